@@ -104,6 +104,8 @@ typedef struct cl_mem_ext_ptr_t {
 
 /* New flags for cl_queue */
 #define CL_QUEUE_DPDK                               (1 << 31)
+/* Waits on the queue and its events spin before blocking, see Runtime.wait_spin */
+#define CL_QUEUE_WAIT_SPIN_XILINX                   (1 << 30)
 
 #define CL_MEM_REGISTER_MAP                         (1 << 27)
 #ifdef PMD_OCL
@@ -188,6 +190,165 @@ xclEnqueuePeerToPeerCopyBuffer(cl_command_queue    command_queue,
                      const cl_event *    event_wait_list,
                      cl_event *          event_parameter);
 
+/*----
+ *
+ * DOC: Command queue capture and replay
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * The commands enqueued on an in-order command queue between
+ * xclBeginCapture() and xclEndCapture() are recorded in a cl_graph.
+ * Captured commands execute as usual.  xclReplayGraph() enqueues the
+ * recorded commands again without argument validation.  NDRange
+ * commands bind the kernel arguments current at replay, so clSetKernelArg
+ * between replays patches the arguments of the replayed kernels.
+ */
+typedef struct _cl_graph *          cl_graph;
+
+/**
+ * xclBeginCapture - start recording commands enqueued on a queue
+ *
+ * CL_INVALID_COMMAND_QUEUE: if command_queue is not valid or is out of order
+ * CL_INVALID_OPERATION    : if command_queue is already capturing
+ */
+extern cl_int
+xclBeginCapture(cl_command_queue command_queue);
+
+/**
+ * xclEndCapture - stop recording and return the recorded graph
+ *
+ * CL_INVALID_COMMAND_QUEUE: if command_queue is not valid
+ * CL_INVALID_OPERATION    : if command_queue is not capturing, or if
+ *                           a recorded command cannot be replayed
+ * CL_INVALID_VALUE        : if graph is nullptr
+ */
+extern cl_int
+xclEndCapture(cl_command_queue command_queue,
+              cl_graph*        graph);
+
+/**
+ * xclReplayGraph - enqueue the commands of a graph
+ *
+ * @event: if not nullptr, returns an event for the last replayed command
+ *
+ * CL_INVALID_COMMAND_QUEUE: if command_queue is not the queue the graph
+ *                           was captured on
+ * CL_INVALID_VALUE        : if graph is nullptr
+ */
+extern cl_int
+xclReplayGraph(cl_command_queue command_queue,
+               cl_graph         graph,
+               cl_event*        event);
+
+/**
+ * xclReleaseGraph - release a graph returned by xclEndCapture
+ */
+extern cl_int
+xclReleaseGraph(cl_graph graph);
+
+/*----
+ *
+ * DOC: Batched buffer transfers
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ * xclEnqueueWriteBuffers() and xclEnqueueReadBuffers() enqueue a batch
+ * of buffer writes or reads as one command with one event, so that
+ * validation, event creation and scheduling are paid once per batch.
+ * Each transfer behaves as the corresponding clEnqueueWriteBuffer() or
+ * clEnqueueReadBuffer().  The transfers of a batch are performed in
+ * arbitrary order, they must not overlap.
+ */
+typedef struct _cl_buffer_transfer_xilinx {
+  cl_mem buffer;
+  size_t offset;
+  size_t size;
+  void*  ptr;
+} cl_buffer_transfer_xilinx;
+
+/**
+ * xclEnqueueWriteBuffers - enqueue writes of host memory to buffers
+ *
+ * @num_transfers: number of entries in transfers
+ * @transfers: buffer ranges and the host memory to write them from,
+ *  the array may be reused once the call returns
+ *
+ * Errors are those of clEnqueueWriteBuffer() for any transfer, and
+ * CL_INVALID_VALUE if num_transfers is 0 or transfers is nullptr
+ */
+extern cl_int
+xclEnqueueWriteBuffers(cl_command_queue                 command_queue,
+                       cl_bool                          blocking,
+                       cl_uint                          num_transfers,
+                       const cl_buffer_transfer_xilinx* transfers,
+                       cl_uint                          num_events_in_wait_list,
+                       const cl_event*                  event_wait_list,
+                       cl_event*                        event);
+
+/**
+ * xclEnqueueReadBuffers - enqueue reads of buffers to host memory
+ *
+ * Arguments and errors as xclEnqueueWriteBuffers(), with the errors of
+ * clEnqueueReadBuffer()
+ */
+extern cl_int
+xclEnqueueReadBuffers(cl_command_queue                 command_queue,
+                      cl_bool                          blocking,
+                      cl_uint                          num_transfers,
+                      const cl_buffer_transfer_xilinx* transfers,
+                      cl_uint                          num_events_in_wait_list,
+                      const cl_event*                  event_wait_list,
+                      cl_event*                        event);
+
+/**
+ * xclSetKernelArgs - set all arguments of a kernel with one call
+ *
+ * @kernel: kernel whose arguments are set
+ * @args_size: size in bytes of args
+ * @args: packed argument values
+ *
+ * The arguments are laid out back to back in argument index order
+ * without padding, each as it would be passed to clSetKernelArg():
+ * the scalar value, a cl_mem for global and constant arguments, a
+ * size_t local memory size for local arguments, and a nullptr cl_mem
+ * for stream arguments.  A struct declared with
+ * __attribute__((packed)) has this layout.
+ *
+ * Arguments whose value is unchanged since the previous call keep
+ * their device register map encoding, so launch loops that update a
+ * few arguments only re-encode those.
+ *
+ * CL_INVALID_KERNEL   : if kernel is not a valid kernel object
+ * CL_INVALID_ARG_SIZE : if args_size does not match the packed size of
+ *                       the kernel arguments, or a local size is 0
+ * CL_INVALID_ARG_VALUE: if args is nullptr
+ */
+extern cl_int
+xclSetKernelArgs(cl_kernel   kernel,
+                 size_t      args_size,
+                 const void* args);
+
+/**
+ * xclPrefetchMemObjects - hint that buffers will soon be used on a device
+ *
+ * @device: device the buffers will be used on
+ * @num_mem_objects: number of entries in mem_objects
+ * @mem_objects: buffers to migrate to device
+ *
+ * Queues a background migration of each buffer to device on the DMA
+ * workers, without a command queue slot or event.  A kernel launched
+ * later finds the buffer resident and does not migrate it; a launch
+ * or host access while the migration is in progress waits for it.
+ * Only buffers already placed in a memory bank of device are migrated,
+ * i.e. bound to a kernel argument or created with a bank; the hint is
+ * ignored for other buffers and for failed migrations.
+ *
+ * CL_INVALID_DEVICE    : if device is not a valid device, or not in the
+ *                        context of a mem object
+ * CL_INVALID_MEM_OBJECT: if a mem object is not a valid buffer
+ * CL_INVALID_VALUE     : if num_mem_objects is 0 or mem_objects is nullptr
+ */
+extern cl_int
+xclPrefetchMemObjects(cl_device_id  device,
+                      cl_uint       num_mem_objects,
+                      const cl_mem* mem_objects);
+
 /*----
  *
  * DOC: OpenCL Stream APIs
@@ -210,6 +371,12 @@ typedef uint64_t cl_stream_flags;
 typedef uint32_t cl_stream_attributes;
 #define CL_STREAM                                   (1 << 0)
 #define CL_PACKET                                   (1 << 1)
+/* Runtime managed ring of pinned buffers, clWriteStream returns once
+ * the data is copied into the ring and clReadStream pops data that the
+ * runtime has already read ahead. Ring depth and buffer size are taken
+ * from Runtime.stream_ring_depth and Runtime.stream_ring_buffer_size
+ * when the stream is created. */
+#define CL_STREAM_RING                              (1 << 2)
 
 /**
  * cl_stream_attributes.
@@ -225,6 +392,7 @@ typedef uint32_t cl_stream_attributes;
 typedef stream_xfer_req_type         cl_stream_xfer_req_type;
 typedef streams_poll_req_completions cl_streams_poll_req_completions;
 typedef stream_xfer_req              cl_stream_xfer_req;
+typedef stream_iovec                 cl_stream_iovec;
 typedef struct _cl_stream *          cl_stream;
 typedef struct _cl_stream_mem *      cl_stream_mem;
 
@@ -292,6 +460,45 @@ clReadStream(cl_device_id     /* device_id*/,
 	     cl_stream_xfer_req*   /* attributes */,
 	     cl_int*               /* errcode_ret*/) CL_API_SUFFIX__VERSION_1_0;
 
+/**
+ * clWriteStreamv - write data gathered from several buffers to stream
+ * @device_id : The device
+ * @stream    : The stream
+ * @vec       : The buffers to write from, in order.
+ * @num       : The number of buffers in @vec.
+ * @req_type  : The write request type.
+ * errcode_ret: The return value eg CL_SUCCESS
+ * Return a cl_int
+ *
+ * The buffers are written as one request, as if they were one
+ * contiguous buffer, so CL_STREAM_EOT ends the packet after the last
+ * buffer.  No staging copy is made.
+ */
+extern CL_API_ENTRY cl_int CL_API_CALL
+clWriteStreamv(cl_device_id           /* device_id*/,
+	cl_stream                    /* stream*/,
+	const cl_stream_iovec*       /* vec */,
+	size_t                       /* num */,
+	cl_stream_xfer_req*          /* attributes */,
+	cl_int*                      /* errcode_ret*/) CL_API_SUFFIX__VERSION_1_0;
+
+/**
+ * clReadStreamv - read data from stream scattered into several buffers
+ * @device_id : The device
+ * @stream    : The stream
+ * @vec       : The buffers to read into, in order.
+ * @num       : The number of buffers in @vec.
+ * @req_type  : The read request type.
+ * errcode_ret: The return value eg CL_SUCCESS
+ * Return a cl_int.
+ */
+extern CL_API_ENTRY cl_int CL_API_CALL
+clReadStreamv(cl_device_id            /* device_id*/,
+	cl_stream                    /* stream*/,
+	const cl_stream_iovec*       /* vec */,
+	size_t                       /* num */,
+	cl_stream_xfer_req*          /* attributes */,
+	cl_int*                      /* errcode_ret*/) CL_API_SUFFIX__VERSION_1_0;
 
 /* clCreateStreamBuffer - Alloc buffer used for read and write.
  * @size       : The size of the buffer
@@ -385,6 +592,17 @@ extern CL_API_ENTRY rte_mbuf* CL_API_CALL
 	    cl_pipe pipe,
 	    cl_int* errcode_ret) CL_API_SUFFIX__VERSION_1_0;
 
+/*Use rte_pktmbuf_alloc_bulk to allocate count buffers from the mempool used by the
+ * pipe in one burst, for use with clWritePipeBuffers. The API will return count if all
+ * buffers were allocated and 0 otherwise, in which case no buffer is allocated.
+ */
+extern CL_API_ENTRY cl_uint CL_API_CALL
+    clAcquirePipeBuffers(cl_command_queue command_queue,
+	    cl_pipe pipe,
+	    rte_mbuf** buf,
+	    cl_uint count,
+	    cl_int* errcode_ret) CL_API_SUFFIX__VERSION_1_0;
+
 
 /*Use rte_pktmbuf_free to return a buffer to the same mempool used by the pipe.
  * This buffer should not be bound to any descriptor in the RX/TX queue referred to by the pipe.
@@ -414,6 +632,11 @@ extern CL_API_ENTRY cl_int CL_API_CALL
 #define XCL_MEM_TOPOLOGY                (1<<31)
 #define XCL_MEM_EXT_P2P_BUFFER          (1<<30)
 
+// cl_context_properties
+// accepted by clCreateContext, value CL_FALSE skips api checks of calls
+// on command queues and kernels of the context
+#define CL_CONTEXT_API_CHECKS_XILINX    0x1400
+
 //cl_program_info
 //accepted by the <flags> paramete of clGetProrgamInfo
 #define CL_PROGRAM_BUFFERS_XILINX       0x1180
@@ -48,6 +48,8 @@ namespace xclemulation{
     mVerbosity = 0; 
     mServerPort = 0; 
     mKeepRunDir=false; 
+    mSharedMemTransport = false;
+    mBatchedRegWrite = false;
   }
 
   static bool getBoolValue(std::string& value,bool defaultValue)
@@ -122,6 +124,14 @@ namespace xclemulation{
       {
         setKeepRunDir(getBoolValue(value,false));
       }
+      else if(name == "shared_mem_transport")
+      {
+        enableSharedMemTransport(getBoolValue(value,false));
+      }
+      else if(name == "batch_register_writes")
+      {
+        enableBatchedRegWrite(getBoolValue(value,false));
+      }
       else if(name == "sim_dir")
       {
         setSimDir(value);
@@ -111,6 +111,8 @@ namespace xclemulation{
       inline void setVerbosityLevel(unsigned int verbosity)     { mVerbosity        = verbosity;     }
       inline void setServerPort(unsigned int serverPort)        { mServerPort       = serverPort;    }
       inline void setKeepRunDir(bool _mKeepRundir)              { mKeepRunDir = _mKeepRundir;        }    
+      inline void enableSharedMemTransport(bool shm)            { mSharedMemTransport = shm;         }
+      inline void enableBatchedRegWrite(bool batch)             { mBatchedRegWrite = batch;          }
       
       inline bool isDiagnosticsEnabled()        const { return mDiagnostics;    }
       inline bool isUMRChecksEnabled()          const { return mUMRChecks;      }
@@ -127,6 +129,8 @@ namespace xclemulation{
       inline bool isErrorsSuppressed()          const { return mSuppressErrors;  }
       inline bool getVerbosityLevel()           const { return mVerbosity;       }    
       inline bool isKeepRunDirEnabled()         const { return mKeepRunDir;       }    
+      inline bool isSharedMemTransportEnabled() const { return mSharedMemTransport; }
+      inline bool isBatchedRegWriteEnabled()    const { return mBatchedRegWrite;    }
       inline bool isInfosToBePrintedOnConsole() const { return mPrintInfosInConsole;   }  
       inline unsigned int getServerPort()       const { return mServerPort;      }
       inline bool isErrorsToBePrintedOnConsole()   const { return mPrintErrorsInConsole;  }
@@ -155,6 +159,8 @@ namespace xclemulation{
       bool mVerbosity;
       unsigned int mServerPort;
       bool mKeepRunDir;
+      bool mSharedMemTransport;
+      bool mBatchedRegWrite;
       
      
       config();
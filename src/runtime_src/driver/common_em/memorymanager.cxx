@@ -19,11 +19,10 @@
 namespace xclemulation {
   MemoryManager::MemoryManager(uint64_t size, uint64_t start,
       unsigned alignment) : mSize(size), mStart(start), mAlignment(alignment),
-  mCoalesceThreshold(4), mFreeSize(0)
+  mFreeSize(0)
   {
     assert(start % alignment == 0);
-    mFreeBufferList.push_back(std::make_pair(mStart, mSize));
-    mFreeSize = mSize;
+    insertFree(mStart, mSize);
   }
 
   MemoryManager::~MemoryManager()
@@ -36,7 +35,6 @@ namespace xclemulation {
     if (origSize == 0)
       origSize = mAlignment;
 
-    uint64_t result = mNull;
     const size_t mod_size = origSize % mAlignment;
     const size_t pad = (mod_size > 0) ? (mAlignment - mod_size) : 0;
     origSize += pad;
@@ -45,99 +43,92 @@ namespace xclemulation {
 
     std::lock_guard<std::mutex> lock(mMemManagerMutex);
 
-    for (PairList::iterator i = mFreeBufferList.begin(), e = mFreeBufferList.end(); i != e; ++i) 
-    {
-      if (i->second < size)
-        continue;
-      result = i->first;
-      if (i->second > size) 
-      {
-        // Resize the existing entry in freelist
-        i->first += size;
-        i->second -= size;
-      }
-      else 
-      {
-        // remove the exact match found
-        mFreeBufferList.erase(i);
-      }
-      mBusyBufferList.push_back(std::make_pair(result, size));
-      mFreeSize -= size;
-      break;
-    }
+    // Smallest free block that fits, lowest address among equal sizes
+    auto fit = mFreeBufferSizes.lower_bound(std::make_pair(static_cast<uint64_t>(size), static_cast<uint64_t>(0)));
+    if (fit == mFreeBufferSizes.end())
+      return mNull;
+
+    uint64_t result = fit->second;
+    uint64_t blockSize = fit->first;
+    eraseFree(mFreeBufferList.find(result));
+    if (blockSize > size)
+      insertFree(result + size, blockSize - size);
+
+    mBusyBufferList.emplace(result, size);
     return result;
   }
 
   void MemoryManager::free(uint64_t buf)
   {
     std::lock_guard<std::mutex> lock(mMemManagerMutex);
-    PairList::iterator i = find(buf);
+    BufferMap::iterator i = mBusyBufferList.find(buf);
     if (i == mBusyBufferList.end())
       return;
-    mFreeSize += i->second;
-    mFreeBufferList.push_back(std::make_pair(i->first, i->second));
+    uint64_t addr = i->first;
+    uint64_t size = i->second;
     mBusyBufferList.erase(i);
-    if (mFreeBufferList.size() > mCoalesceThreshold) {
-      coalesce();
-    }
-  }
-
 
-  void MemoryManager::coalesce()
-  {
-    // First sort the free buffers and then attempt to coalesce the neighbors
-    mFreeBufferList.sort();
-
-    PairList::iterator curr = mFreeBufferList.begin();
-    PairList::iterator next = curr;
-    ++next;
-    PairList::iterator last = mFreeBufferList.end();
-    while (next != last) {
-      if ((curr->first + curr->second) != next->first) {
-        // Non contiguous blocks
-        curr = next;
-        ++next;
-        continue;
+    // Merge with the free neighbours right away
+    auto next = mFreeBufferList.lower_bound(addr);
+    if (next != mFreeBufferList.end() && next->first == addr + size) {
+      size += next->second;
+      next = std::next(next);
+      eraseFree(std::prev(next));
+    }
+    if (next != mFreeBufferList.begin()) {
+      auto prev = std::prev(next);
+      if (prev->first + prev->second == addr) {
+        addr = prev->first;
+        size += prev->second;
+        eraseFree(prev);
       }
-      // Coalesce curr and next
-      curr->second += next->second;
-      mFreeBufferList.erase(next);
-      next = curr;
-      ++next;
     }
+    insertFree(addr, size);
   }
 
+  void MemoryManager::insertFree(uint64_t addr, uint64_t size)
+  {
+    mFreeBufferList.emplace(addr, size);
+    mFreeBufferSizes.emplace(size, addr);
+    mFreeSize += size;
+  }
 
-  MemoryManager::PairList::iterator MemoryManager::find(uint64_t buf)
+  void MemoryManager::eraseFree(BufferMap::iterator it)
   {
-#if GCC_VERSION >= 40800
-    PairList::iterator i = std::find_if(mBusyBufferList.begin(), mBusyBufferList.end(), [&] (const PairList::value_type& s)
-        { return s.first == buf; });
-#else
-    PairList::iterator i = mBusyBufferList.begin();
-    PairList::iterator last  = mBusyBufferList.end();
-    while(i != last) {
-      if (i->first == buf)
-        break;
-      ++i;
-    }
-#endif
-    return i;
+    mFreeSize -= it->second;
+    mFreeBufferSizes.erase(std::make_pair(it->second, it->first));
+    mFreeBufferList.erase(it);
   }
 
   void MemoryManager::reset()
   {
     std::lock_guard<std::mutex> lock(mMemManagerMutex);
     mFreeBufferList.clear();
+    mFreeBufferSizes.clear();
     mBusyBufferList.clear();
-    mFreeBufferList.push_back(std::make_pair(mStart, mSize));
     mFreeSize = 0;
+    insertFree(mStart, mSize);
+  }
+
+  MemoryManager::snapshot_type MemoryManager::snapshot()
+  {
+    std::lock_guard<std::mutex> lock(mMemManagerMutex);
+    return snapshot_type{mFreeBufferList, mFreeBufferSizes, mBusyBufferList, mFreeSize};
+  }
+
+  void MemoryManager::restore(const snapshot_type& snap)
+  {
+    std::lock_guard<std::mutex> lock(mMemManagerMutex);
+    mFreeBufferList = snap.free;
+    mFreeBufferSizes = snap.sizes;
+    mBusyBufferList = snap.busy;
+    mFreeSize = snap.freeSize;
   }
 
   std::pair<uint64_t, uint64_t> MemoryManager::lookup(uint64_t buf)
   {
     std::lock_guard<std::mutex> lock(mMemManagerMutex);
-    PairList::iterator i = find(buf);
+    BufferMap::iterator i = mBusyBufferList.find(buf);
     if (i != mBusyBufferList.end())
       return *i;
     // Compiler bug -- Some versions of GCC C++11 compiler do not
@@ -147,4 +138,3 @@ namespace xclemulation {
     return std::make_pair(v, v);
   }
 }
-
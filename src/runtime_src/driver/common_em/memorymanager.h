@@ -18,7 +18,8 @@
 #define _HWEM_MEMORY_MANAGER_H_
 
 #include <mutex>
-#include <list>
+#include <map>
+#include <set>
 #include <cassert>
 #include <algorithm>
 
@@ -27,28 +28,43 @@
 
 namespace xclemulation
 {
+    /*
+     * Free blocks are indexed both by address, to coalesce with the
+     * neighbours on free, and by (size, address), for best fit alloc.
+     * Busy blocks are indexed by address.  All operations are O(log n).
+     */
     class MemoryManager 
     {
         std::mutex mMemManagerMutex;
-        std::list<std::pair<uint64_t, uint64_t> > mFreeBufferList;
-        std::list<std::pair<uint64_t, uint64_t> > mBusyBufferList;
+        std::map<uint64_t, uint64_t> mFreeBufferList;
+        std::set<std::pair<uint64_t, uint64_t> > mFreeBufferSizes;
+        std::map<uint64_t, uint64_t> mBusyBufferList;
         uint64_t mSize;
         uint64_t mStart;
         uint64_t mAlignment;
-        const unsigned mCoalesceThreshold;
         uint64_t mFreeSize;
 
-        typedef std::list<std::pair<uint64_t, uint64_t> > PairList;
+        typedef std::map<uint64_t, uint64_t> BufferMap;
 
     public:
         static const uint64_t mNull = 0xffffffffffffffffull;
 
+        // Allocation state, restoring it brings back the same busy buffers
+        struct snapshot_type {
+            BufferMap free;
+            std::set<std::pair<uint64_t, uint64_t> > sizes;
+            BufferMap busy;
+            uint64_t freeSize;
+        };
+
     public:
         MemoryManager(uint64_t size, uint64_t start, unsigned alignment);
         ~MemoryManager();
         uint64_t alloc(size_t& size,unsigned int paddingFactor = 0);
         void free(uint64_t buf);
         void reset();
+        snapshot_type snapshot();
+        void restore(const snapshot_type& snap);
 
         uint64_t size()     { return mSize; }
         uint64_t start()    { return mStart; }
@@ -58,8 +74,8 @@ namespace xclemulation
         std::pair<uint64_t, uint64_t>lookup(uint64_t buf);
 
     private:
-        void coalesce();
-        PairList::iterator find(uint64_t buf);
+        void insertFree(uint64_t addr, uint64_t size);
+        void eraseFree(BufferMap::iterator it);
     };
 }
 
@@ -0,0 +1,221 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "shim.h"
+#include "sched_core.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace xclcpuemhal2 {
+
+  // Upper bound on CU poll backoff, each poll is a round trip to the
+  // device process that is executing the CU
+  static const unsigned int max_poll_backoff_usec = 1000;
+
+  const unsigned int CuPool::max_cus;
+
+  CuPool::CuPool(CpuemShim* parent)
+    : mParent(parent)
+    , mNumCuMasks(0)
+    , mCompleted(0)
+    , mStop(false)
+  {
+    std::memset(mCuStatus,0,sizeof(mCuStatus));
+    std::memset(mCuValid,0,sizeof(mCuValid));
+  }
+
+  CuPool::~CuPool()
+  {
+    stop_workers();
+  }
+
+  // Called with mMutex held.  Commands are not referenced after return.
+  void CuPool::complete(ert_packet* packet, ert_cmd_state state)
+  {
+    packet->state = state;
+    ++mCompleted;
+    mDone.notify_all();
+  }
+
+  // Start pending commands on free CUs, called with mMutex held
+  void CuPool::dispatch()
+  {
+    bool started = false;
+    for (auto itr=mPending.begin(); itr!=mPending.end(); ) {
+      auto packet = *itr;
+      auto num_masks = std::min(sched_cu_masks(packet->header),mNumCuMasks);
+      auto cu_idx = sched_get_free_cu(packet->data,mCuStatus,num_masks);
+      if (cu_idx < 0) {
+        ++itr;
+        continue;
+      }
+      packet->state = ERT_CMD_STATE_RUNNING;
+      mCuCmd[cu_idx] = packet;
+      itr = mPending.erase(itr);
+      started = true;
+    }
+    if (started)
+      mWork.notify_all();
+  }
+
+  void CuPool::worker(unsigned int cu_idx)
+  {
+    std::unique_lock<std::mutex> lk(mMutex);
+    while (true) {
+      mWork.wait(lk,[this,cu_idx] { return mStop || mCuCmd[cu_idx]; });
+      if (mStop)
+        return;
+      auto packet = mCuCmd[cu_idx];
+      auto cu_addr = mCuAddr[cu_idx];
+      lk.unlock();
+
+      // data past header and cu_masks, written as sws does, first the
+      // register map, then again with AP_START
+      auto size = sched_regmap_size(packet->header);
+      auto first = packet->data + sched_cu_masks(packet->header);
+      std::vector<uint32_t> regmap(first,first+size);
+      mParent->xclWrite(XCL_ADDR_KERNEL_CTRL,cu_addr,regmap.data(),size*4);
+      regmap[0] = CpuemShim::CONTROL_AP_START;
+      mParent->xclWrite(XCL_ADDR_KERNEL_CTRL,cu_addr,regmap.data(),size*4);
+
+      unsigned int backoff = 0;
+      while (true) {
+        uint32_t ctrlreg = 0;
+        mParent->xclRead(XCL_ADDR_KERNEL_CTRL,cu_addr,&ctrlreg,4);
+        if (ctrlreg & (CpuemShim::CONTROL_AP_IDLE | CpuemShim::CONTROL_AP_DONE))
+          break;
+        backoff = std::min(max_poll_backoff_usec,backoff ? backoff*2 : 10);
+        lk.lock();
+        if (mWork.wait_for(lk,std::chrono::microseconds(backoff),[this] { return mStop; }))
+          return;
+        lk.unlock();
+      }
+
+      lk.lock();
+      mCuCmd[cu_idx] = nullptr;
+      sched_toggle_idx(mCuStatus,cu_idx);
+      complete(packet,ERT_CMD_STATE_COMPLETED);
+      dispatch();
+    }
+  }
+
+  void CuPool::start_workers(unsigned int num_cus)
+  {
+    for (unsigned int cu_idx=0; cu_idx<num_cus; ++cu_idx)
+      mWorkers.emplace_back(&CuPool::worker,this,cu_idx);
+  }
+
+  // Commands pending or running on stopped workers are aborted
+  void CuPool::stop_workers()
+  {
+    {
+      std::lock_guard<std::mutex> lk(mMutex);
+      mStop = true;
+    }
+    mWork.notify_all();
+    for (auto& worker : mWorkers)
+      worker.join();
+    mWorkers.clear();
+
+    std::lock_guard<std::mutex> lk(mMutex);
+    for (auto& packet : mCuCmd) {
+      if (packet)
+        complete(packet,ERT_CMD_STATE_ABORT);
+      packet = nullptr;
+    }
+    for (auto packet : mPending)
+      complete(packet,ERT_CMD_STATE_ABORT);
+    mPending.clear();
+    mStop = false;
+  }
+
+  void CuPool::configure(ert_packet* packet)
+  {
+    auto cfg = reinterpret_cast<ert_configure_cmd*>(packet);
+    auto num_cus = std::min(cfg->num_cus,max_cus);
+
+    stop_workers();
+
+    std::lock_guard<std::mutex> lk(mMutex);
+    mCuAddr.clear();
+    for (unsigned int cu_idx=0; cu_idx<num_cus; ++cu_idx) {
+      // CU addresses follow the fixed fields of the configure command
+      auto addr = (packet->count >= 5 + num_cus)
+        ? cfg->data[cu_idx]
+        : cfg->cu_base_addr + (cu_idx << cfg->cu_shift);
+      mCuAddr.push_back(addr);
+    }
+    mCuCmd.assign(num_cus,nullptr);
+    mNumCuMasks = num_cus ? sched_mask_idx(num_cus-1) + 1 : 0;
+
+    // CUs not in the program are never free
+    std::memset(mCuValid,0,sizeof(mCuValid));
+    for (unsigned int cu_idx=0; cu_idx<num_cus; ++cu_idx)
+      mCuValid[sched_mask_idx(cu_idx)] |= 1 << sched_idx_in_mask(cu_idx);
+    for (unsigned int mask_idx=0; mask_idx<(max_cus>>5); ++mask_idx)
+      mCuStatus[mask_idx] = ~mCuValid[mask_idx];
+
+    start_workers(num_cus);
+    complete(packet,ERT_CMD_STATE_COMPLETED);
+  }
+
+  int CuPool::add_exec_buffer(ert_packet* packet)
+  {
+    if (packet->opcode == ERT_CONFIGURE) {
+      configure(packet);
+      return 0;
+    }
+
+    std::lock_guard<std::mutex> lk(mMutex);
+
+    // nothing to emulate for commands processed by kds itself
+    if (packet->type == ERT_KDS_LOCAL) {
+      complete(packet,ERT_CMD_STATE_COMPLETED);
+      return 0;
+    }
+
+    if (packet->opcode != ERT_START_CU) {
+      complete(packet,ERT_CMD_STATE_ERROR);
+      return 0;
+    }
+
+    // a command none of whose CUs exist would never start
+    bool valid = false;
+    auto num_masks = std::min(sched_cu_masks(packet->header),mNumCuMasks);
+    for (unsigned int mask_idx=0; mask_idx<num_masks; ++mask_idx)
+      valid = valid || (packet->data[mask_idx] & mCuValid[mask_idx]);
+    if (!valid || !sched_regmap_size(packet->header)) {
+      complete(packet,ERT_CMD_STATE_ERROR);
+      return 0;
+    }
+
+    packet->state = ERT_CMD_STATE_QUEUED;
+    mPending.push_back(packet);
+    dispatch();
+    return 0;
+  }
+
+  int CuPool::wait(int timeoutMilliSec)
+  {
+    std::unique_lock<std::mutex> lk(mMutex);
+    mDone.wait_for(lk,std::chrono::milliseconds(timeoutMilliSec),[this] { return mCompleted > 0; });
+    auto completed = mCompleted;
+    mCompleted = 0;
+    return completed;
+  }
+}
@@ -0,0 +1,77 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _SW_EMU_CU_POOL_H_
+#define _SW_EMU_CU_POOL_H_
+
+#include "ert.h"
+
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+namespace xclcpuemhal2 {
+  class CpuemShim;
+
+  // Software emulated compute units for xclExecBuf.
+  //
+  // Start kernel commands are started on the first free CU of their
+  // CU mask in submission order, commands whose CUs are all busy are
+  // passed by later commands for other CUs, as in mb_scheduler.  Each
+  // CU has a worker thread that transfers the register map, starts the
+  // CU, and polls it for done, so CU invocations of independent
+  // commands run concurrently rather than in turn.
+  class CuPool {
+    public:
+      static const unsigned int max_cus = 128;
+
+      CuPool(CpuemShim* parent);
+      ~CuPool();
+
+      int add_exec_buffer(ert_packet* packet);
+      int wait(int timeoutMilliSec);
+
+    private:
+      void configure(ert_packet* packet);
+      void start_workers(unsigned int num_cus);
+      void stop_workers();
+      void dispatch();
+      void complete(ert_packet* packet, ert_cmd_state state);
+      void worker(unsigned int cu_idx);
+
+      CpuemShim* mParent;
+
+      std::mutex mMutex;
+      std::condition_variable mWork;
+      std::condition_variable mDone;
+
+      std::vector<std::thread> mWorkers;
+      std::vector<uint64_t> mCuAddr;
+      std::vector<ert_packet*> mCuCmd;          // command running per CU
+      uint32_t mCuStatus[max_cus>>5];           // busy(1)/free(0) per CU
+      uint32_t mCuValid[max_cus>>5];            // CUs of the program
+      unsigned int mNumCuMasks;
+
+      std::list<ert_packet*> mPending;          // waiting for a free CU
+      unsigned int mCompleted;                  // not yet reported by wait
+      bool mStop;
+  };
+}
+
+#endif
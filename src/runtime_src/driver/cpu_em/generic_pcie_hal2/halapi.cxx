@@ -380,6 +380,22 @@ int xclCopyBO(xclDeviceHandle handle, unsigned int dst_boHandle, unsigned int sr
     return drv ? drv->xclCopyBO(dst_boHandle, src_boHandle, size, dst_offset, src_offset) : -ENODEV;
 }
 
+int xclExecBuf(xclDeviceHandle handle, unsigned int cmdBO)
+{
+  xclcpuemhal2::CpuemShim *drv = xclcpuemhal2::CpuemShim::handleCheck(handle);
+  if (!drv)
+    return -1;
+  return drv->xclExecBuf(cmdBO);
+}
+
+int xclExecWait(xclDeviceHandle handle, int timeoutMilliSec)
+{
+  xclcpuemhal2::CpuemShim *drv = xclcpuemhal2::CpuemShim::handleCheck(handle);
+  if (!drv)
+    return -1;
+  return drv->xclExecWait(timeoutMilliSec);
+}
+
 size_t xclReadBO(xclDeviceHandle handle, unsigned int boHandle, void *dst,
                  size_t size, size_t skip)
 {
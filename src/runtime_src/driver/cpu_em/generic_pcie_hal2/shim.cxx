@@ -419,6 +419,57 @@ namespace xclcpuemhal2 {
       }
     }
     sock = new unix_socket;
+    if(xclemulation::config::getInstance()->isSharedMemTransportEnabled())
+      attachSharedMemTransport();
+  }
+
+  /*
+   * attachSharedMemTransport()
+   *
+   * Create a shared memory region of one packet and offer it to the
+   * device process. Once acked, xclCopyBuffer* payloads are copied
+   * through the region and the RPC messages only carry the descriptors.
+   * Devices that do not know the region nack it and the socket is used.
+   */
+  void CpuemShim::attachSharedMemTransport()
+  {
+    size_t size = get_messagesize();
+    std::string name = "/sw_em_" + std::to_string(getpid()) + "_" + std::to_string(mDeviceIndex);
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0)
+      return;
+    void* addr = MAP_FAILED;
+    if (ftruncate(fd, size) == 0)
+      addr = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+      shm_unlink(name.c_str());
+      return;
+    }
+
+    bool ack = false;
+#ifndef _WINDOWS
+    xclShmAttach_RPC_CALL(xclShmAttach,name,size);
+#endif
+    if (!ack) {
+      munmap(addr, size);
+      shm_unlink(name.c_str());
+      return;
+    }
+    mShmName = name;
+    mShmBuf = addr;
+    mShmSize = size;
+  }
+
+  void CpuemShim::detachSharedMemTransport()
+  {
+    if (!mShmBuf)
+      return;
+    munmap(mShmBuf, mShmSize);
+    shm_unlink(mShmName.c_str());
+    mShmBuf = nullptr;
+    mShmSize = 0;
+    mShmName.clear();
   }
 
   int CpuemShim::xclLoadXclBin(const xclBin *header)
@@ -533,12 +584,15 @@ namespace xclcpuemhal2 {
       if(!ack)
         return -1;
     }
+    // CUs are set up by the configure command of the program
+    mCuPool.reset(new CuPool(this));
     return 0;
   }
 
   int CpuemShim::xclGetDeviceInfo2(xclDeviceInfo2 *info) 
   {
     std::memset(info, 0, sizeof(xclDeviceInfo2));
+    info->mNumaNode = -1;
     fillDeviceInfo(info,&mDeviceInfo);
     for (auto i : mDDRMemoryManager) 
     {
@@ -753,7 +807,13 @@ namespace xclcpuemhal2 {
       uint64_t c_dest = dest + processed_bytes;
 #ifndef _WINDOWS
       uint32_t space =0;
-      xclCopyBufferHost2Device_RPC_CALL(xclCopyBufferHost2Device,handle,c_dest,c_src,c_size,seek,space);
+      if (mShmBuf && c_size <= mShmSize) {
+        std::memcpy(mShmBuf,c_src,c_size);
+        xclCopyBufferHost2DeviceShm_RPC_CALL(xclCopyBufferHost2Device,handle,c_dest,c_size,seek,space);
+      }
+      else {
+        xclCopyBufferHost2Device_RPC_CALL(xclCopyBufferHost2Device,handle,c_dest,c_src,c_size,seek,space);
+      }
 #endif
       processed_bytes += c_size;
     }
@@ -790,7 +850,13 @@ namespace xclcpuemhal2 {
       uint64_t c_src = src + processed_bytes;
 #ifndef _WINDOWS
       uint32_t space =0;
-      xclCopyBufferDevice2Host_RPC_CALL(xclCopyBufferDevice2Host,handle,c_dest,c_src,c_size,skip,space);
+      if (mShmBuf && c_size <= mShmSize) {
+        xclCopyBufferDevice2HostShm_RPC_CALL(xclCopyBufferDevice2Host,handle,c_src,c_size,skip,space);
+        std::memcpy(c_dest,mShmBuf,c_size);
+      }
+      else {
+        xclCopyBufferDevice2Host_RPC_CALL(xclCopyBufferDevice2Host,handle,c_dest,c_src,c_size,skip,space);
+      }
 #endif
 
       processed_bytes += c_size;
@@ -850,6 +916,9 @@ namespace xclcpuemhal2 {
   }
   void CpuemShim::resetProgram(bool callingFromClose)
   {
+    // CU workers access the device, stop them before it goes away
+    mCuPool.reset();
+
     for (auto& it: mFdToFileNameMap)
     {
       int fd=it.first;
@@ -878,6 +947,8 @@ namespace xclcpuemhal2 {
   
   void CpuemShim::xclClose()
   {
+    // CU workers lock mApiMtx, stop them before taking it
+    mCuPool.reset();
     std::lock_guard<std::mutex> lk(mApiMtx);
     if (mLogStream.is_open()) {
       mLogStream << __func__ << ", " << std::this_thread::get_id() << std::endl;
@@ -913,6 +984,7 @@ namespace xclcpuemhal2 {
       while (-1 == waitpid(0, &status, 0));
     
     systemUtil::makeSystemCall(socketName, systemUtil::systemOperation::REMOVE);
+    detachSharedMemTransport();
     delete sock;
     sock = NULL;
     //clean up directories which are created inside the driver
@@ -1350,6 +1422,34 @@ size_t CpuemShim::xclReadBO(unsigned int boHandle, void *dst, size_t size, size_
   return returnVal;
 }
 /***************************************************************************************/
+/******************************** xclExecBuf *******************************************/
+int CpuemShim::xclExecBuf(unsigned int cmdBO)
+{
+  if (mLogStream.is_open())
+  {
+    mLogStream << __func__ << ", " << std::this_thread::get_id() << ", " << cmdBO << std::endl;
+  }
+  xclemulation::drm_xocl_bo* bo = xclGetBoByHandle(cmdBO);
+  if (!mCuPool || !bo || !bo->buf)
+  {
+    PRINTENDFUNC;
+    return -1;
+  }
+  int ret = mCuPool->add_exec_buffer(reinterpret_cast<ert_packet*>(bo->buf));
+  PRINTENDFUNC;
+  return ret;
+}
+/***************************************************************************************/
+
+/******************************** xclExecWait ******************************************/
+int CpuemShim::xclExecWait(int timeoutMilliSec)
+{
+  if (!mCuPool)
+    return -1;
+  return mCuPool->wait(timeoutMilliSec);
+}
+/***************************************************************************************/
+
 /********************************************** QDMA APIs IMPLEMENTATION START **********************************************/
 
 /*
@@ -18,6 +18,7 @@
 #define _SW_EMU_SHIM_H_
 
 #include "unix_socket.h"
+#include "cupool.h"
 #include "config.h"
 #include "em_defines.h"
 #include "memorymanager.h"
@@ -32,6 +33,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <memory>
 #include <thread>
 #include <tuple>
 #include <sys/wait.h>
@@ -74,6 +76,8 @@ namespace xclcpuemhal2 {
       int xclExportBO(unsigned int boHandle); 
       unsigned int xclImportBO(int boGlobalHandle, unsigned flags);
       int xclCopyBO(unsigned int dst_boHandle, unsigned int src_boHandle, size_t size, size_t dst_offset, size_t src_offset);
+      int xclExecBuf(unsigned int cmdBO);
+      int xclExecWait(int timeoutMilliSec);
 
       xclemulation::drm_xocl_bo* xclGetBoByHandle(unsigned int boHandle);
       inline unsigned short xocl_ddr_channel_count();
@@ -180,6 +184,8 @@ namespace xclcpuemhal2 {
 
       void launchDeviceProcess(bool debuggable, std::string& binDir);
       void launchTempProcess();
+      void attachSharedMemTransport();
+      void detachSharedMemTransport();
       void initMemoryManager(std::list<xclemulation::DDRBank>& DDRBankList);
       std::vector<xclemulation::MemoryManager *> mDDRMemoryManager;
 
@@ -194,6 +200,10 @@ namespace xclcpuemhal2 {
       size_t buf_size;
       unsigned int binaryCounter;
       unix_socket* sock;
+      // Payload region for xclCopyBuffer* when shared_mem_transport is set
+      std::string mShmName;
+      void* mShmBuf = nullptr;
+      size_t mShmSize = 0;
 
 
       uint64_t mRAMSize;
@@ -210,6 +220,8 @@ namespace xclcpuemhal2 {
       bool bXPR;
       // HAL2 RELATED member variables start
       std::map<int, xclemulation::drm_xocl_bo*> mXoclObjMap;
+      // CUs of the loaded program for xclExecBuf
+      std::unique_ptr<CuPool> mCuPool;
       static unsigned int mBufferCount;
       static std::map<int, std::tuple<std::string,int,void*> > mFdToFileNameMap;
       // HAL2 RELATED member variables end 
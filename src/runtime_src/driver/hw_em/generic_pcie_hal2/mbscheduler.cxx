@@ -160,22 +160,23 @@ namespace xclhwemhal2 {
 
     slot_addr = ERT_CQ_BASE_ADDR + xcmd->slot_idx*slot_size(xcmd->exec);
 
-    /* TODO write packet minus header */
-    mParent->xclWrite(XCL_ADDR_KERNEL_CTRL, xcmd->exec->base + slot_addr + 4, xcmd->packet->data,(packet_size(xcmd)-1)*sizeof(uint32_t)); 
+    /* packet minus header, then header, then optional cq interrupt, in one batch */
+    std::vector<HwEmShim::KernelCtrlWrite> writes;
+    writes.push_back({xcmd->exec->base + slot_addr + 4, xcmd->packet->data, (packet_size(xcmd)-1)*sizeof(uint32_t)});
     //memcpy_toio(xcmd->exec->base + slot_addr + 4,xcmd->packet->data,(packet_size(xcmd)-1)*sizeof(uint32_t));
 
-    /* TODO write header */
-    mParent->xclWrite(XCL_ADDR_KERNEL_CTRL, xcmd->exec->base + slot_addr, (void*)(&xcmd->packet->header) ,4); 
+    writes.push_back({xcmd->exec->base + slot_addr, &xcmd->packet->header, 4});
     //iowrite32(xcmd->packet->header,xcmd->exec->base + slot_addr);
 
     /* trigger interrupt to embedded scheduler if feature is enabled */
+    uint32_t mask = 0;
     if (xcmd->exec->cq_interrupt) {
       uint32_t cq_int_addr = ERT_CQ_STATUS_REGISTER_ADDR + (slot_mask_idx(xcmd->slot_idx)<<2);
-      uint32_t mask = 1<<slot_idx_in_mask(xcmd->slot_idx);
-      //TODO 
-      mParent->xclWrite(XCL_ADDR_KERNEL_CTRL,xcmd->exec->base + cq_int_addr, (void*)(&mask) ,4);
+      mask = 1<<slot_idx_in_mask(xcmd->slot_idx);
+      writes.push_back({xcmd->exec->base + cq_int_addr, &mask, 4});
         //iowrite32(mask,xcmd->exec->base + cq_int_addr);
     }
+    mParent->xclWriteKernelCtrl(writes);
 #ifdef EM_DEBUG_KDS
     std::cout<<"Submitted the command CXMD: "<<xcmd<<" PACKET: "<<xcmd->packet<< " BO: "<< xcmd->bo << std::endl <<std::endl;;
 #endif
@@ -16,15 +16,52 @@
 
 #include "mem_model.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#ifndef FALLOC_FL_PUNCH_HOLE
+#include <linux/falloc.h>
+#endif
+
 mem_model::~ mem_model()
 {
   serialize();
+  for (auto& b : mBanks) {
+    if (b.addr)
+      munmap(b.addr, b.size);
+    if (b.fd >= 0)
+      close(b.fd);
+  }
+  for (auto& snap : mSnapshots)
+    for (auto& s : snap.second)
+      close(s.fd);
 }
 
-mem_model::mem_model(std::string deviceName):
+mem_model::mem_model(std::string deviceName, const std::vector<std::pair<uint64_t,uint64_t>>& banks):
   mDeviceName(deviceName),
   module_name("dr_wrapper_dr_i_sdaccel_generic_pcie_0.sdaccel_generic_pcie_model.ddrx_top_tlm_model_0.axi_app_tlm_model_0")
 {
+  std::string file_path = get_mem_file_path();
+  for (auto& range : banks) {
+    bank b;
+    b.base = range.first;
+    // whole pages so every page of the bank is inside the mapping
+    b.size = (range.second + PAGESIZE - 1) & ~uint64_t(PAGESIZE - 1);
+    std::string file_name = file_path + module_name + "_bank" + std::to_string(mBanks.size());
+    b.fd = open(file_name.c_str(), O_RDWR | O_CREAT, 0600);
+    if (b.fd < 0 || ftruncate(b.fd, b.size)) {
+      std::cerr << "unable to open/create mem file " << file_name << "\n";
+      exit(1);
+    }
+    void* addr = mmap(0, b.size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, b.fd, 0);
+    if (addr == MAP_FAILED) {
+      std::cerr << "Out of Memory. DDR model does not support this much of memory\n";
+      exit(1);
+    }
+    b.addr = static_cast<unsigned char*>(addr);
+    b.pages.assign(b.size >> ADDRBITS, page_state::untouched);
+    mBanks.push_back(std::move(b));
+  }
 }
 
   unsigned int mem_model::writeDevMem(uint64_t offset, const void* src, unsigned int size)
@@ -35,42 +72,15 @@ mem_model::mem_model(std::string deviceName):
       uint64_t written_bytes = 0;
       uint64_t addr = offset;
       while(written_bytes < size){
-          uint64_t src_offset = written_bytes;
-
-          unsigned char* page_ptr  = get_page(addr);
-          uint64_t       page_addr = addr & ~(-1 << ADDRBITS);
-
-          unsigned char* dest_buf_ptr = page_ptr + page_addr;
-          unsigned char* src_buf_ptr  = (unsigned char*)(src)      + src_offset;
-
-          uint64_t remaining_bytes_to_write = size - written_bytes;
-          uint64_t unaligned_bytes_in_addr = (addr & ~(-1 << ADDRBITS));
-          uint64_t bytes_upto_next_alignment = (0x1 << ADDRBITS) - unaligned_bytes_in_addr;
-
-          uint64_t buf_size = 0;
-          if(bytes_upto_next_alignment > remaining_bytes_to_write)
-          {
-              buf_size = remaining_bytes_to_write;
-          }else{
-              buf_size = bytes_upto_next_alignment;
-          }
+          unsigned char* dest_buf_ptr = get_page(addr, true) + (addr & (PAGESIZE - 1));
+          unsigned char* src_buf_ptr  = (unsigned char*)(src) + written_bytes;
 
+          uint64_t buf_size = std::min<uint64_t>(size - written_bytes, PAGESIZE - (addr & (PAGESIZE - 1)));
           memcpy(dest_buf_ptr,src_buf_ptr,buf_size);
 
           written_bytes += buf_size;
           addr += buf_size;
       }
-#ifdef DEBUGMSG
-      std::cout << endl;
-      std::cout << "Write Operation size : " << size << endl;
-      for(int i = 0; i < size;i++){
-          cout << std::hex << (unsigned int)(((unsigned char*)src)[i]) << " ";
-      }
-      std::cout << endl;
-      cout << "Write : " ;
-      cout << "Offset --> " << offset << endl;
-#endif    
-
       return 0;
   }
 
@@ -78,85 +88,160 @@ mem_model::mem_model(std::string deviceName):
 #ifdef DEBUGMSG
 	  cout<<endl<<module_name<<" read offset:"<<std::hex<< (uint64_t)offset<<endl;
 #endif 
-	 
 	  uint64_t read_bytes = 0;
 	  uint64_t addr = offset;
 	  while(read_bytes < size){
-		  uint64_t dest_offset = read_bytes;
-
-		  unsigned char* page_ptr  = get_page(addr);
-		  uint64_t       page_addr = addr & ~(-1 << ADDRBITS);
+		  unsigned char* src_buf_ptr = get_page(addr, false) + (addr & (PAGESIZE - 1));
+		  unsigned char* dest_buf_ptr  = (unsigned char*)(dest) + read_bytes;
 
-		  unsigned char* src_buf_ptr = page_ptr + page_addr;
-		  unsigned char* dest_buf_ptr  = (unsigned char*)(dest)      + dest_offset;
+		  uint64_t buf_size = std::min<uint64_t>(size - read_bytes, PAGESIZE - (addr & (PAGESIZE - 1)));
+		  memcpy(dest_buf_ptr,src_buf_ptr,buf_size);
 
-		  uint64_t remaining_bytes_to_read = size - read_bytes;
-		  uint64_t unaligned_bytes_in_addr = (addr & ~(-1 << ADDRBITS));
-		  uint64_t bytes_upto_next_alignment = (0x1 << ADDRBITS) - unaligned_bytes_in_addr;
-
-		  uint64_t buf_size = 0;
-		  if(bytes_upto_next_alignment > remaining_bytes_to_read)
-		  {
-			  buf_size = remaining_bytes_to_read;
-		  }else{
-			  buf_size = bytes_upto_next_alignment;
-		  }
-	  memcpy(dest_buf_ptr,src_buf_ptr,buf_size);
 		  read_bytes += buf_size;
 		  addr += buf_size;
 	  }
-#ifdef DEBUGMSG
-	  std::cout << endl;
-	  std::cout << "Read Operation size : " << size << endl;
-	  for(unsigned int i = 0; i < size;i++){
-		  cout << std::hex << (unsigned int)(((unsigned char*)dest)[i]) << " ";
-	  }
-	  std::cout << endl;
-	  cout << "Read : " ;
-	  cout << "Offset --> " << offset << endl;
-#endif    
-
 	  return 0;
   }
-  unsigned char* mem_model::get_page(uint64_t offset) {
-	  uint64_t page_idx = offset >> ADDRBITS;
-	  std::string file_name = get_mem_file_name(page_idx);
-	  if(pageCache.size() > N_1MBARRAYS)
-	  {
+
+  // Give whole pages of a freed buffer back to the file system
+  void mem_model::freeDevMem(uint64_t offset, uint64_t size)
+  {
+    bank* b = get_bank(offset);
+    if (!b)
+      return;
+    uint64_t first = (offset - b->base + PAGESIZE - 1) >> ADDRBITS;
+    uint64_t last = std::min<uint64_t>(offset - b->base + size, b->size) >> ADDRBITS;
+    if (first >= last)
+      return;
+    if (!mRestored.empty()) {
+      // Private copies are dropped and the pages read from the snapshot
+      // again, which must not be punched
+      auto& s = mSnapshots[mRestored][b - mBanks.data()];
+      madvise(b->addr + (first << ADDRBITS), (last - first) << ADDRBITS, MADV_DONTNEED);
+      std::copy(s.pages.begin() + first, s.pages.begin() + last, b->pages.begin() + first);
+      return;
+    }
+    fallocate(b->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, first << ADDRBITS, (last - first) << ADDRBITS);
+    for (uint64_t idx = first; idx < last; ++idx) {
+      if (b->pages[idx] == page_state::untouched)
+        continue;
+      b->pages[idx] = page_state::untouched;
+      unlink(get_mem_file_name((b->base >> ADDRBITS) + idx).c_str());
+    }
+  }
+
+  bool mem_model::snapshot(const std::string& name)
+  {
+    if (mSnapshots.find(name) != mSnapshots.end())
+      return false;
+
+    std::vector<bank_snapshot> snap;
+    std::string file_path = get_mem_file_path();
+    bool ok = true;
+    for (size_t i = 0; ok && i < mBanks.size(); ++i) {
+      auto& b = mBanks[i];
+      bank_snapshot s;
+      std::string file_name = file_path + module_name + "_bank" + std::to_string(i) + "_snapshot";
+      s.fd = open(file_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+      if (s.fd < 0)
+        return false;
+      unlink(file_name.c_str());
+      ok = (ftruncate(s.fd, b.size) == 0);
+      for (uint64_t idx = 0; ok && idx < b.pages.size(); ++idx) {
+        if (b.pages[idx] == page_state::untouched)
+          continue;
+        ok = (pwrite(s.fd, b.addr + (idx << ADDRBITS), PAGESIZE, idx << ADDRBITS) == PAGESIZE);
+      }
+      s.pages = b.pages;
+      snap.push_back(std::move(s));
+    }
+    if (!ok) {
+      for (auto& s : snap)
+        close(s.fd);
+      return false;
+    }
+    mSnapshots[name] = std::move(snap);
+    return true;
+  }
+
+  bool mem_model::restore(const std::string& name)
+  {
+    auto it = mSnapshots.find(name);
+    if (it == mSnapshots.end())
+      return false;
+    for (size_t i = 0; i < mBanks.size(); ++i) {
+      auto& b = mBanks[i];
+      auto& s = it->second[i];
+      void* addr = mmap(b.addr, b.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_NORESERVE | MAP_FIXED, s.fd, 0);
+      if (addr == MAP_FAILED) {
+        std::cerr << "unable to restore device memory snapshot " << name << "\n";
+        exit(1);
+      }
+      b.pages = s.pages;
+    }
+    mRestored = name;
+    return true;
+  }
+
+  bool mem_model::dropSnapshot(const std::string& name)
+  {
+    auto it = mSnapshots.find(name);
+    if (it == mSnapshots.end() || name == mRestored)
+      return false;
+    for (auto& s : it->second)
+      close(s.fd);
+    mSnapshots.erase(it);
+    return true;
+  }
+
+  mem_model::bank* mem_model::get_bank(uint64_t offset)
+  {
+    for (auto& b : mBanks) {
+      if (offset >= b.base && offset < b.base + b.size)
+        return &b;
+    }
+    return nullptr;
+  }
+
+  unsigned char* mem_model::get_page(uint64_t offset, bool write) {
+	  bank* b = get_bank(offset);
+	  if (!b) {
 		  std::cerr << "Out of Memory. DDR model does not support this much of memory\n";
 		  exit(1);
-	  } else {
-      FILE* pFile = NULL;
-		  if(pageCache.find(page_idx) != pageCache.end())
-		  {
-			  return pageCache[page_idx];
-		  } else if(((pFile = fopen(file_name.c_str(),"r")) != NULL)) {
-			  int fhandle = fileno(pFile);
-
-			  if (deserialize_msg.ParseFromFileDescriptor(fhandle) == false)
-        {
-          fclose(pFile);
-          exit(1);
-        }
-			  pageCache[page_idx] = new unsigned char[PAGESIZE];
-
-			  memcpy(pageCache[page_idx],deserialize_msg.data().c_str(),PAGESIZE);
+	  }
+	  uint64_t idx = (offset - b->base) >> ADDRBITS;
+	  unsigned char* page = b->addr + (idx << ADDRBITS);
+	  if (b->pages[idx] == page_state::untouched) {
+		  // Import the page if the DDR model left one behind
+		  std::string file_name = get_mem_file_name(offset >> ADDRBITS);
+		  FILE* pFile = fopen(file_name.c_str(),"r");
+		  if (pFile) {
+			  if (deserialize_msg.ParseFromFileDescriptor(fileno(pFile)) == false)
+			  {
+				  fclose(pFile);
+				  exit(1);
+			  }
+			  memcpy(page,deserialize_msg.data().c_str(),std::min<size_t>(deserialize_msg.data().size(),PAGESIZE));
 			  fclose(pFile);
-			  return pageCache[page_idx];
-		  } else {
-			  pageCache[page_idx] = new unsigned char[PAGESIZE];
-			  return pageCache[page_idx];
 		  }
+		  b->pages[idx] = page_state::clean;
 	  }
+	  if (write)
+		  b->pages[idx] = page_state::dirty;
+	  return page;
   }
 
 
   void mem_model::serialize() {
      FILE *pFile;
      int fhandle;
-     for (pageCacheItr=pageCache.begin(); pageCacheItr != pageCache.end(); ++pageCacheItr)
+     for (auto& b : mBanks)
      {
-        std::string file_name = get_mem_file_name(pageCacheItr->first);
+       for (uint64_t idx = 0; idx < b.pages.size(); ++idx)
+       {
+        if (b.pages[idx] != page_state::dirty)
+          continue;
+        std::string file_name = get_mem_file_name((b.base >> ADDRBITS) + idx);
         pFile = fopen(file_name.c_str(),"w+");
         if(!pFile)
           continue;
@@ -167,19 +252,20 @@ mem_model::mem_model(std::string deviceName):
           exit(1);
         }
 
-        serialize_msg.set_data(reinterpret_cast<const char*>(pageCacheItr->second),PAGESIZE);
+        serialize_msg.set_data(reinterpret_cast<const char*>(b.addr + (idx << ADDRBITS)),PAGESIZE);
         if(serialize_msg.SerializeToFileDescriptor(fhandle) == false)
         {
           fclose(pFile);
           exit(1);
         }
         fclose(pFile);
+        b.pages[idx] = page_state::clean;
+       }
      }
   }
 
- std::string mem_model::get_mem_file_name(uint64_t pageIdx)
+ std::string mem_model::get_mem_file_path()
  {
-   std::string file_name("");
    std::string user("");
    if(getenv("USER") != NULL)
    {
@@ -198,11 +284,14 @@ mem_model::mem_model(std::string deviceName):
      int rV = system(mkdirCommand.str().c_str());
      if(rV == -1) {std::cout<<"unable to open/create mem file"<<std::endl;}
    }
-    file_name = file_path + module_name + "_" + std::to_string(pageIdx);
+   return file_path;
+ }
+
+ std::string mem_model::get_mem_file_name(uint64_t pageIdx)
+ {
+    std::string file_name = get_mem_file_path() + module_name + "_" + std::to_string(pageIdx);
 #ifdef DEBUGMSG
       cout<<"ddr fmodel file_name: "<< file_name<<endl;
 #endif
     return file_name;
  }
-
-
@@ -23,6 +23,7 @@
 #include <sstream> // memcpy
 #include <stdlib.h> //realloc
 #include <map> //realloc
+#include <vector>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -33,19 +34,54 @@
 #define ONE_MB (ONE_KB * ONE_KB)
 #define PAGESIZE (ONE_MB)
 #define ADDRBITS (20)
-#define N_1MBARRAYS 4096
 
+/*
+ * Device memory used before the simulator is running.  Each DDR bank is
+ * one sparse file mapped with MAP_NORESERVE, so an address is a pointer
+ * into the mapping and untouched memory costs nothing.  Pages are also
+ * exchanged with the DDR model of the simulator as one file per page:
+ * a page file is imported the first time the page is touched, and pages
+ * written to are exported on destruction.
+ *
+ * A snapshot copies the touched pages of every bank to an unlinked sparse
+ * file.  Restoring maps the snapshot MAP_PRIVATE over the banks, so it
+ * costs one mmap per bank and pages are only copied when written again.
+ */
 class mem_model{
 public:
 unsigned int writeDevMem(uint64_t offset, const void* src, unsigned int size);
 unsigned int readDevMem(uint64_t offset, void* dest, unsigned int size);
+void freeDevMem(uint64_t offset, uint64_t size);
+
+bool snapshot(const std::string& name);
+bool restore(const std::string& name);
+bool dropSnapshot(const std::string& name);
 
 protected:
 private:
-  unsigned char* get_page(uint64_t offset);
+  enum class page_state : unsigned char { untouched, clean, dirty };
+
+  struct bank {
+    uint64_t base = 0;
+    uint64_t size = 0;
+    int fd = -1;
+    unsigned char* addr = nullptr;
+    std::vector<page_state> pages;
+  };
+
+  struct bank_snapshot {
+    int fd = -1;
+    std::vector<page_state> pages;
+  };
+
+  bank* get_bank(uint64_t offset);
+  unsigned char* get_page(uint64_t offset, bool write);
+  std::string get_mem_file_path();
   std::string get_mem_file_name(uint64_t pageIdx);
-  std::map<uint64_t,unsigned char*> pageCache;
-  std::map<uint64_t,unsigned char*>::iterator pageCacheItr;
+  std::vector<bank> mBanks;
+  std::map<std::string, std::vector<bank_snapshot>> mSnapshots;
+  // snapshot the banks are currently mapped from, empty if none
+  std::string mRestored;
 
   ddr_mem_msg serialize_msg;
   ddr_mem_msg deserialize_msg;
@@ -53,10 +89,9 @@ private:
   std::string mDeviceName;
   std::string module_name;
 public:
-  mem_model(std::string deviceName);
+  // banks are (base address, size) pairs
+  mem_model(std::string deviceName, const std::vector<std::pair<uint64_t,uint64_t>>& banks);
   ~ mem_model();
 };
 
 #endif
-
-
@@ -606,6 +606,10 @@ namespace xclhwemhal2 {
         //std::cout<<"environment is not set properly"<<std::endl;
       }
     }
+    if(sock && xclemulation::config::getInstance()->isSharedMemTransportEnabled())
+      attachSharedMemTransport();
+    if(sock && xclemulation::config::getInstance()->isBatchedRegWriteEnabled())
+      probeBatchedRegWrite();
 
     if(simMode)
     {
@@ -614,6 +618,113 @@ namespace xclhwemhal2 {
     return 0;
   }
 
+  /*
+   * attachSharedMemTransport()
+   *
+   * Create a shared memory region of one packet and offer it to the
+   * device process. Once acked, xclCopyBuffer* payloads are copied
+   * through the region and the RPC messages only carry the descriptors.
+   * Devices that do not know the region nack it and the socket is used.
+   */
+  void HwEmShim::attachSharedMemTransport()
+  {
+    size_t size = xclemulation::config::getInstance()->getPacketSize();
+    std::string name = "/hw_em_" + std::to_string(getpid()) + "_" + deviceName;
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0)
+      return;
+    void* addr = MAP_FAILED;
+    if (ftruncate(fd, size) == 0)
+      addr = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+      shm_unlink(name.c_str());
+      return;
+    }
+
+    bool ack = false;
+#ifndef _WINDOWS
+    xclShmAttach_RPC_CALL(xclShmAttach,name,size);
+#endif
+    if (!ack) {
+      munmap(addr, size);
+      shm_unlink(name.c_str());
+      return;
+    }
+    mShmName = name;
+    mShmBuf = addr;
+    mShmSize = size;
+  }
+
+  void HwEmShim::detachSharedMemTransport()
+  {
+    if (!mShmBuf)
+      return;
+    munmap(mShmBuf, mShmSize);
+    shm_unlink(mShmName.c_str());
+    mShmBuf = nullptr;
+    mShmSize = 0;
+    mShmName.clear();
+  }
+
+  /*
+   * probeBatchedRegWrite()
+   *
+   * An empty xclWriteAddrKernelCtrlBatch tells whether the device process
+   * can apply several kernel control writes per round trip.
+   */
+  void HwEmShim::probeBatchedRegWrite()
+  {
+    bool valid = false;
+    std::vector<KernelCtrlWrite> writes;
+#ifndef _WINDOWS
+    xclWriteAddrKernelCtrlBatch_RPC_CALL(xclWriteAddrKernelCtrlBatch,writes);
+#endif
+    mBatchedRegWrite = valid;
+  }
+
+  /*
+   * xclWriteKernelCtrl()
+   *
+   * Apply kernel control writes in order. Writes to a CU register map go
+   * through xclWrite, which extracts kernel arguments and logs the start,
+   * everything else is sent in one batch when the device supports it.
+   */
+  size_t HwEmShim::xclWriteKernelCtrl(const std::vector<KernelCtrlWrite>& writes)
+  {
+    if (!simulator_started)
+      return 0;
+
+    bool batch = mBatchedRegWrite;
+    for (auto& w : writes) {
+      if (mKernelOffsetArgsInfoMap.find(w.offset) != mKernelOffsetArgsInfoMap.end()
+          || mOffsetInstanceStreamMap.find(w.offset) != mOffsetInstanceStreamMap.end())
+        batch = false;
+    }
+
+    size_t size = 0;
+    if (!batch) {
+      for (auto& w : writes) {
+        if (xclWrite(XCL_ADDR_KERNEL_CTRL, w.offset, w.data, w.size) != w.size)
+          return -1;
+        size += w.size;
+      }
+      return size;
+    }
+
+    if (mLogStream.is_open()) {
+      mLogStream << __func__ << ", " << std::this_thread::get_id() << ", " << writes.size() << std::endl;
+    }
+    for (auto& w : writes)
+      size += w.size;
+
+    bool valid = false;
+#ifndef _WINDOWS
+    xclWriteAddrKernelCtrlBatch_RPC_CALL(xclWriteAddrKernelCtrlBatch,writes);
+#endif
+    return valid ? size : -1;
+  }
+
    size_t HwEmShim::xclWrite(xclAddressSpace space, uint64_t offset, const void *hostBuf, size_t size) {
 
      if (!simulator_started)
@@ -850,7 +961,7 @@ uint32_t HwEmShim::getAddressSpace (uint32_t topology)
     if(!sock)
     {
       if(!mMemModel)
-        mMemModel = new mem_model(deviceName);
+        mMemModel = createMemModel();
       mMemModel->writeDevMem(dest,src,size);
       return size;
     }
@@ -878,7 +989,13 @@ uint32_t HwEmShim::getAddressSpace (uint32_t topology)
       // TODO: Windows build support
       // *_RPC_CALL uses unix_socket
       uint32_t space = getAddressSpace(topology);
-      xclCopyBufferHost2Device_RPC_CALL(xclCopyBufferHost2Device,handle,c_dest,c_src,c_size,seek,space);
+      if (mShmBuf && c_size <= mShmSize) {
+        std::memcpy(mShmBuf,c_src,c_size);
+        xclCopyBufferHost2DeviceShm_RPC_CALL(xclCopyBufferHost2Device,handle,c_dest,c_size,seek,space);
+      }
+      else {
+        xclCopyBufferHost2Device_RPC_CALL(xclCopyBufferHost2Device,handle,c_dest,c_src,c_size,seek,space);
+      }
 #endif
       processed_bytes += c_size;
     }
@@ -896,7 +1013,7 @@ uint32_t HwEmShim::getAddressSpace (uint32_t topology)
     if(!sock)
     {
       if(!mMemModel)
-        mMemModel = new mem_model(deviceName);
+        mMemModel = createMemModel();
       mMemModel->readDevMem(src,dest,size);
       return size;
     }
@@ -924,7 +1041,13 @@ uint32_t HwEmShim::getAddressSpace (uint32_t topology)
       uint64_t c_src = src + processed_bytes;
 #ifndef _WINDOWS
       uint32_t space = getAddressSpace(topology);
-      xclCopyBufferDevice2Host_RPC_CALL(xclCopyBufferDevice2Host,handle,c_dest,c_src,c_size,skip,space);
+      if (mShmBuf && c_size <= mShmSize) {
+        xclCopyBufferDevice2HostShm_RPC_CALL(xclCopyBufferDevice2Host,handle,c_src,c_size,skip,space);
+        std::memcpy(c_dest,mShmBuf,c_size);
+      }
+      else {
+        xclCopyBufferDevice2Host_RPC_CALL(xclCopyBufferDevice2Host,handle,c_dest,c_src,c_size,skip,space);
+      }
 #endif
 
       processed_bytes += c_size;
@@ -1018,11 +1141,24 @@ uint32_t HwEmShim::getAddressSpace (uint32_t topology)
 
     for (auto i : mDDRMemoryManager) {
       if (buf < i->size()) {
+        if (mMemModel) {
+          auto range = i->lookup(buf);
+          if (!xclemulation::MemoryManager::isNullAlloc(range))
+            mMemModel->freeDevMem(range.first, range.second);
+        }
         i->free(buf);
       }
     }
     PRINTENDFUNC;
   }
+
+  mem_model* HwEmShim::createMemModel()
+  {
+    std::vector<std::pair<uint64_t,uint64_t>> banks;
+    for (auto i : mDDRMemoryManager)
+      banks.emplace_back(i->start(), i->size());
+    return new mem_model(deviceName, banks);
+  }
   void HwEmShim::logMessage(std::string& msg , int verbosity)
   {
     if( verbosity > xclemulation::config::getInstance()->getVerbosityLevel())
@@ -1272,6 +1408,8 @@ uint32_t HwEmShim::getAddressSpace (uint32_t topology)
       saveWaveDataBase();
     }
     //ProfilerStop();
+    detachSharedMemTransport();
+    mBatchedRegWrite = false;
     delete sock;
     sock = NULL;
     PRINTENDFUNC;
@@ -1573,6 +1711,7 @@ uint32_t HwEmShim::getAddressSpace (uint32_t topology)
   int HwEmShim::xclGetDeviceInfo2(xclDeviceInfo2 *info)
   {
     std::memset(info, 0, sizeof(xclDeviceInfo2));
+    info->mNumaNode = -1;
     fillDeviceInfo(info,&mDeviceInfo);
     for (auto i : mDDRMemoryManager) {
       info->mDDRFreeSize += i->freeSize();
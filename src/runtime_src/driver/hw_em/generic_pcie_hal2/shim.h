@@ -117,6 +117,10 @@ using addr_type = uint64_t;
       int xclUpgradeFirmware(const char *fileName);
       int xclBootFPGA();
       int resetProgram(bool saveWdb=true);
+      void attachSharedMemTransport();
+      void probeBatchedRegWrite();
+      mem_model* createMemModel();
+      void detachSharedMemTransport();
       int xclGetDeviceInfo2(xclDeviceInfo2 *info);
 
       // Raw read/write
@@ -125,6 +129,15 @@ using addr_type = uint64_t;
       size_t xclReadModifyWrite(uint64_t offset, const void *hostBuf, size_t size);
       size_t xclReadSkipCopy(uint64_t offset, void *hostBuf, size_t size);
 
+      // One XCL_ADDR_KERNEL_CTRL write of a batch
+      struct KernelCtrlWrite
+      {
+        uint64_t offset;
+        const void* data;
+        size_t size;
+      };
+      size_t xclWriteKernelCtrl(const std::vector<KernelCtrlWrite>& writes);
+
       // Buffer management
       uint64_t xclAllocDeviceBuffer(size_t size);
       uint64_t xclAllocDeviceBuffer2(size_t& size, xclMemoryDomains domain, unsigned flags,bool p2pBuffer, std::string &sFileName);
@@ -243,6 +256,12 @@ using addr_type = uint64_t;
       static bool mFirstBinary;
       unsigned int binaryCounter;
       unix_socket* sock;
+      // Payload region for xclCopyBuffer* when shared_mem_transport is set
+      std::string mShmName;
+      void* mShmBuf = nullptr;
+      size_t mShmSize = 0;
+      // Device accepts xclWriteAddrKernelCtrlBatch
+      bool mBatchedRegWrite = false;
       std::string deviceName;
       xclDeviceInfo2 mDeviceInfo;
       unsigned int mDeviceIndex;
@@ -81,6 +81,7 @@ struct ert_packet {
  * struct ert_start_kernel_cmd: ERT start kernel command format
  *
  * @state:           [3-0] current state of a command
+ * @priority:        [9-8] scheduling priority, 0 (default) is lowest
  * @extra_cu_masks:  [11-10] extra CU masks in addition to mandatory mask
  * @count:           [22-12] number of words in payload (data)
  * @opcode:          [27-23] 0, opcode for start_kernel
@@ -97,7 +98,8 @@ struct ert_start_kernel_cmd {
   union {
     struct {
       uint32_t state:4;          /* [3-0]   */
-      uint32_t unused:6;         /* [9-4]  */
+      uint32_t unused:4;         /* [7-4]  */
+      uint32_t priority:2;       /* [9-8]  */
       uint32_t extra_cu_masks:2; /* [11-10]  */
       uint32_t count:11;         /* [22-12] */
       uint32_t opcode:5;         /* [27-23] */
@@ -130,7 +132,11 @@ struct ert_start_kernel_cmd {
  * @cu_isr:1         enable CUISR custom module for HW scheduler
  * @cq_int:1         enable interrupt from host to HW scheduler
  * @cdma:1           enable CDMA kernel
- * @unused:25
+ * @cycles:1         HW scheduler reports per command CU configure cycles in
+ *                   last word of command queue slot
+ * @cu_dma_thresh:8  regmap size in words below which HW scheduler copies
+ *                   regmap to CU itself rather than using CUDMA, 0 for always CUDMA
+ * @unused:16
  * @dsa52:1          reserved for internal use
  *
  * @data:            addresses of @num_cus CUs
@@ -160,7 +166,9 @@ struct ert_configure_cmd {
   uint32_t cu_isr:1;
   uint32_t cq_int:1;
   uint32_t cdma:1;
-  uint32_t unusedf:25;
+  uint32_t cycles:1;
+  uint32_t cu_dma_thresh:8;
+  uint32_t unusedf:16;
   uint32_t dsa52:1;
 
   /* cu address map size is num_cus */
@@ -61,6 +61,9 @@ extern "C" {
     XCL_PMD_DRIVER_DLLESPEC unsigned pmdRecvPkts(xclDeviceHandle handle, StreamHandle strm, PacketObject *pkts, unsigned count);
     XCL_PMD_DRIVER_DLLESPEC PacketObject pmdAcquirePkts(xclDeviceHandle handle);
     XCL_PMD_DRIVER_DLLESPEC void pmdReleasePkts(xclDeviceHandle handle, PacketObject pkt);
+    /* Burst variants, acquire is all or nothing and returns count or 0 */
+    XCL_PMD_DRIVER_DLLESPEC unsigned pmdAcquirePktsBulk(xclDeviceHandle handle, PacketObject *pkts, unsigned count);
+    XCL_PMD_DRIVER_DLLESPEC void pmdReleasePktsBulk(xclDeviceHandle handle, PacketObject *pkts, unsigned count);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,316 @@
+/**
+ *  Copyright (C) 2018, Xilinx Inc
+ *
+ *  This file is dual licensed.  It may be redistributed and/or modified
+ *  under the terms of the Apache 2.0 License OR version 2 of the GNU
+ *  General Public License.
+ *
+ *  Apache License Verbiage
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  GPL license Verbiage:
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.  This program is
+ *  distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public
+ *  License for more details.  You should have received a copy of the
+ *  GNU General Public License along with this program; if not, write
+ *  to the Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ *  Boston, MA 02111-1307 USA
+ *
+ */
+
+/**
+ *  Command scheduler core shared by the xocl (PCIe) and zocl (Zynq)
+ *  kernel drivers.
+ *
+ *  The functions here are OS agnostic and operate on plain bitmask
+ *  arrays, command packet headers, and CU registers accessed through
+ *  per-platform struct sched_core_ops.  Each driver keeps its own
+ *  command objects, command queues and host notification, and
+ *  implements CU selection, CU start and CU completion in terms of
+ *  these functions, so that scheduling fixes apply to both platforms.
+ */
+
+#ifndef _SCHED_CORE_H_
+#define _SCHED_CORE_H_
+
+#if defined(__KERNEL__)
+# include <linux/types.h>
+#else
+# include <stdint.h>
+#endif
+
+#define SCHED_CORE_U32_MASK 0xFFFFFFFF
+
+/* CU control register offsets */
+#define SCHED_CORE_CU_CTRL_ADDR 0x0
+#define SCHED_CORE_CU_GIE_ADDR  0x4
+#define SCHED_CORE_CU_IER_ADDR  0x8
+
+/**
+ * struct sched_core_ops: per-platform CU register access
+ *
+ * @read32: read 32 bit register at byte address @addr of platform @priv
+ * @write32: write @val to 32 bit register at byte address @addr of platform @priv
+ *
+ * Addresses are relative to the register base of the platform, the
+ * platform decides what @priv refers to.
+ */
+struct sched_core_ops {
+  uint32_t (*read32)(void *priv, uint32_t addr);
+  void (*write32)(void *priv, uint32_t addr, uint32_t val);
+};
+
+/**
+ * sched_ffs_or_neg_one() - Find first set bit in a 32 bit mask.
+ *
+ * @mask: mask to check
+ *
+ * First LSBit is at position 0.
+ *
+ * Return: Position of first set bit, or -1 if none
+ */
+static inline int
+sched_ffs_or_neg_one(uint32_t mask)
+{
+  if (!mask)
+    return -1;
+  return __builtin_ctz(mask);
+}
+
+/**
+ * sched_ffz_or_neg_one() - Find first zero bit in a 32 bit mask
+ *
+ * @mask: mask to check
+ * Return: Position of first zero bit, or -1 if none
+ */
+static inline int
+sched_ffz_or_neg_one(uint32_t mask)
+{
+  if (mask==SCHED_CORE_U32_MASK)
+    return -1;
+  return __builtin_ctz(~mask);
+}
+
+/**
+ * sched_mask_idx() - Mask index for a given slot or CU index
+ *
+ * @idx: Global [0..127] index of a slot or CU
+ * Return: Index of the 32 bit mask containing idx
+ */
+static inline unsigned int
+sched_mask_idx(unsigned int idx)
+{
+  return idx >> 5;
+}
+
+/**
+ * sched_idx_in_mask() - Index within the 32 bit mask that contains it
+ *
+ * @idx: Global [0..127] index of a slot or CU
+ * Return: Index of idx within its mask
+ */
+static inline unsigned int
+sched_idx_in_mask(unsigned int idx)
+{
+  return idx - (sched_mask_idx(idx) << 5);
+}
+
+/**
+ * sched_idx_from_mask() - Given idx within a mask return its global idx [0..127]
+ *
+ * @idx: Index within mask identified by mask_idx
+ * @mask_idx: Index of the mask
+ * Return: Global idx [0..127]
+ */
+static inline unsigned int
+sched_idx_from_mask(unsigned int idx, unsigned int mask_idx)
+{
+  return idx + (mask_idx << 5);
+}
+
+/**
+ * sched_toggle_idx() - Toggle busy(1)/free(0) status of an index
+ *
+ * @status: Array of 32 bit status masks
+ * @idx: Global index to toggle
+ */
+static inline void
+sched_toggle_idx(uint32_t *status, unsigned int idx)
+{
+  status[sched_mask_idx(idx)] ^= 1<<sched_idx_in_mask(idx);
+}
+
+/**
+ * sched_acquire_idx() - Acquire first free index and mark it busy
+ *
+ * @status: Array of 32 bit status masks
+ * @num_masks: Number of masks in use
+ * @num: Number of valid indices
+ * Return: Acquired global index, or -1 if none available
+ */
+static inline int
+sched_acquire_idx(uint32_t *status, unsigned int num_masks, unsigned int num)
+{
+  unsigned int mask_idx;
+  for (mask_idx=0; mask_idx<num_masks; ++mask_idx) {
+    int idx = sched_ffz_or_neg_one(status[mask_idx]);
+    if (idx==-1 || sched_idx_from_mask(idx,mask_idx)>=num)
+      continue;
+    status[mask_idx] ^= (1<<idx);
+    return sched_idx_from_mask(idx,mask_idx);
+  }
+  return -1;
+}
+
+/**
+ * sched_cu_ctrl_done() - Check CU control register value for done
+ *
+ * @ctrl: Value read from CU control register at offset 0x0
+ *
+ * Done is indicated by AP_DONE(2) alone or by AP_DONE(2) | AP_IDLE(4)
+ * but not by AP_IDLE itself, so checking AP_DONE is sufficient.
+ *
+ * Return: non zero if CU is done, 0 otherwise
+ */
+static inline int
+sched_cu_ctrl_done(uint32_t ctrl)
+{
+  return (ctrl & 2) != 0;
+}
+
+/**
+ * sched_opcode() - Command opcode [27-23] of packet header
+ */
+static inline uint32_t
+sched_opcode(uint32_t header)
+{
+  return (header >> 23) & 0x1F;
+}
+
+/**
+ * sched_payload_size() - Payload size [22-12] in words of packet header
+ */
+static inline uint32_t
+sched_payload_size(uint32_t header)
+{
+  return (header >> 12) & 0x7FF;
+}
+
+/**
+ * sched_cu_masks() - Number of CU masks in start kernel packet
+ *
+ * @header: Packet header
+ * Return: 1 + extra cu masks [11-10] for start kernel (opcode 0), 0 otherwise
+ */
+static inline uint32_t
+sched_cu_masks(uint32_t header)
+{
+  if (sched_opcode(header)!=0)
+    return 0;
+  return 1 + ((header >> 10) & 0x3);
+}
+
+/**
+ * sched_regmap_size() - Size of regmap is payload size minus the number of cu_masks
+ */
+static inline uint32_t
+sched_regmap_size(uint32_t header)
+{
+  return sched_payload_size(header) - sched_cu_masks(header);
+}
+
+/**
+ * sched_get_free_cu() - Acquire first free CU per command cu masks
+ *
+ * @cmd_masks: CU masks of start kernel command
+ * @cu_status: Array of 32 bit CU busy(1)/free(0) status masks
+ * @num_masks: Number of masks to check
+ *
+ * The acquired CU is marked busy in @cu_status.
+ *
+ * Return: Global index of acquired CU, or -1 if none available
+ */
+static inline int
+sched_get_free_cu(const uint32_t *cmd_masks, uint32_t *cu_status, unsigned int num_masks)
+{
+  unsigned int mask_idx;
+  for (mask_idx=0; mask_idx<num_masks; ++mask_idx) {
+    uint32_t busy_mask = cu_status[mask_idx];
+    int cu_idx = sched_ffs_or_neg_one((cmd_masks[mask_idx] | busy_mask) ^ busy_mask);
+    if (cu_idx<0)
+      continue;
+    cu_status[mask_idx] ^= 1<<cu_idx;
+    return sched_idx_from_mask(cu_idx,mask_idx);
+  }
+  return -1;
+}
+
+/**
+ * sched_configure_cu() - Transfer register map to CU and start the CU
+ *
+ * @ops: Platform register access
+ * @priv: Platform handle passed to @ops
+ * @cu_addr: Address of CU
+ * @regmap: Register map of start kernel command
+ * @size: Number of words in @regmap
+ * @irq: Enable CU ap_done interrupt when non zero
+ *
+ * The first word of @regmap (AP_START) is skipped and the CU is started
+ * after the register map, and the interrupt enables which it covers,
+ * have been written.
+ */
+static inline void
+sched_configure_cu(const struct sched_core_ops *ops, void *priv, uint32_t cu_addr,
+                   const uint32_t *regmap, uint32_t size, int irq)
+{
+  uint32_t i;
+  for (i=1; i<size; ++i)
+    ops->write32(priv,cu_addr + (i<<2),regmap[i]);
+
+  if (irq) {
+    ops->write32(priv,cu_addr + SCHED_CORE_CU_GIE_ADDR,0x1);
+    ops->write32(priv,cu_addr + SCHED_CORE_CU_IER_ADDR,0x1);
+  }
+
+  ops->write32(priv,cu_addr + SCHED_CORE_CU_CTRL_ADDR,0x1);
+}
+
+/**
+ * sched_cu_done() - Check CU for done and release it if done
+ *
+ * @ops: Platform register access
+ * @priv: Platform handle passed to @ops
+ * @cu_addr: Address of CU
+ * @cu_status: Array of 32 bit CU busy(1)/free(0) status masks
+ * @cu_idx: Global index of CU, marked free in @cu_status if done
+ *
+ * Return: non zero if CU is done, 0 otherwise
+ */
+static inline int
+sched_cu_done(const struct sched_core_ops *ops, void *priv, uint32_t cu_addr,
+              uint32_t *cu_status, unsigned int cu_idx)
+{
+  if (!sched_cu_ctrl_done(ops->read32(priv,cu_addr + SCHED_CORE_CU_CTRL_ADDR)))
+    return 0;
+  sched_toggle_idx(cu_status,cu_idx);
+  return 1;
+}
+
+#endif
@@ -16,6 +16,7 @@
  */
 
 #include <stdint.h>
+#include <stddef.h>
 
 #ifndef _XRT_STREAM_H
 #define _XRT_STREAM_H
@@ -40,6 +41,15 @@ typedef struct stream_xfer_req {
     char                    reserved[64];
 } stream_xfer_req;
 
+/**
+ * cl_stream_iovec.
+ * One piece of a vectored read or write request.
+ */
+typedef struct stream_iovec {
+    void*                   ptr;
+    size_t                  size;
+} stream_iovec;
+
 /**
  * struct cl_streams_poll_req_completions
  * For each poll completion provide one of this struct.
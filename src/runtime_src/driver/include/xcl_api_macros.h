@@ -207,6 +207,18 @@ mtx.unlock();
     FREE_BUFFERS(); \
     xclWriteAddrKernelCtrl_RETURN();
 
+//--------------------xclWriteAddrKernelCtrlBatch--------------------------------
+#define xclWriteAddrKernelCtrlBatch_RPC_CALL(func_name,writes) \
+    RPC_PROLOGUE(func_name); \
+    for (auto& w : writes) { \
+      xclWriteAddrKernelCtrlBatch_call_regWrite* regWrite = c_msg.add_writes(); \
+      regWrite->set_addr(w.offset); \
+      regWrite->set_data((const char*)w.data, w.size); \
+    } \
+    SERIALIZE_AND_SEND_MSG(func_name)\
+    valid = r_msg.valid(); \
+    FREE_BUFFERS();
+
 //-----------------------xclReadAddrSpaceDeviceRam----------------------------
 //Generate call and info message
 #define xclReadAddrSpaceDeviceRam_SET_PROTOMESSAGE(func_name,address_space,addr,data,size) \
@@ -327,6 +339,41 @@ mtx.unlock();
     xclCopyBufferDevice2Host_RETURN();
 
 
+//-----------xclCopyBuffer* through shared memory-----------------
+//Payload is in the xclShmAttach region, the messages carry no data
+#define xclCopyBufferHost2DeviceShm_RPC_CALL(func_name,dev_handle,dest,size,seek,space) \
+    RPC_PROLOGUE(func_name); \
+    c_msg.set_xcldevicehandle((char*)dev_handle); \
+    c_msg.set_dest(dest); \
+    c_msg.set_src(std::string()); \
+    c_msg.set_size(size); \
+    c_msg.set_seek(seek); \
+    c_msg.set_space(space); \
+    c_msg.set_shm(true); \
+    SERIALIZE_AND_SEND_MSG(func_name)\
+    FREE_BUFFERS();
+
+#define xclCopyBufferDevice2HostShm_RPC_CALL(func_name,dev_handle,src,size,skip,space) \
+    RPC_PROLOGUE(func_name); \
+    c_msg.set_xcldevicehandle((char*)dev_handle); \
+    c_msg.set_dest(std::string()); \
+    c_msg.set_src(src); \
+    c_msg.set_size(size); \
+    c_msg.set_skip(skip); \
+    c_msg.set_space(space); \
+    c_msg.set_shm(true); \
+    SERIALIZE_AND_SEND_MSG(func_name)\
+    FREE_BUFFERS();
+
+//-----------xclShmAttach-----------------
+#define xclShmAttach_RPC_CALL(func_name,name,size) \
+    RPC_PROLOGUE(func_name); \
+    c_msg.set_name(name); \
+    c_msg.set_size(size); \
+    SERIALIZE_AND_SEND_MSG(func_name)\
+    ack = r_msg.ack(); \
+    FREE_BUFFERS();
+
 //----------xclPerfMonReadCounters------------
 #define xclPerfMonReadCounters_SET_PROTOMESSAGE() \
     if(simulator_started == false) \
@@ -53,5 +53,7 @@
 #define xclReadQueue_n 25
 #define xclDestroyQueue_n 26
 #define xclImportBO_n 27
+#define xclShmAttach_n 28
+#define xclWriteAddrKernelCtrlBatch_n 29
 
 #endif
@@ -157,7 +157,8 @@ extern "C" {
         BMC,
         BUILD_METADATA,
         KEYVALUE_METADATA,
-        USER_METADATA
+        USER_METADATA,
+        BITSTREAM_COMPRESSED    /* zlib stream of a BITSTREAM section, used when BITSTREAM is absent */
     };
 
     enum MEM_TYPE {
@@ -170,6 +171,7 @@ extern "C" {
         MEM_HBM,
         MEM_BRAM,
         MEM_URAM,
+        MEM_HOST, //Pinned host memory accessed by kernels over PCIe
     };
 
     enum IP_TYPE {
@@ -0,0 +1,94 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * Binary capture of HAL calls
+ *
+ * Written by the runtime when Runtime.hal_capture names a file, and
+ * read by xbreplay.  A capture is a struct xclCaptureHeader followed by
+ * struct xclCaptureRecord entries in call order, each followed by
+ * @payload bytes.  All fields are in host byte order.
+ */
+
+#ifndef _XCL_CAPTURE_H_
+#define _XCL_CAPTURE_H_
+
+#include <stdint.h>
+
+#define XCL_CAPTURE_MAGIC   "xclcap\0"
+#define XCL_CAPTURE_VERSION 1
+
+/**
+ * enum xclCaptureOp: Captured HAL call
+ *
+ * @XCL_CAPTURE_ALLOC:         xclAllocBO, @flags are the BO flags
+ * @XCL_CAPTURE_ALLOC_USERPTR: xclAllocUserPtrBO, @flags are the BO flags
+ * @XCL_CAPTURE_FREE:          xclFreeBO
+ * @XCL_CAPTURE_SYNC:          xclSyncBO, @flags is the xclBOSyncDirection
+ * @XCL_CAPTURE_EXEC_ALLOC:    xclAllocBO of a command buffer
+ * @XCL_CAPTURE_EXEC_BUF:      xclExecBuf, payload is the ERT packet
+ * @XCL_CAPTURE_EXEC_WAIT:     xclExecWait, @offset is the timeout in ms
+ */
+enum xclCaptureOp {
+    XCL_CAPTURE_ALLOC = 1,
+    XCL_CAPTURE_ALLOC_USERPTR,
+    XCL_CAPTURE_FREE,
+    XCL_CAPTURE_SYNC,
+    XCL_CAPTURE_EXEC_ALLOC,
+    XCL_CAPTURE_EXEC_BUF,
+    XCL_CAPTURE_EXEC_WAIT,
+};
+
+/**
+ * struct xclCaptureHeader: Start of a capture file
+ *
+ * @magic:   XCL_CAPTURE_MAGIC
+ * @version: XCL_CAPTURE_VERSION
+ * @device:  Index of the captured device
+ */
+struct xclCaptureHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t device;
+};
+
+/**
+ * struct xclCaptureRecord: One HAL call
+ *
+ * @start:    Start of the call in ns since the capture was opened
+ * @duration: Time spent in the call in ns, 0 for asynchronous syncs
+ * @op:       enum xclCaptureOp
+ * @bo:       BO handle of the capturing process
+ * @size:     Size of BO or transfer
+ * @offset:   Offset of transfer in BO
+ * @flags:    Per @op, see enum xclCaptureOp
+ * @ret:      Return value of the call
+ * @payload:  Number of bytes following the record
+ */
+struct xclCaptureRecord {
+    uint64_t start;
+    uint64_t duration;
+    uint32_t op;
+    uint32_t bo;
+    uint64_t size;
+    uint64_t offset;
+    uint32_t flags;
+    int32_t ret;
+    uint32_t payload;
+    uint32_t reserved;
+};
+
+#endif
@@ -138,6 +138,7 @@ struct xclDeviceInfo2 {
   unsigned short mVccIntVol;
   unsigned short mVccIntCurr;
   unsigned short mNumCDMA;
+  int mNumaNode;                      // NUMA node of the device, -1 if unknown
   // More properties here
 };
 
@@ -205,6 +206,23 @@ enum xclBOSyncDirection {
     XCL_BO_SYNC_BO_FROM_DEVICE,
 };
 
+/*
+ * Allocation hint in flags of xclAllocBO(), the buffer is expected to
+ * live long and is placed together with other long lived buffers to
+ * limit fragmentation of device memory
+ */
+#define XCL_BO_FLAGS_LONG_LIVED (1 << 28)
+
+/**
+ * struct xclBOSyncRange - One range of a vectored sync, see xclSyncBOv()
+ */
+struct xclBOSyncRange {
+    unsigned int boHandle;
+    enum xclBOSyncDirection dir;
+    size_t size;
+    size_t offset;
+};
+
 /**
  * Define address spaces on the device AXI bus. The enums are used in xclRead() and xclWrite()
  * to pass relative offsets.
@@ -528,6 +546,41 @@ XCL_DRIVER_DLLESPEC size_t xclWriteBO(xclDeviceHandle handle, unsigned int boHan
 XCL_DRIVER_DLLESPEC size_t xclReadBO(xclDeviceHandle handle, unsigned int boHandle,
                                      void *dst, size_t size, size_t skip);
 
+/**
+ * xclWriteSyncBO() - Copy-in user data to BO and synchronize it to device memory
+ *
+ * @handle:        Device handle
+ * @boHandle:      BO handle
+ * @src:           Source data pointer
+ * @size:          Size of data to copy
+ * @seek:          Offset within the BO
+ * Return:         0 on success or appropriate error number
+ *
+ * Same as xclWriteBO() followed by xclSyncBO() to the device for the range,
+ * in one call.  Large writes are DMAed straight from ``src`` to device memory
+ * without copying through host backing storage, whose contents for the range
+ * are undefined afterwards.
+ */
+XCL_DRIVER_DLLESPEC int xclWriteSyncBO(xclDeviceHandle handle, unsigned int boHandle,
+                                       const void *src, size_t size, size_t seek);
+
+/**
+ * xclSyncReadBO() - Synchronize BO from device memory and copy-out user data
+ *
+ * @handle:        Device handle
+ * @boHandle:      BO handle
+ * @dst:           Destination data pointer
+ * @size:          Size of data to copy
+ * @skip:          Offset within the BO
+ * Return:         0 on success or appropriate error number
+ *
+ * Same as xclSyncBO() from the device for the range followed by xclReadBO(),
+ * in one call.  Large reads are DMAed straight from device memory to ``dst``,
+ * host backing storage of the range is undefined afterwards.
+ */
+XCL_DRIVER_DLLESPEC int xclSyncReadBO(xclDeviceHandle handle, unsigned int boHandle,
+                                      void *dst, size_t size, size_t skip);
+
 /**
  * xclMapBO() - Memory map BO into user's address space
  *
@@ -537,10 +590,26 @@ XCL_DRIVER_DLLESPEC size_t xclReadBO(xclDeviceHandle handle, unsigned int boHand
  * Return:         Memory mapped buffer
  *
  * Map the contents of the buffer object into host memory
- * To unmap the buffer call POSIX unmap() on mapped void * pointer returned from xclMapBO
+ * To unmap the buffer call POSIX unmap() on mapped void * pointer returned from xclMapBO,
+ * or xclUnmapBO() which also works when the driver caches mappings
  */
 XCL_DRIVER_DLLESPEC void *xclMapBO(xclDeviceHandle handle, unsigned int boHandle, bool write);
 
+/**
+ * xclUnmapBO() - Release a mapping obtained from xclMapBO()
+ *
+ * @handle:        Device handle
+ * @boHandle:      BO handle
+ * @addr:          Pointer returned by xclMapBO()
+ * Return:         0 on success or appropriate error number
+ *
+ * When the driver caches BO mappings (XCL_BO_MAP_CACHE set in the environment)
+ * repeated xclMapBO() calls return the same pointer and the mapping is kept
+ * until the BO is freed, so callers must release it with this function instead
+ * of POSIX munmap().  Without the cache this is equivalent to munmap().
+ */
+XCL_DRIVER_DLLESPEC int xclUnmapBO(xclDeviceHandle handle, unsigned int boHandle, void *addr);
+
 /**
  * xclSyncBO() - Synchronize buffer contents in requested direction
  *
@@ -556,6 +625,53 @@ XCL_DRIVER_DLLESPEC void *xclMapBO(xclDeviceHandle handle, unsigned int boHandle
  */
 XCL_DRIVER_DLLESPEC int xclSyncBO(xclDeviceHandle handle, unsigned int boHandle, xclBOSyncDirection dir,
                                   size_t size, size_t offset);
+
+/**
+ * xclSyncBOAsync() - Start synchronizing buffer contents without waiting for completion
+ *
+ * @handle:        Device handle
+ * @boHandle:      BO handle
+ * @dir:           To device or from device
+ * @size:          Size of data to synchronize
+ * @offset:        Offset within the BO
+ * @fd:            File descriptor created with eventfd system call
+ * Return:         0 when the sync was started or standard errno, drivers without
+ *                 support fail with -EINVAL
+ *
+ * The driver adds 1 to the eventfd counter when the sync completes, or
+ * 1<<32 when it fails, so completion can be waited for with read() or
+ * poll() on @fd.  Many syncs can be outstanding at the same time.
+ */
+XCL_DRIVER_DLLESPEC int xclSyncBOAsync(xclDeviceHandle handle, unsigned int boHandle, xclBOSyncDirection dir,
+                                       size_t size, size_t offset, int fd);
+
+/**
+ * xclSyncBOv() - Synchronize multiple buffer ranges with one call to the driver
+ *
+ * @handle:        Device handle
+ * @ranges:        Array of ranges, each naming BO, direction, size and offset
+ * @num:           Number of ranges
+ * Return:         0 on success or standard errno of first failing range
+ *
+ * Ranges are synchronized in array order.  Consecutive ranges of the same
+ * BO and direction are programmed by the driver as one DMA descriptor
+ * chain when the DMA engine supports it, so image and strided transfers
+ * cost one system call and one transfer instead of one per row.
+ */
+XCL_DRIVER_DLLESPEC int xclSyncBOv(xclDeviceHandle handle, const struct xclBOSyncRange *ranges, size_t num);
+
+/**
+ * xclSetSyncChannel() - Prefer a DMA channel for syncs issued by the calling thread
+ *
+ * @handle:        Device handle
+ * @channel:       DMA channel, or -1 to let the driver pick any free channel
+ * Return:         0 on success or standard errno
+ *
+ * Applies to xclSyncBO() and xclSyncBOv() calls made later by the same
+ * thread.  Threads that each own a channel move data concurrently without
+ * waiting for each other; a busy channel makes the driver use another one.
+ */
+XCL_DRIVER_DLLESPEC int xclSetSyncChannel(xclDeviceHandle handle, int channel);
 /**
  * xclCopyBO() - Copy device buffer contents to another buffer
  *
@@ -599,6 +715,63 @@ XCL_DRIVER_DLLESPEC int xclExportBO(xclDeviceHandle handle, unsigned int boHandl
  */
 XCL_DRIVER_DLLESPEC unsigned int xclImportBO(xclDeviceHandle handle, int fd, unsigned flags);
 
+/* Max number of BOs in a pool created by xclCreateBOPool() */
+#define XCL_BO_POOL_MAX 1024
+
+/**
+ * xclCreateBOPool() - Create a pool of BOs shared with forked processes
+ *
+ * @handle:        Device handle
+ * @size:          Size of each BO
+ * @count:         Number of BOs, at most XCL_BO_POOL_MAX
+ * @flags:         Allocation flags (memory bank) as for xclAllocBO()
+ * Return:         Pool id or standard errno
+ *
+ * Allocates the BOs and exports each as a DMA-BUF fd.  The freelist of
+ * the pool is in anonymous shared memory.  Processes forked after this
+ * call inherit both, open their own device handle and take BOs with
+ * xclAcquirePoolBO(), so a fleet of pre-forked workers shares one set
+ * of buffers.  A BO acquired by a process that exits without releasing
+ * it stays taken.
+ */
+XCL_DRIVER_DLLESPEC int xclCreateBOPool(xclDeviceHandle handle, size_t size, unsigned count, unsigned flags);
+
+/**
+ * xclAcquirePoolBO() - Take a free BO from a pool
+ *
+ * @handle:        Device handle of the calling process
+ * @pool:          Pool id from xclCreateBOPool()
+ * @index:         Receives the index of the BO in the pool
+ * Return:         BO handle valid on @handle, or NULLBO if the pool is empty
+ *
+ * The first acquire of a BO in a process imports its DMA-BUF fd, later
+ * acquires of the same BO reuse the imported handle.
+ */
+XCL_DRIVER_DLLESPEC unsigned int xclAcquirePoolBO(xclDeviceHandle handle, int pool, unsigned *index);
+
+/**
+ * xclReleasePoolBO() - Return a BO to its pool
+ *
+ * @handle:        Device handle of the calling process
+ * @pool:          Pool id from xclCreateBOPool()
+ * @index:         Index returned by xclAcquirePoolBO()
+ * Return:         0 on success or standard errno
+ */
+XCL_DRIVER_DLLESPEC int xclReleasePoolBO(xclDeviceHandle handle, int pool, unsigned index);
+
+/**
+ * xclDestroyBOPool() - Release a pool in the calling process
+ *
+ * @handle:        Device handle of the calling process
+ * @pool:          Pool id from xclCreateBOPool()
+ * Return:         0 on success or standard errno
+ *
+ * Frees the BOs imported by the calling process.  Called by the process
+ * that created the pool, after the other processes are done with it,
+ * it also frees the BOs and the freelist.
+ */
+XCL_DRIVER_DLLESPEC int xclDestroyBOPool(xclDeviceHandle handle, int pool);
+
 /**
  * xclGetBOProperties() - Obtain xclBOProperties struct for a BO
  *
@@ -775,6 +948,20 @@ XCL_DRIVER_DLLESPEC ssize_t xclUnmgdPread(xclDeviceHandle handle, unsigned flags
 XCL_DRIVER_DLLESPEC ssize_t xclUnmgdPwrite(xclDeviceHandle handle, unsigned flags, const void *buf,
                                            size_t size, uint64_t offset);
 
+/**
+ * xclUnmgdOpen() - Open a file descriptor for asynchronous unmanaged DMA
+ *
+ * @handle:        Device handle
+ * @flags:         Unused
+ * Return:         file descriptor or appropriate error number
+ *
+ * Reads and writes of the descriptor DMA from/to the absolute device address given by the
+ * file offset, like xclUnmgdPread() and xclUnmgdPwrite().  Submitted with Linux AIO or
+ * io_uring they return once queued, so one thread can keep many transfers in flight and
+ * reap their completions in batches.  The caller closes the descriptor with close().
+ */
+XCL_DRIVER_DLLESPEC int xclUnmgdOpen(xclDeviceHandle handle, unsigned flags);
+
 /* End HAL Unmanaged DMA APIs */
 
 /*
@@ -873,6 +1060,40 @@ XCL_DRIVER_DLLESPEC int xclExecBuf(xclDeviceHandle handle, unsigned int cmdBO);
  */
 XCL_DRIVER_DLLESPEC int xclExecBufWithWaitList(xclDeviceHandle handle, unsigned int cmdBO, size_t num_bo_in_wait_list, unsigned int *bo_wait_list);
 
+/**
+ * xclExecBufBatch() - Submit multiple execution requests to the embedded (or software) scheduler
+ *
+ * @handle:        Device handle
+ * @cmdBOs:        BO handles containing command packets
+ * @num:           Number of BO handles in cmdBOs
+ * Return:         Number of leading exec buffers submitted, less than @num
+ *                 on error with errno set
+ *
+ * Submit a batch of exec buffers with one call into the driver.  The exec
+ * buffers are scheduled in array order exactly as if each had been
+ * submitted with xclExecBuf().  On error the exec buffers before the
+ * returned index have been submitted and must be waited for, none of the
+ * remaining exec buffers have been submitted.
+ */
+XCL_DRIVER_DLLESPEC int xclExecBufBatch(xclDeviceHandle handle, const unsigned int *cmdBOs, size_t num);
+
+/**
+ * xclExecCompletions() - Retrieve completed exec buffers without a system call
+ *
+ * @handle:        Device handle
+ * @cmdBOs:        Array receiving BO handles of completed exec buffers
+ * @max:           Maximum number of BO handles to retrieve
+ * Return:         Number of BO handles retrieved, -ENOSYS if not supported,
+ *                 -EOVERFLOW if completions were lost, or other standard error number
+ *
+ * Completed exec buffers are reported through a ring shared with the
+ * driver.  Each exec buffer is reported once after its command state has
+ * been updated.  When -EOVERFLOW is returned the caller must check the
+ * state of every outstanding exec buffer, completions may also be lost
+ * for exec buffers submitted before the first call to this function.
+ */
+XCL_DRIVER_DLLESPEC int xclExecCompletions(xclDeviceHandle handle, unsigned int *cmdBOs, size_t max);
+
 /**
  * xclExecWait() - Wait for one or more execution events on the device
  *
@@ -887,6 +1108,22 @@ XCL_DRIVER_DLLESPEC int xclExecBufWithWaitList(xclDeviceHandle handle, unsigned
  */
 XCL_DRIVER_DLLESPEC int xclExecWait(xclDeviceHandle handle, int timeoutMilliSec);
 
+/**
+ * xclExecPollFd() - Get file descriptor signalled by execution events on the device
+ *
+ * @handle:        Device handle
+ * Return:         File descriptor or standard error number
+ *
+ * The returned descriptor reports POLLIN under the same conditions that make
+ * xclExecWait() return > 0, so it can be added to an application's own
+ * poll/epoll event loop instead of dedicating a thread to xclExecWait().
+ * Each readiness report consumes one pending notification.  Once readable,
+ * use xclExecCompletions() to reap completed exec buffers without blocking.
+ * The descriptor is owned by the device handle and must not be closed or
+ * read by the caller.
+ */
+XCL_DRIVER_DLLESPEC int xclExecPollFd(xclDeviceHandle handle);
+
 /**
  * xclRegisterInterruptNotify() - register *eventfd* file handle for a MSIX interrupt
  *
@@ -942,6 +1179,21 @@ XCL_DRIVER_DLLESPEC size_t xclPerfMonStopCounters(xclDeviceHandle handle, xclPer
 XCL_DRIVER_DLLESPEC size_t xclPerfMonReadCounters(xclDeviceHandle handle, xclPerfMonType type,
                                                           xclCounterResults& counterResults);
 
+/*
+ * Snapshot all SPM/SAM/SSPM counters and return the rates since the
+ * previous snapshot. Does not require profiling to be enabled, memory
+ * monitor counters are enabled on first use.
+ */
+XCL_DRIVER_DLLESPEC size_t xclPerfMonSampleCounters(xclDeviceHandle handle, xclCounterSample& sample);
+
+/*
+ * Sample counters every intervalMsec from a background thread and publish
+ * them in an xclCounterSamplePage shared memory page for external monitors.
+ */
+XCL_DRIVER_DLLESPEC int xclPerfMonStartSampling(xclDeviceHandle handle, unsigned int intervalMsec);
+
+XCL_DRIVER_DLLESPEC int xclPerfMonStopSampling(xclDeviceHandle handle);
+
 XCL_DRIVER_DLLESPEC size_t xclDebugReadIPStatus(xclDeviceHandle handle, xclDebugReadType type,
                                                                            void* debugResults);
 
@@ -1083,6 +1335,8 @@ enum xclQueueRequestFlag {
     XCL_QUEUE_REQ_CDH			= 1 << 1,
     XCL_QUEUE_REQ_NONBLOCKING		= 1 << 2,
     XCL_QUEUE_REQ_SILENT		= 1 << 3,
+    /* runtime only, no CL_STREAM equivalent: bufs are one request */
+    XCL_QUEUE_REQ_GATHER		= 1 << 5,
 };
 
 /**
@@ -1134,6 +1388,9 @@ struct xclReqCompletion {
  *         end of transmit signal will be added at last
  *     silent: (only used with non-blocking);
  *         No event generated after write completes
+ *     gather:
+ *         all bufs are written as one request with one descriptor chain,
+ *         otherwise each buf is a request of its own
  */
 XCL_DRIVER_DLLESPEC ssize_t xclWriteQueue(xclDeviceHandle handle, uint64_t q_hdl, xclQueueRequest *wr_req);
 
@@ -1151,6 +1408,8 @@ XCL_DRIVER_DLLESPEC ssize_t xclWriteQueue(xclDeviceHandle handle, uint64_t q_hdl
  *         return only when the requested bytes are read (stream) or the entire packet is read (packet)
  *     non-blocking:
  *         return 0 immediatly.
+ *     gather:
+ *         data is scattered over all bufs by one request
  *     TODO: EOT
  *
  */
@@ -1163,6 +1422,11 @@ XCL_DRIVER_DLLESPEC ssize_t xclReadQueue(xclDeviceHandle handle, uint64_t q_hdl,
  * @req:		Completed requests
  * @timeout:		timeout
  *
+ * Completions already posted are reaped from the completion ring mapped in
+ * user space without a system call.  With XCL_QDMA_POLL_MODE set in the
+ * environment the ring is also polled, instead of blocking in the kernel,
+ * until min_compl completions arrive or timeout expires.
+ *
  * return number of requests been completed.
  */ 
 XCL_DRIVER_DLLESPEC int xclPollCompletion(xclDeviceHandle handle, int min_compl, int max_compl, xclReqCompletion *comps, int* actual_compl, int timeout); 
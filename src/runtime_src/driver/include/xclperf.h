@@ -381,6 +381,40 @@ typedef struct {
   unsigned long long StrStarveCycles[XSSPM_MAX_NUMBER_SLOTS];
 } xclCounterResults;
 
+/* Kernel clocks reported in xclCounterSample */
+#define XCL_SAMPLE_MAX_NUMBER_CLOCKS      4
+
+/* Counter rates between two calls of xclPerfMonSampleCounters */
+typedef struct {
+  unsigned long long TimestampNsec;
+  unsigned long long IntervalNsec;   /* 0 on the first sample */
+  unsigned int   NumMemSlots;
+  unsigned int   NumAccelSlots;
+  unsigned int   NumStrSlots;
+  double         WriteMBps[XSPM_MAX_NUMBER_SLOTS];
+  double         ReadMBps[XSPM_MAX_NUMBER_SLOTS];
+  unsigned int   CuExecCount[XSAM_MAX_NUMBER_SLOTS];   /* completions in interval */
+  double         CuUtilization[XSAM_MAX_NUMBER_SLOTS]; /* percent of interval busy */
+  double         StrMBps[XSSPM_MAX_NUMBER_SLOTS];
+  unsigned int   NumClocks;
+  /* Kernel clock residency from the icap: time weighted mean and range */
+  double         ClockMHz[XCL_SAMPLE_MAX_NUMBER_CLOCKS];
+  unsigned short ClockMinMHz[XCL_SAMPLE_MAX_NUMBER_CLOCKS];
+  unsigned short ClockMaxMHz[XCL_SAMPLE_MAX_NUMBER_CLOCKS];
+} xclCounterSample;
+
+/*
+ * Shared memory page "/xcl_counters_<pid>_<board>" published by
+ * xclPerfMonStartSampling. Sequence is odd while the sample is updated,
+ * readers retry until they see the same even value before and after.
+ */
+#define XCL_COUNTER_SAMPLE_PAGE_VERSION 2
+typedef struct {
+  unsigned int      Version;
+  volatile unsigned int Sequence;
+  xclCounterSample  Sample;
+} xclCounterSamplePage;
+
 /* Performance monitor trace results */
 typedef struct {
   xclPerfMonEventID EventID;
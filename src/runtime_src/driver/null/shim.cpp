@@ -0,0 +1,679 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Null HAL driver, see shim.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "shim.h"
+#include "driver/include/ert.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+namespace {
+
+// Number of null devices reported by xclProbe
+inline unsigned int
+device_count()
+{
+    static unsigned int val = std::getenv("XCL_NULL_DEVICES") ?
+        std::atoi(std::getenv("XCL_NULL_DEVICES")) : 1;
+    return val;
+}
+
+// Microseconds from xclExecBuf until a command completes, 0 completes
+// commands before xclExecBuf returns
+inline unsigned int
+exec_delay_usec()
+{
+    static unsigned int val = std::getenv("XCL_NULL_EXEC_DELAY_USEC") ?
+        std::atoi(std::getenv("XCL_NULL_EXEC_DELAY_USEC")) : 0;
+    return val;
+}
+
+const uint64_t null_ddr_size = 0x400000000;  // 16GB
+const uint32_t null_register_space = 0x400000;
+
+char *
+alignedAlloc(size_t size)
+{
+    void *ptr = nullptr;
+    if (posix_memalign(&ptr, getpagesize(), std::max<size_t>(size, 1)))
+        return nullptr;
+    std::memset(ptr, 0, size);
+    return static_cast<char *>(ptr);
+}
+
+}
+
+namespace xclnull {
+
+NullShim::NullShim(unsigned index, const char *logfileName, xclVerbosityLevel verbosity)
+    : mMagic(0x4e554c4c), mBoardNumber(index)
+{
+    if (exec_delay_usec())
+        mCompleter = std::thread(&NullShim::completerLoop, this);
+}
+
+NullShim::~NullShim()
+{
+    {
+        std::lock_guard<std::mutex> lk(mExecLock);
+        mStop = true;
+    }
+    mExecCond.notify_all();
+    if (mCompleter.joinable())
+        mCompleter.join();
+
+    for (auto& bo : mBOs) {
+        if (!bo.second.mUserPtr)
+            std::free(bo.second.mHost);
+        std::free(bo.second.mDevice);
+    }
+    mMagic = 0;
+}
+
+NullShim *NullShim::handleCheck(void *handle)
+{
+    if (!handle || !static_cast<NullShim *>(handle)->isGood())
+        return nullptr;
+    return static_cast<NullShim *>(handle);
+}
+
+int NullShim::xclGetDeviceInfo2(xclDeviceInfo2 *info)
+{
+    std::memset(info, 0, sizeof(xclDeviceInfo2));
+    info->mNumaNode = -1;
+    info->mMagic = 0X586C0C6C;
+    info->mHALMajorVersion = XCLHAL_MAJOR_VER;
+    info->mHALMinorVersion = XCLHAL_MINOR_VER;
+    info->mVendorId = 0x10ee;
+    info->mDeviceId = 0xffff;
+    info->mSubsystemVendorId = 0x10ee;
+    info->mDataAlignment = getpagesize();
+    info->mMinTransferSize = 64;
+    info->mDDRSize = null_ddr_size;
+    info->mDDRBankCount = 1;
+    info->mDMAThreads = 2;
+    info->mNumClocks = 1;
+    info->mOCLFrequency[0] = 300;
+    info->mPciSlot = mBoardNumber;
+    std::snprintf(info->mName, sizeof(info->mName), "xilinx_null_1ddr_1_0");
+    std::snprintf(info->mFpga, sizeof(info->mFpga), "null");
+    return 0;
+}
+
+// Nothing to program, the runtime gets everything it needs from the
+// xclbin itself
+int NullShim::xclLoadXclBin(const xclBin *buffer)
+{
+    return std::memcmp(buffer->m_magic, "xclbin2", 8) ? -EINVAL : 0;
+}
+
+NullShim::BufferObject *NullShim::lookup(unsigned int boHandle)
+{
+    auto it = mBOs.find(boHandle);
+    return (it != mBOs.end()) ? &it->second : nullptr;
+}
+
+unsigned int NullShim::xclAllocBO(size_t size, xclBOKind domain, unsigned flags)
+{
+    BufferObject bo;
+    bo.mSize = size;
+    bo.mFlags = flags;
+    bo.mHost = alignedAlloc(size);
+    bo.mDevice = alignedAlloc(size);
+    if (!bo.mHost || !bo.mDevice) {
+        std::free(bo.mHost);
+        std::free(bo.mDevice);
+        return mNullBO;
+    }
+
+    std::lock_guard<std::mutex> lk(mBOLock);
+    bo.mPaddr = mNextPaddr;
+    mNextPaddr = (mNextPaddr + size + 0xfff) & ~uint64_t(0xfff);
+    mBOs.emplace(mNextBO, bo);
+    return mNextBO++;
+}
+
+unsigned int NullShim::xclAllocUserPtrBO(void *userptr, size_t size, unsigned flags)
+{
+    BufferObject bo;
+    bo.mSize = size;
+    bo.mFlags = flags;
+    bo.mUserPtr = true;
+    bo.mHost = static_cast<char *>(userptr);
+    bo.mDevice = alignedAlloc(size);
+    if (!bo.mDevice)
+        return mNullBO;
+
+    std::lock_guard<std::mutex> lk(mBOLock);
+    bo.mPaddr = mNextPaddr;
+    mNextPaddr = (mNextPaddr + size + 0xfff) & ~uint64_t(0xfff);
+    mBOs.emplace(mNextBO, bo);
+    return mNextBO++;
+}
+
+void NullShim::xclFreeBO(unsigned int boHandle)
+{
+    std::lock_guard<std::mutex> lk(mBOLock);
+    auto bo = lookup(boHandle);
+    if (!bo)
+        return;
+    if (!bo->mUserPtr)
+        std::free(bo->mHost);
+    std::free(bo->mDevice);
+    mBOs.erase(boHandle);
+}
+
+size_t NullShim::xclWriteBO(unsigned int boHandle, const void *src, size_t size, size_t seek)
+{
+    std::lock_guard<std::mutex> lk(mBOLock);
+    auto bo = lookup(boHandle);
+    if (!bo || seek + size > bo->mSize)
+        return -EINVAL;
+    std::memcpy(bo->mHost + seek, src, size);
+    return 0;
+}
+
+size_t NullShim::xclReadBO(unsigned int boHandle, void *dst, size_t size, size_t skip)
+{
+    std::lock_guard<std::mutex> lk(mBOLock);
+    auto bo = lookup(boHandle);
+    if (!bo || skip + size > bo->mSize)
+        return -EINVAL;
+    std::memcpy(dst, bo->mHost + skip, size);
+    return 0;
+}
+
+void *NullShim::xclMapBO(unsigned int boHandle, bool write)
+{
+    std::lock_guard<std::mutex> lk(mBOLock);
+    auto bo = lookup(boHandle);
+    return bo ? bo->mHost : nullptr;
+}
+
+int NullShim::xclSyncBO(unsigned int boHandle, xclBOSyncDirection dir, size_t size, size_t offset)
+{
+    std::lock_guard<std::mutex> lk(mBOLock);
+    auto bo = lookup(boHandle);
+    if (!bo || offset + size > bo->mSize)
+        return -EINVAL;
+    if (dir == XCL_BO_SYNC_BO_TO_DEVICE)
+        std::memcpy(bo->mDevice + offset, bo->mHost + offset, size);
+    else
+        std::memcpy(bo->mHost + offset, bo->mDevice + offset, size);
+    return 0;
+}
+
+int NullShim::xclCopyBO(unsigned int dst_boHandle, unsigned int src_boHandle, size_t size,
+                        size_t dst_offset, size_t src_offset)
+{
+    std::lock_guard<std::mutex> lk(mBOLock);
+    auto dst = lookup(dst_boHandle);
+    auto src = lookup(src_boHandle);
+    if (!dst || !src || dst_offset + size > dst->mSize || src_offset + size > src->mSize)
+        return -EINVAL;
+    std::memmove(dst->mDevice + dst_offset, src->mDevice + src_offset, size);
+    return 0;
+}
+
+int NullShim::xclGetBOProperties(unsigned int boHandle, xclBOProperties *properties)
+{
+    std::lock_guard<std::mutex> lk(mBOLock);
+    auto bo = lookup(boHandle);
+    if (!bo)
+        return -EINVAL;
+    properties->handle = boHandle;
+    properties->flags = bo->mFlags;
+    properties->size = bo->mSize;
+    properties->paddr = bo->mPaddr;
+    properties->domain = XCL_BO_DEVICE_RAM;
+    return 0;
+}
+
+// There are no registers, reads return zeros
+size_t NullShim::xclWrite(xclAddressSpace space, uint64_t offset, const void *hostBuf, size_t size)
+{
+    return (offset + size > null_register_space) ? -EINVAL : size;
+}
+
+size_t NullShim::xclRead(xclAddressSpace space, uint64_t offset, void *hostBuf, size_t size)
+{
+    if (offset + size > null_register_space)
+        return -EINVAL;
+    std::memset(hostBuf, 0, size);
+    return size;
+}
+
+void NullShim::complete(unsigned int boHandle)
+{
+    {
+        std::lock_guard<std::mutex> lk(mBOLock);
+        auto bo = lookup(boHandle);
+        if (bo) {
+            auto epacket = reinterpret_cast<ert_packet *>(bo->mHost);
+            epacket->state = ERT_CMD_STATE_COMPLETED;
+        }
+    }
+    mCompleted.push_back(boHandle);
+    ++mCompletions;
+}
+
+/*
+ * xclExecBuf()
+ *
+ * Commands complete in submission order, immediately or after
+ * XCL_NULL_EXEC_DELAY_USEC on the completer thread.
+ */
+int NullShim::xclExecBuf(unsigned int cmdBO)
+{
+    {
+        std::lock_guard<std::mutex> lk(mBOLock);
+        auto bo = lookup(cmdBO);
+        if (!bo || bo->mSize < sizeof(ert_packet))
+            return -EINVAL;
+    }
+
+    std::lock_guard<std::mutex> lk(mExecLock);
+    if (!exec_delay_usec())
+        complete(cmdBO);
+    else
+        mPending.emplace_back(clock::now() + std::chrono::microseconds(exec_delay_usec()), cmdBO);
+    mExecCond.notify_all();
+    return 0;
+}
+
+void NullShim::completerLoop()
+{
+    std::unique_lock<std::mutex> lk(mExecLock);
+    while (!mStop) {
+        if (mPending.empty()) {
+            mExecCond.wait(lk);
+            continue;
+        }
+        auto deadline = mPending.front().first;
+        if (clock::now() < deadline) {
+            mExecCond.wait_until(lk, deadline);
+            continue;
+        }
+        while (!mPending.empty() && mPending.front().first <= clock::now()) {
+            complete(mPending.front().second);
+            mPending.pop_front();
+        }
+        mExecCond.notify_all();
+    }
+}
+
+int NullShim::xclExecCompletions(unsigned int *cmdBOs, size_t max)
+{
+    std::lock_guard<std::mutex> lk(mExecLock);
+    size_t count = std::min(max, mCompleted.size());
+    std::copy(mCompleted.begin(), mCompleted.begin() + count, cmdBOs);
+    mCompleted.erase(mCompleted.begin(), mCompleted.begin() + count);
+    return count;
+}
+
+/*
+ * xclExecWait()
+ *
+ * Like poll() on the device node, returns > 0 if commands completed
+ * since the previous call, 0 on timeout
+ */
+int NullShim::xclExecWait(int timeoutMilliSec)
+{
+    std::unique_lock<std::mutex> lk(mExecLock);
+    auto ready = [this] { return mCompletions != mCompletionsWaited || mStop; };
+    if (timeoutMilliSec < 0)
+        mExecCond.wait(lk, ready);
+    else if (!mExecCond.wait_for(lk, std::chrono::milliseconds(timeoutMilliSec), ready))
+        return 0;
+    mCompletionsWaited = mCompletions;
+    return 1;
+}
+
+} // xclnull
+
+using xclnull::NullShim;
+using xclnull::mNullBO;
+
+unsigned xclProbe()
+{
+    return device_count();
+}
+
+unsigned int xclVersion()
+{
+    return 2;
+}
+
+xclDeviceHandle xclOpen(unsigned deviceIndex, const char *logFileName, xclVerbosityLevel level)
+{
+    if (deviceIndex >= device_count())
+        return nullptr;
+    return new NullShim(deviceIndex, logFileName, level);
+}
+
+void xclClose(xclDeviceHandle handle)
+{
+    delete NullShim::handleCheck(handle);
+}
+
+int xclGetDeviceInfo2(xclDeviceHandle handle, xclDeviceInfo2 *info)
+{
+    NullShim *drv = NullShim::handleCheck(handle);
+    return drv ? drv->xclGetDeviceInfo2(info) : -ENODEV;
+}
+
+int xclGetUsageInfo(xclDeviceHandle handle, xclDeviceUsage *info)
+{
+    std::memset(info, 0, sizeof(xclDeviceUsage));
+    return NullShim::handleCheck(handle) ? 0 : -ENODEV;
+}
+
+int xclGetErrorStatus(xclDeviceHandle handle, xclErrorStatus *info)
+{
+    std::memset(info, 0, sizeof(xclErrorStatus));
+    return NullShim::handleCheck(handle) ? 0 : -ENODEV;
+}
+
+int xclLoadXclBin(xclDeviceHandle handle, const xclBin *buffer)
+{
+    NullShim *drv = NullShim::handleCheck(handle);
+    return drv ? drv->xclLoadXclBin(buffer) : -ENODEV;
+}
+
+int xclResetDevice(xclDeviceHandle handle, xclResetKind kind)
+{
+    return NullShim::handleCheck(handle) ? 0 : -ENODEV;
+}
+
+int xclReClock2(xclDeviceHandle handle, unsigned short region, const unsigned short *targetFreqMHz)
+{
+    return NullShim::handleCheck(handle) ? 0 : -ENODEV;
+}
+
+int xclLockDevice(xclDeviceHandle handle)
+{
+    return NullShim::handleCheck(handle) ? 0 : -ENODEV;
+}
+
+int xclUnlockDevice(xclDeviceHandle handle)
+{
+    return NullShim::handleCheck(handle) ? 0 : -ENODEV;
+}
+
+int xclOpenContext(xclDeviceHandle handle, uuid_t xclbinId, unsigned int ipIndex, bool shared)
+{
+    return NullShim::handleCheck(handle) ? 0 : -ENODEV;
+}
+
+int xclCloseContext(xclDeviceHandle handle, uuid_t xclbinId, unsigned ipIndex)
+{
+    return NullShim::handleCheck(handle) ? 0 : -ENODEV;
+}
+
+unsigned int xclAllocBO(xclDeviceHandle handle, size_t size, xclBOKind domain, unsigned flags)
+{
+    NullShim *drv = NullShim::handleCheck(handle);
+    return drv ? drv->xclAllocBO(size, domain, flags) : mNullBO;
+}
+
+unsigned int xclAllocUserPtrBO(xclDeviceHandle handle, void *userptr, size_t size, unsigned flags)
+{
+    NullShim *drv = NullShim::handleCheck(handle);
+    return drv ? drv->xclAllocUserPtrBO(userptr, size, flags) : mNullBO;
+}
+
+void xclFreeBO(xclDeviceHandle handle, unsigned int boHandle)
+{
+    NullShim *drv = NullShim::handleCheck(handle);
+    if (drv)
+        drv->xclFreeBO(boHandle);
+}
+
+size_t xclWriteBO(xclDeviceHandle handle, unsigned int boHandle, const void *src, size_t size, size_t seek)
+{
+    NullShim *drv = NullShim::handleCheck(handle);
+    return drv ? drv->xclWriteBO(boHandle, src, size, seek) : -ENODEV;
+}
+
+size_t xclReadBO(xclDeviceHandle handle, unsigned int boHandle, void *dst, size_t size, size_t skip)
+{
+    NullShim *drv = NullShim::handleCheck(handle);
+    return drv ? drv->xclReadBO(boHandle, dst, size, skip) : -ENODEV;
+}
+
+int xclWriteSyncBO(xclDeviceHandle handle, unsigned int boHandle, const void *src, size_t size, size_t seek)
+{
+    NullShim *drv = NullShim::handleCheck(handle);
+    if (!drv)
+        return -ENODEV;
+    if (int ret = drv->xclWriteBO(boHandle, src, size, seek))
+        return ret;
+    return drv->xclSyncBO(boHandle, XCL_BO_SYNC_BO_TO_DEVICE, size, seek);
+}
+
+int xclSyncReadBO(xclDeviceHandle handle, unsigned int boHandle, void *dst, size_t size, size_t skip)
+{
+    NullShim *drv = NullShim::handleCheck(handle);
+    if (!drv)
+        return -ENODEV;
+    if (int ret = drv->xclSyncBO(boHandle, XCL_BO_SYNC_BO_FROM_DEVICE, size, skip))
+        return ret;
+    return drv->xclReadBO(boHandle, dst, size, skip);
+}
+
+void *xclMapBO(xclDeviceHandle handle, unsigned int boHandle, bool write)
+{
+    NullShim *drv = NullShim::handleCheck(handle);
+    return drv ? drv->xclMapBO(boHandle, write) : nullptr;
+}
+
+int xclUnmapBO(xclDeviceHandle handle, unsigned int boHandle, void *addr)
+{
+    return NullShim::handleCheck(handle) ? 0 : -ENODEV;
+}
+
+int xclSyncBO(xclDeviceHandle handle, unsigned int boHandle, xclBOSyncDirection dir, size_t size, size_t offset)
+{
+    NullShim *drv = NullShim::handleCheck(handle);
+    return drv ? drv->xclSyncBO(boHandle, dir, size, offset) : -ENODEV;
+}
+
+int xclSyncBOv(xclDeviceHandle handle, const struct xclBOSyncRange *ranges, size_t num)
+{
+    NullShim *drv = NullShim::handleCheck(handle);
+    if (!drv)
+        return -ENODEV;
+    for (size_t i = 0; i < num; ++i) {
+        if (int ret = drv->xclSyncBO(ranges[i].boHandle, ranges[i].dir, ranges[i].size, ranges[i].offset))
+            return ret;
+    }
+    return 0;
+}
+
+int xclCopyBO(xclDeviceHandle handle, unsigned int dstBoHandle, unsigned int srcBoHandle, size_t size,
+              size_t dst_offset, size_t src_offset)
+{
+    NullShim *drv = NullShim::handleCheck(handle);
+    return drv ? drv->xclCopyBO(dstBoHandle, srcBoHandle, size, dst_offset, src_offset) : -ENODEV;
+}
+
+int xclGetBOProperties(xclDeviceHandle handle, unsigned int boHandle, xclBOProperties *properties)
+{
+    NullShim *drv = NullShim::handleCheck(handle);
+    return drv ? drv->xclGetBOProperties(boHandle, properties) : -ENODEV;
+}
+
+int xclExportBO(xclDeviceHandle handle, unsigned int boHandle)
+{
+    return -ENOSYS;
+}
+
+unsigned int xclImportBO(xclDeviceHandle handle, int fd, unsigned flags)
+{
+    return mNullBO;
+}
+
+size_t xclWrite(xclDeviceHandle handle, xclAddressSpace space, uint64_t offset, const void *hostBuf, size_t size)
+{
+    NullShim *drv = NullShim::handleCheck(handle);
+    return drv ? drv->xclWrite(space, offset, hostBuf, size) : -ENODEV;
+}
+
+size_t xclRead(xclDeviceHandle handle, xclAddressSpace space, uint64_t offset, void *hostBuf, size_t size)
+{
+    NullShim *drv = NullShim::handleCheck(handle);
+    return drv ? drv->xclRead(space, offset, hostBuf, size) : -ENODEV;
+}
+
+int xclExecBuf(xclDeviceHandle handle, unsigned int cmdBO)
+{
+    NullShim *drv = NullShim::handleCheck(handle);
+    return drv ? drv->xclExecBuf(cmdBO) : -ENODEV;
+}
+
+// Commands complete in order, so anything in the wait list has been
+// submitted ahead of cmdBO and completes first
+int xclExecBufWithWaitList(xclDeviceHandle handle, unsigned int cmdBO, size_t num_bo_in_wait_list,
+                           unsigned int *bo_wait_list)
+{
+    NullShim *drv = NullShim::handleCheck(handle);
+    return drv ? drv->xclExecBuf(cmdBO) : -ENODEV;
+}
+
+int xclExecBufBatch(xclDeviceHandle handle, const unsigned int *cmdBOs, size_t num)
+{
+    NullShim *drv = NullShim::handleCheck(handle);
+    if (!drv) {
+        errno = ENODEV;
+        return 0;
+    }
+    size_t i = 0;
+    for (; i < num; ++i) {
+        if (int ret = drv->xclExecBuf(cmdBOs[i])) {
+            errno = -ret;
+            break;
+        }
+    }
+    return i;
+}
+
+int xclExecCompletions(xclDeviceHandle handle, unsigned int *cmdBOs, size_t max)
+{
+    NullShim *drv = NullShim::handleCheck(handle);
+    return drv ? drv->xclExecCompletions(cmdBOs, max) : -ENODEV;
+}
+
+int xclExecWait(xclDeviceHandle handle, int timeoutMilliSec)
+{
+    NullShim *drv = NullShim::handleCheck(handle);
+    return drv ? drv->xclExecWait(timeoutMilliSec) : -ENODEV;
+}
+
+/*
+ * Profiling, there are no monitors
+ */
+void xclWriteHostEvent(xclDeviceHandle handle, xclPerfMonEventType type, xclPerfMonEventID id)
+{
+}
+
+size_t xclGetDeviceTimestamp(xclDeviceHandle handle)
+{
+    return 0;
+}
+
+double xclGetDeviceClockFreqMHz(xclDeviceHandle handle)
+{
+    return 300.0;
+}
+
+double xclGetReadMaxBandwidthMBps(xclDeviceHandle handle)
+{
+    return 9600.0;
+}
+
+double xclGetWriteMaxBandwidthMBps(xclDeviceHandle handle)
+{
+    return 9600.0;
+}
+
+void xclSetProfilingNumberSlots(xclDeviceHandle handle, xclPerfMonType type, uint32_t numSlots)
+{
+}
+
+uint32_t xclGetProfilingNumberSlots(xclDeviceHandle handle, xclPerfMonType type)
+{
+    return 0;
+}
+
+void xclGetProfilingSlotName(xclDeviceHandle handle, xclPerfMonType type, uint32_t slotnum,
+                             char* slotName, uint32_t length)
+{
+    if (length)
+        slotName[0] = '\0';
+}
+
+size_t xclPerfMonClockTraining(xclDeviceHandle handle, xclPerfMonType type)
+{
+    return 0;
+}
+
+size_t xclPerfMonStartCounters(xclDeviceHandle handle, xclPerfMonType type)
+{
+    return 0;
+}
+
+size_t xclPerfMonStopCounters(xclDeviceHandle handle, xclPerfMonType type)
+{
+    return 0;
+}
+
+size_t xclPerfMonReadCounters(xclDeviceHandle handle, xclPerfMonType type, xclCounterResults& counterResults)
+{
+    std::memset(&counterResults, 0, sizeof(xclCounterResults));
+    return 0;
+}
+
+size_t xclPerfMonStartTrace(xclDeviceHandle handle, xclPerfMonType type, uint32_t startTrigger)
+{
+    return 0;
+}
+
+size_t xclPerfMonStopTrace(xclDeviceHandle handle, xclPerfMonType type)
+{
+    return 0;
+}
+
+uint32_t xclPerfMonGetTraceCount(xclDeviceHandle handle, xclPerfMonType type)
+{
+    return 0;
+}
+
+size_t xclPerfMonReadTrace(xclDeviceHandle handle, xclPerfMonType type, xclTraceResultsVector& traceVector)
+{
+    std::memset(&traceVector, 0, sizeof(xclTraceResultsVector));
+    return 0;
+}
+
+size_t xclDebugReadIPStatus(xclDeviceHandle handle, xclDebugReadType type, void* debugResults)
+{
+    return 0;
+}
@@ -0,0 +1,105 @@
+#ifndef _XCL_NULL_SHIM_H_
+#define _XCL_NULL_SHIM_H_
+
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Null HAL driver. BOs live in host memory and commands complete without
+ * a device, for measuring the overhead of the runtime stack itself.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "driver/include/xclhal2.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace xclnull {
+
+const unsigned int mNullBO = 0xffffffff;
+
+class NullShim
+{
+    // Host buffer is what xclMapBO returns, device buffer is what sync
+    // copies to and from, a user pointer BO has no host buffer of its own
+    struct BufferObject {
+        char *mHost = nullptr;
+        char *mDevice = nullptr;
+        size_t mSize = 0;
+        uint64_t mPaddr = 0;
+        unsigned mFlags = 0;
+        bool mUserPtr = false;
+    };
+
+    using clock = std::chrono::steady_clock;
+
+public:
+    NullShim(unsigned index, const char *logfileName, xclVerbosityLevel verbosity);
+    ~NullShim();
+
+    static NullShim *handleCheck(void *handle);
+    bool isGood() const { return mMagic == 0x4e554c4c; }
+
+    int xclGetDeviceInfo2(xclDeviceInfo2 *info);
+    int xclLoadXclBin(const xclBin *buffer);
+
+    unsigned int xclAllocBO(size_t size, xclBOKind domain, unsigned flags);
+    unsigned int xclAllocUserPtrBO(void *userptr, size_t size, unsigned flags);
+    void xclFreeBO(unsigned int boHandle);
+    size_t xclWriteBO(unsigned int boHandle, const void *src, size_t size, size_t seek);
+    size_t xclReadBO(unsigned int boHandle, void *dst, size_t size, size_t skip);
+    void *xclMapBO(unsigned int boHandle, bool write);
+    int xclSyncBO(unsigned int boHandle, xclBOSyncDirection dir, size_t size, size_t offset);
+    int xclCopyBO(unsigned int dst_boHandle, unsigned int src_boHandle, size_t size,
+                  size_t dst_offset, size_t src_offset);
+    int xclGetBOProperties(unsigned int boHandle, xclBOProperties *properties);
+
+    size_t xclWrite(xclAddressSpace space, uint64_t offset, const void *hostBuf, size_t size);
+    size_t xclRead(xclAddressSpace space, uint64_t offset, void *hostBuf, size_t size);
+
+    int xclExecBuf(unsigned int cmdBO);
+    int xclExecCompletions(unsigned int *cmdBOs, size_t max);
+    int xclExecWait(int timeoutMilliSec);
+
+private:
+    unsigned mMagic;
+    unsigned mBoardNumber;
+
+    std::mutex mBOLock;
+    std::map<unsigned int, BufferObject> mBOs;
+    unsigned int mNextBO = 1;
+    uint64_t mNextPaddr = 0;
+
+    // Completion bookkeeping, see xclExecBuf.  mPending is ordered by
+    // deadline since every command gets the same delay.
+    std::mutex mExecLock;
+    std::condition_variable mExecCond;
+    std::deque<std::pair<clock::time_point, unsigned int>> mPending;
+    std::deque<unsigned int> mCompleted;
+    uint64_t mCompletions = 0;
+    uint64_t mCompletionsWaited = 0;
+    bool mStop = false;
+    std::thread mCompleter;
+
+    BufferObject *lookup(unsigned int boHandle);
+    void complete(unsigned int boHandle);
+    void completerLoop();
+};
+
+} // xclnull
+
+#endif
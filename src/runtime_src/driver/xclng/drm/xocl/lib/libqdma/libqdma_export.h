@@ -561,8 +561,14 @@ struct qdma_queue_conf {
 	u8 cmpl_trig_mode:3;
 	/** enable interrupt for WRB */
 	u8 cmpl_en_intr:1;
+
+	/** config flags: byte #6 */
+	/** ST C2H: adapt trigger mode, timer and counter to the
+	 * completion rate, starting from the values above
+	 */
+	u8 cmpl_adaptive:1;
 	/** reserved */
-	u8 rsvd;
+	u8 rsvd:7;
 
 	/*
 	 * TODO: for Platform streaming DSA
@@ -610,6 +616,15 @@ struct qdma_queue_conf {
 				unsigned int len, unsigned int sgcnt,
 				struct qdma_sw_sg *sgl, void *udd);
 
+	/** optional ST C2H zero copy: pages used as the free list, one per
+	 * descriptor and never freed by libqdma. Reads return
+	 * struct qdma_zc_desc records and the pages are handed back with
+	 * qdma_queue_c2h_recycle()
+	 */
+	struct page **fl_pages;
+	/** number of pages in fl_pages */
+	unsigned int fl_npages;
+
 	/** fill in by libqdma */
 	/** name of the qdma device */
 	char name[QDMA_QUEUE_NAME_MAXLEN];
@@ -948,6 +963,34 @@ struct qdma_cmpl_ctrl {
 int qdma_queue_cmpl_ctrl(unsigned long dev_hndl, unsigned long qhndl,
 				struct qdma_cmpl_ctrl *cctrl, bool set);
 
+/**
+ * struct qdma_zc_desc - zero copy receive record, see fl_pages
+ */
+struct qdma_zc_desc {
+	/** index of the page in fl_pages */
+	unsigned int slot;
+	/** bytes of data in the page */
+	unsigned int len;
+};
+
+/*****************************************************************************/
+/**
+ * qdma_queue_c2h_recycle() - give zero copy receive pages back to h/w
+ *
+ * @param[in]	dev_hndl:	hndl returned from qdma_device_open()
+ * @param[in]	qhndl:		hndl returned from qdma_queue_add()
+ * @param[in]	slots:		page indexes reported in struct qdma_zc_desc
+ * @param[in]	count:		number of slots
+ *
+ * Slots may be returned in any order, the free list is re-armed up to
+ * the oldest slot still held.
+ *
+ * @return	# of slots accepted
+ * @return	<0: error
+ *****************************************************************************/
+int qdma_queue_c2h_recycle(unsigned long dev_hndl, unsigned long qhndl,
+			const u32 *slots, unsigned int count);
+
 /*****************************************************************************/
 /**
  * qdma_queue_packet_read() - read rcv'ed data (ST C2H dma operation)
@@ -780,6 +780,9 @@ void qdma_descq_free_resource(struct qdma_descq *descq)
 void qdma_descq_config(struct qdma_descq *descq, struct qdma_queue_conf *qconf,
 		 int reconfig)
 {
+	/* moderation restarts from the new configuration */
+	memset(&descq->dim, 0, sizeof(descq->dim));
+
 	if (!reconfig) {
 		int len;
 
@@ -954,18 +957,23 @@ int qdma_descq_prog_stm(struct qdma_descq *descq, bool clear)
 }
 #endif
 
-void qdma_descq_service_wb(struct qdma_descq *descq, int budget,
+int qdma_descq_service_wb(struct qdma_descq *descq, int budget,
 				bool c2h_upd_cmpl)
 {
+	int rv = 0;
+
 	lock_descq(descq);
 	qdma_notify_cancel(descq);
 	if (descq->q_state != Q_STATE_ONLINE) {
 		complete(&descq->cancel_comp);
 	} else if (descq->conf.st && descq->conf.c2h)
-		descq_process_completion_st_c2h(descq, budget, c2h_upd_cmpl);
+		rv = descq_process_completion_st_c2h(descq, budget,
+			c2h_upd_cmpl);
 	else
 		descq_mm_n_h2c_wb(descq);
 	unlock_descq(descq);
+
+	return rv < 0 ? 0 : rv;
 }
 
 ssize_t qdma_descq_proc_sgt_request(struct qdma_descq *descq,
@@ -96,6 +96,12 @@ struct qdma_flq {
 	struct qdma_sw_sg *sdesc;
 	/** RW: sw descriptor info */
 	struct qdma_sdesc_info *sdesc_info;
+	/** RO: zero copy pages from qdma_queue_conf.fl_pages, or NULL */
+	struct page **zc_pages;
+	/** RW: per descriptor flag, page returned by the user */
+	u8 *zc_ret;
+	/** RW: oldest descriptor still held by the user */
+	unsigned int zc_pidx;
 };
 
 enum q_state_t {
@@ -112,6 +118,42 @@ enum qdma_req_submit_state {
 
 #define	QDMA_CANCEL_TIMEOUT		5	/* seconds */
 
+/** completion entries serviced per interrupt, the rest is rescheduled */
+#define QDMA_INTR_BUDGET	64
+
+/** adaptive moderation: sampling window and completion rates per second */
+#define QDMA_DIM_WINDOW_MS	100
+#define QDMA_DIM_RATE_HIGH	50000
+#define QDMA_DIM_RATE_LOW	5000
+/** highest global csr timer / counter index used */
+#define QDMA_DIM_LEVEL_MAX	8
+
+/**
+ * @struct - qdma_dim
+ * @brief adaptive interrupt moderation state of a ST C2H queue
+ *
+ * Each level selects the next larger entry of the global c2h timer and
+ * counter threshold tables, which are in ascending order.
+ */
+struct qdma_dim {
+	/** start of the sampling window, in jiffies */
+	unsigned long win_start;
+	/** interrupts serviced in the window */
+	unsigned int irqs;
+	/** completion entries processed in the window */
+	unsigned int cmpls;
+	/** interrupts per second over the last window */
+	unsigned int irq_rate;
+	/** total interrupts serviced */
+	u64 irq_total;
+	/** current level, 0 is the configured moderation */
+	u8 level;
+	/** configured trigger mode, timer and counter index */
+	u8 trig_mode;
+	u8 timer_idx;
+	u8 cnt_th_idx;
+};
+
 /**
  * @struct - qdma_descq
  * @brief	qdma software descriptor book keeping fields
@@ -136,6 +178,8 @@ struct qdma_descq {
 	unsigned int qidx_hw;
 	/** queue handler */
 	struct work_struct work;
+	/** adaptive interrupt moderation */
+	struct qdma_dim dim;
 	/** interrupt list */
 	struct list_head intr_list;
 	/** interrupt id associated for this queue */
@@ -362,9 +406,9 @@ int qdma_descq_context_cleanup(struct qdma_descq *descq);
  * @param[in]	budget:		number of descriptors to process
  * @param[in]	c2h_upd_cmpl:	C2H only: if update completion needed
  *
- * @return	none
+ * @return	ST C2H: # of completion entries processed, 0 otherwise
  *****************************************************************************/
-void qdma_descq_service_wb(struct qdma_descq *descq, int budget,
+int qdma_descq_service_wb(struct qdma_descq *descq, int budget,
 			bool c2h_upd_cmpl);
 
 /*****************************************************************************/
@@ -570,10 +614,10 @@ int descq_flq_alloc_resource(struct qdma_descq *descq);
  *				completion request
  *
  * @param[in]	descq:		pointer to qdma_descq
- * @param[in]	budget:		number of descriptors to process
+ * @param[in]	budget:		number of descriptors to process, 0: all
  * @param[in]	upd_cmpl:	if update completion required
  *
- * @return	0: success
+ * @return	# of completion entries processed
  * @return	<0: failure
  *****************************************************************************/
 int descq_process_completion_st_c2h(struct qdma_descq *descq, int budget,
@@ -15,6 +15,7 @@
 #include "qdma_intr.h"
 
 #include <linux/kernel.h>
+#include <linux/math64.h>
 #include "qdma_descq.h"
 #include "qdma_device.h"
 #include "qdma_regs.h"
@@ -641,12 +642,78 @@ err_out:
 	return -ENOMEM;
 }
 
+/*
+ * Move a ST C2H queue between moderation levels by its completion rate:
+ * coalesce more under load, fall back to the configured trigger when
+ * the rate drops so that light traffic does not wait on the timer
+ */
+static void descq_dim_update(struct qdma_descq *descq, int cmpls)
+{
+	struct qdma_dim *dim = &descq->dim;
+	unsigned long now = jiffies;
+	unsigned int ms, rate;
+	u8 level;
+
+	lock_descq(descq);
+	if (!dim->win_start) {
+		dim->trig_mode = descq->conf.cmpl_trig_mode;
+		dim->timer_idx = descq->conf.cmpl_timer_idx;
+		dim->cnt_th_idx = descq->conf.cmpl_cnt_th_idx;
+		dim->win_start = now;
+	}
+	dim->irqs++;
+	dim->irq_total++;
+	dim->cmpls += cmpls;
+
+	ms = jiffies_to_msecs(now - dim->win_start);
+	if (ms < QDMA_DIM_WINDOW_MS)
+		goto out;
+
+	dim->irq_rate = div_u64((u64)dim->irqs * 1000, ms);
+	rate = div_u64((u64)dim->cmpls * 1000, ms);
+	dim->irqs = 0;
+	dim->cmpls = 0;
+	dim->win_start = now;
+
+	level = dim->level;
+	if (rate > QDMA_DIM_RATE_HIGH && level < QDMA_DIM_LEVEL_MAX)
+		level++;
+	else if (rate < QDMA_DIM_RATE_LOW && level)
+		level--;
+	if (level == dim->level)
+		goto out;
+
+	dim->level = level;
+	if (level) {
+		descq->conf.cmpl_trig_mode = TRIG_MODE_COMBO;
+		descq->conf.cmpl_timer_idx = max_t(u8, dim->timer_idx, level);
+		descq->conf.cmpl_cnt_th_idx = max_t(u8, dim->cnt_th_idx, level);
+	} else {
+		descq->conf.cmpl_trig_mode = dim->trig_mode;
+		descq->conf.cmpl_timer_idx = dim->timer_idx;
+		descq->conf.cmpl_cnt_th_idx = dim->cnt_th_idx;
+	}
+	/* the cidx register carries the trigger settings */
+	if (descq->q_state == Q_STATE_ONLINE)
+		descq_wrb_cidx_update(descq, descq->cidx_wrb_pend);
+out:
+	unlock_descq(descq);
+}
+
 void intr_work(struct work_struct *work)
 {
 	struct qdma_descq *descq;
+	int cnt;
 
 	descq = container_of(work, struct qdma_descq, work);
-	qdma_descq_service_wb(descq, 0, 1);
+	cnt = qdma_descq_service_wb(descq, QDMA_INTR_BUDGET, 1);
+
+	if (descq->conf.st && descq->conf.c2h && descq->conf.cmpl_adaptive)
+		descq_dim_update(descq, cnt);
+
+	/* budget used up, poll again rather than wait for an interrupt */
+	if (cnt >= QDMA_INTR_BUDGET)
+		schedule_work(&descq->work);
 }
 
 /*
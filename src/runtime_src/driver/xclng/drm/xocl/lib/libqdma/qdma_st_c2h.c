@@ -73,25 +73,17 @@ static inline void flq_free_one(struct qdma_sw_sg *sdesc,
 	}
 }
 
-static inline int flq_fill_one(struct qdma_sw_sg *sdesc,
+static inline int flq_map_one(struct qdma_sw_sg *sdesc,
 				struct qdma_c2h_desc *desc, struct device *dev,
-				int node, unsigned char pg_order, gfp_t gfp)
+				struct page *pg, unsigned char pg_order)
 {
-	struct page *pg;
 	dma_addr_t mapping;
 
-	pg = alloc_pages_node(node, __GFP_COMP | gfp, pg_order);
-	if (unlikely(!pg)) {
-		pr_info("OOM, order %d.\n", pg_order);
-		return -ENOMEM;
-	}
-
 	mapping = dma_map_page(dev, pg, 0, PAGE_SIZE << pg_order,
 				PCI_DMA_FROMDEVICE);
 	if (unlikely(dma_mapping_error(dev, mapping))) {
 		dev_err(dev, "page 0x%p mapping error 0x%llx.\n",
 			pg, (unsigned long long)mapping);
-		__free_pages(pg, pg_order);
 		return -EINVAL;
 	}
 
@@ -104,6 +96,26 @@ static inline int flq_fill_one(struct qdma_sw_sg *sdesc,
 	return 0;
 }
 
+static inline int flq_fill_one(struct qdma_sw_sg *sdesc,
+				struct qdma_c2h_desc *desc, struct device *dev,
+				int node, unsigned char pg_order, gfp_t gfp)
+{
+	struct page *pg;
+	int rv;
+
+	pg = alloc_pages_node(node, __GFP_COMP | gfp, pg_order);
+	if (unlikely(!pg)) {
+		pr_info("OOM, order %d.\n", pg_order);
+		return -ENOMEM;
+	}
+
+	rv = flq_map_one(sdesc, desc, dev, pg, pg_order);
+	if (unlikely(rv < 0))
+		__free_pages(pg, pg_order);
+
+	return rv;
+}
+
 void descq_flq_free_resource(struct qdma_descq *descq)
 {
 	struct xlnx_dma_dev *xdev = descq->xdev;
@@ -115,12 +127,18 @@ void descq_flq_free_resource(struct qdma_descq *descq)
 	int i;
 
 	for (i = 0; i < flq->size; i++, sdesc++, desc++) {
-		if (sdesc)
-			flq_free_one(sdesc, desc, dev, pg_order);
-		else
+		if (!sdesc)
 			break;
+		/* zero copy pages belong to the caller */
+		if (flq->zc_pages) {
+			flq_unmap_one(sdesc, desc, dev, pg_order);
+			sdesc->pg = NULL;
+		} else
+			flq_free_one(sdesc, desc, dev, pg_order);
 	}
 
+	kfree(flq->zc_ret);
+
 	if (flq->sdesc) {
 		kfree(flq->sdesc);
 		flq->sdesc = NULL;
@@ -141,11 +159,30 @@ int descq_flq_alloc_resource(struct qdma_descq *descq)
 	int i;
 	int rv = 0;
 
+	if (descq->conf.fl_pages) {
+		/* one page per descriptor, reported back by slot index */
+		if (flq->pg_order || descq->conf.fl_npages < flq->size) {
+			pr_info("%s: zero copy needs %u pages of order 0, "
+				"got %u order %u.\n", descq->conf.name,
+				flq->size, descq->conf.fl_npages,
+				flq->pg_order);
+			return -EINVAL;
+		}
+		flq->zc_ret = kzalloc_node(flq->size, GFP_KERNEL, node);
+		if (!flq->zc_ret)
+			return -ENOMEM;
+		flq->zc_pages = descq->conf.fl_pages;
+		flq->zc_pidx = 0;
+	}
+
 	sdesc = kzalloc_node(flq->size * (sizeof(struct qdma_sw_sg) +
 					  sizeof(struct qdma_sdesc_info)),
 				GFP_KERNEL, node);
 	if (!sdesc) {
 		pr_info("OOM, sz %u.\n", flq->size);
+		kfree(flq->zc_ret);
+		flq->zc_ret = NULL;
+		flq->zc_pages = NULL;
 		return -ENOMEM;
 	}
 	flq->sdesc = sdesc;
@@ -165,8 +202,11 @@ int descq_flq_alloc_resource(struct qdma_descq *descq)
 
 	for (sdesc = flq->sdesc, i = 0; i < flq->size; i++, sdesc++, desc++) {
 	/* pr_err("flq sdesc 0x%p fill.\n", sdesc); */
-		rv = flq_fill_one(sdesc, desc, dev, node, flq->pg_order,
-				GFP_KERNEL);
+		if (flq->zc_pages)
+			rv = flq_map_one(sdesc, desc, dev, flq->zc_pages[i], 0);
+		else
+			rv = flq_fill_one(sdesc, desc, dev, node,
+					flq->pg_order, GFP_KERNEL);
 		if (rv < 0) {
 			descq_flq_free_resource(descq);
 			return rv;
@@ -198,7 +238,11 @@ static int qdma_flq_refill(struct qdma_descq *descq, int idx, int count,
 			sinfo = flq->sdesc_info;
 		}
 
-		if (recycle) {
+		if (recycle || flq->zc_pages) {
+			/* the CPU read the page, hand it back to the device */
+			dma_sync_single_for_device(&xdev->conf.pdev->dev,
+				sdesc->dma_addr, PAGE_SIZE << order,
+				DMA_FROM_DEVICE);
 			sdesc->len = PAGE_SIZE << order;
 			sdesc->offset = 0;
 		} else {
@@ -224,6 +268,115 @@ static int qdma_flq_refill(struct qdma_descq *descq, int idx, int count,
 	return i;
 }
 
+/*
+ * Last free list entry available to h/w. With zero copy the entries
+ * from zc_pidx on are held by the user until recycled.
+ */
+static inline unsigned int flq_hw_pidx(struct qdma_flq *flq)
+{
+	return ring_idx_decr(flq->zc_pages ? flq->zc_pidx : flq->pidx_pend, 1,
+			flq->size);
+}
+
+/*
+ * Re-arm the zero copy entries returned by the user, in ring order.
+ * Returns the number of entries given back to h/w.
+ */
+static unsigned int flq_zc_rearm(struct qdma_descq *descq)
+{
+	struct qdma_flq *flq = &descq->flq;
+	unsigned int n = 0;
+
+	while (flq->zc_pidx != flq->pidx_pend && flq->zc_ret[flq->zc_pidx]) {
+		flq->zc_ret[flq->zc_pidx] = 0;
+		qdma_flq_refill(descq, flq->zc_pidx, 1, 1, GFP_ATOMIC);
+		flq->zc_pidx = ring_idx_incr(flq->zc_pidx, 1, flq->size);
+		n++;
+	}
+
+	return n;
+}
+
+/*
+ * Zero copy read: report each filled free list page to the request
+ * as a struct qdma_zc_desc and leave the page with the user
+ */
+static int descq_st_c2h_read_zc(struct qdma_descq *descq,
+			struct qdma_request *req, bool update_pidx)
+{
+	struct qdma_sgt_req_cb *cb = qdma_req_cb_get(req);
+	struct device *dev = &descq->xdev->conf.pdev->dev;
+	struct qdma_flq *flq = &descq->flq;
+	unsigned int pidx = flq->pidx_pend;
+	struct qdma_sw_sg *fsg = flq->sdesc + pidx;
+	struct qdma_sw_sg *tsg = req->sgl;
+	unsigned int fsgcnt = ring_idx_delta(descq->pidx, pidx, flq->size);
+	unsigned int tsgoff = cb->sg_offset;
+	unsigned int copied = 0, dlen = 0;
+	int i = 0, j = 0;
+
+	if (!fsgcnt)
+		return 0;
+
+	if (cb->sg_idx) {
+		for ( ; tsg && j < cb->sg_idx; j++)
+			tsg = tsg->next;
+
+		if (!tsg)
+			return 0;
+	}
+
+	while ((i < fsgcnt) && tsg) {
+		struct qdma_zc_desc *zd;
+
+		/* records do not straddle request pages */
+		if (tsg->len - tsgoff < sizeof(*zd)) {
+			tsg = tsg->next;
+			tsgoff = 0;
+			j++;
+			continue;
+		}
+
+		/* data is visible to the user once the page is reported */
+		dma_sync_single_for_cpu(dev, fsg->dma_addr, PAGE_SIZE,
+			DMA_FROM_DEVICE);
+
+		zd = page_address(tsg->pg) + tsg->offset + tsgoff;
+		zd->slot = pidx;
+		/* last page of a packet carries the whole packet length */
+		zd->len = fsg->len > PAGE_SIZE ?
+			((fsg->len - 1) & (PAGE_SIZE - 1)) + 1 : fsg->len;
+
+		dlen += zd->len;
+		tsgoff += sizeof(*zd);
+		copied += sizeof(*zd);
+		if (tsgoff == tsg->len) {
+			tsg = tsg->next;
+			tsgoff = 0;
+			j++;
+		}
+
+		pidx = ring_idx_incr(pidx, 1, flq->size);
+		i++;
+		fsg = fsg->next;
+	}
+
+	flq->pidx_pend = ring_idx_incr(flq->pidx_pend, i, flq->size);
+
+	/* h/w pidx moves when the pages are recycled */
+	if (update_pidx && (i || req->count))
+		descq_wrb_cidx_update(descq, descq->cidx_wrb_pend);
+
+	cb->sg_idx = j;
+	cb->sg_offset = tsgoff;
+	cb->left -= copied;
+	cb->offset = req->count - cb->left;
+
+	flq->pkt_dlen -= dlen;
+
+	return copied;
+}
+
 /*
  *
  */
@@ -241,6 +394,9 @@ int descq_st_c2h_read(struct qdma_descq *descq, struct qdma_request *req,
 	int i = 0, j = 0;
 	unsigned int copied = 0, flen = 0;
 
+	if (flq->zc_pages)
+		return descq_st_c2h_read_zc(descq, req, update_pidx);
+
 	pr_debug("fsgcnt %d, sg_idx %d\n", fsgcnt, cb->sg_idx);
 	if (!fsgcnt)
 		return 0;
@@ -256,6 +412,9 @@ int descq_st_c2h_read(struct qdma_descq *descq, struct qdma_request *req,
 	while ((i < fsgcnt) && tsg) {
 		unsigned char *faddr = page_address(fsg->pg) + fsg->offset;
 
+		dma_sync_single_for_cpu(&descq->xdev->conf.pdev->dev,
+			fsg->dma_addr, PAGE_SIZE << flq->pg_order,
+			DMA_FROM_DEVICE);
 		flen = fsg->len;
 		foff = 0;
 
@@ -340,7 +499,16 @@ static inline void qdma_c2h_drop_pending_data(struct qdma_descq *descq)
 		flq->pidx_pend, fsgcnt, descq->cidx_wrb_pend, descq->pidx);
 
 	flq->pidx_pend = ring_idx_incr(flq->pidx_pend, fsgcnt, flq->size);
-	
+
+	/* dropped zero copy pages never reach the user, take them back */
+	if (flq->zc_pages) {
+		pidx = ring_idx_decr(flq->pidx_pend, fsgcnt, flq->size);
+		for (i = 0; i < fsgcnt; i++) {
+			flq->zc_ret[pidx] = 1;
+			pidx = ring_idx_incr(pidx, 1, flq->size);
+		}
+		flq_zc_rearm(descq);
+	}
 }
 
 static int qdma_c2h_packets_proc_dflt(struct qdma_descq *descq, struct cmpl_info *cmpl)
@@ -500,7 +668,7 @@ int descq_process_completion_st_c2h(struct qdma_descq *descq, int budget,
 	pr_debug("pend wrb %d\n", pend_wrb_num);
 
 	color = descq->color;
-	while (likely(wrb_cnt < pend_wrb_num)) {
+	while (likely(wrb_cnt < pend_wrb_num) && (!budget || wrb_cnt < budget)) {
 
 		rv = parse_cmpl_entry(descq, &cmpl, descq->cidx_wrb_pend);
 		/* completion entry error, q is halted */
@@ -546,7 +714,7 @@ int descq_process_completion_st_c2h(struct qdma_descq *descq, int budget,
 			if (descq->cidx_wrb != descq->cidx_wrb_pend)
 				descq_wrb_cidx_update(descq, descq->cidx_wrb_pend);
 
-			pidx = ring_idx_decr(flq->pidx_pend, 1, flq->size);
+			pidx = flq_hw_pidx(flq);
 			pr_debug("update wrb %d, pidx %d\n", descq->cidx_wrb_pend,
 				pidx);
 			descq_c2h_pidx_update(descq, pidx);
@@ -563,7 +731,7 @@ int descq_process_completion_st_c2h(struct qdma_descq *descq, int budget,
 		if (descq->cidx_wrb != descq->cidx_wrb_pend)
 			descq_wrb_cidx_update(descq, descq->cidx_wrb_pend);
 
-		pidx = ring_idx_decr(flq->pidx_pend, 1, flq->size);
+		pidx = flq_hw_pidx(flq);
 		pr_debug("update wrb %d, pidx %d\n", descq->cidx_wrb_pend,
 			pidx);
 		descq_c2h_pidx_update(descq, pidx);
@@ -571,7 +739,7 @@ int descq_process_completion_st_c2h(struct qdma_descq *descq, int budget,
 
 	qdma_sgt_req_done(descq);
 
-	return 0;
+	return wrb_cnt;
 }
 
 int qdma_queue_c2h_peek(unsigned long dev_hndl, unsigned long id,
@@ -621,3 +789,38 @@ int qdma_queue_packet_read(unsigned long dev_hndl, unsigned long id,
 
 	return req->count - cb->left;
 }
+
+int qdma_queue_c2h_recycle(unsigned long dev_hndl, unsigned long id,
+			const u32 *slots, unsigned int count)
+{
+	struct qdma_descq *descq = qdma_device_get_descq_by_id(
+					(struct xlnx_dma_dev *)dev_hndl,
+					id, NULL, 0, 1);
+	struct qdma_flq *flq;
+	unsigned int held, i;
+
+	if (!descq)
+		return QDMA_ERR_INVALID_QIDX;
+
+	flq = &descq->flq;
+	if (!flq->zc_pages)
+		return -EINVAL;
+
+	lock_descq(descq);
+	held = ring_idx_delta(flq->pidx_pend, flq->zc_pidx, flq->size);
+	for (i = 0; i < count; i++) {
+		/* only slots reported to the user and not yet returned */
+		if (slots[i] >= flq->size ||
+			ring_idx_delta(slots[i], flq->zc_pidx,
+				flq->size) >= held ||
+			flq->zc_ret[slots[i]])
+			break;
+		flq->zc_ret[slots[i]] = 1;
+	}
+
+	if (flq_zc_rearm(descq) && descq->q_state == Q_STATE_ONLINE)
+		descq_c2h_pidx_update(descq, flq_hw_pidx(flq));
+	unlock_descq(descq);
+
+	return i ? i : (count ? -EINVAL : 0);
+}
@@ -26,6 +26,8 @@
 
 #include <linux/vmalloc.h>
 #include <linux/sched.h>
+#include <linux/cache.h>
+#include <linux/prefetch.h>
 #include "thread.h"
 #include "qdma_descq.h"
 #include "qdma_wq.h"
@@ -157,6 +159,29 @@ failed:
 	return ret;
 }
 
+/*
+ * The pidx update of a fully filled request is left to a following request
+ * of the same batch, unless the ring is full and nothing else would kick it.
+ */
+static inline bool wq_defer_pidx(struct qdma_descq *descq,
+	struct qdma_wqe *wqe)
+{
+	return wqe->wr.more && !wqe->unproc_bytes && descq->avail;
+}
+
+/*
+ * Called whenever pidx enters a new cacheline of the ring, brings the next
+ * line in for writing while the current one is filled
+ */
+static inline void wq_prefetch_desc(struct qdma_descq *descq, int desc_sz)
+{
+	unsigned int n = L1_CACHE_BYTES / desc_sz;
+
+	if (!(descq->pidx & (n - 1)))
+		prefetchw(descq->desc + ((descq->pidx + n) &
+			(descq->conf.rngsz - 1)) * desc_sz);
+}
+
 static int descq_mm_fill(struct qdma_descq *descq, struct qdma_wqe *wqe)
 {
 	struct qdma_mm_desc	*desc;
@@ -194,6 +219,7 @@ static int descq_mm_fill(struct qdma_descq *descq, struct qdma_wqe *wqe)
 		}
 
 		dma_addr = sg_dma_address(sg) + off;
+		wq_prefetch_desc(descq, sizeof(*desc));
 
 		desc->rsvd1 = 0UL;
 		desc->rsvd0 = 0U;
@@ -242,11 +268,6 @@ static int descq_mm_fill(struct qdma_descq *descq, struct qdma_wqe *wqe)
 	wqe->unproc_sg = next;
 	wqe->unproc_sg_num =  wqe->unproc_sg_num - i;
 
-	if (descq->conf.c2h)
-		descq_c2h_pidx_update(descq, descq->pidx);
-	else
-		descq_h2c_pidx_update(descq, descq->pidx);
-
 	return (descq->avail == 0) ? -ENOENT : 0;
 }
 
@@ -295,6 +316,7 @@ static int descq_st_h2c_fill(struct qdma_descq *descq, struct qdma_wqe *wqe)
 		}
 
 		dma_addr = sg_dma_address(sg) + off;
+		wq_prefetch_desc(descq, sizeof(*desc));
 		desc->src_addr = dma_addr;
 		desc->len = len;
 		if (descq->xdev->stm_en) {
@@ -341,9 +363,6 @@ static int descq_st_h2c_fill(struct qdma_descq *descq, struct qdma_wqe *wqe)
 		wqe->wr.req.eot)
 		desc->cdh_flags |= (1 << S_H2C_DESC_F_EOT);
 
-	descq_h2c_pidx_update(descq, (descq->pidx) &
-		(descq->conf.rngsz - 1));
-
 	wqe->unproc_sg = next;
 	wqe->unproc_sg_num =  wqe->unproc_sg_num - i;
 	if (wqe->state == QDMA_WQE_STATE_PENDING) {
@@ -430,47 +449,64 @@ static int descq_st_c2h_fill(struct qdma_descq *descq, struct qdma_wqe *wqe)
 	return ret;
 }
 
+/*
+ * Fill the descriptors of all unprocessed requests in one pass. h2c and mm
+ * queues hold the descq lock for the whole batch and write pidx once at the
+ * end, the writeback thread is woken once to pick up the batch.
+ */
 static void descq_proc_req(struct qdma_wq *queue)
 {
 	struct qdma_wqe		*wqe;
 	struct xlnx_dma_dev	*xdev;
 	struct qdma_descq	*descq;
+	bool			st_c2h, filled = false, kick = false;
 	int			ret;
 
 	xdev = (struct xlnx_dma_dev *)queue->dev_hdl;
 	descq = qdma_device_get_descq_by_id(xdev, queue->qhdl, NULL, 0, 0);
+	st_c2h = descq->conf.st && descq->conf.c2h;
 
 	wqe = wq_next_unproc(queue);
 	pr_debug("QUEUE%d%s wqe %p,%lld bytes,unproc %d,free %d,pending %d\n",
 		queue->qconf->qidx, queue->qconf->c2h ? "R" : "W", wqe,
 		wqe?wqe->unproc_bytes:0, queue->wq_unproc, queue->wq_free,
 		queue->wq_pending);
+	if (!wqe)
+		return;
 
+	if (!st_c2h)
+		lock_descq(descq);
 	while (wqe) {
 		if (wqe->state == QDMA_WQE_STATE_CANCELED ||
 			wqe->state == QDMA_WQE_STATE_CANCELED_HW)
 			goto next;
-		if(descq->conf.st) {
-			if (descq->conf.c2h) {
-				ret = descq_st_c2h_fill(descq, wqe);
-			} else {
-				lock_descq(descq);
-				ret = descq_st_h2c_fill(descq, wqe);
-				unlock_descq(descq);
-			}
-		} else {
-			lock_descq(descq);
+		if (st_c2h)
+			ret = descq_st_c2h_fill(descq, wqe);
+		else if (descq->conf.st)
+			ret = descq_st_h2c_fill(descq, wqe);
+		else
 			ret = descq_mm_fill(descq, wqe);
-			unlock_descq(descq);
-		}
-		if (descq->wbthp)
-			qdma_kthread_wakeup(descq->wbthp);
+		filled = true;
+		if (!st_c2h && !wq_defer_pidx(descq, wqe))
+			kick = true;
 
 		if (ret)
 			break;
 next:
 		wqe = wq_next_unproc(queue);
 	}
+	if (!st_c2h) {
+		if (kick) {
+			if (descq->conf.c2h)
+				descq_c2h_pidx_update(descq, descq->pidx);
+			else
+				descq_h2c_pidx_update(descq, descq->pidx);
+		}
+		unlock_descq(descq);
+	}
+
+	if (filled && descq->wbthp)
+		qdma_kthread_wakeup(descq->wbthp);
 }
 
 static int qdma_wqe_cancel(struct qdma_request *req)
@@ -712,6 +748,10 @@ void qdma_wq_getstat(struct qdma_wq *queue, struct qdma_wq_stat *stat)
 	stat->flq_cidx = descq->flq.cidx;
 	stat->flq_pidx = descq->flq.pidx;
 	stat->flq_pidx_pend = descq->flq.pidx_pend;
+
+	stat->intr_total = descq->dim.irq_total;
+	stat->intr_rate = descq->dim.irq_rate;
+	stat->intr_level = descq->dim.level;
 }
 
 int qdma_wq_update_pidx(struct qdma_wq *queue, u32 pidx)
@@ -729,3 +769,24 @@ int qdma_wq_update_pidx(struct qdma_wq *queue, u32 pidx)
 	return 0;
 }
 
+/*
+ * Write the producer index of h2c and mm queues, used to flush requests
+ * posted with qdma_wr.more set when the rest of the batch was not posted
+ */
+void qdma_wq_kick(struct qdma_wq *queue)
+{
+	struct xlnx_dma_dev	*xdev;
+	struct qdma_descq	*descq;
+
+	xdev = (struct xlnx_dma_dev *)queue->dev_hdl;
+	descq = qdma_device_get_descq_by_id(xdev, queue->qhdl, NULL, 0, 0);
+	if (!descq || (descq->conf.st && descq->conf.c2h))
+		return;
+
+	lock_descq(descq);
+	if (descq->conf.c2h)
+		descq_c2h_pidx_update(descq, descq->pidx);
+	else
+		descq_h2c_pidx_update(descq, descq->pidx);
+	unlock_descq(descq);
+}
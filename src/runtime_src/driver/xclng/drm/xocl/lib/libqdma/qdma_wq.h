@@ -44,6 +44,8 @@ struct qdma_wr {
 	struct kiocb		*kiocb;
 	bool			write;
 	bool			eot;
+	/* more requests follow, defer the pidx update to the last one */
+	bool			more;
 
 	int (*complete)(struct qdma_complete_event *compl_event);
 	void			*priv_data;
@@ -94,6 +96,10 @@ struct qdma_wq_stat {
         u32			flq_pidx;
         u32			flq_pidx_pend;
 
+        u64			intr_total;
+        u32			intr_rate;
+        u32			intr_level;
+
 };
 
 struct qdma_wq {
@@ -210,5 +216,6 @@ ssize_t qdma_wq_post(struct qdma_wq *queue, struct qdma_wr *wr);
 int qdma_cancel_req(struct qdma_wq *queue, struct kiocb *kiocb);
 void qdma_wq_getstat(struct qdma_wq *queue, struct qdma_wq_stat *stat);
 int qdma_wq_update_pidx(struct qdma_wq *queue, u32 pidx);
+void qdma_wq_kick(struct qdma_wq *queue);
 
 #endif /* _QDMA_WR_H */
@@ -48,6 +48,10 @@ static unsigned int poll_mode;
 module_param(poll_mode, uint, 0644);
 MODULE_PARM_DESC(poll_mode, "Set 1 for hw polling, default is 0 (interrupts)");
 
+static unsigned int poll_size;
+module_param(poll_size, uint, 0644);
+MODULE_PARM_DESC(poll_size, "Poll for completion of memory mapped transfers up to this many bytes instead of waiting for the interrupt, default is 0 (never)");
+
 static unsigned int interrupt_mode;
 module_param(interrupt_mode, uint, 0644);
 MODULE_PARM_DESC(interrupt_mode, "0 - MSI-x , 1 - MSI, 2 - Legacy");
@@ -56,6 +60,10 @@ static unsigned int enable_credit_mp;
 module_param(enable_credit_mp, uint, 0644);
 MODULE_PARM_DESC(enable_credit_mp, "Set 1 to enable creidt feature, default is 0 (no credit control)");
 
+static unsigned int req_pool_depth = 2;
+module_param(req_pool_depth, uint, 0444);
+MODULE_PARM_DESC(req_pool_depth, "Requests of up to XDMA_TRANSFER_MAX_DESC descriptors preallocated per engine on the device NUMA node, default is 2");
+
 /*
  * xdma device management
  * maintains a list of the xdma devices
@@ -469,6 +477,12 @@ static u32 engine_status_read(struct xdma_engine *engine, bool clear, bool dump)
  * xdma_engine_stop() - stop an SG DMA engine
  *
  */
+/* completion of the current transfer is polled from the writeback */
+static inline int engine_polled(struct xdma_engine *engine)
+{
+	return poll_mode || engine->xfer_polled;
+}
+
 static void xdma_engine_stop(struct xdma_engine *engine)
 {
 	u32 w;
@@ -482,7 +496,7 @@ static void xdma_engine_stop(struct xdma_engine *engine)
 	w |= (u32)XDMA_CTRL_IE_READ_ERROR;
 	w |= (u32)XDMA_CTRL_IE_DESC_ERROR;
 
-	if (poll_mode) {
+	if (engine_polled(engine)) {
 		w |= (u32) XDMA_CTRL_POLL_MODE_WB;
 	} else {
 		w |= (u32)XDMA_CTRL_IE_DESC_STOPPED;
@@ -531,7 +545,7 @@ static void engine_start_mode_config(struct xdma_engine *engine)
 	w |= (u32)XDMA_CTRL_IE_DESC_ALIGN_MISMATCH;
 	w |= (u32)XDMA_CTRL_IE_MAGIC_STOPPED;
 
-	if (poll_mode) {
+	if (engine_polled(engine)) {
 		w |= (u32)XDMA_CTRL_POLL_MODE_WB;
 	} else {
 		w |= (u32)XDMA_CTRL_IE_DESC_STOPPED;
@@ -1120,7 +1134,7 @@ static int engine_service(struct xdma_engine *engine, int desc_writeback)
 	}
 
 	/* Before starting engine again, clear the writeback data */
-        if (poll_mode) {
+        if (engine_polled(engine)) {
 		wb_data = (struct xdma_poll_wb *)engine->poll_mode_addr_virt;
 		wb_data->completed_desc_count = 0;
 	}
@@ -2416,6 +2430,75 @@ static void engine_alignments(struct xdma_engine *engine)
 	}
 }
 
+static void xdma_request_free(struct xdma_request_cb *req)
+{
+	if (((unsigned long)req) >= VMALLOC_START &&
+	    ((unsigned long)req) < VMALLOC_END)
+		vfree(req);
+	else
+		kfree(req);
+}
+
+static struct xdma_request_cb * xdma_request_alloc(unsigned int sdesc_nr,
+						int node)
+{
+	struct xdma_request_cb *req;
+	unsigned int size = sizeof(struct xdma_request_cb) +
+				sdesc_nr * sizeof(struct sw_desc);
+
+	req = kzalloc_node(size, GFP_KERNEL, node);
+	if (!req)
+		req = vzalloc_node(size, node);
+	if (!req) {
+		pr_info("OOM, %u sw_desc, %u.\n", sdesc_nr, size);
+		return NULL;
+	}
+
+	return req;
+}
+
+/*
+ * Requests that fit in one transfer come from the engine pool, so the
+ * submit path does not allocate.  Larger requests, or requests made
+ * while the pool is empty, are allocated on the device node.
+ */
+static struct xdma_request_cb *engine_request_get(struct xdma_engine *engine,
+						unsigned int sdesc_nr)
+{
+	struct xdma_request_cb *req = NULL;
+
+	if (sdesc_nr <= XDMA_TRANSFER_MAX_DESC) {
+		spin_lock(&engine->req_pool_lock);
+		if (!list_empty(&engine->req_pool)) {
+			req = list_first_entry(&engine->req_pool,
+					struct xdma_request_cb, pool_entry);
+			list_del(&req->pool_entry);
+		}
+		spin_unlock(&engine->req_pool_lock);
+	}
+
+	if (!req)
+		return xdma_request_alloc(sdesc_nr,
+				dev_to_node(&engine->xdev->pdev->dev));
+
+	memset(req, 0, offsetof(struct xdma_request_cb, sdesc));
+	req->pooled = 1;
+	return req;
+}
+
+static void engine_request_put(struct xdma_engine *engine,
+				struct xdma_request_cb *req)
+{
+	if (!req->pooled) {
+		xdma_request_free(req);
+		return;
+	}
+
+	spin_lock(&engine->req_pool_lock);
+	list_add(&req->pool_entry, &engine->req_pool);
+	spin_unlock(&engine->req_pool_lock);
+}
+
 static void engine_free_resource(struct xdma_engine *engine)
 {
 	struct xdma_dev *xdev = engine->xdev;
@@ -2447,6 +2530,14 @@ static void engine_free_resource(struct xdma_engine *engine)
 			engine->cyclic_result, engine->cyclic_result_bus);
 		engine->cyclic_result = NULL;
 	}
+
+	while (!list_empty(&engine->req_pool)) {
+		struct xdma_request_cb *req = list_first_entry(
+			&engine->req_pool, struct xdma_request_cb, pool_entry);
+
+		list_del(&req->pool_entry);
+		xdma_request_free(req);
+	}
 }
 
 static void engine_destroy(struct xdma_dev *xdev, struct xdma_engine *engine)
@@ -2585,15 +2676,18 @@ static int engine_init_regs(struct xdma_engine *engine)
 	reg_value |= XDMA_CTRL_IE_READ_ERROR;
 	reg_value |= XDMA_CTRL_IE_DESC_ERROR;
 
-	/* if using polled mode, configure writeback address */
-	if (poll_mode) {
-		rv = engine_writeback_setup(engine);
-		if (rv) {
-			dbg_init("%s descr writeback setup failed.\n",
-				engine->name);
-			goto fail_wb;
-		}
-	} else {
+	/*
+	 * configure the writeback address, also used by transfers polled
+	 * because of poll_size
+	 */
+	rv = engine_writeback_setup(engine);
+	if (rv) {
+		dbg_init("%s descr writeback setup failed.\n",
+			engine->name);
+		goto fail_wb;
+	}
+
+	if (!poll_mode) {
 		/* enable the relevant completion interrupts */
 		reg_value |= XDMA_CTRL_IE_DESC_STOPPED;
 		reg_value |= XDMA_CTRL_IE_DESC_COMPLETED;
@@ -2631,7 +2725,10 @@ fail_wb:
 static int engine_alloc_resource(struct xdma_engine *engine)
 {
 	struct xdma_dev *xdev = engine->xdev;
+	int node = dev_to_node(&xdev->pdev->dev);
+	unsigned int i;
 
+	/* coherent memory is allocated on the node of the device */
 	engine->desc = dma_alloc_coherent(&xdev->pdev->dev,
 			XDMA_TRANSFER_MAX_DESC * sizeof(struct xdma_desc),
 			&engine->desc_bus, GFP_KERNEL);
@@ -2641,16 +2738,14 @@ static int engine_alloc_resource(struct xdma_engine *engine)
 		goto err_out;
 	}
 
-	if (poll_mode) {
-		engine->poll_mode_addr_virt = dma_alloc_coherent(
-					&xdev->pdev->dev,
-					sizeof(struct xdma_poll_wb),
-					&engine->poll_mode_bus, GFP_KERNEL);
-		if (!engine->poll_mode_addr_virt) {
-                        pr_warn("%s, %s poll pre-alloc writeback OOM.\n",
-				dev_name(&xdev->pdev->dev), engine->name);
-			goto err_out;
-		}
+	engine->poll_mode_addr_virt = dma_alloc_coherent(
+				&xdev->pdev->dev,
+				sizeof(struct xdma_poll_wb),
+				&engine->poll_mode_bus, GFP_KERNEL);
+	if (!engine->poll_mode_addr_virt) {
+                pr_warn("%s, %s poll pre-alloc writeback OOM.\n",
+			dev_name(&xdev->pdev->dev), engine->name);
+		goto err_out;
 	}
 
 	if (engine->streaming && engine->dir == DMA_FROM_DEVICE) {
@@ -2665,6 +2760,19 @@ static int engine_alloc_resource(struct xdma_engine *engine)
 		}
 	}
 
+	for (i = 0; i < req_pool_depth; i++) {
+		struct xdma_request_cb *req;
+
+		req = xdma_request_alloc(XDMA_TRANSFER_MAX_DESC, node);
+		if (!req) {
+			pr_warn("%s, %s pre-alloc request OOM.\n",
+				dev_name(&xdev->pdev->dev), engine->name);
+			goto err_out;
+		}
+		req->pooled = 1;
+		list_add(&req->pool_entry, &engine->req_pool);
+	}
+
 	return 0;
 
 err_out:
@@ -2683,6 +2791,10 @@ static int engine_init(struct xdma_engine *engine, struct xdma_dev *xdev,
 	/* set magic */
 	engine->magic = MAGIC_ENGINE;
 
+	/* engine_destroy() frees the pool once the magic is set */
+	spin_lock_init(&engine->req_pool_lock);
+	INIT_LIST_HEAD(&engine->req_pool);
+
 	engine->channel = channel;
 
 	/* engine interrupt request bit */
@@ -2755,12 +2867,14 @@ static int transfer_build(struct xdma_engine *engine,
 	int j = 0;
 
 	for (; i < desc_max; i++, j++, sdesc++) {
+		u64 ep_addr = req->ep_vec ? sdesc->ep_addr : req->ep_addr;
+
 		dbg_desc("sw desc %d/%u: 0x%llx, 0x%x, ep 0x%llx.\n",
 			i + req->sw_desc_idx, req->sw_desc_cnt,
-			sdesc->addr, sdesc->len, req->ep_addr);
+			sdesc->addr, sdesc->len, ep_addr);
 
 		/* fill in descriptor entry j with transfer details */
-		xdma_desc_set(xfer->desc_virt + j, sdesc->addr, req->ep_addr,
+		xdma_desc_set(xfer->desc_virt + j, sdesc->addr, ep_addr,
 				 sdesc->len, xfer->dir);
 		xfer->len += sdesc->len;
 
@@ -2847,37 +2961,15 @@ static void xdma_request_cb_dump(struct xdma_request_cb *req)
 }
 #endif
 
-static void xdma_request_free(struct xdma_request_cb *req)
-{
-	if (((unsigned long)req) >= VMALLOC_START &&
-	    ((unsigned long)req) < VMALLOC_END)
-		vfree(req);
-	else
-		kfree(req);
-}
-
-static struct xdma_request_cb * xdma_request_alloc(unsigned int sdesc_nr)
-{
-	struct xdma_request_cb *req;
-	unsigned int size = sizeof(struct xdma_request_cb) +
-				sdesc_nr * sizeof(struct sw_desc);
-
-	req = kzalloc(size, GFP_KERNEL);
-	if (!req) {
-		req = vmalloc(size);
-		if (req)
-			memset(req, 0, size);
-	}
-	if (!req) {
-		pr_info("OOM, %u sw_desc, %u.\n", sdesc_nr, size);
-		return NULL;
-	}
-
-	return req;
-}
-
+/*
+ * @ep_addrs: endpoint address of each of the sgt->nents entries, NULL if
+ * the entries are transferred to consecutive addresses from @ep_addr
+ * @pool: engine whose request pool is used, NULL to allocate a request
+ * that is released with xdma_request_free()
+ */
 static struct xdma_request_cb * xdma_init_request(struct sg_table *sgt,
-						u64 ep_addr)
+			u64 ep_addr, const u64 *ep_addrs,
+			struct xdma_engine *pool)
 {
 	struct xdma_request_cb *req;
 	struct scatterlist *sg = sgt->sgl;
@@ -2895,23 +2987,28 @@ static struct xdma_request_cb * xdma_init_request(struct sg_table *sgt,
 	//pr_info("ep 0x%llx, desc %u+%u.\n", ep_addr, max, extra);
 
 	max += extra;
-	req = xdma_request_alloc(max);
+	req = pool ? engine_request_get(pool, max) :
+		xdma_request_alloc(max, NUMA_NO_NODE);
 	if (!req)
 		return NULL;
 
 	req->sgt = sgt;
 	req->ep_addr = ep_addr;
+	req->ep_vec = (ep_addrs != NULL);
 
 	for (i = 0, sg = sgt->sgl;  i < sgt->nents; i++, sg = sg_next(sg)) {
 		unsigned int tlen = sg_dma_len(sg);
 		dma_addr_t addr = sg_dma_address(sg);
+		u64 ep = ep_addrs ? ep_addrs[i] : 0;
 
 		req->total_len += tlen;
 		while (tlen) {
 			req->sdesc[j].addr = addr;
+			req->sdesc[j].ep_addr = ep;
 			if (tlen > XDMA_DESC_BLEN_MAX) {
 				req->sdesc[j].len = XDMA_DESC_BLEN_MAX;
 				addr += XDMA_DESC_BLEN_MAX;
+				ep += XDMA_DESC_BLEN_MAX;
 				tlen -= XDMA_DESC_BLEN_MAX;
 			} else {
 				req->sdesc[j].len = tlen;
@@ -2929,8 +3026,9 @@ static struct xdma_request_cb * xdma_init_request(struct sg_table *sgt,
 	return req;
 }
 
-ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
-			struct sg_table *sgt, bool dma_mapped, int timeout_ms)
+static ssize_t xdma_xfer_submit_ep(void *dev_hndl, int channel, bool write,
+			u64 ep_addr, const u64 *ep_addrs, struct sg_table *sgt,
+			bool dma_mapped, int timeout_ms)
 {
 	struct xdma_dev *xdev = (struct xdma_dev *)dev_hndl;
 	struct xdma_engine *engine;
@@ -2940,6 +3038,7 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 	int nents;
 	enum dma_data_direction dir = write ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
 	struct xdma_request_cb *req = NULL;
+	int polled;
 
 	if (!dev_hndl)
 		return -EINVAL;
@@ -2993,7 +3092,7 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 		BUG_ON(!sgt->nents);
 	}
 
-	req = xdma_init_request(sgt, ep_addr);
+	req = xdma_init_request(sgt, ep_addr, ep_addrs, engine);
 	if (!req) {
 		rv = -ENOMEM;
 		goto unmap_sgl;
@@ -3002,6 +3101,14 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 	dbg_tfr("%s, len %u sg cnt %u.\n",
 		engine->name, req->total_len, req->sw_desc_cnt);
 
+	/*
+	 * small memory mapped transfers spin on the writeback, the
+	 * interrupt latency would dominate. Streaming C2H may wait on
+	 * data for long, always use interrupts for it
+	 */
+	polled = poll_mode || (poll_size && !engine->streaming &&
+		req->total_len <= poll_size);
+
 	sg = sgt->sgl;
 	nents = req->sw_desc_cnt;
 	while (nents) {
@@ -3019,6 +3126,10 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 		}
 		xfer = &req->xfer;
 
+		spin_lock_irqsave(&engine->lock, flags);
+		engine->xfer_polled = polled;
+		spin_unlock_irqrestore(&engine->lock, flags);
+
 		if (!dma_mapped)
 			xfer->flags = XFER_FLAG_NEED_UNMAP;
 
@@ -3039,6 +3150,9 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 
 		rv = transfer_queue(engine, xfer);
 		if (rv < 0) {
+			spin_lock_irqsave(&engine->lock, flags);
+			engine->xfer_polled = 0;
+			spin_unlock_irqrestore(&engine->lock, flags);
 			spin_unlock(&engine->desc_lock);
 			pr_info("unable to submit %s, %d.\n", engine->name, rv);
 			goto unmap_sgl;
@@ -3047,7 +3161,7 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 		/*
 		 * When polling, determine how many descriptors have been queued		 * on the engine to determine the writeback value expected
 		 */
-		if (poll_mode) {
+		if (polled) {
 			unsigned int desc_count;
 
 			spin_lock_irqsave(&engine->lock, flags);
@@ -3087,7 +3201,7 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 			rv = -EIO;
 			break;
 		default:
-			if (!poll_mode && rv == -ERESTARTSYS) {
+			if (!polled && rv == -ERESTARTSYS) {
 				pr_info("xfer 0x%p,%u, canceled, ep 0x%llx.\n",
 					xfer, xfer->len,
 					req->ep_addr - xfer->len);
@@ -3116,6 +3230,9 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 			break;
 		}
 		transfer_destroy(xdev, xfer);
+		spin_lock_irqsave(&engine->lock, flags);
+		engine->xfer_polled = 0;
+		spin_unlock_irqrestore(&engine->lock, flags);
 		spin_unlock(&engine->desc_lock);
 
 		if (rv < 0)
@@ -3129,15 +3246,34 @@ unmap_sgl:
 	}
 
 	if (req)
-		xdma_request_free(req);
+		engine_request_put(engine, req);
 
 	if (rv < 0)
 		return rv;
 
 	return done;
 }
+
+ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
+			struct sg_table *sgt, bool dma_mapped, int timeout_ms)
+{
+	return xdma_xfer_submit_ep(dev_hndl, channel, write, ep_addr, NULL,
+			sgt, dma_mapped, timeout_ms);
+}
 EXPORT_SYMBOL_GPL(xdma_xfer_submit);
 
+ssize_t xdma_xfer_submit_v(void *dev_hndl, int channel, bool write,
+			const u64 *ep_addrs, struct sg_table *sgt,
+			int timeout_ms)
+{
+	if (!ep_addrs || !sgt->nents)
+		return -EINVAL;
+
+	return xdma_xfer_submit_ep(dev_hndl, channel, write, ep_addrs[0],
+			ep_addrs, sgt, true, timeout_ms);
+}
+EXPORT_SYMBOL_GPL(xdma_xfer_submit_v);
+
 int xdma_performance_submit(struct xdma_dev *xdev, struct xdma_engine *engine)
 {
 	u8 *buffer_virt;
@@ -3225,8 +3361,12 @@ static struct xdma_dev *alloc_dev_instance(struct pci_dev *pdev)
 
 	BUG_ON(!pdev);
 
-	/* allocate zeroed device book keeping structure */
-	xdev = kzalloc(sizeof(struct xdma_dev), GFP_KERNEL);
+	/*
+	 * allocate zeroed device book keeping structure, the engines are
+	 * embedded and are touched on every transfer and interrupt
+	 */
+	xdev = kzalloc_node(sizeof(struct xdma_dev), GFP_KERNEL,
+			dev_to_node(&pdev->dev));
 	if (!xdev) {
 		pr_info("OOM, xdma_dev.\n");
 		return NULL;
@@ -4256,7 +4396,8 @@ int xdma_cyclic_transfer_setup(struct xdma_engine *engine)
 		goto err_out;
 	}
 
-	engine->cyclic_req = xdma_init_request(&engine->cyclic_sgt, 0);
+	engine->cyclic_req = xdma_init_request(&engine->cyclic_sgt, 0, NULL,
+						NULL);
 	if (!engine->cyclic_req) {
 		pr_info("%s cyclic request OOM.\n", engine->name);
 		rc = -ENOMEM;
@@ -382,6 +382,7 @@ struct xdma_result {
 struct sw_desc {
 	dma_addr_t addr;
 	unsigned int len;
+	u64 ep_addr;	/* endpoint address, if the request has ep_vec set */
 };
 
 /* Describes a (SG DMA) single transfer for the engine */
@@ -407,9 +408,13 @@ struct xdma_request_cb {
 	struct sg_table *sgt;
 	unsigned int total_len;
 	u64 ep_addr;
+	int ep_vec;	/* each sw_desc carries its own endpoint address */
 
 	struct xdma_transfer xfer;
 
+	struct list_head pool_entry;	/* on engine req_pool while free */
+	int pooled;			/* owned by the engine req_pool */
+
 	unsigned int sw_desc_idx;
 	unsigned int sw_desc_cnt;
 	struct sw_desc sdesc[0];
@@ -463,6 +468,7 @@ struct xdma_engine {
 	/* Members associated with polled mode support */
 	u8 *poll_mode_addr_virt;	/* virt addr for descriptor writeback */
 	dma_addr_t poll_mode_bus;	/* bus addr for descriptor writeback */
+	int xfer_polled;	/* current transfer polled, see poll_size */
 
 	/* Members associated with interrupt mode support */
 	wait_queue_head_t shutdown_wq;	/* wait queue for shutdown sync */
@@ -476,6 +482,10 @@ struct xdma_engine {
 	dma_addr_t desc_bus;
 	struct xdma_desc *desc;
 
+	/* preallocated requests on the device node, see req_pool_depth */
+	spinlock_t req_pool_lock;
+	struct list_head req_pool;
+
 	/* for performance test support */
 	struct xdma_performance_ioctl *xdma_perf;	/* perf test control */
 	wait_queue_head_t xdma_perf_wq;	/* Perf test sync */
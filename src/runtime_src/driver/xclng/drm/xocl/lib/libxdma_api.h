@@ -150,6 +150,19 @@ int xdma_user_isr_disable(void *dev_hndl, unsigned int mask);
  */
 ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 			struct sg_table *sgt, bool dma_mapped, int timeout_ms);
+
+/*
+ * xdma_xfer_submit_v - submit one descriptor chain that transfers each
+ *	entry of a DMA mapped scatter-gather list to its own endpoint
+ *	address.  This is a blocking call
+ * @ep_addrs: offset into the DDR/BRAM memory of each of the sgt->nents
+ *	entries
+ * return # of bytes transfered or
+ *	 < 0 in case of error
+ */
+ssize_t xdma_xfer_submit_v(void *dev_hndl, int channel, bool write,
+			const u64 *ep_addrs, struct sg_table *sgt,
+			int timeout_ms);
 			
 /*
  * xdma_device_online - bring device offline
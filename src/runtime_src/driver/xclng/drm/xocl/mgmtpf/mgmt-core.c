@@ -47,6 +47,11 @@ module_param(health_check, int, (S_IRUGO|S_IWUSR));
 MODULE_PARM_DESC(health_check,
 	"Enable health thread that checks the status of AXI Firewall and SYSMON. (0 = disable, 1 = enable)");
 
+unsigned int sensor_sample_ms = 1000;
+module_param(sensor_sample_ms, uint, S_IRUGO);
+MODULE_PARM_DESC(sensor_sample_ms,
+	"Interval (in ms) at which XMC and SYSMON sensors are sampled into the sensors_bin and sensors_raw snapshots. (0 = sample on every read, 1000 = default)");
+
 int minimum_initialization = 0;
 module_param(minimum_initialization, int, (S_IRUGO|S_IWUSR));
 MODULE_PARM_DESC(minimum_initialization,
@@ -83,6 +83,19 @@ static int bitstream_ioctl_axlf(struct xclmgmt_dev *lro, const void __user *arg)
 	return xocl_icap_download_axlf(lro, bitstream_obj.xclbin);
 }
 
+static int bitstream_ioctl_uuid(struct xclmgmt_dev *lro, const void __user *arg)
+{
+	struct xclmgmt_ioc_bitstream_uuid bitstream_obj;
+	xuid_t uuid;
+
+	if (copy_from_user((void *)&bitstream_obj, arg,
+		sizeof(struct xclmgmt_ioc_bitstream_uuid)))
+		return -EFAULT;
+
+	memcpy(&uuid, bitstream_obj.uuid, sizeof(uuid));
+	return xocl_icap_download_uuid(lro, &uuid);
+}
+
 long mgmt_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
 	struct xclmgmt_char *lro_char = (struct xclmgmt_char *)filp->private_data;
@@ -126,6 +139,9 @@ long mgmt_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	case XCLMGMT_IOCICAPDOWNLOAD_AXLF:
 		result = bitstream_ioctl_axlf(lro, (void __user *)arg);
 		break;
+	case XCLMGMT_IOCICAPDOWNLOAD_UUID:
+		result = bitstream_ioctl_uuid(lro, (void __user *)arg);
+		break;
 	case XCLMGMT_IOCOCLRESET:
 		result = reset_ocl_ioctl(lro);
 		break;
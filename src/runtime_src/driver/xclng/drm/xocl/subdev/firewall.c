@@ -68,6 +68,7 @@ struct firewall {
 	u32			err_detected_status;
 	u32			err_detected_level;
 	u64			err_detected_time;
+	unsigned long		check_jiffies;
 
 	struct task_struct	*health_thread;
 	struct xocl_health_thread_arg thread_arg;
@@ -77,13 +78,31 @@ struct firewall {
 static int clear_firewall(struct platform_device *pdev);
 static u32 check_firewall(struct platform_device *pdev, int *level);
 
+/*
+ * Status is cached by check_firewall(), which the health thread runs every
+ * interval. Only rescan the firewalls when the cache is older than two
+ * intervals, e.g. the health thread is not running or health_check is off.
+ */
+static void refresh_firewall(struct platform_device *pdev)
+{
+	struct firewall *fw;
+
+	fw = platform_get_drvdata(pdev);
+	BUG_ON(!fw);
+
+	if (!fw->health_thread || time_after(jiffies, fw->check_jiffies +
+		msecs_to_jiffies(fw->thread_arg.interval * 2)))
+		check_firewall(pdev, NULL);
+}
+
 static int get_prop(struct platform_device *pdev, u32 prop, void *val) {
 	struct firewall *fw;
 
 	fw = platform_get_drvdata(pdev);
 	BUG_ON(!fw);
 
-	check_firewall(pdev, NULL);
+	if (prop != XOCL_AF_PROP_TOTAL_LEVEL)
+		refresh_firewall(pdev);
 	switch (prop) {
 	case XOCL_AF_PROP_TOTAL_LEVEL:
 		*(u32 *)val = fw->max_level;
@@ -211,6 +230,7 @@ static u32 check_firewall(struct platform_device *pdev, int *level)
 
 	fw->curr_status = val;
 	fw->curr_level = i >= fw->max_level ? -1 : i;
+	fw->check_jiffies = jiffies;
 
 	return (val);
 }
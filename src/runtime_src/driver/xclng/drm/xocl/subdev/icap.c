@@ -30,6 +30,10 @@
 #include <linux/version.h>
 #include <linux/uuid.h>
 #include <linux/pid.h>
+#include <linux/ktime.h>
+#include <linux/zlib.h>
+#include <linux/crc32.h>
+#include <linux/workqueue.h>
 #include "xclbin.h"
 #include "../xocl_drv.h"
 #include "mgmt-ioctl.h"
@@ -47,6 +51,7 @@ static xuid_t uuid_null = NULL_UUID_LE;
 
 #define	ICAP_PRIVILEGED(icap)	((icap)->icap_regs != NULL)
 #define DMA_HWICAP_BITFILE_BUFFER_SIZE 1024
+#define	ICAP_INFLATE_CHUNK_SIZE		(64 * 1024)
 #define	ICAP_MAX_REG_GROUPS		5
 
 #define	ICAP_MAX_NUM_CLOCKS		2
@@ -110,6 +115,12 @@ struct icap_bitstream_user {
 	pid_t			ibu_pid;
 };
 
+/* A downloaded xclbin kept for download by uuid, keyed by its header uuid */
+struct icap_cached_xclbin {
+	struct list_head	icx_list;
+	struct axlf		*icx_xclbin;
+};
+
 struct icap {
 	struct platform_device	*icap_pdev;
 	struct mutex		icap_lock;
@@ -132,8 +143,48 @@ struct icap {
 
 	char                    *icap_clock_freq_topology;
 	unsigned long		icap_clock_freq_topology_length;
+
+	/* Recently downloaded xclbins, most recent first */
+	struct list_head	icap_xclbin_cache;
+	unsigned int		icap_xclbin_cache_num;
+
+	/* MB firmware images stashed last, see icap_stash_mb_image() */
+	u32			icap_sche_crc;
+	u64			icap_sche_length;
+	u32			icap_mgmt_crc;
+	u64			icap_mgmt_length;
+
+	/* Clock boost governor, see icap_boost_work() */
+	struct delayed_work	icap_boost_work;
+	/* usecs spent at each frequency_table step, per clock */
+	u64			*icap_residency;
+	ktime_t			icap_residency_stamp;
 };
 
+static unsigned int xclbin_cache_num = 0;
+module_param(xclbin_cache_num, uint, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(xclbin_cache_num,
+	"Number of downloaded xclbins kept in memory for download by uuid (0 = no caching, default)");
+
+static unsigned int clock_boost_ms = 0;
+module_param(clock_boost_ms, uint, S_IRUGO);
+MODULE_PARM_DESC(clock_boost_ms,
+	"Interval in ms of the governor stepping kernel clocks between the lowest clock and the one of the xclbin on temperature and 12V current (0 = off, default)");
+
+static unsigned int clock_boost_temp = 85;
+module_param(clock_boost_temp, uint, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(clock_boost_temp,
+	"FPGA temperature in C at which the clock boost governor steps down (default 85)");
+
+static unsigned int clock_boost_curr = 6000;
+module_param(clock_boost_curr, uint, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(clock_boost_curr,
+	"Total 12V current in mA at which the clock boost governor steps down (0 = ignore, default 6000)");
+
+/* The governor steps up only this far below the limits */
+#define	ICAP_BOOST_TEMP_MARGIN	5
+#define	ICAP_BOOST_CURR_MARGIN(curr)	((curr) / 10)
+
 static inline u32 reg_rd(void __iomem *reg)
 {
 	return XOCL_READ_REG32(reg);
@@ -387,6 +438,35 @@ static unsigned short icap_get_ocl_frequency(const struct icap *icap, int idx)
 	return freq;
 }
 
+#define	ICAP_NUM_FREQ_STEPS	ARRAY_SIZE(frequency_table)
+#define	ICAP_RESIDENCY(icap, clk, step)	\
+	((icap)->icap_residency[(clk) * ICAP_NUM_FREQ_STEPS + (step)])
+
+/*
+ * Charge the time since the last call to the current frequency step of each
+ * clock. Called before every clock change, caller holds icap_lock.
+ */
+static void icap_account_residency(struct icap *icap)
+{
+	ktime_t now = ktime_get();
+	u64 us = ktime_us_delta(now, icap->icap_residency_stamp);
+	unsigned short freq;
+	int i;
+
+	icap->icap_residency_stamp = now;
+	if (!icap->icap_residency)
+		return;
+
+	for (i = 0; i < ICAP_MAX_NUM_CLOCKS; i++) {
+		if (!icap->icap_clock_bases[i])
+			continue;
+		freq = icap_get_ocl_frequency(icap, i);
+		if (freq)
+			ICAP_RESIDENCY(icap, i, find_matching_freq_config(freq)) +=
+				us;
+	}
+}
+
 /*
  * Based on Clocking Wizard v5.1, section Dynamic Reconfiguration
  * through AXI4-Lite
@@ -401,6 +481,8 @@ static int icap_ocl_freqscaling(struct icap *icap, bool force)
 	unsigned idx = 0;
 	long err = 0;
 
+	icap_account_residency(icap);
+
 	for(i = 0; i < ICAP_MAX_NUM_CLOCKS; ++i) {
 		// A value of zero means skip scaling for this clock index
 		if (!icap->icap_ocl_frequency[i])
@@ -701,6 +783,87 @@ static int icap_ocl_get_freqscaling(struct platform_device *pdev,
 	return 0;
 }
 
+/*
+ * Clock boost governor. Each interval every kernel clock moves one step up
+ * while temperature and 12V current are below the limits by a margin, never
+ * above the clock of the xclbin, or one step down while a limit is reached.
+ * Reclocking freezes the AXI gate, so the new clocks are only applied while
+ * no process uses the xclbin and take effect for the next one.
+ */
+static void icap_boost_work(struct work_struct *work)
+{
+	struct icap *icap = container_of(to_delayed_work(work), struct icap,
+		icap_boost_work);
+	xdev_handle_t xdev = xocl_get_xdev(icap->icap_pdev);
+	struct clock_freq_topology *topology;
+	unsigned short freqs[ICAP_MAX_NUM_CLOCKS] = { 0 };
+	u32 temp = 0, pex = 0, aux = 0;
+	bool have_curr = false, over, under, change = false;
+	int i, step, num_clocks;
+
+	/* XMC knows temperature and current, sysmon only the temperature */
+	if (!xocl_xmc_get_prop(xdev, XOCL_XMC_PROP_FPGA_TEMP, &temp)) {
+		have_curr =
+			!xocl_xmc_get_prop(xdev, XOCL_XMC_PROP_12V_PEX_CURR, &pex) &&
+			!xocl_xmc_get_prop(xdev, XOCL_XMC_PROP_12V_AUX_CURR, &aux);
+	} else if (!xocl_sysmon_get_prop(xdev, XOCL_SYSMON_PROP_TEMP, &temp)) {
+		temp /= 1000;
+	} else {
+		/* Never boost blind */
+		goto again;
+	}
+
+	over = temp >= clock_boost_temp ||
+		(clock_boost_curr && have_curr &&
+		pex + aux >= clock_boost_curr);
+	under = temp + ICAP_BOOST_TEMP_MARGIN < clock_boost_temp &&
+		(!clock_boost_curr || (have_curr && pex + aux +
+		ICAP_BOOST_CURR_MARGIN(clock_boost_curr) < clock_boost_curr));
+
+	mutex_lock(&icap->icap_lock);
+	icap_account_residency(icap);
+
+	topology = (struct clock_freq_topology *)icap->icap_clock_freq_topology;
+	if (!topology || icap->icap_axi_gate_frozen ||
+		icap_bitstream_in_use(icap, 0))
+		goto unlock;
+
+	num_clocks = min_t(int, topology->m_count, ICAP_MAX_NUM_CLOCKS);
+	for (i = 0; i < num_clocks; i++) {
+		struct clock_freq *clk = &topology->m_clock_freq[i];
+
+		freqs[i] = icap_get_ocl_frequency(icap, i);
+		if (!freqs[i] ||
+			(clk->m_type != CT_DATA && clk->m_type != CT_KERNEL))
+			continue;
+
+		step = find_matching_freq_config(freqs[i]);
+		if (over && step > 0)
+			step--;
+		else if (under && step + 1 < ICAP_NUM_FREQ_STEPS &&
+			frequency_table[step + 1].ocl <= clk->m_freq_Mhz)
+			step++;
+		else
+			continue;
+
+		freqs[i] = frequency_table[step].ocl;
+		change = true;
+	}
+
+	if (change) {
+		ICAP_INFO(icap, "clock boost at %u C, %u mA: %u %u MHz",
+			temp, pex + aux, freqs[0], freqs[1]);
+		(void) set_freqs(icap, freqs, ICAP_MAX_NUM_CLOCKS);
+	}
+
+unlock:
+	mutex_unlock(&icap->icap_lock);
+again:
+	if (clock_boost_ms)
+		schedule_delayed_work(&icap->icap_boost_work,
+			msecs_to_jiffies(clock_boost_ms));
+}
+
 static inline bool mig_calibration_done(struct icap *icap)
 {
 	return (reg_rd(&icap->icap_state->igs_state) & BIT(0)) != 0;
@@ -731,10 +894,8 @@ static inline void free_clock_freq_topology(struct icap *icap)
 }
 
 static int icap_setup_clock_freq_topology(struct icap *icap,
-	const char __user *buffer, unsigned long length)	
+	const char *buffer, unsigned long length)	
 {
-	int err;
-
 	if (length == 0)
 		return 0;
 
@@ -744,11 +905,7 @@ static int icap_setup_clock_freq_topology(struct icap *icap,
 	if (!icap->icap_clock_freq_topology)
 		return -ENOMEM;
 
-	err = copy_from_user(icap->icap_clock_freq_topology, buffer, length);
-	if (err) {
-		free_clock_freq_topology(icap);
-		return -EFAULT;
-	}
+	memcpy(icap->icap_clock_freq_topology, buffer, length);
 	icap->icap_clock_freq_topology_length = length;
 
 	return 0;    
@@ -762,10 +919,8 @@ static inline void free_clear_bitstream(struct icap *icap)
 }
 
 static int icap_setup_clear_bitstream(struct icap *icap,
-	const char __user *buffer, unsigned long length)
+	const char *buffer, unsigned long length)
 {
-	int err;
-
 	if (length == 0)
 		return 0;
 
@@ -775,11 +930,7 @@ static int icap_setup_clear_bitstream(struct icap *icap,
 	if (!icap->icap_clear_bitstream)
 		return -ENOMEM;
 
-	err = copy_from_user(icap->icap_clear_bitstream, buffer, length);
-	if (err) {
-		free_clear_bitstream(icap);
-		return -EFAULT;
-	}
+	memcpy(icap->icap_clear_bitstream, buffer, length);
 	icap->icap_clear_bitstream_length = length;
 
 	return 0;
@@ -990,13 +1141,21 @@ static int bitstream_helper(struct icap *icap, const u32 *word_buffer,
 	return err;
 }
 
+static void icap_report_throughput(struct icap *icap, u64 bytes,
+	ktime_t start)
+{
+	u64 us = ktime_to_us(ktime_sub(ktime_get(), start));
+
+	ICAP_INFO(icap, "downloaded %llu bytes in %llu us, %llu KB/s", bytes,
+		us, us ? div64_u64(bytes * USEC_PER_SEC, us * 1024) : 0);
+}
+
 static long icap_download(struct icap *icap, const char *buffer,
 	unsigned long length)
 {
 	long err = 0;
 	XHwIcap_Bit_Header bit_header = { 0 };
-	unsigned numCharsRead = DMA_HWICAP_BITFILE_BUFFER_SIZE;
-	unsigned byte_read;
+	ktime_t start;
 
 	BUG_ON(!buffer);
 	BUG_ON(!length);
@@ -1014,22 +1173,116 @@ static long icap_download(struct icap *icap, const char *buffer,
 
 	buffer += bit_header.HeaderLength;
 
-	for (byte_read = 0; byte_read < bit_header.BitstreamLength;
-		byte_read += numCharsRead) {
-		numCharsRead = bit_header.BitstreamLength - byte_read;
-		if (numCharsRead > DMA_HWICAP_BITFILE_BUFFER_SIZE)
-			numCharsRead = DMA_HWICAP_BITFILE_BUFFER_SIZE;
+	/* Buffer is in kernel memory, feed the FIFO from it directly */
+	start = ktime_get();
+	err = bitstream_helper(icap, (u32 *)buffer,
+		bit_header.BitstreamLength / sizeof (u32));
+	if (err)
+		goto free_buffers;
 
-		err = bitstream_helper(icap, (u32 *)buffer,
-			numCharsRead / sizeof (u32));
-		if (err)
-			goto free_buffers;
-		buffer += numCharsRead;
+	err = wait_for_done(icap);
+	if (!err)
+		icap_report_throughput(icap, bit_header.BitstreamLength, start);
+
+free_buffers:
+	kfree(bit_header.DesignName);
+	kfree(bit_header.PartName);
+	kfree(bit_header.Date);
+	kfree(bit_header.Time);
+	return err;
+}
+
+/*
+ * Download a BITSTREAM_COMPRESSED section.  The zlib stream is inflated in
+ * chunks of ICAP_INFLATE_CHUNK_SIZE and each chunk is fed to the FIFO as
+ * soon as it is produced, the raw bitstream is never held in memory.
+ */
+static long icap_download_compressed(struct icap *icap, const char *buffer,
+	unsigned long length)
+{
+	long err = 0;
+	XHwIcap_Bit_Header bit_header = { 0 };
+	struct z_stream_s strm = { 0 };
+	u8 *chunk = NULL;
+	unsigned long fill = 0, left = 0, words;
+	bool header = false;
+	int ret = Z_OK;
+	ktime_t start;
+
+	BUG_ON(!buffer);
+	BUG_ON(!length);
+
+	strm.workspace = vmalloc(zlib_inflate_workspacesize());
+	chunk = vmalloc(ICAP_INFLATE_CHUNK_SIZE);
+	if (!strm.workspace || !chunk) {
+		err = -ENOMEM;
+		goto free_buffers;
+	}
+
+	if (zlib_inflateInit(&strm) != Z_OK) {
+		err = -EINVAL;
+		goto free_buffers;
+	}
+	strm.next_in = (const u8 *)buffer;
+	strm.avail_in = length;
+
+	start = ktime_get();
+	while (ret != Z_STREAM_END) {
+		strm.next_out = chunk + fill;
+		strm.avail_out = ICAP_INFLATE_CHUNK_SIZE - fill;
+		ret = zlib_inflate(&strm, Z_SYNC_FLUSH);
+		if ((ret != Z_OK && ret != Z_STREAM_END) ||
+			(ret == Z_OK && !strm.avail_in && strm.avail_out)) {
+			ICAP_ERR(icap, "corrupted compressed bitstream: %d", ret);
+			err = -EINVAL;
+			break;
+		}
+		fill = ICAP_INFLATE_CHUNK_SIZE - strm.avail_out;
+
+		/* Header is in the first chunk, drop it to keep words aligned */
+		if (!header) {
+			if (bitstream_parse_header(icap, chunk, fill,
+				&bit_header) ||
+				bit_header.HeaderLength > fill) {
+				err = -EINVAL;
+				break;
+			}
+			header = true;
+			left = bit_header.BitstreamLength;
+			fill -= bit_header.HeaderLength;
+			memmove(chunk, chunk + bit_header.HeaderLength, fill);
+		}
+
+		/* Partial word at the end of a chunk goes with the next one */
+		words = min(fill, left) / sizeof (u32);
+		if (words) {
+			err = bitstream_helper(icap, (u32 *)chunk, words);
+			if (err)
+				break;
+		}
+		left -= words * sizeof (u32);
+		fill -= words * sizeof (u32);
+		memmove(chunk, chunk + words * sizeof (u32), fill);
+		if (left < sizeof (u32))
+			break;
+	}
+	zlib_inflateEnd(&strm);
+	if (err)
+		goto free_buffers;
+
+	if (left >= sizeof (u32)) {
+		ICAP_ERR(icap, "compressed bitstream short by %lu bytes", left);
+		err = -EINVAL;
+		goto free_buffers;
 	}
 
 	err = wait_for_done(icap);
+	if (!err)
+		icap_report_throughput(icap, bit_header.BitstreamLength, start);
 
 free_buffers:
+	vfree(chunk);
+	vfree(strm.workspace);
 	kfree(bit_header.DesignName);
 	kfree(bit_header.PartName);
 	kfree(bit_header.Date);
@@ -1057,8 +1310,9 @@ static const struct axlf_section_header* get_axlf_section(
 	}
 
 	if (hdr) {
-		if((hdr->m_sectionOffset + hdr->m_sectionSize) >
-			top->m_header.m_length) {
+		if (hdr->m_sectionOffset > top->m_header.m_length ||
+			hdr->m_sectionSize >
+			top->m_header.m_length - hdr->m_sectionOffset) {
 			ICAP_INFO(icap, "found section is invalid");
 			hdr = NULL;
 		} else {
@@ -1072,6 +1326,35 @@ static const struct axlf_section_header* get_axlf_section(
 	return hdr;
 }
 
+/*
+ * Stash an MB firmware image unless it is identical, by crc32 and length, to
+ * the one stashed last.  Returns true if the image was stashed and the MB
+ * needs to be reset to run it.
+ */
+static bool icap_stash_mb_image(struct icap *icap, bool sche,
+	const char *image, u64 length)
+{
+	xdev_handle_t xdev = xocl_get_xdev(icap->icap_pdev);
+	u32 *crc = sche ? &icap->icap_sche_crc : &icap->icap_mgmt_crc;
+	u64 *len = sche ? &icap->icap_sche_length : &icap->icap_mgmt_length;
+	u32 c = crc32_le(~0, image, length);
+	int err;
+
+	if (*len == length && *crc == c) {
+		ICAP_INFO(icap, "mb %s binary unchanged", sche ? "sche" : "mgmt");
+		return false;
+	}
+
+	err = sche ? xocl_mb_load_sche_image(xdev, image, length) :
+		xocl_mb_load_mgmt_image(xdev, image, length);
+	if (!err) {
+		*crc = c;
+		*len = length;
+	}
+	ICAP_INFO(icap, "stashed mb %s binary", sche ? "sche" : "mgmt");
+	return true;
+}
+
 static int icap_download_boot_firmware(struct platform_device *pdev)
 {
 	struct icap *icap = platform_get_drvdata(pdev);
@@ -1140,10 +1423,10 @@ static int icap_download_boot_firmware(struct platform_device *pdev)
 			mbBinaryOffset = mbHeader->m_sectionOffset;
 			mbBinaryLength = mbHeader->m_sectionSize;
 			length = bin_obj_axlf->m_header.m_length;
-			xocl_mb_load_sche_image(xdev, fw->data + mbBinaryOffset,
-				mbBinaryLength);
-			ICAP_INFO(icap, "stashed mb sche binary");
-			load_mbs = true;
+			if (icap_stash_mb_image(icap, true,
+				(const char *)fw->data + mbBinaryOffset,
+				mbBinaryLength))
+				load_mbs = true;
 		}
 	}
 
@@ -1155,10 +1438,10 @@ static int icap_download_boot_firmware(struct platform_device *pdev)
 			mbBinaryOffset = mbHeader->m_sectionOffset;
 			mbBinaryLength = mbHeader->m_sectionSize;
 			length = bin_obj_axlf->m_header.m_length;
-			xocl_mb_load_mgmt_image(xdev, fw->data + mbBinaryOffset,
-				mbBinaryLength);
-			ICAP_INFO(icap, "stashed mb mgmt binary");
-			load_mbs = true;
+			if (icap_stash_mb_image(icap, false,
+				(const char *)fw->data + mbBinaryOffset,
+				mbBinaryLength))
+				load_mbs = true;
 		}
 	}
 
@@ -1311,33 +1594,25 @@ static long icap_download_clear_bitstream(struct icap *icap)
 }
 
 static long axlf_set_freqscaling(struct icap *icap, struct platform_device *pdev, 
-	const char __user *clk_buf, unsigned long length) 
+	const char *clk_buf, unsigned long length) 
 {
 	long err = 0;
-	char *buffer = NULL;
-	struct clock_freq_topology *freqs = NULL;
+	const struct clock_freq_topology *freqs = NULL;
 	int clock_type_count = 0;
 	int i = 0;
-	struct clock_freq *freq = NULL;
+	const struct clock_freq *freq = NULL;
 	int data_clk_count = 0;
 	int kernel_clk_count = 0;
 	int system_clk_count = 0;
 	unsigned short target_freqs[4] = {0};
 
-	buffer = kmalloc(length, GFP_KERNEL);
-	if (!buffer) {
-		ICAP_ERR(icap, "Unable to allocate memory for memory topology");
-		err = -ENOMEM;
-		goto free_buffers;
-	}
-
-	if (copy_from_user(buffer, clk_buf, length)) {
-		ICAP_ERR(icap, "Unable to copy from userspace for memory topology");
-		err = -EFAULT;
+	freqs = (const struct clock_freq_topology*)clk_buf;
+	if (length < offsetof(struct clock_freq_topology, m_clock_freq) ||
+		sizeof_sect(freqs, m_clock_freq) > length) {
+		ICAP_ERR(icap, "Invalid clock topology section");
+		err = -EINVAL;
 		goto free_buffers;
 	}
-
-	freqs = (struct clock_freq_topology*)buffer;
 	if(freqs->m_count > 4) {
 		err = -EDOM;
 		ICAP_ERR(icap, "More than 4 clocks found in clock topology");
@@ -1409,23 +1684,20 @@ static long axlf_set_freqscaling(struct icap *icap, struct platform_device *pdev
 		"sys_freq[0]: %d, sys_freq[1]: %d",
 		ARRAY_SIZE(target_freqs), target_freqs[0], target_freqs[1],
 		target_freqs[2], target_freqs[3]);
-	err = icap_ocl_set_freqscaling(pdev, 0, target_freqs, 4);
+	/* Caller holds icap_lock. */
+	err = set_freqs(icap, target_freqs, 4);
 
 free_buffers:
-	kfree(buffer);
 	return err;
 }
 
-static int icap_download_user(struct icap *icap, const char __user *bit_buf,
-	unsigned long length)
+static int icap_download_user(struct icap *icap, const char *bit_buf,
+	unsigned long length, bool compressed)
 {
 	long err = 0;
-	XHwIcap_Bit_Header bit_header = { 0 };
-	char *buffer = NULL;
-	unsigned numCharsRead = DMA_HWICAP_BITFILE_BUFFER_SIZE;
-	unsigned byte_read;
 
-	ICAP_INFO(icap, "downloading bitstream, length: %lu", length);
+	ICAP_INFO(icap, "downloading %sbitstream, length: %lu",
+		compressed ? "compressed " : "", length);
 
 	icap_freeze_axi_gate(icap);
 
@@ -1433,46 +1705,10 @@ static int icap_download_user(struct icap *icap, const char __user *bit_buf,
 	if (err)
 		goto free_buffers;
 
-	buffer = kmalloc(DMA_HWICAP_BITFILE_BUFFER_SIZE, GFP_KERNEL);
-	if (!buffer) {
-		err = -ENOMEM;
-		goto free_buffers;
-	}
-
-	if (copy_from_user(buffer, bit_buf, DMA_HWICAP_BITFILE_BUFFER_SIZE)) {
-		err = -EFAULT;
-		goto free_buffers;
-	}
-
-	if (bitstream_parse_header(icap, buffer,
-		DMA_HWICAP_BITFILE_BUFFER_SIZE, &bit_header)) {
-		err = -EINVAL;
-		goto free_buffers;
-	}
-	if ((bit_header.HeaderLength + bit_header.BitstreamLength) > length) {
-		err = -EINVAL;
-		goto free_buffers;
-	}
-
-	bit_buf += bit_header.HeaderLength;
-	for (byte_read = 0; byte_read < bit_header.BitstreamLength;
-		byte_read += numCharsRead) {
-		numCharsRead = bit_header.BitstreamLength - byte_read;
-		if (numCharsRead > DMA_HWICAP_BITFILE_BUFFER_SIZE)
-			numCharsRead = DMA_HWICAP_BITFILE_BUFFER_SIZE;
-		if (copy_from_user(buffer, bit_buf, numCharsRead)) {
-			err = -EFAULT;
-			goto free_buffers;
-		}
-
-		bit_buf += numCharsRead;
-		err = bitstream_helper(icap, (u32 *)buffer,
-			numCharsRead / sizeof (u32));
-		if (err)
-			goto free_buffers;
-	}
-
-	err = wait_for_done(icap);
+	if (compressed)
+		err = icap_download_compressed(icap, bit_buf, length);
+	else
+		err = icap_download(icap, bit_buf, length);
 	if (err)
 		goto free_buffers;
 
@@ -1488,20 +1724,98 @@ static int icap_download_user(struct icap *icap, const char __user *bit_buf,
 
 free_buffers:
 	icap_free_axi_gate(icap);
-	kfree(buffer);
-	kfree(bit_header.DesignName);
-	kfree(bit_header.PartName);
-	kfree(bit_header.Date);
-	kfree(bit_header.Time);
 	return err;
 }
 
-static int icap_download_bitstream_axlf(struct platform_device *pdev,
-	const void __user *u_xclbin)
+/*
+ * Bitstream on device is the requested one, no need to download.
+ * But, still need to reset CUs. Caller holds icap_lock.
+ */
+static void icap_refresh_bitstream(struct icap *icap)
+{
+	if (!icap_bitstream_in_use(icap, pid_nr(task_tgid(current)))) {
+		icap_freeze_axi_gate(icap);
+		msleep(50);
+		icap_free_axi_gate(icap);
+		msleep(50);
+	}
+	ICAP_INFO(icap, "bitstream already exists, skip downloading");
+}
+
+static struct icap_cached_xclbin *icap_cache_find(struct icap *icap,
+	const xuid_t *id)
+{
+	struct icap_cached_xclbin *entry;
+
+	list_for_each_entry(entry, &icap->icap_xclbin_cache, icx_list) {
+		if (uuid_equal(&entry->icx_xclbin->m_header.uuid, id))
+			return entry;
+	}
+	return NULL;
+}
+
+static void icap_cache_drop(struct icap *icap, struct icap_cached_xclbin *entry)
+{
+	list_del(&entry->icx_list);
+	icap->icap_xclbin_cache_num--;
+	vfree(entry->icx_xclbin);
+	kfree(entry);
+}
+
+/*
+ * Keep a downloaded xclbin around for later download by uuid. Takes over
+ * the xclbin buffer. Least recently loaded image is dropped when the cache
+ * is full. Caller holds icap_lock.
+ */
+static void icap_cache_xclbin(struct icap *icap, struct axlf *xclbin)
+{
+	struct icap_cached_xclbin *entry;
+
+	entry = icap_cache_find(icap, &xclbin->m_header.uuid);
+	if (entry)
+		icap_cache_drop(icap, entry);
+
+	while (icap->icap_xclbin_cache_num &&
+		icap->icap_xclbin_cache_num >= xclbin_cache_num) {
+		entry = list_last_entry(&icap->icap_xclbin_cache,
+			struct icap_cached_xclbin, icx_list);
+		icap_cache_drop(icap, entry);
+	}
+
+	if (xclbin_cache_num == 0) {
+		vfree(xclbin);
+		return;
+	}
+
+	entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry) {
+		vfree(xclbin);
+		return;
+	}
+	entry->icx_xclbin = xclbin;
+	list_add(&entry->icx_list, &icap->icap_xclbin_cache);
+	icap->icap_xclbin_cache_num++;
+	ICAP_INFO(icap, "cached xclbin %pUb, %u cached",
+		&xclbin->m_header.uuid, icap->icap_xclbin_cache_num);
+}
+
+static void icap_cache_fini(struct icap *icap)
+{
+	struct icap_cached_xclbin *entry, *n;
+
+	list_for_each_entry_safe(entry, n, &icap->icap_xclbin_cache, icx_list)
+		icap_cache_drop(icap, entry);
+}
+
+/*
+ * Download an xclbin which is entirely in kernel memory, sections have
+ * been checked against the xclbin length. Caller holds icap_lock.
+ */
+static int __icap_download_bitstream_axlf(struct platform_device *pdev,
+	const struct axlf *xclbin)
 {
 	struct icap *icap = platform_get_drvdata(pdev);
-	struct axlf bin_obj;
-	char __user *buffer;
+	const char *buffer;
 	long err = 0;
 	uint64_t primaryFirmwareOffset = 0;
 	uint64_t primaryFirmwareLength = 0;
@@ -1510,100 +1824,30 @@ static int icap_download_bitstream_axlf(struct platform_device *pdev,
 	const struct axlf_section_header* primaryHeader = NULL;
 	const struct axlf_section_header* secondaryHeader = NULL;
 	const struct axlf_section_header* ipLayout = NULL;
-	uint64_t copy_buffer_size = 0;
-	struct axlf* copy_buffer = NULL;
 	xdev_handle_t xdev = xocl_get_xdev(pdev);
 	struct xocl_dev_core *core = (struct xocl_dev_core *)xdev;
-	bool need_download;
-	struct ip_layout* layout = NULL;
+	const struct ip_layout* layout = NULL;
 	int i = 0, j = 0;
 	uint32_t dynamic_subdev_nums = core->dyna_subdevs_num;
 	struct xocl_subdev_info* subdev_info = NULL;
 	struct resource *res = NULL;
 	bool dna_check = false;
+	bool compressed = false;
 	uint32_t range = 0;
 	uint32_t base_addr[XOCL_SUBDEV_NUM][NUMS_OF_DYNA_IP_ADDR];
 	uint32_t nums_of_ip_section[XOCL_SUBDEV_NUM];
 	uint32_t sub_id;
 	uint32_t id, idx;
 
-	/* Can only be done from mgmt pf. */
-	if (!ICAP_PRIVILEGED(icap))
-		return -EPERM;
-
-	if (copy_from_user((void *)&bin_obj, u_xclbin, sizeof(struct axlf)))
-		return -EFAULT;
-	if (memcmp(bin_obj.m_magic, ICAP_XCLBIN_V2, sizeof(ICAP_XCLBIN_V2)))
-		return -EINVAL;
-
-	buffer = (char __user *)u_xclbin;
-	err = !access_ok(VERIFY_READ, buffer, bin_obj.m_header.m_length);
-	if (err) {
-		err = -EFAULT;
-		goto done;
-	}
-	/*
-	 * Copy headers in xclbin. Done before potentially skipping redownload
-	 * due to freq scaling requirements.
-	 */
-	copy_buffer_size = bin_obj.m_header.m_numSections *
-		sizeof(struct axlf_section_header) + sizeof(struct axlf);
-	ICAP_INFO(icap, "copy-in headers, num sections: %d, size: %llu",
-		bin_obj.m_header.m_numSections, copy_buffer_size);
-	copy_buffer = (struct axlf *)vmalloc(copy_buffer_size);
-	if(!copy_buffer) {
-		ICAP_ERR(icap, "unable to alloc copy buffer for headers");
-		return -ENOMEM;
-	}
-	if (copy_from_user((void *)copy_buffer, u_xclbin, copy_buffer_size)) {
-		err = -EFAULT;
-		goto done;
-	}
-
-	/* Match the xclbin with the hardware. */
-	if (!xocl_verify_timestamp(xdev,
-		bin_obj.m_header.m_featureRomTimeStamp)) {
-		ICAP_ERR(icap, "timestamp of ROM did not match Xclbin\n");
-		xocl_sysfs_error(xdev, "timestamp of ROM did not match Xclbin\n");
-		return -EINVAL;
-	}
-
-	ICAP_INFO(icap,
-		"incoming xclbin ID: %016llx, on device xclbin ID:%016llx",
-		bin_obj.m_uniqueId, icap->icap_bitstream_id);
-
-	mutex_lock(&icap->icap_lock);
-
-	need_download = (icap->icap_bitstream_id != bin_obj.m_uniqueId);
-
-	if(!need_download) {
-		/*
-		 * No need to download, if xclbin exists already.
-		 * But, still need to reset CUs.
-		 */
-		if (!icap_bitstream_in_use(icap, pid_nr(task_tgid(current)))) {
-			icap_freeze_axi_gate(icap);
-			msleep(50);
-			icap_free_axi_gate(icap);
-			msleep(50);
-		}
-		ICAP_INFO(icap, "bitstream already exists, skip downloading");
-	}
-
-	mutex_unlock(&icap->icap_lock);
-
-	if(!need_download)
-		return 0;
-
 	/*
 	 * Find sections in xclbin.
 	 */
 	ICAP_INFO(icap, "finding CLOCK_FREQ_TOPOLOGY section");
-	primaryHeader = get_axlf_section(icap, copy_buffer, CLOCK_FREQ_TOPOLOGY);
+	primaryHeader = get_axlf_section(icap, xclbin, CLOCK_FREQ_TOPOLOGY);
 	if (primaryHeader != NULL) {
 		primaryFirmwareOffset = primaryHeader->m_sectionOffset;
 		primaryFirmwareLength = primaryHeader->m_sectionSize;
-		buffer = (char __user *)u_xclbin;
+		buffer = (const char *)xclbin;
 		buffer += primaryFirmwareOffset;
 		err = axlf_set_freqscaling(icap, pdev, buffer, primaryFirmwareLength);
 		if (err)
@@ -1614,31 +1858,39 @@ static int icap_download_bitstream_axlf(struct platform_device *pdev,
 	}
 
 	ICAP_INFO(icap, "finding ip layout sections");
-	ipLayout = get_axlf_section(icap, copy_buffer, IP_LAYOUT);
+	ipLayout = get_axlf_section(icap, xclbin, IP_LAYOUT);
 	if (ipLayout == NULL) {
 		err = -EINVAL;
 		goto done;
 	}
 
-	layout = vmalloc(ipLayout->m_sectionSize);
-	if(layout == NULL)
-		goto done;
-	err = copy_from_user(layout, (char __user *)u_xclbin+ipLayout->m_sectionOffset, ipLayout->m_sectionSize);
-	if (sizeof_sect(layout, m_ip_data) > ipLayout->m_sectionSize) {
+	layout = (const struct ip_layout *)
+		((const char *)xclbin + ipLayout->m_sectionOffset);
+	if (ipLayout->m_sectionSize < offsetof(struct ip_layout, m_ip_data) ||
+		sizeof_sect(layout, m_ip_data) > ipLayout->m_sectionSize) {
 		err = -EINVAL;
 		goto done;
 	}
   
 	ICAP_INFO(icap, "finding bitstream sections");
-	primaryHeader = get_axlf_section(icap, copy_buffer, BITSTREAM);
+	primaryHeader = get_axlf_section(icap, xclbin, BITSTREAM);
+	if (primaryHeader == NULL) {
+		primaryHeader = get_axlf_section(icap, xclbin,
+			BITSTREAM_COMPRESSED);
+		compressed = true;
+	}
 	if (primaryHeader == NULL) {
 		err = -EINVAL;
 		goto done;
 	}
 	primaryFirmwareOffset = primaryHeader->m_sectionOffset;
 	primaryFirmwareLength = primaryHeader->m_sectionSize;
+	if (primaryFirmwareLength == 0) {
+		err = -EINVAL;
+		goto done;
+	}
 
-	secondaryHeader = get_axlf_section(icap, copy_buffer,
+	secondaryHeader = get_axlf_section(icap, xclbin,
 		CLEARING_BITSTREAM);
 	if(secondaryHeader) {
 		if (XOCL_PL_TO_PCI_DEV(pdev)->device == 0x7138) {
@@ -1652,9 +1904,6 @@ static int icap_download_bitstream_axlf(struct platform_device *pdev,
 		}
 	}
 
-
-	mutex_lock(&icap->icap_lock);
-
 	if (icap_bitstream_in_use(icap, pid_nr(task_tgid(current)))) {
 		ICAP_ERR(icap, "bitstream is locked, can't download new one");
 		err = -EBUSY;
@@ -1664,9 +1913,10 @@ static int icap_download_bitstream_axlf(struct platform_device *pdev,
 	icap->icap_bitstream_id = 0;
 	uuid_copy(&icap->icap_bitstream_uuid, &uuid_null);
 
-	buffer = (char __user *)u_xclbin;
+	buffer = (const char *)xclbin;
 	buffer += primaryFirmwareOffset;
-	err = icap_download_user(icap, buffer, primaryFirmwareLength);
+	err = icap_download_user(icap, buffer, primaryFirmwareLength,
+		compressed);
 	if (err)
 		goto done;
 
@@ -1764,7 +2014,7 @@ static int icap_download_bitstream_axlf(struct platform_device *pdev,
 		}
 	}
 
-	buffer = (char __user *)u_xclbin;
+	buffer = (const char *)xclbin;
 	buffer += secondaryFirmwareOffset;
 	err = icap_setup_clear_bitstream(icap, buffer, secondaryFirmwareLength);
 	if (err)
@@ -1776,14 +2026,8 @@ static int icap_download_bitstream_axlf(struct platform_device *pdev,
 		goto dna_check_failed;
 
 	/* Remember "this" bitstream, so avoid redownload the next time. */
-	icap->icap_bitstream_id = bin_obj.m_uniqueId;
-	if (!uuid_is_null(&bin_obj.m_header.uuid)) {
-		uuid_copy(&icap->icap_bitstream_uuid, &bin_obj.m_header.uuid);
-	} else {
-		// Legacy xclbin, convert legacy id to new id
-		memcpy(&icap->icap_bitstream_uuid,
-			&bin_obj.m_header.m_timeStamp, 8);
-	}
+	icap->icap_bitstream_id = xclbin->m_uniqueId;
+	uuid_copy(&icap->icap_bitstream_uuid, &xclbin->m_header.uuid);
 	goto done;
 
 dna_check_failed:	
@@ -1799,10 +2043,141 @@ add_subdev_failed:
 done:
 	kfree(res);
 	kfree(subdev_info);
-	vfree(layout);
 	ICAP_INFO(icap, "%s err: %ld", __FUNCTION__, err);
+	return err;
+}
+
+static int icap_download_bitstream_axlf(struct platform_device *pdev,
+	const void __user *u_xclbin)
+{
+	struct icap *icap = platform_get_drvdata(pdev);
+	struct axlf bin_obj;
+	struct axlf *xclbin = NULL;
+	long err = 0;
+	uint64_t copy_buffer_size = 0;
+	xdev_handle_t xdev = xocl_get_xdev(pdev);
+	bool need_download;
+
+	/* Can only be done from mgmt pf. */
+	if (!ICAP_PRIVILEGED(icap))
+		return -EPERM;
+
+	if (copy_from_user((void *)&bin_obj, u_xclbin, sizeof(struct axlf)))
+		return -EFAULT;
+	if (memcmp(bin_obj.m_magic, ICAP_XCLBIN_V2, sizeof(ICAP_XCLBIN_V2)))
+		return -EINVAL;
+
+	copy_buffer_size = bin_obj.m_header.m_numSections *
+		sizeof(struct axlf_section_header) + sizeof(struct axlf);
+	if (copy_buffer_size > bin_obj.m_header.m_length)
+		return -EINVAL;
+
+	if (!access_ok(VERIFY_READ, u_xclbin, bin_obj.m_header.m_length))
+		return -EFAULT;
+
+	/* Match the xclbin with the hardware. */
+	if (!xocl_verify_timestamp(xdev,
+		bin_obj.m_header.m_featureRomTimeStamp)) {
+		ICAP_ERR(icap, "timestamp of ROM did not match Xclbin\n");
+		xocl_sysfs_error(xdev, "timestamp of ROM did not match Xclbin\n");
+		return -EINVAL;
+	}
+
+	ICAP_INFO(icap,
+		"incoming xclbin ID: %016llx, on device xclbin ID:%016llx",
+		bin_obj.m_uniqueId, icap->icap_bitstream_id);
+
+	if (uuid_is_null(&bin_obj.m_header.uuid)) {
+		// Legacy xclbin, convert legacy id to new id
+		memcpy(&bin_obj.m_header.uuid, &bin_obj.m_header.m_timeStamp, 8);
+	}
+
+	mutex_lock(&icap->icap_lock);
+
+	/*
+	 * Same bitstream is identified by uuid, the unique id alone is not
+	 * guaranteed to change between builds. Matching bitstream skips
+	 * download, clock scaling and MIG calibration, the user pf still
+	 * refreshes its metadata through READ_AXLF.
+	 */
+	need_download = (icap->icap_bitstream_id != bin_obj.m_uniqueId) ||
+		!uuid_equal(&icap->icap_bitstream_uuid, &bin_obj.m_header.uuid);
+
+	if(!need_download)
+		icap_refresh_bitstream(icap);
+
+	mutex_unlock(&icap->icap_lock);
+
+	if(!need_download)
+		return 0;
+
+	/*
+	 * Copy in the whole xclbin once, all sections are then consumed from
+	 * kernel memory and the image can be cached for download by uuid.
+	 */
+	ICAP_INFO(icap, "copy-in xclbin, num sections: %d, size: %llu",
+		bin_obj.m_header.m_numSections, bin_obj.m_header.m_length);
+	xclbin = vmalloc(bin_obj.m_header.m_length);
+	if (!xclbin) {
+		ICAP_ERR(icap, "unable to alloc buffer for xclbin");
+		return -ENOMEM;
+	}
+	if (copy_from_user(xclbin, u_xclbin, bin_obj.m_header.m_length)) {
+		vfree(xclbin);
+		return -EFAULT;
+	}
+	/* Header may have changed after it was checked, use the checked one. */
+	memcpy(&xclbin->m_header, &bin_obj.m_header, sizeof(bin_obj.m_header));
+
+	mutex_lock(&icap->icap_lock);
+	err = __icap_download_bitstream_axlf(pdev, xclbin);
+	if (!err)
+		icap_cache_xclbin(icap, xclbin);
+	else
+		vfree(xclbin);
 	mutex_unlock(&icap->icap_lock);
-	vfree(copy_buffer);
+
+	return err;
+}
+
+/*
+ * Download an xclbin previously downloaded through this device, without
+ * copying it in from user space again. Returns -ENOENT if the xclbin is
+ * not cached.
+ */
+static int icap_download_bitstream_uuid(struct platform_device *pdev,
+	const xuid_t *id)
+{
+	struct icap *icap = platform_get_drvdata(pdev);
+	struct icap_cached_xclbin *entry;
+	int err = 0;
+
+	/* Can only be done from mgmt pf. */
+	if (!ICAP_PRIVILEGED(icap))
+		return -EPERM;
+
+	if (uuid_is_null(id))
+		return -EINVAL;
+
+	mutex_lock(&icap->icap_lock);
+
+	entry = icap_cache_find(icap, id);
+	if (!entry) {
+		err = -ENOENT;
+	} else if (icap->icap_bitstream_id == entry->icx_xclbin->m_uniqueId &&
+		uuid_equal(&icap->icap_bitstream_uuid, id)) {
+		icap_refresh_bitstream(icap);
+	} else {
+		err = __icap_download_bitstream_axlf(pdev, entry->icx_xclbin);
+	}
+
+	/* Most recently loaded goes first. */
+	if (entry)
+		list_move(&entry->icx_list, &icap->icap_xclbin_cache);
+
+	mutex_unlock(&icap->icap_lock);
+
+	ICAP_INFO(icap, "download cached xclbin %pUb, err: %d", id, err);
 	return err;
 }
 
@@ -1959,6 +2334,7 @@ static struct xocl_icap_funcs icap_ops = {
 	.reset_bitstream = icap_reset_bitstream,
 	.download_boot_firmware = icap_download_boot_firmware,
 	.download_bitstream_axlf = icap_download_bitstream_axlf,
+	.download_bitstream_uuid = icap_download_bitstream_uuid,
 	.ocl_set_freq = icap_ocl_set_freqscaling,
 	.ocl_get_freq = icap_ocl_get_freqscaling,
 	.ocl_update_clock_freq_topology = icap_ocl_update_clock_freq_topology,
@@ -2003,9 +2379,36 @@ static ssize_t clock_freqs_show(struct device *dev,
 }
 static DEVICE_ATTR_RO(clock_freqs);
 
+/* "<clock> <MHz> <usecs>" for every frequency a clock has run at */
+static ssize_t clock_residency_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct icap *icap = platform_get_drvdata(to_platform_device(dev));
+	ssize_t cnt = 0;
+	int i, step;
+
+	mutex_lock(&icap->icap_lock);
+	icap_account_residency(icap);
+	for (i = 0; icap->icap_residency && i < ICAP_MAX_NUM_CLOCKS; i++) {
+		for (step = 0; step < ICAP_NUM_FREQ_STEPS; step++) {
+			u64 us = ICAP_RESIDENCY(icap, i, step);
+
+			if (us)
+				cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt,
+					"%d %u %llu\n", i,
+					frequency_table[step].ocl, us);
+		}
+	}
+	mutex_unlock(&icap->icap_lock);
+
+	return cnt;
+}
+static DEVICE_ATTR_RO(clock_residency);
+
 static struct attribute *icap_attrs[] = {
 	&dev_attr_clock_freq_topology.attr,
 	&dev_attr_clock_freqs.attr,
+	&dev_attr_clock_residency.attr,
 	NULL,
 };
 
@@ -2020,6 +2423,7 @@ static int icap_remove(struct platform_device *pdev)
 
 	BUG_ON(icap == NULL);
 
+	cancel_delayed_work_sync(&icap->icap_boost_work);
 	del_all_users(icap);
 	xocl_subdev_register(pdev, XOCL_SUBDEV_ICAP, NULL);
 
@@ -2030,6 +2434,8 @@ static int icap_remove(struct platform_device *pdev)
 		iounmap(icap->icap_clock_bases[i]);
 	free_clear_bitstream(icap);
 	free_clock_freq_topology(icap);
+	icap_cache_fini(icap);
+	kfree(icap->icap_residency);
 
 	sysfs_remove_group(&pdev->dev.kobj, &icap_attr_group);
 
@@ -2055,6 +2461,8 @@ static int icap_probe(struct platform_device *pdev)
 	icap->icap_pdev = pdev;
 	mutex_init(&icap->icap_lock);
 	INIT_LIST_HEAD(&icap->icap_bitstream_users);
+	INIT_LIST_HEAD(&icap->icap_xclbin_cache);
+	INIT_DELAYED_WORK(&icap->icap_boost_work, icap_boost_work);
 
 	for (reg_grp = 0; reg_grp < ICAP_MAX_REG_GROUPS; reg_grp++) {
 		switch (reg_grp) {
@@ -2110,6 +2518,15 @@ static int icap_probe(struct platform_device *pdev)
 		goto failed;
 	}
 
+	if (ICAP_PRIVILEGED(icap)) {
+		icap->icap_residency = kcalloc(ICAP_MAX_NUM_CLOCKS *
+			ICAP_NUM_FREQ_STEPS, sizeof(u64), GFP_KERNEL);
+		icap->icap_residency_stamp = ktime_get();
+		if (clock_boost_ms)
+			schedule_delayed_work(&icap->icap_boost_work,
+				msecs_to_jiffies(clock_boost_ms));
+	}
+
 	ICAP_INFO(icap, "successfully initialized");
 	xocl_subdev_register(pdev, XOCL_SUBDEV_ICAP, &icap_ops);
 	return 0;
@@ -747,31 +747,40 @@ static int chan_pkt2msg(struct mailbox_channel *ch)
 	return 0;
 }
 
+/*
+ * Check if a packet is ready for reading.
+ */
+static bool chan_rx_ready(struct mailbox_channel *ch)
+{
+	struct mailbox *mbx = ch->mbc_parent;
+	u32 st = mailbox_reg_rd(mbx, &mbx->mbx_regs->mbr_status);
+
+	if (st == 0xffffffff) {
+		/* Device is still being reset. */
+		return false;
+	} else if (test_bit(MBXCS_BIT_POLL_MODE, &ch->mbc_state)) {
+		return ((st & STATUS_EMPTY) == 0);
+	}
+	return ((st & STATUS_RTA) != 0);
+}
+
 /*
  * Worker for RX channel.
+ *
+ * Drain all packets already sitting in the RX FIFO before going back to
+ * sleep, instead of taking one packet per interrupt or timer tick.
  */
 static void chan_do_rx(struct mailbox_channel *ch)
 {
 	struct mailbox *mbx = ch->mbc_parent;
 	struct mailbox_pkt *pkt = &ch->mbc_packet;
-	bool needs_read = false;
 	u64 id = 0;
 	bool eom;
 	int err;
 	u32 type;
-	u32 st = mailbox_reg_rd(mbx, &mbx->mbx_regs->mbr_status);
 
-	/* Check if a packet is ready for reading. */
-	if (st == 0xffffffff) {
-		/* Device is still being reset. */
-		needs_read = false;
-	} else if (test_bit(MBXCS_BIT_POLL_MODE, &ch->mbc_state)) {
-		needs_read = ((st & STATUS_EMPTY) == 0);
-	} else {
-		needs_read = ((st & STATUS_RTA) != 0);
-	}
-
-	if (needs_read) {
+	while (!test_bit(MBXCS_BIT_STOP, &ch->mbc_state) &&
+		chan_rx_ready(ch)) {
 		chan_recv_pkt(ch);
 		type = pkt->hdr.type & PKT_TYPE_MASK;
 		eom = ((pkt->hdr.type & PKT_TYPE_MSG_END) != 0);
@@ -781,7 +790,7 @@ static void chan_do_rx(struct mailbox_channel *ch)
 			(void) memcpy(&mbx->mbx_tst_pkt, &ch->mbc_packet,
 				sizeof(struct mailbox_pkt));
 			reset_pkt(pkt);
-			return;
+			continue;
 		case PKT_MSG_START:
 			if (ch->mbc_cur_msg) {
 				MBX_ERR(mbx, "received partial msg\n");
@@ -814,7 +823,7 @@ static void chan_do_rx(struct mailbox_channel *ch)
 		default:
 			MBX_ERR(mbx, "invalid mailbox pkt type\n");
 			reset_pkt(pkt);
-			return;
+			continue;
 		}
 
 		if (valid_pkt(pkt)) {
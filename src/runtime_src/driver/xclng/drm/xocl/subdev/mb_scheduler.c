@@ -19,7 +19,10 @@
 #include <linux/list.h>
 #include <linux/eventfd.h>
 #include <linux/kthread.h>
+#include <linux/hrtimer.h>
+#include <linux/slab.h>
 #include <ert.h>
+#include <sched_core.h>
 #include "../xocl_drv.h"
 #include "../userpf/common.h"
 
@@ -59,6 +62,50 @@
 # define SCHED_DEBUG_PACKET(packet,size)
 #endif
 
+static unsigned int penguin_cu_intr = 0;
+module_param(penguin_cu_intr, uint, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(penguin_cu_intr,
+	"Use CU interrupts for command completion in penguin mode when CUs support interrupts (0 = poll CUs, default; 1 = interrupts)");
+
+static unsigned int cu_intr_coalesce_count = 1;
+module_param(cu_intr_coalesce_count, uint, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(cu_intr_coalesce_count,
+	"Number of CU interrupts coalesced before scheduler is woken in penguin mode (1 = default)");
+
+static unsigned int cu_intr_coalesce_us = 0;
+module_param(cu_intr_coalesce_us, uint, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(cu_intr_coalesce_us,
+	"Maximum time (in usec) CU interrupts are coalesced in penguin mode (0 = no coalescing, default)");
+
+static unsigned int cu_policy = 1;
+module_param(cu_policy, uint, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(cu_policy,
+	"CU selection in penguin mode (0 = first free; 1 = round robin, default; 2 = least recently used; 3 = memory bank affine)");
+
+static unsigned int cu_queue_limit = 0;
+module_param(cu_queue_limit, uint, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(cu_queue_limit,
+	"Max number of admitted kernel commands waiting to start per CU, so commands for busy CUs do not hold back commands for other CUs (0 = no limit, default)");
+
+static unsigned int cmd_timeout_ms = 0;
+module_param(cmd_timeout_ms, uint, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(cmd_timeout_ms,
+	"Default deadline (in msec) from start to done of a kernel command before it is aborted (0 = no deadline, default)");
+
+/* CU selection policies, see get_free_cu() */
+#define CU_POLICY_FIRST   0
+#define CU_POLICY_RR      1
+#define CU_POLICY_LRU     2
+#define CU_POLICY_AFFINE  3
+
+/* HLS CU control register offsets */
+#define CU_GIE_ADDR  0x4
+#define CU_IER_ADDR  0x8
+#define CU_ISR_ADDR  0xC
+
+/* Log2 buckets of per CU start to done latency in usec, see cu_latency_bucket() */
+#define CU_LATENCY_BUCKETS 24
+
 /* Forward declaration */
 struct exec_core;
 struct sched_ops;
@@ -71,6 +118,7 @@ static bool queued_to_running(struct xocl_cmd *xcmd);
  *
  * @ctx_list: Context list populated with device context
  * @poll_wait_queue: Wait queue for device polling
+ * @poll_count: Number of completions notified to host, clients consume them in poll
  * @scheduler: Command queue scheduler
  * @submitted_cmds: Tracking of command submitted for execution on this device
  * @num_slots: Number of command queue slots
@@ -90,6 +138,26 @@ static bool queued_to_running(struct xocl_cmd *xcmd);
  * @sr1: If set, then status register [32..63] is pending with completed commands (ERT only).
  * @sr2: If set, then status register [64..95] is pending with completed commands (ERT only).
  * @sr3: If set, then status register [96..127] is pending with completed commands (ERT only).
+ * @cu_isr: If set, then CU interrupts signal command completion (penguin only).
+ * @cu_intr_pending: Bitmap of CUs that interrupted, set by ISR, cleared by scheduler (penguin only).
+ * @cu_intr_count: Number of CU interrupts coalesced since scheduler was last woken (penguin only).
+ * @cu_intr_timer: Wakes scheduler when coalescing window expires (penguin only).
+ * @cu_policy: CU selection policy (penguin only).
+ * @cu_next: CU idx where round robin selection starts (penguin only).
+ * @cu_stamp: Counter for CU use stamps (penguin only).
+ * @cu_last_used: Stamp of last use of each CU (penguin only).
+ * @cu_banks: Bitmap of memory banks connected to each CU (penguin only).
+ * @ert_cycles: If set, then ERT reports CU configure cycles per command (ERT only).
+ * @ert_cycles_cmds: Number of commands with reported configure cycles (ERT only).
+ * @ert_cycles_total: Accumulated reported configure cycles (ERT only).
+ * @ert_cycles_max: Max reported configure cycles of a command (ERT only).
+ * @abort_slots: Bitmap of slots occupied by abort commands sent to ERT (ERT only).
+ * @cu_timeout_ms: Per CU deadline overriding cmd_timeout_ms, 0 if none.  Set through sysfs, not reset.
+ * @cu_timeouts: Number of commands aborted for exceeding their deadline per CU.
+ * @cu_latency: Log2 histogram of start to done latency per CU.
+ * @cu_running: Number of commands running per CU.
+ * @cu_usage: Number of completed commands per CU.
+ * @cu_busy_ns: Accumulated start to done time of completed commands per CU.
  * @ops: Scheduler operations vtable
  */
 struct exec_core {
@@ -100,6 +168,7 @@ struct exec_core {
 	u32			  intr_num;
 
 	wait_queue_head_t          poll_wait_queue;
+	atomic_t                   poll_count;
 
 	struct xocl_sched          *scheduler;
 
@@ -130,6 +199,40 @@ struct exec_core {
 	atomic_t                   sr2;
 	atomic_t                   sr3;
 
+	/* CU interrupts in penguin mode.  Pending bits written by ISR,
+	   cleared by scheduler */
+	unsigned int               cu_isr;
+	unsigned long              cu_intr_pending[BITS_TO_LONGS(MAX_CUS)];
+	atomic_t                   cu_intr_count;
+	struct hrtimer             cu_intr_timer;
+
+	/* CU selection in penguin mode */
+	unsigned int               cu_policy;
+	unsigned int               cu_next;
+	u64                        cu_stamp;
+	u64                        cu_last_used[MAX_CUS];
+	u64                        cu_banks[MAX_CUS];
+
+	/* CU configure cycles reported by ERT */
+	unsigned int               ert_cycles;
+	u64                        ert_cycles_cmds;
+	u64                        ert_cycles_total;
+	u32                        ert_cycles_max;
+
+	/* Command deadlines and latency per CU.  In ERT mode the CU
+	   that runs a command is not known to host, the command is
+	   accounted to the first CU in its CU mask, see cmd_first_cu() */
+	u32                        abort_slots[MAX_U32_SLOT_MASKS];
+	u32                        cu_timeout_ms[MAX_CUS];
+	u32                        cu_timeouts[MAX_CUS];
+	u32                        cu_latency[MAX_CUS][CU_LATENCY_BUCKETS];
+
+	/* CU utilization, sampled through sysfs by 'xbutil top'.  CUs
+	   are accounted like for latency above */
+	u32                        cu_running[MAX_CUS];
+	u64                        cu_usage[MAX_CUS];
+	u64                        cu_busy_ns[MAX_CUS];
+
 	/* Operations for dynamic indirection dependt on MB or kernel scheduler */
 	struct sched_ops	   *ops;
 };
@@ -169,19 +272,43 @@ dev_get_xdev(struct device *dev)
 /**
  * struct xocl_sched: scheduler for xocl_cmd objects
  *
+ * There is one scheduler per exec core (device), so that command dispatch
+ * and polling on one device does not delay other devices.
+ *
  * @scheduler_thread: thread associated with this scheduler
- * @use_count: use count for this scheduler
  * @wait_queue: conditional wait queue for scheduler thread
  * @error: set to 1 to indicate scheduler error
  * @stop: set to 1 to indicate scheduler should stop
  * @command_queue: list of command objects managed by scheduler
  * @intc: boolean flag set when there is a pending interrupt for command completion
  * @poll: number of running commands in polling mode
+ * @cmd_id: id of next command object
+ * @pending_cmds: populated from user space with new commands for buffer objects
+ * @pending_cmds_mutex: protects @pending_cmds
+ * @num_pending: number of pending commands
+ * @exec: execution core (device) scheduled by this scheduler
+ * @clients: clients with commands waiting for admission to @command_queue
+ * @clients_mutex: protects @clients and the client queues linked to it
+ * @num_queued: number of admitted commands in @command_queue not yet started
+ * @cu_queued: number of admitted kernel commands not yet started accounted per CU
+ * @admit_stalled: set when client commands remain but all are held back per
+ *  cu_queue_limit, cleared when an accounted command starts or a client aborts
+ * @num_running: number of commands submitted to device and not yet retired
+ * @next_deadline_ns: earliest deadline of a running command, 0 if none
+ *
+ * Commands are admitted from per client priority queues to @command_queue
+ * in weighted round robin order, a client gets up to 1<<priority commands
+ * admitted per turn.  Admission stops when @num_queued reaches the number
+ * of command queue slots, so that a client with many outstanding commands
+ * cannot starve other clients.  With cu_queue_limit set, a kernel command
+ * also stays in its client queue while all its CUs have cu_queue_limit
+ * commands waiting to start, and later commands of the client for other
+ * CUs are admitted ahead of it.  Tenants using disjoint CUs, e.g. sub
+ * devices, then do not queue behind each other.
  */
 struct xocl_sched
 {
         struct task_struct        *scheduler_thread;
-        unsigned int               use_count;
 
         wait_queue_head_t          wait_queue;
         unsigned int               error;
@@ -190,9 +317,23 @@ struct xocl_sched
         struct list_head           command_queue;
         atomic_t                   intc; /* pending interrupt shared with isr */
         unsigned int               poll; /* number of cmds to poll */
-};
 
-static struct xocl_sched global_scheduler0;
+        atomic_long_t              cmd_id;
+
+        struct list_head           pending_cmds;
+        struct mutex               pending_cmds_mutex;
+        atomic_t                   num_pending;
+
+        struct exec_core          *exec;
+        struct list_head           clients;
+        struct mutex               clients_mutex;
+        unsigned int               num_queued;
+        unsigned int               cu_queued[MAX_CUS];
+        unsigned int               admit_stalled;
+
+        unsigned int               num_running;
+        u64                        next_deadline_ns;
+};
 
 /**
  * Command data used by scheduler
@@ -205,11 +346,18 @@ static struct xocl_sched global_scheduler0;
  * @state: state of command object per scheduling
  * @id: unique id for an active command object
  * @cu_idx: index of CU executing this cmd object; used in penguin mode only
+ * @queued_cu: CU this cmd is accounted to while admitted and not started, -1 if none
  * @slot_idx: command queue index of this command object
  * @wait_count: number of commands that must trigger this command before it can start
  * @chain_count: number of commands that this command must trigger when it completes
  * @chain: list of commands to trigger upon completion; maximum chain depth is 8
  * @deps: list of commands this object depends on, converted to chain when command is queued
+ * @submit_ns: time of submission from user space, used for client wait time statistics
+ * @start_ns: time of submission to device, used for CU latency statistics
+ * @deadline_ns: time when a running command is aborted, 0 if no deadline
+ * @aborted: set when command has exceeded its deadline and is being aborted
+ * @mem_banks: bitmap of memory banks referenced by regmap, used in CU selection
+ * @mem_banks_valid: set when @mem_banks has been computed
  * @packet: mapped ert packet object from user space
  */
 struct xocl_cmd
@@ -222,6 +370,7 @@ struct xocl_cmd
 	enum ert_cmd_state state;
 	unsigned long id;
 	int cu_idx; /* running cu, initialized to -1 */
+	int queued_cu;
 	int slot_idx;
 
 	/* dependency handling */
@@ -232,6 +381,14 @@ struct xocl_cmd
 		struct drm_xocl_bo *deps[8];
 	};
 
+	u64 submit_ns;
+	u64 start_ns;
+	u64 deadline_ns;
+	bool aborted;
+
+	u64 mem_banks;
+	bool mem_banks_valid;
+
 	/* The actual cmd object representation */
 	struct ert_packet *packet;
 };
@@ -286,7 +443,7 @@ type(struct xocl_cmd* xcmd)
 static inline u32
 payload_size(struct xocl_cmd *xcmd)
 {
-	return xcmd->packet->count;
+	return sched_payload_size(xcmd->packet->header);
 }
 
 /**
@@ -310,11 +467,7 @@ packet_size(struct xocl_cmd *xcmd)
 static inline u32
 cu_masks(struct xocl_cmd *xcmd)
 {
-	struct ert_start_kernel_cmd *sk;
-	if (opcode(xcmd)!=ERT_START_KERNEL)
-		return 0;
-	sk = (struct ert_start_kernel_cmd *)xcmd->packet;
-	return 1 + sk->extra_cu_masks;
+	return sched_cu_masks(xcmd->packet->header);
 }
 
 /**
@@ -326,7 +479,7 @@ cu_masks(struct xocl_cmd *xcmd)
 static inline u32
 regmap_size(struct xocl_cmd* xcmd)
 {
-	return payload_size(xcmd) - cu_masks(xcmd);
+	return sched_regmap_size(xcmd->packet->header);
 }
 
 /**
@@ -378,53 +531,30 @@ update_cmd_state(struct xocl_cmd *xcmd)
 	return xcmd->state;
 }
 
-/**
- * List of free xocl_cmd objects.
- *
- * @free_cmds: populated with recycled xocl_cmd objects
- * @cmd_mutex: mutex lock for cmd_list
- *
- * Command objects are recycled for later use and only freed when kernel
- * module is unloaded.
- */
-static LIST_HEAD(free_cmds);
-static DEFINE_MUTEX(free_cmds_mutex);
-
-/**
- * List of new pending xocl_cmd objects
- *
- * @pending_cmds: populated from user space with new commands for buffer objects
- * @num_pending: number of pending commands
- *
- * Scheduler copies pending commands to its private queue when necessary
- */
-static LIST_HEAD(pending_cmds);
-static DEFINE_MUTEX(pending_cmds_mutex);
-static atomic_t num_pending = ATOMIC_INIT(0);
+/* slab cache of command objects shared by all schedulers */
+static struct kmem_cache *xocl_cmd_cache;
 
 /**
  * get_free_xocl_cmd() - Get a free command object
  *
- * Get from free/recycled list or allocate a new command if necessary.
+ * @xs: Scheduler owning the command object
+ *
+ * Command objects are allocated from a slab cache, which recycles freed
+ * objects through per CPU free lists without taking a lock in the common
+ * case.
  *
  * Return: Free command object
  */
 static struct xocl_cmd*
-get_free_xocl_cmd(void)
+get_free_xocl_cmd(struct xocl_sched *xs)
 {
 	struct xocl_cmd* cmd;
-	static unsigned long count=0;
 	SCHED_DEBUG("-> get_free_xocl_cmd\n");
-	mutex_lock(&free_cmds_mutex);
-	cmd=list_first_entry_or_null(&free_cmds,struct xocl_cmd,list);
-	if (cmd)
-		list_del(&cmd->list);
-        mutex_unlock(&free_cmds_mutex);
-	if (!cmd)
-		cmd = kmalloc(sizeof(struct xocl_cmd),GFP_KERNEL);
+	cmd = kmem_cache_alloc(xocl_cmd_cache,GFP_KERNEL);
 	if (!cmd)
 		return ERR_PTR(-ENOMEM);
-	cmd->id = count++;
+	cmd->id = atomic_long_inc_return(&xs->cmd_id) - 1;
+	cmd->xs = xs;
 	SCHED_DEBUGF("<- get_free_xocl_cmd %lu %p\n",cmd->id,cmd);
 	return cmd;
 }
@@ -446,14 +576,17 @@ add_cmd(struct exec_core *exec, struct client_ctx* client, struct drm_xocl_bo* b
 {
 	struct platform_device *pdev=exec->pdev;
 	struct xocl_dev *xdev = xocl_get_xdev(pdev);
-	struct xocl_cmd *xcmd = get_free_xocl_cmd();
+	struct xocl_sched *xs = exec->scheduler;
+	struct xocl_cmd *xcmd = get_free_xocl_cmd(xs);
+	if (IS_ERR(xcmd))
+		return PTR_ERR(xcmd);
 	SCHED_DEBUGF("-> add_cmd(%lu)\n",xcmd->id);
 	xcmd->bo=bo;
 	xcmd->exec=exec;
 	xcmd->cu_idx=-1;
+	xcmd->queued_cu=-1;
 	xcmd->slot_idx=-1;
 	xcmd->packet = (struct ert_packet*)bo->vmapping;
-	xcmd->xs = exec->scheduler;
 
 	xcmd->client=client;
 	atomic_inc(&client->outstanding_execs);
@@ -465,17 +598,21 @@ add_cmd(struct exec_core *exec, struct client_ctx* client, struct drm_xocl_bo* b
 	memcpy(xcmd->deps,deps,numdeps*sizeof(struct drm_xocl_bo*));
 	xcmd->wait_count = numdeps;
 	xcmd->chain_count = 0;
+	xcmd->submit_ns = ktime_to_ns(ktime_get());
+	xcmd->deadline_ns = 0;
+	xcmd->aborted = false;
+	xcmd->mem_banks_valid = false;
 
 	set_cmd_state(xcmd,ERT_CMD_STATE_NEW);
-	mutex_lock(&pending_cmds_mutex);
-	list_add_tail(&xcmd->list,&pending_cmds);
-	mutex_unlock(&pending_cmds_mutex);
+	mutex_lock(&xs->pending_cmds_mutex);
+	list_add_tail(&xcmd->list,&xs->pending_cmds);
+	mutex_unlock(&xs->pending_cmds_mutex);
 
 	/* wake scheduler */
-	atomic_inc(&num_pending);
+	atomic_inc(&xs->num_pending);
 	atomic_inc(&xdev->outstanding_execs);
 	atomic64_inc(&xdev->total_execs);
-	wake_up_interruptible(&xcmd->xs->wait_queue);
+	wake_up_interruptible(&xs->wait_queue);
 
 	SCHED_DEBUGF("<- add_cmd opcode(%d) type(%d)\n",opcode(xcmd),type(xcmd));
 	return 0;
@@ -486,7 +623,7 @@ add_cmd(struct exec_core *exec, struct client_ctx* client, struct drm_xocl_bo* b
  *
  * @xcmd: command object to recycle
  *
- * Command object is added to the freelist
+ * Command object is removed from its list and returned to the slab cache
  *
  * Return: 0
  */
@@ -494,28 +631,75 @@ static int
 recycle_cmd(struct xocl_cmd* xcmd)
 {
 	SCHED_DEBUGF("recycle(%lu) %p\n",xcmd->id,xcmd);
-	mutex_lock(&free_cmds_mutex);
-	list_move_tail(&xcmd->list,&free_cmds);
-	mutex_unlock(&free_cmds_mutex);
+	list_del(&xcmd->list);
+	kmem_cache_free(xocl_cmd_cache,xcmd);
 	return 0;
 }
 
 /**
- * delete_cmd_list() - reclaim memory for all allocated command objects
+ * add_cmds() - Add multiple new commands to pending list
+ *
+ * @exec: Targeted device
+ * @bos: Buffer objects from user space from which new commands are created
+ * @num: Number of buffer objects in @bos
+ *
+ * All command objects are acquired before any command is made pending, so
+ * that either all or none of the commands are added.  The pending list lock
+ * is taken once and the scheduler is woken once for the entire batch.
+ *
+ * Return: 0 on success, -errno on failure
  */
-static void
-delete_cmd_list(void)
+static int
+add_cmds(struct exec_core *exec, struct client_ctx* client, struct drm_xocl_bo **bos, int num)
 {
-	struct xocl_cmd *xcmd;
-	struct list_head *pos, *next;
+	struct platform_device *pdev=exec->pdev;
+	struct xocl_dev *xdev = xocl_get_xdev(pdev);
+	struct xocl_sched *xs = exec->scheduler;
+	struct xocl_cmd *xcmd, *next;
+	u64 now = ktime_to_ns(ktime_get());
+	LIST_HEAD(cmds);
+	int i;
 
-	mutex_lock(&free_cmds_mutex);
-	list_for_each_safe(pos, next, &free_cmds) {
-		xcmd = list_entry(pos, struct xocl_cmd, list);
-		list_del(pos);
-		kfree(xcmd);
+	SCHED_DEBUGF("-> add_cmds(%d)\n",num);
+	for (i=0; i<num; ++i) {
+		xcmd = get_free_xocl_cmd(xs);
+		if (IS_ERR(xcmd)) {
+			list_for_each_entry_safe(xcmd, next, &cmds, list)
+				recycle_cmd(xcmd);
+			SCHED_DEBUG("<- add_cmds -ENOMEM\n");
+			return -ENOMEM;
+		}
+		xcmd->bo=bos[i];
+		xcmd->exec=exec;
+		xcmd->cu_idx=-1;
+		xcmd->queued_cu=-1;
+		xcmd->slot_idx=-1;
+		xcmd->packet = (struct ert_packet*)bos[i]->vmapping;
+		xcmd->client=client;
+		xcmd->wait_count = 0;
+		xcmd->chain_count = 0;
+		xcmd->submit_ns = now;
+		xcmd->deadline_ns = 0;
+		xcmd->aborted = false;
+		xcmd->mem_banks_valid = false;
+		set_cmd_state(xcmd,ERT_CMD_STATE_NEW);
+		list_add_tail(&xcmd->list,&cmds);
 	}
-	mutex_unlock(&free_cmds_mutex);
+
+	atomic_add(num,&client->outstanding_execs);
+
+	mutex_lock(&xs->pending_cmds_mutex);
+	list_splice_tail(&cmds,&xs->pending_cmds);
+	mutex_unlock(&xs->pending_cmds_mutex);
+
+	/* wake scheduler once for all commands */
+	atomic_add(num,&xs->num_pending);
+	atomic_add(num,&xdev->outstanding_execs);
+	atomic64_add(num,&xdev->total_execs);
+	wake_up_interruptible(&xs->wait_queue);
+
+	SCHED_DEBUG("<- add_cmds\n");
+	return 0;
 }
 
 /**
@@ -532,6 +716,44 @@ cleanup_exec(struct xocl_cmd *xcmd)
 	atomic_dec(&xcmd->client->outstanding_execs);
 }
 
+/**
+ * clear_client_queues() - Clear commands of a client waiting for admission
+ *
+ * @client: Client to unlink from its scheduler
+ *
+ * Must be called with the scheduler clients_mutex held.
+ */
+static void
+clear_client_queues(struct client_ctx *client)
+{
+	int prio;
+	for (prio=0; prio<XOCL_PRIORITY_LEVELS; ++prio) {
+		while (!list_empty(&client->sched_queue[prio])) {
+			struct xocl_cmd *xcmd = list_first_entry(&client->sched_queue[prio],struct xocl_cmd,list);
+			DRM_INFO("deleting stale client cmd\n");
+			cleanup_exec(xcmd);
+		}
+	}
+	client->sched_queued = 0;
+	list_del_init(&client->sched_link);
+}
+
+/**
+ * reset_client_queues() - Clear commands waiting for admission
+ *
+ * @xs: Scheduler owning the client queues
+ */
+static void
+reset_client_queues(struct xocl_sched *xs)
+{
+	mutex_lock(&xs->clients_mutex);
+	while (!list_empty(&xs->clients))
+		clear_client_queues(list_first_entry(&xs->clients,struct client_ctx,sched_link));
+	xs->num_queued = 0;
+	xs->admit_stalled = 0;
+	mutex_unlock(&xs->clients_mutex);
+}
+
 /**
  * reset_exec() - Reset the scheduler
  *
@@ -546,22 +768,22 @@ reset_exec(struct exec_core* exec)
 {
 	int i;
 	struct list_head *pos, *next;
+	struct xocl_sched *xs = exec->scheduler;
 
 	/* clear stale command objects if any */
-	list_for_each_safe(pos, next, &pending_cmds) {
+	list_for_each_safe(pos, next, &xs->pending_cmds) {
 		struct xocl_cmd *xcmd = list_entry(pos,struct xocl_cmd,list);
-		if (xcmd->exec!=exec)
-			continue;
 		DRM_INFO("deleting stale pending cmd\n");
 		cleanup_exec(xcmd);
 	}
-	list_for_each_safe(pos, next, &global_scheduler0.command_queue) {
+	list_for_each_safe(pos, next, &xs->command_queue) {
 		struct xocl_cmd *xcmd = list_entry(pos,struct xocl_cmd,list);
-		if (xcmd->exec!=exec)
-			continue;
 		DRM_INFO("deleting stale scheduler cmd\n");
 		cleanup_exec(xcmd);
 	}
+	reset_client_queues(xs);
+	xs->num_running = 0;
+	xs->next_deadline_ns = 0;
 
 	/* reset exec state */
         for (i=0; i<MAX_SLOTS; ++i)
@@ -591,6 +813,31 @@ reset_exec(struct exec_core* exec)
 	atomic_set(&exec->sr1,0);
 	atomic_set(&exec->sr2,0);
 	atomic_set(&exec->sr3,0);
+
+	exec->cu_isr = 0;
+	bitmap_zero(exec->cu_intr_pending,MAX_CUS);
+	atomic_set(&exec->cu_intr_count,0);
+
+	exec->cu_policy = CU_POLICY_FIRST;
+	exec->cu_next = 0;
+	exec->cu_stamp = 0;
+	for (i=0; i<MAX_CUS; ++i) {
+		exec->cu_last_used[i] = 0;
+		exec->cu_banks[i] = 0;
+	}
+
+	exec->ert_cycles = 0;
+	exec->ert_cycles_cmds = 0;
+	exec->ert_cycles_total = 0;
+	exec->ert_cycles_max = 0;
+
+	for (i=0; i<MAX_U32_SLOT_MASKS; ++i)
+		exec->abort_slots[i] = 0;
+	memset(exec->cu_timeouts,0,sizeof(exec->cu_timeouts));
+	memset(exec->cu_latency,0,sizeof(exec->cu_latency));
+	memset(exec->cu_running,0,sizeof(exec->cu_running));
+	memset(exec->cu_usage,0,sizeof(exec->cu_usage));
+	memset(exec->cu_busy_ns,0,sizeof(exec->cu_busy_ns));
 }
 
 /**
@@ -600,19 +847,20 @@ reset_exec(struct exec_core* exec)
  * some reason hangs.
  */
 static void
-reset_all(void)
+reset_all(struct xocl_sched *xs)
 {
 	/* clear stale command objects if any */
-	while (!list_empty(&pending_cmds)) {
-		struct xocl_cmd *xcmd = list_first_entry(&pending_cmds,struct xocl_cmd,list);
+	while (!list_empty(&xs->pending_cmds)) {
+		struct xocl_cmd *xcmd = list_first_entry(&xs->pending_cmds,struct xocl_cmd,list);
 		DRM_INFO("deleting stale pending cmd\n");
 		cleanup_exec(xcmd);
 	}
-	while (!list_empty(&global_scheduler0.command_queue)) {
-		struct xocl_cmd *xcmd = list_first_entry(&global_scheduler0.command_queue,struct xocl_cmd,list);
+	while (!list_empty(&xs->command_queue)) {
+		struct xocl_cmd *xcmd = list_first_entry(&xs->command_queue,struct xocl_cmd,list);
 		DRM_INFO("deleting stale scheduler cmd\n");
 		cleanup_exec(xcmd);
 	}
+	reset_client_queues(xs);
 }
 
 /**
@@ -638,9 +886,7 @@ is_ert(struct exec_core *exec)
 static inline int
 ffs_or_neg_one(u32 mask)
 {
-	if (!mask)
-		return -1;
-	return ffs(mask)-1;
+	return sched_ffs_or_neg_one(mask);
 }
 
 /**
@@ -652,9 +898,7 @@ ffs_or_neg_one(u32 mask)
 static inline int
 ffz_or_neg_one(u32 mask)
 {
-	if (mask==XOCL_U32_MASK)
-		return -1;
-	return ffz(mask);
+	return sched_ffz_or_neg_one(mask);
 }
 
 
@@ -678,7 +922,7 @@ slot_size(struct exec_core *exec)
 static inline unsigned int
 cu_mask_idx(unsigned int cu_idx)
 {
-	return cu_idx >> 5; /* 32 cus per mask */
+	return sched_mask_idx(cu_idx); /* 32 cus per mask */
 }
 
 /**
@@ -690,7 +934,7 @@ cu_mask_idx(unsigned int cu_idx)
 static inline unsigned int
 cu_idx_in_mask(unsigned int cu_idx)
 {
-	return cu_idx - (cu_mask_idx(cu_idx) << 5);
+	return sched_idx_in_mask(cu_idx);
 }
 
 /**
@@ -703,7 +947,7 @@ cu_idx_in_mask(unsigned int cu_idx)
 static inline unsigned int
 cu_idx_from_mask(unsigned int cu_idx, unsigned int mask_idx)
 {
-	return cu_idx + (mask_idx << 5);
+	return sched_idx_from_mask(cu_idx,mask_idx);
 }
 
 /**
@@ -715,7 +959,7 @@ cu_idx_from_mask(unsigned int cu_idx, unsigned int mask_idx)
 static inline unsigned int
 slot_mask_idx(unsigned int slot_idx)
 {
-	return slot_idx >> 5;
+	return sched_mask_idx(slot_idx);
 }
 
 /**
@@ -727,7 +971,7 @@ slot_mask_idx(unsigned int slot_idx)
 static inline unsigned int
 slot_idx_in_mask(unsigned int slot_idx)
 {
-	return slot_idx - (slot_mask_idx(slot_idx) << 5);
+	return sched_idx_in_mask(slot_idx);
 }
 
 /**
@@ -740,7 +984,7 @@ slot_idx_in_mask(unsigned int slot_idx)
 static inline unsigned int
 slot_idx_from_mask_idx(unsigned int slot_idx,unsigned int mask_idx)
 {
-	return slot_idx + (mask_idx << 5);
+	return sched_idx_from_mask(slot_idx,mask_idx);
 }
 
 
@@ -782,6 +1026,41 @@ cu_idx_to_bitmask(struct exec_core *exec, u32 cu_idx)
 }
 
 
+/**
+ * configure_cu_banks() - Compute memory banks connected to each CU
+ *
+ * @exec: Execution core being configured
+ *
+ * A CU is identified in the ip layout by its base address.  Its connected
+ * memory banks are the memory indices of its connectivity entries.  Banks
+ * beyond the first 64 are ignored.
+ */
+static void
+configure_cu_banks(struct exec_core *exec)
+{
+	struct xocl_dev *xdev = exec_get_xdev(exec);
+	struct ip_layout *layout = xdev->layout;
+	struct connectivity *conn = xdev->connectivity;
+	int i, j, k;
+
+	if (!layout || !conn)
+		return;
+
+	for (i=0; i<exec->num_cus; ++i) {
+		for (j=0; j<layout->m_count; ++j) {
+			struct ip_data *ip = &layout->m_ip_data[j];
+			if (ip->m_type!=IP_KERNEL || (u32)ip->m_base_address!=exec->cu_addr_map[i])
+				continue;
+			for (k=0; k<conn->m_count; ++k) {
+				int mem_idx = conn->m_connection[k].mem_data_index;
+				if (conn->m_connection[k].m_ip_layout_index==j && mem_idx>=0 && mem_idx<64)
+					exec->cu_banks[i] |= (u64)1 << mem_idx;
+			}
+		}
+		SCHED_DEBUGF("++ configure cu(%d) banks 0x%llx\n",i,exec->cu_banks[i]);
+	}
+}
+
 /**
  * configure() - Configure the scheduler from user space command
  *
@@ -851,6 +1130,7 @@ configure(struct xocl_cmd *xcmd)
 		exec->ops = &mb_ops;
 		exec->polling_mode = cfg->polling;
 		exec->cq_interrupt = cfg->cq_int;
+		exec->ert_cycles = cfg->cycles;
 		cfg->dsa52 = (dsa>=52) ? 1 : 0;
 		cfg->cdma = cdma ? 1 : 0;
 		/* reserve slot 0 for control commands */
@@ -859,13 +1139,22 @@ configure(struct xocl_cmd *xcmd)
 	else {
 		SCHED_DEBUG("++ configuring penguin scheduler mode\n");
 		exec->ops = &penguin_ops;
-		exec->polling_mode = 1;
+		exec->cu_policy = cu_policy;
+		if (exec->cu_policy==CU_POLICY_AFFINE)
+			configure_cu_banks(exec);
+		exec->cu_isr = penguin_cu_intr && cfg->cu_isr;
+		if (exec->cu_isr && exec->num_cus > exec->intr_num) {
+			DRM_INFO("penguin cu interrupts disabled, cus(%d) exceed interrupts(%d)\n",exec->num_cus,exec->intr_num);
+			exec->cu_isr = 0;
+		}
+		exec->polling_mode = exec->cu_isr ? 0 : 1;
 	}
 
-	DRM_INFO("scheduler config ert(%d) slots(%d), cudma(%d), cuisr(%d), cdma(%d), cus(%d), cu_shift(%d), cu_base(0x%x), cu_masks(%d)\n"
+	DRM_INFO("scheduler config ert(%d) slots(%d), cudma(%d), cudma_thresh(%d), cuisr(%d), cdma(%d), cus(%d), cu_shift(%d), cu_base(0x%x), cu_masks(%d)\n"
 		 ,is_ert(exec)
 		 ,exec->num_slots
 		 ,cfg->cu_dma ? 1 : 0
+		 ,cfg->cu_dma_thresh
 		 ,cfg->cu_isr ? 1 : 0
 		 ,cfg->cdma ? 1 : 0
 		 ,exec->num_cus
@@ -907,20 +1196,9 @@ exec_write(struct xocl_cmd *xcmd)
 static int
 acquire_slot_idx(struct exec_core *exec)
 {
-	unsigned int mask_idx=0, slot_idx=-1;
-	u32 mask;
-	SCHED_DEBUG("-> acquire_slot_idx\n");
-	for (mask_idx=0; mask_idx<exec->num_slot_masks; ++mask_idx) {
-		mask = exec->slot_status[mask_idx];
-		slot_idx = ffz_or_neg_one(mask);
-		if (slot_idx==-1 || slot_idx_from_mask_idx(slot_idx,mask_idx)>=exec->num_slots)
-			continue;
-		exec->slot_status[mask_idx] ^= (1<<slot_idx);
-		SCHED_DEBUGF("<- acquire_slot_idx returns %d\n",slot_idx_from_mask_idx(slot_idx,mask_idx));
-		return slot_idx_from_mask_idx(slot_idx,mask_idx);
-	}
-	SCHED_DEBUGF("<- acquire_slot_idx returns -1\n");
-	return -1;
+	int slot_idx = sched_acquire_idx(exec->slot_status,exec->num_slot_masks,exec->num_slots);
+	SCHED_DEBUGF("<-> acquire_slot_idx returns %d\n",slot_idx);
+	return slot_idx;
 }
 
 /**
@@ -935,11 +1213,9 @@ acquire_slot_idx(struct exec_core *exec)
 static void
 release_slot_idx(struct exec_core *exec, unsigned int slot_idx)
 {
-	unsigned int mask_idx = slot_mask_idx(slot_idx);
-	unsigned int pos = slot_idx_in_mask(slot_idx);
-	SCHED_DEBUGF("<-> release_slot_idx slot_status[%d]=0x%x, pos=%d\n"
-		     ,mask_idx,exec->slot_status[mask_idx],pos);
-	exec->slot_status[mask_idx] ^= (1<<pos);
+	SCHED_DEBUGF("<-> release_slot_idx slot_status[%d]=0x%x, slot_idx=%d\n"
+		     ,slot_mask_idx(slot_idx),exec->slot_status[slot_mask_idx(slot_idx)],slot_idx);
+	sched_toggle_idx(exec->slot_status,slot_idx);
 }
 
 /**
@@ -960,6 +1236,29 @@ get_cu_idx(struct exec_core *exec, unsigned int cmd_idx)
 	return xcmd->cu_idx;
 }
 
+/*
+ * exec_core_ops: CU register access for the shared scheduler core,
+ * addresses are relative to the exec core bar.
+ */
+static u32
+exec_read32(void *priv, u32 addr)
+{
+	struct exec_core *exec = priv;
+	return ioread32(exec->base + addr);
+}
+
+static void
+exec_write32(void *priv, u32 addr, u32 val)
+{
+	struct exec_core *exec = priv;
+	iowrite32(val,exec->base + addr);
+}
+
+static const struct sched_core_ops exec_core_ops = {
+	.read32 = exec_read32,
+	.write32 = exec_write32,
+};
+
 /**
  * cu_done() - Check status of CU
  *
@@ -975,13 +1274,7 @@ cu_done(struct exec_core *exec, unsigned int cu_idx)
 {
 	u32 cu_addr = cu_idx_to_addr(exec,cu_idx);
 	SCHED_DEBUGF("-> cu_done(%d) checks cu at address 0x%x\n",cu_idx,cu_addr);
-	/* done is indicated by AP_DONE(2) alone or by AP_DONE(2) | AP_IDLE(4)
-	 * but not by AP_IDLE itself.  Since 0x10 | (0x10 | 0x100) = 0x110
-	 * checking for 0x10 is sufficient. */
-	if (ioread32(exec->base + cu_addr) & 2) {
-		unsigned int mask_idx = cu_mask_idx(cu_idx);
-		unsigned int pos = cu_idx_in_mask(cu_idx);
-		exec->cu_status[mask_idx] ^= 1<<pos;
+	if (sched_cu_done(&exec_core_ops,exec,cu_addr,exec->cu_status,cu_idx)) {
 		SCHED_DEBUG("<- cu_done returns 1\n");
 		return true;
 	}
@@ -1058,25 +1351,134 @@ trigger_chain(struct xocl_cmd *xcmd)
 static void
 notify_host(struct xocl_cmd *xcmd)
 {
-	struct list_head *ptr;
-	struct client_ctx *entry;
 	struct exec_core *exec = xcmd->exec;
-	struct xocl_dev *xdev = exec_get_xdev(exec);
 
 	SCHED_DEBUGF("-> notify_host xcmd(%lu)\n",xcmd->id);
 
-	/* now for each client update the trigger counter in the context */
-	mutex_lock(&xdev->ctx_list_lock);
-	list_for_each(ptr, &xdev->ctx_list) {
-		entry = list_entry(ptr, struct client_ctx, link);
-		atomic_inc(&entry->trigger);
-	}
-	mutex_unlock(&xdev->ctx_list_lock);
+	/* every client sees this completion once, see poll_client() */
+	atomic_inc(&exec->poll_count);
 	/* wake up all the clients */
 	wake_up_interruptible(&exec->poll_wait_queue);
 	SCHED_DEBUG("<- notify_host\n");
 }
 
+/**
+ * notify_ring() - Write completed command to client completion ring
+ *
+ * @xcmd: Command that completed
+ *
+ * The exec buffer handle is written to the completion ring registered by
+ * the client that submitted the command, if any.  The command state
+ * must be updated prior to calling this function, so that user space sees
+ * the completed state when consuming the ring entry.
+ */
+static void
+notify_ring(struct xocl_cmd *xcmd)
+{
+	struct client_ctx *client = xcmd->client;
+	struct drm_xocl_exec_ring_buf *ring;
+
+	spin_lock(&client->ring_lock);
+	ring = client->ring;
+	if (ring) {
+		if (client->ring_tail - READ_ONCE(ring->head) < client->ring_size) {
+			/* entry at tail is free only after user has moved head past it */
+			smp_mb();
+			ring->handles[client->ring_tail & (client->ring_size - 1)] = xcmd->bo->metadata.handle;
+			/* publish entry and command state before tail */
+			smp_wmb();
+			WRITE_ONCE(ring->tail, ++client->ring_tail);
+		} else {
+			WRITE_ONCE(ring->dropped, ++client->ring_dropped);
+		}
+	}
+	spin_unlock(&client->ring_lock);
+}
+
+/**
+ * cmd_first_cu() - CU a start kernel command is accounted to
+ *
+ * @xcmd: start kernel command
+ *
+ * In penguin mode this is the CU executing the command.  In ERT mode the
+ * CU is chosen by ERT, the command is accounted to the first CU in its CU
+ * mask, which identifies the kernel of the command.
+ *
+ * Return: Index of CU, or -1 if none
+ */
+static int
+cmd_first_cu(struct xocl_cmd *xcmd)
+{
+	unsigned int mask_idx;
+
+	if (xcmd->cu_idx>=0)
+		return xcmd->cu_idx;
+
+	for (mask_idx=0; mask_idx<cu_masks(xcmd); ++mask_idx) {
+		int cu_idx = ffs_or_neg_one(xcmd->packet->data[mask_idx]);
+		if (cu_idx>=0)
+			return cu_idx_from_mask(cu_idx,mask_idx);
+	}
+	return -1;
+}
+
+/**
+ * cmd_stat_cu() - CU a command is accounted to in CU statistics
+ *
+ * @xcmd: Command submitted to device
+ *
+ * Return: Index of CU for start kernel commands not run by host, -1 otherwise
+ */
+static int
+cmd_stat_cu(struct xocl_cmd *xcmd)
+{
+	if (opcode(xcmd)!=ERT_START_CU || type(xcmd)==ERT_KDS_LOCAL)
+		return -1;
+	return cmd_first_cu(xcmd);
+}
+
+/**
+ * cmd_deadline_ns() - Deadline of a command started now
+ *
+ * @xcmd: Command submitted to device
+ * @now: Start time of command
+ *
+ * The deadline of a start kernel command is the per CU deadline of the CU
+ * it is accounted to if set, otherwise the module default.
+ *
+ * Return: Deadline in ns, or 0 if no deadline
+ */
+static u64
+cmd_deadline_ns(struct xocl_cmd *xcmd, u64 now)
+{
+	unsigned int timeout_ms = cmd_timeout_ms;
+	int cu_idx;
+
+	if (opcode(xcmd)!=ERT_START_CU || type(xcmd)==ERT_KDS_LOCAL)
+		return 0;
+
+	cu_idx = cmd_first_cu(xcmd);
+	if (cu_idx>=0 && xcmd->exec->cu_timeout_ms[cu_idx])
+		timeout_ms = xcmd->exec->cu_timeout_ms[cu_idx];
+
+	return timeout_ms ? now + (u64)timeout_ms*NSEC_PER_MSEC : 0;
+}
+
+/**
+ * cu_latency_bucket() - Histogram bucket of a start to done latency
+ *
+ * @latency_ns: Latency of command
+ *
+ * Bucket 0 counts latencies below 1 usec, bucket i counts latencies in
+ * [2^(i-1),2^i) usec, the last bucket also counts everything above.
+ */
+static inline unsigned int
+cu_latency_bucket(u64 latency_ns)
+{
+	unsigned int bucket = fls64(div_u64(latency_ns,NSEC_PER_USEC));
+	return min_t(unsigned int,bucket,CU_LATENCY_BUCKETS-1);
+}
+
 /**
  * mark_cmd_complete() - Move a command to complete state
  *
@@ -1091,18 +1493,38 @@ notify_host(struct xocl_cmd *xcmd)
  * The command is removed from the slot it occupies in the device command
  * queue. The slot is released so new commands can be submitted.  The host
  * is notified that some command has completed.
+ *
+ * A command that was aborted for exceeding its deadline is moved to abort
+ * state instead, otherwise its latency is added to the histogram and the
+ * utilization counters of its CU.
  */
 static void
 mark_cmd_complete(struct xocl_cmd *xcmd)
 {
 	struct exec_core *exec=xcmd->exec;
+	int cu_idx = cmd_stat_cu(xcmd);
 
 	SCHED_DEBUGF("-> mark_cmd_complete xcmd(%lu) slot(%d)\n",xcmd->id,xcmd->slot_idx);
 	exec->submitted_cmds[xcmd->slot_idx] = NULL;
-	set_cmd_state(xcmd,ERT_CMD_STATE_COMPLETED);
+	if (cu_idx>=0 && exec->cu_running[cu_idx])
+		--exec->cu_running[cu_idx];
+	if (xcmd->aborted) {
+		set_cmd_state(xcmd,ERT_CMD_STATE_ABORT);
+	}
+	else {
+		if (cu_idx>=0) {
+			u64 latency = ktime_to_ns(ktime_get()) - xcmd->start_ns;
+			++exec->cu_latency[cu_idx][cu_latency_bucket(latency)];
+			++exec->cu_usage[cu_idx];
+			exec->cu_busy_ns[cu_idx] += latency;
+		}
+		set_cmd_state(xcmd,ERT_CMD_STATE_COMPLETED);
+	}
 	if (exec->polling_mode)
 		--xcmd->xs->poll;
+	--xcmd->xs->num_running;
 	release_slot_idx(exec,xcmd->slot_idx);
+	notify_ring(xcmd);
 	notify_host(xcmd);
 
 	// Deactivate command and trigger chain of waiting commands
@@ -1125,9 +1547,17 @@ mark_mask_complete(struct exec_core *exec, u32 mask, unsigned int mask_idx)
 	SCHED_DEBUGF("-> mark_mask_complete(0x%x,%d)\n",mask,mask_idx);
 	if (!mask)
 		return;
-	for (bit_idx=0, cmd_idx=mask_idx<<5; bit_idx<32; mask>>=1,++bit_idx,++cmd_idx)
-		if (mask & 0x1)
-			mark_cmd_complete(exec->submitted_cmds[cmd_idx]);
+	for (bit_idx=0, cmd_idx=mask_idx<<5; bit_idx<32; mask>>=1,++bit_idx,++cmd_idx) {
+		if (!(mask & 0x1))
+			continue;
+		/* abort commands have no command object, see abort_cmd() */
+		if (exec->abort_slots[mask_idx] & (1<<bit_idx)) {
+			exec->abort_slots[mask_idx] ^= (1<<bit_idx);
+			release_slot_idx(exec,cmd_idx);
+			continue;
+		}
+		mark_cmd_complete(exec->submitted_cmds[cmd_idx]);
+	}
 	SCHED_DEBUG("<- mark_mask_complete\n");
 }
 
@@ -1163,9 +1593,19 @@ queued_to_running(struct xocl_cmd *xcmd)
 	}
 
 	if (xcmd->exec->ops->submit(xcmd)) {
+		struct client_ctx *client = xcmd->client;
+		int cu_idx;
 		set_cmd_int_state(xcmd,ERT_CMD_STATE_RUNNING);
+		xcmd->start_ns = ktime_to_ns(ktime_get());
+		xcmd->deadline_ns = cmd_deadline_ns(xcmd,xcmd->start_ns);
+		client->sched_wait_ns += xcmd->start_ns - xcmd->submit_ns;
+		++client->sched_started;
+		cu_idx = cmd_stat_cu(xcmd);
+		if (cu_idx>=0)
+			++xcmd->exec->cu_running[cu_idx];
 		if (xcmd->exec->polling_mode)
 			++xcmd->xs->poll;
+		++xcmd->xs->num_running;
 		xcmd->exec->submitted_cmds[xcmd->slot_idx] = xcmd;
 		retval = true;
 	}
@@ -1221,29 +1661,235 @@ abort_to_free(struct xocl_cmd *xcmd)
 	SCHED_DEBUG("<- abort_to_free\n");
 }
 
-#if 0
-static void
+/**
+ * abort_cmd() - Abort a running command that exceeded its deadline
+ *
+ * @xcmd: Running command to abort
+ *
+ * In ERT mode an abort command for the slot of @xcmd is written to a free
+ * command queue slot.  ERT releases the CU and retires both slots, and
+ * @xcmd moves to abort state when its slot is marked complete.  The abort
+ * command has no command object, its slot is tracked in exec->abort_slots.
+ *
+ * In penguin mode the command is retired right away.  The CU is left busy
+ * since it never reported done, it is not used again until the exec core
+ * is reset.
+ *
+ * Return: 0 on success, -EBUSY if no slot is available for the abort command
+ */
+static int
 abort_cmd(struct xocl_cmd *xcmd)
 {
-	struct xocl_cmd *abort_cmd = get_free_xocl_cmd();
-	abort_cmd->bo=NULL;
-	abort_cmd->exec=xcmd->exec;
+	struct exec_core *exec = xcmd->exec;
+	struct ert_abort_cmd abort;
+	int cu_idx = cmd_first_cu(xcmd);
+	int slot_idx;
 
-	ert_abort_cmd abort;
-	abort.state = 1;
-	abort.idx = xcmd->slot_idx;
+	SCHED_DEBUGF("-> abort_cmd(%lu) slot_idx(%d)\n",xcmd->id,xcmd->slot_idx);
+
+	if (is_ert(exec)) {
+		u32 slot_addr;
+
+		slot_idx = acquire_slot_idx(exec);
+		if (slot_idx<0) {
+			SCHED_DEBUG("<- abort_cmd no free slot\n");
+			return -EBUSY;
+		}
+		exec->abort_slots[slot_mask_idx(slot_idx)] |= 1<<slot_idx_in_mask(slot_idx);
+
+		abort.header = 0;
+		abort.state = ERT_CMD_STATE_NEW;
+		abort.idx = xcmd->slot_idx;
+		abort.opcode = ERT_ABORT;
+		abort.type = ERT_DEFAULT;
+		slot_addr = ERT_CQ_BASE_ADDR + slot_idx*slot_size(exec);
+		iowrite32(abort.header,exec->base + slot_addr);
+
+		if (exec->cq_interrupt) {
+			u32 cq_int_addr = ERT_CQ_STATUS_REGISTER_ADDR + (slot_mask_idx(slot_idx)<<2);
+			iowrite32(1<<slot_idx_in_mask(slot_idx),exec->base + cq_int_addr);
+		}
+	}
+
+	DRM_ERROR("xcmd(%lu) on cu(%d) exceeded its deadline after %llu ms, aborting\n",
+		  xcmd->id,cu_idx,div_u64(ktime_to_ns(ktime_get()) - xcmd->start_ns,NSEC_PER_MSEC));
+	if (cu_idx>=0)
+		++exec->cu_timeouts[cu_idx];
+	xcmd->aborted = true;
+
+	if (!is_ert(exec))
+		mark_cmd_complete(xcmd);
 
-	iowrite32
-	SCHED_DEBUG("-> abort_cmd\n");
 	SCHED_DEBUG("<- abort_cmd\n");
+	return 0;
+}
+
+/**
+ * check_deadline() - Abort a running command if it exceeded its deadline
+ *
+ * @xcmd: Running command
+ * @now: Current time
+ *
+ * The earliest deadline of commands still running is tracked so the
+ * scheduler wakes up in time to check it, see scheduler_wait().
+ */
+static void
+check_deadline(struct xocl_cmd *xcmd, u64 now)
+{
+	struct xocl_sched *xs = xcmd->xs;
+
+	if (!xcmd->deadline_ns || xcmd->aborted)
+		return;
+
+	/* retry shortly if no slot was available for abort command */
+	if (now >= xcmd->deadline_ns && abort_cmd(xcmd))
+		xcmd->deadline_ns = now + NSEC_PER_MSEC;
+
+	if (xcmd->aborted)
+		return;
+
+	if (!xs->next_deadline_ns || xcmd->deadline_ns < xs->next_deadline_ns)
+		xs->next_deadline_ns = xcmd->deadline_ns;
+}
+
+/**
+ * cmd_priority() - Scheduling priority of a command
+ *
+ * Only start kernel commands carry a priority, other commands are
+ * admitted with highest priority.
+ */
+static inline unsigned int
+cmd_priority(struct xocl_cmd *xcmd)
+{
+	if (opcode(xcmd)!=ERT_START_CU)
+		return XOCL_PRIORITY_LEVELS-1;
+	return ((struct ert_start_kernel_cmd *)xcmd->packet)->priority;
+}
+
+/**
+ * cmd_admit_cu() - Account a command to a CU for admission
+ *
+ * With cu_queue_limit set, a start kernel command is accounted to the CU
+ * in its CU mask with the fewest admitted commands waiting to start.  It
+ * can be admitted only if that CU is below the limit.
+ *
+ * Return: %true if the command can be admitted
+ */
+static bool
+cmd_admit_cu(struct xocl_sched *xs, struct xocl_cmd *xcmd)
+{
+	struct exec_core *exec = xs->exec;
+	unsigned int num_masks;
+	unsigned int cu_idx;
+	int best = -1;
+
+	xcmd->queued_cu = -1;
+	if (!cu_queue_limit || opcode(xcmd)!=ERT_START_CU)
+		return true;
+
+	num_masks = cu_masks(xcmd);
+	for (cu_idx=0; cu_idx<exec->num_cus; ++cu_idx) {
+		unsigned int mask_idx = cu_mask_idx(cu_idx);
+		if (mask_idx>=num_masks)
+			break;
+		if (!(xcmd->packet->data[mask_idx] & cu_idx_to_bitmask(exec,cu_idx)))
+			continue;
+		if (best<0 || xs->cu_queued[cu_idx]<xs->cu_queued[best])
+			best = cu_idx;
+	}
+
+	/* no valid CU, the command fails when started */
+	if (best<0)
+		return true;
+	if (xs->cu_queued[best]>=cu_queue_limit)
+		return false;
+
+	++xs->cu_queued[best];
+	xcmd->queued_cu = best;
+	return true;
+}
+
+/**
+ * scheduler_admit_cmds() - Admit commands from client queues to command queue
+ *
+ * Clients are visited round robin.  At each turn a client has up to
+ * 1<<priority commands of its highest non empty priority admitted.
+ * Commands of aborted clients are admitted without limit so they can be
+ * freed.  Commands held back per cu_queue_limit are skipped, lower
+ * priorities are tried only if nothing was admitted, and admission ends
+ * when a full round of clients admits nothing.  See struct xocl_sched.
+ *
+ * Must be called with @xs->clients_mutex held.
+ */
+static void
+scheduler_admit_cmds(struct xocl_sched *xs)
+{
+	struct client_ctx *client, *next;
+	unsigned int limit = xs->exec->num_slots;
+	unsigned int num_clients = 0;
+	unsigned int idle = 0;
+
+	SCHED_DEBUG("-> scheduler_admit_cmds\n");
+	list_for_each_entry_safe(client, next, &xs->clients, sched_link) {
+		int prio;
+		if (!atomic_read(&client->abort)) {
+			++num_clients;
+			continue;
+		}
+		for (prio=0; prio<XOCL_PRIORITY_LEVELS; ++prio)
+			list_splice_tail_init(&client->sched_queue[prio],&xs->command_queue);
+		client->sched_queued = 0;
+		list_del_init(&client->sched_link);
+	}
+
+	while (!list_empty(&xs->clients) && xs->num_queued < limit && idle < num_clients) {
+		unsigned int quantum, admitted = 0;
+		int prio = XOCL_PRIORITY_LEVELS-1;
+		client = list_first_entry(&xs->clients,struct client_ctx,sched_link);
+		while (list_empty(&client->sched_queue[prio]))
+			--prio;
+
+		for (quantum = 1<<prio; prio>=0 && !admitted; --prio) {
+			struct xocl_cmd *xcmd, *xnext;
+			list_for_each_entry_safe(xcmd, xnext, &client->sched_queue[prio], list) {
+				if (admitted==quantum || xs->num_queued==limit)
+					break;
+				if (!cmd_admit_cu(xs,xcmd))
+					continue;
+				SCHED_DEBUGF("+ admitting cmd(%lu) priority(%d)\n",xcmd->id,prio);
+				list_move_tail(&xcmd->list,&xs->command_queue);
+				--client->sched_queued;
+				++xs->num_queued;
+				++admitted;
+			}
+			/* without cu_queue_limit the head is always admitted */
+			if (!cu_queue_limit)
+				break;
+		}
+
+		idle = admitted ? 0 : idle+1;
+		if (client->sched_queued)
+			list_move_tail(&client->sched_link,&xs->clients);
+		else {
+			list_del_init(&client->sched_link);
+			--num_clients;
+			idle = 0;
+		}
+	}
+
+	/* remaining commands are all held back per cu_queue_limit */
+	xs->admit_stalled = !list_empty(&xs->clients) && xs->num_queued < limit;
+	SCHED_DEBUG("<- scheduler_admit_cmds\n");
 }
-#endif
 
 /**
  * scheduler_queue_cmds() - Queue any pending commands
  *
- * The scheduler copies pending commands to its internal command queue where
- * is is now in queued state.
+ * The scheduler moves pending commands to the queue of the client that
+ * submitted the command where it is now in queued state.  Commands are
+ * admitted from client queues to the internal command queue per
+ * scheduler_admit_cmds().  Commands with unresolved dependencies and
+ * commands in error go directly to the command queue.
  */
 static void
 scheduler_queue_cmds(struct xocl_sched *xs)
@@ -1252,14 +1898,13 @@ scheduler_queue_cmds(struct xocl_sched *xs)
 	struct list_head *pos, *next;
 
 	SCHED_DEBUG("-> scheduler_queue_cmds\n");
-	mutex_lock(&pending_cmds_mutex);
-	list_for_each_safe(pos, next, &pending_cmds) {
+	mutex_lock(&xs->pending_cmds_mutex);
+	mutex_lock(&xs->clients_mutex);
+	list_for_each_safe(pos, next, &xs->pending_cmds) {
+		struct client_ctx *client;
 		xcmd = list_entry(pos, struct xocl_cmd, list);
-		if (xcmd->xs != xs)
-			continue;
 		SCHED_DEBUGF("+ queueing cmd(%lu)\n",xcmd->id);
 		list_del(&xcmd->list);
-		list_add_tail(&xcmd->list,&xs->command_queue);
 
 		/* chain active dependencies if any to this command object */
 		if (xcmd->wait_count && chain_dependencies(xcmd))
@@ -1269,9 +1914,24 @@ scheduler_queue_cmds(struct xocl_sched *xs)
 
 		/* this command is now active and can chain other commands */
 		xcmd->bo->metadata.active=xcmd;
-		atomic_dec(&num_pending);
+		atomic_dec(&xs->num_pending);
+
+		/* a waiting command is started when triggered by its chain */
+		if (xcmd->wait_count || xcmd->state!=ERT_CMD_STATE_QUEUED) {
+			list_add_tail(&xcmd->list,&xs->command_queue);
+			continue;
+		}
+
+		client = xcmd->client;
+		list_add_tail(&xcmd->list,&client->sched_queue[cmd_priority(xcmd)]);
+		++client->sched_queued;
+		if (list_empty(&client->sched_link))
+			list_add_tail(&client->sched_link,&xs->clients);
 	}
-	mutex_unlock(&pending_cmds_mutex);
+	mutex_unlock(&xs->pending_cmds_mutex);
+
+	scheduler_admit_cmds(xs);
+	mutex_unlock(&xs->clients_mutex);
 	SCHED_DEBUG("<- scheduler_queue_cmds\n");
 }
 
@@ -1282,19 +1942,39 @@ static void
 scheduler_iterate_cmds(struct xocl_sched *xs)
 {
 	struct list_head *pos, *next;
+	unsigned int queued = 0;
+	u64 now = 0;
 
 	SCHED_DEBUG("-> scheduler_iterate_cmds\n");
+	xs->next_deadline_ns = 0;
+	if (cu_queue_limit)
+		memset(xs->cu_queued,0,sizeof(xs->cu_queued));
 	list_for_each_safe(pos, next, &xs->command_queue) {
 		struct xocl_cmd *xcmd = list_entry(pos, struct xocl_cmd, list);
+		int queued_cu = (xcmd->state == ERT_CMD_STATE_QUEUED) ? xcmd->queued_cu : -1;
 		update_cmd_state(xcmd);
 
 		SCHED_DEBUGF("+ processing cmd(%lu)\n",xcmd->id);
 
 		/* check running first since queued maybe we waiting for cmd slot */
-		if (xcmd->state == ERT_CMD_STATE_QUEUED)
+		if (xcmd->state == ERT_CMD_STATE_QUEUED) {
 			queued_to_running(xcmd);
+			if (xcmd->state == ERT_CMD_STATE_QUEUED && !xcmd->wait_count) {
+				++queued;
+				if (xcmd->queued_cu>=0)
+					++xs->cu_queued[xcmd->queued_cu];
+			}
+		}
+		/* CU has room again, held back commands may be admitted */
+		if (queued_cu>=0 && xcmd->state != ERT_CMD_STATE_QUEUED)
+			xs->admit_stalled = 0;
 		if (xcmd->state == ERT_CMD_STATE_RUNNING)
 			running_to_complete(xcmd);
+		if (xcmd->state == ERT_CMD_STATE_RUNNING && xcmd->deadline_ns) {
+			if (!now)
+				now = ktime_to_ns(ktime_get());
+			check_deadline(xcmd,now);
+		}
 		if (xcmd->state == ERT_CMD_STATE_COMPLETED)
 			complete_to_free(xcmd);
 		if (xcmd->state == ERT_CMD_STATE_ERROR)
@@ -1302,6 +1982,7 @@ scheduler_iterate_cmds(struct xocl_sched *xs)
 		if (xcmd->state == ERT_CMD_STATE_ABORT)
 			abort_to_free(xcmd);
 	}
+	xs->num_queued = queued;
 	SCHED_DEBUG("<- scheduler_iterate_cmds\n");
 }
 
@@ -1312,6 +1993,8 @@ scheduler_iterate_cmds(struct xocl_sched *xs)
  *   1. there are no pending commands
  *   2. no pending interrupt from embedded scheduler
  *   3. no pending complete commands in polling mode
+ *   4. no client commands that can be admitted to the command queue, that
+ *      is commands all held back per cu_queue_limit do not wake the scheduler
  *
  * Return: 1 if scheduler must wait, 0 othewise
  */
@@ -1324,7 +2007,7 @@ scheduler_wait_condition(struct xocl_sched *xs)
 		return 0;
 	}
 
-	if (atomic_read(&num_pending)) {
+	if (atomic_read(&xs->num_pending)) {
 		SCHED_DEBUG("scheduler wakes to copy new pending commands\n");
 		return 0;
 	}
@@ -1340,6 +2023,12 @@ scheduler_wait_condition(struct xocl_sched *xs)
 		return 0;
 	}
 
+	if (!list_empty(&xs->clients) && xs->num_queued < xs->exec->num_slots
+	    && !xs->admit_stalled) {
+		SCHED_DEBUG("scheduler wakes to admit client commands\n");
+		return 0;
+	}
+
 	SCHED_DEBUG("scheduler waits ...\n");
 	return 1;
 }
@@ -1347,12 +2036,26 @@ scheduler_wait_condition(struct xocl_sched *xs)
 /**
  * scheduler_wait() - check if scheduler should wait
  *
- * See scheduler_wait_condition().
+ * See scheduler_wait_condition().  If a running command has a deadline,
+ * then the wait is bounded by the earliest deadline, so that a hung CU is
+ * detected even when no interrupts arrive.
  */
 static void
 scheduler_wait(struct xocl_sched *xs)
 {
-	wait_event_interruptible(xs->wait_queue,scheduler_wait_condition(xs)==0);
+	u64 now;
+
+	if (!xs->num_running || !xs->next_deadline_ns) {
+		wait_event_interruptible(xs->wait_queue,scheduler_wait_condition(xs)==0);
+		return;
+	}
+
+	now = ktime_to_ns(ktime_get());
+	if (now >= xs->next_deadline_ns)
+		return;
+
+	wait_event_interruptible_timeout(xs->wait_queue,scheduler_wait_condition(xs)==0,
+					 nsecs_to_jiffies(xs->next_deadline_ns - now) + 1);
 }
 
 /**
@@ -1393,59 +2096,106 @@ scheduler(void* data)
 }
 
 /**
- * init_scheduler_thread() - Initialize scheduler thread if necessary
+ * init_scheduler_thread() - Initialize and start scheduler thread
+ *
+ * @xs: Scheduler to start
+ * @idx: Scheduler index used in thread name
  *
  * Return: 0 on success, -errno otherwise
  */
 static int
-init_scheduler_thread(void)
+init_scheduler_thread(struct xocl_sched *xs, int idx)
 {
-	SCHED_DEBUGF("init_scheduler_thread use_count=%d\n",global_scheduler0.use_count);
-	if (global_scheduler0.use_count++)
-		return 0;
+	SCHED_DEBUGF("init_scheduler_thread %d\n",idx);
+
+	init_waitqueue_head(&xs->wait_queue);
+	xs->error = 0;
+	xs->stop = 0;
+
+	INIT_LIST_HEAD(&xs->command_queue);
+	atomic_set(&xs->intc,0);
+	xs->poll=0;
+	xs->num_running=0;
+	xs->next_deadline_ns=0;
+
+	atomic_long_set(&xs->cmd_id,0);
 
-	init_waitqueue_head(&global_scheduler0.wait_queue);
-	global_scheduler0.error = 0;
-	global_scheduler0.stop = 0;
+	INIT_LIST_HEAD(&xs->pending_cmds);
+	mutex_init(&xs->pending_cmds_mutex);
+	atomic_set(&xs->num_pending,0);
 
-	INIT_LIST_HEAD(&global_scheduler0.command_queue);
-	atomic_set(&global_scheduler0.intc,0);
-	global_scheduler0.poll=0;
+	INIT_LIST_HEAD(&xs->clients);
+	mutex_init(&xs->clients_mutex);
+	xs->num_queued = 0;
+	xs->admit_stalled = 0;
 
-	global_scheduler0.scheduler_thread = kthread_run(scheduler,(void*)&global_scheduler0,"xocl-scheduler-thread0");
-	if (IS_ERR(global_scheduler0.scheduler_thread)) {
-		int ret = PTR_ERR(global_scheduler0.scheduler_thread);
+	xs->scheduler_thread = kthread_run(scheduler,(void*)xs,"xocl-scheduler-thread%d",idx);
+	if (IS_ERR(xs->scheduler_thread)) {
+		int ret = PTR_ERR(xs->scheduler_thread);
 		DRM_ERROR(__func__);
+		xs->scheduler_thread = NULL;
 		return ret;
 	}
 	return 0;
 }
 
 /**
- * fini_scheduler_thread() - Finalize scheduler thread if unused
+ * fini_scheduler_thread() - Stop scheduler thread and release commands
+ *
+ * @xs: Scheduler to stop
  *
  * Return: 0 on success, -errno otherwise
  */
 static int
-fini_scheduler_thread(void)
+fini_scheduler_thread(struct xocl_sched *xs)
 {
 	int retval = 0;
-	SCHED_DEBUGF("fini_scheduler_thread use_count=%d\n",global_scheduler0.use_count);
-	if (--global_scheduler0.use_count)
-		return 0;
-
-	retval = kthread_stop(global_scheduler0.scheduler_thread);
+	SCHED_DEBUG("fini_scheduler_thread\n");
+	if (xs->scheduler_thread)
+		retval = kthread_stop(xs->scheduler_thread);
 
 	/* clear stale command objects if any */
-	reset_all();
+	reset_all(xs);
 
-	/* reclaim memory for allocate command objects */
-	delete_cmd_list();
+	mutex_destroy(&xs->pending_cmds_mutex);
+	mutex_destroy(&xs->clients_mutex);
 
 	return retval;
 }
 
 
+/**
+ * mb_collect_cycles() - Collect CU configure cycles of completed commands
+ *
+ * @mask: Bitmask with completed commands
+ * @mask_idx: Index of the command mask. Used to offset the actual cmd slot index
+ *
+ * ERT writes the configure cycles of a start kernel command to the last
+ * word of the command queue slot, the host reads it before the slot is
+ * reused.
+ */
+static void
+mb_collect_cycles(struct exec_core *exec, u32 mask, unsigned int mask_idx)
+{
+	int cmd_idx;
+
+	for (cmd_idx=mask_idx<<5; mask; mask>>=1,++cmd_idx) {
+		struct xocl_cmd *xcmd = exec->submitted_cmds[cmd_idx];
+		u32 slot_addr, cycles;
+
+		if (!(mask & 0x1) || !xcmd || xcmd->aborted || opcode(xcmd)!=ERT_START_CU)
+			continue;
+
+		slot_addr = ERT_CQ_BASE_ADDR + cmd_idx*slot_size(exec);
+		cycles = ioread32(exec->base + slot_addr + slot_size(exec) - sizeof(u32));
+		SCHED_DEBUGF("++ mb_collect_cycles xcmd(%lu) cycles(%d)\n",xcmd->id,cycles);
+		++exec->ert_cycles_cmds;
+		exec->ert_cycles_total += cycles;
+		if (cycles > exec->ert_cycles_max)
+			exec->ert_cycles_max = cycles;
+	}
+}
+
 /**
  * mb_query() - Check command status of argument command
  *
@@ -1479,6 +2229,8 @@ mb_query(struct xocl_cmd *xcmd)
 		u32 csr_addr = ERT_STATUS_REGISTER_ADDR + (cmd_mask_idx<<2);
 		u32 mask = ioread32(xcmd->exec->base + csr_addr);
 		SCHED_DEBUGF("++ mb_query csr_addr=0x%x mask=0x%x\n",csr_addr,mask);
+		if (mask && exec->ert_cycles)
+			mb_collect_cycles(exec,mask,cmd_mask_idx);
 		if (mask)
 			mark_mask_complete(xcmd->exec,mask,cmd_mask_idx);
 	}
@@ -1486,6 +2238,56 @@ mb_query(struct xocl_cmd *xcmd)
 	SCHED_DEBUGF("<- mb_query\n");
 }
 
+/**
+ * penguin_query_intr() - Retire all commands on CUs that have interrupted
+ *
+ * @exec: Execution core with CU interrupts enabled
+ *
+ * Function is called in penguin mode with CU interrupts.  All CUs that have
+ * interrupted since last call are checked and acknowledged, and their
+ * commands are marked complete in one batch per slot mask.
+ */
+static void
+penguin_query_intr(struct exec_core *exec)
+{
+	unsigned long pending[BITS_TO_LONGS(MAX_CUS)];
+	u32 slot_masks[MAX_U32_SLOT_MASKS] = {0};
+	bool completed = false;
+	unsigned int i;
+
+	SCHED_DEBUG("-> penguin_query_intr\n");
+
+	for (i=0; i<BITS_TO_LONGS(MAX_CUS); ++i)
+		pending[i] = xchg(&exec->cu_intr_pending[i],0);
+
+	if (bitmap_empty(pending,MAX_CUS)) {
+		SCHED_DEBUG("<- penguin_query_intr no pending interrupts\n");
+		return;
+	}
+
+	for (i=0; i<exec->num_slots; ++i) {
+		struct xocl_cmd *xcmd = exec->submitted_cmds[i];
+		if (!xcmd || opcode(xcmd)!=ERT_START_CU || !test_bit(xcmd->cu_idx,pending))
+			continue;
+		if (!cu_done(exec,xcmd->cu_idx))
+			continue;
+		/* acknowledge ap_done interrupt, toggle on write */
+		iowrite32(0x1,exec->base + cu_idx_to_addr(exec,xcmd->cu_idx) + CU_ISR_ADDR);
+		slot_masks[slot_mask_idx(i)] |= 1<<slot_idx_in_mask(i);
+		completed = true;
+	}
+
+	for (i=0; i<exec->num_slot_masks; ++i)
+		mark_mask_complete(exec,slot_masks[i],i);
+
+	/* commands already visited by scheduler in this iteration are
+	 * retired in next iteration, make sure it happens */
+	if (completed)
+		atomic_set(&exec->scheduler->intc,1);
+
+	SCHED_DEBUG("<- penguin_query_intr\n");
+}
+
 /**
  * penguin_query() - Check command status of argument command
  *
@@ -1500,7 +2302,9 @@ penguin_query(struct xocl_cmd *xcmd)
 
 	SCHED_DEBUGF("-> penguin_queury() slot_idx=%d\n",xcmd->slot_idx);
 
-	if (type(xcmd)==ERT_KDS_LOCAL
+	if (opc==ERT_START_CU && type(xcmd)!=ERT_KDS_LOCAL && xcmd->exec->cu_isr)
+		penguin_query_intr(xcmd->exec);
+	else if (type(xcmd)==ERT_KDS_LOCAL
 	    ||opc==ERT_CONFIGURE
 	    ||(opc==ERT_START_CU && cu_done(xcmd->exec,get_cu_idx(xcmd->exec,xcmd->slot_idx))))
 		mark_cmd_complete(xcmd);
@@ -1557,33 +2361,132 @@ mb_submit(struct xocl_cmd *xcmd)
 }
 
 /**
- * get_free_cu() - get index of first available CU per command cu mask
+ * cmd_mem_banks() - Memory banks referenced by command register map
+ *
+ * @xcmd: start kernel command
+ *
+ * The scheduler does not know which register map words are buffer
+ * addresses, so every pair of consecutive words past the control registers
+ * is checked against the memory topology.  Scalar arguments can match by
+ * chance, which only affects the preference of CU selection.
+ *
+ * Return: Bitmap of memory banks, computed once per command
+ */
+static u64
+cmd_mem_banks(struct xocl_cmd *xcmd)
+{
+	struct xocl_dev *xdev = cmd_get_xdev(xcmd);
+	struct mem_topology *topo = xdev->topology;
+	struct ert_start_kernel_cmd *ecmd = (struct ert_start_kernel_cmd *)xcmd->packet;
+	u32 *regmap = ecmd->data + ecmd->extra_cu_masks;
+	u32 size = regmap_size(xcmd);
+	u32 i;
+	int b;
+
+	if (xcmd->mem_banks_valid)
+		return xcmd->mem_banks;
+
+	xcmd->mem_banks = 0;
+	xcmd->mem_banks_valid = true;
+	if (!topo)
+		return 0;
+
+	for (i=4; i+1<size; ++i) {
+		u64 addr = ((u64)regmap[i+1] << 32) | regmap[i];
+		if (!addr)
+			continue;
+		for (b=0; b<topo->m_count && b<64; ++b) {
+			struct mem_data *mem = &topo->m_mem_data[b];
+			if (!mem->m_used || mem->m_type==MEM_STREAMING)
+				continue;
+			if (addr>=mem->m_base_address && addr<mem->m_base_address + (mem->m_size<<10))
+				xcmd->mem_banks |= (u64)1 << b;
+		}
+	}
+	return xcmd->mem_banks;
+}
+
+/**
+ * get_free_cu() - get index of an available CU per command cu mask
  *
  * @xcmd: command containing CUs to check for availability
  *
  * This function is called kernel software scheduler mode only, in embedded
  * scheduler mode, the hardware scheduler handles the commands directly.
  *
+ * The CU is selected among the available CUs per the cu_policy module
+ * parameter: the first CU, the next CU round robin, the least recently
+ * used CU, or the CU connected to the most memory banks referenced by the
+ * command with ties broken round robin.
+ *
  * Return: Index of free CU, -1 of no CU is available.
  */
 static int
 get_free_cu(struct xocl_cmd *xcmd)
 {
+	struct exec_core *exec = xcmd->exec;
 	int mask_idx=0;
 	int num_masks = cu_masks(xcmd);
+	int best = -1;
+	unsigned int best_score = 0;
+	unsigned int max_score = 0;
+	u64 banks = 0;
+	unsigned int i;
+
 	SCHED_DEBUG("-> get_free_cu\n");
-	for (mask_idx=0; mask_idx<num_masks; ++mask_idx) {
-		u32 cmd_mask = xcmd->packet->data[mask_idx]; /* skip header */
-		u32 busy_mask = xcmd->exec->cu_status[mask_idx];
-		int cu_idx = ffs_or_neg_one((cmd_mask | busy_mask) ^ busy_mask);
-		if (cu_idx>=0) {
-			xcmd->exec->cu_status[mask_idx] ^= 1<<cu_idx;
-			SCHED_DEBUGF("<- get_free_cu returns %d\n",cu_idx_from_mask(cu_idx,mask_idx));
-			return cu_idx_from_mask(cu_idx,mask_idx);
+	if (exec->cu_policy==CU_POLICY_FIRST) {
+		/* skip header */
+		best = sched_get_free_cu(xcmd->packet->data,exec->cu_status,num_masks);
+		SCHED_DEBUGF("<- get_free_cu returns %d\n",best);
+		return best;
+	}
+
+	if (exec->cu_policy==CU_POLICY_AFFINE) {
+		banks = cmd_mem_banks(xcmd);
+		max_score = hweight64(banks);
+	}
+
+	for (i=0; i<exec->num_cus; ++i) {
+		unsigned int cu_idx = (exec->cu_next + i) % exec->num_cus;
+		unsigned int score;
+		u32 bit = cu_idx_to_bitmask(exec,cu_idx);
+		mask_idx = cu_mask_idx(cu_idx);
+		if (mask_idx>=num_masks)
+			continue;
+		if (!(xcmd->packet->data[mask_idx] & bit) || (exec->cu_status[mask_idx] & bit))
+			continue;
+
+		if (exec->cu_policy==CU_POLICY_LRU) {
+			if (best<0 || exec->cu_last_used[cu_idx]<exec->cu_last_used[best])
+				best = cu_idx;
+			continue;
 		}
+
+		if (exec->cu_policy==CU_POLICY_AFFINE) {
+			score = hweight64(banks & exec->cu_banks[cu_idx]);
+			if (best<0 || score>best_score) {
+				best = cu_idx;
+				best_score = score;
+			}
+			if (best_score<max_score)
+				continue;
+		}
+
+		/* round robin, or perfect bank affinity */
+		best = cu_idx;
+		break;
 	}
-	SCHED_DEBUG("<- get_free_cu returns -1\n");
-	return -1;
+
+	if (best<0) {
+		SCHED_DEBUG("<- get_free_cu returns -1\n");
+		return -1;
+	}
+
+	exec->cu_status[cu_mask_idx(best)] ^= cu_idx_to_bitmask(exec,best);
+	exec->cu_next = (best + 1) % exec->num_cus;
+	exec->cu_last_used[best] = ++exec->cu_stamp;
+	SCHED_DEBUGF("<- get_free_cu returns %d\n",best);
+	return best;
 }
 
 /**
@@ -1597,7 +2500,6 @@ get_free_cu(struct xocl_cmd *xcmd)
 static void
 configure_cu(struct xocl_cmd *xcmd, int cu_idx)
 {
-	u32 i;
 	struct exec_core *exec = xcmd->exec;
 	u32 cu_addr = cu_idx_to_addr(xcmd->exec,cu_idx);
 	u32 size = regmap_size(xcmd);
@@ -1609,14 +2511,9 @@ configure_cu(struct xocl_cmd *xcmd, int cu_idx)
 	/* past header, past cumasks */
 	SCHED_DEBUG_PACKET(ecmd+1+ecmd->extra_cu_masks+1,size);
 
-	/* write register map, but skip first word (AP_START) */
-	/* can't get memcpy_toio to work */
-	/* memcpy_toio(user_bar + cu_addr + 4,ecmd->data + ecmd->extra_cu_masks + 1,(size-1)*4); */
-	for (i=1; i<size; ++i)
-		iowrite32(*(ecmd->data + ecmd->extra_cu_masks + i),exec->base + cu_addr + (i<<2));
-
-	/* start CU at base + 0x0 */
-	iowrite32(0x1,exec->base + cu_addr);
+	/* write register map but skip first word (AP_START), enable
+	 * ap_done interrupt, and start CU at base + 0x0 */
+	sched_configure_cu(&exec_core_ops,exec,cu_addr,ecmd->data + ecmd->extra_cu_masks,size,exec->cu_isr);
 
 	SCHED_DEBUG("<- configure_cu\n");
 }
@@ -1681,12 +2578,50 @@ static struct sched_ops penguin_ops = {
 	.query = penguin_query,
 };
 
+/**
+ * exec_wake_scheduler() - Wake scheduler to process pending interrupts
+ */
+static inline void
+exec_wake_scheduler(struct exec_core *exec)
+{
+	atomic_set(&exec->scheduler->intc,1);
+	wake_up_interruptible(&exec->scheduler->wait_queue);
+}
+
+/**
+ * cu_intr_timeout() - Coalescing window for CU interrupts expired
+ */
+static enum hrtimer_restart
+cu_intr_timeout(struct hrtimer *timer)
+{
+	struct exec_core *exec = container_of(timer,struct exec_core,cu_intr_timer);
+	if (atomic_xchg(&exec->cu_intr_count,0))
+		exec_wake_scheduler(exec);
+	return HRTIMER_NORESTART;
+}
+
 static irqreturn_t exec_isr(int irq, void *arg)
 {
 	struct exec_core *exec = (struct exec_core *)arg;
 
 	SCHED_DEBUGF("-> xocl_user_event %d\n",irq);
-	if (is_ert(exec) && !exec->polling_mode) {
+	if (!is_ert(exec) && exec->cu_isr && irq - exec->intr_base < exec->num_cus) {
+		int count;
+
+		set_bit(irq - exec->intr_base,exec->cu_intr_pending);
+
+		/* wake scheduler when enough interrupts are coalesced, or
+		 * when coalescing window started by first interrupt expires */
+		count = atomic_inc_return(&exec->cu_intr_count);
+		if (!cu_intr_coalesce_us || count >= cu_intr_coalesce_count) {
+			atomic_set(&exec->cu_intr_count,0);
+			exec_wake_scheduler(exec);
+		}
+		else if (count == 1)
+			hrtimer_start(&exec->cu_intr_timer,
+				      ns_to_ktime((u64)cu_intr_coalesce_us * NSEC_PER_USEC),
+				      HRTIMER_MODE_REL);
+	} else if (is_ert(exec) && !exec->polling_mode) {
 
 		if (irq==0)
 			atomic_set(&exec->sr0,1);
@@ -1697,9 +2632,8 @@ static irqreturn_t exec_isr(int irq, void *arg)
 		else if (irq==3)
 			atomic_set(&exec->sr3,1);
 
-		/* wake up all scheduler ... currently one only */
-		atomic_set(&global_scheduler0.intc,1);
-		wake_up_interruptible(&global_scheduler0.wait_queue);
+		/* wake up scheduler of this exec core */
+		exec_wake_scheduler(exec);
 	} else {
 		xocl_err(&exec->pdev->dev, "Unhandled isr irq %d, is_ert %d, "
 			"polling %d", irq, is_ert(exec), exec->polling_mode);
@@ -1721,11 +2655,25 @@ add_exec_buffer(struct platform_device *pdev, struct client_ctx *client, void *b
 	return add_cmd(exec, client, buf, numdeps, deps);
 }
 
+/**
+ * Entry point for batch of exec buffers.
+ *
+ * Function adds all exec buffers to the pending list of commands
+ */
+int
+add_exec_buffers(struct platform_device *pdev, struct client_ctx *client, struct drm_xocl_bo **bos, int num)
+{
+	struct exec_core *exec = platform_get_drvdata(pdev);
+	/* Add the commands to pending list */
+	return add_cmds(exec, client, bos, num);
+}
+
 static int create_client(struct platform_device *pdev, void **priv)
 {
 	struct client_ctx	*client;
 	struct exec_core	*exec;
 	struct xocl_dev *xdev = xocl_get_xdev(pdev);
+	int prio;
 
 	DRM_INFO("scheduler client created pid(%d)\n",pid_nr(task_tgid(current)));
 
@@ -1737,10 +2685,16 @@ static int create_client(struct platform_device *pdev, void **priv)
 	exec = platform_get_drvdata(pdev);
 
 	mutex_init(&client->lock);
+	spin_lock_init(&client->ring_lock);
+	INIT_LIST_HEAD(&client->sched_link);
+	for (prio=0; prio<XOCL_PRIORITY_LEVELS; ++prio)
+		INIT_LIST_HEAD(&client->sched_queue[prio]);
 
-	atomic_set(&client->trigger, 0);
+	client->trigger = atomic_read(&exec->poll_count);
 	atomic_set(&client->abort, 0);
 	atomic_set(&client->outstanding_execs, 0);
+	atomic64_set(&client->bo_bytes, 0);
+	atomic64_set(&client->dma_bytes, 0);
 	mutex_lock(&xdev->ctx_list_lock);
 	client->xdev = xocl_get_xdev(pdev);
 	list_add_tail(&client->link, &xdev->ctx_list);
@@ -1761,12 +2715,20 @@ static void destroy_client(struct platform_device *pdev, void **priv)
 {
 	struct client_ctx 	*client = (struct client_ctx *)(*priv);
 	struct xocl_dev         *xdev = xocl_get_xdev(pdev);
+	struct exec_core        *exec = platform_get_drvdata(pdev);
+	struct xocl_sched       *xs = exec->scheduler;
 	unsigned int            outstanding = atomic_read(&client->outstanding_execs);
 	unsigned int            timeout_loops = 20;
 	unsigned int            loops = 0;
+	struct drm_xocl_bo      *ring_bo;
 
-	/* force scheduler to abort execs for this client */
+	/* force scheduler to abort execs for this client, including commands
+	 * held back from admission */
 	atomic_set(&client->abort,1);
+	mutex_lock(&xs->clients_mutex);
+	xs->admit_stalled = 0;
+	mutex_unlock(&xs->clients_mutex);
+	wake_up_interruptible(&xs->wait_queue);
 
 	/* wait for outstanding execs to finish */
 	while (outstanding) {
@@ -1785,10 +2747,25 @@ static void destroy_client(struct platform_device *pdev, void **priv)
 
 	DRM_INFO("client exits pid(%d)\n",pid_nr(client->pid));
 
+	/* the scheduler may still have the client linked for admission,
+	 * unlink it, and free commands left after a timeout above */
+	mutex_lock(&xs->clients_mutex);
+	clear_client_queues(client);
+	mutex_unlock(&xs->clients_mutex);
+
 	mutex_lock(&xdev->ctx_list_lock);
 	list_del(&client->link);
 	mutex_unlock(&xdev->ctx_list_lock);
 
+	/* release completion ring if any */
+	spin_lock(&client->ring_lock);
+	ring_bo = client->ring_bo;
+	client->ring_bo = NULL;
+	client->ring = NULL;
+	spin_unlock(&client->ring_lock);
+	if (ring_bo)
+		drm_gem_object_unreference_unlocked(&ring_bo->base);
+
 	mutex_destroy(&client->lock);
 	devm_kfree(&pdev->dev, client);
 	*priv = NULL;
@@ -1811,13 +2788,10 @@ static uint poll_client(struct platform_device *pdev, struct file *filp,
 	 * calling poll concurrently using the same file handle
 	 */
 	mutex_lock(&client->lock);
-	counter = atomic_read(&client->trigger);
+	counter = atomic_read(&exec->poll_count) - client->trigger;
 	if (counter > 0) {
-		/*
-		 * Use atomic here since the trigger may be incremented by
-		 * interrupt handler running concurrently.
-		 */
-		atomic_dec(&client->trigger);
+		/* consume one completion, more may be notified concurrently */
+		client->trigger++;
 		ret = POLLIN;
 	}
 	mutex_unlock(&client->lock);
@@ -1855,13 +2829,16 @@ reset(struct platform_device *pdev)
 
 /**
  * validate() - Check if requested cmd is valid in the current context
+ *
+ * The CUs of the context are converted to CU masks when the context
+ * changes, see client_ctx, so only the command CU masks are read here.
  */
 static int
 validate(struct platform_device *pdev, struct client_ctx *client, const struct drm_xocl_bo *bo)
 {
 	struct ert_packet *ecmd = (struct ert_packet*)bo->vmapping;
 	struct ert_start_kernel_cmd *scmd = (struct ert_start_kernel_cmd*)bo->vmapping;
-	u32 ctx_cus[4] = {0};
+	u32 *ctx_cus = client->ctx_cus;
 	u32 cumasks = 0;
 	int i = 0;
 
@@ -1882,7 +2859,6 @@ validate(struct platform_device *pdev, struct client_ctx *client, const struct d
 
 	/* Check CUs in cmd BO against CUs in context */
 	cumasks = 1 + scmd->extra_cu_masks;
-	bitmap_to_u32array(ctx_cus,cumasks,client->cu_bitmap,MAX_CUS);
 	for (i=0; i<cumasks; ++i) {
 		uint32_t cmd_cus = ecmd->data[i];
                 /* cmd_cus must be subset of ctx_cus */
@@ -1899,6 +2875,7 @@ validate(struct platform_device *pdev, struct client_ctx *client, const struct d
 
 struct xocl_mb_scheduler_funcs sche_ops = {
 	.add_exec_buffer = add_exec_buffer,
+	.add_exec_buffers = add_exec_buffers,
 	.create_client = create_client,
 	.destroy_client = destroy_client,
 	.poll_client = poll_client,
@@ -1926,9 +2903,131 @@ kds_numcdmas_show(struct device *dev, struct device_attribute *attr, char *buf)
 }
 static DEVICE_ATTR_RO(kds_numcdmas);
 
+/* one line per client: pid outstanding queued started avg_wait_us bo_bytes dma_bytes */
+static ssize_t
+kds_clients_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct xocl_dev *xdev = dev_get_xdev(dev);
+	struct client_ctx *client;
+	ssize_t sz = 0;
+
+	if (!xdev)
+		return 0;
+
+	mutex_lock(&xdev->ctx_list_lock);
+	list_for_each_entry(client, &xdev->ctx_list, link) {
+		u64 started = client->sched_started;
+		u64 wait_us = started ? div64_u64(client->sched_wait_ns,started*NSEC_PER_USEC) : 0;
+		sz += scnprintf(buf+sz,PAGE_SIZE-sz,"%d %d %u %llu %llu %lld %lld\n",
+				pid_nr(client->pid),atomic_read(&client->outstanding_execs),
+				client->sched_queued,started,wait_us,
+				(long long)atomic64_read(&client->bo_bytes),
+				(long long)atomic64_read(&client->dma_bytes));
+	}
+	mutex_unlock(&xdev->ctx_list_lock);
+	return sz;
+}
+static DEVICE_ATTR_RO(kds_clients);
+
+/* ERT reported CU configure cycles: commands total max */
+static ssize_t
+kds_ert_cycles_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct exec_core *exec = dev_get_exec(dev);
+
+	if (!exec)
+		return 0;
+
+	return sprintf(buf,"%llu %llu %u\n",
+		       exec->ert_cycles_cmds,exec->ert_cycles_total,exec->ert_cycles_max);
+}
+static DEVICE_ATTR_RO(kds_ert_cycles);
+
+/* one line per CU: cu_idx timeouts count per latency bucket, see cu_latency_bucket() */
+static ssize_t
+kds_cu_latency_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct exec_core *exec = dev_get_exec(dev);
+	unsigned int cu_idx, bucket;
+	ssize_t sz = 0;
+
+	if (!exec)
+		return 0;
+
+	for (cu_idx=0; cu_idx<exec->num_cus; ++cu_idx) {
+		sz += scnprintf(buf+sz,PAGE_SIZE-sz,"%u %u",cu_idx,exec->cu_timeouts[cu_idx]);
+		for (bucket=0; bucket<CU_LATENCY_BUCKETS; ++bucket)
+			sz += scnprintf(buf+sz,PAGE_SIZE-sz," %u",exec->cu_latency[cu_idx][bucket]);
+		sz += scnprintf(buf+sz,PAGE_SIZE-sz,"\n");
+	}
+	return sz;
+}
+static DEVICE_ATTR_RO(kds_cu_latency);
+
+/* one line per CU: cu_idx running completed busy_us, see mark_cmd_complete() */
+static ssize_t
+kds_custat_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct exec_core *exec = dev_get_exec(dev);
+	unsigned int cu_idx;
+	ssize_t sz = 0;
+
+	if (!exec)
+		return 0;
+
+	for (cu_idx=0; cu_idx<exec->num_cus; ++cu_idx)
+		sz += scnprintf(buf+sz,PAGE_SIZE-sz,"%u %u %llu %llu\n",cu_idx,
+				exec->cu_running[cu_idx],exec->cu_usage[cu_idx],
+				div_u64(exec->cu_busy_ns[cu_idx],NSEC_PER_USEC));
+	return sz;
+}
+static DEVICE_ATTR_RO(kds_custat);
+
+/* one line per CU: cu_idx deadline_ms, write <cu_idx:deadline_ms> to set, 0 for module default */
+static ssize_t
+kds_cu_timeout_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct exec_core *exec = dev_get_exec(dev);
+	unsigned int cu_idx;
+	ssize_t sz = 0;
+
+	if (!exec)
+		return 0;
+
+	for (cu_idx=0; cu_idx<exec->num_cus; ++cu_idx) {
+		u32 timeout_ms = exec->cu_timeout_ms[cu_idx];
+		sz += scnprintf(buf+sz,PAGE_SIZE-sz,"%u %u\n",cu_idx,timeout_ms ? timeout_ms : cmd_timeout_ms);
+	}
+	return sz;
+}
+
+static ssize_t
+kds_cu_timeout_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct exec_core *exec = dev_get_exec(dev);
+	u32 cu_idx, timeout_ms;
+
+	if (!exec)
+		return -ENODEV;
+
+	if (sscanf(buf,"%u:%u",&cu_idx,&timeout_ms)!=2 || cu_idx>=MAX_CUS) {
+		DRM_ERROR("input should be <cu_idx:deadline_ms>\n");
+		return -EINVAL;
+	}
+
+	exec->cu_timeout_ms[cu_idx] = timeout_ms;
+	return count;
+}
+static DEVICE_ATTR_RW(kds_cu_timeout);
+
 static struct attribute *kds_sysfs_attrs[] = {
 	&dev_attr_kds_numcus.attr,
 	&dev_attr_kds_numcdmas.attr,
+	&dev_attr_kds_clients.attr,
+	&dev_attr_kds_ert_cycles.attr,
+	&dev_attr_kds_cu_latency.attr,
+	&dev_attr_kds_custat.attr,
+	&dev_attr_kds_cu_timeout.attr,
 	NULL
 };
 
@@ -1951,6 +3050,9 @@ user_sysfs_create_kds(struct platform_device *pdev)
 	return err;
 }
 
+/* number of schedulers created, used to name scheduler threads */
+static atomic_t scheduler_count = ATOMIC_INIT(0);
+
 /**
  * Init scheduler
  */
@@ -1980,8 +3082,15 @@ static int mb_scheduler_probe(struct platform_device *pdev)
 
 	exec->pdev = pdev;
 	init_waitqueue_head(&exec->poll_wait_queue);
+	hrtimer_init(&exec->cu_intr_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	exec->cu_intr_timer.function = cu_intr_timeout;
 
-	exec->scheduler = &global_scheduler0;
+	exec->scheduler = devm_kzalloc(&pdev->dev, sizeof(*exec->scheduler), GFP_KERNEL);
+	if (!exec->scheduler)
+		goto err_sysfs;
+	exec->scheduler->exec = exec;
+	if (init_scheduler_thread(exec->scheduler, atomic_inc_return(&scheduler_count) - 1))
+		goto err_sysfs;
 
 	for (i = 0; i < exec->intr_num; i++) {
 		xocl_user_interrupt_reg(xdev, i + exec->intr_base,
@@ -1989,7 +3098,6 @@ static int mb_scheduler_probe(struct platform_device *pdev)
 		xocl_user_interrupt_config(xdev, i + exec->intr_base, true);
 	}
 
-	init_scheduler_thread();
 	reset_exec(exec);
 
 	xocl_subdev_register(pdev, XOCL_SUBDEV_MB_SCHEDULER, &sche_ops);
@@ -1999,6 +3107,10 @@ static int mb_scheduler_probe(struct platform_device *pdev)
 
 	return 0;
 
+err_sysfs:
+	user_sysfs_destroy_kds(pdev);
+	if (exec->scheduler)
+		devm_kfree(&pdev->dev, exec->scheduler);
 err:
 	devm_kfree(&pdev->dev, exec);
 	return 1;
@@ -2014,7 +3126,7 @@ static int mb_scheduler_remove(struct platform_device *pdev)
 	struct exec_core *exec = platform_get_drvdata(pdev);
 
 	SCHED_DEBUG("-> mb_scheduler_remove\n");
-	fini_scheduler_thread();
+	fini_scheduler_thread(exec->scheduler);
 
 	xdev = xocl_get_xdev(pdev);
 	for (i = 0; i < exec->intr_num; i++) {
@@ -2022,7 +3134,9 @@ static int mb_scheduler_remove(struct platform_device *pdev)
 			NULL, NULL);
 		xocl_user_interrupt_config(xdev, i + exec->intr_base, false);
 	}
+	hrtimer_cancel(&exec->cu_intr_timer);
 	user_sysfs_destroy_kds(pdev);
+	devm_kfree(&pdev->dev, exec->scheduler);
 	devm_kfree(&pdev->dev, exec);
 	platform_set_drvdata(pdev, NULL);
 
@@ -2047,12 +3161,22 @@ static struct platform_driver	mb_scheduler_driver = {
 
 int __init xocl_init_mb_scheduler(void)
 {
-	return platform_driver_register(&mb_scheduler_driver);
+	int err;
+
+	xocl_cmd_cache = KMEM_CACHE(xocl_cmd,0);
+	if (!xocl_cmd_cache)
+		return -ENOMEM;
+
+	err = platform_driver_register(&mb_scheduler_driver);
+	if (err)
+		kmem_cache_destroy(xocl_cmd_cache);
+	return err;
 }
 
 void xocl_fini_mb_scheduler(void)
 {
 	SCHED_DEBUG("-> xocl_fini_mb_scheduler\n");
 	platform_driver_unregister(&mb_scheduler_driver);
+	kmem_cache_destroy(xocl_cmd_cache);
 	SCHED_DEBUG("<- xocl_fini_mb_scheduler\n");
 }
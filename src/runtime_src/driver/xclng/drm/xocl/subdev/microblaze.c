@@ -35,6 +35,19 @@
 #define	REG_STOP_CONFIRM	0x1C
 #define	REG_CURR_BASE		0x20
 #define	REG_POWER_CHECKSUM	0x1A4
+#define	REG_SENSOR_BLOCK	0x200
+
+/* board_mon register indices, see ert/management/board_mon.c */
+#define	MB_NUM_REGS		35
+#define	MB_REG_STATUS		2
+#define	MB_REG_ERR		3
+#define	MB_REG_CAP		4
+#define	MB_REG_CURR		7
+#define	MB_REG_POWER_CHECKSUM	34
+
+#define	SENSOR_BLOCK_MAGIC	0x534E5342
+#define	SENSOR_BLOCK_VERSION	1
+#define	SENSOR_BLOCK_RETRY	3
 
 #define	VALID_ID		0x74736574
 
@@ -58,6 +71,19 @@ enum status_mask {
 
 enum cap_mask {
 	CAP_MASK_PM			= 0x1,
+	CAP_MASK_SENSOR_BLOCK		= 0x8,
+};
+
+/*
+ * Copy of all board_mon registers published by the firmware, value[i]
+ * is register i.  Consistent if seq_head equals seq_tail and is even.
+ */
+struct mb_sensor_block {
+	u32	magic;
+	u32	version;	/* version in bits 15:0, count in 31:16 */
+	u32	seq_head;
+	u32	value[MB_NUM_REGS];
+	u32	seq_tail;
 };
 
 enum {
@@ -251,6 +277,83 @@ static ssize_t reset_store(struct device *dev,
 }
 static DEVICE_ATTR_WO(reset);
 
+/*
+ * Read all registers with one burst from the sensor block, retried if
+ * the firmware updated the block during the read.  Caller holds mb_lock.
+ */
+static int mb_read_sensor_block(struct xocl_mb *mb, struct mb_sensor_block *blk)
+{
+	int retry;
+
+	if (!(mb->cap & CAP_MASK_SENSOR_BLOCK))
+		return -ENODEV;
+
+	for (retry = 0; retry < SENSOR_BLOCK_RETRY; retry++) {
+		memcpy_fromio(blk, mb->base_addrs[IO_REG] + REG_SENSOR_BLOCK,
+			sizeof(*blk));
+		if (blk->magic != SENSOR_BLOCK_MAGIC ||
+			blk->version != (SENSOR_BLOCK_VERSION | (MB_NUM_REGS << 16)))
+			return -EINVAL;
+		if (blk->seq_head == blk->seq_tail && !(blk->seq_head & 1))
+			return 0;
+	}
+
+	return -EAGAIN;
+}
+
+static const char * const mb_supplies[] = {
+	"vccint", "vcc1v8", "vcc1v2", "vccbram", "mgtavcc", "mgtavtt",
+	"12v_pex", "12v_aux", "3v3_pex",
+};
+
+/*
+ * All sensors in one read, "<name> <value>" per line.  Uses the sensor
+ * block of firmware that has one, else reads the registers one by one.
+ */
+static ssize_t sensors_raw_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct xocl_mb *mb = platform_get_drvdata(to_platform_device(dev));
+	struct mb_sensor_block blk;
+	ssize_t count = 0;
+	int i;
+
+	memset(&blk, 0, sizeof(blk));
+	mutex_lock(&mb->mb_lock);
+	if (mb->enabled && mb->state != MB_STATE_RESET &&
+		mb_read_sensor_block(mb, &blk)) {
+		blk.value[MB_REG_STATUS] = READ_REG32(mb, REG_STATUS);
+		blk.value[MB_REG_ERR] = READ_REG32(mb, REG_ERR);
+		blk.value[MB_REG_CAP] = READ_REG32(mb, REG_CAP);
+		for (i = 0; i < ARRAY_SIZE(mb_supplies) * 3; i++) {
+			blk.value[MB_REG_CURR + i] = READ_REG32(mb,
+				REG_CURR_BASE + i * sizeof(u32));
+		}
+		blk.value[MB_REG_POWER_CHECKSUM] =
+			READ_REG32(mb, REG_POWER_CHECKSUM);
+	}
+	mutex_unlock(&mb->mb_lock);
+
+	count += sprintf(buf + count, "status %x\n", blk.value[MB_REG_STATUS]);
+	count += sprintf(buf + count, "error %x\n", blk.value[MB_REG_ERR]);
+	count += sprintf(buf + count, "capability %x\n", blk.value[MB_REG_CAP]);
+	for (i = 0; i < ARRAY_SIZE(mb_supplies); i++) {
+		u32 *curr = &blk.value[MB_REG_CURR + i * 3];
+
+		count += sprintf(buf + count, "%s_curr_highest %d\n",
+			mb_supplies[i], curr[0]);
+		count += sprintf(buf + count, "%s_curr_average %d\n",
+			mb_supplies[i], curr[1]);
+		count += sprintf(buf + count, "%s_curr_input %d\n",
+			mb_supplies[i], curr[2]);
+	}
+	count += sprintf(buf + count, "power_checksum %d\n",
+		blk.value[MB_REG_POWER_CHECKSUM]);
+
+	return count;
+}
+static DEVICE_ATTR_RO(sensors_raw);
+
 static struct attribute *mb_attrs[] = {
 	&dev_attr_version.attr,
 	&dev_attr_id.attr,
@@ -260,6 +363,7 @@ static struct attribute *mb_attrs[] = {
 	&dev_attr_power_checksum.attr,
 	&dev_attr_pause.attr,
 	&dev_attr_reset.attr,
+	&dev_attr_sensors_raw.attr,
 	NULL,
 };
 static struct attribute_group mb_attr_group = {
@@ -34,6 +34,9 @@
 #define VM_RESERVED (VM_DONTEXPAND | VM_DONTDUMP)
 #endif
 
+/* fewest channels for which one is reserved for small transfers */
+#define	MM_FAST_LANE_MIN_CHANNELS	4
+
 #define	MM_QUEUE_LEN		8
 #define	MM_EBUF_LEN		256
 
@@ -41,13 +44,20 @@ struct xocl_mm_device {
 	struct platform_device	*pdev;
 	/* Number of bidirectional channels */
 	u32			channel;
-	/* Semaphore, one for each direction */
-	struct semaphore	channel_sem[2];
 	/*
-	 * Channel usage bitmasks, one for each direction
-	 * bit 1 indicates channel is free, bit 0 indicates channel is free
+	 * Channels below fast_lane serve any transfer, the channels from
+	 * fast_lane up are reserved for small transfers
+	 */
+	u32			fast_lane;
+	/* FIFO of waiters for a channel, one per lane and direction */
+	wait_queue_head_t	small_wq[2];
+	wait_queue_head_t	large_wq[2];
+	/*
+	 * Channel usage bitmasks, one for each direction, bit 1 indicates
+	 * channel is free.  Only changed with atomic bitops, there may be
+	 * a queue pair per CPU and acquiring one takes no lock.
 	 */
-	volatile unsigned long	channel_bitmap[2];
+	unsigned long		*channel_bitmap[2];
 
 	struct mm_channel	*chans[2];
 
@@ -59,6 +69,8 @@ struct mm_channel {
 	struct xocl_mm_device	*mm_dev;
 	struct qdma_wq		queue;
 	uint64_t		total_trans_bytes;
+	/* Nanoseconds acquirers queued before getting the channel */
+	uint64_t		total_wait_ns;
 };
 
 /* sysfs */
@@ -214,7 +226,8 @@ failed:
 /* end of sysfs */
 
 static ssize_t qdma_migrate_bo(struct platform_device *pdev,
-	struct sg_table *sgt, u32 write, u64 paddr, u32 channel, u64 len)
+	struct sg_table *sgt, u32 write, u64 paddr, u32 channel, u64 len,
+	bool dma_mapped)
 {
 	struct mm_channel *chan;
 	struct xocl_mm_device *mdev;
@@ -239,15 +252,20 @@ static ssize_t qdma_migrate_bo(struct platform_device *pdev,
 	chan = &mdev->chans[write][channel];
 
 	dir = write ? DMA_TO_DEVICE : DMA_FROM_DEVICE; 
-	nents = pci_map_sg(xdev->core.pdev, sgt->sgl, sgt->orig_nents, dir);
-        if (!nents) {
-		xocl_err(&pdev->dev, "map sgl failed, sgt 0x%p.\n", sgt);
-		return -EIO;
+	if (!dma_mapped) {
+		nents = pci_map_sg(xdev->core.pdev, sgt->sgl, sgt->orig_nents,
+			dir);
+		if (!nents) {
+			xocl_err(&pdev->dev, "map sgl failed, sgt 0x%p.\n",
+				sgt);
+			return -EIO;
+		}
+		sgt->nents = nents;
 	}
-	sgt->nents = nents;
 
 	ret = qdma_wq_post(&chan->queue, &wr);
-	pci_unmap_sg(xdev->core.pdev, sgt->sgl, nents, dir);
+	if (!dma_mapped)
+		pci_unmap_sg(xdev->core.pdev, sgt->sgl, nents, dir);
 
 	if (ret >= 0) {
 		chan->total_trans_bytes += ret;
@@ -259,44 +277,84 @@ static ssize_t qdma_migrate_bo(struct platform_device *pdev,
 	return ret;
 }
 
+/*
+ * Take a free channel usable by the lane, -1 if there is none. @hint is
+ * tried first, else the queue pair of the submitting CPU, so concurrent
+ * submitters on different CPUs do not contend.  Small transfers then
+ * prefer the fast lane to leave the shared channels to large ones.
+ */
+static int grab_channel(struct xocl_mm_device *mdev, u32 dir, int hint,
+	bool small)
+{
+	u32 limit = small ? mdev->channel : mdev->fast_lane;
+	unsigned long *bitmap = mdev->channel_bitmap[dir];
+	int channel;
+
+	if (!limit)
+		return -1;
+
+	if (hint < 0)
+		hint = raw_smp_processor_id() % limit;
+	else if (hint >= limit)
+		hint %= limit;
+	if (test_and_clear_bit(hint, bitmap))
+		return hint;
+
+	if (small && mdev->fast_lane < mdev->channel &&
+		test_and_clear_bit(mdev->fast_lane, bitmap))
+		return mdev->fast_lane;
+
+	for_each_set_bit(channel, bitmap, limit) {
+		if (test_and_clear_bit(channel, bitmap))
+			return channel;
+	}
+
+	return -1;
+}
+
 static void release_channel(struct platform_device *pdev, u32 dir, u32 channel)
 {
 	struct xocl_mm_device *mdev;
 
-
 	mdev = platform_get_drvdata(pdev);
-        set_bit(channel, &mdev->channel_bitmap[dir]);
-        up(&mdev->channel_sem[dir]);
+	set_bit(channel, mdev->channel_bitmap[dir]);
+	/* pairs with the barrier of a waiter queueing before it retries */
+	smp_mb__after_atomic();
+
+	/* small transfers go first, only they can take the fast lane */
+	if (channel >= mdev->fast_lane || waitqueue_active(&mdev->small_wq[dir]))
+		wake_up(&mdev->small_wq[dir]);
+	else
+		wake_up(&mdev->large_wq[dir]);
 }
 
-static int acquire_channel(struct platform_device *pdev, u32 dir)
+static int acquire_channel(struct platform_device *pdev, u32 dir, int hint,
+	bool small)
 {
 	struct xocl_mm_device *mdev;
-	int channel = 0;
-	int result = 0;
+	wait_queue_head_t *wq;
+	int channel = -1;
 	u32 write;
+	ktime_t start;
 
 	mdev = platform_get_drvdata(pdev);
+	wq = small ? &mdev->small_wq[dir] : &mdev->large_wq[dir];
+	start = ktime_get();
 
-	if (down_interruptible(&mdev->channel_sem[dir])) {
-		channel = -ERESTARTSYS;
-		goto out;
-	}
-
-	for (channel = 0; channel < mdev->channel; channel++) {
-		result = test_and_clear_bit(channel,
-			&mdev->channel_bitmap[dir]);
-		if (result)
-			break;
-        }
-        if (!result) {
-		// How is this possible?
-		up(&mdev->channel_sem[dir]);
-		channel = -EIO;
-		goto out;
-	}
+	/*
+	 * Queue behind earlier waiters of the lane instead of barging, so a
+	 * transfer releasing its channel between slices goes to the back
+	 */
+	if (!waitqueue_active(wq))
+		channel = grab_channel(mdev, dir, hint, small);
+	if (channel < 0 && wait_event_interruptible_exclusive(*wq,
+		(channel = grab_channel(mdev, dir, hint, small)) >= 0))
+		return -ERESTARTSYS;
 
 	write = dir ? 1 : 0;
+	/* caller owns the channel, no other writer of its counters */
+	mdev->chans[write][channel].total_wait_ns +=
+		ktime_to_ns(ktime_sub(ktime_get(), start));
 
 	if (!(mdev->chans[write][channel].queue.flag &
 		QDMA_WQ_QUEUE_STARTED)) {
@@ -304,7 +362,7 @@ static int acquire_channel(struct platform_device *pdev, u32 dir)
 		release_channel(pdev, dir, channel);
 		channel = -EINVAL;
 	}
-out:
+
 	return channel;
 }
 
@@ -335,6 +393,8 @@ static void free_channels(struct platform_device *pdev)
 	}
 	devm_kfree(&pdev->dev, mdev->chans[0]);
 	devm_kfree(&pdev->dev, mdev->chans[1]);
+	devm_kfree(&pdev->dev, mdev->channel_bitmap[0]);
+	devm_kfree(&pdev->dev, mdev->channel_bitmap[1]);
 }
 
 static int set_max_chan(struct platform_device *pdev, u32 count)
@@ -350,13 +410,25 @@ static int set_max_chan(struct platform_device *pdev, u32 count)
 	mdev = platform_get_drvdata(pdev);
 	mdev->channel = count;
 
-	sema_init(&mdev->channel_sem[0], mdev->channel);
-	sema_init(&mdev->channel_sem[1], mdev->channel);
+	/*
+	 * Keep the last channel for small transfers only if enough channels
+	 * remain for bulk transfers, with 2 or 3 channels reserving one
+	 * costs large transfers half or a third of their bandwidth
+	 */
+	mdev->fast_lane = (mdev->channel >= MM_FAST_LANE_MIN_CHANNELS) ?
+		mdev->channel - 1 : mdev->channel;
 
 	/* Initialize bit mask to represent individual channels */
-	mdev->channel_bitmap[0] = BIT(mdev->channel);
-	mdev->channel_bitmap[0]--;
-	mdev->channel_bitmap[1] = mdev->channel_bitmap[0];
+	mdev->channel_bitmap[0] = devm_kcalloc(&pdev->dev,
+		BITS_TO_LONGS(mdev->channel), sizeof (long), GFP_KERNEL);
+	mdev->channel_bitmap[1] = devm_kcalloc(&pdev->dev,
+		BITS_TO_LONGS(mdev->channel), sizeof (long), GFP_KERNEL);
+	if (!mdev->channel_bitmap[0] || !mdev->channel_bitmap[1]) {
+		xocl_err(&pdev->dev, "Alloc channel bitmap failed");
+		return -ENOMEM;
+	}
+	bitmap_fill(mdev->channel_bitmap[0], mdev->channel);
+	bitmap_fill(mdev->channel_bitmap[1], mdev->channel);
 
 	xdev = xocl_get_xdev(pdev);
 
@@ -439,6 +511,55 @@ static struct xocl_mm_dma_funcs mm_ops = {
 	.get_chan_stat = get_channel_stat,
 };
 
+static ssize_t channel_stat_raw_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	u32 i;
+	ssize_t nbytes = 0;
+	struct platform_device *pdev = to_platform_device(dev);
+	u32 chs = get_channel_count(pdev);
+
+	for (i = 0; i < chs; i++) {
+		nbytes += sprintf(buf + nbytes, "%llu %llu\n",
+			get_channel_stat(pdev, i, 0),
+			get_channel_stat(pdev, i, 1));
+	}
+	return nbytes;
+}
+static DEVICE_ATTR_RO(channel_stat_raw);
+
+/* Nanoseconds queued for each channel, C2H and H2C, one line per channel */
+static ssize_t channel_wait_raw_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	u32 i;
+	ssize_t nbytes = 0;
+	struct platform_device *pdev = to_platform_device(dev);
+	struct xocl_mm_device *mdev = platform_get_drvdata(pdev);
+	u32 chs = get_channel_count(pdev);
+
+	if (!mdev->chans[0] || !mdev->chans[1])
+		return 0;
+
+	for (i = 0; i < chs; i++) {
+		nbytes += sprintf(buf + nbytes, "%llu %llu\n",
+			mdev->chans[0][i].total_wait_ns,
+			mdev->chans[1][i].total_wait_ns);
+	}
+	return nbytes;
+}
+static DEVICE_ATTR_RO(channel_wait_raw);
+
+static struct attribute *qdma_attrs[] = {
+	&dev_attr_channel_stat_raw.attr,
+	&dev_attr_channel_wait_raw.attr,
+	NULL,
+};
+
+static struct attribute_group qdma_attr_group = {
+	.attrs = qdma_attrs,
+};
+
 static int mm_dma_probe(struct platform_device *pdev)
 {
 	struct xocl_mm_device	*mdev = NULL;
@@ -452,7 +573,17 @@ static int mm_dma_probe(struct platform_device *pdev)
 		goto failed;
 	}
 
+	ret = sysfs_create_group(&pdev->dev.kobj, &qdma_attr_group);
+	if (ret) {
+		xocl_err(&pdev->dev, "create attrs failed: %d", ret);
+		goto failed;
+	}
+
 	mutex_init(&mdev->stat_lock);
+	init_waitqueue_head(&mdev->small_wq[0]);
+	init_waitqueue_head(&mdev->small_wq[1]);
+	init_waitqueue_head(&mdev->large_wq[0]);
+	init_waitqueue_head(&mdev->large_wq[1]);
 	mdev->pdev = pdev;
 
 	xocl_subdev_register(pdev, XOCL_SUBDEV_MM_DMA, &mm_ops);
@@ -479,6 +610,7 @@ static int mm_dma_remove(struct platform_device *pdev)
 		return -EINVAL;
 	}
 
+	sysfs_remove_group(&pdev->dev.kobj, &qdma_attr_group);
 	free_channels(pdev);
 
 	mutex_destroy(&mdev->stat_lock);
@@ -33,23 +33,39 @@
 #define VM_RESERVED (VM_DONTEXPAND | VM_DONTDUMP)
 #endif
 
+/* fewest channels for which one is reserved for small transfers */
+#define	MM_FAST_LANE_MIN_CHANNELS	4
+
 struct xocl_mm_device {
 	/* Number of bidirectional channels */
 	u32			channel;
-	/* Semaphore, one for each direction */
-	struct semaphore	channel_sem[2];
+	/*
+	 * Channels below fast_lane serve any transfer, the channels from
+	 * fast_lane up are reserved for small transfers
+	 */
+	u32			fast_lane;
+	/* Protects channel_bitmap */
+	spinlock_t		channel_lock;
+	/* FIFO of waiters for a channel, one per lane and direction */
+	wait_queue_head_t	small_wq[2];
+	wait_queue_head_t	large_wq[2];
 	/*
 	 * Channel usage bitmasks, one for each direction
 	 * bit 1 indicates channel is free, bit 0 indicates channel is free
 	 */
 	volatile unsigned long	channel_bitmap[2];
 	unsigned long long	*channel_usage[2];
+	/* Nanoseconds each channel spent transferring, one for each direction */
+	unsigned long long	*channel_busy[2];
+	/* Nanoseconds acquirers queued before getting each channel */
+	unsigned long long	*channel_wait[2];
 
 	struct mutex		stat_lock;
 };
 
 static ssize_t xdma_migrate_bo(struct platform_device *pdev,
-	struct sg_table *sgt, u32 dir, u64 paddr, u32 channel, u64 len)
+	struct sg_table *sgt, u32 dir, u64 paddr, u32 channel, u64 len,
+	bool dma_mapped)
 {
 	struct xocl_mm_device *mdev;
 	struct xocl_dev *xdev;
@@ -60,13 +76,18 @@ static ssize_t xdma_migrate_bo(struct platform_device *pdev,
 	int i = 0;
 	ssize_t ret;
 	unsigned long long pgaddr;
+	ktime_t start;
 
 	mdev = platform_get_drvdata(pdev);
 	xocl_dbg(&pdev->dev, "TID %d, Channel:%d, Offset: 0x%llx, Dir: %d",
 		pid, channel, paddr, dir);
 	xdev = xocl_get_xdev(pdev);
+	start = ktime_get();
 	ret = xdma_xfer_submit(xdev->dma_handle, channel, dir,
-		paddr, sgt, false, 10000);
+		paddr, sgt, dma_mapped, 10000);
+	/* caller owns the channel, no other writer of its counters */
+	mdev->channel_busy[dir][channel] +=
+		ktime_to_ns(ktime_sub(ktime_get(), start));
 	if (ret >= 0) {
 		mdev->channel_usage[dir][channel] += ret;
 		return ret;
@@ -85,42 +106,111 @@ static ssize_t xdma_migrate_bo(struct platform_device *pdev,
 	return ret;
 }
 
-static int acquire_channel(struct platform_device *pdev, u32 dir)
+/* One descriptor chain, entry i of the mapped @sgt goes to paddrs[i] */
+static ssize_t xdma_migrate_bo_v(struct platform_device *pdev,
+	struct sg_table *sgt, u32 dir, const u64 *paddrs, u32 channel, u64 len)
 {
 	struct xocl_mm_device *mdev;
-	int channel = 0;
-	int result = 0;
+	struct xocl_dev *xdev;
+	ssize_t ret;
+	ktime_t start;
 
 	mdev = platform_get_drvdata(pdev);
-	if (down_interruptible(&mdev->channel_sem[dir])) {
-		channel = -ERESTARTSYS;
-		goto out;
-	}
+	xocl_dbg(&pdev->dev, "TID %d, Channel:%d, Ranges: %d, Dir: %d",
+		current->pid, channel, sgt->nents, dir);
+	xdev = xocl_get_xdev(pdev);
+	start = ktime_get();
+	ret = xdma_xfer_submit_v(xdev->dma_handle, channel, dir,
+		paddrs, sgt, 10000);
+	mdev->channel_busy[dir][channel] +=
+		ktime_to_ns(ktime_sub(ktime_get(), start));
+	if (ret >= 0)
+		mdev->channel_usage[dir][channel] += ret;
+	else
+		xocl_err(&pdev->dev, "DMA of %d ranges failed %zd",
+			sgt->nents, ret);
+	return ret;
+}
 
-	for (channel = 0; channel < mdev->channel; channel++) {
-		result = test_and_clear_bit(channel,
-			&mdev->channel_bitmap[dir]);
-		if (result)
-			break;
-        }
-        if (!result) {
-		// How is this possible?
-		up(&mdev->channel_sem[dir]);
-		channel = -EIO;
+/*
+ * Take a free channel usable by the lane, -1 if there is none. @hint is
+ * tried first, folded onto the shared channels for large transfers, small
+ * transfers then prefer the fast lane to leave the shared channels to
+ * large ones.
+ */
+static int grab_channel(struct xocl_mm_device *mdev, u32 dir, int hint,
+	bool small)
+{
+	u32 limit = small ? mdev->channel : mdev->fast_lane;
+	int channel = -1;
+
+	/* a large transfer hinted at the fast lane keeps a fixed channel */
+	if (hint >= 0 && limit && hint >= limit)
+		hint %= limit;
+
+	spin_lock(&mdev->channel_lock);
+	if (hint >= 0 && hint < limit &&
+		test_bit(hint, &mdev->channel_bitmap[dir]))
+		channel = hint;
+	else if (small && mdev->fast_lane < mdev->channel &&
+		test_bit(mdev->fast_lane, &mdev->channel_bitmap[dir]))
+		channel = mdev->fast_lane;
+	else {
+		channel = find_first_bit(
+			(unsigned long *)&mdev->channel_bitmap[dir], limit);
+		if (channel >= limit)
+			channel = -1;
 	}
+	if (channel >= 0)
+		clear_bit(channel, &mdev->channel_bitmap[dir]);
+	spin_unlock(&mdev->channel_lock);
 
-out:
 	return channel;
 }
 
-static void release_channel(struct platform_device *pdev, u32 dir, u32 channel)
+static int acquire_channel(struct platform_device *pdev, u32 dir, int hint,
+	bool small)
 {
 	struct xocl_mm_device *mdev;
+	wait_queue_head_t *wq;
+	int channel = -1;
+	ktime_t start;
+
+	mdev = platform_get_drvdata(pdev);
+	wq = small ? &mdev->small_wq[dir] : &mdev->large_wq[dir];
+	start = ktime_get();
+
+	/*
+	 * Queue behind earlier waiters of the lane instead of barging, so a
+	 * transfer releasing its channel between slices goes to the back
+	 */
+	if (!waitqueue_active(wq))
+		channel = grab_channel(mdev, dir, hint, small);
+	if (channel < 0 && wait_event_interruptible_exclusive(*wq,
+		(channel = grab_channel(mdev, dir, hint, small)) >= 0))
+		return -ERESTARTSYS;
+
+	/* caller owns the channel, no other writer of its counters */
+	mdev->channel_wait[dir][channel] +=
+		ktime_to_ns(ktime_sub(ktime_get(), start));
 
+	return channel;
+}
+
+static void release_channel(struct platform_device *pdev, u32 dir, u32 channel)
+{
+	struct xocl_mm_device *mdev;
 
 	mdev = platform_get_drvdata(pdev);
-        set_bit(channel, &mdev->channel_bitmap[dir]);
-        up(&mdev->channel_sem[dir]);
+	spin_lock(&mdev->channel_lock);
+	set_bit(channel, &mdev->channel_bitmap[dir]);
+	spin_unlock(&mdev->channel_lock);
+
+	/* small transfers go first, only they can take the fast lane */
+	if (channel >= mdev->fast_lane || waitqueue_active(&mdev->small_wq[dir]))
+		wake_up(&mdev->small_wq[dir]);
+	else
+		wake_up(&mdev->large_wq[dir]);
 }
 
 static int set_max_chan(struct platform_device *pdev, u32 count)
@@ -139,8 +229,31 @@ static int set_max_chan(struct platform_device *pdev, u32 count)
 		return -ENOMEM;
 	}
 
-	sema_init(&mdev->channel_sem[0], mdev->channel);
-	sema_init(&mdev->channel_sem[1], mdev->channel);
+	mdev->channel_busy[0] = devm_kzalloc(&pdev->dev, sizeof (u64) *
+		mdev->channel, GFP_KERNEL);
+	mdev->channel_busy[1] = devm_kzalloc(&pdev->dev, sizeof (u64) *
+		mdev->channel, GFP_KERNEL);
+	if (!mdev->channel_busy[0] || !mdev->channel_busy[1]) {
+		xocl_err(&pdev->dev, "failed to alloc channel busy time");
+		return -ENOMEM;
+	}
+
+	mdev->channel_wait[0] = devm_kzalloc(&pdev->dev, sizeof (u64) *
+		mdev->channel, GFP_KERNEL);
+	mdev->channel_wait[1] = devm_kzalloc(&pdev->dev, sizeof (u64) *
+		mdev->channel, GFP_KERNEL);
+	if (!mdev->channel_wait[0] || !mdev->channel_wait[1]) {
+		xocl_err(&pdev->dev, "failed to alloc channel wait time");
+		return -ENOMEM;
+	}
+
+	/*
+	 * Keep the last channel for small transfers only if enough channels
+	 * remain for bulk transfers, with 2 or 3 channels reserving one
+	 * costs large transfers half or a third of their bandwidth
+	 */
+	mdev->fast_lane = (mdev->channel >= MM_FAST_LANE_MIN_CHANNELS) ?
+		mdev->channel - 1 : mdev->channel;
 
 	/* Initialize bit mask to represent individual channels */
 	mdev->channel_bitmap[0] = BIT(mdev->channel);
@@ -173,6 +286,7 @@ static u64 get_channel_stat(struct platform_device *pdev, u32 channel,
 
 static struct xocl_mm_dma_funcs mm_ops = {
 	.migrate_bo = xdma_migrate_bo,
+	.migrate_bo_v = xdma_migrate_bo_v,
 	.ac_chan = acquire_channel,
 	.rel_chan = release_channel,
 	.set_max_chan = set_max_chan,
@@ -197,8 +311,52 @@ static ssize_t channel_stat_raw_show(struct device *dev,
 }
 static DEVICE_ATTR_RO(channel_stat_raw);
 
+/* Busy nanoseconds of each channel, C2H and H2C, one line per channel */
+static ssize_t channel_busy_raw_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	u32 i;
+	ssize_t nbytes = 0;
+	struct platform_device *pdev = to_platform_device(dev);
+	struct xocl_mm_device *mdev = platform_get_drvdata(pdev);
+	u32 chs = get_channel_count(pdev);
+
+	if (!mdev->channel_busy[0] || !mdev->channel_busy[1])
+		return 0;
+
+	for (i = 0; i < chs; i++) {
+		nbytes += sprintf(buf + nbytes, "%llu %llu\n",
+			mdev->channel_busy[0][i], mdev->channel_busy[1][i]);
+	}
+	return nbytes;
+}
+static DEVICE_ATTR_RO(channel_busy_raw);
+
+/* Nanoseconds queued for each channel, C2H and H2C, one line per channel */
+static ssize_t channel_wait_raw_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	u32 i;
+	ssize_t nbytes = 0;
+	struct platform_device *pdev = to_platform_device(dev);
+	struct xocl_mm_device *mdev = platform_get_drvdata(pdev);
+	u32 chs = get_channel_count(pdev);
+
+	if (!mdev->channel_wait[0] || !mdev->channel_wait[1])
+		return 0;
+
+	for (i = 0; i < chs; i++) {
+		nbytes += sprintf(buf + nbytes, "%llu %llu\n",
+			mdev->channel_wait[0][i], mdev->channel_wait[1][i]);
+	}
+	return nbytes;
+}
+static DEVICE_ATTR_RO(channel_wait_raw);
+
 static struct attribute *xdma_attrs[] = {
 	&dev_attr_channel_stat_raw.attr,
+	&dev_attr_channel_busy_raw.attr,
+	&dev_attr_channel_wait_raw.attr,
 	NULL,
 };
 
@@ -230,6 +388,11 @@ static int mm_dma_probe(struct platform_device *pdev)
 	}
 
 	mutex_init(&mdev->stat_lock);
+	spin_lock_init(&mdev->channel_lock);
+	init_waitqueue_head(&mdev->small_wq[0]);
+	init_waitqueue_head(&mdev->small_wq[1]);
+	init_waitqueue_head(&mdev->large_wq[0]);
+	init_waitqueue_head(&mdev->large_wq[1]);
 
 	xocl_subdev_register(pdev, XOCL_SUBDEV_MM_DMA, &mm_ops);
 	platform_set_drvdata(pdev, mdev);
@@ -242,6 +405,14 @@ failed:
 			devm_kfree(&pdev->dev, mdev->channel_usage[0]);
 		if (mdev->channel_usage[1])
 			devm_kfree(&pdev->dev, mdev->channel_usage[1]);
+		if (mdev->channel_busy[0])
+			devm_kfree(&pdev->dev, mdev->channel_busy[0]);
+		if (mdev->channel_busy[1])
+			devm_kfree(&pdev->dev, mdev->channel_busy[1]);
+		if (mdev->channel_wait[0])
+			devm_kfree(&pdev->dev, mdev->channel_wait[0]);
+		if (mdev->channel_wait[1])
+			devm_kfree(&pdev->dev, mdev->channel_wait[1]);
 
 		devm_kfree(&pdev->dev, mdev);
 	}
@@ -266,6 +437,14 @@ static int mm_dma_remove(struct platform_device *pdev)
 		devm_kfree(&pdev->dev, mdev->channel_usage[0]);
 	if (mdev->channel_usage[1])
 		devm_kfree(&pdev->dev, mdev->channel_usage[1]);
+	if (mdev->channel_busy[0])
+		devm_kfree(&pdev->dev, mdev->channel_busy[0]);
+	if (mdev->channel_busy[1])
+		devm_kfree(&pdev->dev, mdev->channel_busy[1]);
+	if (mdev->channel_wait[0])
+		devm_kfree(&pdev->dev, mdev->channel_wait[0]);
+	if (mdev->channel_wait[1])
+		devm_kfree(&pdev->dev, mdev->channel_wait[1]);
 
 	mutex_destroy(&mdev->stat_lock);
 
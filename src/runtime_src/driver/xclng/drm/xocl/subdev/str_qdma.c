@@ -59,6 +59,8 @@ struct stream_queue {
 	int			refcnt;
 	struct str_device	*sdev;
 	kuid_t			uid;
+	/* zero copy C2H: stream buffer backing the free list */
+	struct drm_gem_object	*zc_obj;
 };
 
 struct str_device {
@@ -165,6 +167,10 @@ static ssize_t stat_show(struct device *dev, struct device_attribute *da,
 	__SHOW_MEMBER(pstat, flq_pidx);
 	__SHOW_MEMBER(pstat, flq_pidx_pend);
 
+	__SHOW_MEMBER(pstat, intr_total);
+	__SHOW_MEMBER(pstat, intr_rate);
+	__SHOW_MEMBER(pstat, intr_level);
+
 	return off;
 }
 static DEVICE_ATTR_RO(stat);
@@ -334,6 +340,8 @@ static ssize_t stream_post_bo(struct str_device *sdev,
 	wr.sgt = xobj->sgt;
 	wr.eot = (header->flags & XOCL_QDMA_REQ_FLAG_EOT) ? true : false;
 	if (kiocb) {
+		wr.more = (header->flags & XOCL_QDMA_REQ_FLAG_MORE) ?
+			true : false;
 		cb_arg.is_unmgd = false;
 		cb_arg.kiocb = kiocb;
 		cb_arg.xobj = xobj;
@@ -357,17 +365,24 @@ failed:
 	return ret;
 }
 
+/*
+ * Post one request for the @nr user buffers in @iov, more than one buffer
+ * is gathered into a single descriptor chain.
+ */
 static ssize_t queue_rw(struct str_device *sdev, struct stream_queue *queue,
-	char __user *buf, size_t sz, bool write, char __user *u_header,
-	struct kiocb *kiocb)
+	const struct iovec *iov, unsigned long nr, bool write,
+	char __user *u_header, struct kiocb *kiocb)
 {
 	struct vm_area_struct	*vma;
 	struct xocl_dev *xdev;
 	struct drm_xocl_unmgd unmgd;
+	char __user *buf = iov[0].iov_base;
 	unsigned long buf_addr = (unsigned long)buf;
 	struct stream_async_arg cb_arg;
 	enum dma_data_direction dir;
 	struct xocl_qdma_req_header header;
+	size_t sz = 0;
+	unsigned long i;
 	u32 nents;
 	struct qdma_wr wr;
 	long	ret = 0;
@@ -375,16 +390,6 @@ static ssize_t queue_rw(struct str_device *sdev, struct stream_queue *queue,
 	xocl_dbg(&sdev->pdev->dev, "Read / Write Queue %ld",
 		queue->queue.qhdl);
 
-	if (sz == 0)
-		return 0;
-
-	if (((uint64_t)(buf) & ~PAGE_MASK) && queue->queue.qconf->c2h) {
-		xocl_err(&sdev->pdev->dev,
-			"C2H buffer has to be page aligned, buf %p", buf);
-		ret = -EINVAL;
-		goto failed;
-	}
-
 	memset (&header, 0, sizeof (header));
 	if (u_header &&  copy_from_user((void *)&header, u_header,
 		sizeof (struct xocl_qdma_req_header))) {
@@ -392,6 +397,39 @@ static ssize_t queue_rw(struct str_device *sdev, struct stream_queue *queue,
 		return -EFAULT;
 	}
 
+	for (i = 0; i < nr; i++)
+		sz += iov[i].iov_len;
+
+	/* empty request flushes requests deferred with FLAG_MORE */
+	if (sz == 0) {
+		if (!(header.flags & XOCL_QDMA_REQ_FLAG_MORE))
+			qdma_wq_kick(&queue->queue);
+		return 0;
+	}
+
+	if (queue->zc_obj && nr > 1) {
+		xocl_err(&sdev->pdev->dev,
+			"Zero copy read does not take vectors, nr %ld", nr);
+		return -EINVAL;
+	}
+
+	if (queue->zc_obj && (sz % sizeof (struct xocl_qdma_zc_desc))) {
+		xocl_err(&sdev->pdev->dev,
+			"Zero copy read has to be multiple of records, sz 0x%lx",
+			sz);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < nr && queue->queue.qconf->c2h; i++) {
+		if ((uint64_t)(iov[i].iov_base) & ~PAGE_MASK) {
+			xocl_err(&sdev->pdev->dev,
+				"C2H buffer has to be page aligned, buf %p",
+				iov[i].iov_base);
+			ret = -EINVAL;
+			goto failed;
+		}
+	}
+
 	if (!queue->queue.qconf->c2h &&
 		!(header.flags & XOCL_QDMA_REQ_FLAG_EOT) &&
 		(sz & 0xfff)) {
@@ -403,7 +441,7 @@ static ssize_t queue_rw(struct str_device *sdev, struct stream_queue *queue,
 
 	xdev = xocl_get_xdev(sdev->pdev);
 
-	vma = find_vma(current->mm, buf_addr);
+	vma = (nr == 1) ? find_vma(current->mm, buf_addr) : NULL;
 	if (vma && (vma->vm_ops == &stream_vm_ops)) {
 		if (vma->vm_start > buf_addr || vma->vm_end <= buf_addr + sz) {
 			return -EINVAL;
@@ -413,7 +451,10 @@ static ssize_t queue_rw(struct str_device *sdev, struct stream_queue *queue,
 		return ret;
 	}
 
-	ret = xocl_init_unmgd(&unmgd, (uint64_t)buf, sz, write);
+	if (nr == 1)
+		ret = xocl_init_unmgd(&unmgd, (uint64_t)buf, sz, write);
+	else
+		ret = xocl_init_unmgd_v(&unmgd, iov, nr, write);
 	if (ret) {
 		xocl_err(&sdev->pdev->dev, "Init unmgd buf failed, "
 			"ret=%ld", ret);
@@ -437,6 +478,8 @@ static ssize_t queue_rw(struct str_device *sdev, struct stream_queue *queue,
 	wr.eot = (header.flags & XOCL_QDMA_REQ_FLAG_EOT) ? true : false;
 
 	if (kiocb) {
+		wr.more = (header.flags & XOCL_QDMA_REQ_FLAG_MORE) ?
+			true : false;
 		memcpy(&cb_arg.unmgd, &unmgd, sizeof (unmgd));
 		cb_arg.is_unmgd = true;
 		cb_arg.queue = queue;
@@ -480,14 +523,14 @@ static ssize_t queue_aio_read(struct kiocb *kiocb, const struct iovec *iov,
 	queue = (struct stream_queue *)kiocb->ki_filp->private_data;
 	sdev = queue->sdev;
 
-	if (nr != 2) {
+	if (nr < 2) {
 		xocl_err(&sdev->pdev->dev, "Invalid request nr = %ld", nr);
 		return -EINVAL;
 	}
 
 	if (is_sync_kiocb(kiocb)) {
-		ret = queue_rw(sdev, queue, iov[1].iov_base,
-			iov[1].iov_len, false, iov[0].iov_base, NULL);
+		ret = queue_rw(sdev, queue, &iov[1], nr - 1, false,
+			iov[0].iov_base, NULL);
 		if (ret > 0)
 			total += ret;
 
@@ -497,8 +540,8 @@ static ssize_t queue_aio_read(struct kiocb *kiocb, const struct iovec *iov,
 
 	kiocb_set_cancel_fn(kiocb, (kiocb_cancel_fn *)queue_wqe_cancel);
 
-	ret = queue_rw(sdev, queue, iov[1].iov_base, iov[1].iov_len,
-		false, iov[0].iov_base, kiocb);
+	ret = queue_rw(sdev, queue, &iov[1], nr - 1, false,
+		iov[0].iov_base, kiocb);
 	if (ret > 0)
 		total += ret;
 
@@ -515,14 +558,14 @@ static ssize_t queue_aio_write(struct kiocb *kiocb, const struct iovec *iov,
 	queue = (struct stream_queue *)kiocb->ki_filp->private_data;
 	sdev = queue->sdev;
 
-	if (nr != 2) {
+	if (nr < 2) {
 		xocl_err(&sdev->pdev->dev, "Invalid request nr = %ld", nr);
 		return -EINVAL;
 	}
 
 	if (is_sync_kiocb(kiocb)) {
-		ret = queue_rw(sdev, queue, iov[1].iov_base,
-			iov[1].iov_len, true, iov[0].iov_base, NULL);
+		ret = queue_rw(sdev, queue, &iov[1], nr - 1, true,
+			iov[0].iov_base, NULL);
 		if (ret > 0)
 			total += ret;
 
@@ -532,8 +575,8 @@ static ssize_t queue_aio_write(struct kiocb *kiocb, const struct iovec *iov,
 
 	kiocb_set_cancel_fn(kiocb, (kiocb_cancel_fn *)queue_wqe_cancel);
 
-	ret = queue_rw(sdev, queue, iov[1].iov_base, iov[1].iov_len,
-		true, iov[0].iov_base, kiocb);
+	ret = queue_rw(sdev, queue, &iov[1], nr - 1, true,
+		iov[0].iov_base, kiocb);
 	if (ret > 0)
 		total += ret;
 
@@ -553,7 +596,7 @@ static ssize_t queue_write_iter(struct kiocb *kiocb, struct iov_iter *io)
 	sdev = queue->sdev;
 
 	nr = io->nr_segs;
-	if (!iter_is_iovec(io) || nr != 2) {
+	if (!iter_is_iovec(io) || nr < 2) {
 		xocl_err(&sdev->pdev->dev, "Invalid request nr = %ld", nr);
 		goto end;
 	}
@@ -563,8 +606,8 @@ static ssize_t queue_write_iter(struct kiocb *kiocb, struct iov_iter *io)
 		goto end;
 	}
 
-	ret = queue_rw(sdev, queue, io->iov[1].iov_base,
-		io->iov[1].iov_len, true, io->iov[0].iov_base, NULL);
+	ret = queue_rw(sdev, queue, &io->iov[1], nr - 1, true,
+		io->iov[0].iov_base, NULL);
 	if (ret > 0)
 		total += ret;
 
@@ -586,7 +629,7 @@ static ssize_t queue_read_iter(struct kiocb *kiocb, struct iov_iter *io)
 	sdev = queue->sdev;
 
 	nr = io->nr_segs;
-	if (!iter_is_iovec(io) || nr != 2) {
+	if (!iter_is_iovec(io) || nr < 2) {
 		xocl_err(&sdev->pdev->dev, "Invalid request nr = %ld", nr);
 		goto end;
 	}
@@ -596,8 +639,8 @@ static ssize_t queue_read_iter(struct kiocb *kiocb, struct iov_iter *io)
 		goto end;
 	}
 
-	ret = queue_rw(sdev, queue, io->iov[1].iov_base,
-		io->iov[1].iov_len, false, io->iov[0].iov_base, NULL);
+	ret = queue_rw(sdev, queue, &io->iov[1], nr - 1, false,
+		io->iov[0].iov_base, NULL);
 	if (ret > 0)
 		total += ret;
 
@@ -636,12 +679,67 @@ static int queue_release(struct inode *inode, struct file *file)
 		goto failed;
 	}
 
+	if (queue->zc_obj)
+		drm_gem_object_unreference_unlocked(queue->zc_obj);
+
 	devm_kfree(&sdev->pdev->dev, queue);
 		
 failed:
 	return ret;
 }
 
+static long queue_ioctl_recycle(struct stream_queue *queue,
+	void __user *arg)
+{
+	struct str_device *sdev = queue->sdev;
+	struct xocl_qdma_ioc_recycle req;
+	u32 *slots;
+	long ret;
+
+	if (copy_from_user((void *)&req, arg, sizeof (req))) {
+		xocl_err(&sdev->pdev->dev, "copy failed.");
+		return -EFAULT;
+	}
+
+	if (!queue->zc_obj)
+		return -EINVAL;
+
+	if (!req.count)
+		return 0;
+
+	if (req.count > queue->queue.qconf->rngsz)
+		return -EINVAL;
+
+	slots = kmalloc_array(req.count, sizeof (*slots), GFP_KERNEL);
+	if (!slots)
+		return -ENOMEM;
+
+	if (copy_from_user(slots, (void __user *)req.slots,
+		req.count * sizeof (*slots))) {
+		ret = -EFAULT;
+		goto out;
+	}
+
+	ret = qdma_queue_c2h_recycle(queue->queue.dev_hdl, queue->queue.qhdl,
+		slots, req.count);
+out:
+	kfree(slots);
+	return ret;
+}
+
+static long queue_ioctl(struct file *filp, unsigned int cmd,
+	unsigned long arg)
+{
+	struct stream_queue *queue = filp->private_data;
+
+	switch (cmd) {
+	case XOCL_QDMA_IOC_QUEUE_RECYCLE:
+		return queue_ioctl_recycle(queue, (void __user *)arg);
+	default:
+		return -ENOTTY;
+	}
+}
+
 static struct file_operations queue_fops = {
 	.owner = THIS_MODULE,
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3,16,0)
@@ -651,19 +749,32 @@ static struct file_operations queue_fops = {
 	.aio_read = queue_aio_read,
 	.aio_write = queue_aio_write,
 #endif
+	.unlocked_ioctl = queue_ioctl,
 	.release = queue_release,
 };
 
+/*
+ * Create a queue for XOCL_QDMA_IOC_CREATE_QUEUE, or for
+ * XOCL_QDMA_IOC_CREATE_QUEUE_ZC if @zc, in which case @arg is a
+ * struct xocl_qdma_ioc_create_queue_zc.
+ */
 static long stream_ioctl_create_queue(struct str_device *sdev,
-	void __user *arg)
+	void __user *arg, bool zc)
 {
+	struct xocl_qdma_ioc_create_queue_zc zreq;
 	struct xocl_qdma_ioc_create_queue req;
 	struct qdma_queue_conf qconf;
 	struct xocl_dev *xdev;
 	struct stream_queue *queue;
 	long	ret;
 
-	if (copy_from_user((void *)&req, arg,
+	if (zc) {
+		if (copy_from_user((void *)&zreq, arg, sizeof (zreq))) {
+			xocl_err(&sdev->pdev->dev, "copy failed.");
+			return -EFAULT;
+		}
+		req = zreq.queue;
+	} else if (copy_from_user((void *)&req, arg,
 		sizeof (struct xocl_qdma_ioc_create_queue))) {
 		xocl_err(&sdev->pdev->dev, "copy failed.");
 		return -EFAULT;
@@ -691,6 +802,7 @@ static long stream_ioctl_create_queue(struct str_device *sdev,
 	if (!req.write) {
 		qconf.pipe_flow_id = req.flowid & STREAM_FLOWID_MASK;
 		qconf.c2h = 1;
+		qconf.cmpl_adaptive = 1;
 	} else {
 		qconf.bypass = 1;
 		qconf.pipe_slr_id = (req.rid >> STREAM_SLRID_SHIFT) &
@@ -698,8 +810,37 @@ static long stream_ioctl_create_queue(struct str_device *sdev,
 		qconf.pipe_tdest = req.rid & STREAM_TDEST_MASK;
 		qconf.pipe_gl_max = 1;
 	}
+	if (zc) {
+		struct vm_area_struct *vma;
+
+		if (req.write) {
+			xocl_err(&sdev->pdev->dev,
+				"Zero copy is for read queue only");
+			ret = -EINVAL;
+			goto failed;
+		}
+
+		down_read(&current->mm->mmap_sem);
+		vma = find_vma(current->mm, zreq.zc_buf_addr);
+		if (vma && vma->vm_ops == &stream_vm_ops &&
+			vma->vm_start <= zreq.zc_buf_addr) {
+			queue->zc_obj = vma->vm_private_data;
+			drm_gem_object_reference(queue->zc_obj);
+		}
+		up_read(&current->mm->mmap_sem);
+
+		if (!queue->zc_obj) {
+			xocl_err(&sdev->pdev->dev,
+				"Zero copy needs a stream buffer");
+			ret = -EINVAL;
+			goto failed;
+		}
+		qconf.fl_pages = to_xocl_bo(queue->zc_obj)->pages;
+		qconf.fl_npages = queue->zc_obj->size >> PAGE_SHIFT;
+	}
 	queue->flowid = req.flowid;
 	queue->routeid = req.rid;
+	queue->sdev = sdev;
 	xocl_info(&sdev->pdev->dev, "Creating queue with tdest %d, flow %d, "
 		"slr %d", qconf.pipe_tdest, qconf.pipe_flow_id,
 		qconf.pipe_slr_id);
@@ -716,54 +857,60 @@ static long stream_ioctl_create_queue(struct str_device *sdev,
 		queue->queue.qhdl, queue->queue.qconf->qidx,
 		queue->queue.qconf->rngsz);
 
-	queue->file = anon_inode_getfile("qdma_queue", &queue_fops, queue,
-		O_CLOEXEC | O_RDWR);
-	if (!queue->file) {
-		ret = -EFAULT;
+	ret = stream_sysfs_create(queue);
+	if (ret) {
+		xocl_err(&sdev->pdev->dev, "sysfs create failed");
 		goto failed;
 	}
-	queue->file->private_data = queue;
+
+	queue->uid = current_uid();
+
 	queue->qfd = get_unused_fd_flags(0); /* e.g. O_NONBLOCK */
 	if (queue->qfd < 0) {
 		ret = -EFAULT;
 		xocl_err(&sdev->pdev->dev, "Failed get fd");
-		goto failed;
+		goto failed_sysfs;
 	}
-	fd_install(queue->qfd, queue->file);
-	req.handle = queue->qfd;
 
-	if (copy_to_user(arg, &req, sizeof (req))) {
-		xocl_err(&sdev->pdev->dev, "Copy to user failed");
-		ret = -EFAULT;
-		goto failed;
+	queue->file = anon_inode_getfile("qdma_queue", &queue_fops, queue,
+		O_CLOEXEC | O_RDWR);
+	if (IS_ERR(queue->file)) {
+		ret = PTR_ERR(queue->file);
+		queue->file = NULL;
+		put_unused_fd(queue->qfd);
+		goto failed_sysfs;
 	}
+	queue->file->private_data = queue;
 
-	queue->sdev = sdev;
-
-	ret = stream_sysfs_create(queue);
+	/*
+	 * From here the file owns the queue, releasing the file destroys
+	 * it, so the fd is installed only once nothing can fail anymore
+	 */
+	req.handle = queue->qfd;
+	if (zc) {
+		zreq.queue.handle = req.handle;
+		ret = copy_to_user(arg, &zreq, sizeof (zreq));
+	} else
+		ret = copy_to_user(arg, &req, sizeof (req));
 	if (ret) {
-		xocl_err(&sdev->pdev->dev, "sysfs create failed");
-		goto failed;
+		xocl_err(&sdev->pdev->dev, "Copy to user failed");
+		put_unused_fd(queue->qfd);
+		fput(queue->file);
+		return -EFAULT;
 	}
-
-	queue->uid = current_uid();
+	fd_install(queue->qfd, queue->file);
 
 	return 0;
 
+failed_sysfs:
+	stream_sysfs_destroy(queue);
 failed:
-	if (queue->qfd >= 0)
-		put_unused_fd(queue->qfd);
-
-	if (queue->file) {
-		fput(queue->file);
-		queue->file = NULL;
-	}
+	qdma_wq_destroy(&queue->queue);
 
-	if (queue) {
-		devm_kfree(&sdev->pdev->dev, queue);
-	}
+	if (queue->zc_obj)
+		drm_gem_object_unreference_unlocked(queue->zc_obj);
 
-	qdma_wq_destroy(&queue->queue);
+	devm_kfree(&sdev->pdev->dev, queue);
 
 	return ret;
 }
@@ -875,7 +1022,12 @@ static long stream_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 
 	switch (cmd) {
 	case XOCL_QDMA_IOC_CREATE_QUEUE:
-		result = stream_ioctl_create_queue(sdev, (void __user *)arg);
+		result = stream_ioctl_create_queue(sdev, (void __user *)arg,
+			false);
+		break;
+	case XOCL_QDMA_IOC_CREATE_QUEUE_ZC:
+		result = stream_ioctl_create_queue(sdev, (void __user *)arg,
+			true);
 		break;
 	case XOCL_QDMA_IOC_ALLOC_BUFFER:
 		result = stream_ioctl_alloc_buffer(sdev, (void __user *)arg);
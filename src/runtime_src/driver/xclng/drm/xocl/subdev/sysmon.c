@@ -45,7 +45,12 @@
 
 struct xocl_sysmon {
 	void __iomem		*base;
+	struct device		*dev;
 	struct device		*hwmon_dev;
+
+	struct mutex		sample_lock;
+	struct xclmgmt_sensor_sample *sample;
+	struct delayed_work	sample_work;
 };
 
 static int get_prop(struct platform_device *pdev, u32 prop, void *val)
@@ -220,16 +225,126 @@ static ssize_t vcc_bram_show(struct device *dev, struct device_attribute *da,
 }
 static DEVICE_ATTR_RO(vcc_bram);
 
+static const struct {
+	const char *name;
+	u32 prop;
+} sysmon_sensors[] = {
+	{ "temp", XOCL_SYSMON_PROP_TEMP },
+	{ "vcc_int", XOCL_SYSMON_PROP_VCC_INT },
+	{ "vcc_aux", XOCL_SYSMON_PROP_VCC_AUX },
+	{ "vcc_bram", XOCL_SYSMON_PROP_VCC_BRAM },
+};
+
+#define	SYSMON_SAMPLE_SIZE		\
+	(sizeof(struct xclmgmt_sensor_sample) + sizeof(int) * ARRAY_SIZE(sysmon_sensors))
+
+/* Snapshot all sensors, caller holds sample_lock */
+static void sysmon_sample(struct platform_device *pdev)
+{
+	struct xocl_sysmon *sysmon = platform_get_drvdata(pdev);
+	struct xclmgmt_sensor_sample *sample = sysmon->sample;
+	u32 val;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(sysmon_sensors); i++) {
+		val = 0;
+		(void) get_prop(pdev, sysmon_sensors[i].prop, &val);
+		sample->value[i] = val;
+	}
+	sample->timestamp_ns = ktime_to_ns(ktime_get());
+	sample->sequence++;
+}
+
+static void sysmon_sample_work(struct work_struct *work)
+{
+	struct xocl_sysmon *sysmon = container_of(to_delayed_work(work),
+		struct xocl_sysmon, sample_work);
+	struct platform_device *pdev = to_platform_device(sysmon->dev);
+
+	mutex_lock(&sysmon->sample_lock);
+	sysmon_sample(pdev);
+	mutex_unlock(&sysmon->sample_lock);
+
+	schedule_delayed_work(&sysmon->sample_work,
+		msecs_to_jiffies(sensor_sample_ms));
+}
+
+/*
+ * All sensors in one read, "<name> <value>" per line. Served from the last
+ * sample, or sampled here when the sampler is off.
+ */
+static ssize_t sensors_raw_show(struct device *dev, struct device_attribute *da,
+    char *buf)
+{
+	struct platform_device *pdev = to_platform_device(dev);
+	struct xocl_sysmon *sysmon = platform_get_drvdata(pdev);
+	ssize_t count = 0;
+	int i;
+
+	mutex_lock(&sysmon->sample_lock);
+	if (!sensor_sample_ms)
+		sysmon_sample(pdev);
+	for (i = 0; i < ARRAY_SIZE(sysmon_sensors); i++) {
+		count += sprintf(buf + count, "%s %u\n", sysmon_sensors[i].name,
+			(u32)sysmon->sample->value[i]);
+	}
+	mutex_unlock(&sysmon->sample_lock);
+
+	return count;
+}
+static DEVICE_ATTR_RO(sensors_raw);
+
 static struct attribute *sysmon_attributes[] = {
 	&dev_attr_temp.attr,
 	&dev_attr_vcc_int.attr,
 	&dev_attr_vcc_aux.attr,
 	&dev_attr_vcc_bram.attr,
+	&dev_attr_sensors_raw.attr,
+	NULL,
+};
+
+static ssize_t read_sensors_bin(struct file *filp, struct kobject *kobj,
+	struct bin_attribute *attr, char *buffer, loff_t offset, size_t count)
+{
+	struct platform_device *pdev;
+	struct xocl_sysmon *sysmon;
+	size_t nread;
+
+	pdev = to_platform_device(container_of(kobj, struct device, kobj));
+	sysmon = platform_get_drvdata(pdev);
+
+	if (offset >= SYSMON_SAMPLE_SIZE)
+		return 0;
+
+	nread = min_t(size_t, count, SYSMON_SAMPLE_SIZE - offset);
+
+	mutex_lock(&sysmon->sample_lock);
+	if (!sensor_sample_ms)
+		sysmon_sample(pdev);
+	memcpy(buffer, ((char *)sysmon->sample) + offset, nread);
+	mutex_unlock(&sysmon->sample_lock);
+
+	return nread;
+}
+
+static struct bin_attribute sensors_bin_attr = {
+	.attr = {
+		.name = "sensors_bin",
+		.mode = 0444
+	},
+	.read = read_sensors_bin,
+	.write = NULL,
+	.size = SYSMON_SAMPLE_SIZE
+};
+
+static struct bin_attribute *sysmon_bin_attrs[] = {
+	&sensors_bin_attr,
 	NULL,
 };
 
 static const struct attribute_group sysmon_attrgroup = {
 	.attrs = sysmon_attributes,
+	.bin_attrs = sysmon_bin_attrs,
 };
 
 static void mgmt_sysfs_destroy_sysmon(struct platform_device *pdev)
@@ -320,6 +435,19 @@ static int sysmon_probe(struct platform_device *pdev)
 		goto failed;
 	}
 
+	sysmon->dev = &pdev->dev;
+	mutex_init(&sysmon->sample_lock);
+	INIT_DELAYED_WORK(&sysmon->sample_work, sysmon_sample_work);
+
+	sysmon->sample = devm_kzalloc(&pdev->dev, SYSMON_SAMPLE_SIZE,
+		GFP_KERNEL);
+	if (!sysmon->sample) {
+		err = -ENOMEM;
+		goto alloc_sample_failed;
+	}
+	sysmon->sample->version = XCLMGMT_SENSOR_SAMPLE_VERSION;
+	sysmon->sample->count = ARRAY_SIZE(sysmon_sensors);
+
 	platform_set_drvdata(pdev, sysmon);
 
 	err = mgmt_sysfs_create_sysmon(pdev);
@@ -329,10 +457,17 @@ static int sysmon_probe(struct platform_device *pdev)
 
 	xocl_subdev_register(pdev, XOCL_SUBDEV_SYSMON, &sysmon_ops);
 
+	if (sensor_sample_ms)
+		schedule_delayed_work(&sysmon->sample_work, 0);
+
 	return 0;
 
 create_sysmon_failed:
 	platform_set_drvdata(pdev, NULL);
+	devm_kfree(&pdev->dev, sysmon->sample);
+alloc_sample_failed:
+	mutex_destroy(&sysmon->sample_lock);
+	iounmap(sysmon->base);
 failed:
 	return err;
 }
@@ -348,11 +483,15 @@ static int sysmon_remove(struct platform_device *pdev)
 		return -EINVAL;
 	}
 
+	cancel_delayed_work_sync(&sysmon->sample_work);
 	mgmt_sysfs_destroy_sysmon(pdev);
 
 	if (sysmon->base)
 		iounmap(sysmon->base);
 
+	mutex_destroy(&sysmon->sample_lock);
+	devm_kfree(&pdev->dev, sysmon->sample);
+
 	platform_set_drvdata(pdev, NULL);
 	devm_kfree(&pdev->dev, sysmon);
 
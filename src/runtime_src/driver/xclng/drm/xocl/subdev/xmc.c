@@ -152,6 +152,9 @@ struct xocl_xmc {
 	u32			sche_binary_length;
 	char			*mgmt_binary;
 	u32			mgmt_binary_length;
+
+	struct xclmgmt_sensor_sample *sample;
+	struct delayed_work	sample_work;
 };
 
 
@@ -521,6 +524,97 @@ static ssize_t xmc_dimm_temp3_show(struct device *dev, struct device_attribute *
 }
 static DEVICE_ATTR_RO(xmc_dimm_temp3);
 
+#define	XMC_INS(reg)	((reg) + sizeof(u32) * VOLTAGE_INS)
+static const struct {
+	const char *name;
+	u32 reg;
+} xmc_sensors[] = {
+	{ "xmc_12v_pex_vol", XMC_INS(XMC_12V_PEX_REG) },
+	{ "xmc_12v_aux_vol", XMC_INS(XMC_12V_AUX_REG) },
+	{ "xmc_12v_pex_curr", XMC_INS(XMC_12V_PEX_I_IN_REG) },
+	{ "xmc_12v_aux_curr", XMC_INS(XMC_12V_AUX_I_IN_REG) },
+	{ "xmc_3v3_pex_vol", XMC_INS(XMC_3V3_PEX_REG) },
+	{ "xmc_3v3_aux_vol", XMC_INS(XMC_3V3_AUX_REG) },
+	{ "xmc_ddr_vpp_btm", XMC_INS(XMC_DDR4_VPP_BTM_REG) },
+	{ "xmc_sys_5v5", XMC_INS(XMC_SYS_5V5_REG) },
+	{ "xmc_1v2_top", XMC_INS(XMC_VCC1V2_TOP_REG) },
+	{ "xmc_1v8", XMC_INS(XMC_VCC1V8_REG) },
+	{ "xmc_0v85", XMC_INS(XMC_VCC0V85_REG) },
+	{ "xmc_ddr_vpp_top", XMC_INS(XMC_DDR4_VPP_TOP_REG) },
+	{ "xmc_mgt0v9avcc", XMC_INS(XMC_MGT0V9AVCC_REG) },
+	{ "xmc_12v_sw", XMC_INS(XMC_12V_SW_REG) },
+	{ "xmc_mgtavtt", XMC_INS(XMC_MGTAVTT_REG) },
+	{ "xmc_vcc1v2_btm", XMC_INS(XMC_VCC1V2_BTM_REG) },
+	{ "xmc_vccint_vol", XMC_INS(XMC_VCCINT_V_REG) },
+	{ "xmc_vccint_curr", XMC_INS(XMC_VCCINT_I_REG) },
+	{ "xmc_se98_temp0", XMC_INS(XMC_SE98_TEMP0_REG) },
+	{ "xmc_se98_temp1", XMC_INS(XMC_SE98_TEMP1_REG) },
+	{ "xmc_se98_temp2", XMC_INS(XMC_SE98_TEMP2_REG) },
+	{ "xmc_fpga_temp", XMC_FPGA_TEMP },
+	{ "xmc_fan_temp", XMC_FAN_TEMP_REG },
+	{ "xmc_fan_rpm", XMC_FAN_SPEED_REG },
+	{ "xmc_dimm_temp0", XMC_INS(XMC_DIMM_TEMP0_REG) },
+	{ "xmc_dimm_temp1", XMC_INS(XMC_DIMM_TEMP1_REG) },
+	{ "xmc_dimm_temp2", XMC_INS(XMC_DIMM_TEMP2_REG) },
+	{ "xmc_dimm_temp3", XMC_INS(XMC_DIMM_TEMP3_REG) },
+	{ "version", XMC_VERSION_REG },
+};
+#undef	XMC_INS
+
+#define	XMC_SAMPLE_SIZE		\
+	(sizeof(struct xclmgmt_sensor_sample) + sizeof(int) * ARRAY_SIZE(xmc_sensors))
+
+/* Snapshot all sensors, caller holds xmc_lock */
+static void xmc_sample(struct xocl_xmc *xmc)
+{
+	struct xclmgmt_sensor_sample *sample = xmc->sample;
+	bool active = xmc->enabled && xmc->state == XMC_STATE_ENABLED;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(xmc_sensors); i++)
+		sample->value[i] = active ? READ_REG32(xmc, xmc_sensors[i].reg) : 0;
+	sample->timestamp_ns = ktime_to_ns(ktime_get());
+	sample->sequence++;
+}
+
+static void xmc_sample_work(struct work_struct *work)
+{
+	struct xocl_xmc *xmc = container_of(to_delayed_work(work),
+		struct xocl_xmc, sample_work);
+
+	mutex_lock(&xmc->xmc_lock);
+	xmc_sample(xmc);
+	mutex_unlock(&xmc->xmc_lock);
+
+	schedule_delayed_work(&xmc->sample_work,
+		msecs_to_jiffies(sensor_sample_ms));
+}
+
+/*
+ * All sensors in one read, "<name> <value>" per line, names match the
+ * individual attributes above. Served from the last sample, or sampled
+ * here when the sampler is off.
+ */
+static ssize_t sensors_raw_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct xocl_xmc *xmc = dev_get_drvdata(dev);
+	ssize_t count = 0;
+	int i;
+
+	mutex_lock(&xmc->xmc_lock);
+	if (!sensor_sample_ms)
+		xmc_sample(xmc);
+	for (i = 0; i < ARRAY_SIZE(xmc_sensors); i++) {
+		count += sprintf(buf + count, "%s %d\n", xmc_sensors[i].name,
+			xmc->sample->value[i]);
+	}
+	mutex_unlock(&xmc->xmc_lock);
+
+	return count;
+}
+static DEVICE_ATTR_RO(sensors_raw);
+
 static ssize_t version_show(struct device *dev,
 	struct device_attribute *attr, char *buf)
 {
@@ -738,6 +832,7 @@ static struct attribute *xmc_attrs[] = {
 	&dev_attr_xmc_se98_temp0.attr,
 	&dev_attr_xmc_se98_temp1.attr,
 	&dev_attr_xmc_se98_temp2.attr,
+	&dev_attr_sensors_raw.attr,
 	&dev_attr_pause.attr,
 	&dev_attr_reset.attr,
 	&dev_attr_power_flag.attr,
@@ -747,8 +842,46 @@ static struct attribute *xmc_attrs[] = {
 	NULL,
 };
 
+static ssize_t read_sensors_bin(struct file *filp, struct kobject *kobj,
+	struct bin_attribute *attr, char *buffer, loff_t offset, size_t count)
+{
+	struct xocl_xmc *xmc;
+	size_t nread;
+
+	xmc = dev_get_drvdata(container_of(kobj, struct device, kobj));
+
+	if (offset >= XMC_SAMPLE_SIZE)
+		return 0;
+
+	nread = min_t(size_t, count, XMC_SAMPLE_SIZE - offset);
+
+	mutex_lock(&xmc->xmc_lock);
+	if (!sensor_sample_ms)
+		xmc_sample(xmc);
+	memcpy(buffer, ((char *)xmc->sample) + offset, nread);
+	mutex_unlock(&xmc->xmc_lock);
+
+	return nread;
+}
+
+static struct bin_attribute sensors_bin_attr = {
+	.attr = {
+		.name = "sensors_bin",
+		.mode = 0444
+	},
+	.read = read_sensors_bin,
+	.write = NULL,
+	.size = XMC_SAMPLE_SIZE
+};
+
+static struct bin_attribute *xmc_bin_attrs[] = {
+	&sensors_bin_attr,
+	NULL,
+};
+
 static struct attribute_group xmc_attr_group = {
 	.attrs = xmc_attrs,
+	.bin_attrs = xmc_bin_attrs,
 };
 static ssize_t show_mb_pw(struct device *dev, struct device_attribute *da,
 	char *buf)
@@ -1109,10 +1242,46 @@ static int load_sche_image(struct platform_device *pdev, const char *image,
 	return 0;
 }
 
+static int xmc_get_prop(struct platform_device *pdev, u32 prop, void *val)
+{
+	struct xocl_xmc *xmc;
+	u32 reg;
+	int err = 0;
+
+	xmc = platform_get_drvdata(pdev);
+	if (!xmc)
+		return -ENODEV;
+
+	switch (prop) {
+	case XOCL_XMC_PROP_FPGA_TEMP:
+		reg = XMC_FPGA_TEMP;
+		break;
+	case XOCL_XMC_PROP_12V_PEX_CURR:
+		reg = XMC_12V_PEX_I_IN_REG + sizeof(u32) * VOLTAGE_INS;
+		break;
+	case XOCL_XMC_PROP_12V_AUX_CURR:
+		reg = XMC_12V_AUX_I_IN_REG + sizeof(u32) * VOLTAGE_INS;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	/* Unlike the attributes, report a stopped XMC instead of zero */
+	mutex_lock(&xmc->xmc_lock);
+	if (xmc->enabled && xmc->state == XMC_STATE_ENABLED)
+		*(u32 *)val = READ_REG32(xmc, reg);
+	else
+		err = -ENODEV;
+	mutex_unlock(&xmc->xmc_lock);
+
+	return err;
+}
+
 static struct xocl_mb_funcs xmc_ops = {
 	.load_mgmt_image	= load_mgmt_image,
 	.load_sche_image	= load_sche_image,
 	.reset			= xmc_reset,
+	.get_prop		= xmc_get_prop,
 };
 
 static int xmc_remove(struct platform_device *pdev)
@@ -1130,6 +1299,7 @@ static int xmc_remove(struct platform_device *pdev)
 	if (xmc->sche_binary)
 		devm_kfree(&pdev->dev, xmc->sche_binary);
 
+	cancel_delayed_work_sync(&xmc->sample_work);
 	mgmt_sysfs_destroy_xmc(pdev);
 
 	for (i = 0; i < NUM_IOADDR; i++) {
@@ -1139,6 +1309,9 @@ static int xmc_remove(struct platform_device *pdev)
 
 	mutex_destroy(&xmc->xmc_lock);
 
+	if (xmc->sample)
+		devm_kfree(&pdev->dev, xmc->sample);
+
 	platform_set_drvdata(pdev, NULL);
 	devm_kfree(&pdev->dev, xmc);
 
@@ -1172,6 +1345,17 @@ static int xmc_probe(struct platform_device *pdev)
 		return 0;
 	}
 
+	mutex_init(&xmc->xmc_lock);
+	INIT_DELAYED_WORK(&xmc->sample_work, xmc_sample_work);
+
+	xmc->sample = devm_kzalloc(&pdev->dev, XMC_SAMPLE_SIZE, GFP_KERNEL);
+	if (!xmc->sample) {
+		err = -ENOMEM;
+		goto failed;
+	}
+	xmc->sample->version = XCLMGMT_SENSOR_SAMPLE_VERSION;
+	xmc->sample->count = ARRAY_SIZE(xmc_sensors);
+
 	for (i = 0; i < NUM_IOADDR; i++) {
 		res = platform_get_resource(pdev, IORESOURCE_MEM, i);
 		xocl_info(&pdev->dev, "IO start: 0x%llx, end: 0x%llx",
@@ -1193,7 +1377,8 @@ static int xmc_probe(struct platform_device *pdev)
 
 	xocl_subdev_register(pdev, XOCL_SUBDEV_XMC, &xmc_ops);
 
-	mutex_init(&xmc->xmc_lock);
+	if (sensor_sample_ms)
+		schedule_delayed_work(&xmc->sample_work, 0);
 
 	return 0;
 
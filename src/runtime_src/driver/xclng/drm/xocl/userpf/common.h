@@ -55,6 +55,7 @@
 #define MAX_U32_SLOT_MASKS (((MAX_SLOTS-1)>>5) + 1)
 #define MAX_U32_CU_MASKS (((MAX_CUS-1)>>5) + 1)
 #define MAX_DEPS        8
+#define XOCL_PRIORITY_LEVELS 4
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 13, 0)
 #define XOCL_DRM_FREE_MALLOC
@@ -64,6 +65,15 @@
 #endif
 #endif
 
+/*
+ * DMA traffic of a memory bank, indexed by direction, 1 is to device.
+ * Kept per CPU, readers sum over all CPUs.
+ */
+struct xocl_mm_dma_stat {
+	u64	bytes[2];
+	u64	ops[2];
+};
+
 struct xocl_dev	{
 	struct xocl_dev_core	core;
 
@@ -88,6 +98,9 @@ struct xocl_dev	{
 	struct drm_mm		       *mm;
 	struct mutex			mm_lock;
 	struct drm_xocl_mm_stat	       *mm_usage_stat;
+	struct xocl_mm_dma_stat __percpu *mm_dma_stat;
+	/* bytes of BO DMA mappings kept across syncs, see xocl_sync_sgt */
+	atomic64_t			sync_mapped;
 	struct mutex			stat_lock;
 
 	struct mem_topology	       *topology;
@@ -103,6 +116,14 @@ struct xocl_dev	{
 	struct xocl_health_thread_arg	thread_arg;
 
 	void * __iomem bypass_bar_addr;
+	/* pages of whole bypass BAR, P2P BOs use slices of it */
+	struct page		      **p2p_pages;
+	/* pinned host memory of the MEM_HOST bank, host bank BOs use slices of it */
+	void			       *host_mem;
+	dma_addr_t			host_mem_dma;
+	u64				host_mem_base;
+	u64				host_mem_size;
+	struct page		      **host_mem_pages;
 	/*should be removed after mailbox is supported */
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 5, 0) || RHEL_P2P_SUPPORT
 	struct percpu_ref ref;
@@ -112,12 +133,14 @@ struct xocl_dev	{
 	u64			        unique_id_last_bitstream;
 	/* remove the previous id after we move to uuid */
 	xuid_t                          xclbin_id;
-	unsigned                        ip_reference[MAX_CUS];
+	atomic_t                        ip_reference[MAX_CUS];
 	struct list_head                ctx_list;
 	struct mutex			ctx_list_lock;
 	atomic_t                        needs_reset;
 	atomic_t                        outstanding_execs;
 	atomic64_t                      total_execs;
+	/* async sync BO requests */
+	struct workqueue_struct	       *sync_wq;
 };
 
 /**
@@ -125,29 +148,71 @@ struct xocl_dev	{
  *
  * @link: Client context is added to list in device
  * @xclbin_id: UUID for xclbin loaded by client, or nullid if no xclbin loaded
- * @trigger: Poll wait counter for number of completed exec buffers
+ * @trigger: Device exec buffer completions consumed by poll, trails the device poll count
  * @outstanding_execs: Counter for number outstanding exec buffers
  * @abort: Flag to indicate that this context has detached from user space (ctrl-c)
  * @lock: Mutex lock for exclusive access
  * @cu_bitmap: CUs reserved by this context
+ * @ctx_cus: @cu_bitmap as 32 bit CU masks, updated with @cu_bitmap and used to validate exec buffers
+ * @ring_lock: Spinlock protecting exec completion ring
+ * @ring_bo: Exec buffer BO holding completion ring, or NULL if none
+ * @ring: Mapped completion ring shared with user space
+ * @ring_size: Number of ring entries, private copy not writable by user
+ * @ring_tail: Next ring entry to produce, private copy not writable by user
+ * @ring_dropped: Number of completions dropped because ring was full
+ * @sched_link: Client is added to scheduler list of clients with commands waiting for admission
+ * @sched_queue: Per priority commands waiting for admission, owned by scheduler thread
+ * @sched_queued: Number of commands in @sched_queue
+ * @sched_started: Number of commands started by scheduler
+ * @sched_wait_ns: Accumulated time from submission to start of commands
+ * @uptr_cache: Pinned userptr pages reused across userptr BOs, created on first use
+ * @bo_bytes: Size of the BOs this client holds handles to
+ * @dma_bytes: Bytes this client requested to move by sync, copy and unmanaged DMA
  */
 struct client_ctx {
 	struct list_head	link;
 	xuid_t                  xclbin_id;
-	atomic_t		trigger;
+	int			trigger;
 	atomic_t                outstanding_execs;
 	atomic_t                abort;
 	struct mutex		lock;
 	struct xocl_dev        *xdev;
 	DECLARE_BITMAP(cu_bitmap, MAX_CUS);
+	u32                     ctx_cus[MAX_U32_CU_MASKS];
 	struct pid             *pid;
+	spinlock_t                     ring_lock;
+	struct drm_xocl_bo            *ring_bo;
+	struct drm_xocl_exec_ring_buf *ring;
+	u32                            ring_size;
+	u32                            ring_tail;
+	u32                            ring_dropped;
+	struct list_head               sched_link;
+	struct list_head               sched_queue[XOCL_PRIORITY_LEVELS];
+	unsigned int                   sched_queued;
+	u64                            sched_started;
+	u64                            sched_wait_ns;
+	struct xocl_uptr_cache        *uptr_cache;
+	atomic64_t                     bo_bytes;
+	atomic64_t                     dma_bytes;
 };
 
+static inline void xocl_client_dma(struct drm_file *filp, u64 size)
+{
+	struct client_ctx *client = filp->driver_priv;
+
+	if (client)
+		atomic64_add(size, &client->dma_bytes);
+}
+
 /* ioctl functions */
 int xocl_info_ioctl(struct drm_device *dev,
         void *data, struct drm_file *filp);
 int xocl_execbuf_ioctl(struct drm_device *dev,
         void *data, struct drm_file *filp);
+int xocl_execbuf_batch_ioctl(struct drm_device *dev,
+        void *data, struct drm_file *filp);
+int xocl_exec_ring_ioctl(struct drm_device *dev,
+        void *data, struct drm_file *filp);
 int xocl_ctx_ioctl(struct drm_device *dev, void *data,
                    struct drm_file *filp);
 int xocl_user_intr_ioctl(struct drm_device *dev, void *data,
@@ -161,6 +226,9 @@ int xocl_init_sysfs(struct device *dev);
 void xocl_fini_sysfs(struct device *dev);
 
 ssize_t xocl_mm_sysfs_stat(struct xocl_dev *xdev, char *buf, bool raw);
+#define XOCL_MM_FRAG_BUCKETS	6
+ssize_t xocl_mm_sysfs_frag(struct xocl_dev *xdev, char *buf, bool raw);
+ssize_t xocl_mm_sysfs_dma(struct xocl_dev *xdev, char *buf, bool raw);
 
 /* helper functions */
 void xocl_reset_notify(struct pci_dev *pdev, bool prepare);
@@ -178,5 +246,6 @@ struct drm_xocl_bo *xocl_create_bo(struct drm_device *dev,
                                           unsigned user_type);
 
 void xocl_dump_sgtable(struct device *dev, struct sg_table *sgt);
+void xocl_uptr_cache_fini(struct client_ctx *client);
 
 #endif
@@ -24,6 +24,13 @@
 #include "xocl_drm.h"
 
 #define	QDMA_MM_ENGINE_MAX		1 /* 2 with Everest */
+/* upper bound of MM queue pairs, the rest of the queues are for streams */
+#define	QDMA_MM_CHANNEL_MAX		64
+
+static unsigned int mm_channels;
+module_param(mm_channels, uint, (S_IRUGO));
+MODULE_PARM_DESC(mm_channels,
+	"Number of memory mapped QDMA queue pairs (0 = one per online CPU, max 64)");
 
 struct xocl_qdma_dev {
 	struct xocl_dev		ocl_dev;
@@ -124,8 +131,14 @@ static int xocl_user_qdma_probe(struct pci_dev *pdev,
 	}
 
 	if (MM_DMA_DEV(ocl_dev)) {
-		/* use 2 channels (queue pairs) */
-		ret = xocl_set_max_channel(ocl_dev, 2);
+		/*
+		 * a queue pair per CPU lets each submitting CPU use its own
+		 * channel, DMA of concurrent small buffers scales with cores
+		 */
+		u32 channels = mm_channels ? mm_channels : num_online_cpus();
+
+		ret = xocl_set_max_channel(ocl_dev,
+			min_t(u32, channels, QDMA_MM_CHANNEL_MAX));
 		if (ret)
 			goto failed_set_channel;
 
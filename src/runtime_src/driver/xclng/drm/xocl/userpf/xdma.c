@@ -25,6 +25,17 @@
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 5, 0) || RHEL_P2P_SUPPORT
 #include <linux/memremap.h>
 #endif
+#if defined(CONFIG_PCI_P2PDMA) && LINUX_VERSION_CODE >= KERNEL_VERSION(4, 20, 0)
+#include <linux/pci-p2pdma.h>
+#define XOCL_P2PDMA
+#endif
+
+#ifdef XOCL_P2PDMA
+static unsigned int p2pdma = 0;
+module_param(p2pdma, uint, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(p2pdma,
+	"Register P2P BAR with the kernel PCI p2pdma subsystem so that p2pdma aware drivers such as NVMe can DMA to P2P BOs (0 = disable)");
+#endif
 
 struct xocl_xdma_dev {
 	struct xocl_dev		ocl_dev;
@@ -106,6 +117,70 @@ static void xocl_dev_percpu_kill(void *data)
 
 #endif
 
+static void xocl_p2p_pages_free(void *data)
+{
+	vfree(data);
+}
+
+/*
+ * Page pointers of the whole P2P BAR, computed once so that P2P BOs
+ * take a slice of the pool instead of allocating and filling their
+ * own page array.
+ */
+static int xocl_p2p_pages_init(struct pci_dev *pdev, struct xocl_dev *xdev)
+{
+	u64 i, npages = xdev->bypass_bar_len >> PAGE_SHIFT;
+	struct page **pages;
+
+	pages = vmalloc(npages * sizeof(struct page *));
+	if (!pages)
+		return -ENOMEM;
+
+	for (i = 0; i < npages; i++)
+		pages[i] = virt_to_page(xdev->bypass_bar_addr + (i << PAGE_SHIFT));
+
+	xdev->p2p_pages = pages;
+	return devm_add_action_or_reset(&pdev->dev, xocl_p2p_pages_free, pages);
+}
+
+#ifdef XOCL_P2PDMA
+static void xocl_p2pdma_free(void *data)
+{
+	struct xocl_dev *xdev = data;
+
+	pci_free_p2pmem(xdev->core.pdev, xdev->bypass_bar_addr,
+		xdev->bypass_bar_len);
+}
+
+/*
+ * Let the p2pdma subsystem create the BAR pages.  The whole BAR is then
+ * taken back for BOs, which are managed with drm_mm as before, but the
+ * pages are p2pdma pages that p2pdma aware drivers map for DMA with
+ * correct bus addresses.
+ */
+static int xocl_p2pdma_reserve(struct pci_dev *pdev, struct xocl_dev *xdev)
+{
+	int ret;
+
+	ret = pci_p2pdma_add_resource(pdev, xdev->bypass_bar_idx,
+		xdev->bypass_bar_len, 0);
+	if (ret)
+		return ret;
+
+	xdev->bypass_bar_addr = pci_alloc_p2pmem(pdev, xdev->bypass_bar_len);
+	if (!xdev->bypass_bar_addr)
+		return -ENOMEM;
+
+	ret = devm_add_action_or_reset(&pdev->dev, xocl_p2pdma_free, xdev);
+	if (ret) {
+		xdev->bypass_bar_addr = NULL;
+		return ret;
+	}
+
+	return xocl_p2p_pages_init(pdev, xdev);
+}
+#endif
+
 static int xocl_p2p_mem_reserve(struct pci_dev *pdev, xdev_handle_t xdev_hdl)
 {
 	resource_size_t p2p_bar_addr;
@@ -117,6 +192,11 @@ static int xocl_p2p_mem_reserve(struct pci_dev *pdev, xdev_handle_t xdev_hdl)
 	int32_t ret;
 #endif
 
+#ifdef XOCL_P2PDMA
+	if (p2pdma)
+		return xocl_p2pdma_reserve(pdev, xdev);
+#endif
+
 	p2p_bar_len = xdev->bypass_bar_len;
 	p2p_bar_idx = xdev->bypass_bar_idx;
 
@@ -165,7 +245,10 @@ static int xocl_p2p_mem_reserve(struct pci_dev *pdev, xdev_handle_t xdev_hdl)
 		return -ENOMEM;;
 #endif
 
-	return 0;
+	if (!xdev->bypass_bar_addr)
+		return 0;
+
+	return xocl_p2p_pages_init(pdev, xdev);
 }
 
 struct xocl_pci_funcs xdma_pci_ops = {
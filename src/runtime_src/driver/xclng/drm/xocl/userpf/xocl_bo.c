@@ -22,6 +22,15 @@
 #include <linux/dma-buf.h>
 #include <linux/pagemap.h>
 #include <linux/version.h>
+#include <linux/mmu_notifier.h>
+#include <linux/eventfd.h>
+#include <linux/anon_inodes.h>
+#include <linux/aio.h>
+#include <linux/uio.h>
+#include <linux/file.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 11, 0)
+#include <linux/sched/mm.h>
+#endif
 #ifdef XOCL_CMA_ALLOC
 #include <linux/cma.h>
 #endif
@@ -49,7 +58,7 @@ static inline void drm_free_large(void *ptr)
 
 static inline void *drm_malloc_ab(size_t nmemb, size_t size)
 {
-	return kvmalloc_array(nmemb, sizeof(struct page *), GFP_KERNEL);
+	return kvmalloc_array(nmemb, size, GFP_KERNEL);
 }
 #endif
 
@@ -68,6 +77,364 @@ static inline void __user *to_user_ptr(u64 address)
 	return (void __user *)(uintptr_t)address;
 }
 
+#if LINUX_VERSION_CODE < KERNEL_VERSION(4, 11, 0)
+static inline void mmgrab(struct mm_struct *mm)
+{
+	atomic_inc(&mm->mm_count);
+}
+#endif
+
+/*
+ * Userptr registration cache
+ *
+ * Pages pinned for a userptr BO are kept in a per client cache keyed by
+ * user address and number of pages, so that a new userptr BO on the same
+ * host memory reuses the pinned pages and their kernel mapping.  An MMU
+ * notifier on the client address space marks entries stale when the
+ * mapping of their range changes, stale entries are freed once no BO uses
+ * them.  Idle entries are evicted in LRU order beyond userptr_cache_mb.
+ *
+ * The cache lock is a spinlock since it is taken from the MMU notifier,
+ * pages are pinned and released outside the lock.
+ */
+static unsigned int userptr_cache_mb = 64;
+module_param(userptr_cache_mb, uint, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(userptr_cache_mb,
+	"Maximum size (in MB) of idle pinned userptr pages cached per process for reuse (0 = no caching)");
+
+/**
+ * struct xocl_uptr_cache: Pinned userptr pages of a client
+ *
+ * @ref: Held by the client and by each entry
+ * @lock: Protects @entries, @idle_pages, @seq and entry @users and @stale
+ * @entries: Entries, most recently used first
+ * @idle_pages: Number of pages in entries not used by any BO
+ * @seq: Incremented on each invalidation, detects races with pinning
+ * @mn: Notifier marking entries stale when user mappings change
+ * @mm: Address space of client, grabbed while @mn is registered
+ */
+struct xocl_uptr_cache {
+	struct kref		ref;
+	spinlock_t		lock;
+	struct list_head	entries;
+	unsigned long		idle_pages;
+	unsigned long		seq;
+	struct mmu_notifier	mn;
+	struct mm_struct       *mm;
+};
+
+/**
+ * struct xocl_uptr_entry: Pinned pages of one user address range
+ *
+ * @link: Entry is on cache list until it is freed or evicted
+ * @cache: Owning cache, or NULL if entry is not cached
+ * @addr: User address of range
+ * @npages: Number of pages in range
+ * @pages: Pinned pages
+ * @vmapping: Kernel mapping of @pages
+ * @users: Number of BOs using entry
+ * @stale: Set when entry must not be reused, it is freed when unused
+ */
+struct xocl_uptr_entry {
+	struct list_head	link;
+	struct xocl_uptr_cache *cache;
+	unsigned long		addr;
+	unsigned int		npages;
+	struct page	      **pages;
+	void		       *vmapping;
+	unsigned int		users;
+	bool			stale;
+};
+
+static void xocl_uptr_cache_release(struct kref *ref)
+{
+	struct xocl_uptr_cache *cache = container_of(ref, struct xocl_uptr_cache, ref);
+
+	mmu_notifier_unregister(&cache->mn, cache->mm);
+	mmdrop(cache->mm);
+	kfree(cache);
+}
+
+static void xocl_uptr_free(struct xocl_uptr_entry *entry)
+{
+	if (entry->vmapping)
+		vunmap(entry->vmapping);
+	xocl_release_pages(entry->pages, entry->npages, 0);
+	drm_free_large(entry->pages);
+	if (entry->cache)
+		kref_put(&entry->cache->ref, xocl_uptr_cache_release);
+	kfree(entry);
+}
+
+static void xocl_uptr_free_list(struct list_head *list)
+{
+	struct xocl_uptr_entry *entry, *next;
+
+	list_for_each_entry_safe(entry, next, list, link) {
+		list_del(&entry->link);
+		xocl_uptr_free(entry);
+	}
+}
+
+/* Mark entries overlapping [start,end) stale, called with cache lock held */
+static void xocl_uptr_invalidate(struct xocl_uptr_cache *cache,
+	unsigned long start, unsigned long end)
+{
+	struct xocl_uptr_entry *entry;
+
+	++cache->seq;
+	list_for_each_entry(entry, &cache->entries, link) {
+		unsigned long last = entry->addr + ((unsigned long)entry->npages << PAGE_SHIFT);
+		if (entry->stale || entry->addr >= end || last <= start)
+			continue;
+		entry->stale = true;
+		if (!entry->users)
+			cache->idle_pages -= entry->npages;
+	}
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 0, 0)
+static int xocl_uptr_invalidate_range_start(struct mmu_notifier *mn,
+	const struct mmu_notifier_range *range)
+{
+	struct xocl_uptr_cache *cache = container_of(mn, struct xocl_uptr_cache, mn);
+
+	spin_lock(&cache->lock);
+	xocl_uptr_invalidate(cache, range->start, range->end);
+	spin_unlock(&cache->lock);
+	return 0;
+}
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(4, 19, 0)
+static int xocl_uptr_invalidate_range_start(struct mmu_notifier *mn,
+	struct mm_struct *mm, unsigned long start, unsigned long end, bool blockable)
+{
+	struct xocl_uptr_cache *cache = container_of(mn, struct xocl_uptr_cache, mn);
+
+	spin_lock(&cache->lock);
+	xocl_uptr_invalidate(cache, start, end);
+	spin_unlock(&cache->lock);
+	return 0;
+}
+#else
+static void xocl_uptr_invalidate_range_start(struct mmu_notifier *mn,
+	struct mm_struct *mm, unsigned long start, unsigned long end)
+{
+	struct xocl_uptr_cache *cache = container_of(mn, struct xocl_uptr_cache, mn);
+
+	spin_lock(&cache->lock);
+	xocl_uptr_invalidate(cache, start, end);
+	spin_unlock(&cache->lock);
+}
+#endif
+
+static void xocl_uptr_mn_release(struct mmu_notifier *mn, struct mm_struct *mm)
+{
+	struct xocl_uptr_cache *cache = container_of(mn, struct xocl_uptr_cache, mn);
+
+	spin_lock(&cache->lock);
+	xocl_uptr_invalidate(cache, 0, ULONG_MAX);
+	spin_unlock(&cache->lock);
+}
+
+static const struct mmu_notifier_ops xocl_uptr_mn_ops = {
+	.release = xocl_uptr_mn_release,
+	.invalidate_range_start = xocl_uptr_invalidate_range_start,
+};
+
+/* Cache of client, created on first use.  NULL if caching is disabled */
+static struct xocl_uptr_cache *xocl_uptr_cache_get(struct client_ctx *client)
+{
+	struct xocl_uptr_cache *cache;
+
+	if (!client || !userptr_cache_mb)
+		return NULL;
+
+	if (client->uptr_cache)
+		return client->uptr_cache->mm == current->mm ? client->uptr_cache : NULL;
+
+	cache = kzalloc(sizeof(*cache), GFP_KERNEL);
+	if (!cache)
+		return NULL;
+
+	kref_init(&cache->ref);
+	spin_lock_init(&cache->lock);
+	INIT_LIST_HEAD(&cache->entries);
+	cache->mn.ops = &xocl_uptr_mn_ops;
+	cache->mm = current->mm;
+	mmgrab(cache->mm);
+	if (mmu_notifier_register(&cache->mn, cache->mm)) {
+		mmdrop(cache->mm);
+		kfree(cache);
+		return NULL;
+	}
+
+	mutex_lock(&client->lock);
+	if (client->uptr_cache) {
+		/* lost race with another thread of the client */
+		mutex_unlock(&client->lock);
+		kref_put(&cache->ref, xocl_uptr_cache_release);
+		return client->uptr_cache;
+	}
+	client->uptr_cache = cache;
+	mutex_unlock(&client->lock);
+	return cache;
+}
+
+/**
+ * xocl_uptr_pin() - Get pinned and mapped pages for a user address range
+ *
+ * @client: Client creating the userptr BO, or NULL
+ * @addr: Page aligned user address
+ * @npages: Number of pages
+ *
+ * Return: Entry with pinned pages, reused from cache if possible, or ERR_PTR
+ */
+static struct xocl_uptr_entry *xocl_uptr_pin(struct client_ctx *client,
+	unsigned long addr, unsigned int npages)
+{
+	struct xocl_uptr_cache *cache = xocl_uptr_cache_get(client);
+	struct xocl_uptr_entry *entry;
+	unsigned long seq = 0;
+	LIST_HEAD(stale);
+	int pinned;
+
+	if (cache) {
+		struct xocl_uptr_entry *next;
+		struct xocl_uptr_entry *found = NULL;
+
+		spin_lock(&cache->lock);
+		list_for_each_entry_safe(entry, next, &cache->entries, link) {
+			if (entry->stale && !entry->users) {
+				list_move(&entry->link, &stale);
+				continue;
+			}
+			if (!found && !entry->stale && entry->addr == addr && entry->npages == npages)
+				found = entry;
+		}
+		if (found) {
+			if (!found->users++)
+				cache->idle_pages -= npages;
+			list_move(&found->link, &cache->entries);
+		}
+		seq = cache->seq;
+		spin_unlock(&cache->lock);
+		xocl_uptr_free_list(&stale);
+		if (found)
+			return found;
+	}
+
+	entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry)
+		return ERR_PTR(-ENOMEM);
+	INIT_LIST_HEAD(&entry->link);
+	entry->addr = addr;
+	entry->npages = npages;
+	entry->users = 1;
+
+	entry->pages = drm_malloc_ab(npages, sizeof(*entry->pages));
+	if (!entry->pages) {
+		kfree(entry);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	pinned = get_user_pages_fast(addr, npages, 1, entry->pages);
+	if (pinned != npages) {
+		if (pinned > 0)
+			xocl_release_pages(entry->pages, pinned, 0);
+		drm_free_large(entry->pages);
+		kfree(entry);
+		return ERR_PTR(pinned < 0 ? pinned : -EFAULT);
+	}
+
+	/* TODO: resolve the cache issue */
+	entry->vmapping = vmap(entry->pages, npages, VM_MAP, PAGE_KERNEL);
+	if (!entry->vmapping) {
+		xocl_uptr_free(entry);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	if (cache) {
+		spin_lock(&cache->lock);
+		/* not cached if range may have been invalidated while pinning */
+		entry->stale = (seq != cache->seq);
+		entry->cache = cache;
+		kref_get(&cache->ref);
+		list_add(&entry->link, &cache->entries);
+		spin_unlock(&cache->lock);
+	}
+	else {
+		entry->stale = true;
+	}
+
+	return entry;
+}
+
+/**
+ * xocl_uptr_unpin() - Release a userptr BO's use of its pinned pages
+ *
+ * Pages stay pinned in the cache unless the entry is stale or evicted.
+ */
+static void xocl_uptr_unpin(struct xocl_uptr_entry *entry)
+{
+	struct xocl_uptr_cache *cache = entry->cache;
+	unsigned long limit = (unsigned long)userptr_cache_mb << (20 - PAGE_SHIFT);
+	LIST_HEAD(evict);
+
+	if (!cache) {
+		xocl_uptr_free(entry);
+		return;
+	}
+
+	spin_lock(&cache->lock);
+	if (!--entry->users) {
+		if (entry->stale) {
+			list_move(&entry->link, &evict);
+		}
+		else {
+			struct xocl_uptr_entry *lru, *prev;
+			cache->idle_pages += entry->npages;
+			list_for_each_entry_safe_reverse(lru, prev, &cache->entries, link) {
+				if (cache->idle_pages <= limit)
+					break;
+				if (lru->users || lru->stale)
+					continue;
+				cache->idle_pages -= lru->npages;
+				list_move(&lru->link, &evict);
+			}
+		}
+	}
+	spin_unlock(&cache->lock);
+	xocl_uptr_free_list(&evict);
+}
+
+/**
+ * xocl_uptr_cache_fini() - Release pinned userptr pages cached for client
+ *
+ * Called when the client is closed.  Entries still used by BOs are
+ * released with the BO.
+ */
+void xocl_uptr_cache_fini(struct client_ctx *client)
+{
+	struct xocl_uptr_cache *cache = client->uptr_cache;
+	struct xocl_uptr_entry *entry, *next;
+	LIST_HEAD(evict);
+
+	if (!cache)
+		return;
+
+	client->uptr_cache = NULL;
+	spin_lock(&cache->lock);
+	list_for_each_entry_safe(entry, next, &cache->entries, link) {
+		if (!entry->users)
+			list_move(&entry->link, &evict);
+		entry->stale = true;
+	}
+	cache->idle_pages = 0;
+	spin_unlock(&cache->lock);
+	xocl_uptr_free_list(&evict);
+	kref_put(&cache->ref, xocl_uptr_cache_release);
+}
+
 static size_t xocl_bo_physical_addr(const struct drm_xocl_bo *xobj)
 {
 	uint64_t paddr = xobj->mm_node ? xobj->mm_node->start : 0xffffffffffffffffull;
@@ -120,7 +487,11 @@ void xocl_free_bo(struct drm_gem_object *obj)
 	DRM_DEBUG("Freeing BO %p\n", xobj);
 
 	BO_ENTER("xobj %p pages %p", xobj, xobj->pages);
-	if (xobj->vmapping)
+	/*
+	 * pages and mapping of userptr BO are owned by its cache entry, of
+	 * host bank BO by the pinned host memory of the device
+	 */
+	if (xobj->vmapping && !xobj->uptr && !xocl_bo_host(xobj))
 		vunmap(xobj->vmapping);
 	xobj->vmapping = NULL;
 
@@ -128,15 +499,27 @@ void xocl_free_bo(struct drm_gem_object *obj)
 		unmap_mapping_range(xobj->dmabuf->file->f_mapping, 0, 0, 1);
 	}
 
+	/* unmap takes the entries passed to map, not the mapped count */
 	if (xobj->dma_nsg) {
-		pci_unmap_sg(xdev->core.pdev, xobj->sgt->sgl, xobj->dma_nsg,
-			PCI_DMA_BIDIRECTIONAL);
+		pci_unmap_sg(xdev->core.pdev, xobj->sgt->sgl,
+			xobj->sgt->orig_nents, PCI_DMA_BIDIRECTIONAL);
+		xobj->dma_nsg = 0;
+		atomic64_sub(obj->size, &xdev->sync_mapped);
+	}
+
+	if (xobj->sync_sgt) {
+		pci_unmap_sg(xdev->core.pdev, xobj->sync_sgt->sgl,
+			xobj->sync_sgt->orig_nents, PCI_DMA_BIDIRECTIONAL);
+		sg_free_table(xobj->sync_sgt);
+		kfree(xobj->sync_sgt);
+		xobj->sync_sgt = NULL;
+		atomic64_sub(xobj->sync_size, &xdev->sync_mapped);
 	}
 
 	if (xobj->pages) {
-		if (xocl_bo_userptr(xobj)) {
-			xocl_release_pages(xobj->pages, npages, 0);
-			drm_free_large(xobj->pages);
+		if (xobj->uptr) {
+			xocl_uptr_unpin(xobj->uptr);
+			xobj->uptr = NULL;
 		}
 #ifdef XOCL_CMA_ALLOC
 		else if (xocl_bo_cma(xobj)) {
@@ -146,13 +529,20 @@ void xocl_free_bo(struct drm_gem_object *obj)
 		}
 #endif
 		else if(xocl_bo_p2p(xobj)){
-			drm_free_large(xobj->pages);
-			/*devm_* will release all the pages while unload xocl driver*/
+			/* pages belong to the device P2P page pool, and
+			 * devm_* will release all the pages while unload xocl driver*/
 			xobj->bar_vmapping = NULL;
 		}
+		else if (xocl_bo_host(xobj)) {
+			/* slice of the pages of the device host memory */
+		}
 		else if (!xocl_bo_import(xobj)) {
 			drm_gem_put_pages(obj, xobj->pages, false, false);
 		}
+		else {
+			/* pages of an import belong to the exporter */
+			drm_free_large(xobj->pages);
+		}
 	}
 	xobj->pages = NULL;
 
@@ -172,7 +562,8 @@ void xocl_free_bo(struct drm_gem_object *obj)
 
 		if (obj->import_attach) {
 			DRM_DEBUG("Unnmapping attached dma buf\n");
-			dma_buf_unmap_attachment(obj->import_attach, xobj->sgt, DMA_TO_DEVICE);
+			dma_buf_unmap_attachment(obj->import_attach, xobj->sgt,
+				DMA_BIDIRECTIONAL);
 			drm_prime_gem_destroy(obj, NULL);
 		}
 	}
@@ -258,6 +649,7 @@ struct drm_xocl_bo *xocl_create_bo(struct drm_device *dev,
 	struct drm_xocl_bo *xobj;
 	struct xocl_dev *xdev = dev->dev_private;
 	unsigned ddr = xocl_bo_ddr_idx(user_flags);
+	bool long_lived = (user_type & DRM_XOCL_BO_LONG_LIVED) != 0;
 	u16 ddr_count = 0;
 	int err = 0;
 
@@ -313,7 +705,7 @@ struct drm_xocl_bo *xocl_create_bo(struct drm_device *dev,
 				goto out2;
 		}
 		err = xocl_mm_insert_node(xdev, ddr, xobj->mm_node,
-			xobj->base.size);
+			xobj->base.size, long_lived);
 		BO_DEBUG("insert mm_node:%p, start:%llx size: %llx",
 			xobj->mm_node, xobj->mm_node->start,
 			xobj->mm_node->size);
@@ -325,13 +717,16 @@ struct drm_xocl_bo *xocl_create_bo(struct drm_device *dev,
 		for (ddr = 0; ddr < ddr_count; ddr++) {
 			if  (!XOCL_IS_DDR_USED(xdev, ddr))
 				continue;
+			/* host bank is only used when asked for */
+			if (xdev->topology->m_mem_data[ddr].m_type == MEM_HOST)
+				continue;
 			if (user_type & DRM_XOCL_BO_P2P){
 				err = xocl_check_p2p_mem_bank(xdev, ddr);
 				if (err)
 					goto out2;
 			}
 			err = xocl_mm_insert_node(xdev, ddr,
-				xobj->mm_node, xobj->base.size);
+				xobj->mm_node, xobj->base.size, long_lived);
 			BO_DEBUG("insert mm_node:%p, start:%llx size: %llx",
 				xobj->mm_node, xobj->mm_node->start,
 				xobj->mm_node->size);
@@ -350,6 +745,8 @@ struct drm_xocl_bo *xocl_create_bo(struct drm_device *dev,
 	/* Record the DDR we allocated the buffer on */
 	//xobj->flags |= (1 << ddr);
 	xobj->flags = ddr;
+	if (xdev->topology && xdev->topology->m_mem_data[ddr].m_type == MEM_HOST)
+		xobj->type |= XOCL_BO_HOST;
 
 	return xobj;
 out2:
@@ -361,33 +758,6 @@ out3:
 	return ERR_PTR(err);
 }
 
-static struct page** xocl_p2p_get_pages(void *bar_vaddr, int npages)
-{
-	struct page *p, **pages;
-	int i;
-	uint64_t page_offset_enum = 0;
-
-	pages = drm_malloc_ab(npages, sizeof(struct page *));
-
-	if (pages == NULL)
-		return ERR_PTR(-ENOMEM);
-
-	for(i=0; i<npages;i++){
-		p = virt_to_page(bar_vaddr+page_offset_enum);
-		pages[i] = p;
-
-		if (IS_ERR(p))
-			goto fail;
-
-		page_offset_enum += PAGE_SIZE;
-	}
-
-	return pages;
-fail:
-	kvfree(pages);
-	return ERR_CAST(p);
-}
-
 /*
  * For ARE device do not reserve DDR space
  * In below import it will reuse the mm_node which is already created by other application
@@ -456,7 +826,7 @@ int xocl_create_bo_ioctl(struct drm_device *dev,
 //	}
 
 	if(bar_mapped){
-		if(!xdev->bypass_bar_addr){
+		if(!xdev->bypass_bar_addr || !xdev->p2p_pages){
 			DRM_ERROR("No P2P mem region available, Can't create p2p BO\n");
 			return -EINVAL;
 		}
@@ -471,7 +841,7 @@ int xocl_create_bo_ioctl(struct drm_device *dev,
 	}
 
 	if(bar_mapped){
-		if(xobj->mm_node->start >= xdev->bypass_bar_len){
+		if(xobj->mm_node->start + xobj->base.size > xdev->bypass_bar_len){
 			DRM_DEBUG("No enough P2P mem region available\n");
 			ret = -ENOMEM;
 			goto out_free;
@@ -505,7 +875,15 @@ int xocl_create_bo_ioctl(struct drm_device *dev,
 #else
 
 	    if(bar_mapped){
-		    xobj->pages = xocl_p2p_get_pages(xobj->bar_vmapping, xobj->base.size >> PAGE_SHIFT);
+		    /* slice of the pages premapped for the whole BAR */
+		    xobj->pages = xdev->p2p_pages + (xobj->mm_node->start >> PAGE_SHIFT);
+	    }
+	    else if (xocl_bo_host(xobj)) {
+		    /* slice of the pinned host memory at the offset in the bank */
+		    u64 host_off = xobj->mm_node->start - xdev->host_mem_base;
+
+		    xobj->pages = xdev->host_mem_pages + (host_off >> PAGE_SHIFT);
+		    xobj->vmapping = xdev->host_mem + host_off;
 	    }
 	    else{
 		    xobj->pages = drm_gem_get_pages(&xobj->base);
@@ -523,7 +901,7 @@ int xocl_create_bo_ioctl(struct drm_device *dev,
 		    goto out_free;
 	    }
 
-	    if(!bar_mapped){
+	    if(!bar_mapped && !xobj->vmapping){
 		    xobj->vmapping = vmap(xobj->pages, xobj->base.size >> PAGE_SHIFT, VM_MAP, PAGE_KERNEL);
 		    if (!xobj->vmapping) {
 			    ret = -ENOMEM;
@@ -553,6 +931,7 @@ int xocl_create_bo_ioctl(struct drm_device *dev,
     {
 	int ret;
 	struct drm_xocl_bo *xobj;
+	struct xocl_uptr_entry *entry;
 	unsigned int page_count;
 	struct drm_xocl_userptr_bo *args = data;
 	//unsigned ddr = args->flags & XOCL_MEM_BANK_MSK;
@@ -578,30 +957,28 @@ int xocl_create_bo_ioctl(struct drm_device *dev,
 		return PTR_ERR(xobj);
 	}
 
+	/* host bank memory is the device's own pinned memory, not user pages */
+	if (xocl_bo_host(xobj)) {
+		ret = -EINVAL;
+		goto out1;
+	}
+
 	/* Use the page rounded size so we can accurately account for number of pages */
 	page_count = xobj->base.size >> PAGE_SHIFT;
 
-	xobj->pages = drm_malloc_ab(page_count, sizeof(*xobj->pages));
-	if (!xobj->pages) {
-		ret = -ENOMEM;
+	entry = xocl_uptr_pin(filp->driver_priv, args->addr, page_count);
+	if (IS_ERR(entry)) {
+		ret = PTR_ERR(entry);
 		goto out1;
 	}
-	ret = get_user_pages_fast(args->addr, page_count, 1, xobj->pages);
-
-	if (ret != page_count)
-		goto out0;
+	xobj->uptr = entry;
+	xobj->pages = entry->pages;
+	xobj->vmapping = entry->vmapping;
 
 	xobj->sgt = drm_prime_pages_to_sg(xobj->pages, page_count);
 	if (IS_ERR(xobj->sgt)) {
 		ret = PTR_ERR(xobj->sgt);
-		goto out0;
-	}
-
-	/* TODO: resolve the cache issue */
-	xobj->vmapping = vmap(xobj->pages, page_count, VM_MAP, PAGE_KERNEL);
-
-	if (!xobj->vmapping) {
-		ret = -ENOMEM;
+		xobj->sgt = NULL;
 		goto out1;
 	}
 
@@ -614,9 +991,6 @@ int xocl_create_bo_ioctl(struct drm_device *dev,
 	drm_gem_object_unreference_unlocked(&xobj->base);
 	return ret;
 
-out0:
-	drm_free_large(xobj->pages);
-	xobj->pages = NULL;
 out1:
 	xocl_free_bo(&xobj->base);
 	DRM_DEBUG("handle creation failed\n");
@@ -676,36 +1050,206 @@ cleanup:
 	return ERR_PTR(-ENOMEM);
 }
 
-int xocl_sync_bo_ioctl(struct drm_device *dev,
-		       void *data,
-		       struct drm_file *filp)
+/*
+ * Mapped BO memory of a device kept across syncs.  Mappings hold IOMMU
+ * space or bounce buffers until the BO is freed, past the limit syncs
+ * map and unmap around each transfer.
+ */
+static unsigned int sync_map_cache_mb = 1024;
+module_param(sync_map_cache_mb, uint, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(sync_map_cache_mb,
+	"Maximum size (in MB) of BO DMA mappings kept across syncs per device (0 = map each sync)");
+
+/* Account a mapping to keep, false if it exceeds sync_map_cache_mb */
+static bool xocl_sync_map_reserve(struct xocl_dev *xdev, u64 size)
 {
-	const struct drm_xocl_bo *xobj;
+	u64 limit = (u64)sync_map_cache_mb << 20;
+
+	if (atomic64_add_return(size, &xdev->sync_mapped) <= limit)
+		return true;
+	atomic64_sub(size, &xdev->sync_mapped);
+	return false;
+}
+
+/*
+ * DMA mapped sg table for syncing a range of a BO, or NULL if the range
+ * is not cached. The whole BO and its first partial range stay mapped
+ * until the BO is freed, so repeated syncs skip building and mapping
+ * the sg table. The pages of a BO do not move while it exists.  The
+ * mappings of a device are capped by sync_map_cache_mb.
+ */
+static struct sg_table *xocl_sync_sgt(struct xocl_dev *xdev,
+	struct drm_xocl_bo *xobj, u64 offset, u64 size)
+{
+	struct sg_table *sgt = NULL;
+
+	if (xocl_bo_import(xobj) || !xobj->pages || !xobj->sgt)
+		return NULL;
+
+	mutex_lock(&xdev->mm_lock);
+	if (!offset && size == xobj->base.size) {
+		if (!xobj->dma_nsg && xocl_sync_map_reserve(xdev, size)) {
+			xobj->dma_nsg = pci_map_sg(xdev->core.pdev,
+				xobj->sgt->sgl, xobj->sgt->orig_nents,
+				PCI_DMA_BIDIRECTIONAL);
+			if (!xobj->dma_nsg)
+				atomic64_sub(size, &xdev->sync_mapped);
+		}
+		if (xobj->dma_nsg) {
+			xobj->sgt->nents = xobj->dma_nsg;
+			sgt = xobj->sgt;
+		}
+	} else if (xobj->sync_sgt) {
+		if (xobj->sync_offset == offset && xobj->sync_size == size)
+			sgt = xobj->sync_sgt;
+	} else if (xocl_sync_map_reserve(xdev, size)) {
+		sgt = alloc_onetime_sg_table(xobj->pages, offset, size);
+		if (IS_ERR(sgt)) {
+			sgt = NULL;
+			atomic64_sub(size, &xdev->sync_mapped);
+			goto out;
+		}
+		sgt->nents = pci_map_sg(xdev->core.pdev, sgt->sgl,
+			sgt->orig_nents, PCI_DMA_BIDIRECTIONAL);
+		if (!sgt->nents) {
+			sg_free_table(sgt);
+			kfree(sgt);
+			sgt = NULL;
+			atomic64_sub(size, &xdev->sync_mapped);
+			goto out;
+		}
+		xobj->sync_sgt = sgt;
+		xobj->sync_offset = offset;
+		xobj->sync_size = size;
+	}
+out:
+	mutex_unlock(&xdev->mm_lock);
+	return sgt;
+}
+
+/* Channel named by DRM_XOCL_SYNC_BO_CHANNEL() in sync flags, or -1 */
+static inline int xocl_sync_bo_channel(u32 flags)
+{
+	return (flags & DRM_XOCL_SYNC_BO_CHANNEL_VALID) ?
+		(int)(flags & DRM_XOCL_SYNC_BO_CHANNEL_MASK) : -1;
+}
+
+/*
+ * Transfers up to dma_fast_lane_kb may use the DMA channel reserved for
+ * small transfers, which the DMA subdevice only reserves on engines with
+ * 4 or more channels.  Larger syncs are split in dma_slice_kb slices and give
+ * up their channel between slices, so that queued transfers get a turn.
+ */
+static unsigned int dma_fast_lane_kb = 64;
+module_param(dma_fast_lane_kb, uint, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(dma_fast_lane_kb,
+	"Largest transfer (in KB) on the DMA channel reserved for small transfers (0 = no reserved channel)");
+
+static unsigned int dma_slice_kb = 8192;
+module_param(dma_slice_kb, uint, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(dma_slice_kb,
+	"Size (in KB) of the slices a large BO sync holds a DMA channel for (0 = no slicing)");
+
+static inline bool xocl_dma_small(u64 size)
+{
+	return !dma_fast_lane_kb || size <= ((u64)dma_fast_lane_kb << 10);
+}
+
+static inline int xocl_acquire_channel_size(struct xocl_dev *xdev, u32 dir,
+	int hint, u64 size)
+{
+	return xocl_acquire_channel_lane(xdev, dir, hint,
+		xocl_dma_small(size));
+}
+
+/*
+ * Describe @len bytes at @skip of the DMA mapped @src in @dst.  @dst
+ * shares the mapping of @src and is released with sg_free_table() only.
+ */
+static int xocl_slice_sgt(struct sg_table *src, u64 skip, u64 len,
+	struct sg_table *dst)
+{
+	struct scatterlist *sg, *out;
+	unsigned int i, n = 0;
+	u64 pos = 0, lo, hi;
+	int ret;
+
+	for_each_sg(src->sgl, sg, src->nents, i) {
+		if (pos + sg_dma_len(sg) > skip && pos < skip + len)
+			n++;
+		pos += sg_dma_len(sg);
+	}
+
+	ret = sg_alloc_table(dst, n, GFP_KERNEL);
+	if (ret)
+		return ret;
+
+	out = dst->sgl;
+	pos = 0;
+	for_each_sg(src->sgl, sg, src->nents, i) {
+		lo = max(pos, skip);
+		hi = min(pos + sg_dma_len(sg), skip + len);
+		if (lo < hi) {
+			sg_dma_address(out) = sg_dma_address(sg) + (lo - pos);
+			sg_dma_len(out) = hi - lo;
+			out->length = hi - lo;
+			out = sg_next(out);
+		}
+		pos += sg_dma_len(sg);
+		if (pos >= skip + len)
+			break;
+	}
+	dst->nents = n;
+	return 0;
+}
+
+/* DMA @sgt on a channel held for this transfer only */
+static ssize_t xocl_dma_sgt(struct xocl_dev *xdev, struct sg_table *sgt,
+	u32 dir, u64 paddr, u64 size, int hint, bool small, bool mapped)
+{
+	int channel;
+	ssize_t ret;
+
+	channel = xocl_acquire_channel_lane(xdev, dir, hint, small);
+	if (channel < 0)
+		return -EINVAL;
+
+	ret = xocl_migrate_bo(xdev, sgt, dir, paddr, channel, size, mapped);
+	if (ret >= 0)
+		ret = (ret == size) ? 0 : -EIO;
+	xocl_release_channel(xdev, dir, channel);
+	return ret;
+}
+
+/*
+ * DMA a range of a BO in direction @dir, 1 is to device.  @hint is the
+ * preferred DMA channel or -1.
+ */
+static int xocl_sync_bo(struct xocl_dev *xdev, struct drm_gem_object *gem_obj,
+	u32 dir, u64 offset, u64 size, int hint)
+{
+	struct drm_xocl_bo *xobj = to_xocl_bo(gem_obj);
 	struct sg_table *sgt;
+	struct sg_table *mapped;
+	struct sg_table slice;
+	bool small = xocl_dma_small(size);
+	bool imported = xocl_bo_import(xobj) && gem_obj->import_attach;
 	u64 paddr = 0;
-	int channel = 0;
+	u64 skip = 0;
+	u64 done, len, step;
 	ssize_t ret = 0;
-	const struct drm_xocl_sync_bo *args = data;
-	struct xocl_dev *xdev = dev->dev_private;
-
-	u32 dir = (args->dir == DRM_XOCL_SYNC_BO_TO_DEVICE) ? 1 : 0;
-	struct drm_gem_object *gem_obj = xocl_gem_object_lookup(dev, filp,
-							       args->handle);
-	if (!gem_obj) {
-		DRM_ERROR("Failed to look up GEM BO %d\n", args->handle);
-		return -ENOENT;
-	}
 
-	xobj = to_xocl_bo(gem_obj);
 	BO_ENTER("xobj %p", xobj);
-	sgt = xobj->sgt;
 
 	if(xocl_bo_p2p(xobj)){
 		DRM_DEBUG("P2P_BO doesn't support sync_bo\n");
-		ret = -EOPNOTSUPP;
-		goto out;
+		return -EOPNOTSUPP;
 	}
 
+	/* kernels access host bank BOs in place, nothing to migrate */
+	if (xocl_bo_host(xobj))
+		return 0;
+
 	//Sarab: If it is a remote BO then why do sync over ARE.
 	//We should do sync directly using the other device which this bo locally.
 	//So that txfer is: HOST->PCIE->DDR; Else it will be HOST->PCIE->ARE->DDR
@@ -718,50 +1262,398 @@ int xocl_sync_bo_ioctl(struct drm_device *dev,
 	if (xdev->offline)
 		return -ENODEV;
 
+	if (size > gem_obj->size || offset > gem_obj->size - size)
+		return -EINVAL;
 
-	if ((args->offset + args->size) > gem_obj->size) {
-		ret = -EINVAL;
-		goto out;
-	}
+	paddr += offset;
 
-	/* only invalidate the range of addresses requested by the user */
 	/*
-	if (args->dir == DRM_XOCL_SYNC_BO_TO_DEVICE)
-		flush_kernel_vmap_range(kaddr, args->size);
-	else if (args->dir == DRM_XOCL_SYNC_BO_FROM_DEVICE)
-		invalidate_kernel_vmap_range(kaddr, args->size);
-	else {
-		ret = -EINVAL;
-		goto out;
-	}
-	*/
-	paddr += args->offset;
+	 * The exporter mapped an imported table for this device when it was
+	 * attached and owns its coherency, DMA straight out of that table.
+	 */
+	if (imported) {
+		mapped = xobj->sgt;
+		skip = offset;
+	} else
+		mapped = xocl_sync_sgt(xdev, xobj, offset, size);
+
+	/* slices are cut from the mapped table or from the BO pages */
+	step = size;
+	if (dma_slice_kb && (mapped || xobj->pages))
+		step = max_t(u64, (u64)dma_slice_kb << 10, PAGE_SIZE);
 
-	if (args->offset || (args->size != xobj->base.size)) {
-		sgt = alloc_onetime_sg_table(xobj->pages, args->offset, args->size);
-		if (IS_ERR(sgt)) {
-			ret = PTR_ERR(sgt);
-			goto out;
+	//drm_clflush_sg(sgt);
+	if (mapped && dir && !imported)
+		dma_sync_sg_for_device(&xdev->core.pdev->dev, mapped->sgl,
+			mapped->orig_nents, DMA_BIDIRECTIONAL);
+
+	for (done = 0; !ret && done < size; done += len) {
+		len = min(size - done, step);
+		sgt = xobj->sgt;
+		if (mapped && len == size && (!imported || len == gem_obj->size))
+			sgt = mapped;
+		else if (mapped) {
+			ret = xocl_slice_sgt(mapped, skip + done, len, &slice);
+			if (ret)
+				break;
+			sgt = &slice;
+		} else if (offset + done || (len != xobj->base.size)) {
+			sgt = alloc_onetime_sg_table(xobj->pages, offset + done,
+				len);
+			if (IS_ERR(sgt)) {
+				ret = PTR_ERR(sgt);
+				break;
+			}
 		}
-	}
 
-	//drm_clflush_sg(sgt);
-	channel = xocl_acquire_channel(xdev, dir);
+		/* Now perform DMA */
+		ret = xocl_dma_sgt(xdev, sgt, dir, paddr + done, len, hint,
+			small, mapped != NULL);
 
-	if (channel < 0) {
-		ret = -EINVAL;
-		goto clear;
+		if (sgt == &slice)
+			sg_free_table(&slice);
+		else if (sgt != mapped && sgt != xobj->sgt) {
+			sg_free_table(sgt);
+			kfree(sgt);
+		}
 	}
-	/* Now perform DMA */
-	ret = xocl_migrate_bo(xdev, sgt, dir, paddr, channel, args->size);
+
+	if (mapped && !dir && !imported)
+		dma_sync_sg_for_cpu(&xdev->core.pdev->dev, mapped->sgl,
+			mapped->orig_nents, DMA_BIDIRECTIONAL);
+	if (!ret)
+		xocl_mm_account_dma(xdev, xocl_bo_ddr_idx(xobj->flags), dir,
+			size);
+	return ret;
+}
+
+int xocl_sync_bo_ioctl(struct drm_device *dev,
+		       void *data,
+		       struct drm_file *filp)
+{
+	int ret;
+	const struct drm_xocl_sync_bo *args = data;
+	struct xocl_dev *xdev = dev->dev_private;
+
+	u32 dir = (args->dir == DRM_XOCL_SYNC_BO_TO_DEVICE) ? 1 : 0;
+	struct drm_gem_object *gem_obj = xocl_gem_object_lookup(dev, filp,
+							       args->handle);
+	if (!gem_obj) {
+		DRM_ERROR("Failed to look up GEM BO %d\n", args->handle);
+		return -ENOENT;
+	}
+
+	xocl_client_dma(filp, args->size);
+	ret = xocl_sync_bo(xdev, gem_obj, dir, args->offset, args->size,
+		xocl_sync_bo_channel(args->flags));
+	drm_gem_object_unreference_unlocked(gem_obj);
+	return ret;
+}
+
+/*
+ * DMA @n ranges of a BO in direction @dir as one descriptor chain.  The
+ * pages of all ranges are DMA mapped as one table, which is then split at
+ * range boundaries so that each entry has its own device address.
+ * Returns -EOPNOTSUPP if the ranges need one transfer each.
+ */
+static int xocl_sync_bo_chain(struct xocl_dev *xdev,
+	struct drm_gem_object *gem_obj, u32 dir,
+	const struct drm_xocl_sync_bo *ranges, u32 n, int hint)
+{
+	struct drm_xocl_bo *xobj = to_xocl_bo(gem_obj);
+	int dma_dir = dir ? PCI_DMA_TODEVICE : PCI_DMA_FROMDEVICE;
+	struct sg_table pages, chain;
+	struct scatterlist *sg, *out = NULL;
+	u64 *paddrs = NULL;
+	u64 paddr, total = 0, pos, lo, hi, start;
+	unsigned int npages = 0, nchain, i, pass;
+	int channel, nents;
+	ssize_t ret;
+	u32 r;
+
+	if (xocl_bo_p2p(xobj) || xocl_bo_host(xobj) || xocl_bo_import(xobj) ||
+	    !xobj->pages || !xocl_migrate_bo_v_supported(xdev))
+		return -EOPNOTSUPP;
+
+	paddr = xocl_bo_physical_addr(xobj);
+	if (paddr == 0xffffffffffffffffull)
+		return -EINVAL;
+
+	if (xdev->offline)
+		return -ENODEV;
+
+	for (r = 0; r < n; ++r) {
+		if (ranges[r].size > gem_obj->size ||
+		    ranges[r].offset > gem_obj->size - ranges[r].size)
+			return -EINVAL;
+		if (ranges[r].size)
+			npages += DIV_ROUND_UP(offset_in_page(ranges[r].offset) +
+				ranges[r].size, PAGE_SIZE);
+		total += ranges[r].size;
+	}
+
+	/* large syncs give up their channel between slices */
+	if (!total || (dma_slice_kb && total > ((u64)dma_slice_kb << 10)))
+		return -EOPNOTSUPP;
+
+	ret = sg_alloc_table(&pages, npages, GFP_KERNEL);
+	if (ret)
+		return ret;
+
+	sg = pages.sgl;
+	for (r = 0; r < n; ++r) {
+		u64 off = ranges[r].offset;
+		u64 left = ranges[r].size;
+
+		while (left) {
+			unsigned int poff = offset_in_page(off);
+			unsigned int len = min_t(u64, left, PAGE_SIZE - poff);
+
+			sg_set_page(sg, xobj->pages[off >> PAGE_SHIFT], len, poff);
+			sg = sg_next(sg);
+			off += len;
+			left -= len;
+		}
+	}
+
+	nents = pci_map_sg(xdev->core.pdev, pages.sgl, pages.orig_nents,
+		dma_dir);
+	if (!nents) {
+		ret = -EIO;
+		goto free_pages;
+	}
+
+	/*
+	 * Mapped entries may have been merged across ranges, the first pass
+	 * counts the chain entries and the second one fills them in
+	 */
+	for (pass = 0; pass < 2; ++pass) {
+		nchain = 0;
+		pos = start = 0;
+		r = 0;
+		for_each_sg(pages.sgl, sg, nents, i) {
+			for (lo = pos; lo < pos + sg_dma_len(sg); lo = hi) {
+				while (lo >= start + ranges[r].size)
+					start += ranges[r++].size;
+				hi = min(pos + sg_dma_len(sg),
+					start + ranges[r].size);
+				if (pass) {
+					sg_dma_address(out) = sg_dma_address(sg) +
+						(lo - pos);
+					sg_dma_len(out) = hi - lo;
+					out->length = hi - lo;
+					paddrs[nchain] = paddr + ranges[r].offset +
+						(lo - start);
+					out = sg_next(out);
+				}
+				nchain++;
+			}
+			pos += sg_dma_len(sg);
+		}
+
+		if (pass)
+			break;
+
+		paddrs = kmalloc_array(nchain, sizeof(*paddrs), GFP_KERNEL);
+		if (!paddrs) {
+			ret = -ENOMEM;
+			goto unmap;
+		}
+		ret = sg_alloc_table(&chain, nchain, GFP_KERNEL);
+		if (ret)
+			goto unmap;
+		out = chain.sgl;
+	}
+	chain.nents = nchain;
+
+	channel = xocl_acquire_channel_lane(xdev, dir, hint,
+		xocl_dma_small(total));
+	if (channel < 0) {
+		ret = -EINVAL;
+		goto free_chain;
+	}
+	ret = xocl_migrate_bo_v(xdev, &chain, dir, paddrs, channel, total);
 	if (ret >= 0)
-		ret = (ret == args->size) ? 0 : -EIO;
+		ret = (ret == total) ? 0 : -EIO;
 	xocl_release_channel(xdev, dir, channel);
-clear:
-	if (args->offset || (args->size != xobj->base.size)) {
-		sg_free_table(sgt);
-		kfree(sgt);
+
+free_chain:
+	sg_free_table(&chain);
+unmap:
+	kfree(paddrs);
+	pci_unmap_sg(xdev->core.pdev, pages.sgl, pages.orig_nents, dma_dir);
+free_pages:
+	sg_free_table(&pages);
+	if (!ret)
+		xocl_mm_account_dma(xdev, xocl_bo_ddr_idx(xobj->flags), dir,
+			total);
+	return ret;
+}
+
+int xocl_sync_bo_v_ioctl(struct drm_device *dev,
+			 void *data,
+			 struct drm_file *filp)
+{
+	const struct drm_xocl_sync_bo_v *args = data;
+	struct xocl_dev *xdev = dev->dev_private;
+	struct drm_xocl_sync_bo *ranges;
+	u32 i = 0;
+	int ret = 0;
+
+	if (args->flags || !args->num_ranges ||
+	    args->num_ranges > DRM_XOCL_SYNC_BO_V_MAX)
+		return -EINVAL;
+
+	ranges = drm_malloc_ab(args->num_ranges, sizeof(*ranges));
+	if (!ranges)
+		return -ENOMEM;
+
+	if (copy_from_user(ranges, to_user_ptr(args->ranges_ptr),
+			   args->num_ranges * sizeof(*ranges))) {
+		ret = -EFAULT;
+		goto out;
 	}
+
+	while (!ret && i < args->num_ranges) {
+		const struct drm_xocl_sync_bo *first = &ranges[i];
+		u32 dir = (first->dir == DRM_XOCL_SYNC_BO_TO_DEVICE) ? 1 : 0;
+		int hint = xocl_sync_bo_channel(first->flags);
+		struct drm_gem_object *gem_obj;
+		u64 size = first->size;
+		u32 n, j;
+
+		/* following ranges of the same BO and direction */
+		for (n = 1; i + n < args->num_ranges; ++n) {
+			const struct drm_xocl_sync_bo *next = &ranges[i + n];
+			if (next->handle != first->handle || next->dir != first->dir)
+				break;
+			size += next->size;
+		}
+
+		gem_obj = xocl_gem_object_lookup(dev, filp, first->handle);
+		if (!gem_obj) {
+			DRM_ERROR("Failed to look up GEM BO %d\n", first->handle);
+			ret = -ENOENT;
+			break;
+		}
+		xocl_client_dma(filp, size);
+
+		if (n > 1)
+			ret = xocl_sync_bo_chain(xdev, gem_obj, dir, first, n,
+				hint);
+		else
+			ret = -EOPNOTSUPP;
+
+		/* otherwise one transfer per run of adjacent ranges */
+		if (ret == -EOPNOTSUPP) {
+			ret = 0;
+			for (j = 0; !ret && j < n; ) {
+				u64 offset = first[j].offset;
+
+				for (size = first[j++].size; j < n &&
+				     first[j].offset == offset + size; ++j)
+					size += first[j].size;
+				ret = xocl_sync_bo(xdev, gem_obj, dir, offset,
+					size, hint);
+			}
+		}
+		drm_gem_object_unreference_unlocked(gem_obj);
+		i += n;
+	}
+
+out:
+	drm_free_large(ranges);
+	return ret;
+}
+
+/**
+ * struct xocl_sync_work: Pending asynchronous sync of a BO
+ *
+ * @work: Queued on device sync workqueue
+ * @xdev: Device of BO
+ * @gem_obj: BO to sync, referenced until the sync completes
+ * @trigger: Eventfd signaled on completion
+ * @dir: 1 is to device
+ * @offset: Offset into BO
+ * @size: Number of bytes to sync
+ */
+struct xocl_sync_work {
+	struct work_struct	work;
+	struct xocl_dev	       *xdev;
+	struct drm_gem_object  *gem_obj;
+	struct eventfd_ctx     *trigger;
+	u32			dir;
+	u64			offset;
+	u64			size;
+};
+
+static void xocl_sync_bo_work(struct work_struct *work)
+{
+	struct xocl_sync_work *sw = container_of(work, struct xocl_sync_work, work);
+	int ret = xocl_sync_bo(sw->xdev, sw->gem_obj, sw->dir, sw->offset,
+		sw->size, -1);
+
+	if (ret)
+		DRM_DEBUG("async sync of xobj %p failed %d\n", to_xocl_bo(sw->gem_obj), ret);
+	eventfd_signal(sw->trigger, ret ? DRM_XOCL_SYNC_BO_ASYNC_FAILED : 1);
+	eventfd_ctx_put(sw->trigger);
+	drm_gem_object_unreference_unlocked(sw->gem_obj);
+	kfree(sw);
+}
+
+int xocl_sync_bo_async_ioctl(struct drm_device *dev,
+			     void *data,
+			     struct drm_file *filp)
+{
+	const struct drm_xocl_sync_bo_async *args = data;
+	struct xocl_dev *xdev = dev->dev_private;
+	struct drm_gem_object *gem_obj;
+	struct xocl_sync_work *sw;
+	int ret;
+
+	if (args->flags)
+		return -EINVAL;
+
+	if (args->dir != DRM_XOCL_SYNC_BO_TO_DEVICE &&
+	    args->dir != DRM_XOCL_SYNC_BO_FROM_DEVICE)
+		return -EINVAL;
+
+	gem_obj = xocl_gem_object_lookup(dev, filp, args->handle);
+	if (!gem_obj) {
+		DRM_ERROR("Failed to look up GEM BO %d\n", args->handle);
+		return -ENOENT;
+	}
+
+	/* reject what the sync would reject before returning to caller */
+	if (args->size > gem_obj->size || args->offset > gem_obj->size - args->size) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	sw = kzalloc(sizeof(*sw), GFP_KERNEL);
+	if (!sw) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	sw->trigger = eventfd_ctx_fdget(args->fd);
+	if (IS_ERR(sw->trigger)) {
+		ret = PTR_ERR(sw->trigger);
+		kfree(sw);
+		goto out;
+	}
+
+	INIT_WORK(&sw->work, xocl_sync_bo_work);
+	sw->xdev = xdev;
+	sw->gem_obj = gem_obj;
+	sw->dir = (args->dir == DRM_XOCL_SYNC_BO_TO_DEVICE) ? 1 : 0;
+	sw->offset = args->offset;
+	sw->size = args->size;
+	xocl_client_dma(filp, args->size);
+	/* work owns the BO reference from here */
+	queue_work(xdev->sync_wq, &sw->work);
+	return 0;
+
 out:
 	drm_gem_object_unreference_unlocked(gem_obj);
 	return ret;
@@ -834,6 +1726,10 @@ int xocl_pwrite_bo_ioctl(struct drm_device *dev, void *data,
 	}
 
 	kaddr = xobj->vmapping ? xobj->vmapping : xobj->bar_vmapping;
+	if (!kaddr) {
+		ret = -EOPNOTSUPP;
+		goto out;
+	}
 	kaddr += args->offset;
 
 	ret = copy_from_user(kaddr, user_data, args->size);
@@ -883,6 +1779,10 @@ int xocl_pread_bo_ioctl(struct drm_device *dev, void *data,
 	xobj = to_xocl_bo(gem_obj);
 	BO_ENTER("xobj %p", xobj);
 	kaddr = xobj->vmapping ? xobj->vmapping : xobj->bar_vmapping;
+	if (!kaddr) {
+		ret = -EOPNOTSUPP;
+		goto out;
+	}
 	kaddr += args->offset;
 
 	ret = copy_to_user(user_data, kaddr, args->size);
@@ -966,19 +1866,23 @@ int xocl_copy_bo_ioctl(struct drm_device *dev,
 		}
 	}
 
-	channel = xocl_acquire_channel(xdev, dir);
+	channel = xocl_acquire_channel_size(xdev, dir, -1, args->size);
 
 	if (channel < 0) {
 		ret = -EINVAL;
 		goto clear;
 	}
 	/* Now perform DMA */
+	xocl_client_dma(filp, args->size);
 	ret = xocl_migrate_bo(xdev, sgt, dir, paddr, channel,
-		args->size);
+		args->size, false);
 
 	if (ret >= 0)
 		ret = (ret == args->size) ? 0 : -EIO;
 	xocl_release_channel(xdev, dir, channel);
+	if (!ret)
+		xocl_mm_account_dma(xdev, xocl_bo_ddr_idx(src_xobj->flags),
+			dir, args->size);
 
 
 clear:
@@ -1034,6 +1938,18 @@ static struct drm_xocl_bo *xocl_is_exporting_xare(struct drm_device *dev, struct
 	return NULL;
 }
 
+static bool xocl_sgt_has_pages(struct sg_table *sgt)
+{
+	struct scatterlist *sg;
+	int i;
+
+	for_each_sg(sgt->sgl, sg, sgt->orig_nents, i) {
+		if (!sg_page(sg))
+			return false;
+	}
+	return true;
+}
+
 struct drm_gem_object *xocl_gem_prime_import_sg_table(struct drm_device *dev,
 						      struct dma_buf_attachment *attach, struct sg_table *sgt)
 {
@@ -1056,8 +1972,16 @@ struct drm_gem_object *xocl_gem_prime_import_sg_table(struct drm_device *dev,
 		return (struct drm_gem_object *)importing_xobj;
 	}
 
-	importing_xobj->flags |= XOCL_BO_IMPORT;
+	importing_xobj->type |= XOCL_BO_IMPORT;
 	importing_xobj->sgt = sgt;
+
+	/*
+	 * Device memory of a GPU or NIC has no struct pages behind it, such a
+	 * buffer is only reachable by DMA and not mapped for the CPU.
+	 */
+	if (!xocl_sgt_has_pages(sgt))
+		goto out_mmap;
+
 	importing_xobj->pages = drm_malloc_ab(attach->dmabuf->size >> PAGE_SHIFT, sizeof(*importing_xobj->pages));
 	if (!importing_xobj->pages) {
 		ret = -ENOMEM;
@@ -1077,6 +2001,7 @@ struct drm_gem_object *xocl_gem_prime_import_sg_table(struct drm_device *dev,
 		goto out_free;
 	}
 
+out_mmap:
 	ret = drm_gem_create_mmap_offset(&importing_xobj->base);
 	if (ret < 0)
 		goto out_free;
@@ -1168,6 +2093,91 @@ clear_pages:
 	return ret;
 }
 
+/*
+ * Pin @nr user buffers into one sg table, in order, so that they are
+ * transferred by one DMA request.
+ */
+int xocl_init_unmgd_v(struct drm_xocl_unmgd *unmgd, const struct iovec *iov,
+	unsigned long nr, u32 write)
+{
+	struct scatterlist *sg;
+	unsigned int npages = 0;
+	unsigned long i;
+	int ret;
+
+	memset(unmgd, 0, sizeof(struct drm_xocl_unmgd));
+
+	for (i = 0; i < nr; i++) {
+		unsigned long start = (unsigned long)iov[i].iov_base;
+
+		if (!access_ok((write == 1) ? VERIFY_READ : VERIFY_WRITE,
+			iov[i].iov_base, iov[i].iov_len))
+			return -EFAULT;
+		if (iov[i].iov_len)
+			npages += (PAGE_ALIGN(start + iov[i].iov_len) -
+				(start & PAGE_MASK)) >> PAGE_SHIFT;
+	}
+	if (!npages)
+		return -EINVAL;
+
+	unmgd->pages = drm_malloc_ab(npages, sizeof(*unmgd->pages));
+	if (!unmgd->pages)
+		return -ENOMEM;
+
+	unmgd->sgt = kzalloc(sizeof(struct sg_table), GFP_KERNEL);
+	if (!unmgd->sgt) {
+		ret = -ENOMEM;
+		goto clear_pages;
+	}
+
+	ret = sg_alloc_table(unmgd->sgt, npages, GFP_KERNEL);
+	if (ret) {
+		kfree(unmgd->sgt);
+		goto clear_pages;
+	}
+
+	sg = unmgd->sgt->sgl;
+	for (i = 0; i < nr; i++) {
+		unsigned long start = (unsigned long)iov[i].iov_base;
+		size_t left = iov[i].iov_len;
+		unsigned int offset = start & ~PAGE_MASK;
+		struct page **pages = unmgd->pages + unmgd->npages;
+		int n, j;
+
+		if (!left)
+			continue;
+		n = (PAGE_ALIGN(start + left) - (start & PAGE_MASK)) >>
+			PAGE_SHIFT;
+		ret = get_user_pages_fast(start, n, (write == 0) ? 1 : 0,
+			pages);
+		if (ret > 0)
+			unmgd->npages += ret;
+		if (ret != n) {
+			ret = (ret < 0) ? ret : -EFAULT;
+			goto clear_unmgd;
+		}
+
+		for (j = 0; j < n; j++) {
+			size_t len = min_t(size_t, left, PAGE_SIZE - offset);
+
+			sg_set_page(sg, pages[j], len, offset);
+			sg = sg_next(sg);
+			left -= len;
+			offset = 0;
+		}
+	}
+
+	return 0;
+
+clear_unmgd:
+	xocl_finish_unmgd(unmgd);
+	return ret;
+clear_pages:
+	drm_free_large(unmgd->pages);
+	unmgd->pages = NULL;
+	return ret;
+}
+
 void xocl_finish_unmgd(struct drm_xocl_unmgd *unmgd)
 {
 	if (!unmgd->pages)
@@ -1231,15 +2241,16 @@ int xocl_pwrite_unmgd_ioctl(struct drm_device *dev, void *data,
 		return ret;
 	}
 
-	channel = xocl_acquire_channel(xdev, dir);
+	channel = xocl_acquire_channel_size(xdev, dir, -1, args->size);
 	if (channel < 0) {
 		userpf_err(xdev, "acquire channel failed");
 		ret = -EINVAL;
 		goto clear;
 	}
 	/* Now perform DMA */
+	xocl_client_dma(filp, args->size);
 	ret = xocl_migrate_bo(xdev, unmgd.sgt, dir, args->paddr, channel,
-		args->size);
+		args->size, false);
 	if (ret >= 0)
 		ret = (ret == args->size) ? 0 : -EIO;
 	xocl_release_channel(xdev, dir, channel);
@@ -1282,7 +2293,7 @@ int xocl_pread_unmgd_ioctl(struct drm_device *dev, void *data,
 		return ret;
 	}
 
-	channel = xocl_acquire_channel(xdev, dir);
+	channel = xocl_acquire_channel_size(xdev, dir, -1, args->size);
 
 	if (channel < 0) {
 		userpf_err(xdev, "acquire channel failed");
@@ -1290,8 +2301,9 @@ int xocl_pread_unmgd_ioctl(struct drm_device *dev, void *data,
 		goto clear;
 	}
 	/* Now perform DMA */
+	xocl_client_dma(filp, args->size);
 	ret = xocl_migrate_bo(xdev, unmgd.sgt, dir, args->paddr, channel,
-		args->size);
+		args->size, false);
 	if (ret >= 0)
 		ret = (ret == args->size) ? 0 : -EIO;
 
@@ -1301,6 +2313,346 @@ clear:
 	return ret;
 }
 
+/*
+ * Combined write and sync, or sync and read, of at least bo_rw_dma_kb are
+ * DMAed straight between the user pages and device memory, skipping the
+ * copy through the host copy of the BO.
+ */
+static unsigned int bo_rw_dma_kb = 1024;
+module_param(bo_rw_dma_kb, uint, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(bo_rw_dma_kb,
+	"Smallest BO write/read with sync (in KB) DMAed directly from/to user memory (0 = always copy through the BO)");
+
+/* DMA between user memory and device memory, pinning a slice at a time */
+static int xocl_dma_user(struct xocl_dev *xdev, u64 data_ptr, u64 paddr,
+	u64 size, u32 dir)
+{
+	struct drm_xocl_unmgd unmgd;
+	bool small = xocl_dma_small(size);
+	u64 done, len, step = size;
+	int ret = 0;
+
+	if (dma_slice_kb)
+		step = max_t(u64, (u64)dma_slice_kb << 10, PAGE_SIZE);
+
+	for (done = 0; !ret && done < size; done += len) {
+		len = min(size - done, step);
+		ret = xocl_init_unmgd(&unmgd, data_ptr + done, len, dir);
+		if (ret)
+			break;
+		ret = xocl_dma_sgt(xdev, unmgd.sgt, dir, paddr + done, len, -1,
+			small, false);
+		xocl_finish_unmgd(&unmgd);
+	}
+	return ret;
+}
+
+/*
+ * Write to a BO and sync the range to the device (@dir 1), or sync the
+ * range from the device and read it (@dir 0).
+ */
+static int xocl_rw_sync_bo(struct drm_device *dev, struct drm_file *filp,
+	u32 handle, u64 offset, u64 size, u64 data_ptr, u32 dir)
+{
+	struct xocl_dev *xdev = dev->dev_private;
+	struct drm_xocl_bo *xobj;
+	struct drm_gem_object *gem_obj = xocl_gem_object_lookup(dev, filp,
+							       handle);
+	char __user *user_data = to_user_ptr(data_ptr);
+	u64 paddr;
+	void *kaddr;
+	int ret = 0;
+
+	if (!gem_obj) {
+		DRM_ERROR("Failed to look up GEM BO %d\n", handle);
+		return -ENOENT;
+	}
+
+	if ((offset > gem_obj->size) || (size > gem_obj->size)
+	    || ((offset + size) > gem_obj->size)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (size == 0)
+		goto out;
+
+	if (!access_ok(dir ? VERIFY_READ : VERIFY_WRITE, user_data, size)) {
+		ret = -EFAULT;
+		goto out;
+	}
+
+	xobj = to_xocl_bo(gem_obj);
+	BO_ENTER("xobj %p", xobj);
+
+	if (xocl_bo_userptr(xobj)) {
+		ret = -EPERM;
+		goto out;
+	}
+
+	if (xocl_bo_p2p(xobj)) {
+		ret = -EOPNOTSUPP;
+		goto out;
+	}
+
+	if (!bo_rw_dma_kb || size < ((u64)bo_rw_dma_kb << 10)) {
+		kaddr = xobj->vmapping ? xobj->vmapping : xobj->bar_vmapping;
+		kaddr += offset;
+		if (dir && copy_from_user(kaddr, user_data, size)) {
+			ret = -EFAULT;
+			goto out;
+		}
+		ret = xocl_sync_bo(xdev, gem_obj, dir, offset, size, -1);
+		if (!ret && !dir && copy_to_user(user_data, kaddr, size))
+			ret = -EFAULT;
+		goto out;
+	}
+
+	/* If device is offline (due to error), reject all DMA requests */
+	if (xdev->offline) {
+		ret = -ENODEV;
+		goto out;
+	}
+
+	paddr = xocl_bo_physical_addr(xobj);
+	if (paddr == 0xffffffffffffffffull) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	ret = xocl_dma_user(xdev, data_ptr, paddr + offset, size, dir);
+out:
+	drm_gem_object_unreference_unlocked(gem_obj);
+	return ret;
+}
+
+int xocl_pwrite_sync_bo_ioctl(struct drm_device *dev, void *data,
+	struct drm_file *filp)
+{
+	const struct drm_xocl_pwrite_bo *args = data;
+
+	xocl_client_dma(filp, args->size);
+	return xocl_rw_sync_bo(dev, filp, args->handle, args->offset,
+		args->size, args->data_ptr, 1);
+}
+
+int xocl_pread_sync_bo_ioctl(struct drm_device *dev, void *data,
+	struct drm_file *filp)
+{
+	const struct drm_xocl_pread_bo *args = data;
+
+	xocl_client_dma(filp, args->size);
+	return xocl_rw_sync_bo(dev, filp, args->handle, args->offset,
+		args->size, args->data_ptr, 0);
+}
+
+/**
+ * struct xocl_unmgd_file: File opened by DRM_IOCTL_XOCL_UNMGD_FD
+ *
+ * @xdev: Device the file DMAs to and from
+ * @drm_filp: DRM file the fd was opened from, referenced by the file
+ *
+ * Position of a read or write on the file is the device address, so
+ * pread/pwrite, AIO and io_uring move data like xclUnmgdPread/Pwrite.
+ */
+struct xocl_unmgd_file {
+	struct xocl_dev	       *xdev;
+	struct file	       *drm_filp;
+};
+
+/**
+ * struct xocl_unmgd_work: Pending asynchronous unmanaged DMA
+ *
+ * @work: Queued on device sync workqueue
+ * @xdev: Device of the transfer
+ * @kiocb: Completed when the DMA is done
+ * @unmgd: User pages, pinned by the submitter
+ * @paddr: Device address
+ * @size: Number of bytes to transfer
+ * @dir: 1 is to device
+ */
+struct xocl_unmgd_work {
+	struct work_struct	work;
+	struct xocl_dev	       *xdev;
+	struct kiocb	       *kiocb;
+	struct drm_xocl_unmgd	unmgd;
+	u64			paddr;
+	u64			size;
+	u32			dir;
+};
+
+static void xocl_unmgd_work(struct work_struct *work)
+{
+	struct xocl_unmgd_work *uw = container_of(work,
+		struct xocl_unmgd_work, work);
+	ssize_t ret = xocl_dma_sgt(uw->xdev, uw->unmgd.sgt, uw->dir,
+		uw->paddr, uw->size, -1, xocl_dma_small(uw->size), false);
+
+	xocl_finish_unmgd(&uw->unmgd);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,16,0)
+	uw->kiocb->ki_complete(uw->kiocb, ret ? ret : uw->size, 0);
+#else
+	aio_complete(uw->kiocb, ret ? ret : uw->size, 0);
+#endif
+	kfree(uw);
+}
+
+/*
+ * Synchronous requests DMA in the caller, asynchronous ones pin the user
+ * pages here where the caller's mm is current and DMA from the sync
+ * workqueue, so one thread can keep many transfers in flight.
+ */
+static ssize_t xocl_unmgd_rw(struct kiocb *kiocb, const struct iovec *iov,
+	unsigned long nr, u32 dir)
+{
+	struct xocl_unmgd_file *uf = kiocb->ki_filp->private_data;
+	struct xocl_dev *xdev = uf->xdev;
+	struct xocl_unmgd_work *uw;
+	struct drm_xocl_unmgd unmgd;
+	u64 paddr = kiocb->ki_pos;
+	size_t size = iov_length(iov, nr);
+	ssize_t ret;
+
+	if (!size)
+		return 0;
+
+	/* If device is offline (due to error), reject all DMA requests */
+	if (xdev->offline)
+		return -ENODEV;
+
+	if (!xocl_validate_paddr(xdev, paddr, size))
+		userpf_err(xdev, "invalid paddr: 0x%llx, size:0x%zx",
+			paddr, size);
+
+	xocl_client_dma(uf->drm_filp->private_data, size);
+	if (is_sync_kiocb(kiocb)) {
+		if (nr == 1)
+			ret = xocl_dma_user(xdev, (u64)(uintptr_t)iov->iov_base,
+				paddr, size, dir);
+		else {
+			ret = xocl_init_unmgd_v(&unmgd, iov, nr, dir);
+			if (ret)
+				return ret;
+			ret = xocl_dma_sgt(xdev, unmgd.sgt, dir, paddr, size,
+				-1, xocl_dma_small(size), false);
+			xocl_finish_unmgd(&unmgd);
+		}
+		if (ret)
+			return ret;
+		kiocb->ki_pos += size;
+		return size;
+	}
+
+	uw = kzalloc(sizeof(*uw), GFP_KERNEL);
+	if (!uw)
+		return -ENOMEM;
+
+	ret = xocl_init_unmgd_v(&uw->unmgd, iov, nr, dir);
+	if (ret) {
+		kfree(uw);
+		return ret;
+	}
+
+	INIT_WORK(&uw->work, xocl_unmgd_work);
+	uw->xdev = xdev;
+	uw->kiocb = kiocb;
+	uw->paddr = paddr;
+	uw->size = size;
+	uw->dir = dir;
+	queue_work(xdev->sync_wq, &uw->work);
+	return -EIOCBQUEUED;
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,16,0)
+static ssize_t xocl_unmgd_read_iter(struct kiocb *kiocb, struct iov_iter *io)
+{
+	if (!iter_is_iovec(io))
+		return -EINVAL;
+	return xocl_unmgd_rw(kiocb, io->iov, io->nr_segs, 0);
+}
+
+static ssize_t xocl_unmgd_write_iter(struct kiocb *kiocb, struct iov_iter *io)
+{
+	if (!iter_is_iovec(io))
+		return -EINVAL;
+	return xocl_unmgd_rw(kiocb, io->iov, io->nr_segs, 1);
+}
+#else
+static ssize_t xocl_unmgd_aio_read(struct kiocb *kiocb,
+	const struct iovec *iov, unsigned long nr, loff_t off)
+{
+	return xocl_unmgd_rw(kiocb, iov, nr, 0);
+}
+
+static ssize_t xocl_unmgd_aio_write(struct kiocb *kiocb,
+	const struct iovec *iov, unsigned long nr, loff_t off)
+{
+	return xocl_unmgd_rw(kiocb, iov, nr, 1);
+}
+#endif
+
+/* in flight requests hold the file, so nothing is pending here */
+static int xocl_unmgd_release(struct inode *inode, struct file *file)
+{
+	struct xocl_unmgd_file *uf = file->private_data;
+
+	fput(uf->drm_filp);
+	kfree(uf);
+	return 0;
+}
+
+static const struct file_operations xocl_unmgd_fops = {
+	.owner = THIS_MODULE,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,16,0)
+	.read_iter = xocl_unmgd_read_iter,
+	.write_iter = xocl_unmgd_write_iter,
+#else
+	.aio_read = xocl_unmgd_aio_read,
+	.aio_write = xocl_unmgd_aio_write,
+#endif
+	.release = xocl_unmgd_release,
+};
+
+int xocl_unmgd_fd_ioctl(struct drm_device *dev, void *data,
+	struct drm_file *filp)
+{
+	struct drm_xocl_unmgd_fd *args = data;
+	struct xocl_dev *xdev = dev->dev_private;
+	struct xocl_unmgd_file *uf;
+	struct file *file;
+	int fd;
+
+	if (args->flags)
+		return -EINVAL;
+
+	uf = kzalloc(sizeof(*uf), GFP_KERNEL);
+	if (!uf)
+		return -ENOMEM;
+	uf->xdev = xdev;
+	uf->drm_filp = filp->filp;
+
+	fd = get_unused_fd_flags(O_CLOEXEC);
+	if (fd < 0) {
+		kfree(uf);
+		return fd;
+	}
+
+	file = anon_inode_getfile("xocl_unmgd", &xocl_unmgd_fops, uf,
+		O_RDWR | O_CLOEXEC);
+	if (IS_ERR(file)) {
+		put_unused_fd(fd);
+		kfree(uf);
+		return PTR_ERR(file);
+	}
+	file->f_mode |= FMODE_PREAD | FMODE_PWRITE;
+
+	/* keep the device open while the fd exists */
+	get_file(uf->drm_filp);
+	fd_install(fd, file);
+	args->fd = fd;
+	return 0;
+}
+
 int xocl_usage_stat_ioctl(struct drm_device *dev, void *data,
 			  struct drm_file *filp)
 {
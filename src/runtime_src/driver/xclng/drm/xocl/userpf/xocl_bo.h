@@ -25,6 +25,7 @@
 #define XOCL_BO_EXECBUF (1 << 29)
 #define XOCL_BO_CMA     (1 << 28)
 #define XOCL_BO_P2P     (1 << 27)
+#define XOCL_BO_HOST    (1 << 25)
 
 #define XOCL_BO_DDR0 (1 << 0)
 #define XOCL_BO_DDR1 (1 << 1)
@@ -45,12 +46,16 @@
  *
  * @state: State of exec buffer object
  * @active: Reverse mapping to kds command object managed exclusively by kds
+ * @handle: User handle of exec bo when last submitted, reported in exec ring
  */
 struct drm_xocl_exec_metadata {
 	enum drm_xocl_execbuf_state state;
 	struct xocl_cmd            *active;
+	uint32_t                    handle;
 };
 
+struct xocl_uptr_entry;
+
 struct drm_xocl_bo {
 	/* drm base object */
 	struct drm_gem_object base;
@@ -65,6 +70,12 @@ struct drm_xocl_bo {
 	unsigned		dma_nsg;
 	unsigned              flags;
 	unsigned              type;
+	/* pinned pages of userptr BO, shared through client cache */
+	struct xocl_uptr_entry *uptr;
+	/* first partial range synced, kept DMA mapped for repeated syncs */
+	struct sg_table      *sync_sgt;
+	u64                   sync_offset;
+	u64                   sync_size;
 };
 
 struct drm_xocl_unmgd {
@@ -98,6 +109,11 @@ static inline bool xocl_bo_p2p(const struct drm_xocl_bo *bo)
 	return (bo->type & XOCL_BO_P2P);
 }
 
+static inline bool xocl_bo_host(const struct drm_xocl_bo *bo)
+{
+	return (bo->type & XOCL_BO_HOST);
+}
+
 static inline struct drm_gem_object *xocl_gem_object_lookup(struct drm_device *dev,
 							    struct drm_file *filp,
 							    u32 handle)
@@ -141,6 +157,10 @@ int xocl_userptr_bo_ioctl(struct drm_device *dev, void *data,
 	struct drm_file *filp);
 int xocl_sync_bo_ioctl(struct drm_device *dev, void *data,
 	struct drm_file *filp);
+int xocl_sync_bo_async_ioctl(struct drm_device *dev, void *data,
+	struct drm_file *filp);
+int xocl_sync_bo_v_ioctl(struct drm_device *dev, void *data,
+	struct drm_file *filp);
 int xocl_copy_bo_ioctl(struct drm_device *dev, void *data,
 	struct drm_file *filp);
 int xocl_map_bo_ioctl(struct drm_device *dev, void *data,
@@ -151,12 +171,18 @@ int xocl_pwrite_bo_ioctl(struct drm_device *dev, void *data,
 	struct drm_file *filp);
 int xocl_pread_bo_ioctl(struct drm_device *dev, void *data,
 	struct drm_file *filp);
+int xocl_pwrite_sync_bo_ioctl(struct drm_device *dev, void *data,
+	struct drm_file *filp);
+int xocl_pread_sync_bo_ioctl(struct drm_device *dev, void *data,
+	struct drm_file *filp);
 int xocl_ctx_ioctl(struct drm_device *dev, void *data,
 	struct drm_file *filp);
 int xocl_pwrite_unmgd_ioctl(struct drm_device *dev, void *data,
 	struct drm_file *filp);
 int xocl_pread_unmgd_ioctl(struct drm_device *dev, void *data,
 	struct drm_file *filp);
+int xocl_unmgd_fd_ioctl(struct drm_device *dev, void *data,
+	struct drm_file *filp);
 int xocl_usage_stat_ioctl(struct drm_device *dev, void *data,
 	struct drm_file *filp);
 
@@ -170,6 +196,8 @@ int xocl_gem_prime_mmap(struct drm_gem_object *obj, struct vm_area_struct *vma);
 
 int xocl_init_unmgd(struct drm_xocl_unmgd *unmgd, uint64_t data_ptr,
         uint64_t size, u32 write);
+int xocl_init_unmgd_v(struct drm_xocl_unmgd *unmgd, const struct iovec *iov,
+	unsigned long nr, u32 write);
 void xocl_finish_unmgd(struct drm_xocl_unmgd *unmgd);
 
 #endif
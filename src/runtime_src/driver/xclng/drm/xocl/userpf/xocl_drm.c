@@ -54,6 +54,26 @@ static void xocl_free_object(struct drm_gem_object *obj)
 	xocl_free_bo(obj);
 }
 
+/* Account BO sizes to the clients holding handles to them */
+static int xocl_gem_open_object(struct drm_gem_object *obj,
+	struct drm_file *filp)
+{
+	struct client_ctx *client = filp->driver_priv;
+
+	if (client)
+		atomic64_add(obj->size, &client->bo_bytes);
+	return 0;
+}
+
+static void xocl_gem_close_object(struct drm_gem_object *obj,
+	struct drm_file *filp)
+{
+	struct client_ctx *client = filp->driver_priv;
+
+	if (client)
+		atomic64_sub(obj->size, &client->bo_bytes);
+}
+
 static int xocl_mmap(struct file *filp, struct vm_area_struct *vma)
 {
 	int ret;
@@ -61,6 +81,7 @@ static int xocl_mmap(struct file *filp, struct vm_area_struct *vma)
 	struct drm_device *dev = priv->minor->dev;
 	struct mm_struct *mm = current->mm;
 	struct xocl_dev	*xdev = dev->dev_private;
+	struct drm_xocl_bo *xobj;
 	unsigned long vsize;
 	phys_addr_t res_start;
 
@@ -94,6 +115,21 @@ static int xocl_mmap(struct file *filp, struct vm_area_struct *vma)
 		else
 			vma->vm_page_prot = pgprot_writecombine(
 				vm_get_page_prot(vma->vm_flags));
+
+		/*
+		 * Pages of the coherent host memory are not refcounted one
+		 * by one, so host bank BOs are mapped up front instead of
+		 * inserting pages on fault
+		 */
+		xobj = to_xocl_bo(vma->vm_private_data);
+		if (xocl_bo_host(xobj)) {
+			u64 host_off = xobj->mm_node->start - xdev->host_mem_base;
+
+			ret = dma_mmap_coherent(&xdev->core.pdev->dev, vma,
+				xdev->host_mem + host_off,
+				xdev->host_mem_dma + host_off,
+				vma->vm_end - vma->vm_start);
+		}
 		return ret;
 	}
 
@@ -199,7 +235,7 @@ static void xocl_client_release(struct drm_device *dev, struct drm_file *filp)
 	/* This happens when application exists without formally releasing the contexts on CUs.
 	   Give up our contexts on CUs and our lock on xclbin */
 	while (xdev->layout && (bit < xdev->layout->m_count)) {
-		xdev->ip_reference[bit]--;
+		atomic_dec(&xdev->ip_reference[bit]);
 		bit = find_next_bit(client->cu_bitmap, xdev->layout->m_count, bit + 1);
 	}
 	bitmap_zero(client->cu_bitmap, MAX_CUS);
@@ -208,6 +244,9 @@ static void xocl_client_release(struct drm_device *dev, struct drm_file *filp)
 			pid_nr(task_tgid(current)));
 	}
 
+	if (client)
+		xocl_uptr_cache_fini(client);
+
 	if (MB_SCHEDULER_DEV(xdev))
 		xocl_exec_destroy_client(xdev, &filp->driver_priv);
 }
@@ -261,6 +300,20 @@ static const struct drm_ioctl_desc xocl_ioctls[] = {
 			  DRM_AUTH|DRM_UNLOCKED|DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(XOCL_COPY_BO, xocl_copy_bo_ioctl,
 		  DRM_AUTH|DRM_UNLOCKED|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(XOCL_EXECBUF_BATCH, xocl_execbuf_batch_ioctl,
+			  DRM_AUTH|DRM_UNLOCKED|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(XOCL_EXEC_RING, xocl_exec_ring_ioctl,
+			  DRM_AUTH|DRM_UNLOCKED|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(XOCL_SYNC_BO_ASYNC, xocl_sync_bo_async_ioctl,
+			  DRM_AUTH|DRM_UNLOCKED|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(XOCL_SYNC_BO_V, xocl_sync_bo_v_ioctl,
+			  DRM_AUTH|DRM_UNLOCKED|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(XOCL_PWRITE_SYNC_BO, xocl_pwrite_sync_bo_ioctl,
+			  DRM_AUTH|DRM_UNLOCKED|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(XOCL_PREAD_SYNC_BO, xocl_pread_sync_bo_ioctl,
+			  DRM_AUTH|DRM_UNLOCKED|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(XOCL_UNMGD_FD, xocl_unmgd_fd_ioctl,
+			  DRM_AUTH|DRM_UNLOCKED|DRM_RENDER_ALLOW),
 };
 
 static const struct file_operations xocl_driver_fops = {
@@ -287,6 +340,8 @@ static struct drm_driver mm_drm_driver = {
 	.open                           = xocl_client_open,
 
 	.gem_free_object		= xocl_free_object,
+	.gem_open_object		= xocl_gem_open_object,
+	.gem_close_object		= xocl_gem_close_object,
 	.gem_vm_ops			= &xocl_vm_ops,
 
 	.ioctls				= xocl_ioctls,
@@ -358,6 +413,14 @@ int xocl_drm_init(struct xocl_dev *xdev)
 
 	ddev->pdev = xdev->core.pdev;
 
+	/* unbound so that async syncs on different channels overlap */
+	xdev->sync_wq = alloc_workqueue("xocl_sync", WQ_UNBOUND, 0);
+	if (!xdev->sync_wq) {
+		userpf_err(xdev, "alloc sync workqueue failed");
+		ret = -ENOMEM;
+		goto failed;
+	}
+
 	ret = drm_dev_register(ddev, 0);
 	if (ret) {
 		userpf_err(xdev, "register drm dev failed 0x%x", ret);
@@ -391,7 +454,8 @@ int xocl_drm_init(struct xocl_dev *xdev)
 		}
 		xdev->mm_usage_stat = vmalloc(mm_stat_size);
 		memset(xdev->mm_usage_stat, 0, mm_stat_size);
-		if (!xdev->mm_usage_stat) {
+		if (!xdev->mm_usage_stat ||
+			xocl_mm_alloc_dma_stat(xdev, ddr_count)) {
 			userpf_err(xdev, "alloc stat failed, ddr %d, sz %lld",
 				ddr_count, ddr_size);
 			ret = -ENOMEM;
@@ -428,6 +492,11 @@ failed:
 	if (xdev->mm_usage_stat)
 		vfree(xdev->mm_usage_stat);
 
+	if (xdev->sync_wq) {
+		destroy_workqueue(xdev->sync_wq);
+		xdev->sync_wq = NULL;
+	}
+
 	if (!ddev)
 		drm_dev_unref(ddev);
 
@@ -436,6 +505,11 @@ failed:
 
 void xocl_drm_fini(struct xocl_dev *xdev)
 {
+	/* drain pending async syncs, they reference BOs and DMA channels */
+	if (xdev->sync_wq)
+		destroy_workqueue(xdev->sync_wq);
+	xdev->sync_wq = NULL;
+
 	xocl_cleanup_mem(xdev);
 
 	drm_put_dev(xdev->ddev);
@@ -463,17 +537,150 @@ void xocl_mm_update_usage_stat(struct xocl_dev *xdev, u32 ddr,
 	xdev->mm_usage_stat[ddr].bo_count += count;
 }
 
+int xocl_mm_alloc_dma_stat(struct xocl_dev *xdev, u32 count)
+{
+	xdev->mm_dma_stat = __alloc_percpu(
+		count * sizeof(struct xocl_mm_dma_stat),
+		__alignof__(struct xocl_mm_dma_stat));
+	return xdev->mm_dma_stat ? 0 : -ENOMEM;
+}
+
+/* Account a DMA of @size bytes to or from bank @ddr, @dir 1 is to device */
+void xocl_mm_account_dma(struct xocl_dev *xdev, u32 ddr, u32 dir, u64 size)
+{
+	struct xocl_mm_dma_stat *stat;
+
+	if (!xdev->mm_dma_stat || !xdev->topology ||
+		ddr >= xdev->topology->m_count)
+		return;
+
+	stat = get_cpu_ptr(xdev->mm_dma_stat);
+	stat[ddr].bytes[dir] += size;
+	stat[ddr].ops[dir]++;
+	put_cpu_ptr(xdev->mm_dma_stat);
+}
+
+/*
+ * Placement of device memory.  Long lived BOs are packed from the bottom
+ * of a bank, small BOs from the top, other BOs are placed best fit in
+ * between, so that churn of small BOs does not split the free space
+ * needed for large ones.
+ */
+static unsigned int mm_small_bo_kb = 1024;
+module_param(mm_small_bo_kb, uint, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(mm_small_bo_kb,
+	"BOs smaller than this size (in KB) are placed from the top of each memory bank (0 = best fit for all BOs)");
+
 int xocl_mm_insert_node(struct xocl_dev *xdev, u32 ddr,
-                struct drm_mm_node *node, u64 size)
+                struct drm_mm_node *node, u64 size, bool long_lived)
 {
-	return drm_mm_insert_node_generic(&xdev->mm[ddr], node, size, PAGE_SIZE,
+	bool top = !long_lived && size < ((u64)mm_small_bo_kb << 10);
+
 #if defined(XOCL_DRM_FREE_MALLOC)
-		0, 0);
+	enum drm_mm_insert_mode mode = long_lived ? DRM_MM_INSERT_LOW :
+		top ? DRM_MM_INSERT_HIGH : DRM_MM_INSERT_BEST;
+
+	return drm_mm_insert_node_generic(&xdev->mm[ddr], node, size, PAGE_SIZE,
+		0, mode);
 #else
-		0, 0, 0);
+	enum drm_mm_search_flags sflags = long_lived ? DRM_MM_SEARCH_DEFAULT :
+		top ? DRM_MM_SEARCH_BELOW : DRM_MM_SEARCH_BEST;
+	enum drm_mm_allocator_flags aflags = top ? DRM_MM_CREATE_TOP :
+		DRM_MM_CREATE_DEFAULT;
+
+	return drm_mm_insert_node_generic(&xdev->mm[ddr], node, size, PAGE_SIZE,
+		0, sflags, aflags);
 #endif
 }
 
+/*
+ * Pinned host memory backing the MEM_HOST bank.  BOs of the bank keep
+ * device addresses in the bank range of the xclbin.  xocl does not
+ * program any address translation, the bank is only usable on a shell
+ * that maps the bank range onto the bus address of the memory, which
+ * is logged when it is allocated.  Off by default for that reason.
+ *
+ * The memory is one physically contiguous coherent allocation.  Beyond
+ * a few MB this needs a CMA area of at least host_bank_mb reserved at
+ * boot (cma=), else the allocation fails and the bank is unavailable.
+ */
+static unsigned int host_bank_mb;
+module_param(host_bank_mb, uint, (S_IRUGO|S_IWUSR));
+MODULE_PARM_DESC(host_bank_mb,
+	"Maximum size (in MB) of pinned host memory allocated for a host memory bank, needs a shell translating the bank and a CMA area of that size (0 = disable host banks, default)");
+
+/**
+ * xocl_init_host_mem() - Allocate pinned host memory for the host bank
+ *
+ * @xdev: Device
+ * @base: Base address of the bank in the xclbin
+ * @size: Size of the bank in the xclbin, capped by host_bank_mb
+ *
+ * Only one host bank per xclbin is supported.
+ *
+ * Return: Size of the allocated memory, or 0 on failure
+ */
+u64 xocl_init_host_mem(struct xocl_dev *xdev, u64 base, u64 size)
+{
+	u64 i, npages;
+	void *addr;
+
+	if (!host_bank_mb) {
+		userpf_info(xdev, "Host memory banks are disabled by host_bank_mb");
+		return 0;
+	}
+
+	if (xdev->host_mem) {
+		userpf_err(xdev, "Only one host memory bank is supported");
+		return 0;
+	}
+
+	size = min_t(u64, size, (u64)host_bank_mb << 20) & PAGE_MASK;
+	if (!size)
+		return 0;
+
+	npages = size >> PAGE_SHIFT;
+	xdev->host_mem_pages = vmalloc(npages * sizeof(struct page *));
+	if (!xdev->host_mem_pages)
+		return 0;
+
+	xdev->host_mem = dma_alloc_coherent(&xdev->core.pdev->dev, size,
+		&xdev->host_mem_dma, GFP_KERNEL);
+	if (!xdev->host_mem) {
+		userpf_err(xdev, "Failed to allocate %lluMB host memory bank",
+			size >> 20);
+		vfree(xdev->host_mem_pages);
+		xdev->host_mem_pages = NULL;
+		return 0;
+	}
+	memset(xdev->host_mem, 0, size);
+
+	for (i = 0; i < npages; i++) {
+		addr = xdev->host_mem + (i << PAGE_SHIFT);
+		xdev->host_mem_pages[i] = is_vmalloc_addr(addr) ?
+			vmalloc_to_page(addr) : virt_to_page(addr);
+	}
+	xdev->host_mem_base = base;
+	xdev->host_mem_size = size;
+	userpf_info(xdev, "Host memory bank 0x%llx (%lluMB) at bus address 0x%llx",
+		base, size >> 20, (u64)xdev->host_mem_dma);
+
+	return size;
+}
+
+void xocl_fini_host_mem(struct xocl_dev *xdev)
+{
+	if (!xdev->host_mem)
+		return;
+
+	dma_free_coherent(&xdev->core.pdev->dev, xdev->host_mem_size,
+		xdev->host_mem, xdev->host_mem_dma);
+	vfree(xdev->host_mem_pages);
+	xdev->host_mem = NULL;
+	xdev->host_mem_pages = NULL;
+	xdev->host_mem_size = 0;
+}
+
 int xocl_check_topology(struct xocl_dev *xdev)
 {
 	struct mem_topology    *topology;
@@ -524,11 +731,14 @@ void xocl_cleanup_mem(struct xocl_dev *xdev)
 			drm_mm_takedown(&xdev->mm[i]);
 		}
 	}
+	xocl_fini_host_mem(xdev);
 
 	if (xdev->mm)
 		vfree(xdev->mm);
 	if (xdev->mm)
 		vfree(xdev->mm_usage_stat);
+	free_percpu(xdev->mm_dma_stat);
+	xdev->mm_dma_stat = NULL;
 	vfree(xdev->topology);
 	xdev->topology = NULL;
 }
@@ -569,3 +779,118 @@ out:
 	mutex_unlock(&xdev->ctx_list_lock);
 	return size;
 }
+
+/**
+ * xocl_mm_sysfs_dma() - Report DMA traffic of each memory bank
+ *
+ * One line per bank with bytes and number of DMA operations to device,
+ * then from device, since the xclbin was loaded.  Sync and copy BO are
+ * accounted, monitoring tools derive bandwidth from two samples.
+ */
+ssize_t xocl_mm_sysfs_dma(struct xocl_dev *xdev, char *buf, bool raw)
+{
+	int i, cpu;
+	ssize_t count = 0;
+	ssize_t size = 0;
+	const char *txt_fmt = "[%s] h2c: %lluKB %lluops c2h: %lluKB %lluops\n";
+	const char *raw_fmt = "%llu %llu %llu %llu\n";
+	struct mem_topology *topo = xdev->topology;
+
+	mutex_lock(&xdev->ctx_list_lock);
+	if (!topo || !xdev->mm_dma_stat)
+		goto out;
+
+	for (i = 0; i < topo->m_count; i++) {
+		struct xocl_mm_dma_stat sum = { { 0 } };
+
+		for_each_possible_cpu(cpu) {
+			struct xocl_mm_dma_stat *stat =
+				per_cpu_ptr(xdev->mm_dma_stat, cpu) + i;
+
+			sum.bytes[0] += stat->bytes[0];
+			sum.bytes[1] += stat->bytes[1];
+			sum.ops[0] += stat->ops[0];
+			sum.ops[1] += stat->ops[1];
+		}
+
+		if (raw) {
+			count = sprintf(buf, raw_fmt,
+				sum.bytes[1], sum.ops[1],
+				sum.bytes[0], sum.ops[0]);
+		} else {
+			count = sprintf(buf, txt_fmt,
+				topo->m_mem_data[i].m_tag,
+				sum.bytes[1] / 1024, sum.ops[1],
+				sum.bytes[0] / 1024, sum.ops[0]);
+		}
+		buf += count;
+		size += count;
+	}
+out:
+	mutex_unlock(&xdev->ctx_list_lock);
+	return size;
+}
+
+/* Free block histogram bucket of a hole, buckets are <64K, <1M, <16M, <256M, <4G, >=4G */
+static int xocl_mm_frag_bucket(u64 size)
+{
+	int bucket = (fls64(size >> 16) + 3) / 4;
+
+	return min(bucket, XOCL_MM_FRAG_BUCKETS - 1);
+}
+
+/**
+ * xocl_mm_sysfs_frag() - Report free space fragmentation of each memory bank
+ *
+ * One line per bank with free size, largest free block, number of free
+ * blocks and the free block histogram.  A large free size with a small
+ * largest free block means large BOs fail to allocate although memory
+ * is available.
+ */
+ssize_t xocl_mm_sysfs_frag(struct xocl_dev *xdev, char *buf, bool raw)
+{
+	int i, b;
+	ssize_t size = 0;
+	struct mem_topology *topo = xdev->topology;
+
+	mutex_lock(&xdev->ctx_list_lock);
+	if (!topo || !xdev->mm)
+		goto out;
+
+	mutex_lock(&xdev->mm_lock);
+	for (i = 0; i < topo->m_count; i++) {
+		u64 free = 0, largest = 0, hole_start, hole_end;
+		u32 holes = 0, hist[XOCL_MM_FRAG_BUCKETS] = {0};
+		struct drm_mm_node *entry;
+
+		if (topo->m_mem_data[i].m_used &&
+		    topo->m_mem_data[i].m_type != MEM_STREAMING) {
+			drm_mm_for_each_hole(entry, &xdev->mm[i], hole_start, hole_end) {
+				u64 hole = hole_end - hole_start;
+				free += hole;
+				largest = max(largest, hole);
+				++holes;
+				++hist[xocl_mm_frag_bucket(hole)];
+			}
+		}
+
+		if (raw) {
+			size += sprintf(buf + size, "%llu %llu %u", free, largest, holes);
+			for (b = 0; b < XOCL_MM_FRAG_BUCKETS; b++)
+				size += sprintf(buf + size, " %u", hist[b]);
+			size += sprintf(buf + size, "\n");
+		} else {
+			size += sprintf(buf + size,
+				"[%s] free %lluKB largest %lluKB holes %u:",
+				topo->m_mem_data[i].m_tag, free / 1024,
+				largest / 1024, holes);
+			size += sprintf(buf + size,
+				" <64K:%u <1M:%u <16M:%u <256M:%u <4G:%u >=4G:%u\n",
+				hist[0], hist[1], hist[2], hist[3], hist[4], hist[5]);
+		}
+	}
+	mutex_unlock(&xdev->mm_lock);
+out:
+	mutex_unlock(&xdev->ctx_list_lock);
+	return size;
+}
@@ -22,8 +22,13 @@ void xocl_mm_get_usage_stat(struct xocl_dev *xdev, u32 ddr,
         struct drm_xocl_mm_stat *pstat);
 void xocl_mm_update_usage_stat(struct xocl_dev *xdev, u32 ddr,
         u64 size, int count);
+int xocl_mm_alloc_dma_stat(struct xocl_dev *xdev, u32 count);
+void xocl_mm_account_dma(struct xocl_dev *xdev, u32 ddr, u32 dir,
+        u64 size);
 int xocl_mm_insert_node(struct xocl_dev *xdev, u32 ddr,
-                struct drm_mm_node *node, u64 size);
+                struct drm_mm_node *node, u64 size, bool long_lived);
+u64 xocl_init_host_mem(struct xocl_dev *xdev, u64 base, u64 size);
+void xocl_fini_host_mem(struct xocl_dev *xdev);
 int xocl_drm_init(struct xocl_dev *xdev);
 void xocl_drm_fini(struct xocl_dev *xdev);
 
@@ -100,6 +100,7 @@ int xocl_execbuf_ioctl(struct drm_device *dev,
 		ret = -EINVAL;
 		goto out;
 	}
+	xobj->metadata.handle = args->exec_bo_handle;
 
 	/* Copy dependencies from user.  It is an error if a BO handle specified
 	 * as a dependency does not exists. Lookup gem object corresponding to bo
@@ -139,11 +140,196 @@ out:
 	return ret;
 }
 
+int xocl_execbuf_batch_ioctl(struct drm_device *dev,
+	void *data, struct drm_file *filp)
+{
+	struct drm_xocl_execbuf_batch *args = data;
+	struct xocl_dev *xdev = dev->dev_private;
+	struct client_ctx *client = filp->driver_priv;
+	uint32_t handles[DRM_XOCL_EXECBUF_BATCH_MAX];
+	struct drm_xocl_bo *xobjs[DRM_XOCL_EXECBUF_BATCH_MAX] = {0};
+	int num = 0;
+	int ret = 0;
+
+	if (!args->num_bos || args->num_bos > DRM_XOCL_EXECBUF_BATCH_MAX)
+		return -EINVAL;
+
+	if (atomic_read(&xdev->needs_reset)) {
+		userpf_err(xdev, "device needs reset, use 'xbsak reset -h'");
+		return -EBUSY;
+	}
+
+	if (!MB_SCHEDULER_DEV(xdev)) {
+		userpf_err(xdev, "scheduler subdev does not exist");
+		return -EINVAL;
+	}
+
+	/* If ctx xclbin uuid mismatch or no xclbin uuid then EPERM */
+	if (uuid_is_null(&client->xclbin_id) || !uuid_equal(&xdev->xclbin_id,&client->xclbin_id)) {
+		userpf_err(xdev, "Invalid xclbin for current process");
+		return -EPERM;
+	}
+
+	if (copy_from_user(handles, (void __user *)(uintptr_t)args->handles_ptr,
+			   args->num_bos * sizeof(uint32_t)))
+		return -EFAULT;
+
+	/* Look up and validate all exec buffers before any is submitted.
+	 * Each lookup adds a reference to the gem object, the references
+	 * are passed to kds or released here if errors occur. */
+	for (num=0; num<args->num_bos; ++num) {
+		struct drm_gem_object *obj = xocl_gem_object_lookup(dev, filp, handles[num]);
+		if (!obj) {
+			userpf_err(xdev, "Failed to look up GEM BO %d\n", handles[num]);
+			ret = -ENOENT;
+			goto out;
+		}
+
+		xobjs[num] = to_xocl_bo(obj);
+		if (!xocl_bo_execbuf(xobjs[num])) {
+			++num;
+			ret = -EINVAL;
+			goto out;
+		}
+
+		ret = xocl_exec_validate(xdev, client, xobjs[num]);
+		if (ret) {
+			++num;
+			userpf_err(xdev, "Exec buffer validation failed\n");
+			ret = -EINVAL;
+			goto out;
+		}
+		xobjs[num]->metadata.handle = handles[num];
+	}
+
+	/* Add all exec buffers to scheduler (kds) in one go.  The scheduler
+	 * manages the drm object references on success. */
+	ret = xocl_exec_add_buffers(xdev, client, xobjs, num);
+	if (ret) {
+		userpf_err(xdev, "Failed to add exec buffers to scheduler\n");
+		ret = -EINVAL;
+		goto out;
+	}
+
+	return ret;
+
+out:
+	while (num--)
+		drm_gem_object_unreference_unlocked(&xobjs[num]->base);
+	return ret;
+}
+
+/*
+ * Register (or unregister) the exec buffer completion ring of a client.
+ * The ring BO reference is held by the client until the ring is replaced
+ * or the client is destroyed.
+ */
+int xocl_exec_ring_ioctl(struct drm_device *dev,
+	void *data, struct drm_file *filp)
+{
+	struct drm_xocl_exec_ring *args = data;
+	struct xocl_dev *xdev = dev->dev_private;
+	struct client_ctx *client = filp->driver_priv;
+	struct drm_xocl_exec_ring_buf *ring = NULL;
+	struct drm_xocl_bo *xobj = NULL;
+	struct drm_xocl_bo *old;
+	u32 size = 0;
+
+	if (!MB_SCHEDULER_DEV(xdev) || !client) {
+		userpf_err(xdev, "scheduler subdev does not exist");
+		return -EINVAL;
+	}
+
+	if (args->handle) {
+		struct drm_gem_object *obj = xocl_gem_object_lookup(dev, filp, args->handle);
+		if (!obj) {
+			userpf_err(xdev, "Failed to look up GEM BO %d\n", args->handle);
+			return -ENOENT;
+		}
+
+		xobj = to_xocl_bo(obj);
+		if (!xocl_bo_execbuf(xobj) || !xobj->vmapping ||
+		    obj->size < sizeof(*ring) + sizeof(ring->handles[0])) {
+			drm_gem_object_unreference_unlocked(obj);
+			return -EINVAL;
+		}
+
+		size = rounddown_pow_of_two((obj->size - sizeof(*ring)) / sizeof(ring->handles[0]));
+		ring = xobj->vmapping;
+		ring->head = 0;
+		ring->tail = 0;
+		ring->size = size;
+		ring->dropped = 0;
+	}
+
+	spin_lock(&client->ring_lock);
+	old = client->ring_bo;
+	client->ring_bo = xobj;
+	client->ring = ring;
+	client->ring_size = size;
+	client->ring_tail = 0;
+	client->ring_dropped = 0;
+	spin_unlock(&client->ring_lock);
+
+	if (old)
+		drm_gem_object_unreference_unlocked(&old->base);
+
+	return 0;
+}
+
 /*
  * Create a context (ony shared supported today) on a CU. Take a lock on xclbin if
  * it has not been acquired before. Shared the same lock for all context requests
  * for that process
  */
+/*
+ * A process that already holds a context has the xclbin locked, so CUs other
+ * than its last one are added and removed under its own client lock without
+ * the device wide ctx_list_lock and the icap bitstream lock. Returns -EAGAIN
+ * when the request may take or give up the bitstream lock.
+ */
+static int xocl_ctx_fast(struct xocl_dev *xdev, struct client_ctx *client,
+			 struct drm_xocl_ctx *args)
+{
+	int ret = -EAGAIN;
+
+	mutex_lock(&client->lock);
+	if (bitmap_empty(client->cu_bitmap, MAX_CUS) ||
+	    !uuid_equal(&client->xclbin_id, &args->xclbin_id) ||
+	    !xdev->layout || args->cu_index >= xdev->layout->m_count)
+		goto out;
+
+	if (args->op == XOCL_CTX_OP_FREE_CTX) {
+		if (!test_bit(args->cu_index, client->cu_bitmap)) {
+			ret = -EINVAL;
+			goto out;
+		}
+		if (bitmap_weight(client->cu_bitmap, MAX_CUS) == 1)
+			goto out;
+		clear_bit(args->cu_index, client->cu_bitmap);
+		atomic_dec(&xdev->ip_reference[args->cu_index]);
+	} else if (args->op == XOCL_CTX_OP_ALLOC_CTX &&
+		   args->flags == XOCL_CTX_SHARED) {
+		if (test_and_set_bit(args->cu_index, client->cu_bitmap)) {
+			userpf_err(xdev, "Context has already been allocated before by this process");
+			ret = -EPERM;
+			goto out;
+		}
+		atomic_inc(&xdev->ip_reference[args->cu_index]);
+	} else {
+		goto out;
+	}
+
+	bitmap_to_u32array(client->ctx_cus, MAX_U32_CU_MASKS, client->cu_bitmap, MAX_CUS);
+	xocl_info(xdev->ddev->dev, "CTX %s(%pUb, %d, %u)",
+		  args->op == XOCL_CTX_OP_FREE_CTX ? "del" : "add",
+		  &args->xclbin_id, pid_nr(task_tgid(current)), args->cu_index);
+	ret = 0;
+out:
+	mutex_unlock(&client->lock);
+	return ret;
+}
+
 int xocl_ctx_ioctl(struct drm_device *dev, void *data,
 		   struct drm_file *filp)
 {
@@ -153,7 +339,13 @@ int xocl_ctx_ioctl(struct drm_device *dev, void *data,
 	struct client_ctx *client = filp->driver_priv;
 	int ret = 0;
 
+	ret = xocl_ctx_fast(xdev, client, args);
+	if (ret != -EAGAIN)
+		return ret;
+	ret = 0;
+
 	mutex_lock(&xdev->ctx_list_lock);
+	mutex_lock(&client->lock);
 	if (!uuid_equal(&xdev->xclbin_id, &args->xclbin_id)) {
 		ret = -EBUSY;
 		goto out;
@@ -169,7 +361,7 @@ int xocl_ctx_ioctl(struct drm_device *dev, void *data,
 		if (ret) // No context was previously allocated for this CU
 			goto out;
 
-		xdev->ip_reference[args->cu_index]--;
+		atomic_dec(&xdev->ip_reference[args->cu_index]);
 		if (bitmap_empty(client->cu_bitmap, MAX_CUS))
                         // We jsut gave up the last context, give up the xclbin lock
 			ret = xocl_icap_unlock_bitstream(xdev, &xdev->xclbin_id,
@@ -212,10 +404,12 @@ int xocl_ctx_ioctl(struct drm_device *dev, void *data,
 		goto out;
 	}
 
-	xdev->ip_reference[args->cu_index]++;
+	atomic_inc(&xdev->ip_reference[args->cu_index]);
 	xocl_info(dev->dev, "CTX add(%pUb, %d, %u)", &xdev->xclbin_id, pid_nr(task_tgid(current)), args->cu_index);
 out:
+	bitmap_to_u32array(client->ctx_cus, MAX_U32_CU_MASKS, client->cu_bitmap, MAX_CUS);
 	uuid_copy(&client->xclbin_id, (ret ? &uuid_null : &xdev->xclbin_id));
+	mutex_unlock(&client->lock);
 	mutex_unlock(&xdev->ctx_list_lock);
 	return ret;
 }
@@ -403,7 +597,8 @@ static int xocl_init_mm(struct xocl_dev *xdev)
 	memset(xdev->mm, 0, mm_size);
 	xdev->mm_usage_stat = vmalloc(mm_stat_size);
 	memset(xdev->mm_usage_stat, 0, mm_stat_size);
-	if (!xdev->mm || !xdev->mm_usage_stat)
+	if (!xdev->mm || !xdev->mm_usage_stat ||
+		xocl_mm_alloc_dma_stat(xdev, topo->m_count))
 		return -ENOMEM;
 
 	for (i = 0; i < topo->m_count; i++) {
@@ -421,7 +616,24 @@ static int xocl_init_mm(struct xocl_dev *xdev)
 	/* Currently only fixed sizes are supported */
 	for (i = 0; i < topo->m_count; i++) {
 		mem_data = &topo->m_mem_data[i];
-		if (mem_data->m_used && mem_data->m_type != MEM_STREAMING) {
+		if (mem_data->m_used && mem_data->m_type == MEM_HOST) {
+			/*
+			 * The host bank is backed by pinned host memory, it
+			 * may be smaller than the bank.  Without the memory
+			 * the bank is marked unused so no BO lands in it.
+			 */
+			ddr_bank_size = xocl_init_host_mem(xdev,
+				mem_data->m_base_address,
+				mem_data->m_size * 1024);
+			if (!ddr_bank_size) {
+				userpf_err(xdev, "Host bank%d is unavailable", i);
+				mem_data->m_used = 0;
+				continue;
+			}
+			DRM_INFO("XOCL: Allocating host bank%d", i);
+			drm_mm_init(&xdev->mm[i], mem_data->m_base_address,
+					ddr_bank_size);
+		} else if (mem_data->m_used && mem_data->m_type != MEM_STREAMING) {
 			ddr_bank_size = mem_data->m_size * 1024;
 			DRM_INFO("XOCL: Allocating DDR bank%d", i);
 			DRM_INFO("  base_addr:0x%llx, size:0x%lx\n",
@@ -505,7 +717,8 @@ xocl_read_axlf_helper(struct xocl_dev *xdev, struct drm_xocl_axlf *axlf_ptr)
 	if (err)
 		goto done;
 
-	if(bin_obj.m_uniqueId == xdev->unique_id_last_bitstream) {
+	if (bin_obj.m_uniqueId == xdev->unique_id_last_bitstream &&
+		uuid_equal(&xdev->xclbin_id, &bin_obj.m_header.uuid)) {
 		printk(KERN_INFO "Skipping repopulating topology, connectivity,ip_layout data\n");
 		goto done;
 	}
@@ -87,6 +87,40 @@ static ssize_t memstat_raw_show(struct device *dev,
 }
 static DEVICE_ATTR_RO(memstat_raw);
 
+/* -free memory fragmentation-- */
+static ssize_t memfrag_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct xocl_dev *xdev = dev_get_drvdata(dev);
+	return xocl_mm_sysfs_frag(xdev, buf, false);
+}
+static DEVICE_ATTR_RO(memfrag);
+
+static ssize_t memfrag_raw_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct xocl_dev *xdev = dev_get_drvdata(dev);
+	return xocl_mm_sysfs_frag(xdev, buf, true);
+}
+static DEVICE_ATTR_RO(memfrag_raw);
+
+/* -DMA traffic per memory bank-- */
+static ssize_t memdma_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct xocl_dev *xdev = dev_get_drvdata(dev);
+	return xocl_mm_sysfs_dma(xdev, buf, false);
+}
+static DEVICE_ATTR_RO(memdma);
+
+static ssize_t memdma_raw_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct xocl_dev *xdev = dev_get_drvdata(dev);
+	return xocl_mm_sysfs_dma(xdev, buf, true);
+}
+static DEVICE_ATTR_RO(memdma_raw);
+
 /* - End attributes-- */
 
 /* - Begin bin_attributes -- */
@@ -236,6 +270,10 @@ static struct attribute *xocl_attrs[] = {
 	&dev_attr_kdsstat.attr,
 	&dev_attr_memstat.attr,
 	&dev_attr_memstat_raw.attr,
+	&dev_attr_memfrag.attr,
+	&dev_attr_memfrag_raw.attr,
+	&dev_attr_memdma.attr,
+	&dev_attr_memdma_raw.attr,
 	&dev_attr_user_pf.attr,
 	NULL,
 };
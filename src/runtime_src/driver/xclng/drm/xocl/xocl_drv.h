@@ -116,6 +116,7 @@ static inline bool uuid_is_null(const xuid_t *uuid)
 #define NUMS_OF_DYNA_IP_ADDR   4
 
 extern struct class *xrt_class;
+extern unsigned int sensor_sample_ms;
 
 struct xocl_dev;
 struct drm_xocl_bo;
@@ -260,9 +261,23 @@ struct xocl_rom_funcs {
 
 /* mm_dma callbacks */
 struct xocl_mm_dma_funcs {
+	/* sgt is already DMA mapped by the caller if dma_mapped is set */
 	ssize_t (*migrate_bo)(struct platform_device *pdev,
-		struct sg_table *sgt, u32 dir, u64 paddr, u32 channel, u64 sz);
-	int (*ac_chan)(struct platform_device *pdev, u32 dir);
+		struct sg_table *sgt, u32 dir, u64 paddr, u32 channel, u64 sz,
+		bool dma_mapped);
+	/*
+	 * Optional, one transfer of the DMA mapped sgt where entry i goes
+	 * to device address paddrs[i]
+	 */
+	ssize_t (*migrate_bo_v)(struct platform_device *pdev,
+		struct sg_table *sgt, u32 dir, const u64 *paddrs, u32 channel,
+		u64 sz);
+	/*
+	 * channel is tried first if it is free, -1 for any channel. Small
+	 * transfers may also use the channel reserved for them.
+	 */
+	int (*ac_chan)(struct platform_device *pdev, u32 dir, int channel,
+		bool small);
 	void (*rel_chan)(struct platform_device *pdev, u32 dir, u32 channel);
 	int (*set_max_chan)(struct platform_device *pdev, u32 channel_count);
 	u32 (*get_chan_count)(struct platform_device *pdev);
@@ -273,12 +288,22 @@ struct xocl_mm_dma_funcs {
 	SUBDEV(xdev, XOCL_SUBDEV_MM_DMA).pldev
 #define	MM_DMA_OPS(xdev)	\
 	((struct xocl_mm_dma_funcs *)SUBDEV(xdev, XOCL_SUBDEV_MM_DMA).ops)
-#define	xocl_migrate_bo(xdev, sgt, write, paddr, chan, len)	\
+#define	xocl_migrate_bo(xdev, sgt, write, paddr, chan, len, mapped)	\
 	(MM_DMA_DEV(xdev) ? MM_DMA_OPS(xdev)->migrate_bo(MM_DMA_DEV(xdev), \
-	sgt, write, paddr, chan, len) : 0)
+	sgt, write, paddr, chan, len, mapped) : 0)
+#define	xocl_migrate_bo_v_supported(xdev)	\
+	(MM_DMA_DEV(xdev) && MM_DMA_OPS(xdev)->migrate_bo_v)
+#define	xocl_migrate_bo_v(xdev, sgt, write, paddrs, chan, len)	\
+	(xocl_migrate_bo_v_supported(xdev) ?			\
+	MM_DMA_OPS(xdev)->migrate_bo_v(MM_DMA_DEV(xdev), sgt, write,	\
+	paddrs, chan, len) : -EOPNOTSUPP)
 #define	xocl_acquire_channel(xdev, dir)		\
-	(MM_DMA_DEV(xdev) ? MM_DMA_OPS(xdev)->ac_chan(MM_DMA_DEV(xdev), dir) : \
-	-ENODEV)
+	xocl_acquire_channel_hint(xdev, dir, -1)
+#define	xocl_acquire_channel_hint(xdev, dir, chan)	\
+	xocl_acquire_channel_lane(xdev, dir, chan, false)
+#define	xocl_acquire_channel_lane(xdev, dir, chan, small)	\
+	(MM_DMA_DEV(xdev) ? MM_DMA_OPS(xdev)->ac_chan(MM_DMA_DEV(xdev), dir, \
+	chan, small) : -ENODEV)
 #define	xocl_release_channel(xdev, dir, chan)	\
 	(MM_DMA_DEV(xdev) ? MM_DMA_OPS(xdev)->rel_chan(MM_DMA_DEV(xdev), dir, \
 	chan) : NULL)
@@ -295,6 +320,7 @@ struct xocl_mm_dma_funcs {
 /* mb_scheduler callbacks */
 struct xocl_mb_scheduler_funcs {
 	int (*add_exec_buffer)(struct platform_device *pdev, struct client_ctx *client,void *buf, int numdeps, struct drm_xocl_bo **deps);
+	int (*add_exec_buffers)(struct platform_device *pdev, struct client_ctx *client, struct drm_xocl_bo **bos, int num);
 	int (*create_client)(struct platform_device *pdev, void **priv);
 	void (*destroy_client)(struct platform_device *pdev, void **priv);
 	uint (*poll_client)(struct platform_device *pdev, struct file *filp,
@@ -311,6 +337,10 @@ struct xocl_mb_scheduler_funcs {
 	(MB_SCHEDULER_DEV(xdev) ? 				\
 	 MB_SCHEDULER_OPS(xdev)->add_exec_buffer(MB_SCHEDULER_DEV(xdev), client, bo,  numdeps, deps) : \
 	-ENODEV)
+#define	xocl_exec_add_buffers(xdev, client, bos, num)	\
+	(MB_SCHEDULER_DEV(xdev) ? 				\
+	 MB_SCHEDULER_OPS(xdev)->add_exec_buffers(MB_SCHEDULER_DEV(xdev), client, bos, num) : \
+	-ENODEV)
 #define	xocl_exec_create_client(xdev, priv)		\
 	(MB_SCHEDULER_DEV(xdev) ?			\
 	MB_SCHEDULER_OPS(xdev)->create_client(MB_SCHEDULER_DEV(xdev), priv) : \
@@ -397,12 +427,18 @@ struct xocl_firewall_funcs {
 	interval) : -ENODEV)
 
 /* microblaze callbacks */
+enum {
+	XOCL_XMC_PROP_FPGA_TEMP,
+	XOCL_XMC_PROP_12V_PEX_CURR,
+	XOCL_XMC_PROP_12V_AUX_CURR,
+};
 struct xocl_mb_funcs {
 	void (*reset)(struct platform_device *pdev);
 	int (*load_mgmt_image)(struct platform_device *pdev, const char *buf,
 		u32 len);
 	int (*load_sche_image)(struct platform_device *pdev, const char *buf,
 		u32 len);
+	int (*get_prop)(struct platform_device *pdev, u32 prop, void *val);
 };
 
 struct xocl_dna_funcs {
@@ -416,6 +452,10 @@ struct xocl_dna_funcs {
 	((struct xocl_mb_funcs *)SUBDEV(xdev,	\
 	XOCL_SUBDEV_XMC).ops)
 
+#define	xocl_xmc_get_prop(xdev, prop, val)		\
+	(XMC_DEV(xdev) && XMC_OPS(xdev)->get_prop ?	\
+	XMC_OPS(xdev)->get_prop(XMC_DEV(xdev), prop, val) : -ENODEV)
+
 #define	DNA_DEV(xdev)		\
 	SUBDEV(xdev, XOCL_SUBDEV_DNA).pldev
 #define	DNA_OPS(xdev)		\
@@ -507,6 +547,8 @@ struct xocl_icap_funcs {
 	int (*reset_bitstream)(struct platform_device *pdev);
 	int (*download_bitstream_axlf)(struct platform_device *pdev,
 		const void __user *arg);
+	int (*download_bitstream_uuid)(struct platform_device *pdev,
+		const xuid_t *uuid);
 	int (*download_boot_firmware)(struct platform_device *pdev);
 	int (*ocl_set_freq)(struct platform_device *pdev,
 		unsigned int region, unsigned short *freqs, int num_freqs);
@@ -529,6 +571,8 @@ struct xocl_icap_funcs {
 	ICAP_OPS(xdev)->reset_bitstream(ICAP_DEV(xdev))
 #define	xocl_icap_download_axlf(xdev, xclbin)				\
 	ICAP_OPS(xdev)->download_bitstream_axlf(ICAP_DEV(xdev), xclbin)
+#define	xocl_icap_download_uuid(xdev, uuid)				\
+	ICAP_OPS(xdev)->download_bitstream_uuid(ICAP_DEV(xdev), uuid)
 #define	xocl_icap_download_boot_firmware(xdev)				\
 	ICAP_OPS(xdev)->download_boot_firmware(ICAP_DEV(xdev))
 #define	xocl_icap_ocl_get_freq(xdev, region, freqs, num)		\
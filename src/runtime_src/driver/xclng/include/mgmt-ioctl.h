@@ -45,8 +45,10 @@
  * 4    CL reset                               XCLMGMT_IOCOCLRESET            NA
  * 5    Live boot FPGA from PROM               XCLMGMT_IOCREBOOT              NA
  * 6    Device sensors (current, voltage and   NA                             *hwmon* (xclmgmt_microblaze and
- *      temperature)                                                          xclmgmt_sysmon) interface on sysfs
+ *      temperature)                                                          xclmgmt_sysmon) interface on sysfs,
+ *                                                                            xclmgmt_sensor_sample on sensors_bin
  * 7    Querying device errors                 XCLMGMT_IOCERRINFO             xclErrorStatus
+ * 8    Cached FPGA image download by uuid     XCLMGMT_IOCICAPDOWNLOAD_UUID   xclmgmt_ioc_bitstream_uuid
  * ==== ====================================== ============================== ==================================
  *
  */
@@ -74,6 +76,7 @@ enum XCLMGMT_IOC_TYPES {
 	XCLMGMT_IOC_REBOOT,
 	XCLMGMT_IOC_ICAP_DOWNLOAD_AXLF,
 	XCLMGMT_IOC_ERR_INFO,
+	XCLMGMT_IOC_ICAP_DOWNLOAD_UUID,
 	XCLMGMT_IOC_MAX
 };
 
@@ -157,6 +160,19 @@ struct xclmgmt_ioc_bitstream_axlf {
 	struct axlf *xclbin;
 };
 
+/**
+ * struct xclmgmt_ioc_bitstream_uuid - load a previously downloaded xclbin
+ * (AXLF) kept by the driver, see xclbin_cache_num module parameter
+ * used with XCLMGMT_IOCICAPDOWNLOAD_UUID ioctl, fails with ENOENT when the
+ * xclbin is not cached
+ *
+ * @uuid:	uuid of the xclbin, first 8 bytes are m_timeStamp for legacy
+ *		xclbins without uuid
+ */
+struct xclmgmt_ioc_bitstream_uuid {
+	unsigned char uuid[16];
+};
+
 /**
  * struct xclmgmt_ioc_freqscaling - scale frequencies on the board using Xilinx clock wizard
  * used with XCLMGMT_IOCFREQSCALE ioctl
@@ -169,6 +185,31 @@ struct xclmgmt_ioc_freqscaling {
 	unsigned short ocl_target_freq[XCLMGMT_NUM_SUPPORTED_CLOCKS];
 };
 
+#define XCLMGMT_SENSOR_SAMPLE_VERSION	1
+
+/**
+ * struct xclmgmt_sensor_sample - snapshot of all sensors of the xmc or
+ * sysmon subdevice, read from its sensors_bin sysfs node
+ *
+ * The driver samples every sensor_sample_ms (module parameter), a read
+ * returns the last sample without touching the device. Read the node in one
+ * go, values of two partial reads may come from different samples.
+ *
+ * @version:	XCLMGMT_SENSOR_SAMPLE_VERSION
+ * @count:	number of entries in @value
+ * @sequence:	incremented on every sample
+ * @timestamp_ns: monotonic clock when the sample was taken
+ * @value:	sensor values, in the order and units of the sensors_raw node
+ *		of the same subdevice
+ */
+struct xclmgmt_sensor_sample {
+	unsigned version;
+	unsigned count;
+	unsigned long long sequence;
+	unsigned long long timestamp_ns;
+	int value[0];
+};
+
 #define XCLMGMT_IOCINFO		  _IOR (XCLMGMT_IOC_MAGIC,XCLMGMT_IOC_INFO,		 struct xclmgmt_ioc_info)
 #define XCLMGMT_IOCICAPDOWNLOAD	  _IOW (XCLMGMT_IOC_MAGIC,XCLMGMT_IOC_ICAP_DOWNLOAD,	 struct xclmgmt_ioc_bitstream)
 #define XCLMGMT_IOCICAPDOWNLOAD_AXLF	 _IOW(XCLMGMT_IOC_MAGIC,XCLMGMT_IOC_ICAP_DOWNLOAD_AXLF,	 struct xclmgmt_ioc_bitstream_axlf)
@@ -177,6 +218,7 @@ struct xclmgmt_ioc_freqscaling {
 #define XCLMGMT_IOCOCLRESET       _IO  (XCLMGMT_IOC_MAGIC,XCLMGMT_IOC_OCL_RESET)
 #define XCLMGMT_IOCREBOOT         _IO  (XCLMGMT_IOC_MAGIC,XCLMGMT_IOC_REBOOT)
 #define XCLMGMT_IOCERRINFO	  _IOR (XCLMGMT_IOC_MAGIC,XCLMGMT_IOC_ERR_INFO, struct xclErrorStatus)
+#define XCLMGMT_IOCICAPDOWNLOAD_UUID	 _IOW(XCLMGMT_IOC_MAGIC,XCLMGMT_IOC_ICAP_DOWNLOAD_UUID,	 struct xclmgmt_ioc_bitstream_uuid)
 
 #define	XCLMGMT_MB_HWMON_NAME	    "xclmgmt_microblaze"
 #define XCLMGMT_SYSMON_HWMON_NAME   "xclmgmt_sysmon"
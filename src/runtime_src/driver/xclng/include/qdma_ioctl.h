@@ -44,11 +44,13 @@
 enum XOCL_QDMA_IOC_TYPES {
 	XOCL_QDMA_CREATE_QUEUE,
 	XOCL_QDMA_ALLOC_BUFFER,
+	XOCL_QDMA_CREATE_QUEUE_ZC,
 	XOCL_QDMA_MAX
 };
 
 enum XOCL_QDMA_QUEUE_IOC_TYPES {
 	XOCL_QDMA_QUEUE_MODIFY,
+	XOCL_QDMA_QUEUE_RECYCLE,
 	XOCL_QDMA_QUEUE_MAX
 };
 
@@ -62,6 +64,11 @@ enum XOCL_QDMA_REQ_FLAG {
 	XOCL_QDMA_REQ_FLAG_EOT		= (1 << 0),
 	XOCL_QDMA_REQ_FLAG_CDH		= (1 << 1),
 	XOCL_QDMA_REQ_FLAG_SILENT	= (1 << 3),
+	/*
+	 * driver internal, set by xrt on all but the last async request of
+	 * a batch so the producer index is written once for the batch
+	 */
+	XOCL_QDMA_REQ_FLAG_MORE		= (1 << 4),
 };
 
 /**
@@ -81,6 +88,22 @@ struct xocl_qdma_ioc_create_queue {
 	uint64_t		handle;		/* out: queue handle */
 };
 
+/**
+ * struct xocl_qdma_ioc_create_queue_zc - Create zero copy C2H queue
+ * used with XOCL_QDMA_IOC_CREATE_QUEUE_ZC ioctl
+ *
+ * The queue receives into the pages of a stream buffer instead of
+ * copying, see struct xocl_qdma_zc_desc.
+ *
+ * @queue:	queue parameters as for XOCL_QDMA_IOC_CREATE_QUEUE, read only
+ * @zc_buf_addr: user address of a mapped stream buffer backing the free
+ *		list, one page per descriptor
+ */
+struct xocl_qdma_ioc_create_queue_zc {
+	struct xocl_qdma_ioc_create_queue queue;
+	uint64_t		zc_buf_addr;
+};
+
 /**
  * struct xocl_qdma_ioc_alloc_buf - Allocate DMA buffer
  *
@@ -92,6 +115,33 @@ struct xocl_qdma_ioc_alloc_buf {
 	int		buf_fd;
 };
 
+/**
+ * struct xocl_qdma_zc_desc - Zero copy receive record
+ *
+ * Reading a zero copy queue returns an array of these instead of data.
+ * Each names a page of the stream buffer that holds received data; the
+ * page stays with the user until returned with XOCL_QDMA_IOC_QUEUE_RECYCLE.
+ *
+ * @slot:	page index in the stream buffer
+ * @len:	bytes of data in the page
+ */
+struct xocl_qdma_zc_desc {
+	uint32_t	slot;
+	uint32_t	len;
+};
+
+/**
+ * struct xocl_qdma_ioc_recycle - Return zero copy pages to the queue
+ * used with XOCL_QDMA_IOC_QUEUE_RECYCLE ioctl
+ *
+ * @slots:	user pointer to an array of uint32_t slot indexes
+ * @count:	number of slots
+ */
+struct xocl_qdma_ioc_recycle {
+	uint64_t	slots;
+	uint32_t	count;
+};
+
 /**
  * struct xocl_qdma_req_header - per request header for out bind data
  *
@@ -107,7 +157,11 @@ struct xocl_qdma_req_header {
 	XOCL_QDMA_CREATE_QUEUE)
 #define	XOCL_QDMA_IOC_ALLOC_BUFFER		_IO(XOCL_QDMA_IOC_MAGIC, \
 	XOCL_QDMA_ALLOC_BUFFER)
+#define	XOCL_QDMA_IOC_CREATE_QUEUE_ZC		_IO(XOCL_QDMA_IOC_MAGIC, \
+	XOCL_QDMA_CREATE_QUEUE_ZC)
 
 #define	XOCL_QDMA_IOC_QUEUE_MODIFY		_IO(XOCL_QDMA_QUEUE_IOC_MAGIC, \
 	XOCL_QDMA_QUEUE_MODIFY)
+#define	XOCL_QDMA_IOC_QUEUE_RECYCLE		_IO(XOCL_QDMA_QUEUE_IOC_MAGIC, \
+	XOCL_QDMA_QUEUE_RECYCLE)
 #endif
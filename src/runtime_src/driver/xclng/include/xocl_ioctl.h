@@ -69,6 +69,19 @@
  *      interrupt
  * 12   Write buffer from device to peer FPGA  DRM_IOCTL_XOCL_COPY_BO         drm_xocl_copy_bo
  *      buffer
+ * 13   Submit multiple exec buffers to the    DRM_IOCTL_XOCL_EXECBUF_BATCH   drm_xocl_execbuf_batch
+ *      scheduler
+ * 14   Register exec buffer completion ring   DRM_IOCTL_XOCL_EXEC_RING       drm_xocl_exec_ring
+ * 15   Synchronize (DMA) buffer contents      DRM_IOCTL_XOCL_SYNC_BO_ASYNC   drm_xocl_sync_bo_async
+ *      without waiting for completion
+ * 16   Synchronize (DMA) multiple buffer      DRM_IOCTL_XOCL_SYNC_BO_V       drm_xocl_sync_bo_v
+ *      ranges
+ * 17   Write user's data to bo and            DRM_IOCTL_XOCL_PWRITE_SYNC_BO  drm_xocl_pwrite_bo
+ *      synchronize it to device
+ * 18   Synchronize bo from device and read    DRM_IOCTL_XOCL_PREAD_SYNC_BO   drm_xocl_pread_bo
+ *      it into user's data
+ * 19   Open file for unmanaged (AIO capable)  DRM_IOCTL_XOCL_UNMGD_FD        drm_xocl_unmgd_fd
+ *      reads/writes of device memory
  * ==== ====================================== ============================== ==================================
  */
 
@@ -139,6 +152,20 @@ enum drm_xocl_ops {
 	DRM_XOCL_READ_AXLF,
 	/* Copy buffer to Destination buffer by using DMA */
 	DRM_XOCL_COPY_BO,
+	/* Submit multiple exec buffers */
+	DRM_XOCL_EXECBUF_BATCH,
+	/* Register exec buffer completion ring */
+	DRM_XOCL_EXEC_RING,
+	/* Sync buffer by using DMA, signal eventfd on completion */
+	DRM_XOCL_SYNC_BO_ASYNC,
+	/* Sync multiple buffer ranges by using DMA */
+	DRM_XOCL_SYNC_BO_V,
+	/* Write user's data to device memory of buffer by using DMA */
+	DRM_XOCL_PWRITE_SYNC_BO,
+	/* Read device memory of buffer into user's data by using DMA */
+	DRM_XOCL_PREAD_SYNC_BO,
+	/* Open file for unmanaged DMA from/to device by file offset */
+	DRM_XOCL_UNMGD_FD,
 
 	DRM_XOCL_NUM_IOCTLS
 };
@@ -157,6 +184,7 @@ enum drm_xocl_sync_bo_dir {
 #define DRM_XOCL_BO_BANK2   (0x1 << 2)
 #define DRM_XOCL_BO_BANK3   (0x1 << 3)
 
+#define DRM_XOCL_BO_LONG_LIVED (0x1 << 28)
 #define DRM_XOCL_BO_CMA     (0x1 << 29)
 #define DRM_XOCL_BO_P2P     (0x1 << 30)
 #define DRM_XOCL_BO_EXECBUF (0x1 << 31)
@@ -216,10 +244,14 @@ struct drm_xocl_map_bo {
  * used with DRM_IOCTL_XOCL_SYNC_BO ioctl
  *
  * @handle:	bo handle
- * @flags:	Unused
+ * @flags:	0 or DRM_XOCL_SYNC_BO_CHANNEL(n)
  * @size:	Number of bytes to synchronize
  * @offset:	Offset into the object to synchronize
  * @dir:	DRM_XOCL_SYNC_DIR_XXX
+ *
+ * DRM_XOCL_SYNC_BO_CHANNEL(n) asks for DMA channel n.  The driver uses
+ * any free channel when channel n is busy or does not exist, so threads
+ * that each name their own channel do not wait for each other.
  */
 struct drm_xocl_sync_bo {
 	uint32_t handle;
@@ -229,6 +261,63 @@ struct drm_xocl_sync_bo {
 	enum drm_xocl_sync_bo_dir dir;
 };
 
+#define DRM_XOCL_SYNC_BO_CHANNEL_VALID	(1U << 31)
+#define DRM_XOCL_SYNC_BO_CHANNEL_MASK	0xff
+#define DRM_XOCL_SYNC_BO_CHANNEL(n)	\
+	(DRM_XOCL_SYNC_BO_CHANNEL_VALID | ((n) & DRM_XOCL_SYNC_BO_CHANNEL_MASK))
+
+/* Added to eventfd counter by failed DRM_IOCTL_XOCL_SYNC_BO_ASYNC */
+#define DRM_XOCL_SYNC_BO_ASYNC_FAILED	(1ULL << 32)
+
+/**
+ * struct drm_xocl_sync_bo_async - Synchronize the buffer in the requested
+ * direction between device and host without waiting for the DMA
+ * used with DRM_IOCTL_XOCL_SYNC_BO_ASYNC ioctl
+ *
+ * @handle:	bo handle
+ * @flags:	Pass 0
+ * @size:	Number of bytes to synchronize
+ * @offset:	Offset into the object to synchronize
+ * @dir:	DRM_XOCL_SYNC_DIR_XXX
+ * @fd:		File descriptor created with eventfd system call
+ *
+ * The ioctl returns once the sync is queued.  On completion the driver
+ * adds 1 to the eventfd counter, or DRM_XOCL_SYNC_BO_ASYNC_FAILED if the
+ * DMA failed, so reading the eventfd returns number of successful syncs
+ * in the low 32 bits and number of failed syncs in the high 32 bits.
+ * Syncs on different DMA channels proceed concurrently.
+ */
+struct drm_xocl_sync_bo_async {
+	uint32_t handle;
+	uint32_t flags;
+	uint64_t size;
+	uint64_t offset;
+	enum drm_xocl_sync_bo_dir dir;
+	int fd;
+};
+
+#define DRM_XOCL_SYNC_BO_V_MAX 4096
+
+/**
+ * struct drm_xocl_sync_bo_v - Synchronize multiple buffer ranges
+ * used with DRM_IOCTL_XOCL_SYNC_BO_V ioctl
+ *
+ * @num_ranges:  Number of ranges, max DRM_XOCL_SYNC_BO_V_MAX
+ * @flags:       Pass 0
+ * @ranges_ptr:  User's pointer to array of @num_ranges struct drm_xocl_sync_bo
+ *
+ * Ranges are synchronized in array order and the ioctl stops at the
+ * first failing range.  Consecutive ranges of the same BO and direction
+ * are one DMA transfer, a descriptor chain with a device address per
+ * range.  DMA engines without chained transfers, and runs larger than
+ * one DMA slice, get one transfer per set of adjacent ranges.
+ */
+struct drm_xocl_sync_bo_v {
+	uint32_t num_ranges;
+	uint32_t flags;
+	uint64_t ranges_ptr;
+};
+
 /**
  * struct drm_xocl_info_bo - Obtain information about an allocated buffer obbject
  * used with DRM_IOCTL_XOCL_INFO_BO IOCTL
@@ -312,6 +401,14 @@ struct drm_xocl_pread_bo {
 	uint64_t data_ptr;
 };
 
+/*
+ * DRM_IOCTL_XOCL_PWRITE_SYNC_BO and DRM_IOCTL_XOCL_PREAD_SYNC_BO take the
+ * arguments of PWRITE_BO and PREAD_BO and also synchronize the range, to
+ * and from the device respectively.  Large transfers are DMAed directly
+ * between @data_ptr and device memory, so the host copy of the range is
+ * undefined after either ioctl until the range is synced from device.
+ */
+
 enum drm_xocl_ctx_code {
         XOCL_CTX_OP_ALLOC_CTX = 0,
         XOCL_CTX_OP_FREE_CTX
@@ -377,6 +474,25 @@ struct drm_xocl_pread_unmgd {
 	uint64_t data_ptr;
 };
 
+/**
+ * struct drm_xocl_unmgd_fd - open a file for unprotected reads and writes
+ * of device memory
+ * used with DRM_IOCTL_XOCL_UNMGD_FD ioctl
+ *
+ * @flags:	Pass 0
+ * @fd:		File descriptor (out)
+ *
+ * The file offset of a read or write is the device address, so pread(),
+ * pwrite(), preadv(), pwritev(), Linux AIO and io_uring all perform an
+ * unmanaged DMA like DRM_IOCTL_XOCL_PREAD_UNMGD/PWRITE_UNMGD.  AIO and
+ * io_uring requests return once queued, many can be in flight at a time
+ * and their completions are reaped in batches by the usual means.
+ */
+struct drm_xocl_unmgd_fd {
+	uint32_t flags;
+	int32_t fd;
+};
+
 
 struct drm_xocl_mm_stat {
 	size_t memory_usage;
@@ -454,6 +570,62 @@ struct drm_xocl_execbuf {
         uint32_t deps[8];
 };
 
+#define DRM_XOCL_EXECBUF_BATCH_MAX 64
+
+/**
+ * struct drm_xocl_execbuf_batch - Submit multiple exec buffers
+ * used with DRM_IOCTL_XOCL_EXECBUF_BATCH ioctl
+ *
+ * @ctx_id:      Pass 0
+ * @num_bos:     Number of exec buffer handles, max DRM_XOCL_EXECBUF_BATCH_MAX
+ * @handles_ptr: User's pointer to array of @num_bos exec buffer handles
+ *
+ * The exec buffers are added to the scheduler in array order.  Either
+ * all or none of the exec buffers are submitted.
+ */
+struct drm_xocl_execbuf_batch {
+        uint32_t ctx_id;
+        uint32_t num_bos;
+        uint64_t handles_ptr;
+};
+
+/**
+ * struct drm_xocl_exec_ring - Register exec buffer completion ring
+ * used with DRM_IOCTL_XOCL_EXEC_RING ioctl
+ *
+ * @ctx_id:      Pass 0
+ * @handle:      Exec buffer BO laid out as struct drm_xocl_exec_ring_buf,
+ *               or 0 to unregister the current ring
+ *
+ * Once registered, the scheduler writes the handle of every exec buffer
+ * submitted through this file to the ring when the exec buffer completes.
+ */
+struct drm_xocl_exec_ring {
+        uint32_t ctx_id;
+        uint32_t handle;
+};
+
+/**
+ * struct drm_xocl_exec_ring_buf - Layout of exec buffer completion ring
+ *
+ * @head:    Index of next entry to consume, written by user space
+ * @tail:    Index of next entry to produce, written by driver
+ * @size:    Number of entries, power of 2 written by driver at registration
+ * @dropped: Number of completions not written because ring was full,
+ *           written by driver
+ * @handles: Completed exec buffer handles, index modulo @size
+ *
+ * Indices are free running.  User space must fall back to checking the
+ * state of all outstanding exec buffers when @dropped changes.
+ */
+struct drm_xocl_exec_ring_buf {
+        uint32_t head;
+        uint32_t tail;
+        uint32_t size;
+        uint32_t dropped;
+        uint32_t handles[];
+};
+
 /**
  * struct drm_xocl_user_intr - Register user's eventfd for MSIX interrupt
  * used with DRM_IOCTL_XOCL_USER_INTR ioctl
@@ -506,5 +678,19 @@ struct drm_xocl_user_intr {
 					       DRM_XOCL_EXECBUF, struct drm_xocl_execbuf)
 #define DRM_IOCTL_XOCL_USER_INTR      DRM_IOWR(DRM_COMMAND_BASE +	\
 					       DRM_XOCL_USER_INTR, struct drm_xocl_user_intr)
+#define DRM_IOCTL_XOCL_EXECBUF_BATCH  DRM_IOWR(DRM_COMMAND_BASE +	\
+					       DRM_XOCL_EXECBUF_BATCH, struct drm_xocl_execbuf_batch)
+#define DRM_IOCTL_XOCL_EXEC_RING      DRM_IOWR(DRM_COMMAND_BASE +	\
+					       DRM_XOCL_EXEC_RING, struct drm_xocl_exec_ring)
+#define DRM_IOCTL_XOCL_SYNC_BO_ASYNC  DRM_IOW (DRM_COMMAND_BASE +	\
+					       DRM_XOCL_SYNC_BO_ASYNC, struct drm_xocl_sync_bo_async)
+#define DRM_IOCTL_XOCL_SYNC_BO_V      DRM_IOW (DRM_COMMAND_BASE +	\
+					       DRM_XOCL_SYNC_BO_V, struct drm_xocl_sync_bo_v)
+#define DRM_IOCTL_XOCL_PWRITE_SYNC_BO DRM_IOW (DRM_COMMAND_BASE +	\
+					       DRM_XOCL_PWRITE_SYNC_BO, struct drm_xocl_pwrite_bo)
+#define DRM_IOCTL_XOCL_PREAD_SYNC_BO  DRM_IOWR(DRM_COMMAND_BASE +	\
+					       DRM_XOCL_PREAD_SYNC_BO, struct drm_xocl_pread_bo)
+#define DRM_IOCTL_XOCL_UNMGD_FD       DRM_IOWR(DRM_COMMAND_BASE +	\
+					       DRM_XOCL_UNMGD_FD, struct drm_xocl_unmgd_fd)
 
 #endif
@@ -23,6 +23,8 @@
 #include <thread>
 #include <cstring>
 #include <vector>
+#include <array>
+#include <algorithm>
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <errno.h>
@@ -45,7 +47,8 @@
 static const bool FOUR_BYTE_ADDRESSING = false;
 
 uint32_t MAX_NUM_SECTORS = 0;
-uint32_t selected_sector = -1;
+//Extended address register value last written, per slave
+uint32_t selected_sector[2] = {(uint32_t)-1, (uint32_t)-1};
 
 //testing sizes.
 #define WRITE_DATA_SIZE 128
@@ -202,7 +205,11 @@ static const unsigned  SECTOR_ERASE_BYTES = FOUR_BYTE_ADDRESSING ? 5 :4;
 #define WDT_ENABLE  0x02000040//0x40000002
 
 #define BITSTREAM_GUARD_SIZE 0x1000
-uint32_t BITSTREAM_START_LOC = -1; //Set to 0xFFFFFFFF
+
+#define SUBSECTOR_SIZE 0x1000
+#define SECTOR_SIZE 0x10000
+//Stop read-compare after this many changed subsectors in a row
+#define COMPARE_MISS_LIMIT 16
 uint32_t BITSTREAM_GUARD[] = { 
             DUMMY,
             BUSWIDTH1,
@@ -232,7 +239,7 @@ uint32_t BITSTREAM_GUARD[] = {
 
 //---
 
-static uint8_t WriteBuffer[PAGE_SIZE + READ_WRITE_EXTRA_BYTES];
+static uint8_t WriteBuffer[PAGE_SIZE + READ_WRITE_EXTRA_BYTES + 4];
 static uint8_t ReadBuffer[PAGE_SIZE + READ_WRITE_EXTRA_BYTES + 4];
 
 static int slave_index = 0;
@@ -263,10 +270,10 @@ static void clearWriteBuffer(unsigned size) {
 
 static void clearBuffers() {
     clearReadBuffer(PAGE_SIZE + READ_WRITE_EXTRA_BYTES+4);
-    clearWriteBuffer(PAGE_SIZE + READ_WRITE_EXTRA_BYTES);
+    clearWriteBuffer(PAGE_SIZE + READ_WRITE_EXTRA_BYTES + 4);
 }
 
-XSPI_Flasher::XSPI_Flasher( unsigned int device_index, char *inMap )
+XSPI_Flasher::XSPI_Flasher( unsigned int device_index, char *inMap ) : mFifoDepth(0)
 {
     mMgmtMap = inMap; // brought in from Flasher object
 }
@@ -292,13 +299,13 @@ bool XSPI_Flasher::setSector(unsigned address) {
         std::cout << "ERROR: Invalid sector encountered" << std::endl;
         std::cout << "ERROR: Bad address 0x" << std::hex << address << std::dec << std::endl;
         return false;
-    } else if(sector == selected_sector) //Don't do anything if its already selected
+    } else if(sector == selected_sector[slave_index]) //Don't do anything if its already selected
         return true;
     
     if(!writeRegister(COMMAND_EXTENDED_ADDRESS_REG_WRITE, sector, 1))
         return false;
     else {
-        selected_sector = sector;
+        selected_sector[slave_index] = sector;
         return true;
     }
 }
@@ -487,42 +494,86 @@ int XSPI_Flasher::xclTestXSpi(int index)
 }
 
 int XSPI_Flasher::xclUpgradeFirmware2(std::istream& mcsStream1, std::istream& mcsStream2) {
-    int status = 0;
-    status = xclUpgradeFirmwareXSpi(mcsStream1, 0);
-    if(status)
-        return status;
     clearBuffers();
-    recordList.clear();
-    return xclUpgradeFirmwareXSpi(mcsStream2, 1);
+
+    if (!mMgmtMap)
+        return -EACCES;
+
+    //Both flashes are programmed together, see programXSpi
+    std::vector<FlashJob> jobs(2);
+    std::istream* streams[2] = {&mcsStream1, &mcsStream2};
+    for (int i = 0; i < 2; i++) {
+        jobs[i].mSlave = i;
+        int status = parseMcs(*streams[i], jobs[i].mRecords);
+        if(status)
+            return status;
+    }
+    return programXSpi(jobs);
 }
 
 int XSPI_Flasher::xclUpgradeFirmwareXSpi(std::istream& mcsStream, int index) {
     clearBuffers();
-    recordList.clear();
 
     if (!mMgmtMap)
         return -EACCES;
 
-    slave_index = index;
-    std::string line;
-    std::string startAddress;
+    std::vector<FlashJob> jobs(1);
+    jobs[0].mSlave = index;
+    int status = parseMcs(mcsStream, jobs[0].mRecords);
+    if(status)
+        return status;
+    return programXSpi(jobs);
+}
+
+static int hexNibble(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+//Returns the byte at hex digit position pos of line, or -1
+static int hexByte(const std::string& line, size_t pos) {
+    if (pos + 2 > line.size())
+        return -1;
+    int hi = hexNibble(line[pos]);
+    int lo = hexNibble(line[pos + 1]);
+    return (hi < 0 || lo < 0) ? -1 : (hi << 4) | lo;
+}
+
+/*
+ * Decode the whole MCS file into per ELA record binary data, so
+ * programming does not parse text while the flash is waiting.
+ */
+int XSPI_Flasher::parseMcs(std::istream& mcsStream, ELARecordList& records) {
+    records.clear();
+
     ELARecord record;
+    bool recordStarted = false;
     bool endRecordFound = false;
 
-    int lineno = 0;
-    while (!mcsStream.eof() && !endRecordFound) {
-    lineno++;
-        std::string line;
-        std::getline(mcsStream, line);
+    std::string line;
+    while (!endRecordFound && std::getline(mcsStream, line)) {
+        if (!line.empty() && line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
         if (line.size() == 0) {
             continue;
         }
-        if (line[0] != ':') {
+        if (line[0] != ':' || line.size() < 11) {
+            return -EINVAL;
+        }
+        const int dataLen = hexByte(line, 1);
+        const int addrHi = hexByte(line, 3);
+        const int addrLo = hexByte(line, 5);
+        const int recordType = hexByte(line, 7);
+        if (dataLen < 0 || addrHi < 0 || addrLo < 0 || recordType < 0
+            || line.size() < 9 + 2 * (size_t)dataLen) {
             return -EINVAL;
         }
-        const unsigned dataLen = std::stoi(line.substr(1, 2), 0 , 16);
-        const unsigned address = std::stoi(line.substr(3, 4), 0, 16);
-        const unsigned recordType = std::stoi(line.substr(7, 2), 0 , 16);
+        const unsigned address = (addrHi << 8) | addrLo;
         switch (recordType) {
         case 0x00:
         {
@@ -534,8 +585,6 @@ int XSPI_Flasher::xclUpgradeFirmwareXSpi(std::istream& mcsStream, int index) {
             if (address != (record.mDataCount+(record.mStartAddress & 0xFFFF))) {
                 if(record.mDataCount == 0) {
                     //First entry only.
-                    assert(record.mStartAddress != 0);
-                    assert(record.mEndAddress != 0);
                     record.mStartAddress += address;
                     record.mEndAddress += address;
                 }else {
@@ -543,19 +592,22 @@ int XSPI_Flasher::xclUpgradeFirmwareXSpi(std::istream& mcsStream, int index) {
                     return -EINVAL;
                 }
             }
-            //if ( ((record.mEndAddress-record.mStartAddress)& 0xFFFF) != address) {
-              //  return -EINVAL;
-            //}
+            for (int i = 0; i < dataLen; i++) {
+                int value = hexByte(line, 9 + 2 * i);
+                if (value < 0)
+                    return -EINVAL;
+                record.mData.push_back((unsigned char)value);
+            }
             record.mDataCount += dataLen;
             record.mEndAddress += dataLen;
             break;
         }
         case 0x01:
         {
-            if (startAddress.size() == 0) {
+            if (!recordStarted) {
                 break;
             }
-            recordList.push_back(record);
+            records.push_back(record);
             endRecordFound = true;
             break;
         }
@@ -572,29 +624,29 @@ int XSPI_Flasher::xclUpgradeFirmwareXSpi(std::istream& mcsStream, int index) {
             if (dataLen != 2) {
                 return -EINVAL;
             }
-            std::string newAddress = line.substr(9, dataLen * 2);
-            if (startAddress.size()) {
+            const int segHi = hexByte(line, 9);
+            const int segLo = hexByte(line, 11);
+            if (segHi < 0 || segLo < 0) {
+                return -EINVAL;
+            }
+            if (recordStarted) {
                 // Finish the old record
-                recordList.push_back(record);
+                records.push_back(record);
             }
             // Start a new record
-            record.mStartAddress = std::stoi(newAddress, 0 , 16);
-            record.mStartAddress <<= 16;
+            record = ELARecord();
+            record.mStartAddress = ((unsigned)segHi << 24) | ((unsigned)segLo << 16);
             record.mDataPos = mcsStream.tellg();
             record.mEndAddress = record.mStartAddress;
-            record.mDataCount = 0;
-            startAddress = newAddress;
+            recordStarted = true;
         }
         }
     }
 
-    mcsStream.seekg(0);
-    std::cout << "INFO: ***Found " << recordList.size() << " ELA Records" << std::endl;
-
-    //Ensure we set bitstream guard to the first location
-    BITSTREAM_START_LOC = recordList.front().mStartAddress;
-    
-    return programXSpi(mcsStream);
+    std::cout << "INFO: ***Found " << records.size() << " ELA Records" << std::endl;
+    if (records.empty())
+        return -EINVAL;
+    return 0;
 }
 
 unsigned XSPI_Flasher::readReg(unsigned RegOffset) {
@@ -847,6 +899,83 @@ bool XSPI_Flasher::getFlashId()
 }
 
 
+/*
+ * Queue as many bytes as the Tx FIFO takes. With a known FIFO depth an
+ * empty FIFO is filled in one burst, otherwise the full flag is polled
+ * after every byte.
+ */
+bool XSPI_Flasher::fillTxFifo(uint8_t *&SendBufferPtr, int &RemainingBytes)
+{
+    uint32_t StatusReg = XSpi_GetStatusReg();
+    if((StatusReg & (1<<10)) != 0) {
+        std::cout << "status reg in error situation " << std::endl;
+        return false;
+    }
+
+    if (mFifoDepth && (StatusReg & XSP_SR_TX_EMPTY_MASK)) {
+        int burst = std::min<int>(mFifoDepth, RemainingBytes);
+        for (int i = 0; i < burst; i++) {
+            uint32_t Data = *SendBufferPtr++;
+            if(Flasher::flashWrite(0, (unsigned long long)mMgmtMap + XSP_DTR_OFFSET, &Data, 4) != 0) {
+                return false;
+            }
+        }
+        RemainingBytes -= burst;
+        StatusReg = XSpi_GetStatusReg();
+        if((StatusReg & (1<<10)) != 0) {
+            std::cout << "Write command caused created error" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    while (((StatusReg & XSP_SR_TX_FULL_MASK) == 0) && (RemainingBytes > 0)) {
+        uint32_t Data = *SendBufferPtr++;
+        if(Flasher::flashWrite(0, (unsigned long long)mMgmtMap + XSP_DTR_OFFSET, &Data, 4) != 0) {
+            return false;
+        }
+        RemainingBytes--;
+        StatusReg = XSpi_GetStatusReg();
+        if((StatusReg & (1<<10)) != 0) {
+            std::cout << "Write command caused created error" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Count how many bytes the inhibited controller queues before
+ * reporting Tx full. Nothing is shifted out while no slave is selected.
+ */
+void XSPI_Flasher::detectFifoDepth()
+{
+    XSpi_SetSlaveSelectReg(SLAVE_SELECT_MASK);
+    XSpi_SetControlReg(CONTROL_REG_START_STATE);
+
+    unsigned depth = 0;
+    uint32_t Data = 0;
+    while (depth < PAGE_SIZE && (XSpi_GetStatusReg() & XSP_SR_TX_FULL_MASK) == 0) {
+        if(Flasher::flashWrite(0, (unsigned long long)mMgmtMap + XSP_DTR_OFFSET, &Data, 4) != 0)
+            break;
+        depth++;
+    }
+    mFifoDepth = (XSpi_GetStatusReg() & XSP_SR_TX_FULL_MASK) ? depth : 0;
+
+    //Drop the probe bytes
+    XSpi_SetControlReg(CONTROL_REG_START_STATE);
+}
+
+//Single status read, used to interleave commands to both flashes
+bool XSPI_Flasher::pollFlashReady(bool &ready)
+{
+    WriteBuffer[BYTE1] = COMMAND_STATUSREG_READ;
+    if(!finalTransfer(WriteBuffer, ReadBuffer, STATUS_READ_BYTES))
+        return false;
+    ready = (ReadBuffer[1] & FLASH_SR_IS_READY_MASK) == 0;
+    return true;
+}
+
 bool XSPI_Flasher::finalTransfer(uint8_t *SendBufPtr, uint8_t *RecvBufPtr, int ByteCount)
 {
     uint32_t ControlReg;
@@ -910,26 +1039,8 @@ bool XSPI_Flasher::finalTransfer(uint8_t *SendBufPtr, uint8_t *RecvBufPtr, int B
         return false;
     }
 
-    while (((StatusReg & XSP_SR_TX_FULL_MASK) == 0) && (RemainingBytes > 0)) {
-        if (DataWidth == 8) {
-            Data = *SendBufferPtr;
-        } else if (DataWidth == 16) {
-            Data = *(uint16_t *)SendBufferPtr;
-        } else if (DataWidth == 32){
-            Data = *(uint32_t *)SendBufferPtr;
-        }
-
-        if(Flasher::flashWrite(0, (unsigned long long)mMgmtMap + XSP_DTR_OFFSET, &Data, 4) != 0) {
-            return false;
-        }
-        SendBufferPtr += (DataWidth >> 3);
-        RemainingBytes -= (DataWidth >> 3);
-        StatusReg = XSpi_GetStatusReg();
-        if((StatusReg & (1<<10)) != 0) {
-            std::cout << "Write command caused created error" << std::endl;
-            return false;
-        }
-    }
+    if(!fillTxFifo(SendBufferPtr, RemainingBytes))
+        return false;
 
 
     /*
@@ -1005,6 +1116,25 @@ bool XSPI_Flasher::finalTransfer(uint8_t *SendBufPtr, uint8_t *RecvBufPtr, int B
              */
             StatusReg = XSpi_GetStatusReg();
 
+            //With a FIFO, read what the occupancy register (count - 1) reports
+            //without polling the status after every byte
+            if (mFifoDepth && (StatusReg & XSP_SR_RX_EMPTY_MASK) == 0) {
+                uint32_t Occupancy = XSpi_ReadReg(XSP_RFO_OFFSET) + 1;
+                for (uint32_t i = 0; i < Occupancy && i < mFifoDepth; i++) {
+                    if(Flasher::flashRead(0, (unsigned long long)mMgmtMap + XSP_DRR_OFFSET, &Data, 4) != 0)
+                        return false;
+                    if(RecvBufferPtr != NULL)
+                        *RecvBufferPtr++ = (uint8_t)Data;
+                    BytesTransferred++;
+                    ByteCount--;
+                }
+                StatusReg = XSpi_GetStatusReg();
+                if((StatusReg & (1<<10)) != 0) {
+                    std::cout << "status reg in error situation " << std::endl;
+                    return false;
+                }
+            }
+
             while ((StatusReg & XSP_SR_RX_EMPTY_MASK) == 0)
             {
                 //read the data.
@@ -1053,30 +1183,8 @@ bool XSPI_Flasher::finalTransfer(uint8_t *SendBufPtr, uint8_t *RecvBufPtr, int B
                  * The downside is that the status must be read
                  * each loop iteration.
                  */
-                StatusReg = XSpi_GetStatusReg();
-
-                while(((StatusReg & XSP_SR_TX_FULL_MASK)== 0) && (RemainingBytes > 0))
-                {
-                    if (DataWidth == 8) {
-                        Data = *SendBufferPtr;
-                    } else if (DataWidth == 16) {
-                        Data = *(uint16_t *)SendBufferPtr;
-                    } else if (DataWidth == 32) {
-                        Data = *(uint32_t *)SendBufferPtr;
-                    }
-
-                    if(Flasher::flashWrite(0, (unsigned long long)mMgmtMap + XSP_DTR_OFFSET, &Data, 4) != 0) {
-                        return false;
-                    }
-
-                    SendBufferPtr += (DataWidth >> 3);
-                    RemainingBytes -= (DataWidth >> 3);
-                    StatusReg = XSpi_GetStatusReg();
-                    if((StatusReg & (1<<10)) != 0) {
-                        std::cout << "status reg in error situation " << std::endl;
-                        return false;
-                    }
-                }
+                if(!fillTxFifo(SendBufferPtr, RemainingBytes))
+                    return false;
 
                 //Start the transfer by not inhibiting the transmitter any longer.
                 ControlReg = XSpi_GetControlReg();
@@ -1099,7 +1207,7 @@ bool XSPI_Flasher::finalTransfer(uint8_t *SendBufPtr, uint8_t *RecvBufPtr, int B
 }
 
 
-bool XSPI_Flasher::writePage(unsigned Addr, uint8_t writeCmd)
+bool XSPI_Flasher::writePage(unsigned Addr, uint8_t writeCmd, unsigned byteCount)
 {
     if(!isFlashReady())
         return false;
@@ -1149,7 +1257,7 @@ bool XSPI_Flasher::writePage(unsigned Addr, uint8_t writeCmd)
     }
 
     //The data to write is already filled up, so now just write the buffer.
-    if(!finalTransfer(WriteBuffer, ReadBuffer, WRITE_DATA_SIZE + READ_WRITE_EXTRA_BYTES))
+    if(!finalTransfer(WriteBuffer, ReadBuffer, byteCount + READ_WRITE_EXTRA_BYTES))
         return false;
 
     if(!waitTxEmpty())
@@ -1160,7 +1268,7 @@ bool XSPI_Flasher::writePage(unsigned Addr, uint8_t writeCmd)
 
 }
 
-bool XSPI_Flasher::readPage(unsigned Addr, uint8_t readCmd)
+bool XSPI_Flasher::readPage(unsigned Addr, uint8_t readCmd, unsigned byteCount)
 {
     if(!isFlashReady())
         return false;
@@ -1204,7 +1312,7 @@ bool XSPI_Flasher::readPage(unsigned Addr, uint8_t readCmd)
         WriteBuffer[BYTE5] = (uint8_t) Addr;
     }
 
-    unsigned ByteCount = READ_DATA_SIZE;
+    unsigned ByteCount = byteCount;
 
     if (ReadCmd == COMMAND_DUAL_READ) {
         ByteCount += DUAL_READ_DUMMY_BYTES;
@@ -1271,252 +1379,198 @@ bool XSPI_Flasher::prepareXSpi()
     return true;
 }
 
-int XSPI_Flasher::programXSpi(std::istream& mcsStream, const ELARecord& record) {
-    //TODO: decrease the sleep time.
-    const timespec req = {0, 20000};
-
-#if defined(_debug)
-    std::cout << "Programming block (" << std::hex << record.mStartAddress << ", " << record.mEndAddress << std::dec << ")" << std::endl;
-#endif
-
-    assert(mcsStream.tellg() < record.mDataPos);
-    mcsStream.seekg(record.mDataPos, std::ios_base::beg);
-    unsigned char* buffer = &WriteBuffer[READ_WRITE_EXTRA_BYTES];
-    int bufferIndex = 0;
-    int pageIndex = 0;
-    std::string prevLine("");
-    for (unsigned index = record.mDataCount; index > 0;) {
-        std::string line;
-        std::getline(mcsStream, line);
-        if(TEST_MODE)
-            std::cout << line << std::endl;
-        const unsigned dataLen = std::stoi(line.substr(1, 2), 0 , 16);
-        index -= dataLen;
-        const unsigned recordType = std::stoi(line.substr(7, 2), 0 , 16);
-        if (recordType != 0x00) {
-            continue;
-        }
-        const std::string data = line.substr(9, dataLen * 2);
-        // Write in byte swapped order
-        for (unsigned i = 0; i < data.length(); i += 2) {
-            unsigned value = std::stoi(data.substr(i, 2), 0, 16);
-            buffer[bufferIndex++] = (unsigned char)value;
-            assert(bufferIndex <= WRITE_DATA_SIZE);
-
-#if 0
-            //To enable byte swapping uncomment this.
-            //      if ((bufferIndex % 4) == 0) {
-            //        bufferIndex += 4;
-            //      }
-            //      assert(bufferIndex <= WRITE_DATA_SIZE);
-            //      unsigned value = std::stoi(data.substr(i, 2), 0, 16);
-            //      if(TEST_MODE)
-            //        std::cout << data.substr(i, 2);
-            //      buffer[--bufferIndex] = (unsigned char)value;
-            //      if ((bufferIndex % 4) == 0) {
-            //        bufferIndex += 4;
-            //      }
-#endif
-            if (bufferIndex == WRITE_DATA_SIZE) {
-                break;
-            }
-        }
-
-        if(TEST_MODE)
-            std::cout << std::endl;
+static bool isBlank(const unsigned char *data, size_t size) {
+    return std::all_of(data, data + size, [](unsigned char c) { return c == 0xff; });
+}
 
-#if 0
-        //Uncomment if byte swapping enabled.
+//Read back a subsector a page at a time and compare with the image
+bool XSPI_Flasher::subsectorMatches(unsigned addr, const std::vector<unsigned char>& data)
+{
+    const unsigned dataOffset = READ_WRITE_EXTRA_BYTES + QUAD_READ_DUMMY_BYTES;
+    for (unsigned page = 0; page < SUBSECTOR_SIZE; page += PAGE_SIZE) {
+        if(!readPage(addr + page, 0xff, PAGE_SIZE))
+            return false;
+        if (std::memcmp(&ReadBuffer[dataOffset], &data[page], PAGE_SIZE) != 0)
+            return false;
+    }
+    return true;
+}
 
-        //account for the last line
-        //which can have say 14 bytes instead of 16
-        if((bufferIndex %4)!= 0) {
-            while ((bufferIndex %4)!= 0) {
-                unsigned char fillValue = 0xFF;
-                buffer[--bufferIndex] = fillValue;
-            }
-            bufferIndex += 4;
+/*
+ * Lay the records out in 4KB subsectors below the bitstream guard, skip
+ * subsectors the flash already holds, and queue the erase and page
+ * program commands for the rest.
+ */
+int XSPI_Flasher::prepareJob(FlashJob& job)
+{
+    slave_index = job.mSlave;
+    job.mSubsectors.clear();
+    job.mOps.clear();
+
+    //Bitstream guard goes to the first location, unless writing to address 0
+    job.mGuardAddress = job.mRecords.front().mStartAddress;
+    const unsigned shift = job.mGuardAddress ? BITSTREAM_GUARD_SIZE : 0;
+
+    for (const auto& record : job.mRecords) {
+        unsigned addr = record.mStartAddress + shift;
+        size_t offset = 0;
+        while (offset < record.mData.size()) {
+            unsigned sub = addr & ~(SUBSECTOR_SIZE - 1);
+            size_t len = std::min<size_t>(SUBSECTOR_SIZE - (addr - sub), record.mData.size() - offset);
+            auto& buf = job.mSubsectors[sub];
+            if (buf.empty())
+                buf.assign(SUBSECTOR_SIZE, 0xff);
+            std::memcpy(&buf[addr - sub], &record.mData[offset], len);
+            addr += len;
+            offset += len;
         }
+    }
 
-        assert((bufferIndex % 4) == 0);
-#endif
-
-        assert(bufferIndex <= WRITE_DATA_SIZE);
-        if (bufferIndex == WRITE_DATA_SIZE) {
-#if defined(_debug)
-            std::cout << "writing page " << pageIndex << std::endl;
-#endif
-            const unsigned address = std::stoi(line.substr(3, 4), 0, 16);
-            //assert ( (address + dataLen) == static_cast<unsigned int>((pageIndex +1)*WRITE_DATA_SIZE));
-            assert ( (address + dataLen - (record.mStartAddress & 0xFFFF)) 
-                == static_cast<unsigned int>((pageIndex +1)*WRITE_DATA_SIZE));      
-            if(TEST_MODE) {
-                std::cout << (address + dataLen) << " " << (pageIndex +1)*WRITE_DATA_SIZE << std::endl;
-                std::cout << record.mStartAddress << " " << record.mStartAddress + pageIndex*PAGE_SIZE;
-                std::cout << " " << address << std::endl;
-            } else {
-                if(!writePage(record.mStartAddress + pageIndex*WRITE_DATA_SIZE))
-                    return -ENXIO;
-                clearBuffers();
-                {
-                    //debug stuff
-#if defined(_debug)
-                    if(pageIndex == 0) {
-                        if(!readPage(record.mStartAddress + pageIndex*WRITE_DATA_SIZE))
-                            return -ENXIO;
-                        clearBuffers();
-                    }
-#endif
-                }
+    //Blank subsectors are always erased, a floating bus also reads as 0xff
+    std::vector<unsigned> dirty;
+    unsigned misses = 0;
+    for (const auto& sub : job.mSubsectors) {
+        if (misses < COMPARE_MISS_LIMIT && !isBlank(sub.second.data(), SUBSECTOR_SIZE)) {
+            if (subsectorMatches(sub.first, sub.second)) {
+                misses = 0;
+                continue;
             }
-            pageIndex++;
-            nanosleep(&req, 0);
-            bufferIndex = 0;
+            misses++;
         }
-        prevLine = line;
-
+        dirty.push_back(sub.first);
     }
-    if (bufferIndex) {
-        //Write the last page
-        if(TEST_MODE) {
-            std::cout << "writing final page " << pageIndex << std::endl;
-            std::cout << bufferIndex << std::endl;
-            std::cout << prevLine << std::endl;
+    std::cout << "INFO: Flash " << job.mSlave << ": " << job.mSubsectors.size() - dirty.size()
+              << " of " << job.mSubsectors.size() << " subsectors unchanged" << std::endl;
+
+    //A 64KB sector erase replaces 16 subsector erases when all of them change
+    for (size_t i = 0; i < dirty.size();) {
+        if ((dirty[i] & (SECTOR_SIZE - 1)) == 0 && i + 15 < dirty.size()
+            && dirty[i + 15] == dirty[i] + SECTOR_SIZE - SUBSECTOR_SIZE) {
+            job.mOps.push_back({FlashOp::ERASE_64K, dirty[i], nullptr});
+            i += 16;
+        } else {
+            job.mOps.push_back({FlashOp::ERASE_4K, dirty[i], nullptr});
+            i++;
         }
+    }
 
-        const unsigned address = std::stoi(prevLine.substr(3, 4), 0, 16);
-        const unsigned dataLen = std::stoi(prevLine.substr(1, 2), 0 , 16);
-
-        if(TEST_MODE)
-            std::cout << address % WRITE_DATA_SIZE << " " << dataLen << std::endl;
-
-        //assert( (address % WRITE_DATA_SIZE + dataLen) == bufferIndex);
-
-        if(!TEST_MODE) {
-
-            //Fill unused half page to FF
-            for(unsigned i = bufferIndex; i < WRITE_DATA_SIZE; ++i) {
-                buffer[i] = 0xff;
-            }
-
-            if(!writePage(record.mStartAddress + pageIndex*WRITE_DATA_SIZE))
-                return -ENXIO;
-            nanosleep(&req, 0);
-            clearBuffers();
-            {
-                //debug stuff
-#if defined(_debug)
-                if(!readPage(record.mStartAddress + pageIndex*WRITE_DATA_SIZE))
-                    return -ENXIO;
-                clearBuffers();
-#endif
-            }
+    //Erased pages already read 0xff, only program the others
+    for (unsigned sub : dirty) {
+        const auto& buf = job.mSubsectors[sub];
+        for (unsigned page = 0; page < SUBSECTOR_SIZE; page += PAGE_SIZE) {
+            if (!isBlank(&buf[page], PAGE_SIZE))
+                job.mOps.push_back({FlashOp::PROGRAM, sub + page, &buf[page]});
         }
     }
     return 0;
 }
 
-int XSPI_Flasher::programXSpi(std::istream& mcsStream)
+bool XSPI_Flasher::issueOp(const FlashOp& op)
 {
-    //  for (ELARecordList::iterator i = mRecordList.begin(), e = mRecordList.end(); i != e; ++i) {
-    //    i->mStartAddress <<= 16;
-    //    i->mEndAddress += i->mStartAddress;
-    //    // Convert from 2 bytes address to 4 bytes address
-    //    i->mStartAddress /= 2;
-    //    i->mEndAddress /= 2;
-    //  }
-
-    if (!prepareXSpi()) {
-        std::cout << "ERROR: Unable to prepare the XSpi\n";
-        return -EINVAL;
+    switch (op.mType) {
+    case FlashOp::ERASE_4K:
+        return sectorErase(op.mAddress, COMMAND_4KB_SUBSECTOR_ERASE);
+    case FlashOp::ERASE_64K:
+        return sectorErase(op.mAddress, COMMAND_SECTOR_ERASE);
+    case FlashOp::PROGRAM:
+        std::memcpy(&WriteBuffer[READ_WRITE_EXTRA_BYTES], op.mData, PAGE_SIZE);
+        return writePage(op.mAddress, 0xff, PAGE_SIZE);
     }
+    return false;
+}
 
-    //if(!bulkErase())
-    //return false;
+/*
+ * Program all flashes of jobs. Both flashes hang off the same controller
+ * but erase and program time is spent in the flash, so each flash gets its
+ * next command as soon as it reports ready instead of one after the other.
+ */
+int XSPI_Flasher::programXSpi(std::vector<FlashJob>& jobs)
+{
+    for (auto& job : jobs) {
+        slave_index = job.mSlave;
+        selected_sector[slave_index] = -1;
+        if (!prepareXSpi()) {
+            std::cout << "ERROR: Unable to prepare the XSpi\n";
+            return -EINVAL;
+        }
+    }
 
-    const timespec req = {0, 20000};
-    nanosleep(&req, 0);
+    detectFifoDepth();
+
+    size_t total = 0;
+    for (auto& job : jobs) {
+        if (prepareJob(job))
+            return -EINVAL;
+        total += job.mOps.size();
+    }
 
-    uint32_t bitstream_shift_addr = 0;
-    
     //First we enable bitstream guard if not writing to address 0
     //This will protect partially erased/programmed bitstreams
-    if(BITSTREAM_START_LOC != 0) {
-        if(!writeBitstreamGuard(BITSTREAM_START_LOC)) {
+    for (auto& job : jobs) {
+        if (job.mGuardAddress == 0 || job.mSubsectors.empty())
+            continue;
+        slave_index = job.mSlave;
+        if(!writeBitstreamGuard(job.mGuardAddress)) {
             std::cout << "ERROR: Unable to set bitstream guard!" << std::endl;
             return -EINVAL;
         }
-        bitstream_shift_addr += BITSTREAM_GUARD_SIZE;
         std::cout << "Enabled bitstream guard. Bitstream will not be loaded until flashing is finished." << std::endl;
     }
 
-    //Now we can safely erase all subsectors  
-    int beatCount = 0;
-    std::cout << "Erasing flash" << std::flush;
-    for (ELARecordList::iterator i = recordList.begin(), e = recordList.end(); i != e; ++i) {
-        beatCount++;
-        if(beatCount%20==0) {
-            std::cout << "." << std::flush;
-        }
-
-        //Shift all write addresses below bitstream guard
-        i->mStartAddress += bitstream_shift_addr;
-        i->mEndAddress += bitstream_shift_addr;
-        
-        //Erase any subsectors in address range.
-        for(uint32_t j = i->mStartAddress; j < i->mEndAddress; j+=0x1000) {
-            //std::cout << "DEBUG: Erasing subsector @ 0x" << std::hex << j << std::dec << std::endl;
-            if(!sectorErase(j, COMMAND_4KB_SUBSECTOR_ERASE)) {
-                std::cout << "\nERROR: Failed to erase subsector!" << std::endl;
+    //Erase commands are queued before the page programs of each flash
+    std::cout << "Programming flash" << std::flush;
+    const timespec req = {0, 5000};
+    long long idle = 0;
+    size_t done = 0;
+    while (done < total) {
+        bool issued = false;
+        for (auto& job : jobs) {
+            if (job.mOps.empty())
+                continue;
+            slave_index = job.mSlave;
+            bool ready = false;
+            if (!pollFlashReady(ready)) {
+                std::cout << "\nERROR: Unable to read flash status" << std::endl;
                 return -EINVAL;
             }
-            nanosleep(&req, 0); //Pause before next sector erase
-        }
-    }
-    //New line after ...
-    std::cout << std::endl;
-
-    //Next we program flash. Note that bitstream guard is still active
-    beatCount = 0;
-    std::cout << "Programming flash" << std::flush;
-    for (ELARecordList::iterator i = recordList.begin(), e = recordList.end(); i != e; ++i)
-    {
-        beatCount++;
-        if(beatCount%20==0) {
-            std::cout << "." << std::flush;
-        }
-
-        if(TEST_MODE) {
-            std::cout << "INFO: Start address 0x" << std::hex << recordList.front().mStartAddress << std::dec << "\n";
-            std::cout << "INFO: End address 0x" << std::hex << recordList.back().mEndAddress << std::dec << "\n";
+            if (!ready)
+                continue;
+            if (!issueOp(job.mOps.front())) {
+                std::cout << "\nERROR: Failed to " << (job.mOps.front().mType == FlashOp::PROGRAM ? "program" : "erase")
+                          << " flash at 0x" << std::hex << job.mOps.front().mAddress << std::dec << std::endl;
+                return -EINVAL;
+            }
+            job.mOps.pop_front();
+            issued = true;
+            if (++done % 1024 == 0)
+                std::cout << "." << std::flush;
         }
-
-        bool ready = isFlashReady();
-        if(!ready){
-            std::cout << "\nERROR: Unable to get flash ready" << std::endl;
-            return -EINVAL;
+        if (issued) {
+            idle = 0;
+            continue;
         }
-
-        clearBuffers();
-
-        if (programXSpi(mcsStream, *i)) {
-            std::cout << "\nERROR: Could not programXSpi the block" << std::endl;
+        nanosleep(&req, 0);
+        idle += 5000;
+        if (idle >= 30000000000) {
+            std::cout << "\nUnable to get Flash Ready" << std::endl;
             return -EINVAL;
         }
-        nanosleep(&req, 0);
     }
     std::cout << std::endl;
-    
+
     //Finally we clear bitstream guard if not writing to address 0
     //This will allow the bitstream to be loaded
-    if(BITSTREAM_START_LOC != 0) {
-        if(!clearBitstreamGuard(BITSTREAM_START_LOC)) {
+    for (auto& job : jobs) {
+        if (job.mGuardAddress == 0 || job.mSubsectors.empty())
+            continue;
+        slave_index = job.mSlave;
+        if(!clearBitstreamGuard(job.mGuardAddress) || !isFlashReady()) {
             std::cout << "ERROR: Unable to clear bitstream guard!" << std::endl;
             return -EINVAL;
         }
         std::cout << "Cleared bitstream guard. Bitstream now active." << std::endl;
     }
-    
+
     return 0;
 }
 
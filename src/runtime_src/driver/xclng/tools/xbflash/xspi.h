@@ -21,6 +21,8 @@
 
 #include <sys/stat.h>
 #include <list>
+#include <map>
+#include <vector>
 #include <iostream>
 
 
@@ -32,11 +34,30 @@ class XSPI_Flasher
         unsigned mEndAddress;
         unsigned mDataCount;
         std::streampos mDataPos;
+        std::vector<unsigned char> mData;
         ELARecord() : mStartAddress(0), mEndAddress(0), mDataCount(0), mDataPos(0) {}
     };
 
     typedef std::list<ELARecord> ELARecordList;
-    ELARecordList recordList;
+
+    // Flash command issued once the flash reports ready
+    struct FlashOp
+    {
+        enum Type { ERASE_4K, ERASE_64K, PROGRAM } mType;
+        unsigned mAddress;
+        const unsigned char *mData; // one page for PROGRAM
+    };
+
+    // Decoded image and pending commands of one flash
+    struct FlashJob
+    {
+        int mSlave;
+        unsigned mGuardAddress;
+        ELARecordList mRecords;
+        std::map<unsigned, std::vector<unsigned char>> mSubsectors;
+        std::list<FlashOp> mOps;
+        FlashJob() : mSlave(0), mGuardAddress(0) {}
+    };
 
 public:
     XSPI_Flasher( unsigned int device_index, char *inMap );
@@ -47,6 +68,7 @@ public:
 
 private:
     char *mMgmtMap;
+    unsigned mFifoDepth;
 
     int xclTestXSpi(int device_index);
     unsigned readReg(unsigned offset);
@@ -60,11 +82,17 @@ private:
     bool writeEnable();
     bool getFlashId();
     bool finalTransfer(uint8_t *sendBufPtr, uint8_t *recvBufPtr, int byteCount);
-    bool writePage(unsigned addr, uint8_t writeCmd = 0xff);
-    bool readPage(unsigned addr, uint8_t readCmd = 0xff);
+    bool fillTxFifo(uint8_t *&sendBufPtr, int &remainingBytes);
+    void detectFifoDepth();
+    bool pollFlashReady(bool &ready);
+    bool writePage(unsigned addr, uint8_t writeCmd = 0xff, unsigned byteCount = 128);
+    bool readPage(unsigned addr, uint8_t readCmd = 0xff, unsigned byteCount = 128);
+    bool subsectorMatches(unsigned addr, const std::vector<unsigned char>& data);
     bool prepareXSpi();
-    int programXSpi(std::istream& mcsStream, const ELARecord& record);
-    int programXSpi(std::istream& mcsStream);
+    int parseMcs(std::istream& mcsStream, ELARecordList& records);
+    int prepareJob(FlashJob& job);
+    bool issueOp(const FlashOp& op);
+    int programXSpi(std::vector<FlashJob>& jobs);
     bool readRegister(unsigned commandCode, unsigned bytes);
     bool writeRegister(unsigned commandCode, unsigned value, unsigned bytes);
     bool setSector(unsigned address);
@@ -0,0 +1,381 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ * A command line utility to replay a binary capture of HAL calls.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * The capture is written by the runtime when Runtime.hal_capture is set,
+ * see xclcapture.h.  Calls are re-issued in capture order from a single
+ * thread, BO handles of the capture are mapped to the BOs allocated by
+ * the replay.  Command packets are submitted as captured, buffer
+ * addresses in them are those of the capturing process, which match
+ * when the replay allocates the same BOs on an idle device.
+ */
+
+#include "xclhal2.h"
+#include "xclbin.h"
+#include "xclcapture.h"
+
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <getopt.h>
+
+namespace {
+
+const unsigned int null_bo = 0xffffffff;
+
+struct entry
+{
+    xclCaptureRecord rec;
+    std::vector<char> payload;
+};
+
+struct op_stats
+{
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+    uint64_t captured_ns = 0;
+    uint64_t replay_ns = 0;
+    uint64_t errors = 0;
+};
+
+const char *opName(uint32_t op)
+{
+    switch (op) {
+    case XCL_CAPTURE_ALLOC:         return "alloc";
+    case XCL_CAPTURE_ALLOC_USERPTR: return "alloc_userptr";
+    case XCL_CAPTURE_FREE:          return "free";
+    case XCL_CAPTURE_SYNC:          return "sync";
+    case XCL_CAPTURE_EXEC_ALLOC:    return "exec_alloc";
+    case XCL_CAPTURE_EXEC_BUF:      return "exec_buf";
+    case XCL_CAPTURE_EXEC_WAIT:     return "exec_wait";
+    }
+    return "unknown";
+}
+
+std::vector<entry> readCapture(const std::string& path, unsigned& device)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs)
+        throw std::runtime_error("cannot open " + path);
+
+    xclCaptureHeader header;
+    if (!ifs.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, XCL_CAPTURE_MAGIC, sizeof(header.magic)))
+        throw std::runtime_error(path + " is not a HAL capture");
+    if (header.version != XCL_CAPTURE_VERSION)
+        throw std::runtime_error(path + " has unsupported capture version " +
+            std::to_string(header.version));
+    device = header.device;
+
+    std::vector<entry> entries;
+    entry e;
+    while (ifs.read(reinterpret_cast<char *>(&e.rec), sizeof(e.rec))) {
+        e.payload.resize(e.rec.payload);
+        if (e.rec.payload && !ifs.read(e.payload.data(), e.rec.payload))
+            break; // truncated by an application that did not exit cleanly
+        entries.push_back(e);
+    }
+    return entries;
+}
+
+class Replayer
+{
+    xclDeviceHandle mHandle;
+    // BO handles of the capture to BOs of the replay
+    std::map<uint32_t, unsigned int> mBOs;
+    // Host memory of userptr BOs and mapping of command buffers
+    std::map<uint32_t, void *> mHostMem;
+    std::map<uint32_t, size_t> mExecSize;
+
+    unsigned int lookup(uint32_t bo) const
+    {
+        auto itr = mBOs.find(bo);
+        return itr == mBOs.end() ? null_bo : itr->second;
+    }
+
+    int alloc(const entry& e)
+    {
+        void *userptr = nullptr;
+        unsigned int bo;
+        if (e.rec.op == XCL_CAPTURE_ALLOC_USERPTR) {
+            if (posix_memalign(&userptr, 4096, e.rec.size))
+                return -ENOMEM;
+            bo = xclAllocUserPtrBO(mHandle, userptr, e.rec.size, e.rec.flags);
+        } else if (e.rec.op == XCL_CAPTURE_EXEC_ALLOC) {
+            bo = xclAllocBO(mHandle, e.rec.size, xclBOKind(0), (1U << 31));
+            if (bo != null_bo) {
+                userptr = xclMapBO(mHandle, bo, true);
+                if (userptr == nullptr || userptr == (void *)-1) {
+                    xclFreeBO(mHandle, bo);
+                    return -ENOMEM;
+                }
+                mExecSize[e.rec.bo] = e.rec.size;
+            }
+        } else {
+            bo = xclAllocBO(mHandle, e.rec.size, XCL_BO_DEVICE_RAM, e.rec.flags);
+        }
+
+        if (bo == null_bo) {
+            free(userptr);
+            return -ENOMEM;
+        }
+        mBOs[e.rec.bo] = bo;
+        if (userptr)
+            mHostMem[e.rec.bo] = userptr;
+        return 0;
+    }
+
+    int release(const entry& e)
+    {
+        auto bo = lookup(e.rec.bo);
+        if (bo == null_bo)
+            return -ENOENT;
+
+        auto mem = mHostMem.find(e.rec.bo);
+        if (mem != mHostMem.end()) {
+            if (mExecSize.erase(e.rec.bo))
+                xclUnmapBO(mHandle, bo, mem->second);
+            else
+                free(mem->second);
+            mHostMem.erase(mem);
+        }
+        xclFreeBO(mHandle, bo);
+        mBOs.erase(e.rec.bo);
+        return 0;
+    }
+
+    int execBuf(const entry& e)
+    {
+        auto bo = lookup(e.rec.bo);
+        auto size = mExecSize.find(e.rec.bo);
+        if (bo == null_bo || size == mExecSize.end())
+            return -ENOENT;
+        std::memcpy(mHostMem[e.rec.bo], e.payload.data(),
+            std::min(e.payload.size(), size->second));
+        return xclExecBuf(mHandle, bo);
+    }
+
+public:
+    explicit Replayer(xclDeviceHandle handle) : mHandle(handle) {}
+
+    ~Replayer()
+    {
+        // BOs still allocated at the end of the capture
+        while (!mBOs.empty()) {
+            entry e;
+            e.rec.bo = mBOs.begin()->first;
+            release(e);
+        }
+    }
+
+    int issue(const entry& e)
+    {
+        // Without a device the calls are only paced, see -n
+        if (!mHandle)
+            return 0;
+
+        switch (e.rec.op) {
+        case XCL_CAPTURE_ALLOC:
+        case XCL_CAPTURE_ALLOC_USERPTR:
+        case XCL_CAPTURE_EXEC_ALLOC:
+            return alloc(e);
+        case XCL_CAPTURE_FREE:
+            /* frees of BOs allocated before the capture was opened */
+            if (lookup(e.rec.bo) == null_bo)
+                return 0;
+            return release(e);
+        case XCL_CAPTURE_SYNC: {
+            auto bo = lookup(e.rec.bo);
+            if (bo == null_bo)
+                return -ENOENT;
+            return xclSyncBO(mHandle, bo, xclBOSyncDirection(e.rec.flags),
+                e.rec.size, e.rec.offset);
+        }
+        case XCL_CAPTURE_EXEC_BUF:
+            return execBuf(e);
+        case XCL_CAPTURE_EXEC_WAIT:
+            return xclExecWait(mHandle, static_cast<int>(e.rec.offset));
+        }
+        return -EINVAL;
+    }
+};
+
+int loadXclbin(xclDeviceHandle handle, const std::string& path)
+{
+    std::ifstream ifs(path, std::ios::binary | std::ios::ate);
+    if (!ifs) {
+        std::cout << "ERROR: cannot open " << path << std::endl;
+        return -ENOENT;
+    }
+    std::vector<char> buf(ifs.tellg());
+    ifs.seekg(0);
+    ifs.read(buf.data(), buf.size());
+
+    auto top = reinterpret_cast<const axlf *>(buf.data());
+    int ret = xclLoadXclBin(handle, top);
+    if (ret) {
+        std::cout << "ERROR: failed to load " << path << ": " << ret << std::endl;
+        return ret;
+    }
+
+    // Shared contexts on all CUs so that commands can be submitted
+    auto hdr = xclbin::get_axlf_section(top, IP_LAYOUT);
+    if (!hdr)
+        return 0;
+    auto layout = reinterpret_cast<const ip_layout *>(buf.data() + hdr->m_sectionOffset);
+    uuid_t uuid;
+    std::memcpy(uuid, &top->m_header.uuid, sizeof(uuid));
+    for (int i = 0; i < layout->m_count; i++) {
+        if (layout->m_ip_data[i].m_type != IP_KERNEL)
+            continue;
+        ret = xclOpenContext(handle, uuid, i, true);
+        if (ret) {
+            std::cout << "ERROR: failed to open context on CU " << i << ": " << ret << std::endl;
+            return ret;
+        }
+    }
+    return 0;
+}
+
+void usage(const char *prog)
+{
+    std::cout << "Usage: " << prog << " [-d card] [-k xclbin] [-n] [-t] <capture>\n"
+              << "  -d card    replay on this card, default is the captured card\n"
+              << "  -k xclbin  load xclbin before replay, needed for exec_buf\n"
+              << "  -n         null HAL, walk the capture without a device\n"
+              << "  -t         keep the captured time between calls\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    unsigned index = UINT_MAX;
+    std::string xclbin;
+    bool nullHal = false;
+    bool timed = false;
+    int c;
+
+    while ((c = getopt(argc, argv, "d:k:nth")) != -1) {
+        switch (c) {
+        case 'd':
+            index = std::atoi(optarg);
+            break;
+        case 'k':
+            xclbin = optarg;
+            break;
+        case 'n':
+            nullHal = true;
+            break;
+        case 't':
+            timed = true;
+            break;
+        default:
+            usage(argv[0]);
+            return c == 'h' ? 0 : -EINVAL;
+        }
+    }
+    if (optind + 1 != argc) {
+        usage(argv[0]);
+        return -EINVAL;
+    }
+
+    unsigned captured;
+    std::vector<entry> entries;
+    try {
+        entries = readCapture(argv[optind], captured);
+    }
+    catch (const std::exception& ex) {
+        std::cout << "ERROR: " << ex.what() << std::endl;
+        return -EINVAL;
+    }
+    if (index == UINT_MAX)
+        index = captured;
+
+    xclDeviceHandle handle = nullptr;
+    if (!nullHal) {
+        if (index >= xclProbe()) {
+            std::cout << "ERROR: card " << index << " not found" << std::endl;
+            return -ENODEV;
+        }
+        handle = xclOpen(index, nullptr, XCL_QUIET);
+        if (!handle) {
+            std::cout << "ERROR: failed to open card " << index << std::endl;
+            return -ENODEV;
+        }
+        if (!xclbin.empty() && loadXclbin(handle, xclbin)) {
+            xclClose(handle);
+            return -EINVAL;
+        }
+    }
+
+    std::map<uint32_t, op_stats> stats;
+    auto zero = std::chrono::steady_clock::now();
+    {
+        Replayer replayer(handle);
+        for (auto& e : entries) {
+            if (timed)
+                std::this_thread::sleep_until(zero + std::chrono::nanoseconds(e.rec.start));
+            auto start = std::chrono::steady_clock::now();
+            int ret = replayer.issue(e);
+            auto elapsed = std::chrono::steady_clock::now() - start;
+
+            auto& s = stats[e.rec.op];
+            s.count++;
+            if (e.rec.op != XCL_CAPTURE_FREE && e.rec.op != XCL_CAPTURE_EXEC_WAIT)
+                s.bytes += e.rec.size;
+            s.captured_ns += e.rec.duration;
+            s.replay_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+            if (ret < 0)
+                s.errors++;
+        }
+    }
+    auto total = std::chrono::steady_clock::now() - zero;
+
+    if (handle)
+        xclClose(handle);
+
+    uint64_t capturedTotal = entries.empty() ? 0 :
+        entries.back().rec.start + entries.back().rec.duration;
+    std::cout << entries.size() << " calls, captured "
+              << capturedTotal / 1000 << "us, replayed "
+              << std::chrono::duration_cast<std::chrono::microseconds>(total).count()
+              << "us" << (nullHal ? " (null HAL)" : "") << "\n";
+    std::cout << std::left << std::setw(16) << "call" << std::right
+              << std::setw(10) << "count" << std::setw(14) << "bytes"
+              << std::setw(14) << "captured(us)" << std::setw(14) << "replay(us)"
+              << std::setw(8) << "errors" << "\n";
+    for (auto& s : stats) {
+        std::cout << std::left << std::setw(16) << opName(s.first) << std::right
+                  << std::setw(10) << s.second.count
+                  << std::setw(14) << s.second.bytes
+                  << std::setw(14) << s.second.captured_ns / 1000
+                  << std::setw(14) << s.second.replay_ns / 1000
+                  << std::setw(8) << s.second.errors << "\n";
+    }
+    return 0;
+}
@@ -22,6 +22,9 @@
 #include <sstream>
 #include <climits>
 #include <algorithm>
+#include <mutex>
+#include <future>
+#include <iomanip>
 
 #include "xbutil.h"
 #include "shim.h"
@@ -158,6 +161,10 @@ int main(int argc, char *argv[])
     std::string mcsFile1, mcsFile2;
     std::string xclbin;
     size_t blockSize = 0;
+    bool dmaSweep = false;
+    bool dmaJson = false;
+    bool queryAll = false;
+    unsigned dmaThreads = 4;
     bool hot = false;
     int c;
     dd::ddArgs_t ddArgs;
@@ -228,7 +235,12 @@ int main(int argc, char *argv[])
 	{"tracefunnel", no_argument, 0, xcldev::STATUS_UNSUPPORTED},
 	{"monitorfifolite", no_argument, 0, xcldev::STATUS_UNSUPPORTED},
 	{"monitorfifofull", no_argument, 0, xcldev::STATUS_UNSUPPORTED},
-	{"accelmonitor", no_argument, 0, xcldev::STATUS_UNSUPPORTED}
+	{"accelmonitor", no_argument, 0, xcldev::STATUS_UNSUPPORTED},
+	{"sweep", no_argument, 0, xcldev::DMA_SWEEP},
+	{"threads", required_argument, 0, xcldev::DMA_THREADS},
+	{"json", no_argument, 0, xcldev::DMA_JSON},
+	{"all", no_argument, 0, xcldev::QUERY_ALL},
+	{0, 0, 0, 0}
     };
     int long_index;
     const char* short_options = "a:b:c:d:e:f:g:hi:m:n:o:p:r:s:"; //don't add numbers
@@ -285,6 +297,41 @@ int main(int argc, char *argv[])
 	  ipmask |= static_cast<unsigned int>(xcldev::STATUS_SSPM_MASK);
 	  break ;
 	}
+        case xcldev::DMA_SWEEP :
+        case xcldev::DMA_JSON : {
+            //--sweep, --json
+            if (cmd != xcldev::DMATEST) {
+                std::cout << "ERROR: Option '" << long_options[long_index].name << "' cannot be used with command " << cmdname << "\n";
+                return -1;
+            }
+            if (c == xcldev::DMA_SWEEP)
+                dmaSweep = true;
+            else
+                dmaJson = true;
+            break;
+        }
+        case xcldev::QUERY_ALL : {
+            //--all
+            if (cmd != xcldev::QUERY) {
+                std::cout << "ERROR: Option '" << long_options[long_index].name << "' cannot be used with command " << cmdname << "\n";
+                return -1;
+            }
+            queryAll = true;
+            break;
+        }
+        case xcldev::DMA_THREADS : {
+            //--threads
+            if (cmd != xcldev::DMATEST) {
+                std::cout << "ERROR: Option '" << long_options[long_index].name << "' cannot be used with command " << cmdname << "\n";
+                return -1;
+            }
+            dmaThreads = std::atoi(optarg);
+            if (dmaThreads == 0) {
+                std::cout << "ERROR: Value supplied to --threads option is invalid\n";
+                return -1;
+            }
+            break;
+        }
         case xcldev::STATUS_UNSUPPORTED : {
             //Don't give ERROR for as yet unsupported IPs
             std::cout << "INFO: No Status information available for IP: " << long_options[long_index].name << "\n";
@@ -523,9 +570,16 @@ int main(int argc, char *argv[])
         return 0;
     }
 
+    // Opening a card probes it, open all of them concurrently
+    std::vector<std::future<xcldev::device*>> opens;
     for (unsigned i = 0; i < count; i++) {
+        opens.push_back(std::async(std::launch::async, [i] {
+            return new xcldev::device(i, nullptr);
+        }));
+    }
+    for (auto& open : opens) {
         try {
-            deviceVec.emplace_back(new xcldev::device(i, nullptr));
+            deviceVec.emplace_back(open.get());
         } catch (const std::exception& ex) {
             std::cout << ex.what() << std::endl;
         }
@@ -573,7 +627,24 @@ int main(int argc, char *argv[])
     case xcldev::QUERY:
         try
         {
-            result = deviceVec[index]->dump(std::cout);
+            if (queryAll) {
+                // Collect each card's report concurrently, print in card order
+                std::vector<std::future<std::string>> dumps;
+                for (auto& dev : deviceVec) {
+                    const xcldev::device *d = dev.get();
+                    dumps.push_back(std::async(std::launch::async, [d] {
+                        std::stringstream ss;
+                        if (d->dump(ss) != 0)
+                            ss << "ERROR: query failed\n";
+                        return ss.str();
+                    }));
+                }
+                for (size_t i = 0; i < dumps.size(); i++) {
+                    std::cout << "\nCard[" << i << "]:\n" << dumps[i].get();
+                }
+            } else {
+                result = deviceVec[index]->dump(std::cout);
+            }
         }
         catch (...)
         {
@@ -588,7 +659,10 @@ int main(int argc, char *argv[])
         result = deviceVec[index]->run(regionIndex, computeIndex);
         break;
     case xcldev::DMATEST:
-        result = deviceVec[index]->dmatest(blockSize, true);
+        if (dmaSweep)
+            result = deviceVec[index]->dmatestSweep(blockSize, dmaThreads, dmaJson);
+        else
+            result = deviceVec[index]->dmatest(blockSize, true);
         break;
     case xcldev::MEM:
         if (subcmd == xcldev::MEM_READ) {
@@ -641,17 +715,19 @@ void xcldev::printHelp(const std::string& exe)
     std::cout << "Command and option summary:\n";
     std::cout << "  clock   [-d card] [-r region] [-f clock1_freq_MHz] [-g clock2_freq_MHz]\n";
     std::cout << "  dmatest [-d card] [-b [0x]block_size_KB]\n";
+    std::cout << "  dmatest --sweep [-d card] [-b [0x]block_size_KB] [--threads max_threads] [--json]\n";
     std::cout << "  help\n";
     std::cout << "  list\n";
     std::cout << "  mem --read [-d card] [-a [0x]start_addr] [-i size_bytes] [-o output filename]\n";
     std::cout << "  mem --write [-d card] [-a [0x]start_addr] [-i size_bytes] [-e pattern_byte]\n";
     std::cout << "  program [-d card] [-r region] -p xclbin\n";
     std::cout << "  query   [-d card [-r region]]\n";
+    std::cout << "  query   --all\n";
     std::cout << "  reset   [-d card] [-h | -r region]\n";
     std::cout << "  status  [--debug_ip_name]\n";   
     std::cout << "  scan\n";
-    std::cout << "  top [-i seconds]\n";
-    std::cout << "  validate [-d card]\n";
+    std::cout << "  top [-d card] [-i seconds]\n";
+    std::cout << "  validate [-d card] [-q] [--json]\n";
     std::cout << " Requires root privileges:\n";
     std::cout << "  flash   [-d card] -m primary_mcs [-n secondary_mcs] [-o bpi|spi]\n";
     std::cout << "  flash   [-d card] -a <all | dsa> [-t timestamp]\n";
@@ -670,6 +746,8 @@ void xcldev::printHelp(const std::string& exe)
     std::cout << "  " << exe << " program -d 2 -p a.xclbin\n";
     std::cout << "Run DMA test on card 1 with 32 KB blocks of buffer\n";
     std::cout << "  " << exe << " dmatest -d 1 -b 0x2000\n";
+    std::cout << "Benchmark DMA over block sizes 4 KB to 256 MB and 1 to 8 threads on card 0, as JSON\n";
+    std::cout << "  " << exe << " dmatest --sweep --threads 8 --json\n";
     std::cout << "Read 256 bytes from DDR starting at 0x1000 into file read.out\n";
     std::cout << "  " << exe << " mem --read -a 0x1000 -i 256 -o read.out\n";
     std::cout << "  " << "Default values for address is 0x0, size is DDR size and file is memread.out\n";
@@ -684,6 +762,10 @@ void xcldev::printHelp(const std::string& exe)
     std::cout << "  sudo " << exe << " flash scan\n";
     std::cout << "Validate installation on card 1\n";
     std::cout << "  " << exe << " validate -d 1\n";
+    std::cout << "Validate all cards concurrently and report as JSON\n";
+    std::cout << "  " << exe << " validate --json\n";
+    std::cout << "Query all cards\n";
+    std::cout << "  " << exe << " query --all\n";
 }
 
 std::unique_ptr<xcldev::device> xcldev::xclGetDevice(unsigned index)
@@ -725,6 +807,8 @@ static void topPrintUsage(const xcldev::device *dev, xclDeviceUsage& devstat,
     
     dev->m_mem_usage_stringize_dynamics(devstat, devinfo, lines);
 
+    dev->m_cu_usage_stringize_dynamics(lines);
+
     for(auto line:lines){
             printw("%s\n", line.c_str());
     } 
@@ -821,31 +905,34 @@ int xcldev::xclTop(int argc, char *argv[])
 
 const std::string dsaPath("/opt/xilinx/dsa/");
 
-void testCaseProgressReporter(bool *quit)
+void testCaseProgressReporter(bool *quit, std::ostream *ostr)
 {
     int i = 0;
     while (!*quit) {
         if (i != 0 && (i % 5 == 0))
-            std::cout << "." << std::flush;
+            *ostr << "." << std::flush;
         std::this_thread::sleep_for(std::chrono::seconds(1));
         i++;
     }
 }
 
-int runShellCmd(const std::string& cmd, std::string& output)
+int runShellCmd(const std::string& cmd, std::string& output, std::ostream& ostr)
 {
     int ret = 0;
     bool quit = false;
 
     // Kick off progress reporter
-    std::thread t(testCaseProgressReporter, &quit);
-
-    // Run test case
-    setenv("XILINX_XRT", "/opt/xilinx/xrt", 0);
-    setenv("LD_LIBRARY_PATH", "/opt/xilinx/xrt/lib", 1);
+    std::thread t(testCaseProgressReporter, &quit, &ostr);
+
+    // Run test case, environment is set once since cards may run concurrently
+    static std::once_flag envFlag;
+    std::call_once(envFlag, [] {
+        setenv("XILINX_XRT", "/opt/xilinx/xrt", 0);
+        setenv("LD_LIBRARY_PATH", "/opt/xilinx/xrt/lib", 1);
+    });
     std::shared_ptr<FILE> pipe(popen(cmd.c_str(), "r"), pclose);
     if (pipe == nullptr) {
-        std::cout << "ERROR: Failed to run " << cmd << std::endl;
+        output += "ERROR: Failed to run " + cmd;
         ret = -EINVAL;
     }
 
@@ -865,7 +952,7 @@ int runShellCmd(const std::string& cmd, std::string& output)
 }
 
 int xcldev::device::runTestCase(const std::string& exe,
-    const std::string& xclbin, std::string& output)
+    const std::string& xclbin, std::string& output, std::ostream& ostr)
 {
     std::string testCasePath = dsaPath +
         std::string(m_devinfo.mName) + "/test/";
@@ -897,47 +984,49 @@ int xcldev::device::runTestCase(const std::string& exe,
         idxOption = "-d " + std::to_string(m_idx);
 
     std::string cmd = exePath + " " + xclbinPath + " " + idxOption;
-    return runShellCmd(cmd, output);
+    return runShellCmd(cmd, output, ostr);
 }
 
 /*
  * validate
  */
-int xcldev::device::validate(bool quick)
+int xcldev::device::validate(bool quick, std::ostream& ostr, ValidateReport& report)
 {
     std::string output;
     bool testKernelBW = true;
 
     // Check pcie training
-    std::cout << "INFO: Checking PCIE link status: " << std::flush;
+    ostr << "INFO: Checking PCIE link status: " << std::flush;
     if (m_devinfo.mPCIeLinkSpeed != m_devinfo.mPCIeLinkSpeedMax ||
         m_devinfo.mPCIeLinkWidth != m_devinfo.mPCIeLinkWidthMax) {
-        std::cout << "FAILED" << std::endl;
-        std::cout << "WARNING: Card trained to lower spec. "
+        ostr << "FAILED" << std::endl;
+        ostr << "WARNING: Card trained to lower spec. "
             << "Expect: Gen" << m_devinfo.mPCIeLinkSpeedMax << "x"
             << m_devinfo.mPCIeLinkWidthMax
             << ", Current: Gen" << m_devinfo.mPCIeLinkSpeed << "x"
             << m_devinfo.mPCIeLinkWidth
             << std::endl;
         // Non-fatal, continue validating.
+        report.tests.emplace_back("pcie_link", "WARNING");
     }
     else
     {
-        std::cout << "PASSED" << std::endl;
+        ostr << "PASSED" << std::endl;
+        report.tests.emplace_back("pcie_link", "PASSED");
     }
 
     // Run various test cases
 
     // Test verify kernel
-    std::cout << "INFO: Starting verify kernel test: " << std::flush;
+    ostr << "INFO: Starting verify kernel test: " << std::flush;
     int ret = runTestCase(std::string("validate.exe"),
-        std::string("verify.xclbin"), output);
-    std::cout << std::endl;
+        std::string("verify.xclbin"), output, ostr);
+    ostr << std::endl;
     if (ret == -ENOENT) {
         if (m_idx == 0) {
             // Fall back to verify.exe
             ret = runTestCase(std::string("verify.exe"),
-                std::string("verify.xclbin"), output);
+                std::string("verify.xclbin"), output, ostr);
             if (ret == 0) {
                 // Probably testing with old package, skip kernel bandwidth test.
                 testKernelBW = false;
@@ -945,58 +1034,125 @@ int xcldev::device::validate(bool quick)
         }
     }
     if (ret != 0 || output.find("Hello World") == std::string::npos) {
-        std::cout << output << std::endl;
-        std::cout << "ERROR: verify kernel test FAILED" << std::endl;
-        return ret == 0 ? -EINVAL : ret;
+        ostr << output << std::endl;
+        ostr << "ERROR: verify kernel test FAILED" << std::endl;
+        report.tests.emplace_back("verify_kernel", "FAILED");
+        report.result = ret == 0 ? -EINVAL : ret;
+        return report.result;
     }
-    std::cout << "INFO: verify kernel test PASSED" << std::endl;
+    ostr << "INFO: verify kernel test PASSED" << std::endl;
+    report.tests.emplace_back("verify_kernel", "PASSED");
 
     // Skip the rest of test cases for quicker turn around.
-    if (quick)
+    if (quick) {
+        report.tests.emplace_back("dma", "SKIPPED");
+        report.tests.emplace_back("ddr_bandwidth", "SKIPPED");
         return 0;
+    }
 
     // Perform DMA test
-    std::cout << "INFO: Starting DMA test" << std::endl;
-    ret = dmatest(0, false);
+    ostr << "INFO: Starting DMA test" << std::endl;
+    ret = dmatest(0, false, ostr);
     if (ret != 0) {
-        std::cout << "ERROR: DMA test FAILED" << std::endl;
+        ostr << "ERROR: DMA test FAILED" << std::endl;
+        report.tests.emplace_back("dma", "FAILED");
+        report.result = ret;
         return ret;
     }
-    std::cout << "INFO: DMA test PASSED" << std::endl;
+    ostr << "INFO: DMA test PASSED" << std::endl;
+    report.tests.emplace_back("dma", "PASSED");
 
-    if (!testKernelBW)
+    if (!testKernelBW) {
+        report.tests.emplace_back("ddr_bandwidth", "SKIPPED");
         return 0;
+    }
 
 
     // Test kernel bandwidth kernel
-    std::cout << "INFO: Starting DDR bandwidth test: " << std::flush;
+    ostr << "INFO: Starting DDR bandwidth test: " << std::flush;
     ret = runTestCase(std::string("kernel_bw.exe"),
-        std::string("bandwidth.xclbin"), output);
-    std::cout << std::endl;
+        std::string("bandwidth.xclbin"), output, ostr);
+    ostr << std::endl;
     if (ret != 0 || output.find("PASS") == std::string::npos) {
-        std::cout << output << std::endl;
-        std::cout << "ERROR: DDR bandwidth test FAILED" << std::endl;
-        return ret == 0 ? -EINVAL : ret;
+        ostr << output << std::endl;
+        ostr << "ERROR: DDR bandwidth test FAILED" << std::endl;
+        report.tests.emplace_back("ddr_bandwidth", "FAILED");
+        report.result = ret == 0 ? -EINVAL : ret;
+        return report.result;
     }
     // Print out max thruput
     size_t st = output.find("Maximum");
     if (st != std::string::npos) {
         size_t end = output.find("\n", st);
-        std::cout << output.substr(st, end - st) << std::endl;
+        report.maxBandwidth = output.substr(st, end - st);
+        ostr << report.maxBandwidth << std::endl;
     }
-    std::cout << "INFO: DDR bandwidth test PASSED" << std::endl;
+    ostr << "INFO: DDR bandwidth test PASSED" << std::endl;
+    report.tests.emplace_back("ddr_bandwidth", "PASSED");
 
     return 0;
 }
 
+static std::string jsonEscape(const std::string& str)
+{
+    std::stringstream ss;
+    for (unsigned char c : str) {
+        if (c == '"' || c == '\\')
+            ss << '\\' << c;
+        else if (c == '\n')
+            ss << "\\n";
+        else if (c < 0x20)
+            ss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec;
+        else
+            ss << c;
+    }
+    return ss.str();
+}
+
+// Per card state while validating cards concurrently
+struct validateJob {
+    unsigned index;
+    std::string name;
+    std::unique_ptr<xcldev::device> dev;
+    std::stringstream log;
+    xcldev::ValidateReport report;
+};
+
+static void validatePrintJson(const std::vector<std::unique_ptr<validateJob>>& jobs, bool validated)
+{
+    std::cout << "{\n  \"validated\": " << (validated ? "true" : "false")
+              << ",\n  \"cards\": [";
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const validateJob &job = *jobs[i];
+        std::cout << (i ? ",\n" : "\n")
+                  << "    {\"index\": " << job.index
+                  << ", \"name\": \"" << jsonEscape(job.name) << "\""
+                  << ", \"status\": \"" << (job.report.result ? "FAILED" : "PASSED") << "\""
+                  << ", \"error\": " << job.report.result
+                  << ", \"tests\": {";
+        for (size_t t = 0; t < job.report.tests.size(); t++) {
+            std::cout << (t ? ", " : "") << "\"" << job.report.tests[t].first
+                      << "\": \"" << job.report.tests[t].second << "\"";
+        }
+        std::cout << "}, \"max_bandwidth\": \"" << jsonEscape(job.report.maxBandwidth) << "\""
+                  << ", \"log\": \"" << jsonEscape(job.log.str()) << "\"}";
+    }
+    std::cout << "\n  ]\n}\n";
+}
+
 int xcldev::xclValidate(int argc, char *argv[])
 {
     unsigned index = UINT_MAX;
-    const std::string usage("Options: [-d index]");
+    const std::string usage("Options: [-d index] [-q] [--json]");
     int c;
     bool quick = false;
+    bool json = false;
+    static struct option long_options[] = {
+        {"json", no_argument, 0, 'j'},
+        {0, 0, 0, 0}
+    };
 
-    while ((c = getopt(argc, argv, "d:q")) != -1) {
+    while ((c = getopt_long(argc, argv, "d:q", long_options, nullptr)) != -1) {
         switch (c) {
         case 'd': {
             int ret = str2index(optarg, index);
@@ -1007,6 +1163,9 @@ int xcldev::xclValidate(int argc, char *argv[])
         case 'q':
             quick = true;
             break;
+        case 'j':
+            json = true;
+            break;
         default:
             std::cerr << usage << std::endl;
             return -EINVAL;
@@ -1035,29 +1194,80 @@ int xcldev::xclValidate(int argc, char *argv[])
         boards.push_back(index);
     }
 
-    std::cout << "INFO: Found " << boards.size() << " cards" << std::endl;
+    if (!json)
+        std::cout << "INFO: Found " << boards.size() << " cards" << std::endl;
 
-    bool validated = true;
+    // Open all cards up front, each card then validates on its own thread
+    std::vector<std::unique_ptr<validateJob>> jobs;
     for (unsigned i : boards) {
-        std::unique_ptr<device> dev = xclGetDevice(i);
-        if (!dev) {
-            std::cout << "ERROR: Can't open card[" << i << "]" << std::endl;
-            validated = false;
+        std::unique_ptr<validateJob> job(new validateJob);
+        job->index = i;
+        job->dev = xclGetDevice(i);
+        if (!job->dev) {
+            job->log << "ERROR: Can't open card[" << i << "]" << std::endl;
+            job->report.result = -ENODEV;
+        } else {
+            job->name = job->dev->name();
+        }
+        jobs.push_back(std::move(job));
+    }
+
+    // A single card streams its progress as it goes, like before
+    bool interactive = !json && jobs.size() == 1;
+    std::vector<std::thread> workers;
+    for (auto& job : jobs) {
+        if (!job->dev)
             continue;
+        validateJob *j = job.get();
+        std::ostream *ostr = interactive ? &std::cout : &j->log;
+        if (interactive) {
+            std::cout << std::endl << "INFO: Validating card[" << j->index << "]: "
+                << j->name << std::endl;
         }
+        workers.emplace_back([j, ostr, quick] {
+            j->dev->validate(quick, *ostr, j->report);
+        });
+    }
+    if (!json && !interactive)
+        std::cout << "INFO: Validating " << workers.size() << " cards concurrently" << std::endl;
+    for (auto& t : workers)
+        t.join();
 
-        std::cout << std::endl << "INFO: Validating card[" << i << "]: "
-            << dev->name() << std::endl;
+    bool validated = true;
+    for (auto& job : jobs)
+        validated = validated && (job->report.result == 0);
 
-        if (dev->validate(quick) != 0) {
-            validated = false;
-            std::cout << "INFO: Card[" << i << "] failed to validate." << std::endl;
+    if (json) {
+        validatePrintJson(jobs, validated);
+        return validated ? 0 : -EINVAL;
+    }
+
+    for (auto& job : jobs) {
+        if (!interactive || !job->dev) {
+            std::cout << std::endl << "INFO: Validating card[" << job->index << "]: "
+                << job->name << std::endl;
+            std::cout << job->log.str();
+        }
+        if (job->report.result != 0) {
+            std::cout << "INFO: Card[" << job->index << "] failed to validate." << std::endl;
         } else {
-            std::cout << "INFO: Card[" << i << "] validated successfully." << std::endl;
+            std::cout << "INFO: Card[" << job->index << "] validated successfully." << std::endl;
         }
     }
     std::cout << std::endl;
 
+    if (jobs.size() > 1) {
+        std::cout << "INFO: Summary:" << std::endl;
+        for (auto& job : jobs) {
+            std::cout << "  Card[" << job->index << "] "
+                << (job->report.result ? "FAILED" : "PASSED");
+            for (auto& test : job->report.tests)
+                std::cout << " " << test.first << ":" << test.second;
+            std::cout << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
     if (!validated) {
         std::cout << "ERROR: Some cards failed to validate." << std::endl;
         return -EINVAL;
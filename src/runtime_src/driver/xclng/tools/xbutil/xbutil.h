@@ -20,6 +20,7 @@
 
 #include <fstream>
 #include <assert.h>
+#include <algorithm>
 #include <vector>
 #include <map>
 #include <sstream>
@@ -79,7 +80,11 @@ enum subcommand {
     STATUS_SPM,
     STATUS_LAPC,
     STATUS_SSPM,
-    STATUS_UNSUPPORTED
+    STATUS_UNSUPPORTED,
+    DMA_SWEEP,
+    DMA_THREADS,
+    DMA_JSON,
+    QUERY_ALL
 };
 enum statusmask {
     STATUS_NONE_MASK = 0x0,
@@ -128,11 +133,25 @@ static const std::vector<std::pair<std::string, std::string>> flash_types = {
 
 static const std::map<std::string, command> commandTable(map_pairs, map_pairs + sizeof(map_pairs) / sizeof(map_pairs[0]));
 
+// Outcome of validating one card, collected for the aggregated report
+struct ValidateReport {
+    int result = 0;
+    // test name and one of PASSED, FAILED, WARNING or SKIPPED, in run order
+    std::vector<std::pair<std::string, std::string>> tests;
+    std::string maxBandwidth;
+};
+
 class device {
     unsigned int m_idx;
     xclDeviceHandle m_handle;
     xclDeviceInfo2 m_devinfo;
     xclErrorStatus m_errinfo;
+    // Previous per bank DMA traffic sample, rates are reported against it
+    mutable std::vector<std::string> m_memdma_prev;
+    mutable std::chrono::steady_clock::time_point m_memdma_time;
+    // Previous per CU scheduler counters, utilization is reported against it
+    mutable std::vector<std::string> m_custat_prev;
+    mutable std::chrono::steady_clock::time_point m_custat_time;
 
 public:
     int domain() { return pcidev::get_dev(m_idx)->mgmt->domain; }
@@ -601,7 +620,8 @@ public:
                     {MEM_DRAM, "MEM_DRAM"}, {MEM_STREAMING, "MEM_STREAMING"},
                     {MEM_PREALLOCATED_GLOB, "MEM_PREALLOCATED_GLOB"},
                     {MEM_ARE, "MEM_ARE"}, {MEM_HBM, "MEM_HBM"},
-                    {MEM_BRAM, "MEM_BRAM"}, {MEM_URAM, "MEM_URAM"}
+                    {MEM_BRAM, "MEM_BRAM"}, {MEM_URAM, "MEM_URAM"},
+                    {MEM_HOST, "MEM_HOST"}
                 };
                 auto search = my_map.find((MEM_TYPE)map->m_mem_data[i].m_type );
                 str = search->second;
@@ -622,6 +642,83 @@ public:
             ss << std::setw(8) << std::dec << devstat.ddrBOAllocated[i] << "\n";
         }
 
+        // Free memory fragmentation, one line per bank:
+        // free largest holes followed by free block histogram
+        std::vector<std::string> frag;
+        pcidev::get_dev(m_idx)->user->sysfs_get("", "memfrag_raw", errmsg, frag);
+        if (errmsg.empty() && !frag.empty()) {
+            ss << "\nMem Fragmentation" << "\n";
+            ss << std::setw(16) << "Tag" << std::setw(12) << "Free"
+                << std::setw(12) << "Largest" << std::setw(8) << "Holes"
+                << "<64K/<1M/<16M/<256M/<4G/>=4G" << "\n";
+            for (unsigned i = 0; i < std::min<size_t>(numDDR, frag.size()); i++) {
+                if (map->m_mem_data[i].m_type == MEM_STREAMING ||
+                    !map->m_mem_data[i].m_used)
+                    continue;
+                std::stringstream fs(frag[i]);
+                uint64_t freeSize = 0, largest = 0;
+                unsigned holes = 0, bucket = 0;
+                fs >> freeSize >> largest >> holes;
+                ss << " [" << i << "] " <<
+                    std::setw(16 - (std::to_string(i).length()) - 4) << std::left
+                    << map->m_mem_data[i].m_tag;
+                ss << std::setw(12) << unitConvert(freeSize)
+                    << std::setw(12) << unitConvert(largest)
+                    << std::setw(8) << std::dec << holes;
+                std::string sep;
+                while (fs >> bucket) {
+                    ss << sep << bucket;
+                    sep = "/";
+                }
+                ss << "\n";
+            }
+        }
+
+        // DMA traffic, one line per bank: h2c bytes and ops, c2h bytes
+        // and ops.  Repeated calls, as by 'xbutil top', also show rates.
+        std::vector<std::string> memdma;
+        pcidev::get_dev(m_idx)->user->sysfs_get("", "memdma_raw", errmsg, memdma);
+        if (errmsg.empty() && !memdma.empty()) {
+            auto now = std::chrono::steady_clock::now();
+            double secs = std::chrono::duration<double>(now - m_memdma_time).count();
+            bool rates = m_memdma_prev.size() == memdma.size() && secs > 0;
+            ss << "\nMem DMA Traffic" << "\n";
+            ss << std::setw(16) << "Tag" << std::setw(12) << "H2C"
+                << std::setw(10) << "H2C ops" << std::setw(12) << "C2H"
+                << std::setw(10) << "C2H ops";
+            if (rates)
+                ss << std::setw(12) << "H2C/s" << std::setw(12) << "C2H/s";
+            ss << "\n";
+            for (unsigned i = 0; i < std::min<size_t>(numDDR, memdma.size()); i++) {
+                if (map->m_mem_data[i].m_type == MEM_STREAMING ||
+                    !map->m_mem_data[i].m_used)
+                    continue;
+                uint64_t h2c = 0, h2cOps = 0, c2h = 0, c2hOps = 0;
+                std::stringstream ds(memdma[i]);
+                ds >> h2c >> h2cOps >> c2h >> c2hOps;
+                ss << " [" << i << "] " <<
+                    std::setw(16 - (std::to_string(i).length()) - 4) << std::left
+                    << map->m_mem_data[i].m_tag;
+                ss << std::setw(12) << unitConvert(h2c)
+                    << std::setw(10) << std::dec << h2cOps
+                    << std::setw(12) << unitConvert(c2h)
+                    << std::setw(10) << c2hOps;
+                if (rates) {
+                    uint64_t prevH2c = 0, prevC2h = 0, ops = 0;
+                    std::stringstream ps(m_memdma_prev[i]);
+                    ps >> prevH2c >> ops >> prevC2h;
+                    // counters restart when an xclbin is loaded
+                    size_t h2cRate = h2c >= prevH2c ? (h2c - prevH2c) / secs : 0;
+                    size_t c2hRate = c2h >= prevC2h ? (c2h - prevC2h) / secs : 0;
+                    ss << std::setw(12) << unitConvert(h2cRate)
+                        << std::setw(12) << unitConvert(c2hRate);
+                }
+                ss << "\n";
+            }
+            m_memdma_prev = memdma;
+            m_memdma_time = now;
+        }
+
         ss << "\nTotal DMA Transfer Metrics:" << "\n";
         for (unsigned i = 0; i < 2; i++) {
             ss << "  Chan[" << i << "].h2c:  " << unitConvert(devstat.h2c[i]) << "\n";
@@ -630,6 +727,78 @@ public:
         lines.push_back(ss.str());
     }
 
+    /*
+     * CU utilization from the scheduler counters in 'kds_custat', one line
+     * per CU: running commands, completed commands and busy time in usec.
+     * No profiling IP is needed and the CUs are not accessed.  Repeated
+     * calls, as by 'xbutil top', also show completion rate and the share
+     * of the interval a CU had a command running.
+     */
+    void m_cu_usage_stringize_dynamics(std::vector<std::string> &lines) const
+    {
+        std::stringstream ss;
+        std::string errmsg;
+        std::vector<std::string> custat;
+
+        pcidev::get_dev(m_idx)->user->sysfs_get(
+            "mb_scheduler", "kds_custat", errmsg, custat);
+        if (!errmsg.empty() || custat.empty())
+            return;
+
+        // Both ip_layout and scheduler CU indices are sorted by base address
+        std::vector<ip_data> computeUnits;
+        if (getComputeUnits(computeUnits) == 0) {
+            computeUnits.erase(std::remove_if(computeUnits.begin(), computeUnits.end(),
+                [](const ip_data& ip) { return ip.m_type != IP_KERNEL; }),
+                computeUnits.end());
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        double secs = std::chrono::duration<double>(now - m_custat_time).count();
+        bool rates = m_custat_prev.size() == custat.size() && secs > 0;
+
+        ss << "Compute Unit Usage" << "\n";
+        ss << std::left << std::setw(32) << "CU" << std::setw(8) << "Status"
+            << std::setw(12) << "Completed";
+        if (rates)
+            ss << std::setw(12) << "Runs/s" << std::setw(8) << "Busy";
+        ss << "\n";
+
+        for (unsigned i = 0; i < custat.size(); i++) {
+            unsigned idx = 0, running = 0;
+            uint64_t usage = 0, busyUs = 0;
+            std::stringstream cs(custat[i]);
+            cs >> idx >> running >> usage >> busyUs;
+
+            std::string name = idx < computeUnits.size() ?
+                reinterpret_cast<const char *>(computeUnits[idx].m_name) : "";
+            std::string cu = " [" + std::to_string(idx) + "] " + name;
+            ss << std::setw(32) << cu.substr(0, 31)
+                << std::setw(8) << (running ? "BUSY" : "IDLE")
+                << std::setw(12) << std::dec << usage;
+            if (rates) {
+                unsigned prevIdx = 0, prevRunning = 0;
+                uint64_t prevUsage = 0, prevBusyUs = 0;
+                std::stringstream ps(m_custat_prev[i]);
+                ps >> prevIdx >> prevRunning >> prevUsage >> prevBusyUs;
+                // counters restart when an xclbin is loaded
+                uint64_t runs = usage >= prevUsage ? usage - prevUsage : 0;
+                uint64_t busy = busyUs >= prevBusyUs ? busyUs - prevBusyUs : 0;
+                // overlapping commands of a CU can add up to more than 100%
+                double pct = std::min(100.0, busy / (secs * 1e4));
+                ss << std::setw(12) << static_cast<uint64_t>(runs / secs)
+                    << std::fixed << std::setprecision(1) << pct << "%";
+                ss.unsetf(std::ios::fixed);
+                ss << std::setprecision(6);
+            }
+            ss << "\n";
+        }
+        m_custat_prev = custat;
+        m_custat_time = now;
+
+        lines.push_back(ss.str());
+    }
+
     void m_stream_usage_stringize_dynamics( const xclDeviceInfo2& m_devinfo,
         std::vector<std::string> &lines) const
     {
@@ -779,8 +948,8 @@ public:
         if( getComputeUnits( computeUnits ) < 0 ) {
             ostr << "WARNING: 'ip_layout' invalid. Has the bitstream been loaded? See 'xbutil program'.\n";
         } else {
+            int cuCnt = 0;
             for( unsigned int i = 0; i < computeUnits.size(); i++ ) {
-                static int cuCnt = 0;
                 if( computeUnits.at( i ).m_type == IP_KERNEL ) {
                     unsigned statusBuf;
                     xclRead(m_handle, XCL_ADDR_KERNEL_CTRL, computeUnits.at( i ).m_base_address, &statusBuf, 4);
@@ -907,12 +1076,12 @@ public:
      *
      * TODO: Refactor this function to be much shorter.
      */
-    int dmatest(size_t blockSize, bool verbose) {
+    int dmatest(size_t blockSize, bool verbose, std::ostream& ostr = std::cout) {
         if (blockSize == 0)
             blockSize = 256 * 1024 * 1024; // Default block size
 
         if (verbose)
-            std::cout << "Total DDR size: " << m_devinfo.mDDRSize/(1024 * 1024) << " MB\n";
+            ostr << "Total DDR size: " << m_devinfo.mDDRSize/(1024 * 1024) << " MB\n";
 
         bool isAREDevice = false;
         if (strstr(m_devinfo.mName, "-xare")) {//This is ARE device
@@ -931,20 +1100,20 @@ public:
         pcidev::get_dev(m_idx)->user->sysfs_get(
             "", "mem_topology", errmsg, buf);
         if (!errmsg.empty()) {
-            std::cout << errmsg << std::endl;
+            ostr << errmsg << std::endl;
             return -EINVAL;
         }
         const mem_topology *map = (mem_topology *)buf.data();
 
         if(buf.empty() || map->m_count == 0) {
-            std::cout << "WARNING: 'mem_topology' invalid, "
+            ostr << "WARNING: 'mem_topology' invalid, "
                 << "unable to perform DMA Test. Has the bitstream been loaded? "
                 << "See 'xbutil program'." << std::endl;
             return -EINVAL;
         }
 
         if (verbose)
-            std::cout << "Reporting from mem_topology:" << std::endl;
+            ostr << "Reporting from mem_topology:" << std::endl;
 
         for(int32_t i = 0; i < map->m_count; i++) {
             if(map->m_mem_data[i].m_type == MEM_STREAMING)
@@ -952,7 +1121,7 @@ public:
 
             if(map->m_mem_data[i].m_used) {
                 if (verbose) {
-                    std::cout << "Data Validity & DMA Test on "
+                    ostr << "Data Validity & DMA Test on "
                         << map->m_mem_data[i].m_tag << "\n";
                 }
                 addr = map->m_mem_data[i].m_base_address;
@@ -966,7 +1135,7 @@ public:
                         return result;
                 }
                 DMARunner runner( m_handle, blockSize, i);
-                result = runner.run();
+                result = runner.run(ostr);
             }
         }
 
@@ -1000,13 +1169,118 @@ public:
             t2 = Clock::now();
             auto timeDDR = std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count();
             long delayPerHop = (timeARE - timeDDR) / (numIteration * numHops);
-            std::cout << "Averaging ARE hardware latency over " << numIteration * numHops << " hops\n";
-            std::cout << "Latency per ARE hop for 128KB: " << delayPerHop << " ns\n";
-            std::cout << "Total latency over ARE: " << (timeARE - timeDDR) << " ns\n";
+            ostr << "Averaging ARE hardware latency over " << numIteration * numHops << " hops\n";
+            ostr << "Latency per ARE hop for 128KB: " << delayPerHop << " ns\n";
+            ostr << "Total latency over ARE: " << (timeARE - timeDDR) << " ns\n";
         }
         return result;
     }
 
+    /*
+     * dmatest --sweep
+     *
+     * Benchmark matrix over used banks, device and userptr BOs, block sizes,
+     * thread counts and directions.
+     */
+    int dmatestSweep(size_t blockSize, unsigned maxThreads, bool json) {
+        std::string errmsg;
+        std::vector<char> buf;
+
+        pcidev::get_dev(m_idx)->user->sysfs_get(
+            "", "mem_topology", errmsg, buf);
+        if (!errmsg.empty()) {
+            std::cout << errmsg << std::endl;
+            return -EINVAL;
+        }
+        const mem_topology *map = (mem_topology *)buf.data();
+        if(buf.empty() || map->m_count == 0) {
+            std::cout << "WARNING: 'mem_topology' invalid, "
+                << "unable to perform DMA Test. Has the bitstream been loaded? "
+                << "See 'xbutil program'." << std::endl;
+            return -EINVAL;
+        }
+
+        std::vector<size_t> sizes;
+        if (blockSize)
+            sizes.push_back(blockSize);
+        else
+            for (size_t sz = 4 * 1024; sz <= 256 * 1024 * 1024; sz *= 4)
+                sizes.push_back(sz);
+        std::vector<unsigned> threadCounts;
+        for (unsigned t = 1; t < maxThreads; t *= 2)
+            threadCounts.push_back(t);
+        threadCounts.push_back(maxThreads);
+
+        std::vector<DMASweepResult> results;
+        for (int32_t i = 0; i < map->m_count; i++) {
+            if (map->m_mem_data[i].m_type == MEM_STREAMING || !map->m_mem_data[i].m_used)
+                continue;
+            for (bool userPtr : {false, true}) {
+                for (size_t sz : sizes) {
+                    // Enough transfers for percentiles, bounded by 512 MB per run
+                    size_t count = std::max<size_t>(maxThreads,
+                        std::min<size_t>(1024, 0x20000000 / sz));
+                    DMASweep sweep(m_handle, sz, i, userPtr, count);
+                    if (sweep.count() == 0) {
+                        std::cout << "WARNING: Unable to allocate " << sz
+                                  << " byte BOs on " << map->m_mem_data[i].m_tag << "\n";
+                        continue;
+                    }
+                    for (unsigned t : threadCounts) {
+                        for (auto dir : {DMASweep::H2D, DMASweep::D2H, DMASweep::BIDIR}) {
+                            DMASweepResult res;
+                            int result = sweep.run(t, dir, res);
+                            if (result)
+                                return result;
+                            results.push_back(res);
+                        }
+                    }
+                }
+            }
+        }
+
+        std::stringstream link;
+        link << "GEN " << m_devinfo.mPCIeLinkSpeed << "x" << m_devinfo.mPCIeLinkWidth;
+        if (json) {
+            std::cout << "{\n  \"pcie_link\": \"" << link.str() << "\",\n  \"results\": [";
+            for (size_t i = 0; i < results.size(); i++) {
+                const DMASweepResult &r = results[i];
+                std::cout << (i ? ",\n" : "\n")
+                          << "    {\"bank\": \"" << map->m_mem_data[r.bank].m_tag << "\""
+                          << ", \"bo\": \"" << (r.userPtr ? "userptr" : "device") << "\""
+                          << ", \"block_size\": " << r.blockSize
+                          << ", \"threads\": " << r.threads
+                          << ", \"dir\": \"" << r.dir << "\""
+                          << ", \"transfers\": " << r.transfers
+                          << ", \"mbps\": " << r.rateMBps
+                          << ", \"lat_p50_us\": " << r.latencyUs[0]
+                          << ", \"lat_p90_us\": " << r.latencyUs[1]
+                          << ", \"lat_p99_us\": " << r.latencyUs[2]
+                          << ", \"cpu_pct\": " << r.cpuPercent << "}";
+            }
+            std::cout << "\n  ]\n}\n";
+            return 0;
+        }
+
+        std::cout << "PCIe link: " << link.str() << "\n";
+        std::cout << std::left << std::setw(16) << "Bank" << std::setw(9) << "BO"
+                  << std::right << std::setw(11) << "Block(B)" << std::setw(8) << "Threads"
+                  << std::setw(7) << "Dir" << std::setw(11) << "MB/s"
+                  << std::setw(11) << "p50(us)" << std::setw(11) << "p90(us)"
+                  << std::setw(11) << "p99(us)" << std::setw(8) << "CPU%" << "\n";
+        for (const DMASweepResult &r : results) {
+            std::cout << std::left << std::setw(16) << map->m_mem_data[r.bank].m_tag
+                      << std::setw(9) << (r.userPtr ? "userptr" : "device")
+                      << std::right << std::setw(11) << r.blockSize << std::setw(8) << r.threads
+                      << std::setw(7) << r.dir << std::fixed << std::setprecision(1)
+                      << std::setw(11) << r.rateMBps << std::setw(11) << r.latencyUs[0]
+                      << std::setw(11) << r.latencyUs[1] << std::setw(11) << r.latencyUs[2]
+                      << std::setw(8) << r.cpuPercent << "\n";
+            std::cout.unsetf(std::ios::floatfield);
+        }
+        return 0;
+    }
+
     int memread(std::string aFilename, unsigned long long aStartAddr = 0, unsigned long long aSize = 0) {
         if (strstr(m_devinfo.mName, "-xare")) {//This is ARE device
           if (aStartAddr > m_devinfo.mDDRSize) {
@@ -1169,14 +1443,15 @@ public:
         return xclGetDeviceInfo2(m_handle, &devinfo);
     }
 
-    int validate(bool quick);
+    // Messages go to ostr so that cards can be validated concurrently
+    int validate(bool quick, std::ostream& ostr, ValidateReport& report);
 
 private:
     // Run a test case as <exe> <xclbin> [-d index] on this device and collect
-    // all output from the run into "output"
+    // all output from the run into "output", progress is reported to ostr
     // Note: exe should assume index to be 0 without -d
     int runTestCase(const std::string& exe, const std::string& xclbin,
-        std::string& output);
+        std::string& output, std::ostream& ostr);
 };
 
 void printHelp(const std::string& exe);
@@ -365,7 +365,8 @@ public:
                          {MEM_DRAM, "MEM_DRAM"}, {MEM_STREAMING, "MEM_STREAMING"},
                          {MEM_PREALLOCATED_GLOB, "MEM_PREALLOCATED_GLOB"},
                          {MEM_ARE, "MEM_ARE"}, {MEM_HBM, "MEM_HBM"},
-                         {MEM_BRAM, "MEM_BRAM"}, {MEM_URAM, "MEM_URAM"} };
+                         {MEM_BRAM, "MEM_BRAM"}, {MEM_URAM, "MEM_URAM"},
+                         {MEM_HOST, "MEM_HOST"} };
                     auto search = my_map.find( (MEM_TYPE)map->m_mem_data[ i ].m_type );
                     str = search->second;
                 }
@@ -31,6 +31,9 @@
 #ifdef INTERNAL_TESTING
 #define ACCELERATOR_BAR        0
 #define MMAP_SIZE_USER         0x400000
+#else
+/* AppPF BAR0 (sh_cl_ocl bus) is 32 MB in F1 shell */
+#define APP_PF_BAR0_SIZE       0x2000000
 #endif
 
 /* Aligning access to FPGA DRAM space to 4096 Byte */
@@ -196,41 +199,15 @@ namespace awsbwhal {
      * all offsets are relative to the base address available in AppPF BAR4
      * SDAcell XCL_ADDR_SPACE_DEVICE_RAM enum maps to AwsXcl::ocl_global_mem_bar, which is the
      * handle for AppPF BAR4
+     * XCL_ADDR_SPACE_DEVICE_RAM is accessed by DMA through the xocl driver which handles
+     * unaligned offset and size, so no read back of the enclosing aligned block is needed
      */
     size_t AwsXcl::xclReadModifyWrite(uint64_t offset, const void *hostBuf, size_t size) {
         if (mLogStream.is_open()) {
             mLogStream << __func__ << ", " << std::this_thread::get_id() << ", "
                        << offset << ", " << hostBuf << ", " << size << std::endl;
         }
-#if ((GCC_VERSION >= 40800) && !defined(__PPC64__))
-        alignas(DDR_BUFFER_ALIGNMENT) char buffer[DDR_BUFFER_ALIGNMENT];
-#else
-        AlignedAllocator<char> alignedBuffer(DDR_BUFFER_ALIGNMENT, DDR_BUFFER_ALIGNMENT);
-        char* buffer = alignedBuffer.getBuffer();
-#endif
-
-        const size_t mod_size = offset % DDR_BUFFER_ALIGNMENT;
-        // Read back one full aligned block starting from preceding aligned address
-        const uint64_t mod_offset = offset - mod_size;
-        if (xclRead(XCL_ADDR_SPACE_DEVICE_RAM, mod_offset, buffer, DDR_BUFFER_ALIGNMENT) != DDR_BUFFER_ALIGNMENT)
-            return -1;
-
-        // Update the local copy of buffer with user requested data
-        const size_t copy_size = (size + mod_size > DDR_BUFFER_ALIGNMENT) ? DDR_BUFFER_ALIGNMENT - mod_size : size;
-        std::memcpy(buffer + mod_size, hostBuf, copy_size);
-
-        // Write back the updated aligned block
-        if (xclWrite(XCL_ADDR_SPACE_DEVICE_RAM, mod_offset, buffer, DDR_BUFFER_ALIGNMENT) != DDR_BUFFER_ALIGNMENT)
-            return -1;
-
-        // Write any remaining blocks over DDR_BUFFER_ALIGNMENT size
-        if (size + mod_size > DDR_BUFFER_ALIGNMENT) {
-            size_t write_size = xclWrite(XCL_ADDR_SPACE_DEVICE_RAM, mod_offset + DDR_BUFFER_ALIGNMENT,
-                                         (const char *)hostBuf + copy_size, size - copy_size);
-            if (write_size != (size - copy_size))
-                return -1;
-        }
-        return size;
+        return xclWrite(XCL_ADDR_SPACE_DEVICE_RAM, offset, hostBuf, size);
     }
 
     /* Accessing F1 FPGA memory space mapped through AppPF PCIe BARs
@@ -249,6 +226,12 @@ namespace awsbwhal {
 
         switch (space) {
 
+        /* Bulk transfers go through the DMA engine, not BAR copies */
+        case XCL_ADDR_SPACE_DEVICE_RAM:
+        {
+            ssize_t result = xclUnmgdPwrite(0, hostBuf, size, offset);
+            return (result < 0) ? -1 : size;
+        }
         /* Current release now includes performance monitors */
         case XCL_ADDR_SPACE_DEVICE_PERFMON:
         {
@@ -301,6 +284,11 @@ namespace awsbwhal {
         }
 
         switch (space) {
+        case XCL_ADDR_SPACE_DEVICE_RAM:
+        {
+            ssize_t result = xclUnmgdPread(0, hostBuf, size, offset);
+            return (result < 0) ? -1 : size;
+        }
         case XCL_ADDR_SPACE_DEVICE_PERFMON:
         {
 #ifdef	INTERNAL_TESTING
@@ -501,6 +489,7 @@ namespace awsbwhal {
             close(mMgtHandle);
 #else
 //#       error "INTERNAL_TESTING macro disabled. AMZN code goes here. "
+        mKernelBarMap = nullptr;
         if (ocl_kernel_bar >=0)
             fpga_pci_detach(ocl_kernel_bar);
         if (ocl_global_mem_bar>=0)
@@ -565,6 +554,7 @@ namespace awsbwhal {
         ocl_kernel_bar = -1;
         ocl_global_mem_bar = -1;
         sda_mgmt_bar = -1;
+        mKernelBarMap = nullptr;
 
         if (xclGetDeviceInfo2(&mDeviceInfo)) {
             std::cout << "ERROR AwsXcl: DeviceInfo failed for slot# " << std::dec << slot_id << std::endl;
@@ -584,6 +574,13 @@ namespace awsbwhal {
                         ocl_global_mem_bar = -1;
                         sda_mgmt_bar = -1;
                         std::cout << "ERROR AwsXcl: PCI mgmt bar attach failed for slot# " << std::dec << slot_id << std::endl;
+        } else {
+            // Map kernel bar once so register access is a plain load/store
+            // instead of a library call per word.  Fall back to peek/poke
+            // if the bar cannot be mapped.
+            void *addr = nullptr;
+            if (fpga_pci_get_address(ocl_kernel_bar, 0, APP_PF_BAR0_SIZE, &addr) == 0)
+                mKernelBarMap = static_cast<volatile uint32_t *>(addr);
         }
 #endif
 
@@ -667,6 +664,18 @@ namespace awsbwhal {
         }
         }
 
+#ifndef INTERNAL_TESTING
+        // Contiguous access through the persistent mapping.  The bus only
+        // supports 32-bit accesses, so copy word by word rather than memcpy
+        if (mKernelBarMap && offset % 4 == 0 && length % 4 == 0 && offset + length <= APP_PF_BAR0_SIZE) {
+            volatile uint32_t *src = mKernelBarMap + offset / 4;
+            uint32_t *dst = (uint32_t *)qBuf;
+            for (unsigned long long i = 0; i < length / 4; i++)
+                dst[i] = src[i];
+            return 0;
+        }
+#endif
+
         while (length >= 4) {
 #ifdef INTERNAL_TESTING
             *(unsigned *)qBuf = *(unsigned *)(mem + offset);
@@ -717,6 +726,16 @@ namespace awsbwhal {
         }
         }
 
+#ifndef INTERNAL_TESTING
+        if (mKernelBarMap && offset % 4 == 0 && length % 4 == 0 && offset + length <= APP_PF_BAR0_SIZE) {
+            volatile uint32_t *dst = mKernelBarMap + offset / 4;
+            const uint32_t *src = (const uint32_t *)qBuf;
+            for (unsigned long long i = 0; i < length / 4; i++)
+                dst[i] = src[i];
+            return 0;
+        }
+#endif
+
         while (length >= 4) {
 #ifdef INTERNAL_TESTING
             *(unsigned *)(mem + offset) = *(unsigned *)qBuf;
@@ -788,6 +807,7 @@ namespace awsbwhal {
     int AwsXcl::xclGetDeviceInfo2(xclDeviceInfo2 *info)
     {
         std::memset(info, 0, sizeof(xclDeviceInfo2));
+        info->mNumaNode = -1;
         info->mMagic = 0X586C0C6C;
         info->mHALMajorVersion = XCLHAL_MAJOR_VER;
         info->mHALMajorVersion = XCLHAL_MINOR_VER;
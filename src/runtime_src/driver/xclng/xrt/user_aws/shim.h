@@ -353,6 +353,7 @@ public:
         pci_bar_handle_t ocl_kernel_bar;     // AppPF BAR0 for OpenCL kernels
         pci_bar_handle_t sda_mgmt_bar;       // MgmtPF BAR4, for SDAccel Perf mon etc
         pci_bar_handle_t ocl_global_mem_bar; // AppPF BAR4
+        volatile uint32_t *mKernelBarMap;    // AppPF BAR0 mapping, nullptr if not mapped
 #endif
         uint32_t mMemoryProfilingNumberSlots;
         uint32_t mAccelProfilingNumberSlots;
@@ -19,11 +19,14 @@
 #ifndef DMATEST_H
 #define DMATEST_H
 
+#include <algorithm>
 #include <chrono>
 #include <future>
 #include <vector>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <sys/resource.h>
 
 #include "driver/include/xclhal2.h"
 
@@ -97,7 +100,7 @@ namespace xcldev {
                 xclFreeBO(mHandle, i);
         }
 
-        int run() {
+        int run(std::ostream& ostr = std::cout) {
             char *buf = new char[mSize];
             std::memset(buf, 'x', mSize);
 
@@ -116,7 +119,7 @@ namespace xcldev {
             double rate = (mBOList.size() * mSize)/0x100000; // MB
             rate /= timer_stop;
             rate *= 1000000; // s
-            std::cout << "Host -> PCIe -> FPGA write bandwidth = " << rate << " MB/s\n";
+            ostr << "Host -> PCIe -> FPGA write bandwidth = " << rate << " MB/s\n";
 
             //Clear out the host buffer
             std::memset(buf, 0, mSize);
@@ -126,7 +129,7 @@ namespace xcldev {
             rate = (mBOList.size() * mSize)/0x100000; // MB
             rate /= timer_stop;
             rate *= 1000000; //
-            std::cout << "Host <- PCIe <- FPGA read bandwidth = " << rate << " MB/s\n";
+            ostr << "Host <- PCIe <- FPGA read bandwidth = " << rate << " MB/s\n";
 
             // data integrity check: compare with initialized value 'x'
             for (auto i : mBOList) {
@@ -135,7 +138,7 @@ namespace xcldev {
             for (unsigned int i = 0; i < mSize; i++) {
                 if (buf[ i ] != 'x') {
                     delete [] buf;
-                    std::cout << "DMA Test data integrity check failed.\n";
+                    ostr << "DMA Test data integrity check failed.\n";
                     return -1;
                 }
             }
@@ -143,6 +146,142 @@ namespace xcldev {
             return result;
         }
     };
+
+    /*
+     * One cell of the DMA benchmark matrix
+     */
+    struct DMASweepResult {
+        unsigned bank;
+        bool userPtr;
+        size_t blockSize;
+        unsigned threads;
+        const char *dir;        // "h2d", "d2h" or "bidir"
+        size_t transfers;
+        double rateMBps;
+        double latencyUs[3];    // 50th, 90th and 99th percentile per transfer
+        double cpuPercent;      // of one core, process wide
+    };
+
+    /*
+     * Measures DMA over a set of equally sized BOs on one bank. The BOs are
+     * split between the threads and every thread syncs its share once.
+     * Bidirectional runs sync to the device from half of the threads and
+     * from the device on the other half at the same time.
+     */
+    class DMASweep {
+        xclDeviceHandle mHandle;
+        size_t mSize;
+        unsigned mBank;
+        bool mUserPtr;
+        std::vector<unsigned> mBOList;
+        std::vector<void *> mHostBufs;
+
+        static double usec(const rusage &r) {
+            return r.ru_utime.tv_sec * 1e6 + r.ru_utime.tv_usec +
+                   r.ru_stime.tv_sec * 1e6 + r.ru_stime.tv_usec;
+        }
+
+        int runWorker(size_t b, size_t e, xclBOSyncDirection dir,
+                      std::vector<double> *latency) {
+            for (; b < e; ++b) {
+                Timer timer;
+                int result = xclSyncBO(mHandle, mBOList[b], dir, mSize, 0);
+                if (result != 0)
+                    return result;
+                latency->push_back(timer.stop());
+            }
+            return 0;
+        }
+
+    public:
+        enum Direction { H2D, D2H, BIDIR };
+
+        DMASweep(xclDeviceHandle handle, size_t size, unsigned bank,
+                 bool userPtr, size_t count)
+            : mHandle(handle), mSize(size), mBank(bank), mUserPtr(userPtr) {
+            for (size_t i = 0; i < count; i++) {
+                unsigned bo;
+                if (mUserPtr) {
+                    void *buf = nullptr;
+                    if (posix_memalign(&buf, 4096, mSize))
+                        break;
+                    bo = xclAllocUserPtrBO(mHandle, buf, mSize, mBank);
+                    if (bo == 0xffffffff) {
+                        free(buf);
+                        break;
+                    }
+                    mHostBufs.push_back(buf);
+                }
+                else {
+                    bo = xclAllocBO(mHandle, mSize, XCL_BO_DEVICE_RAM, mBank);
+                    if (bo == 0xffffffff)
+                        break;
+                }
+                mBOList.push_back(bo);
+            }
+        }
+
+        ~DMASweep() {
+            for (auto i : mBOList)
+                xclFreeBO(mHandle, i);
+            for (auto i : mHostBufs)
+                free(i);
+        }
+
+        size_t count() const {
+            return mBOList.size();
+        }
+
+        int run(unsigned threads, Direction dir, DMASweepResult &res) {
+            if (dir == BIDIR && threads < 2)
+                threads = 2;
+            if (threads > mBOList.size())
+                threads = mBOList.size();
+            if (threads == 0)
+                return -1;
+
+            std::vector<std::vector<double>> latency(threads);
+            std::vector<std::future<int>> futures;
+            rusage usageStart, usageEnd;
+            getrusage(RUSAGE_SELF, &usageStart);
+            Timer timer;
+            for (unsigned t = 0; t < threads; t++) {
+                size_t b = mBOList.size() * t / threads;
+                size_t e = mBOList.size() * (t + 1) / threads;
+                xclBOSyncDirection d = XCL_BO_SYNC_BO_TO_DEVICE;
+                if (dir == D2H || (dir == BIDIR && (t & 1)))
+                    d = XCL_BO_SYNC_BO_FROM_DEVICE;
+                futures.push_back(std::async(std::launch::async, &DMASweep::runWorker,
+                                             this, b, e, d, &latency[t]));
+            }
+            int result = 0;
+            for (auto &f : futures)
+                result += f.get();
+            double elapsed = timer.stop();
+            getrusage(RUSAGE_SELF, &usageEnd);
+            if (result)
+                return result;
+
+            std::vector<double> all;
+            for (auto &l : latency)
+                all.insert(all.end(), l.begin(), l.end());
+            std::sort(all.begin(), all.end());
+
+            static const char *dirNames[] = {"h2d", "d2h", "bidir"};
+            static const double percentiles[] = {0.50, 0.90, 0.99};
+            res.bank = mBank;
+            res.userPtr = mUserPtr;
+            res.blockSize = mSize;
+            res.threads = threads;
+            res.dir = dirNames[dir];
+            res.transfers = all.size();
+            res.rateMBps = elapsed ? (all.size() * (double)mSize / 0x100000) / (elapsed / 1000000) : 0;
+            for (int i = 0; i < 3; i++)
+                res.latencyUs[i] = all[(size_t)(percentiles[i] * (all.size() - 1))];
+            res.cpuPercent = elapsed ? 100 * (usec(usageEnd) - usec(usageStart)) / elapsed : 0;
+            return 0;
+        }
+    };
 }
 
 #endif /* DMATEST_H */
@@ -28,6 +28,12 @@
 #include <string>
 #include <algorithm>
 #include <numeric>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "dmatest.h"
 
@@ -85,7 +91,9 @@ namespace xcldev {
         ifs.read( buffer, buf_size ); // TODO: read entry by entry instead of entire mem_topology struct.
         mem_topology *map = (mem_topology *)buffer;
         for( int i = 0; i < map->m_count; i++ ) {
-            if( map->m_mem_data[i].m_used && map->m_mem_data[i].m_type != MEM_STREAMING ) {
+            // host bank is pinned host memory, not reachable by the DMA engine
+            if( map->m_mem_data[i].m_used && map->m_mem_data[i].m_type != MEM_STREAMING
+                && map->m_mem_data[i].m_type != MEM_HOST ) {
                 aBanks.emplace_back( map->m_mem_data[i].m_base_address, map->m_mem_data[i].m_size*1024, i );
             }
         }
@@ -97,44 +105,186 @@ namespace xcldev {
     }
 
     /*
-     * readBank()
-     *
-     * Read from specified address, specified size within a bank
-     * Caller's responsibility to do sanity checks. No sanity checks done here
+     * Device ranges are read and written by parallelism() threads in
+     * blocks of kParallelBlockSize. The block size is a multiple of the
+     * O_DIRECT alignment so output file writes can bypass the page cache.
      */
-    int readBank(std::ofstream& aOutFile, unsigned long long aStartAddr, unsigned long long aSize) {
-      char *buf = 0;
-      unsigned long long blockSize = 0x20000;
-      if (posix_memalign((void**)&buf, getpagesize(), blockSize))
-        return -1;
-      std::memset(buf, 0, blockSize);
+    static const uint64_t kParallelBlockSize = 0x400000; // 4MB
+    static const uint64_t kDirectAlignment = 4096;
 
-      size_t count = aSize;
-      uint64_t incr;
-      for (uint64_t phy = aStartAddr; phy < aStartAddr+aSize; phy += incr) {
-        incr = (count >= blockSize) ? blockSize : count;
-        //std::cout << "Reading from addr " << std::hex << phy << " aSize = " << std::hex << incr << std::dec << std::endl;
+    static unsigned int parallelism() {
+      unsigned int n = std::thread::hardware_concurrency();
+      return std::max(1u, std::min(4u, n));
+    }
+
+    struct mem_range_t {
+      uint64_t m_addr;
+      uint64_t m_size;
+      mem_range_t(uint64_t aAddr, uint64_t aSize) : m_addr(aAddr), m_size(aSize) {}
+    };
+
+    /*
+     * readRanges()
+     *
+     * Read aSize bytes starting at byte aOffset of the concatenated device
+     * ranges into aDst. Unaligned destinations go through aBounce since the
+     * DMA engine requires page aligned host buffers.
+     */
+    int readRanges(const std::vector<mem_range_t>& aRanges, uint64_t aOffset, char *aDst,
+                   uint64_t aSize, char *aBounce) {
+      for (const auto& range : aRanges) {
+        if (aSize == 0)
+          break;
+        if (aOffset >= range.m_size) {
+          aOffset -= range.m_size;
+          continue;
+        }
+        uint64_t incr = std::min(aSize, range.m_size - aOffset);
+        uint64_t phy = range.m_addr + aOffset;
+        bool aligned = (reinterpret_cast<uintptr_t>(aDst) % getpagesize()) == 0;
+        char *buf = aligned ? aDst : aBounce;
         if (xclUnmgdPread(mHandle, 0, buf, incr, phy) < 0) {
-          //error
           std::cout << "Error (" << strerror (errno) << ") reading 0x" << std::hex << incr << " bytes from DDR at offset 0x" << std::hex << phy << std::dec << "\n";
-          free(buf);
           return -1;
         }
-        count -= incr;
-        if (incr) {
-          aOutFile.write((const char*)buf, incr);
-          if ((aOutFile.rdstate() & std::ifstream::failbit) != 0) {
-            std::cout << "Error writing to file at offset " << aSize-count << "\n";
+        if (!aligned)
+          std::memcpy(aDst, aBounce, incr);
+        aDst += incr;
+        aSize -= incr;
+        aOffset = 0;
+      }
+      return 0;
+    }
+
+    /*
+     * readToFile()
+     *
+     * Stream aPrefix, the device ranges, and aSuffix to aFd. Each thread
+     * claims file aligned blocks and double buffers: the device read of the
+     * next block overlaps the file write of the previous one.
+     * Returns number of bytes written to the file or -1 on error
+     */
+    long long readToFile(int aFd, bool aDirect, const std::vector<mem_range_t>& aRanges,
+                         const std::string& aPrefix, const std::string& aSuffix) {
+      uint64_t dataSize = std::accumulate(aRanges.begin(), aRanges.end(), (uint64_t)0,
+              [](uint64_t result, const mem_range_t& obj) {return (result + obj.m_size);});
+      uint64_t dataStart = aPrefix.size();
+      uint64_t dataEnd = dataStart + dataSize;
+      uint64_t fileSize = dataEnd + aSuffix.size();
+      uint64_t nblocks = (fileSize + kParallelBlockSize - 1) / kParallelBlockSize;
+      std::atomic<uint64_t> next(0);
+      std::atomic<bool> failed(false);
+
+      // Copy the part of [aOff, aOff+aLen) of the file that overlaps a string
+      auto copyString = [](char *dst, uint64_t off, uint64_t len, const std::string& str, uint64_t strOff) {
+        uint64_t lo = std::max(off, strOff), hi = std::min(off + len, strOff + str.size());
+        if (lo < hi)
+          std::memcpy(dst + (lo - off), str.data() + (lo - strOff), hi - lo);
+      };
+
+      auto worker = [&]() {
+        char *buf[2] = {0, 0};
+        char *bounce = 0;
+        if (posix_memalign((void**)&buf[0], kDirectAlignment, kParallelBlockSize)
+            || posix_memalign((void**)&buf[1], kDirectAlignment, kParallelBlockSize)
+            || posix_memalign((void**)&bounce, kDirectAlignment, kParallelBlockSize)) {
+          failed = true;
+        }
+        std::future<bool> pending;
+        for (int cur = 0; !failed; cur ^= 1) {
+          uint64_t block = next++;
+          if (block >= nblocks)
+            break;
+          uint64_t off = block * kParallelBlockSize;
+          uint64_t len = std::min(kParallelBlockSize, fileSize - off);
+
+          // buf[cur] was last used two blocks ago, its write has completed
+          copyString(buf[cur], off, len, aPrefix, 0);
+          copyString(buf[cur], off, len, aSuffix, dataEnd);
+          uint64_t lo = std::max(off, dataStart), hi = std::min(off + len, dataEnd);
+          if (lo < hi && readRanges(aRanges, lo - dataStart, buf[cur] + (lo - off), hi - lo, bounce)) {
+            failed = true;
+            break;
+          }
+          // O_DIRECT writes whole aligned blocks, the tail is truncated later
+          uint64_t wlen = len;
+          if (aDirect && (wlen % kDirectAlignment)) {
+            wlen = (wlen + kDirectAlignment - 1) & ~(kDirectAlignment - 1);
+            std::memset(buf[cur] + len, 0, wlen - len);
           }
+
+          if (pending.valid() && !pending.get())
+            failed = true;
+          char *wbuf = buf[cur];
+          pending = std::async(std::launch::async, [aFd, wbuf, wlen, off]() {
+            return pwrite(aFd, wbuf, wlen, off) == static_cast<ssize_t>(wlen);
+          });
         }
-        std::cout << "INFO: Read size 0x" << std::hex << incr << " B. Total Read so far 0x" << aSize-count << std::endl;
-      }
-      free(buf);
-      if (count != 0) {
-        std::cout << "Error! Read " << std::dec << aSize-count << " bytes, requested " << aSize << std::endl;
+        if (pending.valid() && !pending.get())
+          failed = true;
+        free(buf[0]);
+        free(buf[1]);
+        free(bounce);
+      };
+
+      std::vector<std::thread> threads;
+      for (unsigned int i = 0; i < parallelism(); ++i)
+        threads.emplace_back(worker);
+      for (auto& t : threads)
+        t.join();
+
+      if (failed) {
+        std::cout << "Error writing to output file" << std::endl;
         return -1;
       }
-      return count;
+      if (ftruncate(aFd, fileSize) < 0)
+        return -1;
+      return fileSize;
+    }
+
+    /*
+     * writeRange()
+     *
+     * Fill a device range with a pattern, one contiguous slice per thread
+     */
+    int writeRange(unsigned long long aStartAddr, unsigned long long aSize, unsigned int aPattern) {
+      unsigned int nthreads = parallelism();
+      uint64_t slice = (aSize + nthreads - 1) / nthreads;
+      slice = (slice + kDirectAlignment - 1) & ~(kDirectAlignment - 1);
+      std::atomic<bool> failed(false);
+
+      auto worker = [&](uint64_t start, uint64_t end) {
+        char *buf = 0;
+        if (posix_memalign((void**)&buf, getpagesize(), kParallelBlockSize)) {
+          failed = true;
+          return;
+        }
+        std::memset(buf, aPattern, kParallelBlockSize);
+        for (uint64_t phy = start; phy < end && !failed; phy += kParallelBlockSize) {
+          uint64_t incr = std::min(kParallelBlockSize, end - phy);
+          if (xclUnmgdPwrite(mHandle, 0, buf, incr, phy) < 0) {
+            std::cout << "Error (" << strerror (errno) << ") writing 0x" << std::hex << incr << " bytes to DDR at offset 0x" << std::hex << phy << std::dec << "\n";
+            failed = true;
+          }
+        }
+        free(buf);
+      };
+
+      std::vector<std::thread> threads;
+      for (uint64_t start = aStartAddr; start < aStartAddr + aSize; start += slice)
+        threads.emplace_back(worker, start, std::min<uint64_t>(start + slice, aStartAddr + aSize));
+      for (auto& t : threads)
+        t.join();
+      return failed ? -1 : 0;
+    }
+
+    static void printThroughput(const char *aWhat, uint64_t aBytes,
+                                std::chrono::high_resolution_clock::time_point aStart) {
+      std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - aStart;
+      if (elapsed.count() <= 0)
+        return;
+      std::cout << "INFO: " << aWhat << " " << std::dec << aBytes << " bytes in " << elapsed.count()
+                << " s (" << (aBytes / elapsed.count()) / (1024 * 1024) << " MB/s)" << std::endl;
     }
 
     int runDMATest(size_t blocksize, unsigned int aPattern) 
@@ -266,11 +416,8 @@ namespace xcldev {
         std::cout << "INFO: Reading from single bank, " << std::dec << size << " bytes from DDR address 0x"  << std::hex << startAddr
                                     << std::dec << std::endl;
       }
-      std::ofstream outFile(aFilename, std::ofstream::out | std::ofstream::binary);
-      char temp[32] = "====START of DDR Data=========\n";
-      outFile.write(temp, sizeof(temp));
-
       size_t count = size;
+      std::vector<mem_range_t> ranges;
       for(auto it = startbank; it!=vec_banks.end(); ++it) {
         unsigned long long available_bank_size;
         if (it != startbank) {
@@ -283,19 +430,38 @@ namespace xcldev {
         }
         if (size != 0) {
           unsigned long long readsize = (size > available_bank_size) ? (unsigned long long) available_bank_size : size;
-          if( readBank(outFile, startAddr, readsize) == -1) {
-            return -1;
-          }
+          ranges.emplace_back(startAddr, readsize);
           size -= readsize;
         }
         else {
           break;
         }
       }
+
+      // O_DIRECT is not supported by every file system, fall back to buffered
+      bool direct = true;
+      int fd = open(aFilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+      if (fd < 0) {
+        direct = false;
+        fd = open(aFilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      }
+      if (fd < 0) {
+        std::cout << "Error (" << strerror (errno) << ") opening " << aFilename << std::endl;
+        return -1;
+      }
+
+      char temp[32] = "====START of DDR Data=========\n";
+      std::string prefix(temp, sizeof(temp));
       strncpy(temp, "\n=====END of DDR Data=========\n", sizeof(temp));
-      outFile.write(temp, sizeof(temp));
-      outFile.close();
-      std::cout << "INFO: Read data saved in file: " << aFilename << "; Num of bytes: " << std::dec << count-size << " bytes " << std::endl;
+      std::string suffix(temp, sizeof(temp));
+
+      auto start = std::chrono::high_resolution_clock::now();
+      long long written = readToFile(fd, direct, ranges, prefix, suffix);
+      close(fd);
+      if (written < 0)
+        return -1;
+      printThroughput("Read", count, start);
+      std::cout << "INFO: Read data saved in file: " << aFilename << "; Num of bytes: " << std::dec << count << " bytes " << std::endl;
       return size;
     }
 
@@ -303,33 +469,14 @@ namespace xcldev {
      * readCompare()
      */
     int readCompare(unsigned long long aStartAddr = 0, unsigned long long aSize = 0, unsigned int aPattern = 'J', bool checks = true) {
-      void *buf = 0;
-      void *bufPattern = 0;
       unsigned long long size = aSize;
       std::vector<mem_bank_t> vec_banks;
       std::vector<mem_bank_t>::iterator startbank;
       int bankcnt = 0;
-      //unsigned long long blockSize = 0x20000;
-      unsigned long long blockSize = aSize;
-      if (blockSize < 64) {
-        blockSize = 64;
-      }
-
-      if (posix_memalign(&buf, getpagesize(), blockSize+1))//Last is for termination char
-        return -1;
-      if (posix_memalign(&bufPattern, getpagesize(), blockSize+1)) {//Last is for termination char
-        free(buf);
-        return -1;
-      }
-      std::memset(buf, '\0', blockSize+1);//Fill with termination char
-      std::memset(bufPattern, '\0', blockSize+1);//Fill with termination char
-      std::memset(bufPattern, aPattern, blockSize);
 
       if(checks) {
           //Sanity check the address and size against the mem topology
           if ((bankcnt = readWriteHelper(aStartAddr, size, vec_banks, startbank)) == -1) {
-              free(buf);
-              free(bufPattern);
               return -1;
           }
       }
@@ -337,36 +484,60 @@ namespace xcldev {
       unsigned long long endAddr = aSize == 0 ? mDDRSize : aStartAddr+aSize;
       size = endAddr-aStartAddr;
 
-      // Use plain POSIX open/pwrite/close.
-      size_t count = size;
-      uint64_t incr;
-      for (uint64_t phy = aStartAddr; phy < aStartAddr+size; phy += incr) {
-        incr = (count >= blockSize) ? blockSize : count;
-        //Reset the read buffer
-        std::memset(buf, '\0', blockSize+1);//Fill with termination char
-        std::memset(bufPattern, '\0', blockSize+1);//Fill with termination char
-        std::memset(bufPattern, aPattern, incr);//Need this when count is < blockSize
-        //std::cout << "Reading from addr " << std::hex << phy << " size = " << std::hex << incr << std::dec << std::endl;
-        if (xclUnmgdPread(mHandle, 0, buf, incr, phy) < 0) {
-          //error
-          std::cout << "Error (" << strerror (errno) << ") reading 0x" << std::hex << incr << " bytes from DDR at offset 0x" << std::hex << phy << std::dec << "\n";
+      // Each thread reads and compares one contiguous slice, reusing one
+      // block sized pattern buffer that memcmp compares a vector at a time
+      unsigned long long blockSize = std::min<unsigned long long>(std::max<unsigned long long>(size, 64), kParallelBlockSize);
+      unsigned int nthreads = parallelism();
+      uint64_t slice = (size + nthreads - 1) / nthreads;
+      slice = (slice + kDirectAlignment - 1) & ~(kDirectAlignment - 1);
+      std::atomic<bool> failed(false);
+      std::atomic<unsigned long long> count(size);
+      std::mutex outLock;
+
+      auto worker = [&](uint64_t start, uint64_t end) {
+        void *buf = 0;
+        void *bufPattern = 0;
+        if (posix_memalign(&buf, getpagesize(), blockSize)) {
+          failed = true;
+          return;
+        }
+        if (posix_memalign(&bufPattern, getpagesize(), blockSize)) {
           free(buf);
-          free(bufPattern);
-          return -1;
+          failed = true;
+          return;
         }
-        count -= incr;
-        if (incr) {
-          //char temp = aPattern;
-          //std::cout << "INFO: Pattern char is: " << temp << std::endl;
-          if( std::string((char*)buf) != std::string((char*)bufPattern)) { // strings are equal
-            std::cout << "Error: read data didn't meet the pattern. Total Num of Bytes Read = " << std::dec << size << std::endl;
-            std::cout << "Error: read data is: " << std::string((char*)buf) << std::endl;
+        std::memset(bufPattern, aPattern, blockSize);
+
+        for (uint64_t phy = start; phy < end && !failed; phy += blockSize) {
+          uint64_t incr = std::min<uint64_t>(blockSize, end - phy);
+          if (xclUnmgdPread(mHandle, 0, buf, incr, phy) < 0) {
+            std::lock_guard<std::mutex> lk(outLock);
+            std::cout << "Error (" << strerror (errno) << ") reading 0x" << std::hex << incr << " bytes from DDR at offset 0x" << std::hex << phy << std::dec << "\n";
+            failed = true;
+            break;
+          }
+          count -= incr;
+          if (incr && std::memcmp(buf, bufPattern, incr)) {
+            auto first = std::mismatch((const char*)buf, (const char*)buf + incr, (const char*)bufPattern);
+            std::lock_guard<std::mutex> lk(outLock);
+            std::cout << "Error: read data didn't meet the pattern at DDR address 0x" << std::hex
+                      << phy + (first.first - (const char*)buf) << ", read 0x"
+                      << (unsigned int)(unsigned char)*first.first << std::dec
+                      << ". Total Num of Bytes Read = " << size << std::endl;
           }
         }
-        //std::cout << "INFO: Read size: " << std::dec << incr << " B. Total Read so far: " << std::dec << size-count << std::endl;
-      }
-      free(buf);
-      free(bufPattern);
+        free(buf);
+        free(bufPattern);
+      };
+
+      std::vector<std::thread> threads;
+      for (uint64_t start = aStartAddr; start < aStartAddr + size; start += slice)
+        threads.emplace_back(worker, start, std::min<uint64_t>(start + slice, aStartAddr + size));
+      for (auto& t : threads)
+        t.join();
+
+      if (failed)
+        return -1;
       if (count != 0) {
         std::cout << "Error! Read " << std::dec << size-count << " bytes, requested " << size << std::endl;
         return -1;
@@ -381,42 +552,14 @@ namespace xcldev {
      * Caller's responsibility to do sanity checks. No sanity checks done here
      */
     int writeBank(unsigned long long aStartAddr, unsigned long long aSize, unsigned int aPattern) {
-      char *buf = 0;
-      unsigned long long endAddr;
-      unsigned long long size;
-      unsigned long long blockSize = 0x20000;//128KB
-      if (posix_memalign((void**)&buf, getpagesize(), blockSize))
-        return -1;
-
-      endAddr = aStartAddr + aSize;
-      size = endAddr-aStartAddr;
-
-      // Use plain POSIX open/pwrite/close.
-
-      std::cout << "INFO: Writing DDR with " << std::dec << size << " bytes of pattern: 0x"
+      std::cout << "INFO: Writing DDR with " << std::dec << aSize << " bytes of pattern: 0x"
          << std::hex << aPattern << " from address 0x" <<std::hex << aStartAddr << std::endl;
 
-      unsigned long long count = size;
-      uint64_t incr = 0;
-      std::memset(buf, aPattern, blockSize);
-      for(uint64_t phy=aStartAddr; phy<endAddr; phy+=incr) {
-        incr = (count >= blockSize) ? blockSize : count;
-        //std::cout << "Writing to addr " << std::hex << phy << " size = " << std::hex << incr << std::dec << std::endl;
-        if (xclUnmgdPwrite(mHandle, 0, buf, incr, phy) < 0) {
-          //error
-          std::cout << "Error (" << strerror (errno) << ") writing 0x" << std::hex << incr << " bytes to DDR at offset 0x" << std::hex << phy << std::dec << "\n";
-          free(buf);
-          return -1;
-        }
-        count -= incr;
-      }
-
-      free(buf);
-      if (count != 0) {
-        std::cout << "Error! Written " << std::dec << size-count << " bytes, requested " << size << std::endl;
+      auto start = std::chrono::high_resolution_clock::now();
+      if (writeRange(aStartAddr, aSize, aPattern))
         return -1;
-      }
-      return count;
+      printThroughput("Wrote", aSize, start);
+      return 0;
     }
 
     /*
@@ -99,6 +99,8 @@
 
 /* SAM Trace Control Masks */
 #define XSAM_TRACE_STALL_SELECT_MASK    0x0000001c
+/* Start trigger bit: stalls are counted per window by host, not traced */
+#define XSAM_TRACE_STALL_AGGREGATE_MASK 0x00000040
 
 /************************** SDx Axi Stream Monitor (SSPM) *********************/
 
@@ -0,0 +1,238 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * BO pools shared by a process and the processes it forks.  The BOs are
+ * exported as DMA-BUF fds, which forked processes inherit and import into
+ * their own device handle.  The freelist is a bitmap in anonymous shared
+ * memory, claimed with atomic operations so no lock is shared across
+ * processes.
+ */
+
+#include "shim.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+const unsigned int null_bo = xocl::mNullBO;
+
+// Mapped shared between the processes, one bit per free BO
+struct pool_freelist
+{
+    std::atomic<uint64_t> free[XCL_BO_POOL_MAX / 64];
+};
+
+struct bo_pool
+{
+    size_t size = 0;
+    unsigned count = 0;
+    pid_t owner = 0;
+    xocl::XOCLShim *owner_drv = nullptr;
+    std::vector<unsigned int> bos;  // BOs of the creating handle
+    std::vector<int> fds;           // DMA-BUF fds, inherited across fork
+    pool_freelist *freelist = nullptr;
+
+    // BOs imported by this process, per device handle.  The map is
+    // inherited on fork and only valid in the process that filled it.
+    pid_t import_pid = 0;
+    std::map<xocl::XOCLShim*, std::vector<unsigned int>> imports;
+};
+
+static std::mutex pools_mutex;
+static std::vector<std::unique_ptr<bo_pool>> pools;
+
+static bo_pool *get_pool(int pool)
+{
+    if (pool < 0 || static_cast<size_t>(pool) >= pools.size())
+        return nullptr;
+    return pools[pool].get();
+}
+
+static int claim(bo_pool *p)
+{
+    for (unsigned w = 0; w < (p->count + 63) / 64; w++) {
+        auto& word = p->freelist->free[w];
+        uint64_t bits = word.load();
+        while (bits) {
+            int bit = __builtin_ctzll(bits);
+            if (word.compare_exchange_weak(bits, bits & ~(1ULL << bit)))
+                return w * 64 + bit;
+        }
+    }
+    return -1;
+}
+
+static void unclaim(bo_pool *p, unsigned index)
+{
+    p->freelist->free[index / 64].fetch_or(1ULL << (index % 64));
+}
+
+// BO handle of pool entry index on drv, imported on first use
+static unsigned int get_bo(bo_pool *p, xocl::XOCLShim *drv, unsigned index)
+{
+    // Importing an own BO into the same file returns the original handle,
+    // the creator uses its BOs directly so they are not freed twice
+    if (getpid() == p->owner && drv == p->owner_drv)
+        return p->bos[index];
+
+    if (p->import_pid != getpid()) {
+        p->imports.clear();
+        p->import_pid = getpid();
+    }
+
+    auto& bos = p->imports[drv];
+    if (bos.empty())
+        bos.resize(p->count, null_bo);
+    if (bos[index] == null_bo)
+        bos[index] = drv->xclImportBO(p->fds[index], 0);
+    return bos[index];
+}
+
+static void free_imports(bo_pool *p)
+{
+    if (p->import_pid != getpid())
+        return;
+    for (auto& imported : p->imports) {
+        for (auto bo : imported.second) {
+            if (bo != null_bo)
+                imported.first->xclFreeBO(bo);
+        }
+    }
+    p->imports.clear();
+}
+
+} // namespace
+
+int xclCreateBOPool(xclDeviceHandle handle, size_t size, unsigned count, unsigned flags)
+{
+    xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
+    if (!drv)
+        return -ENODEV;
+    if (!size || !count || count > XCL_BO_POOL_MAX)
+        return -EINVAL;
+
+    void *addr = mmap(0, sizeof(pool_freelist), PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED)
+        return -ENOMEM;
+
+    std::unique_ptr<bo_pool> p(new bo_pool);
+    p->size = size;
+    p->count = count;
+    p->owner = getpid();
+    p->owner_drv = drv;
+    p->freelist = new (addr) pool_freelist;
+
+    int ret = 0;
+    for (unsigned i = 0; i < count; i++) {
+        unsigned int bo = drv->xclAllocBO(size, XCL_BO_DEVICE_RAM, flags);
+        if (bo == null_bo) {
+            ret = -ENOMEM;
+            break;
+        }
+        p->bos.push_back(bo);
+        int fd = drv->xclExportBO(bo);
+        if (fd < 0) {
+            ret = fd;
+            break;
+        }
+        p->fds.push_back(fd);
+        unclaim(p.get(), i);
+    }
+
+    if (ret) {
+        for (auto fd : p->fds)
+            close(fd);
+        for (auto bo : p->bos)
+            drv->xclFreeBO(bo);
+        munmap(addr, sizeof(pool_freelist));
+        return ret;
+    }
+
+    std::lock_guard<std::mutex> lk(pools_mutex);
+    pools.push_back(std::move(p));
+    return pools.size() - 1;
+}
+
+unsigned int xclAcquirePoolBO(xclDeviceHandle handle, int pool, unsigned *index)
+{
+    xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
+    if (!drv)
+        return null_bo;
+
+    std::lock_guard<std::mutex> lk(pools_mutex);
+    bo_pool *p = get_pool(pool);
+    if (!p)
+        return null_bo;
+
+    int idx = claim(p);
+    if (idx < 0)
+        return null_bo;
+
+    unsigned int bo = get_bo(p, drv, idx);
+    if (bo == null_bo) {
+        unclaim(p, idx);
+        return null_bo;
+    }
+    if (index)
+        *index = idx;
+    return bo;
+}
+
+int xclReleasePoolBO(xclDeviceHandle handle, int pool, unsigned index)
+{
+    xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
+    if (!drv)
+        return -ENODEV;
+
+    std::lock_guard<std::mutex> lk(pools_mutex);
+    bo_pool *p = get_pool(pool);
+    if (!p || index >= p->count)
+        return -EINVAL;
+    unclaim(p, index);
+    return 0;
+}
+
+int xclDestroyBOPool(xclDeviceHandle handle, int pool)
+{
+    xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
+    if (!drv)
+        return -ENODEV;
+
+    std::lock_guard<std::mutex> lk(pools_mutex);
+    bo_pool *p = get_pool(pool);
+    if (!p)
+        return -EINVAL;
+
+    free_imports(p);
+    for (auto fd : p->fds)
+        close(fd);
+    if (getpid() == p->owner) {
+        for (auto bo : p->bos)
+            p->owner_drv->xclFreeBO(bo);
+    }
+    munmap(p->freelist, sizeof(pool_freelist));
+    pools[pool].reset();
+    return 0;
+}
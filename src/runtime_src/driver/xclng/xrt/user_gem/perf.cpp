@@ -33,6 +33,7 @@
  */
 
 #include "shim.h"
+#include "scan.h"
 //#include "datamover.h"
 #include "driver/xclng/include/mgmt-reg.h"
 #include "driver/xclng/include/mgmt-ioctl.h"
@@ -43,6 +44,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
 
@@ -52,9 +54,11 @@
 #include <algorithm>
 #include <thread>
 #include <vector>
+#include <sstream>
 #include <time.h>
 #include <string.h>
 #include <chrono>
+#include <atomic>
 
 #ifndef _WINDOWS
 // TODO: Windows build support
@@ -464,24 +468,17 @@ namespace xocl {
         counterResults.SampleIntervalUsec = sampleInterval / xclGetDeviceClockFreqMHz();
       }
 
+      // Sampled metric counters are contiguous, read them in one access
+      uint32_t spmSample[(XSPM_SAMPLE_READ_LATENCY_OFFSET - XSPM_SAMPLE_WRITE_BYTES_OFFSET) / 4 + 1];
       size += xclRead(XCL_ADDR_SPACE_DEVICE_PERFMON, 
                       baseAddress + XSPM_SAMPLE_WRITE_BYTES_OFFSET, 
-                      &counterResults.WriteBytes[s], 4); 
-      size += xclRead(XCL_ADDR_SPACE_DEVICE_PERFMON, 
-                      baseAddress + XSPM_SAMPLE_WRITE_TRANX_OFFSET, 
-                      &counterResults.WriteTranx[s], 4);
-      size += xclRead(XCL_ADDR_SPACE_DEVICE_PERFMON, 
-                      baseAddress + XSPM_SAMPLE_WRITE_LATENCY_OFFSET, 
-                      &counterResults.WriteLatency[s], 4);
-      size += xclRead(XCL_ADDR_SPACE_DEVICE_PERFMON, 
-                      baseAddress + XSPM_SAMPLE_READ_BYTES_OFFSET, 
-                      &counterResults.ReadBytes[s], 4);
-      size += xclRead(XCL_ADDR_SPACE_DEVICE_PERFMON, 
-                      baseAddress + XSPM_SAMPLE_READ_TRANX_OFFSET, 
-                      &counterResults.ReadTranx[s], 4);
-      size += xclRead(XCL_ADDR_SPACE_DEVICE_PERFMON, 
-                      baseAddress + XSPM_SAMPLE_READ_LATENCY_OFFSET, 
-                      &counterResults.ReadLatency[s], 4);
+                      spmSample, sizeof(spmSample));
+      counterResults.WriteBytes[s]   = spmSample[0];
+      counterResults.WriteTranx[s]   = spmSample[(XSPM_SAMPLE_WRITE_TRANX_OFFSET - XSPM_SAMPLE_WRITE_BYTES_OFFSET) / 4];
+      counterResults.WriteLatency[s] = spmSample[(XSPM_SAMPLE_WRITE_LATENCY_OFFSET - XSPM_SAMPLE_WRITE_BYTES_OFFSET) / 4];
+      counterResults.ReadBytes[s]    = spmSample[(XSPM_SAMPLE_READ_BYTES_OFFSET - XSPM_SAMPLE_WRITE_BYTES_OFFSET) / 4];
+      counterResults.ReadTranx[s]    = spmSample[(XSPM_SAMPLE_READ_TRANX_OFFSET - XSPM_SAMPLE_WRITE_BYTES_OFFSET) / 4];
+      counterResults.ReadLatency[s]  = spmSample[(XSPM_SAMPLE_READ_LATENCY_OFFSET - XSPM_SAMPLE_WRITE_BYTES_OFFSET) / 4];
 
       if (mLogStream.is_open()) {
         mLogStream << "Reading SPM ...SlotNum : " << s << std::endl;
@@ -514,18 +511,15 @@ namespace xocl {
       if (mLogStream.is_open()) {
         mLogStream << "SAM Sample Interval : " << sampleInterval << std::endl;
       }
+      // Execution, stall and min/max counters are contiguous, read them in one access
+      uint32_t samSample[(XSAM_ACCEL_MAX_EXECUTION_CYCLES_OFFSET - XSAM_ACCEL_EXECUTION_COUNT_OFFSET) / 4 + 1];
       size += xclRead(XCL_ADDR_SPACE_DEVICE_PERFMON, 
                       baseAddress + XSAM_ACCEL_EXECUTION_COUNT_OFFSET, 
-                      &counterResults.CuExecCount[s], 4); 
-      size += xclRead(XCL_ADDR_SPACE_DEVICE_PERFMON, 
-                      baseAddress + XSAM_ACCEL_EXECUTION_CYCLES_OFFSET, 
-                      &counterResults.CuExecCycles[s], 4);
-      size += xclRead(XCL_ADDR_SPACE_DEVICE_PERFMON, 
-                      baseAddress + XSAM_ACCEL_MIN_EXECUTION_CYCLES_OFFSET, 
-                      &counterResults.CuMinExecCycles[s], 4);
-      size += xclRead(XCL_ADDR_SPACE_DEVICE_PERFMON, 
-                      baseAddress + XSAM_ACCEL_MAX_EXECUTION_CYCLES_OFFSET, 
-                      &counterResults.CuMaxExecCycles[s], 4);
+                      samSample, sizeof(samSample));
+      counterResults.CuExecCount[s]     = samSample[0];
+      counterResults.CuExecCycles[s]    = samSample[(XSAM_ACCEL_EXECUTION_CYCLES_OFFSET - XSAM_ACCEL_EXECUTION_COUNT_OFFSET) / 4];
+      counterResults.CuMinExecCycles[s] = samSample[(XSAM_ACCEL_MIN_EXECUTION_CYCLES_OFFSET - XSAM_ACCEL_EXECUTION_COUNT_OFFSET) / 4];
+      counterResults.CuMaxExecCycles[s] = samSample[(XSAM_ACCEL_MAX_EXECUTION_CYCLES_OFFSET - XSAM_ACCEL_EXECUTION_COUNT_OFFSET) / 4];
       if (mLogStream.is_open()) {
         mLogStream << "Reading SAM ...SlotNum : " << s << std::endl;
         mLogStream << "Reading SAM ...CuExecCount : " << counterResults.CuExecCount[s] << std::endl;
@@ -535,15 +529,9 @@ namespace xocl {
       }
       // Check Stall bit
       if (mAccelmonProperties[s] & 0x4) {
-        size += xclRead(XCL_ADDR_SPACE_DEVICE_PERFMON, 
-                      baseAddress + XSAM_ACCEL_STALL_INT_OFFSET, 
-                      &counterResults.CuStallIntCycles[s], 4); 
-        size += xclRead(XCL_ADDR_SPACE_DEVICE_PERFMON, 
-                      baseAddress + XSAM_ACCEL_STALL_STR_OFFSET, 
-                      &counterResults.CuStallStrCycles[s], 4); 
-        size += xclRead(XCL_ADDR_SPACE_DEVICE_PERFMON, 
-                      baseAddress + XSAM_ACCEL_STALL_EXT_OFFSET, 
-                      &counterResults.CuStallExtCycles[s], 4);
+        counterResults.CuStallIntCycles[s] = samSample[(XSAM_ACCEL_STALL_INT_OFFSET - XSAM_ACCEL_EXECUTION_COUNT_OFFSET) / 4];
+        counterResults.CuStallStrCycles[s] = samSample[(XSAM_ACCEL_STALL_STR_OFFSET - XSAM_ACCEL_EXECUTION_COUNT_OFFSET) / 4];
+        counterResults.CuStallExtCycles[s] = samSample[(XSAM_ACCEL_STALL_EXT_OFFSET - XSAM_ACCEL_EXECUTION_COUNT_OFFSET) / 4];
         if (mLogStream.is_open()) {
           mLogStream << "Stall Counters enabled : " << std::endl;
           mLogStream << "Reading SAM ...CuStallIntCycles : " << counterResults.CuStallIntCycles[s] << std::endl;
@@ -565,21 +553,16 @@ namespace xocl {
       size += xclRead(XCL_ADDR_SPACE_DEVICE_PERFMON,
                       baseAddress + XSSPM_SAMPLE_OFFSET, 
                       &sampleInterval, 4);
+      // 64 bit stream counters are contiguous, read them in one access
+      uint64_t sspmSample[(XSSPM_STARVE_CYCLES_OFFSET - XSSPM_NUM_TRANX_OFFSET) / 8 + 1];
       size += xclRead(XCL_ADDR_SPACE_DEVICE_PERFMON,
                       baseAddress + XSSPM_NUM_TRANX_OFFSET, 
-                      &counterResults.StrNumTranx[s], 8);
-      size += xclRead(XCL_ADDR_SPACE_DEVICE_PERFMON,
-                      baseAddress + XSSPM_DATA_BYTES_OFFSET, 
-                      &counterResults.StrDataBytes[s], 8);
-      size += xclRead(XCL_ADDR_SPACE_DEVICE_PERFMON,
-                      baseAddress + XSSPM_BUSY_CYCLES_OFFSET, 
-                      &counterResults.StrBusyCycles[s], 8);
-      size += xclRead(XCL_ADDR_SPACE_DEVICE_PERFMON,
-                      baseAddress + XSSPM_STALL_CYCLES_OFFSET, 
-                      &counterResults.StrStallCycles[s], 8);
-      size += xclRead(XCL_ADDR_SPACE_DEVICE_PERFMON,
-                      baseAddress + XSSPM_STARVE_CYCLES_OFFSET, 
-                      &counterResults.StrStarveCycles[s], 8);
+                      sspmSample, sizeof(sspmSample));
+      counterResults.StrNumTranx[s]     = sspmSample[0];
+      counterResults.StrDataBytes[s]    = sspmSample[(XSSPM_DATA_BYTES_OFFSET - XSSPM_NUM_TRANX_OFFSET) / 8];
+      counterResults.StrBusyCycles[s]   = sspmSample[(XSSPM_BUSY_CYCLES_OFFSET - XSSPM_NUM_TRANX_OFFSET) / 8];
+      counterResults.StrStallCycles[s]  = sspmSample[(XSSPM_STALL_CYCLES_OFFSET - XSSPM_NUM_TRANX_OFFSET) / 8];
+      counterResults.StrStarveCycles[s] = sspmSample[(XSSPM_STARVE_CYCLES_OFFSET - XSSPM_NUM_TRANX_OFFSET) / 8];
       if (mLogStream.is_open()) {
         mLogStream << "Reading SSPM ...SlotNum : " << s << std::endl;
         mLogStream << "Reading SSPM ...NumTranx : " << counterResults.StrNumTranx[s] << std::endl;
@@ -592,18 +575,223 @@ namespace xocl {
     return size;
   }
 
+  // Kernel clocks since the previous sample, from the cumulative time the
+  // kernel driver reports per clock and frequency. Clocks change when the
+  // clock boost governor of the mgmt driver is on.
+  void XOCLShim::sampleClockResidency(xclCounterSample& sample) {
+    auto dev = pcidev::get_dev(mBoardNumber);
+    if (!dev || !dev->mgmt)
+      return;
+
+    std::string errmsg;
+    std::vector<std::string> lines;
+    dev->mgmt->sysfs_get("icap", "clock_residency", errmsg, lines);
+    if (!errmsg.empty())
+      return;
+
+    // Frequencies not listed before had no time, the first sample only
+    // records the base
+    bool first = mSampleResidency.empty();
+    uint64_t totalUsec[XCL_SAMPLE_MAX_NUMBER_CLOCKS] = {};
+    double weightedMHz[XCL_SAMPLE_MAX_NUMBER_CLOCKS] = {};
+    for (auto& line : lines) {
+      unsigned clock = 0, freq = 0;
+      uint64_t usec = 0;
+      std::istringstream is(line);
+      if (!(is >> clock >> freq >> usec) || clock >= XCL_SAMPLE_MAX_NUMBER_CLOCKS)
+        continue;
+
+      auto& prev = mSampleResidency[std::make_pair(clock, freq)];
+      uint64_t delta = usec - prev;
+      prev = usec;
+      if (!delta || first)
+        continue;
+
+      sample.NumClocks = std::max(sample.NumClocks, clock + 1);
+      totalUsec[clock] += delta;
+      weightedMHz[clock] += (double)delta * freq;
+      if (!sample.ClockMinMHz[clock] || freq < sample.ClockMinMHz[clock])
+        sample.ClockMinMHz[clock] = freq;
+      sample.ClockMaxMHz[clock] = std::max<unsigned short>(sample.ClockMaxMHz[clock], freq);
+    }
+
+    for (unsigned c = 0; c < sample.NumClocks; c++) {
+      if (totalUsec[c])
+        sample.ClockMHz[c] = weightedMHz[c] / totalUsec[c];
+    }
+  }
+
+  // Snapshot counters and convert the difference to the previous snapshot
+  // into rates. Counters wrap, unsigned differences stay correct across it.
+  size_t XOCLShim::xclPerfMonSampleCounters(xclCounterSample& sample) {
+    std::lock_guard<std::mutex> lock(mSampleLock);
+    memset(&sample, 0, sizeof(xclCounterSample));
+    sampleClockResidency(sample);
+
+    readDebugIpLayout();
+    if (!mIsDeviceProfiling)
+      return 0;
+
+    size_t size = 0;
+    uint32_t regValue;
+    uint32_t numMemSlots = getPerfMonNumberSlots(XCL_PERF_MON_MEMORY);
+
+    // Memory monitors only count once enabled, do not reset them as
+    // profiling may be sharing the counters
+    if (mSamplePrevNsec == 0) {
+      for (uint32_t s=0; s < numMemSlots; s++) {
+        uint64_t baseAddress = getPerfMonBaseAddress(XCL_PERF_MON_MEMORY,s);
+        size += xclRead(XCL_ADDR_SPACE_DEVICE_PERFMON, baseAddress + XSPM_CONTROL_OFFSET, &regValue, 4);
+        if (regValue & XSPM_CR_COUNTER_ENABLE_MASK)
+          continue;
+        regValue |= XSPM_CR_COUNTER_ENABLE_MASK;
+        size += xclWrite(XCL_ADDR_SPACE_DEVICE_PERFMON, baseAddress + XSPM_CONTROL_OFFSET, &regValue, 4);
+      }
+    }
+
+    xclCounterResults results;
+    size += xclPerfMonReadCounters(XCL_PERF_MON_MEMORY, results);
+    uint64_t nowNsec = getHostTraceTimeNsec();
+
+    sample.TimestampNsec = nowNsec;
+    sample.IntervalNsec = mSamplePrevNsec ? (nowNsec - mSamplePrevNsec) : 0;
+    sample.NumMemSlots = numMemSlots;
+    sample.NumAccelSlots = getPerfMonNumberSlots(XCL_PERF_MON_ACCEL);
+    sample.NumStrSlots = getPerfMonNumberSlots(XCL_PERF_MON_STR);
+
+    if (sample.IntervalNsec) {
+      // Bytes per usec is MB/s
+      double intervalUsec = sample.IntervalNsec / 1000.0;
+      uint32_t byteScale = getPerfMonByteScaleFactor(XCL_PERF_MON_MEMORY);
+      for (uint32_t s=0; s < sample.NumMemSlots; s++) {
+        uint32_t writeBytes = results.WriteBytes[s] - mSamplePrev.WriteBytes[s];
+        uint32_t readBytes = results.ReadBytes[s] - mSamplePrev.ReadBytes[s];
+        sample.WriteMBps[s] = (double)writeBytes * byteScale / intervalUsec;
+        sample.ReadMBps[s] = (double)readBytes * byteScale / intervalUsec;
+      }
+
+      double intervalCycles = intervalUsec * xclGetDeviceClockFreqMHz();
+      for (uint32_t s=0; s < sample.NumAccelSlots; s++) {
+        uint32_t execCycles = results.CuExecCycles[s] - mSamplePrev.CuExecCycles[s];
+        sample.CuExecCount[s] = results.CuExecCount[s] - mSamplePrev.CuExecCount[s];
+        if (intervalCycles > 0)
+          sample.CuUtilization[s] = std::min(100.0, 100.0 * execCycles / intervalCycles);
+      }
+
+      for (uint32_t s=0; s < sample.NumStrSlots; s++) {
+        uint64_t strBytes = results.StrDataBytes[s] - mSamplePrev.StrDataBytes[s];
+        sample.StrMBps[s] = (double)strBytes / intervalUsec;
+      }
+    }
+
+    mSamplePrev = results;
+    mSamplePrevNsec = nowNsec;
+    return size;
+  }
+
+  int XOCLShim::xclPerfMonStartSampling(unsigned int intervalMsec) {
+    if (intervalMsec == 0)
+      return -EINVAL;
+
+    std::lock_guard<std::mutex> lock(mSamplingLock);
+    if (mSamplingThread.joinable())
+      return -EBUSY;
+
+    mSamplePageName = "/xcl_counters_" + std::to_string(getpid()) + "_"
+        + std::to_string(mBoardNumber);
+    int fd = shm_open(mSamplePageName.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+      return -errno;
+    if (ftruncate(fd, sizeof(xclCounterSamplePage)) < 0) {
+      int ret = -errno;
+      close(fd);
+      shm_unlink(mSamplePageName.c_str());
+      return ret;
+    }
+    void *addr = mmap(0, sizeof(xclCounterSamplePage), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+      shm_unlink(mSamplePageName.c_str());
+      return -ENOMEM;
+    }
+
+    mSamplePage = static_cast<xclCounterSamplePage *>(addr);
+    memset(mSamplePage, 0, sizeof(xclCounterSamplePage));
+    mSamplePage->Version = XCL_COUNTER_SAMPLE_PAGE_VERSION;
+
+    mSamplingStop = false;
+    mSamplingThread = std::thread(&XOCLShim::samplingLoop, this, intervalMsec);
+    return 0;
+  }
+
+  int XOCLShim::xclPerfMonStopSampling() {
+    {
+      std::lock_guard<std::mutex> lock(mSamplingLock);
+      if (!mSamplingThread.joinable())
+        return 0;
+      mSamplingStop = true;
+    }
+    mSamplingCond.notify_one();
+    mSamplingThread.join();
+
+    munmap(mSamplePage, sizeof(xclCounterSamplePage));
+    shm_unlink(mSamplePageName.c_str());
+    mSamplePage = nullptr;
+    return 0;
+  }
+
+  void XOCLShim::samplingLoop(unsigned int intervalMsec) {
+    xclCounterSample sample;
+    std::unique_lock<std::mutex> lock(mSamplingLock);
+    while (!mSamplingCond.wait_for(lock, std::chrono::milliseconds(intervalMsec),
+                                   [this] { return mSamplingStop; })) {
+      xclPerfMonSampleCounters(sample);
+
+      // Odd sequence tells readers an update is in progress
+      mSamplePage->Sequence++;
+      std::atomic_thread_fence(std::memory_order_release);
+      mSamplePage->Sample = sample;
+      std::atomic_thread_fence(std::memory_order_release);
+      mSamplePage->Sequence++;
+    }
+  }
+
   // *****
   // Trace
   // *****
 
+  // Write current host time to the trace funnel, it comes back in the trace
+  // stream as 4 words of 16 bits each next to the device timestamp
+  size_t XOCLShim::writeTraceClockTraining() {
+    size_t size = 0;
+    uint32_t regValue;
+    uint64_t baseAddress = getTraceFunnelAddress(XCL_PERF_MON_MEMORY);
+    uint64_t timeStamp = getHostTraceTimeNsec();
+    regValue = static_cast <uint32_t> (timeStamp & 0xFFFF);
+    size += xclWrite(XCL_ADDR_SPACE_DEVICE_PERFMON, baseAddress, &regValue, 4);
+    regValue = static_cast <uint32_t> (timeStamp >> 16 & 0xFFFF);
+    size += xclWrite(XCL_ADDR_SPACE_DEVICE_PERFMON, baseAddress, &regValue, 4);
+    regValue = static_cast <uint32_t> (timeStamp >> 32 & 0xFFFF);
+    size += xclWrite(XCL_ADDR_SPACE_DEVICE_PERFMON, baseAddress, &regValue, 4);
+    regValue = static_cast <uint32_t> (timeStamp >> 48 & 0xFFFF);
+    size += xclWrite(XCL_ADDR_SPACE_DEVICE_PERFMON, baseAddress, &regValue, 4);
+    return size;
+  }
+
   // Clock training used in converting device trace timestamps to host domain
+  // Called periodically while tracing so the conversion follows clock drift
   size_t XOCLShim::xclPerfMonClockTraining(xclPerfMonType type) {
     if (mLogStream.is_open()) {
       mLogStream << __func__ << ", " << std::this_thread::get_id() << ", "
           << type << ", Send clock training..." << std::endl;
     }
-    // This will be enabled later. We're snapping first event to start of cu.
-    return 1;
+
+    if (!mIsDeviceProfiling || type != XCL_PERF_MON_MEMORY
+        || !getTraceFunnelAddress(XCL_PERF_MON_MEMORY))
+      return 0;
+
+    mTraceClockTraining = true;
+    return writeTraceClockTraining();
   }
 
   // Start trace performance monitoring
@@ -612,6 +800,7 @@ namespace xocl {
     // Bit 0: Trace Coarse/Fine     Bit 1: Transfer Trace Ctrl
     // Bit 2: CU Trace Ctrl         Bit 3: INT Trace Ctrl
     // Bit 4: Str Trace Ctrl        Bit 5: Ext Trace Ctrl
+    // Bit 6: Stall aggregation, stall transitions are not traced
     if (mLogStream.is_open()) {
       mLogStream << __func__ << ", " << std::this_thread::get_id()
       << ", " << type << ", " << startTrigger
@@ -640,6 +829,8 @@ namespace xocl {
       // Set Stall trace control register bits
       // Bit 1 : CU (Always ON)  Bit 2 : INT  Bit 3 : STR  Bit 4 : Ext 
       regValue = ((startTrigger & XSAM_TRACE_STALL_SELECT_MASK) >> 1) | 0x1 ;
+      if (startTrigger & XSAM_TRACE_STALL_AGGREGATE_MASK)
+        regValue = 0x1;
       size += xclWrite(XCL_ADDR_SPACE_DEVICE_PERFMON, baseAddress + XSAM_TRACE_CTRL_OFFSET, &regValue, 4);
     }
 
@@ -647,17 +838,12 @@ namespace xocl {
     size += resetFifos(type);
     xclPerfMonGetTraceCount(type);
 
+    // These 8 words lead the FIFO, later training words are marked
+    mTraceClockWordsPending = 8;
+    mTraceClockTraining = false;
+    mTraceClockWord = 0;
     for (uint32_t i = 0; i < 2; i++) {
-      baseAddress = getTraceFunnelAddress(XCL_PERF_MON_MEMORY);
-      uint64_t timeStamp = getHostTraceTimeNsec();
-      regValue = static_cast <uint32_t> (timeStamp & 0xFFFF);
-      size += xclWrite(XCL_ADDR_SPACE_DEVICE_PERFMON, baseAddress, &regValue, 4);
-      regValue = static_cast <uint32_t> (timeStamp >> 16 & 0xFFFF);
-      size += xclWrite(XCL_ADDR_SPACE_DEVICE_PERFMON, baseAddress, &regValue, 4);
-      regValue = static_cast <uint32_t> (timeStamp >> 32 & 0xFFFF); 
-      size += xclWrite(XCL_ADDR_SPACE_DEVICE_PERFMON, baseAddress, &regValue, 4);
-      regValue = static_cast <uint32_t> (timeStamp >> 48 & 0xFFFF);
-      size += xclWrite(XCL_ADDR_SPACE_DEVICE_PERFMON, baseAddress, &regValue, 4);
+      size += writeTraceClockTraining();
       usleep(10);
     }
     return size;
@@ -816,6 +1002,7 @@ namespace xocl {
     // Read & process all trace FIFOs
     // ******************************
     xclTraceResults results = {};
+    uint32_t numResults = 0;
     for (uint32_t wordnum=0; wordnum < numSamples; wordnum++) {
       uint32_t index = wordsPerSample * wordnum;
       uint64_t temp = 0;
@@ -824,32 +1011,37 @@ namespace xocl {
       if (!temp)
         continue;
 
-      // This section assumes that we write 8 timestamp packets in startTrace
-      int mod = (wordnum % 4);
-      unsigned int clockWordIndex = 7;
-      if (wordnum > clockWordIndex || mod == 0) {
-        memset(&results, 0, sizeof(xclTraceResults));
-      }
-      if (wordnum <= clockWordIndex) {
-        if (mod == 0) {
-          results.Timestamp = temp & 0x1FFFFFFFFFFF;
+      // Clock training words: the 8 written in startTrace lead the FIFO,
+      // the ones from periodic training are marked by the trace funnel in
+      // bit 63 and may be interleaved with events, even across reads
+      bool isClockWord = (mTraceClockWordsPending > 0)
+          || (mTraceClockTraining && ((temp >> 63) & 0x1));
+      if (isClockWord) {
+        if (mTraceClockWordsPending > 0)
+          mTraceClockWordsPending--;
+        if (mTraceClockWord == 0) {
+          memset(&mTraceClockResults, 0, sizeof(xclTraceResults));
+          mTraceClockResults.Timestamp = temp & 0x1FFFFFFFFFFF;
         }
-        uint64_t partial = (((temp >> 45) & 0xFFFF) << (16 * mod));
-        results.HostTimestamp = results.HostTimestamp | partial;
+        uint64_t partial = (((temp >> 45) & 0xFFFF) << (16 * mTraceClockWord));
+        mTraceClockResults.HostTimestamp = mTraceClockResults.HostTimestamp | partial;
         if (mLogStream.is_open()) {
           mLogStream << "Updated partial host timestamp : " << std::hex << partial << std::endl;
         }
-        if (mod == 3) {
+        if (++mTraceClockWord == 4) {
+          mTraceClockWord = 0;
           if (mLogStream.is_open()) {
             mLogStream << "  Trace sample " << std::dec << wordnum << ": ";
-            mLogStream << " Timestamp : " << results.Timestamp << "   ";
-            mLogStream << " Host Timestamp : " << std::hex << results.HostTimestamp << std::endl;
+            mLogStream << " Timestamp : " << mTraceClockResults.Timestamp << "   ";
+            mLogStream << " Host Timestamp : " << std::hex << mTraceClockResults.HostTimestamp << std::endl;
           }
-          traceVector.mArray[static_cast<int>(wordnum/4)] = results;
+          traceVector.mArray[numResults++] = mTraceClockResults;
         }
         continue;
       }
 
+      memset(&results, 0, sizeof(xclTraceResults));
+
       // SDSoC Packet Format
       results.Timestamp = temp & 0x1FFFFFFFFFFF;
       results.EventType = ((temp >> 45) & 0xF) ? XCL_PERF_MON_END_EVENT : 
@@ -859,7 +1051,7 @@ namespace xocl {
       results.Overflow = (temp >> 62) & 0x1;
       results.Error = (temp >> 63) & 0x1;
       results.EventID = XCL_PERF_MON_HW_EVENT;
-      traceVector.mArray[wordnum - clockWordIndex + 1] = results;
+      traceVector.mArray[numResults++] = results;
 
       if (mLogStream.is_open()) {
         mLogStream << "  Trace sample " << std::dec << wordnum << ": ";
@@ -874,6 +1066,7 @@ namespace xocl {
         mLogStream << std::endl;
       }
     }
+    traceVector.mLength = numResults;
 
     return size;
   }
@@ -899,6 +1092,24 @@ size_t xclPerfMonReadCounters(xclDeviceHandle handle, xclPerfMonType type, xclCo
   return drv ? drv->xclPerfMonReadCounters(type, counterResults) : -ENODEV;
 }
 
+size_t xclPerfMonSampleCounters(xclDeviceHandle handle, xclCounterSample& sample)
+{
+  xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
+  return drv ? drv->xclPerfMonSampleCounters(sample) : -ENODEV;
+}
+
+int xclPerfMonStartSampling(xclDeviceHandle handle, unsigned int intervalMsec)
+{
+  xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
+  return drv ? drv->xclPerfMonStartSampling(intervalMsec) : -ENODEV;
+}
+
+int xclPerfMonStopSampling(xclDeviceHandle handle)
+{
+  xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
+  return drv ? drv->xclPerfMonStopSampling() : -ENODEV;
+}
+
 size_t xclPerfMonClockTraining(xclDeviceHandle handle, xclPerfMonType type)
 {
   xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
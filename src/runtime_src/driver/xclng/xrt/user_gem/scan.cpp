@@ -33,6 +33,11 @@
 #define ADVANTECH_ID 0x13fe
 
 static const std::string sysfs_root = "/sys/bus/pci/devices/";
+static const std::string sysfs_drivers = "/sys/bus/pci/drivers/";
+
+// PCIE drivers of the mgmt and user pfs, only functions bound to one of
+// them have the mgmt_pf or user_pf entry the scan looks for
+static const char *xrt_drivers[] = { "xclmgmt", "xocl_xdma", "xocl_qdma" };
 
 // Helper to find subdevice directory name
 // Assumption: all subdevice's sysfs directory name starts with subdevice name!!
@@ -431,22 +436,26 @@ private:
     pci_device_scanner& operator=(const pci_device_scanner& s);
 }; /* pci_device_scanner */
 
-void pci_device_scanner::pci_device_scanner::rescan_nolock()
+// Collect the supported functions listed in dir. Driver directories
+// also hold entries such as bind and new_id, only PCIE addresses are
+// probed.
+static void scan_dir(const std::string& path, bool bdf_only,
+    std::vector<std::unique_ptr<pcidev::pci_func>>& mgmt_devices,
+    std::vector<std::unique_ptr<pcidev::pci_func>>& user_devices)
 {
-    std::vector<std::unique_ptr<pcidev::pci_func>> mgmt_devices;
-    std::vector<std::unique_ptr<pcidev::pci_func>> user_devices;
     DIR *dir;
     struct dirent *entry;
+    uint16_t dom, b, d, f;
 
-    dev_list.clear();
-
-    dir = opendir(sysfs_root.c_str());
-    if(!dir) {
-        std::cout << "Cannot open " << sysfs_root << std::endl;
+    dir = opendir(path.c_str());
+    if(!dir)
         return;
-    }
 
     while((entry = readdir(dir))) {
+        if (bdf_only && sscanf(entry->d_name, "%hx:%hx:%hx.%hx",
+            &dom, &b, &d, &f) < 4)
+            continue;
+
         std::unique_ptr<pcidev::pci_func> pf(
             new pcidev::pci_func(std::string(entry->d_name)));
         if(pf->vendor_id == INVALID_ID)
@@ -460,6 +469,34 @@ void pci_device_scanner::pci_device_scanner::rescan_nolock()
     }
 
     (void) closedir(dir);
+}
+
+void pci_device_scanner::pci_device_scanner::rescan_nolock()
+{
+    std::vector<std::unique_ptr<pcidev::pci_func>> mgmt_devices;
+    std::vector<std::unique_ptr<pcidev::pci_func>> user_devices;
+    bool found_driver = false;
+
+    dev_list.clear();
+
+    // Walking the functions bound to our drivers avoids probing every
+    // PCIE function in the system, fall back to the full device list
+    // when none of the drivers is registered
+    for (auto drv : xrt_drivers) {
+        const std::string path = sysfs_drivers + drv;
+        if (access(path.c_str(), F_OK) != 0)
+            continue;
+        found_driver = true;
+        scan_dir(path, true, mgmt_devices, user_devices);
+    }
+
+    if (!found_driver) {
+        if (access(sysfs_root.c_str(), F_OK) != 0) {
+            std::cout << "Cannot open " << sysfs_root << std::endl;
+            return;
+        }
+        scan_dir(sysfs_root, false, mgmt_devices, user_devices);
+    }
 
     num_ready = add_to_device_list(mgmt_devices, user_devices, dev_list);
 }
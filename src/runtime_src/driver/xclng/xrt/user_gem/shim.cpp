@@ -23,10 +23,12 @@
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <algorithm>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/uio.h>
 #include <cstring>
+#include <cstdio>
 #include <thread>
 #include <chrono>
 #include <unistd.h>
@@ -59,6 +61,20 @@ is_multiprocess_mode()
   return val;
 }
 
+inline bool
+is_map_cache_enabled()
+{
+  static bool val = std::getenv("XCL_BO_MAP_CACHE") != nullptr;
+  return val;
+}
+
+inline bool
+is_ctx_cache_enabled()
+{
+  static bool val = std::getenv("XCL_CTX_CACHE") != nullptr;
+  return val;
+}
+
 /*
  * wordcopy()
  *
@@ -130,6 +146,111 @@ inline int io_getevents(aio_context_t ctx, long min_nr, long max_nr,
         return syscall(__NR_io_getevents, ctx, min_nr, max_nr, events, timeout);
 }
 
+/*
+ * Layout of the completion ring the kernel maps at the aio context address,
+ * see fs/aio.c.  Completions can be reaped from it without a system call.
+ */
+#define SHIM_AIO_RING_MAGIC	0xa10a10a1
+
+struct shim_aio_ring {
+        unsigned id;
+        unsigned nr;
+        unsigned head;
+        unsigned tail;
+        unsigned magic;
+        unsigned compat_features;
+        unsigned incompat_features;
+        unsigned header_length;
+        struct io_event io_events[0];
+};
+
+// Device info, usage and error status are served from a snapshot no older
+// than this, 0 reads sysfs on every query
+inline unsigned int
+sysfs_cache_msec()
+{
+  static unsigned int val = std::getenv("XCL_SYSFS_CACHE_MSEC") ?
+    std::atoi(std::getenv("XCL_SYSFS_CACHE_MSEC")) : 200;
+  return val;
+}
+
+// True, and restamped, when a snapshot taken at stamp must be refreshed
+static bool
+sysfs_cache_stale(std::chrono::steady_clock::time_point& stamp)
+{
+  auto now = std::chrono::steady_clock::now();
+  if (stamp != std::chrono::steady_clock::time_point() &&
+      now - stamp < std::chrono::milliseconds(sysfs_cache_msec()))
+    return false;
+  stamp = now;
+  return true;
+}
+
+/*
+ * Sensors of one subdevice, read in one go from its sensors_raw node
+ * ("<name> <value>" per line) or one file per sensor with older drivers
+ */
+class sysfs_sensors {
+  pcidev::pci_func *mFunc;
+  std::string mSubdev;
+  std::map<std::string, uint64_t> mValues;
+  bool mRaw = false;
+
+public:
+  sysfs_sensors(pcidev::pci_func *func, const std::string& subdev)
+    : mFunc(func), mSubdev(subdev)
+  {
+    std::string errmsg;
+    std::vector<std::string> lines;
+    mFunc->sysfs_get(mSubdev, "sensors_raw", errmsg, lines);
+    if (!errmsg.empty() || lines.empty())
+      return;
+
+    mRaw = true;
+    for (auto& line : lines) {
+      std::stringstream ss(line);
+      std::string name, value;
+      if (ss >> name >> value)
+        mValues[name] = std::strtoull(value.c_str(), nullptr, 0);
+    }
+  }
+
+  template <typename T>
+  void get(const std::string& name, T& val)
+  {
+    if (!mRaw) {
+      std::string errmsg;
+      mFunc->sysfs_get(mSubdev, name, errmsg, val);
+      return;
+    }
+    auto it = mValues.find(name);
+    val = (it != mValues.end()) ? static_cast<T>(it->second) : static_cast<T>(-1);
+  }
+};
+
+inline bool
+is_qdma_poll_mode()
+{
+  static bool val = std::getenv("XCL_QDMA_POLL_MODE") != nullptr;
+  return val;
+}
+
+/*
+ * Id of an xclbin as known to the driver, legacy xclbins without uuid are
+ * identified by their timestamp.
+ */
+inline void
+get_xclbin_id(const axlf *buffer, unsigned char id[16])
+{
+  const unsigned char *uuid =
+    reinterpret_cast<const unsigned char *>(&buffer->m_header.uuid);
+  std::memset(id, 0, 16);
+  if (std::all_of(uuid, uuid + 16, [](unsigned char c) { return c == 0; }))
+    std::memcpy(id, &buffer->m_header.m_timeStamp, 8);
+  else
+    std::memcpy(id, uuid, 16);
+}
+
 /*
  * XOCLShim()
  */
@@ -231,6 +352,8 @@ xocl::XOCLShim::~XOCLShim()
 {
     auto dev = pcidev::get_dev(mBoardNumber);
 
+    xclPerfMonStopSampling();
+
     if (mLogStream.is_open()) {
         mLogStream << __func__ << ", " << std::this_thread::get_id() << std::endl;
         mLogStream.close();
@@ -253,6 +376,12 @@ xocl::XOCLShim::~XOCLShim()
 
     if (mAioEnabled)
 	    io_destroy(mAioContext);
+
+    if (mExecRing != nullptr)
+        xclUnmapBO(mExecRingBO, mExecRing);
+
+    for (auto& entry : mMapCache)
+        munmap(entry.second.addr, entry.second.size);
 }
 
 /*
@@ -440,6 +569,14 @@ unsigned int xocl::XOCLShim::xclAllocUserPtrBO(void *userptr, size_t size, unsig
  */
 void xocl::XOCLShim::xclFreeBO(unsigned int boHandle)
 {
+    if (is_map_cache_enabled()) {
+        std::lock_guard<std::mutex> lk(mMapCacheLock);
+        auto it = mMapCache.find(boHandle);
+        if (it != mMapCache.end()) {
+            munmap(it->second.addr, it->second.size);
+            mMapCache.erase(it);
+        }
+    }
     drm_gem_close closeInfo = {boHandle, 0};
     ioctl(mUserHandle, DRM_IOCTL_GEM_CLOSE, &closeInfo);
 }
@@ -466,10 +603,28 @@ int xocl::XOCLShim::xclReadBO(unsigned int boHandle, void *dst, size_t size, siz
     return ret ? -errno : ret;
 }
 
+/*
+ * xclWriteSyncBO()
+ */
+int xocl::XOCLShim::xclWriteSyncBO(unsigned int boHandle, const void *src, size_t size, size_t seek)
+{
+    drm_xocl_pwrite_bo pwriteInfo = { boHandle, 0, seek, size, reinterpret_cast<uint64_t>(src) };
+    return ioctl(mUserHandle, DRM_IOCTL_XOCL_PWRITE_SYNC_BO, &pwriteInfo) ? -errno : 0;
+}
+
+/*
+ * xclSyncReadBO()
+ */
+int xocl::XOCLShim::xclSyncReadBO(unsigned int boHandle, void *dst, size_t size, size_t skip)
+{
+    drm_xocl_pread_bo preadInfo = { boHandle, 0, skip, size, reinterpret_cast<uint64_t>(dst) };
+    return ioctl(mUserHandle, DRM_IOCTL_XOCL_PREAD_SYNC_BO, &preadInfo) ? -errno : 0;
+}
+
 /*
  * xclMapBO()
  */
-void *xocl::XOCLShim::xclMapBO(unsigned int boHandle, bool write)
+void *xocl::XOCLShim::mapBO(unsigned int boHandle, bool write, size_t *size)
 {
     drm_xocl_info_bo info = { boHandle, 0, 0 };
     int result = ioctl(mUserHandle, DRM_IOCTL_XOCL_INFO_BO, &info);
@@ -483,8 +638,72 @@ void *xocl::XOCLShim::xclMapBO(unsigned int boHandle, bool write)
         return nullptr;
     }
 
-    return mmap(0, info.size, (write ? (PROT_READ|PROT_WRITE) : PROT_READ),
-              MAP_SHARED, mUserHandle, mapInfo.offset);
+    void *addr = mmap(0, info.size, (write ? (PROT_READ|PROT_WRITE) : PROT_READ),
+                      MAP_SHARED, mUserHandle, mapInfo.offset);
+    if (addr == MAP_FAILED) {
+        return addr;
+    }
+    *size = info.size;
+    return addr;
+}
+
+void *xocl::XOCLShim::xclMapBO(unsigned int boHandle, bool write)
+{
+    size_t size = 0;
+    if (!is_map_cache_enabled()) {
+        return mapBO(boHandle, write, &size);
+    }
+
+    // Cached mappings are always read/write so that one mapping serves
+    // every caller of the BO until it is freed
+    std::lock_guard<std::mutex> lk(mMapCacheLock);
+    auto it = mMapCache.find(boHandle);
+    if (it != mMapCache.end()) {
+        ++it->second.refs;
+        return it->second.addr;
+    }
+
+    void *addr = mapBO(boHandle, true, &size);
+    if (addr == nullptr || addr == MAP_FAILED) {
+        return addr;
+    }
+    mMapCache[boHandle] = BOMapping{addr, size, 1};
+    return addr;
+}
+
+/*
+ * xclUnmapBO()
+ */
+int xocl::XOCLShim::xclUnmapBO(unsigned int boHandle, void *addr)
+{
+    if (is_map_cache_enabled()) {
+        // Keep the mapping for the next xclMapBO, it is torn down in xclFreeBO
+        std::lock_guard<std::mutex> lk(mMapCacheLock);
+        auto it = mMapCache.find(boHandle);
+        if (it == mMapCache.end() || it->second.addr != addr) {
+            return -EINVAL;
+        }
+        if (it->second.refs) {
+            --it->second.refs;
+        }
+        return 0;
+    }
+
+    drm_xocl_info_bo info = { boHandle, 0, 0 };
+    int result = ioctl(mUserHandle, DRM_IOCTL_XOCL_INFO_BO, &info);
+    if (result) {
+        return -errno;
+    }
+    return munmap(addr, info.size) ? -errno : 0;
+}
+
+// DMA channel preferred by syncs of this thread, see xclSetSyncChannel()
+static thread_local int sync_channel = -1;
+
+static uint32_t
+syncFlags()
+{
+    return (sync_channel < 0) ? 0 : DRM_XOCL_SYNC_BO_CHANNEL(sync_channel);
 }
 
 /*
@@ -496,11 +715,64 @@ int xocl::XOCLShim::xclSyncBO(unsigned int boHandle, xclBOSyncDirection dir, siz
     drm_xocl_sync_bo_dir drm_dir = (dir == XCL_BO_SYNC_BO_TO_DEVICE) ?
             DRM_XOCL_SYNC_BO_TO_DEVICE :
             DRM_XOCL_SYNC_BO_FROM_DEVICE;
-    drm_xocl_sync_bo syncInfo = {boHandle, 0, size, offset, drm_dir};
+    drm_xocl_sync_bo syncInfo = {boHandle, syncFlags(), size, offset, drm_dir};
     ret = ioctl(mUserHandle, DRM_IOCTL_XOCL_SYNC_BO, &syncInfo);
     return ret ? -errno : ret;
 }
 
+/*
+ * xclSyncBOAsync()
+ */
+int xocl::XOCLShim::xclSyncBOAsync(unsigned int boHandle, xclBOSyncDirection dir, size_t size, size_t offset, int fd)
+{
+    int ret;
+    drm_xocl_sync_bo_dir drm_dir = (dir == XCL_BO_SYNC_BO_TO_DEVICE) ?
+            DRM_XOCL_SYNC_BO_TO_DEVICE :
+            DRM_XOCL_SYNC_BO_FROM_DEVICE;
+    drm_xocl_sync_bo_async syncInfo = {boHandle, 0, size, offset, drm_dir, fd};
+    ret = ioctl(mUserHandle, DRM_IOCTL_XOCL_SYNC_BO_ASYNC, &syncInfo);
+    return ret ? -errno : ret;
+}
+
+/*
+ * xclSyncBOv()
+ *
+ * The driver accepts at most DRM_XOCL_SYNC_BO_V_MAX ranges per ioctl,
+ * more ranges are split.
+ */
+int xocl::XOCLShim::xclSyncBOv(const xclBOSyncRange *ranges, size_t num)
+{
+    std::vector<drm_xocl_sync_bo> syncInfo;
+    syncInfo.reserve(std::min<size_t>(num,DRM_XOCL_SYNC_BO_V_MAX));
+    while (num) {
+        auto count = std::min<size_t>(num,DRM_XOCL_SYNC_BO_V_MAX);
+        syncInfo.clear();
+        for (size_t i = 0; i < count; ++i) {
+            drm_xocl_sync_bo_dir drm_dir = (ranges[i].dir == XCL_BO_SYNC_BO_TO_DEVICE) ?
+                    DRM_XOCL_SYNC_BO_TO_DEVICE :
+                    DRM_XOCL_SYNC_BO_FROM_DEVICE;
+            syncInfo.push_back({ranges[i].boHandle, syncFlags(), ranges[i].size, ranges[i].offset, drm_dir});
+        }
+        drm_xocl_sync_bo_v vec = {static_cast<uint32_t>(count), 0, reinterpret_cast<uint64_t>(syncInfo.data())};
+        if (ioctl(mUserHandle, DRM_IOCTL_XOCL_SYNC_BO_V, &vec))
+            return -errno;
+        ranges += count;
+        num -= count;
+    }
+    return 0;
+}
+
+/*
+ * xclSetSyncChannel()
+ */
+int xocl::XOCLShim::xclSetSyncChannel(int channel)
+{
+    if (channel > DRM_XOCL_SYNC_BO_CHANNEL_MASK)
+        return -EINVAL;
+    sync_channel = (channel < 0) ? -1 : channel;
+    return 0;
+}
+
 /*
  * xclCopyBO()
  */
@@ -545,16 +817,24 @@ void xocl::XOCLShim::xclSysfsGetErrorStatus(xclErrorStatus& stat)
 int xocl::XOCLShim::xclGetErrorStatus(xclErrorStatus *info)
 {
 #ifdef AXI_FIREWALL
+    std::lock_guard<std::mutex> lock(mSysfsCacheLock);
+    if (sysfs_cache_stale(mSysfsErrorTime)) {
+        std::memset(&mSysfsError, 0, sizeof(xclErrorStatus));
+        xclSysfsGetErrorStatus(mSysfsError);
+    }
+    *info = mSysfsError;
+#else
     std::memset(info, 0, sizeof(xclErrorStatus));
-    xclSysfsGetErrorStatus(*info);
 #endif  // AXI Firewall
     return 0;
 }
 
 /*
- * xclSysfsGetDeviceInfo()
+ * xclSysfsGetStaticInfo()
+ *
+ * Fields that do not change while the device is open
  */
-void xocl::XOCLShim::xclSysfsGetDeviceInfo(xclDeviceInfo2 *info)
+void xocl::XOCLShim::xclSysfsGetStaticInfo(xclDeviceInfo2 *info)
 {
     std::string s;
     std::string errmsg;
@@ -579,52 +859,70 @@ void xocl::XOCLShim::xclSysfsGetDeviceInfo(xclDeviceInfo2 *info)
 
     info->mNumClocks = numClocks(info->mName);
 
-    dev->mgmt->sysfs_get("", "link_width", errmsg, info->mPCIeLinkWidth);
-    dev->mgmt->sysfs_get("", "link_speed", errmsg, info->mPCIeLinkSpeed);
     dev->mgmt->sysfs_get("", "link_speed_max", errmsg, info->mPCIeLinkSpeedMax);
     dev->mgmt->sysfs_get("", "link_width_max", errmsg, info->mPCIeLinkWidthMax);
 
     dev->mgmt->sysfs_get("", "version", errmsg, info->mDriverVersion);
     dev->mgmt->sysfs_get("", "slot", errmsg, info->mPciSlot);
+    // -1 when the node can't be read or the device has none
+    int numa_node = -1;
+    dev->mgmt->sysfs_get("", "numa_node", errmsg, numa_node);
+    info->mNumaNode = (numa_node < 0) ? -1 : numa_node;
     dev->mgmt->sysfs_get("", "xpr", errmsg, info->mIsXPR);
-    dev->mgmt->sysfs_get("", "mig_calibration", errmsg, info->mMigCalib);
-
-    dev->mgmt->sysfs_get("sysmon", "temp", errmsg, info->mOnChipTemp);
-    info->mOnChipTemp /= 1000;
-    dev->mgmt->sysfs_get("sysmon", "vcc_int", errmsg, info->mVInt);
-    dev->mgmt->sysfs_get("sysmon", "vcc_aux", errmsg, info->mVAux);
-    dev->mgmt->sysfs_get("sysmon", "vcc_bram", errmsg, info->mVBram);
 
     dev->mgmt->sysfs_get("microblaze", "version", errmsg, info->mMBVersion);
+}
+
+/*
+ * xclSysfsGetDeviceInfo()
+ *
+ * Fields that change at run time, sensors are batched per subdevice
+ */
+void xocl::XOCLShim::xclSysfsGetDeviceInfo(xclDeviceInfo2 *info)
+{
+    std::string errmsg;
+    auto dev = pcidev::get_dev(mBoardNumber);
 
-    dev->mgmt->sysfs_get("xmc", "version", errmsg, info->mXMCVersion);
-    dev->mgmt->sysfs_get("xmc", "xmc_12v_pex_vol", errmsg, info->m12VPex);
-    dev->mgmt->sysfs_get("xmc", "xmc_12v_aux_vol", errmsg, info->m12VAux);
-    dev->mgmt->sysfs_get("xmc", "xmc_12v_pex_curr", errmsg, info->mPexCurr);
-    dev->mgmt->sysfs_get("xmc", "xmc_12v_aux_curr", errmsg, info->mAuxCurr);
-    dev->mgmt->sysfs_get("xmc", "xmc_dimm_temp0", errmsg, info->mDimmTemp[0]);
-    dev->mgmt->sysfs_get("xmc", "xmc_dimm_temp1", errmsg, info->mDimmTemp[1]);
-    dev->mgmt->sysfs_get("xmc", "xmc_dimm_temp2", errmsg, info->mDimmTemp[2]);
-    dev->mgmt->sysfs_get("xmc", "xmc_dimm_temp3", errmsg, info->mDimmTemp[3]);
-    dev->mgmt->sysfs_get("xmc", "xmc_se98_temp0", errmsg, info->mSE98Temp[0]);
-    dev->mgmt->sysfs_get("xmc", "xmc_se98_temp1", errmsg, info->mSE98Temp[1]);
-    dev->mgmt->sysfs_get("xmc", "xmc_se98_temp2", errmsg, info->mSE98Temp[2]);
-    dev->mgmt->sysfs_get("xmc", "xmc_fan_temp", errmsg, info->mFanTemp);
-    dev->mgmt->sysfs_get("xmc", "xmc_fan_rpm", errmsg, info->mFanRpm);
-    dev->mgmt->sysfs_get("xmc", "xmc_3v3_pex_vol", errmsg, info->m3v3Pex);
-    dev->mgmt->sysfs_get("xmc", "xmc_3v3_aux_vol", errmsg, info->m3v3Aux);
-    dev->mgmt->sysfs_get("xmc", "xmc_ddr_vpp_btm", errmsg, info->mDDRVppBottom);
-    dev->mgmt->sysfs_get("xmc", "xmc_ddr_vpp_top", errmsg, info->mDDRVppTop);
-    dev->mgmt->sysfs_get("xmc", "xmc_sys_5v5", errmsg, info->mSys5v5);
-    dev->mgmt->sysfs_get("xmc", "xmc_1v2_top", errmsg, info->m1v2Top);
-    dev->mgmt->sysfs_get("xmc", "xmc_1v8", errmsg, info->m1v8Top);
-    dev->mgmt->sysfs_get("xmc", "xmc_0v85", errmsg, info->m0v85);
-    dev->mgmt->sysfs_get("xmc", "xmc_mgt0v9avcc", errmsg, info->mMgt0v9);
-    dev->mgmt->sysfs_get("xmc", "xmc_12v_sw", errmsg, info->m12vSW);
-    dev->mgmt->sysfs_get("xmc", "xmc_mgtavtt", errmsg, info->mMgtVtt);
-    dev->mgmt->sysfs_get("xmc", "xmc_vcc1v2_btm", errmsg, info->m1v2Bottom);
-    dev->mgmt->sysfs_get("xmc", "xmc_vccint_vol", errmsg, info->mVccIntVol);
-    dev->mgmt->sysfs_get("xmc", "xmc_vccint_curr", errmsg, info->mVccIntCurr);
+    dev->mgmt->sysfs_get("", "link_width", errmsg, info->mPCIeLinkWidth);
+    dev->mgmt->sysfs_get("", "link_speed", errmsg, info->mPCIeLinkSpeed);
+    dev->mgmt->sysfs_get("", "mig_calibration", errmsg, info->mMigCalib);
+
+    sysfs_sensors sysmon(dev->mgmt.get(), "sysmon");
+    sysmon.get("temp", info->mOnChipTemp);
+    info->mOnChipTemp /= 1000;
+    sysmon.get("vcc_int", info->mVInt);
+    sysmon.get("vcc_aux", info->mVAux);
+    sysmon.get("vcc_bram", info->mVBram);
+
+    sysfs_sensors xmc(dev->mgmt.get(), "xmc");
+    xmc.get("version", info->mXMCVersion);
+    xmc.get("xmc_12v_pex_vol", info->m12VPex);
+    xmc.get("xmc_12v_aux_vol", info->m12VAux);
+    xmc.get("xmc_12v_pex_curr", info->mPexCurr);
+    xmc.get("xmc_12v_aux_curr", info->mAuxCurr);
+    xmc.get("xmc_dimm_temp0", info->mDimmTemp[0]);
+    xmc.get("xmc_dimm_temp1", info->mDimmTemp[1]);
+    xmc.get("xmc_dimm_temp2", info->mDimmTemp[2]);
+    xmc.get("xmc_dimm_temp3", info->mDimmTemp[3]);
+    xmc.get("xmc_se98_temp0", info->mSE98Temp[0]);
+    xmc.get("xmc_se98_temp1", info->mSE98Temp[1]);
+    xmc.get("xmc_se98_temp2", info->mSE98Temp[2]);
+    xmc.get("xmc_fan_temp", info->mFanTemp);
+    xmc.get("xmc_fan_rpm", info->mFanRpm);
+    xmc.get("xmc_3v3_pex_vol", info->m3v3Pex);
+    xmc.get("xmc_3v3_aux_vol", info->m3v3Aux);
+    xmc.get("xmc_ddr_vpp_btm", info->mDDRVppBottom);
+    xmc.get("xmc_ddr_vpp_top", info->mDDRVppTop);
+    xmc.get("xmc_sys_5v5", info->mSys5v5);
+    xmc.get("xmc_1v2_top", info->m1v2Top);
+    xmc.get("xmc_1v8", info->m1v8Top);
+    xmc.get("xmc_0v85", info->m0v85);
+    xmc.get("xmc_mgt0v9avcc", info->mMgt0v9);
+    xmc.get("xmc_12v_sw", info->m12vSW);
+    xmc.get("xmc_mgtavtt", info->mMgtVtt);
+    xmc.get("xmc_vcc1v2_btm", info->m1v2Bottom);
+    xmc.get("xmc_vccint_vol", info->mVccIntVol);
+    xmc.get("xmc_vccint_curr", info->mVccIntCurr);
 
     std::vector<uint64_t> freqs;
     dev->mgmt->sysfs_get("icap", "clock_freqs", errmsg, freqs);
@@ -646,16 +944,37 @@ void xocl::XOCLShim::xclSysfsGetDeviceInfo(xclDeviceInfo2 *info)
  */
 int xocl::XOCLShim::xclGetDeviceInfo2(xclDeviceInfo2 *info)
 {
-    std::memset(info, 0, sizeof(xclDeviceInfo2));
-    info->mMagic = 0X586C0C6C;
-    info->mHALMajorVersion = XCLHAL_MAJOR_VER;
-    info->mHALMinorVersion = XCLHAL_MINOR_VER;
-    info->mMinTransferSize = DDR_BUFFER_ALIGNMENT;
-    info->mDMAThreads = 2;
-    xclSysfsGetDeviceInfo(info);
+    std::lock_guard<std::mutex> lock(mSysfsCacheLock);
+    if (!mSysfsStaticValid) {
+        std::memset(&mSysfsInfo, 0, sizeof(xclDeviceInfo2));
+        mSysfsInfo.mMagic = 0X586C0C6C;
+        mSysfsInfo.mHALMajorVersion = XCLHAL_MAJOR_VER;
+        mSysfsInfo.mHALMinorVersion = XCLHAL_MINOR_VER;
+        mSysfsInfo.mMinTransferSize = DDR_BUFFER_ALIGNMENT;
+        mSysfsInfo.mDMAThreads = 2;
+        xclSysfsGetStaticInfo(&mSysfsInfo);
+        mSysfsStaticValid = true;
+        mSysfsInfoTime = std::chrono::steady_clock::time_point();
+    }
+    if (sysfs_cache_stale(mSysfsInfoTime))
+        xclSysfsGetDeviceInfo(&mSysfsInfo);
+    *info = mSysfsInfo;
     return 0;
 }
 
+/*
+ * invalidateSysfsCache()
+ *
+ * Downloads, reclocking and resets change what the snapshots report
+ */
+void xocl::XOCLShim::invalidateSysfsCache()
+{
+    std::lock_guard<std::mutex> lock(mSysfsCacheLock);
+    mSysfsInfoTime = std::chrono::steady_clock::time_point();
+    mSysfsUsageTime = std::chrono::steady_clock::time_point();
+    mSysfsErrorTime = std::chrono::steady_clock::time_point();
+}
+
 /*
  * resetDevice()
  */
@@ -665,10 +984,12 @@ int xocl::XOCLShim::resetDevice(xclResetKind kind)
     // Call a new IOCTL to just reset the OCL region
     if (kind == XCL_RESET_FULL) {
         ret =  ioctl(mMgtHandle, XCLMGMT_IOCHOTRESET);
+        invalidateSysfsCache();
         return ret ? -errno : ret;
     }
     else if (kind == XCL_RESET_KERNEL) {
         ret = ioctl(mMgtHandle, XCLMGMT_IOCOCLRESET);
+        invalidateSysfsCache();
         return ret ? -errno : ret;
     }
     return -EINVAL;
@@ -710,6 +1031,7 @@ int xocl::XOCLShim::xclReClock2(unsigned short region, const unsigned short *tar
     obj.ocl_target_freq[0] = targetFreqMHz[0];
     obj.ocl_target_freq[1] = targetFreqMHz[1];
     ret = ioctl(mMgtHandle, XCLMGMT_IOCFREQSCALE, &obj);
+    invalidateSysfsCache();
     return ret ? -errno : ret;
 }
 
@@ -776,6 +1098,7 @@ int xocl::XOCLShim::xclLoadXclBin(const xclBin *buffer)
     }
 
     mIsDebugIpLayoutRead = false;
+    invalidateSysfsCache();
 
     return ret;
 }
@@ -794,16 +1117,29 @@ int xocl::XOCLShim::xclLoadAxlf(const axlf *buffer)
         return -EPERM;
     }
 
-    const unsigned cmd = XCLMGMT_IOCICAPDOWNLOAD_AXLF;
-    xclmgmt_ioc_bitstream_axlf obj = {const_cast<axlf *>(buffer)};
-    int ret = ioctl(mMgtHandle, cmd, &obj);
+    releaseIdleContexts();
+
+    // The driver does not download an xclbin whose uuid is already on the
+    // device, so the DDR is not reinitialized either
+    const bool loaded = isXclbinLoaded(buffer);
+
+    // Images kept by the driver are downloaded without passing the whole
+    // xclbin in again, anything else falls back to the full download
+    xclmgmt_ioc_bitstream_uuid uuid_obj;
+    get_xclbin_id(buffer, uuid_obj.uuid);
+    int ret = ioctl(mMgtHandle, XCLMGMT_IOCICAPDOWNLOAD_UUID, &uuid_obj);
+    if (ret && (errno == ENOENT || errno == ENOTTY || errno == EINVAL)) {
+        const unsigned cmd = XCLMGMT_IOCICAPDOWNLOAD_AXLF;
+        xclmgmt_ioc_bitstream_axlf obj = {const_cast<axlf *>(buffer)};
+        ret = ioctl(mMgtHandle, cmd, &obj);
+    }
     if(ret) {
         return ret ? -errno : ret;
     }
 
     // If it is an XPR DSA, zero out the DDR again as downloading the XCLBIN
     // reinitializes the DDR and results in ECC error.
-    if(isXPR())
+    if(isXPR() && !loaded)
     {
         if (mLogStream.is_open()) {
             mLogStream << __func__ << "XPR Device found, zeroing out DDR again.." << std::endl;
@@ -829,6 +1165,50 @@ int xocl::XOCLShim::xclLoadAxlf(const axlf *buffer)
     return ret ? -errno : ret;
 }
 
+/*
+ * isXclbinLoaded()
+ *
+ * Compare the xclbin uuid and unique id against the ones reported by
+ * the user pf, the same check icap uses to skip a download.  Legacy
+ * xclbins are identified by their timestamp as in the driver.
+ */
+bool xocl::XOCLShim::isXclbinLoaded(const axlf *buffer)
+{
+    unsigned char id[16];
+    get_xclbin_id(buffer, id);
+
+    char str[40];
+    std::snprintf(str, sizeof(str),
+        "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+        id[0], id[1], id[2], id[3], id[4], id[5], id[6], id[7],
+        id[8], id[9], id[10], id[11], id[12], id[13], id[14], id[15]);
+
+    std::string errmsg;
+    std::string loaded;
+    pcidev::get_dev(mBoardNumber)->user->sysfs_get("", "xclbinuuid", errmsg, loaded);
+    if (!errmsg.empty() || loaded.compare(0, std::strlen(str), str))
+        return false;
+
+    // icap also requires the unique id to match
+    std::string uniqueid;
+    pcidev::get_dev(mBoardNumber)->user->sysfs_get("", "xclbinid", errmsg, uniqueid);
+    if (!errmsg.empty())
+        return false;
+    try {
+        if (std::stoull(uniqueid, nullptr, 16) != buffer->m_uniqueId)
+            return false;
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+
+    if (mLogStream.is_open()) {
+        mLogStream << __func__ << ", " << std::this_thread::get_id()
+                   << ", xclbin " << str << " already loaded" << std::endl;
+    }
+    return true;
+}
+
 /*
  * xclExportBO()
  */
@@ -926,12 +1306,10 @@ void xocl::XOCLShim::xclSysfsGetUsageInfo(drm_xocl_usage_stat& stat)
     std::string errmsg;
     std::vector<std::string> dmaStatStrs;
     std::vector<std::string> mmStatStrs;
-    std::vector<std::string> xmcStatStrs;
     auto dev = pcidev::get_dev(mBoardNumber);
 
     dev->user->sysfs_get("mm_dma", "channel_stat_raw", errmsg, dmaStatStrs);
     dev->user->sysfs_get("", "memstat_raw", errmsg, mmStatStrs);
-    dev->user->sysfs_get("microblaze", "version", errmsg, xmcStatStrs);
 
     if (!dmaStatStrs.empty()) {
         stat.dma_channel_count = dmaStatStrs.size();
@@ -959,9 +1337,15 @@ void xocl::XOCLShim::xclSysfsGetUsageInfo(drm_xocl_usage_stat& stat)
  */
 int xocl::XOCLShim::xclGetUsageInfo(xclDeviceUsage *info)
 {
-    drm_xocl_usage_stat stat = { 0 };
-
-    xclSysfsGetUsageInfo(stat);
+    drm_xocl_usage_stat stat;
+    {
+        std::lock_guard<std::mutex> lock(mSysfsCacheLock);
+        if (sysfs_cache_stale(mSysfsUsageTime)) {
+            std::memset(&mSysfsUsage, 0, sizeof(drm_xocl_usage_stat));
+            xclSysfsGetUsageInfo(mSysfsUsage);
+        }
+        stat = mSysfsUsage;
+    }
     std::memset(info, 0, sizeof(xclDeviceUsage));
     std::memcpy(info->h2c, stat.h2c, sizeof(size_t) * 8);
     std::memcpy(info->c2h, stat.c2h, sizeof(size_t) * 8);
@@ -1072,10 +1456,7 @@ void xocl::XOCLShim::xclFreeDeviceBuffer(uint64_t buf)
     }
 
     std::pair<unsigned, char *> bo = mLegacyAddressTable.erase(buf);
-    drm_xocl_info_bo boInfo = {bo.first, 0, 0, 0};
-    if (!ioctl(mUserHandle, DRM_IOCTL_XOCL_INFO_BO, &boInfo)) {
-        munmap(bo.second, boInfo.size);
-    }
+    xclUnmapBO(bo.first, bo.second);
     xclFreeBO(bo.first);
 }
 
@@ -1141,6 +1522,17 @@ ssize_t xocl::XOCLShim::xclUnmgdPread(unsigned flags, void *buf, size_t count, u
     return ioctl(mUserHandle, DRM_IOCTL_XOCL_PREAD_UNMGD, &unmgd);
 }
 
+/*
+ * xclUnmgdOpen()
+ */
+int xocl::XOCLShim::xclUnmgdOpen(unsigned flags)
+{
+    drm_xocl_unmgd_fd unmgd = {flags, -1};
+    if (ioctl(mUserHandle, DRM_IOCTL_XOCL_UNMGD_FD, &unmgd))
+        return -errno;
+    return unmgd.fd;
+}
+
 /*
  * xclExecBuf()
  */
@@ -1166,12 +1558,104 @@ int xocl::XOCLShim::xclExecBuf(unsigned int cmdBO, size_t num_bo_in_wait_list, u
     }
     int ret;
     unsigned int bwl[8] = {0};
+    if (num_bo_in_wait_list > 8)
+        return -EINVAL;
     std::memcpy(bwl,bo_wait_list,num_bo_in_wait_list*sizeof(unsigned int));
     drm_xocl_execbuf exec = {0, cmdBO, bwl[0],bwl[1],bwl[2],bwl[3],bwl[4],bwl[5],bwl[6],bwl[7]};
     ret = ioctl(mUserHandle, DRM_IOCTL_XOCL_EXECBUF, &exec);
     return ret ? -errno : ret;
 }
 
+/*
+ * xclExecBufBatch()
+ *
+ * The driver accepts at most DRM_XOCL_EXECBUF_BATCH_MAX exec buffers
+ * per ioctl, larger batches are split.  Each ioctl submits all or none
+ * of its exec buffers, so a failure leaves a submitted prefix.
+ */
+int xocl::XOCLShim::xclExecBufBatch(const unsigned int *cmdBOs, size_t num)
+{
+    if (mLogStream.is_open()) {
+        mLogStream << __func__ << ", " << std::this_thread::get_id() << ", " << num << std::endl;
+    }
+    size_t submitted = 0;
+    while (submitted < num) {
+        auto count = std::min<size_t>(num - submitted,DRM_XOCL_EXECBUF_BATCH_MAX);
+        drm_xocl_execbuf_batch batch = {0, static_cast<uint32_t>(count), reinterpret_cast<uint64_t>(cmdBOs + submitted)};
+        if (ioctl(mUserHandle, DRM_IOCTL_XOCL_EXECBUF_BATCH, &batch))
+            break;
+        submitted += count;
+    }
+    return submitted;
+}
+
+/*
+ * initExecRing()
+ *
+ * Allocate an exec buffer for the completion ring and register it with
+ * the driver.  Drivers without ring support reject the ioctl, in which
+ * case the ring is marked as not supported.  Called with mExecRingLock.
+ */
+void xocl::XOCLShim::initExecRing()
+{
+    mExecRingState = -1;
+    mExecRingBOSize = getpagesize();
+    mExecRingBO = xclAllocBO(mExecRingBOSize, xclBOKind(0), DRM_XOCL_BO_EXECBUF);
+    if (mExecRingBO == mNullBO)
+        return;
+
+    auto ring = static_cast<drm_xocl_exec_ring_buf*>(xclMapBO(mExecRingBO, true));
+    if (ring == nullptr || ring == MAP_FAILED) {
+        xclFreeBO(mExecRingBO);
+        return;
+    }
+
+    drm_xocl_exec_ring reg = {0, mExecRingBO};
+    if (ioctl(mUserHandle, DRM_IOCTL_XOCL_EXEC_RING, &reg)) {
+        xclUnmapBO(mExecRingBO, ring);
+        xclFreeBO(mExecRingBO);
+        return;
+    }
+
+    // The driver holds its own reference to the ring BO
+    mExecRing = ring;
+    mExecRingDropped = __atomic_load_n(&mExecRing->dropped, __ATOMIC_ACQUIRE);
+    mExecRingState = 1;
+}
+
+/*
+ * xclExecCompletions()
+ *
+ * Consume completed exec buffer handles from the completion ring.
+ * Returns number of handles copied to cmdBOs, -ENOSYS if the driver does
+ * not support a completion ring, or -EOVERFLOW if completions were
+ * dropped since last call, in which case the caller must check the
+ * state of all outstanding exec buffers.
+ */
+int xocl::XOCLShim::xclExecCompletions(unsigned int *cmdBOs, size_t max)
+{
+    std::lock_guard<std::mutex> lk(mExecRingLock);
+    if (mExecRingState == 0)
+        initExecRing();
+    if (mExecRingState < 0)
+        return -ENOSYS;
+
+    auto mask = mExecRing->size - 1;
+    auto head = mExecRing->head;
+    auto tail = __atomic_load_n(&mExecRing->tail, __ATOMIC_ACQUIRE);
+    size_t count = 0;
+    for (; head != tail && count < max; ++head)
+        cmdBOs[count++] = mExecRing->handles[head & mask];
+    __atomic_store_n(&mExecRing->head, head, __ATOMIC_RELEASE);
+
+    auto dropped = __atomic_load_n(&mExecRing->dropped, __ATOMIC_ACQUIRE);
+    if (dropped != mExecRingDropped) {
+        mExecRingDropped = dropped;
+        return -EOVERFLOW;
+    }
+    return count;
+}
+
 /*
  * xclRegisterEventNotify()
  */
@@ -1205,8 +1689,25 @@ int xocl::XOCLShim::xclOpenContext(uuid_t xclbinId, unsigned int ipIndex, bool s
     std::memcpy(ctx.xclbin_id, xclbinId, sizeof(uuid_t));
     ctx.cu_index = ipIndex;
     ctx.flags = flags;
+    if (!shared) {
+        ret = ioctl(mUserHandle, DRM_IOCTL_XOCL_CTX, &ctx);
+        return ret ? -errno : ret;
+    }
+
+    // The driver holds one reservation per process and CU, further opens
+    // of the same CU only take a reference
+    std::lock_guard<std::mutex> lock(mCtxLock);
+    auto key = std::make_pair(std::string(reinterpret_cast<const char *>(xclbinId), sizeof(uuid_t)), ipIndex);
+    auto it = mCtxRefs.find(key);
+    if (it != mCtxRefs.end()) {
+        ++it->second;
+        return 0;
+    }
     ret = ioctl(mUserHandle, DRM_IOCTL_XOCL_CTX, &ctx);
-    return ret ? -errno : ret;
+    if (ret)
+        return -errno;
+    mCtxRefs.emplace(key, 1);
+    return 0;
 }
 
 /*
@@ -1218,10 +1719,43 @@ int xocl::XOCLShim::xclCloseContext(uuid_t xclbinId, unsigned int ipIndex) const
     drm_xocl_ctx ctx = {XOCL_CTX_OP_FREE_CTX};
     std::memcpy(ctx.xclbin_id, xclbinId, sizeof(uuid_t));
     ctx.cu_index = ipIndex;
+
+    std::lock_guard<std::mutex> lock(mCtxLock);
+    auto key = std::make_pair(std::string(reinterpret_cast<const char *>(xclbinId), sizeof(uuid_t)), ipIndex);
+    auto it = mCtxRefs.find(key);
+    if (it != mCtxRefs.end()) {
+        if (it->second == 0)
+            return -EINVAL;
+        if (--it->second || is_ctx_cache_enabled())
+            return 0;
+        mCtxRefs.erase(it);
+    }
     ret = ioctl(mUserHandle, DRM_IOCTL_XOCL_CTX, &ctx);
     return ret ? -errno : ret;
 }
 
+/*
+ * releaseIdleContexts()
+ *
+ * Give up the driver reservations kept by XCL_CTX_CACHE that no longer
+ * have references, they pin the xclbin loaded on the device.
+ */
+void xocl::XOCLShim::releaseIdleContexts()
+{
+    std::lock_guard<std::mutex> lock(mCtxLock);
+    for (auto it = mCtxRefs.begin(); it != mCtxRefs.end();) {
+        if (it->second) {
+            ++it;
+            continue;
+        }
+        drm_xocl_ctx ctx = {XOCL_CTX_OP_FREE_CTX};
+        std::memcpy(ctx.xclbin_id, it->first.first.data(), sizeof(uuid_t));
+        ctx.cu_index = it->first.second;
+        (void) ioctl(mUserHandle, DRM_IOCTL_XOCL_CTX, &ctx);
+        it = mCtxRefs.erase(it);
+    }
+}
+
 /*
  * xclBootFPGA()
  */
@@ -1229,6 +1763,7 @@ int xocl::XOCLShim::xclBootFPGA()
 {
     int ret;
     ret = ioctl( mMgtHandle, XCLMGMT_IOCREBOOT );
+    invalidateSysfsCache();
     return ret ? -errno : ret;
 }
 
@@ -1338,9 +1873,9 @@ int xocl::XOCLShim::xclFreeQDMABuf(uint64_t buf_hdl)
  */
 int xocl::XOCLShim::xclPollCompletion(int min_compl, int max_compl, struct xclReqCompletion *comps, int* actual, int timeout /*ms*/)
 {
-    /* TODO: populate actual and timeout args correctly */
     struct timespec time;
-    time.tv_nsec = timeout*1000000;
+    time.tv_sec = timeout / 1000;
+    time.tv_nsec = (timeout % 1000) * 1000000;
 
     int num_evt, i;
 
@@ -1350,24 +1885,196 @@ int xocl::XOCLShim::xclPollCompletion(int min_compl, int max_compl, struct xclRe
         std::cout << __func__ << "ERROR: async io is not enabled" << std::endl;
         goto done;
     }
-    num_evt = io_getevents(mAioContext, min_compl, max_compl, (struct io_event *)comps, &time);
-    if (num_evt < min_compl) {
-        std::cout << __func__ << " ERROR: failed to poll Queue Completions" << std::endl;
-        goto done;
-    }
-    *actual = num_evt;
 
-    for (i = num_evt - 1; i >= 0; i--) {
-        comps[i].priv_data = (void *)((struct io_event *)comps)[i].data;
-        comps[i].nbytes = ((struct io_event *)comps)[i].res;
-        comps[i].err_code = ((struct io_event *)comps)[i].res2;
+    {
+        // Reap what is already in the completion ring, in poll mode spin
+        // on the ring until min_compl completions or timeout
+        std::lock_guard<std::mutex> lk(mAioReapLock);
+        int reaped = reapAioRing(max_compl, comps);
+        if (reaped >= 0 && is_qdma_poll_mode()) {
+            auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+            while (reaped < min_compl && std::chrono::steady_clock::now() < end)
+                reaped += reapAioRing(max_compl - reaped, comps + reaped);
+        }
+
+        if (reaped >= 0 && (reaped >= min_compl || is_qdma_poll_mode())) {
+            *actual = reaped;
+            num_evt = (reaped >= min_compl) ? 0 : reaped;
+            if (num_evt)
+                std::cout << __func__ << " ERROR: failed to poll Queue Completions" << std::endl;
+            goto done;
+        }
+        reaped = std::max(reaped, 0);
+
+        auto rest = comps + reaped;
+        num_evt = io_getevents(mAioContext, std::max(min_compl - reaped, 0), max_compl - reaped,
+                               (struct io_event *)rest, &time);
+        for (i = num_evt - 1; i >= 0; i--) {
+            rest[i].priv_data = (void *)((struct io_event *)rest)[i].data;
+            rest[i].nbytes = ((struct io_event *)rest)[i].res;
+            rest[i].err_code = ((struct io_event *)rest)[i].res2;
+        }
+        *actual = reaped + std::max(num_evt, 0);
+        if (num_evt < 0 || *actual < min_compl) {
+            std::cout << __func__ << " ERROR: failed to poll Queue Completions" << std::endl;
+            num_evt = (num_evt < 0) ? num_evt : *actual;
+            goto done;
+        }
+        num_evt = 0;
     }
-    num_evt = 0;
 
 done:
     return num_evt;
 }
 
+/*
+ * reapAioRing()
+ *
+ * Copy up to max_compl completions from the aio completion ring mapped in
+ * user space, called with mAioReapLock.  Return number of completions, or
+ * -1 if the ring layout is not the one known here.
+ */
+int xocl::XOCLShim::reapAioRing(int max_compl, struct xclReqCompletion *comps)
+{
+    auto ring = reinterpret_cast<shim_aio_ring *>(mAioContext);
+    if (ring->magic != SHIM_AIO_RING_MAGIC || ring->incompat_features)
+        return -1;
+
+    unsigned head = ring->head;
+    unsigned tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    int num = 0;
+    for (; head != tail && num < max_compl; num++) {
+        const struct io_event &evt = ring->io_events[head];
+        comps[num].priv_data = (void *)evt.data;
+        comps[num].nbytes = evt.res;
+        comps[num].err_code = evt.res2;
+        head = (head + 1) % ring->nr;
+    }
+    __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+    return num;
+}
+
+/*
+ * submitQueueAio()
+ *
+ * Submit all buffers of a non-blocking request with one io_submit. Write
+ * requests of a batch but the last are flagged so the driver writes the
+ * queue producer index once for the whole batch.
+ */
+ssize_t xocl::XOCLShim::submitQueueAio(uint64_t q_hdl, xclQueueRequest *wr, bool write)
+{
+    if (!mAioEnabled) {
+        std::cout << __func__ << "ERROR: async io is not enabled" << std::endl;
+        return 0;
+    }
+
+    std::vector<struct xocl_qdma_req_header> headers(wr->buf_num);
+    std::vector<struct iovec> iovs(2 * wr->buf_num);
+    std::vector<struct iocb> cbs(wr->buf_num);
+    std::vector<struct iocb *> cbps(wr->buf_num);
+    unsigned num = 0;
+
+    for (; num < wr->buf_num; num++) {
+        if (write && !(wr->flag & XCL_QUEUE_REQ_EOT) && (wr->bufs[num].len & 0xfff)) {
+            std::cerr << "ERROR: write without EOT has to be multiple of 4k" << std::endl;
+            break;
+        }
+
+        headers[num].flags = wr->flag;
+        iovs[2 * num].iov_base = &headers[num];
+        iovs[2 * num].iov_len = sizeof(headers[num]);
+        iovs[2 * num + 1].iov_base = (void *)wr->bufs[num].va;
+        iovs[2 * num + 1].iov_len = wr->bufs[num].len;
+
+        memset(&cbs[num], 0, sizeof(cbs[num]));
+        cbs[num].aio_fildes = (int)q_hdl;
+        cbs[num].aio_lio_opcode = write ? IOCB_CMD_PWRITEV : IOCB_CMD_PREADV;
+        cbs[num].aio_buf = (uint64_t)&iovs[2 * num];
+        cbs[num].aio_offset = 0;
+        cbs[num].aio_nbytes = 2;
+        cbs[num].aio_data = (uint64_t)wr->priv_data;
+        cbps[num] = &cbs[num];
+    }
+
+    if (write) {
+        for (unsigned i = 0; i + 1 < num; i++)
+            headers[i].flags |= XOCL_QDMA_REQ_FLAG_MORE;
+    }
+
+    if (!num)
+        return 0;
+
+    int rc = io_submit(mAioContext, num, cbps.data());
+    if (rc < (int)num) {
+        std::cerr << "ERROR: async " << (write ? "write" : "read") << " stream failed" << std::endl;
+        // Last submitted request deferred its doorbell, flush it with an empty request
+        if (write && rc > 0) {
+            struct xocl_qdma_req_header header = {};
+            struct iovec iov[2] = {{&header, sizeof(header)}, {nullptr, 0}};
+            if (writev((int)q_hdl, iov, 2) < 0)
+                std::cerr << "ERROR: flush write stream failed" << std::endl;
+        }
+    }
+    return rc > 0 ? rc : 0;
+}
+
+/*
+ * submitQueueGather()
+ *
+ * Submit all buffers of a XCL_QUEUE_REQ_GATHER request as one vectored
+ * request, which the driver turns into a single descriptor chain.
+ */
+ssize_t xocl::XOCLShim::submitQueueGather(uint64_t q_hdl, xclQueueRequest *wr, bool write)
+{
+    struct xocl_qdma_req_header header;
+    std::vector<struct iovec> iovs(wr->buf_num + 1);
+    size_t total = 0;
+
+    header.flags = wr->flag & ~XCL_QUEUE_REQ_GATHER;
+    iovs[0].iov_base = &header;
+    iovs[0].iov_len = sizeof(header);
+    for (unsigned i = 0; i < wr->buf_num; i++) {
+        iovs[i + 1].iov_base = (void *)wr->bufs[i].va;
+        iovs[i + 1].iov_len = wr->bufs[i].len;
+        total += wr->bufs[i].len;
+    }
+
+    if (write && !(wr->flag & XCL_QUEUE_REQ_EOT) && (total & 0xfff)) {
+        std::cerr << "ERROR: write without EOT has to be multiple of 4k" << std::endl;
+        return -EINVAL;
+    }
+
+    if (!(wr->flag & XCL_QUEUE_REQ_NONBLOCKING)) {
+        ssize_t rc = write ? writev((int)q_hdl, iovs.data(), iovs.size()) :
+            readv((int)q_hdl, iovs.data(), iovs.size());
+        if (rc < 0)
+            std::cerr << "ERROR: " << (write ? "write" : "read") << " stream failed: " << rc << std::endl;
+        else if (write && (size_t)rc != total)
+            std::cerr << "ERROR: only " << rc << "/" << total << " bytes is written" << std::endl;
+        return rc;
+    }
+
+    if (!mAioEnabled) {
+        std::cout << __func__ << "ERROR: async io is not enabled" << std::endl;
+        return 0;
+    }
+
+    struct iocb cb;
+    struct iocb *cbp = &cb;
+    memset(&cb, 0, sizeof(cb));
+    cb.aio_fildes = (int)q_hdl;
+    cb.aio_lio_opcode = write ? IOCB_CMD_PWRITEV : IOCB_CMD_PREADV;
+    cb.aio_buf = (uint64_t)iovs.data();
+    cb.aio_offset = 0;
+    cb.aio_nbytes = iovs.size();
+    cb.aio_data = (uint64_t)wr->priv_data;
+
+    int rc = io_submit(mAioContext, 1, &cbp);
+    if (rc < 1)
+        std::cerr << "ERROR: async " << (write ? "write" : "read") << " stream failed" << std::endl;
+    return rc > 0 ? rc : 0;
+}
+
 /*
  * xclWriteQueue()
  */
@@ -1375,6 +2082,12 @@ ssize_t xocl::XOCLShim::xclWriteQueue(uint64_t q_hdl, xclQueueRequest *wr)
 {
     ssize_t rc = 0;
 
+    if (wr->flag & XCL_QUEUE_REQ_GATHER)
+        return submitQueueGather(q_hdl, wr, true);
+
+    if (wr->flag & XCL_QUEUE_REQ_NONBLOCKING)
+        return submitQueueAio(q_hdl, wr, true);
+
     for (unsigned i = 0; i < wr->buf_num; i++) {
         void *buf = (void *)wr->bufs[i].va;
         struct iovec iov[2];
@@ -1386,51 +2099,20 @@ ssize_t xocl::XOCLShim::xclWriteQueue(uint64_t q_hdl, xclQueueRequest *wr)
         iov[1].iov_base = buf;
         iov[1].iov_len = wr->bufs[i].len;
 
-        if (wr->flag & XCL_QUEUE_REQ_NONBLOCKING) {
-            struct iocb cb;
-            struct iocb *cbs[1];
-
-            if (!mAioEnabled) {
-                std::cout << __func__ << "ERROR: async io is not enabled" << std::endl;
-                break;
-            }
-
-            if (!(wr->flag & XCL_QUEUE_REQ_EOT) && (wr->bufs[i].len & 0xfff)) {
-                std::cerr << "ERROR: write without EOT has to be multiple of 4k" << std::endl;
-                break;
-            }
-
-            memset(&cb, 0, sizeof(cb));
-            cb.aio_fildes = (int)q_hdl;
-            cb.aio_lio_opcode = IOCB_CMD_PWRITEV;
-            cb.aio_buf = (uint64_t)iov;
-            cb.aio_offset = 0;
-            cb.aio_nbytes = 2;
-            cb.aio_data = (uint64_t)wr->priv_data;
-
-            cbs[0] = &cb;
-            if (io_submit(mAioContext, 1, cbs) > 0)
-                rc++;
-            else {
-                std::cerr << "ERROR: async write stream failed" << std::endl;
-                break;
-            }
-        } else {
-            if (!(wr->flag & XCL_QUEUE_REQ_EOT) && (wr->bufs[i].len & 0xfff)) {
-                std::cerr << "ERROR: write without EOT has to be multiple of 4k" << std::endl;
-                rc = -EINVAL;
-                break;
-            }
+        if (!(wr->flag & XCL_QUEUE_REQ_EOT) && (wr->bufs[i].len & 0xfff)) {
+            std::cerr << "ERROR: write without EOT has to be multiple of 4k" << std::endl;
+            rc = -EINVAL;
+            break;
+        }
 
-            rc = writev((int)q_hdl, iov, 2);
-            if (rc < 0) {
-                std::cerr << "ERROR: write stream failed: " << rc << std::endl;
-                break;
-            } else if ((size_t)rc != wr->bufs[i].len) {
-                std::cerr << "ERROR: only " << rc << "/" << wr->bufs[i].len;
-                std::cerr << " bytes is written" << std::endl;
-                break;
-            }
+        rc = writev((int)q_hdl, iov, 2);
+        if (rc < 0) {
+            std::cerr << "ERROR: write stream failed: " << rc << std::endl;
+            break;
+        } else if ((size_t)rc != wr->bufs[i].len) {
+            std::cerr << "ERROR: only " << rc << "/" << wr->bufs[i].len;
+            std::cerr << " bytes is written" << std::endl;
+            break;
         }
     }
     return rc;
@@ -1443,6 +2125,12 @@ ssize_t xocl::XOCLShim::xclReadQueue(uint64_t q_hdl, xclQueueRequest *wr)
 {
     ssize_t rc = 0;
 
+    if (wr->flag & XCL_QUEUE_REQ_GATHER)
+        return submitQueueGather(q_hdl, wr, false);
+
+    if (wr->flag & XCL_QUEUE_REQ_NONBLOCKING)
+        return submitQueueAio(q_hdl, wr, false);
+
     for (unsigned i = 0; i < wr->buf_num; i++) {
         void *buf = (void *)wr->bufs[i].va;
         struct iovec iov[2];
@@ -1454,36 +2142,10 @@ ssize_t xocl::XOCLShim::xclReadQueue(uint64_t q_hdl, xclQueueRequest *wr)
         iov[1].iov_base = buf;
         iov[1].iov_len = wr->bufs[i].len;
 
-        if (wr->flag & XCL_QUEUE_REQ_NONBLOCKING) {
-            struct iocb cb;
-            struct iocb *cbs[1];
-
-            if (!mAioEnabled) {
-                std::cout << __func__ << "ERROR: async io is not enabled" << std::endl;
-                break;
-            }
-
-            memset(&cb, 0, sizeof(cb));
-            cb.aio_fildes = (int)q_hdl;
-            cb.aio_lio_opcode = IOCB_CMD_PREADV;
-            cb.aio_buf = (uint64_t)iov;
-            cb.aio_offset = 0;
-            cb.aio_nbytes = 2;
-            cb.aio_data = (uint64_t)wr->priv_data;
-
-            cbs[0] = &cb;
-            if (io_submit(mAioContext, 1, cbs) > 0)
-                rc++;
-            else {
-                std::cerr << "ERROR: async read stream failed" << std::endl;
-                break;
-            }
-        } else {
-            rc = readv((int)q_hdl, iov, 2);
-            if (rc < 0) {
-                std::cerr << "ERROR: read stream failed: " << rc << std::endl;
-                break;
-            }
+        rc = readv((int)q_hdl, iov, 2);
+        if (rc < 0) {
+            std::cerr << "ERROR: read stream failed: " << rc << std::endl;
+            break;
         }
     }
     return rc;
@@ -1638,18 +2300,54 @@ size_t xclReadBO(xclDeviceHandle handle, unsigned int boHandle, void *dst, size_
     return drv ? drv->xclReadBO(boHandle, dst, size, skip) : -ENODEV;
 }
 
+int xclWriteSyncBO(xclDeviceHandle handle, unsigned int boHandle, const void *src, size_t size, size_t seek)
+{
+    xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
+    return drv ? drv->xclWriteSyncBO(boHandle, src, size, seek) : -ENODEV;
+}
+
+int xclSyncReadBO(xclDeviceHandle handle, unsigned int boHandle, void *dst, size_t size, size_t skip)
+{
+    xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
+    return drv ? drv->xclSyncReadBO(boHandle, dst, size, skip) : -ENODEV;
+}
+
 void *xclMapBO(xclDeviceHandle handle, unsigned int boHandle, bool write)
 {
     xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
     return drv ? drv->xclMapBO(boHandle, write) : nullptr;
 }
 
+int xclUnmapBO(xclDeviceHandle handle, unsigned int boHandle, void *addr)
+{
+    xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
+    return drv ? drv->xclUnmapBO(boHandle, addr) : -ENODEV;
+}
+
 int xclSyncBO(xclDeviceHandle handle, unsigned int boHandle, xclBOSyncDirection dir, size_t size, size_t offset)
 {
     xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
     return drv ? drv->xclSyncBO(boHandle, dir, size, offset) : -ENODEV;
 }
 
+int xclSyncBOAsync(xclDeviceHandle handle, unsigned int boHandle, xclBOSyncDirection dir, size_t size, size_t offset, int fd)
+{
+    xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
+    return drv ? drv->xclSyncBOAsync(boHandle, dir, size, offset, fd) : -ENODEV;
+}
+
+int xclSyncBOv(xclDeviceHandle handle, const xclBOSyncRange *ranges, size_t num)
+{
+    xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
+    return drv ? drv->xclSyncBOv(ranges, num) : -ENODEV;
+}
+
+int xclSetSyncChannel(xclDeviceHandle handle, int channel)
+{
+    xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
+    return drv ? drv->xclSetSyncChannel(channel) : -ENODEV;
+}
+
 int xclCopyBO(xclDeviceHandle handle, unsigned int dst_boHandle,
             unsigned int src_boHandle, size_t size, size_t dst_offset, size_t src_offset)
 {
@@ -1811,6 +2509,12 @@ ssize_t xclUnmgdPread(xclDeviceHandle handle, unsigned flags, void *buf, size_t
     return drv ? drv->xclUnmgdPread(flags, buf, count, offset) : -ENODEV;
 }
 
+int xclUnmgdOpen(xclDeviceHandle handle, unsigned flags)
+{
+    xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
+    return drv ? drv->xclUnmgdOpen(flags) : -ENODEV;
+}
+
 int xclGetBOProperties(xclDeviceHandle handle, unsigned int boHandle, xclBOProperties *properties)
 {
     xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
@@ -1842,6 +2546,22 @@ int xclExecBufWithWaitList(xclDeviceHandle handle, unsigned int cmdBO, size_t nu
     return drv ? drv->xclExecBuf(cmdBO,num_bo_in_wait_list,bo_wait_list) : -ENODEV;
 }
 
+int xclExecBufBatch(xclDeviceHandle handle, const unsigned int *cmdBOs, size_t num)
+{
+    xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
+    if (!drv) {
+        errno = ENODEV;
+        return 0;
+    }
+    return drv->xclExecBufBatch(cmdBOs,num);
+}
+
+int xclExecCompletions(xclDeviceHandle handle, unsigned int *cmdBOs, size_t max)
+{
+    xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
+    return drv ? drv->xclExecCompletions(cmdBOs,max) : -ENODEV;
+}
+
 int xclRegisterEventNotify(xclDeviceHandle handle, unsigned int userInterrupt, int fd)
 {
     xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
@@ -1854,6 +2574,12 @@ int xclExecWait(xclDeviceHandle handle, int timeoutMilliSec)
   return drv ? drv->xclExecWait(timeoutMilliSec) : -ENODEV;
 }
 
+int xclExecPollFd(xclDeviceHandle handle)
+{
+  xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
+  return drv ? drv->xclExecPollFd() : -ENODEV;
+}
+
 int xclOpenContext(xclDeviceHandle handle, uuid_t xclbinId, unsigned int ipIndex, bool shared)
 {
   xocl::XOCLShim *drv = xocl::XOCLShim::handleCheck(handle);
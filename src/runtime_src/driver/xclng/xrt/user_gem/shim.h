@@ -29,6 +29,9 @@
 #include "driver/xclng/include/qdma_ioctl.h"
 #include <libdrm/drm.h>
 #include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
 #include <fstream>
 #include <list>
 #include <map>
@@ -166,8 +169,14 @@ public:
     void xclFreeBO(unsigned int boHandle);
     int xclWriteBO(unsigned int boHandle, const void *src, size_t size, size_t seek);
     int xclReadBO(unsigned int boHandle, void *dst, size_t size, size_t skip);
+    int xclWriteSyncBO(unsigned int boHandle, const void *src, size_t size, size_t seek);
+    int xclSyncReadBO(unsigned int boHandle, void *dst, size_t size, size_t skip);
     void *xclMapBO(unsigned int boHandle, bool write);
+    int xclUnmapBO(unsigned int boHandle, void *addr);
     int xclSyncBO(unsigned int boHandle, xclBOSyncDirection dir, size_t size, size_t offset);
+    int xclSyncBOAsync(unsigned int boHandle, xclBOSyncDirection dir, size_t size, size_t offset, int fd);
+    int xclSyncBOv(const xclBOSyncRange *ranges, size_t num);
+    int xclSetSyncChannel(int channel);
     int xclCopyBO(unsigned int dst_boHandle, unsigned int src_boHandle, size_t size,
                   size_t dst_offset, size_t src_offset);
 
@@ -200,6 +209,7 @@ public:
 
     ssize_t xclUnmgdPwrite(unsigned flags, const void *buf, size_t count, uint64_t offset);
     ssize_t xclUnmgdPread(unsigned flags, void *buf, size_t count, uint64_t offset);
+    int xclUnmgdOpen(unsigned flags);
 
     int xclGetSectionInfo(void *section_info, size_t *section_size, enum axlf_section_kind, int index);
 
@@ -218,6 +228,9 @@ public:
     size_t xclPerfMonStartCounters(xclPerfMonType type);
     size_t xclPerfMonStopCounters(xclPerfMonType type);
     size_t xclPerfMonReadCounters(xclPerfMonType type, xclCounterResults& counterResults);
+    size_t xclPerfMonSampleCounters(xclCounterSample& sample);
+    int xclPerfMonStartSampling(unsigned int intervalMsec);
+    int xclPerfMonStopSampling();
 
     //debug related
     uint32_t getCheckerNumberSlots(int type);
@@ -236,8 +249,11 @@ public:
     // Execute and interrupt abstraction
     int xclExecBuf(unsigned int cmdBO);
     int xclExecBuf(unsigned int cmdBO,size_t numdeps, unsigned int* bo_wait_list);
+    int xclExecBufBatch(const unsigned int *cmdBOs, size_t num);
+    int xclExecCompletions(unsigned int *cmdBOs, size_t max);
     int xclRegisterEventNotify(unsigned int userInterrupt, int fd);
     int xclExecWait(int timeoutMilliSec);
+    int xclExecPollFd() const { return mUserHandle; }
     int xclOpenContext(uuid_t xclbinId, unsigned int ipIndex, bool shared) const;
     int xclCloseContext(uuid_t xclbinId, unsigned int ipIndex) const;
 
@@ -286,6 +302,8 @@ private:
     }
 
     int xclLoadAxlf(const axlf *buffer);
+    bool isXclbinLoaded(const axlf *buffer);
+    void xclSysfsGetStaticInfo(xclDeviceInfo2 *info);
     void xclSysfsGetDeviceInfo(xclDeviceInfo2 *info);
     void xclSysfsGetUsageInfo(drm_xocl_usage_stat& stat);
     void xclSysfsGetErrorStatus(xclErrorStatus& stat);
@@ -349,6 +367,7 @@ private:
     uint32_t getPerfMonSlotStartBit(xclPerfMonType type, uint32_t slotnum);
     uint32_t getPerfMonSlotDataWidth(xclPerfMonType type, uint32_t slotnum);
     size_t resetFifos(xclPerfMonType type);
+    size_t writeTraceClockTraining();
     uint32_t bin2dec(std::string str, int start, int number);
     uint32_t bin2dec(const char * str, int start, int number);
     std::string dec2bin(uint32_t n);
@@ -370,9 +389,74 @@ private:
     uint8_t mAccelmonProperties[XSAM_MAX_NUMBER_SLOTS] = {};
     uint8_t mStreammonProperties[XSSPM_MAX_NUMBER_SLOTS] = {};
 
+    // Counter sampling, previous snapshot is the base of the next rates
+    std::mutex mSampleLock;
+    xclCounterResults mSamplePrev = {};
+    uint64_t mSamplePrevNsec = 0;
+    // usecs per (clock, MHz) from the icap clock_residency of mgmt pf
+    std::map<std::pair<unsigned, unsigned>, uint64_t> mSampleResidency;
+    void sampleClockResidency(xclCounterSample& sample);
+    std::mutex mSamplingLock;
+    std::condition_variable mSamplingCond;
+    std::thread mSamplingThread;
+    bool mSamplingStop = false;
+    xclCounterSamplePage *mSamplePage = nullptr;
+    std::string mSamplePageName;
+    void samplingLoop(unsigned int intervalMsec);
+
+    // Trace clock training, words from startTrace still at the head of
+    // the FIFO and the host timestamp being assembled from its 4 words
+    uint32_t mTraceClockWordsPending = 0;
+    bool mTraceClockTraining = false;
+    uint32_t mTraceClockWord = 0;
+    xclTraceResults mTraceClockResults = {};
+
     // QDMA AIO
     aio_context_t mAioContext;
     bool mAioEnabled;
+    std::mutex mAioReapLock;
+    int reapAioRing(int max_compl, struct xclReqCompletion *comps);
+
+    // Exec buffer completion ring, registered on first use
+    std::mutex mExecRingLock;
+    drm_xocl_exec_ring_buf *mExecRing = nullptr;
+    unsigned int mExecRingBO = 0;
+    size_t mExecRingBOSize = 0;
+    int mExecRingState = 0; // 0: not initialized, 1: registered, -1: not supported
+    uint32_t mExecRingDropped = 0;
+    void initExecRing();
+
+    // Snapshots of the sysfs backed queries, see XCL_SYSFS_CACHE_MSEC.
+    // Static fields are read once, the rest is refreshed when stale.
+    std::mutex mSysfsCacheLock;
+    bool mSysfsStaticValid = false;
+    xclDeviceInfo2 mSysfsInfo = {};
+    drm_xocl_usage_stat mSysfsUsage = {};
+    xclErrorStatus mSysfsError = {};
+    std::chrono::steady_clock::time_point mSysfsInfoTime;
+    std::chrono::steady_clock::time_point mSysfsUsageTime;
+    std::chrono::steady_clock::time_point mSysfsErrorTime;
+    void invalidateSysfsCache();
+
+    // BO mappings kept across xclMapBO/xclUnmapBO, see XCL_BO_MAP_CACHE
+    struct BOMapping {
+        void *addr;
+        size_t size;
+        unsigned int refs;
+    };
+    std::mutex mMapCacheLock;
+    std::map<unsigned int, BOMapping> mMapCache;
+    void *mapBO(unsigned int boHandle, bool write, size_t *size);
+
+    // Shared CU contexts refcounted per process, keyed by xclbin uuid and
+    // CU index. With XCL_CTX_CACHE an entry that drops to zero references
+    // stays reserved in the driver for the next open, idle entries are
+    // given up before an xclbin download and when the device is closed.
+    mutable std::mutex mCtxLock;
+    mutable std::map<std::pair<std::string, unsigned int>, unsigned int> mCtxRefs;
+    void releaseIdleContexts();
+    ssize_t submitQueueAio(uint64_t q_hdl, xclQueueRequest *wr, bool write);
+    ssize_t submitQueueGather(uint64_t q_hdl, xclQueueRequest *wr, bool write);
 }; /* XOCLShim */
 
 } /* xocl */
@@ -49,6 +49,10 @@ enum drm_zocl_sync_bo_dir {
 	DRM_ZOCL_SYNC_BO_FROM_DEVICE
 };
 
+/* Cacheable BO that the PL accesses coherently (HPC port through CCI),
+ * only granted if zocl is dma-coherent in device tree, no sync needed */
+#define DRM_ZOCL_BO_FLAGS_HOST_COHERENT (0x1 << 25)
+#define DRM_ZOCL_BO_FLAGS_CACHEABLE  (0x1 << 26)
 #define DRM_ZOCL_BO_FLAGS_COHERENT   (0x1 << 27)
 #define DRM_ZOCL_BO_FLAGS_CMA        (0x1 << 28)
 #define DRM_ZOCL_BO_FLAGS_SVM        (0x1 << 29)
@@ -21,6 +21,7 @@
 #include <linux/kthread.h>
 #include <linux/delay.h>
 #include <linux/sched.h>
+#include <sched_core.h>
 #include "sched_exec.h"
 
 /* #define SCHED_VERBOSE */
@@ -99,9 +100,7 @@ is_ert(struct drm_device *dev)
 inline int
 ffs_or_neg_one(u32 mask)
 {
-	if (!mask)
-		return -1;
-	return ffs(mask)-1;
+	return sched_ffs_or_neg_one(mask);
 }
 
 /**
@@ -113,9 +112,7 @@ ffs_or_neg_one(u32 mask)
 inline int
 ffz_or_neg_one(u32 mask)
 {
-	if (mask == U32_MASK)
-		return -1;
-	return ffz(mask);
+	return sched_ffz_or_neg_one(mask);
 }
 
 /**
@@ -140,7 +137,7 @@ slot_size(struct drm_device *dev)
 inline unsigned int
 cu_mask_idx(unsigned int cu_idx)
 {
-	return cu_idx >> 5; /* 32 cus per mask */
+	return sched_mask_idx(cu_idx); /* 32 cus per mask */
 }
 
 /**
@@ -152,7 +149,7 @@ cu_mask_idx(unsigned int cu_idx)
 inline unsigned int
 cu_idx_in_mask(unsigned int cu_idx)
 {
-	return cu_idx - (cu_mask_idx(cu_idx) << 5);
+	return sched_idx_in_mask(cu_idx);
 }
 
 /**
@@ -165,7 +162,7 @@ cu_idx_in_mask(unsigned int cu_idx)
 inline unsigned int
 cu_idx_from_mask(unsigned int cu_idx, unsigned int mask_idx)
 {
-	return cu_idx + (mask_idx << 5);
+	return sched_idx_from_mask(cu_idx, mask_idx);
 }
 
 /**
@@ -177,7 +174,7 @@ cu_idx_from_mask(unsigned int cu_idx, unsigned int mask_idx)
 inline unsigned int
 slot_mask_idx(unsigned int slot_idx)
 {
-	return slot_idx >> 5;
+	return sched_mask_idx(slot_idx);
 }
 
 /**
@@ -189,7 +186,7 @@ slot_mask_idx(unsigned int slot_idx)
 inline unsigned int
 slot_idx_in_mask(unsigned int slot_idx)
 {
-	return slot_idx - (slot_mask_idx(slot_idx) << 5);
+	return sched_idx_in_mask(slot_idx);
 }
 
 /**
@@ -202,7 +199,7 @@ slot_idx_in_mask(unsigned int slot_idx)
 inline unsigned int
 slot_idx_from_mask_idx(unsigned int slot_idx, unsigned int mask_idx)
 {
-	return slot_idx + (mask_idx << 5);
+	return sched_idx_from_mask(slot_idx, mask_idx);
 }
 
 
@@ -227,7 +224,7 @@ opcode(struct sched_cmd *cmd)
 inline u32
 payload_size(struct sched_cmd *cmd)
 {
-	return cmd->packet->count;
+	return sched_payload_size(cmd->packet->header);
 }
 
 /**
@@ -251,12 +248,7 @@ packet_size(struct sched_cmd *cmd)
 inline u32
 cu_masks(struct sched_cmd *cmd)
 {
-	struct start_kernel_cmd *sk;
-
-	if (opcode(cmd) != OP_START_KERNEL)
-		return 0;
-	sk = (struct start_kernel_cmd *)cmd->packet;
-	return 1 + sk->extra_cu_masks;
+	return sched_cu_masks(cmd->packet->header);
 }
 
 /**
@@ -268,7 +260,7 @@ cu_masks(struct sched_cmd *cmd)
 inline u32
 regmap_size(struct sched_cmd *cmd)
 {
-	return payload_size(cmd) - cu_masks(cmd);
+	return sched_regmap_size(cmd->packet->header);
 }
 
 /**
@@ -484,23 +476,12 @@ static int
 acquire_slot_idx(struct drm_device *dev)
 {
 	struct drm_zocl_dev *zdev = dev->dev_private;
-	unsigned int mask_idx = 0, slot_idx = -1, tmp_idx;
-	u32 mask;
-
-	SCHED_DEBUG("-> acquire_slot_idx\n");
-	for (mask_idx = 0; mask_idx < zdev->exec->num_slot_masks; ++mask_idx) {
-		mask = zdev->exec->slot_status[mask_idx];
-		slot_idx = ffz_or_neg_one(mask);
-		tmp_idx = slot_idx_from_mask_idx(slot_idx, mask_idx);
-		if (slot_idx == -1 || tmp_idx >= zdev->exec->num_slots)
-			continue;
-		zdev->exec->slot_status[mask_idx] ^= (1<<slot_idx);
-		SCHED_DEBUG("<- acquire_slot_idx returns %d\n",
-			    slot_idx_from_mask_idx(slot_idx, mask_idx));
-		return slot_idx_from_mask_idx(slot_idx, mask_idx);
-	}
-	SCHED_DEBUG("<- acquire_slot_idx returns -1\n");
-	return -1;
+	int slot_idx = sched_acquire_idx(zdev->exec->slot_status,
+					 zdev->exec->num_slot_masks,
+					 zdev->exec->num_slots);
+
+	SCHED_DEBUG("<-> acquire_slot_idx returns %d\n", slot_idx);
+	return slot_idx;
 }
 
 /**
@@ -516,12 +497,9 @@ static void
 release_slot_idx(struct drm_device *dev, unsigned int slot_idx)
 {
 	struct drm_zocl_dev *zdev = dev->dev_private;
-	unsigned int mask_idx = slot_mask_idx(slot_idx);
-	unsigned int pos = slot_idx_in_mask(slot_idx);
 
-	SCHED_DEBUG("<-> release_slot_idx slot_status[%d]=0x%x, pos=%d\n",
-		    mask_idx, zdev->exec->slot_status[mask_idx], pos);
-	zdev->exec->slot_status[mask_idx] ^= (1<<pos);
+	SCHED_DEBUG("<-> release_slot_idx slot_idx=%d\n", slot_idx);
+	sched_toggle_idx(zdev->exec->slot_status, slot_idx);
 }
 
 /**
@@ -544,6 +522,31 @@ get_cu_idx(struct drm_device *dev, unsigned int cmd_idx)
 	return cmd->cu_idx;
 }
 
+/*
+ * zocl_core_ops: CU register access for the shared scheduler core,
+ * addresses are offsets from the zocl register base.
+ */
+static u32
+zocl_read32(void *priv, u32 addr)
+{
+	struct drm_zocl_dev *zdev = priv;
+
+	return ioread32(zdev->regs + addr);
+}
+
+static void
+zocl_write32(void *priv, u32 addr, u32 val)
+{
+	struct drm_zocl_dev *zdev = priv;
+
+	iowrite32(val, zdev->regs + addr);
+}
+
+static const struct sched_core_ops zocl_core_ops = {
+	.read32 = zocl_read32,
+	.write32 = zocl_write32,
+};
+
 /**
  * cu_done() - Check status of CU
  *
@@ -558,19 +561,12 @@ inline int
 cu_done(struct drm_device *dev, unsigned int cu_idx)
 {
 	struct drm_zocl_dev *zdev = dev->dev_private;
-	u32 *virt_addr = zdev->regs + cu_idx_to_offset(dev, cu_idx);
-
-	SCHED_DEBUG("-> cu_done(,%d) checks cu at address 0x%p\n",
-		    cu_idx, virt_addr);
-	/* done is indicated by AP_DONE(2) alone or by AP_DONE(2) | AP_IDLE(4)
-	 * but not by AP_IDLE itself.  Since 0x10 | (0x10 | 0x100) = 0x110
-	 * checking for 0x10 is sufficient.
-	 */
-	if (*virt_addr & 2) {
-		unsigned int mask_idx = cu_mask_idx(cu_idx);
-		unsigned int pos = cu_idx_in_mask(cu_idx);
+	u32 offset = cu_idx_to_offset(dev, cu_idx);
 
-		zdev->exec->cu_status[mask_idx] ^= 1<<pos;
+	SCHED_DEBUG("-> cu_done(,%d) checks cu at offset 0x%x\n",
+		    cu_idx, offset);
+	if (sched_cu_done(&zocl_core_ops, zdev, offset,
+			  zdev->exec->cu_status, cu_idx)) {
 		SCHED_DEBUG("<- cu_done returns 1\n");
 		return true;
 	}
@@ -592,15 +588,12 @@ inline int
 ert_cu_done(struct drm_device *dev, unsigned int cu_idx)
 {
 	struct drm_zocl_dev *zdev = dev->dev_private;
-	u32 *virt_addr = zdev->regs + cu_idx_to_offset(dev, cu_idx);
-
-	SCHED_DEBUG("-> ert_cu_done(,%d) checks cu at address 0x%p\n",
-		    cu_idx, virt_addr);
-	if (*virt_addr & 2) {
-		unsigned int mask_idx = cu_mask_idx(cu_idx);
-		unsigned int pos = cu_idx_in_mask(cu_idx);
+	u32 offset = cu_idx_to_offset(dev, cu_idx);
 
-		zdev->exec->cu_status[mask_idx] ^= 1<<pos;
+	SCHED_DEBUG("-> ert_cu_done(,%d) checks cu at offset 0x%x\n",
+		    cu_idx, offset);
+	if (sched_cu_done(&zocl_core_ops, zdev, offset,
+			  zdev->exec->cu_status, cu_idx)) {
 		SCHED_DEBUG("<- ert_cu_done returns 1\n");
 		return true;
 	}
@@ -902,24 +895,15 @@ reset_all(void)
 static int
 get_free_cu(struct sched_cmd *cmd)
 {
-	int mask_idx = 0;
 	struct drm_zocl_dev *zdev = cmd->ddev->dev_private;
+	int cu_idx;
 
 	SCHED_DEBUG("-> get_free_cu\n");
-	for (mask_idx = 0; mask_idx < zdev->exec->num_cu_masks; ++mask_idx) {
-		u32 cmd_mask = cmd->packet->data[mask_idx]; /* skip header */
-		u32 busy_mask = zdev->exec->cu_status[mask_idx];
-		int cu_idx = ffs_or_neg_one((cmd_mask | busy_mask) ^ busy_mask);
-
-		if (cu_idx >= 0) {
-			zdev->exec->cu_status[mask_idx] ^= 1 << cu_idx;
-			SCHED_DEBUG("<- get_free_cu returns %d\n",
-				    cu_idx_from_mask(cu_idx, mask_idx));
-			return cu_idx_from_mask(cu_idx, mask_idx);
-		}
-	}
-	SCHED_DEBUG("<- get_free_cu returns -1\n");
-	return -1;
+	/* skip header */
+	cu_idx = sched_get_free_cu(cmd->packet->data, zdev->exec->cu_status,
+				   zdev->exec->num_cu_masks);
+	SCHED_DEBUG("<- get_free_cu returns %d\n", cu_idx);
+	return cu_idx;
 }
 
 /**
@@ -935,17 +919,16 @@ static void
 configure_cu(struct sched_cmd *cmd, int cu_idx)
 {
 	struct drm_zocl_dev *zdev = cmd->ddev->dev_private;
-	u32 i, size = regmap_size(cmd);
-	u32 *virt_addr = zdev->regs + cu_idx_to_offset(cmd->ddev, cu_idx);
+	u32 size = regmap_size(cmd);
+	u32 offset = cu_idx_to_offset(cmd->ddev, cu_idx);
 	struct start_kernel_cmd *sk = (struct start_kernel_cmd *)cmd->packet;
 
-	SCHED_DEBUG("-> configure_cu cu_idx=%d, cu_addr=0x%p, regmap_size=%d\n",
-		    cu_idx, virt_addr, size);
-	for (i = 1; i < size; ++i)
-		virt_addr[i] = *(sk->data + sk->extra_cu_masks + i);
-
-	/* start CU at base + 0x0 */
-	virt_addr[0] = 0x1;
+	SCHED_DEBUG("-> configure_cu cu_idx=%d, offset=0x%x, regmap_size=%d\n",
+		    cu_idx, offset, size);
+	/* write register map but skip first word (AP_START), and start CU
+	 * at base + 0x0, there is no CU interrupt handler on this platform */
+	sched_configure_cu(&zocl_core_ops, zdev, offset,
+			   sk->data + sk->extra_cu_masks, size, 0);
 
 	SCHED_DEBUG("<- configure_cu\n");
 }
@@ -963,19 +946,17 @@ static void
 ert_configure_cu(struct sched_cmd *cmd, int cu_idx)
 {
 	struct drm_zocl_dev *zdev = cmd->ddev->dev_private;
-	u32 i, size = regmap_size(cmd);
-	u32 *virt_addr = zdev->regs + cu_idx_to_offset(cmd->ddev, cu_idx);
+	u32 size = regmap_size(cmd);
+	u32 offset = cu_idx_to_offset(cmd->ddev, cu_idx);
 	struct start_kernel_cmd *sk = (struct start_kernel_cmd *)cmd->packet;
 
 	SCHED_DEBUG("-> ert_configure_cu ");
-	SCHED_DEBUG("cu_idx=%d, cu_addr=0x%p, regmap_size=%d\n",
-		    cu_idx, virt_addr, size);
-
-	for (i = 1; i < size; ++i)
-		virt_addr[i] = *(sk->data + sk->extra_cu_masks + i);
-
-	/* start CU at base + 0x0 */
-	virt_addr[0] = 0x1;
+	SCHED_DEBUG("cu_idx=%d, offset=0x%x, regmap_size=%d\n",
+		    cu_idx, offset, size);
+	/* write register map but skip first word (AP_START), and start CU
+	 * at base + 0x0, there is no CU interrupt handler on this platform */
+	sched_configure_cu(&zocl_core_ops, zdev, offset,
+			   sk->data + sk->extra_cu_masks, size, 0);
 
 	SCHED_DEBUG("<- ert_configure_cu\n");
 }
@@ -24,11 +24,196 @@
 #include <asm/io.h>
 #include "zocl_drv.h"
 
+static unsigned int bo_pool_mb = 64;
+module_param(bo_pool_mb, uint, 0644);
+MODULE_PARM_DESC(bo_pool_mb,
+	"Max MB of freed CMA buffers kept for reuse, 0 disables pool (default 64)");
+
 static inline void __user *to_user_ptr(u64 address)
 {
 	return (void __user *)(uintptr_t)address;
 }
 
+/* A free CMA buffer in the BO pool */
+struct zocl_pool_buf {
+	struct list_head	link;
+	void			*vaddr;
+	dma_addr_t		paddr;
+};
+
+/**
+ * zocl_bo_pool_class() - Smallest pool size class that fits size
+ *
+ * Return: Size class, or -1 if size exceeds largest class
+ */
+static int zocl_bo_pool_class(size_t size)
+{
+	int class = get_order(size);
+
+	return class < ZOCL_BO_POOL_CLASSES ? class : -1;
+}
+
+void zocl_bo_pool_init(struct zocl_bo_pool *pool)
+{
+	int i;
+
+	mutex_init(&pool->lock);
+	for (i = 0; i < ZOCL_BO_POOL_CLASSES; ++i)
+		INIT_LIST_HEAD(&pool->free[i]);
+	pool->cached = 0;
+}
+
+/* Release all buffers held in pool back to CMA */
+static void zocl_bo_pool_drain(struct drm_device *dev)
+{
+	struct drm_zocl_dev *zdev = dev->dev_private;
+	struct zocl_bo_pool *pool = &zdev->bo_pool;
+	struct zocl_pool_buf *buf, *next;
+	int i;
+
+	mutex_lock(&pool->lock);
+	for (i = 0; i < ZOCL_BO_POOL_CLASSES; ++i) {
+		list_for_each_entry_safe(buf, next, &pool->free[i], link) {
+			list_del(&buf->link);
+			dma_free_wc(dev->dev, PAGE_SIZE << i, buf->vaddr,
+					buf->paddr);
+			kfree(buf);
+		}
+	}
+	pool->cached = 0;
+	mutex_unlock(&pool->lock);
+}
+
+void zocl_bo_pool_fini(struct drm_device *dev)
+{
+	zocl_bo_pool_drain(dev);
+}
+
+/**
+ * zocl_bo_pool_get() - Get CMA buffer for BO of size bytes
+ *
+ * Buffers up to the largest size class are rounded up to their class
+ * and recycled from the pool when available.  Recycled buffers are
+ * cleared since they may come from another client.
+ *
+ * @pool_size: Returns size of the CMA allocation
+ * Return: Kernel address of buffer, or NULL on failure
+ */
+static void *zocl_bo_pool_get(struct drm_device *dev, size_t size,
+		dma_addr_t *paddr, size_t *pool_size)
+{
+	struct drm_zocl_dev *zdev = dev->dev_private;
+	struct zocl_bo_pool *pool = &zdev->bo_pool;
+	int class = bo_pool_mb ? zocl_bo_pool_class(size) : -1;
+	struct zocl_pool_buf *buf = NULL;
+	void *vaddr;
+
+	if (class >= 0) {
+		mutex_lock(&pool->lock);
+		buf = list_first_entry_or_null(&pool->free[class],
+				struct zocl_pool_buf, link);
+		if (buf) {
+			list_del(&buf->link);
+			pool->cached -= PAGE_SIZE << class;
+		}
+		mutex_unlock(&pool->lock);
+	}
+
+	if (buf) {
+		vaddr = buf->vaddr;
+		*paddr = buf->paddr;
+		*pool_size = PAGE_SIZE << class;
+		kfree(buf);
+		memset(vaddr, 0, *pool_size);
+		return vaddr;
+	}
+
+	*pool_size = (class >= 0) ? PAGE_SIZE << class : size;
+	vaddr = dma_alloc_wc(dev->dev, *pool_size, paddr,
+			GFP_KERNEL | __GFP_NOWARN);
+	if (!vaddr) {
+		/* CMA may be held by the pool or be too fragmented for
+		 * the rounded up size, retry with the exact size */
+		zocl_bo_pool_drain(dev);
+		*pool_size = size;
+		vaddr = dma_alloc_wc(dev->dev, size, paddr,
+				GFP_KERNEL | __GFP_NOWARN);
+	}
+	return vaddr;
+}
+
+/**
+ * zocl_bo_pool_put() - Return CMA buffer of freed BO to pool
+ *
+ * The buffer is freed if it is not of a size class or if the pool is
+ * full.
+ */
+void zocl_bo_pool_put(struct drm_device *dev, void *vaddr, dma_addr_t paddr,
+		size_t size)
+{
+	struct drm_zocl_dev *zdev = dev->dev_private;
+	struct zocl_bo_pool *pool = &zdev->bo_pool;
+	int class = zocl_bo_pool_class(size);
+	struct zocl_pool_buf *buf;
+
+	if (class < 0 || (PAGE_SIZE << class) != size)
+		goto free;
+
+	buf = kmalloc(sizeof(*buf), GFP_KERNEL);
+	if (!buf)
+		goto free;
+
+	mutex_lock(&pool->lock);
+	if (pool->cached + size > ((size_t)bo_pool_mb << 20)) {
+		mutex_unlock(&pool->lock);
+		kfree(buf);
+		goto free;
+	}
+	buf->vaddr = vaddr;
+	buf->paddr = paddr;
+	list_add(&buf->link, &pool->free[class]);
+	pool->cached += size;
+	mutex_unlock(&pool->lock);
+	return;
+
+free:
+	dma_free_wc(dev->dev, size, vaddr, paddr);
+}
+
+/**
+ * zocl_bo_cacheable_get() - Get buffer for cacheable BO of size bytes
+ *
+ * Coherent CMA buffers are mapped uncached by the kernel, so a BO mapped
+ * cached in user space gets zeroed pages with a streaming DMA mapping
+ * instead.  The sync ioctl hands the mapping between CPU and device.
+ *
+ * Return: Kernel address of buffer, or NULL on failure
+ */
+static void *zocl_bo_cacheable_get(struct drm_device *dev, size_t size,
+		dma_addr_t *paddr)
+{
+	struct page *page;
+
+	page = alloc_pages(GFP_KERNEL | __GFP_ZERO | __GFP_NOWARN,
+			get_order(size));
+	if (!page)
+		return NULL;
+
+	*paddr = dma_map_page(dev->dev, page, 0, size, DMA_BIDIRECTIONAL);
+	if (dma_mapping_error(dev->dev, *paddr)) {
+		__free_pages(page, get_order(size));
+		return NULL;
+	}
+	return page_address(page);
+}
+
+void zocl_bo_cacheable_put(struct drm_device *dev, void *vaddr,
+		dma_addr_t paddr, size_t size)
+{
+	dma_unmap_page(dev->dev, paddr, size, DMA_BIDIRECTIONAL);
+	__free_pages(virt_to_page(vaddr), get_order(size));
+}
+
 void zocl_describe(const struct drm_zocl_bo *obj)
 {
 	size_t size_in_kb = obj->cma_base.base.size / 1024;
@@ -133,28 +318,48 @@ zocl_create_bo(struct drm_device *dev, uint64_t unaligned_size, u32 user_flags)
 	if (!size)
 		return ERR_PTR(-EINVAL);
 
-	if (zdev->domain) {
-		bo = kzalloc(sizeof(*bo), GFP_KERNEL);
-		if (!bo)
-			return ERR_PTR(-ENOMEM);
+	bo = kzalloc(sizeof(*bo), GFP_KERNEL);
+	if (!bo)
+		return ERR_PTR(-ENOMEM);
 
+	if (zdev->domain) {
 		err = drm_gem_object_init(dev, &bo->gem_base, size);
 		if (err < 0)
 			goto free;
 	} else {
-		cma_obj = drm_gem_cma_create(dev, size);
-		if (IS_ERR(cma_obj))
-			return ERR_PTR(-ENOMEM);
+		/* CMA backed BO, buffer is recycled through BO pool */
+		cma_obj = &bo->cma_base;
+		err = drm_gem_object_init(dev, &cma_obj->base, size);
+		if (err < 0)
+			goto free;
 
-		bo = to_zocl_bo(&cma_obj->base);
+		err = drm_gem_create_mmap_offset(&cma_obj->base);
+		if (err)
+			goto release;
+
+		if (user_flags & DRM_ZOCL_BO_FLAGS_CACHEABLE)
+			cma_obj->vaddr = zocl_bo_cacheable_get(dev, size,
+					&cma_obj->paddr);
+		else
+			cma_obj->vaddr = zocl_bo_pool_get(dev, size,
+					&cma_obj->paddr, &bo->pool_size);
+		if (!cma_obj->vaddr) {
+			err = -ENOMEM;
+			goto release;
+		}
 	}
 
 	if (user_flags & DRM_ZOCL_BO_FLAGS_EXECBUF) {
 		bo->flags = DRM_ZOCL_BO_FLAGS_EXECBUF;
 		bo->metadata.state = DRM_ZOCL_EXECBUF_STATE_ABORT;
+	} else if (!zdev->domain && (user_flags & DRM_ZOCL_BO_FLAGS_CACHEABLE)) {
+		bo->flags = DRM_ZOCL_BO_FLAGS_CACHEABLE;
+		bo->flags |= user_flags & DRM_ZOCL_BO_FLAGS_HOST_COHERENT;
 	}
 
 	return bo;
+release:
+	drm_gem_object_release(&cma_obj->base);
 free:
 	kfree(bo);
 	return ERR_PTR(err);
@@ -227,15 +432,36 @@ zocl_create_bo_ioctl(struct drm_device *dev, void *data, struct drm_file *filp)
 	struct drm_zocl_bo *bo;
 	struct drm_zocl_dev *zdev = dev->dev_private;
 
-	/* Remove all flags, except EXECBUF. */
-	args->flags &= DRM_ZOCL_BO_FLAGS_EXECBUF;
+	/* Remove all flags, except EXECBUF, CACHEABLE and HOST_COHERENT. */
+	args->flags &= DRM_ZOCL_BO_FLAGS_EXECBUF | DRM_ZOCL_BO_FLAGS_CACHEABLE |
+		DRM_ZOCL_BO_FLAGS_HOST_COHERENT;
+
+	/* Host coherent BOs are cacheable BOs without cache maintenance,
+	 * granted only if PL access is coherent */
+	if (!zdev->dma_coherent)
+		args->flags &= ~DRM_ZOCL_BO_FLAGS_HOST_COHERENT;
+	else if (args->flags & DRM_ZOCL_BO_FLAGS_HOST_COHERENT)
+		args->flags |= DRM_ZOCL_BO_FLAGS_CACHEABLE;
+
+	/* Exec buffers are parsed by scheduler, keep them uncached.
+	 * Cacheable buffers are not from CMA, their size is limited to
+	 * what the page allocator provides contiguously */
+	if ((args->flags & DRM_ZOCL_BO_FLAGS_EXECBUF) ||
+			get_order(PAGE_ALIGN(args->size)) >= MAX_ORDER)
+		args->flags &= ~(DRM_ZOCL_BO_FLAGS_CACHEABLE |
+				DRM_ZOCL_BO_FLAGS_HOST_COHERENT);
 
-	if (zdev->domain)
+	if (zdev->domain) {
+		args->flags &= ~(DRM_ZOCL_BO_FLAGS_CACHEABLE |
+				DRM_ZOCL_BO_FLAGS_HOST_COHERENT);
 		return zocl_create_svm_bo(dev, data, filp);
+	}
 
 	/* This is not good. But force to use COHERENT and CMA flags here. */
 	/* Remove this only when XRT use the same flags for xocl and zocl */
-	args->flags |= DRM_ZOCL_BO_FLAGS_COHERENT;
+	/* Cacheable BOs are not coherent, user must sync them explicitly */
+	if (!(args->flags & DRM_ZOCL_BO_FLAGS_CACHEABLE))
+		args->flags |= DRM_ZOCL_BO_FLAGS_COHERENT;
 	args->flags |= DRM_ZOCL_BO_FLAGS_CMA;
 
 	bo = zocl_create_bo(dev, args->size, args->flags);
@@ -244,12 +470,12 @@ zocl_create_bo_ioctl(struct drm_device *dev, void *data, struct drm_file *filp)
 		return PTR_ERR(bo);
 	}
 
-	bo->flags |= DRM_ZOCL_BO_FLAGS_COHERENT;
+	bo->flags |= args->flags & DRM_ZOCL_BO_FLAGS_COHERENT;
 	bo->flags |= DRM_ZOCL_BO_FLAGS_CMA;
 
 	ret = drm_gem_handle_create(filp, &bo->cma_base.base, &args->handle);
 	if (ret) {
-		drm_gem_cma_free_object(&bo->cma_base.base);
+		zocl_free_bo(&bo->cma_base.base);
 		DRM_DEBUG("handle creation failed\n");
 		return ret;
 	}
@@ -395,6 +621,30 @@ int zocl_sync_bo_ioctl(struct drm_device *dev,
 		goto out;
 	}
 
+	/* Coherent (uncached) and host coherent BOs need no cache
+	 * maintenance */
+	if (zocl_bo_host_coherent(to_zocl_bo(gem_obj)) ||
+			(to_zocl_bo(gem_obj)->flags & DRM_ZOCL_BO_FLAGS_COHERENT))
+		goto out;
+
+	/* Cacheable BOs are mapped cached in user space, hand the
+	 * requested range of their streaming mapping over */
+	if (zocl_bo_cacheable(to_zocl_bo(gem_obj))) {
+		dma_addr_t paddr = to_zocl_bo(gem_obj)->cma_base.paddr;
+
+		if (args->dir == DRM_ZOCL_SYNC_BO_TO_DEVICE)
+			dma_sync_single_range_for_device(dev->dev, paddr,
+					args->offset, args->size,
+					DMA_BIDIRECTIONAL);
+		else if (args->dir == DRM_ZOCL_SYNC_BO_FROM_DEVICE)
+			dma_sync_single_range_for_cpu(dev->dev, paddr,
+					args->offset, args->size,
+					DMA_BIDIRECTIONAL);
+		else
+			ret = -EINVAL;
+		goto out;
+	}
+
 	kaddr = drm_gem_cma_prime_vmap(gem_obj);
 
 	/* only invalidate the range of addresses requested by the user */
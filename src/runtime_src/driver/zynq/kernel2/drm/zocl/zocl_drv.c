@@ -20,12 +20,14 @@
  */
 
 #include <linux/dma-buf.h>
+#include <linux/dma-mapping.h>
 #include <linux/module.h>
 #include <linux/fpga/fpga-mgr.h>
 #include <linux/iommu.h>
 #include <linux/pagemap.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
+#include <linux/of_address.h>
 #include "zocl_drv.h"
 #include "sched_exec.h"
 
@@ -122,7 +124,21 @@ void zocl_free_bo(struct drm_gem_object *obj)
 		zocl_describe(zocl_obj);
 		if (zocl_obj->flags == DRM_ZOCL_BO_FLAGS_USERPTR)
 			zocl_free_userptr_bo(obj);
-		else
+		else if (zocl_bo_cacheable(zocl_obj)) {
+			struct drm_gem_cma_object *cma_obj = &zocl_obj->cma_base;
+
+			zocl_bo_cacheable_put(obj->dev, cma_obj->vaddr,
+					cma_obj->paddr, obj->size);
+			drm_gem_object_release(obj);
+			kfree(zocl_obj);
+		} else if (zocl_obj->pool_size) {
+			struct drm_gem_cma_object *cma_obj = &zocl_obj->cma_base;
+
+			zocl_bo_pool_put(obj->dev, cma_obj->vaddr,
+					cma_obj->paddr, zocl_obj->pool_size);
+			drm_gem_object_release(obj);
+			kfree(zocl_obj);
+		} else
 			drm_gem_cma_free_object(obj);
 		return;
 	}
@@ -149,6 +165,45 @@ void zocl_free_bo(struct drm_gem_object *obj)
 	kfree(zocl_obj);
 }
 
+/*
+ * Map CMA backed BO.  Same as drm_gem_cma_mmap() except that cacheable
+ * BOs, which are page allocator buffers with a streaming DMA mapping,
+ * are mapped cached.  User space syncs them with the sync ioctl.
+ */
+static int zocl_cma_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct drm_file *priv = filp->private_data;
+	struct drm_device *dev = priv->minor->dev;
+	struct drm_zocl_bo *bo;
+	unsigned long vsize = vma->vm_end - vma->vm_start;
+	int rc;
+
+	rc = drm_gem_mmap(filp, vma);
+	if (rc)
+		return rc;
+
+	/* vma->vm_private_data is set by drm_gem_mmap */
+	bo = to_zocl_bo(vma->vm_private_data);
+
+	vma->vm_flags &= ~VM_PFNMAP;
+	vma->vm_pgoff = 0;
+
+	if (zocl_bo_cacheable(bo)) {
+		unsigned long pfn = PFN_DOWN(virt_to_phys(bo->cma_base.vaddr));
+
+		vma->vm_page_prot = vm_get_page_prot(vma->vm_flags);
+		rc = remap_pfn_range(vma, vma->vm_start, pfn, vsize,
+				vma->vm_page_prot);
+	} else
+		rc = dma_mmap_wc(dev->dev, vma, bo->cma_base.vaddr,
+				bo->cma_base.paddr, vsize);
+
+	if (rc)
+		drm_gem_vm_close(vma);
+
+	return rc;
+}
+
 static int zocl_mmap(struct file *filp, struct vm_area_struct *vma)
 {
 	struct drm_file *priv = filp->private_data;
@@ -163,7 +218,7 @@ static int zocl_mmap(struct file *filp, struct vm_area_struct *vma)
 	 */
 	if (likely(vma->vm_pgoff >= ZOCL_FILE_PAGE_OFFSET)) {
 		if (!zdev->domain)
-			return drm_gem_cma_mmap(filp, vma);
+			return zocl_cma_mmap(filp, vma);
 
 		/* Map user's pages into his VM */
 		rc = drm_gem_mmap(filp, vma);
@@ -328,11 +383,21 @@ static const struct file_operations zocl_driver_fops = {
 	.release        = drm_release,
 };
 
+/* CMA helper allocated objects, e.g. imported BOs, are zocl BOs too */
+static struct drm_gem_object *
+zocl_gem_create_object(struct drm_device *dev, size_t size)
+{
+	struct drm_zocl_bo *bo = kzalloc(sizeof(*bo), GFP_KERNEL);
+
+	return bo ? &bo->cma_base.base : NULL;
+}
+
 static struct drm_driver zocl_driver = {
 	.driver_features           = DRIVER_GEM | DRIVER_PRIME | DRIVER_RENDER,
 	.open                      = zocl_client_open,
 	.postclose                 = zocl_client_release,
 	.gem_free_object           = zocl_free_bo,
+	.gem_create_object         = zocl_gem_create_object,
 	.gem_vm_ops                = &zocl_bo_vm_ops,
 	.prime_handle_to_fd        = drm_gem_prime_handle_to_fd,
 	.prime_fd_to_handle        = drm_gem_prime_fd_to_handle,
@@ -389,9 +454,14 @@ static int zocl_drm_platform_probe(struct platform_device *pdev)
 	if (!zdev)
 		return -ENOMEM;
 
+	zocl_bo_pool_init(&zdev->bo_pool);
+
 	zdev->regs       = map;
 	zdev->res_start  = res->start;
 	zdev->res_len    = resource_size(res);
+	zdev->dma_coherent = of_dma_is_coherent(pdev->dev.of_node);
+	if (zdev->dma_coherent)
+		DRM_INFO("PL access is cache coherent\n");
 
 	subdev = find_pdev("80180000.ert_hw");
 	if (subdev) {
@@ -480,6 +550,7 @@ static int zocl_drm_platform_remove(struct platform_device *pdev)
 #endif
 
 	sched_fini_exec(drm);
+	zocl_bo_pool_fini(drm);
 	zocl_free_sections(zdev);
 	zocl_fini_sysfs(drm->dev);
 
@@ -47,6 +47,8 @@ struct drm_zocl_bo {
 	};
 	struct drm_zocl_exec_metadata  metadata;
 	uint32_t                       flags;
+	/* Size of CMA allocation from BO pool, 0 if not from pool */
+	size_t                         pool_size;
 };
 
 	static inline struct drm_gem_object *
@@ -75,6 +77,18 @@ zocl_bo_execbuf(const struct drm_zocl_bo *bo)
 	return (bo->flags & DRM_ZOCL_BO_FLAGS_EXECBUF);
 }
 
+	static inline bool
+zocl_bo_cacheable(const struct drm_zocl_bo *bo)
+{
+	return (bo->flags & DRM_ZOCL_BO_FLAGS_CACHEABLE);
+}
+
+	static inline bool
+zocl_bo_host_coherent(const struct drm_zocl_bo *bo)
+{
+	return (bo->flags & DRM_ZOCL_BO_FLAGS_HOST_COHERENT);
+}
+
 
 int zocl_create_bo_ioctl(struct drm_device *dev, void *data,
 		struct drm_file *filp);
@@ -108,5 +122,11 @@ int zocl_init_sysfs(struct device *dev);
 void zocl_fini_sysfs(struct device *dev);
 void zocl_free_sections(struct drm_zocl_dev *zdev);
 void zocl_free_bo(struct drm_gem_object *obj);
+void zocl_bo_pool_init(struct zocl_bo_pool *pool);
+void zocl_bo_pool_fini(struct drm_device *dev);
+void zocl_bo_pool_put(struct drm_device *dev, void *vaddr, dma_addr_t paddr,
+		size_t size);
+void zocl_bo_cacheable_put(struct drm_device *dev, void *vaddr,
+		dma_addr_t paddr, size_t size);
 
 #endif
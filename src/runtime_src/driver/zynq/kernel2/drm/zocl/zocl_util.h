@@ -36,6 +36,22 @@
 	(ret); \
 })
 
+/* Freed CMA buffers of PAGE_SIZE << class bytes kept for reuse */
+#define ZOCL_BO_POOL_CLASSES 14
+
+/**
+ * struct zocl_bo_pool: Size class pool of freed CMA buffers
+ *
+ * @lock: Mutex lock for exclusive access
+ * @free: Per size class list of free buffers
+ * @cached: Number of bytes held in pool
+ */
+struct zocl_bo_pool {
+	struct mutex		 lock;
+	struct list_head	 free[ZOCL_BO_POOL_CLASSES];
+	size_t			 cached;
+};
+
 struct drm_zocl_dev {
 	struct drm_device       *ddev;
 	struct fpga_manager     *fpga_mgr;
@@ -52,6 +68,9 @@ struct drm_zocl_dev {
 	struct debug_ip_layout	*debug_ip;
 	struct connectivity	*connectivity;
 	u64			 unique_id_last_bitstream;
+	struct zocl_bo_pool	 bo_pool;
+	/* PL accesses snoop CPU caches, per dma-coherent in device tree */
+	bool			 dma_coherent;
 };
 
 #endif
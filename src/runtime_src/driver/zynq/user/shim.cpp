@@ -31,6 +31,8 @@
 #include <unistd.h>
 #include <vector>
 #include <poll.h>
+#include <cstdlib>
+#include <algorithm>
 //#include "xclbin.h"
 #include <assert.h>
 
@@ -130,6 +132,9 @@ ZYNQShim::ZYNQShim(unsigned index, const char *logfileName, xclVerbosityLevel ve
 ZYNQShim::~ZYNQShim()
 {
   //TODO
+  for (auto& header : mExecHeaders)
+    munmap(const_cast<ert_packet*>(header.second), sizeof(ert_packet));
+
   if (mKernelFD > 0) {
     close(mKernelFD);
   }
@@ -180,12 +185,33 @@ size_t ZYNQShim::xclRead(xclAddressSpace space, uint64_t offset, void *hostBuf,
 unsigned int ZYNQShim::xclAllocBO(size_t size, xclBOKind domain, unsigned flags) {
   // TODO: unify xocl and zocl flags.
   //drm_zocl_create_bo info = { size, 0xffffffff, DRM_ZOCL_BO_FLAGS_COHERENT | DRM_ZOCL_BO_FLAGS_CMA };
+  // Small data buffers, typically shared back and forth every frame, ask
+  // for hardware coherence, zocl grants it if PL access is coherent (HPC
+  // ports through CCI) and these buffers are mapped cached and need no
+  // sync at all.  Other data buffers are mapped uncached as before,
+  // unless XCL_ZYNQ_CACHEABLE_BO is set, then they are mapped cached
+  // and synced explicitly with xclSyncBO.
+  static const size_t coherentMaxSize = std::getenv("XCL_ZYNQ_COHERENT_BO_MAX")
+    ? std::strtoul(std::getenv("XCL_ZYNQ_COHERENT_BO_MAX"), nullptr, 0)
+    : 0x40000;
+  static const bool cacheable = std::getenv("XCL_ZYNQ_CACHEABLE_BO") != nullptr;
+  if (!(flags & DRM_ZOCL_BO_FLAGS_EXECBUF)) {
+    if (cacheable)
+      flags |= DRM_ZOCL_BO_FLAGS_CACHEABLE;
+    if (size <= coherentMaxSize)
+      flags |= DRM_ZOCL_BO_FLAGS_HOST_COHERENT;
+  }
   drm_zocl_create_bo info = { size, 0xffffffff, flags};
   int result = ioctl(mKernelFD, DRM_IOCTL_ZOCL_CREATE_BO, &info);
   if (mVerbosity == XCL_INFO) {
     std::cout  << "xclAllocBO result = " << result << std::endl;
     std::cout << "Handle " << info.handle << std::endl;
   }
+  if (!result && (info.flags & DRM_ZOCL_BO_FLAGS_CACHEABLE)
+      && !(info.flags & DRM_ZOCL_BO_FLAGS_HOST_COHERENT)) {
+    std::lock_guard<std::mutex> lk(mSyncLock);
+    mSyncBOs.insert(info.handle);
+  }
   return info.handle;
 }
 
@@ -202,6 +228,20 @@ unsigned int ZYNQShim::xclAllocUserPtrBO(void *userptr, size_t size, unsigned fl
 
 void ZYNQShim::xclFreeBO(unsigned int boHandle)
 {
+  {
+    std::lock_guard<std::mutex> lk(mSyncLock);
+    mSyncBOs.erase(boHandle);
+  }
+  {
+    std::lock_guard<std::mutex> lk(mExecLock);
+    auto itr = mExecHeaders.find(boHandle);
+    if (itr != mExecHeaders.end()) {
+      munmap(const_cast<ert_packet*>(itr->second), sizeof(ert_packet));
+      mExecHeaders.erase(itr);
+      mExecPending.erase(std::remove(mExecPending.begin(), mExecPending.end(), boHandle),
+                         mExecPending.end());
+    }
+  }
   drm_gem_close closeInfo = {boHandle, 0};
   int result = ioctl(mKernelFD, DRM_IOCTL_GEM_CLOSE, &closeInfo);
   if (mVerbosity == XCL_INFO) {
@@ -255,6 +295,7 @@ void *ZYNQShim::xclMapBO(unsigned int boHandle, bool write)
 int ZYNQShim::xclGetDeviceInfo2(xclDeviceInfo2 *info)
 {
   std::memset(info, 0, sizeof(xclDeviceInfo2));
+  info->mNumaNode = -1;
 
   info->mMagic = 0X586C0C6C;
   info->mHALMajorVersion = XCLHAL_MAJOR_VER;
@@ -288,8 +329,19 @@ int ZYNQShim::xclGetDeviceInfo2(xclDeviceInfo2 *info)
 
 int ZYNQShim::xclSyncBO(unsigned int boHandle, xclBOSyncDirection dir, size_t size, size_t offset)
 {
-  //no need to sync for MPSOC.
-  return 0;
+  // Only cacheable buffers need a sync, the driver flushes / invalidates
+  // them, all other buffers are coherent
+  {
+    std::lock_guard<std::mutex> lk(mSyncLock);
+    if (!mSyncBOs.count(boHandle))
+      return 0;
+  }
+
+  drm_zocl_sync_bo_dir zocl_dir = (dir == XCL_BO_SYNC_BO_TO_DEVICE)
+    ? DRM_ZOCL_SYNC_BO_TO_DEVICE
+    : DRM_ZOCL_SYNC_BO_FROM_DEVICE;
+  drm_zocl_sync_bo syncInfo = { boHandle, zocl_dir, offset, size };
+  return ioctl(mKernelFD, DRM_IOCTL_ZOCL_SYNC_BO, &syncInfo) ? -errno : 0;
 }
 
 #ifndef __HWEM__
@@ -419,8 +471,47 @@ void ZYNQShim::xclWriteHostEvent(xclPerfMonEventType type, xclPerfMonEventID id)
 
 int ZYNQShim::xclExecBuf(unsigned int cmdBO)
 {
+  std::lock_guard<std::mutex> lk(mExecLock);
+  if (mExecHeaders.find(cmdBO) == mExecHeaders.end()) {
+    drm_zocl_map_bo mapInfo = { cmdBO, 0, 0 };
+    if (ioctl(mKernelFD, DRM_IOCTL_ZOCL_MAP_BO, &mapInfo))
+      return -errno;
+    void *ptr = mmap(0, sizeof(ert_packet), PROT_READ, MAP_SHARED, mKernelFD, mapInfo.offset);
+    if (ptr == MAP_FAILED)
+      return -errno;
+    mExecHeaders.emplace(cmdBO, static_cast<const ert_packet*>(ptr));
+  }
+
   drm_zocl_execbuf exec = {0, cmdBO};
-  return ioctl(mKernelFD, DRM_IOCTL_ZOCL_EXECBUF, &exec);
+  int result = ioctl(mKernelFD, DRM_IOCTL_ZOCL_EXECBUF, &exec);
+  if (result == 0)
+    mExecPending.push_back(cmdBO);
+  return result;
+}
+
+/*
+ * xclExecCompletions()
+ *
+ * zocl has no completion ring, instead check the state of each exec
+ * buffer submitted since the previous call.  Never blocks, returns the
+ * number of handles copied to cmdBOs.
+ */
+int ZYNQShim::xclExecCompletions(unsigned int *cmdBOs, size_t max)
+{
+  std::lock_guard<std::mutex> lk(mExecLock);
+  size_t count = 0;
+  auto end = std::remove_if(mExecPending.begin(), mExecPending.end(),
+    [this, cmdBOs, max, &count](unsigned int bo) {
+      if (count == max)
+        return false;
+      auto state = reinterpret_cast<const volatile ert_packet*>(mExecHeaders[bo])->state;
+      if (state < ERT_CMD_STATE_COMPLETED)
+        return false;
+      cmdBOs[count++] = bo;
+      return true;
+    });
+  mExecPending.erase(end, mExecPending.end());
+  return count;
 }
 
 int ZYNQShim::xclExecWait(int timeoutMilliSec)
@@ -639,6 +730,22 @@ int xclExecWait(xclDeviceHandle handle, int timeoutMilliSec)
   return drv->xclExecWait(timeoutMilliSec);
 }
 
+int xclExecCompletions(xclDeviceHandle handle, unsigned int *cmdBOs, size_t max)
+{
+  ZYNQ::ZYNQShim *drv = ZYNQ::ZYNQShim::handleCheck(handle);
+  if (!drv)
+    return -EINVAL;
+  return drv->xclExecCompletions(cmdBOs, max);
+}
+
+int xclExecPollFd(xclDeviceHandle handle)
+{
+  ZYNQ::ZYNQShim *drv = ZYNQ::ZYNQShim::handleCheck(handle);
+  if (!drv)
+    return -EINVAL;
+  return drv->xclExecPollFd();
+}
+
 //
 // TODO: pending implementations
 //
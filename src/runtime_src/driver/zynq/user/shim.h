@@ -22,10 +22,15 @@
 
 #include "driver/include/xclhal2.h"
 #include "driver/zynq/include/zynq_ioctl.h"
+#include "driver/include/ert.h"
 //#include "driver/include/xclperf.h"
 //#include "driver/zynq/include/zynq_perfmon_params.h"
 #include <cstdint>
 #include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace ZYNQ {
 
@@ -50,6 +55,8 @@ public:
   unsigned int xclGetBOProperties(unsigned int boHandle, xclBOProperties *properties);
   int xclExecBuf(unsigned int cmdBO);
   int xclExecWait(int timeoutMilliSec);
+  int xclExecCompletions(unsigned int *cmdBOs, size_t max);
+  int xclExecPollFd() const { return mKernelFD; }
 
   // Bitstream/bin download
   int xclLoadXclBin(const xclBin *buffer);
@@ -72,6 +79,17 @@ private:
   xclVerbosityLevel mVerbosity;
   int mKernelFD;
   uint32_t* mKernelControlPtr;
+
+  // Cacheable BOs not granted DRM_ZOCL_BO_FLAGS_HOST_COHERENT, only
+  // these are synced, all other BOs need no cache maintenance
+  std::mutex mSyncLock;
+  std::unordered_set<unsigned int> mSyncBOs;
+
+  // Exec buffers submitted but not yet reaped by xclExecCompletions, and
+  // the shim's own read only mapping of each exec buffer header
+  std::mutex mExecLock;
+  std::vector<unsigned int> mExecPending;
+  std::unordered_map<unsigned int, const ert_packet*> mExecHeaders;
 };
 
 }
@@ -42,7 +42,7 @@ void fake_xil_printf(char* somestring, ...) {
 // Please bump uo the patchlevel every time you update the file
 #define BOARD_MON_MAJOR 2017
 #define BOARD_MON_MINOR 4
-#define BOARD_MON_PATCHLEVEL 3
+#define BOARD_MON_PATCHLEVEL 4
 
 //Set version number based on commit # in repo
 #define BOARD_MON_VERSION_NUM (BOARD_MON_MAJOR * 1000 + BOARD_MON_MINOR * 100 + BOARD_MON_PATCHLEVEL)
@@ -93,6 +93,7 @@ void fake_xil_printf(char* somestring, ...) {
 #define POWMON_SUPPORT              0x00000001
 #define BMC_COMM_SUPPORT            0x00000002
 #define CLOCK_SCALE_SUPPORT         0x00000004
+#define SENSOR_BLOCK_SUPPORT        0x00000008
 #define MGTAVTT_AVAILABLE           0x00010000
 #define MGTAVCCC_AVAILABLE          0x00020000
 #define VCCBRAM_AVAILABLE           0x00040000
@@ -180,6 +181,17 @@ void fake_xil_printf(char* somestring, ...) {
 //Power Checksum Register
 #define CUR_CHKSUM_REG      34
 #define CUR_CHKSUM_ADDR             0x01A4
+//Sensor block, a packed copy of all registers for the host to read in one burst
+//Values are in RegisterMap order, the block is consistent when both sequence
+//numbers are equal and even. See publish_sensor_block()
+#define SENSOR_BLOCK_ADDR           0x0200
+#define SENSOR_BLOCK_MAGIC          0x534E5342 //"SNSB"
+#define SENSOR_BLOCK_VERSION        1
+#define SENSOR_BLOCK_MAGIC_ADDR     (SENSOR_BLOCK_ADDR + 0x0)
+#define SENSOR_BLOCK_VERSION_ADDR   (SENSOR_BLOCK_ADDR + 0x4) //Version in bits 15:0, number of values in bits 31:16
+#define SENSOR_BLOCK_SEQ_HEAD_ADDR  (SENSOR_BLOCK_ADDR + 0x8)
+#define SENSOR_BLOCK_VALUES_ADDR    (SENSOR_BLOCK_ADDR + 0xC)
+#define SENSOR_BLOCK_SEQ_TAIL_ADDR  (SENSOR_BLOCK_VALUES_ADDR + NUM_REGISTERS*4)
 /* TODO: If supported make sure to update register indices
 //Kernel MMCM0 Registers
 #define KERNEL_MMCM0_STAT_REG 26
@@ -536,6 +548,8 @@ void pmbus_print_voltage(u32 IIC, SupplyStats *supply);
 void pmbus_print_current(u32 IIC, SupplyStats *supply);
 int store_current(u32 IIC, SupplyStats *supply);
 void write_cur_checksum();
+void init_sensor_block();
+void publish_sensor_block();
 int init_board_info(u32 feature_rom);
 void write_reg(Register *reg, u32 val);
 u32 read_reg(Register *reg);
@@ -552,6 +566,28 @@ void write_cur_checksum() {
 	write_reg(&RegisterMap[CUR_CHKSUM_REG], cur_checksum);
 }
 
+void init_sensor_block() {
+	XBram_WriteReg(bram, SENSOR_BLOCK_SEQ_HEAD_ADDR, 0);
+	XBram_WriteReg(bram, SENSOR_BLOCK_SEQ_TAIL_ADDR, 1);
+	XBram_WriteReg(bram, SENSOR_BLOCK_VERSION_ADDR, SENSOR_BLOCK_VERSION | (NUM_REGISTERS << 16));
+	XBram_WriteReg(bram, SENSOR_BLOCK_MAGIC_ADDR, SENSOR_BLOCK_MAGIC);
+	write_reg(&RegisterMap[FEATURES_REG], RegisterMap[FEATURES_REG].reg_val | SENSOR_BLOCK_SUPPORT);
+}
+
+//The tail sequence number is made odd before the values are updated and both
+//get the next even number after, so a host reading from head to tail only
+//sees equal even numbers if no value changed during its read
+void publish_sensor_block() {
+	static u32 seq = 0;
+
+	XBram_WriteReg(bram, SENSOR_BLOCK_SEQ_TAIL_ADDR, seq + 1);
+	for(u8 i=0; i<NUM_REGISTERS; i++)
+		XBram_WriteReg(bram, SENSOR_BLOCK_VALUES_ADDR + i*4, RegisterMap[i].reg_val);
+	seq += 2;
+	XBram_WriteReg(bram, SENSOR_BLOCK_SEQ_HEAD_ADDR, seq);
+	XBram_WriteReg(bram, SENSOR_BLOCK_SEQ_TAIL_ADDR, seq);
+}
+
 int iic_mux_select(u32 IIC, u8 iic_mux_chan){
 	if(sizeof(iic_mux_chan) != XIic_Send(IIC, _board_info.iic_mux_addr, &iic_mux_chan, sizeof(iic_mux_chan), XIIC_STOP)) {
 	    xil_printf("Failed to set IIC Mux!\n");
@@ -1025,6 +1061,8 @@ int main ()
 	for(int i=0;i<_board_info.num_supplies;i++)
 	    _board_info.supplies[i].sum_iout = 0;
 
+	init_sensor_block();
+
 	//Initialize I2C
 	if(!msp432_support) {
 	    IIC = XPAR_STATIC_REGION_BRD_MGMT_SCHEDULER_BOARD_MANAGEMENT_BOARD_I2C_CTRL_BASEADDR;
@@ -1129,6 +1167,7 @@ int main ()
 		    }
         } else
 		    write_cur_checksum();
+	    publish_sensor_block();
 	    XIntc_MasterEnable(intc);
 	}
 
@@ -175,6 +175,13 @@ struct bitset_type
     return bitmasks[mask_idx];
   }
 
+  void
+  clear(size_type pos)
+  {
+    auto mask = pos >> 5;
+    bitmasks[mask] &= ~(1<<(pos - (mask << 5)));
+  }
+
   void
   toggle(size_type pos)
   {
@@ -263,6 +270,11 @@ static value_type cq_status_enabled         = 0;
 static value_type mb_host_interrupt_enabled = 0;
 static value_type cu_dma_52                 = 0;
 static value_type cdma_enabled              = 0;
+static value_type cu_cycles_enabled         = 0;
+
+// Regmap size (words) below which regmap is copied by MB even if
+// CU DMA is enabled.  0 means always use CU DMA when enabled.
+static size_type cu_dma_threshold           = 0;
 
 // Struct slot_info is per command slot in command queue
 struct slot_info
@@ -278,6 +290,9 @@ struct slot_info
   // free    [0x4]: the command slot is free
   value_type header_value = 0;
 
+  // Opcode of command in slot, decoded once when slot becomes new
+  value_type cmd_opcode = 0;
+
   // Bitset of CUs that can be used by current command in slot
   bitset_type cus;
 
@@ -294,10 +309,21 @@ static slot_info command_slots[max_slots];
 // Fixed sized map from cu_idx -> slot_idx
 static size_type cu_slot_usage[max_cus];
 
+// Bitsets of slots in each slot state, indexed by state value
+// new (0x1), queued (0x2), running (0x3), free (0x4).  The scheduler
+// loop visits only the slots flagged in the bitset of a state rather
+// than reading the header of every slot.
+static bitset_type slot_state_mask[5];
+
 // Bitmask indicating status of CUs. (0) idle, (1) running.
 // Only 'num_cus' lower bits are used
 static bitset_type cu_status;
 
+// Bitmask of CUs whose command was aborted while running.  A fenced
+// CU remains busy in cu_status until the MB is configured again, its
+// interrupts are ignored since no command is associated with it.
+static bitset_type cu_fenced;
+
 // Bitmask for interrupt enabled CUs.  (0) no interrupt (1) enabled
 static bitset_type cu_interrupt_mask;
 #ifndef ERT_HW_EMU
@@ -321,6 +347,43 @@ write_reg(addr_type addr, value_type val)
   *ptr = val;
 }
 #endif
+
+#if defined(XPAR_TMRCTR_0_BASEADDR) && !defined(ERT_HW_EMU)
+// Free running AXI timer used to count CU configure cycles
+const addr_type ERT_TIMER_ADDR = XPAR_TMRCTR_0_BASEADDR;
+
+/**
+ * Start timer 0 counting up with auto reload from 0
+ */
+inline bool
+start_cycles()
+{
+  write_reg(ERT_TIMER_ADDR + 0x4,0);    // TLR0 load value
+  write_reg(ERT_TIMER_ADDR,0x20);       // TCSR0 LOAD0
+  write_reg(ERT_TIMER_ADDR,0x90);       // TCSR0 ENT0 | ARHT0
+  return true;
+}
+
+inline value_type
+read_cycles()
+{
+  return read_reg(ERT_TIMER_ADDR + 0x8); // TCR0
+}
+#else
+// No timer in this build, cycle reporting cannot be enabled
+inline bool
+start_cycles()
+{
+  return false;
+}
+
+inline value_type
+read_cycles()
+{
+  return 0;
+}
+#endif
+
 /**
  * Command opcode [27:23]
  */
@@ -448,16 +511,21 @@ setup()
   INIT_DEBUGF("cu_base_address=0x%x\n",cu_base_address);
   INIT_DEBUGF("cu_dma_enabled=%d\n",cu_dma_enabled);
   INIT_DEBUGF("cu_dma_52=%d\n",cu_dma_52);
+  INIT_DEBUGF("cu_dma_threshold=%d\n",cu_dma_threshold);
   INIT_DEBUGF("cdma_enabled=%d\n",cdma_enabled);
   INIT_DEBUGF("cu_isr_enabled=%d\n",cu_interrupt_enabled);
   INIT_DEBUGF("cq_int_enabled=%d\n",cq_status_enabled);
   INIT_DEBUGF("mb_host_int_enabled=%d\n",mb_host_interrupt_enabled);
 
   // Initialize command slots
+  for (auto& mask : slot_state_mask)
+    mask.reset(num_slots-1);
   for (size_type i=0; i<num_slots; ++i) {
     auto& slot = command_slots[i];
     slot.slot_addr = ERT_CQ_BASE_ADDR + (slot_size * i);
     slot.header_value = 0x4; // free
+    slot.cmd_opcode = 0;
+    slot_state_mask[0x4].set(i);
     slot.cus.reset(num_cus);
     slot.regmap_addr = 0;
     slot.regmap_size = 0;
@@ -471,6 +539,7 @@ setup()
  	 write_reg(STATUS_REGISTER_ADDR[i],0);
 
   cu_status.reset(num_cus);
+  cu_fenced.reset(num_cus);
 
   // Initialize cu_slot_usage
   for (size_type i=0; i<num_cus; ++i)
@@ -557,12 +626,32 @@ setup()
     microblaze_disable_interrupts();          // enable interrupts
   }
 
+  // Count CU configure cycles if requested and a timer is present
+  if (cu_cycles_enabled)
+    cu_cycles_enabled = start_cycles();
+  INIT_DEBUGF("cu_cycles_enabled=%d\n",cu_cycles_enabled);
+
   // Enable/disable mb->host interrupts
   write_reg(ERT_HOST_INTERRUPT_ENABLE_ADDR,mb_host_interrupt_enabled);
 
   INIT_DEBUG("<- setup\n");
 }
 
+/**
+ * Change state of slot and move slot to bitset of new state
+ *
+ * Caller must disable interrupts if the bitsets involved are also
+ * modified by the interrupt handler.
+ */
+inline void
+set_slot_state(size_type slot_idx, value_type state)
+{
+  auto& slot = command_slots[slot_idx];
+  slot_state_mask[slot.header_value & 0xF].clear(slot_idx);
+  slot.header_value = (slot.header_value & ~0xF) | state;
+  slot_state_mask[state].set(slot_idx);
+}
+
 /**
  * Associate CUs with a command slot
  */
@@ -677,12 +766,17 @@ start_cu(size_type slot_idx)
     if (cus.test(cu_idx) && !cu_status.test(cu_idx)) {
       ERT_DEBUGF("start_cu cu(%d) for slot_idx(%d)\n",cu_idx,slot_idx);
       ERT_ASSERT(read_reg(cu_idx_to_addr(cu_idx))==4,"cu not ready");
-      if (cu_dma_enabled) { // hardware transfer and start
+      auto start = read_cycles();
+      if (cu_dma_enabled && slot.regmap_size>=cu_dma_threshold) { // hardware transfer and start
         configure_cu_dma(cu_idx,slot_idx,slot.slot_addr);
       }
       else { // manually configure and start cu
         configure_cu(cu_idx_to_addr(cu_idx),slot.regmap_addr,slot.regmap_size);
       }
+      // report configure cycles in last word of slot, host reads
+      // it when command completes
+      if (cu_cycles_enabled)
+        write_reg(slot.slot_addr + slot_size - sizeof(value_type),read_cycles() - start);
       cu_status.toggle(cu_idx);     // toggle cu status bit, it is now busy
       set_cu_info(cu_idx,slot_idx); // record which slot cu associated with
       return cu_idx;
@@ -712,7 +806,7 @@ check_command(size_type slot_idx, size_type cu_idx)
   slot.cus.toggle(cu_idx);
   if (slot.cus.none()) {
     notify_host(slot_idx);
-    slot.header_value = (slot.header_value & ~0xF) | 0x4; // free
+    set_slot_state(slot_idx,0x4); // free
     ERT_DEBUGF("slot(%d) [running -> free]\n",slot_idx);
 
 #ifdef DEBUG_SLOT_STATE
@@ -804,6 +898,8 @@ configure_mb(size_type slot_idx)
   cu_interrupt_enabled = (features & 0x8)!=0;
   cq_status_enabled = (features & 0x10)!=0;
   cdma_enabled = (features & 0x20)!=0;
+  cu_cycles_enabled = (features & 0x40)!=0;
+  cu_dma_threshold = (features >> 7) & 0xFF;
   cu_dma_52 = (features & 0x80000000)!=0;
 
   // CU base address
@@ -818,7 +914,7 @@ configure_mb(size_type slot_idx)
   // notify host
   notify_host(slot_idx);
 
-  slot.header_value = (slot.header_value & ~0xF) | 0x4; // free
+  set_slot_state(slot_idx,0x4); // free
   ERT_DEBUGF("slot(%d) [running -> free]\n",slot_idx);
 
   INIT_DEBUG("<--configure_mb\n");
@@ -862,19 +958,28 @@ abort_mb(size_type slot_idx)
   auto& slot = command_slots[slot_idx];
   size_type sidx = (slot.header_value >>  15) & 0xFF;
   auto& s = command_slots[sidx];
-  if (opcode(s.header_value)!=ERT_START_KERNEL)
-    return true; // bail if not a start_kernel command
-  if ((s.header_value & 0xF)!=0x3)
-    return true; // bail if not running
-  for (size_type cu_idx=0; cu_idx<num_cus; ++cu_idx) {
-    if (s.cus.test(cu_idx)) {
-      check_command(sidx,cu_idx);
-      cu_slot_usage[cu_idx] = no_index;
-      cu_status.toggle(cu_idx);
+  auto state = s.header_value & 0xF;
+  if (s.cmd_opcode==ERT_START_KERNEL && state==0x2) {
+    // not yet started on a CU, retire as is
+    notify_host(sidx);
+    set_slot_state(sidx,0x4); // free
+  }
+  else if (s.cmd_opcode==ERT_START_KERNEL && state==0x3) {
+    // retire the command, but fence its CU which may still be running
+    // or hung, the CU stays busy until the MB is configured again
+    for (size_type cu_idx=0; cu_idx<num_cus; ++cu_idx) {
+      if (s.cus.test(cu_idx)) {
+        cu_fenced.set(cu_idx);
+        cu_slot_usage[cu_idx] = no_index;
+      }
     }
+    notify_host(sidx);
+    set_slot_state(sidx,0x4); // free
   }
 
+  // acknowledge the abort command itself
   notify_host(slot_idx);
+  set_slot_state(slot_idx,0x4); // free
   return true;
 }
 
@@ -915,7 +1020,17 @@ free_to_new(size_type slot_idx)
   if ((header & 0xF) == 0x1) {
     ERT_DEBUGF("new slot(%d)\n",slot_idx);
     write_reg(slot.slot_addr,header | 0xF);
+    if (cq_status_enabled) {
+      // called from host interrupt handler
+      set_slot_state(slot_idx,0x1);
+    }
+    else {
+      // free slots are also released by cu interrupt handler
+      disable_interrupt_guard guard;
+      set_slot_state(slot_idx,0x1);
+    }
     slot.header_value = header;
+    slot.cmd_opcode = opcode(header);
     ERT_DEBUGF("slot(%d) [free -> new]\n",slot_idx);
     return true;
   }
@@ -934,7 +1049,7 @@ new_to_queued(size_type slot_idx)
   auto& slot = command_slots[slot_idx];
   ERT_ASSERT((slot.header_value & 0xF)==0x1,"slot is not new\n");
 
-  auto opc = opcode(slot.header_value);
+  auto opc = slot.cmd_opcode;
   ERT_DEBUGF("slot_idx(%d) opcode = %d\n",slot_idx,opc);
   if (opc!=ERT_START_KERNEL) { // Non performance critical command
     process_special_command(opc,slot_idx);
@@ -948,7 +1063,12 @@ new_to_queued(size_type slot_idx)
   }
   slot.regmap_addr = regmap_section_addr(slot.header_value,slot.slot_addr);
   slot.regmap_size = regmap_size(slot.header_value);
-  slot.header_value = (slot.header_value & ~0xF) | 0x2; // queued
+
+  {
+    // new slots are also flagged by host interrupt handler
+    disable_interrupt_guard guard;
+    set_slot_state(slot_idx,0x2); // queued
+  }
 
   ERT_DEBUGF("slot(%d) [new -> queued]\n",slot_idx);
 
@@ -977,7 +1097,7 @@ queued_to_running(size_type slot_idx)
   auto cu_idx = start_cu(slot_idx);
   if (cu_idx != no_index) {
     slot.cus.clear_and_set(cu_idx); // bitmask now reflects running cu
-    slot.header_value |= 0x1;       // running (0x2->0x3)
+    set_slot_state(slot_idx,0x3);   // running
     ERT_DEBUGF("slot(%d) [queued -> running]\n",slot_idx);
 
 #ifdef DEBUG_SLOT_STATE
@@ -1006,7 +1126,11 @@ running_to_free(size_type slot_idx)
     for (size_type cu_idx=offset; cu_mask; cu_mask >>=1, ++cu_idx) {
       if ((cu_mask & 0x1) && check_cu(cu_idx,false)) {
         notify_host(slot_idx);
-        slot.header_value = (slot.header_value & ~0xF) | 0x4; // free
+        {
+          // free slots are also consumed by host interrupt handler
+          disable_interrupt_guard guard;
+          set_slot_state(slot_idx,0x4); // free
+        }
         ERT_DEBUGF("slot(%d) [running -> free]\n",slot_idx);
 
 #ifdef DEBUG_SLOT_STATE
@@ -1022,16 +1146,23 @@ running_to_free(size_type slot_idx)
 /**
  * Main routine executed by embedded scheduler loop
  *
- * For each command slot do
- *  1. If status is free (0x4), then read new command header
- *     Status remains free (0x4), or transitions to new (0x1)
- *  2. If status is new (0x1), then read CUs in command
+ * For each 32 slot mask do
+ *  1. For each free slot (0x4), read new command header
+ *     Status remains free (0x4), or transitions to new (0x1).
+ *     Skipped when CQ status is enabled, in which case the interrupt
+ *     handler reads the CQ status registers and flags new slots.
+ *  2. For each new slot (0x1), read CUs in command
  *     Status transitions to queued (0x2)
- *  3. If status is queued (0x2), then start command on available CU
+ *  3. For each queued slot (0x2), start command on available CU
  *     Status remains queued if no CUs available, or transitions to running (0x3)
- *  4. If status is running (0x4), then check CU status
- *     Status remains running (0x4) if CU is still running, or
- *     transitions to free if CU is done
+ *  4. For each running slot (0x3), check CU status
+ *     Status remains running (0x3) if CU is still running, or
+ *     transitions to free if CU is done.
+ *     Skipped when CU interrupts are enabled.
+ *
+ * Only slots flagged in the corresponding slot state bitset are
+ * visited.  A slot's state is checked again before each transition
+ * since a special command (configure) may reset all slots.
  */
 ERT_UNUSED // don't warn when unused
 static void
@@ -1044,8 +1175,7 @@ scheduler_loop()
   setup();
 
   while (1) {
-    for (size_type slot_idx=0; slot_idx<num_slots; ++slot_idx) {
-      auto& slot = command_slots[slot_idx];
+    for (size_type w=0,offset=0; w<num_slot_masks; ++w,offset+=32) {
 #ifdef ERT_HW_EMU
       if(sim_embedded_scheduler_sw_imp::getSchedularPtr()!=nullptr) {
       sim_embedded_scheduler_sw_imp* sch=sim_embedded_scheduler_sw_imp::getSchedularPtr();
@@ -1057,24 +1187,28 @@ scheduler_loop()
 #endif
       // CQ_STATUS_ENABLED CHECK WON'T WORK IF HOST TRANSITIONS
       // FROM ENABLED -> DISABLED IN CONFIGURE COMMAND
-      if (!cq_status_enabled && ((slot.header_value & 0xF) == 0x4)) { // free
-        if (!free_to_new(slot_idx))
-          continue;
-      }
-
-      if ((slot.header_value & 0xF) == 0x1) { // new
-        if (!new_to_queued(slot_idx))
-          continue;
+      if (!cq_status_enabled) {
+        auto slot_mask = slot_state_mask[0x4].get_mask(w);
+        for (size_type slot_idx=offset; slot_mask; slot_mask >>= 1, ++slot_idx)
+          if (slot_mask & 0x1)
+            free_to_new(slot_idx);
       }
 
-      if ((slot.header_value & 0xF) == 0x2) { // queued
-        if (!queued_to_running(slot_idx))
-          continue;
-      }
+      auto slot_mask = slot_state_mask[0x1].get_mask(w);
+      for (size_type slot_idx=offset; slot_mask; slot_mask >>= 1, ++slot_idx)
+        if ((slot_mask & 0x1) && (command_slots[slot_idx].header_value & 0xF) == 0x1)
+          new_to_queued(slot_idx);
 
-      if (!cu_interrupt_enabled && ((slot.header_value & 0xF) == 0x3)) { // running
-        if (!running_to_free(slot_idx))
-          continue;
+      slot_mask = slot_state_mask[0x2].get_mask(w);
+      for (size_type slot_idx=offset; slot_mask; slot_mask >>= 1, ++slot_idx)
+        if ((slot_mask & 0x1) && (command_slots[slot_idx].header_value & 0xF) == 0x2)
+          queued_to_running(slot_idx);
+
+      if (!cu_interrupt_enabled) {
+        slot_mask = slot_state_mask[0x3].get_mask(w);
+        for (size_type slot_idx=offset; slot_mask; slot_mask >>= 1, ++slot_idx)
+          if ((slot_mask & 0x1) && (command_slots[slot_idx].header_value & 0xF) == 0x3)
+            running_to_free(slot_idx);
       }
     }
   } // while
@@ -1097,6 +1231,9 @@ cu_interrupt_handler()
         if (cu_mask & 0x1) {
           ERT_DEBUGF("cu(%d) is interrupting\n",cu_idx);
           ERT_ASSERT(cu_status.test(cu_idx),"cu wasn't started");
+          // fenced cu completed an aborted command, it stays busy
+          if (cu_fenced.test(cu_idx))
+            continue;
           // check if command is done
           check_command(cu_slot_usage[cu_idx],cu_idx);
           cu_slot_usage[cu_idx] = no_index; // reset slot index
@@ -1121,9 +1258,11 @@ cu_interrupt_handler()
     auto cu_idx = num_cus-1; // cdma is last cu
     ERT_DEBUGF("cdma cu(%d) interrupts\n",cu_idx);
     ERT_ASSERT(cu_status.test(cu_idx),"cdma cu wasn't started");
-    check_command(cu_slot_usage[cu_idx],cu_idx);
-    cu_slot_usage[cu_idx] = no_index; // reset slot index;
-    cu_status.toggle(cu_idx); // toggle status of completed cus
+    if (!cu_fenced.test(cu_idx)) {
+      check_command(cu_slot_usage[cu_idx],cu_idx);
+      cu_slot_usage[cu_idx] = no_index; // reset slot index;
+      cu_status.toggle(cu_idx); // toggle status of completed cus
+    }
 
     // Reset cdma (1) read status to clear it, (2) reset isr at base + 0xC
     ERT_UNUSED volatile auto val = read_reg(cu_idx_to_addr(cu_idx));
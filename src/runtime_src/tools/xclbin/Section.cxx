@@ -35,7 +35,9 @@ Section::Section()
     , m_sKindName("")
     , m_pBuffer(nullptr)
     , m_bufferSize(0)
-    , m_name("") {
+    , m_name("")
+    , m_bPayloadDeferred(false)
+    , m_sourceOffset(0) {
   // Empty
 }
 
@@ -51,6 +53,8 @@ Section::purgeBuffers()
     m_pBuffer = nullptr;
   }
   m_bufferSize = 0;
+  m_bPayloadDeferred = false;
+  m_sourceOffset = 0;
 }
 
 void
@@ -238,6 +242,69 @@ Section::readXclBinBinary(std::fstream& _istream, const axlf_section_header& _se
 }
 
 
+void
+Section::readXclBinBinaryReference(const axlf_section_header& _sectionHeader) {
+  // Some error checking
+  if ((enum axlf_section_kind)_sectionHeader.m_sectionKind != getSectionKind()) {
+    std::string errMsg = XUtil::format("Error: Unexpected section kind.  Expected: %d, Read: %d", getSectionKind(), _sectionHeader.m_sectionKind);
+    throw std::runtime_error(errMsg);
+  }
+
+  if (m_pBuffer != nullptr) {
+    std::string errMsg = "Error: Binary buffer already exists.";
+    throw std::runtime_error(errMsg);
+  }
+
+  // Only record where the payload lives, it is copied file to file on write
+  m_name = (char*)&_sectionHeader.m_sectionName;
+  m_bufferSize = _sectionHeader.m_sectionSize;
+  m_sourceOffset = _sectionHeader.m_sectionOffset;
+  m_bPayloadDeferred = true;
+
+  XUtil::TRACE(XUtil::format("Section: %s (%d) deferred", getSectionKindAsString().c_str(), (unsigned int)getSectionKind()));
+  XUtil::TRACE(XUtil::format("  m_name: %s", m_name.c_str()));
+  XUtil::TRACE(XUtil::format("  m_size: %ld", m_bufferSize));
+  XUtil::TRACE(XUtil::format("  m_offset: 0x%lx", m_sourceOffset));
+}
+
+void
+Section::materializePayload(std::fstream& _istream) {
+  if (!m_bPayloadDeferred) {
+    return;
+  }
+
+  axlf_section_header sectionHeader = (axlf_section_header){ 0 };
+  sectionHeader.m_sectionKind = getSectionKind();
+  sectionHeader.m_sectionOffset = m_sourceOffset;
+  sectionHeader.m_sectionSize = m_bufferSize;
+  XUtil::safeStringCopy((char*)&sectionHeader.m_sectionName, m_name, sizeof(axlf_section_header::m_sectionName));
+
+  m_bPayloadDeferred = false;
+  m_sourceOffset = 0;
+  readXclBinBinary(_istream, sectionHeader);
+}
+
+bool
+Section::isPayloadDeferred() const {
+  return m_bPayloadDeferred;
+}
+
+uint64_t
+Section::getSourceOffset() const {
+  return m_sourceOffset;
+}
+
+bool
+Section::hasJSONImage() const {
+  // Sections registered with a JSON name marshal their payload into the mirror data
+  for (auto & item : m_mapJSONNameToKind) {
+    if (item.second == m_eKind) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void 
 Section::readJSONSectionImage(const boost::property_tree::ptree& _ptSection)
 {
@@ -298,9 +365,23 @@ Section::readXclBinBinary(std::fstream& _istream,
 
 void
 Section::getPayload(boost::property_tree::ptree& _pt) const {
+  // Deferred payloads are mirrored as an image (offset and size) only
+  if (m_bPayloadDeferred) {
+    return;
+  }
   marshalToJSON(m_pBuffer, m_bufferSize, _pt);
 }
 
+void
+Section::readRawPayload(std::fstream& _istream, const axlf_section_header& _sectionHeader) {
+  readXclBinBinary(_istream, _sectionHeader);
+}
+
+void
+Section::writeRawPayload(std::fstream& _ostream) const {
+  writeXclBinSectionBuffer(_ostream);
+}
+
 void
 Section::marshalToJSON(char* _pDataSegment,
                        unsigned int _segmentSize,
@@ -330,7 +411,7 @@ Section::readPayload(std::fstream& _istream, enum FormatType _eFormatType)
         _istream.seekg(0, _istream.end);
         sectionHeader.m_sectionSize = _istream.tellg();
 
-        readXclBinBinary(_istream, sectionHeader);
+        readRawPayload(_istream, sectionHeader);
         break;
       }
     case FT_JSON:
@@ -435,7 +516,7 @@ Section::dumpContents(std::fstream& _ostream, enum FormatType _eFormatType) cons
   switch (_eFormatType) {
   case FT_RAW:
     {
-      writeXclBinSectionBuffer(_ostream);
+      writeRawPayload(_ostream);
       break;
     }
   case FT_JSON:
@@ -88,11 +88,24 @@ class Section {
   void purgeBuffers();
   void setName(const std::string &_sSectionName);
 
+ public:
+  // Streaming helpers - the payload stays in the source file until needed
+  void readXclBinBinaryReference(const axlf_section_header& _sectionHeader);
+  void materializePayload(std::fstream& _istream);
+  bool isPayloadDeferred() const;
+  uint64_t getSourceOffset() const;
+  bool hasJSONImage() const;
+
  protected:
   // Child class option to create an JSON metadata
   virtual void marshalToJSON(char* _pDataSection, unsigned int _sectionSize, boost::property_tree::ptree& _ptree) const;
   virtual void marshalFromJSON(const boost::property_tree::ptree& _ptSection, std::ostringstream& _buf) const;
 
+ protected:
+  // Child class option to transform a RAW payload, as added and dumped by the user
+  virtual void readRawPayload(std::fstream& _istream, const axlf_section_header& _sectionHeader);
+  virtual void writeRawPayload(std::fstream& _ostream) const;
+
  protected:
   Section();
 
@@ -108,6 +121,9 @@ class Section {
   unsigned int m_bufferSize;
   std::string m_name;
 
+  bool m_bPayloadDeferred;
+  uint64_t m_sourceOffset;
+
  private:
   static std::map<enum axlf_section_kind, std::string> m_mapIdToName;
   static std::map<std::string, enum axlf_section_kind> m_mapNameToId;
@@ -0,0 +1,102 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "SectionBitstreamCompressed.h"
+
+#include <memory>
+#include <stdexcept>
+#include <zlib.h>
+
+#include "XclBinUtilities.h"
+namespace XUtil = XclBinUtilities;
+
+// Static Variables / Classes
+SectionBitstreamCompressed::_init SectionBitstreamCompressed::_initializer;
+
+SectionBitstreamCompressed::SectionBitstreamCompressed() {
+  // Empty
+}
+
+SectionBitstreamCompressed::~SectionBitstreamCompressed() {
+  // Empty
+}
+
+void
+SectionBitstreamCompressed::readRawPayload(std::fstream& _istream,
+                                           const axlf_section_header& _sectionHeader) {
+  if (m_pBuffer != nullptr) {
+    std::string errMsg = "Error: Binary buffer already exists.";
+    throw std::runtime_error(errMsg);
+  }
+
+  std::unique_ptr<Bytef[]> raw(new Bytef[_sectionHeader.m_sectionSize]);
+  _istream.seekg(_sectionHeader.m_sectionOffset);
+  _istream.read((char*)raw.get(), _sectionHeader.m_sectionSize);
+  if (_istream.gcount() != (std::streamsize)_sectionHeader.m_sectionSize) {
+    std::string errMsg = "ERROR: Input stream for the binary buffer is smaller then the expected size.";
+    throw std::runtime_error(errMsg);
+  }
+
+  uLongf compressedSize = compressBound(_sectionHeader.m_sectionSize);
+  std::unique_ptr<Bytef[]> compressed(new Bytef[compressedSize]);
+  int ret = compress2(compressed.get(), &compressedSize, raw.get(), _sectionHeader.m_sectionSize, Z_DEFAULT_COMPRESSION);
+  if (ret != Z_OK) {
+    std::string errMsg = XUtil::format("ERROR: Unable to compress the bitstream (%d).", ret);
+    throw std::runtime_error(errMsg);
+  }
+
+  m_name = (char*)&_sectionHeader.m_sectionName;
+  m_bufferSize = compressedSize;
+  m_pBuffer = new char[m_bufferSize];
+  memcpy(m_pBuffer, compressed.get(), m_bufferSize);
+
+  XUtil::TRACE(XUtil::format("Section: %s (%d)", getSectionKindAsString().c_str(), (unsigned int)getSectionKind()));
+  XUtil::TRACE(XUtil::format("  m_name: %s", m_name.c_str()));
+  XUtil::TRACE(XUtil::format("  m_size: %ld, raw: %ld", m_bufferSize, _sectionHeader.m_sectionSize));
+}
+
+void
+SectionBitstreamCompressed::writeRawPayload(std::fstream& _ostream) const {
+  if ((m_pBuffer == nullptr) ||
+      (m_bufferSize == 0)) {
+    return;
+  }
+
+  z_stream strm = {};
+  if (inflateInit(&strm) != Z_OK) {
+    std::string errMsg = "ERROR: Unable to initialize bitstream decompression.";
+    throw std::runtime_error(errMsg);
+  }
+
+  strm.next_in = (Bytef*)m_pBuffer;
+  strm.avail_in = m_bufferSize;
+
+  const unsigned int chunkSize = 64 * 1024;
+  std::unique_ptr<Bytef[]> chunk(new Bytef[chunkSize]);
+  int ret = Z_OK;
+  while (ret != Z_STREAM_END) {
+    strm.next_out = chunk.get();
+    strm.avail_out = chunkSize;
+    ret = inflate(&strm, Z_NO_FLUSH);
+    if ((ret != Z_OK) && (ret != Z_STREAM_END)) {
+      inflateEnd(&strm);
+      std::string errMsg = XUtil::format("ERROR: Compressed bitstream is corrupted (%d).", ret);
+      throw std::runtime_error(errMsg);
+    }
+    _ostream.write((char*)chunk.get(), chunkSize - strm.avail_out);
+  }
+  inflateEnd(&strm);
+}
@@ -0,0 +1,59 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __SectionBitstreamCompressed_h_
+#define __SectionBitstreamCompressed_h_
+
+// ----------------------- I N C L U D E S -----------------------------------
+
+// #includes here - please keep these to a bare minimum!
+#include "Section.h"
+#include <boost/functional/factory.hpp>
+
+// ------------ F O R W A R D - D E C L A R A T I O N S ----------------------
+// Forward declarations - use these instead whenever possible...
+
+// ------------------- C L A S S :   S e c t i o n ---------------------------
+
+/**
+ *    This class represents a BITSTREAM section stored as a zlib stream.
+ *    RAW payloads are compressed when added and inflated when dumped, the
+ *    driver inflates the section while downloading it.
+*/
+
+class SectionBitstreamCompressed : public Section {
+ public:
+  SectionBitstreamCompressed();
+  virtual ~SectionBitstreamCompressed();
+
+ protected:
+  virtual void readRawPayload(std::fstream& _istream, const axlf_section_header& _sectionHeader);
+  virtual void writeRawPayload(std::fstream& _ostream) const;
+
+ private:
+  // Purposefully private and undefined ctors...
+  SectionBitstreamCompressed(const SectionBitstreamCompressed& obj);
+  SectionBitstreamCompressed& operator=(const SectionBitstreamCompressed& obj);
+
+ private:
+  // Static initializer helper class
+  static class _init {
+   public:
+    _init() { registerSectionCtor(BITSTREAM_COMPRESSED, "BITSTREAM_COMPRESSED", "", boost::factory<SectionBitstreamCompressed*>()); }
+  } _initializer;
+};
+
+#endif
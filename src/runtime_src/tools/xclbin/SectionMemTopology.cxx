@@ -53,6 +53,8 @@ SectionMemTopology::getMemTypeStr(enum MEM_TYPE _memType) const {
       return "MEM_PREALLOCATED_GLOB";
     case MEM_ARE:
       return "MEM_ARE";
+    case MEM_HOST:
+      return "MEM_HOST";
   }
 
   return XUtil::format("UNKNOWN (%d)", (unsigned int)_memType);
@@ -87,6 +89,9 @@ SectionMemTopology::getMemType(std::string& _sMemType) const {
   if (_sMemType == "MEM_ARE")
     return MEM_ARE;
 
+  if (_sMemType == "MEM_HOST")
+    return MEM_HOST;
+
   std::string errMsg = "ERROR: Unknown memory type: '" + _sMemType + "'";
   throw std::runtime_error(errMsg);
 }
@@ -27,6 +27,9 @@
 #include <boost/uuid/uuid_generators.hpp> // generators
 #include <boost/filesystem.hpp>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include "XclBinUtilities.h"
 namespace XUtil = XclBinUtilities;
 
@@ -92,7 +95,7 @@ XclBin::readXclBinBinaryHeader(std::fstream& _istream) {
 }
 
 void
-XclBin::readXclBinBinarySections(std::fstream& _istream) {
+XclBin::readXclBinBinarySections(std::fstream& _istream, bool _bStream) {
   // Read in each section
   unsigned int numberOfSections = m_xclBinHeader.m_header.m_numSections;
 
@@ -117,7 +120,13 @@ XclBin::readXclBinBinarySections(std::fstream& _istream) {
 
     // Here for testing purposes, when all segments are supported it should be removed
     if (pSection != nullptr) {
-      pSection->readXclBinBinary(_istream, sectionHeader);
+      // When streaming, leave raw payloads in the file; JSON sections are small
+      // and needed for the mirror data, so they are always brought in
+      if (_bStream && !pSection->hasJSONImage()) {
+        pSection->readXclBinBinaryReference(sectionHeader);
+      } else {
+        pSection->readXclBinBinary(_istream, sectionHeader);
+      }
       addSection(pSection);
     }
   }
@@ -125,7 +134,8 @@ XclBin::readXclBinBinarySections(std::fstream& _istream) {
 
 void
 XclBin::readXclBinBinary(const std::string &_binaryFileName,
-                         bool _bMigrate) {
+                         bool _bMigrate,
+                         bool _bStream) {
   // Error checks
   if (_binaryFileName.empty()) {
     std::string errMsg = "ERROR: Missing file name to read from.";
@@ -152,7 +162,11 @@ XclBin::readXclBinBinary(const std::string &_binaryFileName,
     readXclBinBinaryHeader(ifXclBin);
 
     // Read the sections
-    readXclBinBinarySections(ifXclBin);
+    if (_bStream) {
+      XUtil::TRACE("Streaming mode: raw section payloads are copied on write");
+      m_sStreamSourceFile = _binaryFileName;
+    }
+    readXclBinBinarySections(ifXclBin, _bStream);
   }
 
   ifXclBin.close();
@@ -199,7 +213,7 @@ XclBin::writeXclBinBinaryHeader(std::fstream& _ostream, boost::property_tree::pt
 
 
 void
-XclBin::writeXclBinBinarySections(std::fstream& _ostream, boost::property_tree::ptree& _mirroredData) {
+XclBin::writeXclBinBinarySections(std::fstream& _ostream, const std::string &_binaryFileName, boost::property_tree::ptree& _mirroredData) {
   // Nothing to write
   if (m_sections.empty()) {
     return;
@@ -243,7 +257,13 @@ XclBin::writeXclBinBinarySections(std::fstream& _ostream, boost::property_tree::
     }
 
     // Write buffer
-    m_sections[index]->writeXclBinSectionBuffer(_ostream);
+    if (m_sections[index]->isPayloadDeferred()) {
+      _ostream.flush();
+      writeXclBinDeferredSection(m_sections[index], _binaryFileName, runningOffset);
+      _ostream.seekp(runningOffset + sectionHeader[index].m_sectionSize);
+    } else {
+      m_sections[index]->writeXclBinSectionBuffer(_ostream);
+    }
 
     // Write mirror data
     {
@@ -276,6 +296,57 @@ XclBin::writeXclBinBinarySections(std::fstream& _ostream, boost::property_tree::
 }
 
 
+void
+XclBin::writeXclBinDeferredSection(const Section *_pSection,
+                                   const std::string &_binaryFileName,
+                                   uint64_t _offset) {
+  XUtil::TRACE(XUtil::format("Copying deferred section '%s' (%d) from: %s",
+                             _pSection->getSectionKindAsString().c_str(),
+                             _pSection->getSectionKind(),
+                             m_sStreamSourceFile.c_str()));
+
+  int fdIn = open(m_sStreamSourceFile.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fdIn < 0) {
+    std::string errMsg = "ERROR: Unable to open the file for reading: " + m_sStreamSourceFile;
+    throw std::runtime_error(errMsg);
+  }
+
+  int fdOut = open(_binaryFileName.c_str(), O_WRONLY | O_CLOEXEC);
+  if (fdOut < 0) {
+    close(fdIn);
+    std::string errMsg = "ERROR: Unable to open the file for writing: " + _binaryFileName;
+    throw std::runtime_error(errMsg);
+  }
+
+  try {
+    XUtil::copyFileRange(fdIn, _pSection->getSourceOffset(), fdOut, _offset, _pSection->getSize());
+  } catch (...) {
+    close(fdOut);
+    close(fdIn);
+    throw;
+  }
+
+  close(fdOut);
+  close(fdIn);
+}
+
+void
+XclBin::materializeSection(Section *_pSection) {
+  if ((_pSection == nullptr) ||
+      !_pSection->isPayloadDeferred()) {
+    return;
+  }
+
+  std::fstream ifXclBin;
+  ifXclBin.open(m_sStreamSourceFile, std::ifstream::in | std::ifstream::binary);
+  if (!ifXclBin.is_open()) {
+    std::string errMsg = "ERROR: Unable to open the file for reading: " + m_sStreamSourceFile;
+    throw std::runtime_error(errMsg);
+  }
+
+  _pSection->materializePayload(ifXclBin);
+}
+
 void
 XclBin::writeXclBinBinaryMirrorData(std::fstream& _ostream,
                                     const boost::property_tree::ptree& _mirroredData) const {
@@ -335,7 +406,7 @@ XclBin::writeXclBinBinary(const std::string &_binaryFileName,
   writeXclBinBinaryHeader(ofXclBin, mirroredData);
 
   // Write the section array and sections
-  writeXclBinBinarySections(ofXclBin, mirroredData);
+  writeXclBinBinarySections(ofXclBin, _binaryFileName, mirroredData);
 
   // Write out our mirror data
   writeXclBinBinaryMirrorData(ofXclBin, mirroredData);
@@ -802,12 +873,14 @@ XclBin::dumpSection(ParameterSectionData &_PSD)
     throw std::runtime_error(errMsg);
   }
 
-  const Section *pSection = findSection(eKind);
+  Section *pSection = findSection(eKind);
   if (pSection == nullptr) {
     std::string errMsg = XUtil::format("Error: Section '%s' does not exists.", _PSD.getSectionName().c_str());
     throw std::runtime_error(errMsg);
   }
 
+  materializeSection(pSection);
+
   std::string sDumpFileName = _PSD.getFile();
   // Write the xclbin file image
   std::fstream oDumpFile;
@@ -43,7 +43,7 @@ class XclBin {
   void printHeader(std::ostream &_ostream) const;
   void printSections(std::ostream &_ostream) const;
 
-  void readXclBinBinary(const std::string &_binaryFileName, bool _bMigrate = false);
+  void readXclBinBinary(const std::string &_binaryFileName, bool _bMigrate = false, bool _bStream = false);
   void writeXclBinBinary(const std::string &_binaryFileName, bool _bSkipUUIDInsertion, bool _bInsertValidationChecksum);
   void removeSection(const std::string & _sSectionToRemove);
   void addSection(ParameterSectionData &_PSD);
@@ -58,7 +58,8 @@ class XclBin {
  private:
   void updateHeaderFromSection(Section *_pSection);
   void readXclBinBinaryHeader(std::fstream& _istream);
-  void readXclBinBinarySections(std::fstream& _istream);
+  void readXclBinBinarySections(std::fstream& _istream, bool _bStream);
+  void materializeSection(Section *_pSection);
 
   void findAndReadMirrorData(std::fstream& _istream, boost::property_tree::ptree& _mirrorData) const;
   void readXclBinaryMirrorImage(std::fstream& _istream, const boost::property_tree::ptree& _mirrorData);
@@ -79,7 +80,8 @@ class XclBin {
   void readXclBinHeader(const boost::property_tree::ptree& _ptHeader, struct axlf& _axlfHeader);
   void readXclBinSection(std::fstream& _istream, const boost::property_tree::ptree& _ptSection);
   void writeXclBinBinaryHeader(std::fstream& _ostream, boost::property_tree::ptree& _mirroredData);
-  void writeXclBinBinarySections(std::fstream& _ostream, boost::property_tree::ptree& _mirroredData);
+  void writeXclBinBinarySections(std::fstream& _ostream, const std::string &_binaryFileName, boost::property_tree::ptree& _mirroredData);
+  void writeXclBinDeferredSection(const Section *_pSection, const std::string &_binaryFileName, uint64_t _offset);
 
 
  protected:
@@ -89,6 +91,7 @@ class XclBin {
  private:
   std::vector<Section*> m_sections;
   axlf m_xclBinHeader;
+  std::string m_sStreamSourceFile;   // Source of deferred section payloads
 
  protected:
   SchemaVersion m_SchemaVersionMirrorWrite;
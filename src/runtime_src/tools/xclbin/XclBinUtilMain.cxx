@@ -98,6 +98,7 @@ int main_(int argc, char** argv) {
   bool bSkipValidateInsertion = false;
   bool bVersion = false;
   bool bForce = true;   // Assume true until xocc is updated to use the --force option
+  bool bStream = false;
 
   std::string sInputFile;
   std::string sOutputFile;
@@ -131,6 +132,7 @@ int main_(int argc, char** argv) {
       ("list-sections,l", boost::program_options::bool_switch(&bListSections), "List the sections")
       ("version", boost::program_options::bool_switch(&bVersion), "Version information regarding this executable")
       ("force", boost::program_options::bool_switch(&bForce), "Forces an file overwrite")
+      ("stream", boost::program_options::bool_switch(&bStream), "Copy untouched raw sections from the input file instead of loading them into memory")
  ;
 
 // --remove-section=section
@@ -147,6 +149,10 @@ int main_(int argc, char** argv) {
 //
 // --migrate-forward
 //    Migrates the xclbin forward to the new binary structure using the backup mirror metadata.
+//
+// --stream
+//    Raw sections that are not replaced or dumped are copied file to file (copy_file_range/sendfile)
+//    when the output is written, so large bitstreams are never held in memory.
 
   // hidden options
   boost::program_options::options_description hidden("Hidden options");
@@ -196,6 +202,7 @@ int main_(int argc, char** argv) {
     std::cout << "  3) Extracting the build metadata : xclbinutil --dump-section BUILD_METADATA:HTML:buildMetadata.json --input binary_container_1.xclbin" << std::endl;
     std::cout << "  4) Removing a section            : xclbinutil --remove-section BITSTREAM --input binary_container_1.xclbin --output binary_container_modified.xclbin" << std::endl;
     std::cout << "  5) Checking xclbin integrity     : xclbinutil --validate --input binary_containter_1.xclbin" <<std::endl;
+    std::cout << "  6) Compressing the bitstream     : xclbinutil --remove-section BITSTREAM --add-section BITSTREAM_COMPRESSED:RAW:bitstream.bit --input binary_container_1.xclbin --output binary_container_compressed.xclbin" << std::endl;
 
     std::cout << std::endl 
               << "Command Line Options" << std::endl
@@ -258,7 +265,7 @@ int main_(int argc, char** argv) {
 
   XclBin xclBin;
   if (!sInputFile.empty()) {
-    xclBin.readXclBinBinary(sInputFile, bMigrateForward);
+    xclBin.readXclBinBinary(sInputFile, bMigrateForward, bStream);
   }
 
   for (auto keyValue : keyValuePairs) {
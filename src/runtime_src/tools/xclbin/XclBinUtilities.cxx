@@ -26,6 +26,11 @@
 #include <inttypes.h>
 #include <vector>
 
+#include <errno.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+
 namespace XUtil = XclBinUtilities;
 
 static bool m_bVerbose = false;
@@ -462,3 +467,63 @@ XclBinUtilities::printKinds() {
   }
 }
 
+
+// Copy a byte range between two files without staging it in user space.
+// copy_file_range keeps the data in the kernel (and may reflink), sendfile
+// is the fallback for older kernels and cross filesystem copies, and a plain
+// pread/pwrite loop covers everything else.
+void
+XclBinUtilities::copyFileRange(int _fdIn, uint64_t _offsetIn,
+                               int _fdOut, uint64_t _offsetOut,
+                               uint64_t _size) {
+  XUtil::TRACE(XUtil::format("Copying 0x%lx bytes from offset 0x%lx to offset 0x%lx", _size, _offsetIn, _offsetOut));
+
+#ifdef SYS_copy_file_range
+  while (_size != 0) {
+    loff_t offIn = _offsetIn;
+    loff_t offOut = _offsetOut;
+    ssize_t copied = syscall(SYS_copy_file_range, _fdIn, &offIn, _fdOut, &offOut, _size, 0);
+    if (copied <= 0) {
+      break;
+    }
+    _offsetIn += copied;
+    _offsetOut += copied;
+    _size -= copied;
+  }
+#endif
+
+  if ((_size != 0) &&
+      (lseek(_fdOut, _offsetOut, SEEK_SET) == (off_t)_offsetOut)) {
+    while (_size != 0) {
+      off_t offIn = _offsetIn;
+      ssize_t copied = sendfile(_fdOut, _fdIn, &offIn, _size);
+      if (copied <= 0) {
+        break;
+      }
+      _offsetIn += copied;
+      _offsetOut += copied;
+      _size -= copied;
+    }
+  }
+
+  static const size_t bounceSize = 1024 * 1024;
+  std::unique_ptr<char[]> bounce;
+  while (_size != 0) {
+    if (!bounce) {
+      bounce.reset(new char[bounceSize]);
+    }
+    size_t chunk = (_size < bounceSize) ? _size : bounceSize;
+    ssize_t bytesRead = pread(_fdIn, bounce.get(), chunk, _offsetIn);
+    if (bytesRead <= 0) {
+      std::string errMsg = XUtil::format("ERROR: Unable to read 0x%lx bytes from the input file at offset 0x%lx", _size, _offsetIn);
+      throw std::runtime_error(errMsg);
+    }
+    if (pwrite(_fdOut, bounce.get(), bytesRead, _offsetOut) != bytesRead) {
+      std::string errMsg = XUtil::format("ERROR: Unable to write 0x%lx bytes to the output file at offset 0x%lx", bytesRead, _offsetOut);
+      throw std::runtime_error(errMsg);
+    }
+    _offsetIn += bytesRead;
+    _offsetOut += bytesRead;
+    _size -= bytesRead;
+  }
+}
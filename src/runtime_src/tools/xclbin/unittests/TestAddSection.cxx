@@ -2,6 +2,9 @@
 #include "ParameterSectionData.h"
 #include "XclBin.h"
 
+#include <fstream>
+#include <iterator>
+
 TEST(AddSection, AddClearingBitstream) {
    XclBin xclBin;
   
@@ -28,3 +31,32 @@ TEST(AddSection, AddClearingBitstream) {
 
 
 
+
+static std::string readFile(const std::string& _fileName) {
+   std::ifstream ifs(_fileName, std::ifstream::binary);
+   return std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+}
+
+TEST(AddSection, AddCompressedBitstream) {
+   XclBin xclBin;
+   xclBin.readXclBinBinary("unittests/test_data/sample_1_2018.2.xclbin", false /* bMigrateForward */);
+
+   // Extract the bitstream and add it back compressed
+   ParameterSectionData psdDump("BITSTREAM:RAW:unittests/test_data/bitstream.bit");
+   xclBin.dumpSection(psdDump);
+   xclBin.removeSection("BITSTREAM");
+
+   ParameterSectionData psdAdd("BITSTREAM_COMPRESSED:RAW:unittests/test_data/bitstream.bit");
+   xclBin.addSection(psdAdd);
+
+   const Section * pSection = xclBin.findSection(BITSTREAM_COMPRESSED);
+   ASSERT_NE(pSection, nullptr) << "Section 'BITSTREAM_COMPRESSED' was not added.";
+
+   const std::string sRaw = readFile("unittests/test_data/bitstream.bit");
+   ASSERT_LT(pSection->getSize(), sRaw.size()) << "Section 'BITSTREAM_COMPRESSED' is not compressed.";
+
+   // Dumping the compressed section restores the bitstream
+   ParameterSectionData psdInflate("BITSTREAM_COMPRESSED:RAW:unittests/test_data/bitstream_inflated.bit");
+   xclBin.dumpSection(psdInflate);
+   ASSERT_EQ(readFile("unittests/test_data/bitstream_inflated.bit"), sRaw) << "Inflated bitstream differs.";
+}
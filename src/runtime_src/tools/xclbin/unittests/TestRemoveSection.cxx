@@ -26,3 +26,36 @@ TEST(RemoveSection, RemoveBitstream) {
 
 
 
+
+TEST(RemoveSection, RemoveBitstreamStreaming) {
+   const std::string sInput = "unittests/test_data/sample_1_2018.2.xclbin";
+   const std::string sOutput = "unittests/test_data/stream_remove.xclbin";
+
+   enum axlf_section_kind _eKind;
+   Section::translateSectionKindStrToKind("BITSTREAM", _eKind);
+
+   XclBin xclBin;
+   xclBin.readXclBinBinary(sInput, false /* bMigrateForward */, true /* bStream */);
+
+   // Raw sections stay in the file, JSON sections are read in
+   Section * pSection = xclBin.findSection(_eKind);
+   ASSERT_NE(pSection, nullptr) << "Section 'BITSTREAM' not found.";
+   ASSERT_TRUE(pSection->isPayloadDeferred()) << "Section 'BITSTREAM' was loaded.";
+   pSection = xclBin.findSection(MEM_TOPOLOGY);
+   ASSERT_NE(pSection, nullptr) << "Section 'MEM_TOPOLOGY' not found.";
+   ASSERT_FALSE(pSection->isPayloadDeferred()) << "Section 'MEM_TOPOLOGY' was deferred.";
+
+   xclBin.removeSection("BITSTREAM");
+   xclBin.writeXclBinBinary(sOutput, true /* bSkipUUIDInsertion */, false /* bInsertValidationChecksum */);
+
+   // Copied sections must read back with the same sizes
+   XclBin xclBinOrig;
+   xclBinOrig.readXclBinBinary(sInput, false /* bMigrateForward */);
+   XclBin xclBinStream;
+   xclBinStream.readXclBinBinary(sOutput, false /* bMigrateForward */);
+   ASSERT_EQ(xclBinStream.findSection(_eKind), nullptr) << "Section 'BITSTREAM' was not removed.";
+
+   pSection = xclBinStream.findSection(EMBEDDED_METADATA);
+   ASSERT_NE(pSection, nullptr) << "Section 'EMBEDDED_METADATA' not copied.";
+   ASSERT_EQ(pSection->getSize(), xclBinOrig.findSection(EMBEDDED_METADATA)->getSize());
+}
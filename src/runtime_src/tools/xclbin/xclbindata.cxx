@@ -707,6 +707,9 @@ XclBinData::getMemType( std::string &_sMemType ) const
   if ( _sMemType == "MEM_ARE" )
       return MEM_ARE;
 
+  if ( _sMemType == "MEM_HOST" )
+      return MEM_HOST;
+
   std::string errMsg = "ERROR: Unknown memory type: '" + _sMemType + "'";
   throw std::runtime_error(errMsg);
 }
@@ -1300,6 +1303,7 @@ XclBinData::getMemTypeStr(enum MEM_TYPE _memType) const
     case MEM_STREAMING: return "MEM_STREAMING";
     case MEM_PREALLOCATED_GLOB: return "MEM_PREALLOCATED_GLOB";
     case MEM_ARE: return "MEM_ARE";
+    case MEM_HOST: return "MEM_HOST";
   }
 
   return XclBinUtil::format("UNKNOWN (%d)", (unsigned int) _memType);
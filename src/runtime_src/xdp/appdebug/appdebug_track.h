@@ -30,11 +30,26 @@
 #include <set>
 #include <map>
 #include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstdint>
 
 namespace appdebug {
 void cb_scheduler_cmd_start (const xrt::command*,const xocl::execution_context*);
 void cb_scheduler_cmd_done (const xrt::command*,const xocl::execution_context*);
 
+//Objects are spread over shards by address. Runtime threads creating and
+//releasing objects only lock their shard, a debugger walk of all objects
+//locks every shard.
+const size_t app_debug_num_shards = 16;
+
+template <typename T>
+inline size_t
+app_debug_shard_idx(T aObj)
+{
+  return (reinterpret_cast<uintptr_t>(aObj) >> 6) % app_debug_num_shards;
+}
+
 template <typename T>
 class app_debug_track {
 public:
@@ -50,24 +65,27 @@ public:
   //these can suspend to get access to the data structure
   void add_object (T aObj) {
     if (m_set) {
-      std::lock_guard<std::mutex> lk (m_mutex);
-      m_objs.insert(aObj);
+      auto& s = m_shards[app_debug_shard_idx(aObj)];
+      std::lock_guard<std::mutex> lk (s.m_mutex);
+      s.m_objs.insert(aObj);
     }
   }
   void remove_object (T aObj) {
     if (m_set) {
-      std::lock_guard<std::mutex> lk (m_mutex);
-      m_objs.erase(aObj);
+      auto& s = m_shards[app_debug_shard_idx(aObj)];
+      std::lock_guard<std::mutex> lk (s.m_mutex);
+      s.m_objs.erase(aObj);
     }
   }
 
   //Following 2 function called during debug by user, this should never suspend
   void validate_object (T aObj) {
     if (m_set) {
-      std::unique_lock<std::mutex> lk(m_mutex, std::defer_lock);
+      auto& s = m_shards[app_debug_shard_idx(aObj)];
+      std::unique_lock<std::mutex> lk(s.m_mutex, std::defer_lock);
       if (!lk.try_lock())
         throw xocl::error(DBG_EXCEPT_LOCK_FAILED, "Failed to secure lock on data structure");
-      if (m_objs.find(aObj) == m_objs.end() )
+      if (s.m_objs.find(aObj) == s.m_objs.end() )
         throw xocl::error(DBG_EXCEPT_INVALID_OBJECT, "Unknown OpenCL object");
     }
     else {
@@ -75,12 +93,20 @@ public:
     }
   }
 
+  //All shards stay locked while fn is called so that no object is released
+  //during the walk, fn cannot call any functions that lock the tracker
   void for_each(std::function<void(T aObj)>&& fn) {
     if (m_set) {
-      std::unique_lock<std::mutex> lk(m_mutex, std::defer_lock);
-      if (!lk.try_lock())
-        throw xocl::error(DBG_EXCEPT_LOCK_FAILED, "Failed to secure lock on data structure");
-      std::for_each(m_objs.begin(), m_objs.end(), fn);
+      std::vector<std::unique_lock<std::mutex>> locks;
+      std::vector<T> objs;
+      for (auto& s : m_shards) {
+        locks.emplace_back(s.m_mutex, std::defer_lock);
+        if (!locks.back().try_lock())
+          throw xocl::error(DBG_EXCEPT_LOCK_FAILED, "Failed to secure lock on data structure");
+        objs.insert(objs.end(), s.m_objs.begin(), s.m_objs.end());
+      }
+      std::sort(objs.begin(), objs.end());
+      std::for_each(objs.begin(), objs.end(), fn);
     }
     else {
       throw xocl::error(DBG_EXCEPT_INVALID_OBJECT, "Invalid object tracker");
@@ -91,16 +117,20 @@ public:
   //disallow access to the data structure after the object is deleted
   static bool m_set;
 private:
-  std::set <T> m_objs;
-  std::mutex m_mutex;
+  struct shard {
+    std::mutex m_mutex;
+    std::set <T> m_objs;
+  };
+  shard m_shards[app_debug_num_shards];
 };
 
 template <>
 class app_debug_track <cl_event> {
 public:
+  //Updated by the scheduler callbacks without holding the tracker lock
   struct event_data_t {
-    bool m_start;
-    uint32_t m_ncomplete;
+    std::atomic<bool> m_start {false};
+    std::atomic<uint32_t> m_ncomplete {0};
   };
   static app_debug_track* getInstance() {
     static app_debug_track singleton;
@@ -118,35 +148,41 @@ public:
   //these can suspend to get access to the data structure
   void add_object (cl_event aObj) {
     if (m_set) {
-      std::lock_guard<std::mutex> lk (m_mutex);
-      m_objs.insert(std::pair<cl_event, event_data_t>(aObj, event_data_t()));
+      auto& s = m_shards[app_debug_shard_idx(aObj)];
+      std::lock_guard<std::mutex> lk (s.m_mutex);
+      s.m_objs[aObj];
     }
   }
   void remove_object (cl_event aObj) {
     if (m_set) {
-      std::lock_guard<std::mutex> lk (m_mutex);
-      m_objs.erase(aObj);
+      auto& s = m_shards[app_debug_shard_idx(aObj)];
+      std::lock_guard<std::mutex> lk (s.m_mutex);
+      s.m_objs.erase(aObj);
     }
   }
 
   //Suspends on lock, returns a reference and throws exception in cases that cannot be handled
+  //The reference stays valid until the event is removed
   event_data_t& get_data (const cl_event aObj) {
     if (!m_set)
       throw xocl::error(DBG_EXCEPT_INVALID_OBJECT, "Appdebug singleton is deleted");
 
-    std::lock_guard<std::mutex> lk (m_mutex);
-    if (m_objs.find(aObj) == m_objs.end() )
+    auto& s = m_shards[app_debug_shard_idx(aObj)];
+    std::lock_guard<std::mutex> lk (s.m_mutex);
+    auto it = s.m_objs.find(aObj);
+    if (it == s.m_objs.end() )
       throw xocl::error(DBG_EXCEPT_INVALID_OBJECT, "Unknown OpenCL object");
-    return m_objs[aObj];
+    return it->second;
   }
 
   //Following 2 function called during debug by user, this should never suspend
   void validate_object (cl_event aObj) {
     if (m_set) {
-      std::unique_lock<std::mutex> lk(m_mutex, std::defer_lock);
+      auto& s = m_shards[app_debug_shard_idx(aObj)];
+      std::unique_lock<std::mutex> lk(s.m_mutex, std::defer_lock);
       if (!lk.try_lock())
         throw xocl::error(DBG_EXCEPT_LOCK_FAILED, "Failed to secure lock on data structure");
-      if (m_objs.find(aObj) == m_objs.end() )
+      if (s.m_objs.find(aObj) == s.m_objs.end() )
         throw xocl::error(DBG_EXCEPT_INVALID_OBJECT, "Unknown OpenCL object");
     }
     else {
@@ -154,15 +190,21 @@ public:
     }
   }
 
+  //All shards stay locked while fn is called so that no event is released
+  //during the walk, fn cannot call any functions that lock the tracker
   void for_each(std::function<void(cl_event aObj)>&& fn) {
     if (m_set) {
-      std::unique_lock<std::mutex> lk(m_mutex, std::defer_lock);
-      if (!lk.try_lock())
-        throw xocl::error(DBG_EXCEPT_LOCK_FAILED, "Failed to secure lock on data structure");
-      //std::for_each(m_objs.begin(), m_objs.end(), fn);
-      for (auto it = m_objs.begin(); it!=m_objs.end(); ++it) {
-        fn(it->first);
+      std::vector<std::unique_lock<std::mutex>> locks;
+      std::vector<cl_event> objs;
+      for (auto& s : m_shards) {
+        locks.emplace_back(s.m_mutex, std::defer_lock);
+        if (!locks.back().try_lock())
+          throw xocl::error(DBG_EXCEPT_LOCK_FAILED, "Failed to secure lock on data structure");
+        for (auto it = s.m_objs.begin(); it!=s.m_objs.end(); ++it)
+          objs.push_back(it->first);
       }
+      std::sort(objs.begin(), objs.end());
+      std::for_each(objs.begin(), objs.end(), fn);
     }
     else {
       throw xocl::error(DBG_EXCEPT_INVALID_OBJECT, "Invalid object tracker");
@@ -173,12 +215,14 @@ public:
     if (!m_set)
       throw xocl::error(DBG_EXCEPT_INVALID_OBJECT, "Appdebug singleton is deleted");
 
-    std::unique_lock<std::mutex> lk(m_mutex, std::defer_lock);
+    auto& s = m_shards[app_debug_shard_idx(aObj)];
+    std::unique_lock<std::mutex> lk(s.m_mutex, std::defer_lock);
     if (!lk.try_lock())
       throw xocl::error(DBG_EXCEPT_LOCK_FAILED, "Failed to secure lock on data structure");
-    if (m_objs.find(aObj) == m_objs.end() )
+    auto it = s.m_objs.find(aObj);
+    if (it == s.m_objs.end() )
       throw xocl::error(DBG_EXCEPT_INVALID_OBJECT, "Unknown OpenCL object");
-    return m_objs[aObj];
+    return it->second;
   }
 
   //When the program exits, the static singleton object could get deleted
@@ -186,8 +230,11 @@ public:
   //disallow access to the data structure after the object is deleted
   static bool m_set;
 private:
-  std::map<cl_event, event_data_t> m_objs;
-  std::mutex m_mutex;
+  struct shard {
+    std::mutex m_mutex;
+    std::map<cl_event, event_data_t> m_objs;
+  };
+  shard m_shards[app_debug_num_shards];
 };
 ////////////////////////Command queue////////////////////
 inline
@@ -41,6 +41,8 @@
 
 #include "xocl/xclbin/xclbin.h"
 
+#include "xrt/util/task.h"
+
 #include <map>
 #include <sstream>
 #include "xocl/api/plugin/xdp/profile.h"
@@ -503,6 +505,19 @@ void cb_log_dependencies (xocl::event* event,  cl_uint num_deps, const cl_event*
   }
 }
 
+static void
+cb_log_task_queue(const void* queue, bool enqueue, size_t depth, unsigned long wait_ns)
+{
+  // tasks can be serviced while the profiler is being torn down
+  if (!XCL::active())
+    return;
+
+  XCL::RTSingleton::Instance()->getProfileManager()->logTaskQueue
+    (reinterpret_cast<uint64_t>(queue)
+     ,enqueue ? XCL::RTProfile::QUEUE : XCL::RTProfile::START
+     ,depth,wait_ns);
+}
+
 void cb_add_to_active_devices(const std::string& device_name)
 {
   static bool profile_on = XCL::RTSingleton::Instance()->applicationProfilingOn();
@@ -577,6 +592,8 @@ void register_xocl_profile_callbacks() {
   xocl::profile::register_cb_log_function_start(cb_log_function_start);
   xocl::profile::register_cb_log_function_end(cb_log_function_end);
   xocl::profile::register_cb_log_dependencies(cb_log_dependencies);
+  if (xrt::config::get_timeline_trace())
+    xrt::task::register_queue_trace(cb_log_task_queue);
   xocl::profile::register_cb_add_to_active_devices(cb_add_to_active_devices);
   xocl::profile::register_cb_set_kernel_clock_freq(cb_set_kernel_clock_freq);
   xocl::profile::register_cb_reset(cb_reset);
@@ -39,6 +39,7 @@
 #include "xdp/rt_singleton.h"
 #include "driver/include/xclperf.h"
 #include "xrt/util/message.h"
+#include "xrt/util/config_reader.h"
 
 namespace Profiling {
 
@@ -80,6 +81,7 @@ namespace Profiling {
       // Before deleting, do a final read of counters and force flush of trace buffers
       endDeviceProfiling();
     }
+    stopTraceOffload();
   }
 
   // Start device profiling
@@ -99,12 +101,16 @@ namespace Profiling {
       xdp::profile::platform::start_device_trace(rts->getcl_platform_id(),XCL_PERF_MON_ACCEL, numComputeUnits);
 
     mProfileRunning = true;
+    startTraceOffload();
   }
 
   // End device profiling (for a given program)
   // Perform final read of counters and force flush of trace buffers
   void Profiler::endDeviceProfiling()
   {
+    // Final flush below must not race the offload thread
+    stopTraceOffload();
+
     // Only needs to be called once
     if (mEndDeviceProfilingCalled)
    	  return;
@@ -175,6 +181,7 @@ namespace Profiling {
 
     XOCL_DEBUGF("getDeviceTrace: START (forceRead: %d)\n", forceReadTrace);
 
+    std::lock_guard<std::mutex> lock(mTraceMutex);
     if (rts->deviceTraceProfilingOn())
       xdp::profile::platform::log_device_trace(rts->getcl_platform_id(),XCL_PERF_MON_MEMORY, forceReadTrace);
 
@@ -184,6 +191,69 @@ namespace Profiling {
     XOCL_DEBUGF("getDeviceTrace: END\n");
   }
 
+  // Start draining trace FIFOs in the background (only for a board)
+  void Profiler::startTraceOffload()
+  {
+    auto rts = XCL::RTSingleton::Instance();
+    if (mTraceOffloadThread.joinable() || !xrt::config::get_trace_offload()
+        || (rts->getFlowMode() != XCL::RTSingleton::DEVICE)
+        || (!rts->deviceTraceProfilingOn() && !rts->deviceOclProfilingOn()))
+      return;
+
+    mTraceOffloadStop = false;
+    mTraceOffloadThread = std::thread(&Profiler::traceOffloadLoop, this);
+  }
+
+  void Profiler::stopTraceOffload()
+  {
+    if (!mTraceOffloadThread.joinable())
+      return;
+
+    {
+      std::lock_guard<std::mutex> lock(mTraceMutex);
+      mTraceOffloadStop = true;
+    }
+    mTraceOffloadCond.notify_one();
+    mTraceOffloadThread.join();
+  }
+
+  // Poll the trace FIFOs, faster while they fill and slower while idle.
+  // The reads themselves happen once a FIFO is past the samples threshold.
+  void Profiler::traceOffloadLoop()
+  {
+    auto rts = XCL::RTSingleton::Instance();
+    auto profileMgr = rts->getProfileManager();
+    auto platform = rts->getcl_platform_id();
+    const uint32_t threshold = profileMgr->getTraceSamplesThreshold();
+    const uint32_t minIntervalMsec = 1;
+    const uint32_t maxIntervalMsec = std::max(minIntervalMsec, 8 * profileMgr->getSampleIntervalMsec());
+    uint32_t intervalMsec = std::max(minIntervalMsec, profileMgr->getSampleIntervalMsec());
+
+    std::unique_lock<std::mutex> lock(mTraceMutex);
+    while (!mTraceOffloadStop) {
+      mTraceOffloadCond.wait_for(lock, std::chrono::milliseconds(intervalMsec),
+                                 [this] { return mTraceOffloadStop; });
+      if (mTraceOffloadStop || !XCL::active())
+        break;
+
+      uint32_t samples = 0;
+      if (rts->deviceTraceProfilingOn()) {
+        xdp::profile::platform::log_device_trace(platform, XCL_PERF_MON_MEMORY, false);
+        samples = xdp::profile::platform::get_device_trace_samples(platform, XCL_PERF_MON_MEMORY);
+      }
+      if (rts->deviceOclProfilingOn()) {
+        xdp::profile::platform::log_device_trace(platform, XCL_PERF_MON_ACCEL, false);
+        samples = std::max(samples,
+            xdp::profile::platform::get_device_trace_samples(platform, XCL_PERF_MON_ACCEL));
+      }
+
+      if (samples > threshold / 2)
+        intervalMsec = std::max(minIntervalMsec, intervalMsec / 2);
+      else if (samples < threshold / 8)
+        intervalMsec = std::min(maxIntervalMsec, intervalMsec * 2);
+    }
+  }
+
   /*
    * Callback functions called from xocl
    */
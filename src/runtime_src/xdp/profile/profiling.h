@@ -27,6 +27,9 @@
 
 #include <CL/opencl.h>
 #include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 // Use Profiling::Profiler::Instance() to get to the singleton runtime object
 // Runtime code base can access the singleton and make decisions based on the
@@ -60,12 +63,22 @@ namespace Profiling {
   private:
     uint32_t getTimeDiffUsec(std::chrono::steady_clock::time_point start,
                              std::chrono::steady_clock::time_point end);
+    // Background draining of device trace FIFOs between sync points
+    void startTraceOffload();
+    void stopTraceOffload();
+    void traceOffloadLoop();
 
   private:
     bool mProfileRunning = false;
     bool mEndDeviceProfilingCalled = false;
     static Profiler* mRTInstance;
 
+    // Serializes trace reads of the offload thread and the host code
+    std::mutex mTraceMutex;
+    std::condition_variable mTraceOffloadCond;
+    bool mTraceOffloadStop = false;
+    std::thread mTraceOffloadThread;
+
   };
   /*
    * Callback functions called from xocl
@@ -152,6 +152,11 @@ namespace XCL {
     CallCount[functionName].logEnd(timePoint);
   }
 
+  void PerformanceCounter::logFunctionCallsSkipped(const std::string& functionName, uint32_t calls)
+  {
+    CallCount[functionName].logSkippedCalls(calls);
+  }
+
   void PerformanceCounter::logKernelExecutionStart(const std::string& kernelName, const std::string& deviceName,
                                                    double timePoint)
   {
@@ -388,8 +393,7 @@ namespace XCL {
       std::string name = cuIter->first;
       name = name.substr(0, name.find_last_of("|"));
       if (name.find(deviceName) != std::string::npos && name.find(cuName) != std::string::npos) {
-        TimeStats cuStats = cuIter->second;
-        return cuStats.getNoOfCalls();
+        return cuIter->second.getNoOfCalls();
       }
       cuIter++;
     }
@@ -405,8 +409,7 @@ namespace XCL {
       auto fullName = pair.first;
       if (fullName.find(deviceName) != std::string::npos
           && fullName.find(cuName)  != std::string::npos) {
-        auto stat = pair.second;
-        return stat.getTotalTime();
+        return pair.second.getTotalTime();
       }
     }
     return getTotalKernelExecutionTime(deviceName);
@@ -79,6 +79,7 @@ namespace XCL {
                                  uint32_t bitWidth, double clockFreqMhz, bool isRead);
     void logFunctionCallStart(const std::string& functionName, double timePoint);
     void logFunctionCallEnd(const std::string& functionName, double timePoint);
+    void logFunctionCallsSkipped(const std::string& functionName, uint32_t calls);
     void logKernelExecutionStart(const std::string& kernelName, const std::string& deviceName, double timePoint);
     void logKernelExecutionEnd(const std::string& kernelName, const std::string& deviceName, double timePoint);
     void logComputeUnitDeviceStart(const std::string& deviceName, double timePoint);
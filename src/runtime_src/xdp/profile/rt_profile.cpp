@@ -27,6 +27,7 @@
 //#include <CL/opencl.h>
 #include "xocl/core/device.h"
 #include "xocl/xclbin/xclbin.h"
+#include "xrt/util/config_reader.h"
 #include "../../driver/include/xclperf.h"
 
 #include <iostream>
@@ -34,6 +35,7 @@
 #include <fstream>
 #include <iomanip>
 #include <algorithm>
+#include <cstring>
 #include <ctime>
 #include <cassert>
 
@@ -49,6 +51,8 @@ namespace XCL {
     ProfileFlags(flag),
     FileFlags(0),
     MigrateMemCalls(0),
+    FunctionCallSampleInterval(xrt::config::get_api_call_sample_interval()),
+    MaxPendingTraces(xrt::config::get_max_pending_traces()),
     DeviceTraceOption(DEVICE_TRACE_OFF),
     StallTraceOption(STALL_TRACE_OFF),
     CurrentContextId(0),
@@ -163,6 +167,7 @@ namespace XCL {
   void RTProfile::detach(WriterI* writer)
   {
     std::lock_guard < std::mutex > lock(LogMutex);
+    flushFunctionCalls();
     auto itr = std::find(Writers.begin(), Writers.end(), writer);
     if (itr != Writers.end())
       Writers.erase(itr);
@@ -200,6 +205,9 @@ namespace XCL {
     case DEPENDENCY_EVENT:
       commandString = "DEPENDENCY_EVENT";
       break;
+    case TASK_QUEUE:
+      commandString = "TASK_QUEUE";
+      break;
     default:
       assert(0);
       break;
@@ -231,6 +239,33 @@ namespace XCL {
     }
   }
 
+  // Traces whose END never arrives (e.g., aborted commands) would otherwise
+  // stay forever. Once the limit is reached, drop the older half so the cost
+  // is amortized over many calls.
+  template <typename T>
+  void RTProfile::trimPendingTraces(std::map<uint64_t, T*>& traceMap)
+  {
+    if (MaxPendingTraces == 0 || traceMap.size() < MaxPendingTraces)
+      return;
+
+    std::vector<std::pair<double, uint64_t>> pending;
+    pending.reserve(traceMap.size());
+    for (const auto& pair : traceMap) {
+      T* trace = pair.second;
+      double lastTime = std::max(trace->getQueue(), std::max(trace->getSubmit(), trace->getStart()));
+      pending.emplace_back(lastTime, pair.first);
+    }
+
+    auto middle = pending.begin() + pending.size() / 2;
+    std::nth_element(pending.begin(), middle, pending.end());
+    for (auto itr = pending.begin(); itr != middle; ++itr) {
+      auto traceItr = traceMap.find(itr->second);
+      T::recycle(traceItr->second);
+      traceMap.erase(traceItr);
+    }
+    XDP_LOG("trimPendingTraces: dropped %d traces with no END\n", (int)(middle - pending.begin()));
+  }
+
   void RTProfile::setTimeStamp(e_profile_command_state objStage,
       TimeTrace* traceObject, double timeStamp)
   {
@@ -293,6 +328,7 @@ namespace XCL {
     BufferTrace* traceObject = nullptr;
     auto itr = BufferTraceMap.find(objId);
     if (itr == BufferTraceMap.end()) {
+      trimPendingTraces(BufferTraceMap);
       traceObject = BufferTrace::reuse();
       BufferTraceMap[objId] = traceObject;
     }
@@ -334,6 +370,10 @@ namespace XCL {
       // Store thread IDs into set
       addToThreadIds(threadId);
     }
+    else if (objStage == END) {
+      BufferTraceMap.erase(objId);
+      BufferTrace::recycle(traceObject);
+    }
 
     writeTimelineTrace(timeStamp, commandString, stageString, eventString, dependString,
                        objSize, address, bank, threadId);
@@ -422,6 +462,7 @@ namespace XCL {
       KernelTrace* traceObject = nullptr;
       auto itr = KernelTraceMap.find(eventId);
       if(itr == KernelTraceMap.end()) {
+        trimPendingTraces(KernelTraceMap);
         traceObject = KernelTrace::reuse();
         KernelTraceMap[eventId] = traceObject;
       } else {
@@ -448,6 +489,9 @@ namespace XCL {
         if (traceObject->getStart() > 0.0 && traceObject->getStart() < deviceTimeStamp) {
           PerfCounters.pushToSortedTopUsage(traceObject);
         }
+        else {
+          KernelTrace::recycle(traceObject);
+        }
       }
 
       // Write all states to timeline trace
@@ -515,6 +559,28 @@ namespace XCL {
     writeTimelineTrace(getTraceTime(), commandString, "", eventString, dependString);
   }
 
+  // Host side task queues, a row per queue with its depth after the
+  // operation and, on dequeue, the time the task waited on the queue
+  void RTProfile::logTaskQueue(uint64_t queueId, e_profile_command_state objStage,
+      size_t depth, uint64_t waitNsec)
+  {
+    double timeStamp = getTraceTime();
+
+    std::string commandString;
+    std::string stageString;
+    std::lock_guard < std::mutex > lock(LogMutex);
+    commandKindToString(TASK_QUEUE, commandString);
+    commandStageToString(objStage, stageString);
+
+    std::stringstream queueStr;
+    queueStr << std::showbase << std::hex << std::uppercase << queueId
+             << "|" << std::dec << depth;
+    std::stringstream waitStr;
+    waitStr << std::setprecision(10) << (waitNsec / 1.0e6);
+
+    writeTimelineTrace(timeStamp, commandString, stageString, queueStr.str(), waitStr.str());
+  }
+
   xclPerfMonEventID
   RTProfile::getFunctionEventID(const std::string &functionName, long long queueAddress)
   {
@@ -584,8 +650,100 @@ else if (functionName.find("clEnqueueMigrateMemObjects") != std::string::npos)
     return XCL_PERF_MON_IGNORE_EVENT;
   }
 
+  // Buffer of the calling thread, a thread that exited leaves its buffer
+  // for reuse. Records left in it are drained with the next flush.
+  FunctionCallBuffer* RTProfile::getFunctionCallBuffer()
+  {
+    struct holder {
+      const RTProfile* owner = nullptr;
+      std::shared_ptr<FunctionCallBuffer> buffer;
+      ~holder() {
+        if (buffer)
+          buffer->InUse.store(false, std::memory_order_release);
+      }
+    };
+    static thread_local holder tl;
+
+    if (tl.buffer && tl.owner == this)
+      return tl.buffer.get();
+    if (tl.buffer)
+      tl.buffer->InUse.store(false, std::memory_order_release);
+
+    std::lock_guard<std::mutex> lock(LogMutex);
+    tl.owner = this;
+    for (auto& buffer : FunctionCallBuffers) {
+      bool inuse = false;
+      if (buffer->InUse.compare_exchange_strong(inuse, true, std::memory_order_acq_rel)) {
+        tl.buffer = buffer;
+        return tl.buffer.get();
+      }
+    }
+    FunctionCallBuffers.push_back(std::make_shared<FunctionCallBuffer>());
+    tl.buffer = FunctionCallBuffers.back();
+    return tl.buffer.get();
+  }
+
+  void RTProfile::logFunctionCall(const FunctionCallBuffer::Record& record)
+  {
+    std::string name(record.FunctionName);
+    if (record.QueueAddress == 0)
+      name += "|General";
+    else
+      (name += "|") +=std::to_string(record.QueueAddress);
+
+    if (record.IsStart)
+      PerfCounters.logFunctionCallStart(record.FunctionName, record.TimeStamp);
+    else
+      PerfCounters.logFunctionCallEnd(record.FunctionName, record.TimeStamp);
+    writeTimelineTrace(record.TimeStamp, name.c_str(), record.IsStart ? "START" : "END");
+  }
+
+  // Drain one thread at a time, so calls of a thread are summarized in order
+  void RTProfile::flushFunctionCalls()
+  {
+    FunctionCallBuffer::Record record;
+    for (auto& buffer : FunctionCallBuffers) {
+      while (buffer->pop(record))
+        logFunctionCall(record);
+
+      if (FunctionCallSampleInterval <= 1)
+        continue;
+      std::lock_guard<std::mutex> lock(buffer->CallsLock);
+      for (auto& call : buffer->Calls) {
+        if (call.second.Skipped == 0)
+          continue;
+        PerfCounters.logFunctionCallsSkipped(call.first, call.second.Skipped);
+        call.second.Skipped = 0;
+      }
+    }
+  }
+
+  // Time only every Nth call of each function on a thread, including the
+  // first. The others are just counted, see Debug.api_call_sample_interval
+  bool RTProfile::sampleFunctionCall(FunctionCallBuffer* buffer, const char* functionName)
+  {
+    bool sampled = true;
+    if (FunctionCallSampleInterval > 1) {
+      std::lock_guard<std::mutex> lock(buffer->CallsLock);
+      auto& counts = buffer->Calls[functionName];
+      sampled = (counts.Calls++ % FunctionCallSampleInterval) == 0;
+      if (!sampled)
+        counts.Skipped++;
+    }
+    return buffer->pushCall(sampled);
+  }
+
   void RTProfile::logFunctionCallStart(const char* functionName, long long queueAddress)
   {
+    if (std::strstr(functionName, "MigrateMem"))
+      MigrateMemCalls++;
+
+    auto buffer = getFunctionCallBuffer();
+    if (!sampleFunctionCall(buffer, functionName)) {
+      FunctionStartLogged = true;
+      return;
+    }
+
 #ifdef USE_DEVICE_TIMELINE
     double timeStamp = getDeviceTimeStamp(getTraceTime(), CurrentDeviceName);
 #else
@@ -593,16 +751,14 @@ else if (functionName.find("clEnqueueMigrateMemObjects") != std::string::npos)
 #endif
 
     std::string name(functionName);
-    if (name.find("MigrateMem") != std::string::npos)
-      MigrateMemCalls++;
 
-    if (queueAddress == 0)
-      name += "|General";
-    else
-      (name += "|") +=std::to_string(queueAddress);
-    std::lock_guard<std::mutex> lock(LogMutex);
-    PerfCounters.logFunctionCallStart(functionName, timeStamp);
-    writeTimelineTrace(timeStamp, name.c_str(), "START");
+    // Record the call, the LogMutex is only taken once the buffer is full
+    FunctionCallBuffer::Record record = {timeStamp, functionName, queueAddress, true};
+    if (!buffer->push(record)) {
+      std::lock_guard<std::mutex> lock(LogMutex);
+      flushFunctionCalls();
+      buffer->push(record);
+    }
     FunctionStartLogged = true;
 
     // Write host event to trace buffer
@@ -620,6 +776,10 @@ else if (functionName.find("clEnqueueMigrateMemObjects") != std::string::npos)
     if (!FunctionStartLogged)
       logFunctionCallStart(functionName, queueAddress);
 
+    auto buffer = getFunctionCallBuffer();
+    if (!buffer->popCall())
+      return;
+
 #ifdef USE_DEVICE_TIMELINE
     double timeStamp = getDeviceTimeStamp(getTraceTime(), CurrentDeviceName);
 #else
@@ -627,14 +787,12 @@ else if (functionName.find("clEnqueueMigrateMemObjects") != std::string::npos)
 #endif
 
     std::string name(functionName);
-    if (queueAddress == 0)
-      name += "|General";
-    else
-      (name += "|") +=std::to_string(queueAddress);
-
-    std::lock_guard<std::mutex> lock(LogMutex);
-    PerfCounters.logFunctionCallEnd(functionName, timeStamp);
-    writeTimelineTrace(timeStamp, name.c_str(), "END");
+    FunctionCallBuffer::Record record = {timeStamp, functionName, queueAddress, false};
+    if (!buffer->push(record)) {
+      std::lock_guard<std::mutex> lock(LogMutex);
+      flushFunctionCalls();
+      buffer->push(record);
+    }
 
     // Write host event to trace buffer
     xclPerfMonEventID eventID = getFunctionEventID(name, queueAddress);
@@ -777,7 +935,32 @@ else if (functionName.find("clEnqueueMigrateMemObjects") != std::string::npos)
     std::lock_guard<std::mutex> lock(LogMutex);
     RTProfileDevice::TraceResultVector resultVector;
     DeviceProfile->logTrace(deviceName, type, traceVector, resultVector);
+    logDeviceTraceResults(deviceName, binaryName, resultVector);
+  }
+
+  // Log stalls summed over a window, read from the accelerator monitor
+  // counters when stall transitions are not traced
+  void RTProfile::logDeviceStallWindow(std::string deviceName, std::string binaryName,
+      xclCounterResults& counterResults, uint64_t timeNsec) {
+    if (DeviceProfile == NULL || StallTraceOption == STALL_TRACE_OFF)
+      return;
+
+    uint32_t stallMask = 0;
+    if (StallTraceOption & STALL_TRACE_INT) stallMask |= XSAM_TRACE_STALL_INT_MASK;
+    if (StallTraceOption & STALL_TRACE_STR) stallMask |= XSAM_TRACE_STALL_STR_MASK;
+    if (StallTraceOption & STALL_TRACE_EXT) stallMask |= XSAM_TRACE_STALL_EXT_MASK;
+    uint32_t numSlots = XCL::RTSingleton::Instance()->getProfileNumberSlots(XCL_PERF_MON_ACCEL, deviceName);
+
+    std::lock_guard<std::mutex> lock(LogMutex);
+    RTProfileDevice::TraceResultVector resultVector;
+    DeviceProfile->logStallWindow(deviceName, counterResults, timeNsec, numSlots,
+                                  stallMask, resultVector);
+    logDeviceTraceResults(deviceName, binaryName, resultVector);
+  }
 
+  // Caller must hold LogMutex
+  void RTProfile::logDeviceTraceResults(const std::string& deviceName, const std::string& binaryName,
+      RTProfileDevice::TraceResultVector& resultVector) {
     if (resultVector.empty())
       return;
 
@@ -1479,6 +1662,10 @@ else if (functionName.find("clEnqueueMigrateMemObjects") != std::string::npos)
 
   void RTProfile::getProfileRuleCheckSummary()
   {
+    {
+      std::lock_guard<std::mutex> lock(LogMutex);
+      flushFunctionCalls();
+    }
     RuleChecks->getProfileRuleCheckSummary(this);
   }
 
@@ -1488,6 +1675,10 @@ else if (functionName.find("clEnqueueMigrateMemObjects") != std::string::npos)
   }
 
   void RTProfile::writeProfileSummary() {
+    {
+      std::lock_guard<std::mutex> lock(LogMutex);
+      flushFunctionCalls();
+    }
     if(!this->isApplicationProfileOn())
       return;
 
@@ -27,6 +27,8 @@
 
 #include <limits>
 #include <cstdint>
+#include <atomic>
+#include <memory>
 #include <map>
 #include <set>
 #include <vector>
@@ -35,6 +37,7 @@
 #include <thread>
 #include <mutex>
 #include <queue>
+#include <unordered_map>
 
 namespace XCL {
   class WriterI;
@@ -44,6 +47,84 @@ namespace XCL {
   class DeviceTrace;
   class ProfileRuleChecks;
 
+  // **************************************************************************
+  // Per-thread buffer of API call events
+  //
+  // The owning thread pushes without locking, records are drained with
+  // RTProfile::LogMutex held. Function names are the static strings passed
+  // in by the API call logger.
+  // **************************************************************************
+  class FunctionCallBuffer {
+  public:
+    struct Record {
+      double TimeStamp;
+      const char* FunctionName;
+      long long QueueAddress;
+      bool IsStart;
+    };
+
+    static const size_t Capacity = 1024;
+
+    bool push(const Record& record) {
+      auto head = Head.load(std::memory_order_relaxed);
+      auto next = (head + 1) % Capacity;
+      if (next == Tail.load(std::memory_order_acquire))
+        return false;
+      Records[head] = record;
+      Head.store(next, std::memory_order_release);
+      return true;
+    }
+
+    bool pop(Record& record) {
+      auto tail = Tail.load(std::memory_order_relaxed);
+      if (tail == Head.load(std::memory_order_acquire))
+        return false;
+      record = Records[tail];
+      Tail.store((tail + 1) % Capacity, std::memory_order_release);
+      return true;
+    }
+
+    // Track nesting of the calls in progress on the owning thread, one
+    // bit per level records whether the call is timed. Returns the
+    // effective decision, calls nested too deep are always timed.
+    bool pushCall(bool sampled) {
+      if (Depth >= 64)
+        sampled = true;
+      else if (sampled)
+        SampledMask |= (1ULL << Depth);
+      else
+        SampledMask &= ~(1ULL << Depth);
+      ++Depth;
+      return sampled;
+    }
+
+    bool popCall() {
+      if (Depth == 0)
+        return true;
+      --Depth;
+      return (Depth >= 64) || ((SampledMask >> Depth) & 0x1);
+    }
+
+    // Cleared when the owning thread exits, the buffer is then reused
+    std::atomic<bool> InUse{true};
+
+    // Per function counts for 1-in-N call sampling, Skipped is moved to
+    // the summary when the buffer is flushed
+    struct CallCounts {
+      uint64_t Calls = 0;
+      uint32_t Skipped = 0;
+    };
+    std::mutex CallsLock;
+    std::unordered_map<const char*, CallCounts> Calls;
+
+  private:
+    uint64_t SampledMask = 0;
+    unsigned int Depth = 0;
+    Record Records[Capacity];
+    std::atomic<size_t> Head{0};
+    std::atomic<size_t> Tail{0};
+  };
+
   // **************************************************************************
   // Top-level profile class
   // **************************************************************************
@@ -69,7 +150,8 @@ namespace XCL {
       DEVICE_KERNEL_EXECUTE = 0x6,
       DEVICE_BUFFER_READ = 0x7,
       DEVICE_BUFFER_WRITE = 0x8,
-      DEPENDENCY_EVENT = 0x9
+      DEPENDENCY_EVENT = 0x9,
+      TASK_QUEUE = 0xA
     };
 
     enum e_profile_command_state {
@@ -144,6 +226,8 @@ namespace XCL {
     uint32_t getSampleIntervalMsec();
     void logDeviceTrace(std::string deviceName, std::string binaryName, xclPerfMonType type,
         xclTraceResultsVector& traceVector);
+    void logDeviceStallWindow(std::string deviceName, std::string binaryName,
+        xclCounterResults& counterResults, uint64_t timeNsec);
     void logDeviceCounters(std::string deviceName, std::string binaryName, xclPerfMonType type,
         xclCounterResults& counterResults, uint64_t timeNsec, bool firstReadAfterProgram);
 
@@ -171,6 +255,10 @@ namespace XCL {
   void logDependency(e_profile_command_kind objKind,
       const std::string eventString, const std::string dependString);
 
+    // log host task queue enqueue (QUEUE) and dequeue (START)
+    void logTaskQueue(uint64_t queueId, e_profile_command_state objStage,
+        size_t depth, uint64_t waitNsec);
+
     // log user or cl API function calls
     void logFunctionCallStart(const char* functionName, long long queueAddress);
     void logFunctionCallEnd(const char* functionName, long long queueAddress);
@@ -260,6 +348,15 @@ namespace XCL {
         std::string& stageString) const;
     void setTimeStamp(e_profile_command_state objStage, TimeTrace* traceObject, double timeStamp);
     xclPerfMonEventID getFunctionEventID(const std::string &functionName, long long queueAddress);
+    FunctionCallBuffer* getFunctionCallBuffer();
+    bool sampleFunctionCall(FunctionCallBuffer* buffer, const char* functionName);
+    // Following functions require LogMutex
+    void logFunctionCall(const FunctionCallBuffer::Record& record);
+    void flushFunctionCalls();
+    template <typename T>
+    void trimPendingTraces(std::map<uint64_t, T*>& traceMap);
+    void logDeviceTraceResults(const std::string& deviceName, const std::string& binaryName,
+        RTProfileDevice::TraceResultVector& resultVector);
 
     void setArgumentsBank(const std::string& deviceName);
 
@@ -285,6 +382,8 @@ namespace XCL {
     int OclSlotIndex;
     unsigned int HostSlotIndex;
     int MigrateMemCalls;
+    unsigned int FunctionCallSampleInterval;
+    unsigned int MaxPendingTraces;
     e_device_trace DeviceTraceOption;
     e_stall_trace StallTraceOption;
     uint32_t CurrentContextId;
@@ -307,6 +406,7 @@ namespace XCL {
     std::map<uint64_t, BufferTrace*> BufferTraceMap;
     std::map<uint64_t, DeviceTrace*> DeviceTraceMap;
     std::mutex LogMutex;
+    std::vector<std::shared_ptr<FunctionCallBuffer>> FunctionCallBuffers;
     RTProfileDevice* DeviceProfile;
     ProfileRuleChecks* RuleChecks;
 
@@ -86,9 +86,13 @@ namespace XCL {
     for (int i=0; i < XCL_PERF_MON_TOTAL_PROFILE; i++) {
       mTrainSlope[i] = 1000.0 / mTraceClockRateMHz;
       mTrainOffset[i] = 0.0;
+      mTrainProgramStart[i] = 0.0;
+      mTrainDeviceTime[i] = 0.0;
+      mTrainHostTime[i] = 0.0;
+      mNumTrainPoints[i] = 0;
     }
 
-    memset(&mPrevTimestamp, 0, XCL_PERF_MON_TOTAL_PROFILE*sizeof(uint32_t));
+    memset(&mPrevTimestamp, 0, XCL_PERF_MON_TOTAL_PROFILE*sizeof(uint64_t));
   }
 
   // Destructor
@@ -122,17 +126,23 @@ namespace XCL {
     uint8_t flags = 0;
     uint32_t prevHostTimestamp = 0xFFFFFFFF;
     uint32_t slotID = 0;
-    uint32_t timestamp = 0;
+    // Device timestamps are 45 bits, do not truncate them
+    uint64_t timestamp = 0;
     //uint64_t deviceStartTimestamp = 0;
     uint64_t hostTimestampNsec = 0;
     uint64_t startTime = 0;
-    double y1, y2, x1, x2;
     DeviceTrace kernelTrace;
     
     XDP_LOG("[rt_device_profile] Logging %u device trace samples (total = %ld)...\n",
         traceVector.mLength, mNumTraceEvents);
     mNumTraceEvents += traceVector.mLength;
 
+    // Kernel events go in front of the results.  Collect them here and
+    // insert once at the end, in the order that inserting each one at
+    // the front would give, instead of shifting the results per event.
+    TraceResultVector kernelResults;
+    resultVector.reserve(resultVector.size() + traceVector.mLength);
+
     // Find and set minimum timestamp in case of multiple Kernels
     if(isHwEmu) {
       uint64_t minHostTimestampNsec = traceVector.mArray[0].HostTimestamp;
@@ -176,21 +186,15 @@ Please use 'coarse' option for data transfer trace or turn off Stall profiling")
         prevHostTimestamp = trace.HostTimestamp;
       }
       else {
-        // for hw first two packets are for clock training
+        // for hw only clock training packets carry a host timestamp, the
+        // first two come from startTrace and the rest from periodic training
         // 1000 is to account for delay in sending from host
         // TODO: Calculate the delay instead of hard coding
-        if (i == 0) {
-          y1 = static_cast <double> (trace.HostTimestamp) + 1000;
-          x1 = static_cast <double> (trace.Timestamp);
+        if (trace.HostTimestamp != 0) {
+          addClockTrainingPoint(deviceName, type, static_cast <double> (trace.Timestamp),
+                                static_cast <double> (trace.HostTimestamp) + 1000);
           continue;
         }
-        if (i == 1) {
-          y2 = static_cast <double> (trace.HostTimestamp) + 1000;
-          x2 = static_cast <double> (trace.Timestamp);
-          mTrainSlope[type] = (y2 - y1) / (x2 - x1);
-          mTrainOffset[type] = y2 - mTrainSlope[type] * x2;
-          trainDeviceHostTimestamps(deviceName, type);
-        }
         if (trace.Overflow == 1)
           trace.Timestamp += LOOP_ADD_TIME_SPM;
         timestamp = trace.Timestamp;
@@ -340,7 +344,7 @@ Please use 'coarse' option for data transfer trace or turn off Stall profiling")
               kernelTrace.StartTime = startTime;
               kernelTrace.Start = convertDeviceToHostTimestamp(startTime, type, deviceName);
               kernelTrace.TraceStart = kernelTrace.Start;
-              resultVector.insert(resultVector.begin(), kernelTrace);
+              kernelResults.push_back(kernelTrace);
             }
             else {
               mAccelMonCuTime[s] = timestamp;
@@ -452,10 +456,19 @@ Please use 'coarse' option for data transfer trace or turn off Stall profiling")
     
     // Try to approximate CU Ends from data transnfers
     if(!isHwEmu) {
-      std::string cuPortName, cuNameSAM, cuNameSPM;
+      std::string cuPortName, cuNameSAM;
+      // CU of each memory monitor slot, looked up once for all CUs
+      std::vector<std::string> cuNamesSPM;
       auto rts = XCL::RTSingleton::Instance();
       for (int i = 0; i < XSAM_MAX_NUMBER_SLOTS; i++) {
         if (mAccelMonStartedEvents[i] & XSAM_TRACE_CU_MASK) {
+          if (cuNamesSPM.empty()) {
+            cuNamesSPM.resize(XSPM_MAX_NUMBER_SLOTS);
+            for (int j = 0; j < XSPM_MAX_NUMBER_SLOTS; j++) {
+              rts->getProfileSlotName(XCL_PERF_MON_MEMORY, deviceName, j, cuPortName);
+              cuNamesSPM[j] = cuPortName.substr(0, cuPortName.find_first_of("/"));
+            }
+          }
           kernelTrace.SlotNum = i;
           kernelTrace.Name = "OCL Region";
           kernelTrace.Type = "Kernel";
@@ -467,9 +480,7 @@ Please use 'coarse' option for data transfer trace or turn off Stall profiling")
           uint64_t lastTimeStamp = 0;
           rts->getProfileSlotName(XCL_PERF_MON_ACCEL, deviceName, i, cuNameSAM);
           for (int j = 0; j < XSPM_MAX_NUMBER_SLOTS; j++) {
-            rts->getProfileSlotName(XCL_PERF_MON_MEMORY, deviceName, j, cuPortName);
-            cuNameSPM = cuPortName.substr(0, cuPortName.find_first_of("/"));
-            if (cuNameSAM == cuNameSPM && lastTimeStamp < mPerfMonLastTranx[j])
+            if (cuNameSAM == cuNamesSPM[j] && lastTimeStamp < mPerfMonLastTranx[j])
               lastTimeStamp = mPerfMonLastTranx[j];
           }
           if (lastTimeStamp < mAccelMonLastTranx[i])
@@ -480,11 +491,12 @@ Please use 'coarse' option for data transfer trace or turn off Stall profiling")
             kernelTrace.EndTime = lastTimeStamp;
             kernelTrace.End = convertDeviceToHostTimestamp(kernelTrace.EndTime, type, deviceName);
             // Insert is needed in case there are only stalls
-            resultVector.insert(resultVector.begin(), kernelTrace);
+            kernelResults.push_back(kernelTrace);
           }
         }
       }
     }
+    resultVector.insert(resultVector.begin(), kernelResults.rbegin(), kernelResults.rend());
     // Clear vectors
     std::fill_n(mAccelMonStartedEvents,XSAM_MAX_NUMBER_SLOTS,0);
     mDeviceTrainVector.clear();
@@ -493,6 +505,52 @@ Please use 'coarse' option for data transfer trace or turn off Stall profiling")
     XDP_LOG("[rt_device_profile] Done logging device trace samples\n");
   }
 
+  // Report one event per stall type and CU holding the stall time summed
+  // over the window, in place of a trace event per stall transition.
+  // Events start at the window start, so their length reads as the share
+  // of the window the CU was stalled.
+  void RTProfileDevice::logStallWindow(std::string deviceName, xclCounterResults& counterResults,
+      uint64_t timeNsec, uint32_t numSlots, uint32_t stallMask,
+      TraceResultVector& resultVector) {
+    double windowEndMsec = timeNsec / 1.0e6;
+    bool firstWindow = (mStallWindowStartMsec == 0.0);
+    double windowMsec = windowEndMsec - mStallWindowStartMsec;
+    double cyclesPerMsec = getKernelClockFreqMHz(deviceName) * 1000.0;
+
+    auto logStall = [&](uint32_t s, const char* stallType, uint32_t cycles, uint32_t& prevCycles) {
+      // Unsigned difference is correct across counter rollover
+      uint32_t stallCycles = cycles - prevCycles;
+      prevCycles = cycles;
+      if (firstWindow || stallCycles == 0)
+        return;
+
+      DeviceTrace kernelTrace;
+      kernelTrace.SlotNum = s;
+      kernelTrace.Name = "OCL Region";
+      kernelTrace.Type = stallType;
+      kernelTrace.Kind = DeviceTrace::DEVICE_KERNEL;
+      kernelTrace.BurstLength = 0;
+      kernelTrace.NumBytes = 0;
+      kernelTrace.StartTime = 0;
+      kernelTrace.EndTime = stallCycles;
+      kernelTrace.Start = mStallWindowStartMsec;
+      kernelTrace.End = mStallWindowStartMsec + std::min(stallCycles / cyclesPerMsec, windowMsec);
+      kernelTrace.TraceStart = kernelTrace.Start;
+      resultVector.push_back(kernelTrace);
+    };
+
+    for (uint32_t s=0; s < numSlots; s++) {
+      if (stallMask & XSAM_TRACE_STALL_INT_MASK)
+        logStall(s, "Intra-Kernel Dataflow Stall", counterResults.CuStallIntCycles[s], mAccelMonStallIntCycles[s]);
+      if (stallMask & XSAM_TRACE_STALL_STR_MASK)
+        logStall(s, "Inter-Kernel Pipe Stall", counterResults.CuStallStrCycles[s], mAccelMonStallStrCycles[s]);
+      if (stallMask & XSAM_TRACE_STALL_EXT_MASK)
+        logStall(s, "External Memory Stall", counterResults.CuStallExtCycles[s], mAccelMonStallExtCycles[s]);
+    }
+
+    mStallWindowStartMsec = windowEndMsec;
+  }
+
   // ****************
   // Helper functions
   // ****************
@@ -631,6 +689,28 @@ Please use 'coarse' option for data transfer trace or turn off Stall profiling")
     mTrainProgramStart[type] = static_cast<double>(currentTime - currentOffset);
   }
 
+  // Each new point starts a segment through it and the previous point, so
+  // the mapping follows drift between host and device clocks over time
+  void RTProfileDevice::addClockTrainingPoint(std::string deviceName, xclPerfMonType type,
+      double deviceTimestamp, double hostTimestampNsec) {
+    // Until there are two points, use the nominal trace clock as slope
+    if (mNumTrainPoints[type] > 0 && deviceTimestamp > mTrainDeviceTime[type]) {
+      mTrainSlope[type] = (hostTimestampNsec - mTrainHostTime[type])
+                        / (deviceTimestamp - mTrainDeviceTime[type]);
+    }
+    mTrainOffset[type] = hostTimestampNsec - mTrainSlope[type] * deviceTimestamp;
+
+    // Host clock offset only needs to be found once
+    if (mNumTrainPoints[type] == 0)
+      trainDeviceHostTimestamps(deviceName, type);
+
+    XDP_LOG("[rt_device_profile] Clock training point %u: device = %.0f, host = %.0f, slope = %.6f\n",
+            mNumTrainPoints[type], deviceTimestamp, hostTimestampNsec, mTrainSlope[type]);
+    mTrainDeviceTime[type] = deviceTimestamp;
+    mTrainHostTime[type] = hostTimestampNsec;
+    mNumTrainPoints[type]++;
+  }
+
   // Convert device timestamp to host time domain (in msec)
   double RTProfileDevice::convertDeviceToHostTimestamp(uint64_t deviceTimestamp, xclPerfMonType type,
       const std::string& deviceName) { 
@@ -89,8 +89,10 @@ namespace XCL {
         mTraceClockRateMHz = clockRateMHz;
 
         // Update slope for conversion between device and host
-        for (int i=0; i < XCL_PERF_MON_TOTAL_PROFILE; i++)
+        for (int i=0; i < XCL_PERF_MON_TOTAL_PROFILE; i++) {
           mTrainSlope[i] = 1000.0 / clockRateMHz;
+          mNumTrainPoints[i] = 0;
+        }
       }
       void setGlobalMemoryClockFreqMHz(double clockRateMHz) {
         mGlobalMemoryClockRateMHz = clockRateMHz;
@@ -104,6 +106,12 @@ namespace XCL {
       void logTrace(std::string deviceName, xclPerfMonType type,
           xclTraceResultsVector& traceVector, TraceResultVector& resultVector);
 
+      // log stalls counted by accelerator monitors since last window,
+      // stallMask selects XSAM_TRACE_STALL_* types
+      void logStallWindow(std::string deviceName, xclCounterResults& counterResults,
+          uint64_t timeNsec, uint32_t numSlots, uint32_t stallMask,
+          TraceResultVector& resultVector);
+
       // Get slot name and kind
       void getSlotName(int slotnum, std::string& slotName) const;
       DeviceTrace::e_device_kind getSlotKind(std::string& slotName) const;
@@ -119,6 +127,8 @@ namespace XCL {
 
       // Device/host timestamps: training and conversion
       void trainDeviceHostTimestamps(std::string deviceName, xclPerfMonType type);
+      void addClockTrainingPoint(std::string deviceName, xclPerfMonType type,
+          double deviceTimestamp, double hostTimestampNsec);
       double convertDeviceToHostTimestamp(uint64_t deviceTimestamp, xclPerfMonType type,
           const std::string& deviceName);
 
@@ -146,13 +156,23 @@ namespace XCL {
       double mTrainSlope[XCL_PERF_MON_TOTAL_PROFILE];
       double mTrainOffset[XCL_PERF_MON_TOTAL_PROFILE];
       double mTrainProgramStart[XCL_PERF_MON_TOTAL_PROFILE];
-      uint32_t mPrevTimestamp[XCL_PERF_MON_TOTAL_PROFILE];
+      // Latest clock training point, the mapping is piecewise-linear
+      // through consecutive points
+      double mTrainDeviceTime[XCL_PERF_MON_TOTAL_PROFILE];
+      double mTrainHostTime[XCL_PERF_MON_TOTAL_PROFILE];
+      uint32_t mNumTrainPoints[XCL_PERF_MON_TOTAL_PROFILE];
+      uint64_t mPrevTimestamp[XCL_PERF_MON_TOTAL_PROFILE];
       uint64_t mAccelMonCuTime[XSAM_MAX_NUMBER_SLOTS]       = { 0 };
       uint64_t mAccelMonCuHostTime[XSAM_MAX_NUMBER_SLOTS]   = { 0 };
       uint64_t mAccelMonStallIntTime[XSAM_MAX_NUMBER_SLOTS] = { 0 };
       uint64_t mAccelMonStallStrTime[XSAM_MAX_NUMBER_SLOTS] = { 0 };
       uint64_t mAccelMonStallExtTime[XSAM_MAX_NUMBER_SLOTS] = { 0 };
       uint8_t mAccelMonStartedEvents[XSAM_MAX_NUMBER_SLOTS] = { 0 };
+      // Stall counters at start of current stall window
+      uint32_t mAccelMonStallIntCycles[XSAM_MAX_NUMBER_SLOTS] = { 0 };
+      uint32_t mAccelMonStallStrCycles[XSAM_MAX_NUMBER_SLOTS] = { 0 };
+      uint32_t mAccelMonStallExtCycles[XSAM_MAX_NUMBER_SLOTS] = { 0 };
+      double mStallWindowStartMsec = 0.0;
       uint64_t mPerfMonLastTranx[XSPM_MAX_NUMBER_SLOTS]     = { 0 };
       uint64_t mAccelMonLastTranx[XSAM_MAX_NUMBER_SLOTS]    = { 0 };
       std::set<std::string> mDeviceFirstTimestamp;
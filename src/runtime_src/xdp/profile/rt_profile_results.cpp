@@ -21,6 +21,7 @@
 #include <chrono>
 #include <iomanip>
 #include <algorithm>
+#include <cmath>
 #include <time.h>
 // #include <unistd.h>
 #include "rt_profile_results.h"
@@ -34,6 +35,65 @@ XCL::DeviceTrace* XCL::DeviceTrace::RecycleHead = nullptr;
 
 namespace XCL {
 
+  //
+  // LatencyHistogram
+  //
+
+  // Values below 2^SubBucketBits ns get their own bucket, larger values use
+  // the top SubBucketBits bits below the MSB as a linear sub-bucket
+  uint32_t LatencyHistogram::getBucket(uint64_t valueNsec)
+  {
+    const uint64_t subBuckets = 1ULL << SubBucketBits;
+    if (valueNsec < subBuckets)
+      return static_cast<uint32_t>(valueNsec);
+
+    uint32_t msb = 63 - __builtin_clzll(valueNsec);
+    uint32_t shift = msb - SubBucketBits;
+    uint32_t subBucket = (valueNsec >> shift) & (subBuckets - 1);
+    return ((shift + 1) << SubBucketBits) | subBucket;
+  }
+
+  double LatencyHistogram::getBucketMidpoint(uint32_t bucket)
+  {
+    const uint32_t subBuckets = 1U << SubBucketBits;
+    if (bucket < subBuckets)
+      return bucket / 1.0e6;
+
+    uint32_t shift = (bucket >> SubBucketBits) - 1;
+    uint64_t lower = static_cast<uint64_t>(subBuckets | (bucket & (subBuckets - 1))) << shift;
+    return (lower + ((1ULL << shift) / 2.0)) / 1.0e6;
+  }
+
+  void LatencyHistogram::record(double durationMsec)
+  {
+    if (durationMsec < 0.0)
+      durationMsec = 0.0;
+    Buckets[getBucket(static_cast<uint64_t>(durationMsec * 1.0e6))]++;
+    Count++;
+    if (MaxValue < durationMsec)
+      MaxValue = durationMsec;
+    if (MinValue > durationMsec)
+      MinValue = durationMsec;
+  }
+
+  double LatencyHistogram::getPercentile(double percentile) const
+  {
+    if (Count == 0)
+      return 0.0;
+
+    // Nearest rank, first sample whose cumulative count reaches it
+    uint64_t rank = static_cast<uint64_t>(std::ceil(percentile / 100.0 * Count));
+    rank = std::max<uint64_t>(1, std::min<uint64_t>(rank, Count));
+
+    uint64_t total = 0;
+    for (const auto& bucket : Buckets) {
+      total += bucket.second;
+      if (total >= rank)
+        return std::min(MaxValue, std::max(MinValue, getBucketMidpoint(bucket.first)));
+    }
+    return MaxValue;
+  }
+
   //
   // BufferStats
   //
@@ -48,6 +108,7 @@ namespace XCL {
     // by ms duration to get MB/s
     double transferRate = (size / (1000.0 * duration));
     AveTransferRate = (AveTransferRate * Count + transferRate) / (Count + 1);
+    Latency.record(duration);
     Count++;
     if (Max < size)
       Max = size;
@@ -76,6 +137,7 @@ namespace XCL {
     double time = EndTime - StartTime;
     TotalTime += time;
     AveTime = (AveTime * NoOfCalls + time) / (NoOfCalls + 1);
+    Latency.record(time);
     NoOfCalls++;
     if (MaxTime < time)
       MaxTime = time;
@@ -36,6 +36,34 @@
 namespace XCL {
   class WriterI;
 
+  // Streaming duration distribution used for percentile columns
+  // Bucketed like an HDR histogram: exact below 32 ns, then 32 linear
+  // sub-buckets per power of two (under 3% relative error)
+  // All recorded values are in ms
+  class LatencyHistogram {
+  public:
+    LatencyHistogram()
+      : Count( 0 ),
+        MinValue( (std::numeric_limits<double>::max)() ),
+        MaxValue( 0.0 )
+      {};
+    ~LatencyHistogram() {};
+  public:
+    void record(double durationMsec);
+    // Percentile in [0, 100], returns 0 if nothing was recorded
+    double getPercentile(double percentile) const;
+    inline uint64_t getCount() const { return Count; }
+  private:
+    static uint32_t getBucket(uint64_t valueNsec);
+    static double getBucketMidpoint(uint32_t bucket);
+  private:
+    static const uint32_t SubBucketBits = 5;
+    std::map<uint32_t, uint64_t> Buckets;
+    uint64_t Count;
+    double MinValue;
+    double MaxValue;
+  };
+
   // Class to record stats on buffer read and writes
   // All sizes are in bytes and times are in ms
   class BufferStats {
@@ -80,6 +108,7 @@ namespace XCL {
     }
     inline double getClockFreqMhz() const { return ClockFreqMhz; }
     inline std::string getDeviceName() const { return DeviceName; }
+    inline const LatencyHistogram& getLatency() const { return Latency; }
 
     inline void setContextId(uint32_t contextId) { ContextId = contextId; }
     inline void setNumDevices(uint32_t numDevices) { NumDevices = numDevices; }
@@ -102,6 +131,7 @@ namespace XCL {
     double AveTransferRate;
     double ClockFreqMhz;
     std::string DeviceName;
+    LatencyHistogram Latency;
   };
 
   // Class to record stats on time such as time spent in an API call
@@ -117,6 +147,7 @@ namespace XCL {
         MaxTime( 0 ),
         MinTime( (std::numeric_limits<double>::max)() ),
         NoOfCalls( 0 ),
+        SkippedCalls( 0 ),
         ClockFreqMhz( 300 )
       {};
     ~TimeStats() {};
@@ -125,12 +156,16 @@ namespace XCL {
     void logEnd(double timePoint);
     void logStats(double totalTimeStat, double maxTimeStat, 
                   double minTimeStat, uint32_t totalCalls, uint32_t clockFreqMhz);
-    inline double getTotalTime() const { return TotalTime; }
+    // Count calls that were not timed, their time is taken as the average
+    void logSkippedCalls(uint32_t calls) { SkippedCalls += calls; }
+    inline double getTotalTime() const { return TotalTime + AveTime * SkippedCalls; }
     inline double getAveTime() const {return AveTime; }
     inline double getMaxTime() const {return MaxTime; }
     inline double getMinTime() const {return MinTime; }
-    inline uint32_t getNoOfCalls() const {return NoOfCalls; }
+    inline uint32_t getNoOfCalls() const {return NoOfCalls + SkippedCalls; }
     inline uint32_t getClockFreqMhz() const { return ClockFreqMhz; }
+    // Only timed calls are in the histogram, counter stats have none
+    inline const LatencyHistogram& getLatency() const { return Latency; }
   private:
     double TotalTime;
     double StartTime;
@@ -139,7 +174,9 @@ namespace XCL {
     double MaxTime;
     double MinTime;
     uint32_t NoOfCalls;
+    uint32_t SkippedCalls;
     uint32_t ClockFreqMhz;
+    LatencyHistogram Latency;
   };
 
   // Class to store time trace of kernel execution, buffer read, or buffer write
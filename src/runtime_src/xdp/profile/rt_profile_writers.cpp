@@ -112,7 +112,8 @@ namespace XCL {
     //Table 1: API Call summary
     std::vector<std::string> APICallSummaryColumnLabels = { "API Name",
         "Number Of Calls", "Total Time (ms)", "Minimum Time (ms)",
-        "Average Time (ms)", "Maximum Time (ms)" };
+        "Average Time (ms)", "Maximum Time (ms)",
+        "P50 Time (ms)", "P90 Time (ms)", "P99 Time (ms)", "P99.9 Time (ms)" };
 
     writeTableHeader(getSummaryStream(), "OpenCL API Calls", APICallSummaryColumnLabels);
     profile->writeAPISummary(this);
@@ -121,7 +122,8 @@ namespace XCL {
     // Table 2: Kernel Execution Summary
     std::vector<std::string> KernelExecutionSummaryColumnLabels = {
         "Kernel", "Number Of Enqueues", "Total Time (ms)",
-        "Minimum Time (ms)", "Average Time (ms)", "Maximum Time (ms)" };
+        "Minimum Time (ms)", "Average Time (ms)", "Maximum Time (ms)",
+        "P50 Time (ms)", "P90 Time (ms)", "P99 Time (ms)", "P99.9 Time (ms)" };
 
     std::string table2Caption = (flowMode == XCL::RTSingleton::HW_EM) ?
         "Kernel Execution (includes estimated device times)" : "Kernel Execution";
@@ -133,7 +135,8 @@ namespace XCL {
     std::vector<std::string> ComputeUnitExecutionSummaryColumnLabels = {
         "Device", "Compute Unit", "Kernel", "Global Work Size", "Local Work Size",
         "Number Of Calls", "Total Time (ms)", "Minimum Time (ms)",
-        "Average Time (ms)", "Maximum Time (ms)", "Clock Frequency (MHz)" };
+        "Average Time (ms)", "Maximum Time (ms)", "Clock Frequency (MHz)",
+        "P50 Time (ms)", "P90 Time (ms)", "P99 Time (ms)", "P99.9 Time (ms)" };
 
     std::string table3Caption = (flowMode == XCL::RTSingleton::HW_EM) ?
         "Compute Unit Utilization (includes estimated device times)" : "Compute Unit Utilization";
@@ -172,7 +175,8 @@ namespace XCL {
     std::vector<std::string> DataTransferSummaryColumnLabels = {
         "Context:Number of Devices", "Transfer Type", "Number Of Transfers",
         "Transfer Rate (MB/s)", "Average Bandwidth Utilization (%)",
-        "Average Size (KB)", "Total Time (ms)", "Average Time (ms)"
+        "Average Size (KB)", "Total Time (ms)", "Average Time (ms)",
+        "P50 Time (ms)", "P90 Time (ms)", "P99 Time (ms)", "P99.9 Time (ms)"
     };
     writeTableHeader(getSummaryStream(), "Data Transfer: Host and Global Memory",
         DataTransferSummaryColumnLabels);
@@ -227,9 +231,22 @@ namespace XCL {
     writeTableCells(getSummaryStream(), name, stats.getNoOfCalls(),
         stats.getTotalTime(), stats.getMinTime(),
         stats.getAveTime(), stats.getMaxTime());
+    writePercentileCells(getSummaryStream(), stats.getLatency());
     writeTableRowEnd(getSummaryStream());
   }
 
+  void WriterI::writePercentileCells(std::ofstream& ofs, const LatencyHistogram& latency,
+      bool valid)
+  {
+    static const double percentiles[] = {50.0, 90.0, 99.0, 99.9};
+    for (auto percentile : percentiles) {
+      if (valid && latency.getCount() > 0)
+        writeTableCells(ofs, latency.getPercentile(percentile));
+      else
+        writeTableCells(ofs, "N/A");
+    }
+  }
+
   void WriterI::writeStallSummary(std::string& cuName, uint32_t cuRunCount, 
       double cuRunTimeMsec, double cuStallExt, double cuStallStr, double cuStallInt)
   {
@@ -301,6 +318,8 @@ namespace XCL {
     writeTableRowStart(getSummaryStream());
     writeTableCells(getSummaryStream(), contextDevices, name, totalTranx,
         transferRateStr, aveBWUtilStr, aveBytes/1000.0, totalTimeStr, aveTimeStr);
+    writePercentileCells(getSummaryStream(), stats.getLatency(),
+        XCL::RTSingleton::Instance()->getFlowMode() != XCL::RTSingleton::HW_EM);
 
     writeTableRowEnd(getSummaryStream());
   }
@@ -467,6 +486,7 @@ namespace XCL {
         name.substr(third_index+1, fourth_index - third_index -1), // localSize
         stats.getNoOfCalls(), stats.getTotalTime(), stats.getMinTime(),
         stats.getAveTime(), stats.getMaxTime(), stats.getClockFreqMhz());
+    writePercentileCells(getSummaryStream(), stats.getLatency());
     writeTableRowEnd(getSummaryStream());
   }
 
@@ -486,6 +506,7 @@ namespace XCL {
         name.substr(fourth_index+1), // cuName
         stats.getNoOfCalls(), stats.getTotalTime(), stats.getMinTime(),
         stats.getAveTime(), stats.getMaxTime(), clockFreqMHz);
+    writePercentileCells(getSummaryStream(), stats.getLatency());
     writeTableRowEnd(getSummaryStream());
   }
 
@@ -1327,7 +1348,8 @@ namespace XCL {
     // Table 1: Software Functions
     std::vector<std::string> SoftwareFunctionColumnLabels = { 
         "Function", "Number Of Calls", "Total Time (ms)", "Minimum Time (ms)",
-        "Average Time (ms)", "Maximum Time (ms)" };
+        "Average Time (ms)", "Maximum Time (ms)",
+        "P50 Time (ms)", "P90 Time (ms)", "P99 Time (ms)", "P99.9 Time (ms)" };
 
     writeTableHeader(getSummaryStream(), "Software Functions", SoftwareFunctionColumnLabels);
     profile->writeAPISummary(this);
@@ -1336,7 +1358,8 @@ namespace XCL {
     // Table 2: Hardware Functions
     std::vector<std::string> HardwareFunctionColumnLabels = {
         "Function", "Number Of Calls", "Total Time (ms)", "Minimum Time (ms)", 
-        "Average Time (ms)", "Maximum Time (ms)" };
+        "Average Time (ms)", "Maximum Time (ms)",
+        "P50 Time (ms)", "P90 Time (ms)", "P99 Time (ms)", "P99.9 Time (ms)" };
 
     std::string table2Caption = (XCL::RTSingleton::Instance()->getFlowMode() == XCL::RTSingleton::HW_EM) ?
         "Hardware Functions (includes estimated device times)" : "Hardware Functions";
@@ -1347,7 +1370,8 @@ namespace XCL {
     // Table 3: Hardware Accelerators
     std::vector<std::string> HardwareAcceleratorColumnLabels = {
         "Location", "Accelerator", "Number Of Calls", "Total Time (ms)", "Minimum Time (ms)",
-        "Average Time (ms)", "Maximum Time (ms)", "Clock Frequency (MHz)" };
+        "Average Time (ms)", "Maximum Time (ms)", "Clock Frequency (MHz)",
+        "P50 Time (ms)", "P90 Time (ms)", "P99 Time (ms)", "P99.9 Time (ms)" };
 
     std::string table3Caption = (XCL::RTSingleton::Instance()->getFlowMode() == XCL::RTSingleton::HW_EM) ?
         "Hardware Accelerators (includes estimated device times)" : "Hardware Accelerators";
@@ -1392,7 +1416,8 @@ namespace XCL {
     // Table 7: Data Transfer: Host and DDR Memory
     std::vector<std::string> HostTransferColumnLabels = {
         "Transfer Type", "Number Of Transfers", "Transfer Rate (MB/s)", 
-        "Average Bandwidth Utilization (%)", "Average Size (KB)", "Average Time (ms)"
+        "Average Bandwidth Utilization (%)", "Average Size (KB)", "Average Time (ms)",
+        "P50 Time (ms)", "P90 Time (ms)", "P99 Time (ms)", "P99.9 Time (ms)"
     };
     writeTableHeader(getSummaryStream(), "Data Transfer: Host and DDR Memory",
         HostTransferColumnLabels);
@@ -1599,9 +1624,161 @@ namespace XCL {
     writeTableRowStart(getSummaryStream());
     writeTableCells(getSummaryStream(), name, totalTranx, transferRateStr, 
         aveBWUtilStr, aveBytes/1000.0, aveTimeStr);
+    writePercentileCells(getSummaryStream(), stats.getLatency(),
+        XCL::RTSingleton::Instance()->getFlowMode() != XCL::RTSingleton::HW_EM);
 
     writeTableRowEnd(getSummaryStream());
   }
+
+  // ******************
+  // Trace Event Writer
+  // ******************
+  TraceEventWriter::TraceEventWriter(const std::string& timelineFileName) :
+        TimelineFileName(timelineFileName)
+  {
+    if (TimelineFileName != "") {
+      assert(!Timeline_ofs.is_open());
+      TimelineFileName += FileExtension;
+      openStream(Timeline_ofs, TimelineFileName);
+      Timeline_ofs << "[\n";
+      Timeline_ofs.flush();
+    }
+  }
+
+  TraceEventWriter::~TraceEventWriter()
+  {
+    if (Timeline_ofs.is_open()) {
+      Timeline_ofs << "\n]\n";
+      Timeline_ofs.close();
+    }
+  }
+
+  std::string TraceEventWriter::escape(const std::string& str)
+  {
+    std::string result;
+    result.reserve(str.size());
+    for (auto c : str) {
+      if (static_cast<unsigned char>(c) < 0x20)
+        continue;
+      if (c == '"' || c == '\\')
+        result += '\\';
+      result += c;
+    }
+    return result;
+  }
+
+  uint64_t TraceEventWriter::getTrack(const std::string& key)
+  {
+    auto itr = Tracks.find(key);
+    if (itr != Tracks.end())
+      return itr->second;
+    uint64_t track = Tracks.size();
+    Tracks[key] = track;
+    return track;
+  }
+
+  void TraceEventWriter::writeEvent(const char* phase, double traceTime,
+      const std::string& name, const char* category, int pid, uint64_t tid,
+      const std::string& id, double duration, const std::string& args)
+  {
+    if (!Timeline_ofs.is_open())
+      return;
+
+    auto& ofs = getTimelineStream();
+    if (!FirstEvent)
+      ofs << ",\n";
+    FirstEvent = false;
+
+    // Trace event timestamps are in usec
+    ofs << std::setprecision(15)
+        << "{\"name\":\"" << escape(name) << "\",\"cat\":\"" << category
+        << "\",\"ph\":\"" << phase << "\",\"ts\":" << traceTime * 1000.0
+        << ",\"pid\":" << pid << ",\"tid\":" << tid;
+    if (!id.empty())
+      ofs << ",\"id\":\"" << escape(id) << "\"";
+    if (phase[0] == 'X')
+      ofs << ",\"dur\":" << duration * 1000.0;
+    else if (phase[0] == 'i')
+      ofs << ",\"s\":\"t\"";
+    if (!args.empty())
+      ofs << ",\"args\":{" << args << "}";
+    ofs << "}";
+
+    if (++NumEvents % FlushInterval == 0)
+      ofs.flush();
+  }
+
+  // API calls nest per queue, names are "<function>|<queue>"
+  void TraceEventWriter::writeTimeline(double time, const std::string& functionName,
+      const std::string& eventName)
+  {
+    auto pos = functionName.find('|');
+    std::string name = functionName.substr(0, pos);
+    std::string queue = (pos == std::string::npos) ? "" : functionName.substr(pos + 1);
+    const char* phase = (eventName == "START") ? "B" : "E";
+    writeEvent(phase, time, name, "api", 0, getTrack(queue));
+  }
+
+  // Kernel enqueues overlap, so START/END are async events keyed by cl event
+  void TraceEventWriter::writeTimeline(double traceTime, const std::string& commandString,
+            const std::string& stageString, const std::string& eventString,
+            const std::string& dependString, uint64_t objId, size_t size)
+  {
+    std::stringstream args;
+    args << "\"stage\":\"" << stageString << "\",\"object\":" << objId
+         << ",\"size\":" << size << ",\"depend\":\"" << escape(dependString) << "\"";
+
+    const char* phase = (stageString == "START") ? "b" : (stageString == "END") ? "e" : "i";
+    writeEvent(phase, traceTime, commandString, "kernel", 0, getTrack(commandString),
+               eventString, 0.0, args.str());
+  }
+
+  void TraceEventWriter::writeTimeline(double traceTime, const std::string& commandString,
+            const std::string& stageString, const std::string& eventString,
+            const std::string& dependString, size_t size, uint64_t address,
+            const std::string& bank, std::thread::id threadId)
+  {
+    std::stringstream args;
+    args << "\"stage\":\"" << stageString << "\",\"address\":\""
+         << (boost::format("0X%09x") % address) << "\",\"bank\":\"" << escape(bank)
+         << "\",\"size\":" << size << ",\"depend\":\"" << escape(dependString) << "\"";
+
+    const char* phase = (stageString == "START") ? "b" : (stageString == "END") ? "e" : "i";
+    writeEvent(phase, traceTime, commandString, "transfer", 0, getTrack(commandString),
+               eventString, 0.0, args.str());
+  }
+
+  void TraceEventWriter::writeTimeline(double traceTime, const std::string& commandString,
+            const std::string& stageString, const std::string& eventString,
+            const std::string& dependString)
+  {
+    std::stringstream args;
+    args << "\"event\":\"" << escape(eventString) << "\",\"depend\":\""
+         << escape(dependString) << "\"";
+    writeEvent("i", traceTime, commandString, "dependency", 0, getTrack(commandString),
+               "", 0.0, args.str());
+  }
+
+  // Device activity is complete, one track per monitor slot of each device
+  void TraceEventWriter::writeDeviceTrace(const RTProfileDevice::TraceResultVector &resultVector,
+      std::string deviceName, std::string binaryName)
+  {
+    for (auto& tr : resultVector) {
+#ifndef XDP_VERBOSE
+      if (tr.Kind == DeviceTrace::DEVICE_BUFFER)
+        continue;
+#endif
+      std::string kind = (tr.Kind == DeviceTrace::DEVICE_KERNEL) ? "Kernel" : "Host";
+      std::string track = deviceName + "|" + kind + "|" + std::to_string(tr.SlotNum);
+
+      std::stringstream args;
+      args << "\"binary\":\"" << escape(binaryName) << "\",\"slot\":" << tr.SlotNum
+           << ",\"burst\":" << tr.BurstLength << ",\"start_cycles\":" << tr.StartTime
+           << ",\"end_cycles\":" << tr.EndTime;
+      writeEvent("X", tr.Start, kind + "_" + tr.Type, "device", 1, getTrack(track),
+                 "", tr.End - tr.Start, args.str());
+    }
+  }
 }
 
 
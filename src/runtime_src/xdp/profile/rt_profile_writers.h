@@ -95,27 +95,27 @@ namespace XCL {
 
 	    // Functions for timeline trace log
 	    // Write timeline trace of a function call such as cl API call
-	    void writeTimeline(double time, const std::string& functionName,
+	    virtual void writeTimeline(double time, const std::string& functionName,
 	        const std::string& eventName);
 	    // Write timeline trace of Kernel execution
-	    void writeTimeline(double traceTime, const std::string& commandString,
+	    virtual void writeTimeline(double traceTime, const std::string& commandString,
             const std::string& stageString, const std::string& eventString,
             const std::string& dependString, uint64_t objId, size_t size);
 	    // Write timeline trace of read/write of buffer
-	    void writeTimeline(double traceTime, const std::string& commandString,
+	    virtual void writeTimeline(double traceTime, const std::string& commandString,
             const std::string& stageString, const std::string& eventString,
             const std::string& dependString, size_t size, uint64_t address,
             const std::string& bank, std::thread::id threadId);
-	    void writeTimeline(double traceTime, const std::string& commandString,
+	    virtual void writeTimeline(double traceTime, const std::string& commandString,
             const std::string& stageString, const std::string& eventString,
             const std::string& dependString);
 
 	    // Functions for device counters
-	    void writeDeviceCounters(xclPerfMonType type, xclCounterResults& results,
+	    virtual void writeDeviceCounters(xclPerfMonType type, xclCounterResults& results,
 		      double timestamp, uint32_t sampleNum, bool firstReadAfterProgram);
 
 	    // Functions for device trace
-	    void writeDeviceTrace(const RTProfileDevice::TraceResultVector &resultVector,
+	    virtual void writeDeviceTrace(const RTProfileDevice::TraceResultVector &resultVector,
 	        std::string deviceName, std::string binaryName);
 
 	    // Function for profile rule checks
@@ -149,6 +149,10 @@ namespace XCL {
 		    writeTableCells(ofs, args...);
 		}
 
+	    // Write p50, p90, p99 and p99.9 cells, N/A when nothing was timed
+	    void writePercentileCells(std::ofstream& ofs, const LatencyHistogram& latency,
+	        bool valid = true);
+
 	protected:
 	    void openStream(std::ofstream& ofs, const std::string& fileName);
 	    std::ofstream& getSummaryStream() {return Summary_ofs;}
@@ -303,6 +307,64 @@ namespace XCL {
       const std::string FileExtension = ".html";
     };
 
+    //
+    // Trace Event Writer
+    //
+    // Streams the timeline trace as Chrome trace events (JSON array format,
+    // viewable in chrome://tracing or Perfetto) while the application runs.
+    // Events go straight to the file and the stream is flushed every
+    // FlushInterval events, so memory use does not grow with the trace.
+    // The array format does not require the closing bracket, so the file
+    // stays readable if the application is killed. No summary is written.
+    //
+    class TraceEventWriter: public WriterI {
+
+	public:
+      TraceEventWriter(const std::string& timelineFileName);
+	    ~TraceEventWriter();
+
+	    void writeSummary(RTProfile* profile) override {}
+
+	    void writeTimeline(double time, const std::string& functionName,
+	        const std::string& eventName) override;
+	    void writeTimeline(double traceTime, const std::string& commandString,
+            const std::string& stageString, const std::string& eventString,
+            const std::string& dependString, uint64_t objId, size_t size) override;
+	    void writeTimeline(double traceTime, const std::string& commandString,
+            const std::string& stageString, const std::string& eventString,
+            const std::string& dependString, size_t size, uint64_t address,
+            const std::string& bank, std::thread::id threadId) override;
+	    void writeTimeline(double traceTime, const std::string& commandString,
+            const std::string& stageString, const std::string& eventString,
+            const std::string& dependString) override;
+	    // Counter samples are only reported in the CSV timeline
+	    void writeDeviceCounters(xclPerfMonType type, xclCounterResults& results,
+		      double timestamp, uint32_t sampleNum, bool firstReadAfterProgram) override {}
+	    void writeDeviceTrace(const RTProfileDevice::TraceResultVector &resultVector,
+	        std::string deviceName, std::string binaryName) override;
+
+	protected:
+	    void writeTableHeader(std::ofstream& ofs, const std::string& caption,
+	        const std::vector<std::string>& columnLabels) override {}
+
+	private:
+	    // Write one event; phase is the trace event "ph" field, times in msec
+	    void writeEvent(const char* phase, double traceTime, const std::string& name,
+	        const char* category, int pid, uint64_t tid, const std::string& id = "",
+	        double duration = 0.0, const std::string& args = "");
+	    // Small integer track for a string key such as a queue or device
+	    uint64_t getTrack(const std::string& key);
+	    static std::string escape(const std::string& str);
+
+	private:
+	    static const unsigned int FlushInterval = 4096;
+	    std::string TimelineFileName;
+	    std::map<std::string, uint64_t> Tracks;
+	    unsigned int NumEvents = 0;
+	    bool FirstEvent = true;
+	    const std::string FileExtension = ".json";
+    };
+
 };
 #endif
 
@@ -25,9 +25,15 @@
 #include "xocl/core/context.h"
 #include "xocl/core/program.h"
 #include "xocl/core/execution_context.h"
+#include "xrt/util/message.h"
+#include "xrt/util/config_reader.h"
+#include "xrt/util/task.h"
 
 #include <chrono>
 #include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 
 namespace xdp { namespace profile {
 
@@ -155,6 +161,13 @@ void get_cu_done(const xrt::command* cmd, const xocl::execution_context* ctx)
                           workGroupSize, localWorkDim, cuName);
 }
 
+namespace device {
+
+data*
+get_data(key k);
+
+}
+
 ////////////////////////////////////////////////////////////////
 // Platform
 ////////////////////////////////////////////////////////////////
@@ -353,6 +366,19 @@ log_device_trace(key k, xclPerfMonType type, bool forceRead)
   return ret;
 }
 
+uint32_t
+get_device_trace_samples(key k, xclPerfMonType type)
+{
+  auto platform = k;
+  uint32_t samples = 0;
+  for (auto device : platform->get_device_range()) {
+    if (!device->is_active())
+      continue;
+    samples = std::max(samples, xdp::profile::device::getTraceSamples(device, type));
+  }
+  return samples;
+}
+
 cl_int 
 start_device_counters(key k, xclPerfMonType type)
 {
@@ -386,12 +412,20 @@ log_device_counters(key k, xclPerfMonType type, bool firstReadAfterProgram,
                     bool forceRead)
 {
   auto platform = k;
-  cl_int ret = CL_SUCCESS;
+  std::atomic<cl_int> ret {CL_SUCCESS};
   if (isValidPerfMonTypeCounters(k,type)) {
+    // Read the devices concurrently.  Per device data is created up
+    // front since the device data map cannot grow during the reads.
+    std::vector<xocl::device*> devices;
     for (auto device : platform->get_device_range()) {
-      if (device->is_active())
-        ret |= xdp::profile::device::logCounters(device,type, firstReadAfterProgram, forceRead);
+      if (device->is_active()) {
+        xdp::profile::device::get_data(device);
+        devices.push_back(device);
+      }
     }
+    xrt::task::parallel_for(devices,[&](xocl::device* device) {
+        ret.fetch_or(xdp::profile::device::logCounters(device,type,firstReadAfterProgram,forceRead));
+      });
   }
   return ret;
 }
@@ -508,6 +542,10 @@ startTrace(key k, xclPerfMonType type, size_t numComputeUnits)
   if (stallTrace & XCL::RTProfile::STALL_TRACE_INT)    traceOption   |= (0x1 << 2);
   if (stallTrace & XCL::RTProfile::STALL_TRACE_STR)    traceOption   |= (0x1 << 3);
   if (stallTrace & XCL::RTProfile::STALL_TRACE_EXT)    traceOption   |= (0x1 << 4);
+  // Sum stalls over windows from the counters instead of tracing transitions
+  data->mStallWindowUsec = (stallTrace != XCL::RTProfile::STALL_TRACE_OFF)
+                         ? xrt::config::get_stall_trace_window() * 1000 : 0;
+  if (data->mStallWindowUsec)                          traceOption   |= (0x1 << 6);
   XOCL_DEBUGF("Starting trace with option = 0x%x\n", traceOption);
   xdevice->startTrace(type, traceOption);
 
@@ -521,8 +559,8 @@ startTrace(key k, xclPerfMonType type, size_t numComputeUnits)
   // Get the trace samples threshold
   data->mSamplesThreshold = profileMgr->getTraceSamplesThreshold();
 
-  // Calculate interval for clock training
-  data->mTrainingIntervalUsec = (uint32_t)(pow(2, 17) / deviceClockMHz);
+  // Keep training while tracing so device timestamps follow host clock drift
+  data->mTrainingIntervalUsec = xrt::config::get_trace_clock_training_interval() * 1000;
 
   return CL_SUCCESS;
 }
@@ -595,24 +633,36 @@ logTrace(key k, xclPerfMonType type, bool forceRead)
   // NOTE: once we start flushing FIFOs, we stop all training (no longer needed)
   std::chrono::steady_clock::time_point nowTime = std::chrono::steady_clock::now();
 
-  if (!data->mPerformingFlush &&
+  if (!data->mPerformingFlush && data->mTrainingIntervalUsec &&
       (nowTime - data->mLastTraceTrainingTime[type]) > std::chrono::microseconds(data->mTrainingIntervalUsec)) {
     xdevice->clockTraining(type);
     data->mLastTraceTrainingTime[type] = nowTime;
   }
 
+  // Close the stall window if it has passed, the final window is closed
+  // by the flush
+  if (data->mStallWindowUsec && type == XCL_PERF_MON_MEMORY && !data->mPerformingFlush &&
+      (forceRead || (nowTime - data->mLastStallWindowTime) > std::chrono::microseconds(data->mStallWindowUsec))) {
+    xdevice->readCounters(type, data->mStallCounterResults);
+    std::string binary_name = device->is_active() ? device->get_xclbin().project_name() : "binary";
+    XCL::RTSingleton::Instance()->getProfileManager()->logDeviceStallWindow(device->get_unique_name(),
+        binary_name, data->mStallCounterResults, xrt::time_ns());
+    data->mLastStallWindowTime = nowTime;
+  }
+
   // Read and log when trace FIFOs are filled beyond specified threshold
   uint32_t numSamples = 0;
   if (!forceRead) {
     numSamples = xdevice->countTrace(type).get();
   }
 
-  // Control how often we do clock training: if there are new samples, then don't train
-  if (numSamples > data->mLastTraceNumSamples[type]) {
-    data->mLastTraceTrainingTime[type] = nowTime;
-  }
   data->mLastTraceNumSamples[type] = numSamples;
 
+  uint32_t fifoDepth = (type == XCL_PERF_MON_ACCEL) ? XPAR_AXI_PERF_MON_2_TRACE_NUMBER_SAMPLES
+                                                    : XPAR_AXI_PERF_MON_0_TRACE_NUMBER_SAMPLES;
+  if (numSamples >= fifoDepth)
+    ++data->mTraceFifoFullCount[type];
+
   if (forceRead || (numSamples > data->mSamplesThreshold)) {
     // Create unique name for device since system can have multiples of same device
     std::string device_name = device->get_unique_name();
@@ -638,11 +688,25 @@ logTrace(key k, xclPerfMonType type, bool forceRead)
     }
   }
 
+  if (forceRead && data->mTraceFifoFullCount[type]) {
+    std::string msg = "Trace FIFO on " + device->get_unique_name() + " was found full "
+        + std::to_string(data->mTraceFifoFullCount[type])
+        + " time(s), some device trace samples may have been dropped.";
+    xrt::message::send(xrt::message::severity_level::WARNING, msg);
+    data->mTraceFifoFullCount[type] = 0;
+  }
+
   if (forceRead)
     data->mPerformingFlush = true;
   return CL_SUCCESS;
 }
 
+uint32_t
+getTraceSamples(key k, xclPerfMonType type)
+{
+  return get_data(k)->mLastTraceNumSamples[type];
+}
+
 cl_int 
 logCounters(key k, xclPerfMonType type, bool firstReadAfterProgram, bool forceRead)
 {
@@ -667,8 +731,13 @@ logCounters(key k, xclPerfMonType type, bool firstReadAfterProgram, bool forceRe
     std::string device_name = device->get_unique_name();
     std::string binary_name = device->get_xclbin().project_name();
 
-    XCL::RTSingleton::Instance()->getProfileManager()->logDeviceCounters(device_name, binary_name, type, data->mCounterResults,
-                                                                         timeNsec, firstReadAfterProgram);
+    {
+      // counters can be read from several devices concurrently
+      static std::mutex log_mutex;
+      std::lock_guard<std::mutex> lk(log_mutex);
+      XCL::RTSingleton::Instance()->getProfileManager()->logDeviceCounters(device_name, binary_name, type, data->mCounterResults,
+                                                                           timeNsec, firstReadAfterProgram);
+    }
 
     //update the last time sample
     data->mLastCountersSampleTime = nowTime;
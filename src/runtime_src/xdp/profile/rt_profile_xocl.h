@@ -100,6 +100,10 @@ stop_device_trace(key k, xclPerfMonType type);
 cl_int 
 log_device_trace(key k, xclPerfMonType type, bool forceRead);
 
+// Largest trace FIFO fill seen by the last read of any active device
+uint32_t
+get_device_trace_samples(key k, xclPerfMonType type);
+
 cl_int 
 start_device_counters(key k, xclPerfMonType type);
 
@@ -139,9 +143,15 @@ struct data
   uint32_t mSamplesThreshold = 0;
   uint32_t mSampleIntervalMsec = 0;
   uint32_t mTrainingIntervalUsec = 0;
+  // Stall trace aggregation window, 0 when stall transitions are traced
+  uint32_t mStallWindowUsec = 0;
+  xclCounterResults mStallCounterResults;
   uint32_t mLastTraceNumSamples[XCL_PERF_MON_TOTAL_PROFILE] = {0};
+  // Reads that found the trace FIFO full, samples may have been dropped
+  uint32_t mTraceFifoFullCount[XCL_PERF_MON_TOTAL_PROFILE] = {0};
   std::chrono::steady_clock::time_point mLastCountersSampleTime;
   std::chrono::steady_clock::time_point mLastTraceTrainingTime[XCL_PERF_MON_TOTAL_PROFILE];
+  std::chrono::steady_clock::time_point mLastStallWindowTime;
 };
 
 void
@@ -183,6 +193,9 @@ stopCounters(key k, xclPerfMonType type);
 cl_int 
 logTrace(key k, xclPerfMonType type, bool forceRead);
 
+uint32_t
+getTraceSamples(key k, xclPerfMonType type);
+
 cl_int 
 logCounters(key k, xclPerfMonType type, bool firstReadAfterProgram, bool forceRead);
 
@@ -21,6 +21,7 @@
 #include "xocl/core/platform.h"
 #include "xocl/core/execution_context.h"
 #include "xrt/util/config_reader.h"
+#include "xrt/util/task.h"
 
 #include "xdp/profile/profile.h"
 #include "xdp/profile/rt_profile.h"
@@ -85,6 +86,7 @@ namespace XCL {
 
   RTSingleton::~RTSingleton() {
     gActive = false;
+    xrt::task::register_queue_trace(nullptr);
 
     endProfiling();
 
@@ -148,6 +150,14 @@ namespace XCL {
       timelineFile2 = "sdx_timeline_trace";
     }
 
+    // Streamed trace events replace the CSV timeline
+    if (!timelineFile.empty() && xrt::config::get_timeline_trace_format() == "json") {
+      TraceEventWriter* traceWriter = new TraceEventWriter(timelineFile);
+      Writers.push_back(traceWriter);
+      ProfileMgr->attach(traceWriter);
+      timelineFile = "";
+    }
+
     // HTML and CSV writers
     //HTMLWriter* htmlWriter = new HTMLWriter(profileFile, timelineFile, "Xilinx");
     CSVWriter* csvWriter = new CSVWriter(profileFile, timelineFile, "Xilinx");
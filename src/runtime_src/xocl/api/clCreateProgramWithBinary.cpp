@@ -30,8 +30,11 @@
 #include "detail/context.h"
 #include "detail/device.h"
 
+#include "xrt/util/task.h"
+
 #include <exception>
 #include <string>
+#include <vector>
 #include <algorithm>
 
 #include "plugin/xdp/profile.h"
@@ -126,18 +129,22 @@ clCreateProgramWithBinary(cl_context                      context ,
   // Construct program object
   auto program = xrt::make_unique<xocl::program>(xocl::xocl(context),num_devices,device_list,binaries,lengths);
 
-  // Assign binaries to all devices in the list
-  size_t idx = 0;
-  for (auto device : xocl::get_range(device_list,device_list+num_devices)) {
-    try {
+  // Assign binaries to all devices in the list.  Multiple devices
+  // are programmed concurrently, each download takes seconds.  All
+  // devices are waited for before the first error is rethrown.
+  auto devices = xocl::get_range(device_list,device_list+num_devices);
+  auto errors = xrt::task::fork_join(devices,[&program](cl_device_id device) {
       loadProgramBinary(program.get(),xocl(device));
-      xocl::assign(&binary_status[idx++],CL_SUCCESS);
-    }
-    catch (const xocl::error& ex) {
-      xocl::assign(&binary_status[idx],CL_INVALID_BINARY);
-      throw;
-    }
+    });
+
+  std::exception_ptr eptr;
+  for (size_t idx=0; idx<errors.size(); ++idx) {
+    xocl::assign(&binary_status[idx],errors[idx] ? CL_INVALID_BINARY : CL_SUCCESS);
+    if (errors[idx] && !eptr)
+      eptr = errors[idx];
   }
+  if (eptr)
+    std::rethrow_exception(eptr);
 
   xocl::profile::start_device_profiling(1);
   // NOTE: We read from the counters to set a baseline for values and
@@ -129,7 +129,7 @@ validOrError(cl_command_queue     command_queue ,
              const cl_event *     event_wait_list ,
              cl_event *           event_parameter)
 {
-  if (!config::api_checks())
+  if (!config::api_checks(command_queue))
     return;
 
   setIfZero(src_row_pitch,src_slice_pitch,dst_row_pitch,dst_slice_pitch,region);
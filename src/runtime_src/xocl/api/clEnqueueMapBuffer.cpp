@@ -38,7 +38,7 @@ validOrError(cl_command_queue command_queue,
              cl_uint          num_events_in_wait_list,
              const cl_event * event_wait_list)
 {
-  if(!config::api_checks())
+  if(!config::api_checks(command_queue))
     return;
 
   detail::command_queue::validOrError(command_queue); 
@@ -34,7 +34,7 @@ static void
 validOrError(cl_command_queue command_queue,
              cl_event*        event_parameter)
 {
-  if (!config::api_checks())
+  if (!config::api_checks(command_queue))
     return;
 
   detail::command_queue::validOrError(command_queue);
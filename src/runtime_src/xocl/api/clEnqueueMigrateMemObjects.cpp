@@ -37,7 +37,7 @@ validOrError(cl_command_queue        command_queue ,
              const cl_event *        event_wait_list ,
              cl_event *              event_parameter )
 {
-  if (!config::api_checks())
+  if (!config::api_checks(command_queue))
     return;
 
   // CL_INVALID_COMMAND_QUEUE if command_queue is not a valid host
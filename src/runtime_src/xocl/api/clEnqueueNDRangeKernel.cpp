@@ -101,6 +101,24 @@ getDeviceMaxWorkItemSizes(cl_device_id device)
   return sizes;
 }
 
+// Buffer arguments the kernel argument migration may transfer to device,
+// see action_ndrange_migrate
+static std::vector<const xocl::memory*>
+get_migrating_arguments(cl_kernel kernel, const xocl::device* device)
+{
+  std::vector<const xocl::memory*> mems;
+  for (auto& arg : xocl::xocl(kernel)->get_argument_range()) {
+    auto mem = arg->get_memory_object();
+    if (!mem || arg->is_progvar())
+      continue;
+    if (mem->get_flags() & (CL_MEM_WRITE_ONLY|CL_MEM_HOST_NO_ACCESS))
+      continue;
+    if (!mem->is_resident(device))
+      mems.push_back(mem);
+  }
+  return mems;
+}
+
 }
 
 namespace xocl {
@@ -116,7 +134,7 @@ validOrError(cl_command_queue command_queue,
              const cl_event * event_wait_list,
              cl_event *       event_parameter)
 {
-  if (!config::api_checks())
+  if (!config::api_checks(command_queue))
     return;
 
   // CL_INVALID_COMMAND_QUEUE if command_queue is not a valid host
@@ -318,7 +336,7 @@ clEnqueueNDRangeKernel(cl_command_queue command_queue,
   // err_checking: this code is highly fragile and it was suggested that we make minimal changes to this section.
   // We are not really able to disable error checks completely because the error checks are heavily intertwined
   // with the functionality in this section. Here is a good trade-off.
-  if(xocl::config::api_checks()) {
+  if(xocl::config::api_checks(command_queue)) {
     //XCL_CONFORMANCECOLLECT mode
     //write out the kernel sources in clCreateKernel and fail quickly in clEnqueueNDRange
     //skip build in clBuildProgram
@@ -394,7 +412,7 @@ clEnqueueNDRangeKernel(cl_command_queue command_queue,
   assert(local_work_size_3D[0] && local_work_size_3D[1] && local_work_size_3D[2]);
 
   // More api checks after computing sizes above
-  if (config::api_checks()) {
+  if (config::api_checks(command_queue)) {
 
     //opencl1.2-rev11.pdf P168
     //CL_INVALID_WORK_GROUP_SIZE if local_work_size is specified and the total number
@@ -449,9 +467,24 @@ clEnqueueNDRangeKernel(cl_command_queue command_queue,
     new_wait_list_size = printf_wait_list.size();
   }
 
+  // On an in-order queue the migration of kernel arguments waits only
+  // for queued commands that may use them, so that it overlaps with
+  // earlier kernels.  The kernel event still follows queue order.
+  std::vector<xocl::ptr<xocl::event>> ahead_deps;
+  bool ahead = xrt::config::get_ndrange_migrate_ahead()
+    && !xocl::xocl(command_queue)->get_properties().test(CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE);
+  if (ahead)
+    ahead_deps = xocl::xocl(command_queue)->get_migration_dependencies
+      (get_migrating_arguments(kernel,xocl::xocl(command_queue)->get_device()));
+  std::vector<cl_event> migrate_wait_list(new_wait_list,new_wait_list+new_wait_list_size);
+  for (auto& ev : ahead_deps)
+    migrate_wait_list.push_back(ev.get());
+
   // Event for kernel arg migration (todo: experiment with multiple events, one pr arg)
-  auto umEvent = xocl::create_hard_event(command_queue,CL_COMMAND_MIGRATE_MEM_OBJECTS,new_wait_list_size,new_wait_list);
+  auto umEvent = xocl::create_hard_event(command_queue,CL_COMMAND_MIGRATE_MEM_OBJECTS,migrate_wait_list.size(),migrate_wait_list.data());
   cl_event mEvent = umEvent.get();
+  if (ahead)
+    umEvent->set_queue_ahead();
 
   if (printf_init_event)
     // The printf_init_event has been added to the event waitlist
@@ -543,7 +576,7 @@ void CL_CALLBACK cb_BufferReturned(cl_event event, cl_int status, void *data)
   CallbackArgs *args = reinterpret_cast<CallbackArgs*>(data);
   cl_kernel kernel = args->kernel.get();
   XCL::Printf::PrintfManager printfManager;
-  printfManager.enqueueBuffer(kernel, args->buf);
+  printfManager.enqueueBuffer(kernel, std::move(args->buf));
   delete args;
   if ( XCL::Printf::isPrintfDebugMode() ) {
     std::cout << "clEnqueueNDRangeKernel - printf buffer returned callback\n";
@@ -27,7 +27,7 @@ namespace xocl {
 static void
 validOrError(const cl_command_queue command_queue)
 {
-  if(!config::api_checks())
+  if(!config::api_checks(command_queue))
     return;
   detail::command_queue::validOrError(command_queue); 
 }
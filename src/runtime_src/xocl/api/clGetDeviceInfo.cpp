@@ -228,6 +228,7 @@ clGetDeviceInfo(cl_device_id   device,
        CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE 
        | CL_QUEUE_PROFILING_ENABLE
        | CL_QUEUE_DPDK
+       | CL_QUEUE_WAIT_SPIN_XILINX
      );
     break;
   case CL_DEVICE_BUILT_IN_KERNELS:
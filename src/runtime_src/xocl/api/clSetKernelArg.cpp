@@ -32,7 +32,7 @@ validOrError(cl_kernel    kernel,
              size_t       arg_size,
              const void * arg_value)
 {
-  if (!config::api_checks())
+  if (!config::api_checks(kernel))
     return;
 
   // CL_INVALID_KERNEL if kernel is not a valid kernel object.
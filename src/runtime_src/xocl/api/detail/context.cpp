@@ -17,6 +17,9 @@
 #include "context.h"
 #include "command_queue.h"
 #include "xocl/core/context.h"
+#include "xocl/core/command_queue.h"
+#include "xocl/core/kernel.h"
+#include "xocl/core/program.h"
 #include "xocl/core/memory.h"
 #include "xocl/core/error.h"
 #include "xocl/core/property.h"
@@ -51,6 +54,8 @@ validOrError(const cl_context_properties* properties)
       ;
     else if (key==CL_CONTEXT_INTEROP_USER_SYNC)
       ;
+    else if (key==CL_CONTEXT_API_CHECKS_XILINX)
+      ;
     else
       throw error(CL_INVALID_PROPERTY,"bad context property '" + std::to_string(key) + "'");
   }
@@ -58,6 +63,30 @@ validOrError(const cl_context_properties* properties)
 
 } // context
 
-}} // detail,xocl
+} // detail
+
+namespace config {
+
+bool
+api_checks(cl_context context)
+{
+  return api_checks() && (!context || xocl(context)->get_api_checks());
+}
+
+bool
+api_checks(cl_command_queue command_queue)
+{
+  return api_checks() && (!command_queue || api_checks(xocl(command_queue)->get_context()));
+}
+
+bool
+api_checks(cl_kernel kernel)
+{
+  return api_checks() && (!kernel || api_checks(xocl(kernel)->get_program()->get_context()));
+}
+
+} // config
+
+} // xocl
 
 
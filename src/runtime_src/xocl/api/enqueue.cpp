@@ -33,6 +33,9 @@
 
 namespace {
 
+static void
+handle_device_exception(xocl::event* event, const std::exception& ex);
+
 // Command based enqueue needs to manage event state
 struct enqueue_command : xrt::command
 {
@@ -48,6 +51,10 @@ struct enqueue_command : xrt::command
   {
     m_ev->set_status(CL_COMPLETE);
   }
+  virtual void error(const std::exception& ex) const
+  {
+    handle_device_exception(m_ev,ex);
+  }
 };
 
 // Exception pointer for device exceptions during enqueue tasks.  The
@@ -215,6 +222,38 @@ write_buffer(xocl::event* event,xocl::device* device
   }
 }
 
+using transfer_vector = std::vector<cl_buffer_transfer_xilinx>;
+
+static void
+read_buffers(xocl::event* event,xocl::device* device
+             ,std::shared_ptr<transfer_vector> transfers)
+{
+  try {
+    event->set_status(CL_RUNNING);
+    for (auto& t : *transfers)
+      device->read_buffer(xocl::xocl(t.buffer),t.offset,t.size,t.ptr);
+    event->set_status(CL_COMPLETE);
+  }
+  catch (const std::exception& ex) {
+    handle_device_exception(event,ex);
+  }
+}
+
+static void
+write_buffers(xocl::event* event,xocl::device* device
+              ,std::shared_ptr<transfer_vector> transfers)
+{
+  try {
+    event->set_status(CL_RUNNING);
+    for (auto& t : *transfers)
+      device->write_buffer(xocl::xocl(t.buffer),t.offset,t.size,t.ptr);
+    event->set_status(CL_COMPLETE);
+  }
+  catch (const std::exception& ex) {
+    handle_device_exception(event,ex);
+  }
+}
+
 static void
 unmap_buffer(xocl::event* event,xocl::device* device
              ,cl_mem buffer, void* mapped_ptr)
@@ -261,6 +300,20 @@ migrate_buffer(shared_event_completer sec,xocl::device* device
   }
 }
 
+// Kernel argument migration, skipped for arguments made resident by a
+// prefetch that completed or was in progress when the launch was enqueued
+static void
+make_resident(shared_event_completer sec,xocl::device* device,xocl::memory* buffer)
+{
+  try {
+    sec->set_status(CL_RUNNING);
+    device->make_resident(buffer);
+  }
+  catch (const std::exception& ex) {
+    handle_device_exception(sec.get(),ex);
+  }
+}
+
 static void
 read_image(xocl::event* event,xocl::device* device,cl_mem image,
 	const size_t* origin,const size_t* region, size_t row_pitch,size_t slice_pitch,
@@ -351,6 +404,9 @@ action_ndrange_migrate(cl_event event,cl_kernel kernel)
       else {
         mem->get_buffer_object(device);
         kernel_args.push_back(mem);
+        // the kernel may write the argument
+        if (!(mem->get_flags() & CL_MEM_READ_ONLY))
+          mem->invalidate_host();
       }
     }
   }
@@ -372,7 +428,7 @@ action_ndrange_migrate(cl_event event,cl_kernel kernel)
 
       // only migrate if not already resident on device
       if (!mem->is_resident(device)) {
-        xdevice->schedule(migrate_buffer,async_type::write,ec,device,mem,0);
+        xdevice->schedule(make_resident,async_type::write,ec,device,mem);
       }
     }
   };
@@ -455,6 +511,36 @@ action_write_buffer(cl_mem buffer,size_t offset, size_t size, const void* ptr)
   };
 }
 
+// All transfers of a batch are one task on the device, the caller's
+// array is copied since it may be reused once the enqueue returns
+xocl::event::action_enqueue_type
+action_read_buffers(cl_uint num,const cl_buffer_transfer_xilinx* transfers)
+{
+  throw_if_error();
+  auto tv = std::make_shared<transfer_vector>(transfers,transfers+num);
+  return [tv](xocl::event* ev) {
+    XOCL_DEBUG(std::cout,"launching read buffers DMA event(",ev->get_uid(),")\n");
+    auto command_queue = ev->get_command_queue();
+    auto device = command_queue->get_device();
+    auto xdevice = device->get_xrt_device();
+    xdevice->schedule(read_buffers,async_type::read,ev,device,tv);
+  };
+}
+
+xocl::event::action_enqueue_type
+action_write_buffers(cl_uint num,const cl_buffer_transfer_xilinx* transfers)
+{
+  throw_if_error();
+  auto tv = std::make_shared<transfer_vector>(transfers,transfers+num);
+  return [tv](xocl::event* ev) {
+    XOCL_DEBUG(std::cout,"launching write buffers DMA event(",ev->get_uid(),")\n");
+    auto command_queue = ev->get_command_queue();
+    auto device = command_queue->get_device();
+    auto xdevice = device->get_xrt_device();
+    xdevice->schedule(write_buffers,async_type::write,ev,device,tv);
+  };
+}
+
 xocl::event::action_enqueue_type
 action_unmap_buffer(cl_mem memobj,void* mapped_ptr)
 {
@@ -56,6 +56,12 @@ action_map_svm_buffer(cl_event event,cl_map_flags map_flags,void* svm_ptr,size_t
 xocl::event::action_enqueue_type
 action_write_buffer(cl_mem buffer,size_t offset, size_t size, const void* ptr);
 
+xocl::event::action_enqueue_type
+action_read_buffers(cl_uint num,const cl_buffer_transfer_xilinx* transfers);
+
+xocl::event::action_enqueue_type
+action_write_buffers(cl_uint num,const cl_buffer_transfer_xilinx* transfers);
+
 xocl::event::action_enqueue_type
 action_unmap_buffer(cl_mem memobj,void* mapped_ptr);
 
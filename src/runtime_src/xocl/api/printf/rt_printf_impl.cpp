@@ -25,6 +25,8 @@
 #include <stdexcept>
 #include <iomanip>
 #include <algorithm>
+#include <future>
+#include <thread>
 
 #ifdef _WINDOWS
 #define snprintf _snprintf
@@ -34,6 +36,10 @@
 /////////////////////////////////////////////////////////////////////////
 
 namespace {
+  // Work item segments per concurrent formatting task, smaller buffers
+  // are printed by the calling thread
+  const int min_segments_per_worker = 256;
+
   // Restores ostream flags to original when function goes out of scope
   struct IOS_FlagRestore
   {
@@ -671,26 +677,29 @@ void FormatString::dbgDump(std::ostream& str) const
 /////////////////////////////////////////////////////////////////////////
 
 BufferPrintf::BufferPrintf()
-  : m_currentOffset(0)
 {
 }
 
 BufferPrintf::BufferPrintf(const MemBuffer& buf, const StringTable& table)
-  : m_currentOffset(0)
 {
   setBuffer(buf);
   setStringTable(table);
 }
 
+BufferPrintf::BufferPrintf(MemBuffer&& buf, const StringTable& table)
+{
+  setBuffer(std::move(buf));
+  setStringTable(table);
+}
+
 BufferPrintf::~BufferPrintf()
 {
-  m_currentOffset = 0;
   m_buf.clear();
   m_stringTable.clear();
+  m_formats.clear();
 }
         
 BufferPrintf::BufferPrintf(const uint8_t* buf, size_t bufLen, const StringTable& table)
-  : m_currentOffset(0)
 {
   setBuffer(buf, bufLen);
   setStringTable(table);
@@ -713,42 +722,74 @@ void BufferPrintf::setBuffer(const MemBuffer& buf)
   std::copy(buf.begin(), buf.end(), m_buf.begin());
 }
 
+void BufferPrintf::setBuffer(MemBuffer&& buf)
+{
+  // Currently bufLen must be 64-bit aligned
+  if ( (buf.size() % 8) != 0 ) {
+    throwError("setBuffer - bufLen is not a multiple of 8 bytes");
+  }
+  m_buf = std::move(buf);
+}
+
 void BufferPrintf::setStringTable(const StringTable& table) 
 {
   m_stringTable = table;
+  m_formats.clear();
+  for ( auto& entry : m_stringTable ) {
+    m_formats.emplace(entry.first, FormatString(entry.second));
+  }
 }
 
 void BufferPrintf::print(std::ostream& os)
 {
-  moveToFirstRecord();
-  while ( hasNextRecord() ) {
-    std::string formatStr = getFormat();
-    FormatString format(formatStr);
-    if ( format.isValid() ) {
-      std::vector<XCL::Printf::ConversionSpec> conversionVec;
-      format.getSpecifiers(conversionVec);
-      std::vector<PrintfArg> argVec;
-      int argOffset = getFormatByteCount();
-      for ( auto conversion : conversionVec ) {
-        PrintfArg arg = buildArg(m_currentOffset + argOffset, conversion);
-        argVec.push_back(arg);
-        argOffset += getElementByteCount(conversion) * conversion.m_vectorSize;
-        // HACK: Special handling for vec3 packed strangely from compiler
-        //    float3 += 32 bits
-        //    others += 64 bits
-        if ( conversion.isVector() && conversion.m_vectorSize == 3) {
-          if ( conversion.isFloatClass() ) {
-            argOffset += 4;
-          }
-          else {
-            argOffset += 8;
-          }
-        }
-      }
-      std::string result = string_printf(formatStr, argVec);
-      os << result;
+  int bufSize = m_buf.size();
+  int segmentSize = getWorkItemPrintfBufferSize();
+  int segments = (bufSize + segmentSize - 1) / segmentSize;
+  int workers = std::min(static_cast<int>(std::thread::hardware_concurrency()),
+                         segments / min_segments_per_worker);
+  if ( workers <= 1 ) {
+    printRecords(os, 0, bufSize);
+    return;
+  }
+
+  // Records never cross a work item segment, so chunks aligned to
+  // segments can be formatted independently
+  int chunkSize = ((segments + workers - 1) / workers) * segmentSize;
+  std::vector<std::future<std::string>> chunks;
+  for ( int begin = 0; begin < bufSize; begin += chunkSize ) {
+    int end = std::min(begin + chunkSize, bufSize);
+    chunks.push_back(std::async(std::launch::async, [this, begin, end] {
+      std::ostringstream oss;
+      printRecords(oss, begin, end);
+      return oss.str();
+    }));
+  }
+  for ( auto& chunk : chunks ) {
+    os << chunk.get();
+  }
+}
+
+void BufferPrintf::printRecords(std::ostream& os, int begin, int end) const
+{
+  int offset = nextRecordOffset(begin);
+  while ( offset != -1 && offset < end ) {
+    uint32_t id = (uint32_t)extractField(offset, getFormatByteCount());
+    const FormatString& format = getFormatString(id);
+    if ( !format.isValid() ) {
+      std::string msg = "printRecords - Invalid format: ";
+      std::string formatStr;
+      lookup(id, formatStr);
+      msg += formatStr;
+      throwError(msg);
+    }
+    std::vector<PrintfArg> argVec;
+    offset += getFormatByteCount();
+    for ( auto& conversion : format.specifiers() ) {
+      argVec.push_back(buildArg(offset, conversion));
+      offset += getArgByteCount(conversion);
     }
-    nextRecord();
+    os << string_printf(format, argVec);
+    offset = nextRecordOffset(offset);
   }
 }
 
@@ -817,6 +858,24 @@ int BufferPrintf::getElementByteCount(const ConversionSpec& conversion)
   return 8;
 }
 
+/*static*/
+int BufferPrintf::getArgByteCount(const ConversionSpec& conversion)
+{
+  int retval = getElementByteCount(conversion) * conversion.m_vectorSize;
+  // HACK: Special handling for vec3 packed strangely from compiler
+  //    float3 += 32 bits
+  //    others += 64 bits
+  if ( conversion.isVector() && conversion.m_vectorSize == 3) {
+    if ( conversion.isFloatClass() ) {
+      retval += 4;
+    }
+    else {
+      retval += 8;
+    }
+  }
+  return retval;
+}
+
 int BufferPrintf::nextRecordOffset(int currentOffset) const
 {
   // Given a currentOffset, return a pointer to the next valid record
@@ -856,68 +915,15 @@ int BufferPrintf::nextRecordOffset(int currentOffset) const
   return offset;
 }
 
-bool BufferPrintf::hasNextRecord() const
-{
-  bool eof = (nextRecordOffset(m_currentOffset) == -1);
-  return ( !eof );
-}
-
-
-void BufferPrintf::moveToFirstRecord()
-{
-  if ( hasNextRecord() ) {
-    m_currentOffset = nextRecordOffset(0);
-  }
-}
-
-void BufferPrintf::nextRecord()
+const FormatString& BufferPrintf::getFormatString(uint32_t id) const
 {
-  // Assume we are pointing at a valid record and want to move to the next one
-  if (! hasNextRecord() ) {
-    throwError("nextRecord - No next record");
-  }
-
-  std::string formatStr = getFormat();
-  FormatString format(formatStr);
-  if ( !format.isValid() ) {
-    std::string msg = "nextRecord - Invalid format: ";
-    msg += formatStr;
-    throwError(msg);
-  }
-  std::vector<ConversionSpec> conversionVec;
-  format.getSpecifiers(conversionVec);
-  // skip format ID
-  m_currentOffset += getFormatByteCount();  
-  // Skip all arguments
-  for (auto conversion : conversionVec) {
-    m_currentOffset += getElementByteCount(conversion) * conversion.m_vectorSize;
-    // HACK: Special handling for vec3 packed strangely from compiler
-    //    float3 += 32 bits
-    //    others += 64 bits
-    if ( conversion.isVector() && conversion.m_vectorSize == 3) {
-      if ( conversion.isFloatClass() ) {
-        m_currentOffset += 4;
-      }
-      else {
-        m_currentOffset += 8;
-      }
-    }
+  auto found = m_formats.find(id);
+  if ( found == m_formats.end() ) {
+    std::ostringstream oss;
+    oss << "BufferPrintf lookup() - id " << id << " does not exist in the string table";
+    throwError(oss.str());
   }
-  m_currentOffset = nextRecordOffset(m_currentOffset);
-}
-
-std::string BufferPrintf::getFormat() const
-{
-  uint32_t id = getFormatID();
-  std::string retval;
-  lookup(id, retval);
-  return retval;
-}
-
-uint32_t BufferPrintf::getFormatID() const
-{
-  uint32_t id = (uint32_t)extractField(m_currentOffset, getFormatByteCount());
-  return id;
+  return found->second;
 }
 
 void BufferPrintf::lookup(int id, std::string& retval) const
@@ -943,7 +949,7 @@ uint64_t BufferPrintf::extractField(int idx, int byteCount) const
   return val;
 }
 
-PrintfArg BufferPrintf::buildArg(int bufIdx, ConversionSpec& conversion) const
+PrintfArg BufferPrintf::buildArg(int bufIdx, const ConversionSpec& conversion) const
 {
   int elementBytes = getElementByteCount(conversion);
   if ( conversion.isIntClass() ) {
@@ -1003,7 +1009,7 @@ PrintfArg BufferPrintf::buildArg(int bufIdx, ConversionSpec& conversion) const
 
 /////////////////////////////////////////////////////////////////////////
 
-std::string convertArg(PrintfArg& arg, ConversionSpec& conversion)
+std::string convertArg(PrintfArg& arg, const ConversionSpec& conversion)
 {
   std::string retval = "";
   char formatStr[32];
@@ -1122,8 +1128,6 @@ std::string convertArg(PrintfArg& arg, ConversionSpec& conversion)
 
 std::string string_printf(const std::string& formatStr, std::vector<PrintfArg> args)
 {
-  std::vector<ConversionSpec> specVec;
-  std::vector<std::string> splitVec;
   FormatString formatString(formatStr);
   if ( formatString.isValid() == false ) {
     std::ostringstream oss;
@@ -1131,8 +1135,13 @@ std::string string_printf(const std::string& formatStr, std::vector<PrintfArg> a
     throwError(oss.str());
     return "";
   }
-  formatString.getSplitFormatString(splitVec);
-  formatString.getSpecifiers(specVec);
+  return string_printf(formatString, args);
+}
+
+std::string string_printf(const FormatString& formatString, std::vector<PrintfArg>& args)
+{
+  const std::vector<ConversionSpec>& specVec = formatString.specifiers();
+  const std::vector<std::string>& splitVec = formatString.splitFormatString();
    
   if ( args.size() != specVec.size() ) {
     std::ostringstream oss;
@@ -1147,7 +1156,7 @@ std::string string_printf(const std::string& formatStr, std::vector<PrintfArg> a
   }
   for ( size_t idx = 1; idx < splitVec.size(); ++idx ) {
     PrintfArg& arg = args[idx-1];
-    ConversionSpec& conversion = specVec[idx-1];
+    const ConversionSpec& conversion = specVec[idx-1];
     oss << convertArg(arg, conversion);
     oss << splitVec[idx];
   }
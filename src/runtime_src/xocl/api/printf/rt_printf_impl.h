@@ -143,6 +143,10 @@ public:
    //    splitStr.size() == specVec.size() + 1
    void getSplitFormatString(std::vector<std::string>& splitStr) const;
 
+   // Same as above without copying, valid for the lifetime of this object
+   const std::vector<ConversionSpec>& specifiers() const { return m_specVec; }
+   const std::vector<std::string>& splitFormatString() const { return m_splitFormatString; }
+
    bool isValid() const { return m_valid; }
    void dbgDump(std::ostream& str = std::cout) const;
 
@@ -244,16 +248,21 @@ public:
 public:
     BufferPrintf();
     BufferPrintf(const MemBuffer& buf, const StringTable& table);
+    BufferPrintf(MemBuffer&& buf, const StringTable& table);
     BufferPrintf(const uint8_t* buf, size_t bufSize, const StringTable& table);
 
     ~BufferPrintf();
 
     void setBuffer(const uint8_t* buf, size_t bufLen);
     void setBuffer(const MemBuffer& buf);
+    void setBuffer(MemBuffer&& buf);
 
+    // Also parses every format string of the table once
     void setStringTable(const StringTable& table);
     
-    // Print buffer contents to the outputstream
+    // Print buffer contents to the outputstream. Large buffers are
+    // formatted concurrently in chunks of work item segments, output
+    // order is the same as for sequential printing.
     void print(std::ostream& os = std::cout);
 
     void dbgDump(std::ostream& os = std::cout) const;
@@ -264,30 +273,25 @@ public:
     //   8: everything else
     static int getElementByteCount(const ConversionSpec& conversion);
 
+    // Returns the bytes all elements of this conversion take in the buffer
+    static int getArgByteCount(const ConversionSpec& conversion);
+
     // Number of bytes in a format string ID
     static int getFormatByteCount() { return 8; }
 
 private:
-    // Set the current offset to the first record
-    void moveToFirstRecord();
-
-    // Returns offset of next record or -1 if no more records found
+    // Returns offset of next record or -1 if no more records found.
+    // Assumes currentOffset is either on a record start position -or-
+    // on the gap between records (because we advanced to the first byte
+    // after the last record which lies in the gap between work item
+    // segments).
     int nextRecordOffset(int currentOffset) const;
 
-    // Returns true if we have another record, false if no more exist
-    bool hasNextRecord() const;
+    // Print the records that start in [begin,end)
+    void printRecords(std::ostream& os, int begin, int end) const;
 
-    // Move m_currentOffset to the next record start. Assumes we are either
-    // on a record start position -or- we are positioned on the gap between
-    // records (because we advanced to the first byte after the last record
-    // which lies in the gap between work item segments).
-    void nextRecord();
-
-    // Extracts the Format for the current record
-    std::string getFormat() const;
-
-    // Extracts the Format_ID for the current record
-    uint32_t getFormatID() const;
+    // Find an ID in the parsed string table
+    const FormatString& getFormatString(uint32_t id) const;
 
     // Find an ID in the string table and return the string 
     void lookup(int id, std::string& retval) const;
@@ -297,7 +301,7 @@ private:
 
     // Build up a printf argument given the conversion specifier
     // and memory buffer and string table
-    PrintfArg buildArg(int bufIdx, ConversionSpec& conversion) const;
+    PrintfArg buildArg(int bufIdx, const ConversionSpec& conversion) const;
     
     // Convert escape sequences \n, \r, \t, \ to text representation
     // Newline replaced by string: "\n"
@@ -306,10 +310,9 @@ private:
     static std::string escape(const std::string& s);
 
 private:
-    // currentOffset always points at the current format string
-    int m_currentOffset;
     MemBuffer m_buf;
     StringTable m_stringTable;
+    std::map<uint32_t,FormatString> m_formats;
 };
 
 
@@ -319,13 +322,16 @@ private:
 // Perform a conversion given a single printf argument and return the string 
 // representation of the result. This is called repeatedly for each arg
 // during string_printf to build the complete output string.
-std::string convertArg(PrintfArg& arg, ConversionSpec& conversion);
+std::string convertArg(PrintfArg& arg, const ConversionSpec& conversion);
 
 // Given format string and args, create and return a string (similar to sprintf). 
 // This exercises the round trip internal printf and is used to test breaking down
 // a format and printing arguments.
 std::string string_printf(const std::string& formatStr, std::vector<PrintfArg> args);
 
+// Same as above for an already parsed format string
+std::string string_printf(const FormatString& format, std::vector<PrintfArg>& args);
+
 // Throws an exception with the given error message. Put as a utility function 
 // because I am not sure on the exception throwing and error reporting standards
 // so for now I simply throw a std::runtime_exception.
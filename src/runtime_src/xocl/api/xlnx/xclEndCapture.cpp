@@ -0,0 +1,81 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Copyright 2018 Xilinx, Inc. All rights reserved.
+
+#include <CL/opencl.h>
+#include "xocl/config.h"
+#include "xocl/core/command_queue.h"
+#include "xocl/core/event.h"
+#include "xocl/core/graph.h"
+#include "detail/command_queue.h"
+#include "plugin/xdp/profile.h"
+
+#include "xrt/util/memory.h"
+
+namespace xocl {
+
+static void
+validOrError(cl_command_queue command_queue,
+             cl_graph*        graph)
+{
+  if (!config::api_checks())
+    return;
+
+  detail::command_queue::validOrError(command_queue);
+
+  if (!graph)
+    throw error(CL_INVALID_VALUE,"graph is nullptr");
+}
+
+static cl_int
+xclEndCapture(cl_command_queue command_queue,
+              cl_graph*        graph)
+{
+  validOrError(command_queue,graph);
+
+  auto events = xocl(command_queue)->end_capture();
+
+  // A command is replayed through its enqueue action or execution
+  // context, commands completed inline by the enqueue API have neither
+  for (auto& ev : events)
+    if (!ev->get_enqueue_action() && !ev->get_execution_context())
+      throw error(CL_INVALID_OPERATION,"captured event " + ev->get_suid() + " cannot be replayed");
+
+  auto ugraph = xrt::make_unique<xocl::graph>(xocl(command_queue),std::move(events));
+  *graph = ugraph.release();
+  return CL_SUCCESS;
+}
+
+} // xocl
+
+cl_int
+xclEndCapture(cl_command_queue command_queue,
+              cl_graph*        graph)
+{
+  try {
+    PROFILE_LOG_FUNCTION_CALL_WITH_QUEUE(command_queue);
+    return xocl::xclEndCapture(command_queue,graph);
+  }
+  catch (const xrt::error& ex) {
+    xocl::send_exception_message(ex.what());
+    return ex.get_code();
+  }
+  catch (const std::exception& ex) {
+    xocl::send_exception_message(ex.what());
+    return CL_OUT_OF_HOST_MEMORY;
+  }
+}
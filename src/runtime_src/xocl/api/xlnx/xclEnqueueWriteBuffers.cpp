@@ -0,0 +1,120 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Copyright 2018 Xilinx, Inc. All rights reserved.
+
+#include <CL/opencl.h>
+#include "xocl/config.h"
+#include "xocl/core/command_queue.h"
+#include "xocl/core/memory.h"
+#include "xocl/core/event.h"
+#include "xocl/core/context.h"
+#include "detail/command_queue.h"
+#include "detail/memory.h"
+#include "detail/event.h"
+#include "detail/context.h"
+
+#include "enqueue.h"
+#include "plugin/xdp/profile.h"
+
+namespace xocl {
+
+static void
+validOrError(cl_command_queue                 command_queue,
+             cl_bool                          blocking,
+             cl_uint                          num_transfers,
+             const cl_buffer_transfer_xilinx* transfers,
+             cl_uint                          num_events_in_wait_list,
+             const cl_event*                  event_wait_list,
+             cl_event*                        event_parameter)
+{
+  if (!config::api_checks(command_queue))
+    return;
+
+  if (!num_transfers || !transfers)
+    throw error(CL_INVALID_VALUE,"no transfers");
+
+  detail::command_queue::validOrError(command_queue);
+  detail::event::validOrError(command_queue,num_events_in_wait_list,event_wait_list,blocking/*check status*/);
+
+  // Checks of clEnqueueWriteBuffer per transfer, except that register
+  // map buffers are not supported
+  std::vector<cl_mem> buffers;
+  buffers.reserve(num_transfers);
+  for (auto& t : get_range(transfers,transfers+num_transfers)) {
+    if (!t.ptr)
+      throw error(CL_INVALID_VALUE,"ptr == nullptr");
+    detail::memory::validOrError(t.buffer,t.offset,t.size);
+    auto flags = xocl(t.buffer)->get_flags();
+    if (flags & CL_MEM_REGISTER_MAP)
+      throw error(CL_INVALID_OPERATION,"CL_MEM_REGISTER_MAP buffers cannot be batched");
+    if (flags & (CL_MEM_HOST_READ_ONLY|CL_MEM_HOST_NO_ACCESS))
+      throw error(CL_INVALID_OPERATION,"buffer flags do not allow writing");
+    buffers.push_back(t.buffer);
+  }
+  detail::context::validOrError(xocl(command_queue)->get_context(),buffers);
+}
+
+static cl_int
+xclEnqueueWriteBuffers(cl_command_queue                 command_queue,
+                       cl_bool                          blocking,
+                       cl_uint                          num_transfers,
+                       const cl_buffer_transfer_xilinx* transfers,
+                       cl_uint                          num_events_in_wait_list,
+                       const cl_event*                  event_wait_list,
+                       cl_event*                        event_parameter)
+{
+  validOrError(command_queue,blocking,num_transfers,transfers,
+               num_events_in_wait_list,event_wait_list,event_parameter);
+
+  auto uevent = xocl::create_hard_event
+    (command_queue,CL_COMMAND_WRITE_BUFFER,num_events_in_wait_list,event_wait_list);
+  xocl::enqueue::set_event_action(uevent.get(),xocl::enqueue::action_write_buffers,num_transfers,transfers);
+
+  uevent->queue();
+  if (blocking)
+    uevent->wait();
+
+  xocl::assign(event_parameter,uevent.get());
+  return CL_SUCCESS;
+}
+
+} // xocl
+
+cl_int
+xclEnqueueWriteBuffers(cl_command_queue                 command_queue,
+                       cl_bool                          blocking,
+                       cl_uint                          num_transfers,
+                       const cl_buffer_transfer_xilinx* transfers,
+                       cl_uint                          num_events_in_wait_list,
+                       const cl_event*                  event_wait_list,
+                       cl_event*                        event_parameter)
+{
+  try {
+    PROFILE_LOG_FUNCTION_CALL_WITH_QUEUE(command_queue);
+    return xocl::xclEnqueueWriteBuffers
+      (command_queue,blocking,num_transfers,transfers,
+       num_events_in_wait_list,event_wait_list,event_parameter);
+  }
+  catch (const xrt::error& ex) {
+    xocl::send_exception_message(ex.what());
+    return ex.get_code();
+  }
+  catch (const std::exception& ex) {
+    xocl::send_exception_message(ex.what());
+    return CL_OUT_OF_HOST_MEMORY;
+  }
+}
@@ -0,0 +1,80 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "xocl/config.h"
+#include "xocl/core/memory.h"
+#include "xocl/core/device.h"
+#include "xocl/core/context.h"
+#include "xocl/api/detail/memory.h"
+#include "xocl/api/detail/device.h"
+#include "plugin/xdp/profile.h"
+
+namespace xocl {
+
+static void
+validOrError(cl_device_id  device,
+             cl_uint       num_mem_objects,
+             const cl_mem* mem_objects)
+{
+  if (!config::api_checks())
+    return;
+
+  detail::device::validOrError(device);
+
+  if (!num_mem_objects || !mem_objects)
+    throw error(CL_INVALID_VALUE,"no mem objects");
+
+  for (auto mem : get_range(mem_objects,mem_objects+num_mem_objects)) {
+    detail::memory::validOrError(mem);
+    if (xocl(mem)->get_type() != CL_MEM_OBJECT_BUFFER)
+      throw error(CL_INVALID_MEM_OBJECT,"mem object is not a buffer");
+    if (!xocl(mem)->get_context()->has_device(xocl(device)))
+      throw error(CL_INVALID_DEVICE,"device is not in context of mem object");
+  }
+}
+
+static cl_int
+xclPrefetchMemObjects(cl_device_id  device,
+                      cl_uint       num_mem_objects,
+                      const cl_mem* mem_objects)
+{
+  validOrError(device,num_mem_objects,mem_objects);
+
+  for (auto mem : get_range(mem_objects,mem_objects+num_mem_objects))
+    xocl(device)->prefetch_buffer(xocl(mem));
+  return CL_SUCCESS;
+}
+
+} // xocl
+
+cl_int
+xclPrefetchMemObjects(cl_device_id  device,
+                      cl_uint       num_mem_objects,
+                      const cl_mem* mem_objects)
+{
+  try {
+    PROFILE_LOG_FUNCTION_CALL;
+    return xocl::xclPrefetchMemObjects(device,num_mem_objects,mem_objects);
+  }
+  catch (const xocl::error& ex) {
+    xocl::send_exception_message(ex.what());
+    return ex.get_code();
+  }
+  catch (const std::exception& ex) {
+    xocl::send_exception_message(ex.what());
+    return CL_OUT_OF_RESOURCES;
+  }
+}
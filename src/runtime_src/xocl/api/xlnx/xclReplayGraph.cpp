@@ -0,0 +1,109 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Copyright 2018 Xilinx, Inc. All rights reserved.
+
+#include <CL/opencl.h>
+#include "xocl/config.h"
+#include "xocl/core/command_queue.h"
+#include "xocl/core/event.h"
+#include "xocl/core/graph.h"
+#include "detail/command_queue.h"
+
+#include "enqueue.h"
+#include "plugin/xdp/profile.h"
+
+namespace xocl {
+
+static void
+validOrError(cl_command_queue command_queue,
+             cl_graph         graph,
+             cl_event*        event)
+{
+  if (!config::api_checks())
+    return;
+
+  detail::command_queue::validOrError(command_queue);
+
+  if (!graph)
+    throw error(CL_INVALID_VALUE,"graph is nullptr");
+
+  if (xocl(graph)->get_command_queue()!=xocl(command_queue))
+    throw error(CL_INVALID_COMMAND_QUEUE,"graph was not captured on command queue");
+}
+
+static cl_int
+xclReplayGraph(cl_command_queue command_queue,
+               cl_graph         graph,
+               cl_event*        event_parameter)
+{
+  validOrError(command_queue,graph,event_parameter);
+
+  // The captured events are prototypes for the replayed events.
+  // Arguments are not validated again, the argument checks were done
+  // when the commands were captured.
+  ptr<event> last;
+  auto protos = xocl(graph)->get_event_range();
+  for (auto itr=protos.begin(); itr!=protos.end(); ++itr) {
+    auto proto = (*itr).get();
+    auto uevent = xocl::create_hard_event(command_queue,proto->get_command_type());
+
+    if (auto ec = proto->get_execution_context()) {
+      // NDRange execution binds the current kernel arguments
+      uevent->set_execution_context(ec->clone(uevent.get()));
+      xocl::enqueue::set_event_action(uevent.get(),xocl::enqueue::action_ndrange_execute);
+    }
+    else if (proto->get_command_type()==CL_COMMAND_MIGRATE_MEM_OBJECTS
+             && itr+1!=protos.end() && (*(itr+1))->get_execution_context()) {
+      // Migration of NDRange kernel arguments, is enqueued right before
+      // the NDRange event and must migrate the current arguments
+      auto kernel = (*(itr+1))->get_execution_context()->get_kernel();
+      xocl::enqueue::set_event_action(uevent.get(),xocl::enqueue::action_ndrange_migrate,uevent.get(),kernel);
+    }
+    else {
+      auto action = proto->get_enqueue_action();
+      uevent->set_enqueue_action(std::move(action));
+    }
+
+    uevent->queue();
+    last = std::move(uevent);
+  }
+
+  if (last.get())
+    xocl::assign(event_parameter,last.get());
+  return CL_SUCCESS;
+}
+
+} // xocl
+
+cl_int
+xclReplayGraph(cl_command_queue command_queue,
+               cl_graph         graph,
+               cl_event*        event_parameter)
+{
+  try {
+    PROFILE_LOG_FUNCTION_CALL_WITH_QUEUE(command_queue);
+    return xocl::xclReplayGraph(command_queue,graph,event_parameter);
+  }
+  catch (const xrt::error& ex) {
+    xocl::send_exception_message(ex.what());
+    return ex.get_code();
+  }
+  catch (const std::exception& ex) {
+    xocl::send_exception_message(ex.what());
+    return CL_OUT_OF_HOST_MEMORY;
+  }
+}
@@ -0,0 +1,74 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "xocl/config.h"
+#include "xocl/core/kernel.h"
+#include "xocl/api/detail/kernel.h"
+#include "plugin/xdp/profile.h"
+
+namespace xocl {
+
+static void
+validOrError(cl_kernel   kernel,
+             size_t      args_size,
+             const void* args)
+{
+  if (!config::api_checks(kernel))
+    return;
+
+  // CL_INVALID_KERNEL if kernel is not a valid kernel object.
+  detail::kernel::validOrError(kernel);
+
+  // CL_INVALID_ARG_VALUE if args is nullptr
+  if (args_size && !args)
+    throw error(CL_INVALID_ARG_VALUE,"args cannot be nullptr");
+
+  // CL_INVALID_ARG_SIZE if args_size does not match the arguments
+  // checked in core/kernel::set_arguments
+}
+
+static cl_int
+xclSetKernelArgs(cl_kernel   kernel,
+                 size_t      args_size,
+                 const void* args)
+{
+  validOrError(kernel,args_size,args);
+  xocl(kernel)->set_arguments(args_size,args);
+  return CL_SUCCESS;
+}
+
+} // xocl
+
+cl_int
+xclSetKernelArgs(cl_kernel   kernel,
+                 size_t      args_size,
+                 const void* args)
+{
+  try {
+    PROFILE_LOG_FUNCTION_CALL;
+    return xocl::xclSetKernelArgs(kernel,args_size,args);
+  }
+  catch (const xocl::error& ex) {
+    std::string msg = ex.what();
+    msg += "\nERROR: xclSetKernelArgs() for kernel \"" + xocl::xocl(kernel)->get_name() + "\".\n";
+    xocl::send_exception_message(msg.c_str());
+    return ex.get_code();
+  }
+  catch (const std::exception& ex) {
+    xocl::send_exception_message(ex.what());
+    return CL_OUT_OF_RESOURCES;
+  }
+}
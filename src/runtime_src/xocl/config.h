@@ -19,6 +19,7 @@
 
 #include "xocl/core/debug.h"
 #include "xrt/config.h"
+#include <CL/cl.h>
 
 #define XOCL_UNUSED XRT_UNUSED
 
@@ -30,6 +31,24 @@ api_checks()
   return xrt::config::get_api_checks();
 }
 
+/**
+ * API checks for calls on objects of a context
+ *
+ * Checks are skipped when disabled globally or when the context of
+ * the object was created with CL_CONTEXT_API_CHECKS_XILINX set to
+ * CL_FALSE.  Invalid (nullptr) objects are always checked.
+ *
+ * Defined in api/detail/context.cpp
+ */
+bool
+api_checks(cl_context context);
+
+bool
+api_checks(cl_command_queue command_queue);
+
+bool
+api_checks(cl_kernel kernel);
+
 }}
 
 #endif
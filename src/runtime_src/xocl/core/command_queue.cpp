@@ -18,9 +18,14 @@
 #include "context.h"
 #include "device.h"
 #include "event.h"
+#include "memory.h"
+#include "execution_context.h"
 
 #include "xocl/api/plugin/xdp/profile.h"
 
+#include "xrt/util/memory.h"
+#include "xrt/util/time.h"
+
 #include <algorithm>
 #include <iostream>
 #include <cassert>
@@ -71,12 +76,30 @@ command_queue::
 
 bool
 command_queue::
-queue(event* ev)
+queue(event* ev,bool ahead)
 {
   bool ooo = m_props.test(CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE);
   XOCL_DEBUG(std::cout,"queue(",m_uid,") queues event(",ev->get_uid(),")\n");
 
   std::lock_guard<std::mutex> lk(m_events_mutex);
+  if (!ooo && ahead) {
+    m_events.insert(ev);
+    m_num_events.store(m_events.size(),std::memory_order_relaxed);
+    ev->retain();
+    if (m_capture)
+      m_capture->push_back(ev);
+    return true;
+  }
+
+  if (!ooo) {
+    if (ev->get_execution_context())
+      m_kernel_events.push_back(ev);
+    else {
+      m_last_ordered_event = ev;
+      m_kernel_events.clear();
+    }
+  }
+
   if (!ooo && m_last_queued_event.get()) {
     m_last_queued_event->chain(ev);
 
@@ -95,12 +118,48 @@ queue(event* ev)
   }
 
   m_events.insert(ev);
+  m_num_events.store(m_events.size(),std::memory_order_relaxed);
   m_last_queued_event = ev;
   ev->retain();
 
+  if (m_capture)
+    m_capture->push_back(ev);
+
   return true;
 }
 
+std::vector<ptr<event>>
+command_queue::
+get_migration_dependencies(const std::vector<const memory*>& mems) const
+{
+  std::vector<ptr<event>> deps;
+  if (m_props.test(CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE))
+    return deps;
+
+  // Sub buffers alias their parent, compare the buffers they belong to
+  auto root = [](const memory* mem) {
+    auto parent = mem->get_sub_buffer_parent();
+    return parent ? parent : mem;
+  };
+
+  std::lock_guard<std::mutex> lk(m_events_mutex);
+  if (m_last_ordered_event.get())
+    deps.push_back(m_last_ordered_event);
+
+  for (auto ev : m_kernel_events) {
+    auto args = ev->get_execution_context()->get_bound_argument_range();
+    bool uses = std::any_of(args.begin(),args.end(),[&](const std::unique_ptr<kernel::argument>& arg) {
+        auto amem = arg->get_memory_object();
+        return amem && std::any_of(mems.begin(),mems.end(),[&](const memory* mem) {
+            return root(mem)==root(amem);
+          });
+      });
+    if (uses)
+      deps.emplace_back(ev);
+  }
+  return deps;
+}
+
 bool
 command_queue::
 submit(event* ev)
@@ -139,8 +198,14 @@ remove(event* ev)
   if (it==m_events.end())
     throw xocl::error(CL_INVALID_EVENT,"event " + ev->get_suid() + " never submitted");
   m_events.erase(it);
+  m_num_events.store(m_events.size(),std::memory_order_release);
   if (m_last_queued_event==ev)
     m_last_queued_event = nullptr;
+  if (m_last_ordered_event==ev)
+    m_last_ordered_event = nullptr;
+  auto kit = std::find(m_kernel_events.begin(),m_kernel_events.end(),ev);
+  if (kit!=m_kernel_events.end())
+    m_kernel_events.erase(kit);
 
   if ((ev->get_command_type()==CL_COMMAND_BARRIER) && (m_props.test(CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE)))  {
     auto bit = std::find(m_barriers.begin(),m_barriers.end(),ev);
@@ -176,6 +241,16 @@ command_queue::
 wait() const
 {
   XOCL_DEBUG(std::cout,"xocl::command_queue::wait(",m_uid,")\n");
+
+  // As event::wait, spin before blocking if enabled for this queue
+  if (auto spin_ns = get_wait_spin_ns()) {
+    auto end = xrt::time_ns() + spin_ns;
+    do {
+      if (!m_num_events.load(std::memory_order_acquire))
+        return;
+    } while (xrt::time_ns() < end);
+  }
+
   std::unique_lock<std::mutex> lk(m_events_mutex);
   while (m_events.size())
     m_has_events.wait(lk);
@@ -201,6 +276,29 @@ wait_and_lock() const
     m_has_events.wait(lk);
   return queue_lock(std::move(lk));
 }
+void
+command_queue::
+begin_capture()
+{
+  std::lock_guard<std::mutex> lk(m_events_mutex);
+  if (m_capture)
+    throw xocl::error(CL_INVALID_OPERATION,"queue " + std::to_string(m_uid) + " is already capturing");
+  m_capture = xrt::make_unique<std::vector<ptr<event>>>();
+}
+
+std::vector<ptr<event>>
+command_queue::
+end_capture()
+{
+  std::lock_guard<std::mutex> lk(m_events_mutex);
+  if (!m_capture)
+    throw xocl::error(CL_INVALID_OPERATION,"queue " + std::to_string(m_uid) + " is not capturing");
+  std::vector<ptr<event>> events;
+  events.swap(*m_capture);
+  m_capture.reset();
+  return events;
+}
+
 void
 command_queue::
 register_constructor_callbacks(commandqueue_callback_type&& aCallback)
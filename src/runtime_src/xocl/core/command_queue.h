@@ -20,13 +20,16 @@
 #include "xocl/core/object.h"
 #include "xocl/core/refcount.h"
 #include "xocl/core/property.h"
+#include "xrt/config.h"
 
+#include <atomic>
 #include <vector>
 #include <set>
 #include <unordered_set>
 #include <mutex>
 #include <condition_variable>
 #include <functional>
+#include <memory>
 
 namespace xocl {
 
@@ -101,6 +104,20 @@ public:
     return m_props.test(CL_QUEUE_PROFILING_ENABLE);
   }
 
+  /**
+   * Get how long waits on the queue and its events spin before
+   * blocking
+   *
+   * @return
+   *   Spin budget in ns, 0 unless queue was created with
+   *   CL_QUEUE_WAIT_SPIN_XILINX
+   */
+  unsigned long
+  get_wait_spin_ns() const
+  {
+    return m_props.test(CL_QUEUE_WAIT_SPIN_XILINX) ? xrt::config::get_wait_spin()*1000ul : 0;
+  }
+
   /**
    * Get range with events that are queued or submitted
    */
@@ -114,11 +131,32 @@ public:
   /**
    * Add event to the command queue
    *
+   * @param ahead
+   *   On an in-order queue, do not order the event after the last
+   *   queued event and do not order later events after it.  The event
+   *   must carry its dependencies, see get_migration_dependencies().
    * @return
    *   true if successfully queued, false otherwise
    */
   bool
-  queue(event*);
+  queue(event*,bool ahead=false);
+
+  /**
+   * Get the queued events a migration of memory objects must wait for
+   *
+   * On an in-order queue these are the last queued event that is not
+   * an NDRange kernel, and the NDRange kernels queued after it that
+   * have any of the memory objects as argument.  A migration waiting
+   * for these events can be queued ahead of the queue order.
+   *
+   * @param mems
+   *   Memory objects to migrate
+   * @return
+   *   Events the migration must depend on, empty for out of order
+   *   queues
+   */
+  std::vector<ptr<event>>
+  get_migration_dependencies(const std::vector<const memory*>& mems) const;
 
   /**
    * Submit event for execution
@@ -182,6 +220,31 @@ public:
    *
    * Callbacks are called in arbitrary order
    */
+  /**
+   * Start capturing the events queued on this queue
+   *
+   * Captured events execute as usual, they are also recorded so
+   * that they can be replayed, see xocl::graph.
+   */
+  void
+  begin_capture();
+
+  /**
+   * Stop capturing events
+   *
+   * @return
+   *   The events queued since begin_capture(), in queue order
+   */
+  std::vector<ptr<event>>
+  end_capture();
+
+  bool
+  is_capturing() const
+  {
+    std::lock_guard<std::mutex> lk(m_events_mutex);
+    return m_capture!=nullptr;
+  }
+
   static void
   register_constructor_callbacks(commandqueue_callback_type&& aCallback);
 
@@ -201,8 +264,19 @@ private:
   mutable std::mutex m_events_mutex;
   mutable std::condition_variable m_has_events;
   event_queue_type m_events;
+  // Size of m_events, waits spin on it without the lock
+  std::atomic<size_t> m_num_events {0};
   std::vector<event*> m_barriers;
   ptr<event> m_last_queued_event;
+
+  // In-order queue: last queued event that is not an NDRange kernel,
+  // and the NDRange kernel events queued after it
+  ptr<event> m_last_ordered_event;
+  std::vector<event*> m_kernel_events;
+
+  // Events queued while capturing, on heap to avoid
+  // allocation unless needed.
+  std::unique_ptr<std::vector<ptr<event>>> m_capture;
   property_type m_props;
 };
 
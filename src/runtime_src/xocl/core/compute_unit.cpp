@@ -64,6 +64,10 @@ compute_unit(const xclbin::symbol* s, const std::string& n, device* d)
     throw std::runtime_error("Internal error  constructing compute unit");
   m_index = std::distance(cu2addr.begin(),itr);
 
+  // Connectivity is fixed by the xclbin, look it up once here so that
+  // launches only index the argument masks
+  init_memidx(xclbin);
+
   XOCL_DEBUGF("xocl::compute_unit::compute_unit(%d) name(%s) index(%d) address(0x%x)\n",m_uid,m_name.c_str(),m_index,m_address);
 }
 
@@ -73,37 +77,64 @@ compute_unit::
   XOCL_DEBUG(std::cout,"xocl::compute_unit::~compute_unit(",m_uid,")\n");
 }
 
+void
+compute_unit::
+init_memidx(const xclbin& xclbin)
+{
+  m_memidx.set(); // all bits true
+  int argidx = 0;
+  for (auto& arg : m_symbol->arguments) {
+    if (arg.atype!=xclbin::symbol::arg::argtype::indexed)
+      continue;
+    bool global = (arg.address_qualifier==1 || arg.address_qualifier==2); // global or constant
+    xclbin::memidx_bitmask_type mask;
+    bool valid = true;
+    try {
+      mask = xclbin.cu_address_to_memidx(m_address,argidx);
+    }
+    catch (const std::exception&) {
+      valid = false;
+      if (global)
+        m_memidx_intersect_valid = false;
+    }
+    if (valid && global)
+      m_memidx &= mask;
+    m_memidx_mask.push_back(mask);
+    m_memidx_valid.push_back(valid);
+    ++argidx;
+  }
+
+  m_memidx_union = xclbin.cu_address_to_memidx(m_address);
+}
+
 xclbin::memidx_bitmask_type
 compute_unit::
 get_memidx(unsigned int argidx) const
 {
-  auto itr = m_memidx_mask.find(argidx);
-  if (itr == m_memidx_mask.end()) {
-    auto xclbin = m_device->get_xclbin();
-    itr = m_memidx_mask.insert(itr,std::make_pair(argidx,xclbin.cu_address_to_memidx(m_address,argidx)));
-  }
-  return (*itr).second;
+  if (argidx < m_memidx_mask.size() && m_memidx_valid[argidx])
+    return m_memidx_mask[argidx];
+
+  // throws for an argument without connectivity
+  auto xclbin = m_device->get_xclbin();
+  return xclbin.cu_address_to_memidx(m_address,argidx);
 }
 
 xclbin::memidx_bitmask_type
 compute_unit::
 get_memidx_intersect() const
 {
-  if (cached)
+  if (m_memidx_intersect_valid)
     return m_memidx;
 
-  cached = true;
-
-  m_memidx.set(); // all bits true
+  // rethrow the connectivity error of the first bad argument
   int argidx = 0;
   for (auto& arg : m_symbol->arguments) {
     if (arg.atype!=xclbin::symbol::arg::argtype::indexed)
       continue;
-    if (arg.address_qualifier==1 || arg.address_qualifier==2) // global or constant
-      m_memidx &= get_memidx(argidx);
+    if (arg.address_qualifier==1 || arg.address_qualifier==2)
+      get_memidx(argidx);
     ++argidx;
   }
-
   return m_memidx;
 }
 
@@ -111,8 +142,7 @@ xclbin::memidx_bitmask_type
 compute_unit::
 get_memidx_union() const
 {
-  auto xclbin = m_device->get_xclbin();
-  return xclbin.cu_address_to_memidx(m_address);
+  return m_memidx_union;
 }
 
 } // xocl
@@ -19,6 +19,7 @@
 
 #include "xocl/xclbin/xclbin.h"
 #include <string>
+#include <vector>
 
 namespace xocl {
 
@@ -113,6 +114,9 @@ public:
 
 
 private:
+  void
+  init_memidx(const xclbin& xclbin);
+
   unsigned int m_uid = 0;
   const xclbin::symbol* m_symbol = nullptr;
   std::string m_name;
@@ -120,13 +124,18 @@ private:
   size_t m_address = 0;
   size_t m_index = 0;
 
-  // Map CU arg to memory bank indicies. An argument can
-  // be connected to multiple memory banks.
-  mutable std::map<unsigned int,xclbin::memidx_bitmask_type> m_memidx_mask;
-
-  // Intersection of all argument masks
-  mutable bool cached = false;
-  mutable xclbin::memidx_bitmask_type m_memidx; 
+  // Memory bank indicies of each indexed CU arg, computed when the
+  // CU is constructed. An argument can be connected to multiple
+  // memory banks. Args without connectivity are not valid and are
+  // looked up again by get_memidx to report the error.
+  std::vector<xclbin::memidx_bitmask_type> m_memidx_mask;
+  std::vector<bool> m_memidx_valid;
+
+  // Intersection of all global and constant argument masks, and
+  // union of all banks connected to the CU
+  bool m_memidx_intersect_valid = true;
+  xclbin::memidx_bitmask_type m_memidx;
+  xclbin::memidx_bitmask_type m_memidx_union;
 };
 
 } // xocl
@@ -32,6 +32,10 @@ context(const cl_context_properties* properties
 
   XOCL_DEBUG(std::cout,"xocl::context::context(",m_uid,")\n");
 
+  for (auto& prop : m_props)
+    if (prop.get_key()==CL_CONTEXT_API_CHECKS_XILINX)
+      m_api_checks = prop.get_value()!=CL_FALSE;
+
   std::transform(devices,devices+num_devices
                  ,std::back_inserter(m_devices)
                  ,[](cl_device_id dev) {
@@ -72,6 +72,17 @@ public:
     return m_props.get_value_as<T>(key);
   }
 
+  /**
+   * @return
+   *   false if context was created with CL_CONTEXT_API_CHECKS_XILINX
+   *   set to CL_FALSE
+   */
+  bool
+  get_api_checks() const
+  {
+    return m_api_checks;
+  }
+
   range<device_iterator_type>
   get_device_range()
   {
@@ -151,6 +162,7 @@ private:
   unsigned int m_uid = 0;
   property_list_type m_props;
   notify_action m_notify;
+  bool m_api_checks = true;
 
   platform* m_platform = nullptr;
 
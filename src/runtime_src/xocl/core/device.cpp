@@ -16,6 +16,7 @@
 
 #include "device.h"
 #include "memory.h"
+#include "context.h"
 #include "program.h"
 #include "compute_unit.h"
 
@@ -29,11 +30,17 @@
 #include <fstream>
 #include <sstream>
 #include <cstring>
+#include <unistd.h>
 
 namespace {
 
 static unsigned int uid_count = 0;
 
+// Serializes the parts of program loading that touch process wide
+// state (profiling, debug, scheduler), so that devices can be
+// programmed concurrently with only the download itself in parallel
+static std::mutex load_program_mutex;
+
 static
 std::string
 to_hex(void* addr)
@@ -111,6 +118,8 @@ sync_to_hbuf(xocl::memory* buffer, size_t offset, size_t size,
 static void
 open_or_error(xrt::device* device, const std::string& log)
 {
+  if (device->is_open())
+    return;
   if (!device->open(log.size() ? log.c_str() : nullptr, xrt::device::verbosity_level::quiet))
     throw xocl::error(CL_DEVICE_NOT_FOUND,"Device setup failed");
 }
@@ -170,6 +179,16 @@ init_scheduler(xocl::device* device)
                  ,cu2addr);
 }
 
+// Host bank buffers live in pinned host memory owned by the driver,
+// they cannot wrap user host memory
+static bool
+is_host_bank(const xocl::xclbin& xclbin, unsigned int memidx)
+{
+  auto mems = xclbin.get_mem_topology();
+  return mems
+    && memidx < static_cast<unsigned int>(mems->m_count)
+    && mems->m_mem_data[memidx].m_type == MEM_HOST;
+}
 
 }
 
@@ -203,7 +222,7 @@ alloc(memory* mem, unsigned int memidx)
 {
   auto host_ptr = mem->get_host_ptr();
   auto sz = mem->get_size();
-  if (is_aligned_ptr(host_ptr)) {
+  if (is_aligned_ptr(host_ptr) && !is_host_bank(m_xclbin,memidx)) {
     auto boh = m_xdevice->alloc(sz,xrt::device::memoryDomain::XRT_DEVICE_RAM,memidx,host_ptr);
     track(mem);
     return boh;
@@ -217,9 +236,10 @@ alloc(memory* mem, unsigned int memidx)
   auto boh = m_xdevice->alloc(sz,domain,memidx,nullptr);
   track(mem);
 
-  // Handle unaligned user ptr
+  // Handle unaligned user ptr, and user ptr of host bank buffer
   if (host_ptr) {
-    unaligned_message(host_ptr);
+    if (!is_host_bank(m_xclbin,memidx))
+      unaligned_message(host_ptr);
     auto bo_host_ptr = m_xdevice->map(boh);
     memcpy(bo_host_ptr, host_ptr, sz);
     m_xdevice->unmap(boh);
@@ -254,7 +274,7 @@ alloc(memory* mem)
 
 int
 device::
-get_stream(xrt::device::stream_flags flags, xrt::device::stream_attrs attrs, const cl_mem_ext_ptr_t* ext, xrt::device::stream_handle* stream, int32_t& conn)
+get_stream(xrt::device::stream_flags flags, xrt::device::stream_attrs attrs, const cl_mem_ext_ptr_t* ext, std::vector<xrt::device::stream_handle>& streams, int32_t& conn)
 {
   uint64_t route = (uint64_t)-1;
   uint64_t flow = (uint64_t)-1;
@@ -292,10 +312,24 @@ get_stream(xrt::device::stream_flags flags, xrt::device::stream_attrs attrs, con
     xocl(kernel)->set_argument(ext->flags,sizeof(cl_mem),nullptr);
   }
 
-  if (flags & CL_STREAM_READ_ONLY)
-    return m_xdevice->createReadStream(flags, attrs, route, flow, stream);
-  else if (flags & CL_STREAM_WRITE_ONLY)
-    return m_xdevice->createWriteStream(flags, attrs, route, flow, stream);
+  xrt::device::stream_handle stream = 0;
+  if (flags & CL_STREAM_READ_ONLY) {
+    auto ret = m_xdevice->createReadStream(flags, attrs, route, flow, &stream);
+    if (!ret)
+      streams.push_back(stream);
+    return ret;
+  }
+  else if (flags & CL_STREAM_WRITE_ONLY) {
+    // Extra queues are best effort, the stream works with what it got
+    auto nqueues = std::max(xrt::config::get_stream_write_queues(),1u);
+    for (unsigned int i=0; i<nqueues; ++i) {
+      auto ret = m_xdevice->createWriteStream(flags, attrs, route, flow, &stream);
+      if (ret)
+        return streams.empty() ? ret : 0;
+      streams.push_back(stream);
+    }
+    return 0;
+  }
   else
     throw xocl::error(CL_INVALID_OPERATION,"Unknown stream type specified");
   return -1;
@@ -303,17 +337,71 @@ get_stream(xrt::device::stream_flags flags, xrt::device::stream_attrs attrs, con
 
 int
 device::
-close_stream(xrt::device::stream_handle stream, int connidx)
+close_stream(const std::vector<xrt::device::stream_handle>& streams, int connidx)
 {
   assert(connidx!=-1);
   clear_connection(connidx);
-  return m_xdevice->closeStream(stream);
+  int ret = 0;
+  for (auto stream : streams)
+    if (auto err = m_xdevice->closeStream(stream))
+      ret = err;
+  return ret;
+}
+
+char*
+device::
+acquire_stream_slot(const void* ptr, size_t size, const xrt::device::stream_xfer_req* req)
+{
+  auto slot_size = xrt::config::get_stream_ring_slot_size();
+  if (!size || size > slot_size || (req->flags & CL_STREAM_NONBLOCKING))
+    return nullptr;
+
+  auto cptr = static_cast<const char*>(ptr);
+  std::lock_guard<std::mutex> lk(m_mutex);
+
+  // Stream buffers are already pinned
+  auto itr = m_stream_bufs.upper_bound(cptr);
+  if (itr != m_stream_bufs.begin() && cptr + size <= (--itr)->first + itr->second.first)
+    return nullptr;
+
+  if (!m_stream_ring_init) {
+    m_stream_ring_init = true;
+    for (unsigned int i=0; i<xrt::config::get_stream_ring_slots(); ++i) {
+      xrt::device::stream_buf_handle handle = 0;
+      auto buf = static_cast<char*>(m_xdevice->allocStreamBuf(slot_size,&handle));
+      if (!buf)
+        break;
+      m_stream_ring.emplace_back(handle,buf);
+      m_stream_ring_free.push_back(buf);
+    }
+  }
+
+  if (m_stream_ring_free.empty())
+    return nullptr;
+  auto slot = m_stream_ring_free.back();
+  m_stream_ring_free.pop_back();
+  return slot;
+}
+
+void
+device::
+release_stream_slot(char* slot)
+{
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_stream_ring_free.push_back(slot);
 }
 
 ssize_t
 device::
 write_stream(xrt::device::stream_handle stream, const void* ptr, size_t offset, size_t size, xrt::device::stream_xfer_req* req)
 {
+  auto src = static_cast<const char*>(ptr) + offset;
+  if (auto slot = acquire_stream_slot(src,size,req)) {
+    std::memcpy(slot,src,size);
+    auto ret = m_xdevice->writeStream(stream, slot, 0, size, req);
+    release_stream_slot(slot);
+    return ret;
+  }
   return m_xdevice->writeStream(stream, ptr, offset, size, req);
 }
 
@@ -321,20 +409,56 @@ ssize_t
 device::
 read_stream(xrt::device::stream_handle stream, void* ptr, size_t offset, size_t size, xrt::device::stream_xfer_req* req)
 {
+  auto dst = static_cast<char*>(ptr) + offset;
+  if (auto slot = acquire_stream_slot(dst,size,req)) {
+    auto ret = m_xdevice->readStream(stream, slot, 0, size, req);
+    if (ret > 0)
+      std::memcpy(dst,slot,std::min(static_cast<size_t>(ret),size));
+    release_stream_slot(slot);
+    return ret;
+  }
   return m_xdevice->readStream(stream, ptr, offset, size, req);
 }
 
+ssize_t
+device::
+write_streamv(xrt::device::stream_handle stream, const cl_stream_iovec* vec, size_t num, xrt::device::stream_xfer_req* req)
+{
+  return m_xdevice->writeStreamv(stream, vec, num, req);
+}
+
+ssize_t
+device::
+read_streamv(xrt::device::stream_handle stream, const cl_stream_iovec* vec, size_t num, xrt::device::stream_xfer_req* req)
+{
+  return m_xdevice->readStreamv(stream, vec, num, req);
+}
+
 xrt::device::stream_buf
 device::
 alloc_stream_buf(size_t size, xrt::device::stream_buf_handle* handle)
 {
-  return m_xdevice->allocStreamBuf(size,handle);
+  auto buf = m_xdevice->allocStreamBuf(size,handle);
+  if (buf) {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_stream_bufs[static_cast<const char*>(buf)] = std::make_pair(size,*handle);
+  }
+  return buf;
 }
 
 int
 device::
 free_stream_buf(xrt::device::stream_buf_handle handle)
 {
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    for (auto itr=m_stream_bufs.begin(); itr!=m_stream_bufs.end(); ++itr) {
+      if ((*itr).second.second == handle) {
+        m_stream_bufs.erase(itr);
+        break;
+      }
+    }
+  }
   return m_xdevice->freeStreamBuf(handle);
 }
 
@@ -404,6 +528,19 @@ device(platform* pltf, xrt::device* swem_device, xrt::device* hwem_device)
   : device(pltf,nullptr,swem_device,hwem_device)
 {}
 
+void
+device::
+open(xrt::device* hw_device)
+{
+  std::string hallog = xrt::config::get_hal_logging();
+  if (!hallog.compare("null"))
+    hallog.clear();
+
+  open_or_error(hw_device,hallog);
+  if (!xrt::config::get_lazy_device_setup())
+    hw_device->setup();
+}
+
 device::
 device(device* parent, const compute_unit_vector_type& cus)
   : m_uid(uid_count++)
@@ -431,6 +568,8 @@ device::
 ~device()
 {
   XOCL_DEBUG(std::cout,"xocl::device::~device(",m_uid,")\n");
+  for (auto& slot : m_stream_ring)
+    m_xdevice->freeStreamBuf(slot.first);
 }
 
 void
@@ -441,8 +580,9 @@ set_xrt_device(xrt::device* xd,bool final)
     throw std::runtime_error("temp device already set");
   m_xdevice = xd;
 
-  // start the DMA threads if necessary
-  if (final)
+  // start the DMA threads if necessary, lazy setup defers them to
+  // the first task queued to the device
+  if (final && !xrt::config::get_lazy_device_setup())
     m_xdevice->setup();
 }
 
@@ -726,23 +866,107 @@ import_buffer_object(const device* src_device, const xrt::device::BufferObjectHa
   // Export from exporting device (src_device)
   auto fd = src_device->get_xrt_device()->getMemObjectFd(src_boh);
 
-  // Import into this device
+  // Import into this device, the imported BO holds its own reference
+  // to the exported buffer so the fd is no longer needed
   size_t size=0;
-  return get_xrt_device()->getBufferFromFd(fd,size,1);
+  auto boh = get_xrt_device()->getBufferFromFd(fd,size,1);
+  close(fd);
+  return boh;
+}
+
+// Apply a host write of a replicated buffer on device to the copies on
+// the other devices.  Resident copies are synced in parallel.
+static void
+write_replicas(device* dev, memory* buffer, const void* ptr, size_t size, size_t offset)
+{
+  std::vector<xrt::event> events;
+  for (auto d : buffer->get_context()->get_device_range()) {
+    if (d==dev)
+      continue;
+    auto boh = buffer->get_buffer_object_or_null(d);
+    if (!boh)
+      continue;
+    auto xdevice = d->get_xrt_device();
+    if (!buffer->is_aligned())
+      xdevice->write(boh,ptr,size,offset,false);
+    if (buffer->is_resident(d))
+      events.push_back(xdevice->sync(boh,size,offset,xrt::hal::device::direction::HOST2DEVICE,true));
+  }
+  for (auto& ev : events)
+    ev.wait();
+}
+
+// Make a replicated buffer resident on device and all other active
+// devices of its context at once.  If one device has written the
+// buffer, its copy is read back and copied to the others, otherwise
+// all copies already hold the host content.
+static void
+replicate_buffer(device* dev, memory* buffer)
+{
+  auto owner = const_cast<device*>(buffer->get_replica_owner());
+  if (owner && buffer->is_resident(owner) && !buffer->is_host_valid())
+    owner->migrate_buffer(buffer,CL_MIGRATE_MEM_OBJECT_HOST);
+
+  // Without host ptr the source is the owner's host
+  // backing, it stays mapped until all copies are written
+  const char* src = nullptr;
+  xrt::device::BufferObjectHandle src_boh;
+  if (owner && !buffer->get_host_ptr()) {
+    src_boh = buffer->get_buffer_object_or_error(owner);
+    src = static_cast<const char*>(owner->get_xrt_device()->map(src_boh));
+  }
+
+  std::vector<std::pair<size_t,size_t>> ranges;
+  if (owner || !buffer->get_dirty_ranges(ranges)) {
+    ranges.clear();
+    ranges.emplace_back(0,buffer->get_size());
+  }
+
+  std::vector<device*> devices;
+  std::vector<xrt::event> events;
+  for (auto d : buffer->get_context()->get_device_range()) {
+    if ((d!=dev && !d->is_active()) || buffer->is_resident(d))
+      continue;
+    auto xdevice = d->get_xrt_device();
+    auto boh = buffer->get_buffer_object(d);
+    for (auto& range : ranges) {
+      if (src && d!=owner)
+        xdevice->write(boh,src+range.first,range.second,range.first,false);
+      else
+        sync_to_hbuf(buffer,range.first,range.second,xdevice,boh);
+      events.push_back(xdevice->sync(boh,range.second,range.first,xrt::hal::device::direction::HOST2DEVICE,true));
+    }
+    devices.push_back(d);
+  }
+  for (auto& ev : events)
+    ev.wait();
+  if (src)
+    owner->get_xrt_device()->unmap(src_boh);
+
+  for (auto d : devices)
+    buffer->set_resident(d);
+  if (!buffer->get_sub_buffer_parent())
+    buffer->clear_replica_owner();
 }
 
 void*
 device::
 map_buffer(memory* buffer, cl_map_flags map_flags, size_t offset, size_t size, void* assert_result)
 {
+  auto mlk = buffer->lock_migration();
   auto xdevice = get_xrt_device();
   xrt::device::BufferObjectHandle boh;
 
   // If buffer is resident it must be refreshed unless CL_MAP_INVALIDATE_REGION
-  // is specified in which case host will discard current content
-  if (!(map_flags & CL_MAP_WRITE_INVALIDATE_REGION) && buffer->is_resident(this)) {
+  // is specified in which case host will discard current content, or
+  // unless the host copy is current
+  if (!(map_flags & CL_MAP_WRITE_INVALIDATE_REGION) && buffer->is_resident(this)
+      && !buffer->is_host_valid()) {
+    auto generation = buffer->get_host_generation();
     boh = buffer->get_buffer_object_or_error(this);
     xdevice->sync(boh,size,offset,xrt::hal::device::direction::DEVICE2HOST,false);
+    if (offset==0 && size==buffer->get_size())
+      buffer->validate_host(generation);
   }
 
   if (!boh)
@@ -801,15 +1025,19 @@ unmap_buffer(memory* buffer, void* mapped_ptr)
     }
   }
 
+  auto lk = buffer->lock_migration();
   auto xdevice = get_xrt_device();
   auto boh = buffer->get_buffer_object_or_error(this);
 
   // Sync data to boh if write flags, and sync to device if resident
   if (flags & (CL_MAP_WRITE | CL_MAP_WRITE_INVALIDATE_REGION)) {
+    buffer->add_dirty_range(offset,size);
     if (auto ubuf = static_cast<char*>(buffer->get_host_ptr()))
       xdevice->write(boh,ubuf+offset,size,offset,false);
     if (buffer->is_resident(this) && !buffer->is_p2p_memory())
       xdevice->sync(boh,size,offset,xrt::hal::device::direction::HOST2DEVICE,false);
+    if (buffer->is_replicated())
+      write_replicas(this,buffer,mapped_ptr,size,offset);
   }
 }
 
@@ -817,24 +1045,44 @@ void
 device::
 migrate_buffer(memory* buffer,cl_mem_migration_flags flags)
 {
+  auto lk = buffer->lock_migration();
+
   // Support clEnqueueMigrateMemObjects device->host
   if (flags & CL_MIGRATE_MEM_OBJECT_HOST) {
     buffer_resident_or_error(buffer,this);
     auto boh = buffer->get_buffer_object_or_error(this);
     auto xdevice = get_xrt_device();
     if(!buffer->is_p2p_memory()){
-      xdevice->sync(boh,buffer->get_size(),0,xrt::hal::device::direction::DEVICE2HOST,false);
+      if (!buffer->is_host_valid()) {
+        auto generation = buffer->get_host_generation();
+        xdevice->sync(boh,buffer->get_size(),0,xrt::hal::device::direction::DEVICE2HOST,false);
+        buffer->validate_host(generation);
+      }
       sync_to_ubuf(buffer,0,buffer->get_size(),xdevice,boh);
     }
     return;
   }
 
-  // Host to device for kernel args and clEnqueueMigrateMemObjects
+  // Host to device for kernel args and clEnqueueMigrateMemObjects.
+  // Replicated buffers become resident on all devices at once.
+  if (buffer->is_replicated()) {
+    replicate_buffer(this,buffer);
+    return;
+  }
+
   // Get or create the buffer object on this device.
   auto xdevice = get_xrt_device();
   xrt::device::BufferObjectHandle boh = buffer->get_buffer_object(this);
 
-  if(!buffer->is_p2p_memory()){
+  std::vector<std::pair<size_t,size_t>> ranges;
+  if(!buffer->is_p2p_memory() && buffer->get_dirty_ranges(ranges)) {
+    // Only the ranges written by host have defined content
+    for (auto& range : ranges)
+      sync_to_hbuf(buffer,range.first,range.second,xdevice,boh);
+    if (!ranges.empty())
+      xdevice->sync(boh,ranges,xrt::hal::device::direction::HOST2DEVICE);
+  }
+  else if(!buffer->is_p2p_memory()){
     // Sync from host to device to make make buffer resident of this device
     sync_to_hbuf(buffer,0,buffer->get_size(),xdevice,boh);
     xdevice->sync(boh,buffer->get_size(), 0, xrt::hal::device::direction::HOST2DEVICE,false);
@@ -843,13 +1091,68 @@ migrate_buffer(memory* buffer,cl_mem_migration_flags flags)
   buffer->set_resident(this);
 }
 
+void
+device::
+make_resident(memory* buffer)
+{
+  // Waits for a prefetch of the buffer in progress
+  auto lk = buffer->lock_migration();
+  if (!buffer->is_resident(this))
+    migrate_buffer(buffer,0);
+}
+
+void
+device::
+prefetch_buffer(memory* buffer)
+{
+  // Without a buffer object the bank of the buffer is not yet known,
+  // it is placed when bound to a kernel argument
+  if (buffer->is_p2p_memory() || buffer->is_resident(this)
+      || !buffer->get_buffer_object_or_null(this))
+    return;
+
+  // Errors are dropped with the event, a kernel launch migrates the
+  // buffer again if the prefetch did not complete
+  ptr<memory> hold(buffer);
+  get_xrt_device()->schedule([this,hold] { make_resident(hold.get()); },
+                             xrt::device::queue_type::write);
+}
+
 void
 device::
 write_buffer(memory* buffer, size_t offset, size_t size, const void* ptr)
 {
+  auto lk = buffer->lock_migration();
+  buffer->add_dirty_range(offset,size);
+
+  // Buffer is not yet allocated, write is applied when the buffer is
+  // placed in a bank by kernel argument binding or migration
+  if (buffer->try_defer_write(offset,size,ptr))
+    return;
+
   auto xdevice = get_xrt_device();
   auto boh = buffer->get_buffer_object(this);
 
+  if (buffer->is_replicated())
+    write_replicas(this,buffer,ptr,size,offset);
+
+  // Pipeline large writes to resident buffer, the copy of each chunk
+  // overlaps with the DMA of the previous chunks
+  static size_t chunk_size = xrt::config::get_write_pipeline_chunk_size();
+  if (chunk_size && size >= 2*chunk_size && buffer->is_resident(this)) {
+    auto src = static_cast<const char*>(ptr);
+    std::vector<xrt::event> events;
+    for (size_t done=0; done<size; done+=chunk_size) {
+      auto chunk = std::min(chunk_size,size-done);
+      xdevice->write(boh,src+done,chunk,offset+done,false);
+      sync_to_ubuf(buffer,offset+done,chunk,xdevice,boh);
+      events.push_back(xdevice->sync(boh,chunk,offset+done,xrt::hal::device::direction::HOST2DEVICE,true));
+    }
+    for (auto& ev : events)
+      ev.wait();
+    return;
+  }
+
   // Write data to buffer object at offset
   xdevice->write(boh,ptr,size,offset,false);
 
@@ -869,10 +1172,14 @@ read_buffer(memory* buffer, size_t offset, size_t size, void* ptr)
   auto xdevice = get_xrt_device();
   auto boh = buffer->get_buffer_object(this);
 
-  if (buffer->is_resident(this))
+  if (buffer->is_resident(this) && !buffer->is_host_valid()) {
     // Sync back from device at offset to buffer object
     // HAL performs skip/copy read if necesary
+    auto generation = buffer->get_host_generation();
     xdevice->sync(boh,size,offset,xrt::hal::device::direction::DEVICE2HOST,false);
+    if (offset==0 && size==buffer->get_size())
+      buffer->validate_host(generation);
+  }
 
   // Read data from buffer object at offset
   xdevice->read(boh,ptr,size,offset,false);
@@ -881,34 +1188,18 @@ read_buffer(memory* buffer, size_t offset, size_t size, void* ptr)
   sync_to_ubuf(buffer,offset,size,xdevice,boh);
 }
 
-void
-device::
-copy_buffer(memory* src_buffer, memory* dst_buffer, size_t src_offset, size_t dst_offset, size_t size, const cmd_type& cmd)
+// Make cmd a CDMA copy of size bytes from src_addr to dst_addr.  The
+// command may run on any of the device CDMA engines.
+static void
+init_cdma_copy(device* dev, xrt::command* cmd, uint64_t src_addr, uint64_t dst_addr, size_t size)
 {
-  auto xdevice = get_xrt_device();
-
-  if (!get_num_cdmas() || is_emulation_mode()) {
-    auto cb = [this](memory* sbuf, memory* dbuf, size_t soff, size_t doff, size_t sz,const cmd_type& c) {
-      c->start();
-      char* hbuf_src = static_cast<char*>(map_buffer(sbuf,CL_MAP_READ,soff,sz,nullptr));
-      char* hbuf_dst = static_cast<char*>(map_buffer(dbuf,CL_MAP_WRITE_INVALIDATE_REGION,doff,sz,nullptr));
-      std::memcpy(hbuf_dst,hbuf_src,sz);
-      unmap_buffer(sbuf,hbuf_src);
-      unmap_buffer(dbuf,hbuf_dst);
-      c->done();
-    };
-    xdevice->schedule(cb,xrt::device::queue_type::misc,src_buffer,dst_buffer,src_offset,dst_offset,size,cmd);
-    return;
-  }
-
-  // CDMA.  TODO, this needs to be done at lower shim level, not in OCL land
   auto sk_cmd = xrt::command_cast<ert_start_kernel_cmd*>(cmd);
-  auto packet = cmd->get_packet();
+  auto& packet = cmd->get_packet();
   size_t offset = 1; // packet offset past header
 
-  auto maxidx = get_num_cus() + get_num_cdmas();
+  auto maxidx = dev->get_num_cus() + dev->get_num_cdmas();
 
-  for (auto cu_idx=get_num_cus(); cu_idx<maxidx; ++cu_idx) {
+  for (auto cu_idx=dev->get_num_cus(); cu_idx<maxidx; ++cu_idx) {
     auto mask_idx = cu_idx/32;
     auto cu_mask_idx = cu_idx - mask_idx*32;
     packet[offset + mask_idx] |= 1 << cu_mask_idx;
@@ -918,11 +1209,6 @@ copy_buffer(memory* src_buffer, memory* dst_buffer, size_t src_offset, size_t ds
   offset += maxidx/32 + 1; // packet offset past cumasks
 
   // Insert copy command content
-  auto src_boh = xocl::xocl(src_buffer)->get_buffer_object(this);
-  auto src_addr = xdevice->getDeviceAddr(src_boh) + src_offset;
-  auto dst_boh = xocl::xocl(dst_buffer)->get_buffer_object(this);
-  auto dst_addr = xdevice->getDeviceAddr(dst_boh) + dst_offset;
-
   packet[offset++] = 0; // 0x0 reserved CU AP_CTRL
   packet[offset++] = 0; // 0x4 reserved CU GIE
   packet[offset++] = 0; // 0xc reserved CU IER
@@ -936,6 +1222,136 @@ copy_buffer(memory* src_buffer, memory* dst_buffer, size_t src_offset, size_t ds
   packet[offset++] = (size*8) / 512;                 // 0x28 units of 512 bits
 
   sk_cmd->count = offset-1; // number of words in payload (excludes header)
+}
+
+// Copy from a buffer resident on another device (sdev) to a buffer on
+// dev.  P2P source buffers are imported into dev and copied device to
+// device.  Otherwise the source is synced to its own pinned host
+// backing and DMAed from there straight to the destination device
+// address.  Copying through host mapped buffers is the fallback.
+static void
+copy_device_buffer(device* dev, device* sdev, memory* src_buffer, memory* dst_buffer,
+                   size_t src_offset, size_t dst_offset, size_t size)
+{
+  auto xdevice = dev->get_xrt_device();
+  auto sxdevice = sdev->get_xrt_device();
+  auto src_boh = src_buffer->get_buffer_object_or_error(sdev);
+  auto dst_boh = dst_buffer->get_buffer_object(dev);
+
+  if (src_buffer->is_p2p_memory()) {
+    try {
+      auto boh = dev->import_buffer_object(sdev,src_boh);
+      if (xdevice->copy(dst_boh,boh,size,dst_offset,src_offset).get<int>()==0) {
+        dst_buffer->invalidate_host();
+        dst_buffer->drop_replicas(dev);
+        return;
+      }
+    }
+    catch (const std::exception&) {
+      // not exportable, fall through to host staging
+    }
+  }
+
+  if (!src_buffer->is_p2p_memory()) {
+    if (!src_buffer->is_host_valid())
+      sxdevice->sync(src_boh,size,src_offset,xrt::hal::device::direction::DEVICE2HOST,false);
+    auto hbuf_src = static_cast<const char*>(sxdevice->map(src_boh)) + src_offset;
+    auto dst_addr = xdevice->getDeviceAddr(dst_boh) + dst_offset;
+    auto written = xdevice->write_unmgd(hbuf_src,size,dst_addr);
+    sxdevice->unmap(src_boh);
+    if (written==static_cast<ssize_t>(size)) {
+      dst_buffer->invalidate_host();
+      dst_buffer->drop_replicas(dev);
+      return;
+    }
+  }
+
+  char* hbuf_src = static_cast<char*>(sdev->map_buffer(src_buffer,CL_MAP_READ,src_offset,size,nullptr));
+  char* hbuf_dst = static_cast<char*>(dev->map_buffer(dst_buffer,CL_MAP_WRITE_INVALIDATE_REGION,dst_offset,size,nullptr));
+  std::memcpy(hbuf_dst,hbuf_src,size);
+  sdev->unmap_buffer(src_buffer,hbuf_src);
+  dev->unmap_buffer(dst_buffer,hbuf_dst);
+}
+
+void
+device::
+copy_buffer(memory* src_buffer, memory* dst_buffer, size_t src_offset, size_t dst_offset, size_t size, const cmd_type& cmd)
+{
+  auto xdevice = get_xrt_device();
+
+  // Source resident only on another device of the context
+  auto src_device = const_cast<device*>(src_buffer->get_resident_device());
+  if (src_device && src_device!=this && !is_emulation_mode()) {
+    auto cb = [this](device* sdev, memory* sbuf, memory* dbuf, size_t soff, size_t doff, size_t sz,const cmd_type& c) {
+      c->start();
+      try {
+        copy_device_buffer(this,sdev,sbuf,dbuf,soff,doff,sz);
+      }
+      catch (const std::exception& ex) {
+        c->error(ex);
+        throw;
+      }
+      c->done();
+    };
+    xdevice->schedule(cb,xrt::device::queue_type::misc,src_device,src_buffer,dst_buffer,src_offset,dst_offset,size,cmd);
+    return;
+  }
+
+  if (!get_num_cdmas() || is_emulation_mode()) {
+    auto cb = [this](memory* sbuf, memory* dbuf, size_t soff, size_t doff, size_t sz,const cmd_type& c) {
+      c->start();
+      try {
+        char* hbuf_src = static_cast<char*>(map_buffer(sbuf,CL_MAP_READ,soff,sz,nullptr));
+        char* hbuf_dst = static_cast<char*>(map_buffer(dbuf,CL_MAP_WRITE_INVALIDATE_REGION,doff,sz,nullptr));
+        std::memcpy(hbuf_dst,hbuf_src,sz);
+        unmap_buffer(sbuf,hbuf_src);
+        unmap_buffer(dbuf,hbuf_dst);
+      }
+      catch (const std::exception& ex) {
+        c->error(ex);
+        throw;
+      }
+      c->done();
+    };
+    xdevice->schedule(cb,xrt::device::queue_type::misc,src_buffer,dst_buffer,src_offset,dst_offset,size,cmd);
+    return;
+  }
+
+  // CDMA.  TODO, this needs to be done at lower shim level, not in OCL land
+  auto src_boh = xocl::xocl(src_buffer)->get_buffer_object(this);
+  auto src_addr = xdevice->getDeviceAddr(src_boh) + src_offset;
+  auto dst_boh = xocl::xocl(dst_buffer)->get_buffer_object(this);
+  auto dst_addr = xdevice->getDeviceAddr(dst_boh) + dst_offset;
+  dst_buffer->invalidate_host();
+  dst_buffer->drop_replicas(this);
+
+  // Large copies are split over all CDMA engines, the chunks are
+  // waited for on a worker and the command completes when all are done
+  constexpr size_t min_chunk = 1024*1024;
+  constexpr size_t cdma_align = 64;
+  auto chunks = get_num_cdmas();
+  if (chunks > 1 && size >= chunks*min_chunk) {
+    auto cb = [this,xdevice](uint64_t saddr, uint64_t daddr, size_t sz, size_t n, const cmd_type& c) {
+      c->start();
+      auto chunk = sz / n / cdma_align * cdma_align;
+      std::vector<cmd_type> cmds;
+      for (size_t idx=0; idx<n; ++idx) {
+        auto off = idx*chunk;
+        auto csz = (idx==n-1) ? sz-off : chunk;
+        auto ccmd = std::make_shared<xrt::command>(xdevice,ERT_START_CU);
+        init_cdma_copy(this,ccmd.get(),saddr+off,daddr+off,csz);
+        xrt::scheduler::schedule(ccmd);
+        cmds.push_back(std::move(ccmd));
+      }
+      for (auto& ccmd : cmds)
+        ccmd->wait();
+      c->done();
+    };
+    xdevice->schedule(cb,xrt::device::queue_type::misc,src_addr,dst_addr,size,chunks,cmd);
+    return;
+  }
+
+  init_cdma_copy(this,cmd.get(),src_addr,dst_addr,size);
   xrt::scheduler::schedule(cmd);
 }
 
@@ -946,7 +1362,17 @@ copy_p2p_buffer(memory* src_buffer, memory* dst_buffer, size_t src_offset, size_
   auto xdevice = get_xrt_device();
   auto src_boh = src_buffer->get_buffer_object(this);
   auto dst_boh = dst_buffer->get_buffer_object(this);
-  xdevice->copy(dst_boh, src_boh, size, dst_offset, src_offset);
+  dst_buffer->invalidate_host();
+  dst_buffer->drop_replicas(this);
+  if (xdevice->copy(dst_boh, src_boh, size, dst_offset, src_offset).get<int>()==0)
+    return;
+
+  // Device DMA of the peer buffer failed, bounce through host memory
+  char* hbuf_src = static_cast<char*>(map_buffer(src_buffer,CL_MAP_READ,src_offset,size,nullptr));
+  char* hbuf_dst = static_cast<char*>(map_buffer(dst_buffer,CL_MAP_WRITE_INVALIDATE_REGION,dst_offset,size,nullptr));
+  std::memcpy(hbuf_dst,hbuf_src,size);
+  unmap_buffer(src_buffer,hbuf_src);
+  unmap_buffer(dst_buffer,hbuf_dst);
 }
 
 void
@@ -954,6 +1380,46 @@ device::
 fill_buffer(memory* buffer, const void* pattern, size_t pattern_size, size_t offset, size_t size)
 {
   auto boh = xocl::xocl(buffer)->get_buffer_object(this);
+
+  // Device side fill of resident buffers. Host fills and syncs a seed
+  // of whole patterns at the start of the range, which CDMA then
+  // doubles in place until the range is covered, so only the seed and
+  // a short tail cross PCIe.  Copies are in units that are multiples of
+  // both the CDMA transfer size and the pattern to preserve the pattern.
+  constexpr size_t seed = 64*1024;
+  constexpr size_t cdma_align = 64;
+  auto xdevice = get_xrt_device();
+  if (get_num_cdmas() && !is_emulation_mode() && size >= 2*seed && seed % pattern_size == 0
+      && buffer->is_resident(this) && !buffer->is_p2p_memory()
+      && (xdevice->getDeviceAddr(boh) + offset) % cdma_align == 0) {
+    size_t unit = cdma_align;
+    while (unit % pattern_size)
+      unit += cdma_align;
+    fill_host(buffer,pattern,pattern_size,offset,seed);
+    buffer->invalidate_host();
+    buffer->drop_replicas(this);
+    auto addr = xdevice->getDeviceAddr(boh) + offset;
+    size_t done = seed;
+    while (size - done >= unit) {
+      auto sz = std::min(done,size-done) / unit * unit;
+      auto cmd = std::make_shared<xrt::command>(xdevice,ERT_START_CU);
+      init_cdma_copy(this,cmd.get(),addr,addr+done,sz);
+      xrt::scheduler::schedule(cmd);
+      cmd->wait();
+      done += sz;
+    }
+    if (done < size)
+      fill_host(buffer,pattern,pattern_size,offset+done,size-done);
+    return;
+  }
+
+  fill_host(buffer,pattern,pattern_size,offset,size);
+}
+
+void
+device::
+fill_host(memory* buffer, const void* pattern, size_t pattern_size, size_t offset, size_t size)
+{
   char* hbuf = static_cast<char*>(map_buffer(buffer,CL_MAP_WRITE_INVALIDATE_REGION,offset,size,nullptr));
   char* dst = hbuf;
   for (; pattern_size <= size; size-=pattern_size, dst+=pattern_size)
@@ -976,39 +1442,130 @@ rw_image(device* device,
     + image->get_image_row_pitch()*origin[1]
     + image->get_image_slice_pitch()*origin[2];
 
-  if (!origin[0] && region[0]==image->get_image_width() && row_pitch==image->get_image_row_pitch()
-      && (region[2]==1
-          || (!origin[1] && region[1]==image->get_image_height() && slice_pitch==image->get_image_slice_pitch())
-          )
-      ) {
-    size_t sz = region[2]==1 ? row_pitch*region[1] : slice_pitch*region[2];
+  // Copy straight between host memory and the mapped buffer object
+  // rather than through one read or write per row
+  auto image_data = static_cast<char*>(xdevice->map(boh)) + image_offset;
+  auto image_row_pitch = image->get_image_row_pitch();
+  auto image_slice_pitch = image->get_image_slice_pitch();
+  size_t row_size = image->get_image_bytes_per_pixel()*region[0];
+
+  auto copy = [read_to,write_from](char* image_ptr, size_t host_offset, size_t sz) {
     if (read_to)
-      xdevice->read(boh,read_to,sz,image_offset,false);
+      std::memcpy(read_to+host_offset,image_ptr,sz);
     else
-      xdevice->write(boh,write_from,sz,image_offset,false);
+      std::memcpy(image_ptr,write_from+host_offset,sz);
+  };
+
+  if (row_pitch==image_row_pitch && row_size==image_row_pitch
+      && (region[2]==1 || (slice_pitch==image_slice_pitch && slice_pitch==row_size*region[1]))) {
+    // region is contiguous with the same layout on both sides
+    copy(image_data,0,row_size*region[1]*region[2]);
   }
   else {
-    size_t image_offset_tmp = image_offset;
-    for (unsigned int j=0; j<region[2]; ++j) {
-      size_t offset = image_offset_tmp;
-      for (unsigned int i=0; i<region[1]; ++i) {
-        if (read_to) {
-          xdevice->read(boh,read_to,image->get_image_bytes_per_pixel()*region[0],offset,false);
-          read_to += row_pitch;
-        }
-        else {
-          xdevice->write(boh,write_from,image->get_image_bytes_per_pixel()*region[0],offset, false);
-          write_from += row_pitch;
-        }
-        offset += image->get_image_row_pitch();
-      }
-      image_offset_tmp += image->get_image_slice_pitch();
+    for (size_t j=0; j<region[2]; ++j)
+      for (size_t i=0; i<region[1]; ++i)
+        copy(image_data + j*image_slice_pitch + i*image_row_pitch, j*slice_pitch + i*row_pitch, row_size);
+  }
+
+  xdevice->unmap(boh);
+}
+
+// (offset,size) ranges of the rows of a rectangle at offset in a buffer
+// object, for syncing only the rows read or written.  Rows that are
+// adjacent in the buffer object are merged into one range
+static std::vector<std::pair<size_t,size_t>>
+rect_ranges(size_t offset,size_t row_size,size_t rows,size_t slices,size_t row_pitch,size_t slice_pitch)
+{
+  std::vector<std::pair<size_t,size_t>> ranges;
+  ranges.reserve(rows*slices);
+  for (size_t j=0; j<slices; ++j) {
+    for (size_t i=0; i<rows; ++i) {
+      size_t row_offset = offset + j*slice_pitch + i*row_pitch;
+      if (!ranges.empty() && ranges.back().first + ranges.back().second == row_offset)
+        ranges.back().second += row_size;
+      else
+        ranges.emplace_back(row_offset,row_size);
+    }
+  }
+  return ranges;
+}
+
+// (offset,size) ranges of the image buffer object covered by region
+static std::vector<std::pair<size_t,size_t>>
+image_ranges(memory* image,const size_t* origin,const size_t* region)
+{
+  size_t image_offset = image->get_image_data_offset()
+    + image->get_image_bytes_per_pixel()*origin[0]
+    + image->get_image_row_pitch()*origin[1]
+    + image->get_image_slice_pitch()*origin[2];
+  size_t row_size = image->get_image_bytes_per_pixel()*region[0];
+  return rect_ranges(image_offset,row_size,region[1],region[2]
+                     ,image->get_image_row_pitch(),image->get_image_slice_pitch());
+}
+
+// Copy the rows of a rectangle between host memory and the mapped buffer
+// object
+static void
+rw_buffer_rect(device* device,memory* buffer,size_t buffer_offset,size_t host_offset,const size_t* region
+               ,size_t buffer_row_pitch,size_t buffer_slice_pitch,size_t host_row_pitch,size_t host_slice_pitch
+               ,char* read_to,const char* write_from)
+{
+  auto boh = buffer->get_buffer_object_or_error(device);
+  auto xdevice = device->get_xrt_device();
+  auto buffer_data = static_cast<char*>(xdevice->map(boh));
+
+  for (size_t j=0; j<region[2]; ++j) {
+    for (size_t i=0; i<region[1]; ++i) {
+      auto buffer_ptr = buffer_data + buffer_offset + j*buffer_slice_pitch + i*buffer_row_pitch;
+      auto host_row = host_offset + j*host_slice_pitch + i*host_row_pitch;
       if (read_to)
-        read_to += slice_pitch;
+        std::memcpy(read_to+host_row,buffer_ptr,region[0]);
       else
-        write_from += slice_pitch;
+        std::memcpy(buffer_ptr,write_from+host_row,region[0]);
     }
   }
+
+  xdevice->unmap(boh);
+}
+
+void
+device::
+write_buffer_rect(memory* buffer,size_t buffer_offset,size_t host_offset,const size_t* region
+                  ,size_t buffer_row_pitch,size_t buffer_slice_pitch,size_t host_row_pitch,size_t host_slice_pitch
+                  ,const void* ptr)
+{
+  auto lk = buffer->lock_migration();
+  rw_buffer_rect(this,buffer,buffer_offset,host_offset,region,buffer_row_pitch,buffer_slice_pitch
+                 ,host_row_pitch,host_slice_pitch,nullptr,static_cast<const char*>(ptr));
+
+  // Range spanned by the written rectangle
+  buffer->add_dirty_range
+    (buffer_offset,(region[2]-1)*buffer_slice_pitch+(region[1]-1)*buffer_row_pitch+region[0]);
+
+  // Sync newly written rows to device if buffer is resident
+  if (buffer->is_resident(this) && !buffer->is_p2p_memory()) {
+    auto boh = buffer->get_buffer_object_or_error(this);
+    get_xrt_device()->sync(boh,rect_ranges(buffer_offset,region[0],region[1],region[2],buffer_row_pitch,buffer_slice_pitch)
+                           ,xrt::hal::device::direction::HOST2DEVICE);
+  }
+}
+
+void
+device::
+read_buffer_rect(memory* buffer,size_t buffer_offset,size_t host_offset,const size_t* region
+                 ,size_t buffer_row_pitch,size_t buffer_slice_pitch,size_t host_row_pitch,size_t host_slice_pitch
+                 ,void* ptr)
+{
+  // Sync rows to read back from device if buffer is resident and the
+  // host copy is stale
+  if (buffer->is_resident(this) && !buffer->is_host_valid() && !buffer->is_p2p_memory()) {
+    auto boh = buffer->get_buffer_object_or_error(this);
+    get_xrt_device()->sync(boh,rect_ranges(buffer_offset,region[0],region[1],region[2],buffer_row_pitch,buffer_slice_pitch)
+                           ,xrt::hal::device::direction::DEVICE2HOST);
+  }
+
+  rw_buffer_rect(this,buffer,buffer_offset,host_offset,region,buffer_row_pitch,buffer_slice_pitch
+                 ,host_row_pitch,host_slice_pitch,static_cast<char*>(ptr),nullptr);
 }
 
 void
@@ -1018,10 +1575,10 @@ write_image(memory* image,const size_t* origin,const size_t* region,size_t row_p
   // Write from ptr into image
   rw_image(this,image,origin,region,row_pitch,slice_pitch,nullptr,static_cast<const char*>(ptr));
 
-  // Sync newly writte data to device if image is resident
+  // Sync newly written rows to device if image is resident
   if (image->is_resident(this)) {
     auto boh = image->get_buffer_object_or_error(this);
-    get_xrt_device()->sync(boh, image->get_size(), 0,xrt::hal::device::direction::HOST2DEVICE,false);
+    get_xrt_device()->sync(boh,image_ranges(image,origin,region),xrt::hal::device::direction::HOST2DEVICE);
   }
 }
 
@@ -1029,10 +1586,10 @@ void
 device::
 read_image(memory* image,const size_t* origin,const size_t* region,size_t row_pitch,size_t slice_pitch,void *ptr)
 {
-  // Sync back from device if image is resident
+  // Sync rows to read back from device if image is resident
   if (image->is_resident(this)) {
     auto boh = image->get_buffer_object_or_error(this);
-    get_xrt_device()->sync(boh,image->get_size(),0,xrt::hal::device::direction::DEVICE2HOST,false);
+    get_xrt_device()->sync(boh,image_ranges(image,origin,region),xrt::hal::device::direction::DEVICE2HOST);
   }
 
   // Now read from image into ptr
@@ -1087,6 +1644,7 @@ load_program(program* program)
     throw xocl::error(CL_OUT_OF_RESOURCES,"cannot load program on sub device");
 
   std::lock_guard<std::mutex> lock(m_mutex);
+  std::unique_lock<std::mutex> load_lock(load_program_mutex);
 
   if (m_active && !std::getenv("XCL_CONFORMANCE"))
     throw xocl::error(CL_OUT_OF_RESOURCES,"program already loaded on device");
@@ -1156,7 +1714,9 @@ load_program(program* program)
   // programmming
   if (xrt::config::get_xclbin_programing()) {
     auto header = reinterpret_cast<const xclBin *>(binary_data.first);
+    load_lock.unlock();
     auto xbrv = xdevice->loadXclBin(header);
+    load_lock.lock();
     if (xbrv.valid() && xbrv.get()){
       if(xbrv.get() == -EACCES)
         throw xocl::error(CL_INVALID_PROGRAM,"Failed to load xclbin. Invalid DNA");
@@ -74,6 +74,20 @@ public:
    */
   device(platform* pltf, xrt::device* swem_device, xrt::device* hwem_device);
 
+  /**
+   * Open a hw device ahead of construction
+   *
+   * Opening a card and starting its DMA threads is the slow part of
+   * constructing a hw device.  The platform opens all cards
+   * concurrently with this function, the constructor then finds the
+   * card already open.
+   *
+   * @param hw_device
+   *   The underlying xrt device managed by the platform
+   */
+  static void
+  open(xrt::device* hw_device);
+
   /**
    * Sub device constructor
    *
@@ -385,6 +399,26 @@ public:
   void
   migrate_buffer(memory* buffer,cl_mem_migration_flags flags);
 
+  /**
+   * Migrate buffer to this device unless it is already resident
+   *
+   * Used for kernel arguments.  Waits for a prefetch of the buffer
+   * in progress and does not transfer it again.
+   */
+  void
+  make_resident(memory* buffer);
+
+  /**
+   * Migrate buffer to this device in the background (xclPrefetchMemObjects)
+   *
+   * The migration is queued to the DMA write workers and holds the
+   * migration lock of the buffer while it runs, later operations on
+   * the buffer wait for it.  Buffers that are resident, have no buffer
+   * object on this device, or are p2p buffers are skipped.
+   */
+  void
+  prefetch_buffer(memory* buffer);
+
   /**
    * Write data size bytes to buffer at specified offset
    *
@@ -462,17 +496,56 @@ public:
   void
   fill_buffer(memory* buffer, const void* pattern, size_t pattern_size, size_t offset, size_t size);
 
+  /**
+   * Write a rectangle of host memory to a buffer
+   *
+   * The rows are copied to the buffer object and, if the buffer is
+   * resident, synced to device with one vectored sync.
+   *
+   * @param buffer_offset
+   *  Byte offset in buffer of the rectangle origin
+   * @param host_offset
+   *  Byte offset in host memory of the rectangle origin
+   * @param region
+   *  Width in bytes, rows, and slices of the rectangle
+   */
+  void
+  write_buffer_rect(memory* buffer,size_t buffer_offset,size_t host_offset,const size_t* region
+                    ,size_t buffer_row_pitch,size_t buffer_slice_pitch,size_t host_row_pitch,size_t host_slice_pitch
+                    ,const void* ptr);
+
+  /**
+   * Read a rectangle of a buffer to host memory
+   *
+   * If the buffer is resident and its host copy is stale, the rows are
+   * first synced from device with one vectored sync.  Arguments are as
+   * for write_buffer_rect().
+   */
+  void
+  read_buffer_rect(memory* buffer,size_t buffer_offset,size_t host_offset,const size_t* region
+                   ,size_t buffer_row_pitch,size_t buffer_slice_pitch,size_t host_row_pitch,size_t host_slice_pitch
+                   ,void* ptr);
+
   void
   write_image(memory* image,const size_t* origin,const size_t* region,size_t row_pitch,size_t slice_pitch,const void *ptr);
 
   void
   read_image(memory* image,const size_t* origin,const size_t* region,size_t row_pitch,size_t slice_pitch,void *ptr);
 
+  /**
+   * Open the hardware queues of a stream
+   *
+   * A read stream gets one queue, a write stream gets up to
+   * Runtime.stream_write_queues queues for the same route.
+   *
+   * @streams: vector to receive the queue handles
+   * Return: 0 if at least one queue was opened, error otherwise
+   */
   int
-  get_stream(xrt::device::stream_flags flags, xrt::device::stream_attrs attrs, const cl_mem_ext_ptr_t* ext, xrt::device::stream_handle* stream, int32_t& m_conn);
+  get_stream(xrt::device::stream_flags flags, xrt::device::stream_attrs attrs, const cl_mem_ext_ptr_t* ext, std::vector<xrt::device::stream_handle>& streams, int32_t& m_conn);
 
   int
-  close_stream(xrt::device::stream_handle stream, int connidx);
+  close_stream(const std::vector<xrt::device::stream_handle>& streams, int connidx);
 
   ssize_t
   write_stream(xrt::device::stream_handle stream, const void* ptr, size_t offset, size_t size, xrt::device::stream_xfer_req* req);
@@ -480,6 +553,18 @@ public:
   ssize_t
   read_stream(xrt::device::stream_handle stream, void* ptr, size_t offset, size_t size, xrt::device::stream_xfer_req* req);
 
+  /**
+   * Write or read the buffers of @vec as one stream request
+   *
+   * The buffers are transferred in place, they are not staged through
+   * the pinned ring used by write_stream and read_stream.
+   */
+  ssize_t
+  write_streamv(xrt::device::stream_handle stream, const cl_stream_iovec* vec, size_t num, xrt::device::stream_xfer_req* req);
+
+  ssize_t
+  read_streamv(xrt::device::stream_handle stream, const cl_stream_iovec* vec, size_t num, xrt::device::stream_xfer_req* req);
+
   xrt::device::stream_buf
   alloc_stream_buf(size_t size, xrt::device::stream_buf_handle* handle);
 
@@ -686,6 +771,23 @@ private:
   void
   set_xrt_device(const xocl::xclbin& xclbin);
 
+  /**
+   * Get a free staging slot for a blocking stream transfer of ptr
+   *
+   * Return: nullptr if the transfer should not be staged
+   */
+  char*
+  acquire_stream_slot(const void* ptr, size_t size, const xrt::device::stream_xfer_req* req);
+
+  void
+  release_stream_slot(char* slot);
+
+  /**
+   * Fill buffer range through host memory
+   */
+  void
+  fill_host(memory* buffer, const void* pattern, size_t pattern_size, size_t offset, size_t size);
+
   /**
    * Track mem object as allocated on this device
    */
@@ -750,6 +852,14 @@ private:
   // Track memory objects allocated on this device
   std::set<const memory*> m_memobjs;
 
+  // Pinned stream buffers allocated by alloc_stream_buf, and a ring
+  // of such buffers used to stage blocking transfers of other memory
+  // so that steady state streaming does not pin pages per request
+  std::map<const char*,std::pair<size_t,xrt::device::stream_buf_handle>> m_stream_bufs;
+  std::vector<std::pair<xrt::device::stream_buf_handle,char*>> m_stream_ring;
+  std::vector<char*> m_stream_ring_free;
+  bool m_stream_ring_init = false;
+
   // CUs populated during load_program or by sub device contructor.
   compute_unit_vector_type m_computeunits;
 
@@ -21,11 +21,15 @@
 #include "xrt/config.h"
 #include "xrt/util/task.h"
 #include "xrt/util/memory.h"
+#include "xrt/util/time.h"
 
 #include "xocl/api/plugin/xdp/profile.h"
 
 #include <iostream>
 #include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 namespace {
 
@@ -50,6 +54,52 @@ to_string(cl_int status)
 
 static xocl::event::event_callback_list sg_constructor_callbacks;
 static xocl::event::event_callback_list sg_destructor_callbacks;
+
+// Max number of released events kept on a freelist
+constexpr size_t freelist_capacity = 1024;
+
+// Max number of event sizes with a freelist.  There is one size per
+// combination of event classes, see create_event
+constexpr size_t max_sizes = 16;
+
+using freelist_type = xrt::task::bounded_ring<void*>;
+
+// Freelists are looked up by event size in a fixed table, where a
+// slot is claimed by a size with a CAS, so lookup never locks.  The
+// freelists are intentionally never deleted, events can be released
+// during static destruction.
+struct slot_type
+{
+  std::atomic<size_t> size {0};
+  std::atomic<freelist_type*> freelist {nullptr};
+};
+
+static slot_type s_slots[max_sizes];
+
+static freelist_type*
+get_freelist(size_t size)
+{
+  for (auto& slot : s_slots) {
+    auto sz = slot.size.load();
+    if (!sz && slot.size.compare_exchange_strong(sz,size)) {
+      auto freelist = new freelist_type(freelist_capacity);
+      slot.freelist = freelist;
+      return freelist;
+    }
+
+    if (sz==size) {
+      // wait for claiming thread to create the freelist
+      freelist_type* freelist = nullptr;
+      while (!(freelist=slot.freelist.load()))
+        std::this_thread::yield();
+      return freelist;
+    }
+  }
+
+  // no freelist, event is allocated and deleted on the heap
+  return nullptr;
+}
+
 } // namespace
 
 namespace xocl {
@@ -72,6 +122,7 @@ event::
 event(command_queue* cq, context* ctx, cl_command_type cmd, cl_uint num_deps, const cl_event* deps)
   : event(cq,ctx,cmd)
 {
+  m_deps.reserve(num_deps);
   for (auto dep : get_range(deps,deps+num_deps)) {
     XOCL_DEBUG(std::cout,"event(",m_uid,") depends on event(",xocl(dep)->get_uid(),")\n");
     xocl(dep)->chain(this);
@@ -88,6 +139,27 @@ event::
     cb(this);
 }
 
+void*
+event::
+operator new(size_t sz)
+{
+  void* ptr = nullptr;
+  auto freelist = get_freelist(sz);
+  if (freelist && freelist->try_pop(ptr))
+    return ptr;
+  return ::operator new(sz);
+}
+
+void
+event::
+operator delete(void* ptr, size_t sz)
+{
+  // storage is released if the freelist is full
+  auto freelist = get_freelist(sz);
+  if (!freelist || !freelist->try_push(std::move(ptr)))
+    ::operator delete(ptr);
+}
+
 cl_int
 event::
 set_status(cl_int s)
@@ -102,6 +174,9 @@ set_status(cl_int s)
   bool complete = (s==CL_COMPLETE);
   ptr<xocl::event> retain(complete?this:nullptr);
 
+  // Dependencies are released upon completion, outside the lock
+  event_vector_type deps;
+
   {
     std::lock_guard<std::mutex> lk(m_mutex);
 
@@ -117,12 +192,18 @@ set_status(cl_int s)
 
     std::swap(m_status,s);
     time_set(m_status);
+    if (m_status<=0)
+      m_done.store(true,std::memory_order_release);
+
+    if (complete)
+      deps.swap(m_deps);
   } // lk
 
   //Make the profile logging calls before notifying the event
   //and before removing it from queue. Otherwise the main could exit
   //deleting datastrucutres while the profile call is ongoing (CR-1003505)
-  profile::log(this,m_status);
+  if (m_profile_action)
+    profile::log(this,m_status);
 
   if (complete) {
     // Run callbacks before notifying the event and before removing it from queue
@@ -136,8 +217,20 @@ set_status(cl_int s)
     // remove the completed event from queue (submitted queue)
     // before event_scheduler attempts to submit next event.
     queue_remove();   // 1 (order matters)
+
+    // Submit all chained events that are ready before triggering any
+    // of them.  Actions of events without an execution context only
+    // schedule work on device queues, they are triggered first so that
+    // independent transfers start before the NDRange executions, which
+    // start compute units from this thread.
+    std::vector<event*> ready;
     for (auto& c : m_chain) // not a race, since m_chain is blocked by CL_COMPLETE
-      c->submit();
+      if (c->submit_status() && c->is_hard())
+        ready.push_back(c.get());
+    std::stable_partition(ready.begin(),ready.end()
+                          ,[](event* ev) { return ev->get_execution_context()==nullptr; });
+    for (auto ev : ready)
+      ev->trigger_enqueue_action();
   }
 
   return s;
@@ -154,13 +247,18 @@ queue(bool blocking_submit)
     if (queued) {
       XOCL_DEBUG(std::cout,"event(",m_uid,") [",to_string(m_status),"->",to_string(CL_QUEUED),"]\n");
       m_status = CL_QUEUED;
-      profile::log(this,m_status);
+      if (m_profile_action)
+        profile::log(this,m_status);
       time_set(CL_QUEUED);
     }
   }
 
   assert(queued);
 
+  // Start NDRange execution before dependencies complete if possible
+  if (m_execution_context && !m_deps.empty())
+    execute_ahead();
+
   // Submit the event now if possible (event is created with wait_count=1)
   submit();
 
@@ -177,6 +275,19 @@ queue(bool blocking_submit)
 bool
 event::
 submit()
+{
+  if (!submit_status())
+    return false;
+
+  if (is_hard())
+    trigger_enqueue_action();
+
+  return true;
+}
+
+bool
+event::
+submit_status()
 {
   {
     std::lock_guard<std::mutex> lk(m_mutex);
@@ -190,15 +301,12 @@ submit()
 
     XOCL_DEBUG(std::cout,"event(",m_uid,") [",to_string(m_status),"->",to_string(CL_SUBMITTED),"]\n");
     m_status = CL_SUBMITTED;
-    profile::log(this,m_status);
+    if (m_profile_action)
+      profile::log(this,m_status);
     time_set(CL_SUBMITTED);
   }
 
   m_event_submitted.notify_all();
-
-  if (is_hard())
-    trigger_enqueue_action();
-
   return true;
 }
 
@@ -227,6 +335,7 @@ abort(cl_int status,bool fatal)
     // Only abort queued events unless fatal abort
     if (abort_ev==this && (fatal || abort_ev->m_status==CL_QUEUED)) {
       abort_ev->m_status = status;  // abort ev
+      abort_ev->m_done.store(true,std::memory_order_release);
       abort_ev->queue_abort(fatal); // remove from queue if any
       m_event_complete.notify_all();
     }
@@ -249,6 +358,17 @@ event::
 wait() const
 {
   XOCL_DEBUG(std::cout,"xocl::event::wait(",m_uid,")\n");
+
+  // Completion within the spin budget is observed without the waiter
+  // being woken up through the condition variable
+  if (auto spin_ns = m_command_queue.get() ? m_command_queue->get_wait_spin_ns() : 0) {
+    auto end = xrt::time_ns() + spin_ns;
+    do {
+      if (m_done.load(std::memory_order_acquire))
+        return;
+    } while (xrt::time_ns() < end);
+  }
+
   std::unique_lock<std::mutex> lk(m_mutex);
   while (m_status>0)  // (<0 => aborted) (==0 => CL_COMPLETE)
     m_event_complete.wait(lk);
@@ -278,6 +398,11 @@ void
 event::
 run_callbacks(cl_int status)
 {
+  // Callbacks are not added once the event is complete, so when
+  // called upon completion there is no need to lock for the check
+  if (status==CL_COMPLETE && !m_callbacks)
+    return;
+
   {
     std::lock_guard<std::mutex> lk(m_mutex);
     if (!m_callbacks)
@@ -328,6 +453,7 @@ chain(event* ev)
     return;
   m_chain.push_back(ev);
   ++ev->m_wait_count;
+  ev->m_deps.push_back(this);
 }
 
 bool
@@ -345,6 +471,35 @@ waits_on(const event* ev) const
   return ev->chains(this);
 }
 
+bool
+event::
+execute_ahead()
+{
+  // Execution contexts of dependencies.  A kernel argument migration
+  // event is looked through, its execution context checks that the
+  // migration has nothing to transfer
+  std::vector<execution_context*> ecs;
+  for (auto& dep : m_deps) {
+    if (auto ec = dep->get_execution_context()) {
+      ecs.push_back(ec);
+      continue;
+    }
+
+    if (dep->get_command_type()!=CL_COMMAND_MIGRATE_MEM_OBJECTS)
+      return false;
+
+    std::lock_guard<std::mutex> lk(dep->m_mutex);
+    for (auto& mdep : dep->m_deps) {
+      auto ec = mdep->get_execution_context();
+      if (!ec)
+        return false;
+      ecs.push_back(ec);
+    }
+  }
+
+  return m_execution_context->execute_ahead(ecs);
+}
+
 bool
 event::
 queue_queue()
@@ -361,7 +516,7 @@ queue_queue()
     return true;
   }
 
-  return (m_command_queue->queue(this));
+  return (m_command_queue->queue(this,m_queue_ahead));
 }
 
 bool
@@ -27,6 +27,7 @@
 
 #include "xrt/config.h"
 
+#include <atomic>
 #include <vector>
 #include <functional>
 #include <iostream>
@@ -64,6 +65,16 @@ public:
   event(command_queue* cq, context* ctx, cl_command_type cmd, cl_uint num_deps, const cl_event* deps);
   virtual ~event();
 
+  /**
+   * Events are allocated from freelists, one per event type size,
+   * so that the storage of released events is recycled.
+   */
+  static void*
+  operator new(size_t sz);
+
+  static void
+  operator delete(void* ptr, size_t sz);
+
   /**
    */
   unsigned int
@@ -104,6 +115,16 @@ public:
     m_enqueue_action = std::move(action);
   }
 
+  /**
+   * @return
+   *   The enqueue action of this event, empty if none
+   */
+  const action_enqueue_type&
+  get_enqueue_action() const
+  {
+    return m_enqueue_action;
+  }
+
   /**
    * Trigger the enqueue action if any.
    *
@@ -365,6 +386,19 @@ public:
     m_execution_context = std::move(ec);
   }
 
+  /**
+   * Queue this event ahead of the commands already queued
+   *
+   * The event is not ordered after the last event of an in-order
+   * queue, it waits only for its explicit dependencies.  Used for
+   * migration of NDRange arguments, see command_queue::queue().
+   */
+  void
+  set_queue_ahead()
+  {
+    m_queue_ahead = true;
+  }
+
   /**
    * @return
    *   The execution context asssociated with this event, or nullptr
@@ -411,6 +445,17 @@ private:
   bool
   submit();
 
+  /**
+   * Mark this event submitted if it waits on no more events
+   *
+   * The enqueue action is not triggered, see submit().
+   *
+   * @return
+   *   true if submitted, false otherwise.
+   */
+  bool
+  submit_status();
+
   /**
    * Check if this event chains argument event
    */
@@ -428,6 +473,20 @@ private:
   bool
   waits_on(const event* ev) const;
 
+  /**
+   * Start execution context of this event ahead of its dependencies
+   *
+   * Succeeds if the dependencies, possibly through a kernel argument
+   * migration event, are NDRange events whose commands can be waited
+   * on by the scheduler.  The event itself remains queued until
+   * its dependencies complete.
+   *
+   * @return
+   *   true if execution was started, false otherwise
+   */
+  bool
+  execute_ahead();
+
   /**
    * If a profiling event, then record time at status change
    *
@@ -507,7 +566,11 @@ private:
   std::unique_ptr<execution_context> m_execution_context;
 
   cl_int m_status = -1;
+  // Set with m_status when the event completes or is aborted, waits
+  // spin on it without the lock
+  std::atomic<bool> m_done {false};
   cl_command_type m_command_type = 0;
+  bool m_queue_ahead = false;
   mutable std::mutex m_mutex;
   mutable std::condition_variable m_event_complete;
   mutable std::condition_variable m_event_submitted;
@@ -522,6 +585,10 @@ private:
   // Number of events this event is waiting on.  This includes
   // explicit event depedencies and events that chain this
   unsigned int m_wait_count = 0;
+
+  // Events this event is waiting on, released upon completion.
+  // Used to start execution ahead of dependencies
+  event_vector_type m_deps;
 };
 
 /**
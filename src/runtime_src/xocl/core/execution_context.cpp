@@ -20,14 +20,22 @@
 
 #include "xrt/scheduler/command.h"
 #include "xrt/scheduler/scheduler.h"
+#include "xrt/util/config_reader.h"
 
 #include "impl/spir.h"
 
 #include <iostream>
 #include <fstream>
+#include <cstring>
+#include <map>
+#include <mutex>
 
 namespace {
 
+// Limits of command chaining in the kernel driver scheduler
+constexpr size_t max_wait_list = 8; // commands a command can wait on
+constexpr size_t max_chain = 8;     // commands that can wait on a command
+
 const char*
 value_or_empty(const char* value)
 {
@@ -36,24 +44,31 @@ value_or_empty(const char* value)
 
 ////////////////////////////////////////////////////////////////
 // Conformance mode testing.
-// Save currently executing contexts (s_active).
-// Save context that want to use a diferent program (s_pending)
+// Save currently executing contexts per device (active).
+// Save context that want to use a diferent program (pending)
 ////////////////////////////////////////////////////////////////
 namespace conformance {
 
-// Global conformance mutex to ensure that exactly one thread
-// at a time can do context switching (reconfig).  The recursive
-// mutex allows conformance_done() to lock and still be able to call
-// conformance_execute().  Note that conformance_execute() has two
+// Contexts of one device.  The recursive mutex ensures that exactly
+// one thread at a time can do context switching (reconfig) of the
+// device and allows conformance_done() to lock and still be able to
+// call conformance_execute().  Note that conformance_execute() has two
 // entry points, one from event trigger action and second from
 // conformance::try_pending() which is called from conformance_done().
-static std::recursive_mutex s_mutex;
+// Contexts of different devices do not wait for each other.
+struct device_contexts
+{
+  std::recursive_mutex mutex;
 
-// Active contexts are those executing using currently loaded program
-static std::vector<xocl::execution_context*> s_active;
+  // Active contexts are those executing using currently loaded program
+  std::vector<xocl::execution_context*> active;
 
-// Pending contexts are those waiting to reconfigure the device
-static std::vector<xocl::execution_context*> s_pending;
+  // Pending contexts are those waiting to reconfigure the device
+  std::vector<xocl::execution_context*> pending;
+};
+
+static std::mutex s_mutex; // guards s_devices
+static std::map<const xocl::device*,device_contexts> s_devices;
 
 inline bool
 on()
@@ -62,50 +77,59 @@ on()
   return conf;
 }
 
+// Get the contexts of a device, map nodes are stable so the
+// returned reference is valid for the life of the process
+static device_contexts&
+get(const xocl::device* device)
+{
+  std::lock_guard<std::mutex> lk(s_mutex);
+  return s_devices[device];
+}
+
 // Add context to pending list if and only if there are
-// current active contexts.
+// current active contexts on the device.
 // @return true if context is added as pending, false otherwise
 static bool
-pending(xocl::execution_context* ctx)
+pending(device_contexts& dc, xocl::execution_context* ctx)
 {
-  if (s_active.empty())
+  if (dc.active.empty())
     return false;
 
-  s_pending.push_back(ctx);
+  dc.pending.push_back(ctx);
   return true;
 }
 
 // Add context to active list of execution contexts
 // @return true
 static bool
-active(xocl::execution_context* ctx)
+active(device_contexts& dc, xocl::execution_context* ctx)
 {
-  s_active.push_back(ctx);
+  dc.active.push_back(ctx);
   return true;
 }
 
 // Remove context from active list of execution contexts
 // @return true
 static bool
-remove(xocl::execution_context* ctx)
+remove(device_contexts& dc, xocl::execution_context* ctx)
 {
-  auto itr = std::find(s_active.begin(),s_active.end(),ctx);
-  assert(itr!=s_active.end()); // return false;
-  s_active.erase(itr);
+  auto itr = std::find(dc.active.begin(),dc.active.end(),ctx);
+  assert(itr!=dc.active.end()); // return false;
+  dc.active.erase(itr);
   return true;
 }
 
-// Try execute pending contexts
+// Try execute pending contexts of a device
 // @return false if no pending contexts or there are active ones,
 // true if execution was tried on all pending contexts
 static bool
-try_pending()
+try_pending(device_contexts& dc)
 {
   std::vector<xocl::execution_context*> pending;
-  if (!s_active.empty() || s_pending.empty())
+  if (!dc.active.empty() || dc.pending.empty())
     return false;
-  pending = s_pending;
-  s_pending.clear();
+  pending = dc.pending;
+  dc.pending.clear();
   for (auto ctx : pending)
     ctx->execute();
   return true;
@@ -153,7 +177,7 @@ struct execution_context::start_kernel : xrt::command
 {
 public:
   start_kernel(xrt::device* xdevice, xocl::execution_context* ec)
-    : xrt::command(xdevice,ERT_START_KERNEL), m_ec(ec)
+    : xrt::command(xdevice,ERT_START_KERNEL), m_ec(ec), m_chained(0)
   {}
   virtual void start() const
   {
@@ -165,6 +189,10 @@ public:
     m_ec->done(this);
   }
   mutable xocl::execution_context* m_ec;
+
+  // Number of commands started with this command in their wait list,
+  // guarded by m_ec mutex
+  size_t m_chained;
 };
 
 struct execution_context::start_kernel_conformance : start_kernel
@@ -260,7 +288,7 @@ add_compute_units(device* device)
 
 bool
 execution_context::
-write(const command_type& cmd)
+write(const command_type& cmd, std::vector<command_type>* batch)
 {
   auto& packet = cmd->get_packet();
   auto data_size = packet.size() - 1; // subtract header
@@ -290,7 +318,10 @@ write(const command_type& cmd)
       ostr << "0x" << std::uppercase << std::setfill('0') << std::setw(8) << std::hex << packet[i] << std::dec << "\n";
   }
 
-  xrt::scheduler::schedule(cmd);
+  if (batch)
+    batch->push_back(cmd);
+  else
+    xrt::scheduler::schedule(cmd);
   return true;
 }
 
@@ -319,6 +350,7 @@ encode_compute_units(packet_type& packet)
   // write extra cu mask count to header [11:10]
   auto epacket = reinterpret_cast<ert_start_kernel_cmd*>(packet.data());
   epacket->extra_cu_masks = no_of_masks-1;
+  epacket->priority = xrt::config::get_kds_priority();
 }
 
 const compute_unit*
@@ -353,13 +385,14 @@ update_work()
 
 void
 execution_context::
-start()
+start(const std::vector<command_type>& waitlist, std::vector<command_type>* batch)
 {
   XOCL_DEBUGF("execution_context(%d) starting workgroup(%d,%d,%d)\n"
               ,get_uid(),m_cu_group_id[0],m_cu_group_id[1],m_cu_group_id[2]);
 
-  // On first work load, transition event to CL_RUNNING
-  if ( (m_cu_group_id[0]==0) && (m_cu_group_id[1]==0) && (m_cu_group_id[2]==0))
+  // On first work load, transition event to CL_RUNNING.  When running
+  // ahead the event is still queued, see execute()
+  if (!m_ahead && (m_cu_group_id[0]==0) && (m_cu_group_id[1]==0) && (m_cu_group_id[2]==0))
     m_event->set_status(CL_RUNNING);
 
   auto xdevice = m_device->get_xrt_device();
@@ -385,37 +418,61 @@ start()
       num_workgroups[d] = m_gsize[d]/m_lsize[d];
   }
 
-  // Push kernel args
+  // Push kernel args.  Start from the regmap of the previous launch on
+  // the same CUs and encode only the args that were set since then
   xocl::memory* printf_buffer = nullptr;
-  for (auto& arg : m_kernel_args) {
-    if (arg->is_printf()) {
-      printf_buffer = arg->get_memory_object();
-      assert(printf_buffer);
-      continue;
+  {
+    std::vector<uint32_t> cumasks(packet.data()+1,packet.data()+offset);
+    std::lock_guard<std::mutex> lk(m_kernel->get_regmap_mutex());
+    auto& tmpl = m_kernel->get_regmap_template(m_device,cumasks);
+    if (tmpl.versions.size() != m_kernel_args.size())
+      tmpl.versions.assign(m_kernel_args.size(),std::numeric_limits<unsigned long>::max());
+    if (!tmpl.words.empty()) {
+      std::memcpy(packet.data()+offset,tmpl.words.data(),tmpl.words.size()*sizeof(uint32_t));
+      packet.resize(offset+tmpl.words.size());
     }
 
-    auto address_space = arg->get_address_space();
-    if (address_space == SPIR_ADDRSPACE_PRIVATE)
-    {
-      auto arginforange = arg->get_arginfo_range();
-      fill_regmap(regmap,offset,arg->get_value(),arg->get_size(),arginforange);
-    } else if(address_space==SPIR_ADDRSPACE_PIPES) {
-	//do nothing
-    } else if (address_space==SPIR_ADDRSPACE_GLOBAL
-             || address_space==SPIR_ADDRSPACE_CONSTANT)
-    {
-      uint64_t physaddr = 0;
-      if (auto mem = arg->get_memory_object()) {
-        auto boh = xocl::xocl(mem)->get_buffer_object_or_error(m_device);
-        physaddr = xdevice->getDeviceAddr(boh);
+    bool dirty = false;
+    size_t argno = 0;
+    for (auto& arg : m_kernel_args) {
+      auto& version = tmpl.versions[argno++];
+      if (arg->is_printf()) {
+        printf_buffer = arg->get_memory_object();
+        assert(printf_buffer);
+        continue;
       }
-      else if (auto svm = arg->get_svm_object()) {
-        physaddr = reinterpret_cast<uint64_t>(svm);
+
+      if (version == arg->get_version())
+        continue;
+      version = arg->get_version();
+      dirty = true;
+
+      auto address_space = arg->get_address_space();
+      if (address_space == SPIR_ADDRSPACE_PRIVATE)
+      {
+        auto arginforange = arg->get_arginfo_range();
+        fill_regmap(regmap,offset,arg->get_value(),arg->get_size(),arginforange);
+      } else if(address_space==SPIR_ADDRSPACE_PIPES) {
+        //do nothing
+      } else if (address_space==SPIR_ADDRSPACE_GLOBAL
+               || address_space==SPIR_ADDRSPACE_CONSTANT)
+      {
+        uint64_t physaddr = 0;
+        if (auto mem = arg->get_memory_object()) {
+          auto boh = xocl::xocl(mem)->get_buffer_object_or_error(m_device);
+          physaddr = xdevice->getDeviceAddr(boh);
+        }
+        else if (auto svm = arg->get_svm_object()) {
+          physaddr = xdevice->getSVMDeviceAddr(svm);
+        }
+        auto arginforange = arg->get_arginfo_range();
+        assert(arginforange.size()==1);
+        fill_regmap(regmap,offset,&physaddr, arg->get_size(), arginforange);
       }
-      auto arginforange = arg->get_arginfo_range();
-      assert(arginforange.size()==1);
-      fill_regmap(regmap,offset,&physaddr, arg->get_size(), arginforange);
     }
+
+    if (dirty)
+      tmpl.words.assign(packet.data()+offset,packet.data()+packet.size());
   }
 
   for (auto& arg : m_kernel->get_progvar_argument_range()) {
@@ -476,21 +533,43 @@ start()
       fill_regmap(regmap,offset,&printf_buffer_addr,sizeof(printf_buffer_addr),arg->get_arginfo_range());
   }
 
-  // send command to mbs
-  write(cmd);
+  // send command to mbs, the command is active once it is scheduled
+  // so that it can be waited on by other contexts
+  if (!waitlist.empty())
+    cmd->set_wait_list(waitlist);
+  write(cmd,batch);
+  m_commands.push_back(std::move(cmd));
+}
+
+void
+execution_context::
+remove_command(const xrt::command* cmd)
+{
+  auto itr = std::find_if(m_commands.begin(),m_commands.end()
+                          ,[cmd](const std::shared_ptr<start_kernel>& c) { return c.get()==cmd; });
+  if (itr!=m_commands.end())
+    m_commands.erase(itr);
 }
 
 bool
 execution_context::
-done(const xrt::command*)
+done(const xrt::command* cmd)
 {
   // Care must be taken not to mark event complete and later reference
   // any data members of context which is owned (and deleted) with event
   bool ctx_done = false;
+  bool more = false;
   {
     std::lock_guard<std::mutex> lk(m_mutex);
-    if (--m_active==0 && m_done)
-      ctx_done=true;
+    remove_command(cmd);
+    if (--m_active==0 && m_done) {
+      // event completes when submitted if running ahead
+      if (m_ahead && !m_ahead_submitted)
+        m_ahead_complete = true;
+      else
+        ctx_done=true;
+    }
+    more = !m_done;
   }
 
   // Only one thread will be able to set local ctx_done to true, so it's
@@ -501,14 +580,100 @@ done(const xrt::command*)
   }
 
   // execute more workgroups if necessary
-  execute();
+  if (more)
+    execute();
   return false;
 }
 
+bool
+execution_context::
+execute_ahead(const std::vector<execution_context*>& deps)
+{
+  static bool chain = xrt::config::get_kds_chain_commands();
+  if (!chain || conformance::on())
+    return false;
+
+  if (!xrt::scheduler::has_wait_list(m_device->get_xrt_device()))
+    return false;
+
+  // All workgroups must be started at once
+  auto num = get_num_work_groups();
+  if (!num || num>2*m_cus.size() || num>max_chain)
+    return false;
+
+  // Kernel arguments must be resident so that the migration event
+  // this context may wait on has nothing to transfer
+  for (auto& arg : m_kernel_args) {
+    auto mem = arg->get_memory_object();
+    if (mem && !mem->is_resident(m_device)
+        && !(mem->get_flags() & (CL_MEM_WRITE_ONLY|CL_MEM_HOST_NO_ACCESS)))
+      return false;
+  }
+
+  std::vector<execution_context*> ecs(deps);
+  std::sort(ecs.begin(),ecs.end());
+  ecs.erase(std::unique(ecs.begin(),ecs.end()),ecs.end());
+
+  // Reserve chaining of the active commands of dependencies.  A
+  // dependency that is not fully started cannot be waited on.
+  std::vector<command_type> waitlist;
+  auto reserve = [&](execution_context* ec) {
+    std::lock_guard<std::mutex> lk(ec->m_mutex);
+    if (ec==this || ec->m_device!=m_device || !ec->m_done)
+      return false;
+    if (waitlist.size()+ec->m_commands.size()>max_wait_list)
+      return false;
+    for (auto& cmd : ec->m_commands)
+      if (cmd->m_chained+num>max_chain)
+        return false;
+    for (auto& cmd : ec->m_commands) {
+      cmd->m_chained += num;
+      waitlist.push_back(cmd);
+    }
+    return true;
+  };
+
+  if (!std::all_of(ecs.begin(),ecs.end(),reserve)) {
+    for (auto& cmd : waitlist) {
+      auto skcmd = static_cast<start_kernel*>(cmd.get());
+      std::lock_guard<std::mutex> lk(skcmd->m_ec->m_mutex);
+      skcmd->m_chained -= num;
+    }
+    return false;
+  }
+
+  XOCL_DEBUGF("execution_context(%d) starts ahead waiting on %d commands\n",get_uid(),waitlist.size());
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_ahead = true;
+  std::vector<command_type> batch;
+  while (!m_done) {
+    start(waitlist,&batch);
+    update_work();
+  }
+  xrt::scheduler::schedule(batch);
+  return true;
+}
+
 bool
 execution_context::
 execute()
 {
+  // Event is submitted after execution was started ahead
+  if (m_ahead) {
+    bool complete = false;
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      if (!m_ahead_submitted) {
+        m_ahead_submitted = true;
+        m_event->set_status(CL_RUNNING);
+        complete = m_ahead_complete;
+      }
+    }
+    if (complete)
+      m_event->set_status(CL_COMPLETE);
+    return true;
+  }
+
   // Mutual exclusion as multiple start_kernel commands could call execute.
   std::lock_guard<std::mutex> lk(m_mutex);
 
@@ -529,11 +694,17 @@ execute()
   // In order to keep scheduler busy, we need more than just one
   // workgroup at a time, so here we try to ensure that the scheduled
   // commands at any given time is twice the number of available CUs.
+  //
+  // The workgroups started here are scheduled as one batch, which
+  // the scheduler submits with one call to the driver.
   auto limit = 2*m_cus.size();
+  std::vector<command_type> batch;
   for (size_t i=m_active; !m_done && i<limit; ++i) {
-    start();
+    start({},&batch);
     update_work();
   }
+  if (!batch.empty())
+    xrt::scheduler::schedule(batch);
 
   return m_done;
 }
@@ -543,19 +714,21 @@ execute()
 ////////////////////////////////////////////////////////////////
 bool
 execution_context::
-conformance_done(const xrt::command*)
+conformance_done(const xrt::command* cmd)
 {
-  // Global conformance lock
-  std::lock_guard<std::recursive_mutex> lk(conformance::s_mutex);
+  // Device conformance lock
+  auto& dc = conformance::get(m_device);
+  std::lock_guard<std::recursive_mutex> lk(dc.mutex);
 
   // Care must be taken not to mark event complete and later reference
   // any data members of context which is owned (and deleted) with event
   bool ctx_done = false;
   {
     std::lock_guard<std::mutex> lk(m_mutex);
+    remove_command(cmd);
     if (--m_active==0) {
       assert(m_done);
-      conformance::remove(this);
+      conformance::remove(dc,this);
       ctx_done = true;
     }
   }
@@ -564,7 +737,7 @@ conformance_done(const xrt::command*)
   // safe to proceed without exclusive lock
   if (ctx_done) {
     m_event->set_status(CL_COMPLETE);
-    conformance::try_pending(); // if no active, then try execute all pending
+    conformance::try_pending(dc); // if no active, then try execute all pending
   }
 
   return true;
@@ -574,11 +747,12 @@ bool
 execution_context::
 conformance_execute()
 {
-  // Global conformance lock
-  std::lock_guard<std::recursive_mutex> lk(conformance::s_mutex);
+  // Device conformance lock
+  auto& dc = conformance::get(m_device);
+  std::lock_guard<std::recursive_mutex> lk(dc.mutex);
 
   bool same = m_kernel->get_program()==m_device->get_program();
-  if (!same && conformance::pending(this))
+  if (!same && conformance::pending(dc,this))
     return false;
 
   // Either same program or no current active running contexts
@@ -596,7 +770,7 @@ conformance_execute()
   }
 
   // Run
-  conformance::active(this);
+  conformance::active(dc,this);
   // Schedule all workgroups
   for (size_t i=0; !m_done; ++i) {
     start();
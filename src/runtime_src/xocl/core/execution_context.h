@@ -23,6 +23,7 @@
 
 #include "xrt/scheduler/command.h"
 #include <mutex>
+#include <memory>
 #include <array>
 #include <algorithm>
 #include <iostream>
@@ -105,6 +106,16 @@ private:
   // to be scheduled
   bool m_done = false;
 
+  // Active start_kernel commands, in order of scheduling
+  std::vector<std::shared_ptr<start_kernel>> m_commands;
+
+  // Execution was started ahead of dependencies, see execute_ahead().
+  // The event is marked running when it is submitted, and complete
+  // when both submitted and all commands are done
+  bool m_ahead = false;
+  bool m_ahead_submitted = false;
+  bool m_ahead_complete = false;
+
   std::mutex m_mutex;
 
   /**
@@ -113,8 +124,11 @@ private:
   void
   add_compute_units(xocl::device* device);
 
+  /**
+   * Send command to scheduler, or add it to batch if not null
+   */
   bool
-  write(const command_type& cmd);
+  write(const command_type& cmd, std::vector<command_type>* batch = nullptr);
 
   void
   encode_compute_units(packet_type& pkt);
@@ -125,8 +139,23 @@ private:
   void
   update_work();
 
+  /**
+   * Start next workgroup
+   *
+   * @param waitlist
+   *   Commands that must complete before the workgroup starts
+   * @param batch
+   *   If not null, the workgroup command is added to batch rather
+   *   than scheduled, so caller can schedule all commands at once
+   */
+  void
+  start(const std::vector<command_type>& waitlist = {}, std::vector<command_type>* batch = nullptr);
+
+  /**
+   * Remove a done command from list of active commands
+   */
   void
-  start();
+  remove_command(const xrt::command* cmd);
 
   /**
    * Callback to indicate a start_kernel command is done.
@@ -191,6 +220,15 @@ public:
     return m_kernel->get_indexed_argument_range();
   }
 
+  /**
+   * Get the kernel arguments bound to this context
+   */
+  xocl::range<argument_iterator_type>
+  get_bound_argument_range() const
+  {
+    return xocl::range<argument_iterator_type>(m_kernel_args.begin(),m_kernel_args.end());
+  }
+
   xocl::range<argument_iterator_type>
   get_progvar_argument_range() const
   {
@@ -209,6 +247,29 @@ public:
     return m_kernel.get();
   }
 
+  kernel*
+  get_kernel()
+  {
+    return m_kernel.get();
+  }
+
+  /**
+   * Create an execution context for another event
+   *
+   * The new context executes the same kernel with the same work
+   * sizes, but binds the current arguments of the kernel.
+   *
+   * @param event
+   *   The kernel event of the new context
+   */
+  std::unique_ptr<execution_context>
+  clone(event* event) const
+  {
+    return std::unique_ptr<execution_context>
+      (new execution_context(m_device,m_kernel.get(),event,m_dim
+                             ,m_goffset.data(),m_gsize.data(),m_lsize.data()));
+  }
+
   /**
    * Get the kernel event associated with this context
    *
@@ -248,6 +309,23 @@ public:
   bool
   execute();
 
+  /**
+   * Start execution context ahead of its dependencies.
+   *
+   * Called while the event is queued.  All workgroups are started
+   * with the active commands of the argument contexts in their wait
+   * list, so that the scheduler starts the workgroups as soon as
+   * the dependencies complete, without a round trip to the host.
+   *
+   * @param deps
+   *   Execution contexts this context depends on
+   * @return
+   *   true if all workgroups were started, false if execution
+   *   must wait for the event to be submitted
+   */
+  bool
+  execute_ahead(const std::vector<execution_context*>& deps);
+
 private:
   // Call back for start_kernel_conformance comands
   bool
@@ -0,0 +1,41 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "graph.h"
+#include "command_queue.h"
+#include "event.h"
+
+#include <iostream>
+
+namespace xocl {
+
+graph::
+graph(command_queue* cq, event_vector_type&& events)
+  : m_command_queue(cq), m_events(std::move(events))
+{
+  static unsigned int uid_count = 0;
+  m_uid = uid_count++;
+
+  XOCL_DEBUG(std::cout,"xocl::graph::graph(",m_uid,") with ",m_events.size()," events\n");
+}
+
+graph::
+~graph()
+{
+  XOCL_DEBUG(std::cout,"xocl::graph::~graph(",m_uid,")\n");
+}
+
+} // xocl
@@ -0,0 +1,79 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef xocl_core_graph_h_
+#define xocl_core_graph_h_
+
+#include "xocl/core/object.h"
+#include "xocl/core/refcount.h"
+#include "xocl/core/range.h"
+
+#include <vector>
+
+namespace xocl {
+
+/**
+ * A graph is the sequence of events captured on an in-order command
+ * queue between xclBeginCapture and xclEndCapture.
+ *
+ * The captured events are kept as prototypes for replay.  A replay
+ * enqueues one new event per prototype, with the prototype's
+ * enqueue action, or for NDRange events with an execution context
+ * cloned from the prototype's.  Ordering within the graph follows
+ * from the in-order queue the graph is replayed on.
+ */
+class graph : public refcount, public _cl_graph
+{
+public:
+  using event_vector_type = std::vector<ptr<event>>;
+  using event_iterator_type = event_vector_type::const_iterator;
+
+  graph(command_queue* cq, event_vector_type&& events);
+  virtual ~graph();
+
+  unsigned int
+  get_uid() const
+  {
+    return m_uid;
+  }
+
+  command_queue*
+  get_command_queue() const
+  {
+    return m_command_queue.get();
+  }
+
+  range<event_iterator_type>
+  get_event_range() const
+  {
+    return range<event_iterator_type>(m_events.begin(),m_events.end());
+  }
+
+  size_t
+  size() const
+  {
+    return m_events.size();
+  }
+
+private:
+  unsigned int m_uid = 0;
+  ptr<command_queue> m_command_queue;
+  event_vector_type m_events;
+};
+
+} // xocl
+
+#endif
@@ -20,6 +20,7 @@
 
 #include "xrt/util/memory.h"
 #include <sstream>
+#include <cstring>
 #include <iostream>
 #include <memory>
 #include <algorithm>
@@ -109,6 +110,7 @@ set(size_t size, const void* cvalue)
   auto value = const_cast<void*>(cvalue);
   m_value = { reinterpret_cast<uint8_t*>(value), reinterpret_cast<uint8_t*>(value) + size };
   m_set = true;
+  ++m_version;
 }
 
 const std::string
@@ -153,6 +155,7 @@ set(size_t size, const void* cvalue)
   if (m_argidx < std::numeric_limits<unsigned long>::max())
     m_buf->get_buffer_object(m_kernel,m_argidx);
   m_set = true;
+  ++m_version;
 }
 
 void
@@ -166,6 +169,7 @@ set_svm(size_t size, const void* cvalue)
 
   m_svm_buf = value;
   m_set = true;
+  ++m_version;
 }
 
 std::unique_ptr<kernel::argument>
@@ -187,6 +191,7 @@ set(size_t size, const void* value)
     throw xocl::error(CL_INVALID_ARG_SIZE,"CL_KERNEL_ARG_ADDRESS_LOCAL wrong size:" + std::to_string(size));
 
   m_set = true;
+  ++m_version;
 }
 
 std::unique_ptr<kernel::argument>
@@ -207,6 +212,7 @@ set(size_t size, const void* cvalue)
   m_buf = xocl(mem);
   m_buf->get_buffer_object(m_kernel,m_argidx);
   m_set = true;
+  ++m_version;
 }
 
 std::unique_ptr<kernel::argument>
@@ -254,6 +260,7 @@ set(size_t size, const void* cvalue)
   if(cvalue != nullptr)
     throw error(CL_INVALID_VALUE,"Invalid stream_argument value for kernel arg, it should be null");
   m_set = true;
+  ++m_version;
 }
 
 kernel::
@@ -265,65 +272,37 @@ kernel(program* prog, const std::string& name, const xclbin::symbol& symbol)
 
   XOCL_DEBUG(std::cout,"xocl::kernel::kernel(",m_uid,")\n");
 
-  for (auto& arg : m_symbol.arguments) {
-
-    switch (arg.atype) {
-    case xclbin::symbol::arg::argtype::printf:
-      if (m_printf_args.size())
-        throw xocl::error(CL_INVALID_BINARY,"Only one printf argument allowed");
-      m_printf_args.emplace_back(argument::create(&arg,this));
-      break;
-    case xclbin::symbol::arg::argtype::progvar:
-    {
-      // for address_qualifier==4, see comment under create function above
-      if (arg.address_qualifier!=1 && arg.address_qualifier!=4)
-        throw std::runtime_error
-          ("progvar with address_qualifiler " + std::to_string(arg.address_qualifier)
-           + " not implemented");
-      m_progvar_args.emplace_back(argument::create(&arg,this));
-      if (arg.address_qualifier==1) {
-        auto& pvar = m_progvar_args.back();
-        auto mem = clCreateBuffer(get_context(),CL_MEM_PROGVAR,arg.memsize,nullptr,nullptr);
-        if (arg.linkage=="external")
-          xocl::xocl(mem)->add_flags(CL_MEM_EXT_PTR_XILINX);
-        pvar->set(sizeof(cl_mem),&mem); // retains mem
-        clReleaseMemObject(mem);
-      }
-      break;
-    }
-    case xclbin::symbol::arg::argtype::rtinfo:
-    {
-      assert(arg.id.empty());
-      auto nm = arg.name;
-      auto itr = range_find(m_rtinfo_args,
-                            [&nm](const argument_value_type& arg)
-                            { return arg->get_name()==nm; });
-      if (itr==m_rtinfo_args.end())
-        m_rtinfo_args.emplace_back(argument::create(&arg,this));
-      else
-        (*itr)->add(&arg);
-      break;
+  // The argument layout is shared by all kernels created from the
+  // same program symbol, only the argument objects are per kernel
+  auto layout = m_program.get()
+    ? m_program->get_kernel_layout(m_symbol)
+    : program::create_kernel_layout(m_symbol);
+
+  auto create = [this](argument_vector_type& args, const program::kernel_layout::components_type& c) {
+    args.emplace_back(argument::create(c.front(),this));
+    for (auto itr=c.begin()+1; itr!=c.end(); ++itr)
+      args.back()->add(*itr);
+  };
+
+  m_indexed_args.reserve(layout->indexed.size());
+  for (auto& c : layout->indexed)
+    create(m_indexed_args,c);
+  for (auto& c : layout->printf)
+    create(m_printf_args,c);
+  for (auto& c : layout->rtinfo)
+    create(m_rtinfo_args,c);
+
+  for (auto& c : layout->progvar) {
+    create(m_progvar_args,c);
+    auto arg = c.front();
+    if (arg->address_qualifier==1) {
+      auto& pvar = m_progvar_args.back();
+      auto mem = clCreateBuffer(get_context(),CL_MEM_PROGVAR,arg->memsize,nullptr,nullptr);
+      if (arg->linkage=="external")
+        xocl::xocl(mem)->add_flags(CL_MEM_EXT_PTR_XILINX);
+      pvar->set(sizeof(cl_mem),&mem); // retains mem
+      clReleaseMemObject(mem);
     }
-    case xclbin::symbol::arg::argtype::indexed:
-    {
-      assert(!arg.id.empty());
-      auto idx  = std::stoul(arg.id,0,0);
-      if (idx==m_indexed_args.size())
-        // next argument
-        m_indexed_args.emplace_back(argument::create(&arg,this));
-      else if (idx<m_indexed_args.size())
-        // previous argument a second time (e.g. 229_vadd-long)
-        // scalar vector, e.g. long2, long4, etc.
-        // need to resize existing arg.
-        m_indexed_args[idx]->add(&arg);
-      else
-        throw xocl::error(CL_INVALID_BINARY,"Wrong kernel argument index: " + arg.id);
-      break;
-    }
-    default:
-      throw std::runtime_error("Internal error creating kernel arguments");
-    } // switch (arg.atype)
-
   }
 }
 
@@ -371,6 +350,72 @@ kernel::
   XOCL_DEBUG(std::cout,"xocl::kernel::~kernel(",m_uid,")\n");
 }
 
+// Size of an indexed argument in the packed buffer of set_arguments
+static size_t
+get_packed_size(const kernel::argument* arg)
+{
+  switch (arg->get_address_space()) {
+  case 0:
+    return arg->get_size();
+  case 3:
+    return sizeof(size_t);
+  default:
+    return sizeof(cl_mem);
+  }
+}
+
+size_t
+kernel::
+get_arguments_size() const
+{
+  size_t sz = 0;
+  for (auto& arg : m_indexed_args)
+    sz += get_packed_size(arg.get());
+  return sz;
+}
+
+void
+kernel::
+set_arguments(size_t sz, const void* args)
+{
+  auto expected = get_arguments_size();
+  if (sz != expected)
+    throw error(CL_INVALID_ARG_SIZE,"Invalid packed arguments size, expected "
+                + std::to_string(expected) + " got " + std::to_string(sz));
+  if (sz && !args)
+    throw error(CL_INVALID_ARG_VALUE,"Packed arguments cannot be nullptr");
+
+  auto data = static_cast<const char*>(args);
+  for (unsigned long idx=0; idx<m_indexed_args.size(); ++idx) {
+    auto& arg = m_indexed_args[idx];
+    auto argsz = get_packed_size(arg.get());
+    auto value = data;
+    data += argsz;
+
+    switch (arg->get_address_space()) {
+    case 0:
+      if (arg->is_set() && std::memcmp(arg->get_value(),value,argsz)==0)
+        continue;
+      arg->set(idx,argsz,value);
+      break;
+    case 1:
+    case 2: {
+      auto mem = *reinterpret_cast<const cl_mem*>(value);
+      if (arg->is_set() && mem && arg->get_memory_object()==xocl(mem))
+        continue;
+      arg->set(idx,argsz,value);
+      break;
+    }
+    case 3:
+      arg->set(idx,*reinterpret_cast<const size_t*>(value),nullptr);
+      break;
+    default:
+      arg->set(idx,argsz,*reinterpret_cast<const cl_mem*>(value));
+      break;
+    }
+  }
+}
+
 context*
 kernel::
 get_context() const
@@ -24,6 +24,8 @@
 
 #include "xrt/util/td.h"
 #include <limits>
+#include <map>
+#include <mutex>
 
 #include <iostream>
 
@@ -66,6 +68,15 @@ public:
     is_set() const
     { return m_set; }
 
+    /**
+     * @return
+     *   Number of times the argument has been set, clones share the
+     *   version of the argument they were cloned from
+     */
+    unsigned long
+    get_version() const
+    { return m_version; }
+
     void
     set(unsigned long argidx, size_t sz, const void* arg)
     {
@@ -227,6 +238,7 @@ public:
     kernel* m_kernel = nullptr;
     unsigned long m_argidx = std::numeric_limits<unsigned long>::max();
     bool m_set = false;
+    unsigned long m_version = 0;
   };
 
   class scalar_argument : public argument
@@ -504,6 +516,34 @@ public:
     m_indexed_args.at(idx)->set(idx,sz,arg);
   }
 
+  /**
+   * Set all indexed arguments from one packed buffer
+   *
+   * The buffer holds the indexed arguments back to back in argument
+   * order without padding, each as it would be passed to
+   * clSetKernelArg: the scalar value, a cl_mem for global and constant
+   * arguments, a size_t local memory size for local arguments, and a
+   * nullptr cl_mem for stream arguments.
+   *
+   * The size of the buffer is validated before any argument is set.
+   * Arguments whose value is unchanged are left alone so that their
+   * version, and hence the cached regmap words, remain valid.
+   *
+   * @param sz
+   *   Size of the buffer, must match get_arguments_size()
+   * @param args
+   *   The packed argument values
+   */
+  void
+  set_arguments(size_t sz, const void* args);
+
+  /**
+   * @return
+   *   Size of the packed buffer expected by set_arguments()
+   */
+  size_t
+  get_arguments_size() const;
+
   void
   set_svm_argument(unsigned long idx, size_t sz, const void* arg)
   {
@@ -569,6 +609,41 @@ public:
     return boost::join(m_printf_args,m_rtinfo_args);
   }
 
+  /**
+   * Encoded argument register map of a previous launch
+   *
+   * Execution contexts copy the words of the template into their
+   * command and re-encode only the arguments whose version differs
+   * from the version recorded in the template.
+   */
+  struct regmap_template
+  {
+    std::vector<uint32_t> words;          // regmap following the cu masks
+    std::vector<unsigned long> versions;  // argument versions in words
+  };
+
+  /**
+   * Get the regmap template for launches on a set of compute units
+   *
+   * @param device
+   *   Device of the compute units
+   * @param cumasks
+   *   Encoded compute unit masks identifying the set of compute units
+   * @return
+   *   Template, empty on first use, guarded by get_regmap_mutex()
+   */
+  regmap_template&
+  get_regmap_template(const device* device, const std::vector<uint32_t>& cumasks)
+  {
+    return m_regmap_templates[std::make_pair(device,cumasks)];
+  }
+
+  std::mutex&
+  get_regmap_mutex()
+  {
+    return m_regmap_mutex;
+  }
+
   ////////////////////////////////////////////////////////////////
   // Conformance helpers
   ////////////////////////////////////////////////////////////////
@@ -586,6 +661,9 @@ private:
   argument_vector_type m_printf_args;
   argument_vector_type m_progvar_args;
   argument_vector_type m_rtinfo_args;
+
+  std::mutex m_regmap_mutex;
+  std::map<std::pair<const device*,std::vector<uint32_t>>,regmap_template> m_regmap_templates;
 };
 
 } // xocl
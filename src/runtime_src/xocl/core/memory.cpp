@@ -20,8 +20,12 @@
 #include "error.h"
 
 #include "xrt/util/memory.h"
+#include "xrt/util/metrics.h"
+#include "xrt/config.h"
 
 #include <iostream>
+#include <cstring>
+#include <algorithm>
 
 namespace {
 
@@ -48,6 +52,17 @@ singleContextDevice(cl_context context)
     : nullptr;
 }
 
+// Max number of host written ranges tracked per buffer
+constexpr size_t max_dirty_ranges = 256;
+
+static xrt::metrics::gauge&
+memory_objects()
+{
+  static auto& metric = xrt::metrics::get_gauge
+    ("xocl_memory_objects","Live OpenCL memory objects");
+  return metric;
+}
+
 static xocl::memory::memory_callback_list sg_constructor_callbacks;
 static xocl::memory::memory_callback_list sg_destructor_callbacks;
 
@@ -57,11 +72,13 @@ namespace xocl {
 memory::
 memory(context* cxt, cl_mem_flags flags)
   : m_context(cxt), m_flags(flags)
+  , m_dirty_tracking(!(flags & (CL_MEM_COPY_HOST_PTR|CL_MEM_USE_HOST_PTR)))
 {
   static unsigned int uid_count = 0;
   m_uid = uid_count++;
 
   XOCL_DEBUG(std::cout,"xocl::memory::memory(): ",m_uid,"\n");
+  memory_objects().add();
 
   for (auto& cb: sg_constructor_callbacks)
     cb(this);
@@ -73,6 +90,7 @@ memory::
 ~memory()
 {
   XOCL_DEBUG(std::cout,"xocl::memory::~memory(): ",m_uid,"\n");
+  memory_objects().sub();
 
   if (m_dtor_notify)
     std::for_each(m_dtor_notify->rbegin(),m_dtor_notify->rend(),
@@ -132,9 +150,13 @@ get_buffer_object(device* device)
   }
 
   // Regular none XARE device, or first BO for this mem object
-  return (itr==m_bomap.end())
-    ? (m_bomap[device] = device->allocate_buffer_object(this))
-    : (*itr).second;
+  if (itr!=m_bomap.end())
+    return (*itr).second;
+
+  auto boh = (m_bomap[device] = device->allocate_buffer_object(this));
+  apply_deferred_writes(device,boh);
+  copy_replica(device,boh);
+  return boh;
 }
 
 memory::buffer_object_handle
@@ -171,7 +193,9 @@ get_buffer_object(kernel* kernel, unsigned long argidx)
       for (size_t idx=0; idx<cu_memidx_mask.size(); ++idx) {
         if (cu_memidx_mask.test(idx)) {
           try {
-            return (m_bomap[device] = device->allocate_buffer_object(this,idx));
+            auto boh = (m_bomap[device] = device->allocate_buffer_object(this,idx));
+            apply_deferred_writes(device,boh);
+            return boh;
           }
           catch (const std::bad_alloc&) {
           }
@@ -183,6 +207,184 @@ get_buffer_object(kernel* kernel, unsigned long argidx)
   return nullptr;
 }
 
+void
+memory::
+add_dirty_range(size_t offset, size_t size)
+{
+  if (auto parent = get_sub_buffer_parent()) {
+    parent->add_dirty_range(get_sub_buffer_offset()+offset,size);
+    return;
+  }
+
+  std::lock_guard<std::mutex> lk(m_boh_mutex);
+  if (!m_dirty_tracking)
+    return;
+
+  // Too many ranges to be worth tracking, migrate whole buffer
+  if (m_dirty && m_dirty->size()>=max_dirty_ranges) {
+    m_dirty_tracking = false;
+    m_dirty.reset();
+    return;
+  }
+
+  if (!m_dirty)
+    m_dirty = xrt::make_unique<std::vector<std::pair<size_t,size_t>>>();
+  m_dirty->emplace_back(offset,size);
+}
+
+bool
+memory::
+get_dirty_ranges(std::vector<std::pair<size_t,size_t>>& ranges) const
+{
+  if (get_type()!=CL_MEM_OBJECT_BUFFER || get_sub_buffer_parent())
+    return false;
+
+  std::lock_guard<std::mutex> lk(m_boh_mutex);
+  if (!m_dirty_tracking)
+    return false;
+
+  ranges.clear();
+  if (!m_dirty)
+    return true;
+
+  ranges = *m_dirty;
+  std::sort(ranges.begin(),ranges.end());
+
+  // Coalesce overlapping and adjacent ranges
+  size_t idx = 0;
+  for (size_t i=1; i<ranges.size(); ++i) {
+    auto& last = ranges[idx];
+    auto end = last.first + last.second;
+    if (ranges[i].first<=end)
+      last.second = std::max(end,ranges[i].first+ranges[i].second) - last.first;
+    else
+      ranges[++idx] = ranges[i];
+  }
+  ranges.resize(idx+1);
+  return true;
+}
+
+bool
+memory::
+try_defer_write(size_t offset, size_t size, const void* ptr)
+{
+  static bool deferred = xrt::config::get_deferred_bank_binding();
+  if (!deferred)
+    return false;
+
+  // Buffers with an explicit bank, register maps and sub buffers are
+  // allocated as usual
+  if (get_type()!=CL_MEM_OBJECT_BUFFER || get_ext_flags() || get_sub_buffer_parent()
+      || (get_flags() & CL_MEM_REGISTER_MAP))
+    return false;
+
+  std::lock_guard<std::mutex> lk(m_boh_mutex);
+  if (!m_bomap.empty())
+    return false;
+
+  // The host ptr is the backing store of the buffer object when it
+  // is allocated
+  if (auto host_ptr = get_host_ptr()) {
+    auto dst = static_cast<char*>(host_ptr) + offset;
+    if (dst!=ptr)
+      std::memcpy(dst,ptr,size);
+    return true;
+  }
+
+  if (!m_deferred_writes)
+    m_deferred_writes = xrt::make_unique<std::vector<deferred_write>>();
+  auto src = static_cast<const char*>(ptr);
+  m_deferred_writes->push_back({offset,std::vector<char>(src,src+size)});
+  return true;
+}
+
+void
+memory::
+apply_deferred_writes(device* device, const buffer_object_handle& boh)
+{
+  if (!m_deferred_writes)
+    return;
+
+  auto xdevice = device->get_xrt_device();
+  for (auto& write : *m_deferred_writes)
+    xdevice->write(boh,write.data.data(),write.data.size(),write.offset,false);
+  m_deferred_writes.reset();
+}
+
+void
+memory::
+copy_replica(device* device, const buffer_object_handle& boh)
+{
+  // Sub buffers are placed in their parent's buffer object, and an
+  // aligned host ptr is the backing store of all copies
+  if (!is_replicated() || get_sub_buffer_parent() || is_aligned())
+    return;
+
+  auto itr = m_replica_owner ? m_bomap.find(m_replica_owner) : m_bomap.begin();
+  if (itr!=m_bomap.end() && (*itr).first==device)
+    ++itr;
+  if (itr==m_bomap.end())
+    return;
+
+  auto sdevice = (*itr).first->get_xrt_device();
+  auto src = sdevice->map((*itr).second);
+  device->get_xrt_device()->write(boh,src,get_size(),0,false);
+  sdevice->unmap((*itr).second);
+}
+
+bool
+memory::
+is_replicated() const
+{
+  static bool replicate = xrt::config::get_replicate_read_only_buffers();
+  if (!replicate)
+    return false;
+  if (auto parent = get_sub_buffer_parent())
+    return parent->is_replicated();
+  return get_type()==CL_MEM_OBJECT_BUFFER
+    && (get_flags() & CL_MEM_READ_ONLY)
+    && !is_p2p_memory()
+    && m_context->num_devices()>1;
+}
+
+void
+memory::
+drop_replicas(const device* device)
+{
+  if (!is_replicated())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lk(m_boh_mutex);
+    auto resident = std::find(m_resident.begin(),m_resident.end(),device)!=m_resident.end();
+    m_resident.clear();
+    if (resident)
+      m_resident.push_back(device);
+    m_replica_owner = device;
+  }
+
+  if (auto parent = get_sub_buffer_parent())
+    parent->drop_replicas(device);
+}
+
+const device*
+memory::
+get_replica_owner() const
+{
+  if (auto parent = get_sub_buffer_parent())
+    return parent->get_replica_owner();
+  std::lock_guard<std::mutex> lk(m_boh_mutex);
+  return m_replica_owner;
+}
+
+void
+memory::
+clear_replica_owner()
+{
+  std::lock_guard<std::mutex> lk(m_boh_mutex);
+  m_replica_owner = nullptr;
+}
+
 memory::buffer_object_handle
 memory::
 get_buffer_object_or_error(const device* device) const
@@ -24,9 +24,13 @@
 #include "xocl/xclbin/xclbin.h"
 
 #include "xrt/device/device.h"
+#include "xrt/util/host_pool.h"
+#include "xrt/util/metrics.h"
 
 #include <unistd.h>
 #include <map>
+#include <atomic>
+#include <mutex>
 
 namespace xocl {
 
@@ -330,6 +334,21 @@ public:
   buffer_object_handle
   get_buffer_object(kernel* kernel, unsigned long argidx);
 
+  /**
+   * Defer a write to this buffer until it is allocated on a device
+   *
+   * A buffer that is not allocated on any device is placed in the
+   * memory bank of the first kernel argument it is bound to.  Writes
+   * before then are kept on the host, in the host ptr if any, and are
+   * applied when the buffer object is created.
+   *
+   * @return
+   *   true if the write was deferred, false if the buffer must be
+   *   written through its buffer object
+   */
+  bool
+  try_defer_write(size_t offset, size_t size, const void* ptr);
+
   /**
    * Get the buffer object on argument device or error out if none
    * exists.
@@ -424,6 +443,8 @@ public:
 
   /**
    * Set device resident
+   *
+   * Host writes are no longer tracked once the buffer is resident
    */
   void
   set_resident(const device* device)
@@ -431,8 +452,49 @@ public:
     std::lock_guard<std::mutex> lk(m_boh_mutex);
     if (std::find(m_resident.begin(),m_resident.end(),device) == m_resident.end())
       m_resident.push_back(device);
+    m_dirty_tracking = false;
+    m_dirty.reset();
+  }
+
+  /**
+   * Lock migration of this buffer between host and devices
+   *
+   * Held by the device operations that move content of the buffer,
+   * and by a background prefetch for its whole migration, see
+   * device::prefetch_buffer().  Recursive as migrations nest.  A sub
+   * buffer shares the lock of its parent.
+   */
+  std::unique_lock<std::recursive_mutex>
+  lock_migration() const
+  {
+    if (auto parent = get_sub_buffer_parent())
+      return parent->lock_migration();
+    return std::unique_lock<std::recursive_mutex>(m_migrate_mutex);
   }
 
+  /**
+   * Record a host write to a range of this buffer
+   *
+   * A buffer created without host data has undefined content except
+   * for the ranges written by host.  Until the buffer is first made
+   * resident, only these ranges have to be migrated to device.  A sub
+   * buffer records the range in its parent.
+   */
+  void
+  add_dirty_range(size_t offset, size_t size);
+
+  /**
+   * Get the coalesced ranges written by host before first migration
+   *
+   * @param ranges
+   *   Sorted, non overlapping (offset,size) ranges written by host
+   * @return
+   *   true if only the returned ranges must be migrated, false if the
+   *   whole buffer must be migrated
+   */
+  bool
+  get_dirty_ranges(std::vector<std::pair<size_t,size_t>>& ranges) const;
+
   /**
    * Clear resident devices
    */
@@ -443,6 +505,102 @@ public:
     m_resident.clear();
   }
 
+  /**
+   * Check if this buffer is replicated on the devices of its context
+   *
+   * A CL_MEM_READ_ONLY buffer in a multi device context has a copy on
+   * each device.  Host writes are applied to all copies, and the copies
+   * are made resident together, see device::migrate_buffer.  A sub
+   * buffer is replicated if its parent is.
+   */
+  bool
+  is_replicated() const;
+
+  /**
+   * Make the copy on device the only valid copy of a replicated buffer
+   *
+   * Called when device writes the buffer.  The buffer is no longer
+   * resident on other devices, and their copies are refreshed from
+   * this device when next migrated.
+   */
+  void
+  drop_replicas(const device* device);
+
+  /**
+   * Get the device with the only valid copy of a replicated buffer,
+   * nullptr if all copies are valid
+   */
+  const device*
+  get_replica_owner() const;
+
+  /**
+   * Mark all copies of a replicated buffer valid again
+   */
+  void
+  clear_replica_owner();
+
+  /**
+   * Check if the host copy of this buffer is current
+   *
+   * The host copy is stale once the device may have written the
+   * buffer, e.g. as a kernel argument or copy destination, until the
+   * whole buffer is synced back from device.  A sub buffer is stale
+   * also if its parent is.
+   */
+  bool
+  is_host_valid() const
+  {
+    auto parent = get_sub_buffer_parent();
+    return !(m_host_state & host_stale) && (!parent || parent->is_host_valid());
+  }
+
+  /**
+   * Generation of the host copy
+   *
+   * The generation changes each time the host copy is invalidated.  A
+   * device to host sync samples the generation before it starts and
+   * passes it to validate_host() when done.
+   */
+  unsigned int
+  get_host_generation() const
+  {
+    return m_host_state >> 1;
+  }
+
+  /**
+   * Mark the host copy of this buffer stale
+   *
+   * Called when a device write of the buffer is enqueued.  Bumps the
+   * host generation so that a device to host sync, which is still in
+   * flight, does not mark the host copy current when it completes.
+   * A stale sub buffer makes its parent stale.
+   */
+  void
+  invalidate_host()
+  {
+    auto state = m_host_state.load();
+    while (!m_host_state.compare_exchange_weak(state,(state+2) | host_stale))
+      ;
+    if (auto parent = get_sub_buffer_parent())
+      parent->invalidate_host();
+  }
+
+  /**
+   * Mark the host copy of this buffer current
+   *
+   * @generation: host generation sampled before syncing the whole
+   *   buffer from device
+   *
+   * The host copy stays stale if it was invalidated after @generation
+   * was sampled.
+   */
+  void
+  validate_host(unsigned int generation)
+  {
+    auto stale = (generation << 1) | host_stale;
+    m_host_state.compare_exchange_strong(stale,generation << 1);
+  }
+
   /**
    * Add a dtor callback
    */
@@ -464,6 +622,22 @@ public:
   static void register_destructor_callbacks(memory_callback_type&& aCallback);
 
 private:
+  // Apply deferred writes to newly allocated buffer object, must be
+  // called with m_boh_mutex locked
+  void
+  apply_deferred_writes(device* device, const buffer_object_handle& boh);
+
+  // Copy content of a valid copy of a replicated buffer to a newly
+  // allocated buffer object, must be called with m_boh_mutex locked
+  void
+  copy_replica(device* device, const buffer_object_handle& boh);
+
+  struct deferred_write
+  {
+    size_t offset;
+    std::vector<char> data;
+  };
+
   unsigned int m_uid = 0;
   ptr<context> m_context;
 
@@ -478,9 +652,26 @@ private:
   std::unique_ptr<std::vector<std::function<void()>>> m_dtor_notify;
 
   mutable std::mutex m_boh_mutex;
+  mutable std::recursive_mutex m_migrate_mutex;
   bomap_type m_bomap;
   std::vector<const device*> m_resident;
+
+  // Device with the only valid copy of a replicated buffer, see
+  // drop_replicas()
+  const device* m_replica_owner = nullptr;
+
+  // Writes deferred until first allocation, see try_defer_write.  On
+  // heap to avoid allocation unless needed.
+  std::unique_ptr<std::vector<deferred_write>> m_deferred_writes;
   connidx_type m_connidx = -1;
+
+  // Host copy generation and stale bit, see is_host_valid()
+  static constexpr unsigned int host_stale = 0x1;
+  std::atomic<unsigned int> m_host_state {0};
+
+  // Ranges written by host before first migration, see add_dirty_range()
+  bool m_dirty_tracking = true;
+  std::unique_ptr<std::vector<std::pair<size_t,size_t>>> m_dirty;
 };
 
 class buffer : public memory
@@ -494,8 +685,15 @@ public:
 
     if (flags & (CL_MEM_COPY_HOST_PTR | CL_MEM_ALLOC_HOST_PTR))
       // allocate sufficiently aligned memory and reassign m_host_ptr
-      if (posix_memalign(&m_host_ptr,alignment,sz))
+    {
+      try {
+        m_host_ptr = xrt::host_pool::allocate(sz,alignment);
+      }
+      catch (const std::bad_alloc&) {
         throw error(CL_MEM_OBJECT_ALLOCATION_FAILURE);
+      }
+      host_bytes().add(sz);
+    }
     if (flags & CL_MEM_COPY_HOST_PTR)
       std::memcpy(m_host_ptr,host_ptr,sz);
 
@@ -504,8 +702,10 @@ public:
 
   ~buffer()
   {
-    if (m_host_ptr && (get_flags() & (CL_MEM_COPY_HOST_PTR | CL_MEM_ALLOC_HOST_PTR)))
-      free(m_host_ptr);
+    if (m_host_ptr && (get_flags() & (CL_MEM_COPY_HOST_PTR | CL_MEM_ALLOC_HOST_PTR))) {
+      xrt::host_pool::deallocate(m_host_ptr,m_size,getpagesize());
+      host_bytes().sub(m_size);
+    }
   }
 
   virtual cl_mem_object_type
@@ -533,6 +733,15 @@ public:
   }
 
 private:
+  // Host memory allocated by xocl for buffers
+  static xrt::metrics::gauge&
+  host_bytes()
+  {
+    static auto& metric = xrt::metrics::get_gauge
+      ("xocl_host_buffer_bytes","Host memory allocated for buffers");
+    return metric;
+  }
+
   bool m_aligned = false;
   size_t m_size = 0;
   void* m_host_ptr = nullptr;
@@ -40,6 +40,7 @@ class sampler;
 class memory;
 class stream;
 class stream_mem;
+class graph;
 
 /**
  * Base class for all CL API object types
@@ -158,5 +159,6 @@ struct _cl_kernel :        public xocl::object<xocl::kernel,       _cl_kernel> {
 struct _cl_mem :           public xocl::object<xocl::memory,       _cl_mem> {};
 struct _cl_stream :        public xocl::object<xocl::stream,       _cl_stream> {};
 struct _cl_stream_mem :    public xocl::object<xocl::stream_mem,   _cl_stream_mem> {};
+struct _cl_graph :         public xocl::object<xocl::graph,        _cl_graph> {};
 
 #endif
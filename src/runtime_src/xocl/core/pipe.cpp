@@ -53,6 +53,14 @@ acquirePacket() const
   //return m_device->get_xrt_device()->acquirePacket();
 }
 
+size_t
+pipe::
+acquirePackets(rte_mbuf** buf, size_t count) const
+{
+    return 0;
+  //return m_device->get_xrt_device()->acquirePackets(buf,count);
+}
+
 size_t
 pipe::
 send(rte_mbuf** buf, size_t count) const
@@ -59,6 +59,15 @@ public:
   rte_mbuf*
   acquirePacket() const;
 
+  /**
+   * Acquire a burst of packets from the pipe mempool
+   *
+   * @return
+   *   count if all packets were acquired, 0 otherwise
+   */
+  size_t
+  acquirePackets(rte_mbuf** buf, size_t count) const;
+
   size_t
   send(rte_mbuf** buf, size_t count) const;
 
@@ -20,6 +20,7 @@
 
 #include "xocl/xclbin/xclbin.h"
 #include "xrt/util/memory.h"
+#include "xrt/util/task.h"
 #include "xrt/scheduler/scheduler.h"
 
 #include <boost/filesystem/operations.hpp>
@@ -137,8 +138,9 @@ public:
     std::reverse(m_hwem.begin(),m_hwem.end());
     std::reverse(m_swem.begin(),m_swem.end());
 
-    // Sanity checks
-    if (m_hwem.size() != m_swem.size())
+    // Sanity checks, only one emulation driver is loaded when
+    // XCL_EMULATION_MODE names the mode
+    if (!m_hwem.empty() && !m_swem.empty() && m_hwem.size() != m_swem.size())
       throw xocl::error(CL_DEVICE_NOT_FOUND,"Emulation device mismatch");
   }
 
@@ -221,7 +223,8 @@ platform()
   XOCL_DEBUG(std::cout,"xocl::platform::platform(",m_uid,")\n");
 
   if (is_emulation_mode()) {
-    while (auto hwem_device = m_device_mgr->get_hwem_device()) {
+    while (m_device_mgr->has_hwem_devices() || m_device_mgr->has_swem_devices()) {
+      auto hwem_device = m_device_mgr->get_hwem_device();
       auto swem_device = m_device_mgr->get_swem_device();
       auto udev = xrt::make_unique<xocl::device>(this,swem_device,hwem_device);
 #ifndef PMD_OCL
@@ -234,7 +237,14 @@ platform()
 
   //User can target either emulation or board. Not both at the same time.
   if (!is_emulation_mode() && m_device_mgr->has_hw_devices()) {
-    while (xrt::device* hw_device = m_device_mgr->get_hw_device()) {
+    // open all cards concurrently, devices are then constructed in
+    // order so that uids and names follow the card order
+    std::vector<xrt::device*> hw_devices;
+    while (xrt::device* hw_device = m_device_mgr->get_hw_device())
+      hw_devices.push_back(hw_device);
+    xrt::task::parallel_for(hw_devices,&device::open);
+
+    for (auto hw_device : hw_devices) {
       auto udev = xrt::make_unique<xocl::device>(this,hw_device,nullptr,nullptr);
       auto dev = udev.release();
       add_device(dev);
@@ -242,8 +252,10 @@ platform()
     }
   }
 
+  // lazy setup starts the scheduler when the first program is loaded
   try {
-    xrt::scheduler::start();
+    if (!xrt::config::get_lazy_device_setup())
+      xrt::scheduler::start();
   }
   catch(const std::exception&) {
     throw error(CL_OUT_OF_HOST_MEMORY,"failed to allocate platform event_scheduler");
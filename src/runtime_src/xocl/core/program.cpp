@@ -25,6 +25,8 @@
 #include "xrt/util/memory.h"
 
 #include <boost/filesystem/operations.hpp>
+#include <algorithm>
+#include <cstring>
 #include <vector>
 #include <iostream>
 #include <fstream>
@@ -102,8 +104,23 @@ program(context* ctx,cl_uint num_devices, const cl_device_id* devices,
   : program(ctx,"")
 {
   for (cl_uint i=0; i<num_devices; ++i) {
-    m_devices.push_back(xocl::xocl(devices[i]));
-    m_binaries.emplace(xocl::xocl(devices[i]),std::vector<char>(binaries[i],binaries[i]+lengths[i]));
+    auto device = xocl::xocl(devices[i]);
+    m_devices.push_back(device);
+
+    // Devices given the same binary share one copy of the raw data,
+    // xclbins are commonly tens of MB, one per device adds up
+    auto itr = std::find_if(m_binaries.begin(),m_binaries.end(),
+      [&](const std::pair<const xocl::device* const,xclbin>& e) {
+        auto range = e.second.binary().binary_data();
+        return static_cast<size_t>(range.second-range.first)==lengths[i]
+          && std::memcmp(range.first,binaries[i],lengths[i])==0;
+      });
+    if (itr!=m_binaries.end()) {
+      m_binaries.emplace(device,xclbin((*itr).second.binary()));
+      continue;
+    }
+
+    m_binaries.emplace(device,std::vector<char>(binaries[i],binaries[i]+lengths[i]));
   }
 
   // Verify that each binary contains the same kernels
@@ -229,6 +246,75 @@ create_kernel(const std::string& kernel_name)
   return std::unique_ptr<kernel,decltype(deleter)>(k.release(),deleter);
 }
 
+std::shared_ptr<const program::kernel_layout>
+program::
+create_kernel_layout(const xclbin::symbol& symbol)
+{
+  auto layout = std::make_shared<kernel_layout>();
+
+  for (auto& arg : symbol.arguments) {
+
+    switch (arg.atype) {
+    case xclbin::symbol::arg::argtype::printf:
+      if (layout->printf.size())
+        throw xocl::error(CL_INVALID_BINARY,"Only one printf argument allowed");
+      layout->printf.push_back({&arg});
+      break;
+    case xclbin::symbol::arg::argtype::progvar:
+      // for address_qualifier==4, see comment in kernel::argument::create
+      if (arg.address_qualifier!=1 && arg.address_qualifier!=4)
+        throw std::runtime_error
+          ("progvar with address_qualifiler " + std::to_string(arg.address_qualifier)
+           + " not implemented");
+      layout->progvar.push_back({&arg});
+      break;
+    case xclbin::symbol::arg::argtype::rtinfo:
+    {
+      assert(arg.id.empty());
+      auto& nm = arg.name;
+      auto itr = std::find_if(layout->rtinfo.begin(),layout->rtinfo.end(),
+                              [&nm](const kernel_layout::components_type& c)
+                              { return c.front()->name==nm; });
+      if (itr==layout->rtinfo.end())
+        layout->rtinfo.push_back({&arg});
+      else
+        (*itr).push_back(&arg);
+      break;
+    }
+    case xclbin::symbol::arg::argtype::indexed:
+    {
+      assert(!arg.id.empty());
+      auto idx  = std::stoul(arg.id,0,0);
+      if (idx==layout->indexed.size())
+        // next argument
+        layout->indexed.push_back({&arg});
+      else if (idx<layout->indexed.size())
+        // previous argument a second time (e.g. 229_vadd-long)
+        // scalar vector, e.g. long2, long4, etc.
+        layout->indexed[idx].push_back(&arg);
+      else
+        throw xocl::error(CL_INVALID_BINARY,"Wrong kernel argument index: " + arg.id);
+      break;
+    }
+    default:
+      throw std::runtime_error("Internal error creating kernel arguments");
+    } // switch (arg.atype)
+  }
+
+  return layout;
+}
+
+std::shared_ptr<const program::kernel_layout>
+program::
+get_kernel_layout(const xclbin::symbol& symbol)
+{
+  std::lock_guard<std::mutex> lk(m_layout_mutex);
+  auto& layout = m_kernel_layouts[&symbol];
+  if (!layout)
+    layout = create_kernel_layout(symbol);
+  return layout;
+}
+
 program::creation_type
 program::
 get_creation_type() const
@@ -24,6 +24,8 @@
 
 #include <vector>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <functional>
 
 namespace xocl {
@@ -239,6 +241,41 @@ public:
   std::unique_ptr<kernel,std::function<void(kernel*)>>
   create_kernel(const std::string& kernel_name);
 
+  /**
+   * Kernel argument layout
+   *
+   * The xclbin symbol arguments grouped into kernel arguments by kind.
+   * Each entry lists the symbol arguments making up one kernel
+   * argument, e.g. the components of a vector scalar argument.
+   */
+  struct kernel_layout
+  {
+    using arginfo_type = const xclbin::symbol::arg*;
+    using components_type = std::vector<arginfo_type>;
+
+    std::vector<components_type> indexed;
+    std::vector<components_type> printf;
+    std::vector<components_type> progvar;
+    std::vector<components_type> rtinfo;
+  };
+
+  /**
+   * Build the argument layout of a kernel symbol
+   *
+   * Throws on malformed symbol arguments.
+   */
+  static std::shared_ptr<const kernel_layout>
+  create_kernel_layout(const xclbin::symbol& symbol);
+
+  /**
+   * Get the argument layout of a kernel symbol of this program
+   *
+   * The layout is built on first request and shared by all kernels
+   * subsequently created from the same symbol.
+   */
+  std::shared_ptr<const kernel_layout>
+  get_kernel_layout(const xclbin::symbol& symbol);
+
   /**
    * How was this program created
    *
@@ -333,6 +370,9 @@ private:
   std::map<const device*,std::string> m_options;
   std::map<const device*,std::string> m_logs;    // build *error* logs
 
+  std::mutex m_layout_mutex;
+  std::map<const xclbin::symbol*,std::shared_ptr<const kernel_layout>> m_kernel_layouts;
+
   std::string m_source;
 public:
   // conformance
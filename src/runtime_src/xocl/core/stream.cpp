@@ -17,8 +17,180 @@
 #include "stream.h"
 #include "device.h"
 
+#include "xrt/config.h"
+#include "xrt/util/thread.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 namespace xocl { 
 
+// Pinned buffers cycle between the free and the full list.  For a
+// write stream the application fills free buffers and the workers
+// drain full buffers to the hardware queues, for a read stream the
+// workers keep reads posted into free buffers and the application
+// drains the full ones.  There is one worker per hardware queue with
+// one blocking request in flight, so each queue keeps its order.
+//
+// Blocking workers rather than one aio completion poller, because
+// the aio completion ring is shared by all queues of the device and a
+// poller would reap completions that clPollStreams must return.
+//
+// The ring retains the device, a read worker detached at close may
+// still be in a posted read and is the last owner of the ring.
+struct stream::ring
+{
+  struct buffer
+  {
+    char* data;
+    size_t size;
+    size_t offset;
+    stream_xfer_flags flags;
+    xrt::device::stream_buf_handle handle;
+  };
+
+  ptr<device> m_device;
+  size_t m_buffer_size;
+  std::vector<buffer> m_buffers;
+  std::deque<buffer*> m_free;
+  std::deque<buffer*> m_full;
+  std::vector<std::thread> m_workers;
+  std::mutex m_mutex;
+  std::condition_variable m_work;
+  ssize_t m_error = 0;
+  bool m_stop = false;
+
+  ring(device* device, size_t depth, size_t size)
+    : m_device(device), m_buffer_size(size)
+  {
+    m_buffers.reserve(depth);
+    for (size_t i=0; i<depth; ++i) {
+      xrt::device::stream_buf_handle handle = 0;
+      auto data = static_cast<char*>(m_device->alloc_stream_buf(size,&handle));
+      if (!data)
+        break;
+      m_buffers.push_back({data,0,0,0,handle});
+    }
+    for (auto& buf : m_buffers)
+      m_free.push_back(&buf);
+  }
+
+  ~ring()
+  {
+    for (auto& buf : m_buffers)
+      m_device->free_stream_buf(buf.handle);
+  }
+
+  ssize_t
+  push(const void* ptr, size_t size, const stream_xfer_req* req)
+  {
+    // No customer defined header, the request does not outlive the call
+    stream_xfer_flags flags = req ? req->flags : 0;
+    flags &= ~(CL_STREAM_NONBLOCKING | CL_STREAM_SILENT | CL_STREAM_CDH);
+
+    auto src = static_cast<const char*>(ptr);
+    size_t done = 0;
+    std::unique_lock<std::mutex> lk(m_mutex);
+    while (done < size) {
+      m_work.wait(lk,[this] { return m_error || !m_free.empty(); });
+      if (m_error)
+        return m_error;
+      auto buf = m_free.front();
+      m_free.pop_front();
+      auto chunk = std::min(size-done,m_buffer_size);
+      lk.unlock();
+      std::memcpy(buf->data,src+done,chunk);
+      lk.lock();
+      done += chunk;
+      buf->size = chunk;
+      buf->flags = (done < size) ? (flags & ~CL_STREAM_EOT) : flags;
+      m_full.push_back(buf);
+      m_work.notify_all();
+    }
+    return done;
+  }
+
+  ssize_t
+  pop(void* ptr, size_t size)
+  {
+    std::unique_lock<std::mutex> lk(m_mutex);
+    m_work.wait(lk,[this] { return m_stop || m_error || !m_full.empty(); });
+    if (m_full.empty())
+      return m_error;
+
+    // A request smaller than the packet leaves the rest for the next pop
+    auto buf = m_full.front();
+    auto chunk = std::min(size,buf->size-buf->offset);
+    std::memcpy(ptr,buf->data+buf->offset,chunk);
+    buf->offset += chunk;
+    if (buf->offset == buf->size) {
+      m_full.pop_front();
+      m_free.push_back(buf);
+      m_work.notify_all();
+    }
+    return chunk;
+  }
+
+  // Drains full buffers, exits when stopped and drained
+  void
+  write_worker(stream_handle handle)
+  {
+    std::unique_lock<std::mutex> lk(m_mutex);
+    while (true) {
+      m_work.wait(lk,[this] { return m_stop || !m_full.empty(); });
+      if (m_full.empty())
+        return;
+      auto buf = m_full.front();
+      m_full.pop_front();
+      lk.unlock();
+      stream_xfer_req req;
+      std::memset(&req,0,sizeof(req));
+      req.flags = buf->flags;
+      auto ret = m_device->write_stream(handle,buf->data,0,buf->size,&req);
+      lk.lock();
+      if (ret < 0 && !m_error)
+        m_error = ret;
+      m_free.push_back(buf);
+      m_work.notify_all();
+    }
+  }
+
+  // Keeps one read posted while there is a free buffer
+  void
+  read_worker(stream_handle handle)
+  {
+    std::unique_lock<std::mutex> lk(m_mutex);
+    while (true) {
+      m_work.wait(lk,[this] { return m_stop || !m_free.empty(); });
+      if (m_stop)
+        return;
+      auto buf = m_free.front();
+      m_free.pop_front();
+      lk.unlock();
+      stream_xfer_req req;
+      std::memset(&req,0,sizeof(req));
+      req.flags = CL_STREAM_EOT;
+      auto ret = m_device->read_stream(handle,buf->data,0,m_buffer_size,&req);
+      lk.lock();
+      if (m_stop)
+        return;
+      if (ret < 0) {
+        m_error = ret;
+        m_free.push_back(buf);
+        m_work.notify_all();
+        return;
+      }
+      buf->size = ret;
+      buf->offset = 0;
+      m_full.push_back(buf);
+      m_work.notify_all();
+    }
+  }
+};
+
 stream::
 stream(stream::stream_flags_type flags, stream::stream_attributes_type attrs, cl_mem_ext_ptr_t* ext)
   : m_flags(flags), m_attrs(attrs), m_ext(ext) 
@@ -34,7 +206,27 @@ stream::
 stream::get_stream(device* device)
 {
   m_device = device;
-  return device->get_stream(m_flags, m_attrs, m_ext, &m_handle, m_connidx);
+  auto attrs = m_attrs;
+  attrs &= ~CL_STREAM_RING;
+  auto ret = device->get_stream(m_flags, attrs, m_ext, m_handles, m_connidx);
+  if (ret || !m_attrs.test(CL_STREAM_RING) || m_handles.empty())
+    return ret;
+
+  auto depth = std::max(xrt::config::get_stream_ring_depth(),1u);
+  auto size = (std::max(xrt::config::get_stream_ring_buffer_size(),1u) + 0xfff) & ~0xfff;
+  m_ring = std::make_shared<ring>(m_device,depth,size);
+  if (m_ring->m_buffers.empty())
+    throw xocl::error(CL_OUT_OF_RESOURCES,"Unable to allocate stream ring buffers");
+
+  auto r = m_ring;
+  bool read = m_flags.test(CL_STREAM_READ_ONLY);
+  for (auto handle : m_handles) {
+    if (read)
+      m_ring->m_workers.emplace_back(xrt::thread([r,handle] { r->read_worker(handle); }));
+    else
+      m_ring->m_workers.emplace_back(xrt::thread([r,handle] { r->write_worker(handle); }));
+  }
+  return 0;
 }
 
 ssize_t 
@@ -43,7 +235,11 @@ stream
 {
   if(device != m_device)
     throw xocl::error(CL_INVALID_OPERATION,"Stream read on a bad device");
-  return m_device->read_stream(m_handle, ptr, offset, size, req);
+  if(m_handles.empty())
+    throw xocl::error(CL_INVALID_OPERATION,"Stream read without a queue");
+  if (m_ring)
+    return m_ring->pop(static_cast<char*>(ptr) + offset, size);
+  return m_device->read_stream(m_handles.front(), ptr, offset, size, req);
 }
 
 ssize_t 
@@ -52,7 +248,39 @@ stream
 {
   if(device != m_device)
     throw xocl::error(CL_INVALID_OPERATION,"Stream write on a bad device");
-  return m_device->write_stream(m_handle, ptr, offset, size, req);
+  if(m_handles.empty())
+    throw xocl::error(CL_INVALID_OPERATION,"Stream write without a queue");
+  if (m_ring)
+    return m_ring->push(static_cast<const char*>(ptr) + offset, size, req);
+  auto idx = m_handles.size() > 1 ? m_next++ % m_handles.size() : 0;
+  return m_device->write_stream(m_handles[idx], ptr, offset, size, req);
+}
+
+ssize_t
+stream
+::readv(device* device, const cl_stream_iovec* vec, size_t num, stream_xfer_req* req)
+{
+  if(device != m_device)
+    throw xocl::error(CL_INVALID_OPERATION,"Stream read on a bad device");
+  if(m_handles.empty())
+    throw xocl::error(CL_INVALID_OPERATION,"Stream read without a queue");
+  if (m_ring)
+    throw xocl::error(CL_INVALID_OPERATION,"Vectored stream read on a stream ring");
+  return m_device->read_streamv(m_handles.front(), vec, num, req);
+}
+
+ssize_t
+stream
+::writev(device* device, const cl_stream_iovec* vec, size_t num, stream_xfer_req* req)
+{
+  if(device != m_device)
+    throw xocl::error(CL_INVALID_OPERATION,"Stream write on a bad device");
+  if(m_handles.empty())
+    throw xocl::error(CL_INVALID_OPERATION,"Stream write without a queue");
+  if (m_ring)
+    throw xocl::error(CL_INVALID_OPERATION,"Vectored stream write on a stream ring");
+  auto idx = m_handles.size() > 1 ? m_next++ % m_handles.size() : 0;
+  return m_device->write_streamv(m_handles[idx], vec, num, req);
 }
 
 int
@@ -60,7 +288,28 @@ stream::
 stream::close()
 {
   assert(m_connidx!=-1);
-  return m_device->close_stream(m_handle,m_connidx);
+  if (!m_ring)
+    return m_device->close_stream(m_handles,m_connidx);
+
+  {
+    std::lock_guard<std::mutex> lk(m_ring->m_mutex);
+    m_ring->m_stop = true;
+  }
+  m_ring->m_work.notify_all();
+
+  // Pending writes are drained before the queues are closed.  A posted
+  // read may never complete, read workers are detached and the last
+  // one to finish releases the ring buffers and its device reference
+  bool read = m_flags.test(CL_STREAM_READ_ONLY);
+  if (!read)
+    for (auto& worker : m_ring->m_workers)
+      worker.join();
+  auto ret = m_device->close_stream(m_handles,m_connidx);
+  if (read)
+    for (auto& worker : m_ring->m_workers)
+      worker.detach();
+  m_ring.reset();
+  return ret;
 }
 
 
@@ -23,6 +23,10 @@
 
 #include "xrt/device/device.h"
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 namespace xocl {
 //class stream for qdma and other streaming purposes.
 class stream : public _cl_stream // TODO: public refcount
@@ -40,13 +44,21 @@ private:
   stream_flags_type m_flags {0};
   stream_attributes_type m_attrs {0};
   cl_mem_ext_ptr_t* m_ext {nullptr};
-  stream_handle m_handle {0};
+  // Hardware queues, writes are striped round robin across them
+  std::vector<stream_handle> m_handles;
+  std::atomic<unsigned int> m_next {0};
   device* m_device {nullptr};
   int m_connidx = -1;
+  // Runtime managed ring of a CL_STREAM_RING stream, shared with the
+  // workers that move its buffers through the hardware queues
+  struct ring;
+  std::shared_ptr<ring> m_ring;
 public:
   int get_stream(device* device); 
   ssize_t read(device* device, void* ptr, size_t offset, size_t size, stream_xfer_req* req );
   ssize_t write(device* device, const void* ptr, size_t offset, size_t size, stream_xfer_req* req);
+  ssize_t readv(device* device, const cl_stream_iovec* vec, size_t num, stream_xfer_req* req);
+  ssize_t writev(device* device, const cl_stream_iovec* vec, size_t num, stream_xfer_req* req);
   int close();
 };
 
@@ -0,0 +1,68 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef xocl_test_bench_bench_h_
+#define xocl_test_bench_bench_h_
+
+#include "xocl/core/time.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace xocl { namespace test {
+
+/**
+ * @return
+ *   Number of operator new calls made by the process so far
+ */
+unsigned long
+allocations();
+
+/**
+ * Run @f @iterations times after a short warm up and print the
+ * average ns/call and allocations/call in a form that is easy to
+ * diff between runs:
+ *
+ *   bench: <name> <iterations> <ns/call> <allocs/call>
+ */
+template <typename F>
+void
+measure(const std::string& name, size_t iterations, F&& f)
+{
+  for (size_t i=0; i<std::min<size_t>(iterations,100); ++i)
+    f();
+
+  unsigned long ns = 0;
+  auto allocs = allocations();
+  {
+    xocl::time_guard tg(ns);
+    for (size_t i=0; i<iterations; ++i)
+      f();
+  }
+  allocs = allocations() - allocs;
+
+  std::cout << "bench: " << name << " " << iterations << " "
+            << std::fixed << std::setprecision(1)
+            << static_cast<double>(ns) / iterations << " "
+            << std::setprecision(2)
+            << static_cast<double>(allocs) / iterations << "\n";
+}
+
+}} // test,xocl
+
+#endif
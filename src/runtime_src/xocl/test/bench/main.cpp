@@ -0,0 +1,58 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#define BOOST_TEST_MODULE "SDAccel runtime API overhead benchmark"
+#include <boost/test/unit_test.hpp>
+
+#include "bench.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Every heap allocation made by the process goes through these, which
+// lets the benchmarks report allocations per API call.
+namespace {
+
+std::atomic<unsigned long> s_allocations{0};
+
+void*
+allocate(std::size_t sz)
+{
+  ++s_allocations;
+  if (auto ptr = std::malloc(sz ? sz : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+}
+
+void* operator new(std::size_t sz)                  { return allocate(sz); }
+void* operator new[](std::size_t sz)                { return allocate(sz); }
+void  operator delete(void* ptr) noexcept           { std::free(ptr); }
+void  operator delete[](void* ptr) noexcept         { std::free(ptr); }
+void  operator delete(void* ptr, std::size_t) noexcept   { std::free(ptr); }
+void  operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace xocl { namespace test {
+
+unsigned long
+allocations()
+{
+  return s_allocations.load();
+}
+
+}} // test,xocl
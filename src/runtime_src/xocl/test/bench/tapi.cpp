@@ -0,0 +1,200 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include "../api/setup.h"
+#include "bench.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+// Per call overhead of the host APIs on the hot path of an application.
+// Kernel benchmarks need a sw_emu xclbin whose kernel takes a buffer as
+// its first argument:
+//
+//   XOCL_BENCH_XCLBIN=<xclbin> XOCL_BENCH_KERNEL=<name> <test> -t bench_api
+//
+// XOCL_BENCH_ITERATIONS overrides the number of calls per measurement.
+
+namespace {
+
+size_t
+iterations()
+{
+  static size_t val = std::getenv("XOCL_BENCH_ITERATIONS")
+    ? std::max(1,std::atoi(std::getenv("XOCL_BENCH_ITERATIONS")))
+    : 10000;
+  return val;
+}
+
+struct ocl_kernel
+{
+  cl_program program = nullptr;
+  cl_kernel kernel = nullptr;
+
+  explicit
+  ocl_kernel(const ocl_sw_emulation& ocl)
+  {
+    auto xclbin = std::getenv("XOCL_BENCH_XCLBIN");
+    auto name = std::getenv("XOCL_BENCH_KERNEL");
+    if (!xclbin || !name)
+      return;
+
+    std::ifstream stream(xclbin,std::ios::binary);
+    std::vector<unsigned char> binary((std::istreambuf_iterator<char>(stream)),std::istreambuf_iterator<char>());
+    BOOST_REQUIRE(!binary.empty());
+
+    cl_int err = CL_SUCCESS;
+    size_t size = binary.size();
+    const unsigned char* data = binary.data();
+    program = clCreateProgramWithBinary(ocl.context,1,&ocl.device,&size,&data,nullptr,&err);
+    BOOST_REQUIRE_EQUAL(err,CL_SUCCESS);
+    BOOST_REQUIRE_EQUAL(clBuildProgram(program,0,nullptr,nullptr,nullptr,nullptr),CL_SUCCESS);
+    kernel = clCreateKernel(program,name,&err);
+    BOOST_REQUIRE_EQUAL(err,CL_SUCCESS);
+  }
+
+  ~ocl_kernel()
+  {
+    if (kernel)
+      clReleaseKernel(kernel);
+    if (program)
+      clReleaseProgram(program);
+  }
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE ( bench_api )
+
+BOOST_AUTO_TEST_CASE( bench_clCreateBuffer )
+{
+  ocl_sw_emulation ocl;
+  cl_int err = CL_SUCCESS;
+
+  xocl::test::measure("clCreateBuffer+clReleaseMemObject",iterations(),[&] {
+    auto mem = clCreateBuffer(ocl.context,CL_MEM_READ_WRITE,4096,nullptr,&err);
+    clReleaseMemObject(mem);
+  });
+  BOOST_CHECK_EQUAL(err,CL_SUCCESS);
+}
+
+BOOST_AUTO_TEST_CASE( bench_clEnqueueMigrateMemObjects )
+{
+  ocl_sw_emulation ocl;
+  cl_int err = CL_SUCCESS;
+
+  auto cq = clCreateCommandQueue(ocl.context,ocl.device,0,&err);
+  BOOST_REQUIRE_EQUAL(err,CL_SUCCESS);
+  auto mem = clCreateBuffer(ocl.context,CL_MEM_READ_WRITE,4096,nullptr,&err);
+  BOOST_REQUIRE_EQUAL(err,CL_SUCCESS);
+
+  xocl::test::measure("clEnqueueMigrateMemObjects",iterations(),[&] {
+    cl_event ev = nullptr;
+    err = clEnqueueMigrateMemObjects(cq,1,&mem,0,0,nullptr,&ev);
+    clReleaseEvent(ev);
+  });
+  BOOST_CHECK_EQUAL(err,CL_SUCCESS);
+  clFinish(cq);
+
+  clReleaseMemObject(mem);
+  clReleaseCommandQueue(cq);
+}
+
+BOOST_AUTO_TEST_CASE( bench_clWaitForEvents )
+{
+  ocl_sw_emulation ocl;
+  cl_int err = CL_SUCCESS;
+
+  auto cq = clCreateCommandQueue(ocl.context,ocl.device,0,&err);
+  BOOST_REQUIRE_EQUAL(err,CL_SUCCESS);
+
+  // Wait on an event that is already complete, this is the validation
+  // and bookkeeping cost only
+  auto uev = clCreateUserEvent(ocl.context,&err);
+  BOOST_REQUIRE_EQUAL(clSetUserEventStatus(uev,CL_COMPLETE),CL_SUCCESS);
+  xocl::test::measure("clWaitForEvents(complete)",iterations(),[&] {
+    err = clWaitForEvents(1,&uev);
+  });
+  BOOST_CHECK_EQUAL(err,CL_SUCCESS);
+  clReleaseEvent(uev);
+
+  // Round trip through the queue
+  xocl::test::measure("clEnqueueMarker+clWaitForEvents",iterations(),[&] {
+    cl_event ev = nullptr;
+    clEnqueueMarkerWithWaitList(cq,0,nullptr,&ev);
+    err = clWaitForEvents(1,&ev);
+    clReleaseEvent(ev);
+  });
+  BOOST_CHECK_EQUAL(err,CL_SUCCESS);
+
+  clReleaseCommandQueue(cq);
+}
+
+BOOST_AUTO_TEST_CASE( bench_clSetKernelArg )
+{
+  ocl_sw_emulation ocl;
+  ocl_kernel k(ocl);
+  if (!k.kernel) {
+    BOOST_TEST_MESSAGE("XOCL_BENCH_XCLBIN/XOCL_BENCH_KERNEL not set, skipping");
+    return;
+  }
+
+  cl_int err = CL_SUCCESS;
+  auto mem = clCreateBuffer(ocl.context,CL_MEM_READ_WRITE,4096,nullptr,&err);
+  BOOST_REQUIRE_EQUAL(err,CL_SUCCESS);
+
+  xocl::test::measure("clSetKernelArg",iterations(),[&] {
+    err = clSetKernelArg(k.kernel,0,sizeof(cl_mem),&mem);
+  });
+  BOOST_CHECK_EQUAL(err,CL_SUCCESS);
+
+  clReleaseMemObject(mem);
+}
+
+BOOST_AUTO_TEST_CASE( bench_clEnqueueNDRangeKernel )
+{
+  ocl_sw_emulation ocl;
+  ocl_kernel k(ocl);
+  if (!k.kernel) {
+    BOOST_TEST_MESSAGE("XOCL_BENCH_XCLBIN/XOCL_BENCH_KERNEL not set, skipping");
+    return;
+  }
+
+  cl_int err = CL_SUCCESS;
+  auto cq = clCreateCommandQueue(ocl.context,ocl.device,CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE,&err);
+  BOOST_REQUIRE_EQUAL(err,CL_SUCCESS);
+  auto mem = clCreateBuffer(ocl.context,CL_MEM_READ_WRITE,4096,nullptr,&err);
+  BOOST_REQUIRE_EQUAL(err,CL_SUCCESS);
+  BOOST_REQUIRE_EQUAL(clSetKernelArg(k.kernel,0,sizeof(cl_mem),&mem),CL_SUCCESS);
+
+  // Enqueue cost only, completion is drained by clFinish outside the loop
+  size_t global = 1;
+  xocl::test::measure("clEnqueueNDRangeKernel",iterations(),[&] {
+    cl_event ev = nullptr;
+    err = clEnqueueNDRangeKernel(cq,k.kernel,1,nullptr,&global,&global,0,nullptr,&ev);
+    clReleaseEvent(ev);
+  });
+  BOOST_CHECK_EQUAL(err,CL_SUCCESS);
+  clFinish(cq);
+
+  clReleaseMemObject(mem);
+  clReleaseCommandQueue(cq);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
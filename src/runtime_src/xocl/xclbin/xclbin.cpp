@@ -28,6 +28,8 @@
 #include <boost/property_tree/xml_parser.hpp>
 
 #include <map>
+#include <unordered_map>
+#include <mutex>
 #include <limits>
 #include <cassert>
 #include <cstdlib>
@@ -708,6 +710,17 @@ private:
 
   pt::ptree xml_project;
 
+  // kernel name to kernel lookup, rebuilt when kernels are renamed
+  std::unordered_map<std::string,const kernel_wrapper*> m_kernel_index;
+
+  void
+  init_kernel_index()
+  {
+    m_kernel_index.clear();
+    for (auto& kernel : m_kernels)
+      m_kernel_index.emplace(kernel->name(),kernel.get());
+  }
+
   bool
   driver_match(const kernel_wrapper& k, const std::string& dsa) const
   {
@@ -780,6 +793,8 @@ public:
       XOCL_DEBUG(std::cout,"xclbin found kernel '" + xml_kernel.second.get<std::string>("<xmlattr>.name") + "'\n");
       m_kernels.emplace_back(xrt::make_unique<kernel_wrapper>(platform,device,core,xml_kernel.second));
     }
+
+    init_kernel_index();
   }
 
   xocl::xclbin::system_clocks_type
@@ -840,10 +855,9 @@ public:
   const xocl::xclbin::symbol&
   lookup_kernel(const std::string& kernel_name) const
   {
-    for (auto& kernel : m_kernels) {
-      if (kernel->name()==kernel_name)
-        return kernel->symbol();
-    }
+    auto itr = m_kernel_index.find(kernel_name);
+    if (itr!=m_kernel_index.end())
+      return (*itr).second->symbol();
     throw xocl::error(CL_INVALID_KERNEL_NAME,"No kernel with name '" + kernel_name + "' found in program");
   }
 
@@ -923,6 +937,8 @@ public:
         ++retval;
       }
     }
+    if (retval)
+      init_kernel_index();
     return retval;
   }
 
@@ -954,6 +970,10 @@ class xclbin_data_sections
   std::vector<membank> m_membanks;
   std::vector<int> m_used_connections;
 
+  // kernel name to its connections in connectivity order, the kernel
+  // name is the part of the ip name before ':'
+  std::unordered_map<std::string,std::vector<int32_t>> m_kernel_connections;
+
 public:
   explicit
   xclbin_data_sections(const xocl::xclbin::binary_type& binary)
@@ -975,6 +995,15 @@ public:
                   return b1.base_addr > b2.base_addr;
                 });
     }
+
+    // index connections by kernel name
+    if (is_valid()) {
+      for (int32_t i=0; i<m_con->m_count; ++i) {
+        auto ipidx = m_con->m_connection[i].m_ip_layout_index;
+        std::string ip_name = reinterpret_cast<const char*>(m_ip->m_ip_data[ipidx].m_name);
+        m_kernel_connections[ip_name.substr(0,ip_name.find(':'))].push_back(i);
+      }
+    }
   }
 
   bool
@@ -993,6 +1022,31 @@ public:
     if (!is_valid())
       return -1;
 
+    auto itr = m_kernel_connections.find(kernel_name);
+    if (itr==m_kernel_connections.end())
+      return get_memidx_from_arg_scan(kernel_name,arg,conn);
+
+    for (auto i : (*itr).second) {
+      if (m_con->m_connection[i].arg_index!=arg)
+        continue;
+      if (std::find(m_used_connections.begin(), m_used_connections.end(), i)
+          != m_used_connections.end())
+        continue;
+
+      size_t memidx = m_con->m_connection[i].mem_data_index;
+      assert(m_mem->m_mem_data[memidx].m_used);
+      m_used_connections.push_back(i);
+      conn = i;
+      return memidx;
+    }
+    throw std::runtime_error("did not find mem index for (kernel_name,arg):" + kernel_name + "," + std::to_string(arg));
+    return -1;
+  }
+
+  // Fallback for kernel names that are not an ip name prefix up to ':'
+  xocl::xclbin::memidx_type
+  get_memidx_from_arg_scan(const std::string& kernel_name, int32_t arg, xocl::xclbin::connidx_type& conn)
+  {
     // iterate connectivity and look for CU that with name that matches kernel_name
     for (int32_t i=0; i<m_con->m_count; ++i) {
       if (m_con->m_connection[i].arg_index!=arg)
@@ -1146,6 +1200,35 @@ public:
   }
 };
 
+// Parsed metadata shared between xclbin objects constructed from
+// identical meta data, e.g. the same binary loaded on several devices.
+// Entries expire with the last xclbin referencing them.  Conformance
+// mode renames kernels in place and gets a private copy.
+static std::shared_ptr<metadata>
+get_metadata(const data_range& xml)
+{
+  if (std::getenv("XCL_CONFORMANCE"))
+    return std::make_shared<metadata>(xml);
+
+  static std::mutex mutex;
+  static std::map<std::string,std::weak_ptr<metadata>> cache;
+
+  std::string key(xml.first,xml.second);
+  std::lock_guard<std::mutex> lk(mutex);
+  auto itr = cache.find(key);
+  if (itr!=cache.end()) {
+    if (auto md = (*itr).second.lock())
+      return md;
+  }
+
+  for (auto it=cache.begin(); it!=cache.end(); )
+    it = (*it).second.expired() ? cache.erase(it) : std::next(it);
+
+  auto md = std::make_shared<metadata>(xml);
+  cache[std::move(key)] = md;
+  return md;
+}
+
 } // namespace
 
 namespace xocl {
@@ -1156,12 +1239,21 @@ namespace xocl {
 struct xclbin::impl
 {
   binary_type m_binary;
-  metadata m_xml;
+  std::shared_ptr<metadata> m_metadata;
+  metadata& m_xml;
   xclbin_data_sections m_sections;
 
   impl(std::vector<char>&& xb)
     : m_binary(std::move(xb))
-    , m_xml(m_binary.meta_data())
+    , m_metadata(get_metadata(m_binary.meta_data()))
+    , m_xml(*m_metadata)
+    , m_sections(m_binary)
+  {}
+
+  impl(const binary_type& binary)
+    : m_binary(binary)
+    , m_metadata(get_metadata(m_binary.meta_data()))
+    , m_xml(*m_metadata)
     , m_sections(m_binary)
   {}
 
@@ -1289,6 +1381,12 @@ xclbin(std::vector<char>&& xb)
 {
 }
 
+xclbin::
+xclbin(const binary_type& binary)
+  : m_impl(xrt::make_unique<xclbin::impl>(binary))
+{
+}
+
 xclbin::
 xclbin(xclbin&& rhs)
   : m_impl(std::move(rhs.m_impl))
@@ -170,6 +170,15 @@ public:
   binary_type
   binary() const;
 
+  /**
+   * Construct from a binary shared with another xclbin
+   *
+   * The raw binary data is not copied, but the constructed xclbin
+   * has its own connection bookkeeping.
+   */
+  explicit
+  xclbin(const binary_type& binary);
+
   /**
    * Get dsa name
    */
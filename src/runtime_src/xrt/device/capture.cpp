@@ -0,0 +1,116 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "capture.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// Records are written when this much is buffered
+const size_t block_size = 1 << 20;
+
+void
+write_all(int fd, const char* data, size_t size)
+{
+  while (size) {
+    auto ret = ::write(fd,data,size);
+    if (ret < 0 && errno == EINTR)
+      continue;
+    if (ret <= 0)
+      return; // capture is best effort, the application goes on
+    data += ret;
+    size -= ret;
+  }
+}
+
+}
+
+namespace xrt { namespace hal2 {
+
+capture::
+capture(const std::string& path, unsigned int device)
+  : m_zero(std::chrono::steady_clock::now())
+{
+  m_fd = ::open(path.c_str(),O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC,0644);
+  if (m_fd < 0)
+    throw std::runtime_error("cannot open HAL capture '" + path + "': " + std::strerror(errno));
+
+  m_buffer.reserve(2*block_size);
+  xclCaptureHeader header = {};
+  std::memcpy(header.magic,XCL_CAPTURE_MAGIC,sizeof(header.magic));
+  header.version = XCL_CAPTURE_VERSION;
+  header.device = device;
+  auto data = reinterpret_cast<const char*>(&header);
+  m_buffer.insert(m_buffer.end(),data,data+sizeof(header));
+}
+
+capture::
+~capture()
+{
+  flush();
+  ::close(m_fd);
+}
+
+void
+capture::
+flush()
+{
+  write_all(m_fd,m_buffer.data(),m_buffer.size());
+  m_buffer.clear();
+}
+
+uint64_t
+capture::
+now() const
+{
+  auto elapsed = std::chrono::steady_clock::now() - m_zero;
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+}
+
+void
+capture::
+record(xclCaptureOp op, uint64_t start, bool complete, unsigned int bo,
+       uint64_t size, uint64_t offset, uint32_t flags, int ret,
+       const void* payload, uint32_t payload_size)
+{
+  xclCaptureRecord rec = {};
+  rec.start = start;
+  rec.duration = complete ? now() - start : 0;
+  rec.op = op;
+  rec.bo = bo;
+  rec.size = size;
+  rec.offset = offset;
+  rec.flags = flags;
+  rec.ret = ret;
+  rec.payload = payload ? payload_size : 0;
+
+  auto data = reinterpret_cast<const char*>(&rec);
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_buffer.insert(m_buffer.end(),data,data+sizeof(rec));
+  if (rec.payload) {
+    auto pdata = static_cast<const char*>(payload);
+    m_buffer.insert(m_buffer.end(),pdata,pdata+rec.payload);
+  }
+  if (m_buffer.size() >= block_size)
+    flush();
+}
+
+}} // hal2,xrt
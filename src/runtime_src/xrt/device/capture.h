@@ -0,0 +1,87 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef xrt_device_capture_h
+#define xrt_device_capture_h
+
+#include "driver/include/xclcapture.h"
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace xrt { namespace hal2 {
+
+/**
+ * Binary capture of HAL calls in the format of xclcapture.h
+ *
+ * Records are buffered and written to the file in large blocks so
+ * that the capture is cheap enough to leave enabled.  Records of
+ * concurrent calls are serialized in the order they complete.
+ */
+class capture
+{
+  int m_fd = -1;
+  std::mutex m_mutex;
+  std::vector<char> m_buffer;
+  std::chrono::steady_clock::time_point m_zero;
+
+  void
+  flush();
+
+public:
+  /**
+   * Open capture file
+   *
+   * @param path
+   *   File to create, an existing file is truncated
+   * @param device
+   *   Index of captured device, recorded in the header
+   */
+  capture(const std::string& path, unsigned int device);
+  ~capture();
+
+  /**
+   * @return
+   *   ns since the capture was opened, start time of a call
+   */
+  uint64_t
+  now() const;
+
+  /**
+   * Record a call
+   *
+   * @param op
+   *   Captured call
+   * @param start
+   *   Start time of call from now()
+   * @param complete
+   *   True if the call has completed, duration is computed from
+   *   @start.  False for calls that return before the work is done.
+   * @param payload
+   *   Data recorded after the call, e.g. command packet
+   */
+  void
+  record(xclCaptureOp op, uint64_t start, bool complete, unsigned int bo,
+         uint64_t size, uint64_t offset, uint32_t flags, int ret,
+         const void* payload=nullptr, uint32_t payload_size=0);
+};
+
+}} // hal2,xrt
+
+#endif
@@ -18,12 +18,242 @@
 
 #include "xrt/util/task.h"
 #include "xrt/util/event.h"
+#include "xrt/util/config_reader.h"
 
 #include <future>
+#include <map>
 #include <cstring> // for std::memset
 
 namespace xrt {
 
+/**
+ * Suballocator of small device buffers
+ *
+ * Buffers are rounded up to a power of two size class, starting at the
+ * device alignment.  Each size class of a memory index carves buffers
+ * out of its current slab buffer object by bumping an offset, and
+ * allocates a new slab when the current is exhausted.  Released buffers
+ * go on the freelist of their size class and are reused before the
+ * slab is bumped.  Slabs are freed when the suballocator and all
+ * buffers carved out of them are gone.
+ *
+ * Buffers reference the suballocator through their deleter so that the
+ * suballocator outlives them.
+ *
+ * The SVM suballocator uses a single memory index and allocates its
+ * slabs as alloc_svm buffers are allocated, in any bank.
+ */
+struct device::suballocator
+{
+  struct chunk
+  {
+    BufferObjectHandle slab;
+    size_t offset;
+  };
+
+  struct size_class
+  {
+    std::vector<chunk> freelist;
+    BufferObjectHandle slab;
+    size_t next = 0;
+  };
+
+  hal::device* m_hal;
+  size_t m_max_size;
+  size_t m_slab_size;
+  size_t m_min_size = 0;
+  bool m_svm = false;
+
+  std::mutex m_mutex;
+  std::map<uint64_t,std::vector<size_class>> m_classes; // per memory index
+
+  suballocator(hal::device* hal, size_t max_size, size_t slab_size, bool svm=false)
+    : m_hal(hal), m_max_size(max_size), m_slab_size(slab_size), m_svm(svm)
+  {}
+
+  /**
+   * Acquire a chunk for a buffer of size sz in memory index
+   *
+   * @param cls
+   *   Set to size class of chunk
+   * @return
+   *   Chunk of slab, with null slab if sz is not suballocated or
+   *   slab allocation failed
+   */
+  chunk
+  acquire(uint64_t memidx, size_t sz, unsigned int& cls)
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+
+    // device alignment is known once the device is open
+    if (!m_min_size)
+      m_min_size = m_hal->getAlignment();
+
+    size_t csz = m_min_size;
+    for (cls=0; csz < sz; csz <<= 1)
+      ++cls;
+    if (csz > m_slab_size)
+      return {nullptr,0};
+
+    auto& classes = m_classes[memidx];
+    if (classes.size() <= cls)
+      classes.resize(cls+1);
+    auto& sc = classes[cls];
+
+    if (!sc.freelist.empty()) {
+      auto c = std::move(sc.freelist.back());
+      sc.freelist.pop_back();
+      return c;
+    }
+
+    if (!sc.slab || sc.next + csz > m_slab_size) {
+      try {
+        // slabs live as long as the device, keep them out of the way
+        // of short lived buffers
+        sc.slab = m_svm
+          ? m_hal->alloc(m_slab_size)
+          : m_hal->alloc(m_slab_size,memoryDomain::XRT_DEVICE_LONG_LIVED_RAM,memidx,nullptr);
+      }
+      catch (const std::bad_alloc&) {
+        sc.slab = nullptr;
+      }
+      sc.next = 0;
+      if (!sc.slab)
+        return {nullptr,0};
+    }
+
+    chunk c {sc.slab,sc.next};
+    sc.next += csz;
+    return c;
+  }
+
+  void
+  release(uint64_t memidx, unsigned int cls, chunk&& c)
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_classes[memidx][cls].freelist.push_back(std::move(c));
+  }
+};
+
+/**
+ * Deleter of suballocated buffer handles, returns chunk to its size class
+ */
+struct device::suballoc_deleter
+{
+  std::shared_ptr<suballocator> sa;
+  BufferObjectHandle sub;
+  uint64_t memidx;
+  unsigned int cls;
+  suballocator::chunk c;
+
+  void
+  operator() (BufferObjectHandle::element_type*)
+  {
+    sub.reset();
+    sa->release(memidx,cls,std::move(c));
+  }
+};
+
+std::shared_ptr<device::suballocator>
+device::
+create_suballocator(hal::device* hal)
+{
+  size_t max_size = config::get_bo_suballoc_max_size();
+  size_t slab_size = config::get_bo_suballoc_slab_size();
+  if (!hal || !max_size || max_size > slab_size)
+    return nullptr;
+  return std::make_shared<suballocator>(hal,max_size,slab_size);
+}
+
+std::shared_ptr<device::suballocator>
+device::
+create_svm_suballocator(hal::device* hal)
+{
+  size_t max_size = config::get_svm_suballoc_max_size();
+  size_t slab_size = config::get_bo_suballoc_slab_size();
+  if (!hal || !max_size || max_size > slab_size)
+    return nullptr;
+  return std::make_shared<suballocator>(hal,max_size,slab_size,true);
+}
+
+device::BufferObjectHandle
+device::
+suballoc(const std::shared_ptr<suballocator>& sa, size_t sz, uint64_t memoryIndex)
+{
+  if (!sz || sz > sa->m_max_size)
+    return nullptr;
+
+  unsigned int cls = 0;
+  auto c = sa->acquire(memoryIndex,sz,cls);
+  if (!c.slab)
+    return nullptr;
+
+  auto sub = m_hal->alloc(c.slab,sz,c.offset);
+  auto bo = sub.get();
+  return BufferObjectHandle(bo,suballoc_deleter{sa,std::move(sub),memoryIndex,cls,std::move(c)});
+}
+
+void*
+device::
+alloc_svm(size_t sz)
+{
+  BufferObjectHandle boh;
+  if (m_svm_suballoc)
+    boh = suballoc(m_svm_suballoc,sz,0);
+  if (!boh)
+    boh = m_hal->alloc(sz);
+
+  auto ptr = m_hal->map(boh);
+  std::lock_guard<std::mutex> lk(m_svm_mutex);
+  m_svm.emplace(ptr,std::make_pair(std::move(boh),sz));
+  return ptr;
+}
+
+void
+device::
+free_svm(void* svm_ptr)
+{
+  // Releasing the handle frees the buffer object or returns the chunk
+  // to its slab
+  BufferObjectHandle boh;
+  {
+    std::lock_guard<std::mutex> lk(m_svm_mutex);
+    auto itr = m_svm.find(svm_ptr);
+    if (itr == m_svm.end())
+      throw std::runtime_error("free_svm: The SVM pointer is invalid.");
+    boh = std::move((*itr).second.first);
+    m_svm.erase(itr);
+  }
+}
+
+uint64_t
+device::
+getSVMDeviceAddr(const void* svm_ptr)
+{
+  std::lock_guard<std::mutex> lk(m_svm_mutex);
+
+  // The allocation containing svm_ptr is the last one starting at or
+  // before it
+  auto itr = m_svm.upper_bound(svm_ptr);
+  if (itr != m_svm.begin()) {
+    --itr;
+    auto base = static_cast<const char*>((*itr).first);
+    auto offset = static_cast<size_t>(static_cast<const char*>(svm_ptr) - base);
+    if (offset < (*itr).second.second)
+      return m_hal->getDeviceAddr((*itr).second.first) + offset;
+  }
+  throw std::runtime_error("getSVMDeviceAddr: The SVM pointer is invalid.");
+}
+
+void
+device::
+free(const BufferObjectHandle& bo)
+{
+  if (std::get_deleter<suballoc_deleter>(bo))
+    return;
+  m_hal->free(bo);
+}
+
 std::ostream&
 device::
 printDeviceInfo(std::ostream& ostr) const
@@ -21,6 +21,7 @@
 #include "xrt/util/range.h"
 
 #include <set>
+#include <map>
 #include <vector>
 #include <thread>
 #include <mutex>
@@ -56,12 +57,19 @@ public:
 
   explicit
   device(std::unique_ptr<hal::device>&& hal)
-    : m_hal(std::move(hal)), m_setup_done(false)
+    : m_hal(std::move(hal))
+    , m_suballoc(create_suballocator(m_hal.get()))
+    , m_svm_suballoc(create_svm_suballocator(m_hal.get()))
+    , m_setup_done(false)
   {
   }
 
   device(device&& rhs)
-    : m_hal(std::move(rhs.m_hal)), m_setup_done(rhs.m_setup_done)
+    : m_hal(std::move(rhs.m_hal))
+    , m_suballoc(std::move(rhs.m_suballoc))
+    , m_svm_suballoc(std::move(rhs.m_svm_suballoc))
+    , m_svm(std::move(rhs.m_svm))
+    , m_setup_done(rhs.m_setup_done)
   {}
 
   ~device()
@@ -140,6 +148,12 @@ public:
     return m_hal->get_cdma_count();
   }
 
+  int
+  getNumaNode() const
+  {
+    return m_hal->getNumaNode();
+  }
+
   /**
    * Open a HAL device
    *
@@ -162,6 +176,12 @@ public:
     m_hal->close();
   }
 
+  bool
+  is_open() const
+  {
+    return m_hal->is_open();
+  }
+
   ExecBufferObjectHandle
   allocExecBuffer(size_t sz)
   {
@@ -182,9 +202,22 @@ public:
   alloc(size_t sz)
   { return m_hal->alloc(sz); }
 
+  /**
+   * Allocate a buffer object in specified memory
+   *
+   * When enabled in sdaccel.ini, small device buffers are carved out
+   * of larger slab buffer objects per memory index, see
+   * xrt::config::get_bo_suballoc_max_size().  A suballocated buffer
+   * is returned to its size class when its handle is released.
+   */
   BufferObjectHandle
   alloc(size_t sz, memoryDomain domain, uint64_t memoryIndex, void* user_ptr)
-  { return m_hal->alloc(sz, domain, memoryIndex, user_ptr); }
+  {
+    if (m_suballoc && !user_ptr && domain==memoryDomain::XRT_DEVICE_RAM)
+      if (auto boh = suballoc(m_suballoc,sz,memoryIndex))
+        return boh;
+    return m_hal->alloc(sz, domain, memoryIndex, user_ptr);
+  }
 
   /**
    * Allocate a new buffer object from an existing one by offsetting
@@ -205,17 +238,42 @@ public:
   alloc(const BufferObjectHandle& bo, size_t sz, size_t offset)
   { return m_hal->alloc(bo,sz,offset); }
 
+  /**
+   * Allocate shared virtual memory
+   *
+   * Small allocations are carved out of pooled slab buffer objects,
+   * see xrt::config::get_svm_suballoc_max_size(), larger ones get a
+   * buffer object of their own.
+   *
+   * @return
+   *   Host address of the allocation
+   */
   void*
-  alloc_svm(size_t sz)
-  { return m_hal->alloc_svm(sz); }
+  alloc_svm(size_t sz);
 
+  /**
+   * Free a buffer object explicitly
+   *
+   * Suballocated buffers share their slab buffer object and are
+   * released only by dropping their handle, this function ignores
+   * them.
+   */
   void
-  free(const BufferObjectHandle& bo)
-  { m_hal->free(bo); }
+  free(const BufferObjectHandle& bo);
 
   void
-  free_svm(void* svm_ptr)
-  { m_hal->free_svm(svm_ptr); }
+  free_svm(void* svm_ptr);
+
+  /**
+   * Get the device address of an SVM pointer
+   *
+   * @param svm_ptr
+   *   Pointer into an allocation returned by alloc_svm()
+   * @return
+   *   Device address corresponding to svm_ptr
+   */
+  uint64_t
+  getSVMDeviceAddr(const void* svm_ptr);
 
   /**
    * Write sz bytes from buffer to host memory at offset in buffer
@@ -268,6 +326,17 @@ public:
   sync(const BufferObjectHandle& bo, size_t sz, size_t offset, direction dir, bool async=true)
   { return m_hal->sync(bo,sz,offset,dir,async); }
 
+  /**
+   * Sync multiple (offset,size) ranges of a buffer object
+   *
+   * The ranges are submitted to the driver with one call if
+   * supported, otherwise one at a time.  Returns when all ranges
+   * are synced.
+   */
+  int
+  sync(const BufferObjectHandle& bo, const std::vector<std::pair<size_t,size_t>>& ranges, direction dir)
+  { return m_hal->sync_ranges(bo,ranges,dir); }
+
   /**
    * Copy sz bytes at offset from device to device/host
    *
@@ -356,10 +425,51 @@ public:
   exec_buf(const ExecBufferObjectHandle& bo)
   { return m_hal->exec_buf(bo); }
 
+  /**
+   * Submit multiple exec buffers with one call to the driver
+   * if supported, otherwise one at a time
+   *
+   * Return: Number of leading exec buffers submitted, less than
+   *   bos.size() on error with errno set
+   */
+  size_t
+  exec_buf(const std::vector<ExecBufferObjectHandle>& bos)
+  { return m_hal->exec_buf(bos); }
+
+  /**
+   * Submit exec buffer to start when exec buffers in wait list
+   * have completed, see has_exec_wait_list()
+   */
+  int
+  exec_buf(const ExecBufferObjectHandle& bo, const std::vector<ExecBufferObjectHandle>& waitlist)
+  { return m_hal->exec_buf(bo,waitlist); }
+
+  bool
+  has_exec_wait_list() const
+  { return m_hal->has_exec_wait_list(); }
+
   int
   exec_wait(int timeout_ms) const
   { return m_hal->exec_wait(timeout_ms); }
 
+  unsigned int
+  exec_buf_handle(const ExecBufferObjectHandle& bo) const
+  { return m_hal->exec_buf_handle(bo); }
+
+  int
+  exec_completions(std::vector<unsigned int>& completed)
+  { return m_hal->exec_completions(completed); }
+
+  /**
+   * DMA sz bytes of host memory to absolute device address
+   *
+   * Return: number of bytes written, -ENOSYS if not supported, or
+   *  negative error code
+   */
+  ssize_t
+  write_unmgd(const void* buffer, size_t sz, uint64_t device_addr)
+  { return m_hal->write_unmgd(buffer,sz,device_addr); }
+
 public:
   /**
    * Get the device address of a buffer object
@@ -491,6 +601,18 @@ public:
     return m_hal->readStream(stream, ptr, offset, size, req);
   };
 
+  ssize_t
+  writeStreamv(hal::StreamHandle stream, const hal::StreamIovec* vec, size_t num, hal::StreamXferReq* req)
+  {
+    return m_hal->writeStreamv(stream, vec, num, req);
+  };
+
+  ssize_t
+  readStreamv(hal::StreamHandle stream, const hal::StreamIovec* vec, size_t num, hal::StreamXferReq* req)
+  {
+    return m_hal->readStreamv(stream, vec, num, req);
+  };
+
   int
   pollStreams(hal::StreamXferCompletions* comps, int min, int max, int* actual, int timeout)    
   {
@@ -527,6 +649,18 @@ public:
 #endif
 
 private:
+  struct suballocator;
+  struct suballoc_deleter;
+
+  static std::shared_ptr<suballocator>
+  create_suballocator(hal::device* hal);
+
+  static std::shared_ptr<suballocator>
+  create_svm_suballocator(hal::device* hal);
+
+  BufferObjectHandle
+  suballoc(const std::shared_ptr<suballocator>& sa, size_t sz, uint64_t memoryIndex);
+
   void retain(const BufferObjectHandle& bo)
   {
     std::lock_guard<std::mutex> buflk(m_buffers_mutex);
@@ -841,6 +975,13 @@ public:
 private:
 
   std::unique_ptr<hal::device> m_hal;
+  std::shared_ptr<suballocator> m_suballoc;
+  std::shared_ptr<suballocator> m_svm_suballoc;
+
+  // SVM allocations by host address, with their size
+  std::map<const void*,std::pair<BufferObjectHandle,size_t>> m_svm;
+  std::mutex m_svm_mutex;
+
   std::vector<BufferObjectHandle> m_buffers;
   mutable std::mutex m_buffers_mutex;
   bool m_setup_done;
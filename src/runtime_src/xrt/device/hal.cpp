@@ -17,6 +17,7 @@
 #include "hal.h"
 #include "xrt/util/memory.h"
 
+#include <cstring>
 #include <dlfcn.h>
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/path.hpp>
@@ -94,6 +95,16 @@ isEmulationMode()
   return val;
 }
 
+// XCL_EMULATION_MODE=sw_emu or hw_emu needs only the matching driver,
+// any other value loads both and the xclbin target picks one
+static bool
+isEmulationMode(const char* mode)
+{
+  static const char* xem = std::getenv("XCL_EMULATION_MODE");
+  static bool any = xem && std::strcmp(xem,"sw_emu")!=0 && std::strcmp(xem,"hw_emu")!=0;
+  return xem && (any || std::strcmp(xem,mode)==0);
+}
+
 // Open the HAL implementation dll and construct a hal::device for
 // each board detected by the implementation
 static void
@@ -154,6 +165,15 @@ loadDevices()
 
   // xrt
   bfs::path xrt(emptyOrValue(getenv("XILINX_XRT")));
+  if (!xrt.empty() && xrt::config::get_null_driver()) {
+    directoryOrError(xrt);
+    bfs::path p(xrt / "lib/libxrt_null.so");
+    if (!isDLL(p))
+      throw std::runtime_error("Runtime.null_driver is set but " + p.string() + " not found");
+    createHalDevices(devices,p.string());
+    return devices;
+  }
+
   if (!xrt.empty() && !isEmulationMode()) {
     directoryOrError(xrt);
     bfs::path p(xrt / "lib/libxrt_core.so");
@@ -161,13 +181,13 @@ loadDevices()
       createHalDevices(devices,p.string());
   }
 
-  if (devices.empty()) { // if failed libxrt_core load, try libxrt_aws
+  if (devices.empty() && !isEmulationMode()) { // if failed libxrt_core load, try libxrt_aws
     bfs::path p(xrt / "lib/libxrt_aws.so");
     if (isDLL(p))
       createHalDevices(devices,p.string());
   }
 
-  if (!xrt.empty() && isEmulationMode()) {
+  if (!xrt.empty() && isEmulationMode("hw_emu")) {
     directoryOrError(xrt);
 
     auto hw_em_driver_path = xrt::config::get_hw_em_driver();
@@ -181,7 +201,7 @@ loadDevices()
       createHalDevices(devices,hw_em_driver_path);
   }
 
-  if (!xrt.empty() && isEmulationMode()) {
+  if (!xrt.empty() && isEmulationMode("sw_emu")) {
     directoryOrError(xrt);
 
     auto sw_em_driver_path = xrt::config::get_sw_em_driver();
@@ -31,6 +31,7 @@
 #include <vector>
 #include <thread>
 #include <iosfwd>
+#include <cerrno>
 
 //struct xclBin;
 struct axlf;
@@ -73,6 +74,7 @@ typedef uint64_t StreamFlags;
 
 using StreamXferReq = stream_xfer_req;
 using StreamXferCompletions = streams_poll_req_completions;
+using StreamIovec = stream_iovec;
 /**
  * Helper class to encapsulate return values from HAL operations.
  *
@@ -152,6 +154,7 @@ public:
     ,XRT_SHARED_VIRTUAL
     ,XRT_SHARED_PHYSICAL
     ,XRT_DEVICE_P2P_RAM
+    ,XRT_DEVICE_LONG_LIVED_RAM // device RAM hinted to outlive most other buffers
   };
 
   virtual bool
@@ -160,6 +163,9 @@ public:
   virtual void
   close() = 0;
 
+  virtual bool
+  is_open() const = 0;
+
   // Hack to copy hw_em device info to sw_em device info
   // Should not be necessary when we move to sw_emu
   virtual void
@@ -190,6 +196,16 @@ public:
   virtual size_t
   get_cdma_count() const = 0;
 
+  /**
+   * @return
+   *   NUMA node the device is attached to, or -1 if unknown
+   */
+  virtual int
+  getNumaNode() const
+  {
+    return -1;
+  }
+
   virtual ExecBufferObjectHandle
   allocExecBuffer(size_t sz) = 0;
 
@@ -232,6 +248,22 @@ public:
   virtual event
   sync(const BufferObjectHandle& bo, size_t sz, size_t offset, direction dir, bool async) = 0;
 
+  /**
+   * Synchronously sync multiple (offset,size) ranges of a buffer
+   * object in one direction.
+   *
+   * Default implementation syncs one range at a time and stops at
+   * first failure.
+   */
+  virtual int
+  sync_ranges(const BufferObjectHandle& bo, const std::vector<std::pair<size_t,size_t>>& ranges, direction dir)
+  {
+    for (auto& range : ranges)
+      if (auto ret = sync(bo,range.second,range.first,dir,false).get<int>())
+        return ret;
+    return 0;
+  }
+
   virtual event
   copy(const BufferObjectHandle& dst_bo, const BufferObjectHandle& src_bo, size_t sz,
        size_t dst_offset, size_t src_offset) = 0;
@@ -260,12 +292,90 @@ public:
     throw std::runtime_error("exec_buf not supported");
   }
 
+  /**
+   * Submit multiple exec buffers in order.
+   *
+   * Default implementation submits one exec buffer at a time
+   * and stops at first failure.
+   *
+   * Return: Number of leading exec buffers submitted, less than
+   *   bos.size() on error with errno set
+   */
+  virtual size_t
+  exec_buf(const std::vector<ExecBufferObjectHandle>& bos)
+  {
+    size_t submitted = 0;
+    for (auto& bo : bos) {
+      if (exec_buf(bo))
+        break;
+      ++submitted;
+    }
+    return submitted;
+  }
+
+  /**
+   * Submit an exec buffer that starts when the exec buffers in the
+   * wait list have completed.
+   *
+   * Exec buffers in the wait list must have been submitted prior
+   * to this call.
+   */
+  virtual int
+  exec_buf(const ExecBufferObjectHandle& bo, const std::vector<ExecBufferObjectHandle>& waitlist)
+  {
+    throw std::runtime_error("exec_buf with wait list not supported");
+  }
+
+  /**
+   * Check if exec_buf with wait list is supported
+   */
+  virtual bool
+  has_exec_wait_list() const
+  {
+    return false;
+  }
+
   virtual int
   exec_wait(int timeout_ms) const
   {
     throw std::runtime_error("exec_wait not supported");
   }
 
+  /**
+   * Driver handle of an exec buffer as reported by exec_completions
+   */
+  virtual unsigned int
+  exec_buf_handle(const ExecBufferObjectHandle& bo) const
+  {
+    throw std::runtime_error("exec_buf_handle not supported");
+  }
+
+  /**
+   * Retrieve completed exec buffers without waiting
+   *
+   * @completed: Handles of completed exec buffers are appended
+   * Return: 0 on success, -ENOSYS if not supported, -EOVERFLOW if
+   *  completions were lost and all outstanding exec buffers must be checked
+   */
+  virtual int
+  exec_completions(std::vector<unsigned int>& completed)
+  {
+    return -ENOSYS;
+  }
+
+  /**
+   * DMA host memory to an absolute device address, bypassing buffer
+   * objects
+   *
+   * Return: number of bytes written, -ENOSYS if not supported, or
+   *  negative error code
+   */
+  virtual ssize_t
+  write_unmgd(const void* buffer, size_t sz, uint64_t device_addr)
+  {
+    return -ENOSYS;
+  }
+
 public:
   virtual int
   createWriteStream(StreamFlags flags, hal::StreamAttributes attr, uint64_t route, uint64_t flow, hal::StreamHandle *stream) = 0;
@@ -288,6 +398,12 @@ public:
   virtual ssize_t
   readStream(hal::StreamHandle stream, void* ptr, size_t offset, size_t size, hal::StreamXferReq* req) = 0;
 
+  virtual ssize_t
+  writeStreamv(hal::StreamHandle stream, const hal::StreamIovec* vec, size_t num, hal::StreamXferReq* req) = 0;
+
+  virtual ssize_t
+  readStreamv(hal::StreamHandle stream, const hal::StreamIovec* vec, size_t num, hal::StreamXferReq* req) = 0;
+
   virtual int
   pollStreams(StreamXferCompletions* comps, int min, int max, int* actual, int timeout) = 0;
 
@@ -17,10 +17,104 @@
 #include "hal2.h"
 #include "xrt/util/memory.h"
 #include "xrt/util/thread.h"
+#include "xrt/util/numa.h"
+#include "xrt/util/metrics.h"
 
 #include <cstring> // for std::memcpy
 #include <iostream>
 #include <sys/mman.h> // for POSIX munmap
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace {
+
+// Event that completes when the driver signals the eventfd of an
+// asynchronous sync.  The value is 0 on success, -EIO if the DMA
+// failed.  The event owns the eventfd.
+class eventfd_event
+{
+  int m_fd = -1;
+  mutable int m_value = 0;
+  mutable bool m_done = false;
+public:
+  typedef int value_type;
+
+  explicit
+  eventfd_event(int fd) : m_fd(fd) {}
+
+  eventfd_event(eventfd_event&& rhs) : m_fd(rhs.m_fd), m_value(rhs.m_value), m_done(rhs.m_done)
+  {
+    rhs.m_fd = -1;
+  }
+
+  ~eventfd_event()
+  {
+    if (m_fd >= 0)
+      close(m_fd);
+  }
+
+  int
+  wait() const
+  {
+    if (m_done)
+      return m_value;
+    uint64_t count = 0;
+    while (::read(m_fd,&count,sizeof(count)) != sizeof(count))
+      if (errno != EINTR)
+        return -errno;
+    m_value = (count >> 32) ? -EIO : 0;
+    m_done = true;
+    return m_value;
+  }
+
+  bool
+  ready() const
+  {
+    if (m_done)
+      return true;
+    struct pollfd pfd = {m_fd,POLLIN,0};
+    return poll(&pfd,1,0) == 1;
+  }
+};
+
+// Event that completes when all its chunk events have completed.
+// The value is the first non-zero chunk return value, or 0.
+class composite_event
+{
+  std::vector<xrt::task::event<int>> m_events;
+public:
+  typedef int value_type;
+
+  void
+  add(xrt::task::event<int>&& ev)
+  {
+    m_events.push_back(std::move(ev));
+  }
+
+  int
+  wait() const
+  {
+    int value = 0;
+    for (auto& ev : m_events) {
+      auto ret = ev.wait();
+      if (!value)
+        value = ret;
+    }
+    return value;
+  }
+
+  bool
+  ready() const
+  {
+    for (auto& ev : m_events)
+      if (!ev.ready())
+        return false;
+    return true;
+  }
+};
+
+}
 
 namespace xrt { namespace hal2 {
 
@@ -36,6 +130,9 @@ device::
   close();
   for (auto& q : m_queue)
     q.stop();
+  m_chunk_queue.stop();
+  if (m_pool)
+    m_pool->stop();
   for (auto& t : m_workers)
     t.join();
 }
@@ -73,10 +170,14 @@ void
 device::
 setup()
 {
-#ifndef PMD_OCL
-  if (!m_workers.empty())
-    return;
+  std::call_once(m_setup_flag,&device::setup_workers,this);
+}
 
+void
+device::
+setup_workers()
+{
+#ifndef PMD_OCL
   openOrError();
 
   auto threads = config::get_dma_threads(); // number of bidirectional channels
@@ -87,17 +188,68 @@ setup()
   if (!threads) // Guard against drivers who do not set m_devinfo.mDMAThreads
     threads = 2;
 
-  XRT_DEBUG(std::cout,"Creating ",2*threads," DMA worker threads\n");
-  for (unsigned int i=0; i<threads; ++i) {
-    // read and write queue workers
-    m_workers.emplace_back(xrt::thread(task::worker2,std::ref(m_queue[static_cast<qtype>(hal::queue_type::read)]),"read"));
-    m_workers.emplace_back(xrt::thread(task::worker2,std::ref(m_queue[static_cast<qtype>(hal::queue_type::write)]),"write"));
+  // Chunk workers service pieces of large sync requests, one worker
+  // per DMA channel.  Chunks are not serviced by the regular DMA
+  // workers, which may themselves be waiting for the chunks
+  auto chunk_size = config::get_dma_chunk_size();
+  if (chunk_size && threads > 1) {
+    auto alignment = std::max(m_devinfo.mDataAlignment,static_cast<size_t>(1));
+    m_chunk_size = ((chunk_size + alignment - 1) / alignment) * alignment;
+    XRT_DEBUG(std::cout,"Creating ",threads," DMA chunk worker threads, chunk size ",m_chunk_size,"\n");
+    for (unsigned int i=0; i<threads; ++i)
+      m_workers.emplace_back(xrt::thread(&device::dma_worker,this,std::ref(m_chunk_queue),i,"chunk"));
+  }
+
+  if (config::get_dma_work_stealing()) {
+    // One deque per worker, queue type is an affinity hint only and
+    // idle workers steal work of any type
+    XRT_DEBUG(std::cout,"Creating ",2*threads+1," work stealing DMA worker threads\n");
+    m_pool = xrt::make_unique<task::pool>(static_cast<qtype>(hal::queue_type::max));
+    std::vector<size_t> workers;
+    for (unsigned int i=0; i<threads; ++i) {
+      workers.push_back(m_pool->add_worker(static_cast<qtype>(hal::queue_type::read)));
+      workers.push_back(m_pool->add_worker(static_cast<qtype>(hal::queue_type::write)));
+    }
+    workers.push_back(m_pool->add_worker(static_cast<qtype>(hal::queue_type::misc)));
+    for (qtype qt=0; qt<static_cast<qtype>(hal::queue_type::max); ++qt)
+      m_queue[qt].attach(m_pool.get(),qt);
+    for (auto w : workers)
+      m_workers.emplace_back(xrt::thread(task::stealing_worker,std::ref(*m_pool),w));
+  }
+  else {
+    if (config::get_lockfree_task_queue()) {
+      for (auto& q : m_queue)
+        q.make_lockfree(config::get_task_queue_size());
+    }
+
+    XRT_DEBUG(std::cout,"Creating ",2*threads," DMA worker threads\n");
+    for (unsigned int i=0; i<threads; ++i) {
+      // read and write queue workers, worker i owns channel i in its direction
+      m_workers.emplace_back(xrt::thread(&device::dma_worker,this,std::ref(m_queue[static_cast<qtype>(hal::queue_type::read)]),i,"read"));
+      m_workers.emplace_back(xrt::thread(&device::dma_worker,this,std::ref(m_queue[static_cast<qtype>(hal::queue_type::write)]),i,"write"));
+    }
+    // single misc queue worker
+    m_workers.emplace_back(xrt::thread(task::worker2,std::ref(m_queue[static_cast<qtype>(hal::queue_type::misc)]),"misc"));
   }
-  // single misc queue worker
-  m_workers.emplace_back(xrt::thread(task::worker2,std::ref(m_queue[static_cast<qtype>(hal::queue_type::misc)]),"misc"));
+
+  // Keep DMA workers and host buffers on the NUMA node of the device
+  auto node = getNumaNode();
+  for (auto& t : m_workers)
+    xrt::set_numa_affinity(t,node);
+  if (config::get_numa_host_memory())
+    xrt::numa::set_host_memory_node(node);
 #endif
 }
 
+void
+device::
+dma_worker(task::queue& q, int channel, const std::string& id)
+{
+  if (m_ops->mSetSyncChannel && config::get_dma_channel_affinity())
+    m_ops->mSetSyncChannel(m_handle,channel);
+  task::worker2(q,id);
+}
+
 device::BufferObject*
 device::
 getBufferObject(const BufferObjectHandle& boh) const
@@ -108,6 +260,58 @@ getBufferObject(const BufferObjectHandle& boh) const
   return bo;
 }
 
+void
+device::
+unmapBO(unsigned int handle, void* addr, size_t size)
+{
+  if (m_ops->mUnmapBO)
+    m_ops->mUnmapBO(m_handle, handle, addr);
+  else
+    munmap(addr, size);
+}
+
+void
+device::
+open_capture()
+{
+  auto path = config::get_hal_capture();
+  if (path.empty() || path == "null")
+    return;
+  m_capture = xrt::make_unique<capture>(path + "." + std::to_string(m_idx),m_idx);
+}
+
+unsigned int
+device::
+allocBO(size_t sz, xclBOKind kind, uint64_t flags)
+{
+  auto start = capture_start();
+  auto handle = m_ops->mAllocBO(m_handle,sz,kind,flags);
+  if (m_capture)
+    m_capture->record(XCL_CAPTURE_ALLOC,start,true,handle,sz,0,flags,0);
+  return handle;
+}
+
+unsigned int
+device::
+allocUserPtrBO(void* userptr, size_t sz, uint64_t flags)
+{
+  auto start = capture_start();
+  auto handle = m_ops->mAllocUserPtrBO(m_handle,userptr,sz,flags);
+  if (m_capture)
+    m_capture->record(XCL_CAPTURE_ALLOC_USERPTR,start,true,handle,sz,0,flags,0);
+  return handle;
+}
+
+void
+device::
+freeBO(unsigned int handle)
+{
+  auto start = capture_start();
+  m_ops->mFreeBO(m_handle,handle);
+  if (m_capture)
+    m_capture->record(XCL_CAPTURE_FREE,start,true,handle,0,0,0,0);
+}
+
 device::ExecBufferObject*
 device::
 getExecBufferObject(const ExecBufferObjectHandle& boh) const
@@ -125,14 +329,17 @@ allocExecBuffer(size_t sz)
   auto delBufferObject = [this](ExecBufferObjectHandle::element_type* ebo) {
     ExecBufferObject* bo = static_cast<ExecBufferObject*>(ebo);
     XRT_DEBUG(std::cout,"deleted exec buffer object\n");
-    munmap(bo->data, bo->size);
-    m_ops->mFreeBO(m_handle, bo->handle);
+    unmapBO(bo->handle, bo->data, bo->size);
+    freeBO(bo->handle);
     delete bo;
   };
 
   auto ubo = xrt::make_unique<ExecBufferObject>();
   //ubo->handle = m_ops->mAllocBO(m_handle,sz,xclBOKind(0),(1<<31));  // 1<<31 xocl_ioctl.h
+  auto start = capture_start();
   ubo->handle = m_ops->mAllocBO(m_handle,sz,xclBOKind(0),(((uint64_t)1)<<31));  // 1<<31 xocl_ioctl.h
+  if (m_capture)
+    m_capture->record(XCL_CAPTURE_EXEC_ALLOC,start,true,ubo->handle,sz,0,0,0);
   if (ubo->handle == 0xffffffff)
     throw std::bad_alloc();
 
@@ -151,15 +358,15 @@ alloc(size_t sz)
   auto delBufferObject = [this](BufferObjectHandle::element_type* vbo) {
     BufferObject* bo = static_cast<BufferObject*>(vbo);
     XRT_DEBUG(std::cout,"deleted buffer object device address(",bo->deviceAddr,",",bo->size,")\n");
-    munmap(bo->hostAddr, bo->size);
-    m_ops->mFreeBO(m_handle, bo->handle);
+    unmapBO(bo->handle, bo->hostAddr, bo->size);
+    freeBO(bo->handle);
     delete bo;
   };
 
   xclBOKind kind = XCL_BO_DEVICE_RAM; //TODO: check default
   uint64_t flags = 0xFFFFFF; //TODO: check default, any bank.
   auto ubo = xrt::make_unique<BufferObject>();
-  ubo->handle = m_ops->mAllocBO(m_handle, sz, kind, flags);
+  ubo->handle = allocBO(sz, kind, flags);
   if (ubo->handle == 0xffffffff)
     throw std::bad_alloc();
 
@@ -180,13 +387,13 @@ alloc(size_t sz,void* userptr)
   auto delBufferObject = [this](BufferObjectHandle::element_type* vbo) {
     BufferObject* bo = static_cast<BufferObject*>(vbo);
     XRT_DEBUG(std::cout,"deleted buffer object device address(",bo->deviceAddr,",",bo->size,")\n");
-    m_ops->mFreeBO(m_handle, bo->handle);
+    freeBO(bo->handle);
     delete bo;
   };
 
   uint64_t flags = 0xFFFFFF; //TODO:check default
   auto ubo = xrt::make_unique<BufferObject>();
-  ubo->handle = m_ops->mAllocUserPtrBO(m_handle, userptr, sz, flags);
+  ubo->handle = allocUserPtrBO(userptr, sz, flags);
   if (ubo->handle == 0xffffffff)
     throw std::bad_alloc();
 
@@ -210,8 +417,8 @@ alloc(size_t sz, Domain domain, uint64_t memory_index, void* userptr)
     XRT_DEBUG(std::cout,"deleted buffer object device address(",bo->deviceAddr,",",bo->size,")\n");
     if (bo->kind != XCL_BO_DEVICE_PREALLOCATED_BRAM) {
       if (mmapRequired)
-        munmap(bo->hostAddr, bo->size);
-      m_ops->mFreeBO(m_handle, bo->handle);
+        unmapBO(bo->handle, bo->hostAddr, bo->size);
+      freeBO(bo->handle);
     }
     delete bo;
   };
@@ -230,10 +437,13 @@ alloc(size_t sz, Domain domain, uint64_t memory_index, void* userptr)
     if(domain==Domain::XRT_DEVICE_P2P_RAM) {
       flags |= (1<<30);
     }
+    if(domain==Domain::XRT_DEVICE_LONG_LIVED_RAM) {
+      flags |= XCL_BO_FLAGS_LONG_LIVED;
+    }
     if (userptr)
-      ubo->handle = m_ops->mAllocUserPtrBO(m_handle, userptr, sz, flags);
+      ubo->handle = allocUserPtrBO(userptr, sz, flags);
     else
-      ubo->handle = m_ops->mAllocBO(m_handle, sz, kind, flags);
+      ubo->handle = allocBO(sz, kind, flags);
 
     if (ubo->handle == 0xffffffff)
       throw std::bad_alloc();
@@ -300,7 +510,7 @@ device::
 free(const BufferObjectHandle& boh)
 {
   BufferObject* bo = getBufferObject(boh);
-  m_ops->mFreeBO(m_handle, bo->handle);
+  freeBO(bo->handle);
 }
 
 void
@@ -310,7 +520,7 @@ free_svm(void* svm_ptr)
   auto boh = svm_bo_lookup(svm_ptr);
   auto bo = getBufferObject(boh);
   eraseSVMBufferObjectMap(bo->hostAddr);
-  m_ops->mFreeBO(m_handle, bo->handle);
+  freeBO(bo->handle);
 }
 
 event
@@ -336,6 +546,16 @@ read(const BufferObjectHandle& boh, void* dst, size_t sz, size_t offset, bool as
     : event(typed_event<void *>(std::memcpy(dst, hostAddr, sz)));
 }
 
+static void
+count_dma_bytes(xclBOSyncDirection dir, size_t sz)
+{
+  static auto& to_device = xrt::metrics::get_counter
+    ("xrt_dma_bytes_total{direction=\"to_device\"}","Bytes synced between host and device buffers");
+  static auto& from_device = xrt::metrics::get_counter
+    ("xrt_dma_bytes_total{direction=\"from_device\"}","Bytes synced between host and device buffers");
+  (dir==XCL_BO_SYNC_BO_FROM_DEVICE ? from_device : to_device).add(sz);
+}
+
 event
 device::sync(const BufferObjectHandle& boh, size_t sz, size_t offset, direction dir1, bool async)
 {
@@ -344,12 +564,105 @@ device::sync(const BufferObjectHandle& boh, size_t sz, size_t offset, direction
     dir = XCL_BO_SYNC_BO_FROM_DEVICE;
 
   BufferObject* bo = getBufferObject(boh);
+  count_dma_bytes(dir,sz);
+
+  // asynchronous syncs are captured when submitted
+  auto start = capture_start();
+  if (m_capture && async)
+    m_capture->record(XCL_CAPTURE_SYNC,start,false,bo->handle,sz,offset+bo->offset,dir,0);
+
+  // chunk workers are known once workers are set up
+  setup();
+  if (auto chunk_size = get_chunk_size()) {
+    if (sz >= 2*chunk_size) {
+      auto ev = sync_chunked(bo,sz,offset,dir,async,chunk_size);
+      if (m_capture && !async)
+        m_capture->record(XCL_CAPTURE_SYNC,start,true,bo->handle,sz,offset+bo->offset,dir,0);
+      return ev;
+    }
+  }
+
+  if (async && m_ops->mSyncBOAsync && config::get_dma_async_sync()) {
+    // The driver queues the DMA and signals the eventfd, no worker
+    // thread is needed.  Fall back to workers if the driver refuses
+    auto fd = eventfd(0,EFD_CLOEXEC);
+    if (fd >= 0) {
+      if (!m_ops->mSyncBOAsync(m_handle,bo->handle,dir,sz,offset+bo->offset,fd))
+        return event(eventfd_event(fd));
+      ::close(fd);
+    }
+  }
 
   if (async) {
     auto qt = (dir==XCL_BO_SYNC_BO_FROM_DEVICE) ? hal::queue_type::read : hal::queue_type::write;
-    return event(addTaskF(m_ops->mSyncBO,qt,m_handle,bo->handle,dir,sz,offset));
+    return event(addTaskF(m_ops->mSyncBO,qt,m_handle,bo->handle,dir,sz,offset+bo->offset));
+  }
+  auto ret = m_ops->mSyncBO(m_handle, bo->handle, dir, sz, offset+bo->offset);
+  if (m_capture)
+    m_capture->record(XCL_CAPTURE_SYNC,start,true,bo->handle,sz,offset+bo->offset,dir,ret);
+  return event(typed_event<int>(std::move(ret)));
+}
+
+int
+device::
+sync_ranges(const BufferObjectHandle& boh, const std::vector<std::pair<size_t,size_t>>& ranges, direction dir1)
+{
+  if (!m_ops->mSyncBOv)
+    return hal::device::sync_ranges(boh,ranges,dir1);
+
+  xclBOSyncDirection dir = XCL_BO_SYNC_BO_TO_DEVICE;
+  if(dir1 == direction::DEVICE2HOST)
+    dir = XCL_BO_SYNC_BO_FROM_DEVICE;
+
+  // Offsets are relative to parent of sub buffer
+  BufferObject* bo = getBufferObject(boh);
+  std::vector<xclBOSyncRange> vec;
+  vec.reserve(ranges.size());
+  for (auto& range : ranges) {
+    vec.push_back({bo->handle,dir,range.second,range.first+bo->offset});
+    count_dma_bytes(dir,range.second);
   }
-  return event(typed_event<int>(m_ops->mSyncBO(m_handle, bo->handle, dir, sz, offset+bo->offset)));
+  auto start = capture_start();
+  auto ret = m_ops->mSyncBOv(m_handle,vec.data(),vec.size());
+
+  // ranges of one vectored sync share start and duration
+  if (m_capture)
+    for (auto& range : vec)
+      m_capture->record(XCL_CAPTURE_SYNC,start,true,range.boHandle,range.size,range.offset,dir,ret);
+  return ret;
+}
+
+size_t
+device::
+get_chunk_size() const
+{
+  // chunk workers exist only if chunking was enabled at setup
+  if (!m_chunk_size)
+    return 0;
+
+  // current size, follows xrt::config::reload()
+  size_t chunk_size = config::get_dma_chunk_size();
+  auto alignment = std::max(m_devinfo.mDataAlignment,static_cast<size_t>(1));
+  return ((chunk_size + alignment - 1) / alignment) * alignment;
+}
+
+event
+device::
+sync_chunked(BufferObject* bo, size_t sz, size_t offset, xclBOSyncDirection dir, bool async,
+             size_t chunk_size)
+{
+  // Offset is relative to parent of sub buffer
+  offset += bo->offset;
+
+  composite_event cev;
+  for (size_t done=0; done<sz; done+=chunk_size) {
+    auto chunk = std::min(chunk_size,sz-done);
+    cev.add(task::createF(m_chunk_queue,m_ops->mSyncBO,m_handle,bo->handle,dir,chunk,offset+done));
+  }
+
+  if (async)
+    return event(std::move(cev));
+  return event(typed_event<int>(cev.wait()));
 }
 
 event
@@ -357,7 +670,24 @@ device::copy(const BufferObjectHandle& dst_boh, const BufferObjectHandle& src_bo
 {
   BufferObject* dst_bo = getBufferObject(dst_boh);
   BufferObject* src_bo = getBufferObject(src_boh);
-  return event(typed_event<int>(m_ops->mCopyBO(m_handle, dst_bo->handle, src_bo->handle, sz, dst_offset, src_offset)));
+  dst_offset += dst_bo->offset;
+  src_offset += src_bo->offset;
+
+  // Large copies are pipelined in chunks over the chunk workers, each
+  // chunk gets a DMA channel of its own in the driver
+  auto chunk_size = get_chunk_size();
+  if (chunk_size && sz > chunk_size) {
+    composite_event cev;
+    for (size_t done=0; done<sz; done+=chunk_size) {
+      auto chunk = std::min(chunk_size,sz-done);
+      cev.add(task::createF(m_chunk_queue,m_ops->mCopyBO,m_handle,dst_bo->handle,src_bo->handle,chunk,
+                            dst_offset+done,src_offset+done));
+    }
+    return event(typed_event<int>(cev.wait()));
+  }
+
+  return event(typed_event<int>(m_ops->mCopyBO(m_handle, dst_bo->handle, src_bo->handle, sz,
+                                               dst_offset, src_offset)));
 }
 
 size_t
@@ -402,19 +732,125 @@ unmap(const ExecBufferObjectHandle& boh)
 {
 }
 
+void
+device::
+capture_exec_buf(const ExecBufferObject* bo, uint64_t start, int ret)
+{
+  // payload is the ERT packet, header word plus count words
+  auto header = *static_cast<const uint32_t*>(bo->data);
+  size_t words = ((header >> 12) & 0x7ff) + 1;
+  auto bytes = std::min(words*sizeof(uint32_t),bo->size);
+  m_capture->record(XCL_CAPTURE_EXEC_BUF,start,true,bo->handle,bo->size,0,0,ret,
+                    bo->data,static_cast<uint32_t>(bytes));
+}
+
 int
 device::
 exec_buf(const ExecBufferObjectHandle& boh)
 {
   auto bo = getExecBufferObject(boh);
-  return m_ops->mExecBuf(m_handle,bo->handle);
+  auto start = capture_start();
+  auto ret = m_ops->mExecBuf(m_handle,bo->handle);
+  if (m_capture)
+    capture_exec_buf(bo,start,ret);
+  return ret;
+}
+
+size_t
+device::
+exec_buf(const std::vector<ExecBufferObjectHandle>& bos)
+{
+  if (!m_ops->mExecBufBatch)
+    return hal::device::exec_buf(bos);
+
+  std::vector<unsigned int> handles;
+  handles.reserve(bos.size());
+  for (auto& boh : bos)
+    handles.push_back(getExecBufferObject(boh)->handle);
+  auto start = capture_start();
+  auto ret = m_ops->mExecBufBatch(m_handle,handles.data(),handles.size());
+  auto err = (ret<0) ? -ret : errno;
+  auto submitted = (ret<0) ? 0 : static_cast<size_t>(ret);
+
+  // commands of a batch share start and duration
+  if (m_capture)
+    for (size_t i=0; i<bos.size(); ++i)
+      capture_exec_buf(getExecBufferObject(bos[i]),start,(i<submitted) ? 0 : -err);
+  errno = err;
+  return submitted;
+}
+
+int
+device::
+exec_buf(const ExecBufferObjectHandle& boh, const std::vector<ExecBufferObjectHandle>& waitlist)
+{
+  if (!m_ops->mExecBufWithWaitList)
+    return hal::device::exec_buf(boh,waitlist);
+
+  std::vector<unsigned int> handles;
+  handles.reserve(waitlist.size());
+  for (auto& wboh : waitlist)
+    handles.push_back(getExecBufferObject(wboh)->handle);
+  auto bo = getExecBufferObject(boh);
+  auto start = capture_start();
+  auto ret = m_ops->mExecBufWithWaitList(m_handle,bo->handle,handles.size(),handles.data());
+
+  // the wait list is not captured, replay submits in capture order
+  if (m_capture)
+    capture_exec_buf(bo,start,ret);
+  return ret;
+}
+
+bool
+device::
+has_exec_wait_list() const
+{
+  return m_ops->mExecBufWithWaitList!=nullptr;
 }
 
 int
 device::
 exec_wait(int timeout_ms) const
 {
-  return m_ops->mExecWait(m_handle,timeout_ms);
+  auto start = capture_start();
+  auto ret = m_ops->mExecWait(m_handle,timeout_ms);
+  if (m_capture)
+    m_capture->record(XCL_CAPTURE_EXEC_WAIT,start,true,0,0,timeout_ms,0,ret);
+  return ret;
+}
+
+unsigned int
+device::
+exec_buf_handle(const ExecBufferObjectHandle& boh) const
+{
+  return getExecBufferObject(boh)->handle;
+}
+
+int
+device::
+exec_completions(std::vector<unsigned int>& completed)
+{
+  if (!m_ops->mExecCompletions)
+    return -ENOSYS;
+
+  unsigned int handles[64];
+  while (1) {
+    auto count = m_ops->mExecCompletions(m_handle,handles,64);
+    if (count < 0)
+      return count;
+    completed.insert(completed.end(),handles,handles+count);
+    if (count < 64)
+      return 0;
+  }
+}
+
+ssize_t
+device::
+write_unmgd(const void* buffer, size_t sz, uint64_t device_addr)
+{
+  if (!m_ops->mUnmgdPwrite)
+    return -ENOSYS;
+  return m_ops->mUnmgdPwrite(m_handle,0,buffer,sz,device_addr);
 }
 
 BufferObjectHandle
@@ -464,7 +900,7 @@ getBufferFromFd(const int fd, size_t& size, unsigned flags)
   auto delBufferObject = [this](BufferObjectHandle::element_type* vbo) {
     BufferObject* bo = static_cast<BufferObject*>(vbo);
     XRT_DEBUG(std::cout,"deleted buffer object device address(",bo->deviceAddr,",",bo->size,")\n");
-    munmap(bo->hostAddr, bo->size);
+    unmapBO(bo->handle, bo->hostAddr, bo->size);
     m_ops->mFreeBO(m_handle, bo->handle);
     delete bo;
   };
@@ -568,12 +1004,10 @@ ssize_t
 device::
 writeStream(hal::StreamHandle stream, const void* ptr, size_t offset, size_t size, hal::StreamXferReq* request) 
 {
-  //TODO:
-  (void)offset;
   xclQueueRequest req;
   xclReqBuffer buffer;
 
-  buffer.va = (uint64_t)ptr;
+  buffer.va = (uint64_t)ptr + offset;
   buffer.len = size;
   buffer.buf_hdl = 0;
 
@@ -594,11 +1028,10 @@ ssize_t
 device::
 readStream(hal::StreamHandle stream, void* ptr, size_t offset, size_t size, hal::StreamXferReq* request) 
 { 
-  (void)offset;
   xclQueueRequest req;
   xclReqBuffer buffer;
 
-  buffer.va = (uint64_t)ptr;
+  buffer.va = (uint64_t)ptr + offset;
   buffer.len = size;
   buffer.buf_hdl = 0;
 
@@ -612,6 +1045,45 @@ readStream(hal::StreamHandle stream, void* ptr, size_t offset, size_t size, hal:
   return m_ops->mReadQueue(m_handle,stream,&req);
 }
 
+// One request whose buffers the driver chains into one transfer
+static void
+gather_request(xclQueueRequest& req, std::vector<xclReqBuffer>& buffers,
+               const hal::StreamIovec* vec, size_t num, const hal::StreamXferReq* request)
+{
+  buffers.resize(num);
+  for (size_t i=0; i<num; ++i) {
+    buffers[i].va = reinterpret_cast<uint64_t>(vec[i].ptr);
+    buffers[i].len = vec[i].size;
+    buffers[i].buf_hdl = 0;
+  }
+
+  req.bufs = buffers.data();
+  req.buf_num = static_cast<uint32_t>(num);
+  req.flag = request->flags | XCL_QUEUE_REQ_GATHER;
+  req.timeout = request->timeout;
+  req.priv_data = request->priv_data;
+}
+
+ssize_t
+device::
+writeStreamv(hal::StreamHandle stream, const hal::StreamIovec* vec, size_t num, hal::StreamXferReq* request)
+{
+  xclQueueRequest req;
+  std::vector<xclReqBuffer> buffers;
+  gather_request(req,buffers,vec,num,request);
+  return m_ops->mWriteQueue(m_handle,stream,&req);
+}
+
+ssize_t
+device::
+readStreamv(hal::StreamHandle stream, const hal::StreamIovec* vec, size_t num, hal::StreamXferReq* request)
+{
+  xclQueueRequest req;
+  std::vector<xclReqBuffer> buffers;
+  gather_request(req,buffers,vec,num,request);
+  return m_ops->mReadQueue(m_handle,stream,&req);
+}
+
 int
 device::
 pollStreams(hal::StreamXferCompletions* comps, int min, int max, int* actual, int timeout) {
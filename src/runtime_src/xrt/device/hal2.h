@@ -19,6 +19,7 @@
 
 #include "xrt/device/hal.h"
 #include "xrt/device/halops2.h"
+#include "xrt/device/capture.h"
 #include "xrt/device/PMDOperations.h"
 
 #include <cassert>
@@ -27,6 +28,7 @@
 #include <type_traits>
 #include <cstring>
 #include <memory>
+#include <mutex>
 #include <map>
 
 namespace xrt { namespace hal2 {
@@ -58,7 +60,11 @@ class device : public xrt::hal::device
   // by a worker simultaneously
   using qtype = std::underlying_type<hal::queue_type>::type;
   std::array<task::queue,static_cast<qtype>(hal::queue_type::max)> m_queue;
+  std::unique_ptr<task::pool> m_pool; // work stealing workers if enabled
+  task::queue m_chunk_queue;          // chunks of large sync requests
+  size_t m_chunk_size = 0;            // 0 when chunk workers are not started
   std::vector<std::thread> m_workers;
+  std::once_flag m_setup_flag;        // workers are started once
   svmbomap_type m_svmbomap;
 
   std::shared_ptr<hal2::operations> m_ops;
@@ -66,6 +72,7 @@ class device : public xrt::hal::device
 
   hal2::device_handle m_handle;
   hal2::device_info m_devinfo;
+  std::unique_ptr<capture> m_capture; // if Runtime.hal_capture is set
 
   struct BufferObject : hal::buffer_object
   {
@@ -91,6 +98,63 @@ class device : public xrt::hal::device
   BufferObject*
   getBufferObject(const BufferObjectHandle& boh) const;
 
+  /**
+   * Start time of a captured call, 0 if calls are not captured
+   */
+  uint64_t
+  capture_start() const
+  {
+    return m_capture ? m_capture->now() : 0;
+  }
+
+  void
+  open_capture();
+
+  /**
+   * BO allocation and free through the driver, captured if enabled
+   */
+  unsigned int
+  allocBO(size_t sz, xclBOKind kind, uint64_t flags);
+
+  unsigned int
+  allocUserPtrBO(void* userptr, size_t sz, uint64_t flags);
+
+  void
+  freeBO(unsigned int handle);
+
+  void
+  capture_exec_buf(const ExecBufferObject* bo, uint64_t start, int ret);
+
+  /**
+   * Release a mapping obtained with mMapBO, through the driver when
+   * it supports xclUnmapBO so that cached mappings are left intact
+   */
+  void
+  unmapBO(unsigned int handle, void* addr, size_t size);
+
+  /**
+   * Current chunk size for large sync requests, 0 if chunking is
+   * disabled or no chunk workers were started
+   */
+  size_t
+  get_chunk_size() const;
+
+  /**
+   * Split a sync request in @chunk_size pieces that are serviced
+   * in parallel by the chunk workers.  The returned event completes
+   * when all chunks are done.
+   */
+  event
+  sync_chunked(BufferObject* bo, size_t sz, size_t offset, xclBOSyncDirection dir, bool async,
+               size_t chunk_size);
+
+  /**
+   * Service DMA tasks of a queue with syncs preferring DMA channel
+   * @channel, which this worker owns in its direction
+   */
+  void
+  dma_worker(task::queue& q, int channel, const std::string& id);
+
   ExecBufferObject*
   getExecBufferObject(const ExecBufferObjectHandle& boh) const;
 
@@ -116,9 +180,13 @@ class device : public xrt::hal::device
   task::queue&
   get_queue(hal::queue_type qt)
   {
+    setup();
     return m_queue[static_cast<qtype>(qt)];
   }
 
+  void
+  setup_workers();
+
   /**
    * emplace, erase, and find operations for m_svmbomap
    */
@@ -175,7 +243,8 @@ public:
    * Prepare the hal2 device for actual use
    *
    * If the device supports DMA threads then they are started by
-   * this function.
+   * this function.  Safe to call repeatedly and concurrently, the
+   * first task queued to the device calls it if nobody did before.
    */
   void
   setup();
@@ -190,8 +259,10 @@ public:
     assert(0);
 #else
     m_handle=m_ops->mOpen(m_idx,log,static_cast<hal2::verbosity_level>(level));
-    if (m_handle)
+    if (m_handle) {
       retval = true;
+      open_capture();
+    }
 #endif
     getDeviceInfo(&m_devinfo);
     return retval;
@@ -201,15 +272,22 @@ public:
   close()
   {
     if (m_handle) {
+      m_capture.reset();
       m_ops->mClose(m_handle);
       m_handle=nullptr;
     }
   }
 
+  virtual bool
+  is_open() const
+  {
+    return m_handle!=nullptr;
+  }
+
   virtual task::queue*
   getQueue(hal::queue_type qt)
   {
-    return &m_queue[static_cast<qtype>(qt)];
+    return &get_queue(qt);
   }
 
   virtual std::string
@@ -258,6 +336,12 @@ public:
     return m_devinfo.mNumCDMA;
   }
 
+  virtual int
+  getNumaNode() const
+  {
+    return m_devinfo.mNumaNode;
+  }
+
   virtual ExecBufferObjectHandle
   allocExecBuffer(size_t sz);
 
@@ -294,6 +378,9 @@ public:
   virtual event
   sync(const BufferObjectHandle& bo, size_t sz, size_t offset, direction dir, bool async);
 
+  virtual int
+  sync_ranges(const BufferObjectHandle& bo, const std::vector<std::pair<size_t,size_t>>& ranges, direction dir);
+
   virtual event
   copy(const BufferObjectHandle& dst_bo, const BufferObjectHandle& src_bo, size_t sz, size_t dst_offset, size_t src_offset);
 
@@ -318,9 +405,27 @@ public:
   virtual int
   exec_buf(const ExecBufferObjectHandle& bo);
 
+  virtual size_t
+  exec_buf(const std::vector<ExecBufferObjectHandle>& bos);
+
+  virtual int
+  exec_buf(const ExecBufferObjectHandle& bo, const std::vector<ExecBufferObjectHandle>& waitlist);
+
+  virtual bool
+  has_exec_wait_list() const;
+
   virtual int
   exec_wait(int timeout_ms) const;
 
+  virtual unsigned int
+  exec_buf_handle(const ExecBufferObjectHandle& bo) const;
+
+  virtual int
+  exec_completions(std::vector<unsigned int>& completed);
+
+  virtual ssize_t
+  write_unmgd(const void* buffer, size_t sz, uint64_t device_addr);
+
 public:
 
   virtual int
@@ -344,6 +449,12 @@ public:
   virtual ssize_t
   readStream(hal::StreamHandle stream, void* ptr, size_t offset, size_t size, hal::StreamXferReq* req);
 
+  virtual ssize_t
+  writeStreamv(hal::StreamHandle stream, const hal::StreamIovec* vec, size_t num, hal::StreamXferReq* req);
+
+  virtual ssize_t
+  readStreamv(hal::StreamHandle stream, const hal::StreamIovec* vec, size_t num, hal::StreamXferReq* req);
+
   virtual int 
   pollStreams(hal::StreamXferCompletions* comps, int min, int max, int* actual, int timeout);
 
@@ -34,13 +34,21 @@ operations(const std::string &fileName, void *fileHandle, unsigned int count)
   ,mExportBO(0)
   ,mGetBOProperties(0)
   ,mExecBuf(0)
+  ,mExecBufBatch(0)
+  ,mExecBufWithWaitList(0)
+  ,mExecCompletions(0)
   ,mExecWait(0)
   ,mFreeBO(0)
   ,mWriteBO(0)
   ,mReadBO(0)
   ,mSyncBO(0)
+  ,mSyncBOAsync(0)
+  ,mSyncBOv(0)
+  ,mSetSyncChannel(0)
   ,mCopyBO(0)
+  ,mUnmgdPwrite(0)
   ,mMapBO(0)
+  ,mUnmapBO(0)
   ,mWrite(0)
   ,mRead(0)
   ,mReClock2(0)
@@ -96,6 +104,9 @@ operations(const std::string &fileName, void *fileHandle, unsigned int count)
 
   mGetBOProperties = (getBOPropertiesFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclGetBOProperties");
   mExecBuf = (execBOFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclExecBuf");
+  mExecBufBatch = (execBOBatchFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclExecBufBatch");
+  mExecBufWithWaitList = (execBOWaitListFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclExecBufWithWaitList");
+  mExecCompletions = (execCompletionsFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclExecCompletions");
   mExecWait = (execWaitFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclExecWait");
 
   mFreeBO   = (freeBOFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclFreeBO");
@@ -109,8 +120,13 @@ operations(const std::string &fileName, void *fileHandle, unsigned int count)
     return;
 
   mSyncBO   = (syncBOFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclSyncBO");
+  mSyncBOAsync = (syncBOAsyncFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclSyncBOAsync");
+  mSyncBOv  = (syncBOvFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclSyncBOv");
+  mSetSyncChannel = (setSyncChannelFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclSetSyncChannel");
   mCopyBO   = (copyBOFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclCopyBO");
+  mUnmgdPwrite = (unmgdPwriteFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclUnmgdPwrite");
   mMapBO    = (mapBOFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclMapBO");
+  mUnmapBO  = (unmapBOFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclUnmapBO");
 
   mWrite    = (writeFuncType)dlsym(const_cast<void *>(mDriverHandle), "xclWrite");
   if(!mWrite)
@@ -62,6 +62,9 @@ private:
   typedef unsigned int (*exportBOFuncType)(xclDeviceHandle handle, unsigned int boHandle);
   typedef int (*getBOPropertiesFuncType)(xclDeviceHandle handle, unsigned int boHandle, xclBOProperties*);
   typedef unsigned int (*execBOFuncType)(xclDeviceHandle handle, unsigned int cmdBO);
+  typedef int (*execBOBatchFuncType)(xclDeviceHandle handle, const unsigned int *cmdBOs, size_t num);
+  typedef int (*execBOWaitListFuncType)(xclDeviceHandle handle, unsigned int cmdBO, size_t num_bo_in_wait_list, unsigned int *bo_wait_list);
+  typedef int (*execCompletionsFuncType)(xclDeviceHandle handle, unsigned int *cmdBOs, size_t max);
   typedef int (*execWaitFuncType)(xclDeviceHandle handle, int timeoutMS);
 
   typedef void (* freeBOFuncType)(xclDeviceHandle handle, unsigned int boHandle);
@@ -69,10 +72,17 @@ private:
   typedef size_t (* readBOFuncType)(xclDeviceHandle handle, unsigned int boHandle, void *dst, size_t size, size_t skip);
   typedef int (* syncBOFuncType)(xclDeviceHandle handle, unsigned int boHandle, xclBOSyncDirection dir,
                                  size_t size, size_t offset);
+  typedef int (* syncBOAsyncFuncType)(xclDeviceHandle handle, unsigned int boHandle, xclBOSyncDirection dir,
+                                      size_t size, size_t offset, int fd);
+  typedef int (* syncBOvFuncType)(xclDeviceHandle handle, const xclBOSyncRange *ranges, size_t num);
+  typedef int (* setSyncChannelFuncType)(xclDeviceHandle handle, int channel);
   typedef int (* copyBOFuncType)(xclDeviceHandle handle, unsigned int dstBoHandle, unsigned int srcBoHandle,
                                  size_t size, size_t dst_offset, size_t src_offset);
+  typedef ssize_t (* unmgdPwriteFuncType)(xclDeviceHandle handle, unsigned flags, const void *buf,
+                                          size_t size, uint64_t offset);
 
   typedef void* (* mapBOFuncType)(xclDeviceHandle handle, unsigned int boHandle, bool write);
+  typedef int (* unmapBOFuncType)(xclDeviceHandle handle, unsigned int boHandle, void *addr);
 
   typedef int (* reClock2FuncType)(xclDeviceHandle handle, unsigned short region,
                                    const unsigned short *targetFreqMHz);
@@ -157,14 +167,22 @@ public:
   getBOPropertiesFuncType mGetBOProperties;
 
   execBOFuncType mExecBuf;
+  execBOBatchFuncType mExecBufBatch;
+  execBOWaitListFuncType mExecBufWithWaitList;
+  execCompletionsFuncType mExecCompletions;
   execWaitFuncType mExecWait;
 
   freeBOFuncType mFreeBO;
   writeBOFuncType mWriteBO;
   readBOFuncType mReadBO;
   syncBOFuncType mSyncBO;
+  syncBOAsyncFuncType mSyncBOAsync;
+  syncBOvFuncType mSyncBOv;
+  setSyncChannelFuncType mSetSyncChannel;
   copyBOFuncType mCopyBO;
+  unmgdPwriteFuncType mUnmgdPwrite;
   mapBOFuncType mMapBO;
+  unmapBOFuncType mUnmapBO;
   writeFuncType mWrite;
   readFuncType mRead;
   reClock2FuncType mReClock2;
@@ -188,4 +188,20 @@ void pmdReleasePkts(unsigned port, PacketObject pkt)
   rte_pktmbuf_free(pkt);
 }
 
+unsigned pmdAcquirePktsBulk(unsigned port, PacketObject *pkts, unsigned count)
+{
+  /* One mempool access for the whole burst, mbufs come from the per
+   * lcore cache when possible */
+  if (rte_pktmbuf_alloc_bulk(m_po_pool, (struct rte_mbuf **)pkts, count))
+    return 0;
+  return count;
+}
+
+void pmdReleasePktsBulk(unsigned port, PacketObject *pkts, unsigned count)
+{
+  unsigned i;
+  for (i = 0; i < count; i++)
+    rte_pktmbuf_free(pkts[i]);
+}
+
 
@@ -19,10 +19,22 @@
 #include <map>
 #include <vector>
 
+#include "xrt/util/task.h"
+#include "xrt/util/metrics.h"
+
+#include <atomic>
+#include <iostream>
+
 namespace {
 
 using buffer_type = xrt::device::ExecBufferObjectHandle;
-static std::mutex s_mutex;
+using mapped_buffer_type = std::pair<buffer_type,void*>;
+
+// Max number of exec buffers kept on a device freelist
+constexpr size_t freelist_capacity = 1024;
+
+// Max number of devices with a freelist
+constexpr size_t max_devices = 64;
 
 // Static destruction logic to prevent double purging.
 
@@ -30,40 +42,116 @@ static std::mutex s_mutex;
 // destruction calls platform dtor, which in turns calls purge
 // commands, but static destruction could have deleted the static
 // object in this file first.
-static bool s_purged = false;
+static std::atomic<bool> s_purged {false};
+
+// Per device freelist of mapped exec buffers.  Buffers stay mapped
+// while on the freelist.
+struct freelist_type
+{
+  xrt::task::bounded_ring<mapped_buffer_type> buffers;
+  std::atomic<unsigned long> hits {0};
+  std::atomic<unsigned long> misses {0};
+
+  freelist_type() : buffers(freelist_capacity) {}
+};
+
+// Device freelists are looked up in a fixed table, where a slot
+// is claimed by a device with a CAS, so lookup never locks.  The
+// freelists are intentionally never deleted, they must outlive
+// static destruction of this file, see purge_command_freelist
+struct slot_type
+{
+  std::atomic<xrt::device*> device {nullptr};
+  std::atomic<freelist_type*> freelist {nullptr};
+};
 
 struct X {
-  std::map<xrt::device*,std::vector<buffer_type>> freelist;
+  slot_type slots[max_devices];
   X() {}
   ~X() { s_purged = true; }
 };
 
 static X sx;
 
-static buffer_type
-get_buffer(xrt::device* device,size_t sz)
+static freelist_type*
+get_freelist(xrt::device* device)
 {
-  std::lock_guard<std::mutex> lk(s_mutex);
-
-  auto itr = sx.freelist.find(device);
-  if (itr != sx.freelist.end()) {
-    auto& freelist = (*itr).second;
-    if (!freelist.empty()) {
-      auto buffer = freelist.back();
-      freelist.pop_back();
-      return buffer;
+  for (auto& slot : sx.slots) {
+    auto dev = slot.device.load();
+    if (!dev && slot.device.compare_exchange_strong(dev,device)) {
+      auto freelist = new freelist_type;
+      slot.freelist = freelist;
+      return freelist;
     }
+
+    if (dev==device) {
+      // wait for claiming thread to create the freelist
+      freelist_type* freelist = nullptr;
+      while (!(freelist=slot.freelist.load()))
+        std::this_thread::yield();
+      return freelist;
+    }
+  }
+
+  throw std::runtime_error("too many devices for exec buffer freelist");
+}
+
+static mapped_buffer_type
+alloc_buffer(xrt::device* device, size_t sz)
+{
+  auto bo = device->allocExecBuffer(sz); // not thread safe
+  auto data = device->map(bo);
+  return std::make_pair(std::move(bo),data);
+}
+
+// Exec buffers on the freelists of all devices
+static xrt::metrics::gauge&
+pooled_buffers()
+{
+  static auto& metric = xrt::metrics::get_gauge
+    ("xrt_exec_buffer_pool_free","Exec buffers available on device freelists");
+  return metric;
+}
+
+static bool
+push_buffer(freelist_type* freelist,mapped_buffer_type&& buffer)
+{
+  if (!freelist->buffers.try_push(std::move(buffer)))
+    return false;
+  pooled_buffers().add();
+  return true;
+}
+
+static mapped_buffer_type
+get_buffer(xrt::device* device,size_t sz)
+{
+  static auto& hits = xrt::metrics::get_counter
+    ("xrt_exec_buffer_pool_requests_total{result=\"hit\"}","Exec buffer requests served by freelist or allocation");
+  static auto& misses = xrt::metrics::get_counter
+    ("xrt_exec_buffer_pool_requests_total{result=\"miss\"}","Exec buffer requests served by freelist or allocation");
+
+  auto freelist = get_freelist(device);
+
+  mapped_buffer_type buffer;
+  if (freelist->buffers.try_pop(buffer)) {
+    ++freelist->hits;
+    hits.add();
+    pooled_buffers().sub();
+    return buffer;
   }
 
-  return device->allocExecBuffer(sz); // not thread safe
+  ++freelist->misses;
+  misses.add();
+  return alloc_buffer(device,sz);
 }
 
 static void
-free_buffer(xrt::device* device,buffer_type bo)
+free_buffer(xrt::device* device,mapped_buffer_type&& buffer)
 {
-  std::lock_guard<std::mutex> lk(s_mutex);
   s_purged=false;
-  sx.freelist[device].emplace_back(std::move(bo));
+
+  // buffer is released if the freelist is full
+  push_buffer(get_freelist(device),std::move(buffer));
 }
 
 } // namespace
@@ -79,17 +167,49 @@ purge_command_freelist()
   if (s_purged)
     return;
 
-  for (auto& elem : sx.freelist)
-    elem.second.clear();
+  std::vector<freelist_type*> freelists;
+  for (auto& slot : sx.slots) {
+    if (auto freelist = slot.freelist.load())
+      freelists.push_back(freelist);
+  }
+
+  // devices release their buffers concurrently, fork_join runs on
+  // this thread alone if the shared workers are already stopped
+  xrt::task::parallel_for(freelists,[](freelist_type* freelist) {
+      XRT_DEBUG(std::cout,"exec buffer freelist hits: ",freelist->hits
+                ," misses: ",freelist->misses,"\n");
+
+      mapped_buffer_type buffer;
+      while (freelist->buffers.try_pop(buffer)) {
+        buffer.first = nullptr;
+        pooled_buffers().sub();
+      }
+    });
 
   s_purged = true;
 }
 
+void
+init_command_freelist(xrt::device* device)
+{
+  auto freelist = get_freelist(device);
+  auto depth = std::min<size_t>(xrt::config::get_exec_buffer_pool_depth(),freelist_capacity);
+  for (auto count=freelist->buffers.size(); count<depth; ++count) {
+    s_purged=false;
+    push_buffer(freelist,alloc_buffer(device,command::regmap_size*sizeof(command::value_type)));
+  }
+}
+
 command::
 command(xrt::device* device, ert_cmd_opcode opcode)
+  : command(device,opcode,get_buffer(device,regmap_size*sizeof(value_type)))
+{}
+
+command::
+command(xrt::device* device, ert_cmd_opcode opcode, mapped_buffer_type&& buffer)
   : m_device(device)
-  , m_exec_bo(get_buffer(m_device,regmap_size*sizeof(value_type)))
-  , m_packet(m_device->map(m_exec_bo))
+  , m_exec_bo(std::move(buffer.first))
+  , m_packet(buffer.second)
 {
   static unsigned int uid_count = 0;
   m_uid = uid_count++;
@@ -111,6 +231,7 @@ command(command&& rhs)
   : m_uid(rhs.m_uid), m_device(rhs.m_device)
   , m_exec_bo(std::move(rhs.m_exec_bo))
   , m_packet(std::move(rhs.m_packet))
+  , m_submit_ns(rhs.m_submit_ns)
 {
   rhs.m_exec_bo = 0;
 }
@@ -120,8 +241,8 @@ command::
 {
   if (m_exec_bo) {
     XRT_DEBUG(std::cout,"xrt::command::~command(",m_uid,")\n");
-    m_device->unmap(m_exec_bo);
-    free_buffer(m_device,m_exec_bo);
+    // buffer stays mapped while on the freelist
+    free_buffer(m_device,std::make_pair(std::move(m_exec_bo),m_packet.data()));
   }
 }
 
@@ -22,7 +22,11 @@
 #include "xrt/device/device.h"
 
 #include <cstddef>
+#include <exception>
 #include <array>
+#include <utility>
+#include <vector>
+#include <memory>
 
 namespace xrt {
 
@@ -34,8 +38,8 @@ namespace xrt {
  */
 class command
 {
-  static constexpr auto regmap_size = 4096/sizeof(uint32_t);
 public:
+  static constexpr auto regmap_size = 4096/sizeof(uint32_t);
   using packet_type = xrt::regmap_placed<uint32_t,regmap_size>;
   using value_type = packet_type::word_type;
   using buffer_type = xrt::device::ExecBufferObjectHandle;
@@ -57,6 +61,14 @@ public:
    */
   ~command();
 
+private:
+  // Exec buffer and its mapped data
+  using mapped_buffer_type = std::pair<buffer_type,void*>;
+
+  command(xrt::device* device, ert_cmd_opcode opcode, mapped_buffer_type&& buffer);
+
+public:
+
   /**
    * Unique ID for this command.
    *
@@ -169,6 +181,50 @@ public:
     return reinterpret_cast<ERT_COMMAND_TYPE>(m_packet.data());
   }
 
+  /**
+   * Set commands that must complete before this command can start
+   *
+   * The wait list is resolved on device by the scheduler, which
+   * must support this, see xrt::scheduler::has_wait_list().  The
+   * commands in the wait list must have been scheduled before this
+   * command.
+   */
+  void
+  set_wait_list(std::vector<std::shared_ptr<command>> waitlist)
+  {
+    m_wait_list = std::move(waitlist);
+  }
+
+  const std::vector<std::shared_ptr<command>>&
+  get_wait_list() const
+  {
+    return m_wait_list;
+  }
+
+  /**
+   * Clear the wait list once it has been resolved by the scheduler
+   */
+  void
+  clear_wait_list()
+  {
+    m_wait_list.clear();
+  }
+
+  /**
+   * Time of submission to device in ns, set by the scheduler
+   */
+  void
+  set_submit_time(unsigned long ns)
+  {
+    m_submit_ns = ns;
+  }
+
+  unsigned long
+  get_submit_time() const
+  {
+    return m_submit_ns;
+  }
+
   /**
    * Wait for command completion
    */
@@ -192,6 +248,16 @@ public:
   virtual void
   done() const {}
 
+  /**
+   * Client call back for command failure
+   *
+   * Called instead of done() by host side work servicing the command
+   * when the work throws.  It is called from within the handler of
+   * the exception, which it may rethrow.
+   */
+  virtual void
+  error(const std::exception&) const {}
+
 public:
 
   /**
@@ -212,6 +278,12 @@ public:
     else if (s==ERT_CMD_STATE_RUNNING) {
       start();
     }
+    else if (s==ERT_CMD_STATE_ERROR || s==ERT_CMD_STATE_ABORT) {
+      // client was told through error(), only release waiters
+      std::lock_guard<std::mutex> lk(m_mutex);
+      m_done = true;
+      m_cmd_done.notify_all();
+    }
   }
 
 private:
@@ -220,6 +292,11 @@ private:
   buffer_type m_exec_bo;
   mutable packet_type m_packet;
 
+  // commands that must complete before this command starts
+  std::vector<std::shared_ptr<command>> m_wait_list;
+
+  unsigned long m_submit_ns = 0;
+
   // synchronization
   bool m_done = false;
   std::mutex m_mutex;
@@ -249,6 +326,16 @@ command_cast(const std::shared_ptr<command>& cmd)
 void
 purge_command_freelist();
 
+/**
+ * Preallocate exec buffer objects for commands on a device
+ *
+ * The number of buffers is specified in sdaccel.ini
+ *  [Runtime]
+ *   exec_buffer_pool_depth = 32
+ */
+void
+init_command_freelist(xrt::device* device);
+
 } // xrt
 
 #endif
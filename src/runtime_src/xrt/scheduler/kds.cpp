@@ -29,16 +29,22 @@
 #include "xrt/util/debug.h"
 #include "xrt/util/time.h"
 #include "xrt/util/task.h"
+#include "xrt/util/memory.h"
+#include "xrt/util/metrics.h"
 #include "xrt/device/device.h"
 #include "driver/include/ert.h"
 #include "command.h"
 
 #include <memory>
 #include <cstring>
+#include <cstdio>
 #include <cerrno>
 #include <algorithm>
 #include <thread>
+#include <atomic>
 #include <list>
+#include <vector>
+#include <unordered_map>
 #include <map>
 
 namespace {
@@ -59,12 +65,38 @@ static bool threaded_notification = true;
 // Main command monitor interfacing to embedded MB scheduler
 ////////////////////////////////////////////////////////////////
 static std::mutex s_mutex;
-static std::condition_variable s_work;
 static bool s_running = false;
-static bool s_stop = false;
+static std::atomic<bool> s_stop {false};
 static std::exception_ptr s_exception;
-static std::map<const xrt::device*, command_queue_type> s_device_cmds;
-static std::map<const xrt::device*, std::thread> s_device_monitor_threads;
+
+// Per device command monitor.  Launched commands are added to the
+// submitted list under the device mutex.  The monitor thread moves
+// submitted commands to its own running list which it checks without
+// holding any lock, so launching of commands on one device is never
+// serialized with completion checking of this or any other device.
+//
+// Launched commands are first staged.  The launching thread that
+// finds no submission in progress becomes the submitter and submits
+// all staged commands with one call to the driver, including those
+// staged by other threads while it was submitting.
+struct device_monitor
+{
+  std::mutex mutex;
+  std::condition_variable work;
+  command_queue_type submitted;
+  std::thread thread;
+
+  std::mutex launch_mutex;
+  command_queue_type staged;
+  bool submitting = false;
+
+  // Completions are retrieved from driver completion ring
+  bool completion_ring = false;
+};
+
+// Guarded by s_mutex, but safe to access a device monitor without
+// lock once it has been inserted by init
+static std::map<const xrt::device*, std::unique_ptr<device_monitor>> s_device_monitors;
 
 inline bool
 is_51_dsa(const xrt::device* device)
@@ -80,13 +112,177 @@ is_command_done(const command_type& cmd)
   return epacket->state >= ERT_CMD_STATE_COMPLETED;
 }
 
+// Adaptive busy poll for low latency completion.  The spin budget
+// doubles, up to the configured maximum, when spinning observed a
+// completion, and halves when the budget expired idle, so a device
+// running long commands quickly stops burning cycles.  The maximum
+// follows polling_throttle across xrt::config::reload().
+class spinner
+{
+  unsigned int m_generation = xrt::config::tuning::unset;
+  unsigned long m_max_ns = 0;
+  unsigned long m_min_ns = 0;
+  unsigned long m_budget_ns = 0;
+
+  void
+  update_tuning()
+  {
+    auto& tuning = xrt::config::get_tuning();
+    if (tuning.generation == m_generation)
+      return;
+    m_generation = tuning.generation;
+    m_max_ns = tuning.polling_throttle*1000ul;
+    m_min_ns = m_max_ns/16;
+    m_budget_ns = m_max_ns;
+  }
+
+public:
+  spinner()
+  {
+    update_tuning();
+  }
+
+  /**
+   * Spin until @done returns true or budget expires
+   *
+   * Return: true if @done returned true, false if budget expired
+   */
+  template <typename Predicate>
+  bool
+  spin(Predicate done)
+  {
+    update_tuning();
+    if (!m_budget_ns)
+      return false;
+
+    auto end = xrt::time_ns() + m_budget_ns;
+    do {
+      if (done()) {
+        m_budget_ns = std::min(m_max_ns,m_budget_ns*2);
+        return true;
+      }
+    } while (xrt::time_ns() < end);
+
+    m_budget_ns = std::max(m_min_ns,m_budget_ns/2);
+    return false;
+  }
+};
+
+// Running time estimate per kernel, used to pick how completion of
+// its commands is waited for.  Host polling wins for kernels that
+// complete within the polling budget, interrupts win for longer
+// running kernels.  A kernel is identified by the CU mask of its
+// start commands, the estimate is an exponentially weighted moving
+// average of observed submission to completion time.  Accessed only
+// by the device monitor thread.
+class runtime_estimator
+{
+  struct estimate
+  {
+    unsigned long ns = 0;
+    xrt::metrics::gauge* runtime = nullptr;
+    xrt::metrics::counter* polled = nullptr;
+    xrt::metrics::counter* waited = nullptr;
+  };
+
+  unsigned long m_poll_ns;
+  std::unordered_map<uint32_t,estimate> m_estimates;
+
+  static bool
+  get_key(const command_type& cmd, uint32_t& key)
+  {
+    auto epacket = xrt::command_cast<ert_start_kernel_cmd*>(cmd.get());
+    if (epacket->opcode!=ERT_START_CU)
+      return false;
+    key = epacket->cu_mask;
+    return true;
+  }
+
+  estimate&
+  get_estimate(uint32_t key)
+  {
+    auto itr = m_estimates.find(key);
+    if (itr!=m_estimates.end())
+      return itr->second;
+
+    auto& e = m_estimates[key];
+    if (xrt::metrics::enabled()) {
+      char label[32];
+      std::snprintf(label,sizeof(label),"{cu_mask=\"0x%x\"",key);
+      std::string lbl(label);
+      e.runtime = &xrt::metrics::get_gauge
+        ("xrt_kds_kernel_runtime_ns"+lbl+"}","Estimated kernel run time");
+      e.polled = &xrt::metrics::get_counter
+        ("xrt_kds_kernel_completions_total"+lbl+",mode=\"poll\"}","Kernel completions per wait mode");
+      e.waited = &xrt::metrics::get_counter
+        ("xrt_kds_kernel_completions_total"+lbl+",mode=\"interrupt\"}","Kernel completions per wait mode");
+    }
+    return e;
+  }
+
+  bool
+  is_short(const estimate& e) const
+  {
+    // kernels without an estimate are polled until one is known
+    return e.ns <= m_poll_ns;
+  }
+
+public:
+  runtime_estimator()
+    : m_poll_ns(xrt::config::get_polling_throttle()*1000ul)
+  {}
+
+  /**
+   * Return: true if completion of @cmd should be host polled
+   */
+  bool
+  poll(const command_type& cmd)
+  {
+    m_poll_ns = xrt::config::get_polling_throttle()*1000ul;
+    uint32_t key = 0;
+    return m_poll_ns && (!get_key(cmd,key) || is_short(get_estimate(key)));
+  }
+
+  /**
+   * Record observed run time of completed @cmd
+   */
+  void
+  update(const command_type& cmd, unsigned long now)
+  {
+    uint32_t key = 0;
+    if (!get_key(cmd,key))
+      return;
+
+    auto& e = get_estimate(key);
+    auto counter = (m_poll_ns && is_short(e)) ? e.polled : e.waited;
+    if (counter)
+      counter->add();
+
+    auto ns = now - cmd->get_submit_time();
+    e.ns = e.ns ? (e.ns*7 + ns)/8 : ns;
+    if (e.runtime)
+      e.runtime->set(e.ns);
+  }
+};
+
+static xrt::metrics::gauge&
+outstanding_commands()
+{
+  static auto& metric = xrt::metrics::get_gauge
+    ("xrt_kds_outstanding_commands","Commands launched and not yet completed");
+  return metric;
+}
+
 static bool
-check(const command_type& cmd)
+check(const command_type& cmd, runtime_estimator& estimator)
 {
   if (!is_command_done(cmd))
     return false;
 
+  estimator.update(cmd,xrt::time_ns());
+
   XRT_DEBUG(std::cout,"xrt::kds::command(",cmd->get_uid(),") [running->done]\n");
+  outstanding_commands().sub();
   if (!threaded_notification) {
     cmd->notify(ERT_CMD_STATE_COMPLETED);
     return true;
@@ -100,74 +296,277 @@ check(const command_type& cmd)
   return true;
 }
 
+// Commands with a wait list are submitted one at a time, in order
+// with the batches of commands before and after.  Returns the number
+// of leading commands submitted, less than all commands on error with
+// errno set.
+static size_t
+submit(xrt::device* device, const command_queue_type& cmds)
+{
+  size_t submitted = 0;
+  std::vector<xrt::device::ExecBufferObjectHandle> bos;
+  auto submit_bos = [device,&bos,&submitted]() {
+    auto count = (bos.size()==1)
+      ? (device->exec_buf(bos.front()) ? 0 : 1)
+      : device->exec_buf(bos);
+    auto ok = (count==bos.size());
+    submitted += count;
+    bos.clear();
+    return ok;
+  };
+
+  for (auto& cmd : cmds) {
+    auto& waitlist = cmd->get_wait_list();
+    if (waitlist.empty()) {
+      bos.push_back(cmd->get_exec_bo());
+      continue;
+    }
+
+    if (!bos.empty() && !submit_bos())
+      return submitted;
+
+    std::vector<xrt::device::ExecBufferObjectHandle> wbos;
+    wbos.reserve(waitlist.size());
+    for (auto& wcmd : waitlist)
+      wbos.push_back(wcmd->get_exec_bo());
+    if (device->exec_buf(cmd->get_exec_bo(),wbos))
+      return submitted;
+    cmd->clear_wait_list();
+    ++submitted;
+  }
+
+  if (!bos.empty())
+    submit_bos();
+  return submitted;
+}
+
+// Fail a command that was not submitted.  The client is told through
+// error() and waiters for the command are released.
 static void
-launch(command_type cmd)
+fail(const command_type& cmd, const std::runtime_error& err)
 {
-  XRT_DEBUG(std::cout,"xrt::kds::command(",cmd->get_uid(),") [new->submitted->running]\n");
+  ert_packet* epacket = xrt::command_cast<ert_packet*>(cmd.get());
+  epacket->state = ERT_CMD_STATE_ERROR;
+  try {
+    throw err;
+  }
+  catch (const std::exception& ex) {
+    try {
+      cmd->error(ex);
+    }
+    catch (...) {
+    }
+  }
+  cmd->notify(ERT_CMD_STATE_ERROR);
+}
+
+// Launch commands of one device, the commands are moved to the
+// staged list of the device.  The submitting thread submits until
+// nothing is staged, commands of any thread that fail to submit are
+// failed, and the submitting thread throws once it is done.
+static void
+launch(command_queue_type& launched)
+{
+#ifdef XRT_VERBOSE
+  for (auto& cmd : launched)
+    XRT_DEBUG(std::cout,"xrt::kds::command(",cmd->get_uid(),") [new->submitted->running]\n");
+#endif
 
-  // Submit the command
-  auto device = cmd->get_device();
-  auto exec_bo = cmd->get_exec_bo();
-  if (device->exec_buf(exec_bo))
-    throw std::runtime_error(std::string("failed to launch exec buffer '") + std::strerror(errno) + "'");
+  static auto& launched_total = xrt::metrics::get_counter
+    ("xrt_kds_commands_total","Commands launched");
+  launched_total.add(launched.size());
+  outstanding_commands().add(launched.size());
+
+  auto device = launched.front()->get_device();
 
   // thread safe access, since guaranteed to be inserted in init
-  auto& submitted_cmds = s_device_cmds[device];
+  auto& monitor = *s_device_monitors[device];
 
-  // Store command so completion can be tracked
-  std::lock_guard<std::mutex> lk(s_mutex);
-  submitted_cmds.push_back(cmd);
-  s_work.notify_all();
+  // Stage the commands, return if another thread is submitting
+  // since that thread will pick up these commands
+  {
+    std::lock_guard<std::mutex> lk(monitor.launch_mutex);
+    monitor.staged.splice(monitor.staged.end(),launched);
+    if (monitor.submitting)
+      return;
+    monitor.submitting = true;
+  }
+
+  std::string error;
+  while (1) {
+    command_queue_type cmds;
+    {
+      std::lock_guard<std::mutex> lk(monitor.launch_mutex);
+      if (monitor.staged.empty()) {
+        monitor.submitting = false;
+        break;
+      }
+      cmds.swap(monitor.staged);
+    }
+
+    // Submit the commands
+    auto now = xrt::time_ns();
+    for (auto& cmd : cmds)
+      cmd->set_submit_time(now);
+    auto submitted = submit(device,cmds);
+    if (submitted < cmds.size()) {
+      auto err = errno;
+
+      // The submitted commands are tracked as usual and complete, the
+      // remaining commands, possibly staged by other threads, were not
+      // submitted and are failed
+      auto failed = cmds.size() - submitted;
+      std::runtime_error ex(std::string("failed to launch ") + std::to_string(failed)
+                            + " exec buffer(s) '" + std::strerror(err) + "'");
+      command_queue_type unsubmitted;
+      unsubmitted.splice(unsubmitted.end(),cmds,std::next(cmds.begin(),submitted),cmds.end());
+      outstanding_commands().sub(failed);
+      for (auto& cmd : unsubmitted)
+        fail(cmd,ex);
+      if (error.empty())
+        error = ex.what();
+    }
+
+    // Store commands so completion can be tracked
+    std::lock_guard<std::mutex> lk(monitor.mutex);
+    monitor.submitted.splice(monitor.submitted.end(),cmds);
+    monitor.work.notify_one();
+  }
+
+  if (!error.empty())
+    throw std::runtime_error(error);
 }
 
+// Command monitor using completion ring.  Running commands are indexed
+// by exec buffer handle, so only commands reported by the driver as
+// completed are checked.  Falls back to checking all running commands
+// when the driver reports lost completions.
 static void
-monitor_loop(const xrt::device* device)
+monitor_ring_loop(xrt::device* device)
+{
+  // thread safe access, since guaranteed to be inserted in init
+  auto& monitor = *s_device_monitors[device];
+
+  // Commands owned by this thread, checked without lock
+  std::unordered_map<unsigned int,command_type> running_cmds;
+  command_queue_type new_cmds;
+  std::vector<unsigned int> completed;
+  spinner spin;
+  runtime_estimator estimator;
+
+  auto check_all = [&running_cmds,&estimator]() {
+    for (auto itr=running_cmds.begin(); itr!=running_cmds.end(); )
+      itr = check(itr->second,estimator) ? running_cmds.erase(itr) : std::next(itr);
+  };
+
+  // Host poll only if a running command is of a short running kernel
+  auto poll = [&running_cmds,&estimator]() {
+    return std::any_of(running_cmds.begin(),running_cmds.end(),
+                       [&estimator](const std::pair<const unsigned int,command_type>& e)
+                       { return estimator.poll(e.second); });
+  };
+
+  while (1) {
+    {
+      std::unique_lock<std::mutex> lk(monitor.mutex);
+
+      // Larger wait
+      while (!s_stop && running_cmds.empty() && monitor.submitted.empty())
+        monitor.work.wait(lk);
+
+      new_cmds.splice(new_cmds.end(),monitor.submitted);
+    }
+
+    if (s_stop)
+      return;
+
+    // A command may have completed before it was added to the running
+    // commands, in which case its ring entry was already discarded
+    for (auto& cmd : new_cmds)
+      if (!check(cmd,estimator))
+        running_cmds.emplace(device->exec_buf_handle(cmd->get_exec_bo()),std::move(cmd));
+    new_cmds.clear();
+
+    if (running_cmds.empty())
+      continue;
+
+    completed.clear();
+    auto ret = device->exec_completions(completed);
+    if (ret==0 && completed.empty()) {
+      auto done = [&]() { return (ret = device->exec_completions(completed)) || !completed.empty(); };
+      if (!poll() || !spin.spin(done)) {
+        // Finer wait
+        device->exec_wait(1000);
+        ret = device->exec_completions(completed);
+      }
+    }
+
+    if (ret) {
+      check_all();
+      continue;
+    }
+
+    for (auto handle : completed) {
+      auto itr = running_cmds.find(handle);
+      if (itr!=running_cmds.end() && check(itr->second,estimator))
+        running_cmds.erase(itr);
+    }
+  }
+}
+
+static void
+monitor_loop(xrt::device* device)
 {
   unsigned long loops = 0;           // number of outer loops
   unsigned long sleeps = 0;          // number of sleeps
 
   // thread safe access, since guaranteed to be inserted in init
-  auto& submitted_cmds = s_device_cmds[device];
+  auto& monitor = *s_device_monitors[device];
+
+  if (monitor.completion_ring)
+    return monitor_ring_loop(device);
+
+  // Commands owned by this thread, checked without lock
+  command_queue_type running_cmds;
+  spinner spin;
+  runtime_estimator estimator;
 
   while (1) {
     ++loops;
 
     {
-      {
-        std::unique_lock<std::mutex> lk(s_mutex);
-
-        // Larger wait
-        while (!s_stop && submitted_cmds.empty()) {
-          ++sleeps;
-          s_work.wait(lk);
-        }
+      std::unique_lock<std::mutex> lk(monitor.mutex);
+
+      // Larger wait
+      while (!s_stop && running_cmds.empty() && monitor.submitted.empty()) {
+        ++sleeps;
+        monitor.work.wait(lk);
       }
 
-      if (s_stop)
-        return;
+      running_cmds.splice(running_cmds.end(),monitor.submitted);
+    }
 
-      // Finer wait
+    if (s_stop)
+      return;
+
+    // Busy poll command states if any command is of a short running
+    // kernel, then finer wait.  Completions observed while spinning
+    // leave driver poll events pending, these merely cause spurious
+    // wakeups of subsequent waits.
+    auto poll = [&estimator](const command_type& cmd) { return estimator.poll(cmd); };
+    auto done = [&running_cmds]() {
+      return std::any_of(running_cmds.begin(),running_cmds.end(),is_command_done);
+    };
+    if (!std::any_of(running_cmds.begin(),running_cmds.end(),poll) || !spin.spin(done))
       while (device->exec_wait(1000)==0) ;
 
-      std::lock_guard<std::mutex> lk(s_mutex);
-      auto end = submitted_cmds.end();
-      for (auto itr=submitted_cmds.begin(); itr!=end; ) {
-        auto& cmd = (*itr);
-        if (check(cmd)) {
-          itr = submitted_cmds.erase(itr);
-          end = submitted_cmds.end();
-        }
-        else {
-          ++itr;
-        }
-      }
-    }
+    running_cmds.remove_if([&estimator](const command_type& cmd) { return check(cmd,estimator); });
   }
 }
 
 
 static void
-monitor(const xrt::device* device)
+monitor(xrt::device* device)
 {
   try {
     monitor_loop(device);
@@ -193,7 +592,23 @@ namespace xrt { namespace kds {
 void
 schedule(const command_type& cmd)
 {
-  launch(cmd);
+  command_queue_type launched {cmd};
+  launch(launched);
+}
+
+void
+schedule(const std::vector<command_type>& cmds)
+{
+  // Consecutive commands of same device are staged together and
+  // submitted with one call to the driver
+  command_queue_type launched;
+  for (auto& cmd : cmds) {
+    if (!launched.empty() && launched.front()->get_device()!=cmd->get_device())
+      launch(launched);
+    launched.push_back(cmd);
+  }
+  if (!launched.empty())
+    launch(launched);
 }
 
 void
@@ -214,14 +629,17 @@ stop()
   if (!s_running)
     return;
 
-  {
-    std::lock_guard<std::mutex> lk(s_mutex);
-    s_stop = true;
-  }
+  s_stop = true;
 
-  s_work.notify_all();
-  for (auto& e : s_device_monitor_threads)
-    e.second.join();
+  std::lock_guard<std::mutex> lk(s_mutex);
+  for (auto& e : s_device_monitors) {
+    auto& monitor = *e.second;
+    {
+      std::lock_guard<std::mutex> mlk(monitor.mutex);
+      monitor.work.notify_all();
+    }
+    monitor.thread.join();
+  }
 
   notify_queue.stop();
   if (threaded_notification)
@@ -258,8 +676,11 @@ init(xrt::device* device, size_t regmap_size, bool cu_isr, size_t num_cus, size_
   epacket->ert     = xrt::config::get_ert();
   epacket->polling = xrt::config::get_ert_polling();
   epacket->cu_dma  = cudma;
-  epacket->cu_isr  = cu_isr && xrt::config::get_ert_cuisr();
+  // without ert, cu_isr tells the driver that CUs support interrupts
+  epacket->cu_isr  = cu_isr && (xrt::config::get_ert_cuisr() || !epacket->ert);
   epacket->cq_int  = xrt::config::get_ert_cqint();
+  epacket->cycles  = xrt::config::get_ert_cycles();
+  epacket->cu_dma_thresh = xrt::config::get_ert_cudma_threshold();
 
   // cu addr map
   std::copy(cu_addr_map.begin(), cu_addr_map.end(), epacket->data);
@@ -278,11 +699,18 @@ init(xrt::device* device, size_t regmap_size, bool cu_isr, size_t num_cus, size_
   // create a submitted command queue for this device if necessary,
   // create a command monitor thread for this device if necessary
   std::lock_guard<std::mutex> lk(s_mutex);
-  auto itr = s_device_monitor_threads.find(device);
-  if (itr==s_device_monitor_threads.end()) {
+  auto itr = s_device_monitors.find(device);
+  if (itr==s_device_monitors.end()) {
     XRT_DEBUG(std::cout,"creating monitor thread and queue for device '",device->getName(),"'\n");
-    s_device_cmds.emplace(device,command_queue_type());
-    s_device_monitor_threads.emplace(device,xrt::thread(::monitor,device));
+    auto& monitor = *s_device_monitors.emplace(device,xrt::make_unique<device_monitor>()).first->second;
+
+    // the completion ring is registered on first retrieval, which must
+    // precede any command launched on this device
+    std::vector<unsigned int> completed;
+    monitor.completion_ring = xrt::config::get_kds_completion_ring()
+      && device->exec_completions(completed)!=-ENOSYS;
+    monitor.thread = xrt::thread(::monitor,device);
+    xrt::set_numa_affinity(monitor.thread,device->getNumaNode());
   }
 
   XRT_DEBUG(std::cout,"configure complete\n");
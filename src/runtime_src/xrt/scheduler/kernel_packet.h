@@ -0,0 +1,184 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef xrt_kernel_packet_h_
+#define xrt_kernel_packet_h_
+
+#include "xrt/scheduler/command.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+
+namespace xrt {
+
+/**
+ * Kernel argument of type T at a fixed register map byte offset
+ *
+ * The offset is the argument's offset in the CU register map as
+ * listed in the xclbin, or as defined by the HLS generated driver
+ * header, e.g. XKERNEL_CONTROL_ADDR_A_DATA.
+ */
+template <typename T, std::size_t Offset>
+struct kernel_arg
+{
+  static_assert(Offset % sizeof(uint32_t) == 0,"kernel argument offset must be word aligned");
+  static_assert(std::is_trivially_copyable<T>::value,"kernel argument must be trivially copyable");
+
+  using type = T;
+  static constexpr std::size_t offset = Offset;
+
+  // one past the last register word of this argument
+  static constexpr std::size_t end_word = (Offset + sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+};
+
+namespace detail {
+
+// c++11 constexpr functions are single return statements, so the
+// register map size is computed recursively over the argument list
+constexpr std::size_t
+regmap_words()
+{
+  return 0;
+}
+
+template <typename Arg, typename ...Args>
+constexpr std::size_t
+regmap_words(Arg, Args... args)
+{
+  return (Arg::end_word > regmap_words(args...)) ? Arg::end_word : regmap_words(args...);
+}
+
+// std::index_sequence is c++14
+template <std::size_t ...I>
+struct index_sequence {};
+
+template <std::size_t N, std::size_t ...I>
+struct make_index_sequence : make_index_sequence<N-1, N-1, I...> {};
+
+template <std::size_t ...I>
+struct make_index_sequence<0, I...> : index_sequence<I...> {};
+
+} // detail
+
+/**
+ * Start kernel packet for a kernel with a fixed signature
+ *
+ * Encodes an ERT_START_CU command directly into the mapped exec
+ * buffer of an xrt::command.  Register offsets and the packet size
+ * are compile time constants, so each argument is a fixed size store
+ * and there is no per launch encoding through the arginfo of the
+ * kernel as done by xocl for OpenCL kernels.
+ *
+ *  using vadd = xrt::kernel_packet<xrt::kernel_arg<uint64_t,0x10>,  // a
+ *                                  xrt::kernel_arg<uint64_t,0x1c>,  // b
+ *                                  xrt::kernel_arg<uint32_t,0x28>>; // size
+ *  auto cmd = vadd::create(device,cu_mask,a_addr,b_addr,1024);
+ *  xrt::scheduler::schedule(cmd);
+ *
+ * Only the mandatory CU mask is encoded, CUs above index 31 are
+ * not supported.
+ */
+template <typename ...Args>
+class kernel_packet
+{
+  template <std::size_t I>
+  using arg_type = typename std::tuple_element<I,std::tuple<Args...>>::type;
+
+  // header and cu mask precede the register map
+  static constexpr std::size_t regmap_start = 2;
+
+public:
+  static constexpr std::size_t regmap_words = detail::regmap_words(Args()...);
+  static constexpr std::size_t packet_words = regmap_start + regmap_words;
+  static_assert(packet_words <= command::regmap_size,"kernel register map exceeds command packet");
+
+  /**
+   * Encode the packet header of a start kernel command
+   *
+   * @cmd: command constructed with ERT_START_CU
+   */
+  explicit
+  kernel_packet(command& cmd)
+    : m_packet(cmd.get_packet().data())
+  {
+    cmd.get_packet().resize(packet_words);
+    auto skcmd = cmd.get_ert_cmd<ert_start_kernel_cmd*>();
+    skcmd->extra_cu_masks = 0;
+    skcmd->count = packet_words - 1;
+  }
+
+  /**
+   * Create a start kernel command with all arguments set
+   *
+   * @device:  device on which the command is executed
+   * @cu_mask: CUs that can execute the command
+   * @values:  kernel arguments in signature order
+   * Return:   command ready to be scheduled
+   */
+  static std::shared_ptr<command>
+  create(xrt::device* device, uint32_t cu_mask, const typename Args::type&... values)
+  {
+    auto cmd = std::make_shared<command>(device,ERT_START_CU);
+    kernel_packet packet(*cmd);
+    packet.set_cu_mask(cu_mask);
+    packet.set_args(values...);
+    return cmd;
+  }
+
+  void
+  set_cu_mask(uint32_t cu_mask)
+  {
+    m_packet[1] = cu_mask;
+  }
+
+  /**
+   * Set argument I of the kernel signature
+   */
+  template <std::size_t I>
+  void
+  set_arg(const typename arg_type<I>::type& value)
+  {
+    std::memcpy(m_packet + regmap_start + arg_type<I>::offset/sizeof(uint32_t),&value,sizeof(value));
+  }
+
+  /**
+   * Set all arguments in signature order
+   */
+  void
+  set_args(const typename Args::type&... values)
+  {
+    set_args(detail::make_index_sequence<sizeof...(Args)>(),values...);
+  }
+
+private:
+  template <std::size_t ...I>
+  void
+  set_args(detail::index_sequence<I...>, const typename Args::type&... values)
+  {
+    int expand[] = {0, (set_arg<I>(values),0)...};
+    (void)expand;
+  }
+
+  uint32_t* m_packet;
+};
+
+} // xrt
+
+#endif
@@ -18,9 +18,14 @@
 #include "xrt/config.h"
 #include "xrt/device/device.h"
 #include <cstdlib>
+#include <mutex>
 
 namespace {
 
+// Scheduler threads are running
+static bool s_started = false;
+static std::mutex s_start_mutex;
+
 static bool
 emulation_mode()
 {
@@ -40,7 +45,8 @@ is_sw_emulation()
 inline bool
 kds_enabled(bool forceoff=false)
 {
-  static bool enabled = !is_sw_emulation() && xrt::config::get_kds();
+  static bool enabled = (!is_sw_emulation() || xrt::config::get_sw_emu_kds())
+    && xrt::config::get_kds();
   if (forceoff)
     enabled = false;
   return enabled;
@@ -113,6 +119,7 @@ start()
     kds::start();
   else
     sws::start();
+  s_started = true;
 }
 
 void
@@ -122,6 +129,7 @@ stop()
     kds::stop();
   else
     sws::stop();
+  s_started = false;
 
   purge_command_freelist();
 }
@@ -138,16 +146,40 @@ schedule(const command_type& cmd)
     sws::schedule(cmd);
 }
 
+void
+schedule(const std::vector<command_type>& cmds)
+{
+  if (kds_enabled())
+    kds::schedule(cmds);
+  else
+    sws::schedule(cmds);
+}
+
 void
 init(xrt::device* device, size_t regmap_size, bool cu_isr, size_t num_cus, size_t cu_offset, size_t cu_base_addr, const std::vector<uint32_t>& cu_addr_map)
 {
+  // Started here on first program load unless started by platform
+  {
+    std::lock_guard<std::mutex> lk(s_start_mutex);
+    if (!s_started)
+      start();
+  }
+
   emu_50_disable_kds(device);
   aws_50_disable_kds(device);
 
+  init_command_freelist(device);
+
   if (kds_enabled())
     kds::init(device,regmap_size,cu_isr,num_cus,cu_offset,cu_base_addr,cu_addr_map);
   else
     sws::init(device,regmap_size,num_cus,cu_offset,cu_base_addr,cu_addr_map);
 }
 
+bool
+has_wait_list(const xrt::device* device)
+{
+  return kds_enabled() && device->has_exec_wait_list();
+}
+
 }} // scheduler,xrt
@@ -52,6 +52,12 @@ init(xrt::device* device, size_t slot_size, size_t num_cus, size_t cu_offset, si
 void 
 schedule(const command_type& cmd);
 
+/**
+ * Schedule a batch of commands for execution
+ */
+void
+schedule(const std::vector<command_type>& cmds);
+
 } // sws
 
 /**
@@ -81,6 +87,12 @@ namespace kds {
 void 
 schedule(const command_type& cmd);
 
+/**
+ * Schedule a batch of commands for execution
+ */
+void
+schedule(const std::vector<command_type>& cmds);
+
 void
 start();
 
@@ -99,6 +111,15 @@ namespace scheduler {
 void 
 schedule(const command_type& cmd);
 
+/**
+ * Schedule a batch of commands for execution on either sws or kds
+ *
+ * With kds, the commands are submitted to the driver with one
+ * call rather than one call per command.
+ */
+void
+schedule(const std::vector<command_type>& cmds);
+
 void
 start();
 
@@ -108,6 +129,14 @@ stop();
 void
 init(xrt::device* device, size_t slot_size, bool cu_isr,size_t num_cus, size_t cu_offset, size_t cu_base_addr, const std::vector<uint32_t>& cu_addr_map);
 
+/**
+ * Check if command wait lists are resolved on device
+ *
+ * See xrt::command::set_wait_list()
+ */
+bool
+has_wait_list(const xrt::device* device);
+
 } // scheduler
 
 
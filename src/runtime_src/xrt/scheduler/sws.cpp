@@ -25,9 +25,13 @@
 #include "xrt/util/debug.h"
 #include "xrt/util/thread.h"
 #include "xrt/util/task.h"
+#include "xrt/util/memory.h"
 #include "command.h"
 #include <limits>
+#include <algorithm>
 #include <bitset>
+#include <chrono>
+#include <cstdlib>
 #include <vector>
 #include <list>
 #include <mutex>
@@ -61,22 +65,13 @@ const value_type CMD_START_KERNEL = 0;
 const value_type CMD_CONFIGURE = 1;
 
 ////////////////////////////////////////////////////////////////
-// Configuarable constants
+// Poll policy
 ////////////////////////////////////////////////////////////////
-// Actual number of cus
-static size_type num_cus = 0;
-
-// CU base address
-static addr_type cu_base_address = 0x0;
-
-// CU offset (addone is 32k (1<<15), OCL is 4k (1<<12))
-static size_type cu_offset = 12;
-
-// Enable features via  configure_mb
-static value_type cu_trace_enabled = 0;
-
-// Mapping from cu_idx to its base address
-static std::vector<uint32_t> cu_addr_map;
+// Upper bound on sleep between polls when no command made
+// progress.  In emulation each poll is a round trip to the
+// device process so the bound is larger.
+const unsigned int max_poll_backoff_usec = 50;
+const unsigned int max_emu_poll_backoff_usec = 1000;
 
 ////////////////////////////////////////////////////////////////
 // Helper functions for extracting command header information
@@ -117,13 +112,32 @@ regmap_size(value_type header_value)
   return payload_size(header_value) - cu_masks(header_value);
 }
 
+
 /**
- * Convert cu idx into cu address
+ * In emulation each CU register access is a round trip to the device
+ * process that is executing the CUs
  */
-inline addr_type
-cu_idx_to_addr(size_type cu_idx)
+static bool
+emulation_mode()
 {
-  return cu_addr_map[cu_idx];
+  static bool val = (std::getenv("XCL_EMULATION_MODE") != nullptr);
+  return val;
+}
+
+/**
+ * Busy poll budget after last progress, before sleeping between polls
+ */
+static unsigned long
+poll_spin_ns()
+{
+  // not cached, follows xrt::config::reload()
+  return xrt::config::get_sws_poll_spin(emulation_mode() ? 0 : 100) * 1000ul;
+}
+
+static unsigned int
+poll_backoff_max_usec()
+{
+  return emulation_mode() ? max_emu_poll_backoff_usec : max_poll_backoff_usec;
 }
 
 struct slot_info
@@ -156,7 +170,7 @@ struct slot_info
     return cmd->get_packet();
   }
 
-  void start(size_type cu)
+  void start(size_type cu, bool cu_trace_enabled)
   {
     // update cus to reflect running cu
     cus.reset();
@@ -179,43 +193,12 @@ struct slot_info
 
 // Command notification is threaded through task queue
 // and notifier.  This allows the scheduler to continue
-// while host callback can be processed in the background
+// while host callback can be processed in the background.
+// The notifier is shared by all device schedulers.
 static xrt::task::queue notify_queue;
 static std::thread notifier;
 static bool threaded_notification = true;
 
-static std::list<slot_info> command_queue;
-
-// Fixed sized map from cu_idx -> slot_info
-static const slot_info* cu_slot_usage[max_cus];
-
-// Bitmask indicating status of CUs. (0) idle, (1) running.
-// Only 'num_cus' lower bits are used
-static bitmask_type cu_status;
-
-// Track runtime of each cu
-static uint64_t cu_total_runtime[max_cus] = {0};
-static uint64_t cu_start_time[max_cus] = {0};
-static uint64_t cu_stop_time[max_cus] = {0};
-
-
-/**
- * MB configuration
- */
-static void
-setup()
-{
-  command_queue.clear();
-
-  // Initialize cu_slot_usage
-  for (size_type i=0; i<num_cus; ++i) {
-    cu_slot_usage[i] = nullptr;
-    cu_total_runtime[i] = 0;
-    cu_start_time[i] = 0;
-    cu_stop_time[i] = 0;
-  }
-}
-
 /**
  * Notify host of command completion
  *
@@ -248,294 +231,450 @@ notify_host(slot_info* slot)
 }
 
 /**
- * Configure a CU at argument address
+ * Software scheduler for one device
  *
- * Write register map to CU control register at address
- *
- * @param cu_addr
- *  Address of CU control register
- * @param regmap_addr
- *  The address of the register map to copy into the CU control
- *  register
- * @param regmap_size
- *  The size of register map in 32 bit words
+ * Each device has its own CU table, command queue, and scheduler
+ * thread, so that devices are scheduled independently of each
+ * other.
  */
-inline void
-configure_cu(slot_info* slot, size_type cu)
+class device_scheduler
 {
-  auto cu_addr = cu_idx_to_addr(cu);
-  auto size = regmap_size(slot->header_value);
+  ////////////////////////////////////////////////////////////////
+  // Configuarable constants
+  ////////////////////////////////////////////////////////////////
+  // Actual number of cus
+  size_type num_cus = 0;
 
-  // data past header and cu_masks
-  auto regmap = slot->get_packet().data() + 1 + cu_masks(slot->header_value);
+  // CU base address
+  addr_type cu_base_address = 0x0;
 
-  // write register map, starting at base + 0xC
-  // 0x4, 0x8 used for interrupt, which is initialized in setu
-  slot->device->write_register(cu_addr,regmap,size*4);
+  // CU offset (addone is 32k (1<<15), OCL is 4k (1<<12))
+  size_type cu_offset = 12;
 
-  // start cu
-  const_cast<uint32_t*>(regmap)[0] = 1;
-  slot->device->write_register(cu_addr,regmap,size*4);
-}
+  // Enable features via  configure_mb
+  value_type cu_trace_enabled = 0;
 
-/**
- * Start a cu for command in slot
- *
- * @param slot_idx
- *  Index of command
- * @return
- *  True of a CU was started, false otherwise
- */
-static bool
-start_cu(slot_info* slot)
-{
-  auto cus = slot->cus;
-
-  // Check all CUs against argument cus mask and against cu_status
-  for (size_type cu=0; cu<num_cus; ++cu) {
-    if (cus.test(cu) && !cu_status.test(cu)) {
-      slot->start(cu);           // note that slot is starting on cu
-      configure_cu(slot,cu);
-      cu_status.flip(cu);        // toggle cu status bit, it is now busy
-      cu_slot_usage[cu] = slot;
-      return true;
-    }
-  }
-  return false;
-}
+  // Mapping from cu_idx to its base address
+  std::vector<uint32_t> cu_addr_map;
 
-/**
- * Check CU status
- *
- * CU to check is indicated by bit position in argument cu_mask.
- *
- * If CU is done, then host status register is updated accordingly
- * and internal cu_status register that tracks running CUs is toggled
- * at corresponding position.
- *
- * @param cu_mask
- *   A bitmask with 1 bit set. Position of bit indicates the CU to check
- * @return
- *   True if CU is done, false otherwise
- */
-static bool
-check_cu(slot_info* slot,bool wait=false)
-{
-  auto device = slot->device;
-  auto& cu_mask = slot->cus;
-
-  // find cu idx in mask
-  size_type cu_idx = 0;
-  for (; !cu_mask.test(cu_idx); ++cu_idx);
-  XRT_ASSERT(cu_idx < num_cus,"bad cu idx");
-  XRT_ASSERT(cu_status.test(cu_idx),"cu wasn't started");
-  auto cu_addr = cu_idx_to_addr(cu_idx);
-  value_type ctrlreg = 0;
-
-  do {
-    device->read_register(cu_addr,&ctrlreg,4);
-    if (ctrlreg & (CONTROL_AP_IDLE | CONTROL_AP_DONE)) {
-      cu_status.flip(cu_idx);
-      cu_slot_usage[cu_idx] = nullptr;
-      return true;
-    }
-  } while (wait);
+  std::list<slot_info> command_queue;
 
-  return false;
-}
+  // Fixed sized map from cu_idx -> slot_info
+  const slot_info* cu_slot_usage[max_cus] = {nullptr};
 
-/**
- * Check if queue is idle except for command in argument slot
- */
-static bool
-check_idle_prereq(slot_info* slot)
-{
-  auto end=command_queue.end();
-  for (auto itr=command_queue.begin(); itr!=end; ++itr) {
-    auto s = &(*itr);
-    if (s==slot)
-      continue;
-    if ((s->header_value & 0xF) != 0x4) {
-      XRT_DEBUGF("slot(%d) is busy\n",s->get_uid());
-      return false;
+  // Bitmask indicating status of CUs. (0) idle, (1) running.
+  // Only 'num_cus' lower bits are used
+  bitmask_type cu_status;
+
+  // Track runtime of each cu
+  uint64_t cu_total_runtime[max_cus] = {0};
+  uint64_t cu_start_time[max_cus] = {0};
+  uint64_t cu_stop_time[max_cus] = {0};
+
+  // New commands from host, guarded by s_mutex
+  std::mutex s_mutex;
+  std::condition_variable s_work;
+  bool s_stop=false;
+  std::vector<command_type> s_cmds;
+
+  std::thread s_scheduler;
+
+  /**
+   * Convert cu idx into cu address
+   */
+  addr_type
+  cu_idx_to_addr(size_type cu_idx) const
+  {
+    return cu_addr_map[cu_idx];
+  }
+
+  /**
+   * MB configuration
+   */
+  void
+  setup()
+  {
+    command_queue.clear();
+
+    // Initialize cu_slot_usage
+    for (size_type i=0; i<num_cus; ++i) {
+      cu_slot_usage[i] = nullptr;
+      cu_total_runtime[i] = 0;
+      cu_start_time[i] = 0;
+      cu_stop_time[i] = 0;
     }
   }
 
-  return true;
-}
+  /**
+   * Configure a CU at argument address
+   *
+   * Write register map to CU control register at address
+   *
+   * @param slot
+   *  The command with the register map to copy into the CU control
+   *  register
+   * @param cu
+   *  Index of CU to configure
+   */
+  void
+  configure_cu(slot_info* slot, size_type cu)
+  {
+    auto cu_addr = cu_idx_to_addr(cu);
+    auto size = regmap_size(slot->header_value);
 
+    // data past header and cu_masks
+    auto regmap = slot->get_packet().data() + 1 + cu_masks(slot->header_value);
 
-/**
- * Configure MB and peripherals
- *
- * Wait for CONFIGURE_MB in specified slot, then configure as
- * requested.
- *
- * This function is used in two different scenarios:
- *  1. MB reset/startup, in which case the CONFIGURE_MB is guaranteed
- *     to be in a slot at default slot offset (4K), most likely slot 0.
- *  2. During regular scheduler loop, in which case the CONFIGURE_MB
- *     packet is at an arbitrary slot location.   In this scenario, the
- *     function may return (false) without processing the command if
- *     other commands are currently executing; this is to avoid hardware
- *     lockup.
- *
- * @param slot_idx
- *   The slot index with the CONFIGURE_MB command
- * @return
- *   True if CONFIGURE_MB packet was processed, false otherwise
- */
-static bool
-configure(slot_info* slot)
-{
-  // Ignore the CONFIGURE packet if any commands are
-  // currently being processed.  The main scheduler loop
-  // will revisit the CONFIGURE packet again in case 2).
-  if (!check_idle_prereq(slot))
+    // write register map, starting at base + 0xC
+    // 0x4, 0x8 used for interrupt, which is initialized in setu
+    slot->device->write_register(cu_addr,regmap,size*4);
+
+    // start cu
+    const_cast<uint32_t*>(regmap)[0] = 1;
+    slot->device->write_register(cu_addr,regmap,size*4);
+  }
+
+  /**
+   * Start a cu for command in slot
+   *
+   * @param slot_idx
+   *  Index of command
+   * @return
+   *  True of a CU was started, false otherwise
+   */
+  bool
+  start_cu(slot_info* slot)
+  {
+    auto cus = slot->cus;
+
+    // Check all CUs against argument cus mask and against cu_status
+    for (size_type cu=0; cu<num_cus; ++cu) {
+      if (cus.test(cu) && !cu_status.test(cu)) {
+        slot->start(cu,cu_trace_enabled); // note that slot is starting on cu
+        configure_cu(slot,cu);
+        cu_status.flip(cu);        // toggle cu status bit, it is now busy
+        cu_slot_usage[cu] = slot;
+        return true;
+      }
+    }
     return false;
+  }
 
-  XRT_DEBUGF("configure found)\n");
-  XRT_DEBUGF("slot(%d) [new->queued]\n",slot->get_uid());
-  XRT_DEBUGF("slot(%d) [queued->running]\n",slot->get_uid());
+  /**
+   * Check CU status
+   *
+   * CU to check is indicated by bit position in argument cu_mask.
+   *
+   * If CU is done, then host status register is updated accordingly
+   * and internal cu_status register that tracks running CUs is toggled
+   * at corresponding position.
+   *
+   * @param cu_mask
+   *   A bitmask with 1 bit set. Position of bit indicates the CU to check
+   * @return
+   *   True if CU is done, false otherwise
+   */
+  bool
+  check_cu(slot_info* slot,bool wait=false)
+  {
+    auto device = slot->device;
+    auto& cu_mask = slot->cus;
+
+    // find cu idx in mask
+    size_type cu_idx = 0;
+    for (; !cu_mask.test(cu_idx); ++cu_idx);
+    XRT_ASSERT(cu_idx < num_cus,"bad cu idx");
+    XRT_ASSERT(cu_status.test(cu_idx),"cu wasn't started");
+    auto cu_addr = cu_idx_to_addr(cu_idx);
+    value_type ctrlreg = 0;
+
+    do {
+      device->read_register(cu_addr,&ctrlreg,4);
+      if (ctrlreg & (CONTROL_AP_IDLE | CONTROL_AP_DONE)) {
+        cu_status.flip(cu_idx);
+        cu_slot_usage[cu_idx] = nullptr;
+        return true;
+      }
+    } while (wait);
 
-  auto& packet = slot->get_packet();
-  num_cus=packet[2];
-  cu_offset=packet[3];
-  cu_base_address=packet[4];
+    return false;
+  }
 
-  // Features
-  auto features = packet[5];
-  cu_trace_enabled = features & 0x8;
+  /**
+   * Check if queue is idle except for command in argument slot
+   */
+  bool
+  check_idle_prereq(slot_info* slot)
+  {
+    auto end=command_queue.end();
+    for (auto itr=command_queue.begin(); itr!=end; ++itr) {
+      auto s = &(*itr);
+      if (s==slot)
+        continue;
+      if ((s->header_value & 0xF) != 0x4) {
+        XRT_DEBUGF("slot(%d) is busy\n",s->get_uid());
+        return false;
+      }
+    }
 
-  // (Re)initilize MB
-  setup();
+    return true;
+  }
 
-  // notify host
-  notify_host(slot);
+  /**
+   * Configure MB and peripherals
+   *
+   * Wait for CONFIGURE_MB in specified slot, then configure as
+   * requested.
+   *
+   * This function is used in two different scenarios:
+   *  1. MB reset/startup, in which case the CONFIGURE_MB is guaranteed
+   *     to be in a slot at default slot offset (4K), most likely slot 0.
+   *  2. During regular scheduler loop, in which case the CONFIGURE_MB
+   *     packet is at an arbitrary slot location.   In this scenario, the
+   *     function may return (false) without processing the command if
+   *     other commands are currently executing; this is to avoid hardware
+   *     lockup.
+   *
+   * @param slot_idx
+   *   The slot index with the CONFIGURE_MB command
+   * @return
+   *   True if CONFIGURE_MB packet was processed, false otherwise
+   */
+  bool
+  configure(slot_info* slot)
+  {
+    // Ignore the CONFIGURE packet if any commands are
+    // currently being processed.  The main scheduler loop
+    // will revisit the CONFIGURE packet again in case 2).
+    if (!check_idle_prereq(slot))
+      return false;
 
-  slot->header_value = (slot->header_value & ~0xF) | 0x4; // free
-  XRT_DEBUGF("slot(%d) [running->free]\n",slot->get_uid());
+    XRT_DEBUGF("configure found)\n");
+    XRT_DEBUGF("slot(%d) [new->queued]\n",slot->get_uid());
+    XRT_DEBUGF("slot(%d) [queued->running]\n",slot->get_uid());
 
-  return true;
-}
+    auto& packet = slot->get_packet();
+    num_cus=packet[2];
+    cu_offset=packet[3];
+    cu_base_address=packet[4];
 
-/**
- * Process special command.
- *
- * Special commands are not performace critical
- *
- * @return true
- *   If command was processed, false otherwise
- */
-static bool
-process_special_command(slot_info* slot, size_type opcode)
-{
-  if (opcode==CMD_CONFIGURE)
-    return configure(slot);
-  return false;
-}
+    // Features
+    auto features = packet[5];
+    cu_trace_enabled = features & 0x8;
 
-static std::mutex s_mutex;
-static std::condition_variable s_work;
-static bool s_stop=false;
-static std::vector<command_type> s_cmds;
+    // (Re)initilize MB
+    setup();
 
-/**
- * Main routine executed by embedded scheduler loop
- *
- * For each command slot do
- *  1. If status is free (0x4), then read new command header
- *     Status remains free (0x4), or transitions to new (0x1)
- *  2. If status is new (0x1), then read CUs in command
- *     Status transitions to queued (0x2)
- *  3. If status is queued (0x2), then start command on available CU
- *     Status remains queued if no CUs available, or transitions to running (0x3)
- *  4. If status is running (0x4), then check CU status
- *     Status remains running (0x4) if CU is still running, or
- *     transitions to free if CU is done
- */
-static void
-scheduler_loop()
-{
-  // Basic setup will be changed by configure_mb, but is necessary
-  // for even configure_mb() to work.
-  setup();
+    // notify host
+    notify_host(slot);
 
-  while (1) {
+    slot->header_value = (slot->header_value & ~0xF) | 0x4; // free
+    XRT_DEBUGF("slot(%d) [running->free]\n",slot->get_uid());
 
-    {
-      std::unique_lock<std::mutex> lk(s_mutex);
-      while (!s_stop && command_queue.empty() && s_cmds.empty())
-        s_work.wait(lk);
-
-      if (s_stop) {
-        if (!command_queue.empty() || !s_cmds.empty())
-          throw std::runtime_error("software scheduler stopping while there are active commands");
-        break;
-      }
+    return true;
+  }
 
-      // copy new commands to pending list
-      std::copy(s_cmds.begin(),s_cmds.end(),std::back_inserter(command_queue));
-      s_cmds.clear();
-    } // lk scope
-
-    // iterate commands
-    auto end = command_queue.end();
-    auto nitr = command_queue.begin();
-    for (auto itr=nitr; itr!=end; itr=nitr) {
-      auto slot = &(*itr);
-
-      if ((slot->header_value & 0xF) == 0x1) { // new
-        auto opc = opcode(slot->header_value);
-        if (opc!=CMD_START_KERNEL) { // Non performance critical command
-          process_special_command(slot,opc);
-          continue;
+  /**
+   * Process special command.
+   *
+   * Special commands are not performace critical
+   *
+   * @return true
+   *   If command was processed, false otherwise
+   */
+  bool
+  process_special_command(slot_info* slot, size_type opcode)
+  {
+    if (opcode==CMD_CONFIGURE)
+      return configure(slot);
+    return false;
+  }
+
+  /**
+   * Main routine executed by embedded scheduler loop
+   *
+   * For each command slot do
+   *  1. If status is free (0x4), then read new command header
+   *     Status remains free (0x4), or transitions to new (0x1)
+   *  2. If status is new (0x1), then read CUs in command
+   *     Status transitions to queued (0x2)
+   *  3. If status is queued (0x2), then start command on available CU
+   *     Status remains queued if no CUs available, or transitions to running (0x3)
+   *  4. If status is running (0x4), then check CU status
+   *     Status remains running (0x4) if CU is still running, or
+   *     transitions to free if CU is done
+   *
+   * Passes that make no progress keep polling for the spin budget
+   * after last progress, then sleep between polls with exponential
+   * backoff.  New commands wake up the loop immediately.
+   */
+  void
+  scheduler_loop()
+  {
+    using clock = std::chrono::steady_clock;
+
+    // Basic setup will be changed by configure_mb, but is necessary
+    // for even configure_mb() to work.
+    setup();
+
+    auto spin = std::chrono::nanoseconds(poll_spin_ns());
+    auto last_progress = clock::now();
+    unsigned int backoff = 0;
+    while (1) {
+
+      {
+        std::unique_lock<std::mutex> lk(s_mutex);
+        // Nothing changed recently, give running CUs time before polling
+        // again, but wake up immediately for new commands
+        if (backoff && s_cmds.empty() && !s_stop)
+          s_work.wait_for(lk,std::chrono::microseconds(backoff));
+
+        while (!s_stop && command_queue.empty() && s_cmds.empty())
+          s_work.wait(lk);
+
+        if (s_stop) {
+          if (!command_queue.empty() || !s_cmds.empty())
+            throw std::runtime_error("software scheduler stopping while there are active commands");
+          break;
         }
 
-        // Extract and cache cumask from cmd
-        size_type cumasks = cu_masks(slot->header_value);
-        for (size_type i=0; i<cumasks; ++i) {
-          auto& payload = slot->get_packet();
-          bitmask_type mask(payload[1+i]);
-          slot->cus |= (mask<<sizeof(value_type)*8*i);
+        // copy new commands to pending list
+        std::copy(s_cmds.begin(),s_cmds.end(),std::back_inserter(command_queue));
+        s_cmds.clear();
+      } // lk scope
+
+      bool progress = false;
+
+      // iterate commands
+      auto end = command_queue.end();
+      auto nitr = command_queue.begin();
+      for (auto itr=nitr; itr!=end; itr=nitr) {
+        auto slot = &(*itr);
+
+        if ((slot->header_value & 0xF) == 0x1) { // new
+          auto opc = opcode(slot->header_value);
+          if (opc!=CMD_START_KERNEL) { // Non performance critical command
+            process_special_command(slot,opc);
+            continue;
+          }
+
+          // Extract and cache cumask from cmd
+          size_type cumasks = cu_masks(slot->header_value);
+          for (size_type i=0; i<cumasks; ++i) {
+            auto& payload = slot->get_packet();
+            bitmask_type mask(payload[1+i]);
+            slot->cus |= (mask<<sizeof(value_type)*8*i);
+          }
+
+          slot->header_value = (slot->header_value & ~0xF) | 0x2; // queued
+          XRT_DEBUGF("slot(%d) [new->queued]\n",slot->get_uid());
+          progress = true;
         }
 
-        slot->header_value = (slot->header_value & ~0xF) | 0x2; // queued
-        XRT_DEBUGF("slot(%d) [new->queued]\n",slot->get_uid());
-      }
+        if ((slot->header_value & 0xF) == 0x2) { // queued
+          // queued command, start if any of cus is ready
+          if (start_cu(slot)) { // started
+            slot->header_value |= 0x1; // running (0x2->0x3)
+            XRT_DEBUGF("slot(%d) [queued->running]\n",slot->get_uid());
+            progress = true;
+          }
+        }
 
-      if ((slot->header_value & 0xF) == 0x2) { // queued
-        // queued command, start if any of cus is ready
-        if (start_cu(slot)) { // started
-          slot->header_value |= 0x1; // running (0x2->0x3)
-          XRT_DEBUGF("slot(%d) [queued->running]\n",slot->get_uid());
+        if ((slot->header_value & 0xF) == 0x3) { // running
+          // running command, check its cu status
+          if (check_cu(slot,false)) {
+            notify_host(slot);
+            slot->header_value = (slot->header_value & ~0xF) | 0x4; // free
+            XRT_DEBUGF("slot(%d) [running->free]\n",slot->get_uid());
+            progress = true;
+          }
         }
-      }
 
-      if ((slot->header_value & 0xF) == 0x3) { // running
-        // running command, check its cu status
-        if (check_cu(slot,false)) {
-          notify_host(slot);
-          slot->header_value = (slot->header_value & ~0xF) | 0x4; // free
-          XRT_DEBUGF("slot(%d) [running->free]\n",slot->get_uid());
+        if ((slot->header_value & 0xF) == 0x4) { // free
+          nitr = command_queue.erase(itr);
+          end = command_queue.end();
+          continue;
         }
+
+        nitr = ++itr;
+
       }
 
-      if ((slot->header_value & 0xF) == 0x4) { // free
-        nitr = command_queue.erase(itr);
-        end = command_queue.end();
-        continue;
+      if (progress) {
+        last_progress = clock::now();
+        backoff = 0;
+        spin = std::chrono::nanoseconds(poll_spin_ns());
+      }
+      else if (backoff || clock::now() - last_progress >= spin) {
+        backoff = std::min(poll_backoff_max_usec(),backoff ? backoff*2 : 10);
       }
+    } // while
+  }
+
+public:
+
+  void
+  init(size_t cus, size_t cuoffset, size_t cubase, const std::vector<uint32_t>& cu_amap)
+  {
+    std::lock_guard<std::mutex> lk(s_mutex);
+    num_cus = cus;
+    cu_base_address = cubase;
+    cu_offset = cuoffset;
+    cu_trace_enabled = xrt::config::get_profile();
+    cu_addr_map = cu_amap;
+  }
 
-      nitr = ++itr;
+  template <typename Iterator>
+  void
+  schedule(Iterator first, Iterator last)
+  {
+    std::lock_guard<std::mutex> lk(s_mutex);
+    s_cmds.insert(s_cmds.end(),first,last);
+    s_work.notify_one();
+  }
+
+  void
+  start()
+  {
+    std::lock_guard<std::mutex> lk(s_mutex);
+    s_stop = false;
+    s_scheduler = std::move(xrt::thread(&device_scheduler::scheduler_loop,this));
+  }
 
+  void
+  stop()
+  {
+    {
+      std::lock_guard<std::mutex> lk(s_mutex);
+      s_stop=true;
     }
-  } // while
-}
+
+    s_work.notify_one();
+    s_scheduler.join();
+  }
+};
 
 static bool s_running=false;
-static std::thread s_scheduler;
 
+// Device schedulers, created on first init or schedule for a device
+// and started if sws is running
+static std::mutex s_devices_mutex;
+static std::vector<std::pair<const xrt::device*,std::unique_ptr<device_scheduler>>> s_devices;
+
+static device_scheduler*
+get_device_scheduler(const xrt::device* device)
+{
+  std::lock_guard<std::mutex> lk(s_devices_mutex);
+  for (auto& d : s_devices)
+    if (d.first==device)
+      return d.second.get();
+
+  s_devices.emplace_back(device,xrt::make_unique<device_scheduler>());
+  auto ds = s_devices.back().second.get();
+  if (s_running)
+    ds->start();
+  return ds;
+}
 
 } // namespace
 
@@ -544,9 +683,21 @@ namespace xrt { namespace sws {
 void
 schedule(const command_type& cmd)
 {
-  std::lock_guard<std::mutex> lk(s_mutex);
-  s_cmds.push_back(cmd);
-  s_work.notify_one();
+  get_device_scheduler(cmd->get_device())->schedule(&cmd,&cmd+1);
+}
+
+void
+schedule(const std::vector<command_type>& cmds)
+{
+  // Commands in a batch are usually for the same device, hand off
+  // each run of same device commands in one go
+  auto end = cmds.end();
+  for (auto first=cmds.begin(); first!=end; ) {
+    auto device = (*first)->get_device();
+    auto last = std::find_if(first,end,[device](const command_type& cmd) { return cmd->get_device()!=device; });
+    get_device_scheduler(device)->schedule(first,last);
+    first = last;
+  }
 }
 
 void
@@ -555,8 +706,9 @@ start()
   if (s_running)
     throw std::runtime_error("sws command scheduler is already started");
 
-  std::lock_guard<std::mutex> lk(s_mutex);
-  s_scheduler = std::move(xrt::thread(scheduler_loop));
+  std::lock_guard<std::mutex> lk(s_devices_mutex);
+  for (auto& d : s_devices)
+    d.second->start();
   if (threaded_notification)
     notifier = std::move(xrt::thread(xrt::task::worker,std::ref(notify_queue)));
   s_running = true;
@@ -569,13 +721,12 @@ stop()
     return;
 
   {
-    std::lock_guard<std::mutex> lk(s_mutex);
-    s_stop=true;
+    std::lock_guard<std::mutex> lk(s_devices_mutex);
+    for (auto& d : s_devices)
+      d.second->stop();
+    s_devices.clear();
   }
 
-  s_work.notify_one();
-  s_scheduler.join();
-
   if (threaded_notification) {
     // wait for notifier to drain
     while (notify_queue.size()) {
@@ -590,13 +741,9 @@ stop()
 }
 
 void
-init(xrt::device*, size_t, size_t cus, size_t cuoffset, size_t cubase, const std::vector<uint32_t>& cu_amap)
+init(xrt::device* device, size_t, size_t cus, size_t cuoffset, size_t cubase, const std::vector<uint32_t>& cu_amap)
 {
-  num_cus = cus;
-  cu_base_address = cubase;
-  cu_offset = cuoffset;
-  cu_trace_enabled = xrt::config::get_profile();
-  cu_addr_map = cu_amap;
+  get_device_scheduler(device)->init(cus,cuoffset,cubase,cu_amap);
 }
 
 }} // sws,xrt
@@ -0,0 +1,96 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include "../test_helpers.h"
+
+#include "xrt/device/device.h"
+#include "xrt/scheduler/kernel_packet.h"
+using namespace xrt::test;
+
+namespace {
+
+// vadd(a,b,size) with a 32-bit argument last
+using vadd = xrt::kernel_packet<xrt::kernel_arg<uint64_t,0x10>,
+                                xrt::kernel_arg<uint64_t,0x1c>,
+                                xrt::kernel_arg<uint32_t,0x28>>;
+
+// arguments out of order, 64-bit argument last
+using rvadd = xrt::kernel_packet<xrt::kernel_arg<uint32_t,0x28>,
+                                 xrt::kernel_arg<uint64_t,0x30>,
+                                 xrt::kernel_arg<uint64_t,0x10>>;
+
+static_assert(vadd::regmap_words == 11,"unexpected vadd register map size");
+static_assert(vadd::packet_words == 13,"unexpected vadd packet size");
+static_assert(rvadd::regmap_words == 14,"unexpected rvadd register map size");
+
+static void
+check_vadd(xrt::device* device)
+{
+  auto cmd = vadd::create(device,0x5,0x1122334455667788,0x99aabbccddeeff00,1024);
+  auto& packet = cmd->get_packet();
+  auto skcmd = cmd->get_ert_cmd<ert_start_kernel_cmd*>();
+
+  BOOST_CHECK_EQUAL(skcmd->opcode,ERT_START_CU);
+  BOOST_CHECK_EQUAL(skcmd->count,vadd::packet_words-1);
+  BOOST_CHECK_EQUAL(skcmd->extra_cu_masks,0);
+  BOOST_CHECK_EQUAL(packet[1],0x5);
+
+  // register map starts at packet[2], offsets are bytes
+  BOOST_CHECK_EQUAL(packet[2+0x10/4],0x55667788);
+  BOOST_CHECK_EQUAL(packet[2+0x14/4],0x11223344);
+  BOOST_CHECK_EQUAL(packet[2+0x1c/4],0xddeeff00);
+  BOOST_CHECK_EQUAL(packet[2+0x20/4],0x99aabbcc);
+  BOOST_CHECK_EQUAL(packet[2+0x28/4],1024);
+}
+
+static void
+check_set_arg(xrt::device* device)
+{
+  auto cmd = rvadd::create(device,0x1,16,0x1000,0x2000);
+  rvadd packet(*cmd);
+  packet.set_arg<0>(32);
+  packet.set_arg<2>(0x3000);
+
+  auto& words = cmd->get_packet();
+  BOOST_CHECK_EQUAL(words[2+0x28/4],32);
+  BOOST_CHECK_EQUAL(words[2+0x30/4],0x1000);
+  BOOST_CHECK_EQUAL(words[2+0x10/4],0x3000);
+  BOOST_CHECK_EQUAL(words[2+0x14/4],0);
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(test_kernel_packet)
+
+BOOST_AUTO_TEST_CASE(kernel_packet1)
+{
+  auto pred = [](const xrt::hal::device& hal) {
+    return (hal.getDriverLibraryName().find("xclgemdrv")!=std::string::npos);
+  };
+  auto devices = xrt::test::loadDevices(pred);
+
+  for (auto& device : devices) {
+    device.open();
+    device.setup();
+    check_vadd(&device);
+    check_set_arg(&device);
+    xrt::purge_command_freelist();
+    device.close();
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -18,6 +18,8 @@
 
 #include "xrt/config.h"
 #include "xrt/util/aligned_allocator.h"
+#include "xrt/util/hugepage.h"
+#include <iostream>
 #include <vector>
 
 BOOST_AUTO_TEST_SUITE ( test_aligned_allocator )
@@ -38,6 +40,40 @@ BOOST_AUTO_TEST_CASE( test_aligned_allocator1 )
   }
 }
 
+BOOST_AUTO_TEST_CASE( test_aligned_allocator_large )
+{
+  // alignment is never reduced for buffers eligible for huge pages
+  const size_t sz = 8*1024*1024;
+  auto align = xrt::hugepage::get_alignment(sz,4096);
+  BOOST_CHECK(align>=4096 && (align % 4096)==0);
+  BOOST_CHECK_EQUAL(xrt::hugepage::get_alignment(1024,4096),4096);
+
+  std::vector<char,xrt::aligned_allocator<char,4096>> vec(sz);
+  auto data = vec.data();
+  BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(data) % align,0);
+}
+
+BOOST_AUTO_TEST_CASE( test_host_pool )
+{
+  if (!xrt::config::get_host_pool_size()) {
+    std::cout << "Test case [test_host_pool] not run because host_pool_size is 0\n";
+    return;
+  }
+
+  // freed buffer is reused for a request of the same size class
+  auto ptr1 = xrt::host_pool::allocate(3*4096,4096);
+  BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(ptr1) % 4096,0);
+  xrt::host_pool::deallocate(ptr1,3*4096,4096);
+  auto ptr2 = xrt::host_pool::allocate(4*4096,4096);
+  BOOST_CHECK_EQUAL(ptr1,ptr2);
+  xrt::host_pool::deallocate(ptr2,4*4096,4096);
+
+  // small buffers are not pooled but still aligned
+  auto ptr3 = xrt::host_pool::allocate(100,128);
+  BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(ptr3) % 128,0);
+  xrt::host_pool::deallocate(ptr3,100,128);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 
@@ -54,6 +54,28 @@ BOOST_AUTO_TEST_CASE( test_config1 )
   BOOST_CHECK_EQUAL(xrt::config::detail::get_bool_value("Emulation.bogus",false),false);
 }
 
+BOOST_AUTO_TEST_CASE( test_config_reload )
+{
+  std::string ini(__FILE__);
+  ini += ".ini";
+
+  auto& before = xrt::config::get_tuning();
+  auto generation = xrt::config::reload(ini);
+  BOOST_CHECK_EQUAL(generation,before.generation+1);
+
+  auto& after = xrt::config::get_tuning();
+  BOOST_CHECK_EQUAL(after.generation,generation);
+  BOOST_CHECK_EQUAL(after.dma_channels,2);
+  BOOST_CHECK_EQUAL(xrt::config::get_dma_threads(),2);
+
+  // not in ini file, default values
+  BOOST_CHECK_EQUAL(xrt::config::get_polling_throttle(),0);
+  BOOST_CHECK_EQUAL(xrt::config::get_sws_poll_spin(42),42);
+
+  // replaced snapshot is still valid
+  BOOST_CHECK_EQUAL(before.generation,generation-1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 
@@ -126,6 +126,63 @@ BOOST_AUTO_TEST_CASE( test_event2 )
     t.join();
 }
 
+namespace {
+
+// Too big for inline storage in xrt::event
+struct big_event
+{
+  typedef int value_type;
+  int m_data[32];
+  explicit big_event(int i) { m_data[31] = i; }
+  int wait() const { return m_data[31]; }
+  bool ready() const { return true; }
+};
+
+}
+
+BOOST_AUTO_TEST_CASE( test_event3 )
+{
+  {
+    // inline event survives moves
+    xrt::event ev1(xrt::typed_event<int>(10));
+    xrt::event ev2(std::move(ev1));
+    BOOST_CHECK_EQUAL(ev1.ready(),true); // moved from event is empty
+    BOOST_CHECK_EQUAL(ev2.get<int>(),10);
+  }
+
+  {
+    // heap event survives moves
+    xrt::event ev1(big_event(20));
+    xrt::event ev2(std::move(ev1));
+    BOOST_CHECK_EQUAL(ev2.get<int>(),20);
+  }
+
+  {
+    // assignment between inline and heap events
+    xrt::event ev1(xrt::typed_event<int>(10));
+    xrt::event ev2(big_event(20));
+    ev1 = std::move(ev2);
+    BOOST_CHECK_EQUAL(ev1.get<int>(),20);
+    ev2 = xrt::event(xrt::typed_event<int>(30));
+    BOOST_CHECK_EQUAL(ev2.get<int>(),30);
+    ev1 = std::move(ev2);
+    BOOST_CHECK_EQUAL(ev1.get<int>(),30);
+  }
+
+  {
+    // value is preserved when a ready inline event is moved
+    xrt::task::queue queue;
+    std::thread worker(xrt::task::worker,std::ref(queue));
+    xrt::event ev1(xrt::task::createF(queue,&sleepy_waiter,10));
+    ev1.wait();
+    xrt::event ev2(std::move(ev1));
+    BOOST_CHECK_EQUAL(ev2.ready(),true);
+    BOOST_CHECK_EQUAL(ev2.get<int>(),10);
+    queue.stop();
+    worker.join();
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 
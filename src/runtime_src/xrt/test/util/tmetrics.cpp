@@ -0,0 +1,58 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <boost/test/unit_test.hpp>
+
+#include "xrt/util/metrics.h"
+#include <sstream>
+
+BOOST_AUTO_TEST_SUITE ( test_metrics )
+
+BOOST_AUTO_TEST_CASE( test_metrics1 )
+{
+  auto& c1 = xrt::metrics::get_counter("tmetrics_bytes_total{dir=\"in\"}","Test bytes");
+  auto& c2 = xrt::metrics::get_counter("tmetrics_bytes_total{dir=\"out\"}","Test bytes");
+  auto& g = xrt::metrics::get_gauge("tmetrics_level","Test level");
+
+  c1.add(10);
+  c1.add();
+  c2.add(5);
+  g.add(3);
+  g.sub();
+
+  BOOST_CHECK_EQUAL(c1.value(),11);
+  BOOST_CHECK_EQUAL(c2.value(),5);
+  BOOST_CHECK_EQUAL(g.value(),2);
+
+  // same name returns same metric
+  BOOST_CHECK_EQUAL(&xrt::metrics::get_counter("tmetrics_bytes_total{dir=\"in\"}",""),&c1);
+  BOOST_CHECK_THROW(xrt::metrics::get_gauge("tmetrics_bytes_total{dir=\"in\"}",""),std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE( test_metrics2 )
+{
+  std::ostringstream ostr;
+  xrt::metrics::write(ostr);
+  auto text = ostr.str();
+
+  BOOST_CHECK(text.find("# HELP tmetrics_bytes_total Test bytes\n# TYPE tmetrics_bytes_total counter\n"
+                        "tmetrics_bytes_total{dir=\"in\"} 11\ntmetrics_bytes_total{dir=\"out\"} 5\n")
+              !=std::string::npos);
+  BOOST_CHECK(text.find("# TYPE tmetrics_level gauge\ntmetrics_level 2\n")!=std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -22,6 +22,8 @@
 #include "xrt/util/task.h"
 
 #include <chrono>
+#include <stdexcept>
+#include <algorithm>
 #include <iostream>
 
 BOOST_AUTO_TEST_SUITE ( test_task )
@@ -110,6 +112,156 @@ BOOST_AUTO_TEST_CASE( test_task1 )
     t.join();
 }
 
+BOOST_AUTO_TEST_CASE( test_task_inline )
+{
+  int count = 0;
+
+  // small callable is stored inline, large callable on heap
+  xrt::task::task small([&count] { ++count; });
+  char pad[64] = {1};
+  xrt::task::task large([&count,pad] { count += pad[0]; });
+
+  // move between inline and heap tasks in both directions
+  xrt::task::task t1(std::move(small));
+  BOOST_CHECK_EQUAL(small.valid(),false);
+  t1();
+  BOOST_CHECK_EQUAL(count,1);
+
+  t1 = std::move(large);
+  BOOST_CHECK_EQUAL(large.valid(),false);
+  t1();
+  BOOST_CHECK_EQUAL(count,2);
+
+  xrt::task::task t2([&count] { count += 10; });
+  t1 = std::move(t2);
+  t1();
+  BOOST_CHECK_EQUAL(count,12);
+
+  // tasks queued by createF are inline and survive the queue
+  xrt::task::queue queue;
+  queue.make_lockfree(8);
+  auto tev = xrt::task::createF(queue,&sleepy_waiter,1);
+  auto t = queue.getWork();
+  BOOST_CHECK_EQUAL(t.valid(),true);
+  t();
+  BOOST_CHECK_EQUAL(tev.get(),1);
+}
+
+BOOST_AUTO_TEST_CASE( test_task_lockfree )
+{
+  xrt::task::queue queue;
+  queue.make_lockfree(16);
+  BOOST_CHECK_EQUAL(queue.lockfree(),true);
+
+  std::vector<std::thread> workers;
+  workers.push_back(std::thread(xrt::task::worker,std::ref(queue)));
+  workers.push_back(std::thread(xrt::task::worker,std::ref(queue)));
+
+  {
+    // more tasks than ring capacity, from several producers
+    std::vector<std::thread> producers;
+    std::atomic<int> sum {0};
+    for (int p=0; p<4; ++p) {
+      producers.push_back(std::thread([&queue,&sum] {
+        std::vector<xrt::task::event<int>> events;
+        for (int i=0; i<100; ++i)
+          events.push_back(xrt::task::createF(queue,&sleepy_waiter,0));
+        for (auto& ev : events)
+          sum += ev.get() + 1;
+      }));
+    }
+    for (auto& t : producers)
+      t.join();
+    BOOST_CHECK_EQUAL(sum,400);
+  }
+
+  {
+    // create task from member function with args
+    API api;
+    auto tev = xrt::task::createM(queue,&API::foo,api,100,'a');
+    BOOST_CHECK_EQUAL(tev.get(),100);
+  }
+
+  queue.stop();
+  for (auto& t : workers)
+    t.join();
+}
+
+BOOST_AUTO_TEST_CASE( test_task_stealing )
+{
+  xrt::task::pool pool(2);
+  std::vector<size_t> ids;
+  ids.push_back(pool.add_worker(0));
+  ids.push_back(pool.add_worker(0));
+  ids.push_back(pool.add_worker(1));
+
+  // queues forward work to the pool
+  xrt::task::queue q0, q1;
+  q0.attach(&pool,0);
+  q1.attach(&pool,1);
+
+  std::vector<std::thread> workers;
+  for (auto id : ids)
+    workers.push_back(std::thread(xrt::task::stealing_worker,std::ref(pool),id));
+
+  {
+    // all work has affinity 1, but the affinity 0 workers can steal it
+    std::vector<xrt::task::event<int>> events;
+    for (int i=0; i<30; ++i)
+      events.push_back(xrt::task::createF(q1,&sleepy_waiter,10));
+    auto start = std::chrono::steady_clock::now();
+    for (auto& ev : events)
+      BOOST_CHECK_EQUAL(ev.get(),10);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now()-start).count();
+    BOOST_CHECK(ms < 300);
+  }
+
+  {
+    // create task from member function with args
+    API api;
+    auto tev = xrt::task::createM(q0,&API::foo,api,100,'a');
+    BOOST_CHECK_EQUAL(tev.get(),100);
+  }
+
+  pool.stop();
+  for (auto& t : workers)
+    t.join();
+}
+
+BOOST_AUTO_TEST_CASE( test_task_fork_join )
+{
+  std::vector<int> items = {10,10,10,10,10,10,10,10};
+
+  {
+    // all items are waited for, errors are reported per item
+    std::atomic<int> sum {0};
+    auto errors = xrt::task::fork_join(items,[&sum](int i) {
+        if ((sum += sleepy_waiter(i)) > 50)
+          throw std::runtime_error("too much");
+      });
+    BOOST_CHECK_EQUAL(sum,80);
+    BOOST_CHECK_EQUAL(errors.size(),items.size());
+    BOOST_CHECK_EQUAL(std::count(errors.begin(),errors.end(),nullptr),5);
+  }
+
+  {
+    // first error is rethrown
+    BOOST_CHECK_THROW(xrt::task::parallel_for(items,[](int i) {
+          if (i==10)
+            throw std::runtime_error("bad");
+        }),std::runtime_error);
+  }
+
+  {
+    // nested fork/join does not wait on busy workers
+    std::atomic<int> count {0};
+    xrt::task::parallel_for(items,[&](int) {
+        xrt::task::parallel_for(items,[&](int) { ++count; });
+      });
+    BOOST_CHECK_EQUAL(count,64);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 
@@ -17,6 +17,8 @@
 #ifndef xrt_util_aligned_allocator_h_
 #define xrt_util_aligned_allocator_h_
 
+#include "xrt/util/host_pool.h"
+
 #include <cstddef>
 #include <cstdlib>
 #include <new>
@@ -29,6 +31,12 @@ namespace xrt {
  * std::vector<int,xrt::aligned_allocator<int,4096>> vec;
  * auto data = vec.data();
  * assert((data % 4096)==0);
+ *
+ * Page aligned allocations prefer the NUMA node of the device when
+ * enabled in sdaccel.ini, see xrt/util/numa.h.  Large allocations
+ * are backed by huge pages when enabled, see xrt/util/hugepage.h.
+ * Allocations of a page or more are reused through the host buffer
+ * pool, see xrt/util/host_pool.h
  */
 template <typename T, std::size_t Align>
 struct aligned_allocator
@@ -48,14 +56,11 @@ struct aligned_allocator
 
   T* allocate(std::size_t num)
   {
-    void* ptr = nullptr;
-    if (posix_memalign(&ptr,Align,num*sizeof(T)))
-      throw std::bad_alloc();
-    return reinterpret_cast<T*>(ptr);
+    return reinterpret_cast<T*>(host_pool::allocate(num*sizeof(T),Align));
   }
   void deallocate(T* p, std::size_t num)
   {
-    free(p);
+    host_pool::deallocate(p,num*sizeof(T),Align);
   }
 };
 
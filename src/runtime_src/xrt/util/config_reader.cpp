@@ -21,8 +21,12 @@
 #include <boost/property_tree/ini_parser.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <atomic>
 #include <iostream>
 #include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #ifdef __GNUC__
 # include <linux/limits.h>
@@ -73,6 +77,8 @@ get_ini_path()
 struct tree
 {
   boost::property_tree::ptree m_tree;
+  std::string m_path;
+  std::mutex m_mutex;  // reread while values are accessed
 
   void
   setenv()
@@ -85,7 +91,12 @@ struct tree
   read(const std::string& path)
   {
     try {
-      read_ini(path,m_tree);
+      boost::property_tree::ptree tree;
+      read_ini(path,tree);
+      {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_tree.swap(tree);
+      }
       
       // set env vars to expose sdaccel.ini to hal layer
       setenv();
@@ -102,6 +113,7 @@ struct tree
       return;
 
     //XRT_PRINT(std::cout,"Reading configuration from '",ini_path,"'\n");
+    m_path = ini_path;
     read(ini_path);
   }
 
@@ -114,6 +126,55 @@ struct tree
 
 static tree s_tree;
 
+using tuning = xrt::config::tuning;
+
+static tuning*
+make_tuning(unsigned int generation)
+{
+  using namespace xrt::config::detail;
+  auto t = new tuning;
+  t->generation = generation;
+  t->dma_channels = get_uint_value("Runtime.dma_channels",0);
+  t->dma_chunk_size = get_uint_value("Runtime.dma_chunk_size",0);
+  t->dma_async_sync = get_bool_value("Runtime.dma_async_sync",false);
+  t->polling_throttle = get_uint_value("Runtime.polling_throttle",0);
+  t->sws_poll_spin = get_uint_value("Runtime.sws_poll_spin",tuning::unset);
+  t->wait_spin = get_uint_value("Runtime.wait_spin",50);
+  return t;
+}
+
+// Published tuning snapshot.  Replaced snapshots are kept, references
+// to them may still be held
+struct tunings
+{
+  std::mutex m_mutex;
+  std::vector<std::unique_ptr<tuning>> m_all;
+  std::atomic<const tuning*> m_current;
+
+  tunings()
+  {
+    m_all.emplace_back(make_tuning(0));
+    m_current = m_all.back().get();
+  }
+
+  unsigned int
+  publish()
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    auto generation = m_current.load()->generation + 1;
+    m_all.emplace_back(make_tuning(generation));
+    m_current.store(m_all.back().get(),std::memory_order_release);
+    return generation;
+  }
+};
+
+static tunings&
+get_tunings()
+{
+  static tunings s_tunings;
+  return s_tunings;
+}
+
 }
 
 namespace xrt { namespace config {
@@ -123,13 +184,16 @@ namespace detail {
 bool
 get_bool_value(const char* key, bool default_value)
 {
+  std::lock_guard<std::mutex> lk(s_tree.m_mutex);
   return s_tree.m_tree.get<bool>(key,default_value);
 }
 
 std::string
 get_string_value(const char* key, const std::string& default_value)
 {
+  std::unique_lock<std::mutex> lk(s_tree.m_mutex);
   std::string val = s_tree.m_tree.get<std::string>(key,default_value);
+  lk.unlock();
   // Although INI file entries are not supposed to have quotes around strings
   // but we want to be cautious
   if ((val.front() == '"') && (val.back() == '"')) {
@@ -142,6 +206,7 @@ get_string_value(const char* key, const std::string& default_value)
 unsigned int
 get_uint_value(const char* key, unsigned int default_value)
 {
+  std::lock_guard<std::mutex> lk(s_tree.m_mutex);
   return s_tree.m_tree.get<unsigned int>(key,default_value);
 }
 
@@ -151,6 +216,7 @@ debug(std::ostream& ostr, const std::string& ini)
   if (!ini.empty())
     s_tree.reread(ini);
 
+  std::lock_guard<std::mutex> lk(s_tree.m_mutex);
   for(auto& section : s_tree.m_tree) {
     ostr << "[" << section.first << "]\n";
     for (auto& key:section.second) {
@@ -162,6 +228,22 @@ debug(std::ostream& ostr, const std::string& ini)
 
 } // detail
 
+const tuning&
+get_tuning()
+{
+  return *get_tunings().m_current.load(std::memory_order_acquire);
+}
+
+unsigned int
+reload(const std::string& ini)
+{
+  auto& tunings = get_tunings();
+  const auto& path = ini.empty() ? s_tree.m_path : ini;
+  if (!path.empty())
+    s_tree.reread(path);
+  return tunings.publish();
+}
+
 }}
 
 
@@ -41,7 +41,8 @@ namespace xrt { namespace config {
  *    <any key> = <any value>
  *
  * The file is read into memory and values are cached by the public
- * API in this file, the very first time they are accessed.
+ * API in this file, the very first time they are accessed.  Values
+ * in the tuning snapshot can be reread with reload().
  *
  * The reader itself could be separated from xrt, and the caching of
  * values could be distributed to where the values are used.  For
@@ -66,6 +67,47 @@ std::ostream& debug(std::ostream&, const std::string& ini="");
 
 }
 
+/**
+ * Snapshot of tuning values that can be changed while running
+ *
+ * The snapshot is read from the ini file the first time it is
+ * accessed and is replaced by reload().  Snapshots are immutable,
+ * get_tuning() is a single atomic load, and references returned by
+ * get_tuning() remain valid for the lifetime of the program.
+ *
+ * Consumers that cache values derived from the snapshot can compare
+ * the generation number to detect a reload.
+ */
+struct tuning
+{
+  static constexpr unsigned int unset = static_cast<unsigned int>(-1);
+
+  unsigned int generation;
+  unsigned int dma_channels;      // Runtime.dma_channels
+  unsigned int dma_chunk_size;    // Runtime.dma_chunk_size
+  bool dma_async_sync;            // Runtime.dma_async_sync
+  unsigned int polling_throttle;  // Runtime.polling_throttle
+  unsigned int sws_poll_spin;     // Runtime.sws_poll_spin, unset if not in ini
+  unsigned int wait_spin;         // Runtime.wait_spin
+};
+
+const tuning&
+get_tuning();
+
+/**
+ * Reread the ini file and publish a new tuning snapshot
+ *
+ * Only values in the tuning snapshot pick up the new ini file
+ * content, all other accessors in this file keep the value they
+ * cached when first accessed.
+ *
+ * @ini: Path to ini file, default is to reread the ini file that
+ *   was found at start up
+ * Return: Generation number of the new snapshot
+ */
+unsigned int
+reload(const std::string& ini="");
+
 /**
  * Public API.  Cached accessors.
  *
@@ -130,6 +172,17 @@ get_stall_trace()
   return value;
 }
 
+/**
+ * Window in msec over which stall durations are summed instead of
+ * tracing every stall transition, 0 traces transitions
+ */
+inline unsigned int
+get_stall_trace_window()
+{
+  static unsigned int value = detail::get_uint_value("Debug.stall_trace_window",0);
+  return value;
+}
+
 inline bool
 get_timeline_trace()
 {
@@ -137,6 +190,59 @@ get_timeline_trace()
   return value;
 }
 
+/**
+ * Timeline trace file format, "csv" or "json" (streamed Chrome trace events)
+ */
+inline std::string
+get_timeline_trace_format()
+{
+  static std::string value = detail::get_string_value("Debug.timeline_trace_format","csv");
+  return value;
+}
+
+/**
+ * Drain device trace FIFOs from a background thread while profiling
+ */
+/**
+ * Time and trace only 1 in N calls of each API function, all calls
+ * are still counted in the profile summary
+ */
+inline unsigned int
+get_api_call_sample_interval()
+{
+  static unsigned int value = detail::get_uint_value("Debug.api_call_sample_interval",1);
+  return value;
+}
+
+/**
+ * Maximum number of kernel or buffer traces waiting for their END
+ * event, the oldest are dropped beyond this
+ */
+inline unsigned int
+get_max_pending_traces()
+{
+  static unsigned int value = detail::get_uint_value("Debug.max_pending_traces",4096);
+  return value;
+}
+
+/**
+ * Interval in msec between device trace clock trainings, 0 only trains
+ * when trace is started
+ */
+inline unsigned int
+get_trace_clock_training_interval()
+{
+  static unsigned int value = detail::get_uint_value("Debug.trace_clock_training_interval",100);
+  return value;
+}
+
+inline bool
+get_trace_offload()
+{
+  static bool value = detail::get_bool_value("Debug.trace_offload",true);
+  return value;
+}
+
 inline bool
 get_api_checks()
 {
@@ -151,6 +257,20 @@ get_logging()
   return value;
 }
 
+inline bool
+get_logging_async()
+{
+  static bool value = detail::get_bool_value("Runtime.runtime_log_async",false);
+  return value;
+}
+
+inline unsigned int
+get_logging_async_capacity()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.runtime_log_async_capacity",4096);
+  return value;
+}
+
 inline unsigned int
 get_verbosity()
 {
@@ -161,17 +281,181 @@ get_verbosity()
 inline unsigned int
 get_dma_threads()
 {
-  static unsigned int value = detail::get_uint_value("Runtime.dma_channels",0);
+  return get_tuning().dma_channels;
+}
+
+/**
+ * Use bounded lock-free rings for the hal2 DMA task queues
+ * instead of mutex protected queues
+ */
+inline bool
+get_lockfree_task_queue()
+{
+  static bool value = detail::get_bool_value("Runtime.lockfree_task_queue",false);
   return value;
 }
 
+/**
+ * Capacity of a lock-free task queue, rounded up to power of two
+ */
 inline unsigned int
-get_polling_throttle()
+get_task_queue_size()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.task_queue_size",1024);
+  return value;
+}
+
+/**
+ * Give each hal2 read and write DMA worker its own DMA channel so
+ * concurrent transfers do not compete for the same engine
+ */
+inline bool
+get_dma_channel_affinity()
+{
+  static bool value = detail::get_bool_value("Runtime.dma_channel_affinity",true);
+  return value;
+}
+
+/**
+ * Start device DMA workers and the command scheduler on first use
+ * instead of at platform construction
+ */
+inline bool
+get_lazy_device_setup()
+{
+  static bool value = detail::get_bool_value("Runtime.lazy_device_setup",true);
+  return value;
+}
+
+/**
+ * Service hal2 DMA tasks with a work stealing worker pool where
+ * idle workers pick up tasks of any direction
+ */
+inline bool
+get_dma_work_stealing()
+{
+  static bool value = detail::get_bool_value("Runtime.dma_work_stealing",false);
+  return value;
+}
+
+/**
+ * Size in bytes of the pieces large BO sync requests are split into
+ * and spread over the DMA channels.  Requests smaller than two
+ * chunks are not split.  0, the default, disables chunking; 16MB
+ * (0x1000000) is a good starting point on multi channel boards.
+ * Chunk workers are created when the device is opened, so enabling
+ * chunking takes effect for devices opened afterwards.
+ */
+inline unsigned int
+get_dma_chunk_size()
+{
+  return get_tuning().dma_chunk_size;
+}
+
+/**
+ * Issue asynchronous syncs with the driver's async sync ioctl rather
+ * than on DMA worker threads, when the driver supports it
+ */
+inline bool
+get_dma_async_sync()
+{
+  return get_tuning().dma_async_sync;
+}
+
+/**
+ * Pin DMA workers and scheduler threads to the cpus of the NUMA
+ * node the device is attached to
+ */
+inline bool
+get_numa_thread_affinity()
 {
-  static unsigned int value = detail::get_uint_value("Runtime.polling_throttle",0);
+  static bool value = detail::get_bool_value("Runtime.numa_thread_affinity",false);
   return value;
 }
 
+/**
+ * Prefer the NUMA node of the device for aligned host buffers
+ */
+inline bool
+get_numa_host_memory()
+{
+  static bool value = detail::get_bool_value("Runtime.numa_host_memory",false);
+  return value;
+}
+
+/**
+ * Back large host buffers with transparent huge pages
+ */
+inline bool
+get_host_hugepage()
+{
+  static bool value = detail::get_bool_value("Runtime.host_hugepage",false);
+  return value;
+}
+
+/**
+ * Max bytes of freed aligned host buffers kept for reuse, 0 disables
+ * pooling, see xrt/util/host_pool.h
+ */
+inline unsigned int
+get_host_pool_size()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.host_pool_size",0x4000000);
+  return value;
+}
+
+/**
+ * Fault in newly allocated aligned host buffers up front
+ */
+inline bool
+get_host_prefault()
+{
+  static bool value = detail::get_bool_value("Runtime.host_prefault",false);
+  return value;
+}
+
+/**
+ * Number of exec buffers to preallocate per device for commands
+ */
+inline unsigned int
+get_exec_buffer_pool_depth()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.exec_buffer_pool_depth",32);
+  return value;
+}
+
+/**
+ * Busy poll budget in microseconds for kds completion checking before
+ * waiting in the driver, 0 disables busy polling
+ */
+inline unsigned int
+get_polling_throttle()
+{
+  return get_tuning().polling_throttle;
+}
+
+/**
+ * Spin budget in microseconds of waits on command queues created with
+ * CL_QUEUE_WAIT_SPIN_XILINX before the waiting thread blocks
+ */
+inline unsigned int
+get_wait_spin()
+{
+  return get_tuning().wait_spin;
+}
+
+/**
+ * Busy poll budget in microseconds for software scheduler CU checking
+ * after last progress, before the scheduler thread starts sleeping
+ * between polls.  Default depends on whether CU access is cheap.
+ */
+inline unsigned int
+get_sws_poll_spin(unsigned int dflt)
+{
+  auto value = get_tuning().sws_poll_spin;
+  return value == tuning::unset ? dflt : value;
+}
+
 inline std::string
 get_hal_logging()
 {
@@ -179,6 +463,17 @@ get_hal_logging()
   return value;
 }
 
+/**
+ * File for binary capture of HAL calls, the device index is appended.
+ * The capture is replayed with xbreplay.
+ */
+inline std::string
+get_hal_capture()
+{
+  static std::string value = detail::get_string_value("Runtime.hal_capture","null");
+  return value;
+}
+
 inline bool
 get_multiprocess()
 {
@@ -218,6 +513,19 @@ get_kds()
   return value;
 }
 
+/**
+ * Use kernel driver scheduling in software emulation.  Commands are
+ * then started on cpu_em compute unit worker threads, one per CU,
+ * instead of one CU at a time by the software scheduler (sws).
+ * Requires Runtime.kds.
+ */
+inline bool
+get_sw_emu_kds()
+{
+  static bool value = detail::get_bool_value("Runtime.sw_emu_kds",false);
+  return value;
+}
+
 /**
  * Enable / disable embedded runtime scheduler
  */
@@ -248,6 +556,28 @@ get_ert_cudma()
   return value;
 }
 
+/**
+ * Regmap size in words below which embedded scheduler copies regmap
+ * to CU rather than using CUDMA module, 0 for always CUDMA (max 255)
+ */
+inline unsigned int
+get_ert_cudma_threshold()
+{
+  static unsigned int threshold = detail::get_uint_value("Runtime.ert_cudma_threshold",0);
+  static unsigned int value = threshold > 255 ? 255 : threshold;
+  return value;
+}
+
+/**
+ * Embedded scheduler reports CU configure cycles per command
+ */
+inline bool
+get_ert_cycles()
+{
+  static bool value = get_ert() && detail::get_bool_value("Runtime.ert_cycles",false);
+  return value;
+}
+
 /**
  * Enable embedded scheduler CUISR module
  */
@@ -278,6 +608,192 @@ get_ert_slotsize()
   return value;
 }
 
+/**
+ * Retrieve command completions from driver completion ring when supported
+ */
+inline bool
+get_kds_completion_ring()
+{
+  static bool value = detail::get_bool_value("Runtime.kds_completion_ring",false);
+  return value;
+}
+
+/**
+ * Start NDRange commands ahead of their dependencies, when the
+ * dependencies can be resolved by the kernel driver scheduler.
+ * Off by default, commands started ahead hold exec buffers and
+ * driver command slots while they wait
+ */
+inline bool
+get_kds_chain_commands()
+{
+  static bool value = detail::get_bool_value("Runtime.kds_chain_commands",false);
+  return value;
+}
+
+/**
+ * Migrate NDRange arguments on an in-order queue as soon as the queued
+ * commands that use them complete, overlapping the migration with
+ * earlier kernels that do not use the arguments
+ */
+inline bool
+get_ndrange_migrate_ahead()
+{
+  static bool value = detail::get_bool_value("Runtime.ndrange_migrate_ahead",true);
+  return value;
+}
+
+/**
+ * Scheduling priority [0..3] of kernel start commands, higher is more
+ * urgent.  Used by driver to weight commands among processes.
+ */
+inline unsigned int
+get_kds_priority()
+{
+  static unsigned int prio = detail::get_uint_value("Runtime.kds_priority",0);
+  static unsigned int value = prio > 3 ? 3 : prio;
+  return value;
+}
+
+/**
+ * Keep writes to buffers not yet allocated on a device on the host, so
+ * that the buffer is allocated once in the bank of the first kernel
+ * argument it is bound to
+ */
+inline bool
+get_deferred_bank_binding()
+{
+  static bool value = detail::get_bool_value("Runtime.deferred_bank_binding",true);
+  return value;
+}
+
+/**
+ * Keep a copy of CL_MEM_READ_ONLY buffers on every device of a multi
+ * device context, populated on all devices when the buffer is first
+ * migrated, rather than migrating the buffer per device.  Off by
+ * default since the copies take device memory on devices that may
+ * never use the buffer.
+ */
+inline bool
+get_replicate_read_only_buffers()
+{
+  static bool value = detail::get_bool_value("Runtime.replicate_read_only_buffers",false);
+  return value;
+}
+
+/**
+ * Size in bytes of the pieces a write to a resident buffer is copied
+ * and synced in, so that copying a piece overlaps with the DMA of the
+ * previous piece.  Writes smaller than two pieces are not split.  0
+ * disables pipelining.
+ */
+inline unsigned int
+get_write_pipeline_chunk_size()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.write_pipeline_chunk_size",0x400000);
+  return value;
+}
+
+/**
+ * Device buffers up to this size (bytes) are suballocated from larger
+ * slab buffer objects, 0 disables suballocation
+ */
+inline unsigned int
+get_bo_suballoc_max_size()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.bo_suballoc_max_size",0);
+  return value;
+}
+
+/**
+ * Size (bytes) of slab buffer objects used for suballocation
+ */
+inline unsigned int
+get_bo_suballoc_slab_size()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.bo_suballoc_slab_size",0x400000);
+  return value;
+}
+
+/**
+ * SVM allocations up to this size (bytes) are suballocated from slab
+ * buffer objects of get_bo_suballoc_slab_size(), 0 disables pooling
+ */
+inline unsigned int
+get_svm_suballoc_max_size()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.svm_suballoc_max_size",0x10000);
+  return value;
+}
+
+/**
+ * Number of pinned staging buffers for blocking stream transfers from
+ * memory not allocated as stream buffers, 0 disables staging
+ */
+inline unsigned int
+get_stream_ring_slots()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.stream_ring_slots",8);
+  return value;
+}
+
+/**
+ * Size (bytes) of each stream staging buffer, larger transfers are
+ * not staged
+ */
+inline unsigned int
+get_stream_ring_slot_size()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.stream_ring_slot_size",0x10000);
+  return value;
+}
+
+/**
+ * Number of buffers in the ring of a stream created with CL_STREAM_RING
+ */
+inline unsigned int
+get_stream_ring_depth()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.stream_ring_depth",8);
+  return value;
+}
+
+/**
+ * Size (bytes) of each buffer in the ring of a stream created with
+ * CL_STREAM_RING, rounded up to 4k.  Larger writes are split across
+ * buffers, reads are posted with this size.
+ */
+inline unsigned int
+get_stream_ring_buffer_size()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.stream_ring_buffer_size",0x40000);
+  return value;
+}
+
+/**
+ * Number of hardware queues behind each write stream.  Requests are
+ * striped round robin across the queues, so packets from different
+ * requests may arrive out of order; use only with kernels that do not
+ * depend on packet order.
+ */
+inline unsigned int
+get_stream_write_queues()
+{
+  static unsigned int value = detail::get_uint_value("Runtime.stream_write_queues",1);
+  return value;
+}
+
+/**
+ * Unix socket path where runtime metrics are served in Prometheus
+ * text format, empty disables the exporter
+ */
+inline std::string
+get_metrics_socket()
+{
+  static std::string value = detail::get_string_value("Runtime.metrics_socket","");
+  return value;
+}
+
 inline std::string
 get_hw_em_driver()
 {
@@ -292,6 +808,17 @@ get_sw_em_driver()
   return value;
 }
 
+/**
+ * Use the null HAL driver (libxrt_null) instead of the board drivers,
+ * for measuring runtime overhead without a device
+ */
+inline bool
+get_null_driver()
+{
+  static bool value = detail::get_bool_value("Runtime.null_driver",false);
+  return value;
+}
+
 }}
 
 #endif
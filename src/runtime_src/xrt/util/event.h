@@ -19,6 +19,9 @@
 
 #include "xrt/util/error.h"
 
+#include <new>
+#include <type_traits>
+
 namespace xrt {
 
 /**
@@ -47,6 +50,10 @@ namespace xrt {
  *   myevent ev = ...;
  *   xrt::event ev(std::move(myevent));
  *   int i = ev.get<int>();
+ *
+ * Small event types that are nothrow move constructible, e.g. typed_event
+ * and task::event, are held in storage inside the event object itself, so
+ * creating and moving such events does not allocate.
  */
 class event
 {
@@ -55,6 +62,8 @@ class event
     virtual ~iholder() {}
     virtual void wait() const = 0;
     virtual bool ready() const = 0;
+    // move construct this holder into inline storage at addr
+    virtual iholder* move_to(void* addr) = 0;
   };
 
   template <typename ValueType, int dummy=0>
@@ -88,6 +97,7 @@ class event
     event_holder(EventType&& e) : m_held(std::move(e)) {}
     void wait()  const { if (!this->isValid()) this->setValue(m_held.wait()); }
     bool ready() const { return this->isValid() ? true : m_held.ready(); }
+    iholder* move_to(void* addr) { return new (addr) event_holder(std::move(*this)); }
   };
 
   // Argh, avoid specialization, find a better way to compose setValue
@@ -100,15 +110,73 @@ class event
     event_holder(EventType&& e) : m_held(std::move(e)) {}
     void wait()  const { if (!this->isValid()) {m_held.wait(); this->setValue();} }
     bool ready() const { return this->isValid() ? true : m_held.ready(); }
+    iholder* move_to(void* addr) { return new (addr) event_holder(std::move(*this)); }
   };
 
-  std::unique_ptr<iholder> m_content;
+  template <typename EventType>
+  using holder_type = event_holder<EventType,typename EventType::value_type>;
+
+  // Large enough for task::event and typed_event of pointers and integers
+  static constexpr size_t inline_size = 48;
+  using storage_type = std::aligned_storage<inline_size>::type;
+
+  template <typename Holder>
+  using fits_inline = std::integral_constant<bool,
+    sizeof(Holder) <= inline_size
+    && alignof(Holder) <= alignof(storage_type)
+    && std::is_nothrow_move_constructible<Holder>::value>;
+
+  storage_type m_storage;
+  iholder* m_content;
+
+  bool
+  is_inline() const
+  {
+    return m_content == reinterpret_cast<const iholder*>(&m_storage);
+  }
+
+  void
+  reset()
+  {
+    if (is_inline())
+      m_content->~iholder();
+    else
+      delete m_content;
+    m_content = nullptr;
+  }
+
+  void
+  take(event& rhs)
+  {
+    if (rhs.is_inline()) {
+      m_content = rhs.m_content->move_to(&m_storage);
+      rhs.reset();
+    }
+    else {
+      m_content = rhs.m_content;
+      rhs.m_content = nullptr;
+    }
+  }
+
+  template <typename Holder, typename EventType>
+  iholder*
+  create(EventType&& e, std::true_type)
+  {
+    return new (&m_storage) Holder(std::forward<EventType>(e));
+  }
+
+  template <typename Holder, typename EventType>
+  iholder*
+  create(EventType&& e, std::false_type)
+  {
+    return new Holder(std::forward<EventType>(e));
+  }
 
   template <typename ValueType>
   value_holder<ValueType>*
   value_cast() const noexcept
   {
-    return dynamic_cast<value_holder<ValueType>*>(m_content.get());
+    return dynamic_cast<value_holder<ValueType>*>(m_content);
   }
 
 
@@ -118,22 +186,33 @@ public:
     : m_content(nullptr)
   {}
 
-  event(event&& rhs)
-    : m_content(std::move(rhs.m_content))
+  event(event&& rhs) noexcept
+    : m_content(nullptr)
   {
-    // Invalidate rhs to avoid double delete
-    rhs.m_content = nullptr;
+    // Invalidates rhs to avoid double delete
+    take(rhs);
   }
 
   template <typename EventType>
   event(EventType&& e)
-    : m_content(new event_holder<EventType,typename EventType::value_type>(std::forward<EventType>(e)))
+    : m_content(create<holder_type<EventType>>
+                (std::forward<EventType>(e),fits_inline<holder_type<EventType>>()))
   {}
 
+  ~event()
+  {
+    if (m_content)
+      reset();
+  }
+
   event&
-  operator=(event&& e)
+  operator=(event&& e) noexcept
   {
-    std::swap(m_content,e.m_content);
+    if (this != &e) {
+      if (m_content)
+        reset();
+      take(e);
+    }
     return *this;
   }
 
@@ -0,0 +1,166 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "host_pool.h"
+#include "hugepage.h"
+#include "numa.h"
+#include "metrics.h"
+#include "config_reader.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+static size_t
+page_size()
+{
+  static size_t size = getpagesize();
+  return size;
+}
+
+static size_t
+pool_capacity()
+{
+  static size_t capacity = xrt::config::get_host_pool_size();
+  return capacity;
+}
+
+// Size class of a pooled buffer, 0 if the buffer is not pooled.  Classes
+// are pages spaced an eighth of the next power of two apart, so rounding
+// up to a class adds at most 1/8 to a buffer
+static size_t
+get_class(size_t size, size_t align)
+{
+  if (!pool_capacity() || size < page_size() || align > page_size())
+    return 0;
+  size_t pow2 = page_size();
+  while (pow2 < size)
+    pow2 <<= 1;
+  size_t step = std::max(pow2/8,page_size());
+  size_t cls = (size + step - 1) / step * step;
+  return cls <= pool_capacity() ? cls : 0;
+}
+
+static void*
+allocate_new(size_t size, size_t align)
+{
+  void* ptr = nullptr;
+  if (posix_memalign(&ptr,xrt::hugepage::get_alignment(size,align),size))
+    throw std::bad_alloc();
+  xrt::hugepage::advise(ptr,size);
+  xrt::numa::bind_host_memory(ptr,size);
+
+  // Fault in after the policies above are set, MAP_POPULATE would
+  // fault in pages before huge page and NUMA policy can be applied
+  static bool prefault = xrt::config::get_host_prefault();
+  if (prefault) {
+    auto data = static_cast<volatile char*>(ptr);
+    for (size_t offset=0; offset<size; offset+=page_size())
+      data[offset] = 0;
+  }
+  return ptr;
+}
+
+static xrt::metrics::counter&
+allocations(bool hit)
+{
+  static auto& hits = xrt::metrics::get_counter
+    ("xrt_host_pool_allocations_total{result=\"hit\"}","Pooled host buffer allocations");
+  static auto& misses = xrt::metrics::get_counter
+    ("xrt_host_pool_allocations_total{result=\"miss\"}","Pooled host buffer allocations");
+  return hit ? hits : misses;
+}
+
+// Free buffers per size class
+struct pool
+{
+  std::mutex m_mutex;
+  std::map<size_t,std::vector<void*>> m_free;
+  size_t m_bytes = 0;
+
+  void*
+  get(size_t cls)
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    auto itr = m_free.find(cls);
+    if (itr==m_free.end() || itr->second.empty())
+      return nullptr;
+    auto ptr = itr->second.back();
+    itr->second.pop_back();
+    m_bytes -= cls;
+    return ptr;
+  }
+
+  bool
+  put(void* ptr, size_t cls)
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    if (m_bytes + cls > pool_capacity())
+      return false;
+    m_free[cls].push_back(ptr);
+    m_bytes += cls;
+    return true;
+  }
+
+  ~pool()
+  {
+    for (auto& entry : m_free)
+      for (auto ptr : entry.second)
+        free(ptr);
+  }
+};
+
+static pool&
+get_pool()
+{
+  static pool s_pool;
+  return s_pool;
+}
+
+}
+
+namespace xrt { namespace host_pool {
+
+void*
+allocate(size_t size, size_t align)
+{
+  auto cls = get_class(size,align);
+  if (!cls)
+    return allocate_new(size,align);
+
+  auto ptr = get_pool().get(cls);
+  allocations(ptr!=nullptr).add();
+  return ptr ? ptr : allocate_new(cls,page_size());
+}
+
+void
+deallocate(void* ptr, size_t size, size_t align)
+{
+  if (!ptr)
+    return;
+  auto cls = get_class(size,align);
+  if (!cls || !get_pool().put(ptr,cls))
+    free(ptr);
+}
+
+}} // host_pool,xrt
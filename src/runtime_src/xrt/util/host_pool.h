@@ -0,0 +1,60 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef xrt_util_host_pool_h_
+#define xrt_util_host_pool_h_
+
+#include <cstddef>
+
+namespace xrt { namespace host_pool {
+
+/**
+ * Allocate an aligned host buffer
+ *
+ * Buffers of at least a page are rounded up to a size class, classes
+ * are an eighth of a power of two apart, and are reused from the pool
+ * when a buffer of the same class was freed earlier.  New buffers are aligned per huge page policy
+ * and bound to the host memory NUMA node, see xrt/util/hugepage.h
+ * and xrt/util/numa.h.
+ *
+ * The number of bytes kept in the pool is bounded by sdaccel.ini:
+ *  [Runtime]
+ *   host_pool_size = <bytes, 0 disables pooling>
+ *   host_prefault = true
+ * With host_prefault, new buffers are faulted in before they are
+ * returned, after huge page and NUMA policy has been applied, so the
+ * first DMA or memcpy does not take page faults.
+ *
+ * @size: size of buffer in bytes
+ * @align: required alignment, power of two
+ * Return: buffer, throws std::bad_alloc on failure
+ */
+void*
+allocate(size_t size, size_t align);
+
+/**
+ * Release a buffer obtained from allocate()
+ *
+ * @ptr: buffer to release, can be nullptr
+ * @size: size that was passed to allocate()
+ * @align: alignment that was passed to allocate()
+ */
+void
+deallocate(void* ptr, size_t size, size_t align);
+
+}} // host_pool,xrt
+
+#endif
@@ -0,0 +1,83 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "hugepage.h"
+#include "debug.h"
+#include "config_reader.h"
+
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+
+#ifdef __GNUC__
+# include <sys/mman.h>
+#endif
+
+namespace {
+
+static size_t
+read_hugepage_size()
+{
+#if defined(__GNUC__) && defined(MADV_HUGEPAGE)
+  std::ifstream istr("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size");
+  size_t size = 0;
+  if (istr >> size)
+    return size;
+#endif
+  return 0;
+}
+
+static bool
+enabled()
+{
+  static bool value = xrt::config::get_host_hugepage() && xrt::hugepage::get_size();
+  return value;
+}
+
+}
+
+namespace xrt { namespace hugepage {
+
+size_t
+get_size()
+{
+  static size_t size = read_hugepage_size();
+  return size;
+}
+
+size_t
+get_alignment(size_t size, size_t align)
+{
+  if (!enabled() || size < get_size() || align >= get_size())
+    return align;
+  return get_size();
+}
+
+void
+advise(void* ptr, size_t size)
+{
+#if defined(__GNUC__) && defined(MADV_HUGEPAGE)
+  if (!enabled() || !ptr || size < get_size())
+    return;
+  if (reinterpret_cast<uintptr_t>(ptr) % get_size())
+    return;
+  if (madvise(ptr,size,MADV_HUGEPAGE)) {
+    XRT_DEBUG(std::cout,"madvise(MADV_HUGEPAGE) failed for host buffer ",ptr,"\n");
+  }
+#endif
+}
+
+}} // hugepage,xrt
@@ -0,0 +1,60 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef xrt_util_hugepage_h_
+#define xrt_util_hugepage_h_
+
+#include <cstddef>
+
+namespace xrt { namespace hugepage {
+
+/**
+ * Size of transparent huge pages on this host, 0 if not supported
+ */
+size_t
+get_size();
+
+/**
+ * Alignment to use when allocating a host buffer
+ *
+ * When sdaccel.ini enables huge pages for host buffers:
+ *  [Runtime]
+ *   host_hugepage = true
+ * buffers of at least one huge page are aligned to a huge page so
+ * that they can be backed by huge pages, which lets the driver build
+ * scatter gather tables with one entry per huge page rather than one
+ * per 4K page.
+ *
+ * @size: size of buffer
+ * @align: alignment required by caller
+ * Return: @align or the huge page size if larger and applicable
+ */
+size_t
+get_alignment(size_t size, size_t align);
+
+/**
+ * Advise the kernel to back a host buffer with huge pages
+ *
+ * Nothing is done unless the buffer was allocated with the alignment
+ * returned by get_alignment() and huge pages are enabled.  Must be
+ * called before the buffer is touched.
+ */
+void
+advise(void* ptr, size_t size);
+
+}} // hugepage,xrt
+
+#endif
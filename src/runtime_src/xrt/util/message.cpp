@@ -17,11 +17,18 @@
 #include "message.h"
 
 #include "config_reader.h"
+#include "task.h"
 #include <unistd.h>
 #include <syslog.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <fstream>
 #include <iostream>
+#include <thread>
 
 namespace {
 
@@ -112,6 +119,41 @@ private:
   };
 };
 
+//--
+// Forwards messages to another dispatcher from a background thread.
+//
+// Senders copy the message into a bounded lock-free ring and return
+// without touching the underlying stream.  When the ring is full the
+// message is dropped and counted rather than blocking the sender, the
+// flusher reports the number of dropped messages.  Messages sent after
+// stop() are forwarded synchronously.
+class async_dispatch : public message_dispatch
+{
+public:
+  async_dispatch(message_dispatch* sink, size_t capacity);
+  virtual ~async_dispatch();
+  virtual void send(severity_level l, const char* msg) override;
+  void stop();
+private:
+  struct entry
+  {
+    severity_level level;
+    std::string msg;
+  };
+
+  void flush_loop();
+  void drain();
+
+  std::unique_ptr<message_dispatch> m_sink;
+  std::unique_ptr<xrt::task::bounded_ring<entry>> m_ring;
+  std::atomic<size_t> m_dropped {0};
+  std::atomic<bool> m_stop {false};
+  std::atomic<bool> m_sleeping {false};
+  std::mutex m_mutex;
+  std::condition_variable m_work;
+  std::thread m_flusher;
+};
+
 //-------
 message_dispatch*
 message_dispatch::make_dispatcher(const std::string& choice)
@@ -168,16 +210,119 @@ console_dispatch::send(severity_level l, const char* msg) {
   std::cout << severityMap[l]  << msg << std::endl;
 }
 
+//async ops
+async_dispatch::async_dispatch(message_dispatch* sink, size_t capacity)
+  : m_sink(sink), m_ring(new xrt::task::bounded_ring<entry>(capacity))
+{
+  m_flusher = std::thread(&async_dispatch::flush_loop,this);
+}
+
+async_dispatch::~async_dispatch()
+{
+  stop();
+}
+
+void
+async_dispatch::stop()
+{
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    if (m_stop)
+      return;
+    m_stop = true;
+    m_work.notify_one();
+  }
+  if (m_flusher.joinable())
+    m_flusher.join();
+}
+
+void
+async_dispatch::send(severity_level l, const char* msg)
+{
+  if (m_stop)
+    return m_sink->send(l,msg);
+
+  if (!m_ring->try_push({l,msg})) {
+    ++m_dropped;
+    return;
+  }
+
+  // pairs with the m_sleeping store in flush_loop
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (m_sleeping.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_work.notify_one();
+  }
+}
+
+void
+async_dispatch::drain()
+{
+  entry e;
+  while (m_ring->try_pop(e))
+    m_sink->send(e.level,e.msg.c_str());
+
+  if (auto dropped = m_dropped.exchange(0)) {
+    auto msg = std::to_string(dropped) + " messages dropped, runtime_log_async_capacity too small";
+    m_sink->send(severity_level::WARNING,msg.c_str());
+  }
+}
+
+void
+async_dispatch::flush_loop()
+{
+  while (!m_stop) {
+    drain();
+
+    std::unique_lock<std::mutex> lk(m_mutex);
+    m_sleeping = true;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!m_stop && !m_ring->size())
+      m_work.wait(lk);
+    m_sleeping = false;
+  }
+  drain();
+}
+
+message_dispatch*
+make_dispatcher()
+{
+  const std::string logger = xrt::config::get_logging();
+  auto dispatcher = message_dispatch::make_dispatcher(logger);
+  if (!xrt::config::get_logging_async() || logger == "null" || logger == "")
+    return dispatcher;
+
+  static async_dispatch* async = nullptr;
+  async = new async_dispatch(dispatcher,xrt::config::get_logging_async_capacity());
+
+  // Flush pending messages at exit, later messages are sent synchronously
+  std::atexit([] { async->stop(); });
+  return async;
+}
+
+message_dispatch*
+get_dispatcher()
+{
+  static message_dispatch* dispatcher = make_dispatcher();
+  return dispatcher;
+}
+
 } //end unnamed namespace
 
 namespace xrt { namespace message {
 
+bool
+enabled()
+{
+  static const std::string logger = xrt::config::get_logging();
+  static bool value = (logger != "null" && logger != "");
+  return value;
+}
+
 void
 send(severity_level l, const char* msg)
 {
-  static const std::string logger =  xrt::config::get_logging();
-  static message_dispatch* dispatcher = message_dispatch::make_dispatcher(logger);
-  dispatcher->send(l, msg);
+  get_dispatcher()->send(l, msg);
 }
 
 }} // message,xrt
@@ -35,6 +35,15 @@ enum class severity_level : unsigned short
  WARNING
 };
 
+/**
+ * Check if messages are dispatched anywhere
+ *
+ * Cheap check that callers can use to skip formatting a message that
+ * would be discarded because runtime_log is null.
+ */
+bool
+enabled();
+
 void 
 send(severity_level l, const char* msg);
 
@@ -0,0 +1,244 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "metrics.h"
+#include "debug.h"
+#include "config_reader.h"
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <sstream>
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+
+#ifdef __GNUC__
+# include <unistd.h>
+# include <poll.h>
+# include <sys/socket.h>
+# include <sys/un.h>
+#endif
+
+namespace {
+
+enum class metric_kind { counter, gauge };
+
+struct metric
+{
+  metric_kind kind;
+  std::string help;
+  xrt::metrics::counter counter;
+  xrt::metrics::gauge gauge;
+
+  metric(metric_kind k, const std::string& h) : kind(k), help(h) {}
+};
+
+// The registry is intentionally never deleted, metrics are updated
+// during static destruction of other files
+struct registry
+{
+  std::mutex mutex;
+  std::map<std::string,std::unique_ptr<metric>> metrics;
+};
+
+static registry*
+get_registry()
+{
+  static registry* r = new registry;
+  return r;
+}
+
+static std::string
+base_name(const std::string& name)
+{
+  return name.substr(0,name.find('{'));
+}
+
+#ifdef __GNUC__
+// Serve metrics on a unix socket.  Each connection gets one HTTP/1.0
+// response with the text format, so the socket can be scraped with a
+// plain HTTP client (curl --unix-socket) or through a forwarding proxy
+class exporter
+{
+  std::string m_path;
+  int m_fd = -1;
+  std::atomic<bool> m_stop {false};
+  std::thread m_thread;
+
+  void
+  serve(int fd)
+  {
+    // Drain the request, its content doesn't matter
+    char request[1024];
+    pollfd pfd = {fd,POLLIN,0};
+    if (poll(&pfd,1,100)>0)
+      (void)::recv(fd,request,sizeof(request),0);
+
+    std::ostringstream body;
+    xrt::metrics::write(body);
+    auto text = body.str();
+
+    std::ostringstream response;
+    response << "HTTP/1.0 200 OK\r\n"
+             << "Content-Type: text/plain; version=0.0.4\r\n"
+             << "Content-Length: " << text.size() << "\r\n\r\n"
+             << text;
+    auto data = response.str();
+    for (size_t sent=0; sent<data.size(); ) {
+      auto ret = ::send(fd,data.data()+sent,data.size()-sent,MSG_NOSIGNAL);
+      if (ret<=0)
+        break;
+      sent += ret;
+    }
+    ::close(fd);
+  }
+
+  void
+  run()
+  {
+    while (!m_stop) {
+      pollfd pfd = {m_fd,POLLIN,0};
+      if (poll(&pfd,1,100)<=0)
+        continue;
+      auto fd = ::accept(m_fd,nullptr,nullptr);
+      if (fd>=0)
+        serve(fd);
+    }
+  }
+
+public:
+  explicit
+  exporter(const std::string& path)
+    : m_path(path)
+  {
+    sockaddr_un addr;
+    if (m_path.size() >= sizeof(addr.sun_path)) {
+      XRT_PRINT(std::cout,"metrics socket path too long: ",m_path,"\n");
+      return;
+    }
+
+    std::memset(&addr,0,sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path,m_path.c_str());
+
+    m_fd = ::socket(AF_UNIX,SOCK_STREAM|SOCK_CLOEXEC,0);
+    if (m_fd<0)
+      return;
+
+    ::unlink(m_path.c_str());
+    if (::bind(m_fd,reinterpret_cast<sockaddr*>(&addr),sizeof(addr)) || ::listen(m_fd,4)) {
+      XRT_PRINT(std::cout,"failed to serve metrics on ",m_path,": ",std::strerror(errno),"\n");
+      ::close(m_fd);
+      m_fd = -1;
+      return;
+    }
+
+    m_thread = std::thread(&exporter::run,this);
+  }
+
+  ~exporter()
+  {
+    if (m_fd<0)
+      return;
+    m_stop = true;
+    m_thread.join();
+    ::close(m_fd);
+    ::unlink(m_path.c_str());
+  }
+};
+
+static std::unique_ptr<exporter> s_exporter;
+#endif
+
+static void
+start_exporter()
+{
+  static std::once_flag flag;
+  std::call_once(flag,[]() {
+#ifdef __GNUC__
+    if (xrt::metrics::enabled())
+      s_exporter.reset(new exporter(xrt::config::get_metrics_socket()));
+#endif
+  });
+}
+
+static metric&
+get_metric(const std::string& name, const std::string& help, metric_kind kind)
+{
+  start_exporter();
+
+  auto r = get_registry();
+  std::lock_guard<std::mutex> lk(r->mutex);
+  auto& m = r->metrics[name];
+  if (!m)
+    m.reset(new metric(kind,help));
+  else if (m->kind!=kind)
+    throw std::runtime_error("metric '" + name + "' registered with different type");
+  return *m;
+}
+
+} // namespace
+
+namespace xrt { namespace metrics {
+
+counter&
+get_counter(const std::string& name, const std::string& help)
+{
+  return get_metric(name,help,metric_kind::counter).counter;
+}
+
+gauge&
+get_gauge(const std::string& name, const std::string& help)
+{
+  return get_metric(name,help,metric_kind::gauge).gauge;
+}
+
+bool
+enabled()
+{
+  static bool value = !xrt::config::get_metrics_socket().empty();
+  return value;
+}
+
+void
+write(std::ostream& ostr)
+{
+  auto r = get_registry();
+  std::lock_guard<std::mutex> lk(r->mutex);
+  std::string last;
+  for (auto& entry : r->metrics) {
+    auto& name = entry.first;
+    auto& m = *entry.second;
+    auto base = base_name(name);
+    if (base!=last) {
+      ostr << "# HELP " << base << " " << m.help << "\n"
+           << "# TYPE " << base << " "
+           << (m.kind==metric_kind::counter ? "counter" : "gauge") << "\n";
+      last = base;
+    }
+    ostr << name << " ";
+    if (m.kind==metric_kind::counter)
+      ostr << m.counter.value();
+    else
+      ostr << m.gauge.value();
+    ostr << "\n";
+  }
+}
+
+}} // metrics,xrt
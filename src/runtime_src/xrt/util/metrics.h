@@ -0,0 +1,116 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef xrt_util_metrics_h_
+#define xrt_util_metrics_h_
+
+#include <atomic>
+#include <string>
+#include <ostream>
+#include <cstdint>
+
+namespace xrt { namespace metrics {
+
+/**
+ * Monotonically increasing count, e.g. bytes transferred
+ */
+class counter
+{
+  std::atomic<uint64_t> m_value {0};
+public:
+  void
+  add(uint64_t value=1)
+  {
+    m_value.fetch_add(value,std::memory_order_relaxed);
+  }
+
+  uint64_t
+  value() const
+  {
+    return m_value.load(std::memory_order_relaxed);
+  }
+};
+
+/**
+ * Current level that goes up and down, e.g. outstanding commands
+ */
+class gauge
+{
+  std::atomic<int64_t> m_value {0};
+public:
+  void
+  add(int64_t value=1)
+  {
+    m_value.fetch_add(value,std::memory_order_relaxed);
+  }
+
+  void
+  sub(int64_t value=1)
+  {
+    m_value.fetch_sub(value,std::memory_order_relaxed);
+  }
+
+  void
+  set(int64_t value)
+  {
+    m_value.store(value,std::memory_order_relaxed);
+  }
+
+  int64_t
+  value() const
+  {
+    return m_value.load(std::memory_order_relaxed);
+  }
+};
+
+/**
+ * Get the counter or gauge registered under @name, create it on
+ * first use
+ *
+ * The name follows Prometheus conventions and may carry labels, e.g.
+ * "xrt_dma_bytes_total{direction=\"to_device\"}".  Metrics of the
+ * same name without labels share @help.  The returned reference stays
+ * valid for the life time of the process, so callers should keep it
+ * in a function static instead of looking it up every time.
+ *
+ * The first call also starts the exporter if sdaccel.ini enables it:
+ *  [Runtime]
+ *   metrics_socket = /path/to/socket
+ */
+counter&
+get_counter(const std::string& name, const std::string& help);
+
+gauge&
+get_gauge(const std::string& name, const std::string& help);
+
+/**
+ * @return
+ *   true if metrics are exported, use to guard instrumentation that
+ *   is more expensive than updating an atomic
+ */
+bool
+enabled();
+
+/**
+ * Write all metrics in Prometheus text exposition format
+ */
+void
+write(std::ostream& ostr);
+
+}} // metrics,xrt
+
+#endif
@@ -0,0 +1,79 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "numa.h"
+#include "debug.h"
+#include "config_reader.h"
+
+#include <atomic>
+#include <vector>
+#include <iostream>
+
+#ifdef __GNUC__
+# include <unistd.h>
+# include <sys/syscall.h>
+# include <linux/mempolicy.h>
+#endif
+
+namespace {
+
+static std::atomic<int> s_node {-1};
+
+}
+
+namespace xrt { namespace numa {
+
+void
+set_host_memory_node(int node)
+{
+  if (node < 0)
+    return;
+  int expected = -1;
+  if (s_node.compare_exchange_strong(expected,node)) {
+    XRT_DEBUG(std::cout,"host memory numa node #",node,"\n");
+  }
+}
+
+int
+get_host_memory_node()
+{
+  return s_node;
+}
+
+void
+bind_host_memory(void* ptr, size_t size)
+{
+#ifdef __GNUC__
+  static bool enabled = xrt::config::get_numa_host_memory();
+  int node = s_node;
+  if (!enabled || node < 0 || !ptr || !size)
+    return;
+
+  static size_t page = getpagesize();
+  if (reinterpret_cast<uintptr_t>(ptr) % page)
+    return;
+
+  const size_t bits = 8*sizeof(unsigned long);
+  std::vector<unsigned long> mask(node/bits + 1, 0);
+  mask[node/bits] = 1UL << (node%bits);
+  size = ((size + page - 1) / page) * page;
+  if (syscall(SYS_mbind,ptr,size,MPOL_PREFERRED,mask.data(),mask.size()*bits,0)) {
+    XRT_DEBUG(std::cout,"mbind failed for host buffer ",ptr,"\n");
+  }
+#endif
+}
+
+}} // numa,xrt
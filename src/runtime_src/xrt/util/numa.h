@@ -0,0 +1,57 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef xrt_util_numa_h_
+#define xrt_util_numa_h_
+
+#include <cstddef>
+
+namespace xrt { namespace numa {
+
+/**
+ * Set the NUMA node that host buffers should be allocated from
+ *
+ * The first call with a valid node wins, subsequent calls are
+ * ignored.  Typically called with the node of the first device
+ * that is set up.
+ */
+void
+set_host_memory_node(int node);
+
+/**
+ * @return
+ *   NUMA node host buffers are allocated from, or -1 if not set
+ */
+int
+get_host_memory_node();
+
+/**
+ * Set memory policy of host buffer to prefer the host memory node
+ *
+ * Nothing is done unless sdaccel.ini enables it:
+ *  [Runtime]
+ *   numa_host_memory = true
+ *
+ * The policy applies to pages not yet touched, so this function
+ * should be called right after the buffer is allocated.  The buffer
+ * must be page aligned, otherwise it is left as is.
+ */
+void
+bind_host_memory(void* ptr, size_t size);
+
+}} // numa,xrt
+
+#endif
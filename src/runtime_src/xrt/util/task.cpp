@@ -0,0 +1,72 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "task.h"
+#include "thread.h"
+
+#include <string>
+
+namespace {
+
+// Set when the shared workers are stopped at program exit.  The
+// workers must not be used after that, fork_join then runs on the
+// calling thread only.
+static std::atomic<bool> s_stopped {false};
+
+// Work on the shared queue mostly waits on devices (xclbin download,
+// counter reads), so the worker count does not follow the number of
+// cores closely
+static unsigned int
+worker_count()
+{
+  auto cores = std::thread::hardware_concurrency();
+  return std::min(16u,std::max(4u,cores));
+}
+
+struct shared_workers
+{
+  xrt::task::queue queue;
+  std::vector<std::thread> workers;
+
+  shared_workers()
+  {
+    for (unsigned int w=0; w<worker_count(); ++w)
+      workers.emplace_back(xrt::thread(xrt::task::worker2,std::ref(queue),"fork/join " + std::to_string(w)));
+  }
+
+  ~shared_workers()
+  {
+    s_stopped = true;
+    queue.stop();
+    for (auto& t : workers)
+      t.join();
+  }
+};
+
+}
+
+namespace xrt { namespace task {
+
+queue*
+shared_queue()
+{
+  if (s_stopped)
+    return nullptr;
+  static shared_workers sw;
+  return s_stopped ? nullptr : &sw.queue;
+}
+
+}} // task,xrt
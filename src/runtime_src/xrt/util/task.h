@@ -19,14 +19,26 @@
 
 #include "xrt/util/time.h"
 #include "xrt/util/debug.h"
+#include "xrt/util/metrics.h"
 #include "xrt/config.h"
 
 #include <future>
 #include <functional>
 #include <chrono>
 #include <queue>
+#include <deque>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <new>
+#include <cstdlib>
+#include <exception>
+#include <iterator>
+#include <type_traits>
 #include <iostream>
 
 namespace xrt { namespace task {
@@ -39,6 +51,10 @@ namespace xrt { namespace task {
  *
  * Objects of this task class can be stored in any STL container even
  * when the underlying std::packaged_tasks are of different types.
+ *
+ * Callables that fit in a few words and are nothrow move constructible,
+ * which includes std::packaged_task, are stored inline in the task
+ * object, so creating and queuing such tasks does not allocate.
  */
 class task
 {
@@ -46,6 +62,8 @@ class task
   {
     virtual ~task_iholder() {};
     virtual void execute() = 0;
+    // move construct this holder into inline storage at addr
+    virtual task_iholder* move_to(void* addr) = 0;
   };
 
   template <typename Callable>
@@ -54,28 +72,102 @@ class task
     Callable held;
     task_holder(Callable&& t) : held(std::move(t)) {}
     void execute() { held(); }
+    task_iholder* move_to(void* addr) { return new (addr) task_holder(std::move(held)); }
   };
 
-  std::unique_ptr<task_iholder> content;
+  template <typename Callable>
+  using holder_type = task_holder<typename std::decay<Callable>::type>;
+
+  static constexpr size_t inline_size = 32;
+  using storage_type = std::aligned_storage<inline_size>::type;
+
+  template <typename Holder>
+  using fits_inline = std::integral_constant<bool,
+    sizeof(Holder) <= inline_size
+    && alignof(Holder) <= alignof(storage_type)
+    && std::is_nothrow_move_constructible<Holder>::value>;
+
+  storage_type storage;
+  task_iholder* content;
+  unsigned long queued = 0;  // time_ns() when added to a traced queue
+
+  bool
+  is_inline() const
+  {
+    return content == reinterpret_cast<const task_iholder*>(&storage);
+  }
+
+  void
+  reset()
+  {
+    if (is_inline())
+      content->~task_iholder();
+    else
+      delete content;
+    content = nullptr;
+  }
+
+  void
+  take(task& rhs)
+  {
+    queued = rhs.queued;
+    if (rhs.is_inline()) {
+      content = rhs.content->move_to(&storage);
+      rhs.reset();
+    }
+    else {
+      content = rhs.content;
+      rhs.content = nullptr;
+    }
+  }
+
+  template <typename Holder, typename Callable>
+  task_iholder*
+  create(Callable&& c, std::true_type)
+  {
+    return new (&storage) Holder(std::forward<Callable>(c));
+  }
+
+  template <typename Holder, typename Callable>
+  task_iholder*
+  create(Callable&& c, std::false_type)
+  {
+    return new Holder(std::forward<Callable>(c));
+  }
 
 public:
   task()
     : content(nullptr)
   {}
 
-  task(task&& rhs)
-    : content(std::move(rhs.content))
-  {}
+  task(task&& rhs) noexcept
+    : content(nullptr)
+  {
+    take(rhs);
+  }
 
-  template <typename Callable>
+  template <typename Callable,
+            typename = typename std::enable_if
+              <!std::is_same<typename std::decay<Callable>::type,task>::value>::type>
   task(Callable&& c)
-    : content(new task_holder<Callable>(std::forward<Callable>(c)))
+    : content(create<holder_type<Callable>>
+              (std::forward<Callable>(c),fits_inline<holder_type<Callable>>()))
   {}
 
+  ~task()
+  {
+    if (content)
+      reset();
+  }
+
   task&
-  operator=(task&& rhs)
+  operator=(task&& rhs) noexcept
   {
-    content = std::move(rhs.content);
+    if (this != &rhs) {
+      if (content)
+        reset();
+      take(rhs);
+    }
     return *this;
   }
 
@@ -91,6 +183,22 @@ public:
     content->execute();
   }
 
+  /**
+   * Time point when the task was added to a queue, 0 unless the
+   * queue is traced.
+   */
+  unsigned long
+  enqueue_time() const
+  {
+    return queued;
+  }
+
+  void
+  set_enqueue_time(unsigned long tp)
+  {
+    queued = tp;
+  }
+
   void
   operator() ()
   {
@@ -98,9 +206,341 @@ public:
   }
 };
 
+/**
+ * Trace hook for task queues
+ *
+ * A profiler registers a callback to see every task added to and
+ * removed from a task queue.  The callback is called with the queue,
+ * true on enqueue and false on dequeue, the depth of the queue after
+ * the operation, and on dequeue the time in ns the task spent on the
+ * queue.  The callback is called outside the queue lock and must be
+ * thread safe.  Pass nullptr to stop tracing.
+ */
+using queue_trace_callback =
+  void (*)(const void* queue, bool enqueue, size_t depth, unsigned long wait_ns);
+
+inline std::atomic<queue_trace_callback>&
+queue_trace()
+{
+  static std::atomic<queue_trace_callback> cb {nullptr};
+  return cb;
+}
+
+inline void
+register_queue_trace(queue_trace_callback cb)
+{
+  queue_trace() = cb;
+}
+
+/**
+ * Bounded lock-free multiple producer / multiple consumer ring
+ *
+ * Array based ring where each cell carries a sequence number that
+ * tells producers and consumers if the cell is ready to be written
+ * or read.  A producer or consumer claims a position with a single
+ * CAS on the enqueue or dequeue index, there are no locks.
+ *
+ * Capacity is rounded up to a power of two.  try_push fails when
+ * the ring is full, try_pop fails when the ring is empty, the caller
+ * decides how to wait.
+ */
+template <typename Task>
+class bounded_ring
+{
+  static constexpr size_t cache_line = 64;
+
+  struct alignas(64) cell
+  {
+    std::atomic<size_t> seq;
+    Task data;
+  };
+
+  // Cells are allocated with posix_memalign rather than new[] since
+  // c++11 operator new does not honor the extended alignment of cell.
+  // The enqueue and dequeue indices are kept on separate cache lines
+  // by padding, so that bounded_ring itself has no extended alignment
+  // and can be allocated with plain new.
+  cell* m_cells;
+  size_t m_mask;
+
+  char m_pad0[cache_line];
+  std::atomic<size_t> m_enqueue {0};
+  char m_pad1[cache_line - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> m_dequeue {0};
+  char m_pad2[cache_line - sizeof(std::atomic<size_t>)];
+
+  static size_t
+  round_up(size_t capacity)
+  {
+    size_t sz = 2;
+    while (sz < capacity)
+      sz <<= 1;
+    return sz;
+  }
+
+  static cell*
+  alloc_cells(size_t count)
+  {
+    void* mem = nullptr;
+    if (posix_memalign(&mem,alignof(cell),count*sizeof(cell)))
+      throw std::bad_alloc();
+    auto cells = static_cast<cell*>(mem);
+    for (size_t i=0; i<count; ++i)
+      new (&cells[i]) cell();
+    return cells;
+  }
+
+public:
+  explicit bounded_ring(size_t capacity)
+    : m_cells(alloc_cells(round_up(capacity))), m_mask(round_up(capacity)-1)
+  {
+    for (size_t i=0; i<=m_mask; ++i)
+      m_cells[i].seq.store(i,std::memory_order_relaxed);
+  }
+
+  ~bounded_ring()
+  {
+    for (size_t i=0; i<=m_mask; ++i)
+      m_cells[i].~cell();
+    free(m_cells);
+  }
+
+  bounded_ring(const bounded_ring&) = delete;
+  bounded_ring& operator=(const bounded_ring&) = delete;
+
+  bool
+  try_push(Task&& t)
+  {
+    auto pos = m_enqueue.load(std::memory_order_relaxed);
+    cell* c = nullptr;
+    while (true) {
+      c = &m_cells[pos & m_mask];
+      auto seq = c->seq.load(std::memory_order_acquire);
+      auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff==0) {
+        if (m_enqueue.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed))
+          break;
+      }
+      else if (diff<0)
+        return false; // full
+      else
+        pos = m_enqueue.load(std::memory_order_relaxed);
+    }
+    c->data = std::move(t);
+    c->seq.store(pos+1,std::memory_order_release);
+    return true;
+  }
+
+  bool
+  try_pop(Task& t)
+  {
+    auto pos = m_dequeue.load(std::memory_order_relaxed);
+    cell* c = nullptr;
+    while (true) {
+      c = &m_cells[pos & m_mask];
+      auto seq = c->seq.load(std::memory_order_acquire);
+      auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos+1);
+      if (diff==0) {
+        if (m_dequeue.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed))
+          break;
+      }
+      else if (diff<0)
+        return false; // empty
+      else
+        pos = m_dequeue.load(std::memory_order_relaxed);
+    }
+    t = std::move(c->data);
+    c->seq.store(pos+m_mask+1,std::memory_order_release);
+    return true;
+  }
+
+  // Approximate when producers or consumers are active
+  size_t
+  size() const
+  {
+    auto enq = m_enqueue.load(std::memory_order_relaxed);
+    auto deq = m_dequeue.load(std::memory_order_relaxed);
+    return enq > deq ? enq - deq : 0;
+  }
+
+  size_t
+  capacity() const
+  {
+    return m_mask+1;
+  }
+};
+
+/**
+ * Work stealing pool of task workers
+ *
+ * Each worker owns a deque of tasks and has an affinity, which is
+ * an index identifying the kind of work the worker prefers. Tasks
+ * are added with an affinity and are distributed round robin over
+ * the deques of workers with matching affinity.  A worker services
+ * its own deque first, and when that is empty it steals from the
+ * back of other workers' deques regardless of affinity.  Workers
+ * that find no work park on a condition variable that producers
+ * only signal when some worker is parked.
+ */
+template <typename Task>
+class stealing_pool
+{
+  struct worker_deque
+  {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<std::unique_ptr<worker_deque>> m_deques;
+  std::vector<std::vector<size_t>> m_affinity;  // affinity -> workers
+  std::unique_ptr<std::atomic<size_t>[]> m_next; // round robin per affinity
+  std::atomic<size_t> m_next_any {0};
+
+  std::mutex m_mutex;
+  std::condition_variable m_work;
+  std::atomic<long> m_pending {0};
+  std::atomic<unsigned int> m_sleepers {0};
+  std::atomic<bool> m_stop {false};
+
+  bool
+  pop(size_t idx, Task& t, bool back)
+  {
+    auto& dq = *m_deques[idx];
+    std::lock_guard<std::mutex> lk(dq.mutex);
+    if (dq.tasks.empty())
+      return false;
+    if (back) {
+      t = std::move(dq.tasks.back());
+      dq.tasks.pop_back();
+    }
+    else {
+      t = std::move(dq.tasks.front());
+      dq.tasks.pop_front();
+    }
+    return true;
+  }
+
+  bool
+  try_getWork(size_t worker, Task& t)
+  {
+    if (pop(worker,t,false))
+      return true;
+    auto workers = m_deques.size();
+    for (size_t i=1; i<workers; ++i)
+      if (pop((worker+i)%workers,t,true))
+        return true;
+    return false;
+  }
+
+public:
+  /**
+   * @param affinities
+   *   Number of different affinities, workers and tasks use
+   *   affinity values in range [0,affinities)
+   */
+  explicit stealing_pool(size_t affinities)
+    : m_affinity(affinities), m_next(new std::atomic<size_t>[affinities])
+  {
+    for (size_t i=0; i<affinities; ++i)
+      m_next[i] = 0;
+  }
+
+  /**
+   * Add a worker deque with specified affinity
+   *
+   * Must be called before any work is added to the pool
+   *
+   * @return
+   *   Worker index to be used with getWork
+   */
+  size_t
+  add_worker(size_t affinity)
+  {
+    m_deques.emplace_back(new worker_deque);
+    m_affinity.at(affinity).push_back(m_deques.size()-1);
+    return m_deques.size()-1;
+  }
+
+  void
+  addWork(size_t affinity, Task&& t)
+  {
+    auto& workers = m_affinity.at(affinity);
+    auto idx = workers.empty()
+      ? m_next_any++ % m_deques.size()
+      : workers[m_next[affinity]++ % workers.size()];
+
+    {
+      auto& dq = *m_deques[idx];
+      std::lock_guard<std::mutex> lk(dq.mutex);
+      dq.tasks.push_back(std::move(t));
+    }
+
+    // pairs with the m_sleepers increment in getWork
+    ++m_pending;
+    if (m_sleepers) {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      m_work.notify_one();
+    }
+  }
+
+  /**
+   * Get work for a worker, blocks until work is available or pool
+   * is stopped.  An invalid task is returned when stopped.
+   */
+  Task
+  getWork(size_t worker)
+  {
+    Task task;
+    while (!m_stop) {
+      if (try_getWork(worker,task)) {
+        --m_pending;
+        break;
+      }
+
+      std::unique_lock<std::mutex> lk(m_mutex);
+      ++m_sleepers;
+      while (!m_stop && m_pending<=0)
+        m_work.wait(lk);
+      --m_sleepers;
+    }
+    return task;
+  }
+
+  size_t
+  size() const
+  {
+    auto pending = m_pending.load();
+    return pending > 0 ? pending : 0;
+  }
+
+  size_t
+  workers() const
+  {
+    return m_deques.size();
+  }
+
+  void
+  stop()
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_stop=true;
+    m_work.notify_all();
+  }
+};
+
 /**
  * Multiple producer / multiple consumer queue of task objects
  *
+ * By default the queue is a std::queue guarded by a mutex.  Calling
+ * make_lockfree() switches the queue to a bounded_ring, where
+ * consumers spin on an empty ring for a little while before parking
+ * on a condition variable, and producers only take the mutex when
+ * some consumer is parked.
+ *
+ * Calling attach() turns the queue into a front end of a
+ * stealing_pool, work added to the queue is forwarded to the pool
+ * with the affinity of the queue.
+ *
  * This code is not specifically tied to task::task, but we keep
  * the defintion here to make task.h stand-alone
  */
@@ -108,57 +548,215 @@ template <typename Task>
 class mpmcqueue
 {
   std::queue<Task> m_tasks;
+  std::unique_ptr<bounded_ring<Task>> m_ring;
+  stealing_pool<Task>* m_pool = nullptr;
+  size_t m_affinity = 0;
   mutable std::mutex m_mutex;
   std::condition_variable m_work;
-  bool m_stop = false;
+  std::atomic<bool> m_stop {false};
+  std::atomic<unsigned int> m_sleepers {0};
   unsigned long tp = 0;       // time point when last task consumed
   unsigned long waittime = 0; // wait time from tp to next task avail
   bool debug = false;
+  bool timed = xrt::metrics::enabled(); // track waittime for debug or metrics
+
+  // number of failed polls of an empty ring before a consumer parks
+  static constexpr unsigned int spin_count = 2000;
+
+  // tasks on all timed queues that are not serviced by a pool
+  static xrt::metrics::gauge&
+  depth_gauge()
+  {
+    static auto& gauge = xrt::metrics::get_gauge
+      ("xrt_task_queue_depth","Tasks waiting on task queues");
+    return gauge;
+  }
+
+  void
+  addWorkRing(Task&& t)
+  {
+    // spin while the ring is full
+    while (!m_ring->try_push(std::move(t)))
+      std::this_thread::yield();
+
+    // pairs with the m_sleepers increment in getWorkRing
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleepers.load(std::memory_order_relaxed)) {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      m_work.notify_one();
+    }
+  }
+
+  Task
+  getWorkRing()
+  {
+    Task task;
+    for (unsigned int spin=0; spin<spin_count && !m_stop; ++spin) {
+      if (m_ring->try_pop(task))
+        return task;
+    }
+
+    std::unique_lock<std::mutex> lk(m_mutex);
+    ++m_sleepers;
+    while (!m_stop) {
+      if (m_ring->try_pop(task))
+        break;
+      m_work.wait(lk);
+    }
+    --m_sleepers;
+    return task;
+  }
+
 public:
   mpmcqueue()
   {}
 
   explicit mpmcqueue(bool dbg)
-    : debug(dbg)
+    : debug(dbg), timed(dbg || xrt::metrics::enabled())
   {}
 
+  /**
+   * Switch the queue to a bounded lock-free ring
+   *
+   * Must be called before the queue is shared between threads.
+   * Tasks already on the queue are moved to the ring.
+   *
+   * @param capacity
+   *   Max number of tasks in the ring, rounded to a power of two.
+   *   Producers spin when the ring is full.
+   */
   void
-  addWork(Task&& t)
+  make_lockfree(size_t capacity)
   {
     std::lock_guard<std::mutex> lk(m_mutex);
-    m_tasks.push(std::move(t));
-    if (debug && tp) {
-      auto wt = time_ns() - tp;
-      waittime += wt;
-      XRT_DEBUG(std::cout,"m_tasks.size()=",m_tasks.size()," waittime (ms): ",wt*1e-6,"\n");
-      tp = 0;
+    if (m_ring)
+      return;
+    m_ring.reset(new bounded_ring<Task>(std::max(capacity,m_tasks.size())));
+    while (!m_tasks.empty()) {
+      m_ring->try_push(std::move(m_tasks.front()));
+      m_tasks.pop();
     }
-    //XRT_PRINT(std::cout,"m_tasks.size()=",m_tasks.size(),"\n");
-    m_work.notify_one();
   }
 
-  Task
-  getWork()
+  bool
+  lockfree() const
   {
-    std::unique_lock<std::mutex> lk(m_mutex);
-    while (!m_stop && m_tasks.empty()) {
-      m_work.wait(lk);
+    return m_ring!=nullptr;
+  }
+
+  /**
+   * Forward all work added to this queue to a work stealing pool
+   *
+   * Must be called before the queue is shared between threads.
+   * Tasks already on the queue are moved to the pool.
+   *
+   * @param pool
+   *   The pool that will service work added to this queue
+   * @param affinity
+   *   The pool affinity of work added to this queue
+   */
+  void
+  attach(stealing_pool<Task>* pool, size_t affinity)
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_pool = pool;
+    m_affinity = affinity;
+    if (timed)
+      depth_gauge().sub(m_tasks.size());
+    while (!m_tasks.empty()) {
+      m_pool->addWork(m_affinity,std::move(m_tasks.front()));
+      m_tasks.pop();
     }
+  }
+
+  void
+  addWork(Task&& t)
+  {
+    if (m_pool)
+      return m_pool->addWork(m_affinity,std::move(t));
 
+    auto trace = queue_trace().load(std::memory_order_relaxed);
+    if (trace)
+      t.set_enqueue_time(time_ns());
+    if (timed)
+      depth_gauge().add();
+
+    if (m_ring) {
+      addWorkRing(std::move(t));
+      if (trace)
+        trace(this,true,m_ring->size(),0);
+      return;
+    }
+
+    size_t depth = 0;
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      m_tasks.push(std::move(t));
+      depth = m_tasks.size();
+      if (timed && tp) {
+        static auto& metric = xrt::metrics::get_counter
+          ("xrt_task_queue_wait_ns_total","Time task queue consumers waited for work");
+        auto wt = time_ns() - tp;
+        waittime += wt;
+        metric.add(wt);
+        XRT_DEBUG(std::cout,"m_tasks.size()=",m_tasks.size()," waittime (ms): ",wt*1e-6,"\n");
+        tp = 0;
+      }
+      //XRT_PRINT(std::cout,"m_tasks.size()=",m_tasks.size(),"\n");
+      m_work.notify_one();
+    }
+
+    if (trace)
+      trace(this,true,depth,0);
+  }
+
+  Task
+  getWork()
+  {
     Task task;
-    if (!m_stop) {
-      task = std::move(m_tasks.front());
-      m_tasks.pop();
-      if (debug && m_tasks.size()==0)
-        tp = time_ns();
+    size_t depth = 0;
+    if (m_ring) {
+      task = getWorkRing();
+      depth = m_ring->size();
+    }
+    else {
+      std::unique_lock<std::mutex> lk(m_mutex);
+      while (!m_stop && m_tasks.empty()) {
+        m_work.wait(lk);
+      }
 
+      if (!m_stop) {
+        task = std::move(m_tasks.front());
+        m_tasks.pop();
+        depth = m_tasks.size();
+        if (timed && depth==0)
+          tp = time_ns();
+      }
     }
+
+    if (!task.valid())
+      return task;
+
+    if (timed)
+      depth_gauge().sub();
+
+    // tasks added before tracing was enabled have no enqueue time
+    auto trace = queue_trace().load(std::memory_order_relaxed);
+    if (trace && task.enqueue_time())
+      trace(this,false,depth,time_ns()-task.enqueue_time());
+
     return task;
   }
 
   size_t
   size() const
   {
+    if (m_pool)
+      return m_pool->size();
+
+    if (m_ring)
+      return m_ring->size();
+
     std::lock_guard<std::mutex> lk(m_mutex);
     return m_tasks.size();
   }
@@ -229,6 +827,7 @@ public:
 };
 
 using queue = mpmcqueue<task>;
+using pool = stealing_pool<task>;
 
 /**
  * event class wraps std::future<RT>
@@ -250,7 +849,7 @@ public:
   event() = delete;
   event(const event& rhs) = delete;
 
-  event(const event&& rhs)
+  event(const event&& rhs) noexcept
     : m_future(std::move(rhs.m_future))
   {}
 
@@ -371,6 +970,20 @@ worker_ndebug(queue& q)
   }
 }
 
+// A stealing worker services its own deque in the pool and steals
+// work from other deques when its own is empty.  The worker runs
+// until the pool is stopped.
+inline void
+stealing_worker(stealing_pool<task>& p, size_t worker)
+{
+  while (true) {
+    auto t = p.getWork(worker);
+    if (!t.valid())
+      break;
+    t();
+  }
+}
+
 inline void
 worker2(queue& q, const std::string& id="")
 {
@@ -385,6 +998,112 @@ worker(queue& q)
 {
   return worker2(q,"");
 }
+
+/**
+ * Queue serviced by the runtime's shared fork/join workers
+ *
+ * The workers are started on first use and stopped at program exit.
+ *
+ * @return
+ *   The shared queue, or nullptr after the workers have been stopped
+ */
+queue*
+shared_queue();
+
+namespace detail {
+
+template <typename Iterator, typename F>
+struct fork_join_state
+{
+  std::vector<Iterator> items;
+  std::vector<std::exception_ptr> errors;
+  F* fn;
+  std::atomic<size_t> next {0};
+  size_t done = 0;
+  std::mutex mutex;
+  std::condition_variable work_done;
+
+  // Claim and process items until none are left.  Claims are made
+  // before the joining thread can return, so fn is valid for every
+  // item processed
+  void
+  run()
+  {
+    size_t idx;
+    while ((idx = next.fetch_add(1)) < items.size()) {
+      try {
+        (*fn)(*items[idx]);
+      }
+      catch (...) {
+        errors[idx] = std::current_exception();
+      }
+      std::lock_guard<std::mutex> lk(mutex);
+      if (++done == items.size())
+        work_done.notify_all();
+    }
+  }
+};
+
+} // detail
+
+/**
+ * Call a function on every element of a range concurrently
+ *
+ * The elements are processed by the shared fork/join workers and by
+ * the calling thread, which returns when all elements are done.
+ * Because the caller takes part, fork_join never waits on a busy
+ * pool and can be called from a task or during static destruction.
+ *
+ * @param range
+ *   Any range with std::begin and std::end, e.g. a vector of devices
+ * @param f
+ *   Function called with each element of range
+ * @return
+ *   One exception per element in range order, nullptr for each
+ *   element where f returned normally
+ */
+template <typename Range, typename F>
+std::vector<std::exception_ptr>
+fork_join(Range&& range, F&& f)
+{
+  using iterator = decltype(std::begin(range));
+  using fn_type = typename std::remove_reference<F>::type;
+  auto state = std::make_shared<detail::fork_join_state<iterator,fn_type>>();
+  for (auto itr=std::begin(range), end=std::end(range); itr!=end; ++itr)
+    state->items.push_back(itr);
+  state->errors.resize(state->items.size());
+  state->fn = &f;
+
+  if (state->items.size() > 1) {
+    if (auto q = shared_queue()) {
+      // helpers that start after all items are claimed simply return
+      for (size_t helper=1; helper<state->items.size(); ++helper)
+        q->addWork(task([state] { state->run(); }));
+    }
+  }
+
+  state->run();
+
+  std::unique_lock<std::mutex> lk(state->mutex);
+  while (state->done < state->items.size())
+    state->work_done.wait(lk);
+  return std::move(state->errors);
+}
+
+/**
+ * Call a function on every element of a range concurrently
+ *
+ * Same as fork_join, but rethrows the exception of the first failing
+ * element in range order once all elements are done.
+ */
+template <typename Range, typename F>
+void
+parallel_for(Range&& range, F&& f)
+{
+  for (auto& e : fork_join(std::forward<Range>(range),std::forward<F>(f)))
+    if (e)
+      std::rethrow_exception(e);
+}
 }} // task,xrt
 
 #endif
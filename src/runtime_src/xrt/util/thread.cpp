@@ -21,6 +21,9 @@
 
 #include <thread>
 #include <iostream>
+#include <fstream>
+#include <map>
+#include <mutex>
 
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/tokenizer.hpp>
@@ -132,6 +135,53 @@ set_cpu_affinity(std::thread& thread)
   }
 }
 
+// Parse /sys/devices/system/node/node<N>/cpulist, e.g. "0-7,16-23"
+static bool
+get_node_cpus(int node, cpu_set_t& cpuset)
+{
+  std::ifstream ifs("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+  std::string cpus;
+  if (!ifs || !std::getline(ifs,cpus))
+    return false;
+
+  CPU_ZERO(&cpuset);
+  using tokenizer=boost::tokenizer<boost::char_separator<char> >;
+  boost::char_separator<char> sep(", ");
+  for (auto& tok : tokenizer(cpus,sep)) {
+    auto dash = tok.find('-');
+    auto first = std::stoul(tok.substr(0,dash));
+    auto last = (dash==std::string::npos) ? first : std::stoul(tok.substr(dash+1));
+    for (auto cpu=first; cpu<=last && cpu<CPU_SETSIZE; ++cpu)
+      CPU_SET(cpu,&cpuset);
+  }
+  return CPU_COUNT(&cpuset) > 0;
+}
+
+static void
+set_numa_affinity(std::thread& thread, int node)
+{
+  static std::mutex mutex;
+  static std::map<int,std::pair<bool,cpu_set_t>> nodes;
+
+  std::lock_guard<std::mutex> lk(mutex);
+  auto itr = nodes.find(node);
+  if (itr==nodes.end()) {
+    cpu_set_t cpuset;
+    bool valid = get_node_cpus(node,cpuset);
+    if (!valid)
+      xrt::message::send(xrt::message::severity_level::WARNING,"Ignoring numa affinity since cpus of node #" + std::to_string(node) + " are unknown\n");
+    XRT_DEBUG(std::cout,"numa node #",node," has ",CPU_COUNT(&cpuset)," cpus\n");
+    itr = nodes.emplace(node,std::make_pair(valid,cpuset)).first;
+  }
+
+  if (!(*itr).second.first)
+    return;
+
+  if (pthread_setaffinity_np(thread.native_handle(),sizeof(cpu_set_t),&(*itr).second.second)) {
+    throw std::runtime_error("error calling pthread_setaffinity_np");
+  }
+}
+
 #else 
 
 static void
@@ -144,6 +194,11 @@ set_cpu_affinity(std::thread& thread)
 {
 }
 
+static void
+set_numa_affinity(std::thread& thread, int node)
+{
+}
+
 #endif
 
 } // platform_specific
@@ -166,6 +221,14 @@ void set_cpu_affinity(std::thread& thread)
 
 } // detail
 
+void
+set_numa_affinity(std::thread& thread, int node)
+{
+  if (node < 0 || !xrt::config::get_numa_thread_affinity())
+    return;
+  ::platform_specific::set_numa_affinity(thread,node);
+}
+
 } // xrt
 
 
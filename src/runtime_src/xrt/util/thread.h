@@ -40,6 +40,21 @@ set_cpu_affinity(std::thread& thread);
 
 }
 
+/**
+ * Pin a thread to the cpus of a NUMA node
+ *
+ * The thread is pinned only if sdaccel.ini enables it:
+ *  [Runtime]
+ *   numa_thread_affinity = true
+ *
+ * @param thread
+ *   Thread to pin
+ * @param node
+ *   NUMA node, nothing is done if node is negative
+ */
+void
+set_numa_affinity(std::thread& thread, int node);
+
 /**
  * Construct a thread and set policy according to sdaccel.ini
  * 
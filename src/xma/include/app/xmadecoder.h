@@ -257,6 +257,18 @@ typedef struct XmaDecoderProperties
 /* Forward declaration */
 typedef struct XmaDecoderSession XmaDecoderSession;
 
+/**
+ * @typedef XmaDecoderDataDone
+ * Called by the session worker once the plugin has taken a data buffer sent
+ * in asynchronous mode, with the data used and return code of the plugin
+ * send_data
+*/
+typedef void (*XmaDecoderDataDone)(XmaDecoderSession *session,
+                                   XmaDataBuffer     *data,
+                                   int32_t            data_used,
+                                   int32_t            rc,
+                                   void              *user_data);
+
 /**
  *  @brief Create an decoder session
  *
@@ -348,6 +360,34 @@ xma_dec_session_get_properties(XmaDecoderSession  *dec_session,
 int32_t
 xma_dec_session_recv_frame(XmaDecoderSession *session,
                            XmaFrame          *frame);
+
+/**
+ *  @brief Switch a decoder session to asynchronous sends
+ *
+ *  Once enabled, xma_dec_session_send_data queues the data buffer and
+ *  returns XMA_SUCCESS right away with data_used set to 0; it only blocks
+ *  when queue_depth buffers are outstanding.  A worker thread of the session
+ *  passes queued buffers to the plugin in order and calls done with the
+ *  amount of data used.  The buffer must remain valid until then.  Calls
+ *  into the plugin, including xma_dec_session_recv_frame, are serialized
+ *  with the worker.  Outstanding buffers complete when the session is
+ *  destroyed.
+ *
+ *  @param session     Pointer to session created by xma_dec_session_create
+ *  @param queue_depth Maximum number of buffers queued or being sent
+ *  @param done        Completion callback
+ *  @param user_data   Passed to done unchanged
+ *
+ *  @return        XMA_SUCCESS on success.
+ *  @return        XMA_ERROR on error or if already enabled.
+ *
+ *  @note Call once, before the first buffer is sent.
+*/
+int32_t
+xma_dec_session_set_async(XmaDecoderSession   *session,
+                          uint32_t             queue_depth,
+                          XmaDecoderDataDone   done,
+                          void                *user_data);
 /**
  * @}
  */
@@ -296,6 +296,16 @@ typedef struct XmaEncoderProperties
 /* Forward declaration */
 typedef struct XmaEncoderSession XmaEncoderSession;
 
+/**
+ * @typedef XmaEncoderFrameDone
+ * Called by the session worker once the plugin has taken a frame sent in
+ * asynchronous mode, with the return code of the plugin send_frame
+*/
+typedef void (*XmaEncoderFrameDone)(XmaEncoderSession *session,
+                                    XmaFrame          *frame,
+                                    int32_t            rc,
+                                    void              *user_data);
+
 /**
  *  @brief Create an encoder session
  *
@@ -381,6 +391,58 @@ int32_t
 xma_enc_session_recv_data(XmaEncoderSession *session,
                           XmaDataBuffer     *data,
                           int32_t           *data_size);
+
+/**
+ *  @brief Switch an encoder session to asynchronous sends
+ *
+ *  Once enabled, xma_enc_session_send_frame queues the frame and returns
+ *  XMA_SUCCESS right away; it only blocks when queue_depth frames are
+ *  outstanding.  A worker thread of the session passes queued frames to the
+ *  plugin in order and calls done for each of them.  The frame must remain
+ *  valid until then.  This lets the application prepare and upload the next
+ *  frames while the plugin processes the current one.  Calls into the
+ *  plugin, including xma_enc_session_recv_data, are serialized with the
+ *  worker.  Outstanding frames complete when the session is destroyed.
+ *
+ *  @param session     Pointer to session created by xma_enc_session_create
+ *  @param queue_depth Maximum number of frames queued or being sent
+ *  @param done        Completion callback
+ *  @param user_data   Passed to done unchanged
+ *
+ *  @return        XMA_SUCCESS on success.
+ *  @return        XMA_ERROR on error or if already enabled.
+ *
+ *  @note Call once, before the first frame is sent.
+*/
+int32_t
+xma_enc_session_set_async(XmaEncoderSession   *session,
+                          uint32_t             queue_depth,
+                          XmaEncoderFrameDone  done,
+                          void                *user_data);
+
+/**
+ *  @brief Move an encoder session to a less loaded device
+ *
+ *  Intended to be called periodically at GOP boundaries, once all encoded
+ *  data sent so far has been received.  If another device would carry less
+ *  load than the current one even with this session added, the plugin is
+ *  asked to quiesce, the session is moved to a kernel on that device and
+ *  the plugin is re-initialized there.  The encoded stream restarts with
+ *  a new GOP.  Devices shared by several processes are balanced through
+ *  the load of every session in the resource database.
+ *
+ *  @param session  Pointer to session created by xma_enc_session_create
+ *
+ *  @return        XMA_SUCCESS if the session was moved.
+ *  @return        XMA_ERROR_NO_DEV if no less loaded device was found.
+ *  @return        XMA_ERROR_INVALID if the plugin does not support it.
+ *  @return        XMA_ERROR if the session could not be resumed.
+ *  @return        Plugin quiesce error code if it declined.
+ *
+ *  @note Must be called from the thread that created the session.
+*/
+int32_t
+xma_enc_session_rebalance(XmaEncoderSession *session);
 /**
  * @}
  */
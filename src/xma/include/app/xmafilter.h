@@ -95,7 +95,7 @@ typedef struct XmaFilterProperties
     /* core filter properties */
     /** Specifying type of filter to reserve; @see XmaFilterType */
     XmaFilterType            hwfilter_type;
-    /** kernel receiving data from this filter */
+    /** kernel receiving data from this filter, zerocopy only to it if set */
     XmaSession              *destination;
     /** Vendor request for kernel session */
     char                     hwvendor_string[MAX_VENDOR_NAME];
@@ -51,6 +51,7 @@ extern "C" {
  *  @li @ref xma_scaler_session_create()
  *  @li @ref xma_scaler_session_destroy()
  *  @li @ref xma_scaler_session_send_frame()
+ *  @li @ref xma_scaler_session_send_frame_fanout()
  *  @li @ref xma_scaler_session_recv_frame_list()
  *
  *  A media framework (such as FFmpeg) is responsible for creating a scaler
@@ -319,7 +320,7 @@ typedef struct XmaScalerProperties
 {
     /** specific filter function requested */
     XmaScalerType             hwscaler_type;
-    /** downstream kernel receiving data from this filter */
+    /** downstream kernel receiving data, zerocopy only to it if set */
     XmaSession                *destination;
     /** maximum number of scaled outputs */
     uint32_t                  max_dest_cnt;
@@ -426,6 +427,34 @@ int32_t
 xma_scaler_session_send_frame(XmaScalerSession *session,
                               XmaFrame         *frame);
 
+/**
+ *  @brief Send one input frame to several scaler sessions
+ *
+ *  The frame is uploaded to device memory once, by the first session.
+ *  Every other session on the same device whose plugin supports it scales
+ *  from that device buffer; the remaining sessions upload the frame as
+ *  xma_scaler_session_send_frame() does.  Together with zerocopy
+ *  connections to encoders the rungs of an ABR ladder then never return
+ *  to host memory.  The sessions must receive their outputs of a frame
+ *  before the next frame is sent, as the first session reuses its input
+ *  buffer.
+ *
+ *  @param session_list Scaler sessions, the first one uploads the frame
+ *  @param num_sessions Number of sessions in session_list
+ *  @param frame        Frame to be scaled, as for
+ *      xma_scaler_session_send_frame()
+ *  @param rc_list      Receives the xma_scaler_session_send_frame() return
+ *      code of each session
+ *
+ *  @return        XMA_SUCCESS once the frame was sent to all sessions
+ *  @return        XMA_ERROR_INVALID on invalid arguments
+*/
+int32_t
+xma_scaler_session_send_frame_fanout(XmaScalerSession **session_list,
+                                     int32_t            num_sessions,
+                                     XmaFrame          *frame,
+                                     int32_t           *rc_list);
+
 /**
  *  @brief Receive one or more frames from the hardware accelerator
  *
@@ -29,6 +29,7 @@ typedef struct XmaSingleton
     XmaSystemCfg      systemcfg;
     XmaHwCfg          hwcfg;
     XmaConnect        connections[MAX_CONNECTION_ENTRIES];
+    XmaConnectIndex   conn_index;
     XmaLogger         logger;
     XmaDecoderPlugin  decodercfg[MAX_PLUGINS];
     XmaEncoderPlugin  encodercfg[MAX_PLUGINS];
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2018, Xilinx Inc - All rights reserved
+ * Xilinx SDAccel Media Accelerator API
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#ifndef _XMA_ASYNC_H_
+#define _XMA_ASYNC_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Queue of requests run in order by a worker thread of a session, see
+ * xma_enc_session_set_async() and xma_dec_session_set_async()
+*/
+typedef struct XmaAsyncQueue XmaAsyncQueue;
+
+/** Run a request, called by the worker with the plugin lock held */
+typedef int32_t (*XmaAsyncExec)(void *owner, void *req);
+
+/** Report a completed request, called by the worker unlocked */
+typedef void (*XmaAsyncComplete)(void *owner, void *req, int32_t rc);
+
+/**
+ *  @brief Create a request queue and start its worker
+ *
+ *  @param owner    Session passed to exec and complete
+ *  @param depth    Maximum number of requests queued or running
+ *
+ *  @return         Queue pointer on success
+ *  @return         NULL on failure
+*/
+XmaAsyncQueue*
+xma_async_create(void             *owner,
+                 uint32_t          depth,
+                 XmaAsyncExec      exec,
+                 XmaAsyncComplete  complete);
+
+/**
+ *  @brief Queue a request, blocks while depth requests are outstanding
+ *
+ *  @return         XMA_SUCCESS on success
+ *  @return         XMA_ERROR if the queue is being destroyed
+*/
+int32_t
+xma_async_submit(XmaAsyncQueue *queue, void *req);
+
+/**
+ *  @brief Wait until all queued requests have completed
+*/
+void
+xma_async_drain(XmaAsyncQueue *queue);
+
+/**
+ *  @brief Serialize a synchronous plugin call with the worker
+*/
+void
+xma_async_lock(XmaAsyncQueue *queue);
+
+void
+xma_async_unlock(XmaAsyncQueue *queue);
+
+/**
+ *  @brief Complete all queued requests, stop the worker and free the queue
+*/
+void
+xma_async_destroy(XmaAsyncQueue *queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -61,12 +61,31 @@ typedef struct XmaImageCfg
     XmaKernelCfg kernelcfg[MAX_KERNEL_CONFIGS];
 } XmaImageCfg;
 
+/**
+ * Policy for choosing among free kernels when creating a session
+ *
+ * XMA_ALLOC_FIRST_FIT takes the first kernel that accepts the session
+ * in device order.  The other policies order kernels by the load units
+ * reported by plugins for the sessions already running on them:
+ * XMA_ALLOC_LEAST_LOADED picks the least loaded kernel, XMA_ALLOC_SPREAD
+ * the least loaded device, XMA_ALLOC_PACK the most loaded device so
+ * idle devices stay idle.
+ */
+typedef enum XmaAllocPolicy
+{
+    XMA_ALLOC_FIRST_FIT = 0,
+    XMA_ALLOC_LEAST_LOADED,
+    XMA_ALLOC_SPREAD,
+    XMA_ALLOC_PACK
+} XmaAllocPolicy;
+
 typedef struct XmaSystemCfg
 {
     char        dsa[MAX_DSA_NAME];
     bool        logger_initialized;
     char        logfile[PATH_MAX];
     int32_t     loglevel;
+    XmaAllocPolicy alloc_policy;
     char        pluginpath[PATH_MAX];
     char        xclbinpath[PATH_MAX];
     int32_t     num_images;
@@ -17,6 +17,9 @@
 #ifndef _XMA_CONNECT_H_
 #define _XMA_CONNECT_H_
 
+#include <pthread.h>
+#include "lib/xmalimits.h"
+
 /**
  *  @file
  */
@@ -64,12 +67,14 @@ extern "C" {
  *  Second, the receiving component needs to be signalled when the frame has been
  *  written and is ready to be processed.
  *
- *  The XMA Connection Management API assumes that sessions are created in a
- *  specific order.  Specifically, if a pipeline comprised of a decoder, ABR scaler,
- *  and ABR encoder was requested, it is expected that these components are created
- *  in the same order (from input to output).  If the pipeline is created in the
- *  reverse order (from output to input), the connection manager will likely fall
- *  back to host copies versus "zerocopy".  In addition, if a component is placed
+ *  A pending connection may be created by either side, so sessions can be
+ *  created in any order and from multiple threads.  A sender connects to the
+ *  first compatible pending receiver on its device and vice versa.  When
+ *  several pipelines are created concurrently, a sender should name its
+ *  receiver through the "destination" session property.  The receiver session
+ *  must then be created first, and the sender only connects to it.  Pending
+ *  entries that name each other are preferred over any other compatible
+ *  entry.  In addition, if a component is placed
  *  between connectable XMA compoents that are not known to the XMA, unpredicatble
  *  results will occur since hardware buffers cannot be used by non-XMA components.
  *  If there is any doubt as to whether or not non-XMA components are in a pipeline,
@@ -123,6 +128,7 @@ typedef struct XmaEndpoint
     int32_t         bits_per_pixel;
     int32_t         width;
     int32_t         height;
+    XmaSession      *peer; /**< only connect to this session if not NULL */
 } XmaEndpoint;
 
 typedef struct XmaConnect
@@ -130,8 +136,29 @@ typedef struct XmaConnect
     XmaConnectState     state;
     XmaEndpoint        *sender;
     XmaEndpoint        *receiver;
+    int32_t             next; /**< next entry in free or device pending list */
 } XmaConnect;
 
+/**
+ * Lookup state of the connection table, entries waiting for a peer are
+ * linked per device so matching does not scan the whole table
+*/
+typedef struct XmaConnectIndex
+{
+    pthread_mutex_t     lock; /**< guards connection table and index */
+    int32_t             free_head; /**< first unused entry, -1 if none */
+    int32_t             pending[MAX_XILINX_DEVICES]; /**< first pending entry */
+} XmaConnectIndex;
+
+/**
+ *  @brief Initialize the XMA connection table
+ *
+ *  This function is called internally by the XMA framework once during
+ *  initialization, before any session is created.
+*/
+void
+xma_connect_init(void);
+
 /**
  *  @brief Allocate an XMA connection
  *
@@ -151,6 +178,11 @@ typedef struct XmaConnect
  *
  *  @param type    Type of connection to allocate sender or receiver
  *
+ *  A pending entry of the opposite type that is compatible with the endpoint
+ *  is connected instead of creating a new entry.  Endpoints specifying a peer
+ *  only connect with endpoints of that session.  The endpoint is owned by
+ *  the connection table from then on and freed if no entry was created.
+ *
  *  @return        Connection handle
  *                 -1 indicates a connection entry could not be
  *                    created
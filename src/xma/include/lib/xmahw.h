@@ -127,6 +127,25 @@ bool xma_hw_is_compatible(XmaHwCfg *hwcfg, XmaSystemCfg *systemcfg);
  */
 bool xma_hw_configure(XmaHwCfg *hwcfg, XmaSystemCfg *systemcfg, bool hw_cfg_status);
 
+/**
+ *  @brief Open devices already configured by another process
+ *
+ *  This function is used instead of @ref xma_hw_probe() and
+ *  @ref xma_hw_configure() when the XmaHwCfg was populated from
+ *  the resource database.  Only devices referenced by the system
+ *  configuration are opened and the xclbin files are not read.
+ *
+ *  @param hwcfg     Pointer to an XmaHwCfg structure holding the
+ *                   configuration of the devices.  Device handles
+ *                   are set on success.
+ *  @param systemcfg Pointer to the XmaSystemCfg the devices were
+ *                   configured with.
+ *
+ *  @return          0 on success
+ *                  -1 on failure
+ */
+int xma_hw_attach(XmaHwCfg *hwcfg, XmaSystemCfg *systemcfg);
+
 /**
  *  @}
  */
@@ -26,6 +26,7 @@ typedef struct XmaHwInterface
     bool    (*is_compatible)(XmaHwCfg *hwcfg, XmaSystemCfg *systemcfg);
     bool    (*configure)(XmaHwCfg *hwcfg, XmaSystemCfg *systemcfg,
                          bool hw_cfg_status);
+    int32_t (*attach)(XmaHwCfg *hwcfg, XmaSystemCfg *systemcfg);
 } XmaHwInterface;
 
 #endif
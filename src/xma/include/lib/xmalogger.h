@@ -49,15 +49,18 @@ void xma_thread_start(XmaThread *thread);
 bool xma_thread_is_running(XmaThread *thread);
 void xma_thread_join(XmaThread *thread);
 
-/* Data structure for XmaMsgQ */
+/* Data structure for XmaMsgQ, a lock-free ring with any number of
+ * producers and a single consumer. Each slot sequence tells whether it
+ * is free for the producer at that position or filled for the consumer. */
 typedef struct XmaMsgQ
 {
     uint8_t     *msg_array;
+    size_t      *msg_seq;
     size_t       msg_size;
     size_t       max_msg_entries;
-    int32_t      num_entries;
-    int32_t      front;
-    int32_t      back;
+    size_t       enqueue_pos;
+    size_t       dequeue_pos;
+    uint64_t     dropped; /* messages rejected because the ring was full */
 } XmaMsgQ;
 
 /* XmaMsgQ APIs */
@@ -72,6 +75,7 @@ bool xma_msgq_isfull(XmaMsgQ *msgq);
 bool xma_msgq_isempty(XmaMsgQ *msgq);
 int32_t xma_msgq_enqueue(XmaMsgQ *msgq, void *msg, size_t size);
 int32_t xma_msgq_dequeue(XmaMsgQ *msgq, void *msg, size_t size);
+uint64_t xma_msgq_take_dropped(XmaMsgQ *msgq);
 
 struct XmaActor;
 
@@ -80,9 +84,10 @@ typedef struct XmaActor
 {
     XmaThread          *thread;
     XmaMsgQ            *msg_q;
+    /* only used to park the actor while the queue is empty */
     pthread_mutex_t     lock;
     pthread_cond_t      queued_cond;
-    pthread_cond_t      dequeued_cond;
+    int32_t             waiting;
 } XmaActor;
 
 /* XmaActor APIs */
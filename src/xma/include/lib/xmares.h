@@ -35,6 +35,7 @@ extern char* XMA_SHM_FILE;
 extern char* XMA_SHM_FILE_SIG;
 #endif
 typedef struct XmaSession XmaSession;
+struct XmaHwCfg;
 
 /**
  * @brief opaque object representing data stored in shared memory
@@ -161,6 +162,36 @@ int32_t xma_res_free_dev(XmaResources shm_cfg, int32_t dev_handle);
 int32_t xma_res_free_kernel(XmaResources shm_cfg,
                             XmaKernelRes kern_res);
 
+/**
+ * @brief check whether a session could move to a less loaded device
+ *
+ * A device qualifies when its load plus the load of the session stays below
+ * the load of the device the session currently runs on.
+ *
+ * @param shm_cfg shared memory pointer
+ * @param session session holding a kernel resource
+ *
+ * @returns 0 if a device qualifies, XMA_ERROR_NO_DEV if none does or
+ * error code otherwise
+*/
+int32_t xma_res_rebalance_check(XmaResources shm_cfg, XmaSession *session);
+
+/**
+ * @brief move a session to a kernel on a less loaded device
+ *
+ * The new kernel is aquired before the current one is released so the
+ * session keeps its resources if no device qualifies.  Must be called by
+ * the thread that allocated the session and only once the plugin has
+ * released the current kernel.
+ *
+ * @param shm_cfg shared memory pointer
+ * @param session session holding a kernel resource
+ *
+ * @returns 0 with session kern_res updated, XMA_ERROR_NO_DEV if no device
+ * qualifies or error code otherwise
+*/
+int32_t xma_res_rebalance_kernel(XmaResources shm_cfg, XmaSession *session);
+
 /**
  * @brief retrieve the dev handle associated with this resource
  *
@@ -246,4 +277,34 @@ void xma_res_mark_xma_ready(XmaResources shm_cfg);
  * @returns true if init is already complete, false otherwise
 */
 bool xma_res_xma_init_completed(void);
+
+/**
+ * @brief Look up the configuration cached by the process that configured
+ * the hardware
+ *
+ * The cache is used only while the configuration file keeps the path,
+ * modification time and size it had when the cache was stored.
+ *
+ * @param cfgfile path of the YAML system configuration file
+ * @param config receives the parsed system configuration
+ * @param hwcfg receives the device kernel table, device handles are NULL
+ *
+ * @returns true on a cache hit, false otherwise
+*/
+bool xma_res_cfg_cache_get(const char *cfgfile,
+                           struct XmaSystemCfg *config,
+                           struct XmaHwCfg *hwcfg);
+
+/**
+ * @brief Store the parsed configuration for later processes
+ *
+ * @param shm_cfg shared memory pointer
+ * @param cfgfile path of the YAML system configuration file
+ * @param config parsed system configuration
+ * @param hwcfg configured device kernel table
+ * @returns none
+*/
+void xma_res_cfg_cache_put(XmaResources shm_cfg, const char *cfgfile,
+                           struct XmaSystemCfg *config,
+                           struct XmaHwCfg *hwcfg);
 #endif
@@ -37,7 +37,8 @@ typedef struct XmaXclbinInfo
     XmaIpLayout ip_layout[MAX_KERNEL_CONFIGS];
 } XmaXclbinInfo;
 
-char *xma_xclbin_file_open(const char *xclbin_name);
+char *xma_xclbin_file_open(const char *xclbin_name, size_t *size);
+void xma_xclbin_file_close(char *buffer, size_t size);
 int xma_xclbin_info_get(char *buffer, XmaXclbinInfo *info);
 
 #endif
@@ -24,6 +24,7 @@
  */
 
 #include "xma.h"
+#include "lib/xmaasync.h"
 #include "plg/xmasess.h"
 
 #ifdef __cplusplus
@@ -77,6 +78,10 @@ typedef struct XmaDecoderPlugin
                                   XmaFrame           *frame);
     /** Callback invoked to clean up device buffers when app has terminated session */
     int32_t         (*close)(XmaDecoderSession *session);
+    /** Optional callback returning the load units of a pending session,
+        e.g. pixels per second, used by load balancing alloc_policy.
+        Sessions count as one unit if not provided */
+    uint64_t        (*get_load)(XmaSession *pending_sess);
 } XmaDecoderPlugin;
 
 /**
@@ -90,6 +95,9 @@ typedef struct XmaDecoderSession
     XmaDecoderProperties  decoder_props; /**< session decoder properties */
     XmaDecoderPlugin     *decoder_plugin; /**< pointer to plugin instance */
     int32_t               conn_recv_handle; /**< connection handle to encoder */
+    XmaAsyncQueue        *async; /**< send worker, NULL unless async mode */
+    XmaDecoderDataDone    async_done; /**< async send completion callback */
+    void                 *async_data; /**< user data of async_done */
 } XmaDecoderSession;
 
 /**
@@ -24,6 +24,7 @@
  */
 
 #include "xma.h"
+#include "lib/xmaasync.h"
 #include "plg/xmasess.h"
 
 #ifdef __cplusplus
@@ -101,6 +102,16 @@ typedef struct XmaEncoderPlugin
                                   uint32_t sess_cnt);
     /** Callback called if this encoder supports zerocopy */
     uint64_t        (*get_dev_input_paddr)(XmaEncoderSession *enc_session);
+    /** Optional callback returning the load units of a pending session,
+        e.g. pixels per second, used by load balancing alloc_policy.
+        Sessions count as one unit if not provided */
+    uint64_t        (*get_load)(XmaSession *pending_sess);
+    /** Optional callback called when app calls xma_enc_session_rebalance().
+        Returns 0 if no frame is in flight and the next frame starts a new
+        GOP, the session is then closed and re-initialized, possibly on
+        another kernel.  Any other value leaves the session untouched.
+        Sessions without it are never moved */
+    int32_t         (*quiesce)(XmaEncoderSession *session);
 } XmaEncoderPlugin;
 
 /**
@@ -117,6 +128,9 @@ typedef struct XmaEncoderSession
     XmaEncoderPlugin     *encoder_plugin; /**< link to XMA encoder plugin */
     /** index into connection table (requires zerocopy: enable in cfg)  */
     int32_t               conn_recv_handle;
+    XmaAsyncQueue        *async; /**< send worker, NULL unless async mode */
+    XmaEncoderFrameDone   async_done; /**< async send completion callback */
+    void                 *async_data; /**< user data of async_done */
 } XmaEncoderSession;
 
 /**
@@ -70,6 +70,10 @@ typedef struct XmaFilterPlugin
     int32_t         (*alloc_chan)(XmaSession *pending_sess,
                                   XmaSession **curr_sess,
                                   uint32_t sess_cnt);
+    /** Optional callback returning the load units of a pending session,
+        e.g. pixels per second, used by load balancing alloc_policy.
+        Sessions count as one unit if not provided */
+    uint64_t        (*get_load)(XmaSession *pending_sess);
 } XmaFilterPlugin;
 
 /**
@@ -64,6 +64,10 @@ typedef struct XmaKernelPlugin
                             int32_t            *param_cnt);
     /** close callback used to preform cleanup when application terminates session*/
     int32_t         (*close)(XmaKernelSession *session);
+    /** Optional callback returning the load units of a pending session,
+        e.g. pixels per second, used by load balancing alloc_policy.
+        Sessions count as one unit if not provided */
+    uint64_t        (*get_load)(XmaSession *pending_sess);
 } XmaKernelPlugin;
 
 /**
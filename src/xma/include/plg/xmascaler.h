@@ -74,6 +74,15 @@ typedef struct XmaScalerPlugin
     int32_t         (*alloc_chan)(XmaSession *pending_sess,
                                   XmaSession **curr_sess,
                                   uint32_t sess_cnt);
+    /** Optional callback returning the load units of a pending session,
+        e.g. pixels per second, used by load balancing alloc_policy.
+        Sessions count as one unit if not provided */
+    uint64_t        (*get_load)(XmaSession *pending_sess);
+    /** Optional callback returning the device address of the input frame
+        uploaded by the last send_frame.  Plugins providing it must scale
+        from XmaScalerSession::in_dev_addr instead of uploading the frame
+        whenever it is set */
+    uint64_t        (*get_dev_input_paddr)(XmaScalerSession *session);
 } XmaScalerPlugin;
 
 /**
@@ -89,6 +98,7 @@ typedef struct XmaScalerSession
     int32_t               conn_send_handles[MAX_SCALER_OUTPUTS]; /**< handle to downstream kernels*/
     uint64_t              out_dev_addrs[MAX_SCALER_OUTPUTS]; /**< paddrs to write scaled outputs */
     bool                  zerocopy_dests[MAX_SCALER_OUTPUTS]; /**< map of downstream connections supporting zerocopy */
+    uint64_t              in_dev_addr; /**< paddr of input already on device, 0 to upload frame */
     int8_t                current_pipe; /**< current_pipe */
     int8_t                first_frame; /**< first_frame */
 
@@ -370,12 +370,14 @@ int32_t xma_initialize(char *cfgfile);
  * [SystemCfg]    ::= SystemCfg:CRLF
  *                    (HTAB[logifile]CRLF)*
  *                    (HTAB[loglevel]CRLF)*
+ *                    (HTAB[alloc_policy]CRLF)*
  *                    HTAB[dsa]CRLF
                       HTAB[pluginpath]CRLF
  *                    HTAB[xclbinpath]CRLF
  *                    (HTAB[ImageCfg])+
  * [logfile]      ::= logfile:[filepath]
  * [loglevel]     ::= loglevel:[0 | 1 | 2| 3]
+ * [alloc_policy] ::= alloc_policy:(first_fit | least_loaded | spread | pack)
  * [dsa]          ::= dsa:[name_string]
  * [pluginpath]   ::= pluginpath:[filepath]
  * [xclbinpath]   ::= xclbinpath:[filepath]
@@ -411,6 +413,12 @@ int32_t xma_initialize(char *cfgfile);
  *     specified or lower will be output to the specified logfile.  The level mapping
  *     is as follows: 0 = CRITICAL, 1 = ERROR, 2 = INFO, 3 = DEBUG.
  *     For more information regarding the logging capability see @ref xmalog.
+ * @param alloc_policy Optional property of SystemCfg; specifies how a kernel is
+ *     chosen for a new session.  first_fit (default) takes the first kernel that
+ *     accepts the session in device order.  least_loaded takes the kernel with
+ *     the lowest load, spread the device with the lowest load and pack the
+ *     device with the highest load, leaving idle devices idle.  Load is the sum
+ *     of units reported by the plugin get_load() callback for each session.
  * @param dsa        Property of SystemCfg; The name of the "Dynamic System Archive"
  *     used for all images.
  * @param pluginpath Property of SystemCfg; The path to directory containing all
@@ -96,6 +96,85 @@ XmaBufferHandle xma_plg_buffer_alloc(XmaHwSession s_handle, size_t size);
  */
 void xma_plg_buffer_free(XmaHwSession s_handle, XmaBufferHandle b_handle);
 
+typedef struct XmaBufferPool XmaBufferPool;
+
+/**
+ *  @brief Create a pool of recycled device buffers
+ *
+ *  Plugins that need a device buffer per frame should take them from a
+ *  pool rather than calling @ref xma_plg_buffer_alloc() and
+ *  @ref xma_plg_buffer_free() for each frame.  Buffers returned to the pool
+ *  are kept allocated and handed out again, so a pipeline in steady state
+ *  does not allocate device memory.  All buffers of a pool have the same
+ *  size and are allocated on the DDR bank of the session.  A pool may be
+ *  used from multiple threads.
+ *
+ *  @param s_handle  The session handle associated with this plugin instance
+ *  @param size      Size in bytes of each device buffer
+ *  @param max_free  Number of unused buffers kept for reuse, buffers
+ *                   returned beyond that are freed
+ *
+ *  @return          Pool pointer on success
+ *  @return          NULL on failure
+ *
+ */
+XmaBufferPool *xma_plg_buffer_pool_create(XmaHwSession s_handle,
+                                          size_t       size,
+                                          uint32_t     max_free);
+
+/**
+ *  @brief Get a device buffer from a pool
+ *
+ *  Returns an unused buffer of the pool, allocating a new one only if none
+ *  is available.  The buffer holds a single reference.
+ *
+ *  @param pool      Pool created with @ref xma_plg_buffer_pool_create()
+ *
+ *  @return          Buffer handle, same as @ref xma_plg_buffer_alloc()
+ *
+ */
+XmaBufferHandle xma_plg_buffer_pool_get(XmaBufferPool *pool);
+
+/**
+ *  @brief Add a reference to a device buffer of a pool
+ *
+ *  Used when a buffer is shared, e.g. handed to a downstream kernel, so it
+ *  is only recycled once every holder has called
+ *  @ref xma_plg_buffer_pool_put().
+ *
+ *  @param pool      Pool the buffer was obtained from
+ *  @param b_handle  The buffer handle returned from
+ *                   @ref xma_plg_buffer_pool_get()
+ *
+ *  @return          XMA_SUCCESS on success
+ *  @return          XMA_ERROR if the buffer is not in use in the pool
+ *
+ */
+int32_t xma_plg_buffer_pool_ref(XmaBufferPool *pool, XmaBufferHandle b_handle);
+
+/**
+ *  @brief Release a reference to a device buffer of a pool
+ *
+ *  Once the last reference is released the buffer is kept for reuse.
+ *
+ *  @param pool      Pool the buffer was obtained from
+ *  @param b_handle  The buffer handle returned from
+ *                   @ref xma_plg_buffer_pool_get()
+ *
+ */
+void xma_plg_buffer_pool_put(XmaBufferPool *pool, XmaBufferHandle b_handle);
+
+/**
+ *  @brief Destroy a pool of device buffers
+ *
+ *  Frees all buffers of the pool including the ones still in use, so it
+ *  should be called once the kernel no longer accesses them.
+ *
+ *  @param pool      Pool created with @ref xma_plg_buffer_pool_create()
+ *
+ */
+void xma_plg_buffer_pool_destroy(XmaBufferPool *pool);
+
 /**
  *  @brief Get a physical address for a buffer handle
  *
@@ -201,6 +280,73 @@ int32_t xma_plg_register_read(XmaHwSession     s_handle,
                               size_t           size,
                               size_t           offset);
 
+typedef struct XmaRegisterBatch XmaRegisterBatch;
+
+/**
+ *  @brief Create a staging image of a kernel register map
+ *
+ *  Plugins programming many registers per frame should stage them with
+ *  @ref xma_plg_register_batch_write() and submit them together with
+ *  @ref xma_plg_register_batch_flush().  Registers written since the last
+ *  flush that are adjacent are written with a single call into the driver,
+ *  so a contiguous block of arguments costs one operation.  Registers that
+ *  were not staged are never written, so status and control registers
+ *  between staged ones are left untouched.
+ *
+ *  @param s_handle  The session handle associated with this plugin instance
+ *  @param map_size  Size in bytes of the AXI_Lite register map, a multiple
+ *                   of 4
+ *
+ *  @return          Batch pointer on success
+ *  @return          NULL on failure
+ *
+ */
+XmaRegisterBatch *xma_plg_register_batch_create(XmaHwSession s_handle,
+                                                size_t       map_size);
+
+/**
+ *  @brief Stage register value(s) for the next flush
+ *
+ *  Staging a register again before the flush replaces its value.
+ *
+ *  @param batch     Batch created with @ref xma_plg_register_batch_create()
+ *  @param src       Source data pointer
+ *  @param size      Size of data to stage, a multiple of 4
+ *  @param offset    Offset from the beginning of the kernel AXI_Lite
+ *                   register map, a multiple of 4
+ *
+ *  @return          XMA_SUCCESS on success
+ *  @return          XMA_ERROR if the range is unaligned or outside the map
+ *
+ */
+int32_t xma_plg_register_batch_write(XmaRegisterBatch *batch,
+                                     const void       *src,
+                                     size_t            size,
+                                     size_t            offset);
+
+/**
+ *  @brief Write all staged registers to the kernel
+ *
+ *  Runs of adjacent staged registers are written in ascending offset order,
+ *  one driver call per run.  A register that starts the kernel should be
+ *  written separately with @ref xma_plg_register_write() after the flush.
+ *
+ *  @param batch     Batch created with @ref xma_plg_register_batch_create()
+ *
+ *  @return          >=0 number of bytes written
+ *  @return          <0 on failure
+ *
+ */
+int32_t xma_plg_register_batch_flush(XmaRegisterBatch *batch);
+
+/**
+ *  @brief Free a register batch, staged registers are discarded
+ *
+ *  @param batch     Batch created with @ref xma_plg_register_batch_create()
+ *
+ */
+void xma_plg_register_batch_destroy(XmaRegisterBatch *batch);
+
 /**
  *  @brief Dump kernel registers
  *
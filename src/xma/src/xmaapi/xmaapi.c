@@ -33,32 +33,49 @@ XmaSingleton *g_xma_singleton;
 int32_t xma_initialize(char *cfgfile)
 {
     int32_t ret;
-    bool    rc;
+    bool    rc, cached, hw_configured;
 
     if (!cfgfile)
         cfgfile = XMA_CFG_DEFAULT;
 
     g_xma_singleton = malloc(sizeof(*g_xma_singleton));
     memset(g_xma_singleton, 0, sizeof(*g_xma_singleton));
-
-    ret = xma_cfg_parse(cfgfile, &g_xma_singleton->systemcfg);
-    if (ret != XMA_SUCCESS)
-        return ret;
+    xma_connect_init();
+
+    // Processes started after the hardware was configured reuse the
+    // parsed configuration and kernel table kept in the resource database
+    cached = xma_res_cfg_cache_get(cfgfile, &g_xma_singleton->systemcfg,
+                                   &g_xma_singleton->hwcfg);
+    if (!cached) {
+        ret = xma_cfg_parse(cfgfile, &g_xma_singleton->systemcfg);
+        if (ret != XMA_SUCCESS)
+            return ret;
+    }
 
     ret = xma_logger_init(&g_xma_singleton->logger);
     if (ret != XMA_SUCCESS)
         return ret;
 
-    xma_logmsg(XMA_INFO_LOG, XMAAPI_MOD, "Probing hardware\n");
-    ret = xma_hw_probe(&g_xma_singleton->hwcfg);
-    if (ret != XMA_SUCCESS)
-        return ret;
-
-    xma_logmsg(XMA_INFO_LOG, XMAAPI_MOD, "Checking hardware compatibility\n");
-    rc = xma_hw_is_compatible(&g_xma_singleton->hwcfg,
-                              &g_xma_singleton->systemcfg);
-    if (!rc)
-        return XMA_ERROR_INVALID;
+    if (cached) {
+        xma_logmsg(XMA_INFO_LOG, XMAAPI_MOD,
+                   "Attaching to configured hardware\n");
+        ret = xma_hw_attach(&g_xma_singleton->hwcfg,
+                            &g_xma_singleton->systemcfg);
+        if (ret != XMA_SUCCESS)
+            return ret;
+    } else {
+        xma_logmsg(XMA_INFO_LOG, XMAAPI_MOD, "Probing hardware\n");
+        ret = xma_hw_probe(&g_xma_singleton->hwcfg);
+        if (ret != XMA_SUCCESS)
+            return ret;
+
+        xma_logmsg(XMA_INFO_LOG, XMAAPI_MOD,
+                   "Checking hardware compatibility\n");
+        rc = xma_hw_is_compatible(&g_xma_singleton->hwcfg,
+                                  &g_xma_singleton->systemcfg);
+        if (!rc)
+            return XMA_ERROR_INVALID;
+    }
 
     xma_logmsg(XMA_INFO_LOG, XMAAPI_MOD,
                "Creating resource shared mem database\n");
@@ -67,12 +84,16 @@ int32_t xma_initialize(char *cfgfile)
     if (!g_xma_singleton->shm_res_cfg)
         return XMA_ERROR;
  
-    xma_logmsg(XMA_INFO_LOG, XMAAPI_MOD, "Configure hardware\n");
-    rc = xma_hw_configure(&g_xma_singleton->hwcfg,
-                          &g_xma_singleton->systemcfg,
-                          xma_res_xma_init_completed());
-    if (!rc)
-        goto error;
+    // The database may have been reset since the cache was read
+    hw_configured = xma_res_xma_init_completed();
+    if (!cached || !hw_configured) {
+        xma_logmsg(XMA_INFO_LOG, XMAAPI_MOD, "Configure hardware\n");
+        rc = xma_hw_configure(&g_xma_singleton->hwcfg,
+                              &g_xma_singleton->systemcfg,
+                              hw_configured);
+        if (!rc)
+            goto error;
+    }
 
     xma_logmsg(XMA_INFO_LOG, XMAAPI_MOD, "Load scaler plugins\n");
     ret = xma_scaler_plugins_load(&g_xma_singleton->systemcfg,
@@ -115,6 +136,10 @@ int32_t xma_initialize(char *cfgfile)
         goto error;
 
     xma_init_sighandlers();
+    if (!cached || !hw_configured)
+        xma_res_cfg_cache_put(g_xma_singleton->shm_res_cfg, cfgfile,
+                              &g_xma_singleton->systemcfg,
+                              &g_xma_singleton->hwcfg);
     xma_res_mark_xma_ready(g_xma_singleton->shm_res_cfg);
 
     return XMA_SUCCESS;
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2018, Xilinx Inc - All rights reserved
+ * Xilinx SDAccel Media Accelerator API
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "app/xmaerror.h"
+#include "app/xmalogger.h"
+#include "lib/xmaasync.h"
+
+#define XMA_ASYNC_MOD "xmaasync"
+
+struct XmaAsyncQueue
+{
+    void               *owner;
+    XmaAsyncExec        exec;
+    XmaAsyncComplete    complete;
+    pthread_t           worker;
+    pthread_mutex_t     lock; /**< guards ring state below */
+    pthread_cond_t      changed; /**< request queued or completed */
+    pthread_mutex_t     plugin_lock; /**< plugin is never called concurrently */
+    void              **reqs; /**< ring of depth requests */
+    uint32_t            depth;
+    uint32_t            head; /**< oldest request, running if busy */
+    uint32_t            count; /**< queued and running requests */
+    bool                stop;
+};
+
+static void*
+xma_async_worker(void *arg)
+{
+    XmaAsyncQueue *queue = arg;
+
+    pthread_mutex_lock(&queue->lock);
+    for (;;)
+    {
+        void *req;
+        int32_t rc;
+
+        while (!queue->count && !queue->stop)
+            pthread_cond_wait(&queue->changed, &queue->lock);
+        if (!queue->count)
+            break;
+
+        // Request stays counted while it runs so submit keeps the bound
+        req = queue->reqs[queue->head];
+        pthread_mutex_unlock(&queue->lock);
+
+        pthread_mutex_lock(&queue->plugin_lock);
+        rc = queue->exec(queue->owner, req);
+        pthread_mutex_unlock(&queue->plugin_lock);
+        queue->complete(queue->owner, req, rc);
+
+        pthread_mutex_lock(&queue->lock);
+        queue->head = (queue->head + 1) % queue->depth;
+        queue->count--;
+        pthread_cond_broadcast(&queue->changed);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
+XmaAsyncQueue*
+xma_async_create(void             *owner,
+                 uint32_t          depth,
+                 XmaAsyncExec      exec,
+                 XmaAsyncComplete  complete)
+{
+    XmaAsyncQueue *queue;
+
+    xma_logmsg(XMA_DEBUG_LOG, XMA_ASYNC_MOD, "%s() depth %u\n",
+               __func__, depth);
+    if (!depth || !exec || !complete)
+        return NULL;
+
+    queue = malloc(sizeof(XmaAsyncQueue));
+    if (!queue)
+        return NULL;
+    memset(queue, 0, sizeof(XmaAsyncQueue));
+    queue->reqs = malloc(depth * sizeof(void *));
+    if (!queue->reqs) {
+        free(queue);
+        return NULL;
+    }
+    queue->owner = owner;
+    queue->exec = exec;
+    queue->complete = complete;
+    queue->depth = depth;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_mutex_init(&queue->plugin_lock, NULL);
+    pthread_cond_init(&queue->changed, NULL);
+
+    if (pthread_create(&queue->worker, NULL, xma_async_worker, queue)) {
+        xma_logmsg(XMA_ERROR_LOG, XMA_ASYNC_MOD,
+                   "Unable to start session worker thread\n");
+        pthread_cond_destroy(&queue->changed);
+        pthread_mutex_destroy(&queue->plugin_lock);
+        pthread_mutex_destroy(&queue->lock);
+        free(queue->reqs);
+        free(queue);
+        return NULL;
+    }
+    return queue;
+}
+
+int32_t
+xma_async_submit(XmaAsyncQueue *queue, void *req)
+{
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == queue->depth && !queue->stop)
+        pthread_cond_wait(&queue->changed, &queue->lock);
+    if (queue->stop) {
+        pthread_mutex_unlock(&queue->lock);
+        return XMA_ERROR;
+    }
+    queue->reqs[(queue->head + queue->count) % queue->depth] = req;
+    queue->count++;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+    return XMA_SUCCESS;
+}
+
+void
+xma_async_drain(XmaAsyncQueue *queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count)
+        pthread_cond_wait(&queue->changed, &queue->lock);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+void
+xma_async_lock(XmaAsyncQueue *queue)
+{
+    pthread_mutex_lock(&queue->plugin_lock);
+}
+
+void
+xma_async_unlock(XmaAsyncQueue *queue)
+{
+    pthread_mutex_unlock(&queue->plugin_lock);
+}
+
+void
+xma_async_destroy(XmaAsyncQueue *queue)
+{
+    if (!queue)
+        return;
+
+    // Queued requests still run, the worker exits once the ring is empty
+    pthread_mutex_lock(&queue->lock);
+    queue->stop = true;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+    pthread_join(queue->worker, NULL);
+
+    pthread_cond_destroy(&queue->changed);
+    pthread_mutex_destroy(&queue->plugin_lock);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue->reqs);
+    free(queue);
+}
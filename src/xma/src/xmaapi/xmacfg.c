@@ -41,6 +41,7 @@ static int validate_node_key(char *key, yaml_node_t *node, int key_no);
 static int check_systemcfg(XmaData *data);
 static int set_logfile(XmaData *data);
 static int set_loglevel(XmaData *data);
+static int set_alloc_policy(XmaData *data);
 static int set_dsa(XmaData *data);
 static int set_pluginpath(XmaData *data);
 static int set_xclbinpath(XmaData *data);
@@ -81,6 +82,7 @@ static XmaSystemCfgSM systemcfg_sm[] = {
 { "SystemCfg",     &check_systemcfg,   true },
 { "logfile",       &set_logfile,       false },
 { "loglevel",      &set_loglevel,      false },
+{ "alloc_policy",  &set_alloc_policy,  false },
 { "dsa",           &set_dsa,           true },
 { "pluginpath",    &set_pluginpath,    true },
 { "xclbinpath",    &set_xclbinpath,    true },
@@ -132,6 +134,31 @@ int set_loglevel(XmaData *data)
     return XMA_SUCCESS;
 }
 
+int set_alloc_policy(XmaData *data)
+{
+    yaml_node_t *next_node;
+    const char  *policy;
+
+    next_node = get_next_scalar_node(data->document, &data->node_idx);
+    policy = (const char*)next_node->data.scalar.value;
+    if (strcmp(policy, "first_fit") == 0)
+        data->systemcfg->alloc_policy = XMA_ALLOC_FIRST_FIT;
+    else if (strcmp(policy, "least_loaded") == 0)
+        data->systemcfg->alloc_policy = XMA_ALLOC_LEAST_LOADED;
+    else if (strcmp(policy, "spread") == 0)
+        data->systemcfg->alloc_policy = XMA_ALLOC_SPREAD;
+    else if (strcmp(policy, "pack") == 0)
+        data->systemcfg->alloc_policy = XMA_ALLOC_PACK;
+    else
+    {
+        xma_cfg_log_err("Unknown alloc_policy %s\n", policy);
+        return XMA_ERROR;
+    }
+    data->state_idx++;
+
+    return XMA_SUCCESS;
+}
+
 int set_dsa(XmaData *data)
 {
     yaml_node_t *next_node;
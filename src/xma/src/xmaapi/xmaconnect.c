@@ -19,11 +19,14 @@
 #include <stdlib.h>
 #include "app/xmabuffers.h"
 #include "app/xmaerror.h"
+#include "app/xmalogger.h"
 #include "lib/xmaapi.h"
 #include "lib/xmacfg.h"
 #include "lib/xmaconnect.h"
 #include "lib/xmahw.h"
 
+#define XMA_CONNECT_MOD "xmaconnect"
+
 extern XmaSingleton *g_xma_singleton;
 
 // Helper functions
@@ -34,61 +37,132 @@ bool
 is_connect_compatible(XmaEndpoint *endpt1,
                       XmaEndpoint *endpt2);
 
+static bool
+is_connect_peer(XmaEndpoint *endpt1,
+                XmaEndpoint *endpt2);
+
+void
+xma_connect_init(void)
+{
+    XmaConnect *conntbl = g_xma_singleton->connections;
+    XmaConnectIndex *index = &g_xma_singleton->conn_index;
+    int32_t i;
+
+    pthread_mutex_init(&index->lock, NULL);
+    for (i = 0; i < MAX_CONNECTION_ENTRIES; i++)
+    {
+        conntbl[i].state = XMA_CONNECT_UNUSED;
+        conntbl[i].next = i + 1 < MAX_CONNECTION_ENTRIES ? i + 1 : -1;
+    }
+    index->free_head = 0;
+    for (i = 0; i < MAX_XILINX_DEVICES; i++)
+        index->pending[i] = -1;
+}
+
+// Unlink a pending entry from the list of its device, call with lock held
+static void
+xma_connect_unlink_pending(int32_t dev_id, int32_t c_handle)
+{
+    XmaConnect *conntbl = g_xma_singleton->connections;
+    int32_t *link = &g_xma_singleton->conn_index.pending[dev_id];
+
+    while (*link != -1 && *link != c_handle)
+        link = &conntbl[*link].next;
+    if (*link == c_handle)
+        *link = conntbl[c_handle].next;
+    conntbl[c_handle].next = -1;
+}
+
+// Return an entry to the free list, call with lock held
+static void
+xma_connect_release(int32_t c_handle)
+{
+    XmaConnect *conntbl = g_xma_singleton->connections;
+    XmaConnectIndex *index = &g_xma_singleton->conn_index;
+
+    conntbl[c_handle].state = XMA_CONNECT_UNUSED;
+    conntbl[c_handle].next = index->free_head;
+    index->free_head = c_handle;
+}
+
 int32_t
 xma_connect_alloc(XmaEndpoint *endpt, XmaConnectType type)
 {
     int32_t i;
     int32_t c_handle = -1;
+    int32_t wildcard = -1;
+    bool connected;
     XmaConnect *conntbl = g_xma_singleton->connections;
+    XmaConnectIndex *index = &g_xma_singleton->conn_index;
 
     // Don't add an entry if zerocopy is disabled
-    if (!is_zerocopy_enabled(endpt->dev_id))
+    if (endpt->dev_id < 0 || endpt->dev_id >= MAX_XILINX_DEVICES ||
+        !is_zerocopy_enabled(endpt->dev_id))
+    {
+        free(endpt);
         return c_handle;
+    }
 
-    // An endpoint is added based on the direction provided
-    // If this is a sender, find the first unused connection
-    // entry and set the state to pending.
     // NOTE: The connection table is only local to a process
     //       and not kept in shared system memory
-    // TODO: It may be necessary to obtain a lock on the connection
-    //       table; however, assume for now that connections are
-    //       established during initialization and initialization
-    //       is all performed from a single thread.  This assumption
-    //       may not be true and could create a problem.
+    pthread_mutex_lock(&index->lock);
 
-    // Find an unused entry for a sender
-    if (type == XMA_CONNECT_SENDER)
+    // Look for a pending entry of the opposite type on the same
+    // device.  Entries naming each other beat other compatible ones.
+    for (i = index->pending[endpt->dev_id]; i != -1; i = conntbl[i].next)
     {
-        for (i = 0; i < MAX_CONNECTION_ENTRIES; i++)
-        {
-            if (conntbl[i].state == XMA_CONNECT_UNUSED)
-            {
-                c_handle = i;
-                conntbl[i].sender = endpt;
-                conntbl[i].state = XMA_CONNECT_PENDING_ACTIVE;
-                break;
-            }
+        XmaEndpoint *cmp_endpt = type == XMA_CONNECT_SENDER ?
+                                 conntbl[i].receiver : conntbl[i].sender;
+
+        if (!cmp_endpt || !is_connect_peer(endpt, cmp_endpt) ||
+            !is_connect_compatible(endpt, cmp_endpt))
+            continue;
+
+        if (endpt->peer || cmp_endpt->peer) {
+            c_handle = i;
+            break;
         }
+        if (wildcard == -1)
+            wildcard = i;
     }
-    // Find a compatible pending entry for a receiver
-    if (type == XMA_CONNECT_RECEIVER)
+    if (c_handle == -1)
+        c_handle = wildcard;
+
+    if (c_handle != -1)
     {
-        for (i = 0; i < MAX_CONNECTION_ENTRIES; i++)
-        {
-            if (conntbl[i].state == XMA_CONNECT_PENDING_ACTIVE)
-            {
-                XmaEndpoint *cmp_endpt = conntbl[i].sender;
-                if (is_connect_compatible(endpt, cmp_endpt))
-                {
-                    printf("xmaconnect: compatible connection found\n");
-                    c_handle = i;
-                    conntbl[i].receiver = endpt;
-                    conntbl[i].state = XMA_CONNECT_ACTIVE;
-                    break;
-                }
-            }
-        }
+        xma_connect_unlink_pending(endpt->dev_id, c_handle);
+        if (type == XMA_CONNECT_SENDER)
+            conntbl[c_handle].sender = endpt;
+        else
+            conntbl[c_handle].receiver = endpt;
+        conntbl[c_handle].state = XMA_CONNECT_ACTIVE;
+    }
+    else if (index->free_head != -1)
+    {
+        // No peer yet, wait for one in a new pending entry
+        c_handle = index->free_head;
+        index->free_head = conntbl[c_handle].next;
+        conntbl[c_handle].sender =
+            type == XMA_CONNECT_SENDER ? endpt : NULL;
+        conntbl[c_handle].receiver =
+            type == XMA_CONNECT_RECEIVER ? endpt : NULL;
+        conntbl[c_handle].state = XMA_CONNECT_PENDING_ACTIVE;
+        conntbl[c_handle].next = index->pending[endpt->dev_id];
+        index->pending[endpt->dev_id] = c_handle;
     }
+    connected = c_handle != -1 &&
+                conntbl[c_handle].state == XMA_CONNECT_ACTIVE;
+
+    pthread_mutex_unlock(&index->lock);
+
+    xma_logmsg(XMA_DEBUG_LOG, XMA_CONNECT_MOD,
+               "%s() %s entry %d on device %d %s\n", __func__,
+               type == XMA_CONNECT_SENDER ? "sender" : "receiver",
+               c_handle, endpt->dev_id,
+               c_handle == -1 ? "unavailable" :
+               connected ? "connected" : "pending");
+    if (c_handle == -1)
+        free(endpt);
     return c_handle;
 }
 
@@ -96,35 +170,41 @@ int32_t
 xma_connect_free(int32_t c_handle, XmaConnectType type)
 {
     XmaConnect *conntbl = g_xma_singleton->connections;
+    XmaConnectIndex *index = &g_xma_singleton->conn_index;
+    XmaEndpoint *endpt;
 
     if (c_handle == -1)
         return XMA_SUCCESS;
 
-    if (type == XMA_CONNECT_SENDER &&
-        conntbl[c_handle].sender != NULL)
+    pthread_mutex_lock(&index->lock);
+    if (type == XMA_CONNECT_SENDER)
     {
-        free(conntbl[c_handle].sender);
+        endpt = conntbl[c_handle].sender;
         conntbl[c_handle].sender = NULL;
-        if (conntbl[c_handle].state == XMA_CONNECT_ACTIVE &&
-            conntbl[c_handle].receiver == NULL)
-            conntbl[c_handle].state = XMA_CONNECT_UNUSED;
-        else
-            conntbl[c_handle].state = XMA_CONNECT_PENDING_DELETE;
     }
-
-    if (type == XMA_CONNECT_RECEIVER &&
-        conntbl[c_handle].receiver != NULL)
+    else
     {
-        free(conntbl[c_handle].receiver);
+        endpt = conntbl[c_handle].receiver;
         conntbl[c_handle].receiver = NULL;
-        if (conntbl[c_handle].state == XMA_CONNECT_PENDING_DELETE &&
-            conntbl[c_handle].sender == NULL)
-            conntbl[c_handle].state = XMA_CONNECT_UNUSED;
-        else
+    }
+
+    if (endpt != NULL)
+    {
+        // Pending entries have no peer, others wait for the peer to go
+        if (conntbl[c_handle].state == XMA_CONNECT_PENDING_ACTIVE)
+        {
+            xma_connect_unlink_pending(endpt->dev_id, c_handle);
+            xma_connect_release(c_handle);
+        }
+        else if (conntbl[c_handle].state == XMA_CONNECT_ACTIVE)
             conntbl[c_handle].state = XMA_CONNECT_PENDING_DELETE;
+        else if (conntbl[c_handle].state == XMA_CONNECT_PENDING_DELETE)
+            xma_connect_release(c_handle);
     }
+    pthread_mutex_unlock(&index->lock);
 
-   return XMA_SUCCESS;
+    free(endpt);
+    return XMA_SUCCESS;
 }
 
 bool
@@ -152,7 +232,9 @@ is_zerocopy_enabled(int32_t dev_id)
             break;
     }
 
-    printf("xmaconnect: zerocopy enable = %d\n", zerocopy);
+    xma_logmsg(XMA_DEBUG_LOG, XMA_CONNECT_MOD,
+               "%s() device %d zerocopy enable = %d\n",
+               __func__, dev_id, zerocopy);
     return zerocopy;
 }
 
@@ -163,25 +245,21 @@ is_connect_compatible(XmaEndpoint *endpt1,
     XmaHwSession *hw1 = &endpt1->session->hw_session;
     XmaHwSession *hw2 = &endpt2->session->hw_session;
 
-    // Can't check format because of scaler plugin BUG
-    //       "endpt1->format  %d, endpt2->format  %d\n"
-    //        endpt1->format,  endpt2->format,
-    printf("hw1->dev_handle %p, hw2->dev_handle %p\n"
-           "hw1->ddr_bank   %d, hw2->ddr_bandk  %d\n"
-           "endpt1->bpp     %d, endpt2->bpp     %d\n"
-           "endpt1->width   %d, endpt2->width   %d\n"
-           "endpt1->height  %d, endpt2->height  %d\n",
-            hw1->dev_handle, hw2->dev_handle,
-            hw1->ddr_bank,   hw2->ddr_bank,
-            endpt1->bits_per_pixel, endpt2->bits_per_pixel,
-            endpt1->width,   endpt2->width,
-            endpt1->height,  endpt2->height);
-
+    // Called with the connection table locked, so no logging here
     // Can't check format because of scaler plugin BUG
     //        endpt1->format         == endpt2->format         &&
-    return (hw1->dev_handle        == hw2->dev_handle        &&
+    return (endpt1->session        != endpt2->session        &&
+            hw1->dev_handle        == hw2->dev_handle        &&
             hw1->ddr_bank          == hw2->ddr_bank          &&
             endpt1->bits_per_pixel == endpt2->bits_per_pixel &&
             endpt1->width          == endpt2->width          &&
             endpt1->height         == endpt2->height);
 }
+
+static bool
+is_connect_peer(XmaEndpoint *endpt1,
+                XmaEndpoint *endpt2)
+{
+    return (!endpt1->peer || endpt1->peer == endpt2->session) &&
+           (!endpt2->peer || endpt2->peer == endpt1->session);
+}
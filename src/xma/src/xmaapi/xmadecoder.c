@@ -26,6 +26,12 @@
 
 #define XMA_DECODER_MOD "xmadecoder"
 
+typedef struct XmaDecoderAsyncReq
+{
+    XmaDataBuffer *data;
+    int32_t        data_used;
+} XmaDecoderAsyncReq;
+
 extern XmaSingleton *g_xma_singleton;
 
 int32_t
@@ -174,6 +180,10 @@ xma_dec_session_destroy(XmaDecoderSession *session)
     int32_t rc;
 
     xma_logmsg(XMA_DEBUG_LOG, XMA_DECODER_MOD, "%s()\n", __func__);
+    // Queued data is sent before the plugin is closed
+    xma_async_destroy(session->async);
+    session->async = NULL;
+
     rc  = session->decoder_plugin->close(session);
     if (rc != 0)
         xma_logmsg(XMA_ERROR_LOG, XMA_DECODER_MOD,
@@ -196,13 +206,72 @@ xma_dec_session_destroy(XmaDecoderSession *session)
     return XMA_SUCCESS;
 }
 
+static int32_t
+xma_dec_async_exec(void *owner, void *req)
+{
+    XmaDecoderSession *session = owner;
+    XmaDecoderAsyncReq *dec_req = req;
+
+    return session->decoder_plugin->send_data(session, dec_req->data,
+                                              &dec_req->data_used);
+}
+
+static void
+xma_dec_async_complete(void *owner, void *req, int32_t rc)
+{
+    XmaDecoderSession *session = owner;
+    XmaDecoderAsyncReq *dec_req = req;
+
+    if (rc < 0)
+        xma_logmsg(XMA_ERROR_LOG, XMA_DECODER_MOD,
+                   "Async send of data %p failed. Return code %d\n",
+                   dec_req->data, rc);
+    session->async_done(session, dec_req->data, dec_req->data_used, rc,
+                        session->async_data);
+    free(dec_req);
+}
+
+int32_t
+xma_dec_session_set_async(XmaDecoderSession   *session,
+                          uint32_t             queue_depth,
+                          XmaDecoderDataDone   done,
+                          void                *user_data)
+{
+    xma_logmsg(XMA_DEBUG_LOG, XMA_DECODER_MOD, "%s() depth %u\n",
+               __func__, queue_depth);
+    if (session->async || !done)
+        return XMA_ERROR;
+
+    session->async_done = done;
+    session->async_data = user_data;
+    session->async = xma_async_create(session, queue_depth,
+                                      xma_dec_async_exec,
+                                      xma_dec_async_complete);
+    return session->async ? XMA_SUCCESS : XMA_ERROR;
+}
+
 int32_t
 xma_dec_session_send_data(XmaDecoderSession *session,
                           XmaDataBuffer     *data,
 						  int32_t           *data_used)
 {
+    XmaDecoderAsyncReq *dec_req;
+    int32_t rc;
+
     xma_logmsg(XMA_DEBUG_LOG, XMA_DECODER_MOD, "%s()\n", __func__);
-    return session->decoder_plugin->send_data(session, data, data_used);
+    if (!session->async)
+        return session->decoder_plugin->send_data(session, data, data_used);
+
+    dec_req = malloc(sizeof(XmaDecoderAsyncReq));
+    if (!dec_req)
+        return XMA_ERROR;
+    dec_req->data = data;
+    dec_req->data_used = 0;
+    *data_used = 0;
+    rc = xma_async_submit(session->async, dec_req);
+    if (rc)
+        free(dec_req);
+    return rc;
 }
 
 int32_t
@@ -217,6 +286,14 @@ int32_t
 xma_dec_session_recv_frame(XmaDecoderSession *session,
                            XmaFrame           *frame)
 {
+    int32_t rc;
+
     xma_logmsg(XMA_DEBUG_LOG, XMA_DECODER_MOD, "%s()\n", __func__);
-    return session->decoder_plugin->recv_frame(session, frame);
+    if (!session->async)
+        return session->decoder_plugin->recv_frame(session, frame);
+
+    xma_async_lock(session->async);
+    rc = session->decoder_plugin->recv_frame(session, frame);
+    xma_async_unlock(session->async);
+    return rc;
 }
@@ -84,60 +84,31 @@ xma_enc_plugins_load(XmaSystemCfg      *systemcfg,
     return XMA_SUCCESS;
 }
 
-XmaEncoderSession*
-xma_enc_session_create(XmaEncoderProperties *enc_props)
+/* Attach session to the kernel in its kern_res: hardware session, plugin,
+ * plugin private data and receiver connection */
+static int32_t
+xma_enc_session_bind(XmaEncoderSession *enc_session)
 {
-    XmaEncoderSession *enc_session = malloc(sizeof(XmaEncoderSession));
-    XmaResources xma_shm_cfg = g_xma_singleton->shm_res_cfg;
+    XmaEncoderProperties *enc_props = &enc_session->encoder_props;
     XmaKernelRes kern_res;
-    int rc, dev_handle, kern_handle, enc_handle;
-
-    xma_logmsg(XMA_DEBUG_LOG, XMA_ENCODER_MOD, "%s()\n", __func__);
-	if (!xma_shm_cfg) {
-        xma_logmsg(XMA_ERROR_LOG, XMA_ENCODER_MOD,
-                   "No reference to xma res database\n");
-        free(enc_session);
-		return NULL;
-    }
-
-    memset(enc_session, 0, sizeof(XmaEncoderSession));
-    // init session data
-    enc_session->encoder_props = *enc_props;
-    enc_session->base.chan_id = -1;
-    enc_session->base.session_type = XMA_ENCODER;
-
-    // Just assume this is a VP9 encoder for now and that the FPGA
-    // has been downloaded.  This is accomplished by getting the
-    // first device (dev_handle, base_addr, ddr_bank) and making a
-    // XmaHwSession out of it.  Later this needs to be done by searching
-    // for an available resource.
-    /* JPM TODO default to exclusive device access.  Ensure multiple threads
-       can access this device if in-use pid = requesting thread pid */
-    rc = xma_res_alloc_enc_kernel(xma_shm_cfg, enc_props->hwencoder_type,
-                                  enc_props->hwvendor_string,
-                                  &enc_session->base, false);
-    if (rc) {
-        xma_logmsg(XMA_ERROR_LOG, XMA_ENCODER_MOD,
-                   "Failed to allocate free encoder kernel. Return code %d\n", rc);
-        return NULL;
-    }
+    int dev_handle, kern_handle, enc_handle;
 
     kern_res = enc_session->base.kern_res;
 
     dev_handle = xma_res_dev_handle_get(kern_res);
     xma_logmsg(XMA_INFO_LOG, XMA_ENCODER_MOD,"dev_handle = %d\n", dev_handle);
     if (dev_handle < 0)
-        return NULL;
+        return XMA_ERROR;
 
     kern_handle = xma_res_kern_handle_get(kern_res);
     xma_logmsg(XMA_INFO_LOG, XMA_ENCODER_MOD,"kern_handle = %d\n", kern_handle);
     if (kern_handle < 0)
-        return NULL;
+        return XMA_ERROR;
 
     enc_handle = xma_res_plugin_handle_get(kern_res);
     xma_logmsg(XMA_INFO_LOG, XMA_ENCODER_MOD,"enc_handle = %d\n", enc_handle);
     if (enc_handle < 0)
-        return NULL;
+        return XMA_ERROR;
 
     XmaHwCfg *hwcfg = &g_xma_singleton->hwcfg;
     XmaHwHAL *hal = (XmaHwHAL*)hwcfg->devices[dev_handle].handle;
@@ -164,9 +135,53 @@ xma_enc_session_create(XmaEncoderProperties *enc_props)
     end_pt->bits_per_pixel = enc_props->bits_per_pixel;
     end_pt->width = enc_props->width;
     end_pt->height = enc_props->height;
+    end_pt->peer = NULL;
     enc_session->conn_recv_handle =
         xma_connect_alloc(end_pt, XMA_CONNECT_RECEIVER);
 
+    return XMA_SUCCESS;
+}
+
+XmaEncoderSession*
+xma_enc_session_create(XmaEncoderProperties *enc_props)
+{
+    XmaEncoderSession *enc_session = malloc(sizeof(XmaEncoderSession));
+    XmaResources xma_shm_cfg = g_xma_singleton->shm_res_cfg;
+    int rc;
+
+    xma_logmsg(XMA_DEBUG_LOG, XMA_ENCODER_MOD, "%s()\n", __func__);
+	if (!xma_shm_cfg) {
+        xma_logmsg(XMA_ERROR_LOG, XMA_ENCODER_MOD,
+                   "No reference to xma res database\n");
+        free(enc_session);
+		return NULL;
+    }
+
+    memset(enc_session, 0, sizeof(XmaEncoderSession));
+    // init session data
+    enc_session->encoder_props = *enc_props;
+    enc_session->base.chan_id = -1;
+    enc_session->base.session_type = XMA_ENCODER;
+
+    // Just assume this is a VP9 encoder for now and that the FPGA
+    // has been downloaded.  This is accomplished by getting the
+    // first device (dev_handle, base_addr, ddr_bank) and making a
+    // XmaHwSession out of it.  Later this needs to be done by searching
+    // for an available resource.
+    /* JPM TODO default to exclusive device access.  Ensure multiple threads
+       can access this device if in-use pid = requesting thread pid */
+    rc = xma_res_alloc_enc_kernel(xma_shm_cfg, enc_props->hwencoder_type,
+                                  enc_props->hwvendor_string,
+                                  &enc_session->base, false);
+    if (rc) {
+        xma_logmsg(XMA_ERROR_LOG, XMA_ENCODER_MOD,
+                   "Failed to allocate free encoder kernel. Return code %d\n", rc);
+        return NULL;
+    }
+
+    if (xma_enc_session_bind(enc_session))
+        return NULL;
+
     // Call the plugins initialization function with this session data
     rc = enc_session->encoder_plugin->init(enc_session);
     if (rc) {
@@ -185,6 +200,10 @@ xma_enc_session_destroy(XmaEncoderSession *session)
     int32_t rc;
 
     xma_logmsg(XMA_DEBUG_LOG, XMA_ENCODER_MOD, "%s()\n", __func__);
+    // Queued frames are sent before the plugin is closed
+    xma_async_destroy(session->async);
+    session->async = NULL;
+
     rc  = session->encoder_plugin->close(session);
     if (rc != 0)
         xma_logmsg(XMA_ERROR_LOG, XMA_ENCODER_MOD,
@@ -211,11 +230,52 @@ xma_enc_session_destroy(XmaEncoderSession *session)
     return XMA_SUCCESS;
 }
 
+static int32_t
+xma_enc_async_exec(void *owner, void *req)
+{
+    XmaEncoderSession *session = owner;
+
+    return session->encoder_plugin->send_frame(session, req);
+}
+
+static void
+xma_enc_async_complete(void *owner, void *req, int32_t rc)
+{
+    XmaEncoderSession *session = owner;
+
+    if (rc < 0)
+        xma_logmsg(XMA_ERROR_LOG, XMA_ENCODER_MOD,
+                   "Async send of frame %p failed. Return code %d\n",
+                   req, rc);
+    session->async_done(session, req, rc, session->async_data);
+}
+
+int32_t
+xma_enc_session_set_async(XmaEncoderSession   *session,
+                          uint32_t             queue_depth,
+                          XmaEncoderFrameDone  done,
+                          void                *user_data)
+{
+    xma_logmsg(XMA_DEBUG_LOG, XMA_ENCODER_MOD, "%s() depth %u\n",
+               __func__, queue_depth);
+    if (session->async || !done)
+        return XMA_ERROR;
+
+    session->async_done = done;
+    session->async_data = user_data;
+    session->async = xma_async_create(session, queue_depth,
+                                      xma_enc_async_exec,
+                                      xma_enc_async_complete);
+    return session->async ? XMA_SUCCESS : XMA_ERROR;
+}
+
 int32_t
 xma_enc_session_send_frame(XmaEncoderSession *session,
                            XmaFrame          *frame)
 {
     xma_logmsg(XMA_DEBUG_LOG, XMA_ENCODER_MOD, "%s()\n", __func__);
+    if (session->async)
+        return xma_async_submit(session->async, frame);
     return session->encoder_plugin->send_frame(session, frame);
 }
 
@@ -224,6 +284,63 @@ xma_enc_session_recv_data(XmaEncoderSession *session,
                           XmaDataBuffer     *data,
                           int32_t           *data_size)
 {
+    int32_t rc;
+
+    xma_logmsg(XMA_DEBUG_LOG, XMA_ENCODER_MOD, "%s()\n", __func__);
+    if (!session->async)
+        return session->encoder_plugin->recv_data(session, data, data_size);
+
+    xma_async_lock(session->async);
+    rc = session->encoder_plugin->recv_data(session, data, data_size);
+    xma_async_unlock(session->async);
+    return rc;
+}
+
+int32_t
+xma_enc_session_rebalance(XmaEncoderSession *session)
+{
+    XmaResources xma_shm_cfg = g_xma_singleton->shm_res_cfg;
+    int32_t rc, moved;
+
     xma_logmsg(XMA_DEBUG_LOG, XMA_ENCODER_MOD, "%s()\n", __func__);
-    return session->encoder_plugin->recv_data(session, data, data_size);
+    if (!session->encoder_plugin->quiesce)
+        return XMA_ERROR_INVALID;
+
+    rc = xma_res_rebalance_check(xma_shm_cfg, &session->base);
+    if (rc)
+        return rc;
+
+    // Frames already queued are encoded on the current kernel
+    if (session->async) {
+        xma_async_drain(session->async);
+        xma_async_lock(session->async);
+    }
+
+    rc = session->encoder_plugin->quiesce(session);
+    if (rc) {
+        if (session->async)
+            xma_async_unlock(session->async);
+        return rc;
+    }
+    session->encoder_plugin->close(session);
+
+    // The kernel stays with the session if it could not be moved
+    moved = xma_res_rebalance_kernel(xma_shm_cfg, &session->base);
+    if (moved == XMA_SUCCESS) {
+        free(session->base.plugin_data);
+        xma_connect_free(session->conn_recv_handle, XMA_CONNECT_RECEIVER);
+        rc = xma_enc_session_bind(session);
+    }
+    if (rc == XMA_SUCCESS)
+        rc = session->encoder_plugin->init(session);
+
+    if (session->async)
+        xma_async_unlock(session->async);
+    if (rc) {
+        xma_logmsg(XMA_ERROR_LOG, XMA_ENCODER_MOD,
+                   "Re-initalization of encoder plugin failed. Return code %d\n",
+                   rc);
+        return XMA_ERROR;
+    }
+    return moved;
 }
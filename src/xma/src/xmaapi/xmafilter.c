@@ -162,6 +162,7 @@ xma_filter_session_create(XmaFilterProperties *filter_props)
     end_pt->bits_per_pixel = filter_props->output.bits_per_pixel;
     end_pt->width = filter_props->output.width;
     end_pt->height = filter_props->output.height;
+    end_pt->peer = filter_props->destination;
     filter_session->conn_send_handle =
         xma_connect_alloc(end_pt, XMA_CONNECT_SENDER);
 
@@ -35,3 +35,8 @@ bool xma_hw_configure(XmaHwCfg *hwcfg, XmaSystemCfg *systemcfg, bool hw_cfg_stat
 {
     return hw_if.configure(hwcfg, systemcfg, hw_cfg_status);
 }
+
+int xma_hw_attach(XmaHwCfg *hwcfg, XmaSystemCfg *systemcfg)
+{
+    return hw_if.attach(hwcfg, systemcfg);
+}
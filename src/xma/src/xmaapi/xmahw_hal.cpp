@@ -20,6 +20,8 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <vector>
+#include <algorithm>
+#include <thread>
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
@@ -42,6 +44,11 @@ typedef struct XmaHALDevice
 static int get_device_list(XmaHALDevice   *xlnx_devices,
                            uint32_t       *device_count);
 
+static int open_devices(XmaHALDevice   *xlnx_devices,
+                        const uint32_t *dev_ids,
+                        uint32_t        count,
+                        bool            get_info);
+
 static void set_hw_cfg(uint32_t        device_count,
                        XmaHALDevice   *xlnx_devices,
                        XmaHwCfg       *hwcfg);
@@ -53,25 +60,56 @@ static int get_max_dev_id(XmaSystemCfg *systemcfg);
 int get_device_list(XmaHALDevice   *xlnx_devices,
                     uint32_t       *device_count)
 {
-    int32_t      rc = 0;
+    uint32_t     dev_ids[MAX_XILINX_DEVICES];
     uint32_t     i;
 
     *device_count = xclProbe();
+    if (*device_count > MAX_XILINX_DEVICES)
+        *device_count = MAX_XILINX_DEVICES;
     for (i = 0; i < *device_count; i++)
+        dev_ids[i] = i;
+
+    return open_devices(xlnx_devices, dev_ids, *device_count, true);
+}
+
+/* Devices are opened concurrently, each open costs a driver round trip */
+int open_devices(XmaHALDevice   *xlnx_devices,
+                 const uint32_t *dev_ids,
+                 uint32_t        count,
+                 bool            get_info)
+{
+    std::vector<std::thread> workers;
+    std::vector<int32_t>     rcs(count, 0);
+    uint32_t                 i;
+
+    for (i = 0; i < count; i++)
     {
-        xlnx_devices[i].handle = xclOpen(i, NULL, XCL_QUIET);
-        printf("get_device_list xclOpen handle = %p\n",
-            xlnx_devices[i].handle);
-        rc = xclGetDeviceInfo2(xlnx_devices[i].handle, &xlnx_devices[i].info);
-        if (rc != 0)
+        workers.emplace_back([=, &rcs] {
+            XmaHALDevice *dev = &xlnx_devices[dev_ids[i]];
+
+            dev->handle = xclOpen(dev_ids[i], NULL, XCL_QUIET);
+            if (!dev->handle)
+                rcs[i] = -1;
+            else if (get_info)
+                rcs[i] = xclGetDeviceInfo2(dev->handle, &dev->info);
+        });
+    }
+    for (auto& w : workers)
+        w.join();
+
+    for (i = 0; i < count; i++)
+    {
+        printf("open_devices xclOpen handle = %p\n",
+            xlnx_devices[dev_ids[i]].handle);
+        if (rcs[i] != 0)
         {
-            xma_logmsg("xclGetDeviceInfo2 failed for device id: %d, rc=%d\n",
-                        i, rc);
-            break;
+            xma_logmsg("Opening device id: %d failed, rc=%d\n",
+                        dev_ids[i], rcs[i]);
+            return rcs[i];
         }
     }
 
-    return rc;
+    return 0;
 }
 
 void set_hw_cfg(uint32_t        device_count,
@@ -178,31 +216,56 @@ bool hal_is_compatible(XmaHwCfg *hwcfg, XmaSystemCfg *systemcfg)
     return true;
 }
 
+/*
+ * Images are mapped and their kernels recorded first, then all devices are
+ * programmed concurrently, each ICAP download takes seconds.  All failed
+ * downloads are reported.
+ */
 bool hal_configure(XmaHwCfg *hwcfg, XmaSystemCfg *systemcfg, bool hw_configured)
 {
     std::string   xclbinpath = systemcfg->xclbinpath;
     XmaXclbinInfo info;
     int32_t ddr_table[] = {0, 3, 1, 2};
 
+    struct image
+    {
+        std::string name;
+        char       *buffer;
+        size_t      size;
+    };
+    struct download
+    {
+        int32_t         image;
+        int32_t         dev_id;
+        xclDeviceHandle handle;
+    };
+    std::vector<image>    images;
+    std::vector<download> downloads;
+    bool                  ok = true;
+
     /* Download the requested image to the associated device */
     /* Make sure to program the reference clock prior to download */
-    for (int32_t i = 0; i < systemcfg->num_images; i++)
+    for (int32_t i = 0; ok && i < systemcfg->num_images; i++)
     {
         std::string xclbin = systemcfg->imagecfg[i].xclbin;
         std::string xclfullname = xclbinpath + "/" + xclbin;
-        char *buffer = xma_xclbin_file_open(xclfullname.c_str());
+        size_t size = 0;
+        char *buffer = xma_xclbin_file_open(xclfullname.c_str(), &size);
         if (!buffer)
         {
             xma_logmsg("Could not open xclbin file %s\n",
                        xclfullname.c_str());
-            return false;
+            ok = false;
+            break;
         }
+        images.push_back({xclfullname, buffer, size});
         int32_t rc = xma_xclbin_info_get(buffer, &info);
         if (rc != XMA_SUCCESS)
         {
             xma_logmsg("Could not get info for xclbin file %s\n",
                        xclfullname.c_str());
-            return false;
+            ok = false;
+            break;
         }
 
         for (int32_t d = 0; d < systemcfg->imagecfg[i].num_devices; d++)
@@ -230,22 +293,77 @@ bool hal_configure(XmaHwCfg *hwcfg, XmaSystemCfg *systemcfg, bool hw_configured)
             }
             if (hw_configured)
                 continue;
-            /* Download xclbin first */
-            rc = load_xclbin_to_device(hal->dev_handle, buffer);
-            if (rc != 0)
-            {
-                xma_logmsg("Could not download xclbin file %s to device %d\n",
-                           xclfullname.c_str(),
-                           systemcfg->imagecfg[i].device_id_map[d]);
-                return false;
-            }
+            /* a device listed by several images ends up with the last */
+            auto itr = std::find_if(downloads.begin(), downloads.end(),
+                [dev_id](const download& dl) { return dl.dev_id == dev_id; });
+            if (itr != downloads.end())
+                itr->image = i;
+            else
+                downloads.push_back({i, dev_id, hal->dev_handle});
         }
     }
-    return true;
+
+    if (ok)
+    {
+        std::vector<std::thread> workers;
+        std::vector<int32_t>     rcs(downloads.size(), 0);
+
+        for (size_t j = 0; j < downloads.size(); j++)
+        {
+            workers.emplace_back([&, j] {
+                rcs[j] = load_xclbin_to_device(downloads[j].handle,
+                    images[downloads[j].image].buffer);
+            });
+        }
+        for (auto& w : workers)
+            w.join();
+
+        for (size_t j = 0; j < downloads.size(); j++)
+        {
+            if (rcs[j] == 0)
+                continue;
+            xma_logmsg("Could not download xclbin file %s to device %d\n",
+                       images[downloads[j].image].name.c_str(),
+                       downloads[j].dev_id);
+            ok = false;
+        }
+    }
+
+    for (auto& img : images)
+        xma_xclbin_file_close(img.buffer, img.size);
+    return ok;
+}
+
+int hal_attach(XmaHwCfg *hwcfg, XmaSystemCfg *systemcfg)
+{
+    XmaHALDevice   xlnx_devices[MAX_XILINX_DEVICES];
+    uint32_t       dev_ids[MAX_XILINX_DEVICES];
+    uint32_t       count = 0;
+
+    /* Only configured devices are opened, their kernels are already known */
+    for (int32_t i = 0; i < systemcfg->num_images; i++)
+        for (int32_t d = 0; d < systemcfg->imagecfg[i].num_devices; d++)
+            if (count < MAX_XILINX_DEVICES)
+                dev_ids[count++] = systemcfg->imagecfg[i].device_id_map[d];
+
+    memset(xlnx_devices, 0, sizeof(xlnx_devices));
+    if (open_devices(xlnx_devices, dev_ids, count, false) != 0)
+        return XMA_ERROR;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        XmaHwHAL *hwhal = (XmaHwHAL*)malloc(sizeof(XmaHwHAL));
+        memset(hwhal, 0, sizeof(XmaHwHAL));
+        hwhal->dev_handle = xlnx_devices[dev_ids[i]].handle;
+        hwcfg->devices[dev_ids[i]].handle = hwhal;
+    }
+
+    return XMA_SUCCESS;
 }
 
 XmaHwInterface hw_if = {
     .probe         = hal_probe,
     .is_compatible = hal_is_compatible,
-    .configure     = hal_configure
+    .configure     = hal_configure,
+    .attach        = hal_attach
 };
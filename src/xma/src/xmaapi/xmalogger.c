@@ -131,11 +131,12 @@ xma_logmsg(XmaLogLevelType level, const char *name, const char *msg, ...)
     /* Get XMA logger */
     XmaLogger *logger = &g_xma_singleton->logger;
 
+    /* Filtered messages cost no formatting */
+    if (level > logger->log_level)
+        return;
+
     memset(msg_buff, 0, sizeof(msg_buff));
 
-    if ( level > logger->log_level)
-        return;
-    
     /* Get time */
     gettimeofday(&tv, NULL);
     millisec = lrint(tv.tv_usec/1000.0);
@@ -163,10 +164,27 @@ xma_logmsg(XmaLogLevelType level, const char *name, const char *msg, ...)
     va_end(ap);
 
     /* Send message buffer to logger Actor - 
-       will be copied to loggers message buffer */
+       will be copied to loggers message buffer.
+       Dropped if the queue is full, the actor reports the count */
     xma_actor_sendmsg(logger->actor, msg_buff, sizeof(msg_buff));
 }
 
+static int32_t xma_logger_write(XmaLogger *logger, const char *logmsg)
+{
+    if (logger->fd != -1)
+    {
+        if (write(logger->fd, logmsg, strlen(logmsg)) < 0)
+        {
+            perror("XMA Logger: could not write to file: ");
+            return -1;
+        }
+    }
+    if (logger->use_stdout)
+        printf("%s", logmsg);
+
+    return 0;
+}
+
 void* xma_logger_actor(void *data)
 {
     int32_t rc;
@@ -183,6 +201,8 @@ void* xma_logger_actor(void *data)
     printf("XMA Logger: Logging thread started\n");
     while (1)
     {
+        uint64_t dropped;
+
         memset(logmsg, 0, sizeof(logmsg));
         rc = xma_actor_recvmsg(actor, logmsg, sizeof(logmsg));
         if (rc == 0)
@@ -192,17 +212,19 @@ void* xma_logger_actor(void *data)
                 printf("XMA logger: received shutdown\n");
                 break;
             }
-            if (logger->fd != -1)
+            dropped = xma_msgq_take_dropped(actor->msg_q);
+            if (dropped)
             {
-                rc = write(logger->fd, logmsg, strlen(logmsg));
-                if (rc < 0)
-                {
-                    perror("XMA Logger: could not write to file: ");
+                char dropmsg[XMA_MAX_LOGMSG_SIZE];
+
+                snprintf(dropmsg, sizeof(dropmsg),
+                         "XMA Logger: dropped %lu messages, queue full\n",
+                         (unsigned long)dropped);
+                if (xma_logger_write(logger, dropmsg))
                     break;
-                }
             }
-            if (logger->use_stdout)
-                printf("%s", logmsg);
+            if (xma_logger_write(logger, logmsg))
+                break;
         }
         else
             /* Logger has been shutdown - so return from thread */
@@ -263,59 +285,90 @@ XmaMsgQ *xma_msgq_create(size_t msg_size, size_t max_msg_entries)
     msgq->msg_size = msg_size;
     msgq->max_msg_entries = max_msg_entries;
     msgq->msg_array = malloc(msg_size * max_msg_entries);
-    msgq->num_entries = 0;
-    msgq->front = 0;
-    msgq->back = 0; 
+    msgq->msg_seq = malloc(sizeof(size_t) * max_msg_entries);
+    for (size_t i = 0; i < max_msg_entries; i++)
+        msgq->msg_seq[i] = i;
+    msgq->enqueue_pos = 0;
+    msgq->dequeue_pos = 0;
+    msgq->dropped = 0;
 
     return msgq;
 }
 
 void xma_msgq_destroy(XmaMsgQ *msgq)
 {
+    free(msgq->msg_seq);
     free(msgq->msg_array);
     free(msgq);
 }
 
+/* Full and empty are snapshots, producers may race with the answer */
 bool xma_msgq_isfull(XmaMsgQ *msgq)
 {
-    return (msgq->num_entries == msgq->max_msg_entries);
+    size_t pos = __atomic_load_n(&msgq->enqueue_pos, __ATOMIC_RELAXED);
+    size_t seq = __atomic_load_n(&msgq->msg_seq[pos % msgq->max_msg_entries],
+                                 __ATOMIC_ACQUIRE);
+    return ((intptr_t)seq - (intptr_t)pos) < 0;
 }
 
 bool xma_msgq_isempty(XmaMsgQ *msgq)
 {
-    return (msgq->num_entries == 0); 
+    size_t pos = msgq->dequeue_pos;
+    size_t seq = __atomic_load_n(&msgq->msg_seq[pos % msgq->max_msg_entries],
+                                 __ATOMIC_ACQUIRE);
+    return ((intptr_t)seq - (intptr_t)(pos + 1)) < 0;
 }
 
+/* May be called by any thread, never blocks */
 int32_t xma_msgq_enqueue(XmaMsgQ *msgq, void *msg, size_t size)
 {
-    if (xma_msgq_isfull(msgq))
-    {
-        XMA_DBG_PRINTF("XMA msgq enqueue: full\n");
-        return XMA_MSGQ_FULL;
-    }
+    size_t pos, seq;
+    intptr_t diff;
 
     if (size > msgq->msg_size)
     {
         XMA_DBG_PRINTF("XMA msgq enqueue: too Large\n");
         return XMA_MSGQ_MSG_TOO_LARGE;
     }
-    
-    uint8_t *msgdst = msgq->msg_array + (msgq->msg_size * msgq->back);
+
+    /* Claim the slot at enqueue_pos once its consumer has released it */
+    pos = __atomic_load_n(&msgq->enqueue_pos, __ATOMIC_RELAXED);
+    for (;;)
+    {
+        seq = __atomic_load_n(&msgq->msg_seq[pos % msgq->max_msg_entries],
+                              __ATOMIC_ACQUIRE);
+        diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&msgq->enqueue_pos, &pos, pos + 1,
+                                            true, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED))
+                break;
+        }
+        else if (diff < 0)
+        {
+            XMA_DBG_PRINTF("XMA msgq enqueue: full\n");
+            __atomic_fetch_add(&msgq->dropped, 1, __ATOMIC_RELAXED);
+            return XMA_MSGQ_FULL;
+        }
+        else
+            pos = __atomic_load_n(&msgq->enqueue_pos, __ATOMIC_RELAXED);
+    }
+
+    uint8_t *msgdst = msgq->msg_array +
+                      (msgq->msg_size * (pos % msgq->max_msg_entries));
     memcpy(msgdst, msg, size);
-    
-    msgq->back = (msgq->back + 1) % (msgq->max_msg_entries);
-    msgq->num_entries++;
+    __atomic_store_n(&msgq->msg_seq[pos % msgq->max_msg_entries], pos + 1,
+                     __ATOMIC_RELEASE);
 
     return 0;
 }
-    
+
+/* Single consumer only */
 int32_t xma_msgq_dequeue(XmaMsgQ *msgq, void *msg, size_t size)
 {
-    if (xma_msgq_isempty(msgq))
-    {
-        XMA_DBG_PRINTF("XMA msgq dequeue: empty\n");
-        return XMA_MSGQ_EMPTY;
-    }
+    size_t pos = msgq->dequeue_pos;
+    size_t idx = pos % msgq->max_msg_entries;
 
     if (size < msgq->msg_size)
     {
@@ -323,15 +376,28 @@ int32_t xma_msgq_dequeue(XmaMsgQ *msgq, void *msg, size_t size)
         return XMA_MSGQ_MSG_TOO_SMALL;
     }
 
-    uint8_t *msgsrc = msgq->msg_array + (msgq->msg_size * msgq->front); 
-    memcpy(msg, msgsrc, msgq->msg_size); 
+    if (xma_msgq_isempty(msgq))
+    {
+        XMA_DBG_PRINTF("XMA msgq dequeue: empty\n");
+        return XMA_MSGQ_EMPTY;
+    }
+
+    uint8_t *msgsrc = msgq->msg_array + (msgq->msg_size * idx);
+    memcpy(msg, msgsrc, msgq->msg_size);
 
-    msgq->front = (msgq->front + 1) % (msgq->max_msg_entries);
-    msgq->num_entries--;
+    /* Hand the slot to the producer one lap ahead */
+    __atomic_store_n(&msgq->msg_seq[idx], pos + msgq->max_msg_entries,
+                     __ATOMIC_RELEASE);
+    msgq->dequeue_pos = pos + 1;
 
     return 0;
 }
 
+uint64_t xma_msgq_take_dropped(XmaMsgQ *msgq)
+{
+    return __atomic_exchange_n(&msgq->dropped, 0, __ATOMIC_RELAXED);
+}
+
 /* XmaActor APIs */
 XmaActor *xma_actor_create(XmaThreadFunc    func,
                            size_t           msg_size,
@@ -340,7 +406,7 @@ XmaActor *xma_actor_create(XmaThreadFunc    func,
     XmaActor *actor = malloc(sizeof(XmaActor));
     pthread_mutex_init(&actor->lock, NULL);
     pthread_cond_init(&actor->queued_cond, NULL);
-    pthread_cond_init(&actor->dequeued_cond, NULL);
+    actor->waiting = 0;
     actor->msg_q = xma_msgq_create(msg_size, max_msg_entries);
     actor->thread = xma_thread_create(func, actor);
     
@@ -356,9 +422,11 @@ void xma_actor_destroy(XmaActor *actor)
 {
     char *shutdown = "shutdown\0";
 
-    /* Send shutdown message to Actor */
+    /* Send shutdown message to Actor, it must not be dropped */
     XMA_DBG_PRINTF("XMA sending shutdown message\n");
-    xma_actor_sendmsg(actor, shutdown, strlen(shutdown));
+    while (xma_actor_sendmsg(actor, shutdown, strlen(shutdown)) ==
+           XMA_MSGQ_FULL)
+        sched_yield();
     xma_thread_join(actor->thread);
     xma_msgq_destroy(actor->msg_q);
     xma_thread_destroy(actor->thread);
@@ -369,67 +437,40 @@ void xma_actor_destroy(XmaActor *actor)
 int32_t xma_actor_sendmsg(XmaActor *actor, void *msg, size_t msg_size)
 {
     int32_t rc;
-    bool    was_empty;
 
-    pthread_mutex_lock(&actor->lock);
-    XMA_DBG_PRINTF("XMA actor sendmsg on entry depth=%d, front=%d, back=%d\n", 
-            actor->msg_q->num_entries,
-            actor->msg_q->front,
-            actor->msg_q->back);
-    if (xma_msgq_isfull(actor->msg_q))
-    {
-        XMA_DBG_PRINTF("Waiting: msgq_isfull\n");
-        pthread_cond_wait(&actor->dequeued_cond, &actor->lock);
-        XMA_DBG_PRINTF("Waiting: msgq_isfull done\n");
-    }
-    was_empty = xma_msgq_isempty(actor->msg_q);
     rc = xma_msgq_enqueue(actor->msg_q, msg, msg_size);
-    if (rc == 0 && was_empty)
+    if (rc != 0)
+        return rc;
+
+    /* Pairs with the actor publishing waiting before its last empty
+       check, either it sees the message or we see it waiting */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&actor->waiting, __ATOMIC_RELAXED))
     {
-        XMA_DBG_PRINTF("Sending queued_cond for previously empty queue\n");
+        XMA_DBG_PRINTF("Sending queued_cond for waiting actor\n");
+        pthread_mutex_lock(&actor->lock);
         pthread_cond_broadcast(&actor->queued_cond);
+        pthread_mutex_unlock(&actor->lock);
     }
 
-    XMA_DBG_PRINTF("XMA actor sendmsg on exit depth=%d, front=%d, back=%d\n", 
-            actor->msg_q->num_entries,
-            actor->msg_q->front,
-            actor->msg_q->back);
-
-    pthread_mutex_unlock(&actor->lock);
-
-    return rc; 
-        
+    return 0;
 }
 
 int32_t xma_actor_recvmsg(XmaActor *actor, void *msg, size_t msg_size)
 {
     int32_t rc;
-    bool    was_full;
-
-    pthread_mutex_lock(&actor->lock);
-
-    XMA_DBG_PRINTF("XMA actor recvmsg on entry depth=%d, front=%d, back=%d\n", 
-            actor->msg_q->num_entries,
-            actor->msg_q->front,
-            actor->msg_q->back);
 
-
-    if (xma_msgq_isempty(actor->msg_q))
-        pthread_cond_wait(&actor->queued_cond, &actor->lock);
-
-    was_full = xma_msgq_isfull(actor->msg_q);
     rc = xma_msgq_dequeue(actor->msg_q, msg, msg_size);
-    if (was_full)
-    {
-        XMA_DBG_PRINTF("sending dequeued_cond\n");
-        pthread_cond_broadcast(&actor->dequeued_cond);
-    }
-
-    XMA_DBG_PRINTF("XMA actor recvmsg on exit depth=%d, front=%d, back=%d\n", 
-            actor->msg_q->num_entries,
-            actor->msg_q->front,
-            actor->msg_q->back);
+    if (rc != XMA_MSGQ_EMPTY)
+        return rc;
 
+    pthread_mutex_lock(&actor->lock);
+    __atomic_store_n(&actor->waiting, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    while ((rc = xma_msgq_dequeue(actor->msg_q, msg, msg_size)) ==
+           XMA_MSGQ_EMPTY)
+        pthread_cond_wait(&actor->queued_cond, &actor->lock);
+    __atomic_store_n(&actor->waiting, 0, __ATOMIC_RELAXED);
     pthread_mutex_unlock(&actor->lock);
 
     return rc;
@@ -93,12 +93,15 @@ typedef struct XmaImage {
 typedef struct XmaKernelChan {
     pthread_t thread_id;
     XmaSession *session;
+    uint64_t load; /**< load units reported by plugin for session */
 } XmaKernelChan;
 
 typedef struct XmaKernelInstance {
+    pthread_mutex_t lock; /**< guards client_id, channels and load */
     uint32_t kernel_id;
     pid_t client_id;
     XmaKernelChan channels[MAX_KERNEL_CHANS];
+    uint64_t load; /**< sum of channel loads */
 } XmaKernelInstance;
 
 typedef struct XmaDevice {
@@ -116,13 +119,50 @@ typedef struct XmaShmRes {
     XmaImage images[MAX_IMAGE_CONFIGS];
 } XmaShmRes;
 
+/**
+ * Parsed system configuration and device kernel table of the process that
+ * configured the hardware, reused by later processes while the
+ * configuration file is unchanged
+*/
+typedef struct XmaCfgCache {
+    bool valid;
+    char cfgfile[PATH_MAX];
+    struct timespec mtime;
+    off_t size;
+    XmaSystemCfg systemcfg;
+    XmaHwCfg hwcfg; /**< device handles are per process and not kept */
+} XmaCfgCache;
+
 typedef struct XmaResConfig {
     XmaShmRes sys_res;
     pthread_mutex_t lock;
     pid_t clients[MAX_XILINX_DEVICES * MAX_KERNEL_CONFIGS];
     uint32_t ref_cnt;
+    XmaCfgCache cfg_cache;
 } XmaResConfig;
 
+/**
+ * Plugin callbacks of a kernel matching an allocation request
+*/
+typedef struct XmaKernPluginOps {
+    int32_t (*alloc_chan)(XmaSession *pending,
+                          XmaSession **current,
+                          uint32_t sess_cnt);
+    uint64_t (*get_load)(XmaSession *pending);
+    size_t kernel_data_size;
+} XmaKernPluginOps;
+
+/**
+ * Kernel considered by load balanced allocation
+*/
+typedef struct XmaKernCandidate {
+    int32_t dev_id;
+    int32_t kern_idx;
+    uint64_t kern_load;
+    uint64_t dev_load;
+    XmaKernPluginOps ops;
+} XmaKernCandidate;
+
 /**********************************GLOBALS*************************************/
 #ifdef XMA_RES_TEST
 char *XMA_SHM_FILE = "/tmp/xma_shm_db";
@@ -144,6 +184,14 @@ static int xma_shm_lock(XmaResConfig *xma_shm);
 
 static int xma_shm_unlock(XmaResConfig *xma_shm);
 
+static void xma_shm_mutex_init(pthread_mutex_t *lock);
+
+static int xma_robust_mutex_lock(pthread_mutex_t *lock);
+
+static int xma_kern_lock(XmaResConfig *xma_shm, XmaKernelInstance *kernel_inst);
+
+static int xma_kern_unlock(XmaKernelInstance *kernel_inst);
+
 static int xma_verify_process_res(pid_t pid);
 
 static int xma_verify_shm_client_procs(XmaResConfig *xma_shm,
@@ -160,6 +208,18 @@ static int32_t xma_res_alloc_kernel(XmaResources shm_cfg,
                                     XmaKernReq *kern_props,
                                     enum XmaKernType type);
 
+static int32_t xma_res_alloc_balanced_kernel(XmaResources shm_cfg,
+                                             XmaSession *session,
+                                             XmaKernReq *kern_props,
+                                             enum XmaKernType type);
+
+static bool xma_res_kern_match(XmaResConfig *xma_shm,
+                               XmaDevice *dev,
+                               int kern_idx,
+                               XmaKernReq *kern_props,
+                               enum XmaKernType type,
+                               XmaKernPluginOps *ops);
+
 static int xma_client_thread_kernel_alloc(XmaResources shm_cfg,
                                           XmaDevice *dev,
                                           int dev_kern_idx,
@@ -167,7 +227,8 @@ static int xma_client_thread_kernel_alloc(XmaResources shm_cfg,
                                           size_t kernel_data_size,
                                           int32_t (*alloc_chan)(XmaSession *p,
                                                                 XmaSession **s,
-                                                                uint32_t cnt));
+                                                                uint32_t cnt),
+                                          uint64_t load);
 
 static int xma_client_thread_kernel_free(XmaDevice *dev,
                                          pid_t proc_id,
@@ -181,6 +242,15 @@ static XmaKernReq *xma_res_create_kern_req(enum XmaKernType type,
 
 static int xma_free_dev(XmaResConfig *xma_shm, int32_t dev_handle, pid_t pid);
 
+static uint64_t xma_res_session_load(XmaKernPluginOps *ops,
+                                     XmaSession *session);
+
+static bool xma_dev_proc_active(XmaDevice *dev, pid_t proc_id);
+
+static int xma_res_rebalance_cands(XmaResConfig *xma_shm,
+                                   XmaSession *session,
+                                   XmaKernCandidate *cands);
+
 static void xma_free_all_kernel_chan_res(XmaDevice *dev, pid_t pid);
 
 static void xma_free_all_proc_res(XmaResConfig *xma_shm, pid_t proc_id);
@@ -367,11 +437,11 @@ int32_t xma_res_free_kernel(XmaResources shm_cfg, XmaKernelRes kern_res)
         return XMA_ERROR;
 
     dev = &xma_shm->sys_res.devices[dev_handle];
-    if (xma_shm_lock(xma_shm))
+    if (xma_kern_lock(xma_shm, &dev->kernels[kern_handle]))
         return XMA_ERROR;
     ret = xma_client_thread_kernel_free(dev, proc_id, thread_id,
                                         kern_handle, session);
-    xma_shm_unlock(xma_shm);
+    xma_kern_unlock(&dev->kernels[kern_handle]);
     free(kern_req);
     return ret;
 }
@@ -393,6 +463,114 @@ int32_t xma_res_free_dev(XmaResources shm_cfg, int32_t dev_handle)
     return ret;
 }
 
+int32_t xma_res_rebalance_check(XmaResources shm_cfg, XmaSession *session)
+{
+    XmaResConfig *xma_shm = (XmaResConfig *)shm_cfg;
+    XmaKernCandidate cands[MAX_XILINX_DEVICES * MAX_KERNEL_CONFIGS];
+
+    if (!shm_cfg || !session || !session->kern_res)
+        return XMA_ERROR_INVALID;
+
+    return xma_res_rebalance_cands(xma_shm, session, cands) > 0 ?
+           XMA_SUCCESS : XMA_ERROR_NO_DEV;
+}
+
+int32_t xma_res_rebalance_kernel(XmaResources shm_cfg, XmaSession *session)
+{
+    XmaResConfig *xma_shm = (XmaResConfig *)shm_cfg;
+    XmaKernCandidate cands[MAX_XILINX_DEVICES * MAX_KERNEL_CONFIGS];
+    XmaKernReq *old_req, *new_req;
+    XmaDevice *old_dev;
+    void *old_data, *new_data;
+    int32_t old_chan;
+    pid_t proc_id = getpid();
+    int cand_cnt, i, ret;
+
+    if (!shm_cfg || !session || !session->kern_res)
+        return XMA_ERROR_INVALID;
+
+    cand_cnt = xma_res_rebalance_cands(xma_shm, session, cands);
+    if (cand_cnt < 0)
+        return XMA_ERROR;
+    if (!cand_cnt)
+        return XMA_ERROR_NO_DEV;
+
+    old_req = (XmaKernReq *)session->kern_res;
+    new_req = xma_res_create_kern_req(old_req->type, old_req->vendor,
+                                      old_req->dev_excl);
+    if (!new_req)
+        return XMA_ERROR;
+    new_req->kernel_spec = old_req->kernel_spec;
+
+    /* the session keeps its current kernel until the new one is aquired */
+    old_data = session->kernel_data;
+    old_chan = session->chan_id;
+    for (i = 0; i < cand_cnt; i++)
+    {
+        XmaKernCandidate *cand = &cands[i];
+        XmaDevice *dev = &xma_shm->sys_res.devices[cand->dev_id];
+        int kern_id = dev->kernels[cand->kern_idx].kernel_id;
+        XmaKernel *kernel =
+            &xma_shm->sys_res.images[dev->image_id].kernels[kern_id];
+        uint64_t load = xma_res_session_load(&cand->ops, session);
+        bool dev_in_use;
+
+        if (xma_shm_lock(xma_shm))
+            break;
+        dev_in_use = xma_dev_proc_active(dev, proc_id);
+        ret = xma_alloc_dev(xma_shm, cand->dev_id, new_req->dev_excl);
+        xma_shm_unlock(xma_shm);
+        if (ret < 0)
+            continue;
+
+        session->kernel_data = NULL;
+        session->chan_id = -1;
+        ret = xma_client_thread_kernel_alloc(shm_cfg, dev, cand->kern_idx,
+                                             session,
+                                             cand->ops.kernel_data_size,
+                                             cand->ops.alloc_chan, load);
+        if (ret) {
+            session->kernel_data = old_data;
+            session->chan_id = old_chan;
+            if (!dev_in_use) {
+                if (xma_shm_lock(xma_shm))
+                    break;
+                xma_free_dev(xma_shm, cand->dev_id, proc_id);
+                xma_shm_unlock(xma_shm);
+            }
+            continue;
+        }
+
+        new_req->dev_handle = cand->dev_id;
+        new_req->kern_handle = cand->kern_idx;
+        new_req->plugin_handle = kernel->plugin_handle;
+        new_req->session = session;
+
+        /* release the old channel with the kernel data it was given */
+        new_data = session->kernel_data;
+        session->kernel_data = old_data;
+        old_dev = &xma_shm->sys_res.devices[old_req->dev_handle];
+        xma_res_free_kernel(shm_cfg, (XmaKernelRes)old_req);
+        session->kernel_data = new_data;
+        session->kern_res = (XmaKernelRes)new_req;
+
+        if (!xma_shm_lock(xma_shm)) {
+            if (!xma_dev_proc_active(old_dev, proc_id))
+                xma_free_dev(xma_shm, old_dev - xma_shm->sys_res.devices,
+                             proc_id);
+            xma_shm_unlock(xma_shm);
+        }
+
+        xma_logmsg(XMA_INFO_LOG, XMA_RES_MOD,
+                   "%s() Session moved to kernel %d on device %d, load %lu\n",
+                   __func__, cand->kern_idx, cand->dev_id, load);
+        return XMA_SUCCESS;
+    }
+
+    free(new_req);
+    return i < cand_cnt ? XMA_ERROR : XMA_ERROR_NO_DEV;
+}
+
 int32_t xma_res_dev_handle_get(XmaKernelRes *kern_res)
 {
     XmaKernReq *kern_req = (XmaKernReq *)kern_res;
@@ -488,8 +666,6 @@ static XmaResConfig *xma_shm_open(char *shm_filename, XmaSystemCfg *config)
     int ret, fd;
     XmaResConfig *shm_map;
 
-    pthread_mutexattr_t proc_shared_lock;
-
     xma_logmsg(XMA_DEBUG_LOG, XMA_RES_MOD, "%s()\n", __func__);
     /* JPM TODO consider replacing with shm_open() */
     fd = open(shm_filename, O_RDWR | O_CREAT | O_EXCL, 0666);
@@ -503,13 +679,10 @@ static XmaResConfig *xma_shm_open(char *shm_filename, XmaSystemCfg *config)
     if (ret)
         return NULL; /*JPM log proper error message */
 
-    pthread_mutexattr_init(&proc_shared_lock);
-    pthread_mutexattr_setpshared(&proc_shared_lock, PTHREAD_PROCESS_SHARED);
-    pthread_mutexattr_setrobust(&proc_shared_lock, PTHREAD_MUTEX_ROBUST);
     shm_map = (XmaResConfig *)mmap(NULL, sizeof(XmaResConfig),
                PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
     close(fd);
-    pthread_mutex_init(&shm_map->lock, &proc_shared_lock);
+    xma_shm_mutex_init(&shm_map->lock);
     ret = xma_init_shm(shm_map, config, false);
     if (ret)
         return NULL;
@@ -581,6 +754,80 @@ bool xma_res_xma_init_completed(void)
     return stat(XMA_SHM_FILE_SIG, &stat_buf) == 0 ? true : false;
 }
 
+bool xma_res_cfg_cache_get(const char *cfgfile, XmaSystemCfg *config,
+                           XmaHwCfg *hwcfg)
+{
+    XmaResConfig *shm_map;
+    XmaCfgCache *cache;
+    struct stat cfg_stat, shm_stat;
+    bool hit = false;
+    int fd, i;
+
+    xma_set_shm_filenames();
+    if (!xma_res_xma_init_completed() || stat(cfgfile, &cfg_stat))
+        return false;
+
+    fd = open(XMA_SHM_FILE, O_RDWR);
+    if (fd < 0)
+        return false;
+    if (fstat(fd, &shm_stat) || shm_stat.st_size != sizeof(XmaResConfig)) {
+        close(fd);
+        return false;
+    }
+    shm_map = (XmaResConfig *)mmap(NULL, sizeof(XmaResConfig),
+               PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm_map == MAP_FAILED)
+        return false;
+
+    if (xma_robust_mutex_lock(&shm_map->lock)) {
+        munmap(shm_map, sizeof(XmaResConfig));
+        return false;
+    }
+    cache = &shm_map->cfg_cache;
+    if (cache->valid &&
+        strcmp(cache->cfgfile, cfgfile) == 0 &&
+        cache->mtime.tv_sec == cfg_stat.st_mtim.tv_sec &&
+        cache->mtime.tv_nsec == cfg_stat.st_mtim.tv_nsec &&
+        cache->size == cfg_stat.st_size) {
+        *config = cache->systemcfg;
+        *hwcfg = cache->hwcfg;
+        for (i = 0; i < MAX_XILINX_DEVICES; i++)
+            hwcfg->devices[i].handle = NULL;
+        hit = true;
+    }
+    pthread_mutex_unlock(&shm_map->lock);
+    munmap(shm_map, sizeof(XmaResConfig));
+
+    return hit;
+}
+
+void xma_res_cfg_cache_put(XmaResources shm_cfg, const char *cfgfile,
+                           XmaSystemCfg *config, XmaHwCfg *hwcfg)
+{
+    XmaResConfig *xma_shm = (XmaResConfig *)shm_cfg;
+    XmaCfgCache *cache;
+    struct stat cfg_stat;
+    int i;
+
+    xma_logmsg(XMA_DEBUG_LOG, XMA_RES_MOD, "%s()\n", __func__);
+    if (stat(cfgfile, &cfg_stat) || strlen(cfgfile) >= PATH_MAX)
+        return;
+
+    if (xma_shm_lock(xma_shm))
+        return;
+    cache = &xma_shm->cfg_cache;
+    strcpy(cache->cfgfile, cfgfile);
+    cache->mtime = cfg_stat.st_mtim;
+    cache->size = cfg_stat.st_size;
+    cache->systemcfg = *config;
+    cache->hwcfg = *hwcfg;
+    for (i = 0; i < MAX_XILINX_DEVICES; i++)
+        cache->hwcfg.devices[i].handle = NULL;
+    cache->valid = true;
+    xma_shm_unlock(xma_shm);
+}
+
 static int xma_init_shm(XmaResConfig *xma_shm,
                         XmaSystemCfg *config, bool shm_locked)
 {
@@ -605,6 +852,12 @@ static int xma_init_shm(XmaResConfig *xma_shm,
         return XMA_ERROR;
 
     memset(&xma_shm->sys_res, 0, sizeof(XmaShmRes));
+    xma_shm->cfg_cache.valid = false;
+
+    /* kernel instances are locked individually for channel allocation */
+    for (i = 0; i < MAX_XILINX_DEVICES; i++)
+        for (j = 0; j < MAX_KERNEL_CONFIGS; j++)
+            xma_shm_mutex_init(&shm_devices[i].kernels[j].lock);
 
     /* init device data */
     for (i = 0, cfg_dev_idx = 0; i < dev_cnt; i++, cfg_dev_idx++) {
@@ -832,25 +1085,90 @@ static int xma_free_dev(XmaResConfig *xma_shm, int32_t dev_handle,
     return XMA_ERROR_INVALID;
 }
 
+static bool xma_res_kern_match(XmaResConfig *xma_shm,
+                               XmaDevice *dev,
+                               int kern_idx,
+                               XmaKernReq *kern_props,
+                               enum XmaKernType type,
+                               XmaKernPluginOps *ops)
+{
+    extern XmaSingleton *g_xma_singleton;
+    int str_cmp1 = -1, str_cmp2 = -1, type_cmp = false;
+    int kern_id = dev->kernels[kern_idx].kernel_id;
+    XmaKernel *kernel =
+        &xma_shm->sys_res.images[dev->image_id].kernels[kern_id];
+    XmaScalerPlugin *scaler;
+    XmaDecoderPlugin *decoder;
+    XmaEncoderPlugin *encoder;
+    XmaFilterPlugin *filter;
+    XmaKernelPlugin *kernplg;
+
+    memset(ops, 0, sizeof(XmaKernPluginOps));
+    str_cmp1 = strcmp(kernel->vendor, kern_props->vendor);
+    if (type == xma_res_scaler) {
+        scaler = &g_xma_singleton->scalercfg[kernel->plugin_handle];
+        str_cmp2 = strcmp(kernel->function, XMA_CFG_FUNC_NM_SCALE);
+        type_cmp = scaler->hwscaler_type ==
+                   kern_props->kernel_spec.scal_type ? true : false;
+        ops->alloc_chan = scaler->alloc_chan;
+        ops->get_load = scaler->get_load;
+    } else if (type == xma_res_encoder) {
+        encoder = &g_xma_singleton->encodercfg[kernel->plugin_handle];
+        str_cmp2 = strcmp(kernel->function, XMA_CFG_FUNC_NM_ENC);
+        type_cmp = encoder->hwencoder_type ==
+                   kern_props->kernel_spec.enc_type ? true : false;
+        ops->alloc_chan = encoder->alloc_chan;
+        ops->get_load = encoder->get_load;
+        ops->kernel_data_size = encoder->kernel_data_size;
+    } else if (type == xma_res_decoder) {
+        decoder = &g_xma_singleton->decodercfg[kernel->plugin_handle];
+        str_cmp2 = strcmp(kernel->function, XMA_CFG_FUNC_NM_DEC);
+        type_cmp = decoder->hwdecoder_type ==
+                   kern_props->kernel_spec.dec_type ? true : false;
+        ops->get_load = decoder->get_load;
+    } else if (type == xma_res_filter) {
+        filter = &g_xma_singleton->filtercfg[kernel->plugin_handle];
+        str_cmp2 = strcmp(kernel->function, XMA_CFG_FUNC_NM_FILTER);
+        type_cmp = filter->hwfilter_type ==
+                   kern_props->kernel_spec.filter_type ? true : false;
+        ops->alloc_chan = filter->alloc_chan;
+        ops->get_load = filter->get_load;
+    } else if (type == xma_res_kernel) {
+        kernplg = &g_xma_singleton->kernelcfg[kernel->plugin_handle];
+        str_cmp2 = strcmp(kernel->function, XMA_CFG_FUNC_NM_KERNEL);
+        type_cmp = kernplg->hwkernel_type ==
+                   kern_props->kernel_spec.kernel_type ? true : false;
+        ops->get_load = kernplg->get_load;
+    }
+
+    return str_cmp1 == 0 && str_cmp2 == 0 && type_cmp;
+}
+
+static uint64_t xma_res_session_load(XmaKernPluginOps *ops,
+                                     XmaSession *session)
+{
+    return ops->get_load ? ops->get_load(session) : 1;
+}
+
 static int32_t xma_res_alloc_kernel(XmaResources shm_cfg,
                                          XmaSession *session,
                                          XmaKernReq *kern_props,
                                          enum XmaKernType type)
 {
-    int32_t (*plugin_alloc_chan)(XmaSession *pending,
-                                 XmaSession **current,
-                                 uint32_t sess_cnt);
     XmaResConfig *xma_shm = (XmaResConfig *)shm_cfg;
     pid_t proc_id = getpid();
     extern XmaSingleton *g_xma_singleton;
     int kern_idx, dev_id;
     bool kern_aquired = false;
-    size_t kernel_data_size;
 
     xma_logmsg(XMA_DEBUG_LOG, XMA_RES_MOD, "%s()\n", __func__);
     if (!session)
         return XMA_ERROR_INVALID;
 
+    if (g_xma_singleton->systemcfg.alloc_policy != XMA_ALLOC_FIRST_FIT)
+        return xma_res_alloc_balanced_kernel(shm_cfg, session,
+                                             kern_props, type);
+
     for (dev_id = -1; !kern_aquired && (dev_id < MAX_XILINX_DEVICES);)
     {
         XmaDevice *dev;
@@ -869,60 +1187,20 @@ static int32_t xma_res_alloc_kernel(XmaResources shm_cfg,
              kern_idx < dev->kernel_cnt && !kern_aquired;
              kern_idx++)
         {
-            int str_cmp1 = -1, str_cmp2 = -1, type_cmp = false;
-            int kern_id = dev->kernels[kern_idx].kernel_id;
-            XmaKernel *kernel =
-                &xma_shm->sys_res.images[dev->image_id].kernels[kern_id];
-            XmaScalerPlugin *scaler;
-            XmaDecoderPlugin *decoder;
-            XmaEncoderPlugin *encoder;
-            XmaFilterPlugin *filter;
-            XmaKernelPlugin *kernplg;
-            plugin_alloc_chan = NULL;
-
-            str_cmp1 = strcmp(kernel->vendor, kern_props->vendor);
-            if (type == xma_res_scaler) {
-                scaler = &g_xma_singleton->scalercfg[kernel->plugin_handle];
-                str_cmp2 = strcmp(kernel->function, XMA_CFG_FUNC_NM_SCALE);
-                type_cmp = scaler->hwscaler_type ==
-                           kern_props->kernel_spec.scal_type ? true : false;
-                plugin_alloc_chan = scaler->alloc_chan;
-                kernel_data_size = 0;
-            } else if (type == xma_res_encoder) {
-                encoder = &g_xma_singleton->encodercfg[kernel->plugin_handle];
-                str_cmp2 = strcmp(kernel->function, XMA_CFG_FUNC_NM_ENC);
-                type_cmp = encoder->hwencoder_type ==
-                           kern_props->kernel_spec.enc_type ? true : false;
-                plugin_alloc_chan = encoder->alloc_chan;
-                kernel_data_size = encoder->kernel_data_size;
-            } else if (type == xma_res_decoder) {
-                decoder = &g_xma_singleton->decodercfg[kernel->plugin_handle];
-                str_cmp2 = strcmp(kernel->function, XMA_CFG_FUNC_NM_DEC);
-                type_cmp = decoder->hwdecoder_type ==
-                           kern_props->kernel_spec.dec_type ? true : false;
-                plugin_alloc_chan = NULL;
-                kernel_data_size = 0;
-            } else if (type == xma_res_filter) {
-                filter = &g_xma_singleton->filtercfg[kernel->plugin_handle];
-                str_cmp2 = strcmp(kernel->function, XMA_CFG_FUNC_NM_FILTER);
-                type_cmp = filter->hwfilter_type ==
-                           kern_props->kernel_spec.filter_type ? true : false;
-                plugin_alloc_chan = filter->alloc_chan;
-                kernel_data_size = 0;
-            } else if (type == xma_res_kernel) {
-                kernplg = &g_xma_singleton->kernelcfg[kernel->plugin_handle];
-                str_cmp2 = strcmp(kernel->function, XMA_CFG_FUNC_NM_KERNEL);
-                type_cmp = kernplg->hwkernel_type ==
-                           kern_props->kernel_spec.kernel_type ? true : false;
-                kernel_data_size = 0;
-            }
+            XmaKernPluginOps ops;
 
-            if (str_cmp1 == 0 && str_cmp2 == 0 && type_cmp) {
+            if (xma_res_kern_match(xma_shm, dev, kern_idx, kern_props,
+                                   type, &ops)) {
+                int kern_id = dev->kernels[kern_idx].kernel_id;
+                XmaKernel *kernel =
+                    &xma_shm->sys_res.images[dev->image_id].kernels[kern_id];
                 /* register client thread id with kernel */
                     ret = xma_client_thread_kernel_alloc(shm_cfg, dev, kern_idx,
                                                          session,
-                                                         kernel_data_size,
-                                                         plugin_alloc_chan);
+                                                         ops.kernel_data_size,
+                                                         ops.alloc_chan,
+                                                         xma_res_session_load(&ops,
+                                                                              session));
                     if (ret)
                         continue;
 
@@ -933,7 +1211,6 @@ static int32_t xma_res_alloc_kernel(XmaResources shm_cfg,
                     kern_aquired = true;
             }
         }
-
         if (!kern_aquired) {
             xma_logmsg(XMA_DEBUG_LOG, XMA_RES_MOD,
                        "%s() Unable to locate requested %s kernel type\n",
@@ -969,6 +1246,236 @@ static int32_t xma_res_alloc_kernel(XmaResources shm_cfg,
 
 }
 
+/* Order in which load balanced allocation tries candidate kernels */
+static bool xma_res_cand_before(const XmaKernCandidate *a,
+                                const XmaKernCandidate *b,
+                                XmaAllocPolicy policy)
+{
+    switch (policy) {
+    case XMA_ALLOC_LEAST_LOADED:
+        return a->kern_load < b->kern_load;
+    case XMA_ALLOC_SPREAD:
+        if (a->dev_load != b->dev_load)
+            return a->dev_load < b->dev_load;
+        return a->kern_load < b->kern_load;
+    case XMA_ALLOC_PACK:
+        if (a->dev_load != b->dev_load)
+            return a->dev_load > b->dev_load;
+        return a->kern_load > b->kern_load;
+    default:
+        return false;
+    }
+}
+
+/* Does process have a session on any kernel of device */
+static bool xma_dev_proc_active(XmaDevice *dev, pid_t proc_id)
+{
+    int i;
+
+    for (i = 0; i < MAX_KERNEL_CONFIGS && i < dev->kernel_cnt; i++)
+        if (dev->kernels[i].client_id == proc_id)
+            return true;
+
+    return false;
+}
+
+static int32_t xma_res_alloc_balanced_kernel(XmaResources shm_cfg,
+                                             XmaSession *session,
+                                             XmaKernReq *kern_props,
+                                             enum XmaKernType type)
+{
+    XmaResConfig *xma_shm = (XmaResConfig *)shm_cfg;
+    extern XmaSingleton *g_xma_singleton;
+    XmaAllocPolicy policy = g_xma_singleton->systemcfg.alloc_policy;
+    XmaKernCandidate cands[MAX_XILINX_DEVICES * MAX_KERNEL_CONFIGS];
+    pid_t proc_id = getpid();
+    int cand_cnt = 0, dev_id = -1, i, j;
+
+    xma_logmsg(XMA_DEBUG_LOG, XMA_RES_MOD, "%s() policy %d\n",
+               __func__, policy);
+
+    /* snapshot loads of matching kernels on devices available to us */
+    if (xma_shm_lock(xma_shm))
+        return XMA_ERROR;
+    while (xma_get_next_free_dev(xma_shm, &dev_id) == XMA_SUCCESS)
+    {
+        XmaDevice *dev = &xma_shm->sys_res.devices[dev_id];
+        uint64_t dev_load = 0;
+        int kern_idx;
+
+        for (kern_idx = 0;
+             kern_idx < MAX_KERNEL_CONFIGS && kern_idx < dev->kernel_cnt;
+             kern_idx++)
+            dev_load += dev->kernels[kern_idx].load;
+
+        for (kern_idx = 0;
+             kern_idx < MAX_KERNEL_CONFIGS && kern_idx < dev->kernel_cnt;
+             kern_idx++)
+        {
+            XmaKernelInstance *kernel_inst = &dev->kernels[kern_idx];
+            XmaKernCandidate *cand = &cands[cand_cnt];
+
+            if (kernel_inst->client_id && kernel_inst->client_id != proc_id)
+                continue; /* some other process has this kernel */
+            if (!xma_res_kern_match(xma_shm, dev, kern_idx, kern_props,
+                                    type, &cand->ops))
+                continue;
+
+            cand->dev_id = dev_id;
+            cand->kern_idx = kern_idx;
+            cand->kern_load = kernel_inst->load;
+            cand->dev_load = dev_load;
+            cand_cnt++;
+        }
+    }
+    xma_shm_unlock(xma_shm);
+
+    /* stable insertion sort, ties keep device order */
+    for (i = 1; i < cand_cnt; i++)
+    {
+        XmaKernCandidate cand = cands[i];
+
+        for (j = i; j > 0 && xma_res_cand_before(&cand, &cands[j-1], policy); j--)
+            cands[j] = cands[j-1];
+        cands[j] = cand;
+    }
+
+    /* loads may have changed since the snapshot, the first kernel that
+     * still accepts the session wins */
+    for (i = 0; i < cand_cnt; i++)
+    {
+        XmaKernCandidate *cand = &cands[i];
+        XmaDevice *dev = &xma_shm->sys_res.devices[cand->dev_id];
+        int kern_id = dev->kernels[cand->kern_idx].kernel_id;
+        XmaKernel *kernel =
+            &xma_shm->sys_res.images[dev->image_id].kernels[kern_id];
+        uint64_t load = xma_res_session_load(&cand->ops, session);
+        bool dev_in_use;
+        int ret;
+
+        if (xma_shm_lock(xma_shm))
+            return XMA_ERROR;
+        dev_in_use = xma_dev_proc_active(dev, proc_id);
+        ret = xma_alloc_dev(xma_shm, cand->dev_id, kern_props->dev_excl);
+        xma_shm_unlock(xma_shm);
+        if (ret < 0)
+            continue;
+
+        ret = xma_client_thread_kernel_alloc(shm_cfg, dev, cand->kern_idx,
+                                             session,
+                                             cand->ops.kernel_data_size,
+                                             cand->ops.alloc_chan, load);
+        if (ret) {
+            /* release device unless other sessions of process use it */
+            if (!dev_in_use) {
+                if (xma_shm_lock(xma_shm))
+                    return XMA_ERROR;
+                xma_free_dev(xma_shm, cand->dev_id, proc_id);
+                xma_shm_unlock(xma_shm);
+            }
+            continue;
+        }
+
+        xma_logmsg(XMA_DEBUG_LOG, XMA_RES_MOD,
+                   "%s() Kernel %d on device %d, load %lu\n", __func__,
+                   cand->kern_idx, cand->dev_id, load);
+        kern_props->dev_handle = cand->dev_id;
+        kern_props->kern_handle = cand->kern_idx;
+        kern_props->plugin_handle = kernel->plugin_handle;
+        kern_props->session = session;
+        session->kern_res = (XmaKernelRes)kern_props;
+        return XMA_SUCCESS;
+    }
+
+    xma_logmsg(XMA_ERROR_LOG, XMA_RES_MOD, "No available kernels of type '%s' from vendor %s\n",
+               kern_props->kernel_spec.scal_type ? "scaler" :
+               kern_props->kernel_spec.enc_type ? "encoder" :
+               kern_props->kernel_spec.dec_type ? "decoder" :
+               kern_props->kernel_spec.filter_type ? "filter" :
+               "kernel", kern_props->vendor);
+    return XMA_ERROR_NO_KERNEL;
+}
+
+/* Kernels on other devices that would run a session with less load than
+ * its current device carries, least loaded device first.  A device only
+ * qualifies when it stays below the current one after the move, so two
+ * devices never trade the same session back and forth. */
+static int xma_res_rebalance_cands(XmaResConfig *xma_shm,
+                                   XmaSession *session,
+                                   XmaKernCandidate *cands)
+{
+    XmaKernReq *kern_req = (XmaKernReq *)session->kern_res;
+    XmaDevice *cur_dev;
+    XmaKernelInstance *cur_kern;
+    uint64_t cur_load = 0, sess_load = 0;
+    pid_t proc_id = getpid();
+    int cand_cnt = 0, dev_id = -1, i, j;
+
+    if (kern_req->dev_handle < 0 || kern_req->kern_handle < 0)
+        return XMA_ERROR_INVALID;
+
+    cur_dev = &xma_shm->sys_res.devices[kern_req->dev_handle];
+    cur_kern = &cur_dev->kernels[kern_req->kern_handle];
+
+    if (xma_shm_lock(xma_shm))
+        return XMA_ERROR;
+    for (i = 0; i < MAX_KERNEL_CONFIGS && i < cur_dev->kernel_cnt; i++)
+        cur_load += cur_dev->kernels[i].load;
+    for (i = 0; i < MAX_KERNEL_CHANS && cur_kern->channels[i].thread_id; i++)
+        if (cur_kern->channels[i].session == session)
+            sess_load = cur_kern->channels[i].load;
+
+    while (xma_get_next_free_dev(xma_shm, &dev_id) == XMA_SUCCESS)
+    {
+        XmaDevice *dev = &xma_shm->sys_res.devices[dev_id];
+        uint64_t dev_load = 0;
+        int kern_idx;
+
+        if (dev == cur_dev)
+            continue;
+
+        for (kern_idx = 0;
+             kern_idx < MAX_KERNEL_CONFIGS && kern_idx < dev->kernel_cnt;
+             kern_idx++)
+            dev_load += dev->kernels[kern_idx].load;
+        if (dev_load + sess_load >= cur_load)
+            continue;
+
+        for (kern_idx = 0;
+             kern_idx < MAX_KERNEL_CONFIGS && kern_idx < dev->kernel_cnt;
+             kern_idx++)
+        {
+            XmaKernelInstance *kernel_inst = &dev->kernels[kern_idx];
+            XmaKernCandidate *cand = &cands[cand_cnt];
+
+            if (kernel_inst->client_id && kernel_inst->client_id != proc_id)
+                continue; /* some other process has this kernel */
+            if (!xma_res_kern_match(xma_shm, dev, kern_idx, kern_req,
+                                    kern_req->type, &cand->ops))
+                continue;
+
+            cand->dev_id = dev_id;
+            cand->kern_idx = kern_idx;
+            cand->kern_load = kernel_inst->load;
+            cand->dev_load = dev_load;
+            cand_cnt++;
+        }
+    }
+    xma_shm_unlock(xma_shm);
+
+    for (i = 1; i < cand_cnt; i++)
+    {
+        XmaKernCandidate cand = cands[i];
+
+        for (j = i; j > 0 && xma_res_cand_before(&cand, &cands[j-1],
+                                                XMA_ALLOC_SPREAD); j--)
+            cands[j] = cands[j-1];
+        cands[j] = cand;
+    }
+
+    return cand_cnt;
+}
+
 static int32_t xma_client_thread_kernel_alloc(XmaResources shm_cfg,
                                               XmaDevice *dev,
                                               int dev_kern_idx,
@@ -977,7 +1484,8 @@ static int32_t xma_client_thread_kernel_alloc(XmaResources shm_cfg,
                                               int32_t (*alloc_chan)
                                                             (XmaSession *p,
                                                              XmaSession **c,
-                                                             uint32_t sess_cnt))
+                                                             uint32_t sess_cnt),
+                                              uint64_t load)
 {
     XmaKernelInstance *kernel_inst = &dev->kernels[dev_kern_idx];
     XmaResConfig *xma_shm = (XmaResConfig *)shm_cfg;
@@ -987,67 +1495,60 @@ static int32_t xma_client_thread_kernel_alloc(XmaResources shm_cfg,
     int j, ret;
 
     xma_logmsg(XMA_DEBUG_LOG, XMA_RES_MOD, "%s()\n", __func__);
-    if (xma_shm_lock(xma_shm))
+    /* only this kernel instance is locked, messages are logged once unlocked */
+    if (xma_kern_lock(xma_shm, kernel_inst))
         return XMA_ERROR;
 
     if (kernel_inst->client_id && kernel_inst->client_id != proc_id) {
-        xma_shm_unlock(xma_shm);
+        xma_kern_unlock(kernel_inst);
         return XMA_ERROR_NO_KERNEL; /* some other process has this kernel */
     }
 
-    kernel_inst->client_id = proc_id;
-
-    for (j = 0; kernel_inst->channels[j].thread_id && j < MAX_KERNEL_CHANS; j++)
+    for (j = 0; j < MAX_KERNEL_CHANS && kernel_inst->channels[j].thread_id; j++)
         sessions[j] = kernel_inst->channels[j].session;
 
-    if (!j) { /* unused kernel */
-        xma_logmsg(XMA_DEBUG_LOG, XMA_RES_MOD, "%s() Kernel not in-use\n", __func__);
-        if (alloc_chan) {
-            xma_logmsg(XMA_DEBUG_LOG, XMA_RES_MOD,
-                       "%s() Kernel supports channels\n", __func__);
-            if (kernel_data_size > 0)
-                session->kernel_data = malloc(kernel_data_size);
-            ret = alloc_chan(session, sessions, j);
-            if (ret) {
-                xma_logmsg(XMA_DEBUG_LOG, XMA_RES_MOD,
-                           "%s() Channel request rejected\n", __func__);
-                xma_shm_unlock(xma_shm);
-                return ret;
-            }
-        }
-        kernel_inst->channels[j].session = session;
-        kernel_inst->channels[j].thread_id = thread_id;
-        session->chan_id = session->chan_id >= 0 ? session->chan_id : 0;
-        xma_logmsg(XMA_DEBUG_LOG, XMA_RES_MOD,
-                   "%s() Kernel aquired. Channel id %d\n",
-                   __func__, session->chan_id);
-        xma_shm_unlock(xma_shm);
-        return XMA_SUCCESS;
-    } else if (j && j < MAX_KERNEL_CHANS && alloc_chan) {
-        /* verify it can support another request */
+    if (j && !alloc_chan) {
+        /* kernel is in-use and doesn't support channels */
+        xma_kern_unlock(kernel_inst);
         xma_logmsg(XMA_DEBUG_LOG, XMA_RES_MOD,
-                   "%s() Kernel in-use and supports channels. Channel instance %d\n",
-                   __func__, j);
+                   "%s() All kernel channels in-use \n", __func__);
+        return XMA_ERROR_NO_KERNEL;
+    }
+    if (j == MAX_KERNEL_CHANS) {
+        xma_kern_unlock(kernel_inst);
+        return XMA_ERROR;
+    }
+
+    if (alloc_chan) {
         if (kernel_data_size > 0)
-            session->kernel_data = sessions[0]->kernel_data;
+            session->kernel_data = j ? sessions[0]->kernel_data :
+                                       malloc(kernel_data_size);
         ret = alloc_chan(session, sessions, j);
         if (ret) {
-            xma_shm_unlock(xma_shm);
+            if (!j && kernel_data_size > 0) {
+                free(session->kernel_data);
+                session->kernel_data = NULL;
+            }
+            xma_kern_unlock(kernel_inst);
+            xma_logmsg(XMA_DEBUG_LOG, XMA_RES_MOD,
+                       "%s() Channel request rejected\n", __func__);
             return ret;
         }
-        kernel_inst->channels[j].session = session;
-        kernel_inst->channels[j].thread_id = thread_id;
-        xma_shm_unlock(xma_shm);
-        return XMA_SUCCESS;
-    } else if (j && !alloc_chan) {
-        /* kernel is in-use and doesn't support channels */
-        xma_logmsg(XMA_DEBUG_LOG, XMA_RES_MOD,
-                   "%s() All kernel channels in-use \n", __func__);
-        xma_shm_unlock(xma_shm);
-        return XMA_ERROR_NO_KERNEL;
     }
-    xma_shm_unlock(xma_shm);
-    return XMA_ERROR;
+
+    kernel_inst->client_id = proc_id;
+    kernel_inst->channels[j].session = session;
+    kernel_inst->channels[j].thread_id = thread_id;
+    kernel_inst->channels[j].load = load;
+    kernel_inst->load += load;
+    if (!j)
+        session->chan_id = session->chan_id >= 0 ? session->chan_id : 0;
+    xma_kern_unlock(kernel_inst);
+
+    xma_logmsg(XMA_DEBUG_LOG, XMA_RES_MOD,
+               "%s() Kernel aquired. Channel instance %d, channel id %d\n",
+               __func__, j, session->chan_id);
+    return XMA_SUCCESS;
 }
 
 static int xma_client_thread_kernel_free(XmaDevice *dev,
@@ -1070,8 +1571,10 @@ static int xma_client_thread_kernel_free(XmaDevice *dev,
             continue;
         if (kernel_inst->channels[i].session != session)
             continue;
+        kernel_inst->load -= kernel_inst->channels[i].load;
         kernel_inst->channels[i].thread_id = 0;
         kernel_inst->channels[i].session = NULL;
+        kernel_inst->channels[i].load = 0;
         /* eliminate fragmentation in list of used channels after free */
         for (; i < MAX_KERNEL_CHANS-1 &&
                kernel_inst->channels[i+1].thread_id &&
@@ -1080,12 +1583,15 @@ static int xma_client_thread_kernel_free(XmaDevice *dev,
                                      kernel_inst->channels[i+1].thread_id;
             kernel_inst->channels[i].session =
                                      kernel_inst->channels[i+1].session;
+            kernel_inst->channels[i].load =
+                                     kernel_inst->channels[i+1].load;
         }
         last_used_chan = !i ? true : false;
         /* ensure last entry is cleared if not otherwise */
         if (!last_used_chan) {
             kernel_inst->channels[i].thread_id = 0;
             kernel_inst->channels[i].session = NULL;
+            kernel_inst->channels[i].load = 0;
             return XMA_SUCCESS;
         } else {
             kernel_inst->client_id = 0;
@@ -1121,22 +1627,40 @@ static XmaKernReq *xma_res_create_kern_req(enum XmaKernType type,
     return req;
 }
 
-static int xma_shm_lock(XmaResConfig *xma_shm)
+static void xma_shm_mutex_init(pthread_mutex_t *lock)
 {
-    extern XmaSingleton *g_xma_singleton;
-    int ret;
+    pthread_mutexattr_t proc_shared_lock;
 
-    if (g_xma_singleton->shm_freed || !xma_shm)
-        return XMA_ERROR_INVALID;
+    pthread_mutexattr_init(&proc_shared_lock);
+    pthread_mutexattr_setpshared(&proc_shared_lock, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&proc_shared_lock, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(lock, &proc_shared_lock);
+    pthread_mutexattr_destroy(&proc_shared_lock);
+}
+
+/* state left by a dead owner is reclaimed by xma_verify_shm_client_procs */
+static int xma_robust_mutex_lock(pthread_mutex_t *lock)
+{
+    int ret;
 
-    ret = pthread_mutex_lock(&xma_shm->lock);
+    ret = pthread_mutex_lock(lock);
     if (ret == EOWNERDEAD) {
-        pthread_mutex_consistent(&xma_shm->lock);
+        pthread_mutex_consistent(lock);
         return XMA_SUCCESS;
     }
     return ret;
 }
 
+static int xma_shm_lock(XmaResConfig *xma_shm)
+{
+    extern XmaSingleton *g_xma_singleton;
+
+    if (g_xma_singleton->shm_freed || !xma_shm)
+        return XMA_ERROR_INVALID;
+
+    return xma_robust_mutex_lock(&xma_shm->lock);
+}
+
 static int xma_shm_unlock(XmaResConfig *xma_shm)
 {
     if (!xma_shm)
@@ -1144,6 +1668,22 @@ static int xma_shm_unlock(XmaResConfig *xma_shm)
     return pthread_mutex_unlock(&xma_shm->lock);
 }
 
+/* may be taken while holding the global lock, never the reverse */
+static int xma_kern_lock(XmaResConfig *xma_shm, XmaKernelInstance *kernel_inst)
+{
+    extern XmaSingleton *g_xma_singleton;
+
+    if (g_xma_singleton->shm_freed || !xma_shm)
+        return XMA_ERROR_INVALID;
+
+    return xma_robust_mutex_lock(&kernel_inst->lock);
+}
+
+static int xma_kern_unlock(XmaKernelInstance *kernel_inst)
+{
+    return pthread_mutex_unlock(&kernel_inst->lock);
+}
+
 static void xma_free_all_kernel_chan_res(XmaDevice *dev, pid_t proc_id)
 {
     int i;
@@ -1154,15 +1694,21 @@ static void xma_free_all_kernel_chan_res(XmaDevice *dev, pid_t proc_id)
         XmaKernelInstance *kernel = &dev->kernels[i];
         int j;
 
-        if (proc_id && kernel->client_id != proc_id)
+        xma_robust_mutex_lock(&kernel->lock);
+        if (proc_id && kernel->client_id != proc_id) {
+            pthread_mutex_unlock(&kernel->lock);
             continue;
+        }
 
         kernel->client_id = 0;
+        kernel->load = 0;
         for (j = 0; j < MAX_KERNEL_CHANS && kernel->channels[j].session; j++)
         {
             kernel->channels[j].thread_id = 0;
             kernel->channels[j].session = NULL;
+            kernel->channels[j].load = 0;
         }
+        pthread_mutex_unlock(&kernel->lock);
     }
 }
 
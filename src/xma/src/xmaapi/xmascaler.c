@@ -259,6 +259,7 @@ xma_scaler_session_create(XmaScalerProperties *sc_props)
         end_pt->bits_per_pixel = sc_props->output[i].bits_per_pixel;
         end_pt->width = sc_props->output[i].width;
         end_pt->height = sc_props->output[i].height;
+        end_pt->peer = sc_props->destination;
         sc_session->conn_send_handles[i] =
             xma_connect_alloc(end_pt, XMA_CONNECT_SENDER);
     }
@@ -328,13 +329,12 @@ xma_scaler_session_destroy(XmaScalerSession *session)
     return XMA_SUCCESS;
 }
 
-int32_t
-xma_scaler_session_send_frame(XmaScalerSession  *session,
-                              XmaFrame          *frame)
+/* Point outputs connected to zerocopy capable encoders at their input */
+static void
+xma_scaler_zerocopy_dests(XmaScalerSession *session)
 {
     int32_t i;
 
-    xma_logmsg(XMA_DEBUG_LOG, XMA_SCALER_MOD, "%s()\n", __func__);
     for (i = 0; i < session->props.num_outputs; i++)
     {
         if (session->conn_send_handles[i] != -1)
@@ -361,10 +361,59 @@ xma_scaler_session_send_frame(XmaScalerSession  *session,
             }
         }
     }
+}
+
+int32_t
+xma_scaler_session_send_frame(XmaScalerSession  *session,
+                              XmaFrame          *frame)
+{
+    xma_logmsg(XMA_DEBUG_LOG, XMA_SCALER_MOD, "%s()\n", __func__);
+    xma_scaler_zerocopy_dests(session);
+    session->in_dev_addr = 0;
 
     return session->scaler_plugin->send_frame(session, frame);
 }
 
+int32_t
+xma_scaler_session_send_frame_fanout(XmaScalerSession **session_list,
+                                     int32_t            num_sessions,
+                                     XmaFrame          *frame,
+                                     int32_t           *rc_list)
+{
+    XmaScalerSession *src;
+    uint64_t in_dev_addr = 0;
+    int32_t src_dev, i;
+
+    xma_logmsg(XMA_DEBUG_LOG, XMA_SCALER_MOD, "%s() %d sessions\n",
+               __func__, num_sessions);
+    if (!session_list || num_sessions <= 0 || !rc_list)
+        return XMA_ERROR_INVALID;
+
+    // The first session uploads the frame to its input buffer
+    src = session_list[0];
+    rc_list[0] = xma_scaler_session_send_frame(src, frame);
+    src_dev = xma_res_dev_handle_get(src->base.kern_res);
+    if (rc_list[0] >= 0 && frame->data[0].buffer &&
+        src->scaler_plugin->get_dev_input_paddr)
+        in_dev_addr = src->scaler_plugin->get_dev_input_paddr(src);
+
+    // Sessions on the same device scale from that buffer, others upload
+    for (i = 1; i < num_sessions; i++)
+    {
+        XmaScalerSession *session = session_list[i];
+        bool shared = in_dev_addr &&
+                      session->scaler_plugin->get_dev_input_paddr &&
+                      xma_res_dev_handle_get(session->base.kern_res) == src_dev;
+
+        xma_scaler_zerocopy_dests(session);
+        session->in_dev_addr = shared ? in_dev_addr : 0;
+        rc_list[i] = session->scaler_plugin->send_frame(session, frame);
+        session->in_dev_addr = 0;
+    }
+
+    return XMA_SUCCESS;
+}
+
 int32_t
 xma_scaler_session_recv_frame_list(XmaScalerSession  *session,
                                    XmaFrame          **frame_list)
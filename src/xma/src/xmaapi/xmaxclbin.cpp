@@ -19,6 +19,10 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 //#include <xclbin.h>
 #include "app/xmaerror.h"
 #include "lib/xmaxclbin.h"
@@ -28,25 +32,55 @@
 /* Private function */
 static int get_xclbin_iplayout(char *buffer, XmaIpLayout *layout);
 
-char *xma_xclbin_file_open(const char *xclbin_name)
+/*
+ * The xclbin is mapped rather than read, sections are accessed in place
+ * and the mapping is passed as is to xclLoadXclBin, so peak memory does
+ * not grow with the size of the bitstream
+ */
+char *xma_xclbin_file_open(const char *xclbin_name, size_t *size)
 {
     xma_logmsg("Loading %s\n", xclbin_name);
 
-    std::ifstream file(xclbin_name, std::ios::binary | std::ios::ate);
-    std::streamsize size = file.tellg();
-    file.seekg(0, std::ios::beg);
-
-    char *buffer = (char*)malloc(size);
-    if (!file.read(buffer, size))
+    int fd = open(xclbin_name, O_RDONLY);
+    if (fd < 0)
     {
+        xma_logmsg("Could not open file %s\n", xclbin_name);
+        return NULL;
+    }
+
+    struct stat st;
+    char *buffer = NULL;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(axlf))
         xma_logmsg("Could not read file %s\n", xclbin_name);
-        free(buffer);
+    else
+    {
+        void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED)
+            xma_logmsg("Could not map file %s\n", xclbin_name);
+        else
+            buffer = (char*)addr;
+    }
+    close(fd);
+
+    if (buffer &&
+        reinterpret_cast<axlf *>(buffer)->m_header.m_length > (uint64_t)st.st_size)
+    {
+        xma_logmsg("File %s is truncated\n", xclbin_name);
+        munmap(buffer, st.st_size);
         buffer = NULL;
     }
 
+    if (buffer)
+        *size = st.st_size;
     return buffer;
 }
 
+void xma_xclbin_file_close(char *buffer, size_t size)
+{
+    if (buffer)
+        munmap(buffer, size);
+}
+
 int xma_xclbin_info_get(char *buffer, XmaXclbinInfo *info)
 {
     return get_xclbin_iplayout(buffer, info->ip_layout);
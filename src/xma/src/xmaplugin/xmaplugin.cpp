@@ -15,9 +15,32 @@
  * under the License.
  */
 #include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <new>
+#include <vector>
 #include "xclhal2.h"
 #include "xmaplugin.h"
 
+struct XmaBufferPool
+{
+    XmaHwSession                          s_handle;
+    size_t                                size;
+    uint32_t                              max_free;
+    std::mutex                            lock;
+    std::vector<XmaBufferHandle>          free_bufs;
+    std::map<XmaBufferHandle, int32_t>    in_use; // handle to refcount
+};
+
+struct XmaRegisterBatch
+{
+    XmaHwSession                          s_handle;
+    std::vector<uint32_t>                 image; // staged register values
+    std::vector<bool>                     dirty; // staged since last flush
+};
+
 XmaBufferHandle
 xma_plg_buffer_alloc(XmaHwSession s_handle, size_t size)
 {
@@ -47,6 +70,86 @@ xma_plg_buffer_free(XmaHwSession s_handle, XmaBufferHandle b_handle)
     xclFreeBO(dev_handle, b_handle);
 }
 
+XmaBufferPool *
+xma_plg_buffer_pool_create(XmaHwSession s_handle, size_t size, uint32_t max_free)
+{
+    XmaBufferPool *pool = new (std::nothrow) XmaBufferPool;
+    if (!pool)
+        return NULL;
+
+    pool->s_handle = s_handle;
+    pool->size = size;
+    pool->max_free = max_free;
+    pool->free_bufs.reserve(max_free);
+    return pool;
+}
+
+XmaBufferHandle
+xma_plg_buffer_pool_get(XmaBufferPool *pool)
+{
+    XmaBufferHandle handle;
+
+    {
+        std::lock_guard<std::mutex> lk(pool->lock);
+        if (!pool->free_bufs.empty()) {
+            handle = pool->free_bufs.back();
+            pool->free_bufs.pop_back();
+            pool->in_use[handle] = 1;
+            return handle;
+        }
+    }
+
+    // Allocate outside the lock, other threads may recycle meanwhile
+    handle = xma_plg_buffer_alloc(pool->s_handle, pool->size);
+    if (handle == 0xffffffff) // null BO, never pooled
+        return handle;
+
+    std::lock_guard<std::mutex> lk(pool->lock);
+    pool->in_use[handle] = 1;
+    return handle;
+}
+
+int32_t
+xma_plg_buffer_pool_ref(XmaBufferPool *pool, XmaBufferHandle b_handle)
+{
+    std::lock_guard<std::mutex> lk(pool->lock);
+    auto itr = pool->in_use.find(b_handle);
+    if (itr == pool->in_use.end())
+        return XMA_ERROR;
+    itr->second++;
+    return XMA_SUCCESS;
+}
+
+void
+xma_plg_buffer_pool_put(XmaBufferPool *pool, XmaBufferHandle b_handle)
+{
+    {
+        std::lock_guard<std::mutex> lk(pool->lock);
+        auto itr = pool->in_use.find(b_handle);
+        if (itr == pool->in_use.end() || --itr->second > 0)
+            return;
+        pool->in_use.erase(itr);
+        if (pool->free_bufs.size() < pool->max_free) {
+            pool->free_bufs.push_back(b_handle);
+            return;
+        }
+    }
+    xma_plg_buffer_free(pool->s_handle, b_handle);
+}
+
+void
+xma_plg_buffer_pool_destroy(XmaBufferPool *pool)
+{
+    if (!pool)
+        return;
+
+    for (auto handle : pool->free_bufs)
+        xma_plg_buffer_free(pool->s_handle, handle);
+    for (auto& entry : pool->in_use)
+        xma_plg_buffer_free(pool->s_handle, entry.first);
+    delete pool;
+}
+
 uint64_t
 xma_plg_get_paddr(XmaHwSession s_handle, XmaBufferHandle b_handle)
 {
@@ -146,6 +249,80 @@ xma_plg_register_read(XmaHwSession  s_handle,
                    dst, size);
 }
 
+XmaRegisterBatch *
+xma_plg_register_batch_create(XmaHwSession s_handle, size_t map_size)
+{
+    if (!map_size || map_size % sizeof(uint32_t))
+        return NULL;
+
+    XmaRegisterBatch *batch = new (std::nothrow) XmaRegisterBatch;
+    if (!batch)
+        return NULL;
+
+    batch->s_handle = s_handle;
+    batch->image.resize(map_size / sizeof(uint32_t));
+    batch->dirty.resize(map_size / sizeof(uint32_t));
+    return batch;
+}
+
+int32_t
+xma_plg_register_batch_write(XmaRegisterBatch *batch,
+                             const void       *src,
+                             size_t            size,
+                             size_t            offset)
+{
+    size_t first = offset / sizeof(uint32_t);
+    size_t count = size / sizeof(uint32_t);
+
+    if (size % sizeof(uint32_t) || offset % sizeof(uint32_t) ||
+        first + count > batch->image.size())
+        return XMA_ERROR;
+
+    memcpy(&batch->image[first], src, size);
+    std::fill(batch->dirty.begin() + first, batch->dirty.begin() + first + count,
+              true);
+    return XMA_SUCCESS;
+}
+
+int32_t
+xma_plg_register_batch_flush(XmaRegisterBatch *batch)
+{
+    xclDeviceHandle dev_handle = batch->s_handle.dev_handle;
+    uint64_t        dev_offset = batch->s_handle.base_address;
+    size_t          words = batch->image.size();
+    int32_t         written = 0;
+
+    for (size_t first = 0; first < words; ) {
+        if (!batch->dirty[first]) {
+            ++first;
+            continue;
+        }
+        size_t last = first;
+        while (last < words && batch->dirty[last])
+            batch->dirty[last++] = false;
+
+        size_t size = (last - first) * sizeof(uint32_t);
+        int rc = xclWrite(dev_handle, XCL_ADDR_KERNEL_CTRL,
+                          dev_offset + first * sizeof(uint32_t),
+                          &batch->image[first], size);
+        if (rc < 0) {
+            // Keep the rest staged so a retry writes what is missing
+            std::fill(batch->dirty.begin() + first, batch->dirty.begin() + last,
+                      true);
+            return rc;
+        }
+        written += rc;
+        first = last;
+    }
+    return written;
+}
+
+void
+xma_plg_register_batch_destroy(XmaRegisterBatch *batch)
+{
+    delete batch;
+}
+
 void
 xma_plg_register_dump(XmaHwSession s_handle,
                       int32_t      num_words)
@@ -0,0 +1,183 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CL/opencl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+
+using clock_type = std::chrono::high_resolution_clock;
+
+// Completion bookkeeping shared with the event callbacks
+struct launch_stats
+{
+  std::mutex mutex;
+  std::condition_variable work;
+  size_t running = 0;
+  std::vector<unsigned long> latency;
+};
+
+struct launch_type
+{
+  launch_stats* stats;
+  clock_type::time_point start;
+};
+
+static void
+throw_if_error(cl_int err, const char* msg)
+{
+  if (err != CL_SUCCESS)
+    throw std::runtime_error(std::string(msg) + " failed (" + std::to_string(err) + ")");
+}
+
+static void CL_CALLBACK
+task_complete(cl_event event, cl_int, void* data)
+{
+  auto now = clock_type::now();
+  auto launch = static_cast<launch_type*>(data);
+  auto stats = launch->stats;
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - launch->start).count();
+  delete launch;
+  clReleaseEvent(event);
+
+  std::lock_guard<std::mutex> lk(stats->mutex);
+  stats->latency.push_back(ns);
+  --stats->running;
+  stats->work.notify_one();
+}
+
+static double
+percentile(const std::vector<unsigned long>& sorted, double pct)
+{
+  auto idx = static_cast<size_t>(pct * (sorted.size()-1) / 100.0);
+  return sorted[idx] / 1000.0;
+}
+
+// Keep 'depth' tasks in flight until 'launches' have completed
+static void
+measure(cl_command_queue queue, cl_kernel kernel, size_t depth, size_t launches)
+{
+  launch_stats stats;
+  stats.latency.reserve(launches);
+
+  auto zero = clock_type::now();
+  for (size_t issued = 0; issued < launches; ++issued) {
+    {
+      std::unique_lock<std::mutex> lk(stats.mutex);
+      stats.work.wait(lk,[&stats,depth] { return stats.running < depth; });
+      ++stats.running;
+    }
+
+    cl_event event;
+    auto launch = new launch_type{&stats, clock_type::now()};
+    throw_if_error(clEnqueueTask(queue,kernel,0,nullptr,&event),"clEnqueueTask");
+    throw_if_error(clSetEventCallback(event,CL_COMPLETE,task_complete,launch),"clSetEventCallback");
+    clFlush(queue);
+  }
+  clFinish(queue);
+
+  {
+    std::unique_lock<std::mutex> lk(stats.mutex);
+    stats.work.wait(lk,[&stats] { return stats.running == 0; });
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - zero).count();
+
+  std::sort(stats.latency.begin(),stats.latency.end());
+  std::cout << depth << " "
+            << std::fixed << std::setprecision(0)
+            << (launches * 1e9 / elapsed) << " "
+            << std::setprecision(1)
+            << percentile(stats.latency,50) << " "
+            << percentile(stats.latency,90) << " "
+            << percentile(stats.latency,99) << " "
+            << stats.latency.back() / 1000.0 << "\n";
+}
+
+static int
+run(int argc, char** argv)
+{
+  if (argc < 2) {
+    std::cout << "test-cl.exe <inputfile> [launches] [depth]\n";
+    return EXIT_FAILURE;
+  }
+
+  size_t launches = argc > 2 ? std::max(1,std::atoi(argv[2])) : 10000;
+  size_t depth = argc > 3 ? std::max(1,std::atoi(argv[3])) : 64;
+
+  std::ifstream stream(argv[1],std::ios::binary);
+  std::vector<unsigned char> xclbin((std::istreambuf_iterator<char>(stream)),std::istreambuf_iterator<char>());
+  if (xclbin.empty())
+    throw std::runtime_error(std::string("failed to load ") + argv[1]);
+
+  cl_int err = CL_SUCCESS;
+  cl_platform_id platform;
+  throw_if_error(clGetPlatformIDs(1,&platform,nullptr),"clGetPlatformIDs");
+  cl_device_id device;
+  throw_if_error(clGetDeviceIDs(platform,CL_DEVICE_TYPE_ACCELERATOR,1,&device,nullptr),"clGetDeviceIDs");
+
+  auto context = clCreateContext(0,1,&device,nullptr,nullptr,&err);
+  throw_if_error(err,"clCreateContext");
+  auto queue = clCreateCommandQueue(context,device,CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE,&err);
+  throw_if_error(err,"clCreateCommandQueue");
+
+  size_t size = xclbin.size();
+  const unsigned char* binary = xclbin.data();
+  auto program = clCreateProgramWithBinary(context,1,&device,&size,&binary,nullptr,&err);
+  throw_if_error(err,"clCreateProgramWithBinary");
+  throw_if_error(clBuildProgram(program,0,nullptr,nullptr,nullptr,nullptr),"clBuildProgram");
+  auto kernel = clCreateKernel(program,"noop",&err);
+  throw_if_error(err,"clCreateKernel");
+
+  // warm up, first launch includes one time scheduler setup
+  throw_if_error(clEnqueueTask(queue,kernel,0,nullptr,nullptr),"clEnqueueTask");
+  clFinish(queue);
+
+  std::cout << "depth launches/s p50_us p90_us p99_us max_us\n";
+  for (size_t qd=1; qd<=depth; qd*=2)
+    measure(queue,kernel,qd,launches);
+
+  clReleaseKernel(kernel);
+  clReleaseProgram(program);
+  clReleaseCommandQueue(queue);
+  clReleaseContext(context);
+  return EXIT_SUCCESS;
+}
+
+int
+main(int argc, char** argv)
+{
+  try {
+    return run(argc,argv);
+  }
+  catch (const std::exception& ex) {
+    std::cout << "TEST FAILED: " << ex.what() << "\n";
+  }
+  catch (...) {
+    std::cout << "TEST FAILED\n";
+  }
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,294 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "utils.hpp"
+
+// driver includes
+#include "ert.h"
+#include "xclhal2.h"
+#include "xclbin.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <getopt.h>
+
+const size_t MAXCUS = 8;
+
+// no-op kernel has no arguments, regmap is ctrl, gie, ier, isr
+const size_t REGMAP_SIZE = 4;
+
+size_t cus = MAXCUS;
+size_t slotsize = 4096;
+
+const static struct option long_options[] = {
+  {"bitstream",       required_argument, 0, 'k'},
+  {"hal_logfile",     required_argument, 0, 'l'},
+  {"device",          required_argument, 0, 'd'},
+  {"launches",        required_argument, 0, 'n'},
+  {"cus",             required_argument, 0, 'c'},
+  {"depth",           required_argument, 0, 'q'},
+  {"verbose",         no_argument,       0, 'v'},
+  {"help",            no_argument,       0, 'h'},
+  // enable embedded runtime
+  {"ert",             no_argument,       0, '1'},
+  {"slotsize",        required_argument, 0, '2'},
+  {0, 0, 0, 0}
+};
+
+static void printHelp()
+{
+  std::cout << "usage: %s [options] -k <bitstream>\n\n";
+  std::cout << "  -k <bitstream>\n";
+  std::cout << "  -l <hal_logfile>\n";
+  std::cout << "  -d <device_index>\n";
+  std::cout << "  -v\n";
+  std::cout << "  -h\n\n";
+  std::cout << "";
+  std::cout << "  [--ert]: enable embedded runtime (default: false)\n";
+  std::cout << "  [--slotsize]: command queue slotsize in kB (default: 4096)\n";
+  std::cout << "  [--launches <number>]: launches per measurement point (default: 10000)\n";
+  std::cout << "  [--cus <number>]: max number of cus to sweep (default: 8) (max: 8)\n";
+  std::cout << "  [--depth <number>]: max number of commands in flight to sweep (default: 64)\n";
+  std::cout << "";
+  std::cout << "* Program launches a no-op kernel for CU counts 1,2,4..cus and queue\n";
+  std::cout << "* depths 1,2,4..depth. Each point prints \"mode cus depth rate p50 p90 p99 max\"\n";
+  std::cout << "* for use with awk, where rate is launches per second and latencies are\n";
+  std::cout << "* in us from xclExecBuf to observed completion\n";
+}
+
+// Command in flight
+struct launch_type
+{
+  utils::buffer ebo;
+  unsigned long start = 0;
+  bool running = false;
+
+  explicit launch_type(utils::buffer e)
+    : ebo(std::move(e))
+  {}
+};
+
+static void
+init_scheduler(const utils::device& d, bool ert)
+{
+  auto execbo = utils::get_exec_buffer(d,1024);
+  auto ecmd = reinterpret_cast<ert_configure_cmd*>(execbo->data);
+  ecmd->state = ERT_CMD_STATE_NEW;
+  ecmd->opcode = ERT_CONFIGURE;
+
+  ecmd->slot_size = slotsize;
+  ecmd->num_cus = cus;
+  ecmd->cu_shift = 16;
+  ecmd->cu_base_addr = d->cu_base_addr;
+
+  ecmd->ert = ert;
+  if (ert) {
+    ecmd->cu_dma = 1;
+    ecmd->cu_isr = 1;
+  }
+
+  // TODO: read from xclbin
+  for (size_t i=0; i<cus; ++i)
+    ecmd->data[i] = (i<<16) + d->cu_base_addr;
+
+  ecmd->count = 5 + cus;
+
+  if (xclExecBuf(d->handle,execbo->bo))
+    throw std::runtime_error("unable to issue xclExecBuf");
+
+  while (xclExecWait(d->handle,1000)==0);
+}
+
+static void
+start(const utils::device& d, launch_type& l, size_t ncus)
+{
+  auto ecmd = reinterpret_cast<ert_start_kernel_cmd*>(l.ebo->data);
+  ecmd->state = ERT_CMD_STATE_NEW;
+  ecmd->opcode = ERT_START_CU;
+  ecmd->count = 1 + REGMAP_SIZE;  // cu_mask + regmap
+  ecmd->cu_mask = (1<<ncus)-1;
+  std::fill(ecmd->data,ecmd->data+REGMAP_SIZE,0);
+
+  l.running = true;
+  l.start = utils::time_ns();
+  if (xclExecBuf(d->handle,l.ebo->bo))
+    throw std::runtime_error("unable to issue xclExecBuf");
+}
+
+static bool
+completed(launch_type& l)
+{
+  if (!l.running)
+    return false;
+  auto epacket = reinterpret_cast<ert_packet*>(l.ebo->data);
+  if (epacket->state != ERT_CMD_STATE_COMPLETED)
+    return false;
+  l.running = false;
+  return true;
+}
+
+static double
+percentile(const std::vector<unsigned long>& sorted, double pct)
+{
+  auto idx = static_cast<size_t>(pct * (sorted.size()-1) / 100.0);
+  return sorted[idx] / 1000.0;
+}
+
+// Keep 'depth' commands in flight on 'ncus' CUs until 'launches' have completed
+static void
+measure(const utils::device& d, std::vector<launch_type>& pool, size_t ncus,
+        size_t depth, size_t launches, bool ert)
+{
+  std::vector<unsigned long> latency;
+  latency.reserve(launches);
+
+  size_t issued = 0;
+  auto zero = utils::time_ns();
+  for (size_t i=0; i<depth && issued<launches; ++i, ++issued)
+    start(d,pool[i],ncus);
+
+  while (latency.size() < launches) {
+    while (xclExecWait(d->handle,1000)==0);
+
+    // stamp once per wakeup, this is when the host observes completion
+    auto now = utils::time_ns();
+    for (size_t i=0; i<depth; ++i) {
+      auto& l = pool[i];
+      if (!completed(l))
+        continue;
+      latency.push_back(now - l.start);
+      if (issued < launches) {
+        start(d,l,ncus);
+        ++issued;
+      }
+    }
+  }
+  auto elapsed = utils::time_ns() - zero;
+
+  std::sort(latency.begin(),latency.end());
+  std::cout << (ert ? "ert: " : "kds: ")
+            << ncus << " " << depth << " "
+            << std::fixed << std::setprecision(0)
+            << (launches * 1e9 / elapsed) << " "
+            << std::setprecision(1)
+            << percentile(latency,50) << " "
+            << percentile(latency,90) << " "
+            << percentile(latency,99) << " "
+            << latency.back() / 1000.0 << "\n";
+}
+
+static int
+run(const utils::device& d, size_t launches, size_t depth, bool ert)
+{
+  init_scheduler(d, ert);
+
+  std::vector<launch_type> pool;
+  for (size_t i=0; i<depth; ++i)
+    pool.emplace_back(utils::create_exec_bo(d,1024));
+
+  std::cout << "mode cus depth launches/s p50_us p90_us p99_us max_us\n";
+  for (size_t ncus=1; ncus<=cus; ncus*=2)
+    for (size_t qd=1; qd<=depth; qd*=2)
+      measure(d,pool,ncus,qd,launches,ert);
+
+  return 0;
+}
+
+int run(int argc, char** argv)
+{
+  std::string bitstream;
+  std::string hallog;
+  int option_index = 0;
+  unsigned device_index = 0;
+  size_t launches = 10000;
+  size_t depth = 64;
+  bool verbose = false;
+  bool ert = false;
+  int c;
+  while ((c = getopt_long(argc, argv, "k:l:d:n:vh", long_options, &option_index)) != -1) {
+    switch (c) {
+    case 0:
+      if (long_options[option_index].flag != 0)
+        break;
+    case '1':
+      ert = true;
+      break;
+    case '2':
+      slotsize = std::atoi(optarg);
+      break;
+    case 'k':
+      bitstream = optarg;
+      break;
+    case 'l':
+      hallog = optarg;
+      break;
+    case 'd':
+      device_index = std::atoi(optarg);
+      break;
+    case 'n':
+      launches = std::max(1,std::atoi(optarg));
+      break;
+    case 'c':
+      cus = std::min(8,std::max(1,std::atoi(optarg)));
+      break;
+    case 'q':
+      depth = std::max(1,std::atoi(optarg));
+      break;
+    case 'h':
+      printHelp();
+      return 0;
+    case 'v':
+      verbose = true;
+      break;
+    default:
+      printHelp();
+      return -1;
+    }
+  }
+
+  // bogus compiler warnings
+  (void)verbose;
+
+  if (bitstream.empty())
+    throw std::runtime_error("No bitstream specified");
+
+  if (!hallog.empty())
+    std::cout << "Using " << hallog << " as XRT driver logfile\n";
+
+  std::cout << "Compiled kernel = " << bitstream << std::endl;
+
+  auto device = utils::init(bitstream,device_index,hallog);
+  run(device,launches,depth,ert);
+
+  return 0;
+}
+
+int
+main(int argc, char* argv[])
+{
+  try {
+    run(argc,argv);
+    return 0;
+  }
+  catch (const std::exception& ex) {
+    std::cout << "TEST FAILED: " << ex.what() << "\n";
+  }
+  catch (...) {
+    std::cout << "TEST FAILED\n";
+  }
+
+  return 1;
+}
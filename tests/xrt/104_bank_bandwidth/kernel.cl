@@ -0,0 +1,31 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+  OpenCL Task (1 work item)
+  512 bit wide copy within one bank, saturates the CU memory port
+*/
+
+__kernel __attribute__ ((reqd_work_group_size(1, 1 , 1)))
+void copy (__global ulong8 *in, __global ulong8 *out, unsigned int elements)
+{
+  unsigned int i;
+
+  for(i=0;i< elements;i++){
+    out[i]=in[i];
+  }
+  return;
+}
@@ -0,0 +1,403 @@
+/**
+ * Copyright (C) 2018 Xilinx, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "utils.hpp"
+
+// driver includes
+#include "ert.h"
+#include "xclhal2.h"
+#include "xclbin.h"
+#include "xclperf.h"
+
+#include <atomic>
+#include <iomanip>
+#include <thread>
+#include <getopt.h>
+
+// copy kernel register map
+const size_t COPY_CONTROL_ADDR_IN_DATA = 0x10;
+const size_t COPY_CONTROL_ADDR_OUT_DATA = 0x1c;
+const size_t COPY_CONTROL_ADDR_ELEMENTS_DATA = 0x28;
+
+// one copy CU per bank in the xclbin
+const size_t MAXBANKS = 4;
+
+size_t banks = MAXBANKS;
+size_t slotsize = 4096;
+
+const static struct option long_options[] = {
+  {"bitstream",       required_argument, 0, 'k'},
+  {"hal_logfile",     required_argument, 0, 'l'},
+  {"device",          required_argument, 0, 'd'},
+  {"seconds",         required_argument, 0, 's'},
+  {"size",            required_argument, 0, 'm'},
+  {"banks",           required_argument, 0, 'b'},
+  {"verbose",         no_argument,       0, 'v'},
+  {"help",            no_argument,       0, 'h'},
+  // enable embedded runtime
+  {"ert",             no_argument,       0, '1'},
+  {"slotsize",        required_argument, 0, '2'},
+  {0, 0, 0, 0}
+};
+
+static void printHelp()
+{
+  std::cout << "usage: %s [options] -k <bitstream>\n\n";
+  std::cout << "  -k <bitstream>\n";
+  std::cout << "  -l <hal_logfile>\n";
+  std::cout << "  -d <device_index>\n";
+  std::cout << "  -v\n";
+  std::cout << "  -h\n\n";
+  std::cout << "";
+  std::cout << "  [--ert]: enable embedded runtime (default: false)\n";
+  std::cout << "  [--slotsize]: command queue slotsize in kB (default: 4096)\n";
+  std::cout << "  [--seconds <number>]: seconds per phase (default: 2)\n";
+  std::cout << "  [--size <number>]: buffer size per bank in MB (default: 16)\n";
+  std::cout << "  [--banks <number>]: max number of banks to use (default: 4) (max: 4)\n";
+  std::cout << "";
+  std::cout << "* Program measures DMA only, kernel only, and concurrent DMA and kernel\n";
+  std::cout << "* traffic on all banks at once. Bank rows print \"phase bank dma kernel\"\n";
+  std::cout << "* in MB/s for use with awk, followed by SPM rates per monitored port\n";
+}
+
+// Buffers and progress of one bank
+struct bank_type
+{
+  size_t index = 0;
+  utils::buffer dma;
+  utils::buffer in;
+  utils::buffer out;
+  utils::buffer ebo;
+  unsigned long dma_bytes = 0;  // owned by the dma thread until joined
+  unsigned long kernel_bytes = 0;
+  bool running = false;
+
+  bank_type(size_t idx, utils::buffer d, utils::buffer i, utils::buffer o, utils::buffer e)
+    : index(idx), dma(std::move(d)), in(std::move(i)), out(std::move(o)), ebo(std::move(e))
+  {}
+};
+
+// Bandwidth of one phase
+struct phase_result
+{
+  std::vector<double> dma;
+  std::vector<double> kernel;
+  xclCounterSample spm;
+};
+
+static uint64_t
+paddr(const utils::buffer& bo)
+{
+  xclBOProperties p;
+  uint64_t addr = !xclGetBOProperties(bo->dev,bo->bo,&p) ? p.paddr : -1;
+  if (addr==static_cast<uint64_t>(-1))
+    throw std::runtime_error("bad buffer object address");
+  return addr;
+}
+
+static void
+init_scheduler(const utils::device& d, bool ert)
+{
+  auto execbo = utils::get_exec_buffer(d,1024);
+  auto ecmd = reinterpret_cast<ert_configure_cmd*>(execbo->data);
+  ecmd->state = ERT_CMD_STATE_NEW;
+  ecmd->opcode = ERT_CONFIGURE;
+
+  ecmd->slot_size = slotsize;
+  ecmd->num_cus = MAXBANKS;
+  ecmd->cu_shift = 16;
+  ecmd->cu_base_addr = d->cu_base_addr;
+
+  ecmd->ert = ert;
+  if (ert) {
+    ecmd->cu_dma = 1;
+    ecmd->cu_isr = 1;
+  }
+
+  // TODO: read from xclbin
+  for (size_t i=0; i<MAXBANKS; ++i)
+    ecmd->data[i] = (i<<16) + d->cu_base_addr;
+
+  ecmd->count = 5 + MAXBANKS;
+
+  if (xclExecBuf(d->handle,execbo->bo))
+    throw std::runtime_error("unable to issue xclExecBuf");
+
+  while (xclExecWait(d->handle,1000)==0);
+}
+
+// Program the copy command of a bank once, it is reissued unchanged
+static void
+configure_copy(bank_type& bank)
+{
+  auto in_addr = paddr(bank.in);
+  auto out_addr = paddr(bank.out);
+
+  auto ecmd = reinterpret_cast<ert_start_kernel_cmd*>(bank.ebo->data);
+  ecmd->opcode = ERT_START_CU;
+  ecmd->count = 1 + (COPY_CONTROL_ADDR_ELEMENTS_DATA/4 + 1);  // cu_mask + regmap
+  ecmd->cu_mask = 1<<bank.index;  // copy_<n> is CU <n> on bank <n>
+
+  ecmd->data[COPY_CONTROL_ADDR_IN_DATA/4] = in_addr;
+  ecmd->data[COPY_CONTROL_ADDR_IN_DATA/4 + 1] = (in_addr >> 32) & 0xFFFFFFFF;
+  ecmd->data[COPY_CONTROL_ADDR_OUT_DATA/4] = out_addr;
+  ecmd->data[COPY_CONTROL_ADDR_OUT_DATA/4 + 1] = (out_addr >> 32) & 0xFFFFFFFF;
+  ecmd->data[COPY_CONTROL_ADDR_ELEMENTS_DATA/4] = bank.in->size / 64;  // ulong8
+}
+
+static void
+start_copy(const utils::device& d, bank_type& bank)
+{
+  auto ecmd = reinterpret_cast<ert_start_kernel_cmd*>(bank.ebo->data);
+  ecmd->state = ERT_CMD_STATE_NEW;
+  bank.running = true;
+  if (xclExecBuf(d->handle,bank.ebo->bo))
+    throw std::runtime_error("unable to issue xclExecBuf");
+}
+
+// Alternate H2D and D2H of the bank's DMA buffer until stopped
+static void
+dma_thread(bank_type& bank, const std::atomic<bool>& stop)
+{
+  auto size = bank.dma->size;
+  for (bool h2d = true; !stop; h2d = !h2d) {
+    auto dir = h2d ? XCL_BO_SYNC_BO_TO_DEVICE : XCL_BO_SYNC_BO_FROM_DEVICE;
+    if (xclSyncBO(bank.dma->dev,bank.dma->bo,dir,size,0))
+      throw std::runtime_error("unable to sync bo");
+    bank.dma_bytes += size;
+  }
+}
+
+// Keep one copy in flight on every bank's CU until stopped, a copy
+// reads and writes the buffer so it moves twice its size
+static void
+kernel_loop(const utils::device& d, std::vector<bank_type>& vbanks, const std::atomic<bool>& stop)
+{
+  for (auto& bank : vbanks)
+    start_copy(d,bank);
+
+  size_t running = vbanks.size();
+  while (running) {
+    while (xclExecWait(d->handle,1000)==0);
+    for (auto& bank : vbanks) {
+      auto epacket = reinterpret_cast<ert_packet*>(bank.ebo->data);
+      if (!bank.running || epacket->state != ERT_CMD_STATE_COMPLETED)
+        continue;
+      bank.running = false;
+      bank.kernel_bytes += 2 * bank.in->size;
+      if (stop)
+        --running;
+      else
+        start_copy(d,bank);
+    }
+  }
+}
+
+static phase_result
+run_phase(const utils::device& d, std::vector<bank_type>& vbanks,
+          bool dma, bool kernel, size_t seconds)
+{
+  std::atomic<bool> stop{false};
+  for (auto& bank : vbanks) {
+    bank.dma_bytes = 0;
+    bank.kernel_bytes = 0;
+  }
+
+  phase_result result;
+  xclPerfMonSampleCounters(d->handle,result.spm);
+  auto zero = utils::time_ns();
+
+  std::vector<std::thread> workers;
+  if (dma)
+    for (auto& bank : vbanks)
+      workers.emplace_back(dma_thread,std::ref(bank),std::cref(stop));
+
+  std::thread timer([&stop,seconds] {
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+  });
+
+  if (kernel)
+    kernel_loop(d,vbanks,stop);
+
+  timer.join();
+  for (auto& t : workers)
+    t.join();
+
+  // Counter rates cover the same interval as the host byte counts
+  xclPerfMonSampleCounters(d->handle,result.spm);
+  double usec = (utils::time_ns() - zero) / 1000.0;
+
+  // bytes per usec is MB/s
+  for (auto& bank : vbanks) {
+    result.dma.push_back(bank.dma_bytes / usec);
+    result.kernel.push_back(bank.kernel_bytes / usec);
+  }
+  return result;
+}
+
+static void
+print_phase(const utils::device& d, const std::string& name, const phase_result& result)
+{
+  double dma = 0, kernel = 0;
+  std::cout << std::fixed << std::setprecision(1);
+  for (size_t b=0; b<result.dma.size(); ++b) {
+    std::cout << name << " bank" << b << " " << result.dma[b] << " " << result.kernel[b] << "\n";
+    dma += result.dma[b];
+    kernel += result.kernel[b];
+  }
+  std::cout << name << " total " << dma << " " << kernel << "\n";
+
+  for (unsigned int s=0; s<result.spm.NumMemSlots; ++s) {
+    char slot[128];
+    xclGetProfilingSlotName(d->handle,XCL_PERF_MON_MEMORY,s,slot,sizeof(slot));
+    std::cout << name << " spm " << slot << " read " << result.spm.ReadMBps[s]
+              << " write " << result.spm.WriteMBps[s] << "\n";
+  }
+}
+
+// Fraction of isolated throughput retained when running concurrently
+static double
+retained(double both, double alone)
+{
+  return alone > 0 ? both / alone : 0;
+}
+
+static int
+run(const utils::device& d, size_t seconds, size_t size, bool ert)
+{
+  init_scheduler(d, ert);
+
+  std::vector<bank_type> vbanks;
+  vbanks.reserve(banks);
+  for (size_t b=0; b<banks; ++b) {
+    auto in = utils::create_bo(d,size,b);
+    std::memset(in->data,b,size);
+    if (xclSyncBO(in->dev,in->bo,XCL_BO_SYNC_BO_TO_DEVICE,size,0))
+      throw std::runtime_error("unable to sync bo");
+    vbanks.emplace_back(b,utils::create_bo(d,size,b),std::move(in),
+                        utils::create_bo(d,size,b),utils::create_exec_bo(d,1024));
+    configure_copy(vbanks.back());
+  }
+
+  std::cout << "phase bank dma_MBps kernel_MBps\n";
+  auto dma = run_phase(d,vbanks,true,false,seconds);
+  print_phase(d,"dma",dma);
+  auto kernel = run_phase(d,vbanks,false,true,seconds);
+  print_phase(d,"kernel",kernel);
+  auto both = run_phase(d,vbanks,true,true,seconds);
+  print_phase(d,"both",both);
+
+  std::cout << std::setprecision(2);
+  for (size_t b=0; b<banks; ++b)
+    std::cout << "interference bank" << b
+              << " dma " << retained(both.dma[b],dma.dma[b])
+              << " kernel " << retained(both.kernel[b],kernel.kernel[b]) << "\n";
+
+  return 0;
+}
+
+int run(int argc, char** argv)
+{
+  std::string bitstream;
+  std::string hallog;
+  int option_index = 0;
+  unsigned device_index = 0;
+  size_t seconds = 2;
+  size_t size = 16;
+  bool verbose = false;
+  bool ert = false;
+  int c;
+  while ((c = getopt_long(argc, argv, "k:l:d:s:vh", long_options, &option_index)) != -1) {
+    switch (c) {
+    case 0:
+      if (long_options[option_index].flag != 0)
+        break;
+    case '1':
+      ert = true;
+      break;
+    case '2':
+      slotsize = std::atoi(optarg);
+      break;
+    case 'k':
+      bitstream = optarg;
+      break;
+    case 'l':
+      hallog = optarg;
+      break;
+    case 'd':
+      device_index = std::atoi(optarg);
+      break;
+    case 's':
+      seconds = std::max(1,std::atoi(optarg));
+      break;
+    case 'm':
+      size = std::max(1,std::atoi(optarg));
+      break;
+    case 'b':
+      banks = std::min(4,std::max(1,std::atoi(optarg)));
+      break;
+    case 'h':
+      printHelp();
+      return 0;
+    case 'v':
+      verbose = true;
+      break;
+    default:
+      printHelp();
+      return -1;
+    }
+  }
+
+  // bogus compiler warnings
+  (void)verbose;
+
+  if (bitstream.empty())
+    throw std::runtime_error("No bitstream specified");
+
+  if (!hallog.empty())
+    std::cout << "Using " << hallog << " as XRT driver logfile\n";
+
+  std::cout << "Compiled kernel = " << bitstream << std::endl;
+
+  auto device = utils::init(bitstream,device_index,hallog);
+
+  xclDeviceInfo2 info;
+  if (xclGetDeviceInfo2(device->handle,&info))
+    throw std::runtime_error("Unable to obtain device information");
+  banks = std::min<size_t>(banks,info.mDDRBankCount);
+
+  run(device,seconds,size*1024*1024,ert);
+
+  return 0;
+}
+
+int
+main(int argc, char* argv[])
+{
+  try {
+    run(argc,argv);
+    return 0;
+  }
+  catch (const std::exception& ex) {
+    std::cout << "TEST FAILED: " << ex.what() << "\n";
+  }
+  catch (...) {
+    std::cout << "TEST FAILED\n";
+  }
+
+  return 1;
+}